@@ -47,11 +47,25 @@
 #define CYW43_LINK_NONET        (-2)
 #define CYW43_LINK_BADAUTH      (-3)
 
+// Counters of the work done by the driver, to see where throughput is lost
+typedef struct _cyw43_stats_t {
+    uint32_t polls; // calls to process packets from the bus
+    uint32_t rx_frames;
+    uint32_t rx_bytes;
+    uint32_t rx_drop_link; // dropped because the interface was down
+    uint32_t rx_drop_mem; // dropped because no pbuf was available
+    uint32_t rx_drop_input; // dropped by lwIP
+    uint32_t tx_frames;
+    uint32_t tx_bytes;
+    uint32_t tx_errors;
+} cyw43_stats_t;
+
 typedef struct _cyw43_t {
     cyw43_ll_t cyw43_ll;
 
     uint8_t itf_state;
     uint32_t trace_flags;
+    cyw43_stats_t stats;
 
     // State for async events
     volatile uint32_t wifi_scan_state;
@@ -89,6 +89,7 @@ void cyw43_init(cyw43_t *self) {
     cyw43_ll_init(&self->cyw43_ll, self);
 
     self->itf_state = 0;
+    memset(&self->stats, 0, sizeof(self->stats));
     self->wifi_scan_state = 0;
     self->wifi_join_state = 0;
     self->pend_disassoc = false;
@@ -183,6 +184,7 @@ STATIC void cyw43_poll_func(void) {
     }
 
     cyw43_t *self = &cyw43_state;
+    ++self->stats.polls;
     cyw43_ll_process_packets(&self->cyw43_ll);
 
     if (self->pend_disassoc) {
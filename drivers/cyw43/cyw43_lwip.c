@@ -74,9 +74,12 @@ STATIC err_t cyw43_netif_output(struct netif *netif, struct pbuf *p) {
     int itf = netif->name[1] - '0';
     int ret = cyw43_send_ethernet(self, itf, p->tot_len, (void*)p, true);
     if (ret) {
+        ++self->stats.tx_errors;
         printf("[CYW43] send_ethernet failed: %d\n", ret);
         return ERR_IF;
     }
+    ++self->stats.tx_frames;
+    self->stats.tx_bytes += p->tot_len;
     return ERR_OK;
 }
 
@@ -164,15 +167,23 @@ void cyw43_cb_process_ethernet(void *cb_data, int itf, size_t len, const uint8_t
     if (self->trace_flags) {
         cyw43_ethernet_trace(self, netif, len, buf, NETUTILS_TRACE_NEWLINE);
     }
-    if (netif->flags & NETIF_FLAG_LINK_UP) {
-        struct pbuf *p = pbuf_alloc(PBUF_RAW, len, PBUF_POOL);
-        if (p != NULL) {
-            pbuf_take(p, buf, len);
-            if (netif->input(p, netif) != ERR_OK) {
-                pbuf_free(p);
-            }
-        }
+    if (!(netif->flags & NETIF_FLAG_LINK_UP)) {
+        ++self->stats.rx_drop_link;
+        return;
+    }
+    struct pbuf *p = pbuf_alloc(PBUF_RAW, len, PBUF_POOL);
+    if (p == NULL) {
+        ++self->stats.rx_drop_mem;
+        return;
+    }
+    pbuf_take(p, buf, len);
+    if (netif->input(p, netif) != ERR_OK) {
+        ++self->stats.rx_drop_input;
+        pbuf_free(p);
+        return;
     }
+    ++self->stats.rx_frames;
+    self->stats.rx_bytes += len;
 }
 
 void cyw43_tcpip_set_link_up(cyw43_t *self, int itf) {
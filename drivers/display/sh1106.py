@@ -0,0 +1,79 @@
+# MicroPython SH1106 OLED driver, I2C and SPI interfaces
+#
+# The SH1106 is driven like the SSD1306, but has 132 columns of memory with
+# the display in the middle 128, and only supports page addressing.
+
+from micropython import const
+import ssd1306
+
+
+# register definitions
+SET_LOW_COL = const(0x00)
+SET_HIGH_COL = const(0x10)
+SET_PUMP_MODE = const(0xAD)
+SET_PAGE = const(0xB0)
+
+
+def _init_display(self):
+    for cmd in (
+        ssd1306.SET_DISP,  # display off
+        ssd1306.SET_DISP_CLK_DIV,
+        0x80,
+        ssd1306.SET_MUX_RATIO,
+        self.height - 1,
+        ssd1306.SET_DISP_OFFSET,
+        0x00,
+        ssd1306.SET_DISP_START_LINE,  # start at line 0
+        SET_PUMP_MODE,
+        0x8A if self.external_vcc else 0x8B,
+        ssd1306.SET_SEG_REMAP | 0x01,  # column addr 131 mapped to SEG0
+        ssd1306.SET_COM_OUT_DIR | 0x08,  # scan from COM[N] to COM0
+        ssd1306.SET_COM_PIN_CFG,
+        0x12,
+        ssd1306.SET_CONTRAST,
+        0xFF,  # maximum
+        ssd1306.SET_PRECHARGE,
+        0x22 if self.external_vcc else 0x1F,
+        ssd1306.SET_VCOM_DESEL,
+        0x40,
+        ssd1306.SET_ENTIRE_ON,  # output follows RAM contents
+        ssd1306.SET_NORM_INV,  # not inverted
+        ssd1306.SET_DISP | 0x01,  # display on
+    ):
+        self.write_cmd(cmd)
+    self.fill(0)
+    self.show()
+
+
+def _show(self, region):
+    if self.bus:
+        self.bus.show_mono(self, self.col_offset, True, region)
+        return
+    for page in range(self.pages):
+        self.write_cmd(SET_PAGE | page)
+        self.write_cmd(SET_LOW_COL | (self.col_offset & 0x0F))
+        self.write_cmd(SET_HIGH_COL | (self.col_offset >> 4))
+        self.write_data(memoryview(self.buffer)[page * self.width : (page + 1) * self.width])
+
+
+class SH1106_I2C(ssd1306.SSD1306_I2C):
+    col_offset = 2
+    page_mode = True
+
+    def init_display(self):
+        _init_display(self)
+
+    def show(self, region=None):
+        _show(self, region)
+
+
+class SH1106_SPI(ssd1306.SSD1306_SPI):
+    col_offset = 2
+    page_mode = True
+
+    def init_display(self):
+        _init_display(self)
+
+    def show(self, region=None):
+        self.spi.init(baudrate=self.rate, polarity=0, phase=0)
+        _show(self, region)
@@ -3,6 +3,11 @@
 from micropython import const
 import framebuf
 
+try:
+    import _display
+except ImportError:
+    _display = None
+
 
 # register definitions
 SET_CONTRAST = const(0x81)
@@ -26,12 +31,22 @@ SET_CHARGE_PUMP = const(0x8D)
 # Subclassing FrameBuffer provides support for graphics primitives
 # http://docs.micropython.org/en/latest/pyboard/library/framebuf.html
 class SSD1306(framebuf.FrameBuffer):
+    # a _display.Bus set up by the subclass, if the firmware has it
+    bus = None
+    # first column of the display in the controller's memory
+    col_offset = 0
+    # whether each page must be addressed on its own (SH1106)
+    page_mode = False
+
     def __init__(self, width, height, external_vcc):
         self.width = width
         self.height = height
         self.external_vcc = external_vcc
         self.pages = self.height // 8
         self.buffer = bytearray(self.pages * self.width)
+        if width == 64:
+            # displays with width of 64 pixels are shifted by 32
+            self.col_offset = 32
         super().__init__(self.buffer, self.width, self.height, framebuf.MONO_VLSB)
         self.init_display()
 
@@ -89,13 +104,14 @@ class SSD1306(framebuf.FrameBuffer):
         self.write_cmd(SET_COM_OUT_DIR | ((rotate & 1) << 3))
         self.write_cmd(SET_SEG_REMAP | (rotate & 1))
 
-    def show(self):
-        x0 = 0
-        x1 = self.width - 1
-        if self.width == 64:
-            # displays with width of 64 pixels are shifted by 32
-            x0 += 32
-            x1 += 32
+    def show(self, region=None):
+        # With _display only the given region, or by default the area drawn to
+        # since the last show(), is sent.  Otherwise the whole buffer is sent.
+        if self.bus:
+            self.bus.show_mono(self, self.col_offset, self.page_mode, region)
+            return
+        x0 = self.col_offset
+        x1 = x0 + self.width - 1
         self.write_cmd(SET_COL_ADDR)
         self.write_cmd(x0)
         self.write_cmd(x1)
@@ -111,14 +127,22 @@ class SSD1306_I2C(SSD1306):
         self.addr = addr
         self.temp = bytearray(2)
         self.write_list = [b"\x40", None]  # Co=0, D/C#=1
+        if _display:
+            self.bus = _display.Bus(i2c, addr)
         super().__init__(width, height, external_vcc)
 
     def write_cmd(self, cmd):
+        if self.bus:
+            self.bus.cmd(cmd)
+            return
         self.temp[0] = 0x80  # Co=1, D/C#=0
         self.temp[1] = cmd
         self.i2c.writeto(self.addr, self.temp)
 
     def write_data(self, buf):
+        if self.bus:
+            self.bus.data(buf)
+            return
         self.write_list[1] = buf
         self.i2c.writevto(self.addr, self.write_list)
 
@@ -140,10 +164,19 @@ class SSD1306_SPI(SSD1306):
         self.res(0)
         time.sleep_ms(10)
         self.res(1)
+        if _display:
+            self.bus = _display.Bus(spi, dc, cs)
         super().__init__(width, height, external_vcc)
 
+    def show(self, region=None):
+        self.spi.init(baudrate=self.rate, polarity=0, phase=0)
+        super().show(region)
+
     def write_cmd(self, cmd):
         self.spi.init(baudrate=self.rate, polarity=0, phase=0)
+        if self.bus:
+            self.bus.cmd(cmd)
+            return
         self.cs(1)
         self.dc(0)
         self.cs(0)
@@ -152,6 +185,9 @@ class SSD1306_SPI(SSD1306):
 
     def write_data(self, buf):
         self.spi.init(baudrate=self.rate, polarity=0, phase=0)
+        if self.bus:
+            self.bus.data(buf)
+            return
         self.cs(1)
         self.dc(1)
         self.cs(0)
@@ -0,0 +1,93 @@
+# MicroPython ST7789 and ILI9341 TFT LCD driver, SPI interface
+#
+# These take RGB565 pixels over a MIPI DCS command set.  The frame buffer is
+# sent by the _display module, which must be enabled in the firmware.
+
+from micropython import const
+import framebuf
+import time
+import _display
+
+
+# register definitions
+SWRESET = const(0x01)
+SLPOUT = const(0x11)
+NORON = const(0x13)
+INVOFF = const(0x20)
+INVON = const(0x21)
+DISPON = const(0x29)
+MADCTL = const(0x36)
+COLMOD = const(0x3A)
+
+# MADCTL bits
+MADCTL_MY = const(0x80)
+MADCTL_MX = const(0x40)
+MADCTL_MV = const(0x20)
+MADCTL_BGR = const(0x08)
+
+
+class ST7789(framebuf.FrameBuffer):
+    def __init__(self, width, height, spi, dc, cs, rst=None, x_offset=0, y_offset=0, madctl=0):
+        self.width = width
+        self.height = height
+        self.x_offset = x_offset
+        self.y_offset = y_offset
+        self.madctl = madctl
+        self.spi = spi
+        dc.init(dc.OUT, value=0)
+        cs.init(cs.OUT, value=1)
+        if rst:
+            rst.init(rst.OUT, value=0)
+            time.sleep_ms(10)
+            rst(1)
+        self.bus = _display.Bus(spi, dc, cs)
+        self.buffer = bytearray(width * height * 2)
+        super().__init__(self.buffer, width, height, framebuf.RGB565)
+        self.init_display()
+
+    def write_cmd(self, cmd, data=None):
+        self.bus.cmd(cmd)
+        if data:
+            self.bus.data(data)
+
+    def init_display(self):
+        self.write_cmd(SWRESET)
+        time.sleep_ms(150)
+        self.write_cmd(SLPOUT)
+        time.sleep_ms(10)
+        self.write_cmd(COLMOD, b"\x55")  # 16 bits per pixel
+        self.write_cmd(MADCTL, bytes((self.madctl,)))
+        self.write_cmd(INVON)
+        self.write_cmd(NORON)
+        self.fill(0)
+        self.show()
+        self.write_cmd(DISPON)
+
+    def invert(self, invert):
+        # most ST7789 panels need the controller inverted to show true colours
+        self.write_cmd(INVOFF if invert else INVON)
+
+    def show(self, region=None):
+        # Send the given (x, y, w, h) region, or by default the area drawn to
+        # since the last show().
+        self.bus.show_rgb565(self, self.x_offset, self.y_offset, region)
+
+
+class ILI9341(ST7789):
+    def __init__(self, width, height, spi, dc, cs, rst=None, madctl=MADCTL_MX | MADCTL_BGR):
+        super().__init__(width, height, spi, dc, cs, rst, 0, 0, madctl)
+
+    def init_display(self):
+        self.write_cmd(SWRESET)
+        time.sleep_ms(150)
+        self.write_cmd(SLPOUT)
+        time.sleep_ms(120)
+        self.write_cmd(COLMOD, b"\x55")  # 16 bits per pixel
+        self.write_cmd(MADCTL, bytes((self.madctl,)))
+        self.write_cmd(NORON)
+        self.fill(0)
+        self.show()
+        self.write_cmd(DISPON)
+
+    def invert(self, invert):
+        self.write_cmd(INVON if invert else INVOFF)
@@ -289,46 +289,98 @@ int mp_spiflash_write(mp_spiflash_t *self, uint32_t addr, size_t len, const uint
 
 #if MICROPY_HW_SPIFLASH_ENABLE_CACHE
 
+#define CACHE_NUM_BLOCKS MICROPY_HW_SPIFLASH_CACHE_NUM_BLOCKS
+
+// Returns the buf holding the given sector, or -1 if it's not in the cache.
+STATIC int mp_spiflash_cache_find(mp_spiflash_t *self, uint32_t sec) {
+    mp_spiflash_cache_t *cache = self->config->cache;
+    if (cache->user == self) {
+        for (int i = 0; i < CACHE_NUM_BLOCKS; ++i) {
+            if (cache->block[i] == sec) {
+                return i;
+            }
+        }
+    }
+    return -1;
+}
+
+// Makes the given buf the most recently used one.
+STATIC void mp_spiflash_cache_touch(mp_spiflash_cache_t *cache, int idx) {
+    int i = 0;
+    while (cache->lru[i] != idx) {
+        ++i;
+    }
+    for (; i > 0; --i) {
+        cache->lru[i] = cache->lru[i - 1];
+    }
+    cache->lru[0] = idx;
+}
+
 void mp_spiflash_cached_read(mp_spiflash_t *self, uint32_t addr, size_t len, uint8_t *dest) {
     if (len == 0) {
         return;
     }
     mp_spiflash_acquire_bus(self);
     mp_spiflash_cache_t *cache = self->config->cache;
-    if (cache->user == self && cache->block != 0xffffffff) {
-        uint32_t bis = addr / SECTOR_SIZE;
-        uint32_t bie = (addr + len - 1) / SECTOR_SIZE;
-        if (bis <= cache->block && cache->block <= bie) {
-            // Read straddles current buffer
-            size_t rest = 0;
-            if (bis < cache->block) {
-                // Read direct from flash for first part
-                rest = cache->block * SECTOR_SIZE - addr;
-                mp_spiflash_read_data(self, addr, rest, dest);
-                len -= rest;
-                dest += rest;
-                addr += rest;
-            }
-            uint32_t offset = addr & (SECTOR_SIZE - 1);
-            rest = SECTOR_SIZE - offset;
-            if (rest > len) {
-                rest = len;
-            }
-            memcpy(dest, &cache->buf[offset], rest);
-            len -= rest;
-            if (len == 0) {
-                mp_spiflash_release_bus(self);
-                return;
+    while (len) {
+        uint32_t offset = addr & (SECTOR_SIZE - 1);
+        size_t rest = SECTOR_SIZE - offset;
+        if (rest > len) {
+            rest = len;
+        }
+        int idx = mp_spiflash_cache_find(self, addr / SECTOR_SIZE);
+        if (idx >= 0) {
+            memcpy(dest, &cache->buf[idx][offset], rest);
+        } else {
+            // Read direct from flash, in one transfer up to the next cached sector
+            while (rest < len && mp_spiflash_cache_find(self, (addr + rest) / SECTOR_SIZE) < 0) {
+                rest += len - rest < SECTOR_SIZE ? len - rest : SECTOR_SIZE;
             }
-            dest += rest;
-            addr += rest;
+            mp_spiflash_read_data(self, addr, rest, dest);
         }
+        len -= rest;
+        addr += rest;
+        dest += rest;
     }
-    // Read rest direct from flash
-    mp_spiflash_read_data(self, addr, len, dest);
     mp_spiflash_release_bus(self);
 }
 
+STATIC int mp_spiflash_cache_write_back(mp_spiflash_t *self, int idx) {
+    mp_spiflash_cache_t *cache = self->config->cache;
+    uint32_t addr = cache->block[idx] * SECTOR_SIZE;
+    const uint8_t *buf = cache->buf[idx];
+
+    cache->dirty &= ~(1u << idx);
+
+    // Erase sector, unless it was found erased when read into the cache
+    if (!(cache->erased & (1u << idx))) {
+        int ret = mp_spiflash_erase_block_internal(self, addr);
+        if (ret != 0) {
+            return ret;
+        }
+        cache->erased |= 1u << idx;
+    }
+
+    // Write, skipping pages that are left erased
+    for (int i = 0; i < SECTOR_SIZE / PAGE_SIZE; i += 1) {
+        const uint8_t *page = buf + i * PAGE_SIZE;
+        size_t n = 0;
+        while (n < PAGE_SIZE && page[n] == 0xff) {
+            ++n;
+        }
+        if (n == PAGE_SIZE) {
+            continue;
+        }
+        cache->erased &= ~(1u << idx);
+        int ret = mp_spiflash_write_page(self, addr + i * PAGE_SIZE, PAGE_SIZE, page);
+        if (ret != 0) {
+            return ret;
+        }
+    }
+
+    return 0;
+}
+
 STATIC void mp_spiflash_cache_flush_internal(mp_spiflash_t *self) {
     #if USE_WR_DELAY
     if (!(self->flags & 1)) {
@@ -339,17 +391,15 @@ STATIC void mp_spiflash_cache_flush_internal(mp_spiflash_t *self) {
 
     mp_spiflash_cache_t *cache = self->config->cache;
 
-    // Erase sector
-    int ret = mp_spiflash_erase_block_internal(self, cache->block * SECTOR_SIZE);
-    if (ret != 0) {
-        return;
-    }
-
-    // Write
-    for (int i = 0; i < 16; i += 1) {
-        uint32_t addr = cache->block * SECTOR_SIZE + i * PAGE_SIZE;
-        int ret = mp_spiflash_write_page(self, addr, PAGE_SIZE, cache->buf + i * PAGE_SIZE);
-        if (ret != 0) {
+    // Write back the dirty sectors in order of address
+    while (cache->dirty) {
+        int idx = -1;
+        for (int i = 0; i < CACHE_NUM_BLOCKS; ++i) {
+            if ((cache->dirty & (1u << i)) && (idx < 0 || cache->block[i] < cache->block[idx])) {
+                idx = i;
+            }
+        }
+        if (mp_spiflash_cache_write_back(self, idx) != 0) {
             return;
         }
     }
@@ -376,39 +426,69 @@ STATIC int mp_spiflash_cached_write_part(mp_spiflash_t *self, uint32_t addr, siz
 
     mp_spiflash_cache_t *cache = self->config->cache;
 
-    // Acquire the sector buffer
+    // Acquire the sector buffers
     if (cache->user != self) {
         if (cache->user != NULL) {
             mp_spiflash_cache_flush(cache->user);
         }
         cache->user = self;
-        cache->block = 0xffffffff;
+        cache->dirty = 0;
+        cache->erased = 0;
+        for (int i = 0; i < CACHE_NUM_BLOCKS; ++i) {
+            cache->block[i] = 0xffffffff;
+            cache->lru[i] = i;
+        }
     }
 
-    if (cache->block != sec) {
-        // Read sector
+    int idx = mp_spiflash_cache_find(self, sec);
+    if (idx < 0) {
+        // Reuse the least recently used buffer
+        idx = cache->lru[CACHE_NUM_BLOCKS - 1];
         #if USE_WR_DELAY
-        if (cache->block != 0xffffffff) {
-            mp_spiflash_cache_flush_internal(self);
+        if (cache->dirty & (1u << idx)) {
+            int ret = mp_spiflash_cache_write_back(self, idx);
+            if (ret != 0) {
+                return ret;
+            }
+            if (!cache->dirty) {
+                self->flags &= ~1;
+            }
         }
         #endif
-        mp_spiflash_read_data(self, addr, SECTOR_SIZE, cache->buf);
+        cache->block[idx] = 0xffffffff;
+        cache->erased &= ~(1u << idx);
+        if (!USE_WR_DELAY || len < SECTOR_SIZE) {
+            // Read sector, noting if it's erased so the write back can skip the
+            // erase; a write of the whole sector doesn't need the old contents
+            uint8_t *buf = cache->buf[idx];
+            mp_spiflash_read_data(self, addr, SECTOR_SIZE, buf);
+            size_t n = 0;
+            while (n < SECTOR_SIZE && buf[n] == 0xff) {
+                ++n;
+            }
+            if (n == SECTOR_SIZE) {
+                cache->erased |= 1u << idx;
+            }
+        }
     }
+    mp_spiflash_cache_touch(cache, idx);
+    uint8_t *buf = cache->buf[idx];
 
     #if USE_WR_DELAY
 
-    cache->block = sec;
+    cache->block[idx] = sec;
     // Just copy to buffer
-    memcpy(cache->buf + offset, src, len);
+    memcpy(buf + offset, src, len);
     // And mark dirty
+    cache->dirty |= 1u << idx;
     self->flags |= 1;
 
     #else
 
     uint32_t dirty = 0;
     for (size_t i = 0; i < len; ++i) {
-        if (cache->buf[offset + i] != src[i]) {
-            if (cache->buf[offset + i] != 0xff) {
+        if (buf[offset + i] != src[i]) {
+            if (buf[offset + i] != 0xff) {
                 // Erase sector
                 int ret = mp_spiflash_erase_block_internal(self, addr);
                 if (ret != 0) {
@@ -422,14 +502,14 @@ STATIC int mp_spiflash_cached_write_part(mp_spiflash_t *self, uint32_t addr, siz
         }
     }
 
-    cache->block = sec;
+    cache->block[idx] = sec;
     // Copy new block into buffer
-    memcpy(cache->buf + offset, src, len);
+    memcpy(buf + offset, src, len);
 
     // Write sector in pages of 256 bytes
     for (size_t i = 0; i < 16; ++i) {
         if (dirty & (1 << i)) {
-            int ret = mp_spiflash_write_page(self, addr + i * PAGE_SIZE, PAGE_SIZE, cache->buf + i * PAGE_SIZE);
+            int ret = mp_spiflash_write_page(self, addr + i * PAGE_SIZE, PAGE_SIZE, buf + i * PAGE_SIZE);
             if (ret != 0) {
                 return ret;
             }
@@ -442,58 +522,13 @@ STATIC int mp_spiflash_cached_write_part(mp_spiflash_t *self, uint32_t addr, siz
 }
 
 int mp_spiflash_cached_write(mp_spiflash_t *self, uint32_t addr, size_t len, const uint8_t *src) {
-    uint32_t bis = addr / SECTOR_SIZE;
-    uint32_t bie = (addr + len - 1) / SECTOR_SIZE;
-
     mp_spiflash_acquire_bus(self);
 
-    mp_spiflash_cache_t *cache = self->config->cache;
-    if (cache->user == self && bis <= cache->block && bie >= cache->block) {
-        // Write straddles current buffer
-        uint32_t pre;
-        uint32_t offset;
-        if (cache->block * SECTOR_SIZE >= addr) {
-            pre = cache->block * SECTOR_SIZE - addr;
-            offset = 0;
-        } else {
-            pre = 0;
-            offset = addr - cache->block * SECTOR_SIZE;
-        }
-
-        // Write buffered part first
-        uint32_t len_in_buf = len - pre;
-        len = 0;
-        if (len_in_buf > SECTOR_SIZE - offset) {
-            len = len_in_buf - (SECTOR_SIZE - offset);
-            len_in_buf = SECTOR_SIZE - offset;
-        }
-        memcpy(&cache->buf[offset], &src[pre], len_in_buf);
-        self->flags |= 1; // Mark dirty
-
-        // Write part before buffer sector
-        while (pre) {
-            int rest = pre & (SECTOR_SIZE - 1);
-            if (rest == 0) {
-                rest = SECTOR_SIZE;
-            }
-            int ret = mp_spiflash_cached_write_part(self, addr, rest, src);
-            if (ret != 0) {
-                mp_spiflash_release_bus(self);
-                return ret;
-            }
-            src += rest;
-            addr += rest;
-            pre -= rest;
-        }
-        src += len_in_buf;
-        addr += len_in_buf;
-
-        // Fall through to write remaining part
-    }
-
+    // Write each sector through the cache; sectors already cached are only
+    // updated in their buffer
     uint32_t offset = addr & (SECTOR_SIZE - 1);
     while (len) {
-        int rest = SECTOR_SIZE - offset;
+        size_t rest = SECTOR_SIZE - offset;
         if (rest > len) {
             rest = len;
         }
@@ -39,13 +39,30 @@ enum {
 struct _mp_spiflash_t;
 
 #if MICROPY_HW_SPIFLASH_ENABLE_CACHE
+
+// Number of erase blocks held by the write-back cache.  With more than one, a
+// filesystem can update its metadata and data blocks in turn without the
+// cache writing one of them back (erase and program) at each switch.
+#ifndef MICROPY_HW_SPIFLASH_CACHE_NUM_BLOCKS
+#define MICROPY_HW_SPIFLASH_CACHE_NUM_BLOCKS (1)
+#endif
+
+#if MICROPY_HW_SPIFLASH_CACHE_NUM_BLOCKS < 1 || MICROPY_HW_SPIFLASH_CACHE_NUM_BLOCKS > 32
+#error MICROPY_HW_SPIFLASH_CACHE_NUM_BLOCKS must be between 1 and 32
+#endif
+
 // A cache must be provided by the user in the config struct.  The same cache
-// struct can be shared by multiple SPI flash instances.
+// struct can be shared by multiple SPI flash instances.  It can be zero
+// initialised (eg be in .bss).
 typedef struct _mp_spiflash_cache_t {
-    uint8_t buf[MP_SPIFLASH_ERASE_BLOCK_SIZE] __attribute__((aligned(4)));
+    uint8_t buf[MICROPY_HW_SPIFLASH_CACHE_NUM_BLOCKS][MP_SPIFLASH_ERASE_BLOCK_SIZE] __attribute__((aligned(4)));
     struct _mp_spiflash_t *user; // current user of buf, for shared use
-    uint32_t block; // current block stored in buf; 0xffffffff if invalid
+    uint32_t block[MICROPY_HW_SPIFLASH_CACHE_NUM_BLOCKS]; // block stored in each buf; 0xffffffff if invalid
+    uint32_t dirty; // bitmask of bufs that must be written back to the flash
+    uint32_t erased; // bitmask of bufs whose block is known to be erased in the flash
+    uint8_t lru[MICROPY_HW_SPIFLASH_CACHE_NUM_BLOCKS]; // buf indices, most recently used first
 } mp_spiflash_cache_t;
+
 #endif
 
 typedef struct _mp_spiflash_config_t {
@@ -1,4 +1,8 @@
 """NRF24L01 driver for MicroPython
+
+Firmware built with MICROPY_PY_NRF24L01 also has the _nrf24l01 module, a C
+version of this driver that buffers packets and handles the radio from its
+IRQ pin, for links that need high packet rates.
 """
 
 from micropython import const
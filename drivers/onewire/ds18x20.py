@@ -37,7 +37,19 @@ class DS18X20:
         self.ow.write(buf)
 
     def read_temp(self, rom):
-        buf = self.read_scratch(rom)
+        return self._temp(rom, self.read_scratch(rom))
+
+    def read_temps(self, roms):
+        # read all the sensors in one go, giving None for any with a CRC error
+        buf = bytearray(9 * len(roms))
+        self.ow.select_readinto(roms, _RD_SCRATCH, buf)
+        temps = []
+        for i, rom in enumerate(roms):
+            scratch = memoryview(buf)[9 * i : 9 * i + 9]
+            temps.append(None if self.ow.crc8(scratch) else self._temp(rom, scratch))
+        return temps
+
+    def _temp(self, rom, buf):
         if rom[0] == 0x10:
             if buf[1]:
                 t = buf[0] >> 1 | 0x80
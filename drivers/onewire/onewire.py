@@ -30,8 +30,7 @@ class OneWire:
         return _ow.readbyte(self.pin)
 
     def readinto(self, buf):
-        for i in range(len(buf)):
-            buf[i] = _ow.readbyte(self.pin)
+        _ow.readinto(self.pin, buf)
 
     def writebit(self, value):
         return _ow.writebit(self.pin, value)
@@ -40,8 +39,7 @@ class OneWire:
         return _ow.writebyte(self.pin, value)
 
     def write(self, buf):
-        for b in buf:
-            _ow.writebyte(self.pin, b)
+        _ow.write(self.pin, buf)
 
     def select_rom(self, rom):
         self.reset()
@@ -49,44 +47,12 @@ class OneWire:
         self.write(rom)
 
     def scan(self):
-        devices = []
-        diff = 65
-        rom = False
-        for i in range(0xFF):
-            rom, diff = self._search_rom(rom, diff)
-            if rom:
-                devices += [rom]
-            if diff == 0:
-                break
-        return devices
-
-    def _search_rom(self, l_rom, diff):
-        if not self.reset():
-            return None, 0
-        self.writebyte(self.SEARCH_ROM)
-        if not l_rom:
-            l_rom = bytearray(8)
-        rom = bytearray(8)
-        next_diff = 0
-        i = 64
-        for byte in range(8):
-            r_b = 0
-            for bit in range(8):
-                b = self.readbit()
-                if self.readbit():
-                    if b:  # there are no devices or there is an error on the bus
-                        return None, 0
-                else:
-                    if not b:  # collision, two devices with different bit meaning
-                        if diff > i or ((l_rom[byte] & (1 << bit)) and diff != i):
-                            b = 1
-                            next_diff = i
-                self.writebit(b)
-                if b:
-                    r_b |= 1 << bit
-                i -= 1
-            rom[byte] = r_b
-        return rom, next_diff
+        return _ow.search(self.pin)
+
+    def select_readinto(self, roms, cmd, buf):
+        # select each device in turn, send it cmd and read its reply into the
+        # next len(buf) // len(roms) bytes of buf
+        _ow.select_readinto(self.pin, roms, cmd, buf)
 
     def crc8(self, data):
         return _ow.crc8(data)
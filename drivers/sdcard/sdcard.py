@@ -18,6 +18,9 @@ Example usage on ESP8266:
     os.mount(sd, '/sd')
     os.listdir('/')
 
+On esp8266 and rp2, machine.SDCard(spi, cs) is a faster C version of this
+driver, taking the same arguments.
+
 """
 
 from micropython import const
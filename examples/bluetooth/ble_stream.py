@@ -0,0 +1,81 @@
+# Helpers to stream bulk data over BLE from uasyncio tasks.
+#
+# NotifyStream sends a buffer as a sequence of notifications with
+# BLE.gatts_notify_stream, and L2CAPStream wraps an L2CAP channel with
+# awaitable write/readinto methods.  Both wait on a ThreadSafeFlag that is set
+# from the BLE IRQ handler, so the application's handler must pass events on
+# to the stream's irq method.
+
+import uasyncio as asyncio
+from micropython import const
+
+_IRQ_L2CAP_DISCONNECT = const(24)
+_IRQ_L2CAP_RECV = const(25)
+_IRQ_L2CAP_SEND_READY = const(26)
+_IRQ_GATTS_NOTIFY_READY = const(32)
+
+
+class NotifyStream:
+    def __init__(self, ble, conn_handle, value_handle):
+        self._ble = ble
+        self._conn_handle = conn_handle
+        self._value_handle = value_handle
+        self._ready = asyncio.ThreadSafeFlag()
+
+    def irq(self, event, data):
+        if event == _IRQ_GATTS_NOTIFY_READY:
+            # The stack's buffers are shared, so any stream may continue.
+            self._ready.set()
+
+    async def write(self, buf):
+        mv = memoryview(buf)
+        while mv:
+            n = self._ble.gatts_notify_stream(self._conn_handle, self._value_handle, mv)
+            mv = mv[n:]
+            if mv:
+                await self._ready.wait()
+
+
+class L2CAPStream:
+    def __init__(self, ble, conn_handle, cid, mtu):
+        self._ble = ble
+        self._conn_handle = conn_handle
+        self._cid = cid
+        self._mtu = mtu
+        self._send_ready = asyncio.ThreadSafeFlag()
+        self._recv_ready = asyncio.ThreadSafeFlag()
+        self._closed = False
+
+    def irq(self, event, data):
+        if data[0] != self._conn_handle or data[1] != self._cid:
+            return
+        if event == _IRQ_L2CAP_SEND_READY:
+            self._send_ready.set()
+        elif event == _IRQ_L2CAP_RECV:
+            self._recv_ready.set()
+        elif event == _IRQ_L2CAP_DISCONNECT:
+            self._closed = True
+            self._send_ready.set()
+            self._recv_ready.set()
+
+    async def write(self, buf):
+        mv = memoryview(buf)
+        while mv:
+            if self._closed:
+                raise OSError(107)  # ENOTCONN
+            chunk = mv[: self._mtu]
+            if not self._ble.l2cap_send(self._conn_handle, self._cid, chunk):
+                # Channel is stalled until the peer grants more credits.
+                await self._send_ready.wait()
+            mv = mv[len(chunk) :]
+
+    async def readinto(self, buf):
+        while True:
+            n = self._ble.l2cap_recvinto(self._conn_handle, self._cid, buf)
+            if n or self._closed:
+                return n
+            await self._recv_ready.wait()
+
+    def close(self):
+        if not self._closed:
+            self._ble.l2cap_disconnect(self._conn_handle, self._cid)
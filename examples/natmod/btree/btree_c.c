@@ -110,12 +110,13 @@ STATIC mp_obj_t btree_open(size_t n_args, const mp_obj_t *args) {
     openinfo.cachesize = mp_obj_get_int(args[2]);
     openinfo.psize = mp_obj_get_int(args[3]);
     openinfo.minkeypage = mp_obj_get_int(args[4]);
-    DB *db = __bt_open(MP_OBJ_TO_PTR(args[0]), &btree_stream_fvtable, &openinfo, 0);
-    if (db == NULL) {
+    mp_obj_btree_t *self = btree_new(args[0], 0);
+    self->db = __bt_open(&self->wb, &btree_stream_fvtable, &openinfo, 0);
+    if (self->db == NULL) {
         mp_raise_OSError(native_errno);
     }
 
-    return MP_OBJ_FROM_PTR(btree_new(db, args[0]));
+    return MP_OBJ_FROM_PTR(self);
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(btree_open_obj, 5, 5, btree_open);
 
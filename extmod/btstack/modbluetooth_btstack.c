@@ -1107,6 +1107,48 @@ int mp_bluetooth_gatts_notify_send(uint16_t conn_handle, uint16_t value_handle,
     }
 }
 
+STATIC void btstack_notify_stream_ready_handler(void *context) {
+    mp_bluetooth_btstack_root_pointers_t *rp = (mp_bluetooth_btstack_root_pointers_t *)context;
+    rp->notify_stream_waiting = false;
+    mp_bluetooth_gatts_on_notify_ready(rp->notify_stream_conn_handle, rp->notify_stream_value_handle);
+}
+
+int mp_bluetooth_gatts_notify_stream(uint16_t conn_handle, uint16_t value_handle, const uint8_t *value, size_t value_len, size_t *sent) {
+    DEBUG_printf("mp_bluetooth_gatts_notify_stream\n");
+    *sent = 0;
+    uint16_t mtu = att_server_get_mtu(conn_handle);
+    if (mtu == 0) {
+        return MP_ENOTCONN;
+    }
+
+    MICROPY_PY_BLUETOOTH_ENTER
+    int err = ERROR_CODE_SUCCESS;
+    while (*sent < value_len) {
+        size_t len = MIN(value_len - *sent, (size_t)mtu - 3);
+        // btstack copies the data into an ACL buffer, or fails if there is none free.
+        err = att_server_notify(conn_handle, value_handle, value + *sent, len);
+        if (err != ERROR_CODE_SUCCESS) {
+            break;
+        }
+        *sent += len;
+    }
+    mp_bluetooth_btstack_root_pointers_t *rp = MP_STATE_PORT(bluetooth_btstack_root_pointers);
+    if (err == BTSTACK_ACL_BUFFERS_FULL) {
+        err = ERROR_CODE_SUCCESS;
+        rp->notify_stream_conn_handle = conn_handle;
+        rp->notify_stream_value_handle = value_handle;
+        if (!rp->notify_stream_waiting) {
+            rp->notify_stream_ready.callback = &btstack_notify_stream_ready_handler;
+            rp->notify_stream_ready.context = rp;
+            err = att_server_request_to_send_notification(&rp->notify_stream_ready, conn_handle);
+            rp->notify_stream_waiting = err == ERROR_CODE_SUCCESS;
+        }
+    }
+    MICROPY_PY_BLUETOOTH_EXIT
+
+    return btstack_error_to_errno(err);
+}
+
 int mp_bluetooth_gatts_indicate(uint16_t conn_handle, uint16_t value_handle) {
     DEBUG_printf("mp_bluetooth_gatts_indicate\n");
 
@@ -46,6 +46,12 @@ typedef struct _mp_bluetooth_btstack_root_pointers_t {
 
     btstack_linked_list_t pending_ops;
 
+    // Wakeup for a gatts_notify_stream that filled the ACL buffers.
+    btstack_context_callback_registration_t notify_stream_ready;
+    bool notify_stream_waiting;
+    uint16_t notify_stream_conn_handle;
+    uint16_t notify_stream_value_handle;
+
     #if MICROPY_PY_BLUETOOTH_ENABLE_CENTRAL_MODE
     // Registration for notify/indicate events.
     gatt_client_notification_t notification;
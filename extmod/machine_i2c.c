@@ -605,6 +605,69 @@ STATIC mp_obj_t machine_i2c_writeto_mem(size_t n_args, const mp_obj_t *pos_args,
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_KW(machine_i2c_writeto_mem_obj, 1, machine_i2c_writeto_mem);
 
+#if MICROPY_PY_MACHINE_I2C_TRANSFER_BATCH
+
+// Operation codes for the entries given to transfer_batch.
+#define MACHINE_I2C_BATCH_READ (0)
+#define MACHINE_I2C_BATCH_WRITE (1)
+#define MACHINE_I2C_BATCH_READ_MEM (2)
+#define MACHINE_I2C_BATCH_WRITE_MEM (3)
+
+// Execute a sequence of operations, each a tuple of one of the forms:
+//   (READ, addr, buf) or (WRITE, addr, buf)
+//   (READ_MEM, addr, memaddr, buf[, addrsize]) or (WRITE_MEM, addr, memaddr, buf[, addrsize])
+// Read data goes into the given buffers, so nothing is allocated on the heap.
+STATIC mp_obj_t machine_i2c_transfer_batch(mp_obj_t self_in, mp_obj_t ops_in) {
+    mp_obj_base_t *self = (mp_obj_base_t *)MP_OBJ_TO_PTR(self_in);
+
+    size_t nops;
+    mp_obj_t *ops;
+    mp_obj_get_array(ops_in, &nops, &ops);
+
+    for (size_t i = 0; i < nops; ++i) {
+        size_t nitems;
+        mp_obj_t *items;
+        mp_obj_get_array(ops[i], &nitems, &items);
+        if (nitems < 3) {
+            mp_raise_ValueError(MP_ERROR_TEXT("invalid I2C operation"));
+        }
+        mp_int_t op = mp_obj_get_int(items[0]);
+        mp_int_t addr = mp_obj_get_int(items[1]);
+        bool is_read = op == MACHINE_I2C_BATCH_READ || op == MACHINE_I2C_BATCH_READ_MEM;
+        mp_buffer_info_t bufinfo;
+
+        int ret;
+        if ((op == MACHINE_I2C_BATCH_READ || op == MACHINE_I2C_BATCH_WRITE) && nitems == 3) {
+            mp_get_buffer_raise(items[2], &bufinfo, is_read ? MP_BUFFER_WRITE : MP_BUFFER_READ);
+            if (is_read) {
+                ret = mp_machine_i2c_readfrom(self, addr, bufinfo.buf, bufinfo.len, true);
+            } else {
+                ret = mp_machine_i2c_writeto(self, addr, bufinfo.buf, bufinfo.len, true);
+            }
+        } else if ((op == MACHINE_I2C_BATCH_READ_MEM || op == MACHINE_I2C_BATCH_WRITE_MEM) && nitems <= 5) {
+            mp_get_buffer_raise(items[3], &bufinfo, is_read ? MP_BUFFER_WRITE : MP_BUFFER_READ);
+            mp_int_t memaddr = mp_obj_get_int(items[2]);
+            mp_int_t addrsize = nitems == 5 ? mp_obj_get_int(items[4]) : 8;
+            if (is_read) {
+                ret = read_mem(self_in, addr, memaddr, addrsize, bufinfo.buf, bufinfo.len);
+            } else {
+                ret = write_mem(self_in, addr, memaddr, addrsize, bufinfo.buf, bufinfo.len);
+            }
+        } else {
+            mp_raise_ValueError(MP_ERROR_TEXT("invalid I2C operation"));
+        }
+
+        if (ret < 0) {
+            mp_raise_OSError(-ret);
+        }
+    }
+
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(machine_i2c_transfer_batch_obj, machine_i2c_transfer_batch);
+
+#endif
+
 STATIC const mp_rom_map_elem_t machine_i2c_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_init), MP_ROM_PTR(&machine_i2c_init_obj) },
     { MP_ROM_QSTR(MP_QSTR_scan), MP_ROM_PTR(&machine_i2c_scan_obj) },
@@ -625,6 +688,15 @@ STATIC const mp_rom_map_elem_t machine_i2c_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_readfrom_mem), MP_ROM_PTR(&machine_i2c_readfrom_mem_obj) },
     { MP_ROM_QSTR(MP_QSTR_readfrom_mem_into), MP_ROM_PTR(&machine_i2c_readfrom_mem_into_obj) },
     { MP_ROM_QSTR(MP_QSTR_writeto_mem), MP_ROM_PTR(&machine_i2c_writeto_mem_obj) },
+
+    #if MICROPY_PY_MACHINE_I2C_TRANSFER_BATCH
+    // batched operations
+    { MP_ROM_QSTR(MP_QSTR_transfer_batch), MP_ROM_PTR(&machine_i2c_transfer_batch_obj) },
+    { MP_ROM_QSTR(MP_QSTR_READ), MP_ROM_INT(MACHINE_I2C_BATCH_READ) },
+    { MP_ROM_QSTR(MP_QSTR_WRITE), MP_ROM_INT(MACHINE_I2C_BATCH_WRITE) },
+    { MP_ROM_QSTR(MP_QSTR_READ_MEM), MP_ROM_INT(MACHINE_I2C_BATCH_READ_MEM) },
+    { MP_ROM_QSTR(MP_QSTR_WRITE_MEM), MP_ROM_INT(MACHINE_I2C_BATCH_WRITE_MEM) },
+    #endif
 };
 MP_DEFINE_CONST_DICT(mp_machine_i2c_locals_dict, machine_i2c_locals_dict_table);
 
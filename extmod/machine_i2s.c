@@ -0,0 +1,336 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "py/runtime.h"
+#include "py/stream.h"
+#include "py/mperrno.h"
+#include "py/mphal.h"
+#include "extmod/machine_i2s.h"
+
+#if MICROPY_PY_MACHINE_I2S
+
+#if !MICROPY_ENABLE_SCHEDULER
+#error machine.I2S requires MICROPY_ENABLE_SCHEDULER
+#endif
+
+// The stream methods block until all of the data is transferred, unless a
+// handler is set with irq(), in which case they transfer what they can and
+// return.  The handler is scheduled when the DMA interrupt takes the ring
+// buffer past its half-way mark: on RX when it fills to half, and on TX when
+// it drains to half, so the handler has half a buffer of time to respond.
+
+#ifdef MICROPY_EVENT_POLL_HOOK
+#define MACHINE_I2S_WAIT() MICROPY_EVENT_POLL_HOOK
+#else
+#define MACHINE_I2S_WAIT() mp_handle_pending(true)
+#endif
+
+STATIC size_t machine_i2s_frame_size(machine_i2s_obj_t *self) {
+    return self->bits / 8 * (self->format == MACHINE_I2S_STEREO ? 2 : 1);
+}
+
+// Keep the left sample of each stereo frame, in place, and return the new length.
+STATIC size_t machine_i2s_keep_left(uint8_t *buf, size_t len, size_t sample) {
+    size_t n = len / (2 * sample);
+    if (sample == 2) {
+        uint16_t *p = (uint16_t *)buf;
+        for (size_t i = 0; i < n; ++i) {
+            p[i] = p[2 * i];
+        }
+    } else {
+        uint32_t *p = (uint32_t *)buf;
+        for (size_t i = 0; i < n; ++i) {
+            p[i] = p[2 * i];
+        }
+    }
+    return n * sample;
+}
+
+// Expand n samples at the start of buf, in place, to stereo frames.
+STATIC void machine_i2s_dup_to_stereo(uint8_t *buf, size_t n, size_t sample) {
+    if (sample == 2) {
+        uint16_t *p = (uint16_t *)buf;
+        for (size_t i = n; i-- > 0;) {
+            p[2 * i + 1] = p[2 * i] = p[i];
+        }
+    } else {
+        uint32_t *p = (uint32_t *)buf;
+        for (size_t i = n; i-- > 0;) {
+            p[2 * i + 1] = p[2 * i] = p[i];
+        }
+    }
+}
+
+void machine_i2s_ring_moved(machine_i2s_obj_t *self, size_t avail_before) {
+    if (self->handler == mp_const_none) {
+        return;
+    }
+    size_t half = (self->ring.size - 1) / 2;
+    size_t avail = ringbuf_avail(&self->ring);
+    if (self->mode == MACHINE_I2S_RX ? (avail_before < half && avail >= half) : (avail_before > half && avail <= half)) {
+        mp_sched_schedule(self->handler, MP_OBJ_FROM_PTR(self));
+    }
+}
+
+void machine_i2s_dma_rx(machine_i2s_obj_t *self, uint8_t *buf, size_t len, bool dma_stereo) {
+    size_t sample = self->bits / 8;
+    if (dma_stereo && self->format == MACHINE_I2S_MONO) {
+        len = machine_i2s_keep_left(buf, len, sample);
+    }
+    size_t frame = machine_i2s_frame_size(self);
+    size_t avail_before = ringbuf_avail(&self->ring);
+    size_t n = MIN(len, ringbuf_free(&self->ring) / frame * frame);
+    ringbuf_put_bytes(&self->ring, buf, n);
+    machine_i2s_ring_moved(self, avail_before);
+}
+
+void machine_i2s_dma_tx(machine_i2s_obj_t *self, uint8_t *buf, size_t len, bool dma_stereo) {
+    size_t sample = self->bits / 8;
+    bool expand = dma_stereo && self->format == MACHINE_I2S_MONO;
+    if (expand) {
+        len /= 2;
+    }
+    size_t frame = machine_i2s_frame_size(self);
+    size_t avail_before = ringbuf_avail(&self->ring);
+    size_t n = MIN(len, avail_before / frame * frame);
+    ringbuf_get_bytes(&self->ring, buf, n);
+    memset(buf + n, 0, len - n);
+    if (expand) {
+        machine_i2s_dup_to_stereo(buf, len / sample, sample);
+    }
+    machine_i2s_ring_moved(self, avail_before);
+}
+
+void machine_i2s_deinit(machine_i2s_obj_t *self) {
+    if (self->active) {
+        mp_machine_i2s_port_stop(self);
+        self->active = false;
+    }
+}
+
+STATIC void machine_i2s_init_helper(machine_i2s_obj_t *self, size_t n_pos_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_sck, ARG_ws, ARG_sd, ARG_mode, ARG_bits, ARG_format, ARG_rate, ARG_ibuf };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_sck, MP_ARG_KW_ONLY | MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+        { MP_QSTR_ws, MP_ARG_KW_ONLY | MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+        { MP_QSTR_sd, MP_ARG_KW_ONLY | MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+        { MP_QSTR_mode, MP_ARG_KW_ONLY | MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_bits, MP_ARG_KW_ONLY | MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_format, MP_ARG_KW_ONLY | MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_rate, MP_ARG_KW_ONLY | MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_ibuf, MP_ARG_KW_ONLY | MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 0} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_pos_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    mp_int_t mode = args[ARG_mode].u_int;
+    mp_int_t bits = args[ARG_bits].u_int;
+    mp_int_t format = args[ARG_format].u_int;
+    if (mode != MACHINE_I2S_RX && mode != MACHINE_I2S_TX) {
+        mp_raise_ValueError(MP_ERROR_TEXT("invalid mode"));
+    }
+    if (bits != 16 && bits != 32) {
+        mp_raise_ValueError(MP_ERROR_TEXT("invalid bits"));
+    }
+    if (format != MACHINE_I2S_MONO && format != MACHINE_I2S_STEREO) {
+        mp_raise_ValueError(MP_ERROR_TEXT("invalid format"));
+    }
+    if (args[ARG_rate].u_int <= 0) {
+        mp_raise_ValueError(MP_ERROR_TEXT("invalid rate"));
+    }
+
+    self->sck = args[ARG_sck].u_obj;
+    self->ws = args[ARG_ws].u_obj;
+    self->sd = args[ARG_sd].u_obj;
+    self->mode = mode;
+    self->bits = bits;
+    self->format = format;
+    self->rate = args[ARG_rate].u_int;
+
+    // The ring buffer holds a whole number of frames, plus the byte a ring
+    // buffer always leaves free.
+    size_t frame = machine_i2s_frame_size(self);
+    mp_int_t ibuf = args[ARG_ibuf].u_int / frame * frame;
+    if (ibuf < 2 * (mp_int_t)frame || ibuf >= UINT16_MAX) {
+        mp_raise_ValueError(MP_ERROR_TEXT("invalid ibuf"));
+    }
+    if (self->ring.buf == NULL || self->ring.size != ibuf + 1) {
+        self->ring.buf = NULL;
+        ringbuf_alloc(&self->ring, ibuf + 1);
+    }
+    self->ring.iget = self->ring.iput = 0;
+    if (self->handler == MP_OBJ_NULL) {
+        self->handler = mp_const_none;
+    }
+
+    mp_machine_i2s_port_start(self);
+    self->active = true;
+}
+
+STATIC void machine_i2s_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
+    machine_i2s_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_printf(print, "I2S(%u", self->id);
+    if (self->active) {
+        mp_printf(print, ", mode=%s, bits=%u, format=%s, rate=%d, ibuf=%u",
+            self->mode == MACHINE_I2S_RX ? "RX" : "TX", self->bits,
+            self->format == MACHINE_I2S_MONO ? "MONO" : "STEREO", self->rate, self->ring.size - 1);
+    }
+    mp_print_str(print, ")");
+}
+
+STATIC mp_obj_t machine_i2s_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 1, MP_OBJ_FUN_ARGS_MAX, true);
+    machine_i2s_obj_t *self = mp_machine_i2s_port_get(mp_obj_get_int(args[0]));
+    machine_i2s_deinit(self);
+    mp_map_t kw_args;
+    mp_map_init_fixed_table(&kw_args, n_kw, args + n_args);
+    machine_i2s_init_helper(self, n_args - 1, args + 1, &kw_args);
+    return MP_OBJ_FROM_PTR(self);
+}
+
+STATIC mp_obj_t machine_i2s_init(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    machine_i2s_obj_t *self = MP_OBJ_TO_PTR(pos_args[0]);
+    machine_i2s_deinit(self);
+    machine_i2s_init_helper(self, n_args - 1, pos_args + 1, kw_args);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(machine_i2s_init_obj, 1, machine_i2s_init);
+
+STATIC mp_obj_t machine_i2s_deinit_meth(mp_obj_t self_in) {
+    machine_i2s_deinit(MP_OBJ_TO_PTR(self_in));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(machine_i2s_deinit_obj, machine_i2s_deinit_meth);
+
+STATIC mp_obj_t machine_i2s_irq(mp_obj_t self_in, mp_obj_t handler) {
+    machine_i2s_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (handler != mp_const_none && !mp_obj_is_callable(handler)) {
+        mp_raise_ValueError(MP_ERROR_TEXT("invalid handler"));
+    }
+    self->handler = handler;
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(machine_i2s_irq_obj, machine_i2s_irq);
+
+STATIC const mp_rom_map_elem_t machine_i2s_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_init), MP_ROM_PTR(&machine_i2s_init_obj) },
+    { MP_ROM_QSTR(MP_QSTR_deinit), MP_ROM_PTR(&machine_i2s_deinit_obj) },
+    { MP_ROM_QSTR(MP_QSTR_irq), MP_ROM_PTR(&machine_i2s_irq_obj) },
+    { MP_ROM_QSTR(MP_QSTR_readinto), MP_ROM_PTR(&mp_stream_readinto_obj) },
+    { MP_ROM_QSTR(MP_QSTR_write), MP_ROM_PTR(&mp_stream_write_obj) },
+
+    { MP_ROM_QSTR(MP_QSTR_RX), MP_ROM_INT(MACHINE_I2S_RX) },
+    { MP_ROM_QSTR(MP_QSTR_TX), MP_ROM_INT(MACHINE_I2S_TX) },
+    { MP_ROM_QSTR(MP_QSTR_MONO), MP_ROM_INT(MACHINE_I2S_MONO) },
+    { MP_ROM_QSTR(MP_QSTR_STEREO), MP_ROM_INT(MACHINE_I2S_STEREO) },
+};
+STATIC MP_DEFINE_CONST_DICT(machine_i2s_locals_dict, machine_i2s_locals_dict_table);
+
+STATIC mp_uint_t machine_i2s_stream_read(mp_obj_t self_in, void *buf_in, mp_uint_t size, int *errcode) {
+    machine_i2s_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (!self->active || self->mode != MACHINE_I2S_RX) {
+        *errcode = MP_EPERM;
+        return MP_STREAM_ERROR;
+    }
+    uint8_t *dest = buf_in;
+    size_t n = ringbuf_get_bytes(&self->ring, dest, size);
+    if (self->handler == mp_const_none) {
+        while (n < size && self->active) {
+            MACHINE_I2S_WAIT();
+            n += ringbuf_get_bytes(&self->ring, dest + n, size - n);
+        }
+    }
+    if (n == 0 && size > 0) {
+        *errcode = MP_EAGAIN;
+        return MP_STREAM_ERROR;
+    }
+    return n;
+}
+
+STATIC mp_uint_t machine_i2s_stream_write(mp_obj_t self_in, const void *buf_in, mp_uint_t size, int *errcode) {
+    machine_i2s_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (!self->active || self->mode != MACHINE_I2S_TX) {
+        *errcode = MP_EPERM;
+        return MP_STREAM_ERROR;
+    }
+    const uint8_t *src = buf_in;
+    size_t n = ringbuf_put_bytes(&self->ring, src, size);
+    if (self->handler == mp_const_none) {
+        while (n < size && self->active) {
+            MACHINE_I2S_WAIT();
+            n += ringbuf_put_bytes(&self->ring, src + n, size - n);
+        }
+    }
+    if (n == 0 && size > 0) {
+        *errcode = MP_EAGAIN;
+        return MP_STREAM_ERROR;
+    }
+    return n;
+}
+
+STATIC mp_uint_t machine_i2s_ioctl(mp_obj_t self_in, mp_uint_t request, uintptr_t arg, int *errcode) {
+    machine_i2s_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_uint_t ret;
+    if (request == MP_STREAM_POLL) {
+        uintptr_t flags = arg;
+        ret = 0;
+        if (self->active) {
+            if ((flags & MP_STREAM_POLL_RD) && self->mode == MACHINE_I2S_RX && ringbuf_avail(&self->ring) > 0) {
+                ret |= MP_STREAM_POLL_RD;
+            }
+            if ((flags & MP_STREAM_POLL_WR) && self->mode == MACHINE_I2S_TX && ringbuf_free(&self->ring) > 0) {
+                ret |= MP_STREAM_POLL_WR;
+            }
+        }
+    } else if (request == MP_STREAM_CLOSE) {
+        machine_i2s_deinit(self);
+        ret = 0;
+    } else {
+        *errcode = MP_EINVAL;
+        ret = MP_STREAM_ERROR;
+    }
+    return ret;
+}
+
+STATIC const mp_stream_p_t machine_i2s_stream_p = {
+    .read = machine_i2s_stream_read,
+    .write = machine_i2s_stream_write,
+    .ioctl = machine_i2s_ioctl,
+    .is_text = false,
+};
+
+const mp_obj_type_t machine_i2s_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_I2S,
+    .print = machine_i2s_print,
+    .make_new = machine_i2s_make_new,
+    .protocol = &machine_i2s_stream_p,
+    .locals_dict = (mp_obj_dict_t *)&machine_i2s_locals_dict,
+};
+
+#endif // MICROPY_PY_MACHINE_I2S
@@ -0,0 +1,89 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef MICROPY_INCLUDED_EXTMOD_MACHINE_I2S_H
+#define MICROPY_INCLUDED_EXTMOD_MACHINE_I2S_H
+
+#include "py/obj.h"
+#include "py/ringbuf.h"
+
+#define MACHINE_I2S_RX (0)
+#define MACHINE_I2S_TX (1)
+
+#define MACHINE_I2S_MONO (0)
+#define MACHINE_I2S_STEREO (1)
+
+// The part of an I2S object that is common to all ports.  A port embeds this
+// as the first member of its own object, which holds the DMA state.
+//
+// Samples are kept in the ring buffer as they are read and written by the
+// user: little-endian signed integers of the given number of bits, with the
+// left and right channels interleaved for stereo.  The DMA interrupt moves
+// them between the ring buffer and the DMA buffer, so readinto() and write()
+// only ever copy to and from memory.
+typedef struct _machine_i2s_obj_t {
+    mp_obj_base_t base;
+    uint8_t id;
+    uint8_t mode;
+    uint8_t bits;
+    uint8_t format;
+    bool active;
+    int32_t rate;
+    mp_obj_t sck;
+    mp_obj_t ws;
+    mp_obj_t sd;
+    mp_obj_t handler;
+    ringbuf_t ring;
+} machine_i2s_obj_t;
+
+// A port enabling MICROPY_PY_MACHINE_I2S must provide the following:
+//
+// Return the object for I2S peripheral id, creating it on first use and
+// keeping it in a root pointer, or raise ValueError for an invalid id.
+machine_i2s_obj_t *mp_machine_i2s_port_get(mp_int_t id);
+// Configure the pins and peripheral from the fields of self and start the
+// DMA; the ring buffer is allocated and empty.  Raises on error.
+void mp_machine_i2s_port_start(machine_i2s_obj_t *self);
+// Stop the DMA and interrupts and release the peripheral.
+void mp_machine_i2s_port_stop(machine_i2s_obj_t *self);
+
+// For use by the port from its DMA interrupt, once the DMA has finished with
+// len bytes of buf, to move samples into (RX) or out of (TX) the ring buffer.
+// If dma_stereo is true the DMA buffer always holds stereo frames, and a mono
+// object reads the left channel and writes each sample to both channels.  On
+// overrun the newest samples are dropped, and on underrun silence is sent.
+// The buffer is used in place as scratch space.
+void machine_i2s_dma_rx(machine_i2s_obj_t *self, uint8_t *buf, size_t len, bool dma_stereo);
+void machine_i2s_dma_tx(machine_i2s_obj_t *self, uint8_t *buf, size_t len, bool dma_stereo);
+
+// For a port that moves data to and from the ring buffer itself: call after
+// each move, with the ring buffer level before it, to schedule the handler.
+void machine_i2s_ring_moved(machine_i2s_obj_t *self, size_t avail_before);
+
+void machine_i2s_deinit(machine_i2s_obj_t *self);
+
+extern const mp_obj_type_t machine_i2s_type;
+
+#endif // MICROPY_INCLUDED_EXTMOD_MACHINE_I2S_H
@@ -0,0 +1,184 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "py/runtime.h"
+#include "py/binary.h"
+#include "py/mphal.h"
+#include "extmod/machine_pingroup.h"
+
+#if MICROPY_PY_MACHINE_PINGROUP
+
+// A PinGroup maps bit i of a value to pins[i].  The pins are grouped by the
+// GPIO port they are on, so a write is one set/clear of each port involved
+// and a read is one read of each port.
+
+#define PINGROUP_MAX_PINS (32)
+
+typedef struct _machine_pingroup_port_t {
+    uintptr_t port;
+    uint32_t mask; // all pins of the group on this port
+} machine_pingroup_port_t;
+
+typedef struct _machine_pingroup_obj_t {
+    mp_obj_base_t base;
+    uint8_t num_pins;
+    uint8_t num_ports;
+    uint8_t port_idx[PINGROUP_MAX_PINS];
+    uint32_t pin_mask[PINGROUP_MAX_PINS];
+    machine_pingroup_port_t ports[];
+} machine_pingroup_obj_t;
+
+STATIC void machine_pingroup_write_value(machine_pingroup_obj_t *self, uint32_t value) {
+    uint32_t set[PINGROUP_MAX_PINS];
+    for (size_t i = 0; i < self->num_ports; ++i) {
+        set[i] = 0;
+    }
+    for (size_t i = 0; i < self->num_pins; ++i) {
+        if (value & (1u << i)) {
+            set[self->port_idx[i]] |= self->pin_mask[i];
+        }
+    }
+    for (size_t i = 0; i < self->num_ports; ++i) {
+        mp_hal_pin_port_write(self->ports[i].port, set[i], self->ports[i].mask & ~set[i]);
+    }
+}
+
+STATIC mp_obj_t machine_pingroup_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 1, 1, false);
+    size_t num_pins;
+    mp_obj_t *pins;
+    mp_obj_get_array(args[0], &num_pins, &pins);
+    if (num_pins == 0 || num_pins > PINGROUP_MAX_PINS) {
+        mp_raise_ValueError(MP_ERROR_TEXT("invalid number of pins"));
+    }
+
+    // Find the distinct ports used by the pins.
+    uintptr_t port[PINGROUP_MAX_PINS];
+    uint8_t port_idx[PINGROUP_MAX_PINS];
+    uint32_t pin_mask[PINGROUP_MAX_PINS];
+    size_t num_ports = 0;
+    for (size_t i = 0; i < num_pins; ++i) {
+        mp_hal_pin_obj_t pin = mp_hal_get_pin_obj(pins[i]);
+        uintptr_t p = mp_hal_pin_port(pin);
+        size_t j = 0;
+        while (j < num_ports && port[j] != p) {
+            ++j;
+        }
+        if (j == num_ports) {
+            port[num_ports++] = p;
+        }
+        port_idx[i] = j;
+        pin_mask[i] = mp_hal_pin_port_mask(pin);
+    }
+
+    machine_pingroup_obj_t *self = m_new_obj_var(machine_pingroup_obj_t, machine_pingroup_port_t, num_ports);
+    self->base.type = type;
+    self->num_pins = num_pins;
+    self->num_ports = num_ports;
+    for (size_t i = 0; i < num_pins; ++i) {
+        self->port_idx[i] = port_idx[i];
+        self->pin_mask[i] = pin_mask[i];
+    }
+    for (size_t i = 0; i < num_ports; ++i) {
+        self->ports[i].port = port[i];
+        self->ports[i].mask = 0;
+    }
+    for (size_t i = 0; i < num_pins; ++i) {
+        self->ports[port_idx[i]].mask |= pin_mask[i];
+    }
+    return MP_OBJ_FROM_PTR(self);
+}
+
+// PinGroup.read()
+STATIC mp_obj_t machine_pingroup_read(mp_obj_t self_in) {
+    machine_pingroup_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    uint32_t in[PINGROUP_MAX_PINS];
+    for (size_t i = 0; i < self->num_ports; ++i) {
+        in[i] = mp_hal_pin_port_read(self->ports[i].port);
+    }
+    uint32_t value = 0;
+    for (size_t i = 0; i < self->num_pins; ++i) {
+        if (in[self->port_idx[i]] & self->pin_mask[i]) {
+            value |= 1u << i;
+        }
+    }
+    return mp_obj_new_int_from_uint(value);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(machine_pingroup_read_obj, machine_pingroup_read);
+
+// PinGroup.write(value)
+STATIC mp_obj_t machine_pingroup_write(mp_obj_t self_in, mp_obj_t value_in) {
+    machine_pingroup_write_value(MP_OBJ_TO_PTR(self_in), mp_obj_get_int_truncated(value_in));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(machine_pingroup_write_obj, machine_pingroup_write);
+
+// PinGroup.write_many(buf, strobe)
+// Write each element of buf in turn, pulsing strobe low then high after each.
+STATIC mp_obj_t machine_pingroup_write_many(mp_obj_t self_in, mp_obj_t buf_in, mp_obj_t strobe_in) {
+    machine_pingroup_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_READ);
+    mp_hal_pin_obj_t strobe = mp_hal_get_pin_obj(strobe_in);
+    uintptr_t strobe_port = mp_hal_pin_port(strobe);
+    uint32_t strobe_mask = mp_hal_pin_port_mask(strobe);
+    size_t elem_size = bufinfo.typecode == BYTEARRAY_TYPECODE ? 1 : mp_binary_get_size('@', bufinfo.typecode, NULL);
+    if (elem_size != 1 && elem_size != 2 && elem_size != 4) {
+        mp_raise_ValueError(MP_ERROR_TEXT("unsupported buffer type"));
+    }
+    size_t n = bufinfo.len / elem_size;
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t value;
+        if (elem_size == 1) {
+            value = ((uint8_t *)bufinfo.buf)[i];
+        } else if (elem_size == 2) {
+            value = ((uint16_t *)bufinfo.buf)[i];
+        } else {
+            value = ((uint32_t *)bufinfo.buf)[i];
+        }
+        machine_pingroup_write_value(self, value);
+        mp_hal_pin_port_write(strobe_port, 0, strobe_mask);
+        mp_hal_pin_port_write(strobe_port, strobe_mask, 0);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(machine_pingroup_write_many_obj, machine_pingroup_write_many);
+
+STATIC const mp_rom_map_elem_t machine_pingroup_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_read), MP_ROM_PTR(&machine_pingroup_read_obj) },
+    { MP_ROM_QSTR(MP_QSTR_write), MP_ROM_PTR(&machine_pingroup_write_obj) },
+    { MP_ROM_QSTR(MP_QSTR_write_many), MP_ROM_PTR(&machine_pingroup_write_many_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(machine_pingroup_locals_dict, machine_pingroup_locals_dict_table);
+
+const mp_obj_type_t machine_pingroup_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_PinGroup,
+    .make_new = machine_pingroup_make_new,
+    .locals_dict = (mp_obj_dict_t *)&machine_pingroup_locals_dict,
+};
+
+#endif // MICROPY_PY_MACHINE_PINGROUP
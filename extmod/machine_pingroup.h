@@ -0,0 +1,41 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef MICROPY_INCLUDED_EXTMOD_MACHINE_PINGROUP_H
+#define MICROPY_INCLUDED_EXTMOD_MACHINE_PINGROUP_H
+
+#include "py/obj.h"
+
+// A port enabling MICROPY_PY_MACHINE_PINGROUP must provide the following in
+// its mphalport.h, describing each pin as a bit in a GPIO port register:
+//
+//  uintptr_t mp_hal_pin_port(mp_hal_pin_obj_t pin);
+//  uint32_t mp_hal_pin_port_mask(mp_hal_pin_obj_t pin);
+//  void mp_hal_pin_port_write(uintptr_t port, uint32_t set_mask, uint32_t clr_mask);
+//  uint32_t mp_hal_pin_port_read(uintptr_t port);
+
+extern const mp_obj_type_t machine_pingroup_type;
+
+#endif // MICROPY_INCLUDED_EXTMOD_MACHINE_PINGROUP_H
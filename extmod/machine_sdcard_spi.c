@@ -0,0 +1,451 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "py/runtime.h"
+#include "py/mperrno.h"
+#include "py/mphal.h"
+#include "extmod/machine_spi.h"
+#include "extmod/machine_sdcard_spi.h"
+#include "extmod/vfs.h"
+
+#if MICROPY_PY_MACHINE_SDCARD_SPI
+
+// This is a C version of drivers/sdcard/sdcard.py.  It reads and writes
+// several blocks with CMD18 and CMD25, passes each whole block to the SPI
+// transfer function so a port can use DMA for it, and can have the card check
+// the CRC of commands and data.
+
+#define SDCARD_BLOCK_SIZE (512)
+
+#define SDCARD_INIT_BAUDRATE (100000)
+#define SDCARD_CMD_TIMEOUT (100) // bytes read waiting for a response
+#define SDCARD_INIT_TIMEOUT_MS (1000)
+#define SDCARD_READ_TIMEOUT_MS (100)
+#define SDCARD_WRITE_TIMEOUT_MS (500)
+
+#define R1_IDLE_STATE (1 << 0)
+#define R1_ILLEGAL_COMMAND (1 << 2)
+
+#define TOKEN_CMD25 (0xfc)
+#define TOKEN_STOP_TRAN (0xfd)
+#define TOKEN_DATA (0xfe)
+
+typedef struct _machine_sdcard_spi_obj_t {
+    mp_obj_base_t base;
+    mp_obj_t spi;
+    mp_hal_pin_obj_t cs;
+    uint32_t baudrate;
+    uint32_t sectors;
+    uint8_t addr_shift; // 9 for cards addressed by byte, 0 for those addressed by block
+    bool crc;
+} machine_sdcard_spi_obj_t;
+
+STATIC uint8_t sdcard_crc7(const uint8_t *buf, size_t len) {
+    uint8_t crc = 0;
+    for (size_t i = 0; i < len; ++i) {
+        uint8_t data = buf[i];
+        for (int j = 0; j < 8; ++j) {
+            crc <<= 1;
+            if ((data ^ crc) & 0x80) {
+                crc ^= 0x09;
+            }
+            data <<= 1;
+        }
+    }
+    return crc << 1 | 1;
+}
+
+// CRC-16-CCITT, computed a byte at a time without a table.
+STATIC uint16_t sdcard_crc16(const uint8_t *buf, size_t len) {
+    uint16_t crc = 0;
+    for (size_t i = 0; i < len; ++i) {
+        crc = (crc >> 8) | (crc << 8);
+        crc ^= buf[i];
+        crc ^= (crc & 0xff) >> 4;
+        crc ^= crc << 12;
+        crc ^= (crc & 0xff) << 5;
+    }
+    return crc;
+}
+
+STATIC void sdcard_transfer(machine_sdcard_spi_obj_t *self, size_t len, const uint8_t *src, uint8_t *dest) {
+    mp_obj_base_t *spi = MP_OBJ_TO_PTR(self->spi);
+    ((mp_machine_spi_p_t *)spi->type->protocol)->transfer(spi, len, src, dest);
+}
+
+STATIC uint8_t sdcard_read_byte(machine_sdcard_spi_obj_t *self) {
+    uint8_t b = 0xff;
+    sdcard_transfer(self, 1, &b, &b);
+    return b;
+}
+
+STATIC void sdcard_write_byte(machine_sdcard_spi_obj_t *self, uint8_t b) {
+    sdcard_transfer(self, 1, &b, NULL);
+}
+
+STATIC void sdcard_init_bus(machine_sdcard_spi_obj_t *self, uint32_t baudrate) {
+    mp_obj_t kw[6] = {
+        MP_OBJ_NEW_QSTR(MP_QSTR_baudrate), mp_obj_new_int_from_uint(baudrate),
+        MP_OBJ_NEW_QSTR(MP_QSTR_polarity), MP_OBJ_NEW_SMALL_INT(0),
+        MP_OBJ_NEW_QSTR(MP_QSTR_phase), MP_OBJ_NEW_SMALL_INT(0),
+    };
+    mp_map_t kw_args;
+    mp_map_init_fixed_table(&kw_args, 3, kw);
+    mp_obj_base_t *spi = MP_OBJ_TO_PTR(self->spi);
+    mp_machine_spi_p_t *spi_p = (mp_machine_spi_p_t *)spi->type->protocol;
+    if (spi_p->init != NULL) {
+        spi_p->init(spi, 0, NULL, &kw_args);
+    }
+}
+
+// Wait for the card to release the data line, which it holds low while busy.
+STATIC bool sdcard_wait_ready(machine_sdcard_spi_obj_t *self, mp_uint_t timeout_ms) {
+    mp_uint_t start = mp_hal_ticks_ms();
+    while (sdcard_read_byte(self) != 0xff) {
+        if (mp_hal_ticks_ms() - start >= timeout_ms) {
+            return false;
+        }
+    }
+    return true;
+}
+
+STATIC void sdcard_select(machine_sdcard_spi_obj_t *self) {
+    mp_hal_pin_write(self->cs, 0);
+}
+
+STATIC void sdcard_release(machine_sdcard_spi_obj_t *self) {
+    mp_hal_pin_write(self->cs, 1);
+    // the card only lets go of MISO on the next clock
+    sdcard_write_byte(self, 0xff);
+}
+
+STATIC NORETURN void sdcard_raise_eio(machine_sdcard_spi_obj_t *self) {
+    sdcard_release(self);
+    mp_raise_OSError(MP_EIO);
+}
+
+// Send a command with the card selected, and return its R1 response, or -1 if
+// there was none.  The len bytes following the response are read into resp.
+STATIC int sdcard_cmd(machine_sdcard_spi_obj_t *self, uint8_t cmd, uint32_t arg, uint8_t *resp, size_t len) {
+    if (cmd != 0 && cmd != 12) {
+        // a card that's still writing ignores commands
+        sdcard_wait_ready(self, SDCARD_WRITE_TIMEOUT_MS);
+    }
+    uint8_t buf[6] = { 0x40 | cmd, arg >> 24, arg >> 16, arg >> 8, arg };
+    buf[5] = sdcard_crc7(buf, 5);
+    sdcard_transfer(self, sizeof(buf), buf, NULL);
+    if (cmd == 12) {
+        // skip the stuff byte that follows CMD12
+        sdcard_read_byte(self);
+    }
+    for (int i = 0; i < SDCARD_CMD_TIMEOUT; ++i) {
+        uint8_t r1 = sdcard_read_byte(self);
+        if (!(r1 & 0x80)) {
+            if (len) {
+                memset(resp, 0xff, len);
+                sdcard_transfer(self, len, resp, resp);
+            }
+            return r1;
+        }
+    }
+    return -1;
+}
+
+// Send a command on its own, selecting and releasing the card around it.
+STATIC int sdcard_cmd_release(machine_sdcard_spi_obj_t *self, uint8_t cmd, uint32_t arg, uint8_t *resp, size_t len) {
+    sdcard_select(self);
+    int r1 = sdcard_cmd(self, cmd, arg, resp, len);
+    sdcard_release(self);
+    return r1;
+}
+
+// Receive a data block from the card, which is selected.
+STATIC bool sdcard_read_data(machine_sdcard_spi_obj_t *self, uint8_t *buf, size_t len) {
+    mp_uint_t start = mp_hal_ticks_ms();
+    uint8_t token;
+    while ((token = sdcard_read_byte(self)) == 0xff) {
+        if (mp_hal_ticks_ms() - start >= SDCARD_READ_TIMEOUT_MS) {
+            return false;
+        }
+    }
+    if (token != TOKEN_DATA) {
+        // an error token
+        return false;
+    }
+    memset(buf, 0xff, len);
+    sdcard_transfer(self, len, buf, buf);
+    uint8_t crc[2] = { 0xff, 0xff };
+    sdcard_transfer(self, 2, crc, crc);
+    return !self->crc || (crc[0] << 8 | crc[1]) == sdcard_crc16(buf, len);
+}
+
+// Send a data block to the card, which is selected, and wait while it's written.
+STATIC bool sdcard_write_data(machine_sdcard_spi_obj_t *self, uint8_t token, const uint8_t *buf) {
+    sdcard_write_byte(self, token);
+    sdcard_transfer(self, SDCARD_BLOCK_SIZE, buf, NULL);
+    uint16_t crc = self->crc ? sdcard_crc16(buf, SDCARD_BLOCK_SIZE) : 0xffff;
+    uint8_t crc_buf[2] = { crc >> 8, crc };
+    sdcard_transfer(self, 2, crc_buf, NULL);
+    if ((sdcard_read_byte(self) & 0x1f) != 0x05) {
+        // the data was rejected
+        return false;
+    }
+    return sdcard_wait_ready(self, SDCARD_WRITE_TIMEOUT_MS);
+}
+
+STATIC void sdcard_init_card(machine_sdcard_spi_obj_t *self) {
+    mp_hal_pin_write(self->cs, 1);
+    mp_hal_pin_output(self->cs);
+    sdcard_init_bus(self, SDCARD_INIT_BAUDRATE);
+
+    // clock the card at least 74 times with CS high
+    for (int i = 0; i < 16; ++i) {
+        sdcard_write_byte(self, 0xff);
+    }
+
+    // CMD0: reset the card into SPI mode
+    int r1 = -1;
+    for (int i = 0; i < 5 && r1 != R1_IDLE_STATE; ++i) {
+        r1 = sdcard_cmd_release(self, 0, 0, NULL, 0);
+    }
+    if (r1 != R1_IDLE_STATE) {
+        mp_raise_msg(&mp_type_OSError, MP_ERROR_TEXT("no SD card"));
+    }
+
+    // CMD8: only version 2 cards know it, and echo the check pattern
+    uint8_t resp[4];
+    r1 = sdcard_cmd_release(self, 8, 0x1aa, resp, 4);
+    uint32_t acmd41_arg;
+    if (r1 == R1_IDLE_STATE && (resp[2] & 0xf) == 1 && resp[3] == 0xaa) {
+        acmd41_arg = 0x40000000; // support high capacity cards
+    } else if (r1 == (R1_IDLE_STATE | R1_ILLEGAL_COMMAND)) {
+        acmd41_arg = 0;
+    } else {
+        mp_raise_msg(&mp_type_OSError, MP_ERROR_TEXT("couldn't determine SD card version"));
+    }
+
+    // ACMD41: start the initialisation, and wait for it to finish
+    mp_uint_t start = mp_hal_ticks_ms();
+    for (;;) {
+        sdcard_cmd_release(self, 55, 0, NULL, 0);
+        if (sdcard_cmd_release(self, 41, acmd41_arg, NULL, 0) == 0) {
+            break;
+        }
+        if (mp_hal_ticks_ms() - start >= SDCARD_INIT_TIMEOUT_MS) {
+            mp_raise_msg(&mp_type_OSError, MP_ERROR_TEXT("timeout waiting for SD card"));
+        }
+        mp_hal_delay_ms(1);
+    }
+
+    // CMD58: a version 2 card says in its OCR whether it's addressed by block
+    self->addr_shift = 9;
+    if (acmd41_arg != 0) {
+        if (sdcard_cmd_release(self, 58, 0, resp, 4) != 0) {
+            mp_raise_msg(&mp_type_OSError, MP_ERROR_TEXT("no response from SD card"));
+        }
+        if (resp[0] & 0x40) {
+            self->addr_shift = 0;
+        }
+    }
+
+    // CMD59: turn on checking of CRCs
+    if (self->crc && sdcard_cmd_release(self, 59, 1, NULL, 0) != 0) {
+        mp_raise_msg(&mp_type_OSError, MP_ERROR_TEXT("no response from SD card"));
+    }
+
+    // CMD9: read the CSD register to get the number of sectors
+    uint8_t csd[16];
+    sdcard_select(self);
+    if (sdcard_cmd(self, 9, 0, NULL, 0) != 0 || !sdcard_read_data(self, csd, 16)) {
+        sdcard_release(self);
+        mp_raise_msg(&mp_type_OSError, MP_ERROR_TEXT("no response from SD card"));
+    }
+    sdcard_release(self);
+    if ((csd[0] & 0xc0) == 0x40) {
+        // CSD version 2.0
+        self->sectors = (((csd[7] & 0x3f) << 16 | csd[8] << 8 | csd[9]) + 1) * 1024;
+    } else if ((csd[0] & 0xc0) == 0x00) {
+        // CSD version 1.0, for cards up to 2GB
+        uint32_t c_size = (csd[6] & 0x03) << 10 | csd[7] << 2 | csd[8] >> 6;
+        uint32_t c_size_mult = (csd[9] & 0x03) << 1 | csd[10] >> 7;
+        uint32_t read_bl_len = csd[5] & 0x0f;
+        self->sectors = (c_size + 1) << (c_size_mult + 2 + read_bl_len - 9);
+    } else {
+        mp_raise_msg(&mp_type_OSError, MP_ERROR_TEXT("SD card CSD format not supported"));
+    }
+
+    // CMD16: set the block length of cards addressed by byte
+    if (sdcard_cmd_release(self, 16, SDCARD_BLOCK_SIZE, NULL, 0) != 0) {
+        mp_raise_msg(&mp_type_OSError, MP_ERROR_TEXT("can't set 512 block size"));
+    }
+
+    sdcard_init_bus(self, self->baudrate);
+}
+
+STATIC mp_obj_t machine_sdcard_spi_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *all_args) {
+    enum { ARG_spi, ARG_cs, ARG_baudrate, ARG_crc };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_spi, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_cs, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_baudrate, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 20000000} },
+        { MP_QSTR_crc, MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = false} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all_kw_array(n_args, n_kw, all_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    if (mp_obj_get_type(args[ARG_spi].u_obj)->protocol == NULL) {
+        mp_raise_TypeError(MP_ERROR_TEXT("expecting an SPI object"));
+    }
+
+    machine_sdcard_spi_obj_t *self = m_new_obj(machine_sdcard_spi_obj_t);
+    self->base.type = type;
+    self->spi = args[ARG_spi].u_obj;
+    self->cs = mp_hal_get_pin_obj(args[ARG_cs].u_obj);
+    self->baudrate = args[ARG_baudrate].u_int;
+    self->crc = args[ARG_crc].u_bool;
+    sdcard_init_card(self);
+    return MP_OBJ_FROM_PTR(self);
+}
+
+STATIC size_t sdcard_get_num_blocks(const mp_buffer_info_t *bufinfo) {
+    if (bufinfo->len == 0 || bufinfo->len % SDCARD_BLOCK_SIZE != 0) {
+        mp_raise_ValueError(MP_ERROR_TEXT("buffer length must be a multiple of 512"));
+    }
+    return bufinfo->len / SDCARD_BLOCK_SIZE;
+}
+
+STATIC mp_obj_t machine_sdcard_spi_readblocks(mp_obj_t self_in, mp_obj_t block_num, mp_obj_t buf_in) {
+    machine_sdcard_spi_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_WRITE);
+    size_t n = sdcard_get_num_blocks(&bufinfo);
+    uint32_t addr = (uint32_t)mp_obj_get_int(block_num) << self->addr_shift;
+    uint8_t *buf = bufinfo.buf;
+
+    sdcard_select(self);
+    if (n == 1) {
+        // CMD17: read a single block
+        if (sdcard_cmd(self, 17, addr, NULL, 0) != 0 || !sdcard_read_data(self, buf, SDCARD_BLOCK_SIZE)) {
+            sdcard_raise_eio(self);
+        }
+    } else {
+        // CMD18: read blocks until CMD12 stops the transmission
+        if (sdcard_cmd(self, 18, addr, NULL, 0) != 0) {
+            sdcard_raise_eio(self);
+        }
+        bool ok = true;
+        for (; ok && n > 0; --n, buf += SDCARD_BLOCK_SIZE) {
+            ok = sdcard_read_data(self, buf, SDCARD_BLOCK_SIZE);
+        }
+        if (sdcard_cmd(self, 12, 0, NULL, 0) != 0 || !ok) {
+            sdcard_raise_eio(self);
+        }
+    }
+    sdcard_release(self);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(machine_sdcard_spi_readblocks_obj, machine_sdcard_spi_readblocks);
+
+STATIC mp_obj_t machine_sdcard_spi_writeblocks(mp_obj_t self_in, mp_obj_t block_num, mp_obj_t buf_in) {
+    machine_sdcard_spi_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_READ);
+    size_t n = sdcard_get_num_blocks(&bufinfo);
+    uint32_t addr = (uint32_t)mp_obj_get_int(block_num) << self->addr_shift;
+    const uint8_t *buf = bufinfo.buf;
+
+    sdcard_select(self);
+    if (n == 1) {
+        // CMD24: write a single block
+        if (sdcard_cmd(self, 24, addr, NULL, 0) != 0 || !sdcard_write_data(self, TOKEN_DATA, buf)) {
+            sdcard_raise_eio(self);
+        }
+    } else {
+        // CMD25: write blocks until the stop token
+        if (sdcard_cmd(self, 25, addr, NULL, 0) != 0) {
+            sdcard_raise_eio(self);
+        }
+        bool ok = true;
+        for (; ok && n > 0; --n, buf += SDCARD_BLOCK_SIZE) {
+            ok = sdcard_write_data(self, TOKEN_CMD25, buf);
+        }
+        sdcard_write_byte(self, TOKEN_STOP_TRAN);
+        sdcard_read_byte(self);
+        if (!sdcard_wait_ready(self, SDCARD_WRITE_TIMEOUT_MS) || !ok) {
+            sdcard_raise_eio(self);
+        }
+    }
+    sdcard_release(self);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(machine_sdcard_spi_writeblocks_obj, machine_sdcard_spi_writeblocks);
+
+STATIC mp_obj_t machine_sdcard_spi_ioctl(mp_obj_t self_in, mp_obj_t cmd_in, mp_obj_t arg_in) {
+    machine_sdcard_spi_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    switch (mp_obj_get_int(cmd_in)) {
+        case MP_BLOCKDEV_IOCTL_INIT:
+        case MP_BLOCKDEV_IOCTL_DEINIT:
+        case MP_BLOCKDEV_IOCTL_SYNC:
+            return MP_OBJ_NEW_SMALL_INT(0);
+        case MP_BLOCKDEV_IOCTL_BLOCK_COUNT:
+            return mp_obj_new_int_from_uint(self->sectors);
+        case MP_BLOCKDEV_IOCTL_BLOCK_SIZE:
+            return MP_OBJ_NEW_SMALL_INT(SDCARD_BLOCK_SIZE);
+        default:
+            return mp_const_none;
+    }
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(machine_sdcard_spi_ioctl_obj, machine_sdcard_spi_ioctl);
+
+STATIC mp_obj_t machine_sdcard_spi_info(mp_obj_t self_in) {
+    machine_sdcard_spi_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_obj_t tuple[2] = {
+        mp_obj_new_int_from_ull((uint64_t)self->sectors * SDCARD_BLOCK_SIZE),
+        MP_OBJ_NEW_SMALL_INT(SDCARD_BLOCK_SIZE),
+    };
+    return mp_obj_new_tuple(2, tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(machine_sdcard_spi_info_obj, machine_sdcard_spi_info);
+
+STATIC const mp_rom_map_elem_t machine_sdcard_spi_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_info), MP_ROM_PTR(&machine_sdcard_spi_info_obj) },
+    // block device protocol
+    { MP_ROM_QSTR(MP_QSTR_readblocks), MP_ROM_PTR(&machine_sdcard_spi_readblocks_obj) },
+    { MP_ROM_QSTR(MP_QSTR_writeblocks), MP_ROM_PTR(&machine_sdcard_spi_writeblocks_obj) },
+    { MP_ROM_QSTR(MP_QSTR_ioctl), MP_ROM_PTR(&machine_sdcard_spi_ioctl_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(machine_sdcard_spi_locals_dict, machine_sdcard_spi_locals_dict_table);
+
+const mp_obj_type_t machine_sdcard_spi_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_SDCard,
+    .make_new = machine_sdcard_spi_make_new,
+    .locals_dict = (mp_obj_dict_t *)&machine_sdcard_spi_locals_dict,
+};
+
+#endif // MICROPY_PY_MACHINE_SDCARD_SPI
@@ -61,6 +61,8 @@ extern const mp_obj_dict_t mp_machine_spi_locals_dict;
 
 mp_obj_t mp_machine_spi_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args);
 
+MP_DECLARE_CONST_FUN_OBJ_KW(mp_machine_spi_init_obj);
+MP_DECLARE_CONST_FUN_OBJ_1(mp_machine_spi_deinit_obj);
 MP_DECLARE_CONST_FUN_OBJ_VAR_BETWEEN(mp_machine_spi_read_obj);
 MP_DECLARE_CONST_FUN_OBJ_VAR_BETWEEN(mp_machine_spi_readinto_obj);
 MP_DECLARE_CONST_FUN_OBJ_2(mp_machine_spi_write_obj);
@@ -44,4 +44,8 @@ void mp_uos_deactivate(size_t dupterm_idx, const char *msg, mp_obj_t exc);
 #define mp_uos_dupterm_tx_strn(s, l)
 #endif
 
+#if MICROPY_PY_USOCKET_POOL
+extern const mp_obj_type_t mp_type_usocket_pool;
+#endif
+
 #endif // MICROPY_INCLUDED_EXTMOD_MISC_H
@@ -55,6 +55,26 @@
 
 #define MICROPY_PY_BLUETOOTH_MAX_EVENT_DATA_TUPLE_LEN 5
 
+#if MICROPY_PY_BLUETOOTH_ENABLE_CENTRAL_MODE
+// Advertising data types (Bluetooth Assigned Numbers) used by the scan filter.
+#define MP_BLUETOOTH_AD_TYPE_UUID16_MORE (0x02)
+#define MP_BLUETOOTH_AD_TYPE_UUID128_COMPLETE (0x07)
+#define MP_BLUETOOTH_AD_TYPE_SHORT_NAME (0x08)
+#define MP_BLUETOOTH_AD_TYPE_COMPLETE_NAME (0x09)
+
+// Criteria that a scan result must meet to be passed to the IRQ handler.  This
+// is checked in the stack's callback so unwanted results never reach Python.
+typedef struct {
+    bool has_rssi;
+    int8_t rssi;        // minimum rssi
+    uint8_t addr_len;   // length of addr prefix, 0 for any address
+    uint8_t name_len;   // length of name prefix, 0 for any name
+    uint8_t addr[6];
+    uint8_t name[29];   // longest name that fits in a legacy advertising payload
+    mp_obj_bluetooth_uuid_t uuid; // uuid.type is 0 for any service
+} mp_bluetooth_scan_filter_t;
+#endif
+
 #if !MICROPY_PY_BLUETOOTH_USE_SYNC_EVENTS
 // This formula is intended to allow queuing the data of a large characteristic
 // while still leaving room for a couple of normal (small, fixed size) events.
@@ -66,6 +86,9 @@
 typedef struct {
     mp_obj_base_t base;
     mp_obj_t irq_handler;
+    #if MICROPY_PY_BLUETOOTH_ENABLE_CENTRAL_MODE
+    mp_bluetooth_scan_filter_t scan_filter;
+    #endif
     #if !MICROPY_PY_BLUETOOTH_USE_SYNC_EVENTS
     bool irq_scheduled;
     mp_obj_t irq_data_tuple;
@@ -219,18 +242,14 @@ STATIC mp_int_t bluetooth_uuid_get_buffer(mp_obj_t self_in, mp_buffer_info_t *bu
 STATIC void ringbuf_put_uuid(ringbuf_t *ringbuf, mp_obj_bluetooth_uuid_t *uuid) {
     assert(ringbuf_free(ringbuf) >= (size_t)uuid->type + 1);
     ringbuf_put(ringbuf, uuid->type);
-    for (int i = 0; i < uuid->type; ++i) {
-        ringbuf_put(ringbuf, uuid->data[i]);
-    }
+    ringbuf_put_bytes(ringbuf, uuid->data, uuid->type);
 }
 
 STATIC void ringbuf_get_uuid(ringbuf_t *ringbuf, mp_obj_bluetooth_uuid_t *uuid) {
     assert(ringbuf_avail(ringbuf) >= 1);
     uuid->type = ringbuf_get(ringbuf);
     assert(ringbuf_avail(ringbuf) >= uuid->type);
-    for (int i = 0; i < uuid->type; ++i) {
-        uuid->data[i] = ringbuf_get(ringbuf);
-    }
+    ringbuf_get_bytes(ringbuf, uuid->data, uuid->type);
 }
 #endif // MICROPY_PY_BLUETOOTH_ENABLE_CENTRAL_MODE
 
@@ -646,31 +665,67 @@ STATIC mp_obj_t bluetooth_ble_gap_connect(size_t n_args, const mp_obj_t *args) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(bluetooth_ble_gap_connect_obj, 3, 4, bluetooth_ble_gap_connect);
 
-STATIC mp_obj_t bluetooth_ble_gap_scan(size_t n_args, const mp_obj_t *args) {
-    // Default is indefinite scan, with the NimBLE "background scan" interval and window.
-    mp_int_t duration_ms = 0;
-    mp_int_t interval_us = 1280000;
-    mp_int_t window_us = 11250;
-    bool active_scan = false;
-    if (n_args > 1) {
-        if (args[1] == mp_const_none) {
-            // scan(None) --> stop scan.
-            return bluetooth_handle_errno(mp_bluetooth_gap_scan_stop());
+STATIC mp_obj_t bluetooth_ble_gap_scan(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_duration_ms, ARG_interval_us, ARG_window_us, ARG_active, ARG_rssi, ARG_addr, ARG_name, ARG_uuid };
+    static const mp_arg_t allowed_args[] = {
+        // Default is indefinite scan, with the NimBLE "background scan" interval and window.
+        { MP_QSTR_duration_ms, MP_ARG_OBJ, {.u_rom_obj = MP_ROM_INT(0)} },
+        { MP_QSTR_interval_us, MP_ARG_INT, {.u_int = 1280000} },
+        { MP_QSTR_window_us, MP_ARG_INT, {.u_int = 11250} },
+        { MP_QSTR_active, MP_ARG_BOOL, {.u_bool = false} },
+        { MP_QSTR_rssi, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+        { MP_QSTR_addr, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+        { MP_QSTR_name, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+        { MP_QSTR_uuid, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    if (args[ARG_duration_ms].u_obj == mp_const_none) {
+        // scan(None) --> stop scan.
+        return bluetooth_handle_errno(mp_bluetooth_gap_scan_stop());
+    }
+    mp_int_t duration_ms = mp_obj_get_int(args[ARG_duration_ms].u_obj);
+
+    // Build the new filter before replacing the one the stack may be using.
+    mp_bluetooth_scan_filter_t filter = {0};
+    if (args[ARG_rssi].u_obj != mp_const_none) {
+        filter.has_rssi = true;
+        filter.rssi = MAX(-128, MIN(127, mp_obj_get_int(args[ARG_rssi].u_obj)));
+    }
+    if (args[ARG_addr].u_obj != mp_const_none) {
+        mp_buffer_info_t bufinfo;
+        mp_get_buffer_raise(args[ARG_addr].u_obj, &bufinfo, MP_BUFFER_READ);
+        if (bufinfo.len > sizeof(filter.addr)) {
+            mp_raise_ValueError(MP_ERROR_TEXT("invalid addr"));
         }
-        duration_ms = mp_obj_get_int(args[1]);
-        if (n_args > 2) {
-            interval_us = mp_obj_get_int(args[2]);
-            if (n_args > 3) {
-                window_us = mp_obj_get_int(args[3]);
-                if (n_args > 4) {
-                    active_scan = mp_obj_is_true(args[4]);
-                }
-            }
+        filter.addr_len = bufinfo.len;
+        memcpy(filter.addr, bufinfo.buf, bufinfo.len);
+    }
+    if (args[ARG_name].u_obj != mp_const_none) {
+        mp_buffer_info_t bufinfo;
+        mp_get_buffer_raise(args[ARG_name].u_obj, &bufinfo, MP_BUFFER_READ);
+        if (bufinfo.len > sizeof(filter.name)) {
+            mp_raise_ValueError(MP_ERROR_TEXT("name too long"));
         }
+        filter.name_len = bufinfo.len;
+        memcpy(filter.name, bufinfo.buf, bufinfo.len);
     }
-    return bluetooth_handle_errno(mp_bluetooth_gap_scan_start(duration_ms, interval_us, window_us, active_scan));
+    if (args[ARG_uuid].u_obj != mp_const_none) {
+        if (!mp_obj_is_type(args[ARG_uuid].u_obj, &mp_type_bluetooth_uuid)) {
+            mp_raise_ValueError(MP_ERROR_TEXT("invalid UUID"));
+        }
+        filter.uuid = *(mp_obj_bluetooth_uuid_t *)MP_OBJ_TO_PTR(args[ARG_uuid].u_obj);
+    }
+
+    mp_obj_bluetooth_ble_t *o = MP_OBJ_TO_PTR(MP_STATE_VM(bluetooth));
+    MICROPY_PY_BLUETOOTH_ENTER
+    o->scan_filter = filter;
+    MICROPY_PY_BLUETOOTH_EXIT
+
+    return bluetooth_handle_errno(mp_bluetooth_gap_scan_start(duration_ms, args[ARG_interval_us].u_int, args[ARG_window_us].u_int, args[ARG_active].u_bool));
 }
-STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(bluetooth_ble_gap_scan_obj, 1, 5, bluetooth_ble_gap_scan);
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(bluetooth_ble_gap_scan_obj, 1, bluetooth_ble_gap_scan);
 #endif // MICROPY_PY_BLUETOOTH_ENABLE_CENTRAL_MODE
 
 STATIC mp_obj_t bluetooth_ble_gap_disconnect(mp_obj_t self_in, mp_obj_t conn_handle_in) {
@@ -744,6 +799,17 @@ STATIC mp_obj_t bluetooth_ble_gatts_notify(size_t n_args, const mp_obj_t *args)
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(bluetooth_ble_gatts_notify_obj, 3, 4, bluetooth_ble_gatts_notify);
 
+STATIC mp_obj_t bluetooth_ble_gatts_notify_stream(size_t n_args, const mp_obj_t *args) {
+    mp_int_t conn_handle = mp_obj_get_int(args[1]);
+    mp_int_t value_handle = mp_obj_get_int(args[2]);
+    mp_buffer_info_t bufinfo = {0};
+    mp_get_buffer_raise(args[3], &bufinfo, MP_BUFFER_READ);
+    size_t sent = 0;
+    bluetooth_handle_errno(mp_bluetooth_gatts_notify_stream(conn_handle, value_handle, bufinfo.buf, bufinfo.len, &sent));
+    return MP_OBJ_NEW_SMALL_INT(sent);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(bluetooth_ble_gatts_notify_stream_obj, 4, 4, bluetooth_ble_gatts_notify_stream);
+
 STATIC mp_obj_t bluetooth_ble_gatts_indicate(mp_obj_t self_in, mp_obj_t conn_handle_in, mp_obj_t value_handle_in) {
     (void)self_in;
     mp_int_t conn_handle = mp_obj_get_int(conn_handle_in);
@@ -931,6 +997,7 @@ STATIC const mp_rom_map_elem_t bluetooth_ble_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_gatts_read), MP_ROM_PTR(&bluetooth_ble_gatts_read_obj) },
     { MP_ROM_QSTR(MP_QSTR_gatts_write), MP_ROM_PTR(&bluetooth_ble_gatts_write_obj) },
     { MP_ROM_QSTR(MP_QSTR_gatts_notify), MP_ROM_PTR(&bluetooth_ble_gatts_notify_obj) },
+    { MP_ROM_QSTR(MP_QSTR_gatts_notify_stream), MP_ROM_PTR(&bluetooth_ble_gatts_notify_stream_obj) },
     { MP_ROM_QSTR(MP_QSTR_gatts_indicate), MP_ROM_PTR(&bluetooth_ble_gatts_indicate_obj) },
     { MP_ROM_QSTR(MP_QSTR_gatts_set_buffer), MP_ROM_PTR(&bluetooth_ble_gatts_set_buffer_obj) },
     #if MICROPY_PY_BLUETOOTH_ENABLE_GATT_CLIENT
@@ -984,6 +1051,48 @@ const mp_obj_module_t mp_module_ubluetooth = {
 
 // Helpers
 
+#if MICROPY_PY_BLUETOOTH_ENABLE_CENTRAL_MODE
+// Called from the stack's scan callback, so must not allocate.
+STATIC bool scan_filter_match(const mp_bluetooth_scan_filter_t *filter, const uint8_t *addr, int8_t rssi, const uint8_t *data, size_t data_len) {
+    if (filter->has_rssi && rssi < filter->rssi) {
+        return false;
+    }
+    if (memcmp(addr, filter->addr, filter->addr_len) != 0) {
+        return false;
+    }
+    bool name_ok = filter->name_len == 0;
+    bool uuid_ok = filter->uuid.type == 0;
+
+    // Walk the advertising payload, a sequence of <len><type><value>.
+    for (size_t i = 0; i + 1 < data_len && !(name_ok && uuid_ok);) {
+        size_t len = data[i];
+        if (len == 0 || i + 1 + len > data_len) {
+            break;
+        }
+        uint8_t ad_type = data[i + 1];
+        const uint8_t *value = &data[i + 2];
+        size_t value_len = len - 1;
+        i += 1 + len;
+
+        if (ad_type == MP_BLUETOOTH_AD_TYPE_SHORT_NAME || ad_type == MP_BLUETOOTH_AD_TYPE_COMPLETE_NAME) {
+            name_ok = name_ok || (value_len >= filter->name_len && memcmp(value, filter->name, filter->name_len) == 0);
+        } else if (!uuid_ok && ad_type >= MP_BLUETOOTH_AD_TYPE_UUID16_MORE && ad_type <= MP_BLUETOOTH_AD_TYPE_UUID128_COMPLETE) {
+            // Types 0x02-0x07 come in (incomplete, complete) pairs of 16, 32 and 128-bit UUIDs.
+            static const uint8_t uuid_size[] = { 2, 4, 16 };
+            if (uuid_size[(ad_type - MP_BLUETOOTH_AD_TYPE_UUID16_MORE) / 2] == filter->uuid.type) {
+                for (size_t j = 0; j + filter->uuid.type <= value_len; j += filter->uuid.type) {
+                    if (memcmp(&value[j], filter->uuid.data, filter->uuid.type) == 0) {
+                        uuid_ok = true;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    return name_ok && uuid_ok;
+}
+#endif // MICROPY_PY_BLUETOOTH_ENABLE_CENTRAL_MODE
+
 #if !MICROPY_PY_BLUETOOTH_USE_SYNC_EVENTS
 STATIC void ringbuf_extract(ringbuf_t *ringbuf, mp_obj_tuple_t *data_tuple, size_t n_u16, size_t n_u8, mp_obj_array_t *bytes_addr, size_t n_i8, mp_obj_bluetooth_uuid_t *uuid, mp_obj_array_t *bytes_data) {
     assert(ringbuf_avail(ringbuf) >= n_u16 * 2 + n_u8 + (bytes_addr ? 6 : 0) + n_i8 + (uuid ? 1 : 0) + (bytes_data ? 1 : 0));
@@ -997,9 +1106,7 @@ STATIC void ringbuf_extract(ringbuf_t *ringbuf, mp_obj_tuple_t *data_tuple, size
     }
     if (bytes_addr) {
         bytes_addr->len = 6;
-        for (size_t i = 0; i < bytes_addr->len; ++i) {
-            ((uint8_t *)bytes_addr->items)[i] = ringbuf_get(ringbuf);
-        }
+        ringbuf_get_bytes(ringbuf, bytes_addr->items, bytes_addr->len);
         data_tuple->items[j++] = MP_OBJ_FROM_PTR(bytes_addr);
     }
     for (size_t i = 0; i < n_i8; ++i) {
@@ -1017,9 +1124,7 @@ STATIC void ringbuf_extract(ringbuf_t *ringbuf, mp_obj_tuple_t *data_tuple, size
     // that's what's available here.
     if (bytes_data) {
         bytes_data->len = ringbuf_get16(ringbuf);
-        for (size_t i = 0; i < bytes_data->len; ++i) {
-            ((uint8_t *)bytes_data->items)[i] = ringbuf_get(ringbuf);
-        }
+        ringbuf_get_bytes(ringbuf, bytes_data->items, bytes_data->len);
         data_tuple->items[j++] = MP_OBJ_FROM_PTR(bytes_data);
     }
 
@@ -1056,7 +1161,7 @@ STATIC mp_obj_t bluetooth_ble_invoke_irq(mp_obj_t none_in) {
         } else if (event == MP_BLUETOOTH_IRQ_CONNECTION_UPDATE) {
             // conn_handle, conn_interval, conn_latency, supervision_timeout, status
             ringbuf_extract(&o->ringbuf, data_tuple, 5, 0, NULL, 0, NULL, NULL);
-        } else if (event == MP_BLUETOOTH_IRQ_GATTS_WRITE) {
+        } else if (event == MP_BLUETOOTH_IRQ_GATTS_WRITE || event == MP_BLUETOOTH_IRQ_GATTS_NOTIFY_READY) {
             // conn_handle, value_handle
             ringbuf_extract(&o->ringbuf, data_tuple, 2, 0, NULL, 0, NULL, NULL);
         } else if (event == MP_BLUETOOTH_IRQ_GATTS_INDICATE_DONE) {
@@ -1220,6 +1325,11 @@ void mp_bluetooth_gatts_on_indicate_complete(uint16_t conn_handle, uint16_t valu
     invoke_irq_handler(MP_BLUETOOTH_IRQ_GATTS_INDICATE_DONE, args, 3, 0, NULL_ADDR, NULL_UUID, NULL_DATA, NULL_DATA_LEN, 0);
 }
 
+void mp_bluetooth_gatts_on_notify_ready(uint16_t conn_handle, uint16_t value_handle) {
+    mp_int_t args[] = {conn_handle, value_handle};
+    invoke_irq_handler(MP_BLUETOOTH_IRQ_GATTS_NOTIFY_READY, args, 2, 0, NULL_ADDR, NULL_UUID, NULL_DATA, NULL_DATA_LEN, 0);
+}
+
 mp_int_t mp_bluetooth_gatts_on_read_request(uint16_t conn_handle, uint16_t value_handle) {
     mp_int_t args[] = {conn_handle, value_handle};
     mp_obj_t result = invoke_irq_handler(MP_BLUETOOTH_IRQ_GATTS_READ_REQUEST, args, 2, 0, NULL_ADDR, NULL_UUID, NULL_DATA, NULL_DATA_LEN, 0);
@@ -1271,6 +1381,10 @@ void mp_bluetooth_gap_on_scan_complete(void) {
 }
 
 void mp_bluetooth_gap_on_scan_result(uint8_t addr_type, const uint8_t *addr, uint8_t adv_type, const int8_t rssi, const uint8_t *data, size_t data_len) {
+    mp_obj_bluetooth_ble_t *o = MP_OBJ_TO_PTR(MP_STATE_VM(bluetooth));
+    if (!scan_filter_match(&o->scan_filter, addr, rssi, data, data_len)) {
+        return;
+    }
     mp_int_t args[] = {addr_type, adv_type, rssi};
     invoke_irq_handler(MP_BLUETOOTH_IRQ_SCAN_RESULT, args, 1, 2, addr, NULL_UUID, &data, &data_len, 1);
 }
@@ -1391,9 +1505,7 @@ void mp_bluetooth_gap_on_connected_disconnected(uint8_t event, uint16_t conn_han
     if (enqueue_irq(o, 2 + 1 + 6, event)) {
         ringbuf_put16(&o->ringbuf, conn_handle);
         ringbuf_put(&o->ringbuf, addr_type);
-        for (int i = 0; i < 6; ++i) {
-            ringbuf_put(&o->ringbuf, addr[i]);
-        }
+        ringbuf_put_bytes(&o->ringbuf, addr, 6);
     }
     schedule_ringbuf(atomic_state);
 }
@@ -1432,6 +1544,16 @@ void mp_bluetooth_gatts_on_indicate_complete(uint16_t conn_handle, uint16_t valu
     schedule_ringbuf(atomic_state);
 }
 
+void mp_bluetooth_gatts_on_notify_ready(uint16_t conn_handle, uint16_t value_handle) {
+    MICROPY_PY_BLUETOOTH_ENTER
+    mp_obj_bluetooth_ble_t *o = MP_OBJ_TO_PTR(MP_STATE_VM(bluetooth));
+    if (enqueue_irq(o, 2 + 2, MP_BLUETOOTH_IRQ_GATTS_NOTIFY_READY)) {
+        ringbuf_put16(&o->ringbuf, conn_handle);
+        ringbuf_put16(&o->ringbuf, value_handle);
+    }
+    schedule_ringbuf(atomic_state);
+}
+
 mp_int_t mp_bluetooth_gatts_on_read_request(uint16_t conn_handle, uint16_t value_handle) {
     (void)conn_handle;
     (void)value_handle;
@@ -1461,12 +1583,15 @@ void mp_bluetooth_gap_on_scan_complete(void) {
 void mp_bluetooth_gap_on_scan_result(uint8_t addr_type, const uint8_t *addr, uint8_t adv_type, const int8_t rssi, const uint8_t *data, size_t data_len) {
     MICROPY_PY_BLUETOOTH_ENTER
     mp_obj_bluetooth_ble_t *o = MP_OBJ_TO_PTR(MP_STATE_VM(bluetooth));
+    if (!o || !scan_filter_match(&o->scan_filter, addr, rssi, data, data_len)) {
+        // Drop it here rather than spend ringbuf space and a Python call on it.
+        MICROPY_PY_BLUETOOTH_EXIT
+        return;
+    }
     data_len = MIN(o->irq_data_data_alloc, data_len);
     if (enqueue_irq(o, 1 + 6 + 1 + 1 + 2 + data_len, MP_BLUETOOTH_IRQ_SCAN_RESULT)) {
         ringbuf_put(&o->ringbuf, addr_type);
-        for (int i = 0; i < 6; ++i) {
-            ringbuf_put(&o->ringbuf, addr[i]);
-        }
+        ringbuf_put_bytes(&o->ringbuf, addr, 6);
         // The adv_type will get extracted as an int8_t but that's ok because valid values are 0x00-0x04.
         ringbuf_put(&o->ringbuf, adv_type);
         // Note conversion of int8_t rssi to uint8_t. Must un-convert on the way out.
@@ -1474,9 +1599,7 @@ void mp_bluetooth_gap_on_scan_result(uint8_t addr_type, const uint8_t *addr, uin
         // Length field is 16-bit.
         data_len = MIN(UINT16_MAX, data_len);
         ringbuf_put16(&o->ringbuf, data_len);
-        for (size_t i = 0; i < data_len; ++i) {
-            ringbuf_put(&o->ringbuf, data[i]);
-        }
+        ringbuf_put_bytes(&o->ringbuf, data, data_len);
     }
     schedule_ringbuf(atomic_state);
 }
@@ -1550,11 +1673,8 @@ void mp_bluetooth_gattc_on_data_available(uint8_t event, uint16_t conn_handle, u
 
         // Copy total_len from the fragments to the ringbuffer.
         uint16_t copied_bytes = 0;
-        for (size_t i = 0; i < num; ++i) {
-            for (size_t j = 0; i < data_len[i] && copied_bytes < total_len; ++j) {
-                ringbuf_put(&o->ringbuf, data[i][j]);
-                ++copied_bytes;
-            }
+        for (size_t i = 0; i < num && copied_bytes < total_len; ++i) {
+            copied_bytes += ringbuf_put_bytes(&o->ringbuf, data[i], MIN(data_len[i], total_len - copied_bytes));
         }
     }
     schedule_ringbuf(atomic_state);
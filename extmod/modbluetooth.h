@@ -161,6 +161,7 @@
 #define MP_BLUETOOTH_IRQ_GET_SECRET                     (29)
 #define MP_BLUETOOTH_IRQ_SET_SECRET                     (30)
 #define MP_BLUETOOTH_IRQ_PASSKEY_ACTION                 (31)
+#define MP_BLUETOOTH_IRQ_GATTS_NOTIFY_READY             (32)
 
 #define MP_BLUETOOTH_ADDRESS_MODE_PUBLIC (0)
 #define MP_BLUETOOTH_ADDRESS_MODE_RANDOM (1)
@@ -340,6 +341,10 @@ int mp_bluetooth_gatts_write(uint16_t value_handle, const uint8_t *value, size_t
 int mp_bluetooth_gatts_notify(uint16_t conn_handle, uint16_t value_handle);
 // Notify the central, including a data payload. (Note: does not set the gatts db value).
 int mp_bluetooth_gatts_notify_send(uint16_t conn_handle, uint16_t value_handle, const uint8_t *value, size_t value_len);
+// Notify the central with as much of value as the stack can queue right now, split into notifications of
+// (MTU - 3) bytes. Sets *sent to the number of bytes queued. If that's less than value_len, then the stack
+// must call mp_bluetooth_gatts_on_notify_ready once there is room again.
+int mp_bluetooth_gatts_notify_stream(uint16_t conn_handle, uint16_t value_handle, const uint8_t *value, size_t value_len, size_t *sent);
 // Indicate the central.
 int mp_bluetooth_gatts_indicate(uint16_t conn_handle, uint16_t value_handle);
 
@@ -435,6 +440,9 @@ void mp_bluetooth_gatts_on_write(uint16_t conn_handle, uint16_t value_handle);
 // Call this when an acknowledgment is received for an indication.
 void mp_bluetooth_gatts_on_indicate_complete(uint16_t conn_handle, uint16_t value_handle, uint8_t status);
 
+// Call this when a notify stream that couldn't queue all of its data can send again.
+void mp_bluetooth_gatts_on_notify_ready(uint16_t conn_handle, uint16_t value_handle);
+
 // Call this when a characteristic is read from (giving the handler a chance to update the stored value).
 // Return 0 to allow the read, otherwise a non-zero rejection reason (see MP_BLUETOOTH_GATTS_ERROR_*).
 mp_int_t mp_bluetooth_gatts_on_read_request(uint16_t conn_handle, uint16_t value_handle);
@@ -31,15 +31,35 @@
 
 #include "py/runtime.h"
 #include "py/stream.h"
+#include "py/mperrno.h"
 
 #if MICROPY_PY_BTREE
 
 #include <db.h>
 #include <../../btree/btree.h>
 
+// Layer between the page pool of the database and the underlying stream.
+// It tracks the file position itself to skip redundant seeks, counts I/O
+// for stats(), and, if a block size is given, coalesces consecutive page
+// writes into block-aligned chunks (eg the erase block of a flash device).
+typedef struct _btree_wb_t {
+    mp_obj_t stream;
+    off_t pos; // logical file position as seen by the database
+    off_t stream_pos; // actual position of the stream, -1 if unknown
+    byte *buf; // write-back buffer, NULL if disabled
+    size_t blocksize;
+    off_t buf_off; // file offset of buf[0]
+    size_t buf_len;
+    size_t n_read;
+    size_t n_write;
+    size_t n_stream_read;
+    size_t n_stream_write;
+    size_t n_buf_hit;
+} btree_wb_t;
+
 typedef struct _mp_obj_btree_t {
     mp_obj_base_t base;
-    mp_obj_t stream; // retain a reference to prevent GC from reclaiming it
+    btree_wb_t wb; // also retains a reference to the stream
     DB *db;
     mp_obj_t start_key;
     mp_obj_t end_key;
@@ -66,11 +86,170 @@ void __dbpanic(DB *db) {
     mp_printf(&mp_plat_print, "__dbpanic(%p)\n", db);
 }
 
-STATIC mp_obj_btree_t *btree_new(DB *db, mp_obj_t stream) {
+STATIC int btree_wb_seek_stream(btree_wb_t *wb, off_t pos) {
+    if (wb->stream_pos != pos) {
+        off_t res = mp_stream_posix_lseek(MP_OBJ_TO_PTR(wb->stream), pos, SEEK_SET);
+        if (res < 0) {
+            wb->stream_pos = -1;
+            return -1;
+        }
+        wb->stream_pos = res;
+    }
+    return 0;
+}
+
+STATIC int btree_wb_flush(btree_wb_t *wb) {
+    if (wb->buf_len == 0) {
+        return 0;
+    }
+    if (btree_wb_seek_stream(wb, wb->buf_off) < 0) {
+        return -1;
+    }
+    ssize_t res = mp_stream_posix_write(MP_OBJ_TO_PTR(wb->stream), wb->buf, wb->buf_len);
+    wb->n_stream_write++;
+    if (res < 0) {
+        wb->stream_pos = -1;
+        return -1;
+    }
+    wb->stream_pos += res;
+    if ((size_t)res != wb->buf_len) {
+        errno = MP_EIO;
+        return -1;
+    }
+    wb->buf_len = 0;
+    return 0;
+}
+
+STATIC ssize_t btree_wb_read(virt_fd_t fd, void *buf, size_t len) {
+    btree_wb_t *wb = fd;
+    wb->n_read++;
+    if (wb->buf_len != 0 && wb->pos < wb->buf_off + (off_t)wb->buf_len
+        && wb->pos + (off_t)len > wb->buf_off) {
+        if (wb->pos >= wb->buf_off && wb->pos + (off_t)len <= wb->buf_off + (off_t)wb->buf_len) {
+            // Entirely within the pending block
+            memcpy(buf, wb->buf + (wb->pos - wb->buf_off), len);
+            wb->pos += len;
+            wb->n_buf_hit++;
+            return len;
+        }
+        if (btree_wb_flush(wb) < 0) {
+            return -1;
+        }
+    }
+    if (btree_wb_seek_stream(wb, wb->pos) < 0) {
+        return -1;
+    }
+    ssize_t res = mp_stream_posix_read(MP_OBJ_TO_PTR(wb->stream), buf, len);
+    wb->n_stream_read++;
+    if (res < 0) {
+        wb->stream_pos = -1;
+        return -1;
+    }
+    wb->pos += res;
+    wb->stream_pos = wb->pos;
+    return res;
+}
+
+STATIC ssize_t btree_wb_write(virt_fd_t fd, const void *buf, size_t len) {
+    btree_wb_t *wb = fd;
+    wb->n_write++;
+    if (wb->buf == NULL) {
+        if (btree_wb_seek_stream(wb, wb->pos) < 0) {
+            return -1;
+        }
+        ssize_t res = mp_stream_posix_write(MP_OBJ_TO_PTR(wb->stream), buf, len);
+        wb->n_stream_write++;
+        if (res < 0) {
+            wb->stream_pos = -1;
+            return -1;
+        }
+        wb->pos += res;
+        wb->stream_pos = wb->pos;
+        return res;
+    }
+    const byte *data = buf;
+    size_t remain = len;
+    while (remain > 0) {
+        if (wb->buf_len != 0
+            && (wb->pos < wb->buf_off || wb->pos > wb->buf_off + (off_t)wb->buf_len)) {
+            // Not contiguous with the pending data
+            if (btree_wb_flush(wb) < 0) {
+                return -1;
+            }
+        }
+        if (wb->buf_len == 0) {
+            wb->buf_off = wb->pos;
+        }
+        off_t blk_end = (wb->buf_off / wb->blocksize + 1) * wb->blocksize;
+        size_t n = MIN(remain, (size_t)(blk_end - wb->pos));
+        memcpy(wb->buf + (wb->pos - wb->buf_off), data, n);
+        wb->pos += n;
+        if (wb->pos - wb->buf_off > (off_t)wb->buf_len) {
+            wb->buf_len = wb->pos - wb->buf_off;
+        }
+        data += n;
+        remain -= n;
+        if (wb->buf_off + (off_t)wb->buf_len == blk_end) {
+            // Block complete, write it out
+            if (btree_wb_flush(wb) < 0) {
+                return -1;
+            }
+        }
+    }
+    return len;
+}
+
+STATIC off_t btree_wb_lseek(virt_fd_t fd, off_t offset, int whence) {
+    btree_wb_t *wb = fd;
+    if (whence == SEEK_SET) {
+        wb->pos = offset;
+    } else if (whence == SEEK_CUR) {
+        wb->pos += offset;
+    } else {
+        // The end of the file may be in the pending block
+        if (btree_wb_flush(wb) < 0) {
+            return -1;
+        }
+        off_t res = mp_stream_posix_lseek(MP_OBJ_TO_PTR(wb->stream), offset, whence);
+        if (res < 0) {
+            wb->stream_pos = -1;
+            return -1;
+        }
+        wb->pos = wb->stream_pos = res;
+    }
+    return wb->pos;
+}
+
+STATIC int btree_wb_fsync(virt_fd_t fd) {
+    btree_wb_t *wb = fd;
+    if (btree_wb_flush(wb) < 0) {
+        return -1;
+    }
+    return mp_stream_posix_fsync(MP_OBJ_TO_PTR(wb->stream));
+}
+
+STATIC const FILEVTABLE btree_stream_fvtable = {
+    btree_wb_read,
+    btree_wb_write,
+    btree_wb_lseek,
+    btree_wb_fsync
+};
+
+STATIC mp_obj_btree_t *btree_new(mp_obj_t stream, size_t blocksize) {
     mp_obj_btree_t *o = m_new_obj(mp_obj_btree_t);
     o->base.type = &btree_type;
-    o->stream = stream;
-    o->db = db;
+    memset(&o->wb, 0, sizeof(o->wb));
+    o->wb.stream = stream;
+    o->wb.pos = mp_stream_posix_lseek(MP_OBJ_TO_PTR(stream), 0, SEEK_CUR);
+    if (o->wb.pos < 0) {
+        mp_raise_OSError(errno);
+    }
+    o->wb.stream_pos = o->wb.pos;
+    if (blocksize != 0) {
+        o->wb.buf = m_new(byte, blocksize);
+        o->wb.blocksize = blocksize;
+    }
+    o->db = NULL;
     o->start_key = mp_const_none;
     o->end_key = mp_const_none;
     o->next_flags = 0;
@@ -85,13 +264,22 @@ STATIC void btree_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind
 
 STATIC mp_obj_t btree_flush(mp_obj_t self_in) {
     mp_obj_btree_t *self = MP_OBJ_TO_PTR(self_in);
-    return MP_OBJ_NEW_SMALL_INT(__bt_sync(self->db, 0));
+    int res = __bt_sync(self->db, 0);
+    if (res == RET_SUCCESS && btree_wb_flush(&self->wb) < 0) {
+        res = RET_ERROR;
+    }
+    return MP_OBJ_NEW_SMALL_INT(res);
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(btree_flush_obj, btree_flush);
 
 STATIC mp_obj_t btree_close(mp_obj_t self_in) {
     mp_obj_btree_t *self = MP_OBJ_TO_PTR(self_in);
-    return MP_OBJ_NEW_SMALL_INT(__bt_close(self->db));
+    int res = __bt_close(self->db);
+    // Write out the last pending block even if closing failed
+    if (btree_wb_flush(&self->wb) < 0) {
+        res = RET_ERROR;
+    }
+    return MP_OBJ_NEW_SMALL_INT(res);
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(btree_close_obj, btree_close);
 
@@ -105,6 +293,50 @@ STATIC mp_obj_t btree_put(size_t n_args, const mp_obj_t *args) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(btree_put_obj, 3, 4, btree_put);
 
+#if !MICROPY_ENABLE_DYNRUNTIME
+STATIC mp_obj_t btree_bulk_load(mp_obj_t self_in, mp_obj_t items_in) {
+    mp_obj_btree_t *self = MP_OBJ_TO_PTR(self_in);
+    BTREE *t = self->db->internal;
+    mp_obj_iter_buf_t iter_buf;
+    mp_obj_t iter = mp_getiter(items_in, &iter_buf);
+    mp_obj_t item;
+    mp_obj_t prev_key = MP_OBJ_NULL; // retains the previous key for comparison
+    DBT prev;
+    mp_int_t count = 0;
+    while ((item = mp_iternext(iter)) != MP_OBJ_STOP_ITERATION) {
+        mp_obj_t *kv;
+        mp_obj_get_array_fixed_n(item, 2, &kv);
+        DBT key, val;
+        key.data = (void *)mp_obj_str_get_data(kv[0], &key.size);
+        val.data = (void *)mp_obj_str_get_data(kv[1], &val.size);
+        // Strictly ascending keys keep the database on its append fast
+        // path, which fills each leaf page before starting the next one.
+        if (prev_key != MP_OBJ_NULL && t->bt_cmp(&prev, &key) >= 0) {
+            mp_raise_ValueError(MP_ERROR_TEXT("keys not sorted"));
+        }
+        CHECK_ERROR(__bt_put(self->db, &key, &val, 0));
+        prev_key = kv[0];
+        prev = key;
+        ++count;
+    }
+    return MP_OBJ_NEW_SMALL_INT(count);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(btree_bulk_load_obj, btree_bulk_load);
+
+STATIC mp_obj_t btree_stats(mp_obj_t self_in) {
+    mp_obj_btree_t *self = MP_OBJ_TO_PTR(self_in);
+    const btree_wb_t *wb = &self->wb;
+    mp_obj_t dict = mp_obj_new_dict(5);
+    mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(MP_QSTR_reads), mp_obj_new_int_from_uint(wb->n_read));
+    mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(MP_QSTR_writes), mp_obj_new_int_from_uint(wb->n_write));
+    mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(MP_QSTR_stream_reads), mp_obj_new_int_from_uint(wb->n_stream_read));
+    mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(MP_QSTR_stream_writes), mp_obj_new_int_from_uint(wb->n_stream_write));
+    mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(MP_QSTR_buf_hits), mp_obj_new_int_from_uint(wb->n_buf_hit));
+    return dict;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(btree_stats_obj, btree_stats);
+#endif
+
 STATIC mp_obj_t btree_get(size_t n_args, const mp_obj_t *args) {
     mp_obj_btree_t *self = MP_OBJ_TO_PTR(args[0]);
     DBT key, val;
@@ -309,6 +541,8 @@ STATIC const mp_rom_map_elem_t btree_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_keys), MP_ROM_PTR(&btree_keys_obj) },
     { MP_ROM_QSTR(MP_QSTR_values), MP_ROM_PTR(&btree_values_obj) },
     { MP_ROM_QSTR(MP_QSTR_items), MP_ROM_PTR(&btree_items_obj) },
+    { MP_ROM_QSTR(MP_QSTR_bulk_load), MP_ROM_PTR(&btree_bulk_load_obj) },
+    { MP_ROM_QSTR(MP_QSTR_stats), MP_ROM_PTR(&btree_stats_obj) },
 };
 
 STATIC MP_DEFINE_CONST_DICT(btree_locals_dict, btree_locals_dict_table);
@@ -326,13 +560,6 @@ STATIC const mp_obj_type_t btree_type = {
 };
 #endif
 
-STATIC const FILEVTABLE btree_stream_fvtable = {
-    mp_stream_posix_read,
-    mp_stream_posix_write,
-    mp_stream_posix_lseek,
-    mp_stream_posix_fsync
-};
-
 #if !MICROPY_ENABLE_DYNRUNTIME
 STATIC mp_obj_t mod_btree_open(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
     static const mp_arg_t allowed_args[] = {
@@ -340,6 +567,7 @@ STATIC mp_obj_t mod_btree_open(size_t n_args, const mp_obj_t *pos_args, mp_map_t
         { MP_QSTR_cachesize, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 0} },
         { MP_QSTR_pagesize, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 0} },
         { MP_QSTR_minkeypage, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_blocksize, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 0} },
     };
 
     // Make sure we got a stream object
@@ -350,6 +578,7 @@ STATIC mp_obj_t mod_btree_open(size_t n_args, const mp_obj_t *pos_args, mp_map_t
         mp_arg_val_t cachesize;
         mp_arg_val_t pagesize;
         mp_arg_val_t minkeypage;
+        mp_arg_val_t blocksize;
     } args;
     mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args,
         MP_ARRAY_SIZE(allowed_args), allowed_args, (mp_arg_val_t *)&args);
@@ -358,12 +587,16 @@ STATIC mp_obj_t mod_btree_open(size_t n_args, const mp_obj_t *pos_args, mp_map_t
     openinfo.cachesize = args.cachesize.u_int;
     openinfo.psize = args.pagesize.u_int;
     openinfo.minkeypage = args.minkeypage.u_int;
+    if (args.blocksize.u_int < 0) {
+        mp_raise_ValueError(NULL);
+    }
 
-    DB *db = __bt_open(MP_OBJ_TO_PTR(pos_args[0]), &btree_stream_fvtable, &openinfo, /*dflags*/ 0);
-    if (db == NULL) {
+    mp_obj_btree_t *self = btree_new(pos_args[0], args.blocksize.u_int);
+    self->db = __bt_open(&self->wb, &btree_stream_fvtable, &openinfo, /*dflags*/ 0);
+    if (self->db == NULL) {
         mp_raise_OSError(errno);
     }
-    return MP_OBJ_FROM_PTR(btree_new(db, pos_args[0]));
+    return MP_OBJ_FROM_PTR(self);
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mod_btree_open_obj, 1, mod_btree_open);
 
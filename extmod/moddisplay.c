@@ -0,0 +1,331 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "py/runtime.h"
+#include "py/mphal.h"
+#include "extmod/machine_i2c.h"
+#include "extmod/machine_spi.h"
+#include "extmod/modframebuf.h"
+
+#if MICROPY_PY_DISPLAY
+
+// This module sends the contents of a FrameBuffer to a display controller.
+// A Bus object wraps an I2C bus and address (SSD1306 and SH1106 style, where
+// a control byte says if the bytes that follow are commands or data) or an
+// SPI bus with DC and CS pins.  Only the dirty rectangle of the framebuffer,
+// or a given region, is sent, and the loops over the rows are done in C.
+
+#define CTRL_CMD (0x00)
+#define CTRL_DATA (0x40)
+
+// MIPI DCS commands used by ST7789, ILI9341 and similar controllers
+#define DCS_CASET (0x2a)
+#define DCS_RASET (0x2b)
+#define DCS_RAMWR (0x2c)
+
+// SSD1306 and SH1106 commands
+#define SSD1306_SET_COL_ADDR (0x21)
+#define SSD1306_SET_PAGE_ADDR (0x22)
+#define SH1106_SET_LOW_COL (0x00)
+#define SH1106_SET_HIGH_COL (0x10)
+#define SH1106_SET_PAGE (0xb0)
+
+typedef struct _display_bus_obj_t {
+    mp_obj_base_t base;
+    mp_obj_t bus;
+    mp_hal_pin_obj_t dc;
+    mp_hal_pin_obj_t cs;
+    uint16_t addr;
+    bool spi;
+    bool data;
+} display_bus_obj_t;
+
+typedef struct _display_rect_t {
+    int x0, y0, x1, y1; // end exclusive
+} display_rect_t;
+
+STATIC mp_obj_t display_bus_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 2, 3, false);
+    display_bus_obj_t *self = m_new_obj(display_bus_obj_t);
+    self->base.type = type;
+    self->bus = args[0];
+    if (n_args == 2) {
+        // Bus(i2c, addr)
+        self->spi = false;
+        self->addr = mp_obj_get_int(args[1]);
+    } else {
+        // Bus(spi, dc, cs)
+        self->spi = true;
+        self->dc = mp_hal_get_pin_obj(args[1]);
+        self->cs = mp_hal_get_pin_obj(args[2]);
+        mp_hal_pin_write(self->cs, 1);
+    }
+    return MP_OBJ_FROM_PTR(self);
+}
+
+// Starts a run of commands (data=false) or data, sent with display_bus_send().
+STATIC void display_bus_begin(display_bus_obj_t *self, bool data) {
+    self->data = data;
+    if (self->spi) {
+        mp_hal_pin_write(self->dc, data);
+        mp_hal_pin_write(self->cs, 0);
+    }
+}
+
+STATIC void display_bus_end(display_bus_obj_t *self) {
+    if (self->spi) {
+        mp_hal_pin_write(self->cs, 1);
+    }
+}
+
+// Buses implemented in C are driven through their protocol.  Others, such as
+// a subclass written in Python, have their write() or writevto() method called.
+STATIC void display_bus_send(display_bus_obj_t *self, const uint8_t *buf, size_t len) {
+    const mp_obj_type_t *type = mp_obj_get_type(self->bus);
+    if (self->spi) {
+        if (type->protocol != NULL) {
+            mp_machine_spi_p_t *spi_p = (mp_machine_spi_p_t *)type->protocol;
+            spi_p->transfer(MP_OBJ_TO_PTR(self->bus), len, buf, NULL);
+        } else {
+            mp_obj_t dest[3];
+            mp_load_method(self->bus, MP_QSTR_write, dest);
+            dest[2] = mp_obj_new_bytearray_by_ref(len, (void *)buf);
+            mp_call_method_n_kw(1, 0, dest);
+        }
+    } else {
+        uint8_t ctrl = self->data ? CTRL_DATA : CTRL_CMD;
+        if (type->protocol != NULL) {
+            mp_machine_i2c_p_t *i2c_p = (mp_machine_i2c_p_t *)type->protocol;
+            mp_machine_i2c_buf_t bufs[2] = {{1, &ctrl}, {len, (uint8_t *)buf}};
+            int ret = i2c_p->transfer(MP_OBJ_TO_PTR(self->bus), self->addr, 2, bufs, MP_MACHINE_I2C_FLAG_STOP);
+            if (ret < 0) {
+                mp_raise_OSError(-ret);
+            }
+        } else {
+            mp_obj_t dest[4];
+            mp_load_method(self->bus, MP_QSTR_writevto, dest);
+            dest[2] = MP_OBJ_NEW_SMALL_INT(self->addr);
+            mp_obj_t items[2] = {
+                mp_obj_new_bytes(&ctrl, 1),
+                mp_obj_new_bytearray_by_ref(len, (void *)buf),
+            };
+            dest[3] = mp_obj_new_list(2, items);
+            mp_call_method_n_kw(2, 0, dest);
+        }
+    }
+}
+
+STATIC void display_bus_write(display_bus_obj_t *self, bool data, const uint8_t *buf, size_t len) {
+    display_bus_begin(self, data);
+    display_bus_send(self, buf, len);
+    display_bus_end(self);
+}
+
+STATIC void display_bus_write_obj(display_bus_obj_t *self, bool data, mp_obj_t buf_in) {
+    if (mp_obj_is_small_int(buf_in)) {
+        uint8_t b = MP_OBJ_SMALL_INT_VALUE(buf_in);
+        display_bus_write(self, data, &b, 1);
+    } else {
+        mp_buffer_info_t bufinfo;
+        mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_READ);
+        display_bus_write(self, data, bufinfo.buf, bufinfo.len);
+    }
+}
+
+STATIC mp_obj_t display_bus_cmd(mp_obj_t self_in, mp_obj_t buf_in) {
+    display_bus_write_obj(MP_OBJ_TO_PTR(self_in), false, buf_in);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(display_bus_cmd_obj, display_bus_cmd);
+
+STATIC mp_obj_t display_bus_data(mp_obj_t self_in, mp_obj_t buf_in) {
+    display_bus_write_obj(MP_OBJ_TO_PTR(self_in), true, buf_in);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(display_bus_data_obj, display_bus_data);
+
+// Gets the rectangle to send, which is the given region, or if that's None the
+// dirty rectangle of the framebuffer (which is then cleared).  Returns false if
+// there is nothing to send.
+STATIC bool display_get_rect(mp_obj_framebuf_t *fb, mp_obj_t region_in, display_rect_t *r) {
+    if (region_in == mp_const_none) {
+        r->x0 = fb->dirty_x0;
+        r->y0 = fb->dirty_y0;
+        r->x1 = fb->dirty_x1;
+        r->y1 = fb->dirty_y1;
+        mp_framebuf_clear_dirty(fb);
+    } else {
+        mp_obj_t *items;
+        mp_obj_get_array_fixed_n(region_in, 4, &items);
+        r->x0 = MAX(0, mp_obj_get_int(items[0]));
+        r->y0 = MAX(0, mp_obj_get_int(items[1]));
+        r->x1 = MIN(fb->width, mp_obj_get_int(items[0]) + mp_obj_get_int(items[2]));
+        r->y1 = MIN(fb->height, mp_obj_get_int(items[1]) + mp_obj_get_int(items[3]));
+    }
+    return r->x0 < r->x1 && r->y0 < r->y1;
+}
+
+// show_mono(fb, col_offset, page_mode, region=None)
+// Sends a MONO_VLSB framebuffer, a page of 8 rows at a time.  With page_mode
+// false the SSD1306 column and page address window is set once; with it true
+// each page is addressed on its own, as the SH1106 needs.
+STATIC mp_obj_t display_bus_show_mono(size_t n_args, const mp_obj_t *args) {
+    display_bus_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+    mp_obj_framebuf_t *fb = mp_framebuf_get(args[1]);
+    int col_offset = mp_obj_get_int(args[2]);
+    bool page_mode = mp_obj_is_true(args[3]);
+    if (fb->format != FRAMEBUF_MVLSB) {
+        mp_raise_ValueError(MP_ERROR_TEXT("invalid format"));
+    }
+    display_rect_t r;
+    if (!display_get_rect(fb, n_args > 4 ? args[4] : mp_const_none, &r)) {
+        return mp_const_none;
+    }
+    int page0 = r.y0 >> 3;
+    int page1 = (r.y1 + 7) >> 3;
+    int col = r.x0 + col_offset;
+    const uint8_t *buf = fb->buf;
+
+    if (!page_mode) {
+        uint8_t cmd[6] = {
+            SSD1306_SET_COL_ADDR, col, col + r.x1 - r.x0 - 1,
+            SSD1306_SET_PAGE_ADDR, page0, page1 - 1,
+        };
+        display_bus_write(self, false, cmd, sizeof(cmd));
+        display_bus_begin(self, true);
+        if (r.x0 == 0 && r.x1 == fb->stride) {
+            // Whole rows, which are contiguous in the buffer
+            display_bus_send(self, buf + page0 * fb->stride, (page1 - page0) * fb->stride);
+        } else {
+            for (int page = page0; page < page1; ++page) {
+                display_bus_send(self, buf + page * fb->stride + r.x0, r.x1 - r.x0);
+            }
+        }
+        display_bus_end(self);
+    } else {
+        for (int page = page0; page < page1; ++page) {
+            uint8_t cmd[3] = {
+                SH1106_SET_PAGE | page,
+                SH1106_SET_LOW_COL | (col & 0x0f),
+                SH1106_SET_HIGH_COL | (col >> 4),
+            };
+            display_bus_write(self, false, cmd, sizeof(cmd));
+            display_bus_write(self, true, buf + page * fb->stride + r.x0, r.x1 - r.x0);
+        }
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(display_bus_show_mono_obj, 4, 5, display_bus_show_mono);
+
+STATIC void display_dcs_window(display_bus_obj_t *self, uint8_t cmd, int start, int end) {
+    uint8_t param[4] = {start >> 8, start, end >> 8, end};
+    display_bus_write(self, false, &cmd, 1);
+    display_bus_write(self, true, param, sizeof(param));
+}
+
+// show_rgb565(fb, x_offset, y_offset, region=None)
+// Sends an RGB565 framebuffer to a MIPI DCS controller such as the ST7789 or
+// ILI9341.  The framebuffer holds pixels in native (little endian) order and
+// they are byte swapped on the way out, as the controllers take the high byte
+// first.
+STATIC mp_obj_t display_bus_show_rgb565(size_t n_args, const mp_obj_t *args) {
+    display_bus_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+    mp_obj_framebuf_t *fb = mp_framebuf_get(args[1]);
+    int x_offset = mp_obj_get_int(args[2]);
+    int y_offset = mp_obj_get_int(args[3]);
+    if (fb->format != FRAMEBUF_RGB565) {
+        mp_raise_ValueError(MP_ERROR_TEXT("invalid format"));
+    }
+    display_rect_t r;
+    if (!display_get_rect(fb, n_args > 4 ? args[4] : mp_const_none, &r)) {
+        return mp_const_none;
+    }
+
+    display_dcs_window(self, DCS_CASET, r.x0 + x_offset, r.x1 - 1 + x_offset);
+    display_dcs_window(self, DCS_RASET, r.y0 + y_offset, r.y1 - 1 + y_offset);
+    uint8_t cmd = DCS_RAMWR;
+    display_bus_write(self, false, &cmd, 1);
+
+    // Send the pixels, swapped into a chunk buffer on the stack; rows are
+    // merged into one run when the rectangle spans the whole stride
+    uint8_t chunk[256];
+    size_t chunk_len = 0;
+    size_t row_len = r.x1 - r.x0;
+    int rows = r.y1 - r.y0;
+    if (r.x0 == 0 && (unsigned int)r.x1 == fb->stride) {
+        row_len *= rows;
+        rows = 1;
+    }
+    display_bus_begin(self, true);
+    for (int y = 0; y < rows; ++y) {
+        const uint16_t *src = (const uint16_t *)fb->buf + (r.y0 + y) * fb->stride + r.x0;
+        for (size_t i = 0; i < row_len; ++i) {
+            uint16_t col = src[i];
+            chunk[chunk_len++] = col >> 8;
+            chunk[chunk_len++] = col;
+            if (chunk_len == sizeof(chunk)) {
+                display_bus_send(self, chunk, chunk_len);
+                chunk_len = 0;
+            }
+        }
+    }
+    if (chunk_len) {
+        display_bus_send(self, chunk, chunk_len);
+    }
+    display_bus_end(self);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(display_bus_show_rgb565_obj, 4, 5, display_bus_show_rgb565);
+
+STATIC const mp_rom_map_elem_t display_bus_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_cmd), MP_ROM_PTR(&display_bus_cmd_obj) },
+    { MP_ROM_QSTR(MP_QSTR_data), MP_ROM_PTR(&display_bus_data_obj) },
+    { MP_ROM_QSTR(MP_QSTR_show_mono), MP_ROM_PTR(&display_bus_show_mono_obj) },
+    { MP_ROM_QSTR(MP_QSTR_show_rgb565), MP_ROM_PTR(&display_bus_show_rgb565_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(display_bus_locals_dict, display_bus_locals_dict_table);
+
+STATIC const mp_obj_type_t display_bus_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_Bus,
+    .make_new = display_bus_make_new,
+    .locals_dict = (mp_obj_dict_t *)&display_bus_locals_dict,
+};
+
+STATIC const mp_rom_map_elem_t display_module_globals_table[] = {
+    { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR__display) },
+    { MP_ROM_QSTR(MP_QSTR_Bus), MP_ROM_PTR(&display_bus_type) },
+};
+STATIC MP_DEFINE_CONST_DICT(display_module_globals, display_module_globals_table);
+
+const mp_obj_module_t mp_module_display = {
+    .base = { &mp_type_module },
+    .globals = (mp_obj_dict_t *)&display_module_globals,
+};
+
+#endif // MICROPY_PY_DISPLAY
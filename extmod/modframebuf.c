@@ -28,19 +28,13 @@
 #include <string.h>
 
 #include "py/runtime.h"
+#include "py/binary.h"
+#include "extmod/modframebuf.h"
 
 #if MICROPY_PY_FRAMEBUF
 
 #include "ports/stm32/font_petme128_8x8.h"
 
-typedef struct _mp_obj_framebuf_t {
-    mp_obj_base_t base;
-    mp_obj_t buf_obj; // need to store this to prevent GC from reclaiming buf
-    void *buf;
-    uint16_t width, height, stride;
-    uint8_t format;
-} mp_obj_framebuf_t;
-
 #if !MICROPY_ENABLE_DYNRUNTIME
 STATIC const mp_obj_type_t mp_type_framebuf;
 #endif
@@ -55,15 +49,6 @@ typedef struct _mp_framebuf_p_t {
     fill_rect_t fill_rect;
 } mp_framebuf_p_t;
 
-// constants for formats
-#define FRAMEBUF_MVLSB    (0)
-#define FRAMEBUF_RGB565   (1)
-#define FRAMEBUF_GS2_HMSB (5)
-#define FRAMEBUF_GS4_HMSB (2)
-#define FRAMEBUF_GS8      (6)
-#define FRAMEBUF_MHLSB    (3)
-#define FRAMEBUF_MHMSB    (4)
-
 // Functions for MHLSB and MHMSB
 
 STATIC void mono_horiz_setpixel(const mp_obj_framebuf_t *fb, unsigned int x, unsigned int y, uint32_t col) {
@@ -240,15 +225,75 @@ STATIC mp_framebuf_p_t formats[] = {
     [FRAMEBUF_MHMSB] = {mono_horiz_setpixel, mono_horiz_getpixel, mono_horiz_fill_rect},
 };
 
+#if MICROPY_PY_FRAMEBUF_ACCEL
+// The port provides these to offload fills and same-format copies of RGB565
+// and GS8 rectangles to a 2D DMA engine.  Strides are in pixels.  The fill and
+// copy functions return false if the CPU should do the operation instead, and
+// otherwise may return before it has finished; mp_hal_framebuf_wait() blocks
+// until the last operation is complete.
+bool mp_hal_framebuf_fill(void *dest, unsigned int stride, unsigned int w, unsigned int h, unsigned int bpp, uint32_t col);
+bool mp_hal_framebuf_copy(void *dest, unsigned int dest_stride, const void *src, unsigned int src_stride, unsigned int w, unsigned int h, unsigned int bpp);
+void mp_hal_framebuf_wait(void);
+
+STATIC bool accel_busy;
+
+// Must be called before the CPU reads or writes any framebuffer memory.
+static inline void accel_sync(void) {
+    if (accel_busy) {
+        mp_hal_framebuf_wait();
+        accel_busy = false;
+    }
+}
+
+static inline unsigned int accel_bpp(const mp_obj_framebuf_t *fb) {
+    return fb->format == FRAMEBUF_RGB565 ? 16 : fb->format == FRAMEBUF_GS8 ? 8 : 0;
+}
+#else
+static inline void accel_sync(void) {
+}
+#endif
+
 static inline void setpixel(const mp_obj_framebuf_t *fb, unsigned int x, unsigned int y, uint32_t col) {
+    accel_sync();
     formats[fb->format].setpixel(fb, x, y, col);
 }
 
+STATIC void clear_dirty(mp_obj_framebuf_t *fb) {
+    mp_framebuf_clear_dirty(fb);
+}
+
+// Grow the dirty region to include the given rectangle, which must already
+// be clipped to the framebuffer.
+STATIC void mark_dirty(mp_obj_framebuf_t *fb, int x, int y, int xend, int yend) {
+    if (x >= xend || y >= yend) {
+        return;
+    }
+    fb->dirty_x0 = MIN(fb->dirty_x0, x);
+    fb->dirty_y0 = MIN(fb->dirty_y0, y);
+    fb->dirty_x1 = MAX(fb->dirty_x1, xend);
+    fb->dirty_y1 = MAX(fb->dirty_y1, yend);
+}
+
 static inline uint32_t getpixel(const mp_obj_framebuf_t *fb, unsigned int x, unsigned int y) {
+    accel_sync();
     return formats[fb->format].getpixel(fb, x, y);
 }
 
-STATIC void fill_rect(const mp_obj_framebuf_t *fb, int x, int y, int w, int h, uint32_t col) {
+// Fill a rectangle that is already clipped to the framebuffer.
+STATIC void fill_rect_clipped(mp_obj_framebuf_t *fb, int x, int y, int w, int h, uint32_t col) {
+    #if MICROPY_PY_FRAMEBUF_ACCEL
+    unsigned int bpp = accel_bpp(fb);
+    if (bpp != 0 && mp_hal_framebuf_fill((uint8_t *)fb->buf + (x + y * fb->stride) * bpp / 8,
+        fb->stride, w, h, bpp, col)) {
+        accel_busy = true;
+        return;
+    }
+    #endif
+    accel_sync();
+    formats[fb->format].fill_rect(fb, x, y, w, h, col);
+}
+
+STATIC void fill_rect(mp_obj_framebuf_t *fb, int x, int y, int w, int h, uint32_t col) {
     if (h < 1 || w < 1 || x + w <= 0 || y + h <= 0 || y >= fb->height || x >= fb->width) {
         // No operation needed.
         return;
@@ -260,7 +305,8 @@ STATIC void fill_rect(const mp_obj_framebuf_t *fb, int x, int y, int w, int h, u
     x = MAX(x, 0);
     y = MAX(y, 0);
 
-    formats[fb->format].fill_rect(fb, x, y, xend - x, yend - y, col);
+    fill_rect_clipped(fb, x, y, xend - x, yend - y, col);
+    mark_dirty(fb, x, y, xend, yend);
 }
 
 STATIC mp_obj_t framebuf_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
@@ -303,12 +349,16 @@ STATIC mp_obj_t framebuf_make_new(const mp_obj_type_t *type, size_t n_args, size
             mp_raise_ValueError(MP_ERROR_TEXT("invalid format"));
     }
 
+    clear_dirty(o);
+
     return MP_OBJ_FROM_PTR(o);
 }
 
 STATIC mp_int_t framebuf_get_buffer(mp_obj_t self_in, mp_buffer_info_t *bufinfo, mp_uint_t flags) {
     (void)flags;
     mp_obj_framebuf_t *self = MP_OBJ_TO_PTR(self_in);
+    // the buffer may be handed to a driver that doesn't know about framebuf
+    accel_sync();
     bufinfo->buf = self->buf;
     bufinfo->len = self->stride * self->height * (self->format == FRAMEBUF_RGB565 ? 2 : 1);
     bufinfo->typecode = 'B'; // view framebuf as bytes
@@ -318,7 +368,8 @@ STATIC mp_int_t framebuf_get_buffer(mp_obj_t self_in, mp_buffer_info_t *bufinfo,
 STATIC mp_obj_t framebuf_fill(mp_obj_t self_in, mp_obj_t col_in) {
     mp_obj_framebuf_t *self = MP_OBJ_TO_PTR(self_in);
     mp_int_t col = mp_obj_get_int(col_in);
-    formats[self->format].fill_rect(self, 0, 0, self->width, self->height, col);
+    fill_rect_clipped(self, 0, 0, self->width, self->height, col);
+    mark_dirty(self, 0, 0, self->width, self->height);
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(framebuf_fill_obj, framebuf_fill);
@@ -350,6 +401,7 @@ STATIC mp_obj_t framebuf_pixel(size_t n_args, const mp_obj_t *args) {
         } else {
             // set
             setpixel(self, x, y, mp_obj_get_int(args[3]));
+            mark_dirty(self, x, y, x + 1, y + 1);
         }
     }
     return mp_const_none;
@@ -405,15 +457,10 @@ STATIC mp_obj_t framebuf_rect(size_t n_args, const mp_obj_t *args) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(framebuf_rect_obj, 6, 6, framebuf_rect);
 
-STATIC mp_obj_t framebuf_line(size_t n_args, const mp_obj_t *args) {
-    (void)n_args;
-
-    mp_obj_framebuf_t *self = MP_OBJ_TO_PTR(args[0]);
-    mp_int_t x1 = mp_obj_get_int(args[1]);
-    mp_int_t y1 = mp_obj_get_int(args[2]);
-    mp_int_t x2 = mp_obj_get_int(args[3]);
-    mp_int_t y2 = mp_obj_get_int(args[4]);
-    mp_int_t col = mp_obj_get_int(args[5]);
+STATIC void line(mp_obj_framebuf_t *fb, mp_int_t x1, mp_int_t y1, mp_int_t x2, mp_int_t y2, uint32_t col) {
+    // the line stays within the bounding box of its end points
+    mark_dirty(fb, MAX(0, MIN(x1, x2)), MAX(0, MIN(y1, y2)),
+        MIN(fb->width, MAX(x1, x2) + 1), MIN(fb->height, MAX(y1, y2) + 1));
 
     mp_int_t dx = x2 - x1;
     mp_int_t sx;
@@ -453,12 +500,12 @@ STATIC mp_obj_t framebuf_line(size_t n_args, const mp_obj_t *args) {
     mp_int_t e = 2 * dy - dx;
     for (mp_int_t i = 0; i < dx; ++i) {
         if (steep) {
-            if (0 <= y1 && y1 < self->width && 0 <= x1 && x1 < self->height) {
-                setpixel(self, y1, x1, col);
+            if (0 <= y1 && y1 < fb->width && 0 <= x1 && x1 < fb->height) {
+                setpixel(fb, y1, x1, col);
             }
         } else {
-            if (0 <= x1 && x1 < self->width && 0 <= y1 && y1 < self->height) {
-                setpixel(self, x1, y1, col);
+            if (0 <= x1 && x1 < fb->width && 0 <= y1 && y1 < fb->height) {
+                setpixel(fb, x1, y1, col);
             }
         }
         while (e >= 0) {
@@ -469,21 +516,300 @@ STATIC mp_obj_t framebuf_line(size_t n_args, const mp_obj_t *args) {
         e += 2 * dy;
     }
 
-    if (0 <= x2 && x2 < self->width && 0 <= y2 && y2 < self->height) {
-        setpixel(self, x2, y2, col);
+    if (0 <= x2 && x2 < fb->width && 0 <= y2 && y2 < fb->height) {
+        setpixel(fb, x2, y2, col);
     }
+}
+
+STATIC mp_obj_t framebuf_line(size_t n_args, const mp_obj_t *args) {
+    (void)n_args;
+
+    mp_obj_framebuf_t *self = MP_OBJ_TO_PTR(args[0]);
+    mp_int_t x1 = mp_obj_get_int(args[1]);
+    mp_int_t y1 = mp_obj_get_int(args[2]);
+    mp_int_t x2 = mp_obj_get_int(args[3]);
+    mp_int_t y2 = mp_obj_get_int(args[4]);
+    mp_int_t col = mp_obj_get_int(args[5]);
+
+    line(self, x1, y1, x2, y2, col);
 
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(framebuf_line_obj, 6, 6, framebuf_line);
 
-STATIC mp_obj_t framebuf_blit(size_t n_args, const mp_obj_t *args) {
+// Q2 Q1
+// Q3 Q4
+#define ELLIPSE_MASK_FILL (0x10)
+#define ELLIPSE_MASK_ALL (0x0f)
+#define ELLIPSE_MASK_Q1 (0x01)
+#define ELLIPSE_MASK_Q2 (0x02)
+#define ELLIPSE_MASK_Q3 (0x04)
+#define ELLIPSE_MASK_Q4 (0x08)
+
+STATIC void setpixel_checked(mp_obj_framebuf_t *fb, mp_int_t x, mp_int_t y, uint32_t col, unsigned int mask) {
+    if (mask && 0 <= x && x < fb->width && 0 <= y && y < fb->height) {
+        setpixel(fb, x, y, col);
+        mark_dirty(fb, x, y, x + 1, y + 1);
+    }
+}
+
+STATIC void draw_ellipse_points(mp_obj_framebuf_t *fb, mp_int_t cx, mp_int_t cy, mp_int_t x, mp_int_t y, uint32_t col, unsigned int mask) {
+    if (mask & ELLIPSE_MASK_FILL) {
+        // each point gives a horizontal span from the centre line
+        if (mask & ELLIPSE_MASK_Q1) {
+            fill_rect(fb, cx, cy - y, x + 1, 1, col);
+        }
+        if (mask & ELLIPSE_MASK_Q2) {
+            fill_rect(fb, cx - x, cy - y, x + 1, 1, col);
+        }
+        if (mask & ELLIPSE_MASK_Q3) {
+            fill_rect(fb, cx - x, cy + y, x + 1, 1, col);
+        }
+        if (mask & ELLIPSE_MASK_Q4) {
+            fill_rect(fb, cx, cy + y, x + 1, 1, col);
+        }
+    } else {
+        setpixel_checked(fb, cx + x, cy - y, col, mask & ELLIPSE_MASK_Q1);
+        setpixel_checked(fb, cx - x, cy - y, col, mask & ELLIPSE_MASK_Q2);
+        setpixel_checked(fb, cx - x, cy + y, col, mask & ELLIPSE_MASK_Q3);
+        setpixel_checked(fb, cx + x, cy + y, col, mask & ELLIPSE_MASK_Q4);
+    }
+}
+
+STATIC mp_obj_t framebuf_ellipse(size_t n_args, const mp_obj_t *args) {
+    mp_obj_framebuf_t *self = MP_OBJ_TO_PTR(args[0]);
+    mp_int_t cx = mp_obj_get_int(args[1]);
+    mp_int_t cy = mp_obj_get_int(args[2]);
+    mp_int_t xr = mp_obj_get_int(args[3]);
+    mp_int_t yr = mp_obj_get_int(args[4]);
+    mp_int_t col = mp_obj_get_int(args[5]);
+    unsigned int mask = (n_args > 6 && mp_obj_is_true(args[6])) ? ELLIPSE_MASK_FILL : 0;
+    if (n_args > 7) {
+        mask |= mp_obj_get_int(args[7]) & ELLIPSE_MASK_ALL;
+    } else {
+        mask |= ELLIPSE_MASK_ALL;
+    }
+    if (xr < 0 || yr < 0) {
+        mp_raise_ValueError(NULL);
+    }
+    if (xr == 0 || yr == 0) {
+        // a flat ellipse is a horizontal or vertical line through the centre
+        if (mask & ELLIPSE_MASK_ALL) {
+            fill_rect(self, cx - xr, cy - yr, 2 * xr + 1, 2 * yr + 1, col);
+        }
+        return mp_const_none;
+    }
+
+    // Midpoint algorithm, stepping along y for the part of each quadrant
+    // with slope below 1 and then along x for the rest.
+    mp_int_t two_asquare = 2 * xr * xr;
+    mp_int_t two_bsquare = 2 * yr * yr;
+    mp_int_t x = xr;
+    mp_int_t y = 0;
+    mp_int_t xchange = yr * yr * (1 - 2 * xr);
+    mp_int_t ychange = xr * xr;
+    mp_int_t ellipse_error = 0;
+    mp_int_t stoppingx = two_bsquare * xr;
+    mp_int_t stoppingy = 0;
+    while (stoppingx >= stoppingy) {
+        draw_ellipse_points(self, cx, cy, x, y, col, mask);
+        y += 1;
+        stoppingy += two_asquare;
+        ellipse_error += ychange;
+        ychange += two_asquare;
+        if ((2 * ellipse_error + xchange) > 0) {
+            x -= 1;
+            stoppingx -= two_bsquare;
+            ellipse_error += xchange;
+            xchange += two_bsquare;
+        }
+    }
+    x = 0;
+    y = yr;
+    xchange = yr * yr;
+    ychange = xr * xr * (1 - 2 * yr);
+    ellipse_error = 0;
+    stoppingx = 0;
+    stoppingy = two_asquare * yr;
+    while (stoppingx <= stoppingy) {
+        draw_ellipse_points(self, cx, cy, x, y, col, mask);
+        x += 1;
+        stoppingx += two_bsquare;
+        ellipse_error += xchange;
+        xchange += two_bsquare;
+        if ((2 * ellipse_error + ychange) > 0) {
+            y -= 1;
+            stoppingy -= two_asquare;
+            ellipse_error += ychange;
+            ychange += two_asquare;
+        }
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(framebuf_ellipse_obj, 6, 8, framebuf_ellipse);
+
+#if !MICROPY_ENABLE_DYNRUNTIME
+STATIC mp_obj_t framebuf_poly(size_t n_args, const mp_obj_t *args) {
     mp_obj_framebuf_t *self = MP_OBJ_TO_PTR(args[0]);
-    mp_obj_t source_in = mp_obj_cast_to_native_base(args[1], MP_OBJ_FROM_PTR(&mp_type_framebuf));
-    if (source_in == MP_OBJ_NULL) {
+    mp_int_t x = mp_obj_get_int(args[1]);
+    mp_int_t y = mp_obj_get_int(args[2]);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[3], &bufinfo, MP_BUFFER_READ);
+    // if a slice of the coordinates is given then it must be whole points
+    size_t n_poly = bufinfo.len / (mp_binary_get_size('@', bufinfo.typecode, NULL) * 2);
+    mp_int_t col = mp_obj_get_int(args[4]);
+    bool fill = n_args > 5 && mp_obj_is_true(args[5]);
+
+    if (n_poly == 0) {
+        return mp_const_none;
+    }
+
+    #define POLY_X(i) (x + mp_obj_get_int(mp_binary_get_val_array(bufinfo.typecode, bufinfo.buf, 2 * (i))))
+    #define POLY_Y(i) (y + mp_obj_get_int(mp_binary_get_val_array(bufinfo.typecode, bufinfo.buf, 2 * (i) + 1)))
+
+    if (fill) {
+        mp_int_t y_min = POLY_Y(0);
+        mp_int_t y_max = y_min;
+        for (size_t i = 1; i < n_poly; ++i) {
+            mp_int_t py = POLY_Y(i);
+            y_min = MIN(y_min, py);
+            y_max = MAX(y_max, py);
+        }
+        y_min = MAX(y_min, 0);
+        y_max = MIN(y_max, self->height - 1);
+
+        // Even-odd scanline fill: each row is filled between pairs of
+        // crossings of the polygon's edges, as a span per pair.
+        mp_int_t *nodes = m_new(mp_int_t, n_poly);
+        for (mp_int_t row = y_min; row <= y_max; ++row) {
+            size_t n_nodes = 0;
+            mp_int_t px1 = POLY_X(n_poly - 1);
+            mp_int_t py1 = POLY_Y(n_poly - 1);
+            for (size_t i = 0; i < n_poly; ++i) {
+                mp_int_t px2 = POLY_X(i);
+                mp_int_t py2 = POLY_Y(i);
+                // include the top end of each edge but not the bottom end, so
+                // that a vertex shared by two edges is only counted once
+                if ((py1 <= row && row < py2) || (py2 <= row && row < py1)) {
+                    // round to the nearest pixel
+                    mp_int_t dy = py2 - py1;
+                    mp_int_t num = 2 * (px2 - px1) * (row - py1) + dy;
+                    if (dy < 0) {
+                        num = -num;
+                        dy = -dy;
+                    }
+                    mp_int_t q = num / (2 * dy);
+                    if (num % (2 * dy) < 0) {
+                        --q;
+                    }
+                    // insertion sort as the nodes are generated
+                    size_t j = n_nodes++;
+                    for (; j > 0 && nodes[j - 1] > px1 + q; --j) {
+                        nodes[j] = nodes[j - 1];
+                    }
+                    nodes[j] = px1 + q;
+                }
+                px1 = px2;
+                py1 = py2;
+            }
+            for (size_t i = 0; i + 1 < n_nodes; i += 2) {
+                fill_rect(self, nodes[i], row, nodes[i + 1] - nodes[i] + 1, 1, col);
+            }
+        }
+        m_del(mp_int_t, nodes, n_poly);
+    }
+
+    // Draw the outline, which also covers the bottom edges that the fill
+    // leaves out.
+    mp_int_t px1 = POLY_X(n_poly - 1);
+    mp_int_t py1 = POLY_Y(n_poly - 1);
+    for (size_t i = 0; i < n_poly; ++i) {
+        mp_int_t px2 = POLY_X(i);
+        mp_int_t py2 = POLY_Y(i);
+        line(self, px1, py1, px2, py2, col);
+        px1 = px2;
+        py1 = py2;
+    }
+
+    #undef POLY_X
+    #undef POLY_Y
+
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(framebuf_poly_obj, 5, 6, framebuf_poly);
+#endif
+
+STATIC mp_obj_framebuf_t *framebuf_from_obj(mp_obj_t obj) {
+    mp_obj_t native = mp_obj_cast_to_native_base(obj, MP_OBJ_FROM_PTR(&mp_type_framebuf));
+    if (native == MP_OBJ_NULL) {
         mp_raise_TypeError(NULL);
     }
-    mp_obj_framebuf_t *source = MP_OBJ_TO_PTR(source_in);
+    return MP_OBJ_TO_PTR(native);
+}
+
+#if !MICROPY_ENABLE_DYNRUNTIME
+mp_obj_framebuf_t *mp_framebuf_get(mp_obj_t obj) {
+    mp_obj_framebuf_t *fb = framebuf_from_obj(obj);
+    accel_sync();
+    return fb;
+}
+#endif
+
+// Copy a clipped rectangle between framebuffers of the same format a row at a
+// time, without going through getpixel/setpixel.  Returns false if there is
+// no such fast path for the format.
+STATIC bool blit_same_format(mp_obj_framebuf_t *self, const mp_obj_framebuf_t *source,
+    int x0, int y0, int x1, int y1, int w, int h, mp_int_t key) {
+    #if MICROPY_PY_FRAMEBUF_ACCEL
+    // A copy within one buffer may overlap, which the engine can't handle.
+    unsigned int bpp = accel_bpp(self);
+    if (bpp != 0 && key == -1 && self->buf != source->buf
+        && mp_hal_framebuf_copy((uint8_t *)self->buf + (x0 + y0 * self->stride) * bpp / 8, self->stride,
+            (const uint8_t *)source->buf + (x1 + y1 * source->stride) * bpp / 8, source->stride, w, h, bpp)) {
+        accel_busy = true;
+        return true;
+    }
+    #endif
+    accel_sync();
+    switch (self->format) {
+        case FRAMEBUF_RGB565:
+            for (; h > 0; --h, ++y0, ++y1) {
+                uint16_t *dest = (uint16_t *)self->buf + x0 + y0 * self->stride;
+                const uint16_t *src = (const uint16_t *)source->buf + x1 + y1 * source->stride;
+                if (key == -1) {
+                    memmove(dest, src, w * sizeof(uint16_t));
+                } else {
+                    for (int i = 0; i < w; ++i) {
+                        if (src[i] != (uint32_t)key) {
+                            dest[i] = src[i];
+                        }
+                    }
+                }
+            }
+            return true;
+        case FRAMEBUF_GS8:
+            for (; h > 0; --h, ++y0, ++y1) {
+                uint8_t *dest = (uint8_t *)self->buf + x0 + y0 * self->stride;
+                const uint8_t *src = (const uint8_t *)source->buf + x1 + y1 * source->stride;
+                if (key == -1) {
+                    memmove(dest, src, w);
+                } else {
+                    for (int i = 0; i < w; ++i) {
+                        if (src[i] != (uint32_t)key) {
+                            dest[i] = src[i];
+                        }
+                    }
+                }
+            }
+            return true;
+        default:
+            return false;
+    }
+}
+
+STATIC mp_obj_t framebuf_blit(size_t n_args, const mp_obj_t *args) {
+    mp_obj_framebuf_t *self = MP_OBJ_TO_PTR(args[0]);
+    mp_obj_framebuf_t *source = framebuf_from_obj(args[1]);
 
     mp_int_t x = mp_obj_get_int(args[2]);
     mp_int_t y = mp_obj_get_int(args[3]);
@@ -491,17 +817,74 @@ STATIC mp_obj_t framebuf_blit(size_t n_args, const mp_obj_t *args) {
     if (n_args > 4) {
         key = mp_obj_get_int(args[4]);
     }
+    mp_obj_framebuf_t *palette = NULL;
+    if (n_args > 5 && args[5] != mp_const_none) {
+        palette = framebuf_from_obj(args[5]);
+    }
+    mp_int_t scale = 1;
+    if (n_args > 6) {
+        scale = mp_obj_get_int(args[6]);
+        if (scale < 1) {
+            mp_raise_ValueError(NULL);
+        }
+    }
 
     if (
         (x >= self->width) ||
         (y >= self->height) ||
-        (-x >= source->width) ||
-        (-y >= source->height)
+        (-x >= source->width * scale) ||
+        (-y >= source->height * scale)
         ) {
         // Out of bounds, no-op.
         return mp_const_none;
     }
 
+    // Sources with at most 16 colours are mapped through a lookup table
+    // built once from the palette, rather than reading the palette for
+    // every pixel.
+    uint32_t lut[16];
+    unsigned int lut_len = 0;
+    if (palette != NULL) {
+        switch (source->format) {
+            case FRAMEBUF_MVLSB:
+            case FRAMEBUF_MHLSB:
+            case FRAMEBUF_MHMSB:
+                lut_len = 2;
+                break;
+            case FRAMEBUF_GS2_HMSB:
+                lut_len = 4;
+                break;
+            case FRAMEBUF_GS4_HMSB:
+                lut_len = 16;
+                break;
+        }
+        for (unsigned int i = 0; i < lut_len; ++i) {
+            lut[i] = i < palette->width ? getpixel(palette, i, 0) : i;
+        }
+    }
+
+    if (scale > 1) {
+        // Draw each visible source pixel as a scale x scale block.
+        int sx0 = x < 0 ? -x / scale : 0;
+        int sy0 = y < 0 ? -y / scale : 0;
+        int sxend = MIN(source->width, (self->width - x + scale - 1) / scale);
+        int syend = MIN(source->height, (self->height - y + scale - 1) / scale);
+        for (int sy = sy0; sy < syend; ++sy) {
+            for (int sx = sx0; sx < sxend; ++sx) {
+                uint32_t col = getpixel(source, sx, sy);
+                if (lut_len) {
+                    col = lut[col];
+                } else if (palette != NULL && col < palette->width) {
+                    col = getpixel(palette, col, 0);
+                }
+                if (col != (uint32_t)key) {
+                    fill_rect(self, x + sx * scale, y + sy * scale, scale, scale, col);
+                }
+            }
+        }
+        return mp_const_none;
+    }
+
     // Clip.
     int x0 = MAX(0, x);
     int y0 = MAX(0, y);
@@ -509,13 +892,30 @@ STATIC mp_obj_t framebuf_blit(size_t n_args, const mp_obj_t *args) {
     int y1 = MAX(0, -y);
     int x0end = MIN(self->width, x + source->width);
     int y0end = MIN(self->height, y + source->height);
+    mark_dirty(self, x0, y0, x0end, y0end);
+
+    if (palette == NULL && source->format == self->format
+        && blit_same_format(self, source, x0, y0, x1, y1, x0end - x0, y0end - y0, key)) {
+        return mp_const_none;
+    }
 
+    accel_sync();
     for (; y0 < y0end; ++y0) {
         int cx1 = x1;
+        uint16_t *dest_rgb565 = (uint16_t *)self->buf + y0 * self->stride;
         for (int cx0 = x0; cx0 < x0end; ++cx0) {
             uint32_t col = getpixel(source, cx1, y1);
+            if (lut_len) {
+                col = lut[col];
+            } else if (palette != NULL && col < palette->width) {
+                col = getpixel(palette, col, 0);
+            }
             if (col != (uint32_t)key) {
-                setpixel(self, cx0, y0, col);
+                if (self->format == FRAMEBUF_RGB565) {
+                    dest_rgb565[cx0] = col;
+                } else {
+                    setpixel(self, cx0, y0, col);
+                }
             }
             ++cx1;
         }
@@ -523,7 +923,7 @@ STATIC mp_obj_t framebuf_blit(size_t n_args, const mp_obj_t *args) {
     }
     return mp_const_none;
 }
-STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(framebuf_blit_obj, 4, 5, framebuf_blit);
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(framebuf_blit_obj, 4, 7, framebuf_blit);
 
 STATIC mp_obj_t framebuf_scroll(mp_obj_t self_in, mp_obj_t xstep_in, mp_obj_t ystep_in) {
     mp_obj_framebuf_t *self = MP_OBJ_TO_PTR(self_in);
@@ -553,14 +953,211 @@ STATIC mp_obj_t framebuf_scroll(mp_obj_t self_in, mp_obj_t xstep_in, mp_obj_t ys
             setpixel(self, x, y, getpixel(self, x - xstep, y - ystep));
         }
     }
+    mark_dirty(self, 0, 0, self->width, self->height);
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_3(framebuf_scroll_obj, framebuf_scroll);
 
+#if !MICROPY_ENABLE_DYNRUNTIME
+// A Font wraps a buffer holding a bitmap font, laid out as (little endian):
+//
+//     header:  'F', bpp (1 or 4), height, 0, first code point (u16), number of glyphs (u16)
+//     glyphs:  per glyph, offset of its bitmap from the start of the buffer (u32),
+//              bitmap width (u8), advance (u8)
+//     bitmaps: height rows per glyph, each padded to a whole byte, leftmost
+//              pixel in the most significant bits
+//
+// With 4 bits per pixel each pixel is an alpha value from 0 (transparent) to
+// 15 (opaque), and is blended with what is already in the framebuffer.  The
+// glyphs are drawn straight from the buffer, which can be a bytes object
+// frozen into flash.  See tools/mkfont.py for a converter from BDF fonts.
+
+#define FONT_HEADER_SIZE (8)
+#define FONT_GLYPH_SIZE (6)
+
+typedef struct _mp_obj_framebuf_font_t {
+    mp_obj_base_t base;
+    mp_obj_t data_obj; // keep the buffer alive
+    const uint8_t *data;
+    size_t len;
+    uint8_t bpp;
+    uint8_t height;
+    uint16_t first;
+    uint16_t count;
+} mp_obj_framebuf_font_t;
+
+STATIC const mp_obj_type_t mp_type_framebuf_font;
+
+STATIC mp_obj_t framebuf_font_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 1, 1, false);
+
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[0], &bufinfo, MP_BUFFER_READ);
+    const uint8_t *data = bufinfo.buf;
+    if (bufinfo.len < FONT_HEADER_SIZE || data[0] != 'F' || (data[1] != 1 && data[1] != 4)) {
+        mp_raise_ValueError(MP_ERROR_TEXT("invalid font"));
+    }
+    uint16_t count = data[6] | data[7] << 8;
+    if (bufinfo.len < FONT_HEADER_SIZE + (size_t)count * FONT_GLYPH_SIZE) {
+        mp_raise_ValueError(MP_ERROR_TEXT("invalid font"));
+    }
+
+    mp_obj_framebuf_font_t *o = m_new_obj(mp_obj_framebuf_font_t);
+    o->base.type = type;
+    o->data_obj = args[0];
+    o->data = data;
+    o->len = bufinfo.len;
+    o->bpp = data[1];
+    o->height = data[2];
+    o->first = data[4] | data[5] << 8;
+    o->count = count;
+    return MP_OBJ_FROM_PTR(o);
+}
+
+// Return the table entry of the glyph for the given character, or NULL if
+// the font doesn't have it or the glyph's bitmap is outside the buffer.
+STATIC const uint8_t *font_glyph(const mp_obj_framebuf_font_t *font, unichar chr) {
+    if (chr < font->first || chr - font->first >= font->count) {
+        return NULL;
+    }
+    const uint8_t *glyph = font->data + FONT_HEADER_SIZE + (chr - font->first) * FONT_GLYPH_SIZE;
+    size_t offset = glyph[0] | glyph[1] << 8 | glyph[2] << 16 | (uint32_t)glyph[3] << 24;
+    size_t row_bytes = (glyph[4] * font->bpp + 7) / 8;
+    if (offset > font->len || row_bytes * font->height > font->len - offset) {
+        return NULL;
+    }
+    return glyph;
+}
+
+STATIC const uint8_t *font_glyph_or_default(const mp_obj_framebuf_font_t *font, unichar chr) {
+    const uint8_t *glyph = font_glyph(font, chr);
+    if (glyph == NULL) {
+        glyph = font_glyph(font, '?');
+    }
+    return glyph;
+}
+
+STATIC mp_int_t font_text_width(const mp_obj_framebuf_font_t *font, const byte *str, const byte *top) {
+    mp_int_t w = 0;
+    for (; str < top; str = utf8_next_char(str)) {
+        const uint8_t *glyph = font_glyph_or_default(font, utf8_get_char(str));
+        if (glyph != NULL) {
+            w += glyph[5];
+        }
+    }
+    return w;
+}
+
+STATIC mp_obj_t framebuf_font_size(mp_obj_t self_in, mp_obj_t str_in) {
+    mp_obj_framebuf_font_t *self = MP_OBJ_TO_PTR(self_in);
+    size_t len;
+    const byte *str = (const byte *)mp_obj_str_get_data(str_in, &len);
+    mp_obj_t tuple[2] = {
+        mp_obj_new_int(font_text_width(self, str, str + len)),
+        MP_OBJ_NEW_SMALL_INT(self->height),
+    };
+    return mp_obj_new_tuple(2, tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(framebuf_font_size_obj, framebuf_font_size);
+
+STATIC const mp_rom_map_elem_t framebuf_font_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_size), MP_ROM_PTR(&framebuf_font_size_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(framebuf_font_locals_dict, framebuf_font_locals_dict_table);
+
+STATIC const mp_obj_type_t mp_type_framebuf_font = {
+    { &mp_type_type },
+    .name = MP_QSTR_Font,
+    .make_new = framebuf_font_make_new,
+    .locals_dict = (mp_obj_dict_t *)&framebuf_font_locals_dict,
+};
+
+// Mix col into the pixel at x, y with an alpha of 1 to 14 (out of 15).
+// fg_ramp holds col's channels premultiplied by each alpha.
+STATIC void blend_pixel(mp_obj_framebuf_t *fb, unsigned int x, unsigned int y, uint32_t col,
+    const uint32_t *fg_ramp, unsigned int alpha) {
+    uint32_t bg = getpixel(fb, x, y);
+    unsigned int inv = 15 - alpha;
+    switch (fb->format) {
+        case FRAMEBUF_RGB565: {
+            // fg_ramp packs the red, green and blue sums 10 bits apart
+            uint32_t bg_sum = ((bg >> 11) * inv) << 20 | (((bg >> 5) & 0x3f) * inv) << 10 | (bg & 0x1f) * inv;
+            uint32_t sum = fg_ramp[alpha] + bg_sum;
+            col = ((sum >> 20) / 15) << 11 | (((sum >> 10) & 0x3ff) / 15) << 5 | (sum & 0x3ff) / 15;
+            break;
+        }
+        case FRAMEBUF_GS2_HMSB:
+        case FRAMEBUF_GS4_HMSB:
+        case FRAMEBUF_GS8:
+            col = (fg_ramp[alpha] + bg * inv) / 15;
+            break;
+        default:
+            // monochrome: round the alpha to on or off
+            if (alpha < 8) {
+                return;
+            }
+            break;
+    }
+    setpixel(fb, x, y, col);
+}
+
+STATIC void font_text(mp_obj_framebuf_t *self, const mp_obj_framebuf_font_t *font,
+    const byte *str, const byte *top, mp_int_t x0, mp_int_t y0, uint32_t col) {
+    mark_dirty(self, MAX(0, x0), MAX(0, y0),
+        MIN(self->width, x0 + font_text_width(font, str, top)), MIN(self->height, y0 + font->height));
+
+    // Precompute col times each alpha once per call rather than per pixel.
+    uint32_t fg_ramp[16];
+    if (font->bpp == 4) {
+        for (unsigned int a = 0; a < 16; ++a) {
+            if (self->format == FRAMEBUF_RGB565) {
+                fg_ramp[a] = ((col >> 11) * a) << 20 | (((col >> 5) & 0x3f) * a) << 10 | (col & 0x1f) * a;
+            } else {
+                fg_ramp[a] = col * a;
+            }
+        }
+    }
+
+    for (; str < top; str = utf8_next_char(str)) {
+        const uint8_t *glyph = font_glyph_or_default(font, utf8_get_char(str));
+        if (glyph == NULL) {
+            continue;
+        }
+        unsigned int w = glyph[4];
+        size_t row_bytes = (w * font->bpp + 7) / 8;
+        const uint8_t *bitmap = font->data + (glyph[0] | glyph[1] << 8 | glyph[2] << 16 | (uint32_t)glyph[3] << 24);
+        // clip the glyph to the framebuffer
+        int c0 = MAX(0, -x0);
+        int c1 = MIN((mp_int_t)w, self->width - x0);
+        int r0 = MAX(0, -y0);
+        int r1 = MIN((mp_int_t)font->height, self->height - y0);
+        for (int r = r0; r < r1; ++r) {
+            const uint8_t *row = bitmap + r * row_bytes;
+            for (int c = c0; c < c1; ++c) {
+                if (font->bpp == 1) {
+                    if (row[c >> 3] & (0x80 >> (c & 7))) {
+                        setpixel(self, x0 + c, y0 + r, col);
+                    }
+                } else {
+                    unsigned int alpha = (row[c >> 1] >> ((c & 1) ? 0 : 4)) & 0xf;
+                    if (alpha == 15) {
+                        setpixel(self, x0 + c, y0 + r, col);
+                    } else if (alpha != 0) {
+                        blend_pixel(self, x0 + c, y0 + r, col, fg_ramp, alpha);
+                    }
+                }
+            }
+        }
+        x0 += glyph[5];
+    }
+}
+#endif
+
 STATIC mp_obj_t framebuf_text(size_t n_args, const mp_obj_t *args) {
     // extract arguments
     mp_obj_framebuf_t *self = MP_OBJ_TO_PTR(args[0]);
-    const char *str = mp_obj_str_get_str(args[1]);
+    size_t len;
+    const char *str = mp_obj_str_get_data(args[1], &len);
     mp_int_t x0 = mp_obj_get_int(args[2]);
     mp_int_t y0 = mp_obj_get_int(args[3]);
     mp_int_t col = 1;
@@ -568,6 +1165,20 @@ STATIC mp_obj_t framebuf_text(size_t n_args, const mp_obj_t *args) {
         col = mp_obj_get_int(args[4]);
     }
 
+    #if !MICROPY_ENABLE_DYNRUNTIME
+    if (n_args >= 6 && args[5] != mp_const_none) {
+        if (!mp_obj_is_type(args[5], &mp_type_framebuf_font)) {
+            mp_raise_TypeError(NULL);
+        }
+        font_text(self, MP_OBJ_TO_PTR(args[5]), (const byte *)str, (const byte *)str + len, x0, y0, col);
+        return mp_const_none;
+    }
+    #endif
+
+    // each byte of the string is drawn as one 8x8 character cell
+    mark_dirty(self, MAX(0, x0), MAX(0, y0),
+        MIN(self->width, x0 + 8 * (mp_int_t)len), MIN(self->height, y0 + 8));
+
     // loop over chars
     for (; *str; ++str) {
         // get char and make sure its in range of font
@@ -593,7 +1204,97 @@ STATIC mp_obj_t framebuf_text(size_t n_args, const mp_obj_t *args) {
     }
     return mp_const_none;
 }
-STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(framebuf_text_obj, 4, 5, framebuf_text);
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(framebuf_text_obj, 4, 6, framebuf_text);
+
+STATIC mp_obj_t framebuf_dirty(mp_obj_t self_in) {
+    mp_obj_framebuf_t *self = MP_OBJ_TO_PTR(self_in);
+    if (self->dirty_x0 >= self->dirty_x1) {
+        return mp_const_none;
+    }
+    mp_obj_t tuple[4] = {
+        MP_OBJ_NEW_SMALL_INT(self->dirty_x0),
+        MP_OBJ_NEW_SMALL_INT(self->dirty_y0),
+        MP_OBJ_NEW_SMALL_INT(self->dirty_x1 - self->dirty_x0),
+        MP_OBJ_NEW_SMALL_INT(self->dirty_y1 - self->dirty_y0),
+    };
+    return mp_obj_new_tuple(4, tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(framebuf_dirty_obj, framebuf_dirty);
+
+STATIC mp_obj_t framebuf_clear_dirty(mp_obj_t self_in) {
+    clear_dirty(MP_OBJ_TO_PTR(self_in));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(framebuf_clear_dirty_obj, framebuf_clear_dirty);
+
+STATIC mp_obj_t framebuf_wait(mp_obj_t self_in) {
+    (void)self_in;
+    accel_sync();
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(framebuf_wait_obj, framebuf_wait);
+
+#if !MICROPY_ENABLE_DYNRUNTIME
+// Iterator over the dirty region, yielding for each row a memoryview of the
+// bytes of the buffer that hold the dirty columns.  For MONO_VLSB a row is a
+// page of 8 lines.
+typedef struct _mp_obj_framebuf_rows_it_t {
+    mp_obj_base_t base;
+    mp_fun_1_t iternext;
+    mp_obj_framebuf_t *fb;
+    uint16_t row, row_end;
+    uint16_t x0, x1;
+    uint8_t bpp;
+} mp_obj_framebuf_rows_it_t;
+
+STATIC mp_obj_t framebuf_rows_it_iternext(mp_obj_t self_in) {
+    mp_obj_framebuf_rows_it_t *self = MP_OBJ_TO_PTR(self_in);
+    if (self->row >= self->row_end) {
+        return MP_OBJ_STOP_ITERATION;
+    }
+    accel_sync();
+    size_t base = self->row++ * self->fb->stride;
+    size_t start = ((base + self->x0) * self->bpp) >> 3;
+    size_t end = ((base + self->x1) * self->bpp + 7) >> 3;
+    return mp_obj_new_memoryview('B', end - start, (uint8_t *)self->fb->buf + start);
+}
+
+STATIC mp_obj_t framebuf_dirty_rows(mp_obj_t self_in) {
+    mp_obj_framebuf_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_obj_framebuf_rows_it_t *o = m_new_obj(mp_obj_framebuf_rows_it_t);
+    o->base.type = &mp_type_polymorph_iter;
+    o->iternext = framebuf_rows_it_iternext;
+    o->fb = self;
+    o->row = self->dirty_y0;
+    o->row_end = self->dirty_y1;
+    o->x0 = self->dirty_x0;
+    o->x1 = self->dirty_x1;
+    switch (self->format) {
+        case FRAMEBUF_MVLSB:
+            o->row >>= 3;
+            o->row_end = (o->row_end + 7) >> 3;
+            o->bpp = 8;
+            break;
+        case FRAMEBUF_RGB565:
+            o->bpp = 16;
+            break;
+        case FRAMEBUF_GS2_HMSB:
+            o->bpp = 2;
+            break;
+        case FRAMEBUF_GS4_HMSB:
+            o->bpp = 4;
+            break;
+        case FRAMEBUF_GS8:
+            o->bpp = 8;
+            break;
+        default: // FRAMEBUF_MHLSB, FRAMEBUF_MHMSB
+            o->bpp = 1;
+            break;
+    }
+    return MP_OBJ_FROM_PTR(o);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(framebuf_dirty_rows_obj, framebuf_dirty_rows);
+#endif
 
 #if !MICROPY_ENABLE_DYNRUNTIME
 STATIC const mp_rom_map_elem_t framebuf_locals_dict_table[] = {
@@ -604,9 +1305,15 @@ STATIC const mp_rom_map_elem_t framebuf_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_vline), MP_ROM_PTR(&framebuf_vline_obj) },
     { MP_ROM_QSTR(MP_QSTR_rect), MP_ROM_PTR(&framebuf_rect_obj) },
     { MP_ROM_QSTR(MP_QSTR_line), MP_ROM_PTR(&framebuf_line_obj) },
+    { MP_ROM_QSTR(MP_QSTR_ellipse), MP_ROM_PTR(&framebuf_ellipse_obj) },
+    { MP_ROM_QSTR(MP_QSTR_poly), MP_ROM_PTR(&framebuf_poly_obj) },
     { MP_ROM_QSTR(MP_QSTR_blit), MP_ROM_PTR(&framebuf_blit_obj) },
     { MP_ROM_QSTR(MP_QSTR_scroll), MP_ROM_PTR(&framebuf_scroll_obj) },
     { MP_ROM_QSTR(MP_QSTR_text), MP_ROM_PTR(&framebuf_text_obj) },
+    { MP_ROM_QSTR(MP_QSTR_dirty), MP_ROM_PTR(&framebuf_dirty_obj) },
+    { MP_ROM_QSTR(MP_QSTR_clear_dirty), MP_ROM_PTR(&framebuf_clear_dirty_obj) },
+    { MP_ROM_QSTR(MP_QSTR_dirty_rows), MP_ROM_PTR(&framebuf_dirty_rows_obj) },
+    { MP_ROM_QSTR(MP_QSTR_wait), MP_ROM_PTR(&framebuf_wait_obj) },
 };
 STATIC MP_DEFINE_CONST_DICT(framebuf_locals_dict, framebuf_locals_dict_table);
 
@@ -637,6 +1344,8 @@ STATIC mp_obj_t legacy_framebuffer1(size_t n_args, const mp_obj_t *args) {
         o->stride = o->width;
     }
 
+    clear_dirty(o);
+
     return MP_OBJ_FROM_PTR(o);
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(legacy_framebuffer1_obj, 3, 4, legacy_framebuffer1);
@@ -646,6 +1355,7 @@ STATIC const mp_rom_map_elem_t framebuf_module_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_framebuf) },
     { MP_ROM_QSTR(MP_QSTR_FrameBuffer), MP_ROM_PTR(&mp_type_framebuf) },
     { MP_ROM_QSTR(MP_QSTR_FrameBuffer1), MP_ROM_PTR(&legacy_framebuffer1_obj) },
+    { MP_ROM_QSTR(MP_QSTR_Font), MP_ROM_PTR(&mp_type_framebuf_font) },
     { MP_ROM_QSTR(MP_QSTR_MVLSB), MP_ROM_INT(FRAMEBUF_MVLSB) },
     { MP_ROM_QSTR(MP_QSTR_MONO_VLSB), MP_ROM_INT(FRAMEBUF_MVLSB) },
     { MP_ROM_QSTR(MP_QSTR_RGB565), MP_ROM_INT(FRAMEBUF_RGB565) },
@@ -0,0 +1,62 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef MICROPY_INCLUDED_EXTMOD_MODFRAMEBUF_H
+#define MICROPY_INCLUDED_EXTMOD_MODFRAMEBUF_H
+
+#include "py/obj.h"
+
+typedef struct _mp_obj_framebuf_t {
+    mp_obj_base_t base;
+    mp_obj_t buf_obj; // need to store this to prevent GC from reclaiming buf
+    void *buf;
+    uint16_t width, height, stride;
+    uint8_t format;
+    // bounding box of pixels drawn since the last clear_dirty(), end exclusive
+    uint16_t dirty_x0, dirty_y0, dirty_x1, dirty_y1;
+} mp_obj_framebuf_t;
+
+// constants for formats
+#define FRAMEBUF_MVLSB    (0)
+#define FRAMEBUF_RGB565   (1)
+#define FRAMEBUF_GS2_HMSB (5)
+#define FRAMEBUF_GS4_HMSB (2)
+#define FRAMEBUF_GS8      (6)
+#define FRAMEBUF_MHLSB    (3)
+#define FRAMEBUF_MHMSB    (4)
+
+static inline void mp_framebuf_clear_dirty(mp_obj_framebuf_t *fb) {
+    fb->dirty_x0 = fb->width;
+    fb->dirty_y0 = fb->height;
+    fb->dirty_x1 = 0;
+    fb->dirty_y1 = 0;
+}
+
+// Returns the FrameBuffer of obj (which may be an instance of a subclass), or
+// raises TypeError.  Any hardware operation still drawing into a framebuffer
+// is waited for, so the caller can then read its memory.
+mp_obj_framebuf_t *mp_framebuf_get(mp_obj_t obj);
+
+#endif // MICROPY_INCLUDED_EXTMOD_MODFRAMEBUF_H
@@ -34,8 +34,11 @@
 #include "py/stream.h"
 #include "py/mperrno.h"
 #include "py/mphal.h"
+#include "py/trace.h"
+#include "extmod/misc.h"
 
 #include "lib/netutils/netutils.h"
+#include "extmod/network_ptp.h"
 
 #include "lwip/init.h"
 #include "lwip/tcp.h"
@@ -61,9 +64,17 @@
 // socket, if the connection isn't closed cleanly in that time.
 #define MICROPY_PY_LWIP_TCP_CLOSE_TIMEOUT_MS (10000)
 
+// Number of incoming datagrams that a UDP socket holds before dropping new ones.
+#ifndef MICROPY_PY_LWIP_UDP_QUEUE_LEN
+#define MICROPY_PY_LWIP_UDP_QUEUE_LEN (1)
+#endif
+
 // All socket options should be globally distinct,
 // because we ignore option levels for efficiency.
 #define IP_ADD_MEMBERSHIP 0x400
+#define SO_SNDBUF 0x1001
+#define SO_RCVBUF 0x1002
+#define SO_TIMESTAMPNS 0x1003
 
 // For compatibilily with older lwIP versions.
 #ifndef ip_set_option
@@ -274,6 +285,17 @@ static const int error_lookup_table[] = {
 #define MOD_NETWORK_SOCK_DGRAM (2)
 #define MOD_NETWORK_SOCK_RAW (3)
 
+#if MICROPY_PY_LWIP_UDP_QUEUE_LEN > 1
+typedef struct _lwip_udp_queued_t {
+    struct pbuf *pbuf;
+    byte peer[4];
+    uint16_t peer_port;
+    #if MICROPY_PY_NETWORK_PTP
+    network_ptp_time_t rx_time;
+    #endif
+} lwip_udp_queued_t;
+#endif
+
 typedef struct _lwip_socket_obj_t {
     mp_obj_base_t base;
 
@@ -300,6 +322,27 @@ typedef struct _lwip_socket_obj_t {
     mp_uint_t timeout;
     uint16_t recv_offset;
 
+    // TCP buffer limits set by SO_SNDBUF and SO_RCVBUF, 0 for lwIP's defaults,
+    // and the bytes read for which the window is held back to honour rcvbuf
+    uint16_t sndbuf;
+    uint32_t rcvbuf;
+    uint32_t rcv_held;
+
+    #if MICROPY_PY_LWIP_UDP_QUEUE_LEN > 1
+    // Datagrams that arrived while incoming.pbuf was taken, in order of arrival
+    lwip_udp_queued_t *udp_queue;
+    uint8_t udp_queue_get;
+    volatile uint8_t udp_queue_len;
+    #endif
+
+    #if MICROPY_PY_NETWORK_PTP
+    // With SO_TIMESTAMPNS, the hardware receive times of the datagram in
+    // incoming.pbuf and of the one last read, or zero if not known
+    bool timestamp;
+    network_ptp_time_t rx_time;
+    network_ptp_time_t recv_time;
+    #endif
+
     uint8_t domain;
     uint8_t type;
 
@@ -339,6 +382,14 @@ STATIC void lwip_socket_free_incoming(lwip_socket_obj_t *socket) {
             pbuf_free(socket->incoming.pbuf);
             socket->incoming.pbuf = NULL;
         }
+        #if MICROPY_PY_LWIP_UDP_QUEUE_LEN > 1
+        if (socket->type == MOD_NETWORK_SOCK_DGRAM) {
+            for (; socket->udp_queue_len > 0; --socket->udp_queue_len) {
+                pbuf_free(socket->udp_queue[socket->udp_queue_get].pbuf);
+                socket->udp_queue_get = (socket->udp_queue_get + 1) % (MICROPY_PY_LWIP_UDP_QUEUE_LEN - 1);
+            }
+        }
+        #endif
     } else {
         uint8_t alloc = socket->incoming.connection.alloc;
         struct tcp_pcb *volatile *tcp_array = lwip_socket_incoming_array(socket);
@@ -383,8 +434,26 @@ STATIC u8_t _lwip_raw_incoming(void *arg, struct raw_pcb *pcb, struct pbuf *p, c
 }
 #endif
 
+#if MICROPY_PY_LWIP_UDP_QUEUE_LEN > 1
+// Move the oldest queued datagram, if any, into the receive slot, which must be empty.
+STATIC void lwip_udp_queue_pop(lwip_socket_obj_t *socket) {
+    if (socket->udp_queue_len == 0) {
+        return;
+    }
+    lwip_udp_queued_t *q = &socket->udp_queue[socket->udp_queue_get];
+    socket->peer_port = q->peer_port;
+    memcpy(socket->peer, q->peer, sizeof(socket->peer));
+    #if MICROPY_PY_NETWORK_PTP
+    socket->rx_time = q->rx_time;
+    #endif
+    socket->incoming.pbuf = q->pbuf;
+    socket->udp_queue_get = (socket->udp_queue_get + 1) % (MICROPY_PY_LWIP_UDP_QUEUE_LEN - 1);
+    --socket->udp_queue_len;
+}
+#endif
+
 // Callback for incoming UDP packets. We simply stash the packet and the source address,
-// in case we need it for recvfrom.
+// in case we need it for recvfrom.  Further packets wait in the queue, if there is one.
 #if LWIP_VERSION_MAJOR < 2
 STATIC void _lwip_udp_incoming(void *arg, struct udp_pcb *upcb, struct pbuf *p, ip_addr_t *addr, u16_t port)
 #else
@@ -392,20 +461,45 @@ STATIC void _lwip_udp_incoming(void *arg, struct udp_pcb *upcb, struct pbuf *p,
 #endif
 {
     lwip_socket_obj_t *socket = (lwip_socket_obj_t *)arg;
+    MP_TRACE(MP_TRACE_EVENT_SOCKET, MP_TRACE_SOCKET_RECV);
 
-    if (socket->incoming.pbuf != NULL) {
-        // That's why they call it "unreliable". No room in the inn, drop the packet.
-        pbuf_free(p);
-    } else {
+    #if MICROPY_PY_NETWORK_PTP
+    // The receive time is only known while lwIP processes the frame
+    network_ptp_time_t rx_time = {0, 0};
+    if (socket->timestamp) {
+        network_ptp_hal_rx_timestamp(&rx_time);
+    }
+    #endif
+
+    if (socket->incoming.pbuf == NULL) {
         socket->incoming.pbuf = p;
         socket->peer_port = (mp_uint_t)port;
         memcpy(&socket->peer, addr, sizeof(socket->peer));
+        #if MICROPY_PY_NETWORK_PTP
+        socket->rx_time = rx_time;
+        #endif
+    #if MICROPY_PY_LWIP_UDP_QUEUE_LEN > 1
+    } else if (socket->udp_queue_len < MICROPY_PY_LWIP_UDP_QUEUE_LEN - 1) {
+        size_t i = (socket->udp_queue_get + socket->udp_queue_len) % (MICROPY_PY_LWIP_UDP_QUEUE_LEN - 1);
+        lwip_udp_queued_t *q = &socket->udp_queue[i];
+        q->pbuf = p;
+        q->peer_port = port;
+        memcpy(q->peer, addr, sizeof(q->peer));
+        #if MICROPY_PY_NETWORK_PTP
+        q->rx_time = rx_time;
+        #endif
+        ++socket->udp_queue_len;
+    #endif
+    } else {
+        // That's why they call it "unreliable". No room in the inn, drop the packet.
+        pbuf_free(p);
     }
 }
 
 // Callback for general tcp errors.
 STATIC void _lwip_tcp_error(void *arg, err_t err) {
     lwip_socket_obj_t *socket = (lwip_socket_obj_t *)arg;
+    MP_TRACE(MP_TRACE_EVENT_SOCKET, MP_TRACE_SOCKET_ERROR);
 
     // Free any incoming buffers or connections that are stored
     lwip_socket_free_incoming(socket);
@@ -418,6 +512,7 @@ STATIC void _lwip_tcp_error(void *arg, err_t err) {
 // Callback for tcp connection requests. Error code err is unused. (See tcp.h)
 STATIC err_t _lwip_tcp_connected(void *arg, struct tcp_pcb *tpcb, err_t err) {
     lwip_socket_obj_t *socket = (lwip_socket_obj_t *)arg;
+    MP_TRACE(MP_TRACE_EVENT_SOCKET, MP_TRACE_SOCKET_CONNECTED);
 
     socket->state = STATE_CONNECTED;
     return ERR_OK;
@@ -477,6 +572,7 @@ STATIC err_t _lwip_tcp_accept(void *arg, struct tcp_pcb *newpcb, err_t err) {
     }
 
     lwip_socket_obj_t *socket = (lwip_socket_obj_t *)arg;
+    MP_TRACE(MP_TRACE_EVENT_SOCKET, MP_TRACE_SOCKET_ACCEPT);
     tcp_recv(newpcb, _lwip_tcp_recv_unaccepted);
 
     // Search for an empty slot to store the new connection
@@ -509,6 +605,7 @@ STATIC err_t _lwip_tcp_accept(void *arg, struct tcp_pcb *newpcb, err_t err) {
 // Callback for inbound tcp packets.
 STATIC err_t _lwip_tcp_recv(void *arg, struct tcp_pcb *tcpb, struct pbuf *p, err_t err) {
     lwip_socket_obj_t *socket = (lwip_socket_obj_t *)arg;
+    MP_TRACE(MP_TRACE_EVENT_SOCKET, MP_TRACE_SOCKET_RECV);
 
     if (p == NULL) {
         // Other side has closed connection.
@@ -627,6 +724,16 @@ STATIC mp_uint_t lwip_raw_udp_receive(lwip_socket_obj_t *socket, byte *buf, mp_u
     u16_t result = pbuf_copy_partial(p, buf, ((p->tot_len > len) ? len : p->tot_len), 0);
     pbuf_free(p);
     socket->incoming.pbuf = NULL;
+    #if MICROPY_PY_NETWORK_PTP
+    if (socket->type == MOD_NETWORK_SOCK_DGRAM) {
+        socket->recv_time = socket->rx_time;
+    }
+    #endif
+    #if MICROPY_PY_LWIP_UDP_QUEUE_LEN > 1
+    if (socket->type == MOD_NETWORK_SOCK_DGRAM) {
+        lwip_udp_queue_pop(socket);
+    }
+    #endif
 
     MICROPY_PY_LWIP_EXIT
 
@@ -651,6 +758,40 @@ STATIC mp_uint_t lwip_raw_udp_receive(lwip_socket_obj_t *socket, byte *buf, mp_u
     assert(socket->pcb.tcp);
 
 
+// Space left in the send buffer of a TCP socket, limited by SO_SNDBUF
+STATIC u16_t lwip_tcp_sndbuf(lwip_socket_obj_t *socket) {
+    u16_t available = tcp_sndbuf(socket->pcb.tcp);
+    if (socket->sndbuf != 0) {
+        u16_t queued = TCP_SND_BUF - available;
+        available = queued >= socket->sndbuf ? 0 : MIN(available, socket->sndbuf - queued);
+    }
+    return available;
+}
+
+// Give the window for n bytes that were read back to the peer.  If SO_RCVBUF
+// is set then some is held back, until the window has shrunk to that size.
+// Must be called with the lwIP lock held.
+STATIC void lwip_tcp_recved(lwip_socket_obj_t *socket, mp_uint_t n) {
+    struct tcp_pcb *pcb = socket->pcb.tcp;
+    mp_uint_t held = socket->rcv_held + n;
+    mp_uint_t keep = 0;
+    if (socket->rcvbuf != 0) {
+        // The full window is what lwIP still offers plus all the data it has
+        // received that wasn't given back yet, whether read or not
+        struct pbuf *p = socket->incoming.pbuf;
+        mp_uint_t wnd = pcb->rcv_wnd + held + (p == NULL ? 0 : p->tot_len - socket->recv_offset);
+        if (wnd > socket->rcvbuf) {
+            keep = MIN(held, wnd - socket->rcvbuf);
+        }
+    }
+    socket->rcv_held = keep;
+    for (n = held - keep; n > 0;) {
+        u16_t len = MIN(n, 0xffff);
+        tcp_recved(pcb, len);
+        n -= len;
+    }
+}
+
 // Helper function for send/sendto to handle TCP packets
 STATIC mp_uint_t lwip_tcp_send(lwip_socket_obj_t *socket, const byte *buf, mp_uint_t len, int *_errno) {
     // Check for any pending errors
@@ -658,7 +799,7 @@ STATIC mp_uint_t lwip_tcp_send(lwip_socket_obj_t *socket, const byte *buf, mp_ui
 
     MICROPY_PY_LWIP_ENTER
 
-    u16_t available = tcp_sndbuf(socket->pcb.tcp);
+    u16_t available = lwip_tcp_sndbuf(socket);
 
     if (available == 0) {
         // Non-blocking socket
@@ -675,7 +816,7 @@ STATIC mp_uint_t lwip_tcp_send(lwip_socket_obj_t *socket, const byte *buf, mp_ui
         // If peer fully closed socket, we would have socket->state set to ERR_RST (connection
         // reset) by error callback.
         // Avoid sending too small packets, so wait until at least 16 bytes available
-        while (socket->state >= STATE_CONNECTED && (available = tcp_sndbuf(socket->pcb.tcp)) < 16) {
+        while (socket->state >= STATE_CONNECTED && (available = lwip_tcp_sndbuf(socket)) < 16) {
             MICROPY_PY_LWIP_EXIT
             if (socket->timeout != -1 && mp_hal_ticks_ms() - start > socket->timeout) {
                 *_errno = MP_ETIMEDOUT;
@@ -712,7 +853,7 @@ STATIC mp_uint_t lwip_tcp_send(lwip_socket_obj_t *socket, const byte *buf, mp_ui
     }
 
     // If the output buffer is getting full then send the data to the lower layers
-    if (err == ERR_OK && tcp_sndbuf(socket->pcb.tcp) < TCP_SND_BUF / 4) {
+    if (err == ERR_OK && lwip_tcp_sndbuf(socket) < (socket->sndbuf != 0 ? socket->sndbuf : TCP_SND_BUF) / 4) {
         err = tcp_output(socket->pcb.tcp);
     }
 
@@ -770,32 +911,35 @@ STATIC mp_uint_t lwip_tcp_receive(lwip_socket_obj_t *socket, byte *buf, mp_uint_
 
     assert(socket->pcb.tcp != NULL);
 
-    struct pbuf *p = socket->incoming.pbuf;
-
-    mp_uint_t remaining = p->len - socket->recv_offset;
-    if (len > remaining) {
-        len = remaining;
-    }
-
-    memcpy(buf, (byte *)p->payload + socket->recv_offset, len);
-
-    remaining -= len;
-    if (remaining == 0) {
-        socket->incoming.pbuf = p->next;
-        // If we don't ref here, free() will free the entire chain,
-        // if we ref, it does what we need: frees 1st buf, and decrements
-        // next buf's refcount back to 1.
-        pbuf_ref(p->next);
-        pbuf_free(p);
-        socket->recv_offset = 0;
-    } else {
-        socket->recv_offset += len;
+    // Copy out of as many queued pbufs as needed to fill the buffer, so that a
+    // large read isn't limited to the size of a single segment.
+    mp_uint_t total = 0;
+    struct pbuf *p;
+    while (total < len && (p = socket->incoming.pbuf) != NULL) {
+        mp_uint_t remaining = p->len - socket->recv_offset;
+        mp_uint_t n = MIN(remaining, len - total);
+
+        memcpy(buf + total, (byte *)p->payload + socket->recv_offset, n);
+        total += n;
+
+        remaining -= n;
+        if (remaining == 0) {
+            socket->incoming.pbuf = p->next;
+            // If we don't ref here, free() will free the entire chain,
+            // if we ref, it does what we need: frees 1st buf, and decrements
+            // next buf's refcount back to 1.
+            pbuf_ref(p->next);
+            pbuf_free(p);
+            socket->recv_offset = 0;
+        } else {
+            socket->recv_offset += n;
+        }
     }
-    tcp_recved(socket->pcb.tcp, len);
+    lwip_tcp_recved(socket, total);
 
     MICROPY_PY_LWIP_EXIT
 
-    return len;
+    return total;
 }
 
 /*******************************************************************************/
@@ -817,6 +961,14 @@ STATIC mp_obj_t lwip_socket_make_new(const mp_obj_type_t *type, size_t n_args, s
     socket->base.type = &lwip_socket_type;
     socket->timeout = -1;
     socket->recv_offset = 0;
+    socket->sndbuf = 0;
+    socket->rcvbuf = 0;
+    socket->rcv_held = 0;
+    #if MICROPY_PY_NETWORK_PTP
+    socket->timestamp = false;
+    memset(&socket->rx_time, 0, sizeof(socket->rx_time));
+    memset(&socket->recv_time, 0, sizeof(socket->recv_time));
+    #endif
     socket->domain = MOD_NETWORK_AF_INET;
     socket->type = MOD_NETWORK_SOCK_STREAM;
     socket->callback = MP_OBJ_NULL;
@@ -836,6 +988,11 @@ STATIC mp_obj_t lwip_socket_make_new(const mp_obj_type_t *type, size_t n_args, s
             socket->incoming.connection.tcp.item = NULL;
             break;
         case MOD_NETWORK_SOCK_DGRAM:
+            #if MICROPY_PY_LWIP_UDP_QUEUE_LEN > 1
+            socket->udp_queue = m_new(lwip_udp_queued_t, MICROPY_PY_LWIP_UDP_QUEUE_LEN - 1);
+            socket->udp_queue_get = 0;
+            socket->udp_queue_len = 0;
+            #endif
             socket->pcb.udp = udp_new();
             socket->incoming.pbuf = NULL;
             break;
@@ -1017,6 +1174,9 @@ STATIC mp_obj_t lwip_socket_accept(mp_obj_t self_in) {
     socket2->timeout = socket->timeout;
     socket2->state = STATE_CONNECTED;
     socket2->recv_offset = 0;
+    socket2->sndbuf = socket->sndbuf;
+    socket2->rcvbuf = socket->rcvbuf;
+    socket2->rcv_held = 0;
     socket2->callback = MP_OBJ_NULL;
     tcp_arg(socket2->pcb.tcp, (void *)socket2);
     tcp_err(socket2->pcb.tcp, _lwip_tcp_error);
@@ -1270,6 +1430,128 @@ STATIC mp_obj_t lwip_socket_recvfrom(mp_obj_t self_in, mp_obj_t len_in) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(lwip_socket_recvfrom_obj, lwip_socket_recvfrom);
 
+#if MICROPY_PY_NETWORK_PTP
+// Like recvfrom, but returns (data, ancdata, flags, address) as in CPython,
+// where ancdata has the receive time of the datagram if SO_TIMESTAMPNS is set.
+// The ancbufsize and flags arguments are accepted but not used.
+STATIC mp_obj_t lwip_socket_recvmsg(size_t n_args, const mp_obj_t *args) {
+    lwip_socket_obj_t *socket = MP_OBJ_TO_PTR(args[0]);
+    int _errno;
+
+    lwip_socket_check_connected(socket);
+    if (socket->type != MOD_NETWORK_SOCK_DGRAM) {
+        mp_raise_OSError(MP_EOPNOTSUPP);
+    }
+
+    mp_int_t len = mp_obj_get_int(args[1]);
+    vstr_t vstr;
+    vstr_init_len(&vstr, len);
+    byte ip[4];
+    mp_uint_t port;
+
+    mp_uint_t ret = lwip_raw_udp_receive(socket, (byte *)vstr.buf, len, ip, &port, &_errno);
+    if (ret == -1) {
+        mp_raise_OSError(_errno);
+    }
+
+    mp_obj_t tuple[4];
+    vstr.len = ret;
+    tuple[0] = mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
+    tuple[1] = mp_obj_new_list(0, NULL);
+    if (socket->recv_time.sec != 0 || socket->recv_time.nsec != 0) {
+        // The time is given as two native-endian uint32 of seconds and nanoseconds
+        mp_obj_t anc[3] = {
+            MP_OBJ_NEW_SMALL_INT(1), // SOL_SOCKET
+            MP_OBJ_NEW_SMALL_INT(SO_TIMESTAMPNS),
+            mp_obj_new_bytes((const byte *)&socket->recv_time, sizeof(socket->recv_time)),
+        };
+        mp_obj_list_append(tuple[1], mp_obj_new_tuple(3, anc));
+    }
+    tuple[2] = MP_OBJ_NEW_SMALL_INT(0);
+    tuple[3] = netutils_format_inet_addr(ip, port, NETUTILS_BIG);
+    return mp_obj_new_tuple(4, tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(lwip_socket_recvmsg_obj, 2, 4, lwip_socket_recvmsg);
+#endif
+
+#if MICROPY_PY_USOCKET_BATCH
+STATIC mp_obj_t lwip_socket_sendto_many(mp_obj_t self_in, mp_obj_t bufs_in, mp_obj_t addr_in) {
+    lwip_socket_obj_t *socket = MP_OBJ_TO_PTR(self_in);
+
+    if (socket->type == MOD_NETWORK_SOCK_STREAM) {
+        mp_raise_OSError(MP_EOPNOTSUPP);
+    }
+
+    size_t n;
+    mp_obj_t *bufs;
+    mp_obj_get_array(bufs_in, &n, &bufs);
+
+    // A list gives an address for each datagram, otherwise they all go to the same place
+    mp_obj_t *addrs = NULL;
+    uint8_t ip[NETUTILS_IPV4ADDR_BUFSIZE];
+    mp_uint_t port = 0;
+    if (mp_obj_is_type(addr_in, &mp_type_list)) {
+        mp_obj_get_array_fixed_n(addr_in, n, &addrs);
+    } else {
+        port = netutils_parse_inet_addr(addr_in, ip, NETUTILS_BIG);
+    }
+
+    size_t i = 0;
+    for (; i < n; ++i) {
+        mp_buffer_info_t bufinfo;
+        mp_get_buffer_raise(bufs[i], &bufinfo, MP_BUFFER_READ);
+        if (addrs != NULL) {
+            port = netutils_parse_inet_addr(addrs[i], ip, NETUTILS_BIG);
+        }
+        int _errno;
+        if (lwip_raw_udp_send(socket, bufinfo.buf, bufinfo.len, ip, port, &_errno) == -1) {
+            if (i == 0) {
+                mp_raise_OSError(_errno);
+            }
+            // Report the datagrams that were sent
+            break;
+        }
+    }
+
+    return MP_OBJ_NEW_SMALL_INT(i);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(lwip_socket_sendto_many_obj, lwip_socket_sendto_many);
+
+STATIC mp_obj_t lwip_socket_recvfrom_into_many(size_t n_args, const mp_obj_t *args) {
+    lwip_socket_obj_t *socket = MP_OBJ_TO_PTR(args[0]);
+
+    if (socket->type == MOD_NETWORK_SOCK_STREAM) {
+        mp_raise_OSError(MP_EOPNOTSUPP);
+    }
+
+    size_t n;
+    mp_obj_t *bufs;
+    mp_obj_get_array(args[1], &n, &bufs);
+    mp_obj_t addrs = n_args > 2 ? args[2] : mp_const_none;
+
+    // Wait as usual for the first datagram, then take only those already queued
+    mp_obj_list_t *sizes = MP_OBJ_TO_PTR(mp_obj_new_list(0, NULL));
+    for (size_t i = 0; i < n && (i == 0 || socket->incoming.pbuf != NULL); ++i) {
+        mp_buffer_info_t bufinfo;
+        mp_get_buffer_raise(bufs[i], &bufinfo, MP_BUFFER_WRITE);
+        byte ip[4];
+        mp_uint_t port;
+        int _errno;
+        mp_uint_t ret = lwip_raw_udp_receive(socket, bufinfo.buf, bufinfo.len, ip, &port, &_errno);
+        if (ret == -1) {
+            mp_raise_OSError(_errno);
+        }
+        mp_obj_list_append(MP_OBJ_FROM_PTR(sizes), MP_OBJ_NEW_SMALL_INT(ret));
+        if (addrs != mp_const_none) {
+            mp_obj_subscr(addrs, MP_OBJ_NEW_SMALL_INT(i), netutils_format_inet_addr(ip, port, NETUTILS_BIG));
+        }
+    }
+
+    return MP_OBJ_FROM_PTR(sizes);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(lwip_socket_recvfrom_into_many_obj, 2, 3, lwip_socket_recvfrom_into_many);
+#endif
+
 STATIC mp_obj_t lwip_socket_sendall(mp_obj_t self_in, mp_obj_t buf_in) {
     lwip_socket_obj_t *socket = MP_OBJ_TO_PTR(self_in);
     lwip_socket_check_connected(socket);
@@ -1287,7 +1569,7 @@ STATIC mp_obj_t lwip_socket_sendall(mp_obj_t self_in, mp_obj_t buf_in) {
                 // way to determine how much data, if any, was successfully sent." Then, the
                 // most useful behavior is: check whether we will be able to send all of input
                 // data without EAGAIN, and if won't be, raise it without sending any.
-                if (bufinfo.len > tcp_sndbuf(socket->pcb.tcp)) {
+                if (bufinfo.len > lwip_tcp_sndbuf(socket)) {
                     mp_raise_OSError(MP_EAGAIN);
                 }
             }
@@ -1368,6 +1650,39 @@ STATIC mp_obj_t lwip_socket_setsockopt(size_t n_args, const mp_obj_t *args) {
             break;
         }
 
+        case SO_SNDBUF:
+        case SO_RCVBUF: {
+            // Only TCP sockets have buffers that can be limited, a UDP socket
+            // holds MICROPY_PY_LWIP_UDP_QUEUE_LEN datagrams
+            if (socket->type != MOD_NETWORK_SOCK_STREAM) {
+                break;
+            }
+            // Smaller than a segment would stall the connection
+            mp_int_t val = mp_obj_get_int(args[3]);
+            if (val < TCP_MSS) {
+                val = TCP_MSS;
+            }
+            if (opt == SO_SNDBUF) {
+                socket->sndbuf = val >= TCP_SND_BUF ? 0 : val;
+            } else {
+                socket->rcvbuf = val;
+                MICROPY_PY_LWIP_ENTER
+                if (socket->state == STATE_CONNECTED || socket->state == STATE_PEER_CLOSED) {
+                    // Give back any window that is no longer held back
+                    lwip_tcp_recved(socket, 0);
+                }
+                MICROPY_PY_LWIP_EXIT
+            }
+            break;
+        }
+
+        #if MICROPY_PY_NETWORK_PTP
+        case SO_TIMESTAMPNS: {
+            socket->timestamp = mp_obj_is_true(args[3]);
+            break;
+        }
+        #endif
+
         // level: IPPROTO_IP
         case IP_ADD_MEMBERSHIP: {
             mp_buffer_info_t bufinfo;
@@ -1469,7 +1784,7 @@ STATIC mp_uint_t lwip_socket_ioctl(mp_obj_t self_in, mp_uint_t request, uintptr_
                 // raw socket is writable
                 ret |= MP_STREAM_POLL_WR;
             #endif
-            } else if (socket->pcb.tcp != NULL && tcp_sndbuf(socket->pcb.tcp) > 0) {
+            } else if (socket->pcb.tcp != NULL && lwip_tcp_sndbuf(socket) > 0) {
                 // TCP socket is writable
                 // Note: pcb.tcp==NULL if state<0, and in this case we can't call tcp_sndbuf
                 ret |= MP_STREAM_POLL_WR;
@@ -1559,6 +1874,13 @@ STATIC const mp_rom_map_elem_t lwip_socket_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_recv), MP_ROM_PTR(&lwip_socket_recv_obj) },
     { MP_ROM_QSTR(MP_QSTR_sendto), MP_ROM_PTR(&lwip_socket_sendto_obj) },
     { MP_ROM_QSTR(MP_QSTR_recvfrom), MP_ROM_PTR(&lwip_socket_recvfrom_obj) },
+    #if MICROPY_PY_NETWORK_PTP
+    { MP_ROM_QSTR(MP_QSTR_recvmsg), MP_ROM_PTR(&lwip_socket_recvmsg_obj) },
+    #endif
+    #if MICROPY_PY_USOCKET_BATCH
+    { MP_ROM_QSTR(MP_QSTR_sendto_many), MP_ROM_PTR(&lwip_socket_sendto_many_obj) },
+    { MP_ROM_QSTR(MP_QSTR_recvfrom_into_many), MP_ROM_PTR(&lwip_socket_recvfrom_into_many_obj) },
+    #endif
     { MP_ROM_QSTR(MP_QSTR_sendall), MP_ROM_PTR(&lwip_socket_sendall_obj) },
     { MP_ROM_QSTR(MP_QSTR_settimeout), MP_ROM_PTR(&lwip_socket_settimeout_obj) },
     { MP_ROM_QSTR(MP_QSTR_setblocking), MP_ROM_PTR(&lwip_socket_setblocking_obj) },
@@ -1568,6 +1890,9 @@ STATIC const mp_rom_map_elem_t lwip_socket_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_read), MP_ROM_PTR(&mp_stream_read_obj) },
     { MP_ROM_QSTR(MP_QSTR_readinto), MP_ROM_PTR(&mp_stream_readinto_obj) },
     { MP_ROM_QSTR(MP_QSTR_readline), MP_ROM_PTR(&mp_stream_unbuffered_readline_obj) },
+#if MICROPY_STREAMS_READLINE_INTO
+    { MP_ROM_QSTR(MP_QSTR_readline_into), MP_ROM_PTR(&mp_stream_unbuffered_readline_into_obj) },
+#endif
     { MP_ROM_QSTR(MP_QSTR_write), MP_ROM_PTR(&mp_stream_write_obj) },
 };
 STATIC MP_DEFINE_CONST_DICT(lwip_socket_locals_dict, lwip_socket_locals_dict_table);
@@ -1692,24 +2017,39 @@ STATIC mp_obj_t lwip_getaddrinfo(size_t n_args, const mp_obj_t *args) {
     getaddrinfo_state_t state;
     state.status = 0;
 
+    #if MICROPY_PY_USOCKET_DNS_CACHE
+    if (netutils_dns_cache_lookup(host, (uint8_t *)&state.ipaddr)) {
+        state.status = 1;
+        goto resolved;
+    }
+    #endif
+
     MICROPY_PY_LWIP_ENTER
     err_t ret = dns_gethostbyname(host, (ip_addr_t *)&state.ipaddr, lwip_getaddrinfo_cb, &state);
     MICROPY_PY_LWIP_EXIT
 
     switch (ret) {
         case ERR_OK:
-            // cached
+            // cached, or an address literal
             state.status = 1;
             break;
         case ERR_INPROGRESS:
             while (state.status == 0) {
                 poll_sockets();
             }
+            #if MICROPY_PY_USOCKET_DNS_CACHE
+            if (state.status > 0) {
+                netutils_dns_cache_add(host, (uint8_t *)&state.ipaddr);
+            }
+            #endif
             break;
         default:
             state.status = ret;
     }
 
+    #if MICROPY_PY_USOCKET_DNS_CACHE
+resolved:
+    #endif
     if (state.status < 0) {
         // TODO: CPython raises gaierror, we raise with native lwIP negative error
         // values, to differentiate from normal errno's at least in such way.
@@ -1742,6 +2082,13 @@ STATIC const mp_rom_map_elem_t mp_module_lwip_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_callback), MP_ROM_PTR(&mod_lwip_callback_obj) },
     { MP_ROM_QSTR(MP_QSTR_getaddrinfo), MP_ROM_PTR(&lwip_getaddrinfo_obj) },
     { MP_ROM_QSTR(MP_QSTR_print_pcbs), MP_ROM_PTR(&lwip_print_pcbs_obj) },
+    #if MICROPY_PY_USOCKET_POOL
+    { MP_ROM_QSTR(MP_QSTR_Pool), MP_ROM_PTR(&mp_type_usocket_pool) },
+    #endif
+    #if MICROPY_PY_USOCKET_DNS_CACHE
+    { MP_ROM_QSTR(MP_QSTR_dns_cache_info), MP_ROM_PTR(&netutils_dns_cache_info_obj) },
+    { MP_ROM_QSTR(MP_QSTR_dns_cache_flush), MP_ROM_PTR(&netutils_dns_cache_flush_obj) },
+    #endif
     // objects
     { MP_ROM_QSTR(MP_QSTR_socket), MP_ROM_PTR(&lwip_socket_type) },
     #ifdef MICROPY_PY_LWIP_SLIP
@@ -1759,6 +2106,11 @@ STATIC const mp_rom_map_elem_t mp_module_lwip_globals_table[] = {
 
     { MP_ROM_QSTR(MP_QSTR_SOL_SOCKET), MP_ROM_INT(1) },
     { MP_ROM_QSTR(MP_QSTR_SO_REUSEADDR), MP_ROM_INT(SOF_REUSEADDR) },
+    { MP_ROM_QSTR(MP_QSTR_SO_SNDBUF), MP_ROM_INT(SO_SNDBUF) },
+    { MP_ROM_QSTR(MP_QSTR_SO_RCVBUF), MP_ROM_INT(SO_RCVBUF) },
+    #if MICROPY_PY_NETWORK_PTP
+    { MP_ROM_QSTR(MP_QSTR_SO_TIMESTAMPNS), MP_ROM_INT(SO_TIMESTAMPNS) },
+    #endif
 
     { MP_ROM_QSTR(MP_QSTR_IPPROTO_IP), MP_ROM_INT(0) },
     { MP_ROM_QSTR(MP_QSTR_IP_ADD_MEMBERSHIP), MP_ROM_INT(IP_ADD_MEMBERSHIP) },
@@ -0,0 +1,624 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "py/runtime.h"
+#include "py/mperrno.h"
+#include "py/mphal.h"
+#include "py/ringbuf.h"
+#include "py/stream.h"
+#include "extmod/machine_spi.h"
+
+#if MICROPY_PY_NRF24L01
+
+// _nrf24l01 module: a driver for nRF24L01+ radios that does the packet
+// handling of drivers/nrf24l01/nrf24l01.py in C.
+//
+// All work with the chip is done by service(), which is the handler of the
+// radio's IRQ pin when one is given, and is otherwise called when polling.
+// It moves received packets from the chip's RX FIFO into a ring buffer, and
+// keeps the chip's TX FIFO filled from a second ring buffer, holding CE high
+// so that queued packets go out back to back, each auto-acknowledged.  Both
+// ring buffers hold packets as <len><data:len>.  The radio is in PTX mode
+// while there is something to send, and returns to PRX when listening.
+
+#define NRF_MAX_PAYLOAD (32)
+
+// registers
+#define CONFIG (0x00)
+#define EN_AA (0x01)
+#define EN_RXADDR (0x02)
+#define SETUP_AW (0x03)
+#define SETUP_RETR (0x04)
+#define RF_CH (0x05)
+#define RF_SETUP (0x06)
+#define STATUS (0x07)
+#define RX_ADDR_P0 (0x0a)
+#define TX_ADDR (0x10)
+#define RX_PW_P0 (0x11)
+#define FIFO_STATUS (0x17)
+#define DYNPD (0x1c)
+#define FEATURE (0x1d)
+
+// CONFIG register
+#define EN_CRC (0x08)
+#define CRCO (0x04)
+#define PWR_UP (0x02)
+#define PRIM_RX (0x01)
+
+// RF_SETUP register
+#define POWER_3 (0x06)
+#define SPEED_1M (0x00)
+#define SPEED_2M (0x08)
+#define SPEED_250K (0x20)
+
+// STATUS register
+#define RX_DR (0x40)
+#define TX_DS (0x20)
+#define MAX_RT (0x10)
+
+// FIFO_STATUS register
+#define RX_EMPTY (0x01)
+#define TX_EMPTY (0x10)
+#define TX_FULL (0x20)
+
+// FEATURE register
+#define EN_DPL (0x04)
+
+// instructions
+#define W_REGISTER (0x20)
+#define R_RX_PL_WID (0x60)
+#define R_RX_PAYLOAD (0x61)
+#define W_TX_PAYLOAD (0xa0)
+#define FLUSH_TX (0xe1)
+#define FLUSH_RX (0xe2)
+#define NOP (0xff)
+
+#define NRF_TIMEOUT_MS (500)
+
+typedef struct _nrf24l01_obj_t {
+    mp_obj_base_t base;
+    mp_obj_t spi;
+    mp_obj_t irq;
+    mp_hal_pin_obj_t cs;
+    mp_hal_pin_obj_t ce;
+    ringbuf_t rx;
+    ringbuf_t tx;
+    uint8_t payload_size; // 0 for dynamic payloads
+    uint8_t config;
+    bool listening;
+    bool transmitting;
+    bool busy;
+    bool has_pipe0;
+    uint8_t pipe0_addr[5];
+    uint8_t tx_addr[5];
+    uint32_t tx_packets;
+    uint32_t tx_failures;
+    uint32_t rx_packets;
+    uint32_t rx_dropped;
+} nrf24l01_obj_t;
+
+// Does one SPI transaction, in place: buf[0] is the instruction and the
+// STATUS register is read back into it.
+STATIC void nrf_transfer(nrf24l01_obj_t *self, uint8_t *buf, size_t len) {
+    mp_hal_pin_write(self->cs, 0);
+    const mp_obj_type_t *type = mp_obj_get_type(self->spi);
+    if (type->protocol != NULL) {
+        ((mp_machine_spi_p_t *)type->protocol)->transfer(MP_OBJ_TO_PTR(self->spi), len, buf, buf);
+    } else {
+        // an SPI bus written in Python
+        mp_obj_t dest[4];
+        mp_load_method(self->spi, MP_QSTR_write_readinto, dest);
+        dest[2] = dest[3] = mp_obj_new_bytearray_by_ref(len, buf);
+        mp_call_method_n_kw(2, 0, dest);
+    }
+    mp_hal_pin_write(self->cs, 1);
+}
+
+STATIC uint8_t nrf_cmd(nrf24l01_obj_t *self, uint8_t cmd) {
+    nrf_transfer(self, &cmd, 1);
+    return cmd;
+}
+
+STATIC uint8_t nrf_reg_read(nrf24l01_obj_t *self, uint8_t reg) {
+    uint8_t buf[2] = {reg, NOP};
+    nrf_transfer(self, buf, 2);
+    return buf[1];
+}
+
+STATIC void nrf_reg_write(nrf24l01_obj_t *self, uint8_t reg, uint8_t value) {
+    uint8_t buf[2] = {W_REGISTER | reg, value};
+    nrf_transfer(self, buf, 2);
+}
+
+STATIC void nrf_reg_write_addr(nrf24l01_obj_t *self, uint8_t reg, const uint8_t *addr) {
+    uint8_t buf[6] = {W_REGISTER | reg};
+    memcpy(buf + 1, addr, 5);
+    nrf_transfer(self, buf, 6);
+}
+
+STATIC void nrf_enter_rx(nrf24l01_obj_t *self) {
+    mp_hal_pin_write(self->ce, 0);
+    nrf_reg_write(self, CONFIG, self->config | PWR_UP | PRIM_RX);
+    if (self->has_pipe0) {
+        nrf_reg_write_addr(self, RX_ADDR_P0, self->pipe0_addr);
+    }
+    mp_hal_pin_write(self->ce, 1);
+}
+
+STATIC void nrf_enter_tx(nrf24l01_obj_t *self) {
+    mp_hal_pin_write(self->ce, 0);
+    nrf_reg_write(self, CONFIG, self->config | PWR_UP);
+    if (self->has_pipe0) {
+        // pipe 0 receives the acknowledgements
+        nrf_reg_write_addr(self, RX_ADDR_P0, self->tx_addr);
+    }
+    self->transmitting = true;
+}
+
+STATIC void nrf_read_payload(nrf24l01_obj_t *self) {
+    uint8_t buf[1 + NRF_MAX_PAYLOAD];
+    size_t len = self->payload_size;
+    if (len == 0) {
+        buf[0] = R_RX_PL_WID;
+        buf[1] = NOP;
+        nrf_transfer(self, buf, 2);
+        len = buf[1];
+        if (len > NRF_MAX_PAYLOAD) {
+            // a corrupt packet, which the datasheet says to flush
+            nrf_cmd(self, FLUSH_RX);
+            ++self->rx_dropped;
+            return;
+        }
+    }
+    buf[0] = R_RX_PAYLOAD;
+    memset(buf + 1, NOP, len);
+    nrf_transfer(self, buf, 1 + len);
+    if (ringbuf_free(&self->rx) < 1 + len) {
+        ++self->rx_dropped;
+        return;
+    }
+    ringbuf_put(&self->rx, len);
+    for (size_t i = 0; i < len; ++i) {
+        ringbuf_put(&self->rx, buf[1 + i]);
+    }
+    ++self->rx_packets;
+}
+
+STATIC void nrf_write_payload(nrf24l01_obj_t *self) {
+    uint8_t buf[1 + NRF_MAX_PAYLOAD];
+    size_t len = ringbuf_get(&self->tx);
+    for (size_t i = 0; i < len; ++i) {
+        buf[1 + i] = ringbuf_get(&self->tx);
+    }
+    if (self->payload_size) {
+        // pad out to the fixed payload size
+        memset(buf + 1 + len, 0, self->payload_size - len);
+        len = self->payload_size;
+    }
+    buf[0] = W_TX_PAYLOAD;
+    nrf_transfer(self, buf, 1 + len);
+    ++self->tx_packets;
+}
+
+STATIC void nrf_service(nrf24l01_obj_t *self) {
+    // Flags are cleared before their events are handled, so that an event
+    // that comes in meanwhile sets its flag again and pulls IRQ low.
+    uint8_t status = nrf_cmd(self, NOP) & (RX_DR | TX_DS | MAX_RT);
+    if (status & MAX_RT) {
+        // The packet at the head of the TX FIFO was not acknowledged.  The
+        // FIFO is flushed, which also drops any packets loaded behind it.
+        ++self->tx_failures;
+        nrf_cmd(self, FLUSH_TX);
+    }
+    if (status) {
+        nrf_reg_write(self, STATUS, status);
+    }
+
+    uint8_t fifo = nrf_reg_read(self, FIFO_STATUS);
+    while (!(fifo & RX_EMPTY)) {
+        nrf_read_payload(self);
+        fifo = nrf_reg_read(self, FIFO_STATUS);
+    }
+
+    if (ringbuf_avail(&self->tx)) {
+        if (!self->transmitting) {
+            nrf_enter_tx(self);
+        }
+        while (!(fifo & TX_FULL) && ringbuf_avail(&self->tx)) {
+            nrf_write_payload(self);
+            fifo = nrf_reg_read(self, FIFO_STATUS);
+        }
+        mp_hal_pin_write(self->ce, 1);
+    } else if (self->transmitting && (fifo & TX_EMPTY)) {
+        self->transmitting = false;
+        if (self->listening) {
+            nrf_enter_rx(self);
+        } else {
+            mp_hal_pin_write(self->ce, 0);
+        }
+    }
+}
+
+// Runs nrf_service(), unless it is already running further up the stack,
+// which can happen if the IRQ handler is scheduled during an SPI transfer.
+STATIC void nrf_service_guarded(nrf24l01_obj_t *self) {
+    if (self->busy) {
+        return;
+    }
+    self->busy = true;
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        nrf_service(self);
+        nlr_pop();
+        self->busy = false;
+    } else {
+        self->busy = false;
+        nlr_jump(nlr.ret_val);
+    }
+}
+
+// Waits for cond(self) to become true, servicing the chip if there is no
+// IRQ.  Returns false on a timeout; a negative timeout waits forever.
+STATIC bool nrf_wait(nrf24l01_obj_t *self, bool (*cond)(nrf24l01_obj_t *), mp_int_t timeout_ms) {
+    mp_uint_t start = mp_hal_ticks_ms();
+    for (;;) {
+        if (self->irq == mp_const_none) {
+            nrf_service_guarded(self);
+        }
+        if (cond(self)) {
+            return true;
+        }
+        if (timeout_ms >= 0 && mp_hal_ticks_ms() - start >= (mp_uint_t)timeout_ms) {
+            return false;
+        }
+        MICROPY_EVENT_POLL_HOOK
+    }
+}
+
+STATIC bool nrf_tx_has_room(nrf24l01_obj_t *self) {
+    return ringbuf_free(&self->tx) >= 1 + NRF_MAX_PAYLOAD;
+}
+
+STATIC bool nrf_tx_idle(nrf24l01_obj_t *self) {
+    return !self->transmitting;
+}
+
+STATIC bool nrf_rx_any(nrf24l01_obj_t *self) {
+    return ringbuf_avail(&self->rx) > 0;
+}
+
+// pin.init(pin.OUT, value=value)
+STATIC void nrf_pin_init(mp_obj_t pin, int value) {
+    mp_obj_t dest[5];
+    mp_load_method(pin, MP_QSTR_init, dest);
+    dest[2] = mp_load_attr(pin, MP_QSTR_OUT);
+    dest[3] = MP_OBJ_NEW_QSTR(MP_QSTR_value);
+    dest[4] = MP_OBJ_NEW_SMALL_INT(value);
+    mp_call_method_n_kw(1, 1, dest);
+}
+
+STATIC mp_obj_t nrf24l01_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *all_args) {
+    enum { ARG_spi, ARG_cs, ARG_ce, ARG_irq, ARG_channel, ARG_payload_size, ARG_speed, ARG_rxbuf, ARG_txbuf };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_spi, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_cs, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_ce, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_irq, MP_ARG_OBJ, {.u_obj = mp_const_none} },
+        { MP_QSTR_channel, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 46} },
+        { MP_QSTR_payload_size, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 16} },
+        { MP_QSTR_speed, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = SPEED_250K} },
+        { MP_QSTR_rxbuf, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 16 * (1 + NRF_MAX_PAYLOAD)} },
+        { MP_QSTR_txbuf, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 8 * (1 + NRF_MAX_PAYLOAD)} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all_kw_array(n_args, n_kw, all_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    mp_int_t payload_size = args[ARG_payload_size].u_int;
+    mp_int_t speed = args[ARG_speed].u_int;
+    if (payload_size < 0 || payload_size > NRF_MAX_PAYLOAD
+        || (speed != SPEED_1M && speed != SPEED_2M && speed != SPEED_250K)) {
+        mp_raise_ValueError(NULL);
+    }
+    // each buffer must hold at least one packet of the largest size
+    mp_int_t rxbuf = MAX(args[ARG_rxbuf].u_int, 1 + NRF_MAX_PAYLOAD) + 1;
+    mp_int_t txbuf = MAX(args[ARG_txbuf].u_int, 1 + NRF_MAX_PAYLOAD) + 1;
+
+    nrf24l01_obj_t *self = m_new_obj(nrf24l01_obj_t);
+    memset(self, 0, sizeof(*self));
+    self->base.type = type;
+    self->spi = args[ARG_spi].u_obj;
+    self->cs = mp_hal_get_pin_obj(args[ARG_cs].u_obj);
+    self->ce = mp_hal_get_pin_obj(args[ARG_ce].u_obj);
+    self->irq = mp_const_none;
+    self->payload_size = payload_size;
+    self->config = EN_CRC | CRCO;
+    ringbuf_alloc(&self->rx, rxbuf);
+    ringbuf_alloc(&self->tx, txbuf);
+
+    nrf_pin_init(args[ARG_ce].u_obj, 0);
+    nrf_pin_init(args[ARG_cs].u_obj, 1);
+    mp_hal_delay_ms(5);
+
+    // set address width to 5 bytes and check for device present
+    nrf_reg_write(self, SETUP_AW, 0x03);
+    if (nrf_reg_read(self, SETUP_AW) != 0x03) {
+        mp_raise_OSError(MP_ENODEV);
+    }
+
+    nrf_reg_write(self, EN_AA, 0x3f);
+    nrf_reg_write(self, DYNPD, payload_size ? 0 : 0x3f);
+    nrf_reg_write(self, FEATURE, payload_size ? 0 : EN_DPL);
+    // Retry up to 8 times.  The retransmit delay must cover the ACK, which
+    // takes longer at 250kbps: 1750us is enough there and 500us at the
+    // higher rates, where a longer delay would waste most of the air time.
+    nrf_reg_write(self, SETUP_RETR, (speed == SPEED_250K ? 6 << 4 : 1 << 4) | 8);
+    nrf_reg_write(self, RF_SETUP, POWER_3 | speed);
+    nrf_reg_write(self, RF_CH, MIN(args[ARG_channel].u_int, 125));
+    nrf_reg_write(self, STATUS, RX_DR | TX_DS | MAX_RT);
+    nrf_cmd(self, FLUSH_RX);
+    nrf_cmd(self, FLUSH_TX);
+
+    // power up into standby, which takes 1.5ms
+    nrf_reg_write(self, CONFIG, self->config | PWR_UP);
+    mp_hal_delay_ms(2);
+
+    if (args[ARG_irq].u_obj != mp_const_none) {
+        // irq.irq(handler=self.service, trigger=irq.IRQ_FALLING)
+        mp_obj_t irq = args[ARG_irq].u_obj;
+        mp_obj_t dest[6];
+        mp_load_method(irq, MP_QSTR_irq, dest);
+        dest[2] = MP_OBJ_NEW_QSTR(MP_QSTR_handler);
+        dest[3] = mp_load_attr(MP_OBJ_FROM_PTR(self), MP_QSTR_service);
+        dest[4] = MP_OBJ_NEW_QSTR(MP_QSTR_trigger);
+        dest[5] = mp_load_attr(irq, MP_QSTR_IRQ_FALLING);
+        mp_call_method_n_kw(0, 2, dest);
+        self->irq = irq;
+    }
+    return MP_OBJ_FROM_PTR(self);
+}
+
+STATIC mp_obj_t nrf24l01_deinit(mp_obj_t self_in) {
+    nrf24l01_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (self->irq != mp_const_none) {
+        mp_obj_t dest[4];
+        mp_load_method(self->irq, MP_QSTR_irq, dest);
+        dest[2] = MP_OBJ_NEW_QSTR(MP_QSTR_handler);
+        dest[3] = mp_const_none;
+        mp_call_method_n_kw(0, 1, dest);
+        self->irq = mp_const_none;
+    }
+    mp_hal_pin_write(self->ce, 0);
+    nrf_reg_write(self, CONFIG, self->config);
+    self->listening = false;
+    self->transmitting = false;
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(nrf24l01_deinit_obj, nrf24l01_deinit);
+
+STATIC const uint8_t *nrf_get_addr(mp_obj_t addr_in) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(addr_in, &bufinfo, MP_BUFFER_READ);
+    if (bufinfo.len != 5) {
+        mp_raise_ValueError(MP_ERROR_TEXT("address must be 5 bytes"));
+    }
+    return bufinfo.buf;
+}
+
+STATIC mp_obj_t nrf24l01_open_tx_pipe(mp_obj_t self_in, mp_obj_t addr_in) {
+    nrf24l01_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    memcpy(self->tx_addr, nrf_get_addr(addr_in), 5);
+    nrf_reg_write_addr(self, RX_ADDR_P0, self->tx_addr);
+    nrf_reg_write_addr(self, TX_ADDR, self->tx_addr);
+    nrf_reg_write(self, RX_PW_P0, self->payload_size);
+    nrf_reg_write(self, EN_RXADDR, nrf_reg_read(self, EN_RXADDR) | 1);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(nrf24l01_open_tx_pipe_obj, nrf24l01_open_tx_pipe);
+
+// Pipes 0 and 1 have a 5 byte address.  Pipes 2-5 share the 4 most
+// significant bytes of the address of pipe 1, and take only the first byte.
+STATIC mp_obj_t nrf24l01_open_rx_pipe(mp_obj_t self_in, mp_obj_t pipe_in, mp_obj_t addr_in) {
+    nrf24l01_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_int_t pipe = mp_obj_get_int(pipe_in);
+    const uint8_t *addr = nrf_get_addr(addr_in);
+    if (pipe < 0 || pipe > 5) {
+        mp_raise_ValueError(MP_ERROR_TEXT("invalid pipe"));
+    }
+    if (pipe == 0) {
+        memcpy(self->pipe0_addr, addr, 5);
+        self->has_pipe0 = true;
+    }
+    if (pipe < 2) {
+        nrf_reg_write_addr(self, RX_ADDR_P0 + pipe, addr);
+    } else {
+        nrf_reg_write(self, RX_ADDR_P0 + pipe, addr[0]);
+    }
+    nrf_reg_write(self, RX_PW_P0 + pipe, self->payload_size);
+    nrf_reg_write(self, EN_RXADDR, nrf_reg_read(self, EN_RXADDR) | 1 << pipe);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(nrf24l01_open_rx_pipe_obj, nrf24l01_open_rx_pipe);
+
+STATIC mp_obj_t nrf24l01_start_listening(mp_obj_t self_in) {
+    nrf24l01_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    self->listening = true;
+    if (!self->transmitting) {
+        nrf_enter_rx(self);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(nrf24l01_start_listening_obj, nrf24l01_start_listening);
+
+STATIC mp_obj_t nrf24l01_stop_listening(mp_obj_t self_in) {
+    nrf24l01_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    self->listening = false;
+    if (!self->transmitting) {
+        mp_hal_pin_write(self->ce, 0);
+        nrf_reg_write(self, CONFIG, self->config | PWR_UP);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(nrf24l01_stop_listening_obj, nrf24l01_stop_listening);
+
+STATIC mp_obj_t nrf24l01_service(size_t n_args, const mp_obj_t *args) {
+    // args[1] is the pin, when called as the IRQ handler
+    nrf_service_guarded(MP_OBJ_TO_PTR(args[0]));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(nrf24l01_service_obj, 1, 2, nrf24l01_service);
+
+// send(buf, sync=True)
+// Queues a packet, waiting for room if the queue is full.  With sync, waits
+// until the queue is sent and returns whether every packet was acknowledged.
+STATIC mp_obj_t nrf24l01_send(size_t n_args, const mp_obj_t *args) {
+    nrf24l01_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+    bool sync = n_args < 3 || mp_obj_is_true(args[2]);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[1], &bufinfo, MP_BUFFER_READ);
+    if (bufinfo.len > (self->payload_size ? self->payload_size : NRF_MAX_PAYLOAD)) {
+        mp_raise_ValueError(MP_ERROR_TEXT("packet too long"));
+    }
+    if (!nrf_wait(self, nrf_tx_has_room, NRF_TIMEOUT_MS)) {
+        mp_raise_OSError(MP_ETIMEDOUT);
+    }
+    uint32_t failures = self->tx_failures;
+    ringbuf_put(&self->tx, bufinfo.len);
+    for (size_t i = 0; i < bufinfo.len; ++i) {
+        ringbuf_put(&self->tx, ((uint8_t *)bufinfo.buf)[i]);
+    }
+    // start sending, if this is not the IRQ handler's job
+    nrf_service_guarded(self);
+    if (!sync) {
+        return mp_const_true;
+    }
+    if (!nrf_wait(self, nrf_tx_idle, NRF_TIMEOUT_MS)) {
+        mp_raise_OSError(MP_ETIMEDOUT);
+    }
+    return mp_obj_new_bool(self->tx_failures == failures);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(nrf24l01_send_obj, 2, 3, nrf24l01_send);
+
+// recv(timeout_ms=0)
+// Returns the next received packet, or None if there is none within the
+// timeout.  A negative timeout waits forever.
+STATIC mp_obj_t nrf24l01_recv(size_t n_args, const mp_obj_t *args) {
+    nrf24l01_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+    mp_int_t timeout_ms = n_args > 1 ? mp_obj_get_int(args[1]) : 0;
+    if (!nrf_wait(self, nrf_rx_any, timeout_ms)) {
+        return mp_const_none;
+    }
+    size_t len = ringbuf_get(&self->rx);
+    uint8_t buf[NRF_MAX_PAYLOAD];
+    for (size_t i = 0; i < len; ++i) {
+        buf[i] = ringbuf_get(&self->rx);
+    }
+    return mp_obj_new_bytes(buf, len);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(nrf24l01_recv_obj, 1, 2, nrf24l01_recv);
+
+STATIC mp_obj_t nrf24l01_any(mp_obj_t self_in) {
+    nrf24l01_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (self->irq == mp_const_none) {
+        nrf_service_guarded(self);
+    }
+    return mp_obj_new_bool(nrf_rx_any(self));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(nrf24l01_any_obj, nrf24l01_any);
+
+STATIC mp_obj_t nrf24l01_stats(mp_obj_t self_in) {
+    nrf24l01_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_obj_t items[] = {
+        mp_obj_new_int_from_uint(self->tx_packets),
+        mp_obj_new_int_from_uint(self->tx_failures),
+        mp_obj_new_int_from_uint(self->rx_packets),
+        mp_obj_new_int_from_uint(self->rx_dropped),
+    };
+    return mp_obj_new_tuple(MP_ARRAY_SIZE(items), items);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(nrf24l01_stats_obj, nrf24l01_stats);
+
+STATIC mp_uint_t nrf24l01_ioctl(mp_obj_t self_in, mp_uint_t request, uintptr_t arg, int *errcode) {
+    nrf24l01_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (request == MP_STREAM_POLL) {
+        if (self->irq == mp_const_none) {
+            nrf_service_guarded(self);
+        }
+        mp_uint_t ret = 0;
+        if ((arg & MP_STREAM_POLL_RD) && nrf_rx_any(self)) {
+            ret |= MP_STREAM_POLL_RD;
+        }
+        if ((arg & MP_STREAM_POLL_WR) && nrf_tx_has_room(self)) {
+            ret |= MP_STREAM_POLL_WR;
+        }
+        return ret;
+    }
+    *errcode = MP_EINVAL;
+    return MP_STREAM_ERROR;
+}
+
+STATIC const mp_rom_map_elem_t nrf24l01_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_deinit), MP_ROM_PTR(&nrf24l01_deinit_obj) },
+    { MP_ROM_QSTR(MP_QSTR_open_tx_pipe), MP_ROM_PTR(&nrf24l01_open_tx_pipe_obj) },
+    { MP_ROM_QSTR(MP_QSTR_open_rx_pipe), MP_ROM_PTR(&nrf24l01_open_rx_pipe_obj) },
+    { MP_ROM_QSTR(MP_QSTR_start_listening), MP_ROM_PTR(&nrf24l01_start_listening_obj) },
+    { MP_ROM_QSTR(MP_QSTR_stop_listening), MP_ROM_PTR(&nrf24l01_stop_listening_obj) },
+    { MP_ROM_QSTR(MP_QSTR_service), MP_ROM_PTR(&nrf24l01_service_obj) },
+    { MP_ROM_QSTR(MP_QSTR_send), MP_ROM_PTR(&nrf24l01_send_obj) },
+    { MP_ROM_QSTR(MP_QSTR_recv), MP_ROM_PTR(&nrf24l01_recv_obj) },
+    { MP_ROM_QSTR(MP_QSTR_any), MP_ROM_PTR(&nrf24l01_any_obj) },
+    { MP_ROM_QSTR(MP_QSTR_stats), MP_ROM_PTR(&nrf24l01_stats_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(nrf24l01_locals_dict, nrf24l01_locals_dict_table);
+
+STATIC const mp_stream_p_t nrf24l01_stream_p = {
+    .ioctl = nrf24l01_ioctl,
+};
+
+STATIC const mp_obj_type_t nrf24l01_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_NRF24L01,
+    .make_new = nrf24l01_make_new,
+    .protocol = &nrf24l01_stream_p,
+    .locals_dict = (mp_obj_dict_t *)&nrf24l01_locals_dict,
+};
+
+STATIC const mp_rom_map_elem_t nrf24l01_module_globals_table[] = {
+    { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR__nrf24l01) },
+    { MP_ROM_QSTR(MP_QSTR_NRF24L01), MP_ROM_PTR(&nrf24l01_type) },
+    { MP_ROM_QSTR(MP_QSTR_SPEED_250K), MP_ROM_INT(SPEED_250K) },
+    { MP_ROM_QSTR(MP_QSTR_SPEED_1M), MP_ROM_INT(SPEED_1M) },
+    { MP_ROM_QSTR(MP_QSTR_SPEED_2M), MP_ROM_INT(SPEED_2M) },
+};
+STATIC MP_DEFINE_CONST_DICT(nrf24l01_module_globals, nrf24l01_module_globals_table);
+
+const mp_obj_module_t mp_module_nrf24l01 = {
+    .base = { &mp_type_module },
+    .globals = (mp_obj_dict_t *)&nrf24l01_module_globals,
+};
+
+#endif // MICROPY_PY_NRF24L01
@@ -26,8 +26,10 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <string.h>
 
 #include "py/obj.h"
+#include "py/runtime.h"
 #include "py/mphal.h"
 
 /******************************************************************************/
@@ -43,6 +45,9 @@
 #define TIMING_WRITE2 (50)
 #define TIMING_WRITE3 (10)
 
+#define CMD_SEARCH_ROM (0xf0)
+#define CMD_MATCH_ROM (0x55)
+
 STATIC int onewire_bus_reset(mp_hal_pin_obj_t pin) {
     mp_hal_pin_od_low(pin);
     mp_hal_delay_us(TIMING_RESET1);
@@ -81,6 +86,91 @@ STATIC void onewire_bus_writebit(mp_hal_pin_obj_t pin, int value) {
     mp_hal_quiet_timing_exit(i);
 }
 
+STATIC uint8_t onewire_bus_readbyte(mp_hal_pin_obj_t pin) {
+    uint8_t value = 0;
+    for (int i = 0; i < 8; ++i) {
+        value |= onewire_bus_readbit(pin) << i;
+    }
+    return value;
+}
+
+STATIC void onewire_bus_writebyte(mp_hal_pin_obj_t pin, uint8_t value) {
+    for (int i = 0; i < 8; ++i) {
+        onewire_bus_writebit(pin, value & 1);
+        value >>= 1;
+    }
+}
+
+STATIC void onewire_bus_write(mp_hal_pin_obj_t pin, const uint8_t *src, size_t len) {
+    for (size_t i = 0; i < len; ++i) {
+        onewire_bus_writebyte(pin, src[i]);
+    }
+}
+
+STATIC void onewire_bus_readinto(mp_hal_pin_obj_t pin, uint8_t *dest, size_t len) {
+    for (size_t i = 0; i < len; ++i) {
+        dest[i] = onewire_bus_readbyte(pin);
+    }
+}
+
+// Does one pass of the ROM search.  On entry rom holds the ROM found by the
+// previous pass, and diff the bit position (64 down to 1) of the last collision
+// where that pass took the 1 branch, or 65 for the first pass.  On exit rom is
+// the next ROM and the return value is the diff for the next pass, which is 0
+// if there are no more devices, or -1 if no device responded.
+STATIC int onewire_bus_search(mp_hal_pin_obj_t pin, uint8_t *rom, int diff) {
+    if (!onewire_bus_reset(pin)) {
+        return -1;
+    }
+    onewire_bus_writebyte(pin, CMD_SEARCH_ROM);
+    int next_diff = 0;
+    int i = 64;
+    for (int byte = 0; byte < 8; ++byte) {
+        uint8_t r_b = 0;
+        for (int bit = 0; bit < 8; ++bit) {
+            int b = onewire_bus_readbit(pin);
+            if (onewire_bus_readbit(pin)) {
+                if (b) {
+                    // there are no devices or there is an error on the bus
+                    return -1;
+                }
+            } else if (!b) {
+                // collision, two devices with different bit meaning
+                if (diff > i || ((rom[byte] & (1 << bit)) && diff != i)) {
+                    b = 1;
+                    next_diff = i;
+                }
+            }
+            onewire_bus_writebit(pin, b);
+            if (b) {
+                r_b |= 1 << bit;
+            }
+            --i;
+        }
+        rom[byte] = r_b;
+    }
+    return next_diff;
+}
+
+STATIC uint8_t onewire_crc8_buf(const uint8_t *buf, size_t len) {
+    uint8_t crc = 0;
+    for (size_t i = 0; i < len; ++i) {
+        uint8_t byte = buf[i];
+        for (int b = 0; b < 8; ++b) {
+            uint8_t fb_bit = (crc ^ byte) & 0x01;
+            if (fb_bit == 0x01) {
+                crc = crc ^ 0x18;
+            }
+            crc = (crc >> 1) & 0x7f;
+            if (fb_bit == 0x01) {
+                crc = crc | 0x80;
+            }
+            byte = byte >> 1;
+        }
+    }
+    return crc;
+}
+
 /******************************************************************************/
 // MicroPython bindings
 
@@ -95,12 +185,7 @@ STATIC mp_obj_t onewire_readbit(mp_obj_t pin_in) {
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(onewire_readbit_obj, onewire_readbit);
 
 STATIC mp_obj_t onewire_readbyte(mp_obj_t pin_in) {
-    mp_hal_pin_obj_t pin = mp_hal_get_pin_obj(pin_in);
-    uint8_t value = 0;
-    for (int i = 0; i < 8; ++i) {
-        value |= onewire_bus_readbit(pin) << i;
-    }
-    return MP_OBJ_NEW_SMALL_INT(value);
+    return MP_OBJ_NEW_SMALL_INT(onewire_bus_readbyte(mp_hal_get_pin_obj(pin_in)));
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(onewire_readbyte_obj, onewire_readbyte);
 
@@ -111,35 +196,82 @@ STATIC mp_obj_t onewire_writebit(mp_obj_t pin_in, mp_obj_t value_in) {
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(onewire_writebit_obj, onewire_writebit);
 
 STATIC mp_obj_t onewire_writebyte(mp_obj_t pin_in, mp_obj_t value_in) {
+    onewire_bus_writebyte(mp_hal_get_pin_obj(pin_in), mp_obj_get_int(value_in));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(onewire_writebyte_obj, onewire_writebyte);
+
+STATIC mp_obj_t onewire_readinto(mp_obj_t pin_in, mp_obj_t buf_in) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_WRITE);
+    onewire_bus_readinto(mp_hal_get_pin_obj(pin_in), bufinfo.buf, bufinfo.len);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(onewire_readinto_obj, onewire_readinto);
+
+STATIC mp_obj_t onewire_write(mp_obj_t pin_in, mp_obj_t buf_in) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_READ);
+    onewire_bus_write(mp_hal_get_pin_obj(pin_in), bufinfo.buf, bufinfo.len);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(onewire_write_obj, onewire_write);
+
+// Returns a list of the ROMs of all the devices on the bus.
+STATIC mp_obj_t onewire_search(mp_obj_t pin_in) {
     mp_hal_pin_obj_t pin = mp_hal_get_pin_obj(pin_in);
-    int value = mp_obj_get_int(value_in);
-    for (int i = 0; i < 8; ++i) {
-        onewire_bus_writebit(pin, value & 1);
-        value >>= 1;
+    mp_obj_t roms = mp_obj_new_list(0, NULL);
+    uint8_t rom[8] = {0};
+    int diff = 65;
+    for (int i = 0; i < 0xff && diff > 0; ++i) {
+        diff = onewire_bus_search(pin, rom, diff);
+        if (diff >= 0) {
+            mp_obj_list_append(roms, mp_obj_new_bytearray(sizeof(rom), rom));
+        }
+    }
+    return roms;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(onewire_search_obj, onewire_search);
+
+// Selects each device of the sequence roms in turn, sends it cmd and reads its
+// reply into the next equal part of buf.  A device that doesn't respond to the
+// reset reads as all 0xff, so it fails any CRC check done by the caller.
+STATIC mp_obj_t onewire_select_readinto(size_t n_args, const mp_obj_t *args) {
+    mp_hal_pin_obj_t pin = mp_hal_get_pin_obj(args[0]);
+    size_t n_roms;
+    mp_obj_t *roms;
+    mp_obj_get_array(args[1], &n_roms, &roms);
+    uint8_t cmd = mp_obj_get_int(args[2]);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[3], &bufinfo, MP_BUFFER_WRITE);
+    if (n_roms == 0) {
+        return mp_const_none;
+    }
+    size_t len = bufinfo.len / n_roms;
+    for (size_t i = 0; i < n_roms; ++i) {
+        mp_buffer_info_t rominfo;
+        mp_get_buffer_raise(roms[i], &rominfo, MP_BUFFER_READ);
+        if (rominfo.len != 8) {
+            mp_raise_ValueError(MP_ERROR_TEXT("ROM must be 8 bytes"));
+        }
+        uint8_t *dest = (uint8_t *)bufinfo.buf + i * len;
+        if (!onewire_bus_reset(pin)) {
+            memset(dest, 0xff, len);
+            continue;
+        }
+        onewire_bus_writebyte(pin, CMD_MATCH_ROM);
+        onewire_bus_write(pin, rominfo.buf, rominfo.len);
+        onewire_bus_writebyte(pin, cmd);
+        onewire_bus_readinto(pin, dest, len);
     }
     return mp_const_none;
 }
-STATIC MP_DEFINE_CONST_FUN_OBJ_2(onewire_writebyte_obj, onewire_writebyte);
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(onewire_select_readinto_obj, 4, 4, onewire_select_readinto);
 
 STATIC mp_obj_t onewire_crc8(mp_obj_t data) {
     mp_buffer_info_t bufinfo;
     mp_get_buffer_raise(data, &bufinfo, MP_BUFFER_READ);
-    uint8_t crc = 0;
-    for (size_t i = 0; i < bufinfo.len; ++i) {
-        uint8_t byte = ((uint8_t *)bufinfo.buf)[i];
-        for (int b = 0; b < 8; ++b) {
-            uint8_t fb_bit = (crc ^ byte) & 0x01;
-            if (fb_bit == 0x01) {
-                crc = crc ^ 0x18;
-            }
-            crc = (crc >> 1) & 0x7f;
-            if (fb_bit == 0x01) {
-                crc = crc | 0x80;
-            }
-            byte = byte >> 1;
-        }
-    }
-    return MP_OBJ_NEW_SMALL_INT(crc);
+    return MP_OBJ_NEW_SMALL_INT(onewire_crc8_buf(bufinfo.buf, bufinfo.len));
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(onewire_crc8_obj, onewire_crc8);
 
@@ -151,6 +283,10 @@ STATIC const mp_rom_map_elem_t onewire_module_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_readbyte), MP_ROM_PTR(&onewire_readbyte_obj) },
     { MP_ROM_QSTR(MP_QSTR_writebit), MP_ROM_PTR(&onewire_writebit_obj) },
     { MP_ROM_QSTR(MP_QSTR_writebyte), MP_ROM_PTR(&onewire_writebyte_obj) },
+    { MP_ROM_QSTR(MP_QSTR_readinto), MP_ROM_PTR(&onewire_readinto_obj) },
+    { MP_ROM_QSTR(MP_QSTR_write), MP_ROM_PTR(&onewire_write_obj) },
+    { MP_ROM_QSTR(MP_QSTR_search), MP_ROM_PTR(&onewire_search_obj) },
+    { MP_ROM_QSTR(MP_QSTR_select_readinto), MP_ROM_PTR(&onewire_select_readinto_obj) },
     { MP_ROM_QSTR(MP_QSTR_crc8), MP_ROM_PTR(&onewire_crc8_obj) },
 };
 
@@ -25,9 +25,14 @@
  */
 
 #include "py/runtime.h"
+#include "py/gc.h"
 #include "py/smallint.h"
 #include "py/pairheap.h"
 #include "py/mphal.h"
+#include "py/objgenerator.h"
+#include "py/objlist.h"
+#include "py/stream.h"
+#include "py/trace.h"
 
 #if MICROPY_PY_UASYNCIO
 
@@ -38,15 +43,47 @@ typedef struct _mp_obj_task_t {
     mp_obj_t waiting;
 
     mp_obj_t ph_key;
+
+    // Set when the task is done and data is the return value of its coroutine,
+    // rather than the exception that ended it.
+    bool returned;
+
+    #if MICROPY_PY_UASYNCIO_TIMER_WHEEL
+    // Set while the task is in the timer wheel of a queue rather than its heap.
+    bool in_wheel;
+    #endif
 } mp_obj_task_t;
 
 typedef struct _mp_obj_task_queue_t {
     mp_obj_base_t base;
     mp_obj_task_t *heap;
+    #if MICROPY_PY_UASYNCIO_TIMER_WHEEL
+    // Tasks due to run a short time from now wait in the slots of a timer wheel,
+    // each slot a doubly-linked list through pairheap.next and pairheap.child,
+    // and only go into the heap when their slot comes up.  The wheel is
+    // allocated by the first push of such a task.
+    mp_obj_task_t **wheel;
+    // Start time of the first slot that's not been moved into the heap yet.
+    mp_obj_t wheel_time;
+    size_t wheel_len;
+    #endif
 } mp_obj_task_queue_t;
 
+typedef struct _mp_obj_io_queue_t {
+    mp_obj_base_t base;
+    mp_obj_t poller;
+    mp_obj_t map; // maps id(stream) to [task_waiting_read, task_waiting_write, stream]
+} mp_obj_io_queue_t;
+
+typedef struct _mp_obj_singleton_gen_t {
+    mp_obj_base_t base;
+    mp_obj_t state;
+} mp_obj_singleton_gen_t;
+
 STATIC const mp_obj_type_t task_queue_type;
 STATIC const mp_obj_type_t task_type;
+STATIC const mp_obj_type_t io_queue_type;
+STATIC const mp_obj_type_t singleton_gen_type;
 
 STATIC mp_obj_t task_queue_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args);
 
@@ -74,21 +111,159 @@ STATIC int task_lt(mp_pairheap_t *n1, mp_pairheap_t *n2) {
 /******************************************************************************/
 // TaskQueue class
 
+STATIC void task_queue_heap_push(mp_obj_task_queue_t *self, mp_obj_task_t *task) {
+    self->heap = (mp_obj_task_t *)mp_pairheap_push(task_lt, &self->heap->pairheap, &task->pairheap);
+    MP_GC_WRITE_BARRIER(self);
+}
+
+#if MICROPY_PY_UASYNCIO_TIMER_WHEEL
+
+#define WHEEL_SLOTS (MICROPY_PY_UASYNCIO_TIMER_WHEEL_SLOTS)
+#define WHEEL_SLOT_MS (MICROPY_PY_UASYNCIO_TIMER_WHEEL_SLOT_MS)
+#define WHEEL_INDEX(t) ((MP_OBJ_SMALL_INT_VALUE(t) / WHEEL_SLOT_MS) & (WHEEL_SLOTS - 1))
+
+// The start of the slot after the one that time t is in.
+STATIC mp_obj_t wheel_next_slot(mp_obj_t t) {
+    mp_uint_t start = MP_OBJ_SMALL_INT_VALUE(t) & ~(mp_uint_t)(WHEEL_SLOT_MS - 1);
+    return MP_OBJ_NEW_SMALL_INT((start + WHEEL_SLOT_MS) & (MICROPY_PY_UTIME_TICKS_PERIOD - 1));
+}
+
+// Put a task in the wheel if it's due after the current slot and within the
+// span of the wheel.  Returns false if it should go in the heap instead.
+STATIC bool task_queue_wheel_push(mp_obj_task_queue_t *self, mp_obj_task_t *task) {
+    if (self->wheel_len == 0) {
+        mp_obj_t now = ticks();
+        if (ticks_diff(task->ph_key, now) < WHEEL_SLOT_MS) {
+            // Not worth it for a task that's due now, like any on a wait queue
+            return false;
+        }
+        if (self->wheel == NULL) {
+            // If the heap is locked then do without the wheel
+            self->wheel = m_new_maybe(mp_obj_task_t *, WHEEL_SLOTS);
+            if (self->wheel == NULL) {
+                return false;
+            }
+            memset(self->wheel, 0, WHEEL_SLOTS * sizeof(mp_obj_task_t *));
+            MP_GC_WRITE_BARRIER(self);
+        }
+        self->wheel_time = wheel_next_slot(now);
+    }
+    mp_int_t dt = ticks_diff(task->ph_key, self->wheel_time);
+    if (dt < 0 || dt >= WHEEL_SLOTS * WHEEL_SLOT_MS) {
+        return false;
+    }
+    size_t idx = WHEEL_INDEX(task->ph_key);
+    mp_obj_task_t *head = self->wheel[idx];
+    task->pairheap.next = (mp_pairheap_t *)head;
+    task->pairheap.child = NULL;
+    MP_GC_WRITE_BARRIER(task);
+    if (head != NULL) {
+        head->pairheap.child = &task->pairheap;
+        MP_GC_WRITE_BARRIER(head);
+    }
+    self->wheel[idx] = task;
+    MP_GC_WRITE_BARRIER(self->wheel);
+    task->in_wheel = true;
+    ++self->wheel_len;
+    return true;
+}
+
+STATIC void task_queue_wheel_remove(mp_obj_task_queue_t *self, mp_obj_task_t *task) {
+    mp_pairheap_t *prev = task->pairheap.child;
+    mp_pairheap_t *next = task->pairheap.next;
+    if (prev == NULL) {
+        self->wheel[WHEEL_INDEX(task->ph_key)] = (mp_obj_task_t *)next;
+        MP_GC_WRITE_BARRIER(self->wheel);
+    } else {
+        prev->next = next;
+        MP_GC_WRITE_BARRIER(prev);
+    }
+    if (next != NULL) {
+        next->child = prev;
+        MP_GC_WRITE_BARRIER(next);
+    }
+    mp_pairheap_init_node(task_lt, &task->pairheap);
+    task->in_wheel = false;
+    --self->wheel_len;
+}
+
+// Move all the tasks of a slot into the heap.  They are pushed in the order
+// they were put in the slot, the reverse of the list, so that tasks due at the
+// same time still run in the order they were scheduled.
+STATIC void task_queue_wheel_move_slot(mp_obj_task_queue_t *self, size_t idx) {
+    mp_pairheap_t *node = (mp_pairheap_t *)self->wheel[idx];
+    if (node == NULL) {
+        return;
+    }
+    self->wheel[idx] = NULL;
+    while (node->next != NULL) {
+        node = node->next;
+    }
+    while (node != NULL) {
+        mp_pairheap_t *prev = node->child;
+        mp_pairheap_init_node(task_lt, node);
+        ((mp_obj_task_t *)node)->in_wheel = false;
+        --self->wheel_len;
+        task_queue_heap_push(self, (mp_obj_task_t *)node);
+        node = prev;
+    }
+}
+
+// Move the tasks of every slot that has started into the heap, then if the heap
+// has nothing that's due before the first occupied slot move that one too, so
+// the top of the heap is the first task due.
+STATIC void task_queue_wheel_advance(mp_obj_task_queue_t *self) {
+    mp_obj_t now = ticks();
+    while (self->wheel_len > 0 && ticks_diff(now, self->wheel_time) >= 0) {
+        task_queue_wheel_move_slot(self, WHEEL_INDEX(self->wheel_time));
+        self->wheel_time = wheel_next_slot(self->wheel_time);
+    }
+    if (self->heap != NULL && ticks_diff(self->heap->ph_key, self->wheel_time) < 0) {
+        return;
+    }
+    for (mp_obj_t t = self->wheel_time; self->wheel_len > 0; t = wheel_next_slot(t)) {
+        size_t idx = WHEEL_INDEX(t);
+        if (self->wheel[idx] != NULL) {
+            if (self->heap == NULL || ticks_diff(self->heap->ph_key, t) >= 0) {
+                task_queue_wheel_move_slot(self, idx);
+            }
+            break;
+        }
+    }
+}
+
+#endif // MICROPY_PY_UASYNCIO_TIMER_WHEEL
+
+// Return the first task due to run, or NULL if the queue is empty.
+STATIC mp_obj_task_t *task_queue_first(mp_obj_task_queue_t *self) {
+    #if MICROPY_PY_UASYNCIO_TIMER_WHEEL
+    if (self->wheel_len > 0) {
+        task_queue_wheel_advance(self);
+    }
+    #endif
+    return self->heap;
+}
+
 STATIC mp_obj_t task_queue_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
     (void)args;
     mp_arg_check_num(n_args, n_kw, 0, 0, false);
     mp_obj_task_queue_t *self = m_new_obj(mp_obj_task_queue_t);
     self->base.type = type;
     self->heap = (mp_obj_task_t *)mp_pairheap_new(task_lt);
+    #if MICROPY_PY_UASYNCIO_TIMER_WHEEL
+    self->wheel = NULL;
+    self->wheel_time = MP_OBJ_NEW_SMALL_INT(0);
+    self->wheel_len = 0;
+    #endif
     return MP_OBJ_FROM_PTR(self);
 }
 
 STATIC mp_obj_t task_queue_peek(mp_obj_t self_in) {
-    mp_obj_task_queue_t *self = MP_OBJ_TO_PTR(self_in);
-    if (self->heap == NULL) {
+    mp_obj_task_t *head = task_queue_first(MP_OBJ_TO_PTR(self_in));
+    if (head == NULL) {
         return mp_const_none;
     } else {
-        return MP_OBJ_FROM_PTR(self->heap);
+        return MP_OBJ_FROM_PTR(head);
     }
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(task_queue_peek_obj, task_queue_peek);
@@ -103,18 +278,24 @@ STATIC mp_obj_t task_queue_push_sorted(size_t n_args, const mp_obj_t *args) {
         assert(mp_obj_is_small_int(args[2]));
         task->ph_key = args[2];
     }
-    self->heap = (mp_obj_task_t *)mp_pairheap_push(task_lt, &self->heap->pairheap, &task->pairheap);
+    #if MICROPY_PY_UASYNCIO_TIMER_WHEEL
+    if (task_queue_wheel_push(self, task)) {
+        return mp_const_none;
+    }
+    #endif
+    task_queue_heap_push(self, task);
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(task_queue_push_sorted_obj, 2, 3, task_queue_push_sorted);
 
 STATIC mp_obj_t task_queue_pop_head(mp_obj_t self_in) {
     mp_obj_task_queue_t *self = MP_OBJ_TO_PTR(self_in);
-    mp_obj_task_t *head = (mp_obj_task_t *)mp_pairheap_peek(task_lt, &self->heap->pairheap);
+    mp_obj_task_t *head = task_queue_first(self);
     if (head == NULL) {
         mp_raise_msg(&mp_type_IndexError, MP_ERROR_TEXT("empty heap"));
     }
     self->heap = (mp_obj_task_t *)mp_pairheap_pop(task_lt, &self->heap->pairheap);
+    MP_GC_WRITE_BARRIER(self);
     return MP_OBJ_FROM_PTR(head);
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(task_queue_pop_head_obj, task_queue_pop_head);
@@ -122,7 +303,14 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_1(task_queue_pop_head_obj, task_queue_pop_head);
 STATIC mp_obj_t task_queue_remove(mp_obj_t self_in, mp_obj_t task_in) {
     mp_obj_task_queue_t *self = MP_OBJ_TO_PTR(self_in);
     mp_obj_task_t *task = MP_OBJ_TO_PTR(task_in);
+    #if MICROPY_PY_UASYNCIO_TIMER_WHEEL
+    if (task->in_wheel) {
+        task_queue_wheel_remove(self, task);
+        return mp_const_none;
+    }
+    #endif
     self->heap = (mp_obj_task_t *)mp_pairheap_delete(task_lt, &self->heap->pairheap, &task->pairheap);
+    MP_GC_WRITE_BARRIER(self);
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(task_queue_remove_obj, task_queue_remove);
@@ -154,13 +342,25 @@ STATIC mp_obj_t uasyncio_context = MP_OBJ_NULL;
 
 STATIC mp_obj_t task_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
     mp_arg_check_num(n_args, n_kw, 1, 2, false);
+    #if MICROPY_GC_POOL
+    // reuse a task that has been collected
+    mp_obj_task_t *self = gc_pool_pop(&task_type, sizeof(mp_obj_task_t));
+    if (self == NULL) {
+        self = m_new_obj(mp_obj_task_t);
+    }
+    #else
     mp_obj_task_t *self = m_new_obj(mp_obj_task_t);
+    #endif
     self->pairheap.base.type = type;
     mp_pairheap_init_node(task_lt, &self->pairheap);
     self->coro = args[0];
     self->data = mp_const_none;
     self->waiting = mp_const_none;
     self->ph_key = MP_OBJ_NEW_SMALL_INT(0);
+    self->returned = false;
+    #if MICROPY_PY_UASYNCIO_TIMER_WHEEL
+    self->in_wheel = false;
+    #endif
     if (n_args == 2) {
         uasyncio_context = args[1];
     }
@@ -213,6 +413,7 @@ STATIC mp_obj_t task_cancel(mp_obj_t self_in) {
     }
 
     self->data = mp_obj_dict_get(uasyncio_context, MP_OBJ_NEW_QSTR(MP_QSTR_CancelledError));
+    MP_GC_WRITE_BARRIER(self);
 
     return mp_const_true;
 }
@@ -223,6 +424,7 @@ STATIC mp_obj_t task_throw(mp_obj_t self_in, mp_obj_t value_in) {
     mp_obj_task_t *self = MP_OBJ_TO_PTR(self_in);
     // Set the data because it was cleared by the main scheduling loop.
     self->data = value_in;
+    MP_GC_WRITE_BARRIER(self);
     if (self->waiting == mp_const_none) {
         // Nothing await'ed on the task so call the exception handler.
         mp_obj_t _exc_context = mp_obj_dict_get(uasyncio_context, MP_OBJ_NEW_QSTR(MP_QSTR__exc_context));
@@ -272,6 +474,7 @@ STATIC void task_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest) {
             self->waiting = dest[1];
             dest[0] = MP_OBJ_NULL;
         }
+        MP_GC_WRITE_BARRIER(self);
     }
 }
 
@@ -294,7 +497,11 @@ STATIC mp_obj_t task_getiter(mp_obj_t self_in, mp_obj_iter_buf_t *iter_buf) {
 STATIC mp_obj_t task_iternext(mp_obj_t self_in) {
     mp_obj_task_t *self = MP_OBJ_TO_PTR(self_in);
     if (TASK_IS_DONE(self)) {
-        // Task finished, raise return value to caller so it can continue.
+        // Task finished, pass its return value or exception to the caller so
+        // it can continue.
+        if (self->returned) {
+            return mp_make_stop_iteration(self->data);
+        }
         nlr_raise(self->data);
     } else {
         // Put calling task on waiting queue.
@@ -303,6 +510,7 @@ STATIC mp_obj_t task_iternext(mp_obj_t self_in) {
         task_queue_push_sorted(2, args);
         // Set calling task's data to this task that it waits on, to double-link it.
         ((mp_obj_task_t *)MP_OBJ_TO_PTR(cur_task))->data = self_in;
+        MP_GC_WRITE_BARRIER(MP_OBJ_TO_PTR(cur_task));
     }
     return mp_const_none;
 }
@@ -316,6 +524,361 @@ STATIC const mp_obj_type_t task_type = {
     .iternext = task_iternext,
 };
 
+/******************************************************************************/
+// sleep_ms function
+
+// "Yield" once, then stop.  There is only one of these objects, and it holds
+// no heap pointers, so it can live in static RAM and sleep_ms() doesn't need
+// to allocate on the heap.
+STATIC mp_obj_singleton_gen_t singleton_gen = { { &singleton_gen_type }, MP_OBJ_NULL };
+
+STATIC mp_obj_t singleton_gen_iternext(mp_obj_t self_in) {
+    mp_obj_singleton_gen_t *self = MP_OBJ_TO_PTR(self_in);
+    if (self->state == MP_OBJ_NULL) {
+        return MP_OBJ_STOP_ITERATION;
+    }
+    // _task_queue.push_sorted(cur_task, self.state)
+    mp_obj_t args[3] = {
+        mp_obj_dict_get(uasyncio_context, MP_OBJ_NEW_QSTR(MP_QSTR__task_queue)),
+        mp_obj_dict_get(uasyncio_context, MP_OBJ_NEW_QSTR(MP_QSTR_cur_task)),
+        self->state,
+    };
+    self->state = MP_OBJ_NULL;
+    task_queue_push_sorted(3, args);
+    return mp_const_none;
+}
+
+STATIC const mp_obj_type_t singleton_gen_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_SingletonGenerator,
+    .getiter = mp_identity_getiter,
+    .iternext = singleton_gen_iternext,
+};
+
+// Pause task execution for the given time (integer in milliseconds, uPy extension)
+STATIC mp_obj_t uasyncio_sleep_ms(mp_obj_t t_in) {
+    mp_int_t t = mp_obj_get_int(t_in);
+    if (t < 0) {
+        t = 0;
+    }
+    // ticks_add(ticks(), t)
+    singleton_gen.state = MP_OBJ_NEW_SMALL_INT((mp_hal_ticks_ms() + t) & (MICROPY_PY_UTIME_TICKS_PERIOD - 1));
+    return MP_OBJ_FROM_PTR(&singleton_gen);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(uasyncio_sleep_ms_obj, uasyncio_sleep_ms);
+
+/******************************************************************************/
+// IOQueue class
+
+STATIC mp_obj_t io_queue_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    (void)args;
+    mp_arg_check_num(n_args, n_kw, 0, 0, false);
+    // select.poll()
+    mp_obj_t select = mp_import_name(MP_QSTR_uselect, mp_const_none, MP_OBJ_NEW_SMALL_INT(0));
+    mp_obj_t poller = mp_call_function_0(mp_load_attr(select, MP_QSTR_poll));
+    mp_obj_io_queue_t *self = m_new_obj(mp_obj_io_queue_t);
+    self->base.type = type;
+    self->poller = poller;
+    self->map = mp_obj_new_dict(0);
+    // The run loop only polls when there's something to poll for, so call
+    // ipoll() now to let the poller allocate its iteration state up front
+    // rather than later, when the heap may be locked.
+    mp_obj_t dest[3];
+    mp_load_method(poller, MP_QSTR_ipoll, dest);
+    dest[2] = MP_OBJ_NEW_SMALL_INT(0);
+    mp_call_method_n_kw(1, 0, dest);
+    return MP_OBJ_FROM_PTR(self);
+}
+
+// Call poller.register(s, flags), poller.modify(s, flags) or poller.unregister(s).
+STATIC void io_queue_poller_call(mp_obj_io_queue_t *self, qstr meth, mp_obj_t s, mp_uint_t flags) {
+    mp_obj_t dest[4];
+    mp_load_method(self->poller, meth, dest);
+    dest[2] = s;
+    dest[3] = MP_OBJ_NEW_SMALL_INT(flags);
+    mp_call_method_n_kw(meth == MP_QSTR_unregister ? 1 : 2, 0, dest);
+}
+
+STATIC void io_queue_enqueue(mp_obj_io_queue_t *self, mp_obj_t s, size_t idx) {
+    mp_obj_t cur_task = mp_obj_dict_get(uasyncio_context, MP_OBJ_NEW_QSTR(MP_QSTR_cur_task));
+    mp_obj_t id = mp_obj_id(s);
+    mp_map_elem_t *elem = mp_map_lookup(mp_obj_dict_get_map(self->map), id, MP_MAP_LOOKUP);
+    if (elem == NULL) {
+        mp_obj_t entry[3] = { mp_const_none, mp_const_none, s };
+        entry[idx] = cur_task;
+        mp_obj_dict_store(self->map, id, mp_obj_new_list(3, entry));
+        io_queue_poller_call(self, MP_QSTR_register, s, idx == 0 ? MP_STREAM_POLL_RD : MP_STREAM_POLL_WR);
+    } else {
+        mp_obj_list_t *sm = MP_OBJ_TO_PTR(elem->value);
+        assert(sm->items[idx] == mp_const_none);
+        assert(sm->items[1 - idx] != mp_const_none);
+        sm->items[idx] = cur_task;
+        MP_GC_WRITE_BARRIER(sm);
+        io_queue_poller_call(self, MP_QSTR_modify, s, MP_STREAM_POLL_RD | MP_STREAM_POLL_WR);
+    }
+    // Link task to this IOQueue so it can be removed if needed
+    ((mp_obj_task_t *)MP_OBJ_TO_PTR(cur_task))->data = MP_OBJ_FROM_PTR(self);
+    MP_GC_WRITE_BARRIER(MP_OBJ_TO_PTR(cur_task));
+}
+
+STATIC void io_queue_dequeue(mp_obj_io_queue_t *self, mp_obj_t s) {
+    mp_obj_dict_delete(self->map, mp_obj_id(s));
+    io_queue_poller_call(self, MP_QSTR_unregister, s, 0);
+}
+
+STATIC mp_obj_t io_queue_queue_read(mp_obj_t self_in, mp_obj_t s) {
+    io_queue_enqueue(MP_OBJ_TO_PTR(self_in), s, 0);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(io_queue_queue_read_obj, io_queue_queue_read);
+
+STATIC mp_obj_t io_queue_queue_write(mp_obj_t self_in, mp_obj_t s) {
+    io_queue_enqueue(MP_OBJ_TO_PTR(self_in), s, 1);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(io_queue_queue_write_obj, io_queue_queue_write);
+
+STATIC mp_obj_t io_queue_remove(mp_obj_t self_in, mp_obj_t task) {
+    mp_obj_io_queue_t *self = MP_OBJ_TO_PTR(self_in);
+    for (;;) {
+        mp_map_t *map = mp_obj_dict_get_map(self->map);
+        mp_obj_t del_s = MP_OBJ_NULL;
+        for (size_t i = 0; i < map->alloc; ++i) {
+            if (mp_map_slot_is_filled(map, i)) {
+                mp_obj_list_t *sm = MP_OBJ_TO_PTR(map->table[i].value);
+                if (sm->items[0] == task || sm->items[1] == task) {
+                    del_s = sm->items[2];
+                    break;
+                }
+            }
+        }
+        if (del_s == MP_OBJ_NULL) {
+            break;
+        }
+        io_queue_dequeue(self, del_s);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(io_queue_remove_obj, io_queue_remove);
+
+STATIC void io_queue_wait_io_event_internal(mp_obj_io_queue_t *self, mp_int_t dt) {
+    mp_obj_t task_queue = mp_obj_dict_get(uasyncio_context, MP_OBJ_NEW_QSTR(MP_QSTR__task_queue));
+    // for s, ev in self.poller.ipoll(dt):
+    mp_obj_t dest[3];
+    mp_load_method(self->poller, MP_QSTR_ipoll, dest);
+    dest[2] = MP_OBJ_NEW_SMALL_INT(dt);
+    mp_obj_iter_buf_t iter_buf;
+    mp_obj_t iter = mp_getiter(mp_call_method_n_kw(1, 0, dest), &iter_buf);
+    mp_obj_t item;
+    while ((item = mp_iternext(iter)) != MP_OBJ_STOP_ITERATION) {
+        mp_obj_t *s_ev;
+        mp_obj_get_array_fixed_n(item, 2, &s_ev);
+        mp_obj_t s = s_ev[0];
+        mp_uint_t ev = mp_obj_get_int(s_ev[1]);
+        mp_obj_list_t *sm = MP_OBJ_TO_PTR(mp_obj_dict_get(self->map, mp_obj_id(s)));
+        mp_obj_t args[2] = { task_queue, MP_OBJ_NULL };
+        if ((ev & ~MP_STREAM_POLL_WR) && sm->items[0] != mp_const_none) {
+            // POLLIN or error
+            args[1] = sm->items[0];
+            task_queue_push_sorted(2, args);
+            sm->items[0] = mp_const_none;
+        }
+        if ((ev & ~MP_STREAM_POLL_RD) && sm->items[1] != mp_const_none) {
+            // POLLOUT or error
+            args[1] = sm->items[1];
+            task_queue_push_sorted(2, args);
+            sm->items[1] = mp_const_none;
+        }
+        if (sm->items[0] == mp_const_none && sm->items[1] == mp_const_none) {
+            io_queue_dequeue(self, s);
+        } else if (sm->items[0] == mp_const_none) {
+            io_queue_poller_call(self, MP_QSTR_modify, s, MP_STREAM_POLL_WR);
+        } else {
+            io_queue_poller_call(self, MP_QSTR_modify, s, MP_STREAM_POLL_RD);
+        }
+    }
+}
+
+STATIC mp_obj_t io_queue_wait_io_event(mp_obj_t self_in, mp_obj_t dt_in) {
+    io_queue_wait_io_event_internal(MP_OBJ_TO_PTR(self_in), mp_obj_get_int(dt_in));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(io_queue_wait_io_event_obj, io_queue_wait_io_event);
+
+STATIC const mp_rom_map_elem_t io_queue_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_queue_read), MP_ROM_PTR(&io_queue_queue_read_obj) },
+    { MP_ROM_QSTR(MP_QSTR_queue_write), MP_ROM_PTR(&io_queue_queue_write_obj) },
+    { MP_ROM_QSTR(MP_QSTR_remove), MP_ROM_PTR(&io_queue_remove_obj) },
+    { MP_ROM_QSTR(MP_QSTR_wait_io_event), MP_ROM_PTR(&io_queue_wait_io_event_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(io_queue_locals_dict, io_queue_locals_dict_table);
+
+STATIC const mp_obj_type_t io_queue_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_IOQueue,
+    .make_new = io_queue_make_new,
+    .locals_dict = (mp_obj_dict_t *)&io_queue_locals_dict,
+};
+
+/******************************************************************************/
+// Main run loop
+
+// Continue running the coroutine of a task by sending None into it, or by
+// throwing exc into it if that's not MP_OBJ_NULL.  A coroutine that returns
+// gives MP_VM_RETURN_NORMAL and its return value, without any StopIteration.
+STATIC mp_vm_return_kind_t task_resume(mp_obj_t coro, mp_obj_t exc, mp_obj_t *ret_val) {
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        mp_vm_return_kind_t ret_kind;
+        if (mp_obj_is_type(coro, &mp_type_gen_instance)) {
+            // This can throw into a coroutine that hasn't started yet
+            ret_kind = mp_obj_gen_resume(coro, mp_const_none, exc, ret_val);
+        } else if (exc == MP_OBJ_NULL) {
+            ret_kind = mp_resume(coro, mp_const_none, MP_OBJ_NULL, ret_val);
+        } else {
+            ret_kind = mp_resume(coro, MP_OBJ_NULL, exc, ret_val);
+        }
+        nlr_pop();
+        if (ret_kind == MP_VM_RETURN_NORMAL && *ret_val == MP_OBJ_STOP_ITERATION) {
+            *ret_val = mp_const_none;
+        }
+        return ret_kind;
+    } else {
+        *ret_val = MP_OBJ_FROM_PTR(nlr.ret_val);
+        return MP_VM_RETURN_EXCEPTION;
+    }
+}
+
+// Keep scheduling tasks until there are none left to schedule
+STATIC mp_obj_t uasyncio_run_until_complete(size_t n_args, const mp_obj_t *args) {
+    mp_obj_t main_task = n_args == 0 ? mp_const_none : args[0];
+    if (uasyncio_context == MP_OBJ_NULL) {
+        // No Task was ever created so there's nothing to run
+        return mp_const_none;
+    }
+    mp_obj_t CancelledError = mp_obj_dict_get(uasyncio_context, MP_OBJ_NEW_QSTR(MP_QSTR_CancelledError));
+    for (;;) {
+        // These are looked up each time in case new_event_loop() is called by a task
+        mp_obj_task_queue_t *task_queue = MP_OBJ_TO_PTR(mp_obj_dict_get(uasyncio_context, MP_OBJ_NEW_QSTR(MP_QSTR__task_queue)));
+        mp_obj_t io_queue_in = mp_obj_dict_get(uasyncio_context, MP_OBJ_NEW_QSTR(MP_QSTR__io_queue));
+        if (!mp_obj_is_type(io_queue_in, &io_queue_type)) {
+            mp_raise_TypeError(NULL);
+        }
+        mp_obj_io_queue_t *io_queue = MP_OBJ_TO_PTR(io_queue_in);
+
+        // Wait until the head of _task_queue is ready to run
+        mp_int_t dt = 1;
+        while (dt > 0) {
+            dt = -1;
+            mp_obj_task_t *head = task_queue_first(task_queue);
+            if (head != NULL) {
+                // A task waiting on _task_queue; "ph_key" is time to schedule task at
+                dt = ticks_diff(head->ph_key, ticks());
+                if (dt < 0) {
+                    dt = 0;
+                }
+            } else if (mp_obj_dict_get_map(io_queue->map)->used == 0) {
+                // No tasks can be woken so finished running
+                return mp_const_none;
+            }
+            bool have_io = mp_obj_dict_get_map(io_queue->map)->used != 0;
+            if (!have_io && dt == 0) {
+                // Nothing to poll for and no need to wait, so skip the poller
+                break;
+            }
+            if (dt != 0) {
+                // The idle handler can sleep until the next task is due, less
+                // the time it takes to wake up, if it can wake for the streams
+                mp_obj_t loop = mp_obj_dict_get(uasyncio_context, MP_OBJ_NEW_QSTR(MP_QSTR_Loop));
+                mp_obj_t idle_handler = mp_load_attr(loop, MP_QSTR__idle_handler);
+                mp_int_t latency = mp_obj_get_int(mp_load_attr(loop, MP_QSTR__idle_latency));
+                if (idle_handler != mp_const_none && (dt < 0 || dt > latency)
+                    && (!have_io || mp_obj_is_true(mp_load_attr(loop, MP_QSTR__idle_io)))) {
+                    mp_call_function_1(idle_handler, MP_OBJ_NEW_SMALL_INT(dt < 0 ? -1 : dt - latency));
+                    if (have_io) {
+                        // A stream may have woken the handler, so take its events without waiting
+                        io_queue_wait_io_event_internal(io_queue, 0);
+                    }
+                    dt = 1;
+                    continue;
+                }
+            }
+            io_queue_wait_io_event_internal(io_queue, dt);
+        }
+
+        // Get next task to run and continue it
+        mp_obj_t t_in = task_queue_pop_head(MP_OBJ_FROM_PTR(task_queue));
+        mp_obj_task_t *t = MP_OBJ_TO_PTR(t_in);
+        MP_TRACE(MP_TRACE_EVENT_TASK, (uintptr_t)t >> 3);
+        mp_obj_dict_store(uasyncio_context, MP_OBJ_NEW_QSTR(MP_QSTR_cur_task), t_in);
+
+        // Continue running the coroutine, it's responsible for rescheduling itself
+        mp_obj_t exc = t->data;
+        mp_obj_t er;
+        mp_vm_return_kind_t ret_kind;
+        if (!mp_obj_is_true(exc)) {
+            ret_kind = task_resume(t->coro, MP_OBJ_NULL, &er);
+        } else {
+            t->data = mp_const_none;
+            ret_kind = task_resume(t->coro, exc, &er);
+        }
+        if (ret_kind == MP_VM_RETURN_YIELD) {
+            continue;
+        }
+
+        if (ret_kind == MP_VM_RETURN_NORMAL) {
+            if (t_in == main_task) {
+                return er;
+            }
+            // The coroutine finished, keep its return value for any task that
+            // awaits this one
+            t->returned = true;
+        } else if (!mp_obj_exception_match(er, CancelledError)
+                   && !mp_obj_exception_match(er, MP_OBJ_FROM_PTR(&mp_type_Exception))) {
+            // Not one of the exceptions that end a task, so stop running the loop
+            nlr_raise(er);
+        } else if (t_in == main_task) {
+            // This task is done and it's the main task, so the loop should stop
+            if (mp_obj_exception_match(er, MP_OBJ_FROM_PTR(&mp_type_StopIteration))) {
+                return mp_obj_exception_get_value(er);
+            }
+            nlr_raise(er);
+        }
+
+        // Check the task is not on any event queue
+        assert(t->data == mp_const_none);
+
+        // Schedule any other tasks waiting on the completion of this task
+        bool waiting = false;
+        if (t->waiting != mp_const_none && t->waiting != mp_const_false) {
+            mp_obj_task_queue_t *waiting_queue = MP_OBJ_TO_PTR(t->waiting);
+            while (task_queue_first(waiting_queue) != NULL) {
+                mp_obj_t push_args[2] = { MP_OBJ_FROM_PTR(task_queue), task_queue_pop_head(t->waiting) };
+                task_queue_push_sorted(2, push_args);
+                waiting = true;
+            }
+            // Free waiting queue head
+            t->waiting = mp_const_none;
+        }
+        if (!waiting
+            && !t->returned
+            && !mp_obj_exception_match(er, CancelledError)
+            && !mp_obj_exception_match(er, MP_OBJ_FROM_PTR(&mp_type_StopIteration))) {
+            // An exception ended this detached task, so queue it for later
+            // execution to handle the uncaught exception if no other task retrieves
+            // the exception in the meantime (this is handled by Task.throw).
+            mp_obj_t push_args[2] = { MP_OBJ_FROM_PTR(task_queue), t_in };
+            task_queue_push_sorted(2, push_args);
+        }
+        // Indicate task is done by setting coro to the task object itself
+        t->coro = t_in;
+        // Save return value of coro to pass up to caller
+        t->data = er;
+        MP_GC_WRITE_BARRIER(t);
+    }
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(uasyncio_run_until_complete_obj, 0, 1, uasyncio_run_until_complete);
+
 /******************************************************************************/
 // C-level uasyncio module
 
@@ -323,6 +886,9 @@ STATIC const mp_rom_map_elem_t mp_module_uasyncio_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR__uasyncio) },
     { MP_ROM_QSTR(MP_QSTR_TaskQueue), MP_ROM_PTR(&task_queue_type) },
     { MP_ROM_QSTR(MP_QSTR_Task), MP_ROM_PTR(&task_type) },
+    { MP_ROM_QSTR(MP_QSTR_IOQueue), MP_ROM_PTR(&io_queue_type) },
+    { MP_ROM_QSTR(MP_QSTR_sleep_ms), MP_ROM_PTR(&uasyncio_sleep_ms_obj) },
+    { MP_ROM_QSTR(MP_QSTR_run_until_complete), MP_ROM_PTR(&uasyncio_run_until_complete_obj) },
 };
 STATIC MP_DEFINE_CONST_DICT(mp_module_uasyncio_globals, mp_module_uasyncio_globals_table);
 
@@ -33,199 +33,426 @@
 
 #if MICROPY_PY_UBINASCII
 
+// The two hex digits of each byte value.
+STATIC const char hex_pairs[] =
+    "000102030405060708090a0b0c0d0e0f"
+    "101112131415161718191a1b1c1d1e1f"
+    "202122232425262728292a2b2c2d2e2f"
+    "303132333435363738393a3b3c3d3e3f"
+    "404142434445464748494a4b4c4d4e4f"
+    "505152535455565758595a5b5c5d5e5f"
+    "606162636465666768696a6b6c6d6e6f"
+    "707172737475767778797a7b7c7d7e7f"
+    "808182838485868788898a8b8c8d8e8f"
+    "909192939495969798999a9b9c9d9e9f"
+    "a0a1a2a3a4a5a6a7a8a9aaabacadaeaf"
+    "b0b1b2b3b4b5b6b7b8b9babbbcbdbebf"
+    "c0c1c2c3c4c5c6c7c8c9cacbcccdcecf"
+    "d0d1d2d3d4d5d6d7d8d9dadbdcdddedf"
+    "e0e1e2e3e4e5e6e7e8e9eaebecedeeef"
+    "f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff";
+
+// Write the hex digits of the len bytes at in to out, with the separator
+// sep (if not -1) between them, returning the number of bytes written.
+STATIC size_t binascii_hexlify(const byte *in, size_t len, int sep, byte *out) {
+    byte *o = out;
+    for (const byte *in_end = in + len; in < in_end; ++in) {
+        memcpy(o, &hex_pairs[*in * 2], 2);
+        o += 2;
+        if (sep != -1 && in + 1 != in_end) {
+            *o++ = sep;
+        }
+    }
+    return o - out;
+}
+
+STATIC size_t binascii_hexlify_len(size_t len, int sep) {
+    return len == 0 ? 0 : len * 2 + (sep != -1 ? len - 1 : 0);
+}
+
+STATIC int binascii_hexlify_sep(size_t n_args, const mp_obj_t *args, size_t i) {
+    // 1-char separator between hex numbers
+    return n_args > i ? *(const byte *)mp_obj_str_get_str(args[i]) : -1;
+}
+
 STATIC mp_obj_t mod_binascii_hexlify(size_t n_args, const mp_obj_t *args) {
     // First argument is the data to convert.
     // Second argument is an optional separator to be used between values.
-    const char *sep = NULL;
     mp_buffer_info_t bufinfo;
     mp_get_buffer_raise(args[0], &bufinfo, MP_BUFFER_READ);
-
-    // Code below assumes non-zero buffer length when computing size with
-    // separator, so handle the zero-length case here.
     if (bufinfo.len == 0) {
         return mp_const_empty_bytes;
     }
-
+    int sep = binascii_hexlify_sep(n_args, args, 1);
     vstr_t vstr;
-    size_t out_len = bufinfo.len * 2;
-    if (n_args > 1) {
-        // 1-char separator between hex numbers
-        out_len += bufinfo.len - 1;
-        sep = mp_obj_str_get_str(args[1]);
-    }
-    vstr_init_len(&vstr, out_len);
-    byte *in = bufinfo.buf, *out = (byte *)vstr.buf;
-    for (mp_uint_t i = bufinfo.len; i--;) {
-        byte d = (*in >> 4);
-        if (d > 9) {
-            d += 'a' - '9' - 1;
-        }
-        *out++ = d + '0';
-        d = (*in++ & 0xf);
-        if (d > 9) {
-            d += 'a' - '9' - 1;
-        }
-        *out++ = d + '0';
-        if (sep != NULL && i != 0) {
-            *out++ = *sep;
-        }
-    }
+    vstr_init_len(&vstr, binascii_hexlify_len(bufinfo.len, sep));
+    binascii_hexlify(bufinfo.buf, bufinfo.len, sep, (byte *)vstr.buf);
     return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_binascii_hexlify_obj, 1, 2, mod_binascii_hexlify);
 
-STATIC mp_obj_t mod_binascii_unhexlify(mp_obj_t data) {
-    mp_buffer_info_t bufinfo;
-    mp_get_buffer_raise(data, &bufinfo, MP_BUFFER_READ);
+STATIC int binascii_hex_digit(byte ch) {
+    if ((byte)(ch - '0') < 10) {
+        return ch - '0';
+    }
+    ch |= 0x20;
+    if ((byte)(ch - 'a') < 6) {
+        return ch - 'a' + 10;
+    }
+    return -1;
+}
 
-    if ((bufinfo.len & 1) != 0) {
+STATIC void binascii_unhexlify(const byte *in, size_t len, byte *out) {
+    if ((len & 1) != 0) {
         mp_raise_ValueError(MP_ERROR_TEXT("odd-length string"));
     }
-    vstr_t vstr;
-    vstr_init_len(&vstr, bufinfo.len / 2);
-    byte *in = bufinfo.buf, *out = (byte *)vstr.buf;
-    byte hex_byte = 0;
-    for (mp_uint_t i = bufinfo.len; i--;) {
-        byte hex_ch = *in++;
-        if (unichar_isxdigit(hex_ch)) {
-            hex_byte += unichar_xdigit_value(hex_ch);
-        } else {
+    for (size_t i = 0; i < len; i += 2) {
+        int hi = binascii_hex_digit(in[i]);
+        int lo = binascii_hex_digit(in[i + 1]);
+        if ((hi | lo) < 0) {
             mp_raise_ValueError(MP_ERROR_TEXT("non-hex digit found"));
         }
-        if (i & 1) {
-            hex_byte <<= 4;
-        } else {
-            *out++ = hex_byte;
-            hex_byte = 0;
-        }
+        *out++ = hi << 4 | lo;
     }
+}
+
+STATIC mp_obj_t mod_binascii_unhexlify(mp_obj_t data) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(data, &bufinfo, MP_BUFFER_READ);
+    vstr_t vstr;
+    vstr_init_len(&vstr, bufinfo.len / 2);
+    binascii_unhexlify(bufinfo.buf, bufinfo.len, (byte *)vstr.buf);
     return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_binascii_unhexlify_obj, mod_binascii_unhexlify);
 
-// If ch is a character in the base64 alphabet, and is not a pad character, then
-// the corresponding integer between 0 and 63, inclusively, is returned.
-// Otherwise, -1 is returned.
-static int mod_binascii_sextet(byte ch) {
-    if (ch >= 'A' && ch <= 'Z') {
-        return ch - 'A';
-    } else if (ch >= 'a' && ch <= 'z') {
-        return ch - 'a' + 26;
-    } else if (ch >= '0' && ch <= '9') {
-        return ch - '0' + 52;
-    } else if (ch == '+') {
-        return 62;
-    } else if (ch == '/') {
-        return 63;
-    } else {
-        return -1;
-    }
-}
+STATIC const char base64_alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
 
-STATIC mp_obj_t mod_binascii_a2b_base64(mp_obj_t data) {
-    mp_buffer_info_t bufinfo;
-    mp_get_buffer_raise(data, &bufinfo, MP_BUFFER_READ);
-    byte *in = bufinfo.buf;
+// The value of each character in the base64 alphabet, 64 for the pad character
+// and X for all others.
+#define X (0xff)
+STATIC const byte base64_values[128] = {
+    X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+    X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+    X, X, X, X, X, X, X, X, X, X, X, 62, X, X, X, 63,
+    52, 53, 54, 55, 56, 57, 58, 59, 60, 61, X, X, X, 64, X, X,
+    X, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14,
+    15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, X, X, X, X, X,
+    X, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+    41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, X, X, X, X, X,
+};
+#undef X
 
-    vstr_t vstr;
-    vstr_init(&vstr, (bufinfo.len / 4) * 3 + 1); // Potentially over-allocate
-    byte *out = (byte *)vstr.buf;
+// The decoder is a state machine, so that data can be fed to it in pieces.
+typedef struct _base64_decoder_t {
+    uint32_t shift;
+    uint8_t nbits; // Number of meaningful bits in shift
+    bool hadpad; // Had a pad character since last valid character
+    bool done; // Saw the end of the padding, so ignore the rest
+} base64_decoder_t;
 
-    uint shift = 0;
-    int nbits = 0; // Number of meaningful bits in shift
-    bool hadpad = false; // Had a pad character since last valid character
-    for (size_t i = 0; i < bufinfo.len; i++) {
-        if (in[i] == '=') {
-            if ((nbits == 2) || ((nbits == 4) && hadpad)) {
-                nbits = 0;
+// Decode the len characters at in to out, which has room for out_len bytes,
+// ignoring invalid characters, and return the number of bytes written.
+STATIC size_t base64_decode(base64_decoder_t *dec, const byte *in, size_t len, byte *out, size_t out_len) {
+    const byte *in_end = in + len;
+    byte *o = out;
+    byte *o_end = out + out_len;
+    while (in < in_end && !dec->done) {
+        // Take whole groups of 4 characters at a time while they line up.
+        if (dec->nbits == 0) {
+            while (in_end - in >= 4 && o_end - o >= 3
+                   && (in[0] | in[1] | in[2] | in[3]) < 128) {
+                byte a = base64_values[in[0]], b = base64_values[in[1]];
+                byte c = base64_values[in[2]], d = base64_values[in[3]];
+                if ((a | b | c | d) >= 64) {
+                    // one of them is a pad or invalid character
+                    break;
+                }
+                uint32_t w = a << 18 | b << 12 | c << 6 | d;
+                o[0] = w >> 16;
+                o[1] = w >> 8;
+                o[2] = w;
+                o += 3;
+                in += 4;
+            }
+            if (in == in_end) {
                 break;
             }
-            hadpad = true;
         }
 
-        int sextet = mod_binascii_sextet(in[i]);
-        if (sextet == -1) {
+        byte ch = *in++;
+        byte sextet = ch < 128 ? base64_values[ch] : 0xff;
+        if (sextet == 64) {
+            if ((dec->nbits == 2) || ((dec->nbits == 4) && dec->hadpad)) {
+                dec->nbits = 0;
+                dec->done = true;
+            }
+            dec->hadpad = true;
             continue;
         }
-        hadpad = false;
-        shift = (shift << 6) | sextet;
-        nbits += 6;
-
-        if (nbits >= 8) {
-            nbits -= 8;
-            out[vstr.len++] = (shift >> nbits) & 0xFF;
+        if (sextet >= 64) {
+            continue;
+        }
+        dec->hadpad = false;
+        dec->shift = (dec->shift << 6) | sextet;
+        dec->nbits += 6;
+        if (dec->nbits >= 8) {
+            if (o == o_end) {
+                mp_raise_ValueError(MP_ERROR_TEXT("buffer too small"));
+            }
+            dec->nbits -= 8;
+            *o++ = (dec->shift >> dec->nbits) & 0xFF;
         }
     }
+    return o - out;
+}
 
-    if (nbits) {
+STATIC void base64_decode_finish(base64_decoder_t *dec) {
+    if (dec->nbits) {
         mp_raise_ValueError(MP_ERROR_TEXT("incorrect padding"));
     }
+}
+
+STATIC mp_obj_t mod_binascii_a2b_base64(mp_obj_t data) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(data, &bufinfo, MP_BUFFER_READ);
 
+    vstr_t vstr;
+    vstr_init(&vstr, bufinfo.len * 3 / 4 + 1); // Potentially over-allocate
+    base64_decoder_t dec = {0};
+    vstr.len = base64_decode(&dec, bufinfo.buf, bufinfo.len, (byte *)vstr.buf, vstr.alloc);
+    base64_decode_finish(&dec);
     return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_binascii_a2b_base64_obj, mod_binascii_a2b_base64);
 
-STATIC mp_obj_t mod_binascii_b2a_base64(mp_obj_t data) {
+// Encode the len bytes at in to out, taking 3 bytes at a time and padding the
+// last group, and return the number of characters written.
+STATIC size_t base64_encode(const byte *in, size_t len, byte *out) {
+    byte *o = out;
+    for (; len >= 3; len -= 3, in += 3) {
+        uint32_t w = in[0] << 16 | in[1] << 8 | in[2];
+        o[0] = base64_alphabet[w >> 18];
+        o[1] = base64_alphabet[(w >> 12) & 0x3f];
+        o[2] = base64_alphabet[(w >> 6) & 0x3f];
+        o[3] = base64_alphabet[w & 0x3f];
+        o += 4;
+    }
+    if (len != 0) {
+        uint32_t w = in[0] << 16 | (len == 2 ? in[1] << 8 : 0);
+        o[0] = base64_alphabet[w >> 18];
+        o[1] = base64_alphabet[(w >> 12) & 0x3f];
+        o[2] = len == 2 ? base64_alphabet[(w >> 6) & 0x3f] : '=';
+        o[3] = '=';
+        o += 4;
+    }
+    return o - out;
+}
+
+STATIC size_t base64_encode_len(size_t len) {
+    return (len + 2) / 3 * 4;
+}
+
+STATIC mp_obj_t mod_binascii_b2a_base64(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_data, ARG_newline };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+        { MP_QSTR_newline, MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = true} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+    bool newline = args[ARG_newline].u_bool;
+
     mp_buffer_info_t bufinfo;
-    mp_get_buffer_raise(data, &bufinfo, MP_BUFFER_READ);
+    mp_get_buffer_raise(args[ARG_data].u_obj, &bufinfo, MP_BUFFER_READ);
 
     vstr_t vstr;
-    vstr_init_len(&vstr, ((bufinfo.len != 0) ? (((bufinfo.len - 1) / 3) + 1) * 4 : 0) + 1);
-
-    // First pass, we convert input buffer to numeric base 64 values
-    byte *in = bufinfo.buf, *out = (byte *)vstr.buf;
-    mp_uint_t i;
-    for (i = bufinfo.len; i >= 3; i -= 3) {
-        *out++ = (in[0] & 0xFC) >> 2;
-        *out++ = (in[0] & 0x03) << 4 | (in[1] & 0xF0) >> 4;
-        *out++ = (in[1] & 0x0F) << 2 | (in[2] & 0xC0) >> 6;
-        *out++ = in[2] & 0x3F;
-        in += 3;
+    vstr_init_len(&vstr, base64_encode_len(bufinfo.len) + newline);
+    base64_encode(bufinfo.buf, bufinfo.len, (byte *)vstr.buf);
+    if (newline) {
+        vstr.buf[vstr.len - 1] = '\n';
     }
-    if (i != 0) {
-        *out++ = (in[0] & 0xFC) >> 2;
-        if (i == 2) {
-            *out++ = (in[0] & 0x03) << 4 | (in[1] & 0xF0) >> 4;
-            *out++ = (in[1] & 0x0F) << 2;
-        } else {
-            *out++ = (in[0] & 0x03) << 4;
-            *out++ = 64;
-        }
-        *out = 64;
+    return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mod_binascii_b2a_base64_obj, 1, mod_binascii_b2a_base64);
+
+#if MICROPY_PY_UBINASCII_INTO
+
+STATIC void *binascii_get_out_buf(mp_obj_t buf_in, size_t len) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_WRITE);
+    if (bufinfo.len < len) {
+        mp_raise_ValueError(MP_ERROR_TEXT("buffer too small"));
     }
+    return bufinfo.buf;
+}
 
-    // Second pass, we convert number base 64 values to actual base64 ascii encoding
-    out = (byte *)vstr.buf;
-    for (mp_uint_t j = vstr.len - 1; j--;) {
-        if (*out < 26) {
-            *out += 'A';
-        } else if (*out < 52) {
-            *out += 'a' - 26;
-        } else if (*out < 62) {
-            *out += '0' - 52;
-        } else if (*out == 62) {
-            *out = '+';
-        } else if (*out == 63) {
-            *out = '/';
-        } else {
-            *out = '=';
-        }
-        out++;
+STATIC mp_obj_t mod_binascii_hexlify_into(size_t n_args, const mp_obj_t *args) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[0], &bufinfo, MP_BUFFER_READ);
+    int sep = binascii_hexlify_sep(n_args, args, 2);
+    size_t len = binascii_hexlify_len(bufinfo.len, sep);
+    binascii_hexlify(bufinfo.buf, bufinfo.len, sep, binascii_get_out_buf(args[1], len));
+    return MP_OBJ_NEW_SMALL_INT(len);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_binascii_hexlify_into_obj, 2, 3, mod_binascii_hexlify_into);
+
+STATIC mp_obj_t mod_binascii_unhexlify_into(mp_obj_t data, mp_obj_t buf) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(data, &bufinfo, MP_BUFFER_READ);
+    binascii_unhexlify(bufinfo.buf, bufinfo.len, binascii_get_out_buf(buf, bufinfo.len / 2));
+    return MP_OBJ_NEW_SMALL_INT(bufinfo.len / 2);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(mod_binascii_unhexlify_into_obj, mod_binascii_unhexlify_into);
+
+STATIC mp_obj_t mod_binascii_a2b_base64_into(mp_obj_t data, mp_obj_t buf) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(data, &bufinfo, MP_BUFFER_READ);
+    mp_buffer_info_t out_bufinfo;
+    mp_get_buffer_raise(buf, &out_bufinfo, MP_BUFFER_WRITE);
+    base64_decoder_t dec = {0};
+    size_t len = base64_decode(&dec, bufinfo.buf, bufinfo.len, out_bufinfo.buf, out_bufinfo.len);
+    base64_decode_finish(&dec);
+    return MP_OBJ_NEW_SMALL_INT(len);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(mod_binascii_a2b_base64_into_obj, mod_binascii_a2b_base64_into);
+
+STATIC mp_obj_t mod_binascii_b2a_base64_into(mp_obj_t data, mp_obj_t buf) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(data, &bufinfo, MP_BUFFER_READ);
+    size_t len = base64_encode_len(bufinfo.len);
+    base64_encode(bufinfo.buf, bufinfo.len, binascii_get_out_buf(buf, len));
+    return MP_OBJ_NEW_SMALL_INT(len);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(mod_binascii_b2a_base64_into_obj, mod_binascii_b2a_base64_into);
+
+// Base64Encoder and Base64Decoder convert data that arrives in pieces.  The
+// encoder keeps the bytes that don't make up a whole group of 3 until the
+// next update, or until finish pads them.
+typedef struct _mp_obj_base64_t {
+    mp_obj_base_t base;
+    union {
+        base64_decoder_t dec;
+        struct {
+            byte pending[2];
+            uint8_t n_pending;
+        } enc;
+    };
+} mp_obj_base64_t;
+
+STATIC mp_obj_t base64_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 0, 0, false);
+    mp_obj_base64_t *self = m_new0(mp_obj_base64_t, 1);
+    self->base.type = type;
+    return MP_OBJ_FROM_PTR(self);
+}
+
+STATIC mp_obj_t base64_encoder_update(mp_obj_t self_in, mp_obj_t data) {
+    mp_obj_base64_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(data, &bufinfo, MP_BUFFER_READ);
+    const byte *in = bufinfo.buf;
+    size_t len = bufinfo.len;
+
+    vstr_t vstr;
+    vstr_init_len(&vstr, (self->enc.n_pending + len) / 3 * 4);
+    byte *out = (byte *)vstr.buf;
+    if (self->enc.n_pending + len < 3) {
+        memcpy(self->enc.pending + self->enc.n_pending, in, len);
+        self->enc.n_pending += len;
+        len = 0;
+    } else if (self->enc.n_pending != 0) {
+        byte group[3];
+        size_t n = 3 - self->enc.n_pending;
+        memcpy(group, self->enc.pending, self->enc.n_pending);
+        memcpy(group + self->enc.n_pending, in, n);
+        out += base64_encode(group, 3, out);
+        in += n;
+        len -= n;
+        self->enc.n_pending = 0;
     }
-    *out = '\n';
+    size_t n_whole = len / 3 * 3;
+    base64_encode(in, n_whole, out);
+    memcpy(self->enc.pending + self->enc.n_pending, in + n_whole, len - n_whole);
+    self->enc.n_pending += len - n_whole;
     return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
 }
-STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_binascii_b2a_base64_obj, mod_binascii_b2a_base64);
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(base64_encoder_update_obj, base64_encoder_update);
+
+STATIC mp_obj_t base64_encoder_finish(mp_obj_t self_in) {
+    mp_obj_base64_t *self = MP_OBJ_TO_PTR(self_in);
+    byte out[4];
+    size_t len = base64_encode(self->enc.pending, self->enc.n_pending, out);
+    self->enc.n_pending = 0;
+    return mp_obj_new_bytes(out, len);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(base64_encoder_finish_obj, base64_encoder_finish);
+
+STATIC const mp_rom_map_elem_t base64_encoder_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_update), MP_ROM_PTR(&base64_encoder_update_obj) },
+    { MP_ROM_QSTR(MP_QSTR_finish), MP_ROM_PTR(&base64_encoder_finish_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(base64_encoder_locals_dict, base64_encoder_locals_dict_table);
+
+STATIC const mp_obj_type_t base64_encoder_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_Base64Encoder,
+    .make_new = base64_make_new,
+    .locals_dict = (void *)&base64_encoder_locals_dict,
+};
+
+STATIC mp_obj_t base64_decoder_update(mp_obj_t self_in, mp_obj_t data) {
+    mp_obj_base64_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(data, &bufinfo, MP_BUFFER_READ);
+    vstr_t vstr;
+    vstr_init(&vstr, (self->dec.nbits + bufinfo.len * 6) / 8 + 1);
+    vstr.len = base64_decode(&self->dec, bufinfo.buf, bufinfo.len, (byte *)vstr.buf, vstr.alloc);
+    return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(base64_decoder_update_obj, base64_decoder_update);
+
+STATIC mp_obj_t base64_decoder_finish(mp_obj_t self_in) {
+    mp_obj_base64_t *self = MP_OBJ_TO_PTR(self_in);
+    base64_decoder_t dec = self->dec;
+    memset(&self->dec, 0, sizeof(self->dec));
+    base64_decode_finish(&dec);
+    return mp_const_empty_bytes;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(base64_decoder_finish_obj, base64_decoder_finish);
+
+STATIC const mp_rom_map_elem_t base64_decoder_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_update), MP_ROM_PTR(&base64_decoder_update_obj) },
+    { MP_ROM_QSTR(MP_QSTR_finish), MP_ROM_PTR(&base64_decoder_finish_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(base64_decoder_locals_dict, base64_decoder_locals_dict_table);
+
+STATIC const mp_obj_type_t base64_decoder_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_Base64Decoder,
+    .make_new = base64_make_new,
+    .locals_dict = (void *)&base64_decoder_locals_dict,
+};
+
+#endif // MICROPY_PY_UBINASCII_INTO
 
 #if MICROPY_PY_UBINASCII_CRC32
 #include "uzlib/tinf.h"
 
+#if MICROPY_PY_UBINASCII_CRC32_HW
+uint32_t mp_hal_crc32(uint32_t crc, const void *buf, size_t len);
+#endif
+
 STATIC mp_obj_t mod_binascii_crc32(size_t n_args, const mp_obj_t *args) {
     mp_buffer_info_t bufinfo;
     mp_get_buffer_raise(args[0], &bufinfo, MP_BUFFER_READ);
     uint32_t crc = (n_args > 1) ? mp_obj_get_int_truncated(args[1]) : 0;
-    crc = uzlib_crc32(bufinfo.buf, bufinfo.len, crc ^ 0xffffffff);
-    return mp_obj_new_int_from_uint(crc ^ 0xffffffff);
+    #if MICROPY_PY_UBINASCII_CRC32_HW
+    crc = mp_hal_crc32(crc, bufinfo.buf, bufinfo.len);
+    #else
+    crc = uzlib_crc32(bufinfo.buf, bufinfo.len, crc ^ 0xffffffff) ^ 0xffffffff;
+    #endif
+    return mp_obj_new_int_from_uint(crc);
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_binascii_crc32_obj, 1, 2, mod_binascii_crc32);
 #endif
@@ -236,6 +463,14 @@ STATIC const mp_rom_map_elem_t mp_module_binascii_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_unhexlify), MP_ROM_PTR(&mod_binascii_unhexlify_obj) },
     { MP_ROM_QSTR(MP_QSTR_a2b_base64), MP_ROM_PTR(&mod_binascii_a2b_base64_obj) },
     { MP_ROM_QSTR(MP_QSTR_b2a_base64), MP_ROM_PTR(&mod_binascii_b2a_base64_obj) },
+    #if MICROPY_PY_UBINASCII_INTO
+    { MP_ROM_QSTR(MP_QSTR_hexlify_into), MP_ROM_PTR(&mod_binascii_hexlify_into_obj) },
+    { MP_ROM_QSTR(MP_QSTR_unhexlify_into), MP_ROM_PTR(&mod_binascii_unhexlify_into_obj) },
+    { MP_ROM_QSTR(MP_QSTR_a2b_base64_into), MP_ROM_PTR(&mod_binascii_a2b_base64_into_obj) },
+    { MP_ROM_QSTR(MP_QSTR_b2a_base64_into), MP_ROM_PTR(&mod_binascii_b2a_base64_into_obj) },
+    { MP_ROM_QSTR(MP_QSTR_Base64Encoder), MP_ROM_PTR(&base64_encoder_type) },
+    { MP_ROM_QSTR(MP_QSTR_Base64Decoder), MP_ROM_PTR(&base64_decoder_type) },
+    #endif
     #if MICROPY_PY_UBINASCII_CRC32
     { MP_ROM_QSTR(MP_QSTR_crc32), MP_ROM_PTR(&mod_binascii_crc32_obj) },
     #endif
@@ -0,0 +1,554 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "py/objarray.h"
+#include "py/objint.h"
+#include "py/objlist.h"
+#include "py/objstr.h"
+#include "py/runtime.h"
+#include "py/smallint.h"
+#include "py/stackctrl.h"
+#include "py/stream.h"
+
+#if MICROPY_PY_UCBOR
+
+// Encoding and decoding of CBOR, as specified by RFC 8949.  Integers, floats,
+// None, bools, str, bytes, lists/tuples and dicts are supported.  Tags are
+// not interpreted when decoding, the tagged item is returned as is.
+
+// Major types, in the top 3 bits of the initial byte
+#define CBOR_UINT (0)
+#define CBOR_NINT (1)
+#define CBOR_BYTES (2)
+#define CBOR_TEXT (3)
+#define CBOR_ARRAY (4)
+#define CBOR_MAP (5)
+#define CBOR_TAG (6)
+#define CBOR_SIMPLE (7)
+
+// Values of the low 5 bits of the initial byte
+#define CBOR_AI_1BYTE (24)
+#define CBOR_AI_8BYTE (27)
+#define CBOR_AI_INDEFINITE (31)
+
+// Complete initial bytes of major type 7
+#define CBOR_FALSE (0xf4)
+#define CBOR_TRUE (0xf5)
+#define CBOR_NULL (0xf6)
+#define CBOR_UNDEFINED (0xf7)
+#define CBOR_FLOAT16 (0xf9)
+#define CBOR_FLOAT32 (0xfa)
+#define CBOR_FLOAT64 (0xfb)
+#define CBOR_BREAK (0xff)
+
+#define CBOR_DUMP_BUF_SIZE (128)
+
+/******************************************************************************/
+// Encoder
+
+typedef struct _cbor_enc_t {
+    vstr_t vstr;
+    mp_obj_t stream; // MP_OBJ_NULL to collect all output in vstr
+} cbor_enc_t;
+
+STATIC void cbor_enc_flush(cbor_enc_t *e) {
+    if (e->vstr.len > 0) {
+        mp_stream_write(e->stream, e->vstr.buf, e->vstr.len, MP_STREAM_RW_WRITE);
+        e->vstr.len = 0;
+    }
+}
+
+STATIC void cbor_enc_write(cbor_enc_t *e, const void *data, size_t len) {
+    if (e->stream != MP_OBJ_NULL && e->vstr.len + len > CBOR_DUMP_BUF_SIZE) {
+        cbor_enc_flush(e);
+        if (len > CBOR_DUMP_BUF_SIZE) {
+            mp_stream_write(e->stream, data, len, MP_STREAM_RW_WRITE);
+            return;
+        }
+    }
+    vstr_add_strn(&e->vstr, data, len);
+}
+
+STATIC void cbor_enc_be(byte *buf, size_t n, uint64_t val) {
+    for (size_t i = n; i > 0; --i) {
+        buf[i - 1] = val;
+        val >>= 8;
+    }
+}
+
+// Write an initial byte with the given major type and argument
+STATIC void cbor_enc_head(cbor_enc_t *e, byte major, uint64_t val) {
+    byte buf[9];
+    size_t n;
+    if (val < CBOR_AI_1BYTE) {
+        buf[0] = major << 5 | val;
+        n = 0;
+    } else if (val <= 0xff) {
+        buf[0] = major << 5 | CBOR_AI_1BYTE;
+        n = 1;
+    } else if (val <= 0xffff) {
+        buf[0] = major << 5 | (CBOR_AI_1BYTE + 1);
+        n = 2;
+    } else if (val <= 0xffffffff) {
+        buf[0] = major << 5 | (CBOR_AI_1BYTE + 2);
+        n = 4;
+    } else {
+        buf[0] = major << 5 | CBOR_AI_8BYTE;
+        n = 8;
+    }
+    cbor_enc_be(buf + 1, n, val);
+    cbor_enc_write(e, buf, 1 + n);
+}
+
+STATIC void cbor_enc_byte(cbor_enc_t *e, byte b) {
+    cbor_enc_write(e, &b, 1);
+}
+
+#if MICROPY_LONGINT_IMPL != MICROPY_LONGINT_IMPL_NONE
+STATIC void cbor_enc_bigint(cbor_enc_t *e, mp_obj_t obj) {
+    byte major = CBOR_UINT;
+    if (mp_obj_int_sign(obj) < 0) {
+        // a negative integer n is encoded as -1 - n
+        major = CBOR_NINT;
+        obj = mp_unary_op(MP_UNARY_OP_INVERT, obj);
+    }
+    #if MICROPY_LONGINT_IMPL == MICROPY_LONGINT_IMPL_MPZ
+    if (mp_binary_op(MP_BINARY_OP_MORE, obj, mp_obj_new_int_from_ull(UINT64_MAX)) == mp_const_true) {
+        mp_raise_msg(&mp_type_OverflowError, MP_ERROR_TEXT("int too big"));
+    }
+    #endif
+    byte buf[8];
+    mp_obj_int_to_bytes_impl(obj, true, sizeof(buf), buf);
+    uint64_t val = 0;
+    for (size_t i = 0; i < sizeof(buf); ++i) {
+        val = val << 8 | buf[i];
+    }
+    cbor_enc_head(e, major, val);
+}
+#endif
+
+#if MICROPY_PY_BUILTINS_FLOAT
+// Floats are written in single precision if that doesn't lose anything
+STATIC void cbor_enc_float(cbor_enc_t *e, mp_float_t f) {
+    byte buf[9];
+    float f32 = (float)f;
+    #if MICROPY_FLOAT_IMPL == MICROPY_FLOAT_IMPL_DOUBLE
+    if ((mp_float_t)f32 != f) {
+        union {
+            double f;
+            uint64_t i;
+        } u = {f};
+        buf[0] = CBOR_FLOAT64;
+        cbor_enc_be(buf + 1, 8, u.i);
+        cbor_enc_write(e, buf, 9);
+        return;
+    }
+    #endif
+    union {
+        float f;
+        uint32_t i;
+    } u = {f32};
+    buf[0] = CBOR_FLOAT32;
+    cbor_enc_be(buf + 1, 4, u.i);
+    cbor_enc_write(e, buf, 5);
+}
+#endif
+
+STATIC void cbor_enc_obj(cbor_enc_t *e, mp_obj_t obj) {
+    MP_STACK_CHECK();
+    if (mp_obj_is_small_int(obj)) {
+        mp_int_t val = MP_OBJ_SMALL_INT_VALUE(obj);
+        if (val >= 0) {
+            cbor_enc_head(e, CBOR_UINT, val);
+        } else {
+            cbor_enc_head(e, CBOR_NINT, -1 - val);
+        }
+    } else if (obj == mp_const_none) {
+        cbor_enc_byte(e, CBOR_NULL);
+    } else if (obj == mp_const_false) {
+        cbor_enc_byte(e, CBOR_FALSE);
+    } else if (obj == mp_const_true) {
+        cbor_enc_byte(e, CBOR_TRUE);
+    } else if (mp_obj_is_str(obj)) {
+        GET_STR_DATA_LEN(obj, str, len);
+        cbor_enc_head(e, CBOR_TEXT, len);
+        cbor_enc_write(e, str, len);
+    #if MICROPY_PY_BUILTINS_FLOAT
+    } else if (mp_obj_is_float(obj)) {
+        cbor_enc_float(e, mp_obj_float_get(obj));
+    #endif
+    #if MICROPY_LONGINT_IMPL != MICROPY_LONGINT_IMPL_NONE
+    } else if (mp_obj_is_type(obj, &mp_type_int)) {
+        cbor_enc_bigint(e, obj);
+    #endif
+    } else if (mp_obj_is_type(obj, &mp_type_bytes)
+               || mp_obj_is_type(obj, &mp_type_bytearray)
+               #if MICROPY_PY_BUILTINS_MEMORYVIEW
+               || mp_obj_is_type(obj, &mp_type_memoryview)
+               #endif
+               ) {
+        mp_buffer_info_t bufinfo;
+        mp_get_buffer_raise(obj, &bufinfo, MP_BUFFER_READ);
+        cbor_enc_head(e, CBOR_BYTES, bufinfo.len);
+        cbor_enc_write(e, bufinfo.buf, bufinfo.len);
+    } else if (mp_obj_is_type(obj, &mp_type_list) || mp_obj_is_type(obj, &mp_type_tuple)) {
+        size_t len;
+        mp_obj_t *items;
+        mp_obj_get_array(obj, &len, &items);
+        cbor_enc_head(e, CBOR_ARRAY, len);
+        for (size_t i = 0; i < len; ++i) {
+            cbor_enc_obj(e, items[i]);
+        }
+    } else if (mp_obj_is_dict_or_ordereddict(obj)) {
+        mp_map_t *map = mp_obj_dict_get_map(obj);
+        cbor_enc_head(e, CBOR_MAP, map->used);
+        for (size_t i = 0; i < map->alloc; ++i) {
+            if (mp_map_slot_is_filled(map, i)) {
+                cbor_enc_obj(e, map->table[i].key);
+                cbor_enc_obj(e, map->table[i].value);
+            }
+        }
+    } else {
+        mp_raise_msg_varg(&mp_type_TypeError, MP_ERROR_TEXT("can't convert %s to CBOR"), mp_obj_get_type_str(obj));
+    }
+}
+
+STATIC mp_obj_t mod_ucbor_dump(mp_obj_t obj, mp_obj_t stream) {
+    mp_get_stream_raise(stream, MP_STREAM_OP_WRITE);
+    cbor_enc_t e;
+    vstr_init(&e.vstr, CBOR_DUMP_BUF_SIZE);
+    e.stream = stream;
+    cbor_enc_obj(&e, obj);
+    cbor_enc_flush(&e);
+    vstr_clear(&e.vstr);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(mod_ucbor_dump_obj, mod_ucbor_dump);
+
+STATIC mp_obj_t mod_ucbor_dumps(mp_obj_t obj) {
+    cbor_enc_t e;
+    vstr_init(&e.vstr, 16);
+    e.stream = MP_OBJ_NULL;
+    cbor_enc_obj(&e, obj);
+    return mp_obj_new_str_from_vstr(&mp_type_bytes, &e.vstr);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_ucbor_dumps_obj, mod_ucbor_dumps);
+
+/******************************************************************************/
+// Decoder
+
+typedef struct _cbor_dec_t {
+    const byte *base; // start of the input buffer, referenced by memoryviews
+    const byte *cur;
+    const byte *end;
+    mp_obj_t stream; // MP_OBJ_NULL when decoding from a buffer
+    bool zerocopy;
+} cbor_dec_t;
+
+STATIC NORETURN void cbor_dec_error(void) {
+    mp_raise_ValueError(MP_ERROR_TEXT("invalid CBOR"));
+}
+
+STATIC void cbor_dec_read(cbor_dec_t *d, void *buf, size_t len) {
+    if (d->stream == MP_OBJ_NULL) {
+        if ((size_t)(d->end - d->cur) < len) {
+            cbor_dec_error();
+        }
+        memcpy(buf, d->cur, len);
+        d->cur += len;
+    } else {
+        int errcode;
+        mp_uint_t out_sz = mp_stream_rw(d->stream, buf, len, &errcode, MP_STREAM_RW_READ);
+        if (errcode != 0) {
+            mp_raise_OSError(errcode);
+        }
+        if (out_sz < len) {
+            // premature end of stream
+            cbor_dec_error();
+        }
+    }
+}
+
+STATIC byte cbor_dec_byte(cbor_dec_t *d) {
+    byte b;
+    cbor_dec_read(d, &b, 1);
+    return b;
+}
+
+// Read the argument that follows an initial byte with low 5 bits ai
+STATIC uint64_t cbor_dec_arg(cbor_dec_t *d, byte ai) {
+    if (ai < CBOR_AI_1BYTE) {
+        return ai;
+    }
+    if (ai > CBOR_AI_8BYTE) {
+        cbor_dec_error();
+    }
+    byte buf[8];
+    size_t n = 1 << (ai - CBOR_AI_1BYTE);
+    cbor_dec_read(d, buf, n);
+    uint64_t val = 0;
+    for (size_t i = 0; i < n; ++i) {
+        val = val << 8 | buf[i];
+    }
+    return val;
+}
+
+// Check that len items of at least one byte each could follow, to avoid
+// allocating memory for a length that the input can't hold
+STATIC size_t cbor_dec_len(cbor_dec_t *d, uint64_t len) {
+    if (len > SIZE_MAX || (d->stream == MP_OBJ_NULL && len > (size_t)(d->end - d->cur))) {
+        cbor_dec_error();
+    }
+    return len;
+}
+
+#if MICROPY_PY_BUILTINS_FLOAT
+STATIC mp_obj_t cbor_dec_float(cbor_dec_t *d, byte ib) {
+    byte buf[8];
+    if (ib == CBOR_FLOAT64) {
+        cbor_dec_read(d, buf, 8);
+        union {
+            uint64_t i;
+            double f;
+        } u = {0};
+        for (size_t i = 0; i < 8; ++i) {
+            u.i = u.i << 8 | buf[i];
+        }
+        return mp_obj_new_float((mp_float_t)u.f);
+    }
+    union {
+        uint32_t i;
+        float f;
+    } u = {0};
+    if (ib == CBOR_FLOAT32) {
+        cbor_dec_read(d, buf, 4);
+        u.i = (uint32_t)buf[0] << 24 | buf[1] << 16 | buf[2] << 8 | buf[3];
+    } else {
+        // convert half precision to single precision
+        cbor_dec_read(d, buf, 2);
+        uint32_t sign = (uint32_t)(buf[0] & 0x80) << 24;
+        int exp = (buf[0] >> 2) & 0x1f;
+        uint32_t mant = (buf[0] & 3) << 8 | buf[1];
+        if (exp == 0x1f) {
+            u.i = sign | 0x7f800000 | mant << 13;
+        } else if (exp != 0) {
+            u.i = sign | (exp + 112) << 23 | mant << 13;
+        } else if (mant != 0) {
+            // subnormal halves are normal singles
+            exp = 113;
+            while (!(mant & 0x400)) {
+                mant <<= 1;
+                --exp;
+            }
+            u.i = sign | exp << 23 | (mant & 0x3ff) << 13;
+        } else {
+            u.i = sign;
+        }
+    }
+    return mp_obj_new_float((mp_float_t)u.f);
+}
+#endif
+
+STATIC mp_obj_t cbor_dec_item(cbor_dec_t *d, byte ib);
+
+STATIC mp_obj_t cbor_dec_obj(cbor_dec_t *d) {
+    return cbor_dec_item(d, cbor_dec_byte(d));
+}
+
+STATIC mp_obj_t cbor_dec_string(cbor_dec_t *d, byte major, size_t len) {
+    const mp_obj_type_t *type = major == CBOR_TEXT ? &mp_type_str : &mp_type_bytes;
+    if (d->stream == MP_OBJ_NULL) {
+        const byte *data = d->cur;
+        d->cur += len;
+        #if MICROPY_PY_BUILTINS_MEMORYVIEW
+        if (d->zerocopy && major == CBOR_BYTES) {
+            mp_obj_array_t *mv = m_new_obj(mp_obj_array_t);
+            mp_obj_memoryview_init(mv, 'B', data - d->base, len, (void *)d->base);
+            return MP_OBJ_FROM_PTR(mv);
+        }
+        #endif
+        if (major == CBOR_TEXT) {
+            // short strings that already exist as qstrs, like dict keys, aren't copied
+            return mp_obj_new_str((const char *)data, len);
+        }
+        return mp_obj_new_bytes(data, len);
+    }
+    vstr_t vstr;
+    vstr_init_len(&vstr, len);
+    cbor_dec_read(d, vstr.buf, len);
+    return mp_obj_new_str_from_vstr(type, &vstr);
+}
+
+STATIC mp_obj_t cbor_dec_indefinite(cbor_dec_t *d, byte major) {
+    if (major == CBOR_BYTES || major == CBOR_TEXT) {
+        // the string is made of definite-length chunks of the same major type
+        vstr_t vstr;
+        vstr_init(&vstr, 16);
+        for (byte ib; (ib = cbor_dec_byte(d)) != CBOR_BREAK;) {
+            if (ib >> 5 != major || (ib & 0x1f) == CBOR_AI_INDEFINITE) {
+                cbor_dec_error();
+            }
+            size_t len = cbor_dec_len(d, cbor_dec_arg(d, ib & 0x1f));
+            cbor_dec_read(d, vstr_add_len(&vstr, len), len);
+        }
+        return mp_obj_new_str_from_vstr(major == CBOR_TEXT ? &mp_type_str : &mp_type_bytes, &vstr);
+    } else if (major == CBOR_ARRAY) {
+        mp_obj_t list = mp_obj_new_list(0, NULL);
+        for (byte ib; (ib = cbor_dec_byte(d)) != CBOR_BREAK;) {
+            mp_obj_list_append(list, cbor_dec_item(d, ib));
+        }
+        return list;
+    } else if (major == CBOR_MAP) {
+        mp_obj_t dict = mp_obj_new_dict(0);
+        for (byte ib; (ib = cbor_dec_byte(d)) != CBOR_BREAK;) {
+            mp_obj_t key = mp_obj_str_intern_key(cbor_dec_item(d, ib));
+            mp_obj_dict_store(dict, key, cbor_dec_obj(d));
+        }
+        return dict;
+    }
+    cbor_dec_error();
+}
+
+// Decode the item that starts with initial byte ib
+STATIC mp_obj_t cbor_dec_item(cbor_dec_t *d, byte ib) {
+    MP_STACK_CHECK();
+    byte major = ib >> 5;
+    byte ai = ib & 0x1f;
+    if (major == CBOR_SIMPLE) {
+        switch (ib) {
+            case CBOR_FALSE:
+                return mp_const_false;
+            case CBOR_TRUE:
+                return mp_const_true;
+            case CBOR_NULL:
+            case CBOR_UNDEFINED:
+                return mp_const_none;
+            #if MICROPY_PY_BUILTINS_FLOAT
+            case CBOR_FLOAT16:
+            case CBOR_FLOAT32:
+            case CBOR_FLOAT64:
+                return cbor_dec_float(d, ib);
+            #endif
+            default:
+                // other simple values, and a break outside an indefinite item
+                cbor_dec_error();
+        }
+    }
+    if (ai == CBOR_AI_INDEFINITE) {
+        return cbor_dec_indefinite(d, major);
+    }
+    uint64_t arg = cbor_dec_arg(d, ai);
+    switch (major) {
+        case CBOR_UINT:
+            if (arg <= (uint64_t)MP_SMALL_INT_MAX) {
+                return MP_OBJ_NEW_SMALL_INT(arg);
+            }
+            return mp_obj_new_int_from_ull(arg);
+        case CBOR_NINT:
+            if (arg <= (uint64_t)MP_SMALL_INT_MAX) {
+                return MP_OBJ_NEW_SMALL_INT(-1 - (mp_int_t)arg);
+            }
+            return mp_unary_op(MP_UNARY_OP_INVERT, mp_obj_new_int_from_ull(arg));
+        case CBOR_BYTES:
+        case CBOR_TEXT:
+            return cbor_dec_string(d, major, cbor_dec_len(d, arg));
+        case CBOR_ARRAY: {
+            size_t len = cbor_dec_len(d, arg);
+            mp_obj_list_t *list = MP_OBJ_TO_PTR(mp_obj_new_list(len, NULL));
+            for (size_t i = 0; i < len; ++i) {
+                list->items[i] = mp_const_none;
+            }
+            for (size_t i = 0; i < len; ++i) {
+                list->items[i] = cbor_dec_obj(d);
+            }
+            return MP_OBJ_FROM_PTR(list);
+        }
+        case CBOR_MAP: {
+            size_t len = cbor_dec_len(d, arg);
+            mp_obj_t dict = mp_obj_new_dict(len);
+            for (size_t i = 0; i < len; ++i) {
+                mp_obj_t key = mp_obj_str_intern_key(cbor_dec_obj(d));
+                mp_obj_dict_store(dict, key, cbor_dec_obj(d));
+            }
+            return dict;
+        }
+        default:
+            // a tag: the tagged item is returned without interpretation
+            return cbor_dec_obj(d);
+    }
+}
+
+STATIC mp_obj_t mod_ucbor_load(mp_obj_t stream) {
+    mp_get_stream_raise(stream, MP_STREAM_OP_READ);
+    cbor_dec_t d = {NULL, NULL, NULL, stream, false};
+    return cbor_dec_obj(&d);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_ucbor_load_obj, mod_ucbor_load);
+
+STATIC mp_obj_t mod_ucbor_loads(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_data, ARG_zerocopy };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_data, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_zerocopy, MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = false} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[ARG_data].u_obj, &bufinfo, MP_BUFFER_READ);
+    cbor_dec_t d;
+    d.base = bufinfo.buf;
+    d.cur = d.base;
+    d.end = d.base + bufinfo.len;
+    d.stream = MP_OBJ_NULL;
+    d.zerocopy = args[ARG_zerocopy].u_bool;
+    mp_obj_t obj = cbor_dec_obj(&d);
+    if (d.cur != d.end) {
+        // trailing data
+        cbor_dec_error();
+    }
+    return obj;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mod_ucbor_loads_obj, 1, mod_ucbor_loads);
+
+STATIC const mp_rom_map_elem_t mp_module_ucbor_globals_table[] = {
+    { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_ucbor) },
+    { MP_ROM_QSTR(MP_QSTR_dump), MP_ROM_PTR(&mod_ucbor_dump_obj) },
+    { MP_ROM_QSTR(MP_QSTR_dumps), MP_ROM_PTR(&mod_ucbor_dumps_obj) },
+    { MP_ROM_QSTR(MP_QSTR_load), MP_ROM_PTR(&mod_ucbor_load_obj) },
+    { MP_ROM_QSTR(MP_QSTR_loads), MP_ROM_PTR(&mod_ucbor_loads_obj) },
+};
+
+STATIC MP_DEFINE_CONST_DICT(mp_module_ucbor_globals, mp_module_ucbor_globals_table);
+
+const mp_obj_module_t mp_module_ucbor = {
+    .base = { &mp_type_module },
+    .globals = (mp_obj_dict_t *)&mp_module_ucbor_globals,
+};
+
+#endif // MICROPY_PY_UCBOR
@@ -31,6 +31,7 @@
 #include "py/runtime.h"
 #include "py/objtuple.h"
 #include "py/binary.h"
+#include "py/stackctrl.h"
 
 #if MICROPY_PY_UCTYPES
 
@@ -87,30 +88,83 @@ typedef struct _mp_obj_uctypes_struct_t {
     mp_obj_t desc;
     byte *addr;
     uint32_t flags;
+    #if MICROPY_PY_UCTYPES_COMPILE
+    // With a compiled descriptor, the objects for aggregate fields
+    mp_obj_t children[];
+    #endif
 } mp_obj_uctypes_struct_t;
 
+#if MICROPY_PY_UCTYPES_COMPILE
+
+// A compiled descriptor holds the fields of a struct descriptor in a table
+// ordered by offset, so that attribute access doesn't go through the dict and
+// the objects for aggregate fields can be kept by each struct.  Struct and
+// array descriptors within it are compiled too, but not pointed-to ones, as
+// those may refer back to the descriptor.
+typedef struct _uctypes_field_t {
+    qstr name;
+    size_t child; // index into the children of a struct, for aggregates
+    mp_obj_t desc; // small int for a scalar, compiled tuple for an aggregate
+} uctypes_field_t;
+
+typedef struct _mp_obj_uctypes_desc_t {
+    mp_obj_base_t base;
+    mp_obj_t dict; // descriptor that this was compiled from
+    mp_uint_t size[2]; // indexed by layout_type == LAYOUT_NATIVE
+    mp_uint_t max_field_size;
+    size_t n_fields;
+    size_t n_children;
+    uctypes_field_t fields[];
+} mp_obj_uctypes_desc_t;
+
+STATIC const mp_obj_type_t uctypes_desc_type;
+
+#define IS_COMPILED_DESC(desc) (mp_obj_is_type((desc), &uctypes_desc_type))
+
+#endif
+
 STATIC NORETURN void syntax_error(void) {
     mp_raise_TypeError(MP_ERROR_TEXT("syntax error in uctypes descriptor"));
 }
 
-STATIC mp_obj_t uctypes_struct_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
-    mp_arg_check_num(n_args, n_kw, 2, 3, false);
+STATIC mp_obj_t uctypes_struct_new(const mp_obj_type_t *type, mp_obj_t desc, byte *addr, uint32_t flags) {
+    #if MICROPY_PY_UCTYPES_COMPILE
+    size_t n_children = 0;
+    if (IS_COMPILED_DESC(desc)) {
+        n_children = ((mp_obj_uctypes_desc_t *)MP_OBJ_TO_PTR(desc))->n_children;
+    }
+    mp_obj_uctypes_struct_t *o = m_new_obj_var(mp_obj_uctypes_struct_t, mp_obj_t, n_children);
+    for (size_t i = 0; i < n_children; ++i) {
+        o->children[i] = MP_OBJ_NULL;
+    }
+    #else
     mp_obj_uctypes_struct_t *o = m_new_obj(mp_obj_uctypes_struct_t);
+    #endif
     o->base.type = type;
-    o->addr = (void *)(uintptr_t)mp_obj_int_get_truncated(args[0]);
-    o->desc = args[1];
-    o->flags = LAYOUT_NATIVE;
+    o->desc = desc;
+    o->addr = addr;
+    o->flags = flags;
+    return MP_OBJ_FROM_PTR(o);
+}
+
+STATIC mp_obj_t uctypes_struct_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 2, 3, false);
+    uint32_t flags = LAYOUT_NATIVE;
     if (n_args == 3) {
-        o->flags = mp_obj_get_int(args[2]);
+        flags = mp_obj_get_int(args[2]);
     }
-    return MP_OBJ_FROM_PTR(o);
+    return uctypes_struct_new(type, args[1], (void *)(uintptr_t)mp_obj_int_get_truncated(args[0]), flags);
 }
 
 STATIC void uctypes_struct_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
     (void)kind;
     mp_obj_uctypes_struct_t *self = MP_OBJ_TO_PTR(self_in);
     const char *typen = "unk";
-    if (mp_obj_is_dict_or_ordereddict(self->desc)) {
+    if (mp_obj_is_dict_or_ordereddict(self->desc)
+        #if MICROPY_PY_UCTYPES_COMPILE
+        || IS_COMPILED_DESC(self->desc)
+        #endif
+        ) {
         typen = "STRUCT";
     } else if (mp_obj_is_type(self->desc, &mp_type_tuple)) {
         mp_obj_tuple_t *t = MP_OBJ_TO_PTR(self->desc);
@@ -183,6 +237,16 @@ STATIC mp_uint_t uctypes_struct_agg_size(mp_obj_tuple_t *t, int layout_type, mp_
 }
 
 STATIC mp_uint_t uctypes_struct_size(mp_obj_t desc_in, int layout_type, mp_uint_t *max_field_size) {
+    #if MICROPY_PY_UCTYPES_COMPILE
+    if (IS_COMPILED_DESC(desc_in)) {
+        mp_obj_uctypes_desc_t *d = MP_OBJ_TO_PTR(desc_in);
+        if (d->max_field_size > *max_field_size) {
+            *max_field_size = d->max_field_size;
+        }
+        return d->size[layout_type == LAYOUT_NATIVE];
+    }
+    #endif
+
     if (!mp_obj_is_dict_or_ordereddict(desc_in)) {
         if (mp_obj_is_type(desc_in, &mp_type_tuple)) {
             return uctypes_struct_agg_size((mp_obj_tuple_t *)MP_OBJ_TO_PTR(desc_in), layout_type, max_field_size);
@@ -265,6 +329,103 @@ STATIC mp_obj_t uctypes_struct_sizeof(size_t n_args, const mp_obj_t *args) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(uctypes_struct_sizeof_obj, 1, 2, uctypes_struct_sizeof);
 
+#if MICROPY_PY_UCTYPES_COMPILE
+
+// Position of a field in bits, to order the fields of a compiled descriptor
+STATIC uint64_t uctypes_field_pos(mp_obj_t desc) {
+    if (mp_obj_is_small_int(desc)) {
+        mp_uint_t offset = MP_OBJ_SMALL_INT_VALUE(desc);
+        mp_uint_t val_type = GET_TYPE(offset, VAL_TYPE_BITS);
+        offset &= VALUE_MASK(VAL_TYPE_BITS);
+        if (val_type >= BFUINT8 && val_type <= BFINT32) {
+            return (uint64_t)(offset & ((1 << OFFSET_BITS) - 1)) * 32 + ((offset >> OFFSET_BITS) & 31);
+        }
+        return (uint64_t)offset * 32;
+    }
+    mp_obj_tuple_t *t = MP_OBJ_TO_PTR(desc);
+    return (uint64_t)(MP_OBJ_SMALL_INT_VALUE(t->items[0]) & VALUE_MASK(AGG_TYPE_BITS)) * 32;
+}
+
+STATIC mp_obj_t uctypes_compile_desc(mp_obj_t desc_in);
+
+// Compile the struct, or array element, descriptor within an aggregate descriptor
+STATIC mp_obj_t uctypes_compile_agg(mp_obj_t desc_in) {
+    mp_obj_tuple_t *t = MP_OBJ_TO_PTR(desc_in);
+    if (t->len < 2 || !mp_obj_is_small_int(t->items[0])) {
+        syntax_error();
+    }
+    mp_uint_t agg_type = GET_TYPE(MP_OBJ_SMALL_INT_VALUE(t->items[0]), AGG_TYPE_BITS);
+    size_t sub;
+    if (agg_type == STRUCT) {
+        sub = 1;
+    } else if (agg_type == ARRAY && t->len == 3) {
+        sub = 2;
+    } else {
+        return desc_in;
+    }
+    mp_obj_tuple_t *c = MP_OBJ_TO_PTR(mp_obj_new_tuple(t->len, t->items));
+    c->items[sub] = uctypes_compile_desc(t->items[sub]);
+    return MP_OBJ_FROM_PTR(c);
+}
+
+STATIC mp_obj_t uctypes_compile_desc(mp_obj_t desc_in) {
+    MP_STACK_CHECK();
+    if (IS_COMPILED_DESC(desc_in)) {
+        return desc_in;
+    }
+    if (!mp_obj_is_dict_or_ordereddict(desc_in)) {
+        syntax_error();
+    }
+
+    mp_map_t *map = mp_obj_dict_get_map(desc_in);
+    mp_obj_uctypes_desc_t *d = m_new_obj_var(mp_obj_uctypes_desc_t, uctypes_field_t, map->used);
+    d->base.type = &uctypes_desc_type;
+    d->dict = desc_in;
+    d->n_fields = 0;
+    d->n_children = 0;
+    for (size_t i = 0; i < map->alloc; i++) {
+        if (mp_map_slot_is_filled(map, i)) {
+            uctypes_field_t f;
+            f.name = mp_obj_str_get_qstr(map->table[i].key);
+            f.child = 0;
+            f.desc = map->table[i].value;
+            if (mp_obj_is_type(f.desc, &mp_type_tuple)) {
+                f.desc = uctypes_compile_agg(f.desc);
+                f.child = d->n_children++;
+            } else if (!mp_obj_is_small_int(f.desc)) {
+                syntax_error();
+            }
+            // insert the field in order of position
+            uint64_t pos = uctypes_field_pos(f.desc);
+            size_t j = d->n_fields++;
+            for (; j > 0 && uctypes_field_pos(d->fields[j - 1].desc) > pos; --j) {
+                d->fields[j] = d->fields[j - 1];
+            }
+            d->fields[j] = f;
+        }
+    }
+
+    d->max_field_size = 0;
+    d->size[1] = uctypes_struct_size(desc_in, LAYOUT_NATIVE, &d->max_field_size);
+    mp_uint_t max_field_size = 0;
+    d->size[0] = uctypes_struct_size(desc_in, LAYOUT_LITTLE_ENDIAN, &max_field_size);
+    return MP_OBJ_FROM_PTR(d);
+}
+
+// compile()
+// Return a compiled form of a struct descriptor, for faster field access.
+STATIC mp_obj_t uctypes_compile(mp_obj_t desc_in) {
+    return uctypes_compile_desc(desc_in);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(uctypes_compile_obj, uctypes_compile);
+
+STATIC const mp_obj_type_t uctypes_desc_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_descriptor,
+};
+
+#endif // MICROPY_PY_UCTYPES_COMPILE
+
 static inline mp_obj_t get_unaligned(uint val_type, byte *p, int big_endian) {
     char struct_type = big_endian ? '>' : '<';
     static const char type2char[16] = "BbHhIiQq------fd";
@@ -380,96 +541,74 @@ STATIC void set_aligned(uint val_type, void *p, mp_int_t index, mp_obj_t val) {
     }
 }
 
-STATIC mp_obj_t uctypes_struct_attr_op(mp_obj_t self_in, qstr attr, mp_obj_t set_val) {
-    mp_obj_uctypes_struct_t *self = MP_OBJ_TO_PTR(self_in);
-
-    if (!mp_obj_is_dict_or_ordereddict(self->desc)) {
-        mp_raise_TypeError(MP_ERROR_TEXT("struct: no fields"));
-    }
-
-    mp_obj_t deref = mp_obj_dict_get(self->desc, MP_OBJ_NEW_QSTR(attr));
-    if (mp_obj_is_small_int(deref)) {
-        mp_int_t offset = MP_OBJ_SMALL_INT_VALUE(deref);
-        mp_uint_t val_type = GET_TYPE(offset, VAL_TYPE_BITS);
-        offset &= VALUE_MASK(VAL_TYPE_BITS);
+// Load or store the scalar field with the given descriptor value
+STATIC mp_obj_t uctypes_struct_scalar_op(mp_obj_uctypes_struct_t *self, mp_int_t offset, mp_obj_t set_val) {
+    mp_uint_t val_type = GET_TYPE(offset, VAL_TYPE_BITS);
+    offset &= VALUE_MASK(VAL_TYPE_BITS);
 
-        if (val_type <= INT64 || val_type == FLOAT32 || val_type == FLOAT64) {
-            if (self->flags == LAYOUT_NATIVE) {
-                if (set_val == MP_OBJ_NULL) {
-                    return get_aligned(val_type, self->addr + offset, 0);
-                } else {
-                    set_aligned(val_type, self->addr + offset, 0, set_val);
-                    return set_val; // just !MP_OBJ_NULL
-                }
-            } else {
-                if (set_val == MP_OBJ_NULL) {
-                    return get_unaligned(val_type, self->addr + offset, self->flags);
-                } else {
-                    set_unaligned(val_type, self->addr + offset, self->flags, set_val);
-                    return set_val; // just !MP_OBJ_NULL
-                }
-            }
-        } else if (val_type >= BFUINT8 && val_type <= BFINT32) {
-            uint bit_offset = (offset >> OFFSET_BITS) & 31;
-            uint bit_len = (offset >> LEN_BITS) & 31;
-            offset &= (1 << OFFSET_BITS) - 1;
-            mp_uint_t val;
-            if (self->flags == LAYOUT_NATIVE) {
-                val = get_aligned_basic(val_type & 6, self->addr + offset);
+    if (val_type <= INT64 || val_type == FLOAT32 || val_type == FLOAT64) {
+        if (self->flags == LAYOUT_NATIVE) {
+            if (set_val == MP_OBJ_NULL) {
+                return get_aligned(val_type, self->addr + offset, 0);
             } else {
-                val = mp_binary_get_int(GET_SCALAR_SIZE(val_type & 7), val_type & 1, self->flags, self->addr + offset);
+                set_aligned(val_type, self->addr + offset, 0, set_val);
+                return set_val; // just !MP_OBJ_NULL
             }
+        } else {
             if (set_val == MP_OBJ_NULL) {
-                val >>= bit_offset;
-                val &= (1 << bit_len) - 1;
-                // TODO: signed
-                assert((val_type & 1) == 0);
-                return mp_obj_new_int(val);
+                return get_unaligned(val_type, self->addr + offset, self->flags);
             } else {
-                mp_uint_t set_val_int = (mp_uint_t)mp_obj_get_int(set_val);
-                mp_uint_t mask = (1 << bit_len) - 1;
-                set_val_int &= mask;
-                set_val_int <<= bit_offset;
-                mask <<= bit_offset;
-                val = (val & ~mask) | set_val_int;
-
-                if (self->flags == LAYOUT_NATIVE) {
-                    set_aligned_basic(val_type & 6, self->addr + offset, val);
-                } else {
-                    mp_binary_set_int(GET_SCALAR_SIZE(val_type & 7), self->flags == LAYOUT_BIG_ENDIAN,
-                        self->addr + offset, val);
-                }
+                set_unaligned(val_type, self->addr + offset, self->flags, set_val);
                 return set_val; // just !MP_OBJ_NULL
             }
         }
+    } else if (val_type >= BFUINT8 && val_type <= BFINT32) {
+        uint bit_offset = (offset >> OFFSET_BITS) & 31;
+        uint bit_len = (offset >> LEN_BITS) & 31;
+        offset &= (1 << OFFSET_BITS) - 1;
+        mp_uint_t val;
+        if (self->flags == LAYOUT_NATIVE) {
+            val = get_aligned_basic(val_type & 6, self->addr + offset);
+        } else {
+            val = mp_binary_get_int(GET_SCALAR_SIZE(val_type & 7), val_type & 1, self->flags, self->addr + offset);
+        }
+        if (set_val == MP_OBJ_NULL) {
+            val >>= bit_offset;
+            val &= (1 << bit_len) - 1;
+            // TODO: signed
+            assert((val_type & 1) == 0);
+            return mp_obj_new_int(val);
+        } else {
+            mp_uint_t set_val_int = (mp_uint_t)mp_obj_get_int(set_val);
+            mp_uint_t mask = (1 << bit_len) - 1;
+            set_val_int &= mask;
+            set_val_int <<= bit_offset;
+            mask <<= bit_offset;
+            val = (val & ~mask) | set_val_int;
 
-        assert(0);
-        return MP_OBJ_NULL;
-    }
-
-    if (!mp_obj_is_type(deref, &mp_type_tuple)) {
-        syntax_error();
+            if (self->flags == LAYOUT_NATIVE) {
+                set_aligned_basic(val_type & 6, self->addr + offset, val);
+            } else {
+                mp_binary_set_int(GET_SCALAR_SIZE(val_type & 7), self->flags == LAYOUT_BIG_ENDIAN,
+                    self->addr + offset, val);
+            }
+            return set_val; // just !MP_OBJ_NULL
+        }
     }
 
-    if (set_val != MP_OBJ_NULL) {
-        // Cannot assign to aggregate
-        syntax_error();
-    }
+    assert(0);
+    return MP_OBJ_NULL;
+}
 
-    mp_obj_tuple_t *sub = MP_OBJ_TO_PTR(deref);
+// Return the object for the aggregate field with the given descriptor
+STATIC mp_obj_t uctypes_struct_agg_op(mp_obj_uctypes_struct_t *self, mp_obj_tuple_t *sub) {
     mp_int_t offset = MP_OBJ_SMALL_INT_VALUE(sub->items[0]);
     mp_uint_t agg_type = GET_TYPE(offset, AGG_TYPE_BITS);
     offset &= VALUE_MASK(AGG_TYPE_BITS);
 
     switch (agg_type) {
-        case STRUCT: {
-            mp_obj_uctypes_struct_t *o = m_new_obj(mp_obj_uctypes_struct_t);
-            o->base.type = &uctypes_struct_type;
-            o->desc = sub->items[1];
-            o->addr = self->addr + offset;
-            o->flags = self->flags;
-            return MP_OBJ_FROM_PTR(o);
-        }
+        case STRUCT:
+            return uctypes_struct_new(&uctypes_struct_type, sub->items[1], self->addr + offset, self->flags);
         case ARRAY: {
             mp_uint_t dummy;
             if (IS_SCALAR_ARRAY(sub) && IS_SCALAR_ARRAY_OF_BYTES(sub)) {
@@ -478,20 +617,63 @@ STATIC mp_obj_t uctypes_struct_attr_op(mp_obj_t self_in, qstr attr, mp_obj_t set
             // Fall thru to return uctypes struct object
             MP_FALLTHROUGH
         }
-        case PTR: {
-            mp_obj_uctypes_struct_t *o = m_new_obj(mp_obj_uctypes_struct_t);
-            o->base.type = &uctypes_struct_type;
-            o->desc = MP_OBJ_FROM_PTR(sub);
-            o->addr = self->addr + offset;
-            o->flags = self->flags;
-            return MP_OBJ_FROM_PTR(o);
-        }
+        case PTR:
+            return uctypes_struct_new(&uctypes_struct_type, MP_OBJ_FROM_PTR(sub), self->addr + offset, self->flags);
     }
 
     // Should be unreachable once all cases are handled
     return MP_OBJ_NULL;
 }
 
+STATIC mp_obj_t uctypes_struct_attr_op(mp_obj_t self_in, qstr attr, mp_obj_t set_val) {
+    mp_obj_uctypes_struct_t *self = MP_OBJ_TO_PTR(self_in);
+
+    #if MICROPY_PY_UCTYPES_COMPILE
+    if (IS_COMPILED_DESC(self->desc)) {
+        mp_obj_uctypes_desc_t *d = MP_OBJ_TO_PTR(self->desc);
+        for (size_t i = 0; i < d->n_fields; ++i) {
+            const uctypes_field_t *f = &d->fields[i];
+            if (f->name != attr) {
+                continue;
+            }
+            if (mp_obj_is_small_int(f->desc)) {
+                return uctypes_struct_scalar_op(self, MP_OBJ_SMALL_INT_VALUE(f->desc), set_val);
+            }
+            if (set_val != MP_OBJ_NULL) {
+                // Cannot assign to aggregate
+                syntax_error();
+            }
+            // The object for an aggregate field is made on first access and kept
+            if (self->children[f->child] == MP_OBJ_NULL) {
+                self->children[f->child] = uctypes_struct_agg_op(self, MP_OBJ_TO_PTR(f->desc));
+            }
+            return self->children[f->child];
+        }
+        nlr_raise(mp_obj_new_exception_arg1(&mp_type_KeyError, MP_OBJ_NEW_QSTR(attr)));
+    }
+    #endif
+
+    if (!mp_obj_is_dict_or_ordereddict(self->desc)) {
+        mp_raise_TypeError(MP_ERROR_TEXT("struct: no fields"));
+    }
+
+    mp_obj_t deref = mp_obj_dict_get(self->desc, MP_OBJ_NEW_QSTR(attr));
+    if (mp_obj_is_small_int(deref)) {
+        return uctypes_struct_scalar_op(self, MP_OBJ_SMALL_INT_VALUE(deref), set_val);
+    }
+
+    if (!mp_obj_is_type(deref, &mp_type_tuple)) {
+        syntax_error();
+    }
+
+    if (set_val != MP_OBJ_NULL) {
+        // Cannot assign to aggregate
+        syntax_error();
+    }
+
+    return uctypes_struct_agg_op(self, MP_OBJ_TO_PTR(deref));
+}
+
 STATIC void uctypes_struct_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest) {
     if (dest[0] == MP_OBJ_NULL) {
         // load attribute
@@ -552,12 +734,7 @@ STATIC mp_obj_t uctypes_struct_subscr(mp_obj_t self_in, mp_obj_t index_in, mp_ob
             } else if (value == MP_OBJ_SENTINEL) {
                 mp_uint_t dummy = 0;
                 mp_uint_t size = uctypes_struct_size(t->items[2], self->flags, &dummy);
-                mp_obj_uctypes_struct_t *o = m_new_obj(mp_obj_uctypes_struct_t);
-                o->base.type = &uctypes_struct_type;
-                o->desc = t->items[2];
-                o->addr = self->addr + size * index;
-                o->flags = self->flags;
-                return MP_OBJ_FROM_PTR(o);
+                return uctypes_struct_new(&uctypes_struct_type, t->items[2], self->addr + size * index, self->flags);
             } else {
                 return MP_OBJ_NULL; // op not supported
             }
@@ -570,12 +747,7 @@ STATIC mp_obj_t uctypes_struct_subscr(mp_obj_t self_in, mp_obj_t index_in, mp_ob
             } else {
                 mp_uint_t dummy = 0;
                 mp_uint_t size = uctypes_struct_size(t->items[1], self->flags, &dummy);
-                mp_obj_uctypes_struct_t *o = m_new_obj(mp_obj_uctypes_struct_t);
-                o->base.type = &uctypes_struct_type;
-                o->desc = t->items[1];
-                o->addr = p + size * index;
-                o->flags = self->flags;
-                return MP_OBJ_FROM_PTR(o);
+                return uctypes_struct_new(&uctypes_struct_type, t->items[1], p + size * index, self->flags);
             }
         }
 
@@ -639,6 +811,34 @@ STATIC mp_obj_t uctypes_struct_bytes_at(mp_obj_t ptr, mp_obj_t size) {
 }
 MP_DEFINE_CONST_FUN_OBJ_2(uctypes_struct_bytes_at_obj, uctypes_struct_bytes_at);
 
+#if MICROPY_PY_UCTYPES_COMPILE
+// unpack_all()
+// Return a tuple of the values of all scalar fields of a struct, in order of offset.
+STATIC mp_obj_t uctypes_struct_unpack_all(mp_obj_t self_in) {
+    if (!mp_obj_is_type(self_in, &uctypes_struct_type)) {
+        mp_raise_TypeError(NULL);
+    }
+    mp_obj_uctypes_struct_t *self = MP_OBJ_TO_PTR(self_in);
+    if (!mp_obj_is_dict_or_ordereddict(self->desc) && !IS_COMPILED_DESC(self->desc)) {
+        mp_raise_TypeError(MP_ERROR_TEXT("struct: no fields"));
+    }
+    mp_obj_uctypes_desc_t *d = MP_OBJ_TO_PTR(uctypes_compile_desc(self->desc));
+    size_t n = 0;
+    for (size_t i = 0; i < d->n_fields; ++i) {
+        n += mp_obj_is_small_int(d->fields[i].desc);
+    }
+    mp_obj_tuple_t *t = MP_OBJ_TO_PTR(mp_obj_new_tuple(n, NULL));
+    n = 0;
+    for (size_t i = 0; i < d->n_fields; ++i) {
+        if (mp_obj_is_small_int(d->fields[i].desc)) {
+            t->items[n++] = uctypes_struct_scalar_op(self, MP_OBJ_SMALL_INT_VALUE(d->fields[i].desc), MP_OBJ_NULL);
+        }
+    }
+    return MP_OBJ_FROM_PTR(t);
+}
+MP_DEFINE_CONST_FUN_OBJ_1(uctypes_struct_unpack_all_obj, uctypes_struct_unpack_all);
+#endif
+
 STATIC const mp_obj_type_t uctypes_struct_type = {
     { &mp_type_type },
     .name = MP_QSTR_struct,
@@ -657,6 +857,10 @@ STATIC const mp_rom_map_elem_t mp_module_uctypes_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_addressof), MP_ROM_PTR(&uctypes_struct_addressof_obj) },
     { MP_ROM_QSTR(MP_QSTR_bytes_at), MP_ROM_PTR(&uctypes_struct_bytes_at_obj) },
     { MP_ROM_QSTR(MP_QSTR_bytearray_at), MP_ROM_PTR(&uctypes_struct_bytearray_at_obj) },
+    #if MICROPY_PY_UCTYPES_COMPILE
+    { MP_ROM_QSTR(MP_QSTR_compile), MP_ROM_PTR(&uctypes_compile_obj) },
+    { MP_ROM_QSTR(MP_QSTR_unpack_all), MP_ROM_PTR(&uctypes_struct_unpack_all_obj) },
+    #endif
 
     { MP_ROM_QSTR(MP_QSTR_NATIVE), MP_ROM_INT(LAYOUT_NATIVE) },
     { MP_ROM_QSTR(MP_QSTR_LITTLE_ENDIAN), MP_ROM_INT(LAYOUT_LITTLE_ENDIAN) },
@@ -24,8 +24,11 @@
  * THE SOFTWARE.
  */
 
+#include <string.h>
+
 #include "py/objlist.h"
 #include "py/runtime.h"
+#include "py/gc.h"
 
 #if MICROPY_PY_UHEAPQ
 
@@ -103,12 +106,405 @@ STATIC mp_obj_t mod_uheapq_heapify(mp_obj_t heap_in) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_uheapq_heapify_obj, mod_uheapq_heapify);
 
+#if MICROPY_PY_UHEAPQ_EXTRA
+
+/******************************************************************************/
+// Heaps of entries with a key computed once, for nsmallest, nlargest and merge
+
+typedef struct _uheapq_entry_t {
+    mp_obj_t key;
+    mp_obj_t value;
+    mp_obj_t iter; // for merge, the iterator the value came from
+    mp_uint_t order; // tie-breaker, so results are stable
+} uheapq_entry_t;
+
+// Whether entry a comes before entry b: smallest key first, or largest if
+// reverse, then lowest order first.
+STATIC bool uheapq_entry_before(const uheapq_entry_t *a, const uheapq_entry_t *b, bool reverse) {
+    mp_obj_t lo = reverse ? b->key : a->key;
+    mp_obj_t hi = reverse ? a->key : b->key;
+    if (mp_binary_op(MP_BINARY_OP_LESS, lo, hi) == mp_const_true) {
+        return true;
+    }
+    if (mp_binary_op(MP_BINARY_OP_LESS, hi, lo) == mp_const_true) {
+        return false;
+    }
+    return a->order < b->order;
+}
+
+// The top of the heap is the entry that comes first, or last if last_on_top.
+typedef struct _uheapq_entry_heap_t {
+    uheapq_entry_t *items;
+    size_t len;
+    bool reverse;
+    bool last_on_top;
+} uheapq_entry_heap_t;
+
+STATIC bool uheapq_entry_lt(const uheapq_entry_heap_t *heap, const uheapq_entry_t *a, const uheapq_entry_t *b) {
+    if (heap->last_on_top) {
+        return uheapq_entry_before(b, a, heap->reverse);
+    }
+    return uheapq_entry_before(a, b, heap->reverse);
+}
+
+STATIC void uheapq_entry_siftdown(uheapq_entry_heap_t *heap, size_t pos) {
+    uheapq_entry_t item = heap->items[pos];
+    while (pos > 0) {
+        size_t parent_pos = (pos - 1) >> 1;
+        if (!uheapq_entry_lt(heap, &item, &heap->items[parent_pos])) {
+            break;
+        }
+        heap->items[pos] = heap->items[parent_pos];
+        pos = parent_pos;
+    }
+    heap->items[pos] = item;
+}
+
+// Unlike uheapq_heap_siftup this compares on the way down, because the keys
+// can be any objects and so comparisons aren't cheap.
+STATIC void uheapq_entry_siftup(uheapq_entry_heap_t *heap, size_t pos) {
+    uheapq_entry_t item = heap->items[pos];
+    for (size_t child_pos = 2 * pos + 1; child_pos < heap->len; child_pos = 2 * pos + 1) {
+        if (child_pos + 1 < heap->len && uheapq_entry_lt(heap, &heap->items[child_pos + 1], &heap->items[child_pos])) {
+            child_pos += 1;
+        }
+        if (!uheapq_entry_lt(heap, &heap->items[child_pos], &item)) {
+            break;
+        }
+        heap->items[pos] = heap->items[child_pos];
+        pos = child_pos;
+    }
+    heap->items[pos] = item;
+}
+
+STATIC mp_obj_t uheapq_nbest(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args, bool reverse) {
+    enum { ARG_n, ARG_iterable, ARG_key };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_, MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_key, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = mp_const_none} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+    mp_int_t n = args[ARG_n].u_int;
+    mp_obj_t key_fn = args[ARG_key].u_obj;
+
+    // Keep the n entries that come first in a heap with the last of them on
+    // top, so each new entry only has to be compared with that one.
+    uheapq_entry_heap_t heap = { NULL, 0, reverse, true };
+    size_t alloc = 0;
+    mp_obj_iter_buf_t iter_buf;
+    mp_obj_t iter = mp_getiter(args[ARG_iterable].u_obj, &iter_buf);
+    mp_obj_t value;
+    for (mp_uint_t order = 0; n > 0 && (value = mp_iternext(iter)) != MP_OBJ_STOP_ITERATION; ++order) {
+        uheapq_entry_t entry = {
+            key_fn == mp_const_none ? value : mp_call_function_1(key_fn, value),
+            value, MP_OBJ_NULL, order
+        };
+        if (heap.len < (size_t)n) {
+            if (heap.len == alloc) {
+                size_t new_alloc = alloc == 0 ? 4 : alloc * 2;
+                heap.items = m_renew(uheapq_entry_t, heap.items, alloc, new_alloc);
+                alloc = new_alloc;
+            }
+            heap.items[heap.len++] = entry;
+            uheapq_entry_siftdown(&heap, heap.len - 1);
+        } else if (uheapq_entry_before(&entry, &heap.items[0], reverse)) {
+            heap.items[0] = entry;
+            uheapq_entry_siftup(&heap, 0);
+        }
+    }
+
+    // Pop the entries off last first to give them in order.
+    mp_obj_list_t *result = MP_OBJ_TO_PTR(mp_obj_new_list(heap.len, NULL));
+    while (heap.len > 0) {
+        result->items[--heap.len] = heap.items[0].value;
+        heap.items[0] = heap.items[heap.len];
+        uheapq_entry_siftup(&heap, 0);
+    }
+    m_del(uheapq_entry_t, heap.items, alloc);
+    return MP_OBJ_FROM_PTR(result);
+}
+
+STATIC mp_obj_t mod_uheapq_nsmallest(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    return uheapq_nbest(n_args, pos_args, kw_args, false);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mod_uheapq_nsmallest_obj, 2, mod_uheapq_nsmallest);
+
+STATIC mp_obj_t mod_uheapq_nlargest(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    return uheapq_nbest(n_args, pos_args, kw_args, true);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mod_uheapq_nlargest_obj, 2, mod_uheapq_nlargest);
+
+/******************************************************************************/
+// merge iterator
+
+typedef struct _mp_obj_uheapq_merge_t {
+    mp_obj_base_t base;
+    mp_obj_t key_fn;
+    size_t n_iters; // iterables not started yet, held in heap.items[i].iter
+    uheapq_entry_heap_t heap;
+} mp_obj_uheapq_merge_t;
+
+// Take the next value from the iterator of an entry, returning false if it's done.
+STATIC bool uheapq_merge_fill(mp_obj_uheapq_merge_t *self, uheapq_entry_t *entry) {
+    mp_obj_t value = mp_iternext(entry->iter);
+    if (value == MP_OBJ_STOP_ITERATION) {
+        return false;
+    }
+    entry->value = value;
+    entry->key = self->key_fn == mp_const_none ? value : mp_call_function_1(self->key_fn, value);
+    MP_GC_WRITE_BARRIER(entry);
+    return true;
+}
+
+STATIC mp_obj_t uheapq_merge_iternext(mp_obj_t self_in) {
+    mp_obj_uheapq_merge_t *self = MP_OBJ_TO_PTR(self_in);
+    uheapq_entry_heap_t *heap = &self->heap;
+    if (self->n_iters > 0) {
+        // Start on the first call, like CPython's generator, and heapify in place
+        size_t n_iters = self->n_iters;
+        self->n_iters = 0;
+        for (size_t i = 0; i < n_iters; ++i) {
+            uheapq_entry_t *entry = &heap->items[heap->len];
+            entry->iter = mp_getiter(heap->items[i].iter, NULL);
+            entry->order = i;
+            if (uheapq_merge_fill(self, entry)) {
+                heap->len += 1;
+            }
+        }
+        // so we don't retain pointers to iterables that are done
+        memset(heap->items + heap->len, 0, (n_iters - heap->len) * sizeof(uheapq_entry_t));
+        for (size_t i = heap->len / 2; i > 0;) {
+            uheapq_entry_siftup(heap, --i);
+        }
+    }
+    if (heap->len == 0) {
+        return MP_OBJ_STOP_ITERATION;
+    }
+    mp_obj_t value = heap->items[0].value;
+    if (!uheapq_merge_fill(self, &heap->items[0])) {
+        heap->len -= 1;
+        heap->items[0] = heap->items[heap->len];
+        heap->items[heap->len].iter = MP_OBJ_NULL; // so we don't retain a pointer
+    }
+    if (heap->len > 0) {
+        uheapq_entry_siftup(heap, 0);
+    }
+    return value;
+}
+
+STATIC const mp_obj_type_t uheapq_merge_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_iterator,
+    .getiter = mp_identity_getiter,
+    .iternext = uheapq_merge_iternext,
+};
+
+STATIC mp_obj_t mod_uheapq_merge(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    mp_obj_t key_fn = mp_const_none;
+    bool reverse = false;
+    if (kw_args != NULL) {
+        for (size_t i = 0; i < kw_args->alloc; ++i) {
+            if (!mp_map_slot_is_filled(kw_args, i)) {
+                continue;
+            }
+            mp_obj_t k = kw_args->table[i].key;
+            if (k == MP_OBJ_NEW_QSTR(MP_QSTR_key)) {
+                key_fn = kw_args->table[i].value;
+            } else if (k == MP_OBJ_NEW_QSTR(MP_QSTR_reverse)) {
+                reverse = mp_obj_is_true(kw_args->table[i].value);
+            } else {
+                mp_raise_TypeError(MP_ERROR_TEXT("unexpected keyword argument"));
+            }
+        }
+    }
+    mp_obj_uheapq_merge_t *self = m_new_obj(mp_obj_uheapq_merge_t);
+    self->base.type = &uheapq_merge_type;
+    self->key_fn = key_fn;
+    self->n_iters = n_args;
+    self->heap.items = m_new0(uheapq_entry_t, n_args);
+    self->heap.len = 0;
+    self->heap.reverse = reverse;
+    self->heap.last_on_top = false;
+    // The entries start out holding the iterables, and are reused for their
+    // iterators once started, which can only leave entries behind.
+    for (size_t i = 0; i < n_args; ++i) {
+        self->heap.items[i].iter = pos_args[i];
+    }
+    return MP_OBJ_FROM_PTR(self);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mod_uheapq_merge_obj, 0, mod_uheapq_merge);
+
+/******************************************************************************/
+// KeyHeap class
+
+typedef struct _uheapq_key_entry_t {
+    mp_int_t key;
+    mp_uint_t seq;
+    mp_obj_t item;
+} uheapq_key_entry_t;
+
+typedef struct _mp_obj_uheapq_key_heap_t {
+    mp_obj_base_t base;
+    mp_obj_t key_fn;
+    size_t alloc;
+    size_t len;
+    mp_uint_t seq;
+    uheapq_key_entry_t *items;
+} mp_obj_uheapq_key_heap_t;
+
+static inline bool uheapq_key_lt(const uheapq_key_entry_t *a, const uheapq_key_entry_t *b) {
+    return a->key < b->key || (a->key == b->key && a->seq < b->seq);
+}
+
+STATIC void uheapq_key_siftdown(mp_obj_uheapq_key_heap_t *heap, size_t pos) {
+    uheapq_key_entry_t item = heap->items[pos];
+    while (pos > 0) {
+        size_t parent_pos = (pos - 1) >> 1;
+        if (!uheapq_key_lt(&item, &heap->items[parent_pos])) {
+            break;
+        }
+        heap->items[pos] = heap->items[parent_pos];
+        pos = parent_pos;
+    }
+    heap->items[pos] = item;
+}
+
+STATIC void uheapq_key_siftup(mp_obj_uheapq_key_heap_t *heap, size_t pos) {
+    uheapq_key_entry_t item = heap->items[pos];
+    for (size_t child_pos = 2 * pos + 1; child_pos < heap->len; child_pos = 2 * pos + 1) {
+        if (child_pos + 1 < heap->len && uheapq_key_lt(&heap->items[child_pos + 1], &heap->items[child_pos])) {
+            child_pos += 1;
+        }
+        if (!uheapq_key_lt(&heap->items[child_pos], &item)) {
+            break;
+        }
+        heap->items[pos] = heap->items[child_pos];
+        pos = child_pos;
+    }
+    heap->items[pos] = item;
+}
+
+// Add an item to the end of the heap without restoring the heap order.
+STATIC void uheapq_key_append(mp_obj_uheapq_key_heap_t *self, mp_obj_t item) {
+    mp_int_t key = mp_obj_get_int(self->key_fn == mp_const_none ? item : mp_call_function_1(self->key_fn, item));
+    if (self->len == self->alloc) {
+        size_t new_alloc = self->alloc == 0 ? 4 : self->alloc * 2;
+        self->items = m_renew(uheapq_key_entry_t, self->items, self->alloc, new_alloc);
+        self->alloc = new_alloc;
+    }
+    uheapq_key_entry_t *entry = &self->items[self->len++];
+    entry->key = key;
+    entry->seq = self->seq++;
+    entry->item = item;
+}
+
+STATIC mp_obj_t uheapq_key_heap_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 1, 2, false);
+    mp_obj_uheapq_key_heap_t *self = m_new_obj(mp_obj_uheapq_key_heap_t);
+    self->base.type = type;
+    self->key_fn = args[0];
+    self->alloc = 0;
+    self->len = 0;
+    self->seq = 0;
+    self->items = NULL;
+    if (n_args == 2) {
+        // Take all the items then heapify in place, which is O(n)
+        mp_obj_iter_buf_t iter_buf;
+        mp_obj_t iter = mp_getiter(args[1], &iter_buf);
+        mp_obj_t item;
+        while ((item = mp_iternext(iter)) != MP_OBJ_STOP_ITERATION) {
+            uheapq_key_append(self, item);
+        }
+        for (size_t i = self->len / 2; i > 0;) {
+            uheapq_key_siftup(self, --i);
+        }
+    }
+    return MP_OBJ_FROM_PTR(self);
+}
+
+STATIC mp_obj_t uheapq_key_heap_push(mp_obj_t self_in, mp_obj_t item) {
+    mp_obj_uheapq_key_heap_t *self = MP_OBJ_TO_PTR(self_in);
+    uheapq_key_append(self, item);
+    uheapq_key_siftdown(self, self->len - 1);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(uheapq_key_heap_push_obj, uheapq_key_heap_push);
+
+STATIC mp_obj_uheapq_key_heap_t *uheapq_key_heap_get_nonempty(mp_obj_t self_in) {
+    mp_obj_uheapq_key_heap_t *self = MP_OBJ_TO_PTR(self_in);
+    if (self->len == 0) {
+        mp_raise_msg(&mp_type_IndexError, MP_ERROR_TEXT("empty heap"));
+    }
+    return self;
+}
+
+STATIC mp_obj_t uheapq_key_heap_pop(mp_obj_t self_in) {
+    mp_obj_uheapq_key_heap_t *self = uheapq_key_heap_get_nonempty(self_in);
+    mp_obj_t item = self->items[0].item;
+    self->len -= 1;
+    self->items[0] = self->items[self->len];
+    self->items[self->len].item = MP_OBJ_NULL; // so we don't retain a pointer
+    if (self->len) {
+        uheapq_key_siftup(self, 0);
+    }
+    return item;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(uheapq_key_heap_pop_obj, uheapq_key_heap_pop);
+
+STATIC mp_obj_t uheapq_key_heap_peek(mp_obj_t self_in) {
+    return uheapq_key_heap_get_nonempty(self_in)->items[0].item;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(uheapq_key_heap_peek_obj, uheapq_key_heap_peek);
+
+STATIC mp_obj_t uheapq_key_heap_peekkey(mp_obj_t self_in) {
+    return mp_obj_new_int(uheapq_key_heap_get_nonempty(self_in)->items[0].key);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(uheapq_key_heap_peekkey_obj, uheapq_key_heap_peekkey);
+
+STATIC mp_obj_t uheapq_key_heap_unary_op(mp_unary_op_t op, mp_obj_t self_in) {
+    mp_obj_uheapq_key_heap_t *self = MP_OBJ_TO_PTR(self_in);
+    switch (op) {
+        case MP_UNARY_OP_BOOL:
+            return mp_obj_new_bool(self->len != 0);
+        case MP_UNARY_OP_LEN:
+            return MP_OBJ_NEW_SMALL_INT(self->len);
+        default:
+            return MP_OBJ_NULL; // op not supported
+    }
+}
+
+STATIC const mp_rom_map_elem_t uheapq_key_heap_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_push), MP_ROM_PTR(&uheapq_key_heap_push_obj) },
+    { MP_ROM_QSTR(MP_QSTR_pop), MP_ROM_PTR(&uheapq_key_heap_pop_obj) },
+    { MP_ROM_QSTR(MP_QSTR_peek), MP_ROM_PTR(&uheapq_key_heap_peek_obj) },
+    { MP_ROM_QSTR(MP_QSTR_peekkey), MP_ROM_PTR(&uheapq_key_heap_peekkey_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(uheapq_key_heap_locals_dict, uheapq_key_heap_locals_dict_table);
+
+STATIC const mp_obj_type_t uheapq_key_heap_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_KeyHeap,
+    .make_new = uheapq_key_heap_make_new,
+    .unary_op = uheapq_key_heap_unary_op,
+    .locals_dict = (mp_obj_dict_t *)&uheapq_key_heap_locals_dict,
+};
+
+#endif // MICROPY_PY_UHEAPQ_EXTRA
+
 #if !MICROPY_ENABLE_DYNRUNTIME
 STATIC const mp_rom_map_elem_t mp_module_uheapq_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_uheapq) },
     { MP_ROM_QSTR(MP_QSTR_heappush), MP_ROM_PTR(&mod_uheapq_heappush_obj) },
     { MP_ROM_QSTR(MP_QSTR_heappop), MP_ROM_PTR(&mod_uheapq_heappop_obj) },
     { MP_ROM_QSTR(MP_QSTR_heapify), MP_ROM_PTR(&mod_uheapq_heapify_obj) },
+    #if MICROPY_PY_UHEAPQ_EXTRA
+    { MP_ROM_QSTR(MP_QSTR_nsmallest), MP_ROM_PTR(&mod_uheapq_nsmallest_obj) },
+    { MP_ROM_QSTR(MP_QSTR_nlargest), MP_ROM_PTR(&mod_uheapq_nlargest_obj) },
+    { MP_ROM_QSTR(MP_QSTR_merge), MP_ROM_PTR(&mod_uheapq_merge_obj) },
+    { MP_ROM_QSTR(MP_QSTR_KeyHeap), MP_ROM_PTR(&uheapq_key_heap_type) },
+    #endif
 };
 
 STATIC MP_DEFINE_CONST_DICT(mp_module_uheapq_globals, mp_module_uheapq_globals_table);
@@ -25,6 +25,7 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 
 #include "py/objlist.h"
 #include "py/objstringio.h"
@@ -34,10 +35,43 @@
 
 #if MICROPY_PY_UJSON
 
+#define UJSON_DUMP_BUF_SIZE (128)
+
+// dump collects the many small pieces of output into chunks for the stream
+typedef struct _ujson_dump_buf_t {
+    mp_obj_t stream;
+    size_t len;
+    byte buf[UJSON_DUMP_BUF_SIZE];
+} ujson_dump_buf_t;
+
+STATIC void ujson_dump_flush(ujson_dump_buf_t *d) {
+    if (d->len > 0) {
+        mp_stream_write(d->stream, d->buf, d->len, MP_STREAM_RW_WRITE);
+        d->len = 0;
+    }
+}
+
+STATIC void ujson_dump_strn(void *data, const char *str, size_t len) {
+    ujson_dump_buf_t *d = data;
+    if (d->len + len > UJSON_DUMP_BUF_SIZE) {
+        ujson_dump_flush(d);
+        if (len > UJSON_DUMP_BUF_SIZE) {
+            mp_stream_write(d->stream, str, len, MP_STREAM_RW_WRITE);
+            return;
+        }
+    }
+    memcpy(d->buf + d->len, str, len);
+    d->len += len;
+}
+
 STATIC mp_obj_t mod_ujson_dump(mp_obj_t obj, mp_obj_t stream) {
     mp_get_stream_raise(stream, MP_STREAM_OP_WRITE);
-    mp_print_t print = {MP_OBJ_TO_PTR(stream), mp_stream_write_adaptor};
+    ujson_dump_buf_t d;
+    d.stream = stream;
+    d.len = 0;
+    mp_print_t print = {&d, ujson_dump_strn};
     mp_obj_print_helper(&print, obj, PRINT_JSON);
+    ujson_dump_flush(&d);
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(mod_ujson_dump_obj, mod_ujson_dump);
@@ -87,27 +121,44 @@ STATIC byte ujson_stream_next(ujson_stream_t *s) {
     return s->cur;
 }
 
-STATIC mp_obj_t mod_ujson_load(mp_obj_t stream_obj) {
-    const mp_stream_p_t *stream_p = mp_get_stream_raise(stream_obj, MP_STREAM_OP_READ);
-    ujson_stream_t s = {stream_obj, stream_p->read, 0, 0};
-    vstr_t vstr;
-    vstr_init(&vstr, 8);
+STATIC NORETURN void ujson_syntax_error(void) {
+    mp_raise_ValueError(MP_ERROR_TEXT("syntax error in JSON"));
+}
+
+// Add value to the list or dict container, for a dict either as the pending key
+// or as the value for it
+STATIC void ujson_store(mp_obj_t container, const mp_obj_type_t *type, mp_obj_t *key, mp_obj_t value) {
+    if (type == &mp_type_list) {
+        mp_obj_list_append(container, value);
+    } else if (*key == MP_OBJ_NULL) {
+        *key = value;
+    } else {
+        mp_obj_dict_store(container, *key, value);
+        *key = MP_OBJ_NULL;
+    }
+}
+
+// Parse one value from the stream, starting at the current char.  If at_end
+// is true then reaching the end of an enclosing list or dict instead returns
+// MP_OBJ_NULL.  object_hook, if not MP_OBJ_NULL, is called with each dict
+// when it's complete and its result is used instead.
+STATIC mp_obj_t ujson_parse_value(ujson_stream_t *s, vstr_t *vstr, bool at_end, mp_obj_t object_hook) {
+    (void)object_hook;
     mp_obj_list_t stack; // we use a list as a simple stack for nested JSON
     stack.len = 0;
     stack.items = NULL;
     mp_obj_t stack_top = MP_OBJ_NULL;
     const mp_obj_type_t *stack_top_type = NULL;
     mp_obj_t stack_key = MP_OBJ_NULL;
-    S_NEXT(s);
     for (;;) {
     cont:
-        if (S_END(s)) {
+        if (S_END(*s)) {
             break;
         }
         mp_obj_t next = MP_OBJ_NULL;
         bool enter = false;
-        byte cur = S_CUR(s);
-        S_NEXT(s);
+        byte cur = S_CUR(*s);
+        S_NEXT(*s);
         switch (cur) {
             case ',':
             case ':':
@@ -117,35 +168,35 @@ STATIC mp_obj_t mod_ujson_load(mp_obj_t stream_obj) {
             case '\r':
                 goto cont;
             case 'n':
-                if (S_CUR(s) == 'u' && S_NEXT(s) == 'l' && S_NEXT(s) == 'l') {
-                    S_NEXT(s);
+                if (S_CUR(*s) == 'u' && S_NEXT(*s) == 'l' && S_NEXT(*s) == 'l') {
+                    S_NEXT(*s);
                     next = mp_const_none;
                 } else {
                     goto fail;
                 }
                 break;
             case 'f':
-                if (S_CUR(s) == 'a' && S_NEXT(s) == 'l' && S_NEXT(s) == 's' && S_NEXT(s) == 'e') {
-                    S_NEXT(s);
+                if (S_CUR(*s) == 'a' && S_NEXT(*s) == 'l' && S_NEXT(*s) == 's' && S_NEXT(*s) == 'e') {
+                    S_NEXT(*s);
                     next = mp_const_false;
                 } else {
                     goto fail;
                 }
                 break;
             case 't':
-                if (S_CUR(s) == 'r' && S_NEXT(s) == 'u' && S_NEXT(s) == 'e') {
-                    S_NEXT(s);
+                if (S_CUR(*s) == 'r' && S_NEXT(*s) == 'u' && S_NEXT(*s) == 'e') {
+                    S_NEXT(*s);
                     next = mp_const_true;
                 } else {
                     goto fail;
                 }
                 break;
             case '"':
-                vstr_reset(&vstr);
-                for (; !S_END(s) && S_CUR(s) != '"';) {
-                    byte c = S_CUR(s);
+                vstr_reset(vstr);
+                for (; !S_END(*s) && S_CUR(*s) != '"';) {
+                    byte c = S_CUR(*s);
                     if (c == '\\') {
-                        c = S_NEXT(s);
+                        c = S_NEXT(*s);
                         switch (c) {
                             case 'b':
                                 c = 0x08;
@@ -165,26 +216,29 @@ STATIC mp_obj_t mod_ujson_load(mp_obj_t stream_obj) {
                             case 'u': {
                                 mp_uint_t num = 0;
                                 for (int i = 0; i < 4; i++) {
-                                    c = (S_NEXT(s) | 0x20) - '0';
+                                    c = (S_NEXT(*s) | 0x20) - '0';
                                     if (c > 9) {
                                         c -= ('a' - ('9' + 1));
                                     }
                                     num = (num << 4) | c;
                                 }
-                                vstr_add_char(&vstr, num);
+                                vstr_add_char(vstr, num);
                                 goto str_cont;
                             }
                         }
                     }
-                    vstr_add_byte(&vstr, c);
+                    vstr_add_byte(vstr, c);
                 str_cont:
-                    S_NEXT(s);
+                    S_NEXT(*s);
                 }
-                if (S_END(s)) {
+                if (S_END(*s)) {
                     goto fail;
                 }
-                S_NEXT(s);
-                next = mp_obj_new_str(vstr.buf, vstr.len);
+                S_NEXT(*s);
+                next = mp_obj_new_str(vstr->buf, vstr->len);
+                if (stack_top_type == &mp_type_dict && stack_key == MP_OBJ_NULL) {
+                    next = mp_obj_str_intern_key(next);
+                }
                 break;
             case '-':
             case '0':
@@ -198,10 +252,10 @@ STATIC mp_obj_t mod_ujson_load(mp_obj_t stream_obj) {
             case '8':
             case '9': {
                 bool flt = false;
-                vstr_reset(&vstr);
+                vstr_reset(vstr);
                 for (;;) {
-                    vstr_add_byte(&vstr, cur);
-                    cur = S_CUR(s);
+                    vstr_add_byte(vstr, cur);
+                    cur = S_CUR(*s);
                     if (cur == '.' || cur == 'E' || cur == 'e') {
                         flt = true;
                     } else if (cur == '+' || cur == '-' || unichar_isdigit(cur)) {
@@ -209,12 +263,12 @@ STATIC mp_obj_t mod_ujson_load(mp_obj_t stream_obj) {
                     } else {
                         break;
                     }
-                    S_NEXT(s);
+                    S_NEXT(*s);
                 }
                 if (flt) {
-                    next = mp_parse_num_decimal(vstr.buf, vstr.len, false, false, NULL);
+                    next = mp_parse_num_decimal(vstr->buf, vstr->len, false, false, NULL);
                 } else {
-                    next = mp_parse_num_integer(vstr.buf, vstr.len, 10, NULL);
+                    next = mp_parse_num_integer(vstr->buf, vstr->len, 10, NULL);
                 }
                 break;
             }
@@ -229,16 +283,29 @@ STATIC mp_obj_t mod_ujson_load(mp_obj_t stream_obj) {
             case '}':
             case ']': {
                 if (stack_top == MP_OBJ_NULL) {
+                    if (at_end) {
+                        return MP_OBJ_NULL;
+                    }
                     // no object at all
                     goto fail;
                 }
+                next = stack_top;
+                #if MICROPY_PY_UJSON_OBJECT_HOOK
+                if (object_hook != MP_OBJ_NULL && stack_top_type == &mp_type_dict) {
+                    next = mp_call_function_1(object_hook, next);
+                }
+                #endif
                 if (stack.len == 0) {
                     // finished; compound object
+                    stack_top = next;
                     goto success;
                 }
-                stack.len -= 1;
+                // a completed list or dict is added to its parent
+                stack.len -= 2;
                 stack_top = stack.items[stack.len];
+                stack_key = stack.items[stack.len + 1];
                 stack_top_type = mp_obj_get_type(stack_top);
+                ujson_store(stack_top, stack_top_type, &stack_key, next);
                 goto cont;
             }
             default:
@@ -251,62 +318,189 @@ STATIC mp_obj_t mod_ujson_load(mp_obj_t stream_obj) {
                 // finished; single primitive only
                 goto success;
             }
-        } else {
-            // append to list or dict
-            if (stack_top_type == &mp_type_list) {
-                mp_obj_list_append(stack_top, next);
-            } else {
-                if (stack_key == MP_OBJ_NULL) {
-                    stack_key = next;
-                    if (enter) {
-                        goto fail;
-                    }
-                } else {
-                    mp_obj_dict_store(stack_top, stack_key, next);
-                    stack_key = MP_OBJ_NULL;
-                }
+        } else if (enter) {
+            if (stack_top_type != &mp_type_list && stack_key == MP_OBJ_NULL) {
+                // a list or dict can't be a key
+                goto fail;
             }
-            if (enter) {
-                if (stack.items == NULL) {
-                    mp_obj_list_init(&stack, 1);
-                    stack.items[0] = stack_top;
-                } else {
-                    mp_obj_list_append(MP_OBJ_FROM_PTR(&stack), stack_top);
-                }
-                stack_top = next;
-                stack_top_type = mp_obj_get_type(stack_top);
+            // the new list or dict is added to stack_top once it's complete
+            if (stack.items == NULL) {
+                mp_obj_list_init(&stack, 0);
             }
+            mp_obj_list_append(MP_OBJ_FROM_PTR(&stack), stack_top);
+            mp_obj_list_append(MP_OBJ_FROM_PTR(&stack), stack_key);
+            stack_key = MP_OBJ_NULL;
+            stack_top = next;
+            stack_top_type = mp_obj_get_type(stack_top);
+        } else {
+            // append to list or dict
+            ujson_store(stack_top, stack_top_type, &stack_key, next);
         }
     }
 success:
+    if (stack_top == MP_OBJ_NULL || stack.len != 0) {
+        // not exactly 1 object
+        goto fail;
+    }
+    return stack_top;
+
+fail:
+    ujson_syntax_error();
+}
+
+STATIC mp_obj_t ujson_load_helper(mp_obj_t stream_obj, mp_obj_t object_hook) {
+    const mp_stream_p_t *stream_p = mp_get_stream_raise(stream_obj, MP_STREAM_OP_READ);
+    ujson_stream_t s = {stream_obj, stream_p->read, 0, 0};
+    vstr_t vstr;
+    vstr_init(&vstr, 8);
+    S_NEXT(s);
+    mp_obj_t obj = ujson_parse_value(&s, &vstr, false, object_hook);
     // eat trailing whitespace
     while (unichar_isspace(S_CUR(s))) {
         S_NEXT(s);
     }
     if (!S_END(s)) {
         // unexpected chars
-        goto fail;
-    }
-    if (stack_top == MP_OBJ_NULL || stack.len != 0) {
-        // not exactly 1 object
-        goto fail;
+        ujson_syntax_error();
     }
     vstr_clear(&vstr);
-    return stack_top;
+    return obj;
+}
 
-fail:
-    mp_raise_ValueError(MP_ERROR_TEXT("syntax error in JSON"));
+#if MICROPY_PY_UJSON_OBJECT_HOOK
+STATIC mp_obj_t ujson_get_object_hook(mp_map_t *kw_args) {
+    mp_map_elem_t *elem = mp_map_lookup(kw_args, MP_OBJ_NEW_QSTR(MP_QSTR_object_hook), MP_MAP_LOOKUP);
+    if (elem == NULL || elem->value == mp_const_none) {
+        return MP_OBJ_NULL;
+    }
+    return elem->value;
+}
+
+STATIC mp_obj_t mod_ujson_load(size_t n_args, const mp_obj_t *args, mp_map_t *kw_args) {
+    (void)n_args;
+    return ujson_load_helper(args[0], ujson_get_object_hook(kw_args));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mod_ujson_load_obj, 1, mod_ujson_load);
+#else
+STATIC mp_obj_t mod_ujson_load(mp_obj_t stream_obj) {
+    return ujson_load_helper(stream_obj, MP_OBJ_NULL);
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_ujson_load_obj, mod_ujson_load);
+#endif
 
+#if MICROPY_PY_UJSON_OBJECT_HOOK
+STATIC mp_obj_t mod_ujson_loads(size_t n_args, const mp_obj_t *args, mp_map_t *kw_args) {
+    (void)n_args;
+    mp_obj_t obj = args[0];
+    mp_obj_t object_hook = ujson_get_object_hook(kw_args);
+#else
 STATIC mp_obj_t mod_ujson_loads(mp_obj_t obj) {
+    mp_obj_t object_hook = MP_OBJ_NULL;
+#endif
     mp_buffer_info_t bufinfo;
     mp_get_buffer_raise(obj, &bufinfo, MP_BUFFER_READ);
     vstr_t vstr = {bufinfo.len, bufinfo.len, (char *)bufinfo.buf, true};
     mp_obj_stringio_t sio = {{&mp_type_stringio}, &vstr, 0, MP_OBJ_NULL};
-    return mod_ujson_load(MP_OBJ_FROM_PTR(&sio));
+    return ujson_load_helper(MP_OBJ_FROM_PTR(&sio), object_hook);
 }
+#if MICROPY_PY_UJSON_OBJECT_HOOK
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mod_ujson_loads_obj, 1, mod_ujson_loads);
+#else
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_ujson_loads_obj, mod_ujson_loads);
+#endif
+
+#if MICROPY_PY_UJSON_ITERLOAD
+
+enum {
+    ITERLOAD_START,
+    ITERLOAD_LIST,
+    ITERLOAD_DICT,
+    ITERLOAD_DONE,
+};
+
+typedef struct _mp_obj_ujson_iterload_t {
+    mp_obj_base_t base;
+    mp_fun_1_t iternext;
+    ujson_stream_t s;
+    vstr_t vstr;
+    mp_obj_t object_hook;
+    byte state;
+} mp_obj_ujson_iterload_t;
+
+STATIC void ujson_iterload_skip_space(ujson_stream_t *s) {
+    while (unichar_isspace(S_CUR(*s))) {
+        S_NEXT(*s);
+    }
+}
+
+// Each item of the top-level list or dict is parsed when it's asked for
+STATIC mp_obj_t ujson_iterload_iternext(mp_obj_t self_in) {
+    mp_obj_ujson_iterload_t *self = MP_OBJ_TO_PTR(self_in);
+    if (self->state == ITERLOAD_DONE) {
+        return MP_OBJ_STOP_ITERATION;
+    }
+    if (self->state == ITERLOAD_START) {
+        S_NEXT(self->s);
+        ujson_iterload_skip_space(&self->s);
+        if (S_CUR(self->s) == '[') {
+            self->state = ITERLOAD_LIST;
+        } else if (S_CUR(self->s) == '{') {
+            self->state = ITERLOAD_DICT;
+        } else {
+            ujson_syntax_error();
+        }
+        S_NEXT(self->s);
+    }
+    mp_obj_t item = ujson_parse_value(&self->s, &self->vstr, true, self->object_hook);
+    if (item == MP_OBJ_NULL) {
+        // end of the top-level list or dict
+        ujson_iterload_skip_space(&self->s);
+        if (!S_END(self->s)) {
+            ujson_syntax_error();
+        }
+        self->state = ITERLOAD_DONE;
+        vstr_clear(&self->vstr);
+        return MP_OBJ_STOP_ITERATION;
+    }
+    if (self->state == ITERLOAD_DICT) {
+        mp_obj_t items[2] = { item, ujson_parse_value(&self->s, &self->vstr, true, self->object_hook) };
+        if (items[1] == MP_OBJ_NULL) {
+            ujson_syntax_error();
+        }
+        item = mp_obj_new_tuple(2, items);
+    }
+    return item;
+}
+
+#if MICROPY_PY_UJSON_OBJECT_HOOK
+STATIC mp_obj_t mod_ujson_iterload(size_t n_args, const mp_obj_t *args, mp_map_t *kw_args) {
+    (void)n_args;
+    mp_obj_t stream_obj = args[0];
+    mp_obj_t object_hook = ujson_get_object_hook(kw_args);
+#else
+STATIC mp_obj_t mod_ujson_iterload(mp_obj_t stream_obj) {
+    mp_obj_t object_hook = MP_OBJ_NULL;
+#endif
+    const mp_stream_p_t *stream_p = mp_get_stream_raise(stream_obj, MP_STREAM_OP_READ);
+    mp_obj_ujson_iterload_t *o = m_new_obj(mp_obj_ujson_iterload_t);
+    o->base.type = &mp_type_polymorph_iter;
+    o->iternext = ujson_iterload_iternext;
+    o->s.stream_obj = stream_obj;
+    o->s.read = stream_p->read;
+    o->s.errcode = 0;
+    o->s.cur = 0;
+    vstr_init(&o->vstr, 8);
+    o->object_hook = object_hook;
+    o->state = ITERLOAD_START;
+    return MP_OBJ_FROM_PTR(o);
+}
+#if MICROPY_PY_UJSON_OBJECT_HOOK
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mod_ujson_iterload_obj, 1, mod_ujson_iterload);
+#else
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_ujson_iterload_obj, mod_ujson_iterload);
+#endif
+
+#endif // MICROPY_PY_UJSON_ITERLOAD
 
 STATIC const mp_rom_map_elem_t mp_module_ujson_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_ujson) },
@@ -314,6 +508,9 @@ STATIC const mp_rom_map_elem_t mp_module_ujson_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_dumps), MP_ROM_PTR(&mod_ujson_dumps_obj) },
     { MP_ROM_QSTR(MP_QSTR_load), MP_ROM_PTR(&mod_ujson_load_obj) },
     { MP_ROM_QSTR(MP_QSTR_loads), MP_ROM_PTR(&mod_ujson_loads_obj) },
+    #if MICROPY_PY_UJSON_ITERLOAD
+    { MP_ROM_QSTR(MP_QSTR_iterload), MP_ROM_PTR(&mod_ujson_iterload_obj) },
+    #endif
 };
 
 STATIC MP_DEFINE_CONST_DICT(mp_module_ujson_globals, mp_module_ujson_globals_table);
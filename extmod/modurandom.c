@@ -38,6 +38,54 @@
 #define SEED_ON_IMPORT (0)
 #endif
 
+#if MICROPY_PY_URANDOM_XOSHIRO
+
+// xoshiro128++ random number generator
+// by David Blackman and Sebastiano Vigna
+// https://prng.di.unimi.it/xoshiro128plusplus.c
+// Public Domain
+//
+// It has a period of 2**128 - 1 and passes the BigCrush tests that Yasmarang
+// fails, for the cost of 16 bytes of state.  The state is set from a seed
+// with splitmix32, because it must not be all zeros.
+
+#if SEED_ON_IMPORT
+STATIC uint32_t xoshiro_s[4];
+#else
+// The state for seed(0).
+STATIC uint32_t xoshiro_s[4] = { 0x92ca2f0e, 0x3cd6e3f3, 0x1b147dcc, 0x4c081dbf };
+#endif
+
+static inline uint32_t xoshiro_rotl(uint32_t x, int k) {
+    return (x << k) | (x >> (32 - k));
+}
+
+STATIC uint32_t xoshiro128pp(void) {
+    uint32_t result = xoshiro_rotl(xoshiro_s[0] + xoshiro_s[3], 7) + xoshiro_s[0];
+    uint32_t t = xoshiro_s[1] << 9;
+    xoshiro_s[2] ^= xoshiro_s[0];
+    xoshiro_s[3] ^= xoshiro_s[1];
+    xoshiro_s[1] ^= xoshiro_s[2];
+    xoshiro_s[0] ^= xoshiro_s[3];
+    xoshiro_s[2] ^= t;
+    xoshiro_s[3] = xoshiro_rotl(xoshiro_s[3], 11);
+    return result;
+}
+
+STATIC void xoshiro_seed(uint32_t seed) {
+    for (size_t i = 0; i < 4; ++i) {
+        // splitmix32
+        uint32_t z = (seed += 0x9e3779b9);
+        z = (z ^ (z >> 16)) * 0x85ebca6b;
+        z = (z ^ (z >> 13)) * 0xc2b2ae35;
+        xoshiro_s[i] = z ^ (z >> 16);
+    }
+}
+
+#define urandom_next() xoshiro128pp()
+
+#else
+
 // Yasmarang random number generator
 // by Ilya Levin
 // http://www.literatecode.com/yasmarang
@@ -67,18 +115,22 @@ STATIC uint32_t yasmarang(void) {
 
 // End of Yasmarang
 
+#define urandom_next() yasmarang()
+
+#endif
+
 #if MICROPY_PY_URANDOM_EXTRA_FUNCS
 
 // returns an unsigned integer below the given argument
 // n must not be zero
-STATIC uint32_t yasmarang_randbelow(uint32_t n) {
+STATIC uint32_t urandom_randbelow(uint32_t n) {
     uint32_t mask = 1;
     while ((n & mask) < n) {
         mask = (mask << 1) | 1;
     }
     uint32_t r;
     do {
-        r = yasmarang() & mask;
+        r = urandom_next() & mask;
     } while (r >= n);
     return r;
 }
@@ -93,7 +145,7 @@ STATIC mp_obj_t mod_urandom_getrandbits(mp_obj_t num_in) {
     uint32_t mask = ~0;
     // Beware of C undefined behavior when shifting by >= than bit size
     mask >>= (32 - n);
-    return mp_obj_new_int_from_uint(yasmarang() & mask);
+    return mp_obj_new_int_from_uint(urandom_next() & mask);
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_urandom_getrandbits_obj, mod_urandom_getrandbits);
 
@@ -108,10 +160,14 @@ STATIC mp_obj_t mod_urandom_seed(size_t n_args, const mp_obj_t *args) {
     } else {
         seed = mp_obj_get_int_truncated(args[0]);
     }
+    #if MICROPY_PY_URANDOM_XOSHIRO
+    xoshiro_seed(seed);
+    #else
     yasmarang_pad = seed;
     yasmarang_n = 69;
     yasmarang_d = 233;
     yasmarang_dat = 0;
+    #endif
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_urandom_seed_obj, 0, 1, mod_urandom_seed);
@@ -123,7 +179,7 @@ STATIC mp_obj_t mod_urandom_randrange(size_t n_args, const mp_obj_t *args) {
     if (n_args == 1) {
         // range(stop)
         if (start > 0) {
-            return mp_obj_new_int(yasmarang_randbelow(start));
+            return mp_obj_new_int(urandom_randbelow(start));
         } else {
             goto error;
         }
@@ -132,7 +188,7 @@ STATIC mp_obj_t mod_urandom_randrange(size_t n_args, const mp_obj_t *args) {
         if (n_args == 2) {
             // range(start, stop)
             if (start < stop) {
-                return mp_obj_new_int(start + yasmarang_randbelow(stop - start));
+                return mp_obj_new_int(start + urandom_randbelow(stop - start));
             } else {
                 goto error;
             }
@@ -148,7 +204,7 @@ STATIC mp_obj_t mod_urandom_randrange(size_t n_args, const mp_obj_t *args) {
                 goto error;
             }
             if (n > 0) {
-                return mp_obj_new_int(start + step * yasmarang_randbelow(n));
+                return mp_obj_new_int(start + step * urandom_randbelow(n));
             } else {
                 goto error;
             }
@@ -164,7 +220,7 @@ STATIC mp_obj_t mod_urandom_randint(mp_obj_t a_in, mp_obj_t b_in) {
     mp_int_t a = mp_obj_get_int(a_in);
     mp_int_t b = mp_obj_get_int(b_in);
     if (a <= b) {
-        return mp_obj_new_int(a + yasmarang_randbelow(b - a + 1));
+        return mp_obj_new_int(a + urandom_randbelow(b - a + 1));
     } else {
         mp_raise_ValueError(NULL);
     }
@@ -174,37 +230,59 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_2(mod_urandom_randint_obj, mod_urandom_randint);
 STATIC mp_obj_t mod_urandom_choice(mp_obj_t seq) {
     mp_int_t len = mp_obj_get_int(mp_obj_len(seq));
     if (len > 0) {
-        return mp_obj_subscr(seq, mp_obj_new_int(yasmarang_randbelow(len)), MP_OBJ_SENTINEL);
+        return mp_obj_subscr(seq, mp_obj_new_int(urandom_randbelow(len)), MP_OBJ_SENTINEL);
     } else {
         mp_raise_type(&mp_type_IndexError);
     }
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_urandom_choice_obj, mod_urandom_choice);
 
+// randbytes_into(buf): fill a writable buffer with random bytes, using all
+// 32 bits of each number from the generator
+STATIC mp_obj_t mod_urandom_randbytes_into(mp_obj_t buf_in) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_WRITE);
+    byte *buf = bufinfo.buf;
+    size_t len = bufinfo.len;
+    for (; len >= 4; buf += 4, len -= 4) {
+        uint32_t r = urandom_next();
+        memcpy(buf, &r, 4);
+    }
+    if (len > 0) {
+        uint32_t r = urandom_next();
+        do {
+            *buf++ = r;
+            r >>= 8;
+        } while (--len);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_urandom_randbytes_into_obj, mod_urandom_randbytes_into);
+
 #if MICROPY_PY_BUILTINS_FLOAT
 
-// returns a number in the range [0..1) using Yasmarang to fill in the fraction bits
-STATIC mp_float_t yasmarang_float(void) {
+// returns a number in the range [0..1) using the generator to fill in the fraction bits
+STATIC mp_float_t urandom_float(void) {
     mp_float_union_t u;
     u.p.sgn = 0;
     u.p.exp = (1 << (MP_FLOAT_EXP_BITS - 1)) - 1;
     if (MP_FLOAT_FRAC_BITS <= 32) {
-        u.p.frc = yasmarang();
+        u.p.frc = urandom_next();
     } else {
-        u.p.frc = ((uint64_t)yasmarang() << 32) | (uint64_t)yasmarang();
+        u.p.frc = ((uint64_t)urandom_next() << 32) | (uint64_t)urandom_next();
     }
     return u.f - 1;
 }
 
 STATIC mp_obj_t mod_urandom_random(void) {
-    return mp_obj_new_float(yasmarang_float());
+    return mp_obj_new_float(urandom_float());
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_0(mod_urandom_random_obj, mod_urandom_random);
 
 STATIC mp_obj_t mod_urandom_uniform(mp_obj_t a_in, mp_obj_t b_in) {
     mp_float_t a = mp_obj_get_float(a_in);
     mp_float_t b = mp_obj_get_float(b_in);
-    return mp_obj_new_float(a + (b - a) * yasmarang_float());
+    return mp_obj_new_float(a + (b - a) * urandom_float());
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(mod_urandom_uniform_obj, mod_urandom_uniform);
 
@@ -238,6 +316,7 @@ STATIC const mp_rom_map_elem_t mp_module_urandom_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_randrange), MP_ROM_PTR(&mod_urandom_randrange_obj) },
     { MP_ROM_QSTR(MP_QSTR_randint), MP_ROM_PTR(&mod_urandom_randint_obj) },
     { MP_ROM_QSTR(MP_QSTR_choice), MP_ROM_PTR(&mod_urandom_choice_obj) },
+    { MP_ROM_QSTR(MP_QSTR_randbytes_into), MP_ROM_PTR(&mod_urandom_randbytes_into_obj) },
     #if MICROPY_PY_BUILTINS_FLOAT
     { MP_ROM_QSTR(MP_QSTR_random), MP_ROM_PTR(&mod_urandom_random_obj) },
     { MP_ROM_QSTR(MP_QSTR_uniform), MP_ROM_PTR(&mod_urandom_uniform_obj) },
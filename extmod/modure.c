@@ -171,29 +171,32 @@ STATIC const mp_obj_type_t match_type = {
 };
 #endif
 
+// Run the compiled regex on subj, filling in caps (which must be zeroed)
+STATIC int ure_exec_prog(ByteProg *prog, Subject *subj, const char **caps, int caps_num, bool is_anchored) {
+    #if MICROPY_PY_URE_PIKEVM
+    size_t work_size = re1_5_pikevm_worksize(prog, caps_num);
+    void *work = m_new(byte, work_size);
+    int res = re1_5_pikevm(prog, subj, caps, caps_num, is_anchored, work);
+    m_del(byte, work, work_size);
+    return res;
+    #else
+    return re1_5_recursiveloopprog(prog, subj, caps, caps_num, is_anchored);
+    #endif
+}
+
 STATIC void re_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
     (void)kind;
     mp_obj_re_t *self = MP_OBJ_TO_PTR(self_in);
     mp_printf(print, "<re %p>", self);
 }
 
-STATIC mp_obj_t ure_exec(bool is_anchored, uint n_args, const mp_obj_t *args) {
-    (void)n_args;
-    mp_obj_re_t *self;
-    if (mp_obj_is_type(args[0], &re_type)) {
-        self = MP_OBJ_TO_PTR(args[0]);
-    } else {
-        self = MP_OBJ_TO_PTR(mod_re_compile(1, args));
-    }
-    Subject subj;
-    size_t len;
-    subj.begin = mp_obj_str_get_data(args[1], &len);
-    subj.end = subj.begin + len;
+// Return a match object for the first match in subj, which is part of str, or None
+STATIC mp_obj_t ure_exec_subject(mp_obj_re_t *self, bool is_anchored, mp_obj_t str, Subject *subj) {
     int caps_num = (self->re.sub + 1) * 2;
     mp_obj_match_t *match = m_new_obj_var(mp_obj_match_t, char *, caps_num);
     // cast is a workaround for a bug in msvc: it treats const char** as a const pointer instead of a pointer to pointer to const char
     memset((char *)match->caps, 0, caps_num * sizeof(char *));
-    int res = re1_5_recursiveloopprog(&self->re, &subj, match->caps, caps_num, is_anchored);
+    int res = ure_exec_prog(&self->re, subj, match->caps, caps_num, is_anchored);
     if (res == 0) {
         m_del_var(mp_obj_match_t, char *, caps_num, match);
         return mp_const_none;
@@ -201,10 +204,25 @@ STATIC mp_obj_t ure_exec(bool is_anchored, uint n_args, const mp_obj_t *args) {
 
     match->base.type = &match_type;
     match->num_matches = caps_num / 2; // caps_num counts start and end pointers
-    match->str = args[1];
+    match->str = str;
     return MP_OBJ_FROM_PTR(match);
 }
 
+STATIC mp_obj_t ure_exec(bool is_anchored, uint n_args, const mp_obj_t *args) {
+    (void)n_args;
+    mp_obj_re_t *self;
+    if (mp_obj_is_type(args[0], &re_type)) {
+        self = MP_OBJ_TO_PTR(args[0]);
+    } else {
+        self = MP_OBJ_TO_PTR(mod_re_compile(1, args));
+    }
+    Subject subj;
+    size_t len;
+    subj.begin = mp_obj_str_get_data(args[1], &len);
+    subj.end = subj.begin + len;
+    return ure_exec_subject(self, is_anchored, args[1], &subj);
+}
+
 STATIC mp_obj_t re_match(size_t n_args, const mp_obj_t *args) {
     return ure_exec(true, n_args, args);
 }
@@ -234,7 +252,7 @@ STATIC mp_obj_t re_split(size_t n_args, const mp_obj_t *args) {
     while (true) {
         // cast is a workaround for a bug in msvc: it treats const char** as a const pointer instead of a pointer to pointer to const char
         memset((char **)caps, 0, caps_num * sizeof(char *));
-        int res = re1_5_recursiveloopprog(&self->re, &subj, caps, caps_num, false);
+        int res = ure_exec_prog(&self->re, &subj, caps, caps_num, false);
 
         // if we didn't have a match, or had an empty match, it's time to stop
         if (!res || caps[0] == caps[1]) {
@@ -260,6 +278,52 @@ STATIC mp_obj_t re_split(size_t n_args, const mp_obj_t *args) {
 }
 MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(re_split_obj, 2, 3, re_split);
 
+#if MICROPY_PY_URE_FINDITER
+
+typedef struct _mp_obj_re_finditer_t {
+    mp_obj_base_t base;
+    mp_fun_1_t iternext;
+    mp_obj_re_t *re;
+    mp_obj_t str;
+    Subject subj; // the part of str still to search; begin > end when done
+} mp_obj_re_finditer_t;
+
+// The search for each match is done when the iterator is advanced
+STATIC mp_obj_t re_finditer_iternext(mp_obj_t self_in) {
+    mp_obj_re_finditer_t *self = MP_OBJ_TO_PTR(self_in);
+    if (self->subj.begin > self->subj.end) {
+        return MP_OBJ_STOP_ITERATION;
+    }
+    mp_obj_t match_in = ure_exec_subject(self->re, false, self->str, &self->subj);
+    if (match_in == mp_const_none) {
+        self->subj.begin = self->subj.end + 1;
+        return MP_OBJ_STOP_ITERATION;
+    }
+    // Continue after the match, or after the next char for an empty match
+    mp_obj_match_t *match = MP_OBJ_TO_PTR(match_in);
+    self->subj.begin = match->caps[1] + (match->caps[0] == match->caps[1]);
+    return match_in;
+}
+
+STATIC mp_obj_t re_finditer(size_t n_args, const mp_obj_t *args) {
+    mp_obj_re_finditer_t *o = m_new_obj(mp_obj_re_finditer_t);
+    o->base.type = &mp_type_polymorph_iter;
+    o->iternext = re_finditer_iternext;
+    if (mp_obj_is_type(args[0], &re_type)) {
+        o->re = MP_OBJ_TO_PTR(args[0]);
+    } else {
+        o->re = MP_OBJ_TO_PTR(mod_re_compile(1, args));
+    }
+    size_t len;
+    o->str = args[1];
+    o->subj.begin = mp_obj_str_get_data(args[1], &len);
+    o->subj.end = o->subj.begin + len;
+    return MP_OBJ_FROM_PTR(o);
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(re_finditer_obj, 2, 2, re_finditer);
+
+#endif
+
 #if MICROPY_PY_URE_SUB
 
 STATIC mp_obj_t re_sub_helper(size_t n_args, const mp_obj_t *args) {
@@ -294,7 +358,7 @@ STATIC mp_obj_t re_sub_helper(size_t n_args, const mp_obj_t *args) {
     for (;;) {
         // cast is a workaround for a bug in msvc: it treats const char** as a const pointer instead of a pointer to pointer to const char
         memset((char *)match->caps, 0, caps_num * sizeof(char *));
-        int res = re1_5_recursiveloopprog(&self->re, &subj, match->caps, caps_num, false);
+        int res = ure_exec_prog(&self->re, &subj, match->caps, caps_num, false);
 
         // If we didn't have a match, or had an empty match, it's time to stop
         if (!res || match->caps[0] == match->caps[1]) {
@@ -384,6 +448,9 @@ STATIC const mp_rom_map_elem_t re_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_match), MP_ROM_PTR(&re_match_obj) },
     { MP_ROM_QSTR(MP_QSTR_search), MP_ROM_PTR(&re_search_obj) },
     { MP_ROM_QSTR(MP_QSTR_split), MP_ROM_PTR(&re_split_obj) },
+    #if MICROPY_PY_URE_FINDITER
+    { MP_ROM_QSTR(MP_QSTR_finditer), MP_ROM_PTR(&re_finditer_obj) },
+    #endif
     #if MICROPY_PY_URE_SUB
     { MP_ROM_QSTR(MP_QSTR_sub), MP_ROM_PTR(&re_sub_obj) },
     #endif
@@ -434,6 +501,9 @@ STATIC const mp_rom_map_elem_t mp_module_re_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_compile), MP_ROM_PTR(&mod_re_compile_obj) },
     { MP_ROM_QSTR(MP_QSTR_match), MP_ROM_PTR(&re_match_obj) },
     { MP_ROM_QSTR(MP_QSTR_search), MP_ROM_PTR(&re_search_obj) },
+    #if MICROPY_PY_URE_FINDITER
+    { MP_ROM_QSTR(MP_QSTR_finditer), MP_ROM_PTR(&re_finditer_obj) },
+    #endif
     #if MICROPY_PY_URE_SUB
     { MP_ROM_QSTR(MP_QSTR_sub), MP_ROM_PTR(&re_sub_obj) },
     #endif
@@ -458,7 +528,11 @@ const mp_obj_module_t mp_module_ure = {
 #if MICROPY_PY_URE_DEBUG
 #include "re1.5/dumpcode.c"
 #endif
+#if MICROPY_PY_URE_PIKEVM
+#include "re1.5/pike.c"
+#else
 #include "re1.5/recursiveloop.c"
+#endif
 #include "re1.5/charclass.c"
 
 #endif // MICROPY_PY_URE
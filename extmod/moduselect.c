@@ -36,16 +36,21 @@
 #include "py/stream.h"
 #include "py/mperrno.h"
 #include "py/mphal.h"
+#include "extmod/moduselect.h"
 
 // Flags for poll()
 #define FLAG_ONESHOT (1)
 
-typedef struct _poll_obj_t {
-    mp_obj_t obj;
-    mp_uint_t (*ioctl)(mp_obj_t obj, mp_uint_t request, uintptr_t arg, int *errcode);
-    mp_uint_t flags;
-    mp_uint_t flags_ret;
-} poll_obj_t;
+// Between polls of the objects, a port can wait for them to become ready with
+// MICROPY_PY_USELECT_WAIT(poll_map, timeout_ms), where timeout_ms is the time
+// left or -1 for no timeout.  It must handle pending events as the default of
+// MICROPY_EVENT_POLL_HOOK does.
+#ifdef MICROPY_PY_USELECT_WAIT
+#define POLL_WAIT(poll_map, timeout, start_tick) \
+    MICROPY_PY_USELECT_WAIT((poll_map), (timeout) == (mp_uint_t)-1 ? -1 : (mp_int_t)((timeout) - (mp_hal_ticks_ms() - (start_tick))))
+#else
+#define POLL_WAIT(poll_map, timeout, start_tick) MICROPY_EVENT_POLL_HOOK
+#endif
 
 STATIC void poll_map_add(mp_map_t *poll_map, const mp_obj_t *obj, mp_uint_t obj_len, mp_uint_t flags, bool or_flags) {
     for (mp_uint_t i = 0; i < obj_len; i++) {
@@ -169,7 +174,7 @@ STATIC mp_obj_t select_select(size_t n_args, const mp_obj_t *args) {
             mp_map_deinit(&poll_map);
             return mp_obj_new_tuple(3, list_array);
         }
-        MICROPY_EVENT_POLL_HOOK
+        POLL_WAIT(&poll_map, timeout, start_tick);
     }
 }
 MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp_select_select_obj, 3, 4, select_select);
@@ -247,7 +252,7 @@ STATIC mp_uint_t poll_poll_internal(uint n_args, const mp_obj_t *args) {
         if (n_ready > 0 || (timeout != (mp_uint_t)-1 && mp_hal_ticks_ms() - start_tick >= timeout)) {
             break;
         }
-        MICROPY_EVENT_POLL_HOOK
+        POLL_WAIT(&self->poll_map, timeout, start_tick);
     }
 
     return n_ready;
@@ -0,0 +1,15 @@
+#ifndef MICROPY_INCLUDED_EXTMOD_MODUSELECT_H
+#define MICROPY_INCLUDED_EXTMOD_MODUSELECT_H
+
+#include "py/obj.h"
+
+// An object registered with uselect.  Poll maps hold these, keyed by
+// mp_obj_id(obj), and a port's MICROPY_PY_USELECT_WAIT can look at them.
+typedef struct _poll_obj_t {
+    mp_obj_t obj;
+    mp_uint_t (*ioctl)(mp_obj_t obj, mp_uint_t request, uintptr_t arg, int *errcode);
+    mp_uint_t flags;
+    mp_uint_t flags_ret;
+} poll_obj_t;
+
+#endif // MICROPY_INCLUDED_EXTMOD_MODUSELECT_H
@@ -0,0 +1,179 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "py/runtime.h"
+#include "py/stream.h"
+#include "py/mphal.h"
+#include "extmod/misc.h"
+
+#if MICROPY_PY_USOCKET_POOL
+
+// A pool of idle connections, such as sockets or ussl sockets, kept open for
+// reuse under a key chosen by the caller, usually (host, port, ssl).  Entries
+// are kept in order of when they were put in, oldest first.
+
+typedef struct _pool_entry_t {
+    mp_obj_t key;
+    mp_obj_t sock;
+    mp_uint_t put_ms;
+} pool_entry_t;
+
+typedef struct _mp_obj_usocket_pool_t {
+    mp_obj_base_t base;
+    mp_uint_t idle_ms;
+    size_t alloc;
+    size_t len;
+    pool_entry_t entry[];
+} mp_obj_usocket_pool_t;
+
+STATIC void pool_remove(mp_obj_usocket_pool_t *self, size_t i, bool close) {
+    mp_obj_t sock = self->entry[i].sock;
+    --self->len;
+    memmove(&self->entry[i], &self->entry[i + 1], (self->len - i) * sizeof(pool_entry_t));
+    self->entry[self->len].key = MP_OBJ_NULL;
+    self->entry[self->len].sock = MP_OBJ_NULL;
+    if (close) {
+        mp_stream_close(sock);
+    }
+}
+
+// Close the connections that have been idle for too long
+STATIC void pool_expire(mp_obj_usocket_pool_t *self) {
+    mp_uint_t now = mp_hal_ticks_ms();
+    while (self->len > 0 && now - self->entry[0].put_ms >= self->idle_ms) {
+        pool_remove(self, 0, true);
+    }
+}
+
+// An idle connection should have nothing to read: if it polls as readable then
+// the peer closed it or sent something unexpected, and it can't be reused.
+STATIC bool pool_sock_is_healthy(mp_obj_t sock) {
+    const mp_stream_p_t *stream_p = mp_get_stream(sock);
+    int errcode;
+    mp_uint_t ret = stream_p->ioctl(sock, MP_STREAM_POLL,
+        MP_STREAM_POLL_RD | MP_STREAM_POLL_ERR | MP_STREAM_POLL_HUP, &errcode);
+    return ret == 0;
+}
+
+STATIC mp_obj_t pool_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *all_args) {
+    enum { ARG_size, ARG_idle_ms };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_size, MP_ARG_INT, {.u_int = 4} },
+        { MP_QSTR_idle_ms, MP_ARG_INT, {.u_int = 60000} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all_kw_array(n_args, n_kw, all_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    if (args[ARG_size].u_int < 1 || args[ARG_idle_ms].u_int < 0) {
+        mp_raise_ValueError(NULL);
+    }
+
+    mp_obj_usocket_pool_t *self = m_new_obj_var(mp_obj_usocket_pool_t, pool_entry_t, args[ARG_size].u_int);
+    self->base.type = type;
+    self->idle_ms = args[ARG_idle_ms].u_int;
+    self->alloc = args[ARG_size].u_int;
+    self->len = 0;
+    memset(self->entry, 0, self->alloc * sizeof(pool_entry_t));
+    return MP_OBJ_FROM_PTR(self);
+}
+
+STATIC mp_obj_t pool_unary_op(mp_unary_op_t op, mp_obj_t self_in) {
+    mp_obj_usocket_pool_t *self = MP_OBJ_TO_PTR(self_in);
+    switch (op) {
+        case MP_UNARY_OP_BOOL:
+            return mp_obj_new_bool(self->len != 0);
+        case MP_UNARY_OP_LEN:
+            return MP_OBJ_NEW_SMALL_INT(self->len);
+        default:
+            return MP_OBJ_NULL; // op not supported
+    }
+}
+
+// Pool.put(key, sock): keep an open connection for reuse, closing the oldest
+// one if the pool is full
+STATIC mp_obj_t pool_put(mp_obj_t self_in, mp_obj_t key, mp_obj_t sock) {
+    mp_obj_usocket_pool_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_get_stream_raise(sock, MP_STREAM_OP_IOCTL);
+    pool_expire(self);
+    if (self->len == self->alloc) {
+        pool_remove(self, 0, true);
+    }
+    pool_entry_t *e = &self->entry[self->len++];
+    e->key = key;
+    e->sock = sock;
+    e->put_ms = mp_hal_ticks_ms();
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(pool_put_obj, pool_put);
+
+// Pool.get(key): take the most recent healthy connection for the key out of the
+// pool, or return None
+STATIC mp_obj_t pool_get(mp_obj_t self_in, mp_obj_t key) {
+    mp_obj_usocket_pool_t *self = MP_OBJ_TO_PTR(self_in);
+    pool_expire(self);
+    for (size_t i = self->len; i-- > 0;) {
+        if (!mp_obj_equal(self->entry[i].key, key)) {
+            continue;
+        }
+        mp_obj_t sock = self->entry[i].sock;
+        bool healthy = pool_sock_is_healthy(sock);
+        pool_remove(self, i, !healthy);
+        if (healthy) {
+            return sock;
+        }
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(pool_get_obj, pool_get);
+
+// Pool.close(): close all the connections in the pool
+STATIC mp_obj_t pool_close(mp_obj_t self_in) {
+    mp_obj_usocket_pool_t *self = MP_OBJ_TO_PTR(self_in);
+    while (self->len > 0) {
+        pool_remove(self, self->len - 1, true);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(pool_close_obj, pool_close);
+
+STATIC const mp_rom_map_elem_t pool_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_put), MP_ROM_PTR(&pool_put_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get), MP_ROM_PTR(&pool_get_obj) },
+    { MP_ROM_QSTR(MP_QSTR_close), MP_ROM_PTR(&pool_close_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(pool_locals_dict, pool_locals_dict_table);
+
+const mp_obj_type_t mp_type_usocket_pool = {
+    { &mp_type_type },
+    .name = MP_QSTR_Pool,
+    .make_new = pool_make_new,
+    .unary_op = pool_unary_op,
+    .locals_dict = (mp_obj_dict_t *)&pool_locals_dict,
+};
+
+#endif // MICROPY_PY_USOCKET_POOL
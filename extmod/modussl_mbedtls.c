@@ -56,6 +56,9 @@ typedef struct _mp_obj_ssl_socket_t {
     mbedtls_x509_crt cacert;
     mbedtls_x509_crt cert;
     mbedtls_pk_context pkey;
+    // The direction (MP_STREAM_POLL_RD or MP_STREAM_POLL_WR) that mbedtls last
+    // needed the underlying socket to be ready in, or 0 if it isn't waiting
+    uintptr_t poll_mask;
 } mp_obj_ssl_socket_t;
 
 struct ssl_args {
@@ -64,10 +67,25 @@ struct ssl_args {
     mp_arg_val_t server_side;
     mp_arg_val_t server_hostname;
     mp_arg_val_t do_handshake;
+    #if MICROPY_PY_USSL_SESSION
+    mp_arg_val_t session;
+    #endif
 };
 
 STATIC const mp_obj_type_t ussl_socket_type;
 
+#if MICROPY_PY_USSL_SESSION
+// A copy of the session parameters of an established client connection, which
+// can be passed to wrap_socket to resume that session with an abbreviated
+// handshake (via a session ticket, or the session ID cached by the server).
+typedef struct _mp_obj_ssl_session_t {
+    mp_obj_base_t base;
+    mbedtls_ssl_session session;
+} mp_obj_ssl_session_t;
+
+STATIC const mp_obj_type_t ussl_session_type;
+#endif
+
 #ifdef MBEDTLS_DEBUG_C
 STATIC void mbedtls_debug(void *ctx, int level, const char *file, int line, const char *str) {
     (void)ctx;
@@ -156,6 +174,12 @@ STATIC mp_obj_ssl_socket_t *socket_new(mp_obj_t sock, struct ssl_args *args) {
     // Verify the socket object has the full stream protocol
     mp_get_stream_raise(sock, MP_STREAM_OP_READ | MP_STREAM_OP_WRITE | MP_STREAM_OP_IOCTL);
 
+    #if MICROPY_PY_USSL_SESSION
+    if (args->session.u_obj != mp_const_none && !mp_obj_is_type(args->session.u_obj, &ussl_session_type)) {
+        mp_raise_TypeError(NULL);
+    }
+    #endif
+
     #if MICROPY_PY_USSL_FINALISER
     mp_obj_ssl_socket_t *o = m_new_obj_with_finaliser(mp_obj_ssl_socket_t);
     #else
@@ -163,6 +187,7 @@ STATIC mp_obj_ssl_socket_t *socket_new(mp_obj_t sock, struct ssl_args *args) {
     #endif
     o->base.type = &ussl_socket_type;
     o->sock = sock;
+    o->poll_mask = 0;
 
     int ret;
     mbedtls_ssl_init(&o->ssl);
@@ -212,6 +237,16 @@ STATIC mp_obj_ssl_socket_t *socket_new(mp_obj_t sock, struct ssl_args *args) {
 
     mbedtls_ssl_set_bio(&o->ssl, &o->sock, _mbedtls_ssl_send, _mbedtls_ssl_recv, NULL);
 
+    #if MICROPY_PY_USSL_SESSION
+    if (args->session.u_obj != mp_const_none) {
+        mp_obj_ssl_session_t *session = MP_OBJ_TO_PTR(args->session.u_obj);
+        ret = mbedtls_ssl_set_session(&o->ssl, &session->session);
+        if (ret != 0) {
+            goto cleanup;
+        }
+    }
+    #endif
+
     if (args->key.u_obj != mp_const_none) {
         size_t key_len;
         const byte *key = (const byte *)mp_obj_str_get_data(args->key.u_obj, &key_len);
@@ -280,6 +315,49 @@ STATIC mp_obj_t mod_ssl_getpeercert(mp_obj_t o_in, mp_obj_t binary_form) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(mod_ssl_getpeercert_obj, mod_ssl_getpeercert);
 
+#if MICROPY_PY_USSL_SESSION
+STATIC mp_obj_t mod_ssl_session(mp_obj_t o_in) {
+    mp_obj_ssl_socket_t *o = MP_OBJ_TO_PTR(o_in);
+    #if MICROPY_PY_USSL_FINALISER
+    mp_obj_ssl_session_t *session = m_new_obj_with_finaliser(mp_obj_ssl_session_t);
+    #else
+    mp_obj_ssl_session_t *session = m_new_obj(mp_obj_ssl_session_t);
+    #endif
+    session->base.type = &ussl_session_type;
+    mbedtls_ssl_session_init(&session->session);
+    // This fails if the socket is server side or the handshake isn't done yet
+    int ret = mbedtls_ssl_get_session(&o->ssl, &session->session);
+    if (ret != 0) {
+        mbedtls_ssl_session_free(&session->session);
+        mbedtls_raise_error(ret);
+    }
+    return MP_OBJ_FROM_PTR(session);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_ssl_session_obj, mod_ssl_session);
+
+#if MICROPY_PY_USSL_FINALISER
+STATIC mp_obj_t ussl_session_del(mp_obj_t self_in) {
+    mp_obj_ssl_session_t *self = MP_OBJ_TO_PTR(self_in);
+    mbedtls_ssl_session_free(&self->session);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(ussl_session_del_obj, ussl_session_del);
+
+STATIC const mp_rom_map_elem_t ussl_session_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR___del__), MP_ROM_PTR(&ussl_session_del_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(ussl_session_locals_dict, ussl_session_locals_dict_table);
+#endif
+
+STATIC const mp_obj_type_t ussl_session_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_SSLSession,
+    #if MICROPY_PY_USSL_FINALISER
+    .locals_dict = (void *)&ussl_session_locals_dict,
+    #endif
+};
+#endif
+
 STATIC void socket_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
     (void)kind;
     mp_obj_ssl_socket_t *self = MP_OBJ_TO_PTR(self_in);
@@ -289,6 +367,7 @@ STATIC void socket_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kin
 STATIC mp_uint_t socket_read(mp_obj_t o_in, void *buf, mp_uint_t size, int *errcode) {
     mp_obj_ssl_socket_t *o = MP_OBJ_TO_PTR(o_in);
 
+    o->poll_mask = 0;
     int ret = mbedtls_ssl_read(&o->ssl, buf, size);
     if (ret == MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY) {
         // end of stream
@@ -298,11 +377,13 @@ STATIC mp_uint_t socket_read(mp_obj_t o_in, void *buf, mp_uint_t size, int *errc
         return ret;
     }
     if (ret == MBEDTLS_ERR_SSL_WANT_READ) {
+        o->poll_mask = MP_STREAM_POLL_RD;
         ret = MP_EWOULDBLOCK;
     } else if (ret == MBEDTLS_ERR_SSL_WANT_WRITE) {
         // If handshake is not finished, read attempt may end up in protocol
         // wanting to write next handshake message. The same may happen with
         // renegotation.
+        o->poll_mask = MP_STREAM_POLL_WR;
         ret = MP_EWOULDBLOCK;
     }
     *errcode = ret;
@@ -312,16 +393,19 @@ STATIC mp_uint_t socket_read(mp_obj_t o_in, void *buf, mp_uint_t size, int *errc
 STATIC mp_uint_t socket_write(mp_obj_t o_in, const void *buf, mp_uint_t size, int *errcode) {
     mp_obj_ssl_socket_t *o = MP_OBJ_TO_PTR(o_in);
 
+    o->poll_mask = 0;
     int ret = mbedtls_ssl_write(&o->ssl, buf, size);
     if (ret >= 0) {
         return ret;
     }
     if (ret == MBEDTLS_ERR_SSL_WANT_WRITE) {
+        o->poll_mask = MP_STREAM_POLL_WR;
         ret = MP_EWOULDBLOCK;
     } else if (ret == MBEDTLS_ERR_SSL_WANT_READ) {
         // If handshake is not finished, write attempt may end up in protocol
         // wanting to read next handshake message. The same may happen with
         // renegotation.
+        o->poll_mask = MP_STREAM_POLL_RD;
         ret = MP_EWOULDBLOCK;
     }
     *errcode = ret;
@@ -348,8 +432,31 @@ STATIC mp_uint_t socket_ioctl(mp_obj_t o_in, mp_uint_t request, uintptr_t arg, i
         mbedtls_ssl_config_free(&self->conf);
         mbedtls_ctr_drbg_free(&self->ctr_drbg);
         mbedtls_entropy_free(&self->entropy);
+    } else if (request == MP_STREAM_POLL) {
+        const uintptr_t rdwr = MP_STREAM_POLL_RD | MP_STREAM_POLL_WR;
+        uintptr_t want = arg & rdwr;
+        mp_uint_t ret = 0;
+        // Data already decrypted by mbedtls can be read without the socket
+        if ((want & MP_STREAM_POLL_RD) && mbedtls_ssl_get_bytes_avail(&self->ssl) > 0) {
+            ret |= MP_STREAM_POLL_RD;
+        }
+        // If mbedtls is waiting on the socket in one direction (eg a read during
+        // the handshake may first need to write) then a read or write can proceed
+        // once the socket is ready in that direction, so poll for that instead.
+        uintptr_t mask = want ? self->poll_mask : 0;
+        if (mask) {
+            arg = (arg & ~rdwr) | mask;
+        }
+        mp_uint_t res = mp_get_stream(self->sock)->ioctl(self->sock, request, arg, errcode);
+        if (res == MP_STREAM_ERROR) {
+            return res;
+        }
+        if (mask) {
+            res = (res & ~rdwr) | ((res & mask) ? want : 0);
+        }
+        return ret | res;
     }
-    // Pass all requests down to the underlying socket
+    // Pass all other requests down to the underlying socket
     return mp_get_stream(self->sock)->ioctl(self->sock, request, arg, errcode);
 }
 
@@ -364,6 +471,9 @@ STATIC const mp_rom_map_elem_t ussl_socket_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR___del__), MP_ROM_PTR(&mp_stream_close_obj) },
     #endif
     { MP_ROM_QSTR(MP_QSTR_getpeercert), MP_ROM_PTR(&mod_ssl_getpeercert_obj) },
+    #if MICROPY_PY_USSL_SESSION
+    { MP_ROM_QSTR(MP_QSTR_session), MP_ROM_PTR(&mod_ssl_session_obj) },
+    #endif
 };
 
 STATIC MP_DEFINE_CONST_DICT(ussl_socket_locals_dict, ussl_socket_locals_dict_table);
@@ -393,6 +503,9 @@ STATIC mp_obj_t mod_ssl_wrap_socket(size_t n_args, const mp_obj_t *pos_args, mp_
         { MP_QSTR_server_side, MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = false} },
         { MP_QSTR_server_hostname, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
         { MP_QSTR_do_handshake, MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = true} },
+        #if MICROPY_PY_USSL_SESSION
+        { MP_QSTR_session, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+        #endif
     };
 
     // TODO: Check that sock implements stream protocol
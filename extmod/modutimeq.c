@@ -129,13 +129,16 @@ STATIC mp_obj_t mod_utimeq_heappush(size_t n_args, const mp_obj_t *args) {
         mp_raise_msg(&mp_type_IndexError, MP_ERROR_TEXT("queue overflow"));
     }
     mp_uint_t l = heap->len;
+    mp_uint_t id = utimeq_id;
+    // ids wrap within the small-int range so they can be returned as handles
+    utimeq_id = (utimeq_id + 1) & MP_SMALL_INT_POSITIVE_MASK;
     heap->items[l].time = MP_OBJ_SMALL_INT_VALUE(args[1]);
-    heap->items[l].id = utimeq_id++;
+    heap->items[l].id = id;
     heap->items[l].callback = args[2];
     heap->items[l].args = args[3];
     utimeq_heap_siftdown(heap, 0, heap->len);
     heap->len++;
-    return mp_const_none;
+    return MP_OBJ_NEW_SMALL_INT(id);
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_utimeq_heappush_obj, 4, 4, mod_utimeq_heappush);
 
@@ -175,6 +178,29 @@ STATIC mp_obj_t mod_utimeq_peektime(mp_obj_t heap_in) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_utimeq_peektime_obj, mod_utimeq_peektime);
 
+// Remove the entry with the handle that push() returned for it.  The queue is
+// searched linearly, which is fine for the few entries a utimeq holds.
+STATIC mp_obj_t mod_utimeq_cancel(mp_obj_t heap_in, mp_obj_t handle_in) {
+    mp_obj_utimeq_t *heap = utimeq_get_heap(heap_in);
+    mp_uint_t id = mp_obj_get_int(handle_in);
+    for (mp_uint_t pos = 0; pos < heap->len; ++pos) {
+        if (heap->items[pos].id == id) {
+            heap->len -= 1;
+            heap->items[pos] = heap->items[heap->len];
+            heap->items[heap->len].callback = MP_OBJ_NULL; // so we don't retain a pointer
+            heap->items[heap->len].args = MP_OBJ_NULL;
+            if (pos < heap->len) {
+                // the last entry may belong above or below where the removed one was
+                utimeq_heap_siftup(heap, pos);
+                utimeq_heap_siftdown(heap, 0, pos);
+            }
+            return mp_const_true;
+        }
+    }
+    return mp_const_false;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(mod_utimeq_cancel_obj, mod_utimeq_cancel);
+
 #if DEBUG
 STATIC mp_obj_t mod_utimeq_dump(mp_obj_t heap_in) {
     mp_obj_utimeq_t *heap = utimeq_get_heap(heap_in);
@@ -203,6 +229,7 @@ STATIC const mp_rom_map_elem_t utimeq_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_push), MP_ROM_PTR(&mod_utimeq_heappush_obj) },
     { MP_ROM_QSTR(MP_QSTR_pop), MP_ROM_PTR(&mod_utimeq_heappop_obj) },
     { MP_ROM_QSTR(MP_QSTR_peektime), MP_ROM_PTR(&mod_utimeq_peektime_obj) },
+    { MP_ROM_QSTR(MP_QSTR_cancel), MP_ROM_PTR(&mod_utimeq_cancel_obj) },
     #if DEBUG
     { MP_ROM_QSTR(MP_QSTR_dump), MP_ROM_PTR(&mod_utimeq_dump_obj) },
     #endif
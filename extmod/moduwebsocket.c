@@ -34,25 +34,42 @@
 
 #if MICROPY_PY_UWEBSOCKET
 
-enum { FRAME_HEADER, FRAME_OPT, PAYLOAD, CONTROL };
+enum { FRAME_HEADER, PAYLOAD, CONTROL };
 
-enum { BLOCKING_WRITE = 0x80 };
+enum { STOP_AT_MSG_END = 0x40, BLOCKING_WRITE = 0x80 };
+
+#define FRAME_FIN (0x80)
+
+// Big enough for the longest frame header (2 + 8 byte length + 4 byte mask),
+// so that a header and the start of its payload usually come in one read.
+#define WEBSOCKET_RXBUF_SIZE (32)
+
+// Payloads up to this size are sent in one write together with their header.
+#define WEBSOCKET_TX_COALESCE_SIZE (128)
+
+// Larger payloads are split into frames of at most this size.
+#define WEBSOCKET_TX_FRAME_MAX (0xffff)
 
 typedef struct _mp_obj_websocket_t {
     mp_obj_base_t base;
     mp_obj_t sock;
     uint32_t msg_sz;
+    // Bytes of the current message received so far by recv_into
+    uint32_t recv_total;
     byte mask[4];
     byte state;
-    byte to_recv;
     byte mask_pos;
+    // Read-ahead buffer, holding unconsumed bytes in buf[buf_pos:buf_len]
     byte buf_pos;
-    byte buf[6];
+    byte buf_len;
+    byte buf[WEBSOCKET_RXBUF_SIZE];
     byte opts;
     // Copy of last data frame flags
     byte ws_flags;
     // Copy of current frame flags
     byte last_flags;
+    // Set when the final frame of a data message has been consumed
+    bool msg_done;
 } mp_obj_websocket_t;
 
 STATIC mp_uint_t websocket_write(mp_obj_t self_in, const void *buf, mp_uint_t size, int *errcode);
@@ -64,99 +81,126 @@ STATIC mp_obj_t websocket_make_new(const mp_obj_type_t *type, size_t n_args, siz
     o->base.type = type;
     o->sock = args[0];
     o->state = FRAME_HEADER;
-    o->to_recv = 2;
+    o->recv_total = 0;
     o->mask_pos = 0;
     o->buf_pos = 0;
+    o->buf_len = 0;
     o->opts = FRAME_TXT;
+    o->msg_done = false;
     if (n_args > 1 && args[1] == mp_const_true) {
         o->opts |= BLOCKING_WRITE;
     }
     return MP_OBJ_FROM_PTR(o);
 }
 
+// XOR buf with the mask, starting at *mask_pos, a word at a time.
+STATIC void websocket_unmask(byte *buf, size_t size, const byte *mask, byte *mask_pos) {
+    if (!(mask[0] | mask[1] | mask[2] | mask[3])) {
+        return;
+    }
+    byte pos = *mask_pos;
+    *mask_pos = pos + size;
+    // bytes up to a word boundary
+    for (; size && ((uintptr_t)buf & 3); --size, ++pos) {
+        *buf++ ^= mask[pos & 3];
+    }
+    if (size >= 4) {
+        // the mask rotated to start at pos, in memory order
+        byte rot[4] = {mask[pos & 3], mask[(pos + 1) & 3], mask[(pos + 2) & 3], mask[(pos + 3) & 3]};
+        uint32_t m;
+        memcpy(&m, rot, 4);
+        uint32_t *w = (uint32_t *)buf;
+        for (size_t n = size >> 2; n--;) {
+            *w++ ^= m;
+        }
+        buf = (byte *)w;
+        size &= 3;
+    }
+    for (; size; --size, ++pos) {
+        *buf++ ^= mask[pos & 3];
+    }
+}
+
+// Make sure at least n bytes are in the read-ahead buffer, reading as much
+// as the stream has available.  Returns 0 at EOF, MP_STREAM_ERROR on error
+// (including when a non-blocking stream has no more data yet), or n.
+STATIC mp_uint_t websocket_fill(mp_obj_websocket_t *self, size_t n, int *errcode) {
+    if ((size_t)(self->buf_len - self->buf_pos) >= n) {
+        return n;
+    }
+    memmove(self->buf, self->buf + self->buf_pos, self->buf_len - self->buf_pos);
+    self->buf_len -= self->buf_pos;
+    self->buf_pos = 0;
+    const mp_stream_p_t *stream_p = mp_get_stream(self->sock);
+    while (self->buf_len < n) {
+        mp_uint_t out_sz = stream_p->read(self->sock, self->buf + self->buf_len, sizeof(self->buf) - self->buf_len, errcode);
+        if (out_sz == 0 || out_sz == MP_STREAM_ERROR) {
+            return out_sz;
+        }
+        self->buf_len += out_sz;
+    }
+    return n;
+}
+
 STATIC mp_uint_t websocket_read(mp_obj_t self_in, void *buf, mp_uint_t size, int *errcode) {
     mp_obj_websocket_t *self = MP_OBJ_TO_PTR(self_in);
     const mp_stream_p_t *stream_p = mp_get_stream(self->sock);
     while (1) {
-        if (self->to_recv != 0) {
-            mp_uint_t out_sz = stream_p->read(self->sock, self->buf + self->buf_pos, self->to_recv, errcode);
-            if (out_sz == 0 || out_sz == MP_STREAM_ERROR) {
-                return out_sz;
-            }
-            self->buf_pos += out_sz;
-            self->to_recv -= out_sz;
-            if (self->to_recv != 0) {
-                *errcode = MP_EAGAIN;
-                return MP_STREAM_ERROR;
-            }
-        }
-
         switch (self->state) {
             case FRAME_HEADER: {
-                // TODO: Split frame handling below is untested so far, so conservatively disable it
-                assert(self->buf[0] & 0x80);
+                mp_uint_t out_sz = websocket_fill(self, 2, errcode);
+                if (out_sz == 0 || out_sz == MP_STREAM_ERROR) {
+                    return out_sz;
+                }
+                const byte *hdr = self->buf + self->buf_pos;
+                size_t sz = hdr[1] & 0x7f;
+                size_t hdr_sz = 2 + (sz == 126 ? 2 : sz == 127 ? 8 : 0) + (hdr[1] & 0x80 ? 4 : 0);
+                // wait for the whole header before consuming any of it
+                out_sz = websocket_fill(self, hdr_sz, errcode);
+                if (out_sz == 0 || out_sz == MP_STREAM_ERROR) {
+                    return out_sz;
+                }
+                hdr = self->buf + self->buf_pos;
+                self->buf_pos += hdr_sz;
 
                 // "Control frames MAY be injected in the middle of a fragmented message."
                 // So, they must be processed before data frames (and not alter
                 // self->ws_flags)
-                byte frame_type = self->buf[0];
-                self->last_flags = frame_type;
-                frame_type &= FRAME_OPCODE_MASK;
-
-                if ((self->buf[0] & FRAME_OPCODE_MASK) == FRAME_CONT) {
-                    // Preserve previous frame type
-                    self->ws_flags = (self->ws_flags & FRAME_OPCODE_MASK) | (self->buf[0] & ~FRAME_OPCODE_MASK);
+                self->last_flags = hdr[0];
+                byte frame_type = hdr[0] & FRAME_OPCODE_MASK;
+                if (frame_type >= FRAME_CLOSE) {
+                    self->state = CONTROL;
                 } else {
-                    self->ws_flags = self->buf[0];
+                    if (frame_type == FRAME_CONT) {
+                        // Preserve previous frame type
+                        self->ws_flags = (self->ws_flags & FRAME_OPCODE_MASK) | (hdr[0] & ~FRAME_OPCODE_MASK);
+                    } else {
+                        self->ws_flags = hdr[0];
+                    }
+                    self->state = PAYLOAD;
                 }
 
-                // Reset mask in case someone will use "simplified" protocol
-                // without masks.
-                memset(self->mask, 0, sizeof(self->mask));
-
-                int to_recv = 0;
-                size_t sz = self->buf[1] & 0x7f;
+                const byte *opt = hdr + 2;
                 if (sz == 126) {
                     // Msg size is next 2 bytes
-                    to_recv += 2;
+                    sz = opt[0] << 8 | opt[1];
+                    opt += 2;
                 } else if (sz == 127) {
-                    // Msg size is next 8 bytes
-                    assert(0);
-                }
-                if (self->buf[1] & 0x80) {
-                    // Next 4 bytes is mask
-                    to_recv += 4;
-                }
-
-                self->buf_pos = 0;
-                self->to_recv = to_recv;
-                self->msg_sz = sz; // May be overridden by FRAME_OPT
-                if (to_recv != 0) {
-                    self->state = FRAME_OPT;
-                } else {
-                    if (frame_type >= FRAME_CLOSE) {
-                        self->state = CONTROL;
-                    } else {
-                        self->state = PAYLOAD;
+                    // Msg size is next 8 bytes, of which only 32 bits are supported
+                    if (opt[0] | opt[1] | opt[2] | opt[3]) {
+                        *errcode = MP_EIO;
+                        return MP_STREAM_ERROR;
                     }
+                    sz = (uint32_t)opt[4] << 24 | opt[5] << 16 | opt[6] << 8 | opt[7];
+                    opt += 8;
                 }
-                continue;
-            }
-
-            case FRAME_OPT: {
-                if ((self->buf_pos & 3) == 2) {
-                    // First two bytes are message length
-                    self->msg_sz = (self->buf[0] << 8) | self->buf[1];
-                }
-                if (self->buf_pos >= 4) {
-                    // Last 4 bytes is mask
-                    memcpy(self->mask, self->buf + self->buf_pos - 4, 4);
-                }
-                self->buf_pos = 0;
-                if ((self->last_flags & FRAME_OPCODE_MASK) >= FRAME_CLOSE) {
-                    self->state = CONTROL;
+                self->msg_sz = sz;
+                self->mask_pos = 0;
+                if (hdr[1] & 0x80) {
+                    memcpy(self->mask, opt, 4);
                 } else {
-                    self->state = PAYLOAD;
+                    // "simplified" protocol without masks
+                    memset(self->mask, 0, sizeof(self->mask));
                 }
                 continue;
             }
@@ -164,31 +208,38 @@ STATIC mp_uint_t websocket_read(mp_obj_t self_in, void *buf, mp_uint_t size, int
             case PAYLOAD:
             case CONTROL: {
                 mp_uint_t out_sz = 0;
-                if (self->msg_sz == 0) {
-                    // In case message had zero payload
-                    goto no_payload;
-                }
-
-                size_t sz = MIN(size, self->msg_sz);
-                out_sz = stream_p->read(self->sock, buf, sz, errcode);
-                if (out_sz == 0 || out_sz == MP_STREAM_ERROR) {
-                    return out_sz;
-                }
-
-                sz = out_sz;
-                for (byte *p = buf; sz--; p++) {
-                    *p ^= self->mask[self->mask_pos++ & 3];
+                if (self->msg_sz != 0) {
+                    byte *dest = buf;
+                    size_t sz = MIN(size, self->msg_sz);
+                    if (self->state == CONTROL) {
+                        // control payloads are discarded, through the read-ahead buffer
+                        out_sz = websocket_fill(self, 1, errcode);
+                        if (out_sz == 0 || out_sz == MP_STREAM_ERROR) {
+                            return out_sz;
+                        }
+                        out_sz = MIN(self->msg_sz, (size_t)(self->buf_len - self->buf_pos));
+                        self->buf_pos += out_sz;
+                        dest = NULL;
+                    } else if (self->buf_pos < self->buf_len) {
+                        // payload that came in with the header
+                        out_sz = MIN(sz, (size_t)(self->buf_len - self->buf_pos));
+                        memcpy(dest, self->buf + self->buf_pos, out_sz);
+                        self->buf_pos += out_sz;
+                    } else {
+                        out_sz = stream_p->read(self->sock, dest, sz, errcode);
+                        if (out_sz == 0 || out_sz == MP_STREAM_ERROR) {
+                            return out_sz;
+                        }
+                    }
+                    if (dest != NULL) {
+                        websocket_unmask(dest, out_sz, self->mask, &self->mask_pos);
+                    }
+                    self->msg_sz -= out_sz;
                 }
 
-                self->msg_sz -= out_sz;
                 if (self->msg_sz == 0) {
-                    byte last_state;
-                no_payload:
-                    last_state = self->state;
+                    byte last_state = self->state;
                     self->state = FRAME_HEADER;
-                    self->to_recv = 2;
-                    self->mask_pos = 0;
-                    self->buf_pos = 0;
 
                     // Handle control frame
                     if (last_state == CONTROL) {
@@ -203,6 +254,15 @@ STATIC mp_uint_t websocket_read(mp_obj_t self_in, void *buf, mp_uint_t size, int
                         // DEBUG_printf("Finished receiving ctrl message %x, ignoring\n", self->last_flags);
                         continue;
                     }
+
+                    if (self->last_flags & FRAME_FIN) {
+                        self->msg_done = true;
+                        if (self->opts & STOP_AT_MSG_END) {
+                            return out_sz;
+                        }
+                    }
+                } else if (self->state == CONTROL) {
+                    continue;
                 }
 
                 if (out_sz != 0) {
@@ -218,18 +278,6 @@ STATIC mp_uint_t websocket_read(mp_obj_t self_in, void *buf, mp_uint_t size, int
 
 STATIC mp_uint_t websocket_write(mp_obj_t self_in, const void *buf, mp_uint_t size, int *errcode) {
     mp_obj_websocket_t *self = MP_OBJ_TO_PTR(self_in);
-    assert(size < 0x10000);
-    byte header[4] = {0x80 | (self->opts & FRAME_OPCODE_MASK)};
-    int hdr_sz;
-    if (size < 126) {
-        header[1] = size;
-        hdr_sz = 2;
-    } else {
-        header[1] = 126;
-        header[2] = size >> 8;
-        header[3] = size & 0xff;
-        hdr_sz = 4;
-    }
 
     mp_obj_t dest[3];
     if (self->opts & BLOCKING_WRITE) {
@@ -238,10 +286,44 @@ STATIC mp_uint_t websocket_write(mp_obj_t self_in, const void *buf, mp_uint_t si
         mp_call_method_n_kw(1, 0, dest);
     }
 
-    mp_uint_t out_sz = mp_stream_write_exactly(self->sock, header, hdr_sz, errcode);
-    if (*errcode == 0) {
-        out_sz = mp_stream_write_exactly(self->sock, buf, size, errcode);
-    }
+    // Send the payload as one frame, or as a fragmented message if it is too
+    // big for a frame with a 16-bit length.
+    const byte *p = buf;
+    mp_uint_t out_sz = 0;
+    *errcode = 0;
+    byte opcode = self->opts & FRAME_OPCODE_MASK;
+    do {
+        size_t frag_sz = MIN(size - out_sz, WEBSOCKET_TX_FRAME_MAX);
+        bool last = out_sz + frag_sz == size;
+        byte frame[4 + WEBSOCKET_TX_COALESCE_SIZE];
+        size_t hdr_sz;
+        frame[0] = (last ? FRAME_FIN : 0) | opcode;
+        if (frag_sz < 126) {
+            frame[1] = frag_sz;
+            hdr_sz = 2;
+        } else {
+            frame[1] = 126;
+            frame[2] = frag_sz >> 8;
+            frame[3] = frag_sz & 0xff;
+            hdr_sz = 4;
+        }
+        opcode = FRAME_CONT;
+        if (frag_sz <= WEBSOCKET_TX_COALESCE_SIZE) {
+            // small frames go out in a single write
+            memcpy(frame + hdr_sz, p, frag_sz);
+            mp_stream_write_exactly(self->sock, frame, hdr_sz + frag_sz, errcode);
+        } else {
+            mp_stream_write_exactly(self->sock, frame, hdr_sz, errcode);
+            if (*errcode == 0) {
+                mp_stream_write_exactly(self->sock, p, frag_sz, errcode);
+            }
+        }
+        if (*errcode != 0) {
+            break;
+        }
+        p += frag_sz;
+        out_sz += frag_sz;
+    } while (out_sz < size);
 
     if (self->opts & BLOCKING_WRITE) {
         dest[2] = mp_const_false;
@@ -254,6 +336,48 @@ STATIC mp_uint_t websocket_write(mp_obj_t self_in, const void *buf, mp_uint_t si
     return out_sz;
 }
 
+// Receive a whole data message into buf and return its length.  Like a
+// datagram socket, if the message is longer than buf then the excess is
+// discarded and the full length is still returned.  Returns None if the
+// underlying stream is non-blocking and the message isn't complete yet, in
+// which case the call should be repeated with the same buffer.
+STATIC mp_obj_t websocket_recv_into(mp_obj_t self_in, mp_obj_t buf_in) {
+    mp_obj_websocket_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_WRITE);
+
+    self->opts |= STOP_AT_MSG_END;
+    self->msg_done = false;
+    while (!self->msg_done) {
+        byte scratch[64];
+        byte *dest = scratch;
+        size_t len = sizeof(scratch);
+        if (self->recv_total < bufinfo.len) {
+            dest = (byte *)bufinfo.buf + self->recv_total;
+            len = bufinfo.len - self->recv_total;
+        }
+        int errcode;
+        mp_uint_t out_sz = websocket_read(self_in, dest, len, &errcode);
+        if (out_sz == MP_STREAM_ERROR) {
+            self->opts &= ~STOP_AT_MSG_END;
+            if (mp_is_nonblocking_error(errcode)) {
+                return mp_const_none;
+            }
+            mp_raise_OSError(errcode);
+        }
+        if (out_sz == 0 && !self->msg_done) {
+            // end of stream
+            break;
+        }
+        self->recv_total += out_sz;
+    }
+    self->opts &= ~STOP_AT_MSG_END;
+    mp_uint_t total = self->recv_total;
+    self->recv_total = 0;
+    return mp_obj_new_int_from_uint(total);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(websocket_recv_into_obj, websocket_recv_into);
+
 STATIC mp_uint_t websocket_ioctl(mp_obj_t self_in, mp_uint_t request, uintptr_t arg, int *errcode) {
     mp_obj_websocket_t *self = MP_OBJ_TO_PTR(self_in);
     switch (request) {
@@ -279,6 +403,7 @@ STATIC const mp_rom_map_elem_t websocket_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_read), MP_ROM_PTR(&mp_stream_read_obj) },
     { MP_ROM_QSTR(MP_QSTR_readinto), MP_ROM_PTR(&mp_stream_readinto_obj) },
     { MP_ROM_QSTR(MP_QSTR_readline), MP_ROM_PTR(&mp_stream_unbuffered_readline_obj) },
+    { MP_ROM_QSTR(MP_QSTR_recv_into), MP_ROM_PTR(&websocket_recv_into_obj) },
     { MP_ROM_QSTR(MP_QSTR_write), MP_ROM_PTR(&mp_stream_write_obj) },
     { MP_ROM_QSTR(MP_QSTR_ioctl), MP_ROM_PTR(&mp_stream_ioctl_obj) },
     { MP_ROM_QSTR(MP_QSTR_close), MP_ROM_PTR(&mp_stream_close_obj) },
@@ -94,7 +94,8 @@ STATIC mp_obj_t decompio_make_new(const mp_obj_type_t *type, size_t n_args, size
         header_error:
             mp_raise_ValueError(MP_ERROR_TEXT("compression header"));
         }
-        dict_sz = 1 << dict_opt;
+        // The header gives the window size as log2(size) - 8
+        dict_sz = 1 << (dict_opt + 8);
     } else {
         dict_sz = 1 << -dict_opt;
     }
@@ -146,6 +147,206 @@ STATIC const mp_obj_type_t decompio_type = {
 };
 #endif
 
+#if MICROPY_PY_UZLIB_COMPRESS
+
+#define COMPIO_DEFAULT_WBITS (10)
+#define COMPIO_OUTBUF_SIZE (64)
+
+// Maximum number of hash chain candidates to try for each compression level
+STATIC const uint8_t compio_level_chain[10] = { 0, 1, 2, 4, 8, 16, 16, 32, 64, 128 };
+
+typedef struct _mp_obj_compio_t {
+    mp_obj_base_t base;
+    // Output goes to dest_stream, or if that's MP_OBJ_NULL to dest_vstr
+    mp_obj_t dest_stream;
+    vstr_t *dest_vstr;
+    struct uzlib_comp comp;
+    uint32_t checksum;
+    uint32_t in_len;
+    int8_t wbits;
+    bool closed;
+    byte outbuf[COMPIO_OUTBUF_SIZE];
+} mp_obj_compio_t;
+
+STATIC void compio_flush_outbuf(struct Outbuf *out) {
+    byte *p = (void *)out;
+    p -= offsetof(mp_obj_compio_t, comp.out);
+    mp_obj_compio_t *self = (mp_obj_compio_t *)p;
+
+    if (self->dest_stream == MP_OBJ_NULL) {
+        vstr_add_strn(self->dest_vstr, (const char *)out->outbuf, out->outlen);
+    } else {
+        int err;
+        mp_stream_rw(self->dest_stream, out->outbuf, out->outlen, &err, MP_STREAM_RW_WRITE);
+        if (err != 0) {
+            mp_raise_OSError(err);
+        }
+    }
+    out->outlen = 0;
+}
+
+STATIC void compio_put_bytes(mp_obj_compio_t *self, uint32_t val, size_t n, bool big_endian) {
+    for (size_t i = 0; i < n; ++i) {
+        size_t shift = big_endian ? 8 * (n - 1 - i) : 8 * i;
+        outbits(&self->comp.out, (val >> shift) & 0xff, 8);
+    }
+}
+
+// wbits is as for decompress(): 9 to 15 for a zlib stream, 25 to 31 for gzip,
+// or -9 to -15 for raw deflate; smaller windows need less memory
+STATIC void compio_init(mp_obj_compio_t *self, mp_int_t wbits, mp_int_t level) {
+    mp_int_t abs_wbits = wbits < 0 ? -wbits : wbits & 15;
+    if (abs_wbits < 9 || abs_wbits > 15 || (wbits > 15 && wbits < 25) || wbits > 31 || level < -1 || level > 9) {
+        mp_raise_ValueError(NULL);
+    }
+    self->wbits = wbits;
+    self->closed = false;
+    self->in_len = 0;
+
+    struct uzlib_comp *c = &self->comp;
+    c->out.outbuf = self->outbuf;
+    c->out.outlen = 0;
+    c->out.outsize = COMPIO_OUTBUF_SIZE;
+    c->out.outbits = 0;
+    c->out.noutbits = 0;
+    c->out.outbuf_full_cb = compio_flush_outbuf;
+    c->dict_size = 1 << abs_wbits;
+    c->hash_bits = abs_wbits - 1;
+    c->max_chain = compio_level_chain[level < 0 ? 6 : level];
+    c->window = m_new(byte, 2 * c->dict_size);
+    c->hash_head = m_new(uint16_t, 1 << c->hash_bits);
+    c->hash_prev = m_new(uint16_t, c->dict_size);
+
+    if (wbits > 15) {
+        // Minimal gzip header, with no file name or modification time
+        static const byte gzip_header[10] = { 0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 0xff };
+        for (size_t i = 0; i < sizeof(gzip_header); ++i) {
+            outbits(&c->out, gzip_header[i], 8);
+        }
+        self->checksum = 0;
+    } else if (wbits > 0) {
+        uint32_t cmf_flg = (((abs_wbits - 8) << 4) | 8) << 8;
+        cmf_flg += 31 - cmf_flg % 31;
+        compio_put_bytes(self, cmf_flg, 2, true);
+        self->checksum = 1;
+    }
+    uzlib_compress_init(c);
+}
+
+STATIC void compio_compress(mp_obj_compio_t *self, const void *buf, size_t len) {
+    if (self->wbits > 15) {
+        self->checksum = uzlib_crc32(buf, len, self->checksum ^ 0xffffffff) ^ 0xffffffff;
+    } else if (self->wbits > 0) {
+        self->checksum = uzlib_adler32(buf, len, self->checksum);
+    }
+    self->in_len += len;
+    uzlib_compress(&self->comp, buf, len);
+}
+
+STATIC void compio_finish(mp_obj_compio_t *self) {
+    uzlib_compress_finish(&self->comp);
+    if (self->wbits > 15) {
+        compio_put_bytes(self, self->checksum, 4, false);
+        compio_put_bytes(self, self->in_len, 4, false);
+    } else if (self->wbits > 0) {
+        compio_put_bytes(self, self->checksum, 4, true);
+    }
+    compio_flush_outbuf(&self->comp.out);
+    self->closed = true;
+}
+
+#if !MICROPY_ENABLE_DYNRUNTIME
+STATIC mp_obj_t compio_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 1, 3, false);
+    mp_get_stream_raise(args[0], MP_STREAM_OP_WRITE);
+    mp_obj_compio_t *o = m_new_obj(mp_obj_compio_t);
+    o->base.type = type;
+    o->dest_stream = args[0];
+    mp_int_t wbits = n_args > 1 ? mp_obj_get_int(args[1]) : COMPIO_DEFAULT_WBITS;
+    mp_int_t level = n_args > 2 ? mp_obj_get_int(args[2]) : -1;
+    compio_init(o, wbits, level);
+    return MP_OBJ_FROM_PTR(o);
+}
+
+STATIC mp_uint_t compio_write(mp_obj_t o_in, const void *buf, mp_uint_t size, int *errcode) {
+    mp_obj_compio_t *o = MP_OBJ_TO_PTR(o_in);
+    if (o->closed) {
+        *errcode = MP_EINVAL;
+        return MP_STREAM_ERROR;
+    }
+    compio_compress(o, buf, size);
+    // Pass on the complete bytes produced so far
+    compio_flush_outbuf(&o->comp.out);
+    return size;
+}
+
+STATIC mp_uint_t compio_ioctl(mp_obj_t o_in, mp_uint_t request, uintptr_t arg, int *errcode) {
+    mp_obj_compio_t *o = MP_OBJ_TO_PTR(o_in);
+    if (request == MP_STREAM_CLOSE) {
+        // Finish the compressed stream, but leave the destination open
+        if (!o->closed) {
+            compio_finish(o);
+        }
+        return 0;
+    }
+    *errcode = MP_EINVAL;
+    return MP_STREAM_ERROR;
+}
+
+STATIC mp_obj_t compio___exit__(size_t n_args, const mp_obj_t *args) {
+    (void)n_args;
+    return mp_stream_close(args[0]);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(compio___exit___obj, 4, 4, compio___exit__);
+
+STATIC const mp_rom_map_elem_t compio_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_write), MP_ROM_PTR(&mp_stream_write_obj) },
+    { MP_ROM_QSTR(MP_QSTR_close), MP_ROM_PTR(&mp_stream_close_obj) },
+    { MP_ROM_QSTR(MP_QSTR___enter__), MP_ROM_PTR(&mp_identity_obj) },
+    { MP_ROM_QSTR(MP_QSTR___exit__), MP_ROM_PTR(&compio___exit___obj) },
+};
+
+STATIC MP_DEFINE_CONST_DICT(compio_locals_dict, compio_locals_dict_table);
+
+STATIC const mp_stream_p_t compio_stream_p = {
+    .write = compio_write,
+    .ioctl = compio_ioctl,
+};
+
+STATIC const mp_obj_type_t compio_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_CompressIO,
+    .make_new = compio_make_new,
+    .protocol = &compio_stream_p,
+    .locals_dict = (void *)&compio_locals_dict,
+};
+#endif
+
+STATIC mp_obj_t mod_uzlib_compress(size_t n_args, const mp_obj_t *args) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[0], &bufinfo, MP_BUFFER_READ);
+    mp_int_t level = n_args > 1 ? mp_obj_get_int(args[1]) : -1;
+    mp_int_t wbits = n_args > 2 ? mp_obj_get_int(args[2]) : COMPIO_DEFAULT_WBITS;
+
+    vstr_t vstr;
+    vstr_init(&vstr, bufinfo.len / 2 + 16);
+    mp_obj_compio_t *o = m_new_obj(mp_obj_compio_t);
+    o->dest_stream = MP_OBJ_NULL;
+    o->dest_vstr = &vstr;
+    compio_init(o, wbits, level);
+    compio_compress(o, bufinfo.buf, bufinfo.len);
+    compio_finish(o);
+
+    m_del(byte, o->comp.window, 2 * o->comp.dict_size);
+    m_del(uint16_t, o->comp.hash_head, 1 << o->comp.hash_bits);
+    m_del(uint16_t, o->comp.hash_prev, o->comp.dict_size);
+    m_del_obj(mp_obj_compio_t, o);
+    return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_uzlib_compress_obj, 1, 3, mod_uzlib_compress);
+
+#endif // MICROPY_PY_UZLIB_COMPRESS
+
 STATIC mp_obj_t mod_uzlib_decompress(size_t n_args, const mp_obj_t *args) {
     mp_obj_t data = args[0];
     mp_buffer_info_t bufinfo;
@@ -210,6 +411,10 @@ STATIC const mp_rom_map_elem_t mp_module_uzlib_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_uzlib) },
     { MP_ROM_QSTR(MP_QSTR_decompress), MP_ROM_PTR(&mod_uzlib_decompress_obj) },
     { MP_ROM_QSTR(MP_QSTR_DecompIO), MP_ROM_PTR(&decompio_type) },
+    #if MICROPY_PY_UZLIB_COMPRESS
+    { MP_ROM_QSTR(MP_QSTR_compress), MP_ROM_PTR(&mod_uzlib_compress_obj) },
+    { MP_ROM_QSTR(MP_QSTR_CompressIO), MP_ROM_PTR(&compio_type) },
+    #endif
 };
 
 STATIC MP_DEFINE_CONST_DICT(mp_module_uzlib_globals, mp_module_uzlib_globals_table);
@@ -228,5 +433,9 @@ const mp_obj_module_t mp_module_uzlib = {
 #include "uzlib/tinfgzip.c"
 #include "uzlib/adler32.c"
 #include "uzlib/crc32.c"
+#if MICROPY_PY_UZLIB_COMPRESS
+#include "uzlib/defl_static.c"
+#include "uzlib/lz77.c"
+#endif
 
 #endif // MICROPY_PY_UZLIB
@@ -35,6 +35,9 @@
 #include "py/mphal.h"
 #endif
 #include "extmod/moduwebsocket.h"
+#if MICROPY_PY_UZLIB
+#include "extmod/uzlib/tinf.h"
+#endif
 
 #if MICROPY_PY_WEBREPL
 
@@ -48,7 +51,9 @@ struct webrepl_file {
     char sig[2];
     char type;
     char flags;
-    uint64_t offset;
+    uint16_t chunk_size;
+    uint8_t window;
+    uint8_t reserved[5];
     uint32_t size;
     uint16_t fname_len;
     char fname[64];
@@ -57,6 +62,36 @@ struct webrepl_file {
 enum { PUT_FILE = 1, GET_FILE, GET_VER };
 enum { STATE_PASSWD, STATE_NORMAL };
 
+// Without any flags a file is sent as raw data for PUT_FILE, and for
+// GET_FILE the client asks for each 256-byte chunk with a zero byte.
+//
+// With WEBREPL_FLAG_CHUNKED the file data is sent as records: a 16-bit
+// little endian length followed by at most chunk_size bytes of data.  For
+// GET_FILE the server sends up to window records ahead of the client, which
+// acks each non-empty record with a zero byte; an empty record ends the file.
+// For PUT_FILE the client sends records, then an empty record, and the file
+// must come to size bytes; with WEBREPL_FLAG_ZLIB each record is a separate
+// zlib stream that decompresses to at most chunk_size bytes.  With WEBREPL_FLAG_CRC32 the
+// final response is followed by the CRC32 of the file data.
+#define WEBREPL_FLAG_CHUNKED (0x01)
+#define WEBREPL_FLAG_ZLIB (0x02)
+#define WEBREPL_FLAG_CRC32 (0x04)
+#if MICROPY_PY_UZLIB
+#define WEBREPL_FLAGS_SUPPORTED (WEBREPL_FLAG_CHUNKED | WEBREPL_FLAG_ZLIB | WEBREPL_FLAG_CRC32)
+#else
+#define WEBREPL_FLAGS_SUPPORTED (WEBREPL_FLAG_CHUNKED)
+#endif
+
+// A zlib stream can be a little larger than the data it holds
+#define WEBREPL_ZLIB_SLACK (64)
+
+// Where a compressed record goes in chunk_buf, after room for its data.  The
+// room has a byte spare because uzlib stops when the output is full, before
+// it reads the end of the stream.
+#define ZLIB_REC_OFFSET(self) ((self)->hdr.chunk_size + 1)
+
+enum { RESP_OK, RESP_ERROR };
+
 typedef struct _mp_obj_webrepl_t {
     mp_obj_base_t base;
     mp_obj_t sock;
@@ -65,6 +100,16 @@ typedef struct _mp_obj_webrepl_t {
     uint32_t data_to_recv;
     struct webrepl_file hdr;
     mp_obj_t cur_file;
+    // state of a chunked transfer
+    byte *chunk_buf;
+    size_t chunk_buf_len;
+    uint16_t rec_len;
+    uint16_t rec_pos;
+    byte rec_hdr_to_recv;
+    bool eof;
+    bool failed;
+    uint32_t bytes_done;
+    uint32_t crc;
 } mp_obj_webrepl_t;
 
 STATIC const char passwd_prompt[] = "Password: ";
@@ -102,17 +147,41 @@ STATIC mp_obj_t webrepl_make_new(const mp_obj_type_t *type, size_t n_args, size_
     o->sock = args[0];
     o->hdr_to_recv = sizeof(struct webrepl_file);
     o->data_to_recv = 0;
+    o->chunk_buf = NULL;
     o->state = STATE_PASSWD;
     write_webrepl_str(args[0], SSTR(passwd_prompt));
     return MP_OBJ_FROM_PTR(o);
 }
 
+STATIC void update_crc(mp_obj_webrepl_t *self, const byte *buf, size_t len) {
+    #if MICROPY_PY_UZLIB
+    if (self->hdr.flags & WEBREPL_FLAG_CRC32) {
+        self->crc = uzlib_crc32(buf, len, self->crc ^ 0xffffffff) ^ 0xffffffff;
+    }
+    #else
+    (void)self;
+    (void)buf;
+    (void)len;
+    #endif
+}
+
 STATIC void check_file_op_finished(mp_obj_webrepl_t *self) {
     if (self->data_to_recv == 0) {
         mp_stream_close(self->cur_file);
+        if (self->chunk_buf != NULL) {
+            m_del(byte, self->chunk_buf, self->chunk_buf_len);
+            self->chunk_buf = NULL;
+        }
         self->hdr_to_recv = sizeof(struct webrepl_file);
         DEBUG_printf("webrepl: Finished file operation %d\n", self->hdr.type);
-        write_webrepl_resp(self->sock, 0);
+        uint16_t code = self->failed ? RESP_ERROR : RESP_OK;
+        if (self->hdr.flags & WEBREPL_FLAG_CRC32) {
+            uint32_t crc = self->crc;
+            char buf[8] = {'W', 'B', code & 0xff, code >> 8, crc, crc >> 8, crc >> 16, crc >> 24};
+            write_webrepl(self->sock, buf, sizeof(buf));
+        } else {
+            write_webrepl_resp(self->sock, code);
+        }
     }
 }
 
@@ -131,6 +200,156 @@ STATIC int write_file_chunk(mp_obj_webrepl_t *self) {
     return out_sz;
 }
 
+// Send the next record of a chunked GET_FILE, counting it as waiting for an
+// ack unless it was the empty record that ends the file.
+STATIC void write_file_record(mp_obj_webrepl_t *self) {
+    const mp_stream_p_t *file_stream = mp_get_stream(self->cur_file);
+    byte *buf = self->chunk_buf;
+    int err;
+    mp_uint_t out_sz = file_stream->read(self->cur_file, buf + 2, self->hdr.chunk_size, &err);
+    if (out_sz == MP_STREAM_ERROR) {
+        // end the file early and report the error in the final response
+        self->failed = true;
+        out_sz = 0;
+    }
+    buf[0] = out_sz;
+    buf[1] = out_sz >> 8;
+    update_crc(self, buf + 2, out_sz);
+    DEBUG_printf("webrepl: Sending %d bytes of file\n", out_sz);
+    write_webrepl(self->sock, buf, 2 + out_sz);
+    if (out_sz == 0) {
+        self->eof = true;
+    } else {
+        ++self->data_to_recv;
+    }
+}
+
+// Write a complete record of a chunked PUT_FILE out to the file.
+STATIC void put_file_record(mp_obj_webrepl_t *self) {
+    byte *data = self->chunk_buf;
+    size_t len = self->rec_len;
+    #if MICROPY_PY_UZLIB
+    if (self->hdr.flags & WEBREPL_FLAG_ZLIB) {
+        TINF_DATA decomp;
+        memset(&decomp, 0, sizeof(decomp));
+        uzlib_uncompress_init(&decomp, NULL, 0);
+        decomp.source = data + ZLIB_REC_OFFSET(self);
+        decomp.source_limit = decomp.source + len;
+        decomp.dest = data;
+        decomp.dest_limit = data + ZLIB_REC_OFFSET(self);
+        int st = uzlib_zlib_parse_header(&decomp);
+        if (st >= 0) {
+            st = uzlib_uncompress_chksum(&decomp);
+        }
+        if (st != TINF_DONE || (size_t)(decomp.dest - data) > self->hdr.chunk_size) {
+            DEBUG_printf("webrepl: Bad compressed record: %d\n", st);
+            self->failed = true;
+        }
+        len = decomp.dest - data;
+    }
+    #endif
+    if (len > self->hdr.size - self->bytes_done) {
+        self->failed = true;
+    }
+    if (self->failed) {
+        // keep reading records to stay in step with the client
+        return;
+    }
+    self->bytes_done += len;
+    DEBUG_printf("webrepl: Writing %lu bytes to file\n", len);
+    update_crc(self, data, len);
+    int err;
+    mp_uint_t res = mp_stream_write_exactly(self->cur_file, data, len, &err);
+    if (err != 0 || res != len) {
+        self->failed = true;
+    }
+}
+
+// Take the given byte, and whatever else is ready on the socket, as part of
+// the records of a chunked PUT_FILE.
+STATIC mp_uint_t read_file_records(mp_obj_webrepl_t *self, byte c, int *errcode) {
+    byte *rec = self->chunk_buf;
+    size_t max_len = self->hdr.chunk_size;
+    if (self->hdr.flags & WEBREPL_FLAG_ZLIB) {
+        rec += ZLIB_REC_OFFSET(self);
+        max_len += WEBREPL_ZLIB_SLACK;
+    }
+
+    if (self->rec_hdr_to_recv != 0) {
+        self->rec_len |= c << (8 * (2 - self->rec_hdr_to_recv));
+        if (--self->rec_hdr_to_recv != 0) {
+            return 0;
+        }
+        if (self->rec_len == 0) {
+            // the empty record ends the file
+            if (self->bytes_done != self->hdr.size) {
+                self->failed = true;
+            }
+            self->data_to_recv = 0;
+        } else if (self->rec_len > max_len) {
+            // the client and server are out of step, so give up on the
+            // transfer and the connection
+            self->failed = true;
+            self->data_to_recv = 0;
+            check_file_op_finished(self);
+            *errcode = MP_EIO;
+            return MP_STREAM_ERROR;
+        }
+        return 0;
+    }
+
+    rec[self->rec_pos++] = c;
+    if (self->rec_pos < self->rec_len) {
+        const mp_stream_p_t *sock_stream = mp_get_stream(self->sock);
+        mp_uint_t sz = sock_stream->read(self->sock, rec + self->rec_pos, self->rec_len - self->rec_pos, errcode);
+        if (sz == MP_STREAM_ERROR) {
+            if (!mp_is_nonblocking_error(*errcode)) {
+                return sz;
+            }
+            // the rest of the record will come with later reads
+            sz = 0;
+        }
+        self->rec_pos += sz;
+    }
+    if (self->rec_pos == self->rec_len) {
+        put_file_record(self);
+        self->rec_len = 0;
+        self->rec_pos = 0;
+        self->rec_hdr_to_recv = 2;
+        #ifdef MICROPY_PY_WEBREPL_DELAY
+        mp_hal_delay_ms(MICROPY_PY_WEBREPL_DELAY);
+        #endif
+    }
+    return 0;
+}
+
+// Set up the state for a transfer with WEBREPL_FLAG_CHUNKED, returning false
+// if that can't be done.
+STATIC bool start_chunked_op(mp_obj_webrepl_t *self) {
+    size_t chunk_size = self->hdr.chunk_size;
+    if (chunk_size == 0 || self->hdr.window == 0
+        || ((self->hdr.flags & WEBREPL_FLAG_ZLIB) && self->hdr.type != PUT_FILE)) {
+        return false;
+    }
+    // GET_FILE needs room for the record length, and a compressed PUT_FILE
+    // for the compressed record as well as its decompressed data
+    size_t len = chunk_size + 2;
+    if (self->hdr.flags & WEBREPL_FLAG_ZLIB) {
+        len = ZLIB_REC_OFFSET(self) + chunk_size + WEBREPL_ZLIB_SLACK;
+    } else if (self->hdr.type == PUT_FILE) {
+        len = chunk_size;
+    }
+    self->chunk_buf = m_new_maybe(byte, len);
+    if (self->chunk_buf == NULL) {
+        return false;
+    }
+    self->chunk_buf_len = len;
+    self->rec_len = 0;
+    self->rec_pos = 0;
+    self->rec_hdr_to_recv = 2;
+    return true;
+}
+
 STATIC void handle_op(mp_obj_webrepl_t *self) {
 
     // Handle operations not requiring opened file
@@ -146,6 +365,18 @@ STATIC void handle_op(mp_obj_webrepl_t *self) {
 
     // Handle operations requiring opened file
 
+    self->eof = false;
+    self->failed = false;
+    self->bytes_done = 0;
+    self->crc = 0;
+    if ((self->hdr.flags & ~WEBREPL_FLAGS_SUPPORTED)
+        || ((self->hdr.flags & WEBREPL_FLAG_CHUNKED) && !start_chunked_op(self))) {
+        DEBUG_printf("webrepl: Unsupported flags %x\n", self->hdr.flags);
+        self->hdr_to_recv = sizeof(struct webrepl_file);
+        write_webrepl_resp(self->sock, RESP_ERROR);
+        return;
+    }
+
     mp_obj_t open_args[2] = {
         mp_obj_new_str(self->hdr.fname, strlen(self->hdr.fname)),
         MP_OBJ_NEW_QSTR(MP_QSTR_rb)
@@ -157,20 +388,27 @@ STATIC void handle_op(mp_obj_webrepl_t *self) {
 
     self->cur_file = mp_builtin_open(2, open_args, (mp_map_t *)&mp_const_empty_map);
 
-    #if 0
-    struct mp_stream_seek_t seek = { .offset = self->hdr.offset, .whence = 0 };
-    int err;
-    mp_uint_t res = file_stream->ioctl(self->cur_file, MP_STREAM_SEEK, (uintptr_t)&seek, &err);
-    assert(res != MP_STREAM_ERROR);
-    #endif
-
-    write_webrepl_resp(self->sock, 0);
+    write_webrepl_resp(self->sock, RESP_OK);
 
     if (self->hdr.type == PUT_FILE) {
-        self->data_to_recv = self->hdr.size;
+        if (self->hdr.flags & WEBREPL_FLAG_CHUNKED) {
+            // data_to_recv stays non-zero until the empty record
+            self->data_to_recv = 1;
+        } else {
+            self->data_to_recv = self->hdr.size;
+        }
         check_file_op_finished(self);
     } else if (self->hdr.type == GET_FILE) {
-        self->data_to_recv = 1;
+        if (self->hdr.flags & WEBREPL_FLAG_CHUNKED) {
+            // data_to_recv counts the records still to be acked
+            self->data_to_recv = 0;
+            while (!self->eof && self->data_to_recv < self->hdr.window) {
+                write_file_record(self);
+            }
+            check_file_op_finished(self);
+        } else {
+            self->data_to_recv = 1;
+        }
     }
 }
 
@@ -237,13 +475,22 @@ STATIC mp_uint_t _webrepl_read(mp_obj_t self_in, void *buf, mp_uint_t size, int
             }
         }
 
-        DEBUG_printf("webrepl: op: %d, file: %s, chunk @%x, sz=%d\n", self->hdr.type, self->hdr.fname, (uint32_t)self->hdr.offset, self->hdr.size);
+        DEBUG_printf("webrepl: op: %d, flags: %x, file: %s, sz=%d\n", self->hdr.type, self->hdr.flags, self->hdr.fname, self->hdr.size);
 
         handle_op(self);
 
         return -2;
     }
 
+    if (self->data_to_recv != 0 && self->hdr.type == PUT_FILE && (self->hdr.flags & WEBREPL_FLAG_CHUNKED)) {
+        mp_uint_t res = read_file_records(self, *(byte *)buf, errcode);
+        if (res == MP_STREAM_ERROR) {
+            return res;
+        }
+        check_file_op_finished(self);
+        return -2;
+    }
+
     if (self->data_to_recv != 0) {
         // Ports that don't have much available stack can make this filebuf static
         #if MICROPY_PY_WEBREPL_STATIC_FILEBUF
@@ -269,6 +516,11 @@ STATIC mp_uint_t _webrepl_read(mp_obj_t self_in, void *buf, mp_uint_t size, int
             if (err != 0 || res != buf_sz) {
                 assert(0);
             }
+        } else if (self->hdr.flags & WEBREPL_FLAG_CHUNKED) {
+            // each ack lets another record be sent
+            for (; buf_sz != 0 && !self->eof; --buf_sz) {
+                write_file_record(self);
+            }
         } else if (self->hdr.type == GET_FILE) {
             assert(buf_sz == 1);
             assert(self->data_to_recv == 0);
@@ -293,6 +293,22 @@ STATIC mp_obj_t network_cyw43_status(size_t n_args, const mp_obj_t *args) {
             }
             return list;
         }
+        case MP_QSTR_stats: {
+            // return the driver counters, for both interfaces
+            const cyw43_stats_t *s = &self->cyw->stats;
+            mp_obj_t tuple[9] = {
+                mp_obj_new_int_from_uint(s->polls),
+                mp_obj_new_int_from_uint(s->rx_frames),
+                mp_obj_new_int_from_uint(s->rx_bytes),
+                mp_obj_new_int_from_uint(s->rx_drop_link),
+                mp_obj_new_int_from_uint(s->rx_drop_mem),
+                mp_obj_new_int_from_uint(s->rx_drop_input),
+                mp_obj_new_int_from_uint(s->tx_frames),
+                mp_obj_new_int_from_uint(s->tx_bytes),
+                mp_obj_new_int_from_uint(s->tx_errors),
+            };
+            return mp_obj_new_tuple(9, tuple);
+        }
     }
 
     mp_raise_ValueError(MP_ERROR_TEXT("unknown status param"));
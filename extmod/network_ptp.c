@@ -0,0 +1,359 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "py/runtime.h"
+#include "py/mperrno.h"
+#include "py/mphal.h"
+#include "extmod/network_ptp.h"
+
+#if MICROPY_PY_NETWORK_PTP
+
+#include "lwip/init.h"
+#include "lwip/igmp.h"
+#include "lwip/netif.h"
+#include "lwip/udp.h"
+
+// A minimal IEEE 1588-2008 (PTPv2) slave, over UDP/IPv4, for a network
+// interface with a hardware clock.  It follows the first master that it
+// hears a Sync from, measures the path delay with Delay_Req messages, and
+// steers the hardware clock with a PI servo.  There is no best master clock
+// algorithm, so there should be one master in the domain.
+
+#define PTP_EVENT_PORT (319)
+#define PTP_GENERAL_PORT (320)
+
+#define PTP_MSG_SYNC (0x0)
+#define PTP_MSG_DELAY_REQ (0x1)
+#define PTP_MSG_FOLLOW_UP (0x8)
+#define PTP_MSG_DELAY_RESP (0x9)
+
+#define PTP_HEADER_LEN (34)
+#define PTP_SYNC_LEN (44)
+#define PTP_DELAY_REQ_LEN (44)
+#define PTP_DELAY_RESP_LEN (54)
+#define PTP_FLAG0_TWO_STEP (0x02)
+
+// The clock is stepped, rather than steered, when it's further off than this
+#define PTP_STEP_THRESHOLD_NS (100000)
+// The most the servo changes the frequency of the clock by
+#define PTP_MAX_PPB (500000)
+// Another master is followed if the current one sends no Sync for this long
+#define PTP_MASTER_TIMEOUT_MS (10000)
+
+typedef struct _ptp_slave_t {
+    struct netif *netif;
+    struct udp_pcb *event_pcb;
+    struct udp_pcb *general_pcb;
+    uint8_t domain;
+    uint8_t state;
+    bool have_delay;
+    bool delay_req_sent;
+    uint8_t port_id[10]; // our clockIdentity and portNumber
+    uint8_t master_id[10]; // those of the master
+    uint16_t sync_seq;
+    uint16_t delay_req_seq;
+    uint32_t sync_ms;
+    int64_t sync_correction;
+    int64_t t1; // when the master sent the last Sync
+    int64_t t2; // when the last Sync arrived
+    int64_t req_t1_t2; // t2 - t1 of the Sync before the last Delay_Req
+    int64_t offset_ns;
+    int64_t delay_ns;
+    int64_t integral;
+} ptp_slave_t;
+
+STATIC ptp_slave_t ptp_slave;
+
+STATIC int64_t ptp_time_to_ns(const network_ptp_time_t *t) {
+    return (int64_t)t->sec * 1000000000 + t->nsec;
+}
+
+// A Timestamp in a message: 48 bits of seconds and 32 bits of nanoseconds
+STATIC int64_t ptp_get_timestamp(const uint8_t *buf) {
+    uint64_t sec = 0;
+    for (size_t i = 0; i < 6; ++i) {
+        sec = sec << 8 | buf[i];
+    }
+    uint32_t nsec = buf[6] << 24 | buf[7] << 16 | buf[8] << 8 | buf[9];
+    return (int64_t)sec * 1000000000 + nsec;
+}
+
+// The correctionField of a message, in nanoseconds
+STATIC int64_t ptp_get_correction(const uint8_t *buf) {
+    uint64_t c = 0;
+    for (size_t i = 0; i < 8; ++i) {
+        c = c << 8 | buf[8 + i];
+    }
+    return (int64_t)c / 65536;
+}
+
+// Corrects the clock for the given offset from the master, and returns true
+// if the clock was stepped
+STATIC bool ptp_servo(ptp_slave_t *self, int64_t offset) {
+    self->offset_ns = offset;
+    if (offset > PTP_STEP_THRESHOLD_NS || offset < -PTP_STEP_THRESHOLD_NS) {
+        network_ptp_hal_step(-offset);
+        self->integral = 0;
+        self->state = NETWORK_PTP_STATE_UNCALIBRATED;
+        return true;
+    }
+
+    // Sync messages come about once a second, so an offset in ns is taken as
+    // a frequency error in ppb, and fed to a PI controller
+    self->integral += offset;
+    if (self->integral > PTP_MAX_PPB) {
+        self->integral = PTP_MAX_PPB;
+    } else if (self->integral < -PTP_MAX_PPB) {
+        self->integral = -PTP_MAX_PPB;
+    }
+    int64_t ppb = -(offset * 7 + self->integral * 3) / 10;
+    if (ppb > PTP_MAX_PPB) {
+        ppb = PTP_MAX_PPB;
+    } else if (ppb < -PTP_MAX_PPB) {
+        ppb = -PTP_MAX_PPB;
+    }
+    network_ptp_hal_set_freq(ppb);
+    self->state = NETWORK_PTP_STATE_SLAVE;
+    return false;
+}
+
+STATIC void ptp_send_delay_req(ptp_slave_t *self) {
+    struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, PTP_DELAY_REQ_LEN, PBUF_RAM);
+    if (p == NULL) {
+        return;
+    }
+    uint8_t *buf = p->payload;
+    memset(buf, 0, PTP_DELAY_REQ_LEN);
+    buf[0] = PTP_MSG_DELAY_REQ;
+    buf[1] = 2; // versionPTP
+    buf[3] = PTP_DELAY_REQ_LEN;
+    buf[4] = self->domain;
+    memcpy(&buf[20], self->port_id, sizeof(self->port_id));
+    ++self->delay_req_seq;
+    buf[30] = self->delay_req_seq >> 8;
+    buf[31] = self->delay_req_seq;
+    buf[32] = 1; // controlField for Delay_Req
+    buf[33] = 0x7f; // logMessageInterval
+
+    ip_addr_t dest;
+    IP_ADDR4(&dest, 224, 0, 1, 129);
+    network_ptp_hal_tx_request(true);
+    err_t err = udp_sendto_if(self->event_pcb, p, &dest, PTP_EVENT_PORT, self->netif);
+    network_ptp_hal_tx_request(false);
+    pbuf_free(p);
+    self->delay_req_sent = err == ERR_OK;
+}
+
+// Called when t1 and t2 of a Sync are known
+STATIC void ptp_sync_done(ptp_slave_t *self) {
+    int64_t t1_t2 = self->t2 - self->t1;
+    // Until the delay is known the clock is only stepped, to get close to the
+    // time of the master before measuring the delay
+    int64_t offset = self->have_delay ? t1_t2 - self->delay_ns : t1_t2;
+    if (self->have_delay || offset > PTP_STEP_THRESHOLD_NS || offset < -PTP_STEP_THRESHOLD_NS) {
+        if (ptp_servo(self, offset)) {
+            // The times of this Sync no longer hold for the stepped clock
+            return;
+        }
+    }
+    self->req_t1_t2 = t1_t2;
+    ptp_send_delay_req(self);
+}
+
+#if LWIP_VERSION_MAJOR < 2
+STATIC void ptp_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p, ip_addr_t *addr, u16_t port)
+#else
+STATIC void ptp_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr, u16_t port)
+#endif
+{
+    ptp_slave_t *self = arg;
+
+    // The receive time must be taken now, while lwIP is processing the frame
+    network_ptp_time_t rx_time;
+    bool have_rx_time = network_ptp_hal_rx_timestamp(&rx_time);
+
+    uint8_t buf[PTP_DELAY_RESP_LEN];
+    size_t len = pbuf_copy_partial(p, buf, sizeof(buf), 0);
+    pbuf_free(p);
+    if (len < PTP_HEADER_LEN || (buf[1] & 0x0f) != 2 || buf[4] != self->domain) {
+        return;
+    }
+
+    uint16_t seq = buf[30] << 8 | buf[31];
+    const uint8_t *source_id = &buf[20];
+    bool from_master = memcmp(source_id, self->master_id, sizeof(self->master_id)) == 0;
+
+    switch (buf[0] & 0x0f) {
+        case PTP_MSG_SYNC: {
+            if (len < PTP_SYNC_LEN || !have_rx_time) {
+                return;
+            }
+            if (!from_master) {
+                if (self->state != NETWORK_PTP_STATE_LISTENING
+                    && mp_hal_ticks_ms() - self->sync_ms < PTP_MASTER_TIMEOUT_MS) {
+                    return;
+                }
+                // Follow this master
+                memcpy(self->master_id, source_id, sizeof(self->master_id));
+                self->have_delay = false;
+                self->delay_req_sent = false;
+                self->integral = 0;
+                self->state = NETWORK_PTP_STATE_UNCALIBRATED;
+            }
+            self->sync_ms = mp_hal_ticks_ms();
+            self->sync_seq = seq;
+            self->sync_correction = ptp_get_correction(buf);
+            self->t2 = ptp_time_to_ns(&rx_time);
+            if (!(buf[6] & PTP_FLAG0_TWO_STEP)) {
+                self->t1 = ptp_get_timestamp(&buf[34]) + self->sync_correction;
+                ptp_sync_done(self);
+            }
+            break;
+        }
+
+        case PTP_MSG_FOLLOW_UP: {
+            if (len < PTP_SYNC_LEN || !from_master || seq != self->sync_seq) {
+                return;
+            }
+            self->t1 = ptp_get_timestamp(&buf[34]) + self->sync_correction + ptp_get_correction(buf);
+            ptp_sync_done(self);
+            break;
+        }
+
+        case PTP_MSG_DELAY_RESP: {
+            if (len < PTP_DELAY_RESP_LEN || !from_master || !self->delay_req_sent
+                || seq != self->delay_req_seq
+                || memcmp(&buf[44], self->port_id, sizeof(self->port_id)) != 0) {
+                return;
+            }
+            self->delay_req_sent = false;
+            network_ptp_time_t tx_time;
+            if (!network_ptp_hal_tx_timestamp(&tx_time)) {
+                return;
+            }
+            int64_t t4 = ptp_get_timestamp(&buf[34]) - ptp_get_correction(buf);
+            int64_t t3_t4 = t4 - ptp_time_to_ns(&tx_time);
+            int64_t delay = (self->req_t1_t2 + t3_t4) / 2;
+            if (delay < 0) {
+                // Not possible, the clock must have changed during the exchange
+                return;
+            }
+            if (self->have_delay) {
+                // Smooth out the jitter of the measurements
+                delay = (self->delay_ns * 7 + delay) / 8;
+            }
+            self->delay_ns = delay;
+            self->have_delay = true;
+            break;
+        }
+    }
+}
+
+STATIC struct udp_pcb *ptp_new_pcb(ptp_slave_t *self, u16_t port) {
+    struct udp_pcb *pcb = udp_new();
+    if (pcb == NULL) {
+        return NULL;
+    }
+    if (udp_bind(pcb, IP_ADDR_ANY, port) != ERR_OK) {
+        udp_remove(pcb);
+        return NULL;
+    }
+    udp_recv(pcb, ptp_recv, self);
+    return pcb;
+}
+
+int network_ptp_slave_start(struct netif *netif, uint8_t domain) {
+    ptp_slave_t *self = &ptp_slave;
+    network_ptp_slave_stop();
+
+    memset(self, 0, sizeof(*self));
+    self->netif = netif;
+    self->domain = domain;
+
+    // The clockIdentity is the EUI-64 made from the MAC address
+    const uint8_t *mac = netif->hwaddr;
+    memcpy(&self->port_id[0], &mac[0], 3);
+    self->port_id[3] = 0xff;
+    self->port_id[4] = 0xfe;
+    memcpy(&self->port_id[5], &mac[3], 3);
+    self->port_id[9] = 1; // portNumber
+
+    self->event_pcb = ptp_new_pcb(self, PTP_EVENT_PORT);
+    self->general_pcb = ptp_new_pcb(self, PTP_GENERAL_PORT);
+    ip_addr_t group;
+    IP_ADDR4(&group, 224, 0, 1, 129);
+    if (self->event_pcb == NULL || self->general_pcb == NULL
+        || igmp_joingroup_netif(netif, ip_2_ip4(&group)) != ERR_OK) {
+        network_ptp_slave_stop();
+        return -MP_ENOMEM;
+    }
+    self->state = NETWORK_PTP_STATE_LISTENING;
+    return 0;
+}
+
+void network_ptp_slave_stop(void) {
+    ptp_slave_t *self = &ptp_slave;
+    if (self->event_pcb != NULL) {
+        udp_remove(self->event_pcb);
+        self->event_pcb = NULL;
+    }
+    if (self->general_pcb != NULL) {
+        udp_remove(self->general_pcb);
+        self->general_pcb = NULL;
+    }
+    if (self->state != NETWORK_PTP_STATE_IDLE) {
+        ip_addr_t group;
+        IP_ADDR4(&group, 224, 0, 1, 129);
+        igmp_leavegroup_netif(self->netif, ip_2_ip4(&group));
+        self->state = NETWORK_PTP_STATE_IDLE;
+    }
+}
+
+// Returns (state, offset_ns, delay_ns, ppb), where the offset is that of the
+// clock from the master at the last Sync, before it was corrected
+mp_obj_t network_ptp_slave_status(void) {
+    ptp_slave_t *self = &ptp_slave;
+    MICROPY_PY_LWIP_ENTER
+    uint8_t state = self->state;
+    if (state != NETWORK_PTP_STATE_IDLE && mp_hal_ticks_ms() - self->sync_ms >= PTP_MASTER_TIMEOUT_MS) {
+        state = NETWORK_PTP_STATE_LISTENING;
+    }
+    int64_t offset = self->offset_ns;
+    int64_t delay = self->have_delay ? self->delay_ns : -1;
+    int32_t ppb = network_ptp_hal_get_freq();
+    MICROPY_PY_LWIP_EXIT
+    mp_obj_t tuple[4] = {
+        MP_OBJ_NEW_SMALL_INT(state),
+        mp_obj_new_int_from_ll(offset),
+        mp_obj_new_int_from_ll(delay),
+        mp_obj_new_int(ppb),
+    };
+    return mp_obj_new_tuple(4, tuple);
+}
+
+#endif // MICROPY_PY_NETWORK_PTP
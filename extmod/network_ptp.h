@@ -0,0 +1,62 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef MICROPY_INCLUDED_EXTMOD_NETWORK_PTP_H
+#define MICROPY_INCLUDED_EXTMOD_NETWORK_PTP_H
+
+#include "py/obj.h"
+
+// A time of the hardware PTP clock, which counts TAI since 1970
+typedef struct _network_ptp_time_t {
+    uint32_t sec;
+    uint32_t nsec;
+} network_ptp_time_t;
+
+// States of the PTP slave
+#define NETWORK_PTP_STATE_IDLE (0)
+#define NETWORK_PTP_STATE_LISTENING (1)
+#define NETWORK_PTP_STATE_UNCALIBRATED (2)
+#define NETWORK_PTP_STATE_SLAVE (3)
+
+// Provided by the port, for the network interface with the hardware clock.
+// These are called with the lwIP lock held.
+void network_ptp_hal_get_time(network_ptp_time_t *t);
+void network_ptp_hal_set_time(const network_ptp_time_t *t);
+void network_ptp_hal_step(int64_t ns);
+void network_ptp_hal_set_freq(int32_t ppb);
+int32_t network_ptp_hal_get_freq(void);
+// The receive time of the frame that lwIP is processing, if it came from the interface
+bool network_ptp_hal_rx_timestamp(network_ptp_time_t *t);
+// Request (or cancel the request) that the next frame sent is timestamped
+void network_ptp_hal_tx_request(bool enable);
+// The send time of the last frame that was timestamped, once it is known
+bool network_ptp_hal_tx_timestamp(network_ptp_time_t *t);
+
+struct netif;
+int network_ptp_slave_start(struct netif *netif, uint8_t domain);
+void network_ptp_slave_stop(void);
+mp_obj_t network_ptp_slave_status(void);
+
+#endif // MICROPY_INCLUDED_EXTMOD_NETWORK_PTP_H
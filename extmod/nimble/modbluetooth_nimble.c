@@ -397,6 +397,15 @@ STATIC void gatts_register_cb(struct ble_gatt_register_ctxt *ctxt, void *arg) {
     }
 }
 
+#if MICROPY_BLUETOOTH_NIMBLE_FAST_LINK
+// Ask for the largest link-layer payload and the 2M PHY. Either request may be
+// refused by the controller or the peer, which just leaves the link as it was.
+STATIC void request_fast_link(uint16_t conn_handle) {
+    ble_gap_set_data_len(conn_handle, BLE_HCI_SET_DATALEN_TX_OCTETS_MAX, BLE_HCI_SET_DATALEN_TX_TIME_MAX);
+    ble_gap_set_prefered_le_phy(conn_handle, BLE_GAP_LE_PHY_1M_MASK | BLE_GAP_LE_PHY_2M_MASK, BLE_GAP_LE_PHY_1M_MASK | BLE_GAP_LE_PHY_2M_MASK, BLE_GAP_LE_PHY_CODED_ANY);
+}
+#endif
+
 STATIC int commmon_gap_event_cb(struct ble_gap_event *event, void *arg) {
     struct ble_gap_conn_desc desc;
 
@@ -459,6 +468,9 @@ STATIC int central_gap_event_cb(struct ble_gap_event *event, void *arg) {
                 ble_gap_conn_find(event->connect.conn_handle, &desc);
                 reverse_addr_byte_order(addr, desc.peer_id_addr.val);
                 mp_bluetooth_gap_on_connected_disconnected(MP_BLUETOOTH_IRQ_CENTRAL_CONNECT, event->connect.conn_handle, desc.peer_id_addr.type, addr);
+                #if MICROPY_BLUETOOTH_NIMBLE_FAST_LINK
+                request_fast_link(event->connect.conn_handle);
+                #endif
             } else {
                 // Connection failed.
                 mp_bluetooth_gap_on_connected_disconnected(MP_BLUETOOTH_IRQ_CENTRAL_DISCONNECT, event->connect.conn_handle, 0xff, addr);
@@ -478,6 +490,11 @@ STATIC int central_gap_event_cb(struct ble_gap_event *event, void *arg) {
             if (event->notify_tx.indication && event->notify_tx.status != 0) {
                 // Map "done/ack" to 0, otherwise pass the status directly.
                 mp_bluetooth_gatts_on_indicate_complete(event->notify_tx.conn_handle, event->notify_tx.attr_handle, event->notify_tx.status == BLE_HS_EDONE ? 0 : event->notify_tx.status);
+            } else if (!event->notify_tx.indication && MP_STATE_PORT(bluetooth_nimble_root_pointers)->notify_stream_stalled) {
+                // A notification has gone out and freed its mbuf, so a stalled stream can continue.
+                mp_bluetooth_nimble_root_pointers_t *rp = MP_STATE_PORT(bluetooth_nimble_root_pointers);
+                rp->notify_stream_stalled = false;
+                mp_bluetooth_gatts_on_notify_ready(rp->notify_stream_conn_handle, rp->notify_stream_value_handle);
             }
             return 0;
         }
@@ -1034,6 +1051,48 @@ int mp_bluetooth_gatts_notify_send(uint16_t conn_handle, uint16_t value_handle,
     return ble_hs_err_to_errno(ble_gattc_notify_custom(conn_handle, value_handle, om));
 }
 
+int mp_bluetooth_gatts_notify_stream(uint16_t conn_handle, uint16_t value_handle, const uint8_t *value, size_t value_len, size_t *sent) {
+    *sent = 0;
+    if (!mp_bluetooth_is_active()) {
+        return ERRNO_BLUETOOTH_NOT_ACTIVE;
+    }
+    uint16_t mtu = ble_att_mtu(conn_handle);
+    if (mtu == 0) {
+        return MP_ENOTCONN;
+    }
+    // Mark the stream as stalled up front, so that a notification completing
+    // while this loop runs can't be missed. At worst that raises a spurious
+    // _IRQ_GATTS_NOTIFY_READY.
+    mp_bluetooth_nimble_root_pointers_t *rp = MP_STATE_PORT(bluetooth_nimble_root_pointers);
+    rp->notify_stream_conn_handle = conn_handle;
+    rp->notify_stream_value_handle = value_handle;
+    rp->notify_stream_stalled = true;
+    while (*sent < value_len) {
+        // Stop short of exhausting the pool so that incoming ACL data and
+        // other outgoing PDUs can still get an mbuf.
+        if (os_msys_num_free() <= MICROPY_BLUETOOTH_NIMBLE_NOTIFY_STREAM_RESERVE) {
+            break;
+        }
+        size_t len = MIN(value_len - *sent, (size_t)mtu - 3);
+        struct os_mbuf *om = ble_hs_mbuf_from_flat(value + *sent, len);
+        if (om == NULL) {
+            break;
+        }
+        // notify_custom consumes om whether or not it succeeds.
+        int err = ble_gattc_notify_custom(conn_handle, value_handle, om);
+        if (err == BLE_HS_ENOMEM) {
+            break;
+        } else if (err != 0) {
+            return ble_hs_err_to_errno(err);
+        }
+        *sent += len;
+    }
+    if (*sent == value_len) {
+        rp->notify_stream_stalled = false;
+    }
+    return 0;
+}
+
 int mp_bluetooth_gatts_indicate(uint16_t conn_handle, uint16_t value_handle) {
     if (!mp_bluetooth_is_active()) {
         return ERRNO_BLUETOOTH_NOT_ACTIVE;
@@ -1177,6 +1236,9 @@ STATIC int peripheral_gap_event_cb(struct ble_gap_event *event, void *arg) {
                 ble_gap_conn_find(event->connect.conn_handle, &desc);
                 reverse_addr_byte_order(addr, desc.peer_id_addr.val);
                 mp_bluetooth_gap_on_connected_disconnected(MP_BLUETOOTH_IRQ_PERIPHERAL_CONNECT, event->connect.conn_handle, desc.peer_id_addr.type, addr);
+                #if MICROPY_BLUETOOTH_NIMBLE_FAST_LINK
+                request_fast_link(event->connect.conn_handle);
+                #endif
             } else {
                 // Connection failed.
                 mp_bluetooth_gap_on_connected_disconnected(MP_BLUETOOTH_IRQ_PERIPHERAL_DISCONNECT, event->connect.conn_handle, 0xff, addr);
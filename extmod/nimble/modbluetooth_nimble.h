@@ -31,6 +31,16 @@
 
 #define MP_BLUETOOTH_NIMBLE_MAX_SERVICES (8)
 
+// Request LE data length extension and the 2M PHY on every new connection.
+#ifndef MICROPY_BLUETOOTH_NIMBLE_FAST_LINK
+#define MICROPY_BLUETOOTH_NIMBLE_FAST_LINK (1)
+#endif
+
+// Number of msys mbufs that gatts_notify_stream leaves free for other traffic.
+#ifndef MICROPY_BLUETOOTH_NIMBLE_NOTIFY_STREAM_RESERVE
+#define MICROPY_BLUETOOTH_NIMBLE_NOTIFY_STREAM_RESERVE (2)
+#endif
+
 typedef struct _mp_bluetooth_nimble_root_pointers_t {
     // Characteristic (and descriptor) value storage.
     mp_gatts_db_t gatts_db;
@@ -39,6 +49,11 @@ typedef struct _mp_bluetooth_nimble_root_pointers_t {
     size_t n_services;
     struct ble_gatt_svc_def *services[MP_BLUETOOTH_NIMBLE_MAX_SERVICES];
 
+    // Set when gatts_notify_stream ran out of mbufs, cleared when one is sent.
+    bool notify_stream_stalled;
+    uint16_t notify_stream_conn_handle;
+    uint16_t notify_stream_value_handle;
+
     #if MICROPY_PY_BLUETOOTH_ENABLE_L2CAP_CHANNELS
     // L2CAP channels.
     struct _mp_bluetooth_nimble_l2cap_channel_t *l2cap_chan;
@@ -0,0 +1,167 @@
+// Copyright 2007-2009 Russ Cox.  All Rights Reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#include "re1.5.h"
+
+// Pike VM: all threads advance through the subject together, one byte at a
+// time, so the time taken is at most proportional to the subject length times
+// the program length, and the C stack is only used to follow jumps.  Threads
+// are kept in priority order, giving the same matches as the backtracking
+// engine.
+
+typedef struct {
+	int n;
+	int *pc;
+	const char **sub;
+} ThreadList;
+
+typedef struct {
+	ByteProg *prog;
+	Subject *input;
+	int nsubp;
+	unsigned *mark;
+	unsigned step;
+} PikeVM;
+
+int re1_5_pikevm_worksize(ByteProg *prog, int nsubp)
+{
+	int n = prog->bytelen;
+	return (2 * n + 1) * nsubp * sizeof(const char*) + 2 * n * sizeof(int) + n * sizeof(unsigned);
+}
+
+// Follow jumps and assertions from pc, adding the consumers and Match reached
+// to l, each with its own copy of the captures.
+static void
+addthread(PikeVM *vm, ThreadList *l, const char *pc, const char **sub, const char *sp)
+{
+	int off = pc - vm->prog->insts;
+	if(vm->mark[off] == vm->step)
+		return;
+	vm->mark[off] = vm->step;
+
+	re1_5_stack_chk();
+
+	switch(*pc) {
+	case Jmp:
+		addthread(vm, l, pc + 2 + (signed char)pc[1], sub, sp);
+		return;
+	case Split:
+		addthread(vm, l, pc + 2, sub, sp);
+		addthread(vm, l, pc + 2 + (signed char)pc[1], sub, sp);
+		return;
+	case RSplit:
+		addthread(vm, l, pc + 2 + (signed char)pc[1], sub, sp);
+		addthread(vm, l, pc + 2, sub, sp);
+		return;
+	case Save:
+		off = (unsigned char)pc[1];
+		if(off < vm->nsubp) {
+			const char *old = sub[off];
+			sub[off] = sp;
+			addthread(vm, l, pc + 2, sub, sp);
+			sub[off] = old;
+		} else {
+			addthread(vm, l, pc + 2, sub, sp);
+		}
+		return;
+	case Bol:
+		if(sp == vm->input->begin)
+			addthread(vm, l, pc + 1, sub, sp);
+		return;
+	case Eol:
+		if(sp == vm->input->end)
+			addthread(vm, l, pc + 1, sub, sp);
+		return;
+	}
+	l->pc[l->n] = off;
+	memcpy(l->sub + l->n * vm->nsubp, sub, vm->nsubp * sizeof(*sub));
+	l->n++;
+}
+
+int
+re1_5_pikevm(ByteProg *prog, Subject *input, const char **subp, int nsubp, int is_anchored, void *work)
+{
+	int n = prog->bytelen;
+	ThreadList lists[2], *clist = &lists[0], *nlist = &lists[1], *tmp;
+	const char **sub0 = work;
+	lists[0].sub = sub0 + nsubp;
+	lists[1].sub = lists[0].sub + n * nsubp;
+	lists[0].pc = (int*)(lists[1].sub + n * nsubp);
+	lists[1].pc = lists[0].pc + n;
+
+	PikeVM vm = { prog, input, nsubp, (unsigned*)(lists[1].pc + n), 1 };
+	memset(vm.mark, 0, n * sizeof(unsigned));
+	memset((char*)sub0, 0, nsubp * sizeof(*sub0));
+
+	// Searching is done by starting a new lowest priority thread at each
+	// position, rather than by running the non-anchored prefix code.  If every
+	// match must start with a given char then positions without it are skipped.
+	const char *start = HANDLE_ANCHORED(prog->insts, 1);
+	int first = -1;
+	if(start[0] == Save && start[2] == Char)
+		first = (unsigned char)start[3];
+
+	int matched = 0;
+	const char *sp = input->begin;
+	clist->n = 0;
+	for(;;) {
+		if(!matched && (!is_anchored || sp == input->begin)) {
+			if(clist->n == 0 && first >= 0) {
+				sp = memchr(sp, first, input->end - sp);
+				if(sp == nil)
+					break;
+				vm.step++;
+			}
+			addthread(&vm, clist, start, sub0, sp);
+		}
+		if(clist->n == 0)
+			break;
+
+		vm.step++;
+		nlist->n = 0;
+		for(int i = 0; i < clist->n; i++) {
+			const char *pc = prog->insts + clist->pc[i];
+			const char **sub = clist->sub + i * nsubp;
+			int ok = 0, len = 0;
+			if(*pc == Match) {
+				// Lower priority threads can't give a preferred match
+				memcpy(subp, sub, nsubp * sizeof(*sub));
+				matched = 1;
+				break;
+			}
+			if(sp >= input->end)
+				continue;
+			switch(*pc) {
+			case Char:
+				ok = *sp == pc[1];
+				len = 2;
+				break;
+			case Any:
+				ok = 1;
+				len = 1;
+				break;
+			case Class:
+			case ClassNot:
+				ok = _re1_5_classmatch(pc + 1, sp);
+				len = 2 + 2 * (unsigned char)pc[1];
+				break;
+			case NamedClass:
+				ok = _re1_5_namedclassmatch(pc + 1, sp);
+				len = 2;
+				break;
+			default:
+				re1_5_fatal("pikevm");
+			}
+			if(ok)
+				addthread(&vm, nlist, pc + len, sub, sp + 1);
+		}
+		if(sp >= input->end)
+			break;
+		tmp = clist;
+		clist = nlist;
+		nlist = tmp;
+		sp++;
+	}
+	return matched;
+}
@@ -16,6 +16,10 @@ _attrs = {
     "start_server": "stream",
     "StreamReader": "stream",
     "StreamWriter": "stream",
+    "AsyncFile": "stream",
+    "open_file": "stream",
+    "run_in_executor": "executor",
+    "start_executor": "executor",
 }
 
 # Lazy loader, effectively does:
@@ -0,0 +1,98 @@
+# MicroPython uasyncio module
+# MIT license; Copyright (c) 2021 Damien P. George
+
+from . import core
+
+# MicroPython-extension: run blocking functions on a pool of worker threads so
+# they don't stall other tasks.  A worker takes a job from a queue and sets a
+# ThreadSafeFlag when done, which the waiting task is polling on.  If threads
+# are not available, or the event loop can't poll a ThreadSafeFlag, the function
+# is instead run by the calling task after letting other tasks run.
+_use_thread = None
+_jobs = None
+
+
+def _thread_ok():
+    global _use_thread
+    if _use_thread is None:
+        try:
+            import _thread, uselect
+            from .event import ThreadSafeFlag
+
+            # Unix port can't select/poll on user-defined types.
+            uselect.poll().register(ThreadSafeFlag())
+            _use_thread = True
+        except (ImportError, TypeError):
+            _use_thread = False
+    return _use_thread
+
+
+def _worker(jobs):
+    while True:
+        fn, args, res, flag = jobs.get()
+        try:
+            res[0] = fn(*args)
+        except Exception as er:
+            res[1] = er
+        flag.set()
+
+
+def start_executor(workers=2, stack_size=0):
+    global _jobs
+    if _jobs is not None or not _thread_ok():
+        return
+    import _thread
+
+    if not hasattr(_thread, "Queue"):
+        # each job gets a thread of its own
+        _jobs = False
+        return
+    _jobs = _thread.Queue(4 * workers)
+    if stack_size:
+        stack_size = _thread.stack_size(stack_size)
+    for _ in range(workers):
+        _thread.start_new_thread(_worker, (_jobs,))
+    if stack_size:
+        _thread.stack_size(stack_size)
+
+
+async def run_in_executor(fn, *args):
+    start_executor()
+    if _jobs is None:
+        # Let other tasks run before doing an operation that can't be split
+        await core.sleep_ms(0)
+        return fn(*args)
+    from .event import ThreadSafeFlag
+
+    flag = ThreadSafeFlag()
+    res = [None, None]
+    job = (fn, args, res, flag)
+    if _jobs:
+        while True:
+            try:
+                _jobs.put(job, False)
+                break
+            except OSError:
+                # all workers are busy and the queue is full
+                await core.sleep_ms(1)
+    else:
+        import _thread
+
+        _thread.start_new_thread(_worker, (_Once(job),))
+    await flag.wait()
+    if res[1] is not None:
+        raise res[1]
+    return res[0]
+
+
+# Stand-in for the job queue of a worker thread that runs a single job.
+class _Once:
+    def __init__(self, job):
+        self.job = job
+
+    def get(self):
+        job = self.job
+        if job is None:
+            raise SystemExit
+        self.job = None
+        return job
@@ -2,6 +2,7 @@
 # MIT license; Copyright (c) 2019-2020 Damien P. George
 
 from . import core
+from .executor import _thread_ok, run_in_executor as _run
 
 
 class Stream:
@@ -22,13 +23,21 @@ class Stream:
     def close(self):
         pass
 
+    # Return the connection to the usocket.Pool it was opened from, instead of closing it
+    def release(self):
+        pool, key = self.e["pool"]
+        pool.put(key, self.s)
+
     async def wait_closed(self):
         # TODO yield?
         self.s.close()
 
     async def read(self, n):
-        yield core._io_queue.queue_read(self.s)
-        return self.s.read(n)
+        while True:
+            yield core._io_queue.queue_read(self.s)
+            r = self.s.read(n)
+            if r is not None:
+                return r
 
     async def readexactly(self, n):
         r = b""
@@ -47,6 +56,8 @@ class Stream:
         while True:
             yield core._io_queue.queue_read(self.s)
             l2 = self.s.readline()  # may do multiple reads but won't block
+            if l2 is None:
+                continue  # eg a TLS socket only got handshake data
             l += l2
             if not l2 or l[-1] == 10:  # \n (check l in case l2 is str)
                 return l
@@ -71,20 +82,38 @@ StreamWriter = Stream
 
 
 # Create a TCP stream connection to a remote host
-async def open_connection(host, port):
+# If ssl is true then TLS is negotiated on it, without blocking other tasks
+# If pool is a usocket.Pool then an idle connection to the same place is reused
+async def open_connection(host, port, ssl=None, server_hostname=None, pool=None):
     from uerrno import EINPROGRESS
     import usocket as socket
 
+    e = {}
+    if pool is not None:
+        key = (host, port, bool(ssl))
+        e["pool"] = (pool, key)
+        s = pool.get(key)
+        if s is not None:
+            ss = Stream(s, e)
+            return ss, ss
     ai = socket.getaddrinfo(host, port)[0]  # TODO this is blocking!
     s = socket.socket()
     s.setblocking(False)
-    ss = Stream(s)
+    ss = Stream(s, e)
     try:
         s.connect(ai[-1])
     except OSError as er:
         if er.errno != EINPROGRESS:
             raise er
     yield core._io_queue.queue_write(s)
+    if ssl:
+        import ussl
+
+        if server_hostname is None:
+            server_hostname = host
+        # The handshake is done by the first reads and writes of the stream
+        s = ussl.wrap_socket(s, server_hostname=server_hostname, do_handshake=False)
+        ss = Stream(s, e)
     return ss, ss
 
 
@@ -139,6 +168,98 @@ async def start_server(cb, host, port, backlog=5):
     return s
 
 
+# MicroPython-extension: Stream over a file, such that slow file operations
+# (eg on an SD card) don't stall other tasks.  If threads are available, and the
+# event loop can poll a ThreadSafeFlag, each operation runs on a worker thread of
+# the executor.  Otherwise operations are split into chunks with a yield to the
+# scheduler between each one.
+
+
+class AsyncFile:
+    def __init__(self, f, chunk=512):
+        self.f = f
+        self.chunk = chunk
+        self.out_buf = b""
+
+    async def __aenter__(self):
+        return self
+
+    async def __aexit__(self, exc_type, exc, tb):
+        await self.wait_closed()
+
+    def close(self):
+        pass
+
+    async def wait_closed(self):
+        await _run(self.f.close)
+
+    def seek(self, offset, whence=0):
+        return self.f.seek(offset, whence)
+
+    def tell(self):
+        return self.f.tell()
+
+    async def read(self, n=-1):
+        if _thread_ok():
+            return await _run(self.f.read, n)
+        r = None
+        while n:
+            await core.sleep_ms(0)
+            r2 = self.f.read(self.chunk if n < 0 else min(n, self.chunk))
+            if r is None:
+                r = r2
+            elif r2:
+                r += r2
+            if len(r2) < self.chunk:
+                break
+            n -= len(r2)
+        if r is None:
+            r = self.f.read(0)
+        return r
+
+    async def readinto(self, buf):
+        if _thread_ok():
+            return await _run(self.f.readinto, buf)
+        mv = memoryview(buf)
+        off = 0
+        while off < len(mv):
+            await core.sleep_ms(0)
+            n = self.f.readinto(mv[off : off + self.chunk])
+            if not n:
+                break
+            off += n
+        return off
+
+    async def readline(self):
+        return await _run(self.f.readline)
+
+    def write(self, buf):
+        if isinstance(buf, str):
+            buf = buf.encode()
+        self.out_buf += buf
+
+    async def drain(self):
+        buf = self.out_buf
+        self.out_buf = b""
+        if _thread_ok():
+            await _run(self.f.write, buf)
+            return
+        mv = memoryview(buf)
+        off = 0
+        while off < len(mv):
+            await core.sleep_ms(0)
+            off += self.f.write(mv[off : off + self.chunk])
+
+    async def flush(self):
+        await self.drain()
+        await _run(self.f.flush)
+
+
+# Open a file and return an AsyncFile for it, without blocking other tasks
+async def open_file(name, mode="r", chunk=512):
+    return AsyncFile(await _run(open, name, mode), chunk)
+
+
 ################################################################################
 # Legacy uasyncio compatibility
 
@@ -31,15 +31,37 @@
 #include "py/runtime.h"
 #include "py/objtuple.h"
 #include "py/objarray.h"
+#include "py/objtype.h"
 #include "py/stream.h"
 #include "extmod/misc.h"
 #include "lib/utils/interrupt_char.h"
 
 #if MICROPY_PY_OS_DUPTERM
 
+#if MICROPY_PY_OS_DUPTERM_RX_BUF_SIZE
+#if MICROPY_PY_OS_DUPTERM_RX_BUF_SIZE > 255
+#error MICROPY_PY_OS_DUPTERM_RX_BUF_SIZE must be less than 256
+#endif
+
+// Characters read ahead from the dupterm streams that are implemented in
+// Python, so that each call to their readinto() method gets a batch of
+// characters instead of one.  Streams implemented in C are still read one
+// character at a time, because some (eg UART) wait for the full size.
+typedef struct _dupterm_rx_buf_t {
+    uint8_t pos;
+    uint8_t len;
+    byte buf[MICROPY_PY_OS_DUPTERM_RX_BUF_SIZE];
+} dupterm_rx_buf_t;
+
+STATIC dupterm_rx_buf_t dupterm_rx_buf[MICROPY_PY_OS_DUPTERM];
+#endif
+
 void mp_uos_deactivate(size_t dupterm_idx, const char *msg, mp_obj_t exc) {
     mp_obj_t term = MP_STATE_VM(dupterm_objs[dupterm_idx]);
     MP_STATE_VM(dupterm_objs[dupterm_idx]) = MP_OBJ_NULL;
+    #if MICROPY_PY_OS_DUPTERM_RX_BUF_SIZE
+    dupterm_rx_buf[dupterm_idx].len = 0;
+    #endif
     mp_printf(&mp_plat_print, msg);
     if (exc != MP_OBJ_NULL) {
         mp_obj_print_exception(&mp_plat_print, exc);
@@ -62,6 +84,15 @@ uintptr_t mp_uos_dupterm_poll(uintptr_t poll_flags) {
             continue;
         }
 
+        #if MICROPY_PY_OS_DUPTERM_RX_BUF_SIZE
+        if ((poll_flags & MP_STREAM_POLL_RD) && dupterm_rx_buf[idx].pos < dupterm_rx_buf[idx].len) {
+            poll_flags_out |= MP_STREAM_POLL_RD;
+            if (poll_flags_out == poll_flags) {
+                break;
+            }
+        }
+        #endif
+
         int errcode = 0;
         mp_uint_t ret = 0;
         const mp_stream_p_t *stream_p = mp_get_stream(s);
@@ -98,6 +129,13 @@ int mp_uos_dupterm_rx_chr(void) {
             continue;
         }
 
+        #if MICROPY_PY_OS_DUPTERM_RX_BUF_SIZE
+        dupterm_rx_buf_t *rx = &dupterm_rx_buf[idx];
+        if (rx->pos < rx->len) {
+            return rx->buf[rx->pos++];
+        }
+        #endif
+
         #if MICROPY_PY_UOS_DUPTERM_BUILTIN_STREAM
         if (mp_uos_dupterm_is_builtin_stream(MP_STATE_VM(dupterm_objs[idx]))) {
             byte buf[1];
@@ -114,10 +152,18 @@ int mp_uos_dupterm_rx_chr(void) {
 
         nlr_buf_t nlr;
         if (nlr_push(&nlr) == 0) {
-            byte buf[1];
+            byte buf1[1];
+            byte *buf = buf1;
+            mp_uint_t size = 1;
+            #if MICROPY_PY_OS_DUPTERM_RX_BUF_SIZE
+            if (mp_obj_is_instance_type(mp_obj_get_type(MP_STATE_VM(dupterm_objs[idx])))) {
+                buf = rx->buf;
+                size = sizeof(rx->buf);
+            }
+            #endif
             int errcode;
             const mp_stream_p_t *stream_p = mp_get_stream(MP_STATE_VM(dupterm_objs[idx]));
-            mp_uint_t out_sz = stream_p->read(MP_STATE_VM(dupterm_objs[idx]), buf, 1, &errcode);
+            mp_uint_t out_sz = stream_p->read(MP_STATE_VM(dupterm_objs[idx]), buf, size, &errcode);
             if (out_sz == 0) {
                 nlr_pop();
                 mp_uos_deactivate(idx, "dupterm: EOF received, deactivating\n", MP_OBJ_NULL);
@@ -129,8 +175,23 @@ int mp_uos_dupterm_rx_chr(void) {
                     mp_raise_OSError(errcode);
                 }
             } else {
-                // read 1 byte
+                // read at least 1 byte
                 nlr_pop();
+                #if MICROPY_PY_OS_DUPTERM_RX_BUF_SIZE
+                if (buf == rx->buf) {
+                    // an interrupt char in the batch discards what came before it
+                    out_sz = MIN(out_sz, size);
+                    const byte *intr = NULL;
+                    if (mp_interrupt_char >= 0) {
+                        intr = memchr(buf, mp_interrupt_char, out_sz);
+                    }
+                    if (intr != NULL) {
+                        buf += intr - rx->buf;
+                    }
+                    rx->pos = buf - rx->buf + 1;
+                    rx->len = out_sz;
+                }
+                #endif
                 if (buf[0] == mp_interrupt_char) {
                     // Signal keyboard interrupt to be raised as soon as the VM resumes
                     mp_sched_keyboard_interrupt();
@@ -186,6 +247,9 @@ STATIC mp_obj_t mp_uos_dupterm(size_t n_args, const mp_obj_t *args) {
     if (previous_obj == MP_OBJ_NULL) {
         previous_obj = mp_const_none;
     }
+    #if MICROPY_PY_OS_DUPTERM_RX_BUF_SIZE
+    dupterm_rx_buf[idx].len = 0;
+    #endif
     if (args[0] == mp_const_none) {
         MP_STATE_VM(dupterm_objs[idx]) = MP_OBJ_NULL;
     } else {
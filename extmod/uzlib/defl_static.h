@@ -36,6 +36,9 @@ struct Outbuf {
     unsigned long outbits;
     int noutbits;
     int comp_disabled;
+    /* Called when outbuf is full (outlen == outsize), and must make room in it,
+       eg by consuming the bytes in it and setting outlen to 0. */
+    void (*outbuf_full_cb)(struct Outbuf *out);
 };
 
 void outbits(struct Outbuf *out, unsigned long bits, int nbits);
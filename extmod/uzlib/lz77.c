@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) uzlib authors
+ *
+ * This software is provided 'as-is', without any express
+ * or implied warranty.  In no event will the authors be
+ * held liable for any damages arising from the use of
+ * this software.
+ *
+ * Permission is granted to anyone to use this software
+ * for any purpose, including commercial applications,
+ * and to alter it and redistribute it freely, subject to
+ * the following restrictions:
+ *
+ * 1. The origin of this software must not be
+ *    misrepresented; you must not claim that you
+ *    wrote the original software. If you use this
+ *    software in a product, an acknowledgment in
+ *    the product documentation would be appreciated
+ *    but is not required.
+ *
+ * 2. Altered source versions must be plainly marked
+ *    as such, and must not be misrepresented as
+ *    being the original software.
+ *
+ * 3. This notice may not be removed or altered from
+ *    any source distribution.
+ */
+
+
+/*
+ * LZ77 compressor with hash chains over a bounded window, producing a
+ * single deflate block through defl_static.c.
+ */
+
+#include <string.h>
+#include "uzlib.h"
+
+#define MIN_MATCH 3
+#define MAX_MATCH 258
+
+static unsigned hash3(const struct uzlib_comp *c, const uint8_t *p)
+{
+    uint32_t v = ((uint32_t)p[0] << 16) | (p[1] << 8) | p[2];
+    return (v * 0x9e3779b1) >> (32 - c->hash_bits);
+}
+
+static void insert(struct uzlib_comp *c, unsigned pos)
+{
+    unsigned h = hash3(c, c->window + pos);
+    c->hash_prev[pos & (c->dict_size - 1)] = c->hash_head[h];
+    c->hash_head[h] = pos;
+}
+
+/* Drop the oldest dict_size bytes of the window.  Hash entries that pointed
+   into them become 0; a chain may then lead to a wrong candidate, but every
+   candidate is verified by comparing the bytes anyway. */
+static void slide(struct uzlib_comp *c)
+{
+    unsigned n = c->dict_size;
+    memmove(c->window, c->window + n, c->win_len - n);
+    c->win_len -= n;
+    c->win_pos -= n;
+    for (unsigned i = 0; i < (1u << c->hash_bits); i++) {
+        c->hash_head[i] = c->hash_head[i] >= n ? c->hash_head[i] - n : 0;
+    }
+    for (unsigned i = 0; i < n; i++) {
+        c->hash_prev[i] = c->hash_prev[i] >= n ? c->hash_prev[i] - n : 0;
+    }
+}
+
+/* Encode input from the window; unless finishing keep a full lookahead so
+   matches aren't cut short at the end of the input seen so far. */
+static void encode(struct uzlib_comp *c, bool finish)
+{
+    const uint8_t *win = c->window;
+    unsigned end = c->win_len;
+    while (c->win_pos < end && (finish || end - c->win_pos >= MAX_MATCH)) {
+        unsigned pos = c->win_pos;
+        unsigned avail = end - pos;
+        if (avail > MAX_MATCH) {
+            avail = MAX_MATCH;
+        }
+
+        unsigned best_len = 0;
+        unsigned best_dist = 0;
+        if (avail >= MIN_MATCH) {
+            unsigned cand = c->hash_head[hash3(c, win + pos)];
+            unsigned chain = c->max_chain;
+            while (chain-- && cand < pos && pos - cand <= c->dict_size) {
+                /* Check the byte that would make this match longer first */
+                if (win[cand + best_len] == win[pos + best_len]) {
+                    unsigned len = 0;
+                    while (len < avail && win[cand + len] == win[pos + len]) {
+                        len++;
+                    }
+                    if (len > best_len) {
+                        best_len = len;
+                        best_dist = pos - cand;
+                        if (len == avail) {
+                            break;
+                        }
+                    }
+                }
+                unsigned next = c->hash_prev[cand & (c->dict_size - 1)];
+                if (next >= cand) {
+                    /* Entry was overwritten by a newer position */
+                    break;
+                }
+                cand = next;
+            }
+        }
+
+        if (best_len >= MIN_MATCH) {
+            zlib_match(&c->out, best_dist, best_len);
+        } else {
+            best_len = 1;
+            zlib_literal(&c->out, win[pos]);
+        }
+        for (unsigned i = 0; i < best_len && pos + i + MIN_MATCH <= end; i++) {
+            insert(c, pos + i);
+        }
+        c->win_pos = pos + best_len;
+    }
+}
+
+void uzlib_compress_init(struct uzlib_comp *c)
+{
+    c->win_len = 0;
+    c->win_pos = 0;
+    memset(c->hash_head, 0, sizeof(uint16_t) << c->hash_bits);
+    memset(c->hash_prev, 0, sizeof(uint16_t) * c->dict_size);
+    zlib_start_block(&c->out);
+}
+
+void uzlib_compress(struct uzlib_comp *c, const uint8_t *src, unsigned slen)
+{
+    while (slen) {
+        if (c->win_len == 2 * c->dict_size) {
+            /* The lookahead is at most MAX_MATCH so win_pos >= dict_size */
+            slide(c);
+        }
+        unsigned n = 2 * c->dict_size - c->win_len;
+        if (n > slen) {
+            n = slen;
+        }
+        memcpy(c->window + c->win_len, src, n);
+        c->win_len += n;
+        src += n;
+        slen -= n;
+        encode(c, false);
+    }
+}
+
+void uzlib_compress_finish(struct uzlib_comp *c)
+{
+    encode(c, true);
+    zlib_finish_block(&c->out);
+}
@@ -143,17 +143,29 @@ int TINFCC uzlib_gzip_parse_header(TINF_DATA *d);
 
 /* Compression API */
 
-typedef const uint8_t *uzlib_hash_entry_t;
-
+/* Input is buffered in a window of 2 * dict_size bytes, which holds the
+   history that matches may refer back to plus the lookahead.  Positions in
+   the window are chained by the hash of the 3 bytes starting there. */
 struct uzlib_comp {
     struct Outbuf out;
 
-    uzlib_hash_entry_t *hash_table;
+    uint8_t *window;
+    unsigned int win_len;   /* number of bytes in the window */
+    unsigned int win_pos;   /* next byte to encode */
+    unsigned int dict_size; /* power of 2 from 512 to 32768 */
+    uint16_t *hash_head;    /* 1 << hash_bits entries */
+    uint16_t *hash_prev;    /* dict_size entries */
     unsigned int hash_bits;
-    unsigned int dict_size;
+    unsigned int max_chain; /* number of candidates to try for each match */
 };
 
+/* The caller sets out, window, dict_size, hash_head, hash_prev, hash_bits
+   and max_chain, then calls uzlib_compress_init, which starts the (single,
+   static Huffman) deflate block. */
+void TINFCC uzlib_compress_init(struct uzlib_comp *c);
 void TINFCC uzlib_compress(struct uzlib_comp *c, const uint8_t *src, unsigned slen);
+/* Encodes the remaining input and ends the block, byte aligned */
+void TINFCC uzlib_compress_finish(struct uzlib_comp *c);
 
 /* Checksum API */
 
@@ -122,6 +122,25 @@ STATIC mp_obj_t mp_vfs_proxy_call(mp_vfs_mount_t *vfs, qstr meth_name, size_t n_
     return mp_call_method_n_kw(n_args, 0, meth);
 }
 
+#if MICROPY_VFS_IMPORT_STAT_CACHE
+void mp_vfs_import_stat_cache_clear(void) {
+    memset(MP_STATE_VM(vfs_import_stat_cache), 0, sizeof(MP_STATE_VM(vfs_import_stat_cache)));
+}
+
+// Return the cache entry for the given path.  If it doesn't hold the result
+// for the path then entry->vfs is cleared, and the entry can be filled in.
+STATIC mp_vfs_import_stat_cache_entry_t *import_stat_cache_lookup(mp_vfs_mount_t *vfs, const char *path, mp_uint_t *hash, size_t *len) {
+    *len = strlen(path);
+    *hash = qstr_compute_hash((const byte *)path, *len);
+    mp_vfs_import_stat_cache_entry_t *entry = &MP_STATE_VM(vfs_import_stat_cache)[*hash & (MICROPY_VFS_IMPORT_STAT_CACHE_SIZE - 1)];
+    if (entry->vfs == vfs && entry->hash == *hash && entry->len == *len) {
+        return entry;
+    }
+    entry->vfs = NULL;
+    return entry;
+}
+#endif
+
 mp_import_stat_t mp_vfs_import_stat(const char *path) {
     const char *path_out;
     mp_vfs_mount_t *vfs = mp_vfs_lookup_path(path, &path_out);
@@ -132,6 +151,29 @@ mp_import_stat_t mp_vfs_import_stat(const char *path) {
     // If the mounted object has the VFS protocol, call its import_stat helper
     const mp_vfs_proto_t *proto = mp_obj_get_type(vfs->obj)->protocol;
     if (proto != NULL) {
+        #if MICROPY_VFS_IMPORT_STAT_CACHE
+        // Files of a POSIX filesystem can be changed by other processes, so
+        // only filesystems managed by this VFS are cached.
+        #if MICROPY_VFS_POSIX
+        if (mp_obj_get_type(vfs->obj) != &mp_type_vfs_posix)
+        #endif
+        {
+            mp_uint_t hash;
+            size_t len;
+            mp_vfs_import_stat_cache_entry_t *entry = import_stat_cache_lookup(vfs, path_out, &hash, &len);
+            if (entry->vfs == vfs) {
+                return entry->stat;
+            }
+            mp_import_stat_t stat = proto->import_stat(MP_OBJ_TO_PTR(vfs->obj), path_out);
+            if (len <= 0xffff) {
+                entry->vfs = vfs;
+                entry->hash = hash;
+                entry->len = len;
+                entry->stat = stat;
+            }
+            return stat;
+        }
+        #endif
         return proto->import_stat(MP_OBJ_TO_PTR(vfs->obj), path_out);
     }
 
@@ -163,6 +205,7 @@ STATIC mp_obj_t mp_vfs_autodetect(mp_obj_t bdev_obj) {
         // The superblock for littlefs is in both block 0 and 1, but block 0 may be erased
         // or partially written, so search both blocks 0 and 1 for the littlefs signature.
         mp_vfs_blockdev_t blockdev;
+        blockdev.flags = 0;
         mp_vfs_blockdev_init(&blockdev, bdev_obj);
         uint8_t buf[44];
         for (size_t block_num = 0; block_num <= 1; ++block_num) {
@@ -257,6 +300,11 @@ mp_obj_t mp_vfs_mount(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args
     }
     *vfsp = vfs;
 
+    #if MICROPY_VFS_IMPORT_STAT_CACHE
+    // the new mount may hide paths of a filesystem mounted at the root
+    mp_vfs_import_stat_cache_clear();
+    #endif
+
     return mp_const_none;
 }
 MP_DEFINE_CONST_FUN_OBJ_KW(mp_vfs_mount_obj, 2, mp_vfs_mount);
@@ -281,6 +329,10 @@ mp_obj_t mp_vfs_umount(mp_obj_t mnt_in) {
         mp_raise_OSError(MP_EINVAL);
     }
 
+    #if MICROPY_VFS_IMPORT_STAT_CACHE
+    mp_vfs_import_stat_cache_clear();
+    #endif
+
     // if we unmounted the current device then set current to root
     if (MP_STATE_VM(vfs_cur) == vfs) {
         MP_STATE_VM(vfs_cur) = MP_VFS_ROOT;
@@ -315,6 +367,12 @@ mp_obj_t mp_vfs_open(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args)
     #endif
 
     mp_vfs_mount_t *vfs = lookup_path(args[ARG_file].u_obj, &args[ARG_file].u_obj);
+    #if MICROPY_VFS_IMPORT_STAT_CACHE
+    if (strpbrk(mp_obj_str_get_str(args[ARG_mode].u_obj), "wax+") != NULL) {
+        // the file may be created
+        mp_vfs_import_stat_cache_clear();
+    }
+    #endif
     return mp_vfs_proxy_call(vfs, MP_QSTR_open, 2, (mp_obj_t *)&args);
 }
 MP_DEFINE_CONST_FUN_OBJ_KW(mp_vfs_open_obj, 0, mp_vfs_open);
@@ -338,6 +396,10 @@ mp_obj_t mp_vfs_chdir(mp_obj_t path_in) {
         mp_vfs_proxy_call(vfs, MP_QSTR_chdir, 1, &path_out);
     }
     MP_STATE_VM(vfs_cur) = vfs;
+    #if MICROPY_VFS_IMPORT_STAT_CACHE
+    // relative paths are cached relative to the old directory
+    mp_vfs_import_stat_cache_clear();
+    #endif
     return mp_const_none;
 }
 MP_DEFINE_CONST_FUN_OBJ_1(mp_vfs_chdir_obj, mp_vfs_chdir);
@@ -447,6 +509,9 @@ mp_obj_t mp_vfs_mkdir(mp_obj_t path_in) {
     if (vfs == MP_VFS_ROOT || (vfs != MP_VFS_NONE && !strcmp(mp_obj_str_get_str(path_out), "/"))) {
         mp_raise_OSError(MP_EEXIST);
     }
+    #if MICROPY_VFS_IMPORT_STAT_CACHE
+    mp_vfs_import_stat_cache_clear();
+    #endif
     return mp_vfs_proxy_call(vfs, MP_QSTR_mkdir, 1, &path_out);
 }
 MP_DEFINE_CONST_FUN_OBJ_1(mp_vfs_mkdir_obj, mp_vfs_mkdir);
@@ -454,6 +519,9 @@ MP_DEFINE_CONST_FUN_OBJ_1(mp_vfs_mkdir_obj, mp_vfs_mkdir);
 mp_obj_t mp_vfs_remove(mp_obj_t path_in) {
     mp_obj_t path_out;
     mp_vfs_mount_t *vfs = lookup_path(path_in, &path_out);
+    #if MICROPY_VFS_IMPORT_STAT_CACHE
+    mp_vfs_import_stat_cache_clear();
+    #endif
     return mp_vfs_proxy_call(vfs, MP_QSTR_remove, 1, &path_out);
 }
 MP_DEFINE_CONST_FUN_OBJ_1(mp_vfs_remove_obj, mp_vfs_remove);
@@ -466,6 +534,9 @@ mp_obj_t mp_vfs_rename(mp_obj_t old_path_in, mp_obj_t new_path_in) {
         // can't rename across filesystems
         mp_raise_OSError(MP_EPERM);
     }
+    #if MICROPY_VFS_IMPORT_STAT_CACHE
+    mp_vfs_import_stat_cache_clear();
+    #endif
     return mp_vfs_proxy_call(old_vfs, MP_QSTR_rename, 2, args);
 }
 MP_DEFINE_CONST_FUN_OBJ_2(mp_vfs_rename_obj, mp_vfs_rename);
@@ -473,6 +544,9 @@ MP_DEFINE_CONST_FUN_OBJ_2(mp_vfs_rename_obj, mp_vfs_rename);
 mp_obj_t mp_vfs_rmdir(mp_obj_t path_in) {
     mp_obj_t path_out;
     mp_vfs_mount_t *vfs = lookup_path(path_in, &path_out);
+    #if MICROPY_VFS_IMPORT_STAT_CACHE
+    mp_vfs_import_stat_cache_clear();
+    #endif
     return mp_vfs_proxy_call(vfs, MP_QSTR_rmdir, 1, &path_out);
 }
 MP_DEFINE_CONST_FUN_OBJ_1(mp_vfs_rmdir_obj, mp_vfs_rmdir);
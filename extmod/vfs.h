@@ -43,6 +43,8 @@
 #define MP_BLOCKDEV_FLAG_FREE_OBJ       (0x0002) // fs_user_mount_t obj should be freed on umount
 #define MP_BLOCKDEV_FLAG_HAVE_IOCTL     (0x0004) // new protocol with ioctl
 #define MP_BLOCKDEV_FLAG_NO_FILESYSTEM  (0x0008) // the block device has no filesystem on it
+#define MP_BLOCKDEV_FLAG_CACHE          (0x0010) // use the block cache, if enabled
+#define MP_BLOCKDEV_FLAG_PROTOCOL       (0x0020) // device implements mp_block_dev_p_t, stored in proto
 
 // constants for block protocol ioctl
 #define MP_BLOCKDEV_IOCTL_INIT          (1)
@@ -57,9 +59,29 @@ typedef struct _mp_vfs_proto_t {
     mp_import_stat_t (*import_stat)(void *self, const char *path);
 } mp_vfs_proto_t;
 
+// Native block device protocol, for the protocol slot of a block device type.
+// The VFS calls these functions directly, with no argument objects allocated,
+// if the readblocks/writeblocks methods bound from the device are the given
+// method objects (ie not overridden by a subclass).  The functions implement
+// the same operations as the methods: with ext false this is the simple
+// interface (block_off is 0 and len a multiple of the block size), otherwise
+// the extended interface.  They return 0 or a negative errno, and may raise.
+// The optional mmap function is for devices whose contents can be read
+// directly from memory: it returns the address of block_num and sets
+// *num_blocks to the number of consecutive blocks readable from there, or
+// returns NULL if those blocks aren't memory mapped.
+typedef struct _mp_block_dev_p_t {
+    const void *readblocks_obj;
+    const void *writeblocks_obj;
+    int (*readblocks)(mp_obj_t self, uint32_t block_num, uint32_t block_off, uint8_t *buf, size_t len, bool ext);
+    int (*writeblocks)(mp_obj_t self, uint32_t block_num, uint32_t block_off, const uint8_t *buf, size_t len, bool ext);
+    const uint8_t *(*mmap)(mp_obj_t self, uint32_t block_num, uint32_t *num_blocks);
+} mp_block_dev_p_t;
+
 typedef struct _mp_vfs_blockdev_t {
     uint16_t flags;
     size_t block_size;
+    const mp_block_dev_p_t *proto;
     mp_obj_t readblocks[5];
     mp_obj_t writeblocks[5];
     // new protocol uses just ioctl, old uses sync (optional) and count
@@ -70,6 +92,9 @@ typedef struct _mp_vfs_blockdev_t {
             mp_obj_t count[2];
         } old;
     } u;
+    #if MICROPY_VFS_BLOCKDEV_CACHE
+    struct _mp_vfs_blockdev_cache_t *cache;
+    #endif
 } mp_vfs_blockdev_t;
 
 typedef struct _mp_vfs_mount_t {
@@ -85,9 +110,12 @@ int mp_vfs_blockdev_read_ext(mp_vfs_blockdev_t *self, size_t block_num, size_t b
 int mp_vfs_blockdev_write(mp_vfs_blockdev_t *self, size_t block_num, size_t num_blocks, const uint8_t *buf);
 int mp_vfs_blockdev_write_ext(mp_vfs_blockdev_t *self, size_t block_num, size_t block_off, size_t len, const uint8_t *buf);
 mp_obj_t mp_vfs_blockdev_ioctl(mp_vfs_blockdev_t *self, uintptr_t cmd, uintptr_t arg);
+int mp_vfs_blockdev_flush(mp_vfs_blockdev_t *self);
+const uint8_t *mp_vfs_blockdev_mmap(mp_vfs_blockdev_t *self, size_t block_num, size_t *num_blocks);
 
 mp_vfs_mount_t *mp_vfs_lookup_path(const char *path, const char **path_out);
 mp_import_stat_t mp_vfs_import_stat(const char *path);
+void mp_vfs_import_stat_cache_clear(void);
 mp_obj_t mp_vfs_mount(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args);
 mp_obj_t mp_vfs_umount(mp_obj_t mnt_in);
 mp_obj_t mp_vfs_open(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args);
@@ -117,5 +145,6 @@ MP_DECLARE_CONST_FUN_OBJ_2(mp_vfs_rename_obj);
 MP_DECLARE_CONST_FUN_OBJ_1(mp_vfs_rmdir_obj);
 MP_DECLARE_CONST_FUN_OBJ_1(mp_vfs_stat_obj);
 MP_DECLARE_CONST_FUN_OBJ_1(mp_vfs_statvfs_obj);
+MP_DECLARE_CONST_FUN_OBJ_VAR_BETWEEN(mp_vfs_mmap_obj);
 
 #endif // MICROPY_INCLUDED_EXTMOD_VFS_H
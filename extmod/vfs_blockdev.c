@@ -24,6 +24,8 @@
  * THE SOFTWARE.
  */
 
+#include <string.h>
+
 #include "py/runtime.h"
 #include "py/binary.h"
 #include "py/objarray.h"
@@ -44,12 +46,31 @@ void mp_vfs_blockdev_init(mp_vfs_blockdev_t *self, mp_obj_t bdev) {
         mp_load_method_maybe(bdev, MP_QSTR_sync, self->u.old.sync);
         mp_load_method(bdev, MP_QSTR_count, self->u.old.count);
     }
+
+    // Use the native protocol if the device has one and its methods aren't overridden
+    const mp_block_dev_p_t *proto = NULL;
+    if (self->readblocks[1] != MP_OBJ_NULL) {
+        proto = mp_obj_get_type(self->readblocks[1])->protocol;
+    }
+    if (proto != NULL && !(self->flags & MP_BLOCKDEV_FLAG_NATIVE)
+        && MP_OBJ_TO_PTR(self->readblocks[0]) == proto->readblocks_obj
+        && (self->writeblocks[0] == MP_OBJ_NULL
+            || (self->writeblocks[1] == self->readblocks[1]
+                && MP_OBJ_TO_PTR(self->writeblocks[0]) == proto->writeblocks_obj))) {
+        self->flags |= MP_BLOCKDEV_FLAG_PROTOCOL;
+        self->proto = proto;
+    }
+    #if MICROPY_VFS_BLOCKDEV_CACHE
+    self->cache = NULL;
+    #endif
 }
 
-int mp_vfs_blockdev_read(mp_vfs_blockdev_t *self, size_t block_num, size_t num_blocks, uint8_t *buf) {
+STATIC int blockdev_read_raw(mp_vfs_blockdev_t *self, size_t block_num, size_t num_blocks, uint8_t *buf) {
     if (self->flags & MP_BLOCKDEV_FLAG_NATIVE) {
         mp_uint_t (*f)(uint8_t *, uint32_t, uint32_t) = (void *)(uintptr_t)self->readblocks[2];
         return f(buf, block_num, num_blocks);
+    } else if (self->flags & MP_BLOCKDEV_FLAG_PROTOCOL) {
+        return self->proto->readblocks(self->readblocks[1], block_num, 0, buf, num_blocks * self->block_size, false);
     } else {
         mp_obj_array_t ar = {{&mp_type_bytearray}, BYTEARRAY_TYPECODE, 0, num_blocks *self->block_size, buf};
         self->readblocks[2] = MP_OBJ_NEW_SMALL_INT(block_num);
@@ -60,7 +81,11 @@ int mp_vfs_blockdev_read(mp_vfs_blockdev_t *self, size_t block_num, size_t num_b
     }
 }
 
-int mp_vfs_blockdev_read_ext(mp_vfs_blockdev_t *self, size_t block_num, size_t block_off, size_t len, uint8_t *buf) {
+STATIC int blockdev_read_ext_raw(mp_vfs_blockdev_t *self, size_t block_num, size_t block_off, size_t len, uint8_t *buf) {
+    if (self->flags & MP_BLOCKDEV_FLAG_PROTOCOL) {
+        return self->proto->readblocks(self->readblocks[1], block_num, block_off, buf, len, true);
+    }
+
     mp_obj_array_t ar = {{&mp_type_bytearray}, BYTEARRAY_TYPECODE, 0, len, buf};
     self->readblocks[2] = MP_OBJ_NEW_SMALL_INT(block_num);
     self->readblocks[3] = MP_OBJ_FROM_PTR(&ar);
@@ -73,15 +98,12 @@ int mp_vfs_blockdev_read_ext(mp_vfs_blockdev_t *self, size_t block_num, size_t b
     }
 }
 
-int mp_vfs_blockdev_write(mp_vfs_blockdev_t *self, size_t block_num, size_t num_blocks, const uint8_t *buf) {
-    if (self->writeblocks[0] == MP_OBJ_NULL) {
-        // read-only block device
-        return -MP_EROFS;
-    }
-
+STATIC int blockdev_write_raw(mp_vfs_blockdev_t *self, size_t block_num, size_t num_blocks, const uint8_t *buf) {
     if (self->flags & MP_BLOCKDEV_FLAG_NATIVE) {
         mp_uint_t (*f)(const uint8_t *, uint32_t, uint32_t) = (void *)(uintptr_t)self->writeblocks[2];
         return f(buf, block_num, num_blocks);
+    } else if (self->flags & MP_BLOCKDEV_FLAG_PROTOCOL) {
+        return self->proto->writeblocks(self->writeblocks[1], block_num, 0, buf, num_blocks * self->block_size, false);
     } else {
         mp_obj_array_t ar = {{&mp_type_bytearray}, BYTEARRAY_TYPECODE, 0, num_blocks *self->block_size, (void *)buf};
         self->writeblocks[2] = MP_OBJ_NEW_SMALL_INT(block_num);
@@ -92,10 +114,9 @@ int mp_vfs_blockdev_write(mp_vfs_blockdev_t *self, size_t block_num, size_t num_
     }
 }
 
-int mp_vfs_blockdev_write_ext(mp_vfs_blockdev_t *self, size_t block_num, size_t block_off, size_t len, const uint8_t *buf) {
-    if (self->writeblocks[0] == MP_OBJ_NULL) {
-        // read-only block device
-        return -MP_EROFS;
+STATIC int blockdev_write_ext_raw(mp_vfs_blockdev_t *self, size_t block_num, size_t block_off, size_t len, const uint8_t *buf) {
+    if (self->flags & MP_BLOCKDEV_FLAG_PROTOCOL) {
+        return self->proto->writeblocks(self->writeblocks[1], block_num, block_off, buf, len, true);
     }
 
     mp_obj_array_t ar = {{&mp_type_bytearray}, BYTEARRAY_TYPECODE, 0, len, (void *)buf};
@@ -110,7 +131,326 @@ int mp_vfs_blockdev_write_ext(mp_vfs_blockdev_t *self, size_t block_num, size_t
     }
 }
 
+#if MICROPY_VFS_BLOCKDEV_CACHE
+
+// The block cache sits between the filesystem drivers and the device.  Clean
+// blocks are kept in a small table with LRU replacement.  Written blocks are
+// held in a separate buffer while they extend a single run of consecutive
+// block numbers, and the run is passed to writeblocks in one call when it is
+// full, when a block outside it is written, or on sync/umount.
+typedef struct _mp_vfs_blockdev_cache_t {
+    size_t block_size;
+    uint32_t tick;
+    uint32_t used[MICROPY_VFS_BLOCKDEV_CACHE_BLOCKS]; // last use of a slot, 0 if empty
+    size_t block_num[MICROPY_VFS_BLOCKDEV_CACHE_BLOCKS];
+    uint8_t *data;
+    #if MICROPY_VFS_BLOCKDEV_WRITEBACK_BLOCKS
+    size_t wb_start;
+    size_t wb_count;
+    uint8_t *wb_data;
+    #endif
+} mp_vfs_blockdev_cache_t;
+
+STATIC int blockdev_cache_flush(mp_vfs_blockdev_t *self, mp_vfs_blockdev_cache_t *c) {
+    #if MICROPY_VFS_BLOCKDEV_WRITEBACK_BLOCKS
+    if (c->wb_count != 0) {
+        int ret = blockdev_write_raw(self, c->wb_start, c->wb_count, c->wb_data);
+        if (ret != 0) {
+            return ret;
+        }
+        c->wb_count = 0;
+    }
+    #else
+    (void)self;
+    (void)c;
+    #endif
+    return 0;
+}
+
+STATIC mp_vfs_blockdev_cache_t *blockdev_get_cache(mp_vfs_blockdev_t *self) {
+    if (!(self->flags & MP_BLOCKDEV_FLAG_CACHE)) {
+        return NULL;
+    }
+    mp_vfs_blockdev_cache_t *c = self->cache;
+    if (c != NULL) {
+        if (c->block_size == self->block_size) {
+            return c;
+        }
+        // The block size changed (it is only known once the filesystem has
+        // queried the device), so write out anything pending using the old
+        // size and start again.
+        size_t block_size = self->block_size;
+        self->block_size = c->block_size;
+        blockdev_cache_flush(self, c);
+        self->block_size = block_size;
+    }
+    c = m_new_obj_maybe(mp_vfs_blockdev_cache_t);
+    uint8_t *data = m_new_maybe(uint8_t, MICROPY_VFS_BLOCKDEV_CACHE_BLOCKS * self->block_size);
+    #if MICROPY_VFS_BLOCKDEV_WRITEBACK_BLOCKS
+    uint8_t *wb_data = m_new_maybe(uint8_t, MICROPY_VFS_BLOCKDEV_WRITEBACK_BLOCKS * self->block_size);
+    if (wb_data == NULL) {
+        data = NULL;
+    }
+    #endif
+    if (c == NULL || data == NULL) {
+        // Not enough memory, carry on uncached
+        self->flags &= ~MP_BLOCKDEV_FLAG_CACHE;
+        self->cache = NULL;
+        return NULL;
+    }
+    memset(c, 0, sizeof(*c));
+    c->block_size = self->block_size;
+    c->data = data;
+    #if MICROPY_VFS_BLOCKDEV_WRITEBACK_BLOCKS
+    c->wb_data = wb_data;
+    #endif
+    self->cache = c;
+    return c;
+}
+
+STATIC void blockdev_cache_touch(mp_vfs_blockdev_cache_t *c, size_t i) {
+    if (++c->tick == 0) {
+        // Counter wrapped, age all entries equally
+        for (size_t j = 0; j < MICROPY_VFS_BLOCKDEV_CACHE_BLOCKS; ++j) {
+            if (c->used[j] != 0) {
+                c->used[j] = 1;
+            }
+        }
+        c->tick = 2;
+    }
+    c->used[i] = c->tick;
+}
+
+// Return the cached contents of the given block, or NULL if it's not cached.
+STATIC uint8_t *blockdev_cache_lookup(mp_vfs_blockdev_cache_t *c, size_t block_num) {
+    #if MICROPY_VFS_BLOCKDEV_WRITEBACK_BLOCKS
+    if (block_num - c->wb_start < c->wb_count) {
+        return c->wb_data + (block_num - c->wb_start) * c->block_size;
+    }
+    #endif
+    for (size_t i = 0; i < MICROPY_VFS_BLOCKDEV_CACHE_BLOCKS; ++i) {
+        if (c->used[i] != 0 && c->block_num[i] == block_num) {
+            blockdev_cache_touch(c, i);
+            return c->data + i * c->block_size;
+        }
+    }
+    return NULL;
+}
+
+// Read a block from the device into the least recently used slot.
+STATIC uint8_t *blockdev_cache_fill(mp_vfs_blockdev_t *self, mp_vfs_blockdev_cache_t *c, size_t block_num, bool ext, int *ret) {
+    size_t victim = 0;
+    for (size_t i = 1; i < MICROPY_VFS_BLOCKDEV_CACHE_BLOCKS; ++i) {
+        if (c->used[i] < c->used[victim]) {
+            victim = i;
+        }
+    }
+    // The slot stays empty unless the read succeeds
+    c->used[victim] = 0;
+    uint8_t *data = c->data + victim * c->block_size;
+    if (ext) {
+        *ret = blockdev_read_ext_raw(self, block_num, 0, c->block_size, data);
+    } else {
+        *ret = blockdev_read_raw(self, block_num, 1, data);
+    }
+    if (*ret != 0) {
+        return NULL;
+    }
+    c->block_num[victim] = block_num;
+    blockdev_cache_touch(c, victim);
+    return data;
+}
+
+// Drop a block which is about to be modified through the extended interface.
+STATIC int blockdev_cache_invalidate(mp_vfs_blockdev_t *self, mp_vfs_blockdev_cache_t *c, size_t block_num) {
+    #if MICROPY_VFS_BLOCKDEV_WRITEBACK_BLOCKS
+    if (block_num - c->wb_start < c->wb_count) {
+        int ret = blockdev_cache_flush(self, c);
+        if (ret != 0) {
+            return ret;
+        }
+    }
+    #else
+    (void)self;
+    #endif
+    for (size_t i = 0; i < MICROPY_VFS_BLOCKDEV_CACHE_BLOCKS; ++i) {
+        if (c->block_num[i] == block_num) {
+            c->used[i] = 0;
+        }
+    }
+    return 0;
+}
+
+#endif // MICROPY_VFS_BLOCKDEV_CACHE
+
+int mp_vfs_blockdev_read(mp_vfs_blockdev_t *self, size_t block_num, size_t num_blocks, uint8_t *buf) {
+    #if MICROPY_VFS_BLOCKDEV_CACHE
+    mp_vfs_blockdev_cache_t *c = blockdev_get_cache(self);
+    if (c != NULL) {
+        if (num_blocks == 1) {
+            // Single blocks are mostly filesystem metadata, which is read often
+            int ret = 0;
+            uint8_t *data = blockdev_cache_lookup(c, block_num);
+            if (data == NULL) {
+                data = blockdev_cache_fill(self, c, block_num, false, &ret);
+                if (data == NULL) {
+                    return ret;
+                }
+            }
+            memcpy(buf, data, c->block_size);
+            return 0;
+        }
+        // Larger reads are file data; read them directly so they don't evict
+        // metadata, then replace any blocks which have pending writes.
+        int ret = blockdev_read_raw(self, block_num, num_blocks, buf);
+        #if MICROPY_VFS_BLOCKDEV_WRITEBACK_BLOCKS
+        for (size_t i = 0; ret == 0 && i < c->wb_count; ++i) {
+            size_t n = c->wb_start + i - block_num;
+            if (n < num_blocks) {
+                memcpy(buf + n * c->block_size, c->wb_data + i * c->block_size, c->block_size);
+            }
+        }
+        #endif
+        return ret;
+    }
+    #endif
+    return blockdev_read_raw(self, block_num, num_blocks, buf);
+}
+
+int mp_vfs_blockdev_read_ext(mp_vfs_blockdev_t *self, size_t block_num, size_t block_off, size_t len, uint8_t *buf) {
+    #if MICROPY_VFS_BLOCKDEV_CACHE
+    mp_vfs_blockdev_cache_t *c = blockdev_get_cache(self);
+    if (c != NULL && block_off + len <= c->block_size) {
+        int ret = 0;
+        uint8_t *data = blockdev_cache_lookup(c, block_num);
+        if (data == NULL) {
+            data = blockdev_cache_fill(self, c, block_num, true, &ret);
+            if (data == NULL) {
+                return ret;
+            }
+        }
+        memcpy(buf, data + block_off, len);
+        return 0;
+    }
+    #endif
+    return blockdev_read_ext_raw(self, block_num, block_off, len, buf);
+}
+
+int mp_vfs_blockdev_write(mp_vfs_blockdev_t *self, size_t block_num, size_t num_blocks, const uint8_t *buf) {
+    if (self->writeblocks[0] == MP_OBJ_NULL) {
+        // read-only block device
+        return -MP_EROFS;
+    }
+
+    #if MICROPY_VFS_BLOCKDEV_CACHE
+    mp_vfs_blockdev_cache_t *c = blockdev_get_cache(self);
+    if (c != NULL) {
+        size_t bs = c->block_size;
+        // Keep cached copies up to date
+        for (size_t i = 0; i < MICROPY_VFS_BLOCKDEV_CACHE_BLOCKS; ++i) {
+            size_t n = c->block_num[i] - block_num;
+            if (c->used[i] != 0 && n < num_blocks) {
+                memcpy(c->data + i * bs, buf + n * bs, bs);
+            }
+        }
+        #if MICROPY_VFS_BLOCKDEV_WRITEBACK_BLOCKS
+        if (num_blocks <= MICROPY_VFS_BLOCKDEV_WRITEBACK_BLOCKS) {
+            if (c->wb_count != 0
+                && (block_num < c->wb_start || block_num > c->wb_start + c->wb_count
+                    || block_num + num_blocks > c->wb_start + MICROPY_VFS_BLOCKDEV_WRITEBACK_BLOCKS)) {
+                // Doesn't extend the pending run
+                int ret = blockdev_cache_flush(self, c);
+                if (ret != 0) {
+                    return ret;
+                }
+            }
+            if (c->wb_count == 0) {
+                c->wb_start = block_num;
+            }
+            memcpy(c->wb_data + (block_num - c->wb_start) * bs, buf, num_blocks * bs);
+            if (block_num + num_blocks - c->wb_start > c->wb_count) {
+                c->wb_count = block_num + num_blocks - c->wb_start;
+            }
+            if (c->wb_count == MICROPY_VFS_BLOCKDEV_WRITEBACK_BLOCKS) {
+                return blockdev_cache_flush(self, c);
+            }
+            return 0;
+        }
+        // Too large to hold back; write out the pending run first to keep order
+        int ret = blockdev_cache_flush(self, c);
+        if (ret != 0) {
+            return ret;
+        }
+        #endif
+    }
+    #endif
+
+    return blockdev_write_raw(self, block_num, num_blocks, buf);
+}
+
+int mp_vfs_blockdev_write_ext(mp_vfs_blockdev_t *self, size_t block_num, size_t block_off, size_t len, const uint8_t *buf) {
+    if (self->writeblocks[0] == MP_OBJ_NULL) {
+        // read-only block device
+        return -MP_EROFS;
+    }
+
+    #if MICROPY_VFS_BLOCKDEV_CACHE
+    // Partial writes program flash without erasing, so rather than guess the
+    // resulting contents just drop the block from the cache.
+    mp_vfs_blockdev_cache_t *c = blockdev_get_cache(self);
+    if (c != NULL) {
+        int ret = blockdev_cache_invalidate(self, c, block_num);
+        if (ret != 0) {
+            return ret;
+        }
+    }
+    #endif
+
+    return blockdev_write_ext_raw(self, block_num, block_off, len, buf);
+}
+
+int mp_vfs_blockdev_flush(mp_vfs_blockdev_t *self) {
+    #if MICROPY_VFS_BLOCKDEV_CACHE
+    if (self->cache != NULL && self->cache->block_size == self->block_size) {
+        return blockdev_cache_flush(self, self->cache);
+    }
+    #else
+    (void)self;
+    #endif
+    return 0;
+}
+
+#if MICROPY_VFS_MMAP
+const uint8_t *mp_vfs_blockdev_mmap(mp_vfs_blockdev_t *self, size_t block_num, size_t *num_blocks) {
+    if (!(self->flags & MP_BLOCKDEV_FLAG_PROTOCOL) || self->proto->mmap == NULL) {
+        return NULL;
+    }
+    // Pending writes must reach the device before it is read through memory
+    if (mp_vfs_blockdev_flush(self) != 0) {
+        return NULL;
+    }
+    uint32_t n = 0;
+    const uint8_t *addr = self->proto->mmap(self->readblocks[1], block_num, &n);
+    *num_blocks = n;
+    return addr;
+}
+#endif
+
 mp_obj_t mp_vfs_blockdev_ioctl(mp_vfs_blockdev_t *self, uintptr_t cmd, uintptr_t arg) {
+    #if MICROPY_VFS_BLOCKDEV_CACHE
+    if (self->cache != NULL) {
+        int ret = 0;
+        if (cmd == MP_BLOCKDEV_IOCTL_SYNC || cmd == MP_BLOCKDEV_IOCTL_DEINIT) {
+            ret = mp_vfs_blockdev_flush(self);
+        } else if (cmd == MP_BLOCKDEV_IOCTL_BLOCK_ERASE) {
+            ret = blockdev_cache_invalidate(self, self->cache, arg);
+        }
+        if (ret != 0) {
+            return MP_OBJ_NEW_SMALL_INT(ret);
+        }
+    }
+    #endif
+
     if (self->flags & MP_BLOCKDEV_FLAG_HAVE_IOCTL) {
         // New protocol with ioctl
         self->u.ioctl[2] = MP_OBJ_NEW_SMALL_INT(cmd);
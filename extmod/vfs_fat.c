@@ -71,7 +71,7 @@ STATIC mp_obj_t fat_vfs_make_new(const mp_obj_type_t *type, size_t n_args, size_
     vfs->fatfs.drv = vfs;
 
     // Initialise underlying block device
-    vfs->blockdev.flags = MP_BLOCKDEV_FLAG_FREE_OBJ;
+    vfs->blockdev.flags = MP_BLOCKDEV_FLAG_FREE_OBJ | MP_BLOCKDEV_FLAG_CACHE;
     vfs->blockdev.block_size = FF_MIN_SS; // default, will be populated by call to MP_BLOCKDEV_IOCTL_BLOCK_SIZE
     mp_vfs_blockdev_init(&vfs->blockdev, args[0]);
 
@@ -389,8 +389,10 @@ STATIC mp_obj_t vfs_fat_mount(mp_obj_t self_in, mp_obj_t readonly, mp_obj_t mkfs
 STATIC MP_DEFINE_CONST_FUN_OBJ_3(vfs_fat_mount_obj, vfs_fat_mount);
 
 STATIC mp_obj_t vfs_fat_umount(mp_obj_t self_in) {
-    (void)self_in;
-    // keep the FAT filesystem mounted internally so the VFS methods can still be used
+    fs_user_mount_t *self = MP_OBJ_TO_PTR(self_in);
+    // keep the FAT filesystem mounted internally so the VFS methods can still be used,
+    // but make sure all written blocks have reached the device
+    mp_vfs_blockdev_flush(&self->blockdev);
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(fat_vfs_umount_obj, vfs_fat_umount);
@@ -30,10 +30,23 @@
 #include "lib/oofatfs/ff.h"
 #include "extmod/vfs.h"
 
+#if MICROPY_VFS_FAT_READAHEAD_BLOCKS
+typedef struct _fs_readahead_t {
+    DWORD next; // sector following the last data read
+    DWORD start; // first sector held in data
+    size_t count; // number of valid sectors in data
+    size_t block_size;
+    uint8_t *data;
+} fs_readahead_t;
+#endif
+
 typedef struct _fs_user_mount_t {
     mp_obj_base_t base;
     mp_vfs_blockdev_t blockdev;
     FATFS fatfs;
+    #if MICROPY_VFS_FAT_READAHEAD_BLOCKS
+    fs_readahead_t readahead;
+    #endif
 } fs_user_mount_t;
 
 extern const byte fresult_to_errno_table[20];
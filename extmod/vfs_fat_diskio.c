@@ -32,6 +32,7 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "py/mphal.h"
 
@@ -48,6 +49,56 @@ STATIC fs_user_mount_t *disk_get_device(void *bdev) {
     return (fs_user_mount_t *)bdev;
 }
 
+#if MICROPY_VFS_FAT_READAHEAD_BLOCKS
+// Files read in small pieces produce a single-sector disk_read for each sector
+// in turn.  When such a read follows on from the previous data read, read the
+// following sectors as well, with one multi-block read into the read-ahead
+// buffer, and serve the next single-sector reads from there.
+STATIC int disk_read_ahead(fs_user_mount_t *vfs, BYTE *buff, DWORD sector) {
+    fs_readahead_t *ra = &vfs->readahead;
+    size_t bs = vfs->blockdev.block_size;
+    if (ra->data != NULL && ra->block_size != bs) {
+        ra->data = NULL;
+        ra->count = 0;
+    }
+    bool sequential = sector == ra->next;
+    ra->next = sector + 1;
+
+    if (sector - ra->start < ra->count) {
+        memcpy(buff, ra->data + (sector - ra->start) * bs, bs);
+        return 0;
+    }
+    if (!sequential) {
+        return mp_vfs_blockdev_read(&vfs->blockdev, sector, 1, buff);
+    }
+
+    if (ra->data == NULL) {
+        ra->data = m_new_maybe(uint8_t, MICROPY_VFS_FAT_READAHEAD_BLOCKS * bs);
+        if (ra->data == NULL) {
+            return mp_vfs_blockdev_read(&vfs->blockdev, sector, 1, buff);
+        }
+        ra->block_size = bs;
+    }
+
+    // Don't read past the end of the data area of the volume
+    FATFS *fs = &vfs->fatfs;
+    DWORD end = fs->database + (fs->n_fatent - 2) * fs->csize;
+    size_t n = MICROPY_VFS_FAT_READAHEAD_BLOCKS;
+    if (end - sector < n) {
+        n = end - sector;
+    }
+    ra->count = 0;
+    int ret = mp_vfs_blockdev_read(&vfs->blockdev, sector, n, ra->data);
+    if (ret != 0) {
+        return mp_vfs_blockdev_read(&vfs->blockdev, sector, 1, buff);
+    }
+    ra->start = sector;
+    ra->count = n;
+    memcpy(buff, ra->data, bs);
+    return 0;
+}
+#endif
+
 /*-----------------------------------------------------------------------*/
 /* Read Sector(s)                                                        */
 /*-----------------------------------------------------------------------*/
@@ -63,6 +114,19 @@ DRESULT disk_read(
         return RES_PARERR;
     }
 
+    #if MICROPY_VFS_FAT_READAHEAD_BLOCKS
+    // Only file data (and directories outside the root) is read ahead: the
+    // FAT is read in scattered single sectors and is cached by the block cache
+    FATFS *fs = &vfs->fatfs;
+    if (fs->fs_type != 0 && sector >= fs->database && sector < fs->database + (fs->n_fatent - 2) * fs->csize) {
+        if (count == 1) {
+            int ret = disk_read_ahead(vfs, buff, sector);
+            return ret == 0 ? RES_OK : RES_ERROR;
+        }
+        vfs->readahead.next = sector + count;
+    }
+    #endif
+
     int ret = mp_vfs_blockdev_read(&vfs->blockdev, sector, count, buff);
 
     return ret == 0 ? RES_OK : RES_ERROR;
@@ -83,6 +147,13 @@ DRESULT disk_write(
         return RES_PARERR;
     }
 
+    #if MICROPY_VFS_FAT_READAHEAD_BLOCKS
+    fs_readahead_t *ra = &vfs->readahead;
+    if (sector < ra->start + ra->count && sector + count > ra->start) {
+        ra->count = 0;
+    }
+    #endif
+
     int ret = mp_vfs_blockdev_write(&vfs->blockdev, sector, count, buff);
 
     if (ret == -MP_EROFS) {
@@ -117,6 +188,12 @@ DRESULT disk_ioctl(
     };
     uint8_t bp_op = op_map[cmd & 7];
     mp_obj_t ret = mp_const_none;
+    #if MICROPY_VFS_FAT_READAHEAD_BLOCKS
+    if (cmd == IOCTL_INIT) {
+        // The filesystem is being mounted, so start with no read-ahead data
+        memset(&vfs->readahead, 0, sizeof(vfs->readahead));
+    }
+    #endif
     if (bp_op != 0) {
         ret = mp_vfs_blockdev_ioctl(&vfs->blockdev, bp_op, 0);
     }
@@ -97,6 +97,75 @@ STATIC mp_uint_t file_obj_write(mp_obj_t self_in, const void *buf, mp_uint_t siz
 }
 
 
+#if MICROPY_VFS_MMAP
+// The range can be mapped if its clusters are consecutive on a block device
+// that is memory mapped.
+STATIC mp_uint_t file_obj_mmap(pyb_file_obj_t *self, struct mp_stream_mmap_t *m, int *errcode) {
+    FIL *fp = &self->fp;
+    FATFS *fs = fp->obj.fs;
+    if (fs == NULL) {
+        *errcode = MP_EBADF;
+        return MP_STREAM_ERROR;
+    }
+    fs_user_mount_t *vfs = fs->drv;
+
+    // Write out any pending data so the device contents are current
+    #if !FF_FS_READONLY
+    FRESULT res = f_sync(fp);
+    if (res != FR_OK) {
+        *errcode = fresult_to_errno_table[res];
+        return MP_STREAM_ERROR;
+    }
+    #endif
+
+    #if FF_MAX_SS == FF_MIN_SS
+    const FSIZE_t ss = FF_MAX_SS;
+    #else
+    const FSIZE_t ss = fs->ssize;
+    #endif
+    const FSIZE_t bcs = (FSIZE_t)fs->csize * ss;
+
+    // After a seek to one byte into a cluster fp->clust is that cluster
+    FSIZE_t fptr = f_tell(fp);
+    FSIZE_t first_ofs = m->offset / bcs * bcs;
+    DWORD first_clust = 0;
+    bool contiguous = true;
+    for (FSIZE_t ofs = first_ofs; ofs < m->offset + m->len; ofs += bcs) {
+        if (f_lseek(fp, ofs + 1) != FR_OK) {
+            contiguous = false;
+            break;
+        }
+        if (ofs == first_ofs) {
+            first_clust = fp->clust;
+        } else if (fp->clust != first_clust + (ofs - first_ofs) / bcs) {
+            contiguous = false;
+            break;
+        }
+    }
+    f_lseek(fp, fptr);
+
+    const uint8_t *addr = NULL;
+    if (contiguous) {
+        FSIZE_t off = m->offset - first_ofs;
+        DWORD sect = fs->database + (first_clust - 2) * fs->csize + off / ss;
+        size_t num_blocks = 0;
+        addr = mp_vfs_blockdev_mmap(&vfs->blockdev, sect, &num_blocks);
+        if (addr != NULL && num_blocks * ss < off % ss + m->len) {
+            addr = NULL;
+        }
+        if (addr != NULL) {
+            addr += off % ss;
+        }
+    }
+    if (addr == NULL) {
+        *errcode = MP_EOPNOTSUPP;
+        return MP_STREAM_ERROR;
+    }
+    m->addr = addr;
+    return 0;
+}
+#endif
+
 STATIC mp_obj_t file_obj___exit__(size_t n_args, const mp_obj_t *args) {
     (void)n_args;
     return mp_stream_close(args[0]);
@@ -145,6 +214,11 @@ STATIC mp_uint_t file_obj_ioctl(mp_obj_t o_in, mp_uint_t request, uintptr_t arg,
         }
         return 0;
 
+    #if MICROPY_VFS_MMAP
+    } else if (request == MP_STREAM_MMAP) {
+        return file_obj_mmap(self, (struct mp_stream_mmap_t *)arg, errcode);
+    #endif
+
     } else {
         *errcode = MP_EINVAL;
         return MP_STREAM_ERROR;
@@ -223,6 +297,9 @@ STATIC const mp_rom_map_elem_t vfs_fat_rawfile_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_read), MP_ROM_PTR(&mp_stream_read_obj) },
     { MP_ROM_QSTR(MP_QSTR_readinto), MP_ROM_PTR(&mp_stream_readinto_obj) },
     { MP_ROM_QSTR(MP_QSTR_readline), MP_ROM_PTR(&mp_stream_unbuffered_readline_obj) },
+#if MICROPY_STREAMS_READLINE_INTO
+    { MP_ROM_QSTR(MP_QSTR_readline_into), MP_ROM_PTR(&mp_stream_unbuffered_readline_into_obj) },
+#endif
     { MP_ROM_QSTR(MP_QSTR_readlines), MP_ROM_PTR(&mp_stream_unbuffered_readlines_obj) },
     { MP_ROM_QSTR(MP_QSTR_write), MP_ROM_PTR(&mp_stream_write_obj) },
     { MP_ROM_QSTR(MP_QSTR_flush), MP_ROM_PTR(&mp_stream_flush_obj) },
@@ -32,14 +32,25 @@
 
 #if MICROPY_VFS && (MICROPY_VFS_LFS1 || MICROPY_VFS_LFS2)
 
-enum { LFS_MAKE_ARG_bdev, LFS_MAKE_ARG_readsize, LFS_MAKE_ARG_progsize, LFS_MAKE_ARG_lookahead, LFS_MAKE_ARG_mtime };
+// Number of freed per-file cache buffers kept by each filesystem object for reuse.
+#define LFS_FILE_BUFFER_POOL_MAX (2)
+
+// Marker for a used-block count that must be recomputed by traversing the filesystem.
+#define LFS_USED_BLOCKS_UNKNOWN ((uint32_t)-1)
+
+enum { LFS_MAKE_ARG_bdev, LFS_MAKE_ARG_readsize, LFS_MAKE_ARG_progsize, LFS_MAKE_ARG_lookahead, LFS_MAKE_ARG_cachesize, LFS_MAKE_ARG_blockcycles, LFS_MAKE_ARG_mtime, LFS_MAKE_ARG_cache };
 
 static const mp_arg_t lfs_make_allowed_args[] = {
     { MP_QSTR_, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
     { MP_QSTR_readsize, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 32} },
     { MP_QSTR_progsize, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 32} },
     { MP_QSTR_lookahead, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 32} },
+    { MP_QSTR_cachesize, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 0} },
+    { MP_QSTR_blockcycles, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 100} },
     { MP_QSTR_mtime, MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = true} },
+    #if MICROPY_VFS_BLOCKDEV_CACHE
+    { MP_QSTR_cache, MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = false} },
+    #endif
 };
 
 #if MICROPY_VFS_LFS1
@@ -61,6 +72,9 @@ typedef struct _mp_obj_vfs_lfs1_t {
     vstr_t cur_dir;
     struct lfs1_config config;
     lfs1_t lfs;
+    uint32_t n_used_blocks;
+    uint8_t *file_buffer_pool;
+    size_t file_buffer_pool_len;
 } mp_obj_vfs_lfs1_t;
 
 typedef struct _mp_obj_vfs_lfs1_file_t {
@@ -68,7 +82,6 @@ typedef struct _mp_obj_vfs_lfs1_file_t {
     mp_obj_vfs_lfs1_t *vfs;
     lfs1_file_t file;
     struct lfs1_file_config cfg;
-    uint8_t file_buffer[0];
 } mp_obj_vfs_lfs1_file_t;
 
 const char *mp_vfs_lfs1_make_path(mp_obj_vfs_lfs1_t *self, mp_obj_t path_in);
@@ -111,6 +124,9 @@ typedef struct _mp_obj_vfs_lfs2_t {
     vstr_t cur_dir;
     struct lfs2_config config;
     lfs2_t lfs;
+    uint32_t n_used_blocks;
+    uint8_t *file_buffer_pool;
+    size_t file_buffer_pool_len;
 } mp_obj_vfs_lfs2_t;
 
 typedef struct _mp_obj_vfs_lfs2_file_t {
@@ -120,7 +136,6 @@ typedef struct _mp_obj_vfs_lfs2_file_t {
     lfs2_file_t file;
     struct lfs2_file_config cfg;
     struct lfs2_attr attrs[1];
-    uint8_t file_buffer[0];
 } mp_obj_vfs_lfs2_file_t;
 
 const char *mp_vfs_lfs2_make_path(mp_obj_vfs_lfs2_t *self, mp_obj_t path_in);
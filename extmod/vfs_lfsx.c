@@ -37,7 +37,8 @@
 #include "lib/timeutils/timeutils.h"
 
 STATIC int MP_VFS_LFSx(dev_ioctl)(const struct LFSx_API (config) * c, int cmd, int arg, bool must_return_int) {
-    mp_obj_t ret = mp_vfs_blockdev_ioctl(c->context, cmd, arg);
+    MP_OBJ_VFS_LFSx *self = c->context;
+    mp_obj_t ret = mp_vfs_blockdev_ioctl(&self->blockdev, cmd, arg);
     int ret_i = 0;
     if (must_return_int || ret != mp_const_none) {
         ret_i = mp_obj_get_int(ret);
@@ -46,14 +47,20 @@ STATIC int MP_VFS_LFSx(dev_ioctl)(const struct LFSx_API (config) * c, int cmd, i
 }
 
 STATIC int MP_VFS_LFSx(dev_read)(const struct LFSx_API (config) * c, LFSx_API(block_t) block, LFSx_API(off_t) off, void *buffer, LFSx_API(size_t) size) {
-    return mp_vfs_blockdev_read_ext(c->context, block, off, size, buffer);
+    MP_OBJ_VFS_LFSx *self = c->context;
+    return mp_vfs_blockdev_read_ext(&self->blockdev, block, off, size, buffer);
 }
 
 STATIC int MP_VFS_LFSx(dev_prog)(const struct LFSx_API (config) * c, LFSx_API(block_t) block, LFSx_API(off_t) off, const void *buffer, LFSx_API(size_t) size) {
-    return mp_vfs_blockdev_write_ext(c->context, block, off, size, buffer);
+    MP_OBJ_VFS_LFSx *self = c->context;
+    // any change to the device may change the number of blocks in use
+    self->n_used_blocks = LFS_USED_BLOCKS_UNKNOWN;
+    return mp_vfs_blockdev_write_ext(&self->blockdev, block, off, size, buffer);
 }
 
 STATIC int MP_VFS_LFSx(dev_erase)(const struct LFSx_API (config) * c, LFSx_API(block_t) block) {
+    MP_OBJ_VFS_LFSx *self = c->context;
+    self->n_used_blocks = LFS_USED_BLOCKS_UNKNOWN;
     return MP_VFS_LFSx(dev_ioctl)(c, MP_BLOCKDEV_IOCTL_BLOCK_ERASE, block, true);
 }
 
@@ -61,14 +68,37 @@ STATIC int MP_VFS_LFSx(dev_sync)(const struct LFSx_API (config) * c) {
     return MP_VFS_LFSx(dev_ioctl)(c, MP_BLOCKDEV_IOCTL_SYNC, 0, false);
 }
 
-STATIC void MP_VFS_LFSx(init_config)(MP_OBJ_VFS_LFSx * self, mp_obj_t bdev, size_t read_size, size_t prog_size, size_t lookahead) {
+STATIC void MP_VFS_LFSx(init_config)(MP_OBJ_VFS_LFSx * self, const mp_arg_val_t *args) {
+    size_t read_size = args[LFS_MAKE_ARG_readsize].u_int;
+    size_t prog_size = args[LFS_MAKE_ARG_progsize].u_int;
+    size_t lookahead = args[LFS_MAKE_ARG_lookahead].u_int;
+    #if LFS_BUILD_VERSION == 1
+    if (read_size == 0 || prog_size == 0 || lookahead == 0 || lookahead % 32 != 0) {
+        mp_raise_ValueError(NULL);
+    }
+    #else
+    mp_int_t cache_size = args[LFS_MAKE_ARG_cachesize].u_int;
+    mp_int_t block_cycles = args[LFS_MAKE_ARG_blockcycles].u_int;
+    if (cache_size == 0) {
+        cache_size = 4 * MAX(read_size, prog_size);
+    }
+    if (read_size == 0 || prog_size == 0 || cache_size < 0
+        || cache_size % read_size != 0 || cache_size % prog_size != 0
+        || lookahead == 0 || lookahead % 8 != 0 || block_cycles == 0) {
+        mp_raise_ValueError(NULL);
+    }
+    #endif
+
     self->blockdev.flags = MP_BLOCKDEV_FLAG_FREE_OBJ;
-    mp_vfs_blockdev_init(&self->blockdev, bdev);
+    mp_vfs_blockdev_init(&self->blockdev, args[LFS_MAKE_ARG_bdev].u_obj);
+    self->n_used_blocks = LFS_USED_BLOCKS_UNKNOWN;
+    self->file_buffer_pool = NULL;
+    self->file_buffer_pool_len = 0;
 
     struct LFSx_API (config) * config = &self->config;
     memset(config, 0, sizeof(*config));
 
-    config->context = &self->blockdev;
+    config->context = self;
 
     config->read = MP_VFS_LFSx(dev_read);
     config->prog = MP_VFS_LFSx(dev_prog);
@@ -91,8 +121,12 @@ STATIC void MP_VFS_LFSx(init_config)(MP_OBJ_VFS_LFSx * self, mp_obj_t bdev, size
     config->prog_buffer = m_new(uint8_t, config->prog_size);
     config->lookahead_buffer = m_new(uint8_t, config->lookahead / 8);
     #else
-    config->block_cycles = 100;
-    config->cache_size = 4 * MAX(read_size, prog_size);
+    if (args[LFS_MAKE_ARG_cachesize].u_int != 0 && bs % cache_size != 0) {
+        // an explicit cache size must divide the block size
+        mp_raise_ValueError(NULL);
+    }
+    config->block_cycles = block_cycles;
+    config->cache_size = cache_size;
     config->lookahead_size = lookahead;
     config->read_buffer = m_new(uint8_t, config->cache_size);
     config->prog_buffer = m_new(uint8_t, config->cache_size);
@@ -124,8 +158,13 @@ STATIC mp_obj_t MP_VFS_LFSx(make_new)(const mp_obj_type_t * type, size_t n_args,
     #if LFS_BUILD_VERSION == 2
     self->enable_mtime = args[LFS_MAKE_ARG_mtime].u_bool;
     #endif
-    MP_VFS_LFSx(init_config)(self, args[LFS_MAKE_ARG_bdev].u_obj,
-        args[LFS_MAKE_ARG_readsize].u_int, args[LFS_MAKE_ARG_progsize].u_int, args[LFS_MAKE_ARG_lookahead].u_int);
+    MP_VFS_LFSx(init_config)(self, args);
+    #if MICROPY_VFS_BLOCKDEV_CACHE
+    // littlefs has its own small read/prog caches, so the block cache is opt-in
+    if (args[LFS_MAKE_ARG_cache].u_bool) {
+        self->blockdev.flags |= MP_BLOCKDEV_FLAG_CACHE;
+    }
+    #endif
     int ret = LFSx_API(mount)(&self->lfs, &self->config);
     if (ret < 0) {
         mp_raise_OSError(-ret);
@@ -138,8 +177,7 @@ STATIC mp_obj_t MP_VFS_LFSx(mkfs)(size_t n_args, const mp_obj_t *pos_args, mp_ma
     mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(lfs_make_allowed_args), lfs_make_allowed_args, args);
 
     MP_OBJ_VFS_LFSx self;
-    MP_VFS_LFSx(init_config)(&self, args[LFS_MAKE_ARG_bdev].u_obj,
-        args[LFS_MAKE_ARG_readsize].u_int, args[LFS_MAKE_ARG_progsize].u_int, args[LFS_MAKE_ARG_lookahead].u_int);
+    MP_VFS_LFSx(init_config)(&self, args);
     int ret = LFSx_API(format)(&self.lfs, &self.config);
     if (ret < 0) {
         mp_raise_OSError(-ret);
@@ -396,14 +434,21 @@ STATIC int LFSx_API(traverse_cb)(void *data, LFSx_API(block_t) bl) {
 STATIC mp_obj_t MP_VFS_LFSx(statvfs)(mp_obj_t self_in, mp_obj_t path_in) {
     (void)path_in;
     MP_OBJ_VFS_LFSx *self = MP_OBJ_TO_PTR(self_in);
-    uint32_t n_used_blocks = 0;
-    #if LFS_BUILD_VERSION == 1
-    int ret = LFSx_API(traverse)(&self->lfs, LFSx_API(traverse_cb), &n_used_blocks);
-    #else
-    int ret = LFSx_API(fs_traverse)(&self->lfs, LFSx_API(traverse_cb), &n_used_blocks);
-    #endif
-    if (ret < 0) {
-        mp_raise_OSError(-ret);
+
+    // The count of used blocks is only recomputed if the device was written to
+    // since the last call, which avoids a full traversal of the filesystem.
+    uint32_t n_used_blocks = self->n_used_blocks;
+    if (n_used_blocks == LFS_USED_BLOCKS_UNKNOWN) {
+        n_used_blocks = 0;
+        #if LFS_BUILD_VERSION == 1
+        int ret = LFSx_API(traverse)(&self->lfs, LFSx_API(traverse_cb), &n_used_blocks);
+        #else
+        int ret = LFSx_API(fs_traverse)(&self->lfs, LFSx_API(traverse_cb), &n_used_blocks);
+        #endif
+        if (ret < 0) {
+            mp_raise_OSError(-ret);
+        }
+        self->n_used_blocks = n_used_blocks;
     }
 
     mp_obj_tuple_t *t = MP_OBJ_TO_PTR(mp_obj_new_tuple(10, NULL));
@@ -441,6 +486,9 @@ STATIC mp_obj_t MP_VFS_LFSx(umount)(mp_obj_t self_in) {
     MP_OBJ_VFS_LFSx *self = MP_OBJ_TO_PTR(self_in);
     // LFS unmount never fails
     LFSx_API(unmount)(&self->lfs);
+    mp_vfs_blockdev_flush(&self->blockdev);
+    self->file_buffer_pool = NULL;
+    self->file_buffer_pool_len = 0;
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(MP_VFS_LFSx(umount_obj), MP_VFS_LFSx(umount));
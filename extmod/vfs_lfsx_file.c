@@ -28,6 +28,7 @@
 #include <string.h>
 
 #include "py/runtime.h"
+#include "py/gc.h"
 #include "py/stream.h"
 #include "py/mperrno.h"
 #include "extmod/vfs.h"
@@ -38,6 +39,43 @@ STATIC void MP_VFS_LFSx(check_open)(MP_OBJ_VFS_LFSx_FILE * self) {
     }
 }
 
+STATIC size_t MP_VFS_LFSx(file_buffer_size)(MP_OBJ_VFS_LFSx * vfs) {
+    #if LFS_BUILD_VERSION == 1
+    size_t size = vfs->lfs.cfg->prog_size;
+    #else
+    size_t size = vfs->lfs.cfg->cache_size;
+    #endif
+    // freed buffers are linked together through their first word
+    return MAX(size, sizeof(uint8_t *));
+}
+
+// Take a per-file cache buffer from the pool, or allocate a new one.
+STATIC uint8_t *MP_VFS_LFSx(file_buffer_get)(MP_OBJ_VFS_LFSx * vfs) {
+    uint8_t *buf = vfs->file_buffer_pool;
+    if (buf == NULL) {
+        return m_new(uint8_t, MP_VFS_LFSx(file_buffer_size)(vfs));
+    }
+    vfs->file_buffer_pool = *(uint8_t **)buf;
+    --vfs->file_buffer_pool_len;
+    return buf;
+}
+
+// Return a per-file cache buffer to the pool, or free it if the pool is full.
+STATIC void MP_VFS_LFSx(file_buffer_put)(MP_OBJ_VFS_LFSx * vfs, uint8_t *buf) {
+    if (gc_is_locked()) {
+        // Called from a finaliser (or with the heap locked): the buffer may be
+        // swept in the same collection so it must not be kept.
+        return;
+    }
+    if (vfs->file_buffer_pool_len < LFS_FILE_BUFFER_POOL_MAX) {
+        *(uint8_t **)buf = vfs->file_buffer_pool;
+        vfs->file_buffer_pool = buf;
+        ++vfs->file_buffer_pool_len;
+    } else {
+        m_del(uint8_t, buf, MP_VFS_LFSx(file_buffer_size)(vfs));
+    }
+}
+
 STATIC void MP_VFS_LFSx(file_print)(const mp_print_t * print, mp_obj_t self_in, mp_print_kind_t kind) {
     (void)self_in;
     (void)kind;
@@ -88,18 +126,15 @@ mp_obj_t MP_VFS_LFSx(file_open)(mp_obj_t self_in, mp_obj_t path_in, mp_obj_t mod
         flags = LFSx_MACRO(_O_RDONLY);
     }
 
-    #if LFS_BUILD_VERSION == 1
-    MP_OBJ_VFS_LFSx_FILE *o = m_new_obj_var_with_finaliser(MP_OBJ_VFS_LFSx_FILE, uint8_t, self->lfs.cfg->prog_size);
-    #else
-    MP_OBJ_VFS_LFSx_FILE *o = m_new_obj_var_with_finaliser(MP_OBJ_VFS_LFSx_FILE, uint8_t, self->lfs.cfg->cache_size);
-    #endif
+    MP_OBJ_VFS_LFSx_FILE *o = m_new_obj_with_finaliser(MP_OBJ_VFS_LFSx_FILE);
     o->base.type = type;
-    o->vfs = self;
+    o->vfs = NULL;
     #if !MICROPY_GC_CONSERVATIVE_CLEAR
     memset(&o->file, 0, sizeof(o->file));
     memset(&o->cfg, 0, sizeof(o->cfg));
     #endif
-    o->cfg.buffer = &o->file_buffer[0];
+    o->cfg.buffer = MP_VFS_LFSx(file_buffer_get)(self);
+    o->vfs = self;
 
     #if LFS_BUILD_VERSION == 2
     if (self->enable_mtime) {
@@ -116,6 +151,8 @@ mp_obj_t MP_VFS_LFSx(file_open)(mp_obj_t self_in, mp_obj_t path_in, mp_obj_t mod
     int ret = LFSx_API(file_opencfg)(&self->lfs, &o->file, path, flags, &o->cfg);
     if (ret < 0) {
         o->vfs = NULL;
+        MP_VFS_LFSx(file_buffer_put)(self, o->cfg.buffer);
+        o->cfg.buffer = NULL;
         mp_raise_OSError(-ret);
     }
 
@@ -188,6 +225,8 @@ STATIC mp_uint_t MP_VFS_LFSx(file_ioctl)(mp_obj_t self_in, mp_uint_t request, ui
             return 0;
         }
         int res = LFSx_API(file_close)(&self->vfs->lfs, &self->file);
+        MP_VFS_LFSx(file_buffer_put)(self->vfs, self->cfg.buffer);
+        self->cfg.buffer = NULL;
         self->vfs = NULL; // indicate a closed file
         if (res < 0) {
             *errcode = -res;
@@ -204,6 +243,9 @@ STATIC const mp_rom_map_elem_t MP_VFS_LFSx(file_locals_dict_table)[] = {
     { MP_ROM_QSTR(MP_QSTR_read), MP_ROM_PTR(&mp_stream_read_obj) },
     { MP_ROM_QSTR(MP_QSTR_readinto), MP_ROM_PTR(&mp_stream_readinto_obj) },
     { MP_ROM_QSTR(MP_QSTR_readline), MP_ROM_PTR(&mp_stream_unbuffered_readline_obj) },
+#if MICROPY_STREAMS_READLINE_INTO
+    { MP_ROM_QSTR(MP_QSTR_readline_into), MP_ROM_PTR(&mp_stream_unbuffered_readline_into_obj) },
+#endif
     { MP_ROM_QSTR(MP_QSTR_readlines), MP_ROM_PTR(&mp_stream_unbuffered_readlines_obj) },
     { MP_ROM_QSTR(MP_QSTR_write), MP_ROM_PTR(&mp_stream_write_obj) },
     { MP_ROM_QSTR(MP_QSTR_flush), MP_ROM_PTR(&mp_stream_flush_obj) },
@@ -0,0 +1,304 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "py/runtime.h"
+#include "py/stream.h"
+#include "py/mperrno.h"
+#include "extmod/vfs.h"
+
+#if MICROPY_VFS_MMAP
+
+// A read-only view of part of a file or block device.  If the underlying
+// object can map the range into memory then the bytes are accessed in place.
+// Otherwise single items and small slices are read through a window of
+// MICROPY_VFS_MMAP_WINDOW bytes, and the whole range is only read into RAM
+// if the buffer protocol is used.
+
+typedef struct _mp_obj_vfs_mmap_t {
+    mp_obj_base_t base;
+    mp_obj_t obj; // file or block device, MP_OBJ_NULL once closed
+    const byte *data; // the whole range, mapped or read into RAM, or NULL
+    bool mapped;
+    mp_off_t offset;
+    size_t len;
+    struct mp_stream_mmap_t map;
+    byte *win;
+    size_t win_off; // relative to offset
+    size_t win_len;
+} mp_obj_vfs_mmap_t;
+
+STATIC const mp_obj_type_t mp_type_vfs_mmap;
+
+STATIC mp_off_t vfs_mmap_seek(mp_obj_t obj, mp_off_t offset, int whence) {
+    const mp_stream_p_t *stream_p = mp_get_stream(obj);
+    struct mp_stream_seek_t seek = { .offset = offset, .whence = whence };
+    int errcode;
+    if (stream_p->ioctl(obj, MP_STREAM_SEEK, (uintptr_t)&seek, &errcode) == MP_STREAM_ERROR) {
+        mp_raise_OSError(errcode);
+    }
+    return seek.offset;
+}
+
+// Read part of the range from the file, leaving the file position unchanged.
+STATIC void vfs_mmap_read(mp_obj_vfs_mmap_t *self, size_t index, byte *buf, size_t len) {
+    mp_off_t pos = vfs_mmap_seek(self->obj, 0, MP_SEEK_CUR);
+    vfs_mmap_seek(self->obj, self->offset + index, MP_SEEK_SET);
+    int errcode;
+    mp_uint_t n = mp_stream_rw(self->obj, buf, len, &errcode, MP_STREAM_RW_READ);
+    vfs_mmap_seek(self->obj, pos, MP_SEEK_SET);
+    if (errcode != 0) {
+        mp_raise_OSError(errcode);
+    }
+    if (n != len) {
+        // the file was truncated since it was mapped
+        mp_raise_OSError(MP_EIO);
+    }
+}
+
+STATIC mp_obj_vfs_mmap_t *vfs_mmap_get(mp_obj_t self_in) {
+    mp_obj_vfs_mmap_t *self = MP_OBJ_TO_PTR(self_in);
+    if (self->obj == MP_OBJ_NULL) {
+        mp_raise_ValueError(MP_ERROR_TEXT("mmap closed"));
+    }
+    return self;
+}
+
+// Return a pointer to index..index+len-1 of the range, going through the
+// window, or NULL if that doesn't fit in a window.
+STATIC const byte *vfs_mmap_window(mp_obj_vfs_mmap_t *self, size_t index, size_t len) {
+    if (self->data != NULL) {
+        return self->data + index;
+    }
+    if (index < self->win_off || index - self->win_off + len > self->win_len) {
+        size_t win_off = index & ~(size_t)(MICROPY_VFS_MMAP_WINDOW - 1);
+        if (index + len > win_off + MICROPY_VFS_MMAP_WINDOW) {
+            return NULL;
+        }
+        if (self->win == NULL) {
+            self->win = m_new(byte, MICROPY_VFS_MMAP_WINDOW);
+        }
+        self->win_len = 0;
+        size_t win_len = MIN(MICROPY_VFS_MMAP_WINDOW, self->len - win_off);
+        vfs_mmap_read(self, win_off, self->win, win_len);
+        self->win_off = win_off;
+        self->win_len = win_len;
+    }
+    return self->win + index - self->win_off;
+}
+
+STATIC void vfs_mmap_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
+    (void)kind;
+    mp_obj_vfs_mmap_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_printf(print, "<mmap len=%u %s>", (uint)self->len,
+        self->obj == MP_OBJ_NULL ? "closed" : self->mapped ? "mapped" : "buffered");
+}
+
+STATIC mp_obj_t vfs_mmap_unary_op(mp_unary_op_t op, mp_obj_t self_in) {
+    mp_obj_vfs_mmap_t *self = MP_OBJ_TO_PTR(self_in);
+    switch (op) {
+        case MP_UNARY_OP_BOOL:
+            return mp_obj_new_bool(self->len != 0);
+        case MP_UNARY_OP_LEN:
+            return MP_OBJ_NEW_SMALL_INT(self->len);
+        default:
+            return MP_OBJ_NULL; // op not supported
+    }
+}
+
+STATIC mp_obj_t vfs_mmap_subscr(mp_obj_t self_in, mp_obj_t index, mp_obj_t value) {
+    if (value != MP_OBJ_SENTINEL) {
+        // delete and store are not supported
+        return MP_OBJ_NULL;
+    }
+    mp_obj_vfs_mmap_t *self = vfs_mmap_get(self_in);
+    #if MICROPY_PY_BUILTINS_SLICE
+    if (mp_obj_is_type(index, &mp_type_slice)) {
+        mp_bound_slice_t slice;
+        if (!mp_seq_get_fast_slice_indexes(self->len, index, &slice)) {
+            mp_raise_NotImplementedError(MP_ERROR_TEXT("only slices with step=1 (aka None) are supported"));
+        }
+        size_t start = slice.start;
+        size_t len = slice.stop > slice.start ? slice.stop - slice.start : 0;
+        if (len == 0) {
+            return mp_const_empty_bytes;
+        }
+        const byte *p = vfs_mmap_window(self, start, len);
+        if (p != NULL) {
+            return mp_obj_new_bytes(p, len);
+        }
+        vstr_t vstr;
+        vstr_init_len(&vstr, len);
+        vfs_mmap_read(self, start, (byte *)vstr.buf, len);
+        return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
+    }
+    #endif
+    size_t i = mp_get_index(self->base.type, self->len, index, false);
+    return MP_OBJ_NEW_SMALL_INT(*vfs_mmap_window(self, i, 1));
+}
+
+STATIC mp_int_t vfs_mmap_get_buffer(mp_obj_t self_in, mp_buffer_info_t *bufinfo, mp_uint_t flags) {
+    mp_obj_vfs_mmap_t *self = MP_OBJ_TO_PTR(self_in);
+    if ((flags & MP_BUFFER_WRITE) || self->obj == MP_OBJ_NULL) {
+        return 1;
+    }
+    if (self->data == NULL && self->len > 0) {
+        // Not mapped, so read the whole range into RAM once
+        byte *buf = m_new(byte, self->len);
+        vfs_mmap_read(self, 0, buf, self->len);
+        self->data = buf;
+        if (self->win != NULL) {
+            m_del(byte, self->win, MICROPY_VFS_MMAP_WINDOW);
+            self->win = NULL;
+        }
+    }
+    bufinfo->buf = (void *)self->data;
+    bufinfo->len = self->len;
+    bufinfo->typecode = 'B';
+    return 0;
+}
+
+STATIC mp_obj_t vfs_mmap_close(mp_obj_t self_in) {
+    mp_obj_vfs_mmap_t *self = MP_OBJ_TO_PTR(self_in);
+    if (self->obj == MP_OBJ_NULL) {
+        return mp_const_none;
+    }
+    if (self->map.map_base != NULL) {
+        const mp_stream_p_t *stream_p = mp_get_stream(self->obj);
+        int errcode;
+        stream_p->ioctl(self->obj, MP_STREAM_MUNMAP, (uintptr_t)&self->map, &errcode);
+        self->map.map_base = NULL;
+    }
+    self->obj = MP_OBJ_NULL;
+    self->data = NULL;
+    self->win = NULL;
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(vfs_mmap_close_obj, vfs_mmap_close);
+
+STATIC mp_obj_t vfs_mmap___exit__(size_t n_args, const mp_obj_t *args) {
+    (void)n_args;
+    return vfs_mmap_close(args[0]);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(vfs_mmap___exit___obj, 4, 4, vfs_mmap___exit__);
+
+STATIC const mp_rom_map_elem_t vfs_mmap_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_close), MP_ROM_PTR(&vfs_mmap_close_obj) },
+    { MP_ROM_QSTR(MP_QSTR___enter__), MP_ROM_PTR(&mp_identity_obj) },
+    { MP_ROM_QSTR(MP_QSTR___exit__), MP_ROM_PTR(&vfs_mmap___exit___obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(vfs_mmap_locals_dict, vfs_mmap_locals_dict_table);
+
+STATIC const mp_obj_type_t mp_type_vfs_mmap = {
+    { &mp_type_type },
+    .name = MP_QSTR_mmap,
+    .print = vfs_mmap_print,
+    .unary_op = vfs_mmap_unary_op,
+    .subscr = vfs_mmap_subscr,
+    .buffer_p = { .get_buffer = vfs_mmap_get_buffer },
+    .locals_dict = (mp_obj_dict_t *)&vfs_mmap_locals_dict,
+};
+
+STATIC size_t vfs_mmap_get_range(mp_uint_t size, size_t n_args, const mp_obj_t *args, mp_off_t *offset) {
+    mp_int_t len = n_args > 1 ? mp_obj_get_int(args[1]) : 0;
+    mp_int_t off = n_args > 2 ? mp_obj_get_int(args[2]) : 0;
+    if (len < 0 || off < 0 || (mp_uint_t)off > size) {
+        mp_raise_ValueError(NULL);
+    }
+    if (len == 0) {
+        len = size - off;
+    } else if ((mp_uint_t)len > size - off) {
+        mp_raise_ValueError(MP_ERROR_TEXT("mmap length is greater than file size"));
+    }
+    *offset = off;
+    return len;
+}
+
+#if MICROPY_VFS
+STATIC mp_uint_t vfs_mmap_bdev_ioctl_int(mp_vfs_blockdev_t *bdev, uintptr_t cmd, mp_uint_t dflt) {
+    mp_obj_t ret = mp_vfs_blockdev_ioctl(bdev, cmd, 0);
+    if (ret == mp_const_none) {
+        return dflt;
+    }
+    return mp_obj_get_int(ret);
+}
+#endif
+
+STATIC mp_obj_t mp_vfs_mmap(size_t n_args, const mp_obj_t *args) {
+    mp_obj_t obj = args[0];
+    mp_obj_vfs_mmap_t *self = m_new_obj(mp_obj_vfs_mmap_t);
+    memset(self, 0, sizeof(*self));
+    self->base.type = &mp_type_vfs_mmap;
+
+    #if MICROPY_VFS
+    mp_obj_t dest[2];
+    mp_load_method_maybe(obj, MP_QSTR_readblocks, dest);
+    if (dest[0] != MP_OBJ_NULL) {
+        // A block device, which can only be used if it's memory mapped
+        mp_vfs_blockdev_t bdev;
+        bdev.flags = 0;
+        mp_vfs_blockdev_init(&bdev, obj);
+        mp_uint_t block_size = vfs_mmap_bdev_ioctl_int(&bdev, MP_BLOCKDEV_IOCTL_BLOCK_SIZE, 512);
+        mp_uint_t block_count = vfs_mmap_bdev_ioctl_int(&bdev, MP_BLOCKDEV_IOCTL_BLOCK_COUNT, 0);
+        self->len = vfs_mmap_get_range(block_size * block_count, n_args, args, &self->offset);
+        if (self->len > 0) {
+            size_t block_num = self->offset / block_size;
+            size_t block_off = self->offset % block_size;
+            size_t num_blocks = 0;
+            const uint8_t *addr = mp_vfs_blockdev_mmap(&bdev, block_num, &num_blocks);
+            if (addr == NULL || num_blocks * block_size < block_off + self->len) {
+                mp_raise_OSError(MP_EOPNOTSUPP);
+            }
+            self->data = addr + block_off;
+        }
+        self->mapped = true;
+    } else
+    #endif
+    {
+        // A file, which may be able to map the range itself
+        const mp_stream_p_t *stream_p = mp_get_stream_raise(obj, MP_STREAM_OP_READ | MP_STREAM_OP_IOCTL);
+        mp_off_t pos = vfs_mmap_seek(obj, 0, MP_SEEK_CUR);
+        mp_off_t size = vfs_mmap_seek(obj, 0, MP_SEEK_END);
+        vfs_mmap_seek(obj, pos, MP_SEEK_SET);
+        self->len = vfs_mmap_get_range(size, n_args, args, &self->offset);
+        if (self->len > 0) {
+            self->map.offset = self->offset;
+            self->map.len = self->len;
+            int errcode;
+            if (stream_p->ioctl(obj, MP_STREAM_MMAP, (uintptr_t)&self->map, &errcode) != MP_STREAM_ERROR) {
+                self->data = self->map.addr;
+                self->mapped = true;
+            }
+        }
+    }
+
+    self->obj = obj;
+    return MP_OBJ_FROM_PTR(self);
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp_vfs_mmap_obj, 1, 3, mp_vfs_mmap);
+
+#endif // MICROPY_VFS_MMAP
@@ -35,6 +35,13 @@
 #include <fcntl.h>
 #include <unistd.h>
 
+#if MICROPY_VFS_MMAP && !defined(_WIN32)
+#include <sys/mman.h>
+#define VFS_POSIX_FILE_MMAP (1)
+#else
+#define VFS_POSIX_FILE_MMAP (0)
+#endif
+
 #ifdef _WIN32
 #define fsync _commit
 #endif
@@ -164,7 +171,7 @@ STATIC mp_uint_t vfs_posix_file_write(mp_obj_t o_in, const void *buf, mp_uint_t
 STATIC mp_uint_t vfs_posix_file_ioctl(mp_obj_t o_in, mp_uint_t request, uintptr_t arg, int *errcode) {
     mp_obj_vfs_posix_file_t *o = MP_OBJ_TO_PTR(o_in);
 
-    if (request != MP_STREAM_CLOSE) {
+    if (request != MP_STREAM_CLOSE && request != MP_STREAM_MUNMAP) {
         check_fd_is_open(o);
     }
 
@@ -206,6 +213,29 @@ STATIC mp_uint_t vfs_posix_file_ioctl(mp_obj_t o_in, mp_uint_t request, uintptr_
             return 0;
         case MP_STREAM_GET_FILENO:
             return o->fd;
+        #if VFS_POSIX_FILE_MMAP
+        case MP_STREAM_MMAP: {
+            struct mp_stream_mmap_t *m = (struct mp_stream_mmap_t *)arg;
+            // The mapping must start on a page boundary
+            off_t base_off = m->offset & ~(off_t)(sysconf(_SC_PAGESIZE) - 1);
+            size_t map_len = m->len + (m->offset - base_off);
+            void *base = mmap(NULL, map_len, PROT_READ, MAP_SHARED, o->fd, base_off);
+            if (base == MAP_FAILED) {
+                *errcode = errno;
+                return MP_STREAM_ERROR;
+            }
+            m->addr = (const byte *)base + (m->offset - base_off);
+            m->map_base = base;
+            m->map_len = map_len;
+            return 0;
+        }
+        case MP_STREAM_MUNMAP: {
+            // The mapping stays valid if the file was closed in the meantime
+            struct mp_stream_mmap_t *m = (struct mp_stream_mmap_t *)arg;
+            munmap(m->map_base, m->map_len);
+            return 0;
+        }
+        #endif
         default:
             *errcode = EINVAL;
             return MP_STREAM_ERROR;
@@ -217,6 +247,9 @@ STATIC const mp_rom_map_elem_t vfs_posix_rawfile_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_read), MP_ROM_PTR(&mp_stream_read_obj) },
     { MP_ROM_QSTR(MP_QSTR_readinto), MP_ROM_PTR(&mp_stream_readinto_obj) },
     { MP_ROM_QSTR(MP_QSTR_readline), MP_ROM_PTR(&mp_stream_unbuffered_readline_obj) },
+#if MICROPY_STREAMS_READLINE_INTO
+    { MP_ROM_QSTR(MP_QSTR_readline_into), MP_ROM_PTR(&mp_stream_unbuffered_readline_into_obj) },
+#endif
     { MP_ROM_QSTR(MP_QSTR_readlines), MP_ROM_PTR(&mp_stream_unbuffered_readlines_obj) },
     { MP_ROM_QSTR(MP_QSTR_write), MP_ROM_PTR(&mp_stream_write_obj) },
     { MP_ROM_QSTR(MP_QSTR_seek), MP_ROM_PTR(&mp_stream_seek_obj) },
@@ -41,41 +41,65 @@ typedef struct _mp_reader_vfs_t {
     byte buf[24];
 } mp_reader_vfs_t;
 
-STATIC mp_uint_t mp_reader_vfs_readbyte(void *data) {
-    mp_reader_vfs_t *reader = (mp_reader_vfs_t *)data;
+// Returns false at the end of the file.
+STATIC bool mp_reader_vfs_fill(mp_reader_vfs_t *reader) {
     if (reader->pos >= reader->len) {
         if (reader->len < sizeof(reader->buf)) {
-            return MP_READER_EOF;
+            return false;
         } else {
             int errcode;
             reader->len = mp_stream_rw(reader->file, reader->buf, sizeof(reader->buf),
                 &errcode, MP_STREAM_RW_READ | MP_STREAM_RW_ONCE);
             if (errcode != 0) {
                 // TODO handle errors properly
-                return MP_READER_EOF;
+                return false;
             }
             if (reader->len == 0) {
-                return MP_READER_EOF;
+                return false;
             }
             reader->pos = 0;
         }
     }
+    return true;
+}
+
+STATIC mp_uint_t mp_reader_vfs_readbyte(void *data) {
+    mp_reader_vfs_t *reader = (mp_reader_vfs_t *)data;
+    if (!mp_reader_vfs_fill(reader)) {
+        return MP_READER_EOF;
+    }
     return reader->buf[reader->pos++];
 }
 
+STATIC size_t mp_reader_vfs_readblock(void *data, const byte **buf) {
+    mp_reader_vfs_t *reader = (mp_reader_vfs_t *)data;
+    if (!mp_reader_vfs_fill(reader)) {
+        return 0;
+    }
+    size_t len = reader->len - reader->pos;
+    *buf = reader->buf + reader->pos;
+    // keep len so a short read is still seen as the end of the file
+    reader->pos = reader->len;
+    return len;
+}
+
 STATIC void mp_reader_vfs_close(void *data) {
     mp_reader_vfs_t *reader = (mp_reader_vfs_t *)data;
     mp_stream_close(reader->file);
     m_del_obj(mp_reader_vfs_t, reader);
 }
 
-void mp_reader_new_file(mp_reader_t *reader, const char *filename) {
-    mp_reader_vfs_t *rf = m_new_obj(mp_reader_vfs_t);
+STATIC mp_obj_t mp_reader_vfs_open(const char *filename) {
     mp_obj_t args[2] = {
         mp_obj_new_str(filename, strlen(filename)),
         MP_OBJ_NEW_QSTR(MP_QSTR_rb),
     };
-    rf->file = mp_vfs_open(MP_ARRAY_SIZE(args), &args[0], (mp_map_t *)&mp_const_empty_map);
+    return mp_vfs_open(MP_ARRAY_SIZE(args), &args[0], (mp_map_t *)&mp_const_empty_map);
+}
+
+STATIC void mp_reader_vfs_init(mp_reader_t *reader, mp_obj_t file) {
+    mp_reader_vfs_t *rf = m_new_obj(mp_reader_vfs_t);
+    rf->file = file;
     int errcode;
     rf->len = mp_stream_rw(rf->file, rf->buf, sizeof(rf->buf), &errcode, MP_STREAM_RW_READ | MP_STREAM_RW_ONCE);
     if (errcode != 0) {
@@ -85,6 +109,44 @@ void mp_reader_new_file(mp_reader_t *reader, const char *filename) {
     reader->data = rf;
     reader->readbyte = mp_reader_vfs_readbyte;
     reader->close = mp_reader_vfs_close;
+    reader->readblock = mp_reader_vfs_readblock;
 }
 
+void mp_reader_new_file(mp_reader_t *reader, const char *filename) {
+    mp_reader_vfs_init(reader, mp_reader_vfs_open(filename));
+}
+
+#if MICROPY_PERSISTENT_CODE_LOAD_MAPPED && MICROPY_VFS_MMAP
+
+// Like mp_reader_new_file, but if the whole file can be mapped into memory
+// then reader reads from there and true is returned.  The mapping is never
+// released, so the bytes that reader gives stay for good, and each call
+// makes a new one.
+bool mp_reader_new_file_mapped(mp_reader_t *reader, const char *filename) {
+    mp_obj_t file = mp_reader_vfs_open(filename);
+    const mp_stream_p_t *stream_p = mp_get_stream(file);
+    struct mp_stream_seek_t seek = { .offset = 0, .whence = MP_SEEK_END };
+    struct mp_stream_mmap_t map = { .offset = 0, .addr = NULL };
+    int errcode;
+    if (stream_p->ioctl(file, MP_STREAM_SEEK, (uintptr_t)&seek, &errcode) != MP_STREAM_ERROR
+        && seek.offset > 0) {
+        map.len = seek.offset;
+        if (stream_p->ioctl(file, MP_STREAM_MMAP, (uintptr_t)&map, &errcode) == MP_STREAM_ERROR) {
+            map.addr = NULL;
+        }
+        seek.offset = 0;
+        seek.whence = MP_SEEK_SET;
+        stream_p->ioctl(file, MP_STREAM_SEEK, (uintptr_t)&seek, &errcode);
+    }
+    if (map.addr == NULL) {
+        mp_reader_vfs_init(reader, file);
+        return false;
+    }
+    mp_stream_close(file);
+    mp_reader_new_mem(reader, map.addr, map.len, 0);
+    return true;
+}
+
+#endif
+
 #endif // MICROPY_READER_VFS
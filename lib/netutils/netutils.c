@@ -92,3 +92,94 @@ mp_uint_t netutils_parse_inet_addr(mp_obj_t addr_in, uint8_t *out_ip, netutils_e
     netutils_parse_ipv4_addr(addr_items[0], out_ip, endian);
     return mp_obj_get_int(addr_items[1]);
 }
+
+#if MICROPY_PY_USOCKET_DNS_CACHE
+
+#include "py/mphal.h"
+
+#define DNS_CACHE_HOST_MAX (48)
+
+typedef struct _netutils_dns_cache_entry_t {
+    mp_uint_t expiry_ms; // ticks at which the entry expires
+    uint8_t ip[NETUTILS_IPV4ADDR_BUFSIZE];
+    char host[DNS_CACHE_HOST_MAX]; // empty if the entry is unused
+} netutils_dns_cache_entry_t;
+
+STATIC netutils_dns_cache_entry_t netutils_dns_cache[MICROPY_PY_USOCKET_DNS_CACHE_SIZE];
+
+// Returns the time left before the entry expires, or 0 if it is unused or expired
+STATIC mp_uint_t netutils_dns_cache_ttl(netutils_dns_cache_entry_t *e) {
+    if (e->host[0] == '\0') {
+        return 0;
+    }
+    mp_int_t ttl = (mp_int_t)(e->expiry_ms - mp_hal_ticks_ms());
+    if (ttl <= 0) {
+        e->host[0] = '\0';
+        return 0;
+    }
+    return ttl;
+}
+
+bool netutils_dns_cache_lookup(const char *host, uint8_t *out_ip) {
+    for (size_t i = 0; i < MICROPY_PY_USOCKET_DNS_CACHE_SIZE; ++i) {
+        netutils_dns_cache_entry_t *e = &netutils_dns_cache[i];
+        if (strcmp(e->host, host) == 0 && netutils_dns_cache_ttl(e) > 0) {
+            memcpy(out_ip, e->ip, NETUTILS_IPV4ADDR_BUFSIZE);
+            return true;
+        }
+    }
+    return false;
+}
+
+void netutils_dns_cache_add(const char *host, const uint8_t *ip) {
+    size_t len = strlen(host);
+    if (len == 0 || len >= DNS_CACHE_HOST_MAX) {
+        return;
+    }
+    // Reuse the entry of the host, or an unused one, or else the one that
+    // expires first
+    netutils_dns_cache_entry_t *entry = &netutils_dns_cache[0];
+    mp_uint_t entry_ttl = (mp_uint_t)-1;
+    for (size_t i = 0; i < MICROPY_PY_USOCKET_DNS_CACHE_SIZE; ++i) {
+        netutils_dns_cache_entry_t *e = &netutils_dns_cache[i];
+        mp_uint_t ttl = netutils_dns_cache_ttl(e);
+        if (strcmp(e->host, host) == 0) {
+            entry = e;
+            break;
+        }
+        if (ttl < entry_ttl) {
+            entry = e;
+            entry_ttl = ttl;
+        }
+    }
+    entry->expiry_ms = mp_hal_ticks_ms() + MICROPY_PY_USOCKET_DNS_CACHE_TTL_MS;
+    memcpy(entry->ip, ip, NETUTILS_IPV4ADDR_BUFSIZE);
+    memcpy(entry->host, host, len + 1);
+}
+
+// Returns a list of (host, ip, ttl_ms) for the cached hosts
+STATIC mp_obj_t netutils_dns_cache_info(void) {
+    mp_obj_t list = mp_obj_new_list(0, NULL);
+    for (size_t i = 0; i < MICROPY_PY_USOCKET_DNS_CACHE_SIZE; ++i) {
+        netutils_dns_cache_entry_t *e = &netutils_dns_cache[i];
+        mp_uint_t ttl = netutils_dns_cache_ttl(e);
+        if (ttl > 0) {
+            mp_obj_t tuple[3] = {
+                mp_obj_new_str(e->host, strlen(e->host)),
+                netutils_format_ipv4_addr(e->ip, NETUTILS_BIG),
+                mp_obj_new_int_from_uint(ttl),
+            };
+            mp_obj_list_append(list, mp_obj_new_tuple(3, tuple));
+        }
+    }
+    return list;
+}
+MP_DEFINE_CONST_FUN_OBJ_0(netutils_dns_cache_info_obj, netutils_dns_cache_info);
+
+STATIC mp_obj_t netutils_dns_cache_flush(void) {
+    memset(netutils_dns_cache, 0, sizeof(netutils_dns_cache));
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_0(netutils_dns_cache_flush_obj, netutils_dns_cache_flush);
+
+#endif // MICROPY_PY_USOCKET_DNS_CACHE
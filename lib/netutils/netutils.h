@@ -53,4 +53,13 @@ mp_uint_t netutils_parse_inet_addr(mp_obj_t addr_in, uint8_t *out_ip, netutils_e
 
 void netutils_ethernet_trace(const mp_print_t *print, size_t len, const uint8_t *buf, unsigned int flags);
 
+#if MICROPY_PY_USOCKET_DNS_CACHE
+// Cache of resolved host names, with IPv4 addresses stored in network order.
+// A lookup returns true and fills in out_ip if the host is cached.
+bool netutils_dns_cache_lookup(const char *host, uint8_t *out_ip);
+void netutils_dns_cache_add(const char *host, const uint8_t *ip);
+MP_DECLARE_CONST_FUN_OBJ_0(netutils_dns_cache_info_obj);
+MP_DECLARE_CONST_FUN_OBJ_0(netutils_dns_cache_flush_obj);
+#endif
+
 #endif // MICROPY_INCLUDED_LIB_NETUTILS_NETUTILS_H
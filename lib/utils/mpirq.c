@@ -29,6 +29,7 @@
 
 #include "py/runtime.h"
 #include "py/gc.h"
+#include "py/trace.h"
 #include "lib/utils/mpirq.h"
 
 #if MICROPY_ENABLE_SCHEDULER
@@ -66,6 +67,7 @@ void mp_irq_init(mp_irq_obj_t *self, const mp_irq_methods_t *methods, mp_obj_t p
 }
 
 void mp_irq_handler(mp_irq_obj_t *self) {
+    MP_TRACE(MP_TRACE_EVENT_IRQ, self->ishard);
     if (self->handler != mp_const_none) {
         if (self->ishard) {
             // When executing code within a handler we must lock the scheduler to
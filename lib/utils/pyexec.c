@@ -35,6 +35,12 @@
 #include "py/gc.h"
 #include "py/frozenmod.h"
 #include "py/mphal.h"
+#if MICROPY_REPL_FILE_TRANSFER
+#include "py/builtin.h"
+#include "py/mperrno.h"
+#include "py/stream.h"
+#include "extmod/uzlib/uzlib.h"
+#endif
 #if MICROPY_HW_ENABLE_USB
 #include "irq.h"
 #include "usb.h"
@@ -255,7 +261,217 @@ STATIC void mp_reader_new_stdin(mp_reader_t *reader, mp_reader_stdin_t *reader_s
     reader->close = mp_reader_stdin_close;
 }
 
+#if MICROPY_REPL_FILE_TRANSFER
+
+// This is the most file data the binary file transfer commands move in one
+// block, and the size of the buffer they allocate.
+#ifndef MICROPY_REPL_FILE_BLOCK_MAX
+#define MICROPY_REPL_FILE_BLOCK_MAX (1024)
+#endif
+
+// The file transfer commands move file data as binary blocks: a 16-bit
+// length (1 to the block size), the data and its CRC32, all little endian.
+// An empty block, just a zero length, ends the file.  They start with the
+// host sending the filename as a 16-bit length and the name, to which the
+// device replies with a status byte: 0 if it opened the file, or else an
+// errno value and the command is over.
+//
+// For Ctrl-E P (put) the device then sends the flow-control window and the
+// block size as 16-bit values, and 0x01 each time it has consumed a window
+// of data, as for raw-paste, and the host sends blocks.  For Ctrl-E G (get)
+// the device sends blocks.  Both end with the device sending 0x04 and a
+// status byte, which is MP_EIO if the data failed a CRC.  Being binary, the
+// data can't be interrupted by Ctrl-C.
+
+typedef struct _file_rx_t {
+    uint16_t window_max;
+    uint16_t window_remain;
+} file_rx_t;
+
+// Read from stdin, counting the data against the flow-control window if
+// rx is not NULL.
+STATIC void file_rx_bytes(file_rx_t *rx, byte *buf, size_t len) {
+    while (len--) {
+        *buf++ = mp_hal_stdin_rx_chr();
+        if (rx != NULL && --rx->window_remain == 0) {
+            mp_hal_stdout_tx_strn("\x01", 1); // indicate window available to host
+            rx->window_remain = rx->window_max;
+        }
+    }
+}
+
+STATIC uint32_t file_rx_uint(file_rx_t *rx, size_t len) {
+    byte buf[4];
+    file_rx_bytes(rx, buf, len);
+    uint32_t val = 0;
+    while (len--) {
+        val = val << 8 | buf[len];
+    }
+    return val;
+}
+
+STATIC void file_tx_uint(uint32_t val, size_t len) {
+    byte buf[4];
+    for (size_t i = 0; i < len; ++i) {
+        buf[i] = val >> (8 * i);
+    }
+    mp_hal_stdout_tx_strn((const char *)buf, len);
+}
+
+STATIC uint32_t file_crc32(const byte *buf, size_t len) {
+    return uzlib_crc32(buf, len, 0xffffffff) ^ 0xffffffff;
+}
+
+// Return the errno of an OSError, or MP_EIO for any other exception.
+STATIC int file_exc_errno(mp_obj_t exc) {
+    if (mp_obj_is_subclass_fast(MP_OBJ_FROM_PTR(mp_obj_get_type(exc)), MP_OBJ_FROM_PTR(&mp_type_OSError))) {
+        mp_obj_t value = mp_obj_exception_get_value(exc);
+        if (mp_obj_is_small_int(value)) {
+            return MP_OBJ_SMALL_INT_VALUE(value);
+        }
+    } else if (mp_obj_get_type(exc) == &mp_type_MemoryError) {
+        return MP_ENOMEM;
+    }
+    return MP_EIO;
+}
+
+// Read the filename from the host and open the file, returning 0 or an errno.
+STATIC int file_open(byte *buf, qstr mode, mp_obj_t *file) {
+    size_t len = file_rx_uint(NULL, 2);
+    int status = 0;
+    if (buf == NULL) {
+        status = MP_ENOMEM;
+    } else if (len > MICROPY_REPL_FILE_BLOCK_MAX) {
+        status = MP_EINVAL;
+    }
+    for (size_t i = 0; i < len; ++i) {
+        byte c = mp_hal_stdin_rx_chr();
+        if (status == 0) {
+            buf[i] = c;
+        }
+    }
+    if (status != 0) {
+        return status;
+    }
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        mp_obj_t args[2] = { mp_obj_new_str((const char *)buf, len), MP_OBJ_NEW_QSTR(mode) };
+        *file = mp_builtin_open(2, args, (mp_map_t *)&mp_const_empty_map);
+        nlr_pop();
+    } else {
+        status = file_exc_errno(MP_OBJ_FROM_PTR(nlr.ret_val));
+    }
+    return status;
+}
+
+STATIC int file_close(mp_obj_t file, int status) {
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        mp_stream_close(file);
+        nlr_pop();
+    } else if (status == 0) {
+        status = file_exc_errno(MP_OBJ_FROM_PTR(nlr.ret_val));
+    }
+    return status;
+}
+
+STATIC void do_file_put(void) {
+    byte *buf = m_new_maybe(byte, MICROPY_REPL_FILE_BLOCK_MAX);
+    mp_obj_t file = MP_OBJ_NULL;
+    int status = file_open(buf, MP_QSTR_wb, &file);
+    file_tx_uint(status, 1);
+    if (status != 0) {
+        goto done;
+    }
+
+    // As for raw-paste, sending the window size indicates that a window is
+    // free, and the 0x01 that another one is.
+    file_rx_t rx = { MICROPY_REPL_STDIN_BUFFER_MAX / 2, MICROPY_REPL_STDIN_BUFFER_MAX / 2 };
+    file_tx_uint(rx.window_max, 2);
+    file_tx_uint(MICROPY_REPL_FILE_BLOCK_MAX, 2);
+    mp_hal_stdout_tx_strn("\x01", 1);
+
+    for (;;) {
+        size_t len = file_rx_uint(&rx, 2);
+        if (len == 0) {
+            break;
+        }
+        if (len > MICROPY_REPL_FILE_BLOCK_MAX) {
+            // the host is out of step, so stop here and let it see the end
+            status = MP_EINVAL;
+            break;
+        }
+        file_rx_bytes(&rx, buf, len);
+        uint32_t crc = file_rx_uint(&rx, 4);
+        if (status != 0) {
+            // keep reading blocks until the end, to stay in step with the host
+            continue;
+        }
+        if (file_crc32(buf, len) != crc) {
+            status = MP_EIO;
+            continue;
+        }
+        int err;
+        mp_stream_write_exactly(file, buf, len, &err);
+        status = err;
+    }
+
+    status = file_close(file, status);
+    mp_hal_stdout_tx_strn("\x04", 1);
+    file_tx_uint(status, 1);
+
+done:
+    m_del(byte, buf, MICROPY_REPL_FILE_BLOCK_MAX);
+}
+
+STATIC void do_file_get(void) {
+    byte *buf = m_new_maybe(byte, MICROPY_REPL_FILE_BLOCK_MAX);
+    mp_obj_t file = MP_OBJ_NULL;
+    int status = file_open(buf, MP_QSTR_rb, &file);
+    file_tx_uint(status, 1);
+    if (status != 0) {
+        goto done;
+    }
+
+    const mp_stream_p_t *stream_p = mp_get_stream(file);
+    for (;;) {
+        int err;
+        mp_uint_t len = stream_p->read(file, buf, MICROPY_REPL_FILE_BLOCK_MAX, &err);
+        if (len == MP_STREAM_ERROR) {
+            status = err;
+            len = 0;
+        }
+        file_tx_uint(len, 2);
+        if (len == 0) {
+            break;
+        }
+        mp_hal_stdout_tx_strn((const char *)buf, len);
+        file_tx_uint(file_crc32(buf, len), 4);
+    }
+
+    status = file_close(file, status);
+    mp_hal_stdout_tx_strn("\x04", 1);
+    file_tx_uint(status, 1);
+
+done:
+    m_del(byte, buf, MICROPY_REPL_FILE_BLOCK_MAX);
+}
+
+#endif // MICROPY_REPL_FILE_TRANSFER
+
 STATIC int do_reader_stdin(int c) {
+    #if MICROPY_REPL_FILE_TRANSFER
+    if (c == 'P' || c == 'G') {
+        mp_hal_stdout_tx_strn("R\x01", 2);
+        if (c == 'P') {
+            do_file_put();
+        } else {
+            do_file_get();
+        }
+        return 0;
+    }
+    #endif
+
     if (c != 'A') {
         // Unsupported command.
         mp_hal_stdout_tx_strn("R\x00", 2);
@@ -696,8 +912,32 @@ int pyexec_frozen_module(const char *name) {
         #endif
 
         #if MICROPY_MODULE_FROZEN_MPY
-        case MP_FROZEN_MPY:
+        case MP_FROZEN_MPY: {
+            #if MICROPY_MODULE_FROZEN_ROM_GLOBALS
+            // A script with its globals in ROM runs in those, because that's where
+            // its frozen functions look up globals, and what it defined is then
+            // copied into the current globals.
+            mp_obj_dict_t *old_globals = mp_globals_get();
+            mp_obj_module_t module = {{&mp_type_module}, old_globals};
+            mp_frozen_mpy_init_globals(MP_OBJ_FROM_PTR(&module), frozen_data);
+            if (module.globals != old_globals) {
+                mp_obj_dict_t *old_locals = mp_locals_get();
+                mp_globals_set(module.globals);
+                mp_locals_set(module.globals);
+                int ret = parse_compile_execute(frozen_data, MP_PARSE_FILE_INPUT, EXEC_FLAG_SOURCE_IS_RAW_CODE);
+                mp_globals_set(old_globals);
+                mp_locals_set(old_locals);
+                mp_map_t *map = &module.globals->map;
+                for (size_t i = 0; i < map->alloc; ++i) {
+                    if (mp_map_slot_is_filled(map, i)) {
+                        mp_obj_dict_store(MP_OBJ_FROM_PTR(old_globals), map->table[i].key, map->table[i].value);
+                    }
+                }
+                return ret;
+            }
+            #endif
             return parse_compile_execute(frozen_data, MP_PARSE_FILE_INPUT, EXEC_FLAG_SOURCE_IS_RAW_CODE);
+        }
         #endif
 
         default:
@@ -0,0 +1,83 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "py/mphal.h"
+#include "lib/utils/stdout_buffer.h"
+
+#if MICROPY_HAL_STDOUT_BUFFER_SIZE
+
+// Output is held until a newline, until the buffer is full, or until it has
+// waited for MICROPY_HAL_STDOUT_BUFFER_TIMEOUT_MS and more output comes.  The
+// port also flushes it before waiting for input and from its event poll hook,
+// so a prompt or a partial line is shown while the program is idle.  Access
+// is serialised by the GIL; output from IRQ handlers must bypass the buffer.
+
+STATIC struct {
+    size_t len;
+    mp_uint_t first_ms;
+    bool flushing;
+    char buf[MICROPY_HAL_STDOUT_BUFFER_SIZE];
+} stdout_buffer;
+
+void mp_hal_stdout_buffer_flush(void) {
+    if (stdout_buffer.len == 0 || stdout_buffer.flushing) {
+        return;
+    }
+    // The port may release the GIL while it writes, so mark the buffer as
+    // busy and let any output from other threads go straight through.
+    stdout_buffer.flushing = true;
+    mp_hal_stdout_tx_strn_direct(stdout_buffer.buf, stdout_buffer.len);
+    stdout_buffer.len = 0;
+    stdout_buffer.flushing = false;
+}
+
+void mp_hal_stdout_buffer_write(const char *str, size_t len) {
+    if (stdout_buffer.flushing) {
+        mp_hal_stdout_tx_strn_direct(str, len);
+        return;
+    }
+    if (len > sizeof(stdout_buffer.buf) - stdout_buffer.len) {
+        mp_hal_stdout_buffer_flush();
+        if (len >= sizeof(stdout_buffer.buf)) {
+            // too big to be worth copying
+            mp_hal_stdout_tx_strn_direct(str, len);
+            return;
+        }
+    }
+    if (stdout_buffer.len == 0) {
+        stdout_buffer.first_ms = mp_hal_ticks_ms();
+    }
+    memcpy(stdout_buffer.buf + stdout_buffer.len, str, len);
+    stdout_buffer.len += len;
+    if (memchr(str, '\n', len) != NULL
+        || mp_hal_ticks_ms() - stdout_buffer.first_ms >= MICROPY_HAL_STDOUT_BUFFER_TIMEOUT_MS) {
+        mp_hal_stdout_buffer_flush();
+    }
+}
+
+#endif // MICROPY_HAL_STDOUT_BUFFER_SIZE
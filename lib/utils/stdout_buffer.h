@@ -0,0 +1,47 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef MICROPY_INCLUDED_LIB_UTILS_STDOUT_BUFFER_H
+#define MICROPY_INCLUDED_LIB_UTILS_STDOUT_BUFFER_H
+
+#include "py/mpconfig.h"
+
+#if MICROPY_HAL_STDOUT_BUFFER_SIZE
+
+// A line buffer in front of the port's stdout.  The port's
+// mp_hal_stdout_tx_strn() passes output to mp_hal_stdout_buffer_write(), and
+// the buffer is sent on with one call to mp_hal_stdout_tx_strn_direct(), which
+// the port provides to write to its UART/USB and to dupterm.
+void mp_hal_stdout_buffer_write(const char *str, size_t len);
+void mp_hal_stdout_buffer_flush(void);
+void mp_hal_stdout_tx_strn_direct(const char *str, size_t len);
+
+#else
+
+#define mp_hal_stdout_buffer_flush()
+
+#endif
+
+#endif // MICROPY_INCLUDED_LIB_UTILS_STDOUT_BUFFER_H
@@ -95,6 +95,29 @@ STATIC int compile_and_save(const char *file, const char *output_file, const cha
     }
 }
 
+STATIC int load_const_module(const char *file) {
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        mp_lexer_t *lex = mp_lexer_new_from_file(file);
+
+        // the module name is the file name without the directory and .py extension
+        const char *name = strrchr(file, '/');
+        name = name == NULL ? file : name + 1;
+        size_t len = strlen(name);
+        if (len > 3 && strcmp(name + len - 3, ".py") == 0) {
+            len -= 3;
+        }
+
+        mp_parse_const_module(lex, qstr_from_strn(name, len));
+        nlr_pop();
+        return 0;
+    } else {
+        // uncaught exception
+        mp_obj_print_exception(&mp_stderr_print, (mp_obj_t)nlr.ret_val);
+        return 1;
+    }
+}
+
 STATIC int usage(char **argv) {
     printf(
         "usage: %s [<opts>] [-X <implopt>] <input filename>\n"
@@ -102,6 +125,7 @@ STATIC int usage(char **argv) {
         "--version : show version information\n"
         "-o : output file for compiled bytecode (defaults to input with .mpy extension)\n"
         "-s : source filename to embed in the compiled bytecode (defaults to input file)\n"
+        "-c : file whose const() values \"from <module> import\" can use; can be multiple\n"
         "-v : verbose (trace various operations); can be multiple\n"
         "-O[N] : apply bytecode optimizations of level N\n"
         "\n"
@@ -109,7 +133,9 @@ STATIC int usage(char **argv) {
         "-msmall-int-bits=number : set the maximum bits used to encode a small-int\n"
         "-mno-unicode : don't support unicode in compiled strings\n"
         "-mcache-lookup-bc : cache map lookups in the bytecode\n"
-        "-march=<arch> : set architecture for native emitter; x86, x64, armv6, armv7m, armv7em, armv7emsp, armv7emdp, xtensa, xtensawin\n"
+        "-mlazy-load : store nested functions so they can be loaded on first use\n"
+        "-mmapped-str : end str and bytes constants with a null byte so they can be used in place\n"
+        "-march=<arch> : set architecture for native emitter; x86, x64, armv6, armv7m, armv7em, armv7emsp, armv7emdp, xtensa, xtensawin, rv32imc\n"
         "\n"
         "Implementation specific options:\n", argv[0]
         );
@@ -207,6 +233,8 @@ MP_NOINLINE int main_(int argc, char **argv) {
     mp_dynamic_compiler.small_int_bits = 31;
     mp_dynamic_compiler.opt_cache_map_lookup_in_bytecode = 0;
     mp_dynamic_compiler.py_builtins_str_unicode = 1;
+    mp_dynamic_compiler.lazy_load = 0;
+    mp_dynamic_compiler.mapped_str = 0;
     #if defined(__i386__)
     mp_dynamic_compiler.native_arch = MP_NATIVE_ARCH_X86;
     mp_dynamic_compiler.nlr_buf_num_regs = MICROPY_NLR_NUM_REGS_X86;
@@ -256,6 +284,14 @@ MP_NOINLINE int main_(int argc, char **argv) {
                 }
                 a += 1;
                 source_file = argv[a];
+            } else if (strcmp(argv[a], "-c") == 0) {
+                if (a + 1 >= argc) {
+                    exit(usage(argv));
+                }
+                a += 1;
+                if (load_const_module(argv[a]) != 0) {
+                    exit(1);
+                }
             } else if (strncmp(argv[a], "-msmall-int-bits=", sizeof("-msmall-int-bits=") - 1) == 0) {
                 char *end;
                 mp_dynamic_compiler.small_int_bits =
@@ -268,6 +304,10 @@ MP_NOINLINE int main_(int argc, char **argv) {
                 mp_dynamic_compiler.opt_cache_map_lookup_in_bytecode = 0;
             } else if (strcmp(argv[a], "-mcache-lookup-bc") == 0) {
                 mp_dynamic_compiler.opt_cache_map_lookup_in_bytecode = 1;
+            } else if (strcmp(argv[a], "-mlazy-load") == 0) {
+                mp_dynamic_compiler.lazy_load = 1;
+            } else if (strcmp(argv[a], "-mmapped-str") == 0) {
+                mp_dynamic_compiler.mapped_str = 1;
             } else if (strcmp(argv[a], "-mno-unicode") == 0) {
                 mp_dynamic_compiler.py_builtins_str_unicode = 0;
             } else if (strcmp(argv[a], "-municode") == 0) {
@@ -301,6 +341,9 @@ MP_NOINLINE int main_(int argc, char **argv) {
                 } else if (strcmp(arch, "xtensawin") == 0) {
                     mp_dynamic_compiler.native_arch = MP_NATIVE_ARCH_XTENSAWIN;
                     mp_dynamic_compiler.nlr_buf_num_regs = MICROPY_NLR_NUM_REGS_XTENSAWIN;
+                } else if (strcmp(arch, "rv32imc") == 0) {
+                    mp_dynamic_compiler.native_arch = MP_NATIVE_ARCH_RV32IMC;
+                    mp_dynamic_compiler.nlr_buf_num_regs = MICROPY_NLR_NUM_REGS_RV32I;
                 } else {
                     return usage(argv);
                 }
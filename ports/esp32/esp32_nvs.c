@@ -28,6 +28,7 @@
 
 #include "py/runtime.h"
 #include "py/mperrno.h"
+#include "py/objint.h"
 #include "mphalport.h"
 #include "modesp32.h"
 #include "nvs_flash.h"
@@ -40,13 +41,18 @@
 typedef struct _esp32_nvs_obj_t {
     mp_obj_base_t base;
     nvs_handle_t namespace;
+    mp_obj_t pending; // dict of values staged by set_many, or MP_OBJ_NULL
+    char ns_name[NVS_KEY_NAME_MAX_SIZE];
 } esp32_nvs_obj_t;
 
 // *esp32_nvs_new allocates a python NVS object given a handle to an esp-idf namespace C obj.
-STATIC esp32_nvs_obj_t *esp32_nvs_new(nvs_handle_t namespace) {
+STATIC esp32_nvs_obj_t *esp32_nvs_new(nvs_handle_t namespace, const char *ns_name) {
     esp32_nvs_obj_t *self = m_new_obj(esp32_nvs_obj_t);
     self->base.type = &esp32_nvs_type;
     self->namespace = namespace;
+    self->pending = MP_OBJ_NULL;
+    strncpy(self->ns_name, ns_name, sizeof(self->ns_name) - 1);
+    self->ns_name[sizeof(self->ns_name) - 1] = '\0';
     return self;
 }
 
@@ -66,9 +72,157 @@ STATIC mp_obj_t esp32_nvs_make_new(const mp_obj_type_t *type, size_t n_args, siz
     const char *ns_name = mp_obj_str_get_str(all_args[0]);
     nvs_handle_t namespace;
     check_esp_err(nvs_open(ns_name, NVS_READWRITE, &namespace));
-    return MP_OBJ_FROM_PTR(esp32_nvs_new(namespace));
+    return MP_OBJ_FROM_PTR(esp32_nvs_new(namespace, ns_name));
 }
 
+// Integer types are handled by common functions, taking the esp-idf type.
+STATIC void esp32_nvs_set_int_type(esp32_nvs_obj_t *self, const char *key, mp_obj_t value_in, nvs_type_t type) {
+    if (type == NVS_TYPE_I64 || type == NVS_TYPE_U64) {
+        // Get the low 64 bits of the value, in two's complement
+        uint64_t value;
+        if (mp_obj_is_small_int(value_in)) {
+            value = (int64_t)MP_OBJ_SMALL_INT_VALUE(value_in);
+        } else {
+            mp_obj_int_to_bytes_impl(value_in, false, sizeof(value), (byte *)&value);
+        }
+        if (type == NVS_TYPE_I64) {
+            check_esp_err(nvs_set_i64(self->namespace, key, value));
+        } else {
+            check_esp_err(nvs_set_u64(self->namespace, key, value));
+        }
+        return;
+    }
+    mp_int_t value = mp_obj_get_int(value_in);
+    esp_err_t err;
+    switch (type) {
+        case NVS_TYPE_U8:
+            if (value < 0 || value > UINT8_MAX) {
+                goto out_of_range;
+            }
+            err = nvs_set_u8(self->namespace, key, value);
+            break;
+        case NVS_TYPE_U16:
+            if (value < 0 || value > UINT16_MAX) {
+                goto out_of_range;
+            }
+            err = nvs_set_u16(self->namespace, key, value);
+            break;
+        case NVS_TYPE_U32:
+            // The value may not fit in a small int
+            err = nvs_set_u32(self->namespace, key, mp_obj_get_int_truncated(value_in));
+            break;
+        default:
+            err = nvs_set_i32(self->namespace, key, value);
+            break;
+    }
+    check_esp_err(err);
+    return;
+
+out_of_range:
+    mp_raise_ValueError(MP_ERROR_TEXT("value out of range"));
+}
+
+// Returns the value, or MP_OBJ_NULL if the key doesn't exist with this type.
+STATIC mp_obj_t esp32_nvs_get_int_type(esp32_nvs_obj_t *self, const char *key, nvs_type_t type) {
+    esp_err_t err;
+    mp_obj_t value = MP_OBJ_NULL;
+    switch (type) {
+        case NVS_TYPE_U8: {
+            uint8_t v;
+            err = nvs_get_u8(self->namespace, key, &v);
+            value = MP_OBJ_NEW_SMALL_INT(v);
+            break;
+        }
+        case NVS_TYPE_U16: {
+            uint16_t v;
+            err = nvs_get_u16(self->namespace, key, &v);
+            value = MP_OBJ_NEW_SMALL_INT(v);
+            break;
+        }
+        case NVS_TYPE_U32: {
+            uint32_t v;
+            err = nvs_get_u32(self->namespace, key, &v);
+            value = mp_obj_new_int_from_uint(v);
+            break;
+        }
+        case NVS_TYPE_I64: {
+            int64_t v;
+            err = nvs_get_i64(self->namespace, key, &v);
+            value = mp_obj_new_int_from_ll(v);
+            break;
+        }
+        case NVS_TYPE_U64: {
+            uint64_t v;
+            err = nvs_get_u64(self->namespace, key, &v);
+            value = mp_obj_new_int_from_ull(v);
+            break;
+        }
+        default: {
+            int32_t v;
+            err = nvs_get_i32(self->namespace, key, &v);
+            value = mp_obj_new_int(v);
+            break;
+        }
+    }
+    if (err == ESP_ERR_NVS_NOT_FOUND) {
+        return MP_OBJ_NULL;
+    }
+    check_esp_err(err);
+    return value;
+}
+
+// Returns a str value, or MP_OBJ_NULL if the key doesn't exist as a str.
+STATIC mp_obj_t esp32_nvs_get_str_maybe(esp32_nvs_obj_t *self, const char *key) {
+    size_t length = 0;
+    esp_err_t err = nvs_get_str(self->namespace, key, NULL, &length);
+    if (err == ESP_ERR_NVS_NOT_FOUND) {
+        return MP_OBJ_NULL;
+    }
+    check_esp_err(err);
+    // length includes the terminating null character
+    vstr_t vstr;
+    vstr_init_len(&vstr, length);
+    check_esp_err(nvs_get_str(self->namespace, key, vstr.buf, &length));
+    vstr.len = length - 1;
+    return mp_obj_new_str_from_vstr(&mp_type_str, &vstr);
+}
+
+// Returns a blob value as bytes, or MP_OBJ_NULL if the key doesn't exist as a blob.
+STATIC mp_obj_t esp32_nvs_get_blob_maybe(esp32_nvs_obj_t *self, const char *key) {
+    size_t length = 0;
+    esp_err_t err = nvs_get_blob(self->namespace, key, NULL, &length);
+    if (err == ESP_ERR_NVS_NOT_FOUND) {
+        return MP_OBJ_NULL;
+    }
+    check_esp_err(err);
+    vstr_t vstr;
+    vstr_init_len(&vstr, length);
+    check_esp_err(nvs_get_blob(self->namespace, key, vstr.buf, &length));
+    vstr.len = length;
+    return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
+}
+
+#define ESP32_NVS_INT_ACCESSORS(name, type) \
+    STATIC mp_obj_t esp32_nvs_set_##name(mp_obj_t self_in, mp_obj_t key_in, mp_obj_t value_in) { \
+        esp32_nvs_set_int_type(MP_OBJ_TO_PTR(self_in), mp_obj_str_get_str(key_in), value_in, type); \
+        return mp_const_none; \
+    } \
+    STATIC MP_DEFINE_CONST_FUN_OBJ_3(esp32_nvs_set_##name##_obj, esp32_nvs_set_##name); \
+    STATIC mp_obj_t esp32_nvs_get_##name(mp_obj_t self_in, mp_obj_t key_in) { \
+        mp_obj_t value = esp32_nvs_get_int_type(MP_OBJ_TO_PTR(self_in), mp_obj_str_get_str(key_in), type); \
+        if (value == MP_OBJ_NULL) { \
+            check_esp_err(ESP_ERR_NVS_NOT_FOUND); \
+        } \
+        return value; \
+    } \
+    STATIC MP_DEFINE_CONST_FUN_OBJ_2(esp32_nvs_get_##name##_obj, esp32_nvs_get_##name);
+
+ESP32_NVS_INT_ACCESSORS(u8, NVS_TYPE_U8)
+ESP32_NVS_INT_ACCESSORS(u16, NVS_TYPE_U16)
+ESP32_NVS_INT_ACCESSORS(u32, NVS_TYPE_U32)
+ESP32_NVS_INT_ACCESSORS(i64, NVS_TYPE_I64)
+ESP32_NVS_INT_ACCESSORS(u64, NVS_TYPE_U64)
+
 // esp32_nvs_set_i32 sets a 32-bit integer value
 STATIC mp_obj_t esp32_nvs_set_i32(mp_obj_t self_in, mp_obj_t key_in, mp_obj_t value_in) {
     esp32_nvs_obj_t *self = MP_OBJ_TO_PTR(self_in);
@@ -89,6 +243,25 @@ STATIC mp_obj_t esp32_nvs_get_i32(mp_obj_t self_in, mp_obj_t key_in) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(esp32_nvs_get_i32_obj, esp32_nvs_get_i32);
 
+// esp32_nvs_set_str writes a string value.
+STATIC mp_obj_t esp32_nvs_set_str(mp_obj_t self_in, mp_obj_t key_in, mp_obj_t value_in) {
+    esp32_nvs_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    const char *key = mp_obj_str_get_str(key_in);
+    check_esp_err(nvs_set_str(self->namespace, key, mp_obj_str_get_str(value_in)));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(esp32_nvs_set_str_obj, esp32_nvs_set_str);
+
+// esp32_nvs_get_str reads a string value.
+STATIC mp_obj_t esp32_nvs_get_str(mp_obj_t self_in, mp_obj_t key_in) {
+    mp_obj_t value = esp32_nvs_get_str_maybe(MP_OBJ_TO_PTR(self_in), mp_obj_str_get_str(key_in));
+    if (value == MP_OBJ_NULL) {
+        check_esp_err(ESP_ERR_NVS_NOT_FOUND);
+    }
+    return value;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(esp32_nvs_get_str_obj, esp32_nvs_get_str);
+
 // esp32_nvs_set_blob writes a buffer object into a binary blob value.
 STATIC mp_obj_t esp32_nvs_set_blob(mp_obj_t self_in, mp_obj_t key_in, mp_obj_t value_in) {
     esp32_nvs_obj_t *self = MP_OBJ_TO_PTR(self_in);
@@ -115,18 +288,135 @@ STATIC mp_obj_t esp32_nvs_get_blob(mp_obj_t self_in, mp_obj_t key_in, mp_obj_t v
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_3(esp32_nvs_get_blob_obj, esp32_nvs_get_blob);
 
-// esp32_nvs_erase_key erases one key.
+// esp32_nvs_erase_key erases one key, including any value staged by set_many.
 STATIC mp_obj_t esp32_nvs_erase_key(mp_obj_t self_in, mp_obj_t key_in) {
     esp32_nvs_obj_t *self = MP_OBJ_TO_PTR(self_in);
     const char *key = mp_obj_str_get_str(key_in);
-    check_esp_err(nvs_erase_key(self->namespace, key));
+    esp_err_t err = nvs_erase_key(self->namespace, key);
+    if (self->pending != MP_OBJ_NULL
+        && mp_map_lookup(mp_obj_dict_get_map(self->pending), key_in, MP_MAP_LOOKUP_REMOVE_IF_FOUND) != NULL
+        && err == ESP_ERR_NVS_NOT_FOUND) {
+        // the key only existed as a staged value
+        err = ESP_OK;
+    }
+    check_esp_err(err);
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(esp32_nvs_erase_key_obj, esp32_nvs_erase_key);
 
-// esp32_nvs_commit commits any changes to flash.
+// esp32_nvs_set_many stages the key-value pairs of a dict, to be written by commit.
+// Staging a key again replaces its value, so that only the last one is written.
+STATIC mp_obj_t esp32_nvs_set_many(mp_obj_t self_in, mp_obj_t items_in) {
+    esp32_nvs_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_map_t *map = mp_obj_dict_get_map(items_in);
+    // Check all the items before staging any of them
+    for (size_t i = 0; i < map->alloc; ++i) {
+        if (mp_map_slot_is_filled(map, i)) {
+            mp_obj_t value = map->table[i].value;
+            mp_buffer_info_t bufinfo;
+            if (strlen(mp_obj_str_get_str(map->table[i].key)) >= NVS_KEY_NAME_MAX_SIZE
+                || !(mp_obj_is_int(value) || mp_obj_is_str(value) || mp_get_buffer(value, &bufinfo, MP_BUFFER_READ))) {
+                mp_raise_ValueError(MP_ERROR_TEXT("invalid key or value"));
+            }
+        }
+    }
+    if (self->pending == MP_OBJ_NULL) {
+        self->pending = mp_obj_new_dict(0);
+    }
+    for (size_t i = 0; i < map->alloc; ++i) {
+        if (mp_map_slot_is_filled(map, i)) {
+            mp_obj_t value = map->table[i].value;
+            if (!mp_obj_is_int(value) && !mp_obj_is_str(value)) {
+                // take a copy of buffers, which may be changed before the commit
+                mp_buffer_info_t bufinfo;
+                mp_get_buffer_raise(value, &bufinfo, MP_BUFFER_READ);
+                value = mp_obj_new_bytes(bufinfo.buf, bufinfo.len);
+            }
+            mp_obj_dict_store(self->pending, map->table[i].key, value);
+        }
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(esp32_nvs_set_many_obj, esp32_nvs_set_many);
+
+// esp32_nvs_get_many returns a list with the value of each key, or None if the key
+// doesn't exist.  Staged values are returned in preference to those in flash.
+STATIC mp_obj_t esp32_nvs_get_many(mp_obj_t self_in, mp_obj_t keys_in) {
+    esp32_nvs_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    // Types are tried in this order, so the most common are found quickest
+    static const uint8_t int_types[] = {
+        NVS_TYPE_I32, NVS_TYPE_I64, NVS_TYPE_U8, NVS_TYPE_U16, NVS_TYPE_U32, NVS_TYPE_U64,
+    };
+    mp_obj_t result = mp_obj_new_list(0, NULL);
+    mp_obj_t iter = mp_getiter(keys_in, NULL);
+    mp_obj_t key_in;
+    while ((key_in = mp_iternext(iter)) != MP_OBJ_STOP_ITERATION) {
+        const char *key = mp_obj_str_get_str(key_in);
+        mp_obj_t value = MP_OBJ_NULL;
+        if (self->pending != MP_OBJ_NULL) {
+            mp_map_elem_t *elem = mp_map_lookup(mp_obj_dict_get_map(self->pending), key_in, MP_MAP_LOOKUP);
+            if (elem != NULL) {
+                value = elem->value;
+            }
+        }
+        for (size_t i = 0; value == MP_OBJ_NULL && i < MP_ARRAY_SIZE(int_types); ++i) {
+            value = esp32_nvs_get_int_type(self, key, int_types[i]);
+        }
+        if (value == MP_OBJ_NULL) {
+            value = esp32_nvs_get_str_maybe(self, key);
+        }
+        if (value == MP_OBJ_NULL) {
+            value = esp32_nvs_get_blob_maybe(self, key);
+        }
+        mp_obj_list_append(result, value == MP_OBJ_NULL ? mp_const_none : value);
+    }
+    return result;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(esp32_nvs_get_many_obj, esp32_nvs_get_many);
+
+// esp32_nvs_keys returns a list of the keys stored in flash in this namespace.
+STATIC mp_obj_t esp32_nvs_keys(mp_obj_t self_in) {
+    esp32_nvs_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_obj_t result = mp_obj_new_list(0, NULL);
+    nvs_iterator_t it = nvs_entry_find(NVS_DEFAULT_PART_NAME, self->ns_name, NVS_TYPE_ANY);
+    while (it != NULL) {
+        nvs_entry_info_t info;
+        nvs_entry_info(it, &info);
+        // the iterator is released when it reaches the end
+        it = nvs_entry_next(it);
+        mp_obj_list_append(result, mp_obj_new_str(info.key, strlen(info.key)));
+    }
+    return result;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(esp32_nvs_keys_obj, esp32_nvs_keys);
+
+// esp32_nvs_commit writes any values staged by set_many, then commits any changes to flash.
 STATIC mp_obj_t esp32_nvs_commit(mp_obj_t self_in) {
     esp32_nvs_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (self->pending != MP_OBJ_NULL) {
+        // The staged values are only dropped once all are written, so a failed
+        // commit can be retried
+        mp_map_t *map = mp_obj_dict_get_map(self->pending);
+        for (size_t i = 0; i < map->alloc; ++i) {
+            if (mp_map_slot_is_filled(map, i)) {
+                const char *key = mp_obj_str_get_str(map->table[i].key);
+                mp_obj_t value = map->table[i].value;
+                if (mp_obj_is_str(value)) {
+                    check_esp_err(nvs_set_str(self->namespace, key, mp_obj_str_get_str(value)));
+                } else if (mp_obj_is_int(value)) {
+                    // use a 32-bit value when it fits, otherwise 64-bit
+                    mp_int_t v;
+                    bool fits = mp_obj_get_int_maybe(value, &v) && v >= INT32_MIN && v <= INT32_MAX;
+                    esp32_nvs_set_int_type(self, key, value, fits ? NVS_TYPE_I32 : NVS_TYPE_I64);
+                } else {
+                    mp_buffer_info_t bufinfo;
+                    mp_get_buffer_raise(value, &bufinfo, MP_BUFFER_READ);
+                    check_esp_err(nvs_set_blob(self->namespace, key, bufinfo.buf, bufinfo.len));
+                }
+            }
+        }
+        self->pending = MP_OBJ_NULL;
+    }
     check_esp_err(nvs_commit(self->namespace));
     return mp_const_none;
 }
@@ -135,8 +425,23 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_1(esp32_nvs_commit_obj, esp32_nvs_commit);
 STATIC const mp_rom_map_elem_t esp32_nvs_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_get_i32), MP_ROM_PTR(&esp32_nvs_get_i32_obj) },
     { MP_ROM_QSTR(MP_QSTR_set_i32), MP_ROM_PTR(&esp32_nvs_set_i32_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get_u8), MP_ROM_PTR(&esp32_nvs_get_u8_obj) },
+    { MP_ROM_QSTR(MP_QSTR_set_u8), MP_ROM_PTR(&esp32_nvs_set_u8_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get_u16), MP_ROM_PTR(&esp32_nvs_get_u16_obj) },
+    { MP_ROM_QSTR(MP_QSTR_set_u16), MP_ROM_PTR(&esp32_nvs_set_u16_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get_u32), MP_ROM_PTR(&esp32_nvs_get_u32_obj) },
+    { MP_ROM_QSTR(MP_QSTR_set_u32), MP_ROM_PTR(&esp32_nvs_set_u32_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get_i64), MP_ROM_PTR(&esp32_nvs_get_i64_obj) },
+    { MP_ROM_QSTR(MP_QSTR_set_i64), MP_ROM_PTR(&esp32_nvs_set_i64_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get_u64), MP_ROM_PTR(&esp32_nvs_get_u64_obj) },
+    { MP_ROM_QSTR(MP_QSTR_set_u64), MP_ROM_PTR(&esp32_nvs_set_u64_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get_str), MP_ROM_PTR(&esp32_nvs_get_str_obj) },
+    { MP_ROM_QSTR(MP_QSTR_set_str), MP_ROM_PTR(&esp32_nvs_set_str_obj) },
     { MP_ROM_QSTR(MP_QSTR_get_blob), MP_ROM_PTR(&esp32_nvs_get_blob_obj) },
     { MP_ROM_QSTR(MP_QSTR_set_blob), MP_ROM_PTR(&esp32_nvs_set_blob_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get_many), MP_ROM_PTR(&esp32_nvs_get_many_obj) },
+    { MP_ROM_QSTR(MP_QSTR_set_many), MP_ROM_PTR(&esp32_nvs_set_many_obj) },
+    { MP_ROM_QSTR(MP_QSTR_keys), MP_ROM_PTR(&esp32_nvs_keys_obj) },
     { MP_ROM_QSTR(MP_QSTR_erase_key), MP_ROM_PTR(&esp32_nvs_erase_key_obj) },
     { MP_ROM_QSTR(MP_QSTR_commit), MP_ROM_PTR(&esp32_nvs_commit_obj) },
 };
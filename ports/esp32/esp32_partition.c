@@ -28,10 +28,18 @@
 
 #include "py/runtime.h"
 #include "py/mperrno.h"
+#include "py/stream.h"
 #include "extmod/vfs.h"
 #include "mphalport.h"
 #include "modesp32.h"
 #include "esp_ota_ops.h"
+#include "mbedtls/sha256.h"
+
+#if MBEDTLS_VERSION_NUMBER < 0x02070000
+#define mbedtls_sha256_starts_ret mbedtls_sha256_starts
+#define mbedtls_sha256_update_ret mbedtls_sha256_update
+#define mbedtls_sha256_finish_ret mbedtls_sha256_finish
+#endif
 
 // esp_partition_read and esp_partition_write can operate on arbitrary bytes
 // but esp_partition_erase_range operates on 4k blocks.  But to make a partition
@@ -143,34 +151,95 @@ STATIC mp_obj_t esp32_partition_info(mp_obj_t self_in) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(esp32_partition_info_obj, esp32_partition_info);
 
+STATIC int esp32_partition_bdev_readblocks(mp_obj_t self_in, uint32_t block_num, uint32_t block_off, uint8_t *buf, size_t len, bool ext) {
+    esp32_partition_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    (void)ext;
+    uint32_t offset = block_num * BLOCK_SIZE_BYTES + block_off;
+    check_esp_err(esp_partition_read(self->part, offset, buf, len));
+    return 0;
+}
+
+STATIC int esp32_partition_bdev_writeblocks(mp_obj_t self_in, uint32_t block_num, uint32_t block_off, const uint8_t *buf, size_t len, bool ext) {
+    esp32_partition_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    uint32_t offset = block_num * BLOCK_SIZE_BYTES + block_off;
+    if (!ext) {
+        check_esp_err(esp_partition_erase_range(self->part, offset, len));
+    }
+    check_esp_err(esp_partition_write(self->part, offset, buf, len));
+    return 0;
+}
+
 STATIC mp_obj_t esp32_partition_readblocks(size_t n_args, const mp_obj_t *args) {
-    esp32_partition_obj_t *self = MP_OBJ_TO_PTR(args[0]);
-    uint32_t offset = mp_obj_get_int(args[1]) * BLOCK_SIZE_BYTES;
     mp_buffer_info_t bufinfo;
     mp_get_buffer_raise(args[2], &bufinfo, MP_BUFFER_WRITE);
-    if (n_args == 4) {
-        offset += mp_obj_get_int(args[3]);
-    }
-    check_esp_err(esp_partition_read(self->part, offset, bufinfo.buf, bufinfo.len));
+    uint32_t block_off = n_args == 4 ? mp_obj_get_int(args[3]) : 0;
+    esp32_partition_bdev_readblocks(args[0], mp_obj_get_int(args[1]), block_off, bufinfo.buf, bufinfo.len, n_args == 4);
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(esp32_partition_readblocks_obj, 3, 4, esp32_partition_readblocks);
 
 STATIC mp_obj_t esp32_partition_writeblocks(size_t n_args, const mp_obj_t *args) {
-    esp32_partition_obj_t *self = MP_OBJ_TO_PTR(args[0]);
-    uint32_t offset = mp_obj_get_int(args[1]) * BLOCK_SIZE_BYTES;
     mp_buffer_info_t bufinfo;
     mp_get_buffer_raise(args[2], &bufinfo, MP_BUFFER_READ);
-    if (n_args == 3) {
-        check_esp_err(esp_partition_erase_range(self->part, offset, bufinfo.len));
-    } else {
-        offset += mp_obj_get_int(args[3]);
-    }
-    check_esp_err(esp_partition_write(self->part, offset, bufinfo.buf, bufinfo.len));
+    uint32_t block_off = n_args == 4 ? mp_obj_get_int(args[3]) : 0;
+    esp32_partition_bdev_writeblocks(args[0], mp_obj_get_int(args[1]), block_off, bufinfo.buf, bufinfo.len, n_args == 4);
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(esp32_partition_writeblocks_obj, 3, 4, esp32_partition_writeblocks);
 
+#if MICROPY_VFS_MMAP
+// Partitions are mapped whole on first use and stay mapped, so that addresses
+// handed out remain valid.  The number of mappings is bounded because MMU
+// pages for the data cache are limited.
+#define ESP32_PARTITION_MMAP_MAX (4)
+
+STATIC struct {
+    const esp_partition_t *part;
+    const uint8_t *addr;
+} esp32_partition_mmap_table[ESP32_PARTITION_MMAP_MAX];
+
+STATIC const uint8_t *esp32_partition_bdev_mmap(mp_obj_t self_in, uint32_t block_num, uint32_t *num_blocks) {
+    esp32_partition_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    uint32_t n = self->part->size / BLOCK_SIZE_BYTES;
+    if (block_num >= n) {
+        return NULL;
+    }
+    const uint8_t *addr = NULL;
+    for (size_t i = 0; i < ESP32_PARTITION_MMAP_MAX; ++i) {
+        if (esp32_partition_mmap_table[i].part == self->part) {
+            addr = esp32_partition_mmap_table[i].addr;
+            break;
+        }
+        if (esp32_partition_mmap_table[i].part == NULL) {
+            const void *ptr;
+            spi_flash_mmap_handle_t handle;
+            if (esp_partition_mmap(self->part, 0, self->part->size, SPI_FLASH_MMAP_DATA, &ptr, &handle) != ESP_OK) {
+                return NULL;
+            }
+            esp32_partition_mmap_table[i].part = self->part;
+            esp32_partition_mmap_table[i].addr = ptr;
+            addr = ptr;
+            break;
+        }
+    }
+    if (addr == NULL) {
+        return NULL;
+    }
+    *num_blocks = n - block_num;
+    return addr + block_num * BLOCK_SIZE_BYTES;
+}
+#endif
+
+STATIC const mp_block_dev_p_t esp32_partition_block_dev_p = {
+    .readblocks_obj = &esp32_partition_readblocks_obj,
+    .writeblocks_obj = &esp32_partition_writeblocks_obj,
+    .readblocks = esp32_partition_bdev_readblocks,
+    .writeblocks = esp32_partition_bdev_writeblocks,
+    #if MICROPY_VFS_MMAP
+    .mmap = esp32_partition_bdev_mmap,
+    #endif
+};
+
 STATIC mp_obj_t esp32_partition_ioctl(mp_obj_t self_in, mp_obj_t cmd_in, mp_obj_t arg_in) {
     esp32_partition_obj_t *self = MP_OBJ_TO_PTR(self_in);
     mp_int_t cmd = mp_obj_get_int(cmd_in);
@@ -242,5 +311,228 @@ const mp_obj_type_t esp32_partition_type = {
     .name = MP_QSTR_Partition,
     .print = esp32_partition_print,
     .make_new = esp32_partition_make_new,
+    .protocol = &esp32_partition_block_dev_p,
     .locals_dict = (mp_obj_dict_t *)&esp32_partition_locals_dict,
 };
+
+/******************************************************************************/
+// OTAWriter: a stream which writes data sequentially to a partition, erasing
+// the flash ahead of the writes and computing the SHA256 of the data as it
+// goes, so that an image can be written and verified in a single pass.
+
+// Erase in units of the flash block size, which is faster than erasing each
+// 4k sector separately.
+#define OTA_ERASE_AHEAD_BYTES (65536)
+
+typedef struct _esp32_ota_writer_obj_t {
+    mp_obj_base_t base;
+    const esp_partition_t *part;
+    uint32_t offset; // number of bytes written to flash
+    uint32_t erased; // number of bytes erased from the start of the partition
+    size_t buf_len; // number of bytes held in buf, always less than a sector
+    bool closed;
+    mbedtls_sha256_context sha256;
+    uint8_t digest[32];
+    uint8_t buf[BLOCK_SIZE_BYTES];
+} esp32_ota_writer_obj_t;
+
+STATIC mp_obj_t esp32_ota_writer_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *all_args) {
+    mp_arg_check_num(n_args, n_kw, 1, 1, false);
+    if (!mp_obj_is_type(all_args[0], &esp32_partition_type)) {
+        mp_raise_TypeError(NULL);
+    }
+    esp32_partition_obj_t *part = MP_OBJ_TO_PTR(all_args[0]);
+    esp32_ota_writer_obj_t *self = m_new_obj(esp32_ota_writer_obj_t);
+    self->base.type = type;
+    self->part = part->part;
+    self->offset = 0;
+    self->erased = 0;
+    self->buf_len = 0;
+    self->closed = false;
+    mbedtls_sha256_init(&self->sha256);
+    mbedtls_sha256_starts_ret(&self->sha256, 0);
+    return MP_OBJ_FROM_PTR(self);
+}
+
+// Write data to the flash at the current offset, erasing ahead as needed.
+STATIC void esp32_ota_writer_flash(esp32_ota_writer_obj_t *self, const uint8_t *data, size_t len) {
+    if (len > self->part->size - self->offset) {
+        mp_raise_OSError(MP_ENOSPC);
+    }
+    while (self->erased < self->offset + len) {
+        uint32_t n = OTA_ERASE_AHEAD_BYTES - self->erased % OTA_ERASE_AHEAD_BYTES;
+        if (n > self->part->size - self->erased) {
+            n = self->part->size - self->erased;
+        }
+        check_esp_err(esp_partition_erase_range(self->part, self->erased, n));
+        self->erased += n;
+    }
+    check_esp_err(esp_partition_write(self->part, self->offset, data, len));
+    self->offset += len;
+}
+
+// Take len bytes of data that are either at the end of buf already, or are
+// given by data, and write out all complete sectors.
+STATIC void esp32_ota_writer_add(esp32_ota_writer_obj_t *self, const uint8_t *data, size_t len) {
+    if (data == NULL) {
+        data = self->buf + self->buf_len;
+    }
+    mbedtls_sha256_update_ret(&self->sha256, data, len);
+    if (self->buf_len > 0 || len < BLOCK_SIZE_BYTES) {
+        // Complete the partial sector held in buf
+        size_t n = MIN(len, BLOCK_SIZE_BYTES - self->buf_len);
+        if (data != self->buf + self->buf_len) {
+            memcpy(self->buf + self->buf_len, data, n);
+        }
+        self->buf_len += n;
+        data += n;
+        len -= n;
+        if (self->buf_len < BLOCK_SIZE_BYTES) {
+            return;
+        }
+        esp32_ota_writer_flash(self, self->buf, BLOCK_SIZE_BYTES);
+        self->buf_len = 0;
+    }
+    // Write whole sectors directly from the caller's data, keeping the rest
+    size_t n = len & ~(BLOCK_SIZE_BYTES - 1);
+    if (n > 0) {
+        esp32_ota_writer_flash(self, data, n);
+    }
+    memcpy(self->buf, data + n, len - n);
+    self->buf_len = len - n;
+}
+
+STATIC mp_uint_t esp32_ota_writer_write(mp_obj_t self_in, const void *buf, mp_uint_t size, int *errcode) {
+    esp32_ota_writer_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (self->closed) {
+        *errcode = MP_EBADF;
+        return MP_STREAM_ERROR;
+    }
+    esp32_ota_writer_add(self, buf, size);
+    return size;
+}
+
+STATIC void esp32_ota_writer_close_internal(esp32_ota_writer_obj_t *self) {
+    if (self->closed) {
+        return;
+    }
+    if (self->buf_len > 0) {
+        size_t len = self->buf_len;
+        if (self->part->encrypted) {
+            // Encrypted flash is written in 16-byte units, pad with erased bytes
+            size_t padded = (len + 15) & ~15;
+            memset(self->buf + len, 0xff, padded - len);
+            len = padded;
+        }
+        esp32_ota_writer_flash(self, self->buf, len);
+        self->buf_len = 0;
+    }
+    mbedtls_sha256_finish_ret(&self->sha256, self->digest);
+    mbedtls_sha256_free(&self->sha256);
+    self->closed = true;
+}
+
+STATIC mp_uint_t esp32_ota_writer_ioctl(mp_obj_t self_in, mp_uint_t request, uintptr_t arg, int *errcode) {
+    esp32_ota_writer_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    switch (request) {
+        case MP_STREAM_FLUSH:
+            // Partial sectors are only written on close, so that writes stay aligned
+            return 0;
+        case MP_STREAM_CLOSE:
+            esp32_ota_writer_close_internal(self);
+            return 0;
+        default:
+            *errcode = MP_EINVAL;
+            return MP_STREAM_ERROR;
+    }
+}
+
+// OTAWriter.write_from(stream, size=-1): copy data from a stream (eg a socket)
+// into the partition, reading straight into the sector buffer.  Copies until
+// size bytes have been written or the stream reaches EOF, and returns the
+// number of bytes written.
+STATIC mp_obj_t esp32_ota_writer_write_from(size_t n_args, const mp_obj_t *args) {
+    esp32_ota_writer_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+    if (self->closed) {
+        mp_raise_OSError(MP_EBADF);
+    }
+    mp_get_stream_raise(args[1], MP_STREAM_OP_READ);
+    mp_int_t size = n_args > 2 ? mp_obj_get_int(args[2]) : -1;
+    mp_uint_t total = 0;
+    while (size < 0 || total < (mp_uint_t)size) {
+        mp_uint_t n = BLOCK_SIZE_BYTES - self->buf_len;
+        if (size >= 0 && n > size - total) {
+            n = size - total;
+        }
+        int errcode;
+        n = mp_stream_rw(args[1], self->buf + self->buf_len, n, &errcode, MP_STREAM_RW_READ | MP_STREAM_RW_ONCE);
+        if (n == MP_STREAM_ERROR) {
+            if (mp_is_nonblocking_error(errcode) && total > 0) {
+                break;
+            }
+            mp_raise_OSError(errcode);
+        }
+        if (n == 0) {
+            // EOF
+            break;
+        }
+        esp32_ota_writer_add(self, NULL, n);
+        total += n;
+    }
+    return mp_obj_new_int_from_uint(total);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(esp32_ota_writer_write_from_obj, 2, 3, esp32_ota_writer_write_from);
+
+// OTAWriter.digest(): the SHA256 of the data written so far.
+STATIC mp_obj_t esp32_ota_writer_digest(mp_obj_t self_in) {
+    esp32_ota_writer_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (self->closed) {
+        return mp_obj_new_bytes(self->digest, sizeof(self->digest));
+    }
+    mbedtls_sha256_context ctx;
+    uint8_t digest[32];
+    mbedtls_sha256_init(&ctx);
+    mbedtls_sha256_clone(&ctx, &self->sha256);
+    mbedtls_sha256_finish_ret(&ctx, digest);
+    mbedtls_sha256_free(&ctx);
+    return mp_obj_new_bytes(digest, sizeof(digest));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(esp32_ota_writer_digest_obj, esp32_ota_writer_digest);
+
+// OTAWriter.tell(): the number of bytes written so far.
+STATIC mp_obj_t esp32_ota_writer_tell(mp_obj_t self_in) {
+    esp32_ota_writer_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    return mp_obj_new_int_from_uint(self->offset + self->buf_len);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(esp32_ota_writer_tell_obj, esp32_ota_writer_tell);
+
+STATIC mp_obj_t esp32_ota_writer___exit__(size_t n_args, const mp_obj_t *args) {
+    (void)n_args;
+    return mp_stream_close(args[0]);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(esp32_ota_writer___exit___obj, 4, 4, esp32_ota_writer___exit__);
+
+STATIC const mp_rom_map_elem_t esp32_ota_writer_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_write), MP_ROM_PTR(&mp_stream_write_obj) },
+    { MP_ROM_QSTR(MP_QSTR_write_from), MP_ROM_PTR(&esp32_ota_writer_write_from_obj) },
+    { MP_ROM_QSTR(MP_QSTR_digest), MP_ROM_PTR(&esp32_ota_writer_digest_obj) },
+    { MP_ROM_QSTR(MP_QSTR_tell), MP_ROM_PTR(&esp32_ota_writer_tell_obj) },
+    { MP_ROM_QSTR(MP_QSTR_flush), MP_ROM_PTR(&mp_stream_flush_obj) },
+    { MP_ROM_QSTR(MP_QSTR_close), MP_ROM_PTR(&mp_stream_close_obj) },
+    { MP_ROM_QSTR(MP_QSTR___enter__), MP_ROM_PTR(&mp_identity_obj) },
+    { MP_ROM_QSTR(MP_QSTR___exit__), MP_ROM_PTR(&esp32_ota_writer___exit___obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(esp32_ota_writer_locals_dict, esp32_ota_writer_locals_dict_table);
+
+STATIC const mp_stream_p_t esp32_ota_writer_stream_p = {
+    .write = esp32_ota_writer_write,
+    .ioctl = esp32_ota_writer_ioctl,
+};
+
+const mp_obj_type_t esp32_ota_writer_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_OTAWriter,
+    .make_new = esp32_ota_writer_make_new,
+    .protocol = &esp32_ota_writer_stream_p,
+    .locals_dict = (mp_obj_dict_t *)&esp32_ota_writer_locals_dict,
+};
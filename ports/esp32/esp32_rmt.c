@@ -41,8 +41,8 @@
 // Originally designed to generate infrared remote control signals, the module is very
 // flexible and quite easy-to-use.
 //
-// This current MicroPython implementation lacks some major features, notably receive pulses
-// and carrier output.
+// A channel is configured either to transmit or (with rx=True) to receive.  Received pulses
+// are collected by the driver into a ring buffer and read out with read_pulses_into.
 
 // Forward declaration
 extern const mp_obj_type_t esp32_rmt_type;
@@ -57,8 +57,78 @@ typedef struct _esp32_rmt_obj_t {
     mp_uint_t num_items;
     rmt_item32_t *items;
     bool loop_en;
+    bool rx;
+    bool bitstream; // whether the bitstream translator is installed
+    mp_obj_t tx_buf; // pre-encoded items being sent, kept so they aren't freed
+    mp_obj_t tx_end_handler;
 } esp32_rmt_obj_t;
 
+// Called by the driver, from its ISR, when a channel finishes transmitting.
+STATIC void esp32_rmt_tx_end_callback(rmt_channel_t channel, void *arg) {
+    esp32_rmt_obj_t *self = MP_STATE_PORT(esp32_rmt_obj)[channel];
+    if (self != NULL && self->tx_end_handler != mp_const_none) {
+        mp_sched_schedule(self->tx_end_handler, MP_OBJ_FROM_PTR(self));
+    }
+}
+
+// For write_bitstream, the item to send for a 0 bit and a 1 bit on each channel.
+STATIC rmt_item32_t esp32_rmt_bitstream_items[8][2];
+
+// Convert bytes from src to items (one per bit, MSB first) as the driver needs them.
+STATIC void esp32_rmt_bitstream_translate(const rmt_item32_t *bit_items, const void *src, rmt_item32_t *dest,
+    size_t src_size, size_t wanted_num, size_t *translated_size, size_t *item_num) {
+    const uint8_t *psrc = src;
+    size_t size = 0;
+    size_t num = 0;
+    while (size < src_size && num + 8 <= wanted_num) {
+        for (int i = 7; i >= 0; --i) {
+            *dest++ = bit_items[(*psrc >> i) & 1];
+        }
+        num += 8;
+        ++size;
+        ++psrc;
+    }
+    *translated_size = size;
+    *item_num = num;
+}
+
+// The driver's translator callback isn't told which channel it's for, so there is one per channel.
+#define ESP32_RMT_BITSTREAM_TRANSLATOR(ch) \
+    STATIC void esp32_rmt_bitstream_translate##ch(const void *src, rmt_item32_t *dest, \
+        size_t src_size, size_t wanted_num, size_t *translated_size, size_t *item_num) { \
+        esp32_rmt_bitstream_translate(esp32_rmt_bitstream_items[ch], src, dest, src_size, wanted_num, translated_size, item_num); \
+    }
+ESP32_RMT_BITSTREAM_TRANSLATOR(0)
+ESP32_RMT_BITSTREAM_TRANSLATOR(1)
+ESP32_RMT_BITSTREAM_TRANSLATOR(2)
+ESP32_RMT_BITSTREAM_TRANSLATOR(3)
+ESP32_RMT_BITSTREAM_TRANSLATOR(4)
+ESP32_RMT_BITSTREAM_TRANSLATOR(5)
+ESP32_RMT_BITSTREAM_TRANSLATOR(6)
+ESP32_RMT_BITSTREAM_TRANSLATOR(7)
+
+STATIC const sample_to_rmt_t esp32_rmt_bitstream_translators[8] = {
+    esp32_rmt_bitstream_translate0, esp32_rmt_bitstream_translate1,
+    esp32_rmt_bitstream_translate2, esp32_rmt_bitstream_translate3,
+    esp32_rmt_bitstream_translate4, esp32_rmt_bitstream_translate5,
+    esp32_rmt_bitstream_translate6, esp32_rmt_bitstream_translate7,
+};
+
+// Encode durations from pulses (alternating in level, starting at start) into items.
+STATIC void esp32_rmt_encode(size_t pulses_length, const mp_obj_t *pulses_ptr, mp_uint_t start, rmt_item32_t *items) {
+    mp_uint_t num_items = (pulses_length / 2) + (pulses_length % 2);
+    for (mp_uint_t item_index = 0; item_index < num_items; item_index++) {
+        mp_uint_t pulse_index = item_index * 2;
+        items[item_index].val = 0;
+        items[item_index].duration0 = mp_obj_get_int(pulses_ptr[pulse_index++]);
+        items[item_index].level0 = start++; // Note that start _could_ wrap.
+        if (pulse_index < pulses_length) {
+            items[item_index].duration1 = mp_obj_get_int(pulses_ptr[pulse_index]);
+            items[item_index].level1 = start++;
+        }
+    }
+}
+
 STATIC mp_obj_t esp32_rmt_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *all_args) {
     static const mp_arg_t allowed_args[] = {
         { MP_QSTR_id,        MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = -1} },
@@ -66,6 +136,9 @@ STATIC mp_obj_t esp32_rmt_make_new(const mp_obj_type_t *type, size_t n_args, siz
         { MP_QSTR_clock_div,                   MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 8} }, // 100ns resolution
         { MP_QSTR_carrier_duty_percent,        MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 50} },
         { MP_QSTR_carrier_freq,                MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_rx,                          MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = false} },
+        { MP_QSTR_idle_threshold,              MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 12000} },
+        { MP_QSTR_rx_buf,                      MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 1024} },
     };
     mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
     mp_arg_parse_all_kw_array(n_args, n_kw, all_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
@@ -87,6 +160,10 @@ STATIC mp_obj_t esp32_rmt_make_new(const mp_obj_type_t *type, size_t n_args, siz
         mp_raise_ValueError(MP_ERROR_TEXT("clock_div must be between 1 and 255"));
     }
 
+    if (channel_id >= RMT_CHANNEL_MAX) {
+        mp_raise_ValueError(MP_ERROR_TEXT("invalid channel"));
+    }
+
     esp32_rmt_obj_t *self = m_new_obj_with_finaliser(esp32_rmt_obj_t);
     self->base.type = &esp32_rmt_type;
     self->channel_id = channel_id;
@@ -95,12 +172,30 @@ STATIC mp_obj_t esp32_rmt_make_new(const mp_obj_type_t *type, size_t n_args, siz
     self->carrier_duty_percent = carrier_duty_percent;
     self->carrier_freq = carrier_freq;
     self->loop_en = false;
+    self->rx = args[5].u_bool;
+    self->bitstream = false;
+    self->tx_buf = MP_OBJ_NULL;
+    self->tx_end_handler = mp_const_none;
 
     rmt_config_t config = {0};
-    config.rmt_mode = RMT_MODE_TX;
     config.channel = (rmt_channel_t)self->channel_id;
     config.gpio_num = self->pin;
     config.mem_block_num = 1;
+    config.clk_div = self->clock_div;
+
+    if (self->rx) {
+        config.rmt_mode = RMT_MODE_RX;
+        config.rx_config.filter_en = false;
+        config.rx_config.idle_threshold = args[6].u_int;
+
+        check_esp_err(rmt_config(&config));
+        check_esp_err(rmt_driver_install(config.channel, args[7].u_int, 0));
+        check_esp_err(rmt_rx_start(config.channel, true));
+
+        return MP_OBJ_FROM_PTR(self);
+    }
+
+    config.rmt_mode = RMT_MODE_TX;
     config.tx_config.loop_en = 0;
 
     config.tx_config.carrier_en = carrier_en;
@@ -110,11 +205,11 @@ STATIC mp_obj_t esp32_rmt_make_new(const mp_obj_type_t *type, size_t n_args, siz
     config.tx_config.carrier_freq_hz = self->carrier_freq;
     config.tx_config.carrier_level = 1;
 
-    config.clk_div = self->clock_div;
-
     check_esp_err(rmt_config(&config));
     check_esp_err(rmt_driver_install(config.channel, 0, 0));
 
+    rmt_register_tx_end_callback(esp32_rmt_tx_end_callback, NULL);
+
     return MP_OBJ_FROM_PTR(self);
 }
 
@@ -123,7 +218,9 @@ STATIC void esp32_rmt_print(const mp_print_t *print, mp_obj_t self_in, mp_print_
     if (self->pin != -1) {
         mp_printf(print, "RMT(channel=%u, pin=%u, source_freq=%u, clock_div=%u",
             self->channel_id, self->pin, APB_CLK_FREQ, self->clock_div);
-        if (self->carrier_freq > 0) {
+        if (self->rx) {
+            mp_printf(print, ", rx=True)");
+        } else if (self->carrier_freq > 0) {
             mp_printf(print, ", carrier_freq=%u, carrier_duty_percent=%u)",
                 self->carrier_freq, self->carrier_duty_percent);
         } else {
@@ -138,9 +235,15 @@ STATIC mp_obj_t esp32_rmt_deinit(mp_obj_t self_in) {
     // fixme: check for valid channel. Return exception if error occurs.
     esp32_rmt_obj_t *self = MP_OBJ_TO_PTR(self_in);
     if (self->pin != -1) { // Check if channel has already been deinitialised.
+        if (MP_STATE_PORT(esp32_rmt_obj)[self->channel_id] == self) {
+            MP_STATE_PORT(esp32_rmt_obj)[self->channel_id] = NULL;
+        }
         rmt_driver_uninstall(self->channel_id);
         self->pin = -1; // -1 to indicate RMT is unused
         m_free(self->items);
+        self->items = NULL;
+        self->num_items = 0;
+        self->tx_buf = MP_OBJ_NULL;
     }
     return mp_const_none;
 }
@@ -209,28 +312,37 @@ STATIC mp_obj_t esp32_rmt_write_pulses(size_t n_args, const mp_obj_t *pos_args,
     mp_obj_t pulses = args[1].u_obj;
     mp_uint_t start = args[2].u_int;
 
-    if (start > 1) {
-        mp_raise_ValueError(MP_ERROR_TEXT("start must be 0 or 1"));
+    if (self->rx) {
+        mp_raise_ValueError(MP_ERROR_TEXT("channel is configured for rx"));
     }
 
-    size_t pulses_length = 0;
-    mp_obj_t *pulses_ptr = NULL;
-    mp_obj_get_array(pulses, &pulses_length, &pulses_ptr);
-
-    mp_uint_t num_items = (pulses_length / 2) + (pulses_length % 2);
-    if (num_items > self->num_items) {
-        self->items = (rmt_item32_t *)m_realloc(self->items, num_items * sizeof(rmt_item32_t *));
-        self->num_items = num_items;
+    if (start > 1) {
+        mp_raise_ValueError(MP_ERROR_TEXT("start must be 0 or 1"));
     }
 
-    for (mp_uint_t item_index = 0; item_index < num_items; item_index++) {
-        mp_uint_t pulse_index = item_index * 2;
-        self->items[item_index].duration0 = mp_obj_get_int(pulses_ptr[pulse_index++]);
-        self->items[item_index].level0 = start++; // Note that start _could_ wrap.
-        if (pulse_index < pulses_length) {
-            self->items[item_index].duration1 = mp_obj_get_int(pulses_ptr[pulse_index]);
-            self->items[item_index].level1 = start++;
+    rmt_item32_t *items;
+    mp_uint_t num_items;
+    mp_buffer_info_t bufinfo;
+    if (mp_get_buffer(pulses, &bufinfo, MP_BUFFER_READ)) {
+        // Items pre-encoded by encode_pulses are sent directly from the buffer.
+        if (((uintptr_t)bufinfo.buf & 3) || (bufinfo.len & 3)) {
+            mp_raise_ValueError(MP_ERROR_TEXT("invalid buffer"));
+        }
+        items = bufinfo.buf;
+        num_items = bufinfo.len / sizeof(rmt_item32_t);
+    } else {
+        size_t pulses_length = 0;
+        mp_obj_t *pulses_ptr = NULL;
+        mp_obj_get_array(pulses, &pulses_length, &pulses_ptr);
+
+        num_items = (pulses_length / 2) + (pulses_length % 2);
+        if (num_items > self->num_items) {
+            self->items = (rmt_item32_t *)m_realloc(self->items, num_items * sizeof(rmt_item32_t));
+            self->num_items = num_items;
         }
+        esp32_rmt_encode(pulses_length, pulses_ptr, start, self->items);
+        items = self->items;
+        pulses = MP_OBJ_NULL;
     }
 
     if (self->loop_en) {
@@ -244,7 +356,8 @@ STATIC mp_obj_t esp32_rmt_write_pulses(size_t n_args, const mp_obj_t *pos_args,
         check_esp_err(rmt_set_tx_intr_en(self->channel_id, false));
     }
 
-    check_esp_err(rmt_write_items(self->channel_id, self->items, num_items, false /* non-blocking */));
+    self->tx_buf = pulses;
+    check_esp_err(rmt_write_items(self->channel_id, items, num_items, false /* non-blocking */));
 
     if (self->loop_en) {
         check_esp_err(rmt_set_tx_loop_mode(self->channel_id, true));
@@ -254,6 +367,151 @@ STATIC mp_obj_t esp32_rmt_write_pulses(size_t n_args, const mp_obj_t *pos_args,
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_KW(esp32_rmt_write_pulses_obj, 2, esp32_rmt_write_pulses);
 
+// Send the bits of the bytes in buf, MSB first, where timing is a 4-tuple of
+// (high, low) durations in ticks for a 0 bit followed by those for a 1 bit.
+// The bytes are converted by the driver as it sends them, so buf is used
+// without copying.  Returns without waiting for the transmission to finish.
+STATIC mp_obj_t esp32_rmt_write_bitstream(mp_obj_t self_in, mp_obj_t buf_in, mp_obj_t timing_in) {
+    esp32_rmt_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    if (self->rx) {
+        mp_raise_ValueError(MP_ERROR_TEXT("channel is configured for rx"));
+    }
+
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_READ);
+
+    mp_obj_t *timing;
+    mp_obj_get_array_fixed_n(timing_in, 4, &timing);
+
+    // Wait for any previous transmission, which may still use the bit items.
+    check_esp_err(rmt_wait_tx_done(self->channel_id, portMAX_DELAY));
+
+    rmt_item32_t *bit_items = esp32_rmt_bitstream_items[self->channel_id];
+    for (size_t i = 0; i < 2; ++i) {
+        bit_items[i].val = 0;
+        bit_items[i].duration0 = mp_obj_get_int(timing[i * 2]);
+        bit_items[i].level0 = 1;
+        bit_items[i].duration1 = mp_obj_get_int(timing[i * 2 + 1]);
+        bit_items[i].level1 = 0;
+    }
+
+    if (!self->bitstream) {
+        check_esp_err(rmt_translator_init(self->channel_id, esp32_rmt_bitstream_translators[self->channel_id]));
+        self->bitstream = true;
+    }
+
+    self->tx_buf = buf_in;
+    check_esp_err(rmt_write_sample(self->channel_id, bufinfo.buf, bufinfo.len, false /* non-blocking */));
+
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(esp32_rmt_write_bitstream_obj, esp32_rmt_write_bitstream);
+
+// Encode a list or tuple of pulses into a bytearray of RMT items, which can be
+// passed to write_pulses any number of times without being converted again.
+STATIC mp_obj_t esp32_rmt_encode_pulses(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_self,   MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = mp_const_none} },
+        { MP_QSTR_pulses, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = mp_const_none} },
+        { MP_QSTR_start,  MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 1} },
+    };
+
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    mp_uint_t start = args[2].u_int;
+    if (start > 1) {
+        mp_raise_ValueError(MP_ERROR_TEXT("start must be 0 or 1"));
+    }
+
+    size_t pulses_length = 0;
+    mp_obj_t *pulses_ptr = NULL;
+    mp_obj_get_array(args[1].u_obj, &pulses_length, &pulses_ptr);
+
+    mp_uint_t num_items = (pulses_length / 2) + (pulses_length % 2);
+    mp_obj_t buf = mp_obj_new_bytearray(num_items * sizeof(rmt_item32_t), NULL);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf, &bufinfo, MP_BUFFER_WRITE);
+    esp32_rmt_encode(pulses_length, pulses_ptr, start, bufinfo.buf);
+    return buf;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(esp32_rmt_encode_pulses_obj, 2, esp32_rmt_encode_pulses);
+
+// Set a function to be scheduled, with the RMT object as its argument, each
+// time the channel finishes transmitting.  It can call write_pulses to send
+// the next block of a stream.
+STATIC mp_obj_t esp32_rmt_irq(mp_obj_t self_in, mp_obj_t handler) {
+    esp32_rmt_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (handler != mp_const_none && !mp_obj_is_callable(handler)) {
+        mp_raise_ValueError(MP_ERROR_TEXT("handler must be None or callable"));
+    }
+    if (self->rx) {
+        mp_raise_ValueError(MP_ERROR_TEXT("channel is configured for rx"));
+    }
+    self->tx_end_handler = handler;
+    // Only reference the object from the ISR's table while it has a handler,
+    // so otherwise it can still be reclaimed (and deinitialised) by the GC.
+    MP_STATE_PORT(esp32_rmt_obj)[self->channel_id] = handler == mp_const_none ? NULL : self;
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(esp32_rmt_irq_obj, esp32_rmt_irq);
+
+// Wait for a frame of pulses (ended by the line being idle for idle_threshold
+// ticks) and store their durations into buf, an array of signed 16-bit values,
+// as positive values for high pulses and negative for low ones.  Returns the
+// number of values stored, or 0 if timeout_ms passes first.
+STATIC mp_obj_t esp32_rmt_read_pulses_into(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_self,       MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = mp_const_none} },
+        { MP_QSTR_buf,        MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = mp_const_none} },
+        { MP_QSTR_timeout_ms, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = -1} },
+    };
+
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    esp32_rmt_obj_t *self = MP_OBJ_TO_PTR(args[0].u_obj);
+    if (!self->rx) {
+        mp_raise_ValueError(MP_ERROR_TEXT("channel is not configured for rx"));
+    }
+
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[1].u_obj, &bufinfo, MP_BUFFER_WRITE);
+    int16_t *dest = bufinfo.buf;
+    size_t dest_len = bufinfo.len / sizeof(int16_t);
+
+    RingbufHandle_t ringbuf;
+    check_esp_err(rmt_get_ringbuf_handle(self->channel_id, &ringbuf));
+
+    mp_int_t timeout_ms = args[2].u_int;
+    TickType_t ticks = timeout_ms < 0 ? portMAX_DELAY : timeout_ms / portTICK_PERIOD_MS;
+    size_t rx_size = 0;
+    MP_THREAD_GIL_EXIT();
+    rmt_item32_t *items = (rmt_item32_t *)xRingbufferReceive(ringbuf, &rx_size, ticks);
+    MP_THREAD_GIL_ENTER();
+    if (items == NULL) {
+        return MP_OBJ_NEW_SMALL_INT(0);
+    }
+
+    // A zero duration marks the end of the frame.
+    size_t n = 0;
+    for (size_t i = 0; i < rx_size / sizeof(rmt_item32_t) && n < dest_len; ++i) {
+        if (items[i].duration0 == 0) {
+            break;
+        }
+        dest[n++] = items[i].level0 ? items[i].duration0 : -items[i].duration0;
+        if (items[i].duration1 == 0 || n == dest_len) {
+            break;
+        }
+        dest[n++] = items[i].level1 ? items[i].duration1 : -items[i].duration1;
+    }
+    vRingbufferReturnItem(ringbuf, items);
+
+    return MP_OBJ_NEW_SMALL_INT(n);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(esp32_rmt_read_pulses_into_obj, 2, esp32_rmt_read_pulses_into);
+
 STATIC const mp_rom_map_elem_t esp32_rmt_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR___del__), MP_ROM_PTR(&esp32_rmt_deinit_obj) },
     { MP_ROM_QSTR(MP_QSTR_deinit), MP_ROM_PTR(&esp32_rmt_deinit_obj) },
@@ -262,6 +520,10 @@ STATIC const mp_rom_map_elem_t esp32_rmt_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_wait_done), MP_ROM_PTR(&esp32_rmt_wait_done_obj) },
     { MP_ROM_QSTR(MP_QSTR_loop), MP_ROM_PTR(&esp32_rmt_loop_obj) },
     { MP_ROM_QSTR(MP_QSTR_write_pulses), MP_ROM_PTR(&esp32_rmt_write_pulses_obj) },
+    { MP_ROM_QSTR(MP_QSTR_encode_pulses), MP_ROM_PTR(&esp32_rmt_encode_pulses_obj) },
+    { MP_ROM_QSTR(MP_QSTR_write_bitstream), MP_ROM_PTR(&esp32_rmt_write_bitstream_obj) },
+    { MP_ROM_QSTR(MP_QSTR_irq), MP_ROM_PTR(&esp32_rmt_irq_obj) },
+    { MP_ROM_QSTR(MP_QSTR_read_pulses_into), MP_ROM_PTR(&esp32_rmt_read_pulses_into_obj) },
 };
 STATIC MP_DEFINE_CONST_DICT(esp32_rmt_locals_dict, esp32_rmt_locals_dict_table);
 
@@ -25,12 +25,29 @@
  */
 
 #include "py/runtime.h"
+#include "py/mperrno.h"
 
 #if CONFIG_IDF_TARGET_ESP32
 
 #include "esp32/ulp.h"
 #include "esp_err.h"
 
+// The part of RTC slow memory reserved for the ULP, where its program and
+// data live.  The ULP addresses it in 32-bit words, and its ST instruction
+// writes only the low 16 bits of a word.
+#define ULP_MEM_SIZE (CONFIG_ESP32_ULP_COPROC_RESERVE_MEM)
+
+// A ring buffer in ULP memory, through which the ULP passes 16-bit samples
+// to the main CPU: four header words then the sample slots, one per word.
+// The ULP advances head and the CPU advances tail, and a sample is dropped
+// (and counted) when the ring is full.  ports/esp32/ulp/ring.h has the ULP
+// side of this.
+#define ULP_RING_HEAD (0)
+#define ULP_RING_TAIL (1)
+#define ULP_RING_SIZE (2)
+#define ULP_RING_DROPPED (3)
+#define ULP_RING_HEADER_WORDS (4)
+
 typedef struct _esp32_ulp_obj_t {
     mp_obj_base_t base;
 } esp32_ulp_obj_t;
@@ -83,10 +100,86 @@ STATIC mp_obj_t esp32_ulp_run(mp_obj_t self_in, mp_obj_t entry_point_in) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(esp32_ulp_run_obj, esp32_ulp_run);
 
+// Return the words of ULP memory from byte offset, and check that there are
+// nwords of them.
+STATIC volatile uint32_t *esp32_ulp_get_words(mp_obj_t offset_in, size_t nwords) {
+    mp_uint_t offset = mp_obj_get_int(offset_in);
+    if (offset % 4 != 0 || offset > ULP_MEM_SIZE || nwords > (ULP_MEM_SIZE - offset) / 4) {
+        mp_raise_ValueError(MP_ERROR_TEXT("outside ULP memory"));
+    }
+    return RTC_SLOW_MEM + offset / 4;
+}
+
+// ULP.mem([offset, [length]]): a memoryview of 32-bit words over ULP memory,
+// from the given byte offset, to read and write the ULP's variables.
+STATIC mp_obj_t esp32_ulp_mem(size_t n_args, const mp_obj_t *args) {
+    mp_obj_t offset_in = n_args > 1 ? args[1] : MP_OBJ_NEW_SMALL_INT(0);
+    mp_uint_t offset = mp_obj_get_int(offset_in);
+    size_t nwords = offset <= ULP_MEM_SIZE ? (ULP_MEM_SIZE - offset) / 4 : 0;
+    if (n_args > 2) {
+        nwords = mp_obj_get_int(args[2]) / 4;
+    }
+    volatile uint32_t *words = esp32_ulp_get_words(offset_in, nwords);
+    return mp_obj_new_memoryview('I', nwords, (void *)words);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(esp32_ulp_mem_obj, 1, 3, esp32_ulp_mem);
+
+// ULP.ring_init(offset, size): set up an empty ring of size samples at the
+// given byte offset, after loading the ULP program and before running it.
+STATIC mp_obj_t esp32_ulp_ring_init(mp_obj_t self_in, mp_obj_t offset_in, mp_obj_t size_in) {
+    mp_int_t size = mp_obj_get_int(size_in);
+    if (size < 2 || size > 0xffff) {
+        mp_raise_ValueError(MP_ERROR_TEXT("invalid size"));
+    }
+    volatile uint32_t *ring = esp32_ulp_get_words(offset_in, ULP_RING_HEADER_WORDS + size);
+    ring[ULP_RING_HEAD] = 0;
+    ring[ULP_RING_TAIL] = 0;
+    ring[ULP_RING_SIZE] = size;
+    ring[ULP_RING_DROPPED] = 0;
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(esp32_ulp_ring_init_obj, esp32_ulp_ring_init);
+
+// ULP.ring_read(offset, buf): move the samples in the ring into buf, as
+// 16-bit values, and return how many were moved.
+STATIC mp_obj_t esp32_ulp_ring_read(mp_obj_t self_in, mp_obj_t offset_in, mp_obj_t buf_in) {
+    volatile uint32_t *ring = esp32_ulp_get_words(offset_in, ULP_RING_HEADER_WORDS);
+    uint32_t size = ring[ULP_RING_SIZE];
+    // The ULP writes head, with junk in the upper half, after the sample.
+    uint32_t head = ring[ULP_RING_HEAD] & 0xffff;
+    uint32_t tail = ring[ULP_RING_TAIL];
+    if (size < 2 || size > 0xffff || head >= size || tail >= size) {
+        mp_raise_OSError(MP_EIO);
+    }
+    esp32_ulp_get_words(offset_in, ULP_RING_HEADER_WORDS + size);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_WRITE);
+    uint8_t *buf = bufinfo.buf;
+    size_t max = bufinfo.len / 2;
+
+    // Samples are stored a byte at a time, as buf may not be aligned.
+    size_t n = 0;
+    while (tail != head && n < max) {
+        uint32_t sample = ring[ULP_RING_HEADER_WORDS + tail];
+        buf[2 * n] = sample;
+        buf[2 * n + 1] = sample >> 8;
+        ++n;
+        if (++tail == size) {
+            tail = 0;
+        }
+    }
+    ring[ULP_RING_TAIL] = tail;
+    return MP_OBJ_NEW_SMALL_INT(n);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(esp32_ulp_ring_read_obj, esp32_ulp_ring_read);
+
 STATIC const mp_rom_map_elem_t esp32_ulp_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_set_wakeup_period), MP_ROM_PTR(&esp32_ulp_set_wakeup_period_obj) },
     { MP_ROM_QSTR(MP_QSTR_load_binary), MP_ROM_PTR(&esp32_ulp_load_binary_obj) },
     { MP_ROM_QSTR(MP_QSTR_run), MP_ROM_PTR(&esp32_ulp_run_obj) },
+    { MP_ROM_QSTR(MP_QSTR_mem), MP_ROM_PTR(&esp32_ulp_mem_obj) },
+    { MP_ROM_QSTR(MP_QSTR_ring_init), MP_ROM_PTR(&esp32_ulp_ring_init_obj) },
+    { MP_ROM_QSTR(MP_QSTR_ring_read), MP_ROM_PTR(&esp32_ulp_ring_read_obj) },
     { MP_ROM_QSTR(MP_QSTR_RESERVE_MEM), MP_ROM_INT(CONFIG_ESP32_ULP_COPROC_RESERVE_MEM) },
 };
 STATIC MP_DEFINE_CONST_DICT(esp32_ulp_locals_dict, esp32_ulp_locals_dict_table);
@@ -53,12 +53,24 @@
 #define MP_HW_SPI_MAX_XFER_BYTES (4092)
 #define MP_HW_SPI_MAX_XFER_BITS (MP_HW_SPI_MAX_XFER_BYTES * 8) // Has to be an even multiple of 8
 
+// Asynchronous transfers are queued to the driver as transactions of up to this
+// many bytes, with up to MP_HW_SPI_ASYNC_QUEUE_LEN of them in flight at once.
+#define MP_HW_SPI_ASYNC_MAX_XFER_BYTES (64 * 1024)
+#define MP_HW_SPI_ASYNC_MAX_XFER_BITS (MP_HW_SPI_ASYNC_MAX_XFER_BYTES * 8)
+#define MP_HW_SPI_ASYNC_QUEUE_LEN (2)
+
 typedef struct _machine_hw_spi_default_pins_t {
     int8_t sck;
     int8_t mosi;
     int8_t miso;
 } machine_hw_spi_default_pins_t;
 
+// Object returned by the *_async methods, used to wait for their completion.
+typedef struct _machine_hw_spi_async_obj_t {
+    mp_obj_base_t base;
+    struct _machine_hw_spi_obj_t *spi;
+} machine_hw_spi_async_obj_t;
+
 typedef struct _machine_hw_spi_obj_t {
     mp_obj_base_t base;
     spi_host_device_t host;
@@ -76,8 +88,14 @@ typedef struct _machine_hw_spi_obj_t {
         MACHINE_HW_SPI_STATE_INIT,
         MACHINE_HW_SPI_STATE_DEINIT
     } state;
+    machine_hw_spi_async_obj_t async_obj;
+    spi_transaction_t async_trans[MP_HW_SPI_ASYNC_QUEUE_LEN];
+    uint8_t async_head; // index in async_trans of the oldest queued transaction
+    uint8_t async_count; // number of transactions queued and not yet collected
 } machine_hw_spi_obj_t;
 
+STATIC const mp_obj_type_t machine_hw_spi_async_type;
+
 // Default pin mappings for the hardware SPI instances
 STATIC const machine_hw_spi_default_pins_t machine_hw_spi_default_pins[2] = {
     { .sck = MICROPY_HW_SPI1_SCK, .mosi = MICROPY_HW_SPI1_MOSI, .miso = MICROPY_HW_SPI1_MISO },
@@ -87,6 +105,51 @@ STATIC const machine_hw_spi_default_pins_t machine_hw_spi_default_pins[2] = {
 // Static objects mapping to HSPI and VSPI hardware peripherals
 STATIC machine_hw_spi_obj_t machine_hw_spi_obj[2];
 
+// The buffers of queued asynchronous transactions are held in root pointers so
+// they aren't freed while the DMA is using them: a write and read buffer for
+// each queue slot of each bus.
+STATIC mp_obj_t *machine_hw_spi_async_bufs(machine_hw_spi_obj_t *self, size_t slot) {
+    MP_STATIC_ASSERT(MP_ARRAY_SIZE(MP_STATE_PORT(machine_hw_spi_async_buf)) == 2 * MP_HW_SPI_ASYNC_QUEUE_LEN * 2);
+    return &MP_STATE_PORT(machine_hw_spi_async_buf)[((self - &machine_hw_spi_obj[0]) * MP_HW_SPI_ASYNC_QUEUE_LEN + slot) * 2];
+}
+
+// Collect the oldest queued asynchronous transaction.  If block is false and
+// it has not finished yet then return false without waiting.
+STATIC bool machine_hw_spi_async_collect(machine_hw_spi_obj_t *self, bool block) {
+    spi_transaction_t *trans;
+    esp_err_t ret;
+    if (block) {
+        MP_THREAD_GIL_EXIT();
+        ret = spi_device_get_trans_result(self->spi, &trans, portMAX_DELAY);
+        MP_THREAD_GIL_ENTER();
+    } else {
+        ret = spi_device_get_trans_result(self->spi, &trans, 0);
+    }
+    if (ret != ESP_OK) {
+        return false;
+    }
+    mp_obj_t *bufs = machine_hw_spi_async_bufs(self, self->async_head);
+    bufs[0] = MP_OBJ_NULL;
+    bufs[1] = MP_OBJ_NULL;
+    self->async_head = (self->async_head + 1) % MP_HW_SPI_ASYNC_QUEUE_LEN;
+    --self->async_count;
+    return true;
+}
+
+// Collect all finished asynchronous transactions, returning true if none remain.
+STATIC bool machine_hw_spi_async_poll(machine_hw_spi_obj_t *self) {
+    while (self->async_count && machine_hw_spi_async_collect(self, false)) {
+    }
+    return self->async_count == 0;
+}
+
+// Wait for all queued asynchronous transactions to finish.
+STATIC void machine_hw_spi_async_flush(machine_hw_spi_obj_t *self) {
+    while (self->async_count) {
+        machine_hw_spi_async_collect(self, true);
+    }
+}
+
 STATIC void machine_hw_spi_deinit_internal(machine_hw_spi_obj_t *self) {
     switch (spi_bus_remove_device(self->spi)) {
         case ESP_ERR_INVALID_ARG:
@@ -137,6 +200,10 @@ STATIC void machine_hw_spi_init_internal(
 
     esp_err_t ret;
 
+    if (self->state == MACHINE_HW_SPI_STATE_INIT) {
+        machine_hw_spi_async_flush(self);
+    }
+
     machine_hw_spi_obj_t old_self = *self;
 
     if (host != -1 && host != self->host) {
@@ -206,14 +273,15 @@ STATIC void machine_hw_spi_init_internal(
         .mosi_io_num = self->mosi,
         .sclk_io_num = self->sck,
         .quadwp_io_num = -1,
-        .quadhd_io_num = -1
+        .quadhd_io_num = -1,
+        .max_transfer_sz = MP_HW_SPI_ASYNC_MAX_XFER_BYTES,
     };
 
     spi_device_interface_config_t devcfg = {
         .clock_speed_hz = self->baudrate,
         .mode = self->phase | (self->polarity << 1),
         .spics_io_num = -1, // No CS pin
-        .queue_size = 1,
+        .queue_size = MP_HW_SPI_ASYNC_QUEUE_LEN,
         .flags = self->firstbit == MICROPY_PY_MACHINE_SPI_LSB ? SPI_DEVICE_TXBIT_LSBFIRST | SPI_DEVICE_RXBIT_LSBFIRST : 0,
         .pre_cb = NULL
     };
@@ -264,11 +332,21 @@ STATIC void machine_hw_spi_init_internal(
 STATIC void machine_hw_spi_deinit(mp_obj_base_t *self_in) {
     machine_hw_spi_obj_t *self = (machine_hw_spi_obj_t *)self_in;
     if (self->state == MACHINE_HW_SPI_STATE_INIT) {
+        machine_hw_spi_async_flush(self);
         self->state = MACHINE_HW_SPI_STATE_DEINIT;
         machine_hw_spi_deinit_internal(self);
     }
 }
 
+// Wait for any asynchronous transfers to finish, eg before a soft reset frees their buffers.
+void machine_hw_spi_deinit_all(void) {
+    for (size_t i = 0; i < MP_ARRAY_SIZE(machine_hw_spi_obj); ++i) {
+        if (machine_hw_spi_obj[i].state == MACHINE_HW_SPI_STATE_INIT) {
+            machine_hw_spi_async_flush(&machine_hw_spi_obj[i]);
+        }
+    }
+}
+
 STATIC void machine_hw_spi_transfer(mp_obj_base_t *self_in, size_t len, const uint8_t *src, uint8_t *dest) {
     machine_hw_spi_obj_t *self = MP_OBJ_TO_PTR(self_in);
 
@@ -277,6 +355,9 @@ STATIC void machine_hw_spi_transfer(mp_obj_base_t *self_in, size_t len, const ui
         return;
     }
 
+    // A synchronous transfer must come after any queued ones.
+    machine_hw_spi_async_flush(self);
+
     struct spi_transaction_t transaction = { 0 };
 
     // Round to nearest whole set of bits
@@ -321,6 +402,46 @@ STATIC void machine_hw_spi_transfer(mp_obj_base_t *self_in, size_t len, const ui
     }
 }
 
+// Queue a transfer on the DMA without waiting for it to finish.  If the
+// driver's queue is full then wait for the oldest transaction to make room.
+STATIC void machine_hw_spi_transfer_async(machine_hw_spi_obj_t *self, mp_obj_t src_obj, const uint8_t *src, mp_obj_t dest_obj, uint8_t *dest, size_t len) {
+    if (self->state != MACHINE_HW_SPI_STATE_INIT) {
+        mp_raise_msg(&mp_type_OSError, MP_ERROR_TEXT("transfer on deinitialized SPI"));
+    }
+
+    // Round to nearest whole set of bits
+    size_t bits_remaining = len * 8 / self->bits * self->bits;
+    size_t offset = 0;
+
+    while (bits_remaining) {
+        if (self->async_count == MP_HW_SPI_ASYNC_QUEUE_LEN) {
+            machine_hw_spi_async_collect(self, true);
+        }
+
+        size_t slot = (self->async_head + self->async_count) % MP_HW_SPI_ASYNC_QUEUE_LEN;
+        spi_transaction_t *trans = &self->async_trans[slot];
+        memset(trans, 0, sizeof(*trans));
+        trans->length = MIN(bits_remaining, MP_HW_SPI_ASYNC_MAX_XFER_BITS);
+        if (src != NULL) {
+            trans->tx_buffer = src + offset;
+        }
+        if (dest != NULL) {
+            trans->rx_buffer = dest + offset;
+        }
+
+        // The driver copies to a DMA-capable bounce buffer if needed.
+        check_esp_err(spi_device_queue_trans(self->spi, trans, portMAX_DELAY));
+
+        mp_obj_t *bufs = machine_hw_spi_async_bufs(self, slot);
+        bufs[0] = src_obj;
+        bufs[1] = dest_obj;
+        ++self->async_count;
+
+        bits_remaining -= trans->length;
+        offset += trans->length / 8;
+    }
+}
+
 /******************************************************************************/
 // MicroPython bindings for hw_spi
 
@@ -410,6 +531,8 @@ mp_obj_t machine_hw_spi_make_new(const mp_obj_type_t *type, size_t n_args, size_
         default_pins = &machine_hw_spi_default_pins[1];
     }
     self->base.type = &machine_hw_spi_type;
+    self->async_obj.base.type = &machine_hw_spi_async_type;
+    self->async_obj.spi = self;
 
     machine_hw_spi_init_internal(
         self,
@@ -426,6 +549,44 @@ mp_obj_t machine_hw_spi_make_new(const mp_obj_type_t *type, size_t n_args, size_
     return MP_OBJ_FROM_PTR(self);
 }
 
+STATIC mp_obj_t machine_hw_spi_write_async(mp_obj_t self_in, mp_obj_t wr_buf) {
+    machine_hw_spi_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_buffer_info_t src;
+    mp_get_buffer_raise(wr_buf, &src, MP_BUFFER_READ);
+    machine_hw_spi_transfer_async(self, wr_buf, src.buf, MP_OBJ_NULL, NULL, src.len);
+    return MP_OBJ_FROM_PTR(&self->async_obj);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(machine_hw_spi_write_async_obj, machine_hw_spi_write_async);
+
+STATIC mp_obj_t machine_hw_spi_write_readinto_async(mp_obj_t self_in, mp_obj_t wr_buf, mp_obj_t rd_buf) {
+    machine_hw_spi_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_buffer_info_t src;
+    mp_get_buffer_raise(wr_buf, &src, MP_BUFFER_READ);
+    mp_buffer_info_t dest;
+    mp_get_buffer_raise(rd_buf, &dest, MP_BUFFER_WRITE);
+    if (src.len != dest.len) {
+        mp_raise_ValueError(MP_ERROR_TEXT("buffers must be the same length"));
+    }
+    machine_hw_spi_transfer_async(self, wr_buf, src.buf, rd_buf, dest.buf, src.len);
+    return MP_OBJ_FROM_PTR(&self->async_obj);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(machine_hw_spi_write_readinto_async_obj, machine_hw_spi_write_readinto_async);
+
+STATIC const mp_rom_map_elem_t machine_hw_spi_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_init), MP_ROM_PTR(&mp_machine_spi_init_obj) },
+    { MP_ROM_QSTR(MP_QSTR_deinit), MP_ROM_PTR(&mp_machine_spi_deinit_obj) },
+    { MP_ROM_QSTR(MP_QSTR_read), MP_ROM_PTR(&mp_machine_spi_read_obj) },
+    { MP_ROM_QSTR(MP_QSTR_readinto), MP_ROM_PTR(&mp_machine_spi_readinto_obj) },
+    { MP_ROM_QSTR(MP_QSTR_write), MP_ROM_PTR(&mp_machine_spi_write_obj) },
+    { MP_ROM_QSTR(MP_QSTR_write_readinto), MP_ROM_PTR(&mp_machine_spi_write_readinto_obj) },
+    { MP_ROM_QSTR(MP_QSTR_write_async), MP_ROM_PTR(&machine_hw_spi_write_async_obj) },
+    { MP_ROM_QSTR(MP_QSTR_write_readinto_async), MP_ROM_PTR(&machine_hw_spi_write_readinto_async_obj) },
+
+    { MP_ROM_QSTR(MP_QSTR_MSB), MP_ROM_INT(MICROPY_PY_MACHINE_SPI_MSB) },
+    { MP_ROM_QSTR(MP_QSTR_LSB), MP_ROM_INT(MICROPY_PY_MACHINE_SPI_LSB) },
+};
+STATIC MP_DEFINE_CONST_DICT(machine_hw_spi_locals_dict, machine_hw_spi_locals_dict_table);
+
 STATIC const mp_machine_spi_p_t machine_hw_spi_p = {
     .init = machine_hw_spi_init,
     .deinit = machine_hw_spi_deinit,
@@ -438,5 +599,68 @@ const mp_obj_type_t machine_hw_spi_type = {
     .print = machine_hw_spi_print,
     .make_new = machine_hw_spi_make_new,
     .protocol = &machine_hw_spi_p,
-    .locals_dict = (mp_obj_dict_t *)&mp_machine_spi_locals_dict,
+    .locals_dict = (mp_obj_dict_t *)&machine_hw_spi_locals_dict,
+};
+
+/******************************************************************************/
+// MicroPython bindings for the completion object of asynchronous transfers
+
+STATIC mp_obj_t machine_hw_spi_async_done(mp_obj_t self_in) {
+    machine_hw_spi_async_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    return mp_obj_new_bool(machine_hw_spi_async_poll(self->spi));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(machine_hw_spi_async_done_obj, machine_hw_spi_async_done);
+
+STATIC mp_obj_t machine_hw_spi_async_wait(mp_obj_t self_in) {
+    machine_hw_spi_async_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    machine_hw_spi_async_flush(self->spi);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(machine_hw_spi_async_wait_obj, machine_hw_spi_async_wait);
+
+// Reading gives EOF once all transfers have finished, so that a
+// uasyncio.StreamReader on this object can be used to await completion.
+STATIC mp_uint_t machine_hw_spi_async_read(mp_obj_t self_in, void *buf_in, mp_uint_t size, int *errcode) {
+    machine_hw_spi_async_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (!machine_hw_spi_async_poll(self->spi)) {
+        *errcode = MP_EAGAIN;
+        return MP_STREAM_ERROR;
+    }
+    return 0;
+}
+
+STATIC mp_uint_t machine_hw_spi_async_ioctl(mp_obj_t self_in, mp_uint_t request, uintptr_t arg, int *errcode) {
+    machine_hw_spi_async_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (request == MP_STREAM_POLL) {
+        uintptr_t flags = arg;
+        mp_uint_t ret = 0;
+        if ((flags & MP_STREAM_POLL_RD) && machine_hw_spi_async_poll(self->spi)) {
+            ret |= MP_STREAM_POLL_RD;
+        }
+        if ((flags & MP_STREAM_POLL_WR) && self->spi->async_count < MP_HW_SPI_ASYNC_QUEUE_LEN) {
+            ret |= MP_STREAM_POLL_WR;
+        }
+        return ret;
+    }
+    *errcode = MP_EINVAL;
+    return MP_STREAM_ERROR;
+}
+
+STATIC const mp_rom_map_elem_t machine_hw_spi_async_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_done), MP_ROM_PTR(&machine_hw_spi_async_done_obj) },
+    { MP_ROM_QSTR(MP_QSTR_wait), MP_ROM_PTR(&machine_hw_spi_async_wait_obj) },
+    { MP_ROM_QSTR(MP_QSTR_read), MP_ROM_PTR(&mp_stream_read_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(machine_hw_spi_async_locals_dict, machine_hw_spi_async_locals_dict_table);
+
+STATIC const mp_stream_p_t machine_hw_spi_async_stream_p = {
+    .read = machine_hw_spi_async_read,
+    .ioctl = machine_hw_spi_async_ioctl,
+};
+
+STATIC const mp_obj_type_t machine_hw_spi_async_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_SPIAsync,
+    .protocol = &machine_hw_spi_async_stream_p,
+    .locals_dict = (mp_obj_dict_t *)&machine_hw_spi_async_locals_dict,
 };
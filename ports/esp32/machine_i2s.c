@@ -0,0 +1,162 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "py/runtime.h"
+#include "py/mperrno.h"
+#include "py/mphal.h"
+#include "extmod/machine_i2s.h"
+#include "modmachine.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "driver/i2s.h"
+#include "esp_task.h"
+
+#if MICROPY_PY_MACHINE_I2S
+
+// The IDF driver runs the DMA over a chain of buffers and posts an event to
+// a queue each time it finishes one.  A task waiting on the queue moves one
+// buffer of samples between the driver and the ring buffer per event, so the
+// MicroPython task only ever copies to and from memory.  The driver sends
+// both channels of a mono stream itself, so samples are in the user's
+// format throughout.
+
+#define I2S_DMA_BUF_COUNT (4)
+// In frames: 5.3ms at 48kHz.
+#define I2S_DMA_BUF_LEN (256)
+
+#define I2S_TASK_PRIORITY (ESP_TASK_PRIO_MIN + 2)
+#define I2S_TASK_STACK_SIZE (2048)
+
+typedef struct _machine_i2s_port_obj_t {
+    machine_i2s_obj_t i2s;
+    QueueHandle_t queue;
+    TaskHandle_t task;
+    size_t buf_len;
+    uint8_t *buf;
+} machine_i2s_port_obj_t;
+
+machine_i2s_obj_t *mp_machine_i2s_port_get(mp_int_t id) {
+    if (id < 0 || id >= I2S_NUM_MAX) {
+        mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("I2S(%d) doesn't exist"), id);
+    }
+    machine_i2s_port_obj_t *self = MP_STATE_PORT(machine_i2s_obj)[id];
+    if (self == NULL) {
+        self = m_new0(machine_i2s_port_obj_t, 1);
+        self->i2s.base.type = &machine_i2s_type;
+        self->i2s.id = id;
+        MP_STATE_PORT(machine_i2s_obj)[id] = self;
+    }
+    return &self->i2s;
+}
+
+STATIC void machine_i2s_task(void *arg) {
+    machine_i2s_port_obj_t *self = arg;
+    for (;;) {
+        i2s_event_t event;
+        if (xQueueReceive(self->queue, &event, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        size_t n;
+        if (event.type == I2S_EVENT_RX_DONE) {
+            i2s_read(self->i2s.id, self->buf, self->buf_len, &n, 0);
+            machine_i2s_dma_rx(&self->i2s, self->buf, n, false);
+        } else if (event.type == I2S_EVENT_TX_DONE) {
+            // A DMA buffer has just been freed, so this doesn't wait long.
+            machine_i2s_dma_tx(&self->i2s, self->buf, self->buf_len, false);
+            i2s_write(self->i2s.id, self->buf, self->buf_len, &n, portMAX_DELAY);
+        }
+    }
+}
+
+void mp_machine_i2s_port_start(machine_i2s_obj_t *i2s) {
+    machine_i2s_port_obj_t *self = (machine_i2s_port_obj_t *)i2s;
+    bool rx = i2s->mode == MACHINE_I2S_RX;
+    bool stereo = i2s->format == MACHINE_I2S_STEREO;
+
+    size_t buf_len = I2S_DMA_BUF_LEN * i2s->bits / 8 * (stereo ? 2 : 1);
+    if (self->buf_len != buf_len) {
+        self->buf = m_renew(uint8_t, self->buf, self->buf_len, buf_len);
+        self->buf_len = buf_len;
+    }
+
+    i2s_config_t config = {
+        .mode = I2S_MODE_MASTER | (rx ? I2S_MODE_RX : I2S_MODE_TX),
+        .sample_rate = i2s->rate,
+        .bits_per_sample = i2s->bits,
+        .channel_format = stereo ? I2S_CHANNEL_FMT_RIGHT_LEFT : I2S_CHANNEL_FMT_ONLY_LEFT,
+        #if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(4, 2, 0)
+        .communication_format = I2S_COMM_FORMAT_STAND_I2S,
+        #else
+        .communication_format = I2S_COMM_FORMAT_I2S | I2S_COMM_FORMAT_I2S_MSB,
+        #endif
+        .intr_alloc_flags = ESP_INTR_FLAG_LOWMED,
+        .dma_buf_count = I2S_DMA_BUF_COUNT,
+        .dma_buf_len = I2S_DMA_BUF_LEN,
+        .use_apll = false,
+        .tx_desc_auto_clear = true,
+    };
+    i2s_pin_config_t pins = {
+        .bck_io_num = mp_hal_get_pin_obj(i2s->sck),
+        .ws_io_num = mp_hal_get_pin_obj(i2s->ws),
+        .data_out_num = rx ? I2S_PIN_NO_CHANGE : mp_hal_get_pin_obj(i2s->sd),
+        .data_in_num = rx ? mp_hal_get_pin_obj(i2s->sd) : I2S_PIN_NO_CHANGE,
+    };
+    if (i2s_driver_install(i2s->id, &config, I2S_DMA_BUF_COUNT, &self->queue) != ESP_OK) {
+        mp_raise_OSError(MP_EIO);
+    }
+    if (i2s_set_pin(i2s->id, &pins) != ESP_OK) {
+        i2s_driver_uninstall(i2s->id);
+        mp_raise_ValueError(MP_ERROR_TEXT("invalid pins"));
+    }
+    if (xTaskCreatePinnedToCore(machine_i2s_task, "i2s", I2S_TASK_STACK_SIZE / sizeof(StackType_t),
+        self, I2S_TASK_PRIORITY, &self->task, MP_TASK_COREID) != pdPASS) {
+        i2s_driver_uninstall(i2s->id);
+        mp_raise_OSError(MP_ENOMEM);
+    }
+}
+
+void mp_machine_i2s_port_stop(machine_i2s_obj_t *i2s) {
+    machine_i2s_port_obj_t *self = (machine_i2s_port_obj_t *)i2s;
+    vTaskDelete(self->task);
+    self->task = NULL;
+    // This also deletes the event queue.
+    i2s_driver_uninstall(i2s->id);
+    self->queue = NULL;
+}
+
+void machine_i2s_deinit_all(void) {
+    for (size_t i = 0; i < MP_ARRAY_SIZE(MP_STATE_PORT(machine_i2s_obj)); ++i) {
+        machine_i2s_port_obj_t *self = MP_STATE_PORT(machine_i2s_obj)[i];
+        if (self != NULL) {
+            machine_i2s_deinit(&self->i2s);
+            MP_STATE_PORT(machine_i2s_obj)[i] = NULL;
+        }
+    }
+}
+
+#endif // MICROPY_PY_MACHINE_I2S
@@ -0,0 +1,337 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "py/runtime.h"
+#include "py/mphal.h"
+#include "modmachine.h"
+#include "mphalport.h"
+
+#include "driver/pcnt.h"
+#include "soc/pcnt_struct.h"
+
+// machine.Counter and machine.Encoder, using the PCNT peripheral.
+//
+// Each hardware unit has a 16-bit signed counter.  It is set to count between
+// +/-MACHINE_PCNT_LIMIT and reset to 0 when it reaches either limit, and the
+// limit interrupt adds that to a 64-bit software count, so the total count
+// does not overflow.  Pulses are counted entirely in hardware, at up to
+// 40MHz, so this is not limited by interrupt latency like a Pin.irq counter.
+
+#define MACHINE_PCNT_LIMIT (32767)
+
+// Upper limit of the glitch filter, in APB clock cycles.
+#define MACHINE_PCNT_FILTER_MAX (1023)
+
+#define MACHINE_PCNT_RISING (1)
+#define MACHINE_PCNT_FALLING (2)
+
+typedef struct _machine_pcnt_obj_t {
+    mp_obj_base_t base;
+    pcnt_unit_t unit;
+    bool active;
+    volatile int64_t offset;
+} machine_pcnt_obj_t;
+
+STATIC machine_pcnt_obj_t machine_pcnt_obj[PCNT_UNIT_MAX];
+STATIC bool machine_pcnt_isr_installed = false;
+
+STATIC void machine_pcnt_isr_handler(void *arg) {
+    machine_pcnt_obj_t *self = arg;
+    uint32_t status = PCNT.status_unit[self->unit].val;
+    if (status & PCNT_EVT_H_LIM) {
+        self->offset += MACHINE_PCNT_LIMIT;
+    } else if (status & PCNT_EVT_L_LIM) {
+        self->offset -= MACHINE_PCNT_LIMIT;
+    }
+}
+
+STATIC void machine_pcnt_disable(machine_pcnt_obj_t *self) {
+    if (self->active) {
+        pcnt_counter_pause(self->unit);
+        pcnt_intr_disable(self->unit);
+        pcnt_isr_handler_remove(self->unit);
+        self->active = false;
+    }
+}
+
+void machine_pcnt_deinit_all(void) {
+    for (int i = 0; i < PCNT_UNIT_MAX; ++i) {
+        machine_pcnt_disable(&machine_pcnt_obj[i]);
+    }
+    if (machine_pcnt_isr_installed) {
+        pcnt_isr_service_uninstall();
+        machine_pcnt_isr_installed = false;
+    }
+}
+
+STATIC machine_pcnt_obj_t *machine_pcnt_get(const mp_obj_type_t *type, mp_obj_t id_in) {
+    mp_int_t id = mp_obj_get_int(id_in);
+    if (id < 0 || id >= PCNT_UNIT_MAX) {
+        mp_raise_ValueError(MP_ERROR_TEXT("invalid id"));
+    }
+    machine_pcnt_obj_t *self = &machine_pcnt_obj[id];
+    self->base.type = type;
+    self->unit = id;
+    return self;
+}
+
+// Configure one channel of a unit, with limits of +/-MACHINE_PCNT_LIMIT.
+STATIC void machine_pcnt_config_channel(machine_pcnt_obj_t *self, pcnt_channel_t channel,
+    int pulse_pin, int ctrl_pin, pcnt_count_mode_t pos_mode, pcnt_count_mode_t neg_mode,
+    pcnt_ctrl_mode_t lctrl_mode, pcnt_ctrl_mode_t hctrl_mode) {
+    pcnt_config_t config = {
+        .pulse_gpio_num = pulse_pin,
+        .ctrl_gpio_num = ctrl_pin,
+        .lctrl_mode = lctrl_mode,
+        .hctrl_mode = hctrl_mode,
+        .pos_mode = pos_mode,
+        .neg_mode = neg_mode,
+        .counter_h_lim = MACHINE_PCNT_LIMIT,
+        .counter_l_lim = -MACHINE_PCNT_LIMIT,
+        .unit = self->unit,
+        .channel = channel,
+    };
+    check_esp_err(pcnt_unit_config(&config));
+}
+
+STATIC void machine_pcnt_start(machine_pcnt_obj_t *self, mp_int_t filter_ns) {
+    if (filter_ns > 0) {
+        mp_int_t filter = filter_ns * (APB_CLK_FREQ / 1000000) / 1000;
+        check_esp_err(pcnt_set_filter_value(self->unit, MIN(filter, MACHINE_PCNT_FILTER_MAX)));
+        pcnt_filter_enable(self->unit);
+    } else {
+        pcnt_filter_disable(self->unit);
+    }
+
+    if (!machine_pcnt_isr_installed) {
+        check_esp_err(pcnt_isr_service_install(0));
+        machine_pcnt_isr_installed = true;
+    }
+    pcnt_counter_pause(self->unit);
+    pcnt_counter_clear(self->unit);
+    self->offset = 0;
+    pcnt_event_enable(self->unit, PCNT_EVT_H_LIM);
+    pcnt_event_enable(self->unit, PCNT_EVT_L_LIM);
+    if (!self->active) {
+        check_esp_err(pcnt_isr_handler_add(self->unit, machine_pcnt_isr_handler, self));
+        self->active = true;
+    }
+    pcnt_intr_enable(self->unit);
+    pcnt_counter_resume(self->unit);
+}
+
+STATIC int64_t machine_pcnt_get_value(machine_pcnt_obj_t *self) {
+    // Re-read if the limit interrupt ran while reading the hardware counter.
+    int64_t offset;
+    int16_t count;
+    do {
+        offset = self->offset;
+        pcnt_get_counter_value(self->unit, &count);
+    } while (offset != self->offset);
+    return offset + count;
+}
+
+STATIC void machine_pcnt_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
+    machine_pcnt_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_printf(print, "%q(%u)", mp_obj_get_type(self_in)->name, self->unit);
+}
+
+// Counter.value([value]) and Encoder.value([value])
+STATIC mp_obj_t machine_pcnt_value(size_t n_args, const mp_obj_t *args) {
+    machine_pcnt_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+    if (!self->active) {
+        mp_raise_ValueError(MP_ERROR_TEXT("not initialised"));
+    }
+    int64_t value = machine_pcnt_get_value(self);
+    if (n_args > 1) {
+        // Set the count, keeping any pulses that arrive while doing so.
+        pcnt_intr_disable(self->unit);
+        self->offset += mp_obj_get_int(args[1]) - value;
+        pcnt_intr_enable(self->unit);
+    }
+    return mp_obj_new_int_from_ll(value);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(machine_pcnt_value_obj, 1, 2, machine_pcnt_value);
+
+// Counter.deinit() and Encoder.deinit()
+STATIC mp_obj_t machine_pcnt_deinit(mp_obj_t self_in) {
+    machine_pcnt_disable(MP_OBJ_TO_PTR(self_in));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(machine_pcnt_deinit_obj, machine_pcnt_deinit);
+
+/******************************************************************************/
+// MicroPython bindings for Counter
+
+STATIC mp_obj_t machine_counter_init_helper(machine_pcnt_obj_t *self, size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_src, ARG_edge, ARG_direction, ARG_filter_ns };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_src, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_edge, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = MACHINE_PCNT_RISING} },
+        { MP_QSTR_direction, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = MP_OBJ_NEW_SMALL_INT(1)} },
+        { MP_QSTR_filter_ns, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 0} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    int src = machine_pin_get_id(args[ARG_src].u_obj);
+    mp_int_t edge = args[ARG_edge].u_int;
+
+    // The direction is either fixed, or given by the level of a pin: counting
+    // up while it is high and down while it is low.
+    int ctrl_pin = PCNT_PIN_NOT_USED;
+    pcnt_count_mode_t count_mode = PCNT_COUNT_INC;
+    pcnt_ctrl_mode_t lctrl_mode = PCNT_MODE_KEEP;
+    mp_obj_t direction = args[ARG_direction].u_obj;
+    if (mp_obj_is_int(direction)) {
+        if (mp_obj_get_int(direction) < 0) {
+            count_mode = PCNT_COUNT_DEC;
+        }
+    } else {
+        ctrl_pin = machine_pin_get_id(direction);
+        lctrl_mode = PCNT_MODE_REVERSE;
+    }
+
+    machine_pcnt_config_channel(self, PCNT_CHANNEL_0, src, ctrl_pin,
+        (edge & MACHINE_PCNT_RISING) ? count_mode : PCNT_COUNT_DIS,
+        (edge & MACHINE_PCNT_FALLING) ? count_mode : PCNT_COUNT_DIS,
+        lctrl_mode, PCNT_MODE_KEEP);
+    machine_pcnt_config_channel(self, PCNT_CHANNEL_1, PCNT_PIN_NOT_USED, PCNT_PIN_NOT_USED,
+        PCNT_COUNT_DIS, PCNT_COUNT_DIS, PCNT_MODE_KEEP, PCNT_MODE_KEEP);
+    machine_pcnt_start(self, args[ARG_filter_ns].u_int);
+
+    return mp_const_none;
+}
+
+// Counter(id, src, *, edge=Counter.RISING, direction=Counter.UP, filter_ns=0)
+STATIC mp_obj_t machine_counter_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 1, MP_OBJ_FUN_ARGS_MAX, true);
+    machine_pcnt_obj_t *self = machine_pcnt_get(type, args[0]);
+    if (n_args > 1 || n_kw > 0) {
+        mp_map_t kw_args;
+        mp_map_init_fixed_table(&kw_args, n_kw, args + n_args);
+        machine_counter_init_helper(self, n_args - 1, args + 1, &kw_args);
+    }
+    return MP_OBJ_FROM_PTR(self);
+}
+
+STATIC mp_obj_t machine_counter_init(size_t n_args, const mp_obj_t *args, mp_map_t *kw_args) {
+    return machine_counter_init_helper(MP_OBJ_TO_PTR(args[0]), n_args - 1, args + 1, kw_args);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(machine_counter_init_obj, 1, machine_counter_init);
+
+STATIC const mp_rom_map_elem_t machine_counter_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_init), MP_ROM_PTR(&machine_counter_init_obj) },
+    { MP_ROM_QSTR(MP_QSTR_deinit), MP_ROM_PTR(&machine_pcnt_deinit_obj) },
+    { MP_ROM_QSTR(MP_QSTR_value), MP_ROM_PTR(&machine_pcnt_value_obj) },
+
+    { MP_ROM_QSTR(MP_QSTR_RISING), MP_ROM_INT(MACHINE_PCNT_RISING) },
+    { MP_ROM_QSTR(MP_QSTR_FALLING), MP_ROM_INT(MACHINE_PCNT_FALLING) },
+    { MP_ROM_QSTR(MP_QSTR_UP), MP_ROM_INT(1) },
+    { MP_ROM_QSTR(MP_QSTR_DOWN), MP_ROM_INT(-1) },
+};
+STATIC MP_DEFINE_CONST_DICT(machine_counter_locals_dict, machine_counter_locals_dict_table);
+
+const mp_obj_type_t machine_counter_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_Counter,
+    .print = machine_pcnt_print,
+    .make_new = machine_counter_make_new,
+    .locals_dict = (mp_obj_dict_t *)&machine_counter_locals_dict,
+};
+
+/******************************************************************************/
+// MicroPython bindings for Encoder
+
+STATIC mp_obj_t machine_encoder_init_helper(machine_pcnt_obj_t *self, size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_phase_a, ARG_phase_b, ARG_phases, ARG_filter_ns };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_phase_a, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_phase_b, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_phases, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 1} },
+        { MP_QSTR_filter_ns, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 0} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    int phase_a = machine_pin_get_id(args[ARG_phase_a].u_obj);
+    int phase_b = machine_pin_get_id(args[ARG_phase_b].u_obj);
+    mp_int_t phases = args[ARG_phases].u_int;
+    if (phases != 1 && phases != 2 && phases != 4) {
+        mp_raise_ValueError(MP_ERROR_TEXT("phases must be 1, 2 or 4"));
+    }
+
+    // Channel 0 counts edges of A, in a direction given by the level of B.
+    // With 4 phases channel 1 also counts edges of B, with A giving the direction.
+    machine_pcnt_config_channel(self, PCNT_CHANNEL_0, phase_a, phase_b,
+        PCNT_COUNT_DEC, phases == 1 ? PCNT_COUNT_DIS : PCNT_COUNT_INC,
+        PCNT_MODE_REVERSE, PCNT_MODE_KEEP);
+    if (phases == 4) {
+        machine_pcnt_config_channel(self, PCNT_CHANNEL_1, phase_b, phase_a,
+            PCNT_COUNT_INC, PCNT_COUNT_DEC, PCNT_MODE_REVERSE, PCNT_MODE_KEEP);
+    } else {
+        machine_pcnt_config_channel(self, PCNT_CHANNEL_1, PCNT_PIN_NOT_USED, PCNT_PIN_NOT_USED,
+            PCNT_COUNT_DIS, PCNT_COUNT_DIS, PCNT_MODE_KEEP, PCNT_MODE_KEEP);
+    }
+    machine_pcnt_start(self, args[ARG_filter_ns].u_int);
+
+    return mp_const_none;
+}
+
+// Encoder(id, phase_a, phase_b, *, phases=1, filter_ns=0)
+STATIC mp_obj_t machine_encoder_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 1, MP_OBJ_FUN_ARGS_MAX, true);
+    machine_pcnt_obj_t *self = machine_pcnt_get(type, args[0]);
+    if (n_args > 1 || n_kw > 0) {
+        mp_map_t kw_args;
+        mp_map_init_fixed_table(&kw_args, n_kw, args + n_args);
+        machine_encoder_init_helper(self, n_args - 1, args + 1, &kw_args);
+    }
+    return MP_OBJ_FROM_PTR(self);
+}
+
+STATIC mp_obj_t machine_encoder_init(size_t n_args, const mp_obj_t *args, mp_map_t *kw_args) {
+    return machine_encoder_init_helper(MP_OBJ_TO_PTR(args[0]), n_args - 1, args + 1, kw_args);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(machine_encoder_init_obj, 1, machine_encoder_init);
+
+STATIC const mp_rom_map_elem_t machine_encoder_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_init), MP_ROM_PTR(&machine_encoder_init_obj) },
+    { MP_ROM_QSTR(MP_QSTR_deinit), MP_ROM_PTR(&machine_pcnt_deinit_obj) },
+    { MP_ROM_QSTR(MP_QSTR_value), MP_ROM_PTR(&machine_pcnt_value_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(machine_encoder_locals_dict, machine_encoder_locals_dict_table);
+
+const mp_obj_type_t machine_encoder_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_Encoder,
+    .print = machine_pcnt_print,
+    .make_new = machine_encoder_make_new,
+    .locals_dict = (mp_obj_dict_t *)&machine_encoder_locals_dict,
+};
@@ -31,6 +31,7 @@
 
 #include "driver/gpio.h"
 #include "driver/rtc_io.h"
+#include "soc/gpio_struct.h"
 
 #include "py/runtime.h"
 #include "py/mphal.h"
@@ -177,13 +178,39 @@ void machine_pins_deinit(void) {
     }
 }
 
+#if MICROPY_SCHEDULER_EVENT_DEPTH
+// Pins whose handler is queued as an event, with the level and time of the edge.
+STATIC uint64_t machine_pin_irq_event;
+#endif
+
 STATIC void machine_pin_isr_handler(void *arg) {
     machine_pin_obj_t *self = arg;
     mp_obj_t handler = MP_STATE_PORT(machine_pin_irq_handler)[self->id];
+    #if MICROPY_SCHEDULER_EVENT_DEPTH
+    if (machine_pin_irq_event & (1ULL << self->id)) {
+        mp_sched_event(handler, MP_OBJ_FROM_PTR(self), gpio_get_level(self->id));
+        mp_hal_wake_main_task_from_isr();
+        return;
+    }
+    #endif
     mp_sched_schedule(handler, MP_OBJ_FROM_PTR(self));
     mp_hal_wake_main_task_from_isr();
 }
 
+void mp_hal_pin_port_write(uintptr_t port, uint32_t set_mask, uint32_t clr_mask) {
+    if (port == 0) {
+        GPIO.out_w1ts = set_mask;
+        GPIO.out_w1tc = clr_mask;
+    } else {
+        GPIO.out1_w1ts.val = set_mask;
+        GPIO.out1_w1tc.val = clr_mask;
+    }
+}
+
+uint32_t mp_hal_pin_port_read(uintptr_t port) {
+    return port == 0 ? GPIO.in : GPIO.in1.val;
+}
+
 gpio_num_t machine_pin_get_id(mp_obj_t pin_in) {
     if (mp_obj_get_type(pin_in) != &machine_pin_type) {
         mp_raise_ValueError(MP_ERROR_TEXT("expecting a pin"));
@@ -327,13 +354,16 @@ STATIC mp_obj_t machine_pin_on(mp_obj_t self_in) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(machine_pin_on_obj, machine_pin_on);
 
-// pin.irq(handler=None, trigger=IRQ_FALLING|IRQ_RISING)
+// pin.irq(handler=None, trigger=IRQ_FALLING|IRQ_RISING, wake=None, *, event=False)
 STATIC mp_obj_t machine_pin_irq(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
-    enum { ARG_handler, ARG_trigger, ARG_wake };
+    enum { ARG_handler, ARG_trigger, ARG_wake, ARG_event };
     static const mp_arg_t allowed_args[] = {
         { MP_QSTR_handler, MP_ARG_OBJ, {.u_obj = mp_const_none} },
         { MP_QSTR_trigger, MP_ARG_INT, {.u_int = GPIO_PIN_INTR_POSEDGE | GPIO_PIN_INTR_NEGEDGE} },
         { MP_QSTR_wake, MP_ARG_OBJ, {.u_obj = mp_const_none} },
+        #if MICROPY_SCHEDULER_EVENT_DEPTH
+        { MP_QSTR_event, MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = false} },
+        #endif
     };
     machine_pin_obj_t *self = MP_OBJ_TO_PTR(pos_args[0]);
     mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
@@ -381,6 +411,13 @@ STATIC mp_obj_t machine_pin_irq(size_t n_args, const mp_obj_t *pos_args, mp_map_
                 trigger = 0;
             }
             gpio_isr_handler_remove(self->id);
+            #if MICROPY_SCHEDULER_EVENT_DEPTH
+            if (args[ARG_event].u_bool) {
+                machine_pin_irq_event |= 1ULL << self->id;
+            } else {
+                machine_pin_irq_event &= ~(1ULL << self->id);
+            }
+            #endif
             MP_STATE_PORT(machine_pin_irq_handler)[self->id] = handler;
             gpio_set_intr_type(self->id, trigger);
             gpio_isr_handler_add(self->id, machine_pin_isr_handler, (void *)self);
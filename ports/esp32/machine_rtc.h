@@ -37,6 +37,8 @@ typedef struct {
     bool ext0_level : 1;
     wake_type_t ext0_wake_types;
     bool ext1_level : 1;
+    int8_t uart_wake; // UART number that wakes from light sleep, -1 == None
+    uint16_t uart_wake_threshold; // rising edges on RX to wake
 } machine_rtc_config_t;
 
 extern machine_rtc_config_t machine_rtc_config;
@@ -295,7 +295,11 @@ STATIC mp_obj_t machine_sdcard_readblocks(mp_obj_t self_in, mp_obj_t block_num,
     }
 
     mp_get_buffer_raise(buf, &bufinfo, MP_BUFFER_WRITE);
-    err = sdmmc_read_sectors(&(self->card), bufinfo.buf, mp_obj_get_int(block_num), bufinfo.len / _SECTOR_SIZE(self));
+    mp_int_t block = mp_obj_get_int(block_num);
+    // Release the GIL so other threads (eg a uasyncio loop) run during the transfer
+    MP_THREAD_GIL_EXIT();
+    err = sdmmc_read_sectors(&(self->card), bufinfo.buf, block, bufinfo.len / _SECTOR_SIZE(self));
+    MP_THREAD_GIL_ENTER();
 
     return mp_obj_new_bool(err == ESP_OK);
 }
@@ -312,7 +316,11 @@ STATIC mp_obj_t machine_sdcard_writeblocks(mp_obj_t self_in, mp_obj_t block_num,
     }
 
     mp_get_buffer_raise(buf, &bufinfo, MP_BUFFER_READ);
-    err = sdmmc_write_sectors(&(self->card), bufinfo.buf, mp_obj_get_int(block_num), bufinfo.len / _SECTOR_SIZE(self));
+    mp_int_t block = mp_obj_get_int(block_num);
+    // Release the GIL so other threads (eg a uasyncio loop) run during the transfer
+    MP_THREAD_GIL_EXIT();
+    err = sdmmc_write_sectors(&(self->card), bufinfo.buf, block, bufinfo.len / _SECTOR_SIZE(self));
+    MP_THREAD_GIL_ENTER();
 
     return mp_obj_new_bool(err == ESP_OK);
 }
@@ -30,6 +30,7 @@
 
 #include "driver/uart.h"
 #include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
 
 #include "py/runtime.h"
 #include "py/stream.h"
@@ -50,6 +51,19 @@
 
 #define UART_INV_MASK (UART_INV_TX | UART_INV_RX | UART_INV_RTS | UART_INV_CTS)
 
+// In frame mode, a frame ends when the RX line has been idle for frame_timeout
+// symbol times.  The IDF driver signals this with the timeout flag of its
+// UART_DATA event, and the lengths of complete frames are kept in a small ring
+// so reads and polling can respect frame boundaries.
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(4, 1, 0)
+#define MACHINE_UART_FRAMES (1)
+#else
+#define MACHINE_UART_FRAMES (0)
+#endif
+#define MACHINE_UART_FRAMES_MAX (8)
+#define MACHINE_UART_EVENT_QUEUE_LEN (16)
+#define MACHINE_UART_FRAME_TIMEOUT_MAX (126)
+
 typedef struct _machine_uart_obj_t {
     mp_obj_base_t base;
     uart_port_t uart_num;
@@ -65,10 +79,74 @@ typedef struct _machine_uart_obj_t {
     uint16_t timeout;       // timeout waiting for first char (in ms)
     uint16_t timeout_char;  // timeout waiting between chars (in ms)
     uint32_t invert;        // lines to invert
+    #if MACHINE_UART_FRAMES
+    uint8_t frame_timeout;  // idle time that ends a frame (in symbols), 0 to disable
+    uint8_t frame_head;
+    uint8_t frame_count;
+    uint16_t frame_len[MACHINE_UART_FRAMES_MAX];
+    uint32_t frame_partial; // bytes received so far of the next frame
+    QueueHandle_t event_queue;
+    #endif
 } machine_uart_obj_t;
 
 STATIC const char *_parity_name[] = {"None", "1", "0"};
 
+STATIC void machine_uart_driver_install(machine_uart_obj_t *self) {
+    #if MACHINE_UART_FRAMES
+    self->frame_head = 0;
+    self->frame_count = 0;
+    self->frame_partial = 0;
+    self->event_queue = NULL;
+    if (self->frame_timeout) {
+        uart_driver_install(self->uart_num, self->rxbuf, self->txbuf, MACHINE_UART_EVENT_QUEUE_LEN, &self->event_queue, 0);
+        uart_set_rx_timeout(self->uart_num, self->frame_timeout);
+        return;
+    }
+    #endif
+    uart_driver_install(self->uart_num, self->rxbuf, self->txbuf, 0, NULL, 0);
+}
+
+#if MACHINE_UART_FRAMES
+// Process events from the driver, waiting up to ticks_to_wait for a frame to
+// complete if there is none yet.
+STATIC void machine_uart_frames_update(machine_uart_obj_t *self, TickType_t ticks_to_wait) {
+    uart_event_t event;
+    TickType_t start = xTaskGetTickCount();
+    for (;;) {
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        TickType_t wait = (self->frame_count == 0 && elapsed < ticks_to_wait) ? ticks_to_wait - elapsed : 0;
+        if (xQueueReceive(self->event_queue, &event, wait) != pdTRUE) {
+            return;
+        }
+        switch (event.type) {
+            case UART_DATA:
+                self->frame_partial += event.size;
+                if (event.timeout_flag && self->frame_partial > 0) {
+                    if (self->frame_count < MACHINE_UART_FRAMES_MAX) {
+                        self->frame_len[(self->frame_head + self->frame_count++) % MACHINE_UART_FRAMES_MAX] = self->frame_partial;
+                    } else {
+                        // No room to record the boundary, so merge with the last frame.
+                        self->frame_len[(self->frame_head + MACHINE_UART_FRAMES_MAX - 1) % MACHINE_UART_FRAMES_MAX] += self->frame_partial;
+                    }
+                    self->frame_partial = 0;
+                }
+                break;
+            case UART_FIFO_OVF:
+            case UART_BUFFER_FULL:
+                // Data was lost so the frame boundaries are no longer known.
+                uart_flush_input(self->uart_num);
+                xQueueReset(self->event_queue);
+                self->frame_head = 0;
+                self->frame_count = 0;
+                self->frame_partial = 0;
+                return;
+            default:
+                break;
+        }
+    }
+}
+#endif
+
 /******************************************************************************/
 // MicroPython bindings for UART
 
@@ -107,11 +185,16 @@ STATIC void machine_uart_print(const mp_print_t *print, mp_obj_t self_in, mp_pri
             mp_printf(print, "INV_CTS");
         }
     }
+    #if MACHINE_UART_FRAMES
+    if (self->frame_timeout) {
+        mp_printf(print, ", frame_timeout=%u", self->frame_timeout);
+    }
+    #endif
     mp_printf(print, ")");
 }
 
 STATIC void machine_uart_init_helper(machine_uart_obj_t *self, size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
-    enum { ARG_baudrate, ARG_bits, ARG_parity, ARG_stop, ARG_tx, ARG_rx, ARG_rts, ARG_cts, ARG_txbuf, ARG_rxbuf, ARG_timeout, ARG_timeout_char, ARG_invert };
+    enum { ARG_baudrate, ARG_bits, ARG_parity, ARG_stop, ARG_tx, ARG_rx, ARG_rts, ARG_cts, ARG_txbuf, ARG_rxbuf, ARG_timeout, ARG_timeout_char, ARG_invert, ARG_frame_timeout };
     static const mp_arg_t allowed_args[] = {
         { MP_QSTR_baudrate, MP_ARG_INT, {.u_int = 0} },
         { MP_QSTR_bits, MP_ARG_INT, {.u_int = 0} },
@@ -126,6 +209,7 @@ STATIC void machine_uart_init_helper(machine_uart_obj_t *self, size_t n_args, co
         { MP_QSTR_timeout, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 0} },
         { MP_QSTR_timeout_char, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 0} },
         { MP_QSTR_invert, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_frame_timeout, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = -1} },
     };
     mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
     mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
@@ -133,8 +217,25 @@ STATIC void machine_uart_init_helper(machine_uart_obj_t *self, size_t n_args, co
     // wait for all data to be transmitted before changing settings
     uart_wait_tx_done(self->uart_num, pdMS_TO_TICKS(1000));
 
-    if (args[ARG_txbuf].u_int >= 0 || args[ARG_rxbuf].u_int >= 0) {
-        // must reinitialise driver to change the tx/rx buffer size
+    if (args[ARG_frame_timeout].u_int >= 0) {
+        #if MACHINE_UART_FRAMES
+        if (args[ARG_frame_timeout].u_int > MACHINE_UART_FRAME_TIMEOUT_MAX) {
+            mp_raise_ValueError(MP_ERROR_TEXT("invalid frame_timeout"));
+        }
+        #else
+        if (args[ARG_frame_timeout].u_int > 0) {
+            mp_raise_ValueError(MP_ERROR_TEXT("frame_timeout not supported"));
+        }
+        #endif
+    }
+
+    if (args[ARG_txbuf].u_int >= 0 || args[ARG_rxbuf].u_int >= 0 || args[ARG_frame_timeout].u_int >= 0) {
+        // must reinitialise driver to change the tx/rx buffer size or the frame mode
+        #if MACHINE_UART_FRAMES
+        if (args[ARG_frame_timeout].u_int >= 0) {
+            self->frame_timeout = args[ARG_frame_timeout].u_int;
+        }
+        #endif
         if (args[ARG_txbuf].u_int >= 0) {
             self->txbuf = args[ARG_txbuf].u_int;
         }
@@ -153,7 +254,7 @@ STATIC void machine_uart_init_helper(machine_uart_obj_t *self, size_t n_args, co
         uart_get_stop_bits(self->uart_num, &uartcfg.stop_bits);
         uart_driver_delete(self->uart_num);
         uart_param_config(self->uart_num, &uartcfg);
-        uart_driver_install(self->uart_num, self->rxbuf, self->txbuf, 0, NULL, 0);
+        machine_uart_driver_install(self);
     }
 
     // set baudrate
@@ -297,6 +398,9 @@ STATIC mp_obj_t machine_uart_make_new(const mp_obj_type_t *type, size_t n_args,
     self->rxbuf = 256; // IDF minimum
     self->timeout = 0;
     self->timeout_char = 0;
+    #if MACHINE_UART_FRAMES
+    self->frame_timeout = 0;
+    #endif
 
     switch (uart_num) {
         case UART_NUM_0:
@@ -322,7 +426,7 @@ STATIC mp_obj_t machine_uart_make_new(const mp_obj_type_t *type, size_t n_args,
     // Setup
     uart_param_config(self->uart_num, &uartcfg);
 
-    uart_driver_install(uart_num, self->rxbuf, self->txbuf, 0, NULL, 0);
+    machine_uart_driver_install(self);
 
     mp_map_t kw_args;
     mp_map_init_fixed_table(&kw_args, n_kw, args + n_args);
@@ -386,13 +490,43 @@ STATIC mp_obj_t machine_uart_sendbreak(mp_obj_t self_in) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(machine_uart_sendbreak_obj, machine_uart_sendbreak);
 
+// UART.readinto(buf[, nbytes])
+// In frame mode this reads at most one frame, and returns its length.
+STATIC mp_obj_t machine_uart_readinto(size_t n_args, const mp_obj_t *args) {
+    #if MACHINE_UART_FRAMES
+    machine_uart_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+    if (self->frame_timeout) {
+        mp_buffer_info_t bufinfo;
+        mp_get_buffer_raise(args[1], &bufinfo, MP_BUFFER_WRITE);
+        mp_uint_t len = bufinfo.len;
+        if (n_args > 2) {
+            len = MIN((mp_uint_t)mp_obj_get_int(args[2]), len);
+        }
+        int errcode;
+        mp_uint_t out_sz = mp_get_stream(args[0])->read(args[0], bufinfo.buf, len, &errcode);
+        if (out_sz == MP_STREAM_ERROR) {
+            if (mp_is_nonblocking_error(errcode)) {
+                return mp_const_none;
+            }
+            mp_raise_OSError(errcode);
+        }
+        return MP_OBJ_NEW_SMALL_INT(out_sz);
+    }
+    #endif
+    return mp_call_function_n_kw(MP_OBJ_FROM_PTR(&mp_stream_readinto_obj), n_args, 0, args);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(machine_uart_readinto_obj, 2, 3, machine_uart_readinto);
+
 STATIC const mp_rom_map_elem_t machine_uart_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_init), MP_ROM_PTR(&machine_uart_init_obj) },
     { MP_ROM_QSTR(MP_QSTR_deinit), MP_ROM_PTR(&machine_uart_deinit_obj) },
     { MP_ROM_QSTR(MP_QSTR_any), MP_ROM_PTR(&machine_uart_any_obj) },
     { MP_ROM_QSTR(MP_QSTR_read), MP_ROM_PTR(&mp_stream_read_obj) },
     { MP_ROM_QSTR(MP_QSTR_readline), MP_ROM_PTR(&mp_stream_unbuffered_readline_obj) },
-    { MP_ROM_QSTR(MP_QSTR_readinto), MP_ROM_PTR(&mp_stream_readinto_obj) },
+#if MICROPY_STREAMS_READLINE_INTO
+    { MP_ROM_QSTR(MP_QSTR_readline_into), MP_ROM_PTR(&mp_stream_unbuffered_readline_into_obj) },
+#endif
+    { MP_ROM_QSTR(MP_QSTR_readinto), MP_ROM_PTR(&machine_uart_readinto_obj) },
     { MP_ROM_QSTR(MP_QSTR_write), MP_ROM_PTR(&mp_stream_write_obj) },
     { MP_ROM_QSTR(MP_QSTR_sendbreak), MP_ROM_PTR(&machine_uart_sendbreak_obj) },
 
@@ -419,6 +553,29 @@ STATIC mp_uint_t machine_uart_read(mp_obj_t self_in, void *buf_in, mp_uint_t siz
         time_to_wait = pdMS_TO_TICKS(self->timeout);
     }
 
+    #if MACHINE_UART_FRAMES
+    if (self->frame_timeout) {
+        // Only read complete frames, and do not read past the end of a frame.
+        machine_uart_frames_update(self, time_to_wait);
+        if (self->frame_count == 0) {
+            *errcode = MP_EAGAIN;
+            return MP_STREAM_ERROR;
+        }
+        uint16_t *frame_len = &self->frame_len[self->frame_head];
+        int bytes_read = uart_read_bytes(self->uart_num, buf_in, MIN(size, *frame_len), 0);
+        if (bytes_read <= 0) {
+            *errcode = MP_EAGAIN;
+            return MP_STREAM_ERROR;
+        }
+        *frame_len -= bytes_read;
+        if (*frame_len == 0) {
+            self->frame_head = (self->frame_head + 1) % MACHINE_UART_FRAMES_MAX;
+            --self->frame_count;
+        }
+        return bytes_read;
+    }
+    #endif
+
     int bytes_read = uart_read_bytes(self->uart_num, buf_in, size, time_to_wait);
 
     if (bytes_read <= 0) {
@@ -451,6 +608,13 @@ STATIC mp_uint_t machine_uart_ioctl(mp_obj_t self_in, mp_uint_t request, mp_uint
         ret = 0;
         size_t rxbufsize;
         uart_get_buffered_data_len(self->uart_num, &rxbufsize);
+        #if MACHINE_UART_FRAMES
+        if (self->frame_timeout) {
+            // Readable once a whole frame has been received.
+            machine_uart_frames_update(self, 0);
+            rxbufsize = self->frame_count;
+        }
+        #endif
         if ((flags & MP_STREAM_POLL_RD) && rxbufsize > 0) {
             ret |= MP_STREAM_POLL_RD;
         }
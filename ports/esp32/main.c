@@ -45,6 +45,9 @@
 #elif CONFIG_IDF_TARGET_ESP32S3
 #include "esp32s3/spiram.h"
 #endif
+#if MICROPY_GC_SPLIT_HEAP
+#include "soc/soc_memory_layout.h"
+#endif
 
 #include "py/stackctrl.h"
 #include "py/nlr.h"
@@ -124,11 +127,31 @@ void mp_task(void *pvParameter) {
     void *mp_task_heap = malloc(mp_task_heap_size);
     #endif
 
+    #if MICROPY_GC_SPLIT_HEAP
+    // If the heap is in SPIRAM then also use half of the largest block of the
+    // faster internal RAM, as a separate heap region preferred by small objects.
+    size_t mp_task_heap_internal_size = 0;
+    void *mp_task_heap_internal = NULL;
+    if (!esp_ptr_internal(mp_task_heap)) {
+        mp_task_heap_internal_size = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT) / 2;
+        mp_task_heap_internal = heap_caps_malloc(mp_task_heap_internal_size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+    #endif
+
 soft_reset:
     // initialise the stack pointer for the main thread
     mp_stack_set_top((void *)sp);
     mp_stack_set_limit(MP_TASK_STACK_SIZE - 1024);
+    #if MICROPY_GC_SPLIT_HEAP
+    if (mp_task_heap_internal != NULL) {
+        gc_init(mp_task_heap_internal, mp_task_heap_internal + mp_task_heap_internal_size);
+        gc_add_region(mp_task_heap, mp_task_heap + mp_task_heap_size, GC_REGION_FLAG_LARGE);
+    } else {
+        gc_init(mp_task_heap, mp_task_heap + mp_task_heap_size);
+    }
+    #else
     gc_init(mp_task_heap, mp_task_heap + mp_task_heap_size);
+    #endif
     mp_init();
     mp_obj_list_init(mp_sys_path, 0);
     mp_obj_list_append(mp_sys_path, MP_OBJ_NEW_QSTR(MP_QSTR_));
@@ -170,6 +193,15 @@ soft_reset_exit:
     #endif
 
     machine_timer_deinit_all();
+    machine_hw_spi_deinit_all();
+    machine_pcnt_deinit_all();
+    #if MICROPY_PY_MACHINE_I2S
+    machine_i2s_deinit_all();
+    #endif
+
+    #if MICROPY_PY_ESPNOW
+    espnow_deinit();
+    #endif
 
     #if MICROPY_PY_THREAD
     mp_thread_deinit();
@@ -132,6 +132,35 @@ STATIC mp_obj_t esp32_wake_on_ext1(size_t n_args, const mp_obj_t *pos_args, mp_m
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_KW(esp32_wake_on_ext1_obj, 0, esp32_wake_on_ext1);
 
+STATIC mp_obj_t esp32_wake_on_uart(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum {ARG_uart, ARG_threshold};
+    const mp_arg_t allowed_args[] = {
+        { MP_QSTR_uart, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = mp_const_none} },
+        { MP_QSTR_threshold, MP_ARG_INT, {.u_int = 3} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    if (args[ARG_uart].u_obj == mp_const_none) {
+        machine_rtc_config.uart_wake = -1;
+    } else {
+        mp_int_t uart = mp_obj_get_int(args[ARG_uart].u_obj);
+        mp_int_t threshold = args[ARG_threshold].u_int;
+        // Only UART0 and UART1 can wake the chip from light sleep
+        if (uart < 0 || uart > 1) {
+            mp_raise_ValueError(MP_ERROR_TEXT("invalid UART"));
+        }
+        if (threshold < 3 || threshold > 0x3ff) {
+            mp_raise_ValueError(MP_ERROR_TEXT("invalid threshold"));
+        }
+        machine_rtc_config.uart_wake = uart;
+        machine_rtc_config.uart_wake_threshold = threshold;
+    }
+
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(esp32_wake_on_uart_obj, 1, esp32_wake_on_uart);
+
 #if CONFIG_IDF_TARGET_ESP32
 
 STATIC mp_obj_t esp32_raw_temperature(void) {
@@ -186,6 +215,7 @@ STATIC const mp_rom_map_elem_t esp32_module_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_wake_on_touch), MP_ROM_PTR(&esp32_wake_on_touch_obj) },
     { MP_ROM_QSTR(MP_QSTR_wake_on_ext0), MP_ROM_PTR(&esp32_wake_on_ext0_obj) },
     { MP_ROM_QSTR(MP_QSTR_wake_on_ext1), MP_ROM_PTR(&esp32_wake_on_ext1_obj) },
+    { MP_ROM_QSTR(MP_QSTR_wake_on_uart), MP_ROM_PTR(&esp32_wake_on_uart_obj) },
     #if CONFIG_IDF_TARGET_ESP32
     { MP_ROM_QSTR(MP_QSTR_raw_temperature), MP_ROM_PTR(&esp32_raw_temperature_obj) },
     { MP_ROM_QSTR(MP_QSTR_hall_sensor), MP_ROM_PTR(&esp32_hall_sensor_obj) },
@@ -194,6 +224,7 @@ STATIC const mp_rom_map_elem_t esp32_module_globals_table[] = {
 
     { MP_ROM_QSTR(MP_QSTR_NVS), MP_ROM_PTR(&esp32_nvs_type) },
     { MP_ROM_QSTR(MP_QSTR_Partition), MP_ROM_PTR(&esp32_partition_type) },
+    { MP_ROM_QSTR(MP_QSTR_OTAWriter), MP_ROM_PTR(&esp32_ota_writer_type) },
     { MP_ROM_QSTR(MP_QSTR_RMT), MP_ROM_PTR(&esp32_rmt_type) },
     #if CONFIG_IDF_TARGET_ESP32
     { MP_ROM_QSTR(MP_QSTR_ULP), MP_ROM_PTR(&esp32_ulp_type) },
@@ -0,0 +1,452 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "py/runtime.h"
+#include "py/mperrno.h"
+#include "py/mphal.h"
+#include "py/objarray.h"
+#include "py/ringbuf.h"
+#include "py/stream.h"
+#include "modnetwork.h"
+
+#include "esp_now.h"
+#include "esp_wifi.h"
+
+#if MICROPY_PY_ESPNOW
+
+// espnow module: connectionless messaging between devices using ESP-NOW.
+//
+// The receive callback runs in the WiFi task and copies each message into a
+// ring buffer as <len><mac:6><data:len>, under a spinlock because the WiFi
+// task may run on the other core.  irecv() copies the next message out into
+// buffers that are allocated once, and returns the same (mac, msg) tuple of
+// memoryviews every time, so receiving does not allocate.
+
+#define ESPNOW_MAC_LEN (ESP_NOW_ETH_ALEN)
+#define ESPNOW_RXBUF_DEFAULT (2 * (1 + ESPNOW_MAC_LEN + ESP_NOW_MAX_DATA_LEN))
+
+typedef struct _esp_espnow_obj_t {
+    mp_obj_base_t base;
+    bool active;
+    uint16_t rxbuf_size;
+    ringbuf_t rx;
+    mp_obj_tuple_t *irecv_tuple;
+    mp_obj_array_t irecv_mac;
+    mp_obj_array_t irecv_msg;
+    uint8_t mac_buf[ESPNOW_MAC_LEN];
+    uint8_t msg_buf[ESP_NOW_MAX_DATA_LEN];
+    // Counters, updated by the WiFi task.
+    volatile uint32_t tx_packets;
+    volatile uint32_t tx_responses;
+    volatile uint32_t tx_failures;
+    volatile uint32_t rx_packets;
+    volatile uint32_t rx_dropped;
+} esp_espnow_obj_t;
+
+const mp_obj_type_t esp_espnow_type;
+
+STATIC portMUX_TYPE espnow_mux = portMUX_INITIALIZER_UNLOCKED;
+
+NORETURN STATIC void espnow_raise(esp_err_t err) {
+    switch (err) {
+        case ESP_ERR_ESPNOW_NOT_INIT:
+            mp_raise_msg(&mp_type_OSError, MP_ERROR_TEXT("ESP-NOW not active"));
+        case ESP_ERR_ESPNOW_ARG:
+            mp_raise_OSError(MP_EINVAL);
+        case ESP_ERR_ESPNOW_NO_MEM:
+        case ESP_ERR_ESPNOW_FULL:
+            mp_raise_OSError(MP_ENOMEM);
+        case ESP_ERR_ESPNOW_NOT_FOUND:
+            mp_raise_OSError(MP_ENOENT);
+        case ESP_ERR_ESPNOW_EXIST:
+            mp_raise_OSError(MP_EEXIST);
+        case ESP_ERR_ESPNOW_IF:
+            mp_raise_msg(&mp_type_OSError, MP_ERROR_TEXT("WiFi interface not active"));
+        default:
+            _esp_exceptions(err);
+    }
+}
+
+STATIC void espnow_check(esp_err_t err) {
+    if (err != ESP_OK) {
+        espnow_raise(err);
+    }
+}
+
+STATIC const uint8_t *espnow_get_mac(mp_obj_t mac_in) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(mac_in, &bufinfo, MP_BUFFER_READ);
+    if (bufinfo.len != ESPNOW_MAC_LEN) {
+        mp_raise_ValueError(MP_ERROR_TEXT("invalid MAC address"));
+    }
+    return bufinfo.buf;
+}
+
+// Runs in the WiFi task.
+STATIC void espnow_recv_cb(const uint8_t *mac, const uint8_t *data, int len) {
+    esp_espnow_obj_t *self = MP_STATE_PORT(espnow_singleton);
+    if (self == NULL || len <= 0 || len > ESP_NOW_MAX_DATA_LEN) {
+        return;
+    }
+    portENTER_CRITICAL(&espnow_mux);
+    if (ringbuf_free(&self->rx) < 1 + ESPNOW_MAC_LEN + (size_t)len) {
+        portEXIT_CRITICAL(&espnow_mux);
+        ++self->rx_dropped;
+        return;
+    }
+    ringbuf_put(&self->rx, len);
+    for (int i = 0; i < ESPNOW_MAC_LEN; ++i) {
+        ringbuf_put(&self->rx, mac[i]);
+    }
+    for (int i = 0; i < len; ++i) {
+        ringbuf_put(&self->rx, data[i]);
+    }
+    portEXIT_CRITICAL(&espnow_mux);
+    ++self->rx_packets;
+    xTaskNotifyGive(mp_main_task_handle);
+}
+
+// Runs in the WiFi task.
+STATIC void espnow_send_cb(const uint8_t *mac, esp_now_send_status_t status) {
+    esp_espnow_obj_t *self = MP_STATE_PORT(espnow_singleton);
+    if (self == NULL) {
+        return;
+    }
+    if (status == ESP_NOW_SEND_SUCCESS) {
+        ++self->tx_responses;
+    } else {
+        ++self->tx_failures;
+    }
+}
+
+STATIC mp_obj_t espnow_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 0, 0, false);
+    esp_espnow_obj_t *self = MP_STATE_PORT(espnow_singleton);
+    if (self == NULL) {
+        self = m_new0(esp_espnow_obj_t, 1);
+        self->base.type = &esp_espnow_type;
+        self->rxbuf_size = ESPNOW_RXBUF_DEFAULT;
+        mp_obj_memoryview_init(&self->irecv_mac, 'B', 0, ESPNOW_MAC_LEN, self->mac_buf);
+        mp_obj_memoryview_init(&self->irecv_msg, 'B', 0, 0, self->msg_buf);
+        mp_obj_t items[2] = { MP_OBJ_FROM_PTR(&self->irecv_mac), MP_OBJ_FROM_PTR(&self->irecv_msg) };
+        self->irecv_tuple = MP_OBJ_TO_PTR(mp_obj_new_tuple(2, items));
+        MP_STATE_PORT(espnow_singleton) = self;
+    }
+    return MP_OBJ_FROM_PTR(self);
+}
+
+STATIC void espnow_stop(esp_espnow_obj_t *self) {
+    if (self->active) {
+        esp_now_unregister_recv_cb();
+        esp_now_unregister_send_cb();
+        esp_now_deinit();
+        self->active = false;
+    }
+}
+
+STATIC mp_obj_t espnow_active(size_t n_args, const mp_obj_t *args) {
+    esp_espnow_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+    if (n_args > 1) {
+        if (mp_obj_is_true(args[1])) {
+            if (!self->active) {
+                ringbuf_alloc(&self->rx, self->rxbuf_size);
+                espnow_check(esp_now_init());
+                self->active = true;
+                espnow_check(esp_now_register_recv_cb(espnow_recv_cb));
+                espnow_check(esp_now_register_send_cb(espnow_send_cb));
+            }
+        } else {
+            espnow_stop(self);
+        }
+    }
+    return mp_obj_new_bool(self->active);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(espnow_active_obj, 1, 2, espnow_active);
+
+STATIC mp_obj_t espnow_config(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_rxbuf };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_rxbuf, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = -1} },
+    };
+    esp_espnow_obj_t *self = MP_OBJ_TO_PTR(pos_args[0]);
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+    if (args[ARG_rxbuf].u_int >= 0) {
+        // Takes effect the next time ESP-NOW is made active.
+        mp_int_t size = args[ARG_rxbuf].u_int;
+        if (size < 1 + ESPNOW_MAC_LEN + ESP_NOW_MAX_DATA_LEN + 1 || size > UINT16_MAX) {
+            mp_raise_ValueError(MP_ERROR_TEXT("invalid rxbuf"));
+        }
+        self->rxbuf_size = size;
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(espnow_config_obj, 1, espnow_config);
+
+STATIC mp_obj_t espnow_add_peer(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_mac, ARG_lmk, ARG_channel, ARG_ifidx };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_mac, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_lmk, MP_ARG_OBJ, {.u_obj = mp_const_none} },
+        { MP_QSTR_channel, MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_ifidx, MP_ARG_INT, {.u_int = WIFI_IF_STA} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    esp_now_peer_info_t peer = { 0 };
+    memcpy(peer.peer_addr, espnow_get_mac(args[ARG_mac].u_obj), ESPNOW_MAC_LEN);
+    if (args[ARG_lmk].u_obj != mp_const_none) {
+        mp_buffer_info_t bufinfo;
+        mp_get_buffer_raise(args[ARG_lmk].u_obj, &bufinfo, MP_BUFFER_READ);
+        if (bufinfo.len != ESP_NOW_KEY_LEN) {
+            mp_raise_ValueError(MP_ERROR_TEXT("invalid key"));
+        }
+        memcpy(peer.lmk, bufinfo.buf, ESP_NOW_KEY_LEN);
+        peer.encrypt = true;
+    }
+    peer.channel = args[ARG_channel].u_int;
+    peer.ifidx = args[ARG_ifidx].u_int;
+    espnow_check(esp_now_add_peer(&peer));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(espnow_add_peer_obj, 2, espnow_add_peer);
+
+STATIC mp_obj_t espnow_del_peer(mp_obj_t self_in, mp_obj_t mac_in) {
+    espnow_check(esp_now_del_peer(espnow_get_mac(mac_in)));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(espnow_del_peer_obj, espnow_del_peer);
+
+STATIC mp_obj_t espnow_get_peers(mp_obj_t self_in) {
+    esp_now_peer_num_t num;
+    espnow_check(esp_now_get_peer_num(&num));
+    mp_obj_tuple_t *peers = MP_OBJ_TO_PTR(mp_obj_new_tuple(num.total_num, NULL));
+    esp_now_peer_info_t peer;
+    bool from_head = true;
+    for (size_t i = 0; i < peers->len && esp_now_fetch_peer(from_head, &peer) == ESP_OK; ++i) {
+        from_head = false;
+        mp_obj_t items[] = {
+            mp_obj_new_bytes(peer.peer_addr, ESPNOW_MAC_LEN),
+            MP_OBJ_NEW_SMALL_INT(peer.channel),
+            MP_OBJ_NEW_SMALL_INT(peer.ifidx),
+            mp_obj_new_bool(peer.encrypt),
+        };
+        peers->items[i] = mp_obj_new_tuple(MP_ARRAY_SIZE(items), items);
+    }
+    return MP_OBJ_FROM_PTR(peers);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(espnow_get_peers_obj, espnow_get_peers);
+
+STATIC mp_obj_t espnow_send(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_mac, ARG_msg, ARG_sync };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_mac, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_msg, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_sync, MP_ARG_BOOL, {.u_bool = true} },
+    };
+    esp_espnow_obj_t *self = MP_OBJ_TO_PTR(pos_args[0]);
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    mp_buffer_info_t msg;
+    mp_get_buffer_raise(args[ARG_msg].u_obj, &msg, MP_BUFFER_READ);
+    if (msg.len > ESP_NOW_MAX_DATA_LEN) {
+        mp_raise_ValueError(MP_ERROR_TEXT("msg too long"));
+    }
+
+    uint32_t failures = self->tx_failures;
+    uint32_t n_sent = 0;
+    mp_obj_t mac_in = args[ARG_mac].u_obj;
+    if (mac_in == mp_const_none) {
+        // One packet to every registered peer.
+        esp_now_peer_num_t num;
+        espnow_check(esp_now_get_peer_num(&num));
+        espnow_check(esp_now_send(NULL, msg.buf, msg.len));
+        n_sent = num.total_num;
+    } else if (mp_obj_is_type(mac_in, &mp_type_list) || mp_obj_is_type(mac_in, &mp_type_tuple)) {
+        size_t len;
+        mp_obj_t *items;
+        mp_obj_get_array(mac_in, &len, &items);
+        for (size_t i = 0; i < len; ++i) {
+            espnow_check(esp_now_send(espnow_get_mac(items[i]), msg.buf, msg.len));
+            ++n_sent;
+        }
+    } else {
+        espnow_check(esp_now_send(espnow_get_mac(mac_in), msg.buf, msg.len));
+        n_sent = 1;
+    }
+    uint32_t target = (self->tx_packets += n_sent);
+
+    if (!args[ARG_sync].u_bool) {
+        return mp_const_true;
+    }
+    // Wait for the send callbacks of these packets, which report whether each
+    // peer acknowledged at the MAC layer.
+    while ((int32_t)(self->tx_responses + self->tx_failures - target) < 0) {
+        MICROPY_EVENT_POLL_HOOK
+    }
+    return mp_obj_new_bool(self->tx_failures == failures);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(espnow_send_obj, 3, espnow_send);
+
+// Copy the next message into the irecv buffers. Returns false if there is none.
+STATIC bool espnow_take(esp_espnow_obj_t *self) {
+    bool got = false;
+    portENTER_CRITICAL(&espnow_mux);
+    int len = ringbuf_get(&self->rx);
+    if (len >= 0) {
+        for (int i = 0; i < ESPNOW_MAC_LEN; ++i) {
+            self->mac_buf[i] = ringbuf_get(&self->rx);
+        }
+        for (int i = 0; i < len; ++i) {
+            self->msg_buf[i] = ringbuf_get(&self->rx);
+        }
+        self->irecv_msg.len = len;
+        got = true;
+    }
+    portEXIT_CRITICAL(&espnow_mux);
+    return got;
+}
+
+STATIC mp_obj_t espnow_irecv(size_t n_args, const mp_obj_t *args) {
+    esp_espnow_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+    if (!self->active) {
+        espnow_raise(ESP_ERR_ESPNOW_NOT_INIT);
+    }
+    mp_int_t timeout_ms = -1;
+    if (n_args > 1 && args[1] != mp_const_none) {
+        timeout_ms = mp_obj_get_int(args[1]);
+    }
+    mp_uint_t start = mp_hal_ticks_ms();
+    while (!espnow_take(self)) {
+        if (timeout_ms >= 0 && mp_hal_ticks_ms() - start >= (mp_uint_t)timeout_ms) {
+            return mp_const_none;
+        }
+        MICROPY_EVENT_POLL_HOOK
+    }
+    return MP_OBJ_FROM_PTR(self->irecv_tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(espnow_irecv_obj, 1, 2, espnow_irecv);
+
+STATIC mp_obj_t espnow_recv(size_t n_args, const mp_obj_t *args) {
+    esp_espnow_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+    if (espnow_irecv(n_args, args) == mp_const_none) {
+        return mp_const_none;
+    }
+    mp_obj_t items[] = {
+        mp_obj_new_bytes(self->mac_buf, ESPNOW_MAC_LEN),
+        mp_obj_new_bytes(self->msg_buf, self->irecv_msg.len),
+    };
+    return mp_obj_new_tuple(2, items);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(espnow_recv_obj, 1, 2, espnow_recv);
+
+STATIC mp_obj_t espnow_any(mp_obj_t self_in) {
+    esp_espnow_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    return mp_obj_new_bool(self->active && ringbuf_avail(&self->rx) > 0);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(espnow_any_obj, espnow_any);
+
+STATIC mp_obj_t espnow_stats(mp_obj_t self_in) {
+    esp_espnow_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_obj_t items[] = {
+        mp_obj_new_int_from_uint(self->tx_packets),
+        mp_obj_new_int_from_uint(self->tx_responses),
+        mp_obj_new_int_from_uint(self->tx_failures),
+        mp_obj_new_int_from_uint(self->rx_packets),
+        mp_obj_new_int_from_uint(self->rx_dropped),
+    };
+    return mp_obj_new_tuple(MP_ARRAY_SIZE(items), items);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(espnow_stats_obj, espnow_stats);
+
+STATIC mp_uint_t espnow_ioctl(mp_obj_t self_in, mp_uint_t request, uintptr_t arg, int *errcode) {
+    esp_espnow_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (request == MP_STREAM_POLL) {
+        mp_uint_t ret = 0;
+        if ((arg & MP_STREAM_POLL_RD) && self->active && ringbuf_avail(&self->rx) > 0) {
+            ret |= MP_STREAM_POLL_RD;
+        }
+        if ((arg & MP_STREAM_POLL_WR) && self->active) {
+            ret |= MP_STREAM_POLL_WR;
+        }
+        return ret;
+    }
+    *errcode = MP_EINVAL;
+    return MP_STREAM_ERROR;
+}
+
+STATIC const mp_rom_map_elem_t espnow_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_active), MP_ROM_PTR(&espnow_active_obj) },
+    { MP_ROM_QSTR(MP_QSTR_config), MP_ROM_PTR(&espnow_config_obj) },
+    { MP_ROM_QSTR(MP_QSTR_add_peer), MP_ROM_PTR(&espnow_add_peer_obj) },
+    { MP_ROM_QSTR(MP_QSTR_del_peer), MP_ROM_PTR(&espnow_del_peer_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get_peers), MP_ROM_PTR(&espnow_get_peers_obj) },
+    { MP_ROM_QSTR(MP_QSTR_send), MP_ROM_PTR(&espnow_send_obj) },
+    { MP_ROM_QSTR(MP_QSTR_recv), MP_ROM_PTR(&espnow_recv_obj) },
+    { MP_ROM_QSTR(MP_QSTR_irecv), MP_ROM_PTR(&espnow_irecv_obj) },
+    { MP_ROM_QSTR(MP_QSTR_any), MP_ROM_PTR(&espnow_any_obj) },
+    { MP_ROM_QSTR(MP_QSTR_stats), MP_ROM_PTR(&espnow_stats_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(espnow_locals_dict, espnow_locals_dict_table);
+
+STATIC const mp_stream_p_t espnow_stream_p = {
+    .ioctl = espnow_ioctl,
+};
+
+const mp_obj_type_t esp_espnow_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_ESPNow,
+    .make_new = espnow_make_new,
+    .protocol = &espnow_stream_p,
+    .locals_dict = (mp_obj_dict_t *)&espnow_locals_dict,
+};
+
+void espnow_deinit(void) {
+    esp_espnow_obj_t *self = MP_STATE_PORT(espnow_singleton);
+    if (self != NULL) {
+        espnow_stop(self);
+        MP_STATE_PORT(espnow_singleton) = NULL;
+    }
+}
+
+STATIC const mp_rom_map_elem_t espnow_module_globals_table[] = {
+    { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_espnow) },
+    { MP_ROM_QSTR(MP_QSTR_ESPNow), MP_ROM_PTR(&esp_espnow_type) },
+    { MP_ROM_QSTR(MP_QSTR_MAX_DATA_LEN), MP_ROM_INT(ESP_NOW_MAX_DATA_LEN) },
+    { MP_ROM_QSTR(MP_QSTR_MAX_TOTAL_PEER_NUM), MP_ROM_INT(ESP_NOW_MAX_TOTAL_PEER_NUM) },
+};
+STATIC MP_DEFINE_CONST_DICT(espnow_module_globals, espnow_module_globals_table);
+
+const mp_obj_module_t mp_module_espnow = {
+    .base = { &mp_type_module },
+    .globals = (mp_obj_dict_t *)&espnow_module_globals,
+};
+
+#endif // MICROPY_PY_ESPNOW
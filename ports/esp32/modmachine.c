@@ -35,6 +35,7 @@
 #include "esp_sleep.h"
 #include "esp_pm.h"
 #include "driver/touch_pad.h"
+#include "driver/uart.h"
 
 #if CONFIG_IDF_TARGET_ESP32
 #include "esp32/rom/rtc.h"
@@ -52,8 +53,10 @@
 #include "lib/utils/pyexec.h"
 #include "extmod/machine_mem.h"
 #include "extmod/machine_signal.h"
+#include "extmod/machine_pingroup.h"
 #include "extmod/machine_pulse.h"
 #include "extmod/machine_i2c.h"
+#include "extmod/machine_i2s.h"
 #include "extmod/machine_spi.h"
 #include "modmachine.h"
 #include "machine_rtc.h"
@@ -113,6 +116,10 @@ STATIC mp_obj_t machine_sleep_helper(wake_type_t wake_type, size_t n_args, const
 
     mp_int_t expiry = args[ARG_sleep_ms].u_int;
 
+    // Wake sources stay enabled after a sleep, so start from none, otherwise
+    // the timer of an earlier lightsleep(ms) would end a later lightsleep()
+    esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_ALL);
+
     if (expiry != 0) {
         esp_sleep_enable_timer_wakeup(((uint64_t)expiry) * 1000);
     }
@@ -133,6 +140,12 @@ STATIC mp_obj_t machine_sleep_helper(wake_type_t wake_type, size_t n_args, const
         }
     }
 
+    if (machine_rtc_config.uart_wake != -1 && wake_type == MACHINE_WAKE_SLEEP) {
+        // The characters that wake the chip are lost
+        uart_set_wakeup_threshold(machine_rtc_config.uart_wake, machine_rtc_config.uart_wake_threshold);
+        esp_sleep_enable_uart_wakeup(machine_rtc_config.uart_wake);
+    }
+
     switch (wake_type) {
         case MACHINE_WAKE_SLEEP:
             esp_light_sleep_start();
@@ -273,6 +286,9 @@ STATIC const mp_rom_map_elem_t machine_module_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_DEEPSLEEP), MP_ROM_INT(MACHINE_WAKE_DEEPSLEEP) },
     { MP_ROM_QSTR(MP_QSTR_Pin), MP_ROM_PTR(&machine_pin_type) },
     { MP_ROM_QSTR(MP_QSTR_Signal), MP_ROM_PTR(&machine_signal_type) },
+    #if MICROPY_PY_MACHINE_PINGROUP
+    { MP_ROM_QSTR(MP_QSTR_PinGroup), MP_ROM_PTR(&machine_pingroup_type) },
+    #endif
     #if CONFIG_IDF_TARGET_ESP32
     { MP_ROM_QSTR(MP_QSTR_TouchPad), MP_ROM_PTR(&machine_touchpad_type) },
     #endif
@@ -280,7 +296,12 @@ STATIC const mp_rom_map_elem_t machine_module_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_DAC), MP_ROM_PTR(&machine_dac_type) },
     { MP_ROM_QSTR(MP_QSTR_I2C), MP_ROM_PTR(&machine_hw_i2c_type) },
     { MP_ROM_QSTR(MP_QSTR_SoftI2C), MP_ROM_PTR(&mp_machine_soft_i2c_type) },
+    #if MICROPY_PY_MACHINE_I2S
+    { MP_ROM_QSTR(MP_QSTR_I2S), MP_ROM_PTR(&machine_i2s_type) },
+    #endif
     { MP_ROM_QSTR(MP_QSTR_PWM), MP_ROM_PTR(&machine_pwm_type) },
+    { MP_ROM_QSTR(MP_QSTR_Counter), MP_ROM_PTR(&machine_counter_type) },
+    { MP_ROM_QSTR(MP_QSTR_Encoder), MP_ROM_PTR(&machine_encoder_type) },
     { MP_ROM_QSTR(MP_QSTR_RTC), MP_ROM_PTR(&machine_rtc_type) },
     { MP_ROM_QSTR(MP_QSTR_SPI), MP_ROM_PTR(&machine_hw_spi_type) },
     { MP_ROM_QSTR(MP_QSTR_SoftSPI), MP_ROM_PTR(&mp_machine_soft_spi_type) },
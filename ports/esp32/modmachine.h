@@ -21,11 +21,16 @@ extern const mp_obj_type_t machine_hw_spi_type;
 extern const mp_obj_type_t machine_uart_type;
 extern const mp_obj_type_t machine_rtc_type;
 extern const mp_obj_type_t machine_sdcard_type;
+extern const mp_obj_type_t machine_counter_type;
+extern const mp_obj_type_t machine_encoder_type;
 
 void machine_init(void);
 void machine_deinit(void);
 void machine_pins_init(void);
 void machine_pins_deinit(void);
 void machine_timer_deinit_all(void);
+void machine_hw_spi_deinit_all(void);
+void machine_pcnt_deinit_all(void);
+void machine_i2s_deinit_all(void);
 
 #endif // MICROPY_INCLUDED_ESP32_MODMACHINE_H
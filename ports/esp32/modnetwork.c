@@ -44,7 +44,9 @@
 #include "esp_eth.h"
 #include "esp_wifi.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "lwip/dns.h"
+#include "lwip/netif.h"
 #include "mdns.h"
 
 #if !MICROPY_ESP_IDF_4
@@ -137,11 +139,39 @@ static bool wifi_sta_connected = false;
 // Store the current status. 0 means None here, safe to do so as first enum value is WIFI_REASON_UNSPECIFIED=1.
 static uint8_t wifi_sta_disconn_reason = 0;
 
+// Link statistics for the STA interface, returned by WLAN.status('stats').
+#define WIFI_STA_RSSI_HISTORY (8)
+#define WIFI_STA_RSSI_PERIOD_US (1000000)
+typedef struct _wifi_sta_stats_t {
+    uint32_t connects;
+    uint32_t disconnects;
+    uint32_t beacon_timeouts;
+    uint8_t rssi_next;
+    uint8_t rssi_len;
+    int8_t rssi[WIFI_STA_RSSI_HISTORY];
+} wifi_sta_stats_t;
+static wifi_sta_stats_t wifi_sta_stats;
+
+// Samples the RSSI into wifi_sta_stats while the STA is associated.
+static esp_timer_handle_t wifi_sta_rssi_timer = NULL;
+
 #if MICROPY_HW_ENABLE_MDNS_QUERIES || MICROPY_HW_ENABLE_MDNS_RESPONDER
 // Whether mDNS has been initialised or not
 static bool mdns_initialised = false;
 #endif
 
+// Runs in the esp_timer task.
+static void wifi_sta_rssi_sample(void *arg) {
+    wifi_ap_record_t info;
+    if (esp_wifi_sta_get_ap_info(&info) == ESP_OK) {
+        wifi_sta_stats.rssi[wifi_sta_stats.rssi_next] = info.rssi;
+        wifi_sta_stats.rssi_next = (wifi_sta_stats.rssi_next + 1) % WIFI_STA_RSSI_HISTORY;
+        if (wifi_sta_stats.rssi_len < WIFI_STA_RSSI_HISTORY) {
+            ++wifi_sta_stats.rssi_len;
+        }
+    }
+}
+
 // This function is called by the system-event task and so runs in a different
 // thread to the main MicroPython task.  It must not raise any Python exceptions.
 static esp_err_t event_handler(void *ctx, system_event_t *event) {
@@ -151,6 +181,11 @@ static esp_err_t event_handler(void *ctx, system_event_t *event) {
             break;
         case SYSTEM_EVENT_STA_CONNECTED:
             ESP_LOGI("network", "CONNECTED");
+            ++wifi_sta_stats.connects;
+            wifi_sta_stats.rssi_len = 0;
+            if (wifi_sta_rssi_timer != NULL) {
+                esp_timer_start_periodic(wifi_sta_rssi_timer, WIFI_STA_RSSI_PERIOD_US);
+            }
             break;
         case SYSTEM_EVENT_STA_GOT_IP:
             ESP_LOGI("network", "GOT_IP");
@@ -177,9 +212,15 @@ static esp_err_t event_handler(void *ctx, system_event_t *event) {
             system_event_sta_disconnected_t *disconn = &event->event_info.disconnected;
             char *message = "";
             wifi_sta_disconn_reason = disconn->reason;
+            ++wifi_sta_stats.disconnects;
+            if (wifi_sta_rssi_timer != NULL) {
+                // Fails harmlessly if the timer isn't running.
+                esp_timer_stop(wifi_sta_rssi_timer);
+            }
             switch (disconn->reason) {
                 case WIFI_REASON_BEACON_TIMEOUT:
                     // AP has dropped out; try to reconnect.
+                    ++wifi_sta_stats.beacon_timeouts;
                     message = "\nbeacon timeout";
                     break;
                 case WIFI_REASON_NO_AP_FOUND:
@@ -257,6 +298,11 @@ STATIC mp_obj_t get_wlan(size_t n_args, const mp_obj_t *args) {
         ESP_LOGD("modnetwork", "Initializing WiFi");
         ESP_EXCEPTIONS(esp_wifi_init(&cfg));
         ESP_EXCEPTIONS(esp_wifi_set_storage(WIFI_STORAGE_RAM));
+        const esp_timer_create_args_t timer_args = {
+            .callback = wifi_sta_rssi_sample,
+            .name = "wifi_rssi",
+        };
+        ESP_EXCEPTIONS(esp_timer_create(&timer_args, &wifi_sta_rssi_timer));
         ESP_LOGD("modnetwork", "Initialized");
         initialized = 1;
     }
@@ -433,6 +479,31 @@ STATIC mp_obj_t esp_status(size_t n_args, const mp_obj_t *args) {
             ESP_EXCEPTIONS(esp_wifi_sta_get_ap_info(&info));
             return MP_OBJ_NEW_SMALL_INT(info.rssi);
         }
+        case (uintptr_t)MP_OBJ_NEW_QSTR(MP_QSTR_stats): {
+            // return link counters and recent RSSI samples, only in STA mode
+            require_if(args[0], WIFI_IF_STA);
+            wifi_sta_stats_t stats = wifi_sta_stats;
+            mp_obj_t rssi = mp_obj_new_list(0, NULL);
+            for (size_t i = 0; i < stats.rssi_len; ++i) {
+                // oldest sample first
+                size_t idx = (stats.rssi_next + WIFI_STA_RSSI_HISTORY - stats.rssi_len + i) % WIFI_STA_RSSI_HISTORY;
+                mp_obj_list_append(rssi, MP_OBJ_NEW_SMALL_INT(stats.rssi[idx]));
+            }
+            mp_obj_t dict = mp_obj_new_dict(6);
+            mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(MP_QSTR_connects), mp_obj_new_int_from_uint(stats.connects));
+            mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(MP_QSTR_disconnects), mp_obj_new_int_from_uint(stats.disconnects));
+            mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(MP_QSTR_beacon_timeouts), mp_obj_new_int_from_uint(stats.beacon_timeouts));
+            mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(MP_QSTR_rssi), rssi);
+            #if MIB2_STATS
+            struct netif *netif = NULL;
+            tcpip_adapter_get_netif(TCPIP_ADAPTER_IF_STA, (void **)&netif);
+            if (netif != NULL) {
+                mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(MP_QSTR_tx_bytes), mp_obj_new_int_from_uint(netif->mib2_counters.ifoutoctets));
+                mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(MP_QSTR_rx_bytes), mp_obj_new_int_from_uint(netif->mib2_counters.ifinoctets));
+            }
+            #endif
+            return dict;
+        }
         default:
             mp_raise_ValueError(MP_ERROR_TEXT("unknown status param"));
     }
@@ -633,6 +704,23 @@ STATIC mp_obj_t esp_config(size_t n_args, const mp_obj_t *args, mp_map_t *kwargs
                         cfg.ap.max_connection = mp_obj_get_int(kwargs->table[i].value);
                         break;
                     }
+                    case QS(MP_QSTR_ps_mode): {
+                        ESP_EXCEPTIONS(esp_wifi_set_ps(mp_obj_get_int(kwargs->table[i].value)));
+                        break;
+                    }
+                    case QS(MP_QSTR_listen_interval): {
+                        // In beacon intervals; only used in PS_MAX_MODEM and
+                        // takes effect on the next association.
+                        req_if = WIFI_IF_STA;
+                        cfg.sta.listen_interval = mp_obj_get_int(kwargs->table[i].value);
+                        break;
+                    }
+                    case QS(MP_QSTR_txpower): {
+                        // Given in dBm, set in units of 0.25 dBm.
+                        int8_t power = (mp_obj_get_float(kwargs->table[i].value) * 4);
+                        ESP_EXCEPTIONS(esp_wifi_set_max_tx_power(power));
+                        break;
+                    }
                     default:
                         goto unknown;
                 }
@@ -711,6 +799,23 @@ STATIC mp_obj_t esp_config(size_t n_args, const mp_obj_t *args, mp_map_t *kwargs
             val = MP_OBJ_NEW_SMALL_INT(cfg.ap.max_connection);
             break;
         }
+        case QS(MP_QSTR_ps_mode): {
+            wifi_ps_type_t ps_mode;
+            ESP_EXCEPTIONS(esp_wifi_get_ps(&ps_mode));
+            val = MP_OBJ_NEW_SMALL_INT(ps_mode);
+            break;
+        }
+        case QS(MP_QSTR_listen_interval): {
+            req_if = WIFI_IF_STA;
+            val = MP_OBJ_NEW_SMALL_INT(cfg.sta.listen_interval);
+            break;
+        }
+        case QS(MP_QSTR_txpower): {
+            int8_t power;
+            ESP_EXCEPTIONS(esp_wifi_get_max_tx_power(&power));
+            val = mp_obj_new_float(power * 0.25);
+            break;
+        }
         default:
             goto unknown;
     }
@@ -798,6 +903,10 @@ STATIC const mp_rom_map_elem_t mp_module_network_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_ETH_CLOCK_GPIO17_OUT), MP_ROM_INT(ETH_CLOCK_GPIO17_OUT) },
     #endif
 
+    { MP_ROM_QSTR(MP_QSTR_PS_NONE), MP_ROM_INT(WIFI_PS_NONE)},
+    { MP_ROM_QSTR(MP_QSTR_PS_MIN_MODEM), MP_ROM_INT(WIFI_PS_MIN_MODEM)},
+    { MP_ROM_QSTR(MP_QSTR_PS_MAX_MODEM), MP_ROM_INT(WIFI_PS_MAX_MODEM)},
+
     { MP_ROM_QSTR(MP_QSTR_STAT_IDLE), MP_ROM_INT(STAT_IDLE)},
     { MP_ROM_QSTR(MP_QSTR_STAT_CONNECTING), MP_ROM_INT(STAT_CONNECTING)},
     { MP_ROM_QSTR(MP_QSTR_STAT_GOT_IP), MP_ROM_INT(STAT_GOT_IP)},
@@ -45,11 +45,13 @@
 #include "py/mphal.h"
 #include "py/stream.h"
 #include "py/mperrno.h"
+#include "extmod/misc.h"
 #include "lib/netutils/netutils.h"
 #include "mdns.h"
 #include "modnetwork.h"
 
 #include "lwip/sockets.h"
+#include "lwip/priv/sockets_priv.h"
 #include "lwip/netdb.h"
 #include "lwip/ip4.h"
 #include "lwip/igmp.h"
@@ -75,71 +77,125 @@ typedef struct _socket_obj_t {
     unsigned int retries;
     #if MICROPY_PY_USOCKET_EVENTS
     mp_obj_t events_callback;
-    struct _socket_obj_t *events_next;
     #endif
 } socket_obj_t;
 
 void _socket_settimeout(socket_obj_t *sock, uint64_t timeout_ms);
 
+// Returns the MP_STREAM_POLL_xxx flags of the socket from the event counts
+// that lwIP keeps for it, which is what lwip_select() looks at, but without
+// the cost of a select() call
+STATIC mp_uint_t socket_poll_flags(int fd) {
+    mp_uint_t ret = 0;
+    SYS_ARCH_DECL_PROTECT(lev);
+    SYS_ARCH_PROTECT(lev);
+    struct lwip_sock *sock = lwip_socket_dbg_get_socket(fd);
+    if (sock != NULL) {
+        if (sock->lastdata.pbuf != NULL || sock->rcvevent > 0) {
+            ret |= MP_STREAM_POLL_RD;
+        }
+        if (sock->sendevent != 0) {
+            ret |= MP_STREAM_POLL_WR;
+        }
+        if (sock->errevent != 0) {
+            ret |= MP_STREAM_POLL_HUP;
+        }
+    }
+    SYS_ARCH_UNPROTECT(lev);
+    return ret;
+}
+
 #if MICROPY_PY_USOCKET_EVENTS
 // Support for callbacks on asynchronous socket events (when socket becomes readable)
+//
+// lwIP calls the callback of the netconn behind a socket, from the tcpip thread,
+// for each event on it.  For sockets with a Python callback the netconn callback
+// is wrapped so it also marks the socket in a bit mask of ready sockets, and the
+// handler only has to look at the sockets in that mask.
 
-// This divisor is used to reduce the load on the system, so it doesn't poll sockets too often
-#define USOCKET_EVENTS_DIVISOR (8)
+#define USOCKET_EVENTS_WORDS ((CONFIG_LWIP_MAX_SOCKETS + 31) / 32)
 
-STATIC uint8_t usocket_events_divisor;
-STATIC socket_obj_t *usocket_events_head;
+STATIC portMUX_TYPE usocket_events_mux = portMUX_INITIALIZER_UNLOCKED;
+STATIC volatile uint32_t usocket_events_ready[USOCKET_EVENTS_WORDS];
+STATIC netconn_callback usocket_events_lwip_callback;
 
 void usocket_events_deinit(void) {
-    usocket_events_head = NULL;
+    memset(MP_STATE_PORT(usocket_events_sock), 0, sizeof(MP_STATE_PORT(usocket_events_sock)));
+    memset((void *)usocket_events_ready, 0, sizeof(usocket_events_ready));
 }
 
-// Assumes the socket is not already in the linked list, and adds it
-STATIC void usocket_events_add(socket_obj_t *sock) {
-    sock->events_next = usocket_events_head;
-    usocket_events_head = sock;
+STATIC void usocket_events_set_ready(int idx) {
+    portENTER_CRITICAL(&usocket_events_mux);
+    usocket_events_ready[idx / 32] |= 1 << (idx % 32);
+    portEXIT_CRITICAL(&usocket_events_mux);
 }
 
-// Assumes the socket is already in the linked list, and removes it
-STATIC void usocket_events_remove(socket_obj_t *sock) {
-    for (socket_obj_t **s = &usocket_events_head;; s = &(*s)->events_next) {
-        if (*s == sock) {
-            *s = (*s)->events_next;
-            return;
-        }
+STATIC void usocket_events_callback(struct netconn *conn, enum netconn_evt evt, u16_t len) {
+    usocket_events_lwip_callback(conn, evt, len);
+    int idx = conn->socket - LWIP_SOCKET_OFFSET;
+    if ((evt == NETCONN_EVT_RCVPLUS || evt == NETCONN_EVT_ERROR)
+        && idx >= 0 && idx < CONFIG_LWIP_MAX_SOCKETS) {
+        usocket_events_set_ready(idx);
     }
 }
 
-// Polls all registered sockets for readability and calls their callback if they are readable
-void usocket_events_handler(void) {
-    if (usocket_events_head == NULL) {
-        return;
-    }
-    if (--usocket_events_divisor) {
-        return;
+STATIC void usocket_events_set_netconn_callback(int fd, bool wrap) {
+    SYS_ARCH_DECL_PROTECT(lev);
+    SYS_ARCH_PROTECT(lev);
+    struct lwip_sock *sock = lwip_socket_dbg_get_socket(fd);
+    if (sock != NULL && sock->conn != NULL) {
+        if (wrap) {
+            if (sock->conn->callback != usocket_events_callback) {
+                // all sockets share lwIP's callback
+                usocket_events_lwip_callback = sock->conn->callback;
+                sock->conn->callback = usocket_events_callback;
+            }
+        } else if (sock->conn->callback == usocket_events_callback) {
+            sock->conn->callback = usocket_events_lwip_callback;
+        }
     }
-    usocket_events_divisor = USOCKET_EVENTS_DIVISOR;
-
-    fd_set rfds;
-    FD_ZERO(&rfds);
-    int max_fd = 0;
+    SYS_ARCH_UNPROTECT(lev);
+}
 
-    for (socket_obj_t *s = usocket_events_head; s != NULL; s = s->events_next) {
-        FD_SET(s->fd, &rfds);
-        max_fd = MAX(max_fd, s->fd);
+// Assumes the socket is not already registered, and registers it
+STATIC void usocket_events_add(socket_obj_t *sock) {
+    MP_STATE_PORT(usocket_events_sock)[sock->fd - LWIP_SOCKET_OFFSET] = sock;
+    usocket_events_set_netconn_callback(sock->fd, true);
+    if (socket_poll_flags(sock->fd) & (MP_STREAM_POLL_RD | MP_STREAM_POLL_HUP)) {
+        usocket_events_set_ready(sock->fd - LWIP_SOCKET_OFFSET);
     }
+}
 
-    // Poll the sockets
-    struct timeval timeout = { .tv_sec = 0, .tv_usec = 0 };
-    int r = select(max_fd + 1, &rfds, NULL, NULL, &timeout);
-    if (r <= 0) {
-        return;
-    }
+// Assumes the socket is registered, and unregisters it
+STATIC void usocket_events_remove(socket_obj_t *sock) {
+    usocket_events_set_netconn_callback(sock->fd, false);
+    MP_STATE_PORT(usocket_events_sock)[sock->fd - LWIP_SOCKET_OFFSET] = NULL;
+}
 
-    // Call the callbacks
-    for (socket_obj_t *s = usocket_events_head; s != NULL; s = s->events_next) {
-        if (FD_ISSET(s->fd, &rfds)) {
+// Calls the callbacks of the registered sockets that became readable
+void usocket_events_handler(void) {
+    for (size_t w = 0; w < USOCKET_EVENTS_WORDS; ++w) {
+        if (usocket_events_ready[w] == 0) {
+            continue;
+        }
+        portENTER_CRITICAL(&usocket_events_mux);
+        uint32_t ready = usocket_events_ready[w];
+        usocket_events_ready[w] = 0;
+        portEXIT_CRITICAL(&usocket_events_mux);
+        while (ready) {
+            int idx = w * 32 + __builtin_ctz(ready);
+            ready &= ready - 1;
+            socket_obj_t *s = MP_STATE_PORT(usocket_events_sock)[idx];
+            if (s == NULL) {
+                continue;
+            }
             mp_call_function_1_protected(s->events_callback, s);
+            // Like select() would, keep calling the callback while there is
+            // data left, rather than only when more arrives
+            if (MP_STATE_PORT(usocket_events_sock)[idx] == s
+                && socket_poll_flags(s->fd) & (MP_STREAM_POLL_RD | MP_STREAM_POLL_HUP)) {
+                usocket_events_set_ready(idx);
+            }
         }
     }
 }
@@ -150,6 +206,36 @@ static inline void check_for_exceptions(void) {
     mp_handle_pending(true);
 }
 
+// Makes an addrinfo result for an IPv4 address in network order, like those
+// made by lwip_getaddrinfo (and also freed by lwip_freeaddrinfo)
+static int _socket_new_addrinfo(const char *nodename, const char *servname, const uint8_t *ip, struct addrinfo **res) {
+    struct addrinfo *ai = memp_malloc(MEMP_NETDB);
+    if (ai == NULL) {
+        *res = NULL;
+        return EAI_MEMORY;
+    }
+    memset(ai, 0, sizeof(struct addrinfo) + sizeof(struct sockaddr_storage));
+
+    size_t nodename_len = strlen(nodename);
+    if (nodename_len > DNS_MAX_NAME_LENGTH) {
+        nodename_len = DNS_MAX_NAME_LENGTH;
+    }
+    struct sockaddr_in *sa = (struct sockaddr_in *)((uint8_t *)ai + sizeof(struct addrinfo));
+    memcpy(&sa->sin_addr, ip, sizeof(sa->sin_addr));
+    sa->sin_family = AF_INET;
+    sa->sin_len = sizeof(struct sockaddr_in);
+    sa->sin_port = lwip_htons((u16_t)atoi(servname));
+    ai->ai_family = AF_INET;
+    ai->ai_canonname = ((char *)sa + sizeof(struct sockaddr_storage));
+    memcpy(ai->ai_canonname, nodename, nodename_len);
+    ai->ai_canonname[nodename_len] = '\0';
+    ai->ai_addrlen = sizeof(struct sockaddr_storage);
+    ai->ai_addr = (struct sockaddr *)sa;
+
+    *res = ai;
+    return 0;
+}
+
 // This function mimics lwip_getaddrinfo, with added support for mDNS queries
 static int _socket_getaddrinfo3(const char *nodename, const char *servname,
     const struct addrinfo *hints, struct addrinfo **res) {
@@ -180,26 +266,9 @@ static int _socket_getaddrinfo3(const char *nodename, const char *servname,
             return err;
         }
 
-        struct addrinfo *ai = memp_malloc(MEMP_NETDB);
-        if (ai == NULL) {
-            *res = NULL;
-            return EAI_MEMORY;
-        }
-        memset(ai, 0, sizeof(struct addrinfo) + sizeof(struct sockaddr_storage));
-
-        struct sockaddr_in *sa = (struct sockaddr_in *)((uint8_t *)ai + sizeof(struct addrinfo));
-        inet_addr_from_ip4addr(&sa->sin_addr, &addr);
-        sa->sin_family = AF_INET;
-        sa->sin_len = sizeof(struct sockaddr_in);
-        sa->sin_port = lwip_htons((u16_t)atoi(servname));
-        ai->ai_family = AF_INET;
-        ai->ai_canonname = ((char *)sa + sizeof(struct sockaddr_storage));
-        memcpy(ai->ai_canonname, nodename, nodename_len + 1);
-        ai->ai_addrlen = sizeof(struct sockaddr_storage);
-        ai->ai_addr = (struct sockaddr *)sa;
-
-        *res = ai;
-        return 0;
+        struct in_addr in;
+        inet_addr_from_ip4addr(&in, &addr);
+        return _socket_new_addrinfo(nodename, servname, (uint8_t *)&in, res);
     }
     #endif
 
@@ -228,6 +297,17 @@ static int _socket_getaddrinfo2(const mp_obj_t host, const mp_obj_t portx, struc
         host_str = "0.0.0.0";
     }
 
+    #if MICROPY_PY_USOCKET_DNS_CACHE
+    uint8_t ip[NETUTILS_IPV4ADDR_BUFSIZE];
+    if (netutils_dns_cache_lookup(host_str, ip)) {
+        int res = _socket_new_addrinfo(host_str, port_str, ip, resp);
+        if (res != 0) {
+            mp_raise_OSError(-res);
+        }
+        return res;
+    }
+    #endif
+
     MP_THREAD_GIL_EXIT();
     int res = _socket_getaddrinfo3(host_str, port_str, &hints, resp);
     MP_THREAD_GIL_ENTER();
@@ -243,6 +323,14 @@ static int _socket_getaddrinfo2(const mp_obj_t host, const mp_obj_t portx, struc
         mp_raise_OSError(-2); // name or service not known
     }
 
+    #if MICROPY_PY_USOCKET_DNS_CACHE
+    // Keep names that needed a (m)DNS query, not address literals
+    struct in_addr literal;
+    if (!inet_aton(host_str, &literal)) {
+        netutils_dns_cache_add(host_str, (uint8_t *)&((struct sockaddr_in *)resp[0]->ai_addr)->sin_addr);
+    }
+    #endif
+
     return res;
 }
 
@@ -612,36 +700,128 @@ STATIC mp_obj_t socket_sendall(const mp_obj_t arg0, const mp_obj_t arg1) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(socket_sendall_obj, socket_sendall);
 
-STATIC mp_obj_t socket_sendto(mp_obj_t self_in, mp_obj_t data_in, mp_obj_t addr_in) {
-    socket_obj_t *self = MP_OBJ_TO_PTR(self_in);
+STATIC void _socket_parse_sockaddr(mp_obj_t addr_in, struct sockaddr_in *to) {
+    to->sin_len = sizeof(*to);
+    to->sin_family = AF_INET;
+    to->sin_port = lwip_htons(netutils_parse_inet_addr(addr_in, (uint8_t *)&to->sin_addr, NETUTILS_BIG));
+}
 
+STATIC int _socket_sendto(socket_obj_t *sock, mp_obj_t data_in, const struct sockaddr_in *to, int *errcode) {
     // get the buffer to send
     mp_buffer_info_t bufinfo;
     mp_get_buffer_raise(data_in, &bufinfo, MP_BUFFER_READ);
 
-    // create the destination address
-    struct sockaddr_in to;
-    to.sin_len = sizeof(to);
-    to.sin_family = AF_INET;
-    to.sin_port = lwip_htons(netutils_parse_inet_addr(addr_in, (uint8_t *)&to.sin_addr, NETUTILS_BIG));
-
     // send the data
-    for (int i = 0; i <= self->retries; i++) {
+    for (int i = 0; i <= sock->retries; i++) {
         MP_THREAD_GIL_EXIT();
-        int ret = lwip_sendto(self->fd, bufinfo.buf, bufinfo.len, 0, (struct sockaddr *)&to, sizeof(to));
+        int ret = lwip_sendto(sock->fd, bufinfo.buf, bufinfo.len, 0, (const struct sockaddr *)to, sizeof(*to));
         MP_THREAD_GIL_ENTER();
         if (ret > 0) {
-            return mp_obj_new_int_from_uint(ret);
+            return ret;
         }
         if (ret == -1 && errno != EWOULDBLOCK) {
-            mp_raise_OSError(errno);
+            *errcode = errno;
+            return -1;
         }
         check_for_exceptions();
     }
-    mp_raise_OSError(MP_ETIMEDOUT);
+    *errcode = MP_ETIMEDOUT;
+    return -1;
+}
+
+STATIC mp_obj_t socket_sendto(mp_obj_t self_in, mp_obj_t data_in, mp_obj_t addr_in) {
+    socket_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    // create the destination address
+    struct sockaddr_in to;
+    _socket_parse_sockaddr(addr_in, &to);
+
+    int errcode;
+    int ret = _socket_sendto(self, data_in, &to, &errcode);
+    if (ret == -1) {
+        mp_raise_OSError(errcode);
+    }
+    return mp_obj_new_int_from_uint(ret);
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_3(socket_sendto_obj, socket_sendto);
 
+#if MICROPY_PY_USOCKET_BATCH
+STATIC mp_obj_t socket_sendto_many(mp_obj_t self_in, mp_obj_t bufs_in, mp_obj_t addr_in) {
+    socket_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    size_t n;
+    mp_obj_t *bufs;
+    mp_obj_get_array(bufs_in, &n, &bufs);
+
+    // A list gives an address for each datagram, otherwise they all go to the same place
+    mp_obj_t *addrs = NULL;
+    struct sockaddr_in to;
+    if (mp_obj_is_type(addr_in, &mp_type_list)) {
+        mp_obj_get_array_fixed_n(addr_in, n, &addrs);
+    } else {
+        _socket_parse_sockaddr(addr_in, &to);
+    }
+
+    size_t i = 0;
+    for (; i < n; ++i) {
+        if (addrs != NULL) {
+            _socket_parse_sockaddr(addrs[i], &to);
+        }
+        int errcode;
+        if (_socket_sendto(self, bufs[i], &to, &errcode) == -1) {
+            if (i == 0) {
+                mp_raise_OSError(errcode);
+            }
+            // Report the datagrams that were sent
+            break;
+        }
+    }
+
+    return MP_OBJ_NEW_SMALL_INT(i);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(socket_sendto_many_obj, socket_sendto_many);
+
+STATIC mp_obj_t socket_recvfrom_into_many(size_t n_args, const mp_obj_t *args) {
+    size_t n;
+    mp_obj_t *bufs;
+    mp_obj_get_array(args[1], &n, &bufs);
+    mp_obj_t addrs = n_args > 2 ? args[2] : mp_const_none;
+
+    // Wait as usual for the first datagram, then take only those already queued
+    mp_obj_t sizes = mp_obj_new_list(0, NULL);
+    for (size_t i = 0; i < n; ++i) {
+        mp_buffer_info_t bufinfo;
+        mp_get_buffer_raise(bufs[i], &bufinfo, MP_BUFFER_WRITE);
+        struct sockaddr_in from;
+        socklen_t fromlen = sizeof(from);
+        mp_uint_t ret;
+        if (i == 0) {
+            int errcode;
+            ret = _socket_read_data(args[0], bufinfo.buf, bufinfo.len, (struct sockaddr *)&from, &fromlen, &errcode);
+            if (ret == MP_STREAM_ERROR) {
+                mp_raise_OSError(errcode);
+            }
+        } else {
+            socket_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+            int r = lwip_recvfrom(self->fd, bufinfo.buf, bufinfo.len, MSG_DONTWAIT, (struct sockaddr *)&from, &fromlen);
+            if (r < 0) {
+                break;
+            }
+            ret = r;
+        }
+        mp_obj_list_append(sizes, MP_OBJ_NEW_SMALL_INT(ret));
+        if (addrs != mp_const_none) {
+            uint8_t *ip = (uint8_t *)&from.sin_addr;
+            mp_uint_t port = lwip_ntohs(from.sin_port);
+            mp_obj_subscr(addrs, MP_OBJ_NEW_SMALL_INT(i), netutils_format_inet_addr(ip, port, NETUTILS_BIG));
+        }
+    }
+
+    return sizes;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(socket_recvfrom_into_many_obj, 2, 3, socket_recvfrom_into_many);
+#endif
+
 STATIC mp_obj_t socket_fileno(const mp_obj_t arg0) {
     socket_obj_t *self = MP_OBJ_TO_PTR(arg0);
     return mp_obj_new_int(self->fd);
@@ -685,39 +865,7 @@ STATIC mp_uint_t socket_stream_ioctl(mp_obj_t self_in, mp_uint_t request, uintpt
             return MP_STREAM_POLL_NVAL;
         }
 
-        fd_set rfds;
-        FD_ZERO(&rfds);
-        fd_set wfds;
-        FD_ZERO(&wfds);
-        fd_set efds;
-        FD_ZERO(&efds);
-        struct timeval timeout = { .tv_sec = 0, .tv_usec = 0 };
-        if (arg & MP_STREAM_POLL_RD) {
-            FD_SET(socket->fd, &rfds);
-        }
-        if (arg & MP_STREAM_POLL_WR) {
-            FD_SET(socket->fd, &wfds);
-        }
-        if (arg & MP_STREAM_POLL_HUP) {
-            FD_SET(socket->fd, &efds);
-        }
-
-        int r = select((socket->fd) + 1, &rfds, &wfds, &efds, &timeout);
-        if (r < 0) {
-            *errcode = MP_EIO;
-            return MP_STREAM_ERROR;
-        }
-
-        mp_uint_t ret = 0;
-        if (FD_ISSET(socket->fd, &rfds)) {
-            ret |= MP_STREAM_POLL_RD;
-        }
-        if (FD_ISSET(socket->fd, &wfds)) {
-            ret |= MP_STREAM_POLL_WR;
-        }
-        if (FD_ISSET(socket->fd, &efds)) {
-            ret |= MP_STREAM_POLL_HUP;
-        }
+        mp_uint_t ret = socket_poll_flags(socket->fd) & arg;
 
         // New (unconnected) sockets are writable and have HUP set.
         if (socket->state == SOCKET_STATE_NEW) {
@@ -759,6 +907,10 @@ STATIC const mp_rom_map_elem_t socket_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_sendto), MP_ROM_PTR(&socket_sendto_obj) },
     { MP_ROM_QSTR(MP_QSTR_recv), MP_ROM_PTR(&socket_recv_obj) },
     { MP_ROM_QSTR(MP_QSTR_recvfrom), MP_ROM_PTR(&socket_recvfrom_obj) },
+    #if MICROPY_PY_USOCKET_BATCH
+    { MP_ROM_QSTR(MP_QSTR_sendto_many), MP_ROM_PTR(&socket_sendto_many_obj) },
+    { MP_ROM_QSTR(MP_QSTR_recvfrom_into_many), MP_ROM_PTR(&socket_recvfrom_into_many_obj) },
+    #endif
     { MP_ROM_QSTR(MP_QSTR_setsockopt), MP_ROM_PTR(&socket_setsockopt_obj) },
     { MP_ROM_QSTR(MP_QSTR_settimeout), MP_ROM_PTR(&socket_settimeout_obj) },
     { MP_ROM_QSTR(MP_QSTR_setblocking), MP_ROM_PTR(&socket_setblocking_obj) },
@@ -768,6 +920,9 @@ STATIC const mp_rom_map_elem_t socket_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_read), MP_ROM_PTR(&mp_stream_read_obj) },
     { MP_ROM_QSTR(MP_QSTR_readinto), MP_ROM_PTR(&mp_stream_readinto_obj) },
     { MP_ROM_QSTR(MP_QSTR_readline), MP_ROM_PTR(&mp_stream_unbuffered_readline_obj) },
+#if MICROPY_STREAMS_READLINE_INTO
+    { MP_ROM_QSTR(MP_QSTR_readline_into), MP_ROM_PTR(&mp_stream_unbuffered_readline_into_obj) },
+#endif
     { MP_ROM_QSTR(MP_QSTR_write), MP_ROM_PTR(&mp_stream_write_obj) },
 };
 STATIC MP_DEFINE_CONST_DICT(socket_locals_dict, socket_locals_dict_table);
@@ -840,6 +995,13 @@ STATIC const mp_rom_map_elem_t mp_module_socket_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR___init__), MP_ROM_PTR(&esp_socket_initialize_obj) },
     { MP_ROM_QSTR(MP_QSTR_socket), MP_ROM_PTR(&socket_type) },
     { MP_ROM_QSTR(MP_QSTR_getaddrinfo), MP_ROM_PTR(&esp_socket_getaddrinfo_obj) },
+    #if MICROPY_PY_USOCKET_POOL
+    { MP_ROM_QSTR(MP_QSTR_Pool), MP_ROM_PTR(&mp_type_usocket_pool) },
+    #endif
+    #if MICROPY_PY_USOCKET_DNS_CACHE
+    { MP_ROM_QSTR(MP_QSTR_dns_cache_info), MP_ROM_PTR(&netutils_dns_cache_info_obj) },
+    { MP_ROM_QSTR(MP_QSTR_dns_cache_flush), MP_ROM_PTR(&netutils_dns_cache_flush_obj) },
+    #endif
 
     { MP_ROM_QSTR(MP_QSTR_AF_INET), MP_ROM_INT(AF_INET) },
     { MP_ROM_QSTR(MP_QSTR_AF_INET6), MP_ROM_INT(AF_INET6) },
@@ -7,13 +7,23 @@ from esp import neopixel_write
 class NeoPixel:
     ORDER = (1, 0, 2, 3)
 
-    def __init__(self, pin, n, bpp=3, timing=1):
+    # (high, low) times in ns for a 0 bit then a 1 bit, for each timing mode
+    _TIMING_NS = ((500, 2000, 1200, 1300), (400, 850, 800, 450))
+
+    def __init__(self, pin, n, bpp=3, timing=1, *, rmt=None, buf=None):
         self.pin = pin
         self.n = n
         self.bpp = bpp
-        self.buf = bytearray(n * bpp)
+        self.buf = bytearray(n * bpp) if buf is None else buf
         self.pin.init(pin.OUT)
         self.timing = timing
+        self.rmt = None
+        if rmt is not None:
+            # Drive the strip in the background from an RMT channel, with 25ns resolution.
+            import esp32
+
+            self.rmt = esp32.RMT(rmt, pin=pin, clock_div=2)
+            self._rmt_timing = tuple(t // 25 for t in self._TIMING_NS[timing])
 
     def __setitem__(self, index, val):
         offset = index * self.bpp
@@ -29,4 +39,17 @@ class NeoPixel:
             self[i] = color
 
     def write(self):
-        neopixel_write(self.pin, self.buf, self.timing)
+        if self.rmt is None:
+            neopixel_write(self.pin, self.buf, self.timing)
+        else:
+            self.rmt.write_bitstream(self.buf, self._rmt_timing)
+
+    def done(self):
+        return self.rmt is None or self.rmt.wait_done()
+
+    async def write_async(self):
+        import uasyncio
+
+        self.write()
+        while not self.done():
+            await uasyncio.sleep_ms(1)
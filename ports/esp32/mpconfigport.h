@@ -9,7 +9,10 @@
 #include "esp_system.h"
 
 // object representation and NLR handling
+// (a board can select MICROPY_OBJ_REPR_C to store floats without allocating them)
+#ifndef MICROPY_OBJ_REPR
 #define MICROPY_OBJ_REPR                    (MICROPY_OBJ_REPR_A)
+#endif
 #define MICROPY_NLR_SETJMP                  (1)
 
 // memory allocation policies
@@ -17,7 +20,13 @@
 
 // emitters
 #define MICROPY_PERSISTENT_CODE_LOAD        (1)
+#define MICROPY_PERSISTENT_CODE_SAVE        (1)
+#if CONFIG_IDF_TARGET_ARCH_RISCV
+#define MICROPY_EMIT_RV32                   (1)
+#define MICROPY_EMIT_INLINE_RV32            (1)
+#else
 #define MICROPY_EMIT_XTENSAWIN              (1)
+#endif
 
 // compiler configuration
 #define MICROPY_COMP_MODULE_CONST           (1)
@@ -26,17 +35,23 @@
 // optimisations
 #define MICROPY_OPT_COMPUTED_GOTO           (1)
 #define MICROPY_OPT_MPZ_BITWISE             (1)
+#define MICROPY_OPT_ARG_SLOT_CACHE          (1)
 
 // Python internal features
 #define MICROPY_READER_VFS                  (1)
 #define MICROPY_ENABLE_GC                   (1)
+#define MICROPY_GC_STATS                    (1)
+#define MICROPY_GC_POOL                     (1)
 #define MICROPY_ENABLE_FINALISER            (1)
 #define MICROPY_STACK_CHECK                 (1)
 #define MICROPY_ENABLE_EMERGENCY_EXCEPTION_BUF (1)
+#define MICROPY_PREALLOCATED_EXCEPTIONS     (1)
 #define MICROPY_KBD_EXCEPTION               (1)
+#define MICROPY_HAL_STDOUT_BUFFER_SIZE      (256)
 #define MICROPY_HELPER_REPL                 (1)
 #define MICROPY_REPL_EMACS_KEYS             (1)
 #define MICROPY_REPL_AUTO_INDENT            (1)
+#define MICROPY_REPL_FILE_TRANSFER          (1)
 #define MICROPY_LONGINT_IMPL                (MICROPY_LONGINT_IMPL_MPZ)
 #define MICROPY_ENABLE_SOURCE_LINE          (1)
 #define MICROPY_ERROR_REPORTING             (MICROPY_ERROR_REPORTING_NORMAL)
@@ -45,17 +60,26 @@
 #define MICROPY_CPYTHON_COMPAT              (1)
 #define MICROPY_STREAMS_NON_BLOCK           (1)
 #define MICROPY_STREAMS_POSIX_API           (1)
+#define MICROPY_STREAMS_READLINE_INTO       (1)
 #define MICROPY_MODULE_BUILTIN_INIT         (1)
 #define MICROPY_MODULE_WEAK_LINKS           (1)
 #define MICROPY_MODULE_FROZEN_STR           (0)
 #define MICROPY_MODULE_FROZEN_MPY           (1)
+#define MICROPY_MODULE_MPY_CACHE            (1)
 #define MICROPY_QSTR_EXTRA_POOL             mp_qstr_frozen_const_pool
+#define MICROPY_QSTR_HASH_INDEX             (1)
 #define MICROPY_CAN_OVERRIDE_BUILTINS       (1)
 #define MICROPY_USE_INTERNAL_ERRNO          (0) // errno.h from xtensa-esp32-elf/sys-include/sys
 #define MICROPY_USE_INTERNAL_PRINTF         (0) // ESP32 SDK requires its own printf
 #define MICROPY_ENABLE_SCHEDULER            (1)
 #define MICROPY_SCHEDULER_DEPTH             (8)
+#define MICROPY_SCHEDULER_EVENT_DEPTH       (32)
 #define MICROPY_VFS                         (1)
+#define MICROPY_VFS_BLOCKDEV_CACHE          (1)
+#define MICROPY_VFS_MMAP                    (1)
+#define MICROPY_VFS_BLOCKDEV_CACHE_BLOCKS   (8)
+#define MICROPY_VFS_FAT_READAHEAD_BLOCKS    (16)
+#define MICROPY_VFS_IMPORT_STAT_CACHE       (1)
 
 // control over Python builtins
 #define MICROPY_PY_FUNCTION_ATTRS           (1)
@@ -100,6 +124,8 @@
 #define MICROPY_PY_MATH                     (1)
 #define MICROPY_PY_MATH_SPECIAL_FUNCTIONS   (1)
 #define MICROPY_PY_MATH_ISCLOSE             (1)
+#define MICROPY_PY_MATH_FSUM                (1)
+#define MICROPY_PY_MATH_APPLY               (1)
 #define MICROPY_PY_CMATH                    (1)
 #define MICROPY_PY_GC                       (1)
 #define MICROPY_PY_IO                       (1)
@@ -108,6 +134,7 @@
 #define MICROPY_PY_IO_BYTESIO               (1)
 #define MICROPY_PY_IO_BUFFEREDWRITER        (1)
 #define MICROPY_PY_STRUCT                   (1)
+#define MICROPY_PY_STRUCT_OBJECT            (1)
 #define MICROPY_PY_SYS                      (1)
 #define MICROPY_PY_SYS_MAXSIZE              (1)
 #define MICROPY_PY_SYS_MODULES              (1)
@@ -120,6 +147,9 @@
 #define MICROPY_PY_THREAD                   (1)
 #define MICROPY_PY_THREAD_GIL               (1)
 #define MICROPY_PY_THREAD_GIL_VM_DIVISOR    (32)
+#define MICROPY_PY_THREAD_CREATE_EX         (1)
+#define MICROPY_PY_THREAD_CHANNEL           (1)
+#define MICROPY_PY_THREAD_QUEUE             (1)
 
 // extended modules
 #ifndef MICROPY_PY_BLUETOOTH
@@ -129,9 +159,15 @@
 #define MICROPY_BLUETOOTH_NIMBLE_BINDINGS_ONLY (1)
 #endif
 #define MICROPY_PY_UASYNCIO                 (1)
+#define MICROPY_PY_UASYNCIO_TIMER_WHEEL     (1)
 #define MICROPY_PY_UCTYPES                  (1)
+#define MICROPY_PY_UCTYPES_COMPILE          (1)
 #define MICROPY_PY_UZLIB                    (1)
+#define MICROPY_PY_UZLIB_COMPRESS           (1)
 #define MICROPY_PY_UJSON                    (1)
+#define MICROPY_PY_UJSON_OBJECT_HOOK        (1)
+#define MICROPY_PY_UJSON_ITERLOAD           (1)
+#define MICROPY_PY_UCBOR                    (1)
 #define MICROPY_PY_URE                      (1)
 #define MICROPY_PY_URE_SUB                  (1)
 #define MICROPY_PY_UHEAPQ                   (1)
@@ -142,14 +178,20 @@
 #define MICROPY_PY_UCRYPTOLIB               (1)
 #define MICROPY_PY_UBINASCII                (1)
 #define MICROPY_PY_UBINASCII_CRC32          (1)
+#define MICROPY_PY_UBINASCII_CRC32_HW       (1)
 #define MICROPY_PY_URANDOM                  (1)
 #define MICROPY_PY_URANDOM_EXTRA_FUNCS      (1)
+#define MICROPY_PY_URANDOM_XOSHIRO          (1)
 #define MICROPY_PY_URANDOM_SEED_INIT_FUNC   (esp_random())
 #define MICROPY_PY_OS_DUPTERM               (1)
+#define MICROPY_PY_OS_DUPTERM_RX_BUF_SIZE   (32)
 #define MICROPY_PY_MACHINE                  (1)
 #define MICROPY_PY_MACHINE_PIN_MAKE_NEW     mp_pin_make_new
 #define MICROPY_PY_MACHINE_PULSE            (1)
+#define MICROPY_PY_MACHINE_PINGROUP         (1)
 #define MICROPY_PY_MACHINE_I2C              (1)
+#define MICROPY_PY_MACHINE_I2C_TRANSFER_BATCH (1)
+#define MICROPY_PY_MACHINE_I2S              (1)
 #define MICROPY_PY_MACHINE_SPI              (1)
 #define MICROPY_PY_MACHINE_SPI_MSB          (0)
 #define MICROPY_PY_MACHINE_SPI_LSB          (1)
@@ -161,11 +203,17 @@
 #define MICROPY_PY_USSL                     (1)
 #define MICROPY_SSL_MBEDTLS                 (1)
 #define MICROPY_PY_USSL_FINALISER           (1)
+#define MICROPY_PY_USSL_SESSION             (1)
 #define MICROPY_PY_UWEBSOCKET               (1)
 #define MICROPY_PY_WEBREPL                  (1)
 #define MICROPY_PY_FRAMEBUF                 (1)
+#define MICROPY_PY_DISPLAY                  (1)
+#define MICROPY_PY_NRF24L01                 (1)
 #define MICROPY_PY_BTREE                    (1)
 #define MICROPY_PY_USOCKET_EVENTS           (MICROPY_PY_WEBREPL)
+#define MICROPY_PY_USOCKET_DNS_CACHE        (1)
+#define MICROPY_PY_USOCKET_BATCH            (1)
+#define MICROPY_PY_USOCKET_POOL             (1)
 #define MICROPY_PY_BLUETOOTH_RANDOM_ADDR    (1)
 #define MICROPY_PY_BLUETOOTH_DEFAULT_GAP_NAME ("ESP32")
 
@@ -197,6 +245,18 @@ extern const struct _mp_obj_module_t mp_module_machine;
 extern const struct _mp_obj_module_t mp_module_network;
 extern const struct _mp_obj_module_t mp_module_onewire;
 
+#ifndef MICROPY_PY_ESPNOW
+#define MICROPY_PY_ESPNOW (1)
+#endif
+#if MICROPY_PY_ESPNOW
+extern const struct _mp_obj_module_t mp_module_espnow;
+#define MICROPY_PORT_BUILTIN_MODULE_ESPNOW { MP_OBJ_NEW_QSTR(MP_QSTR_espnow), (mp_obj_t)&mp_module_espnow },
+#define MICROPY_PORT_ROOT_POINTER_ESPNOW struct _esp_espnow_obj_t *espnow_singleton;
+#else
+#define MICROPY_PORT_BUILTIN_MODULE_ESPNOW
+#define MICROPY_PORT_ROOT_POINTER_ESPNOW
+#endif
+
 #define MICROPY_PORT_BUILTIN_MODULES \
     { MP_OBJ_NEW_QSTR(MP_QSTR_esp), (mp_obj_t)&esp_module }, \
     { MP_OBJ_NEW_QSTR(MP_QSTR_esp32), (mp_obj_t)&esp32_module }, \
@@ -206,6 +266,7 @@ extern const struct _mp_obj_module_t mp_module_onewire;
     { MP_OBJ_NEW_QSTR(MP_QSTR_machine), (mp_obj_t)&mp_module_machine }, \
     { MP_OBJ_NEW_QSTR(MP_QSTR_network), (mp_obj_t)&mp_module_network }, \
     { MP_OBJ_NEW_QSTR(MP_QSTR__onewire), (mp_obj_t)&mp_module_onewire }, \
+    MICROPY_PORT_BUILTIN_MODULE_ESPNOW \
 
 #define MP_STATE_PORT MP_STATE_VM
 
@@ -221,7 +282,12 @@ struct mp_bluetooth_nimble_root_pointers_t;
 #define MICROPY_PORT_ROOT_POINTERS \
     const char *readline_hist[8]; \
     mp_obj_t machine_pin_irq_handler[40]; \
+    mp_obj_t machine_hw_spi_async_buf[2 * 2 * 2]; \
+    struct _esp32_rmt_obj_t *esp32_rmt_obj[8]; \
     struct _machine_timer_obj_t *machine_timer_obj_head; \
+    struct _machine_i2s_port_obj_t *machine_i2s_obj[2]; \
+    MICROPY_PORT_ROOT_POINTER_ESPNOW \
+    MICROPY_PORT_ROOT_POINTER_USOCKET_EVENTS \
     MICROPY_PORT_ROOT_POINTER_BLUETOOTH_NIMBLE
 
 // type definitions for the specific machine
@@ -240,8 +306,10 @@ void *esp_native_code_commit(void *, size_t, void *);
 
 #if MICROPY_PY_USOCKET_EVENTS
 #define MICROPY_PY_USOCKET_EVENTS_HANDLER extern void usocket_events_handler(void); usocket_events_handler();
+#define MICROPY_PORT_ROOT_POINTER_USOCKET_EVENTS struct _socket_obj_t *usocket_events_sock[CONFIG_LWIP_MAX_SOCKETS];
 #else
 #define MICROPY_PY_USOCKET_EVENTS_HANDLER
+#define MICROPY_PORT_ROOT_POINTER_USOCKET_EVENTS
 #endif
 
 #if MICROPY_PY_THREAD
@@ -250,6 +318,7 @@ void *esp_native_code_commit(void *, size_t, void *);
         extern void mp_handle_pending(bool); \
         mp_handle_pending(true); \
         MICROPY_PY_USOCKET_EVENTS_HANDLER \
+        MICROPY_HAL_STDOUT_BUFFER_POLL \
         MP_THREAD_GIL_EXIT(); \
         MP_THREAD_GIL_ENTER(); \
     } while (0);
@@ -259,6 +328,7 @@ void *esp_native_code_commit(void *, size_t, void *);
         extern void mp_handle_pending(bool); \
         mp_handle_pending(true); \
         MICROPY_PY_USOCKET_EVENTS_HANDLER \
+        MICROPY_HAL_STDOUT_BUFFER_POLL \
         asm ("waiti 0"); \
     } while (0);
 #endif
@@ -267,6 +337,29 @@ void *esp_native_code_commit(void *, size_t, void *);
 #define MICROPY_WRAP_MP_SCHED_EXCEPTION(f) IRAM_ATTR f
 #define MICROPY_WRAP_MP_SCHED_KEYBOARD_INTERRUPT(f) IRAM_ATTR f
 
+// The hot paths of the VM and the GC also go in IRAM, out of the way of flash
+// cache misses.  They take about 16k of IRAM, so a board that is short of it
+// can leave them in flash.
+#ifndef MICROPY_ESP32_HOT_TEXT_IRAM
+#define MICROPY_ESP32_HOT_TEXT_IRAM (1)
+#endif
+
+#if MICROPY_ESP32_HOT_TEXT_IRAM
+#define MICROPY_HOT_TEXT(f) IRAM_ATTR f
+#else
+#define MICROPY_HOT_TEXT(f) f
+#endif
+
+#define MICROPY_WRAP_MP_EXECUTE_BYTECODE(f) MICROPY_HOT_TEXT(f)
+#define MICROPY_WRAP_MP_BINARY_OP(f) MICROPY_HOT_TEXT(f)
+#define MICROPY_WRAP_MP_LOAD_GLOBAL(f) MICROPY_HOT_TEXT(f)
+#define MICROPY_WRAP_MP_LOAD_NAME(f) MICROPY_HOT_TEXT(f)
+#define MICROPY_WRAP_MP_MAP_LOOKUP(f) MICROPY_HOT_TEXT(f)
+#define MICROPY_WRAP_MP_OBJ_GET_TYPE(f) MICROPY_HOT_TEXT(f)
+#define MICROPY_WRAP_GC_ALLOC(f) MICROPY_HOT_TEXT(f)
+#define MICROPY_WRAP_GC_FREE(f) MICROPY_HOT_TEXT(f)
+#define MICROPY_WRAP_GC_MARK_SUBTREE(f) MICROPY_HOT_TEXT(f)
+
 #define UINT_FMT "%u"
 #define INT_FMT "%d"
 
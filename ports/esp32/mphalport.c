@@ -34,10 +34,13 @@
 #include "freertos/task.h"
 
 #if CONFIG_IDF_TARGET_ESP32
+#include "esp32/rom/crc.h"
 #include "esp32/rom/uart.h"
 #elif CONFIG_IDF_TARGET_ESP32S2
+#include "esp32s2/rom/crc.h"
 #include "esp32s2/rom/uart.h"
 #elif CONFIG_IDF_TARGET_ESP32S3
+#include "esp32s3/rom/crc.h"
 #include "esp32s3/rom/uart.h"
 #endif
 
@@ -49,6 +52,7 @@
 #include "extmod/misc.h"
 #include "lib/timeutils/timeutils.h"
 #include "lib/utils/pyexec.h"
+#include "lib/utils/stdout_buffer.h"
 #include "mphalport.h"
 #include "usb.h"
 
@@ -98,6 +102,7 @@ uintptr_t mp_hal_stdio_poll(uintptr_t poll_flags) {
 }
 
 int mp_hal_stdin_rx_chr(void) {
+    mp_hal_stdout_buffer_flush();
     for (;;) {
         int c = ringbuf_get(&stdin_ringbuf);
         if (c != -1) {
@@ -112,7 +117,15 @@ void mp_hal_stdout_tx_str(const char *str) {
     mp_hal_stdout_tx_strn(str, strlen(str));
 }
 
+#if MICROPY_HAL_STDOUT_BUFFER_SIZE
 void mp_hal_stdout_tx_strn(const char *str, uint32_t len) {
+    mp_hal_stdout_buffer_write(str, len);
+}
+
+void mp_hal_stdout_tx_strn_direct(const char *str, size_t len) {
+#else
+void mp_hal_stdout_tx_strn(const char *str, uint32_t len) {
+#endif
     // Only release the GIL if many characters are being sent
     bool release_gil = len > 20;
     if (release_gil) {
@@ -220,3 +233,11 @@ void mp_hal_wake_main_task_from_isr(void) {
         portYIELD_FROM_ISR();
     }
 }
+
+#if MICROPY_PY_UBINASCII_CRC32_HW
+// The ROM has a table-driven CRC-32 which, like zlib's crc32(), inverts the
+// crc on entry and exit
+uint32_t mp_hal_crc32(uint32_t crc, const void *buf, size_t len) {
+    return crc32_le(crc, buf, len);
+}
+#endif
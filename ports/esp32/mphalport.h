@@ -39,7 +39,11 @@
 // Until we move to IDF 4.2+, we need NimBLE on core 0, and for synchronisation
 // with the ringbuffer and scheduler MP needs to be on the same core.
 // See https://github.com/micropython/micropython/issues/5489
+// A board without BLE may define this as 1 to keep MicroPython off the core
+// that runs the WiFi driver and lwIP.
+#ifndef MP_TASK_COREID
 #define MP_TASK_COREID (0)
+#endif
 
 extern TaskHandle_t mp_main_task_handle;
 
@@ -99,5 +103,10 @@ static inline int mp_hal_pin_read(mp_hal_pin_obj_t pin) {
 static inline void mp_hal_pin_write(mp_hal_pin_obj_t pin, int v) {
     gpio_set_level(pin, v);
 }
+// GPIO0-31 are in port 0 and GPIO32-39 in port 1.
+#define mp_hal_pin_port(p) ((uintptr_t)((p) >= 32))
+#define mp_hal_pin_port_mask(p) (1u << ((p) & 31))
+void mp_hal_pin_port_write(uintptr_t port, uint32_t set_mask, uint32_t clr_mask);
+uint32_t mp_hal_pin_port_read(uintptr_t port);
 
 #endif // INCLUDED_MPHALPORT_H
@@ -115,7 +115,18 @@ STATIC void freertos_entry(void *arg) {
     }
 }
 
-void mp_thread_create_ex(void *(*entry)(void *), void *arg, size_t *stack_size, int priority, char *name) {
+void mp_thread_create_ex(void *(*entry)(void *), void *arg, size_t *stack_size, int priority, int core) {
+    if (priority < 0) {
+        priority = MP_THREAD_PRIORITY;
+    } else if (priority >= configMAX_PRIORITIES) {
+        mp_raise_ValueError(MP_ERROR_TEXT("invalid priority"));
+    }
+    if (core < 0) {
+        core = MP_TASK_COREID;
+    } else if (core >= portNUM_PROCESSORS) {
+        mp_raise_ValueError(MP_ERROR_TEXT("invalid core"));
+    }
+
     // store thread entry function into a global variable so we can access it
     ext_thread_entry = entry;
 
@@ -131,7 +142,7 @@ void mp_thread_create_ex(void *(*entry)(void *), void *arg, size_t *stack_size,
     mp_thread_mutex_lock(&thread_mutex, 1);
 
     // create thread
-    BaseType_t result = xTaskCreatePinnedToCore(freertos_entry, name, *stack_size / sizeof(StackType_t), arg, priority, &th->id, MP_TASK_COREID);
+    BaseType_t result = xTaskCreatePinnedToCore(freertos_entry, "mp_thread", *stack_size / sizeof(StackType_t), arg, priority, &th->id, core);
     if (result != pdPASS) {
         mp_thread_mutex_unlock(&thread_mutex);
         mp_raise_msg(&mp_type_OSError, MP_ERROR_TEXT("can't create thread"));
@@ -152,7 +163,7 @@ void mp_thread_create_ex(void *(*entry)(void *), void *arg, size_t *stack_size,
 }
 
 void mp_thread_create(void *(*entry)(void *), void *arg, size_t *stack_size) {
-    mp_thread_create_ex(entry, arg, stack_size, MP_THREAD_PRIORITY, "mp_thread");
+    mp_thread_create_ex(entry, arg, stack_size, -1, -1);
 }
 
 void mp_thread_finish(void) {
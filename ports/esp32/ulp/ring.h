@@ -0,0 +1,37 @@
+/* The ULP side of the ring buffer read by ULP.ring_read().
+
+   The ring is four header words, head, tail, size and dropped, then size
+   sample slots of one word each.  Reserve it in .bss and set it up from the
+   main CPU with ULP.ring_init() after loading the program.  Offsets below are
+   in bytes, and registers hold word addresses. */
+
+#define RING_HEADER_WORDS 4
+
+/* Append the low 16 bits of r0 to the ring at label \ring, or count a
+   dropped sample if it is full.  Clobbers r1, r2 and r3. */
+    .macro ring_push ring
+    move r3, \ring
+    ld r1, r3, 0            /* r1 = head */
+    add r2, r1, 1           /* r2 = next head, wrapped below */
+    ld r3, r3, 8
+    sub r3, r2, r3          /* overflows if next head < size */
+    jump 1f, ov
+    move r2, 0
+1:
+    move r3, \ring
+    ld r3, r3, 4
+    sub r3, r3, r2          /* full if next head == tail */
+    jump 2f, eq
+    move r3, \ring
+    add r3, r3, r1
+    st r0, r3, 16           /* store the sample after the header */
+    move r3, \ring
+    st r2, r3, 0            /* then publish it by moving head */
+    jump 3f
+2:
+    move r3, \ring
+    ld r1, r3, 12
+    add r1, r1, 1
+    st r1, r3, 12
+3:
+    .endm
@@ -19,3 +19,5 @@
 #define MICROPY_PY_URE_SUB              (1)
 #define MICROPY_PY_UCRYPTOLIB           (1)
 #define MICROPY_PY_FRAMEBUF             (1)
+#define MICROPY_PY_DISPLAY              (1)
+#define MICROPY_PY_MACHINE_SDCARD_SPI   (1)
@@ -113,6 +113,12 @@ bool ets_post(uint8 prio, os_signal_t sig, os_param_t param) {
 int ets_loop_iter_disable = 0;
 int ets_loop_dont_feed_sw_wdt = 0;
 
+// Minimum time between runs of the event loop from the VM hook, in us
+uint32_t ets_loop_iter_interval_us = ETS_LOOP_ITER_INTERVAL_US_DEFAULT;
+static uint32_t ets_loop_iter_last;
+
+ets_loop_stats_t ets_loop_stats;
+
 // to implement a 64-bit wide microsecond counter
 uint32_t system_time_low_word = 0;
 uint32_t system_time_high_word = 0;
@@ -135,6 +141,9 @@ bool ets_loop_iter(void) {
 
     // Update 64-bit microsecond counter
     system_time_update();
+    uint32_t t_start = system_time_low_word;
+    ets_loop_iter_last = t_start;
+    ++ets_loop_stats.runs;
 
     // 6 words before pend_flag_noise_check is a variable that is used by
     // the software WDT.  A 1.6 second period timer will increment this
@@ -150,8 +159,11 @@ bool ets_loop_iter(void) {
         }
         ets_intr_lock();
         // printf("etc_loop_iter: "); dump_task(t - emu_tasks + FIRST_PRIO, t);
-        if (t->i_get != t->i_put) {
+        // Take the events that are queued for the task in one go, but no more
+        // than the queue holds, so a task that posts to itself can't hold the loop
+        for (int n = t->qlen; n > 0 && t->i_get != t->i_put; --n) {
             progress = true;
+            ++ets_loop_stats.events;
             // printf("#%d Calling task %d(%p) (%x, %x)\n", cnt++,
             //    t - emu_tasks + FIRST_PRIO, t->task, t->queue[t->i_get].sig, t->queue[t->i_get].par);
             int idx = t->i_get;
@@ -178,9 +190,22 @@ bool ets_loop_iter(void) {
         idle_cb(idle_arg);
     }
 
+    ets_loop_stats.time_us += system_get_time() - t_start;
+
     return progress;
 }
 
+// Run the event loop, unless it ran less than ets_loop_iter_interval_us ago.
+// This is for hot paths like the VM hook, which would otherwise spend much of
+// their time checking for events.
+bool ets_loop_iter_throttled(void) {
+    if (system_get_time() - ets_loop_iter_last < ets_loop_iter_interval_us) {
+        ++ets_loop_stats.skipped;
+        return false;
+    }
+    return ets_loop_iter();
+}
+
 #if SDK_BELOW_1_1_1
 void my_timer_isr(void *arg) {
 //    uart0_write_char('+');
@@ -1,12 +1,26 @@
 #ifndef MICROPY_INCLUDED_ESP8266_ETS_ALT_TASK_H
 #define MICROPY_INCLUDED_ESP8266_ETS_ALT_TASK_H
 
+// Default minimum time between runs of the event loop from the VM hook, in us
+#define ETS_LOOP_ITER_INTERVAL_US_DEFAULT (1000)
+
+// Counts of the event loop, see esp.loop_stats()
+typedef struct _ets_loop_stats_t {
+    uint32_t runs; // runs of the event loop
+    uint32_t skipped; // calls skipped because the loop ran recently
+    uint32_t events; // events passed to SDK tasks
+    uint32_t time_us; // time spent in the event loop, including the tasks
+} ets_loop_stats_t;
+
 extern int ets_loop_iter_disable;
 extern int ets_loop_dont_feed_sw_wdt;
+extern uint32_t ets_loop_iter_interval_us;
+extern ets_loop_stats_t ets_loop_stats;
 extern uint32_t system_time_low_word;
 extern uint32_t system_time_high_word;
 
 void system_time_update(void);
 bool ets_loop_iter(void);
+bool ets_loop_iter_throttled(void);
 
 #endif // MICROPY_INCLUDED_ESP8266_ETS_ALT_TASK_H
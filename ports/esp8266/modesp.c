@@ -25,6 +25,7 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 
 #include "py/gc.h"
 #include "py/runtime.h"
@@ -78,6 +79,36 @@ STATIC mp_obj_t esp_deepsleep(size_t n_args, const mp_obj_t *args) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(esp_deepsleep_obj, 0, 2, esp_deepsleep);
 
+STATIC mp_obj_t esp_loop_interval(size_t n_args, const mp_obj_t *args) {
+    if (n_args == 0) {
+        return mp_obj_new_int_from_uint(ets_loop_iter_interval_us);
+    } else {
+        mp_int_t us = mp_obj_get_int(args[0]);
+        // The SDK needs to run well within the 1.6s period of the SW WDT
+        if (us < 0 || us > 100000) {
+            mp_raise_ValueError(NULL);
+        }
+        ets_loop_iter_interval_us = us;
+        return mp_const_none;
+    }
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(esp_loop_interval_obj, 0, 1, esp_loop_interval);
+
+STATIC mp_obj_t esp_loop_stats(size_t n_args, const mp_obj_t *args) {
+    ets_loop_stats_t stats = ets_loop_stats;
+    if (n_args > 0 && mp_obj_is_true(args[0])) {
+        memset(&ets_loop_stats, 0, sizeof(ets_loop_stats));
+    }
+    mp_obj_t items[4] = {
+        mp_obj_new_int_from_uint(stats.runs),
+        mp_obj_new_int_from_uint(stats.skipped),
+        mp_obj_new_int_from_uint(stats.events),
+        mp_obj_new_int_from_uint(stats.time_us),
+    };
+    return mp_obj_new_tuple(4, items);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(esp_loop_stats_obj, 0, 1, esp_loop_stats);
+
 STATIC mp_obj_t esp_flash_id() {
     return mp_obj_new_int(spi_flash_get_id());
 }
@@ -357,6 +388,8 @@ STATIC const mp_rom_map_elem_t esp_module_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_osdebug), MP_ROM_PTR(&esp_osdebug_obj) },
     { MP_ROM_QSTR(MP_QSTR_sleep_type), MP_ROM_PTR(&esp_sleep_type_obj) },
     { MP_ROM_QSTR(MP_QSTR_deepsleep), MP_ROM_PTR(&esp_deepsleep_obj) },
+    { MP_ROM_QSTR(MP_QSTR_loop_interval), MP_ROM_PTR(&esp_loop_interval_obj) },
+    { MP_ROM_QSTR(MP_QSTR_loop_stats), MP_ROM_PTR(&esp_loop_stats_obj) },
     { MP_ROM_QSTR(MP_QSTR_flash_id), MP_ROM_PTR(&esp_flash_id_obj) },
     { MP_ROM_QSTR(MP_QSTR_flash_read), MP_ROM_PTR(&esp_flash_read_obj) },
     { MP_ROM_QSTR(MP_QSTR_flash_write), MP_ROM_PTR(&esp_flash_write_obj) },
@@ -28,4 +28,5 @@
 
 extern void mp_js_write(const char *str, mp_uint_t len);
 extern int mp_js_ticks_ms(void);
+extern int mp_js_ticks_us(void);
 extern void mp_js_hook(void);
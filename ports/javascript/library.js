@@ -45,6 +45,13 @@ mergeInto(LibraryManager.library, {
         return (new Date()).getTime() - MP_JS_EPOCH;
     },
 
+    mp_js_ticks_us: function() {
+        if (typeof performance === 'undefined') {
+            return (((new Date()).getTime() - MP_JS_EPOCH) * 1000) | 0;
+        }
+        return (performance.now() * 1000) | 0;
+    },
+
     mp_js_hook: function() {
         if (typeof window === 'undefined') {
             var mp_interrupt_char = Module.ccall('mp_hal_get_interrupt_char', 'number', ['number'], ['null']);
@@ -34,10 +34,36 @@
 #include "py/repl.h"
 #include "py/gc.h"
 #include "py/mperrno.h"
+#include "py/mphal.h"
 #include "lib/utils/pyexec.h"
 
 #include "library.h"
 
+#if MICROPY_PY_UASYNCIO
+// A uasyncio loop run by mp_js_do_str_async or mp_js_asyncio_step returns to
+// JS whenever it would wait, rather than blocking the browser's UI thread.
+// Its idle handler raises GeneratorExit to unwind it, and mp_js_asyncio_step
+// continues it later from the task queue, which holds all of its state.
+static bool asyncio_active;
+static bool asyncio_suspended;
+static int asyncio_wait_ms;
+
+STATIC mp_obj_t asyncio_idle(mp_obj_t dt_in) {
+    mp_int_t dt = mp_obj_get_int(dt_in);
+    if (!asyncio_active) {
+        // a loop run by mp_js_do_str blocks as it would without the handler
+        if (dt > 0) {
+            mp_hal_delay_ms(dt);
+        }
+        return mp_const_none;
+    }
+    asyncio_suspended = true;
+    asyncio_wait_ms = dt;
+    mp_raise_type(&mp_type_GeneratorExit);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(asyncio_idle_obj, asyncio_idle);
+#endif
+
 #if MICROPY_ENABLE_COMPILER
 int do_str(const char *src, mp_parse_input_kind_t input_kind) {
     int ret = 0;
@@ -61,6 +87,10 @@ int do_str(const char *src, mp_parse_input_kind_t input_kind) {
                     ret = 1;
                 }
             }
+        #if MICROPY_PY_UASYNCIO
+        } else if (asyncio_suspended && mp_obj_is_subclass_fast(mp_obj_get_type((mp_obj_t)nlr.ret_val), &mp_type_GeneratorExit)) {
+            // the uasyncio loop is continued by mp_js_asyncio_step
+        #endif
         } else {
             mp_obj_print_exception(&mp_plat_print, (mp_obj_t)nlr.ret_val);
             ret = 1;
@@ -71,20 +101,125 @@ int do_str(const char *src, mp_parse_input_kind_t input_kind) {
 #endif
 
 static char *stack_top;
+static size_t heap_size;
 
 int mp_js_do_str(const char *code) {
     return do_str(code, MP_PARSE_FILE_INPUT);
 }
 
+#if MICROPY_PY_UASYNCIO
+// Run code like mp_js_do_str, with uasyncio's loop returning to JS when it
+// would wait.  JS then calls mp_js_asyncio_step to continue the loop.
+int mp_js_do_str_async(const char *code) {
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        // uasyncio.Loop.set_idle_handler(asyncio_idle, 0, True)
+        mp_obj_t uasyncio = mp_import_name(MP_QSTR_uasyncio, mp_const_none, MP_OBJ_NEW_SMALL_INT(0));
+        mp_obj_t loop = mp_load_attr(uasyncio, MP_QSTR_Loop);
+        mp_obj_t args[3] = { MP_OBJ_FROM_PTR(&asyncio_idle_obj), MP_OBJ_NEW_SMALL_INT(0), mp_const_true };
+        mp_call_function_n_kw(mp_load_attr(loop, MP_QSTR_set_idle_handler), 3, 0, args);
+        nlr_pop();
+    } else {
+        mp_obj_print_exception(&mp_plat_print, (mp_obj_t)nlr.ret_val);
+        return 1;
+    }
+    asyncio_active = true;
+    asyncio_suspended = false;
+    int ret = do_str(code, MP_PARSE_FILE_INPUT);
+    asyncio_active = false;
+    return ret;
+}
+
+// Run the uasyncio tasks that are due, and return the time in ms until the
+// next one is, or -1 if there are no tasks left that a timer can wake.
+int mp_js_asyncio_step(void) {
+    int wait_ms = -1;
+    asyncio_active = true;
+    asyncio_suspended = false;
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        mp_obj_t uasyncio = mp_import_name(MP_QSTR__uasyncio, mp_const_none, MP_OBJ_NEW_SMALL_INT(0));
+        mp_call_function_0(mp_load_attr(uasyncio, MP_QSTR_run_until_complete));
+        nlr_pop();
+    } else if (asyncio_suspended) {
+        wait_ms = asyncio_wait_ms;
+    } else {
+        mp_obj_print_exception(&mp_plat_print, (mp_obj_t)nlr.ret_val);
+    }
+    asyncio_active = false;
+    return wait_ms;
+}
+#endif
+
+#if MICROPY_GC_INCREMENTAL
+// Do a step of an incremental collection, of at most budget_us, from the JS
+// event loop when it's idle.  A new collection is started once an eighth of
+// the heap was allocated since the last one.  No Python code is running then,
+// so the C stack is only this call and nothing is missed in wasm locals, which
+// gc_collect can't scan.  Returns 1 if there's nothing more to do.
+int mp_js_gc_step(int budget_us) {
+    if (!gc_collect_in_progress()
+        && MP_STATE_MEM(gc_alloc_amount) * MICROPY_BYTES_PER_GC_BLOCK < heap_size / 8) {
+        return 1;
+    }
+    return gc_collect_step(budget_us);
+}
+#endif
+
+// The length of the last buffer returned to JS, see mp_js_get_buffer_len.
+static size_t buffer_len;
+
+static void *buffer_info(mp_obj_t obj) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(obj, &bufinfo, MP_BUFFER_READ);
+    buffer_len = bufinfo.len;
+    return bufinfo.buf;
+}
+
+// Return the address of the buffer of the object bound to name in __main__, so
+// JS can view its data in place without copying it.
+void *mp_js_get_buffer(const char *name) {
+    void *buf = NULL;
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        buf = buffer_info(mp_load_global(qstr_from_str(name)));
+        nlr_pop();
+    } else {
+        mp_obj_print_exception(&mp_plat_print, (mp_obj_t)nlr.ret_val);
+    }
+    return buf;
+}
+
+// Bind a new zeroed bytearray of len bytes to name in __main__, for JS to fill
+// in place, and return the address of its data.
+void *mp_js_new_buffer(const char *name, size_t len) {
+    void *buf = NULL;
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        mp_obj_t obj = mp_call_function_1(MP_OBJ_FROM_PTR(&mp_type_bytearray), mp_obj_new_int_from_uint(len));
+        mp_store_global(qstr_from_str(name), obj);
+        buf = buffer_info(obj);
+        nlr_pop();
+    } else {
+        mp_obj_print_exception(&mp_plat_print, (mp_obj_t)nlr.ret_val);
+    }
+    return buf;
+}
+
+size_t mp_js_get_buffer_len(void) {
+    return buffer_len;
+}
+
 int mp_js_process_char(int c) {
     return pyexec_event_repl_process_char(c);
 }
 
-void mp_js_init(int heap_size) {
+void mp_js_init(int size) {
     int stack_dummy;
     stack_top = (char *)&stack_dummy;
 
     #if MICROPY_ENABLE_GC
+    heap_size = size;
     char *heap = (char *)malloc(heap_size * sizeof(char));
     gc_init(heap, heap + heap_size);
     #endif
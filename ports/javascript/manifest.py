@@ -0,0 +1 @@
+include("$(MPY_DIR)/extmod/uasyncio/manifest.py")
@@ -48,6 +48,7 @@
 #define MICROPY_ENABLE_GC           (1)
 #define MICROPY_GC_ALLOC_THRESHOLD  (1)
 #define MICROPY_GC_USES_ALLOCATED_SIZE (1)
+#define MICROPY_GC_INCREMENTAL      (1)
 #define MICROPY_REPL_EVENT_DRIVEN   (1)
 #define MICROPY_HELPER_REPL         (1)
 #define MICROPY_HELPER_LEXER_UNIX   (0)
@@ -116,6 +117,7 @@
 #define MICROPY_PY_URANDOM          (1)
 #define MICROPY_PY_URANDOM_EXTRA_FUNCS (1)
 #define MICROPY_PY_USELECT          (1)
+#define MICROPY_PY_UASYNCIO         (1)
 #define MICROPY_PY_FRAMEBUF         (1)
 #define MICROPY_STREAMS_NON_BLOCK   (1)
 #define MICROPY_MODULE_WEAK_LINKS   (1)
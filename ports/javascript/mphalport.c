@@ -44,7 +44,7 @@ void mp_hal_delay_us(mp_uint_t us) {
 }
 
 mp_uint_t mp_hal_ticks_us(void) {
-    return mp_js_ticks_ms() * 1000;
+    return mp_js_ticks_us();
 }
 
 mp_uint_t mp_hal_ticks_ms(void) {
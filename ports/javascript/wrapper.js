@@ -28,11 +28,64 @@ var Module = {};
 
 var mainProgram = function()
 {
-  mp_js_init = Module.cwrap('mp_js_init', 'null', ['number']);
+  var init = Module.cwrap('mp_js_init', 'null', ['number']);
   mp_js_do_str = Module.cwrap('mp_js_do_str', 'number', ['string']);
   mp_js_init_repl = Module.cwrap('mp_js_init_repl', 'null', ['null']);
   mp_js_process_char = Module.cwrap('mp_js_process_char', 'number', ['number']);
 
+  var do_str_async = Module.cwrap('mp_js_do_str_async', 'number', ['string']);
+  var asyncio_step = Module.cwrap('mp_js_asyncio_step', 'number', ['null']);
+  var gc_step = Module.cwrap('mp_js_gc_step', 'number', ['number']);
+  var get_buffer = Module.cwrap('mp_js_get_buffer', 'number', ['string']);
+  var new_buffer = Module.cwrap('mp_js_new_buffer', 'number', ['string', 'number']);
+  var get_buffer_len = Module.cwrap('mp_js_get_buffer_len', 'number', ['null']);
+
+  // In the browser, steps of garbage collection are done while it's idle.
+  var gc_idle = function(deadline) {
+      var budget_us = Math.floor(deadline.timeRemaining() * 1000);
+      if (budget_us > 0) {
+          gc_step(budget_us);
+      }
+      requestIdleCallback(gc_idle);
+  };
+
+  mp_js_init = function(heap_size) {
+      init(heap_size);
+      if (typeof requestIdleCallback !== 'undefined') {
+          requestIdleCallback(gc_idle);
+      }
+  };
+
+  // Run code, with the uasyncio loop driven by timers of the JS event loop
+  // rather than blocking.  The promise resolves to the exit code of the code
+  // once there are no tasks left.
+  mp_js_do_str_async = function(code) {
+      var ret = do_str_async(code);
+      return new Promise(function(resolve) {
+          var step = function() {
+              var wait_ms = asyncio_step();
+              if (wait_ms < 0) {
+                  resolve(ret);
+              } else {
+                  setTimeout(step, wait_ms);
+              }
+          };
+          setTimeout(step, 0);
+      });
+  };
+
+  // Views of the data of Python objects in the heap, without copying.  They
+  // are valid while the object stays bound to the name in __main__.
+  mp_js_get_buffer = function(name) {
+      var ptr = get_buffer(name);
+      return ptr === 0 ? null : new Uint8Array(HEAPU8.buffer, ptr, get_buffer_len());
+  };
+
+  mp_js_new_buffer = function(name, len) {
+      var ptr = new_buffer(name, len);
+      return ptr === 0 ? null : new Uint8Array(HEAPU8.buffer, ptr, len);
+  };
+
   MP_JS_EPOCH = (new Date()).getTime();
 
   if (typeof window === 'undefined' && require.main === module) {
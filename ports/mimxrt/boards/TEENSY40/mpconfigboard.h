@@ -7,3 +7,6 @@
 #define MICROPY_HW_LED1_PIN (pin_GPIO_B0_03)
 #define MICROPY_HW_LED_ON(pin) (mp_hal_pin_high(pin))
 #define MICROPY_HW_LED_OFF(pin) (mp_hal_pin_low(pin))
+
+// Small objects of the GC heap go in DTCM
+#define MICROPY_HW_GC_HEAP_DTCM_SIZE (64 * 1024)
@@ -38,6 +38,11 @@
 
 extern uint8_t _sstack, _estack, _gc_heap_start, _gc_heap_end;
 
+#if MICROPY_HW_GC_HEAP_DTCM_SIZE
+// This goes in DTCM with the rest of .bss.
+STATIC uint32_t gc_heap_dtcm[MICROPY_HW_GC_HEAP_DTCM_SIZE / sizeof(uint32_t)];
+#endif
+
 void board_init(void);
 
 int main(void) {
@@ -50,7 +55,12 @@ int main(void) {
     mp_stack_set_limit(&_estack - &_sstack - 1024);
 
     for (;;) {
+        #if MICROPY_HW_GC_HEAP_DTCM_SIZE
+        gc_init(gc_heap_dtcm, (uint8_t *)gc_heap_dtcm + sizeof(gc_heap_dtcm));
+        gc_add_region(&_gc_heap_start, &_gc_heap_end, GC_REGION_FLAG_LARGE);
+        #else
         gc_init(&_gc_heap_start, &_gc_heap_end);
+        #endif
         mp_init();
 
         mp_obj_list_init(MP_OBJ_TO_PTR(mp_sys_path), 0);
@@ -32,6 +32,14 @@
 // Memory allocation policies
 #define MICROPY_GC_STACK_ENTRY_TYPE         uint16_t
 #define MICROPY_GC_ALLOC_THRESHOLD          (0)
+
+// Size of the part of the GC heap in DTCM, which takes the small allocations,
+// while the rest of the heap in OCRAM takes the large ones.  0 keeps the whole
+// heap in OCRAM.
+#ifndef MICROPY_HW_GC_HEAP_DTCM_SIZE
+#define MICROPY_HW_GC_HEAP_DTCM_SIZE        (0)
+#endif
+#define MICROPY_GC_SPLIT_HEAP               (MICROPY_HW_GC_HEAP_DTCM_SIZE > 0)
 #define MICROPY_ALLOC_PARSE_CHUNK_INIT      (32)
 #define MICROPY_ALLOC_PATH_MAX              (256)
 #define MICROPY_QSTR_BYTES_IN_HASH          (1)
@@ -97,6 +105,29 @@ extern const struct _mp_obj_module_t mp_module_utime;
 
 #define MICROPY_MAKE_POINTER_CALLABLE(p) ((void *)((mp_uint_t)(p) | 1))
 
+// Run the hot paths of the VM and the GC from ITCM rather than from the
+// flash, which is behind a small cache.  The SDK linker script puts the
+// CodeQuickAccess section in ITCM and the startup code copies it there.
+#ifndef MICROPY_HW_HOT_TEXT_ITCM
+#define MICROPY_HW_HOT_TEXT_ITCM (1)
+#endif
+
+#if MICROPY_HW_HOT_TEXT_ITCM
+#define MICROPY_HOT_TEXT(f) __attribute__((section("CodeQuickAccess"), noinline)) f
+#else
+#define MICROPY_HOT_TEXT(f) f
+#endif
+
+#define MICROPY_WRAP_MP_EXECUTE_BYTECODE(f) MICROPY_HOT_TEXT(f)
+#define MICROPY_WRAP_MP_BINARY_OP(f) MICROPY_HOT_TEXT(f)
+#define MICROPY_WRAP_MP_LOAD_GLOBAL(f) MICROPY_HOT_TEXT(f)
+#define MICROPY_WRAP_MP_LOAD_NAME(f) MICROPY_HOT_TEXT(f)
+#define MICROPY_WRAP_MP_MAP_LOOKUP(f) MICROPY_HOT_TEXT(f)
+#define MICROPY_WRAP_MP_OBJ_GET_TYPE(f) MICROPY_HOT_TEXT(f)
+#define MICROPY_WRAP_GC_ALLOC(f) MICROPY_HOT_TEXT(f)
+#define MICROPY_WRAP_GC_FREE(f) MICROPY_HOT_TEXT(f)
+#define MICROPY_WRAP_GC_MARK_SUBTREE(f) MICROPY_HOT_TEXT(f)
+
 #define MP_SSIZE_MAX (0x7fffffff)
 typedef int mp_int_t; // must be pointer size
 typedef unsigned mp_uint_t; // must be pointer size
@@ -37,6 +37,9 @@
 #include "ble.h" // sd_ble_uuid_encode
 #include "drivers/flash.h"
 #include "mphalport.h"
+#include "nrf_soc.h" // sd_radio_notification_cfg_set
+#include "modules/machine/spi.h"
+#include "modules/machine/uart.h"
 
 
 #if MICROPY_HW_USB_CDC
@@ -55,6 +58,18 @@
 #define BLE_ADV_AD_TYPE_FIELD_SIZE  1
 #define BLE_AD_TYPE_FLAGS_DATA_SIZE 1
 
+// The SoftDevice raises the radio notification on this software interrupt,
+// both some time before the radio turns on and when it turns off again.
+#ifdef NRF51
+#define RADIO_NOTIFICATION_IRQn       SWI1_IRQn
+#define RADIO_NOTIFICATION_IRQHandler SWI1_IRQHandler
+#define RADIO_NOTIFICATION_IRQ_PRIO   3
+#else
+#define RADIO_NOTIFICATION_IRQn       SWI1_EGU1_IRQn
+#define RADIO_NOTIFICATION_IRQHandler SWI1_EGU1_IRQHandler
+#define RADIO_NOTIFICATION_IRQ_PRIO   6
+#endif
+
 #define MSEC_TO_UNITS(TIME, RESOLUTION) (((TIME) * 1000) / (RESOLUTION))
 #define UNIT_0_625_MS (625)
 #define UNIT_10_MS    (10000)
@@ -81,6 +96,7 @@ if (ble_drv_stack_enabled() == 0) { \
 }
 
 static volatile bool m_adv_in_progress;
+static volatile bool m_radio_active;
 static volatile uint8_t m_tx_in_progress;
 
 static ble_drv_gap_evt_callback_t          gap_event_handler;
@@ -131,6 +147,7 @@ void softdevice_assert_handler(uint32_t id, uint32_t pc, uint32_t info) {
 uint32_t ble_drv_stack_enable(void) {
     m_adv_in_progress = false;
     m_tx_in_progress  = 0;
+    m_radio_active    = false;
 
 #if (BLUETOOTH_SD == 110)
   #if BLUETOOTH_LFCLK_RC
@@ -169,6 +186,18 @@ uint32_t ble_drv_stack_enable(void) {
 
     BLE_DRIVER_LOG("IRQ enable status: " UINT_FMT "\n", (uint16_t)err_code);
 
+    // Track when the radio is in use, so that bulk transfers can keep out
+    // of the connection events.
+    err_code = sd_radio_notification_cfg_set(NRF_RADIO_NOTIFICATION_TYPE_INT_ON_BOTH,
+                                             NRF_RADIO_NOTIFICATION_DISTANCE_800US);
+    if (err_code == NRF_SUCCESS) {
+        sd_nvic_ClearPendingIRQ(RADIO_NOTIFICATION_IRQn);
+        sd_nvic_SetPriority(RADIO_NOTIFICATION_IRQn, RADIO_NOTIFICATION_IRQ_PRIO);
+        err_code = sd_nvic_EnableIRQ(RADIO_NOTIFICATION_IRQn);
+    }
+
+    BLE_DRIVER_LOG("Radio notification status: " UINT_FMT "\n", (uint16_t)err_code);
+
 #if (BLUETOOTH_SD == 110)
     ble_enable_params_t ble_enable_params;
     memset(&ble_enable_params, 0x00, sizeof(ble_enable_params));
@@ -242,6 +271,11 @@ uint32_t ble_drv_stack_enable(void) {
 
 void ble_drv_stack_disable(void) {
     sd_softdevice_disable();
+    m_radio_active = false;
+}
+
+bool ble_drv_radio_active(void) {
+    return m_radio_active;
 }
 
 uint8_t ble_drv_stack_enabled(void) {
@@ -1144,6 +1178,20 @@ static void ble_evt_handler(ble_evt_t * p_ble_evt) {
     }
 }
 
+void RADIO_NOTIFICATION_IRQHandler(void) {
+    // The notification comes in pairs, before the radio turns on and after
+    // it turns off again.
+    m_radio_active = !m_radio_active;
+    if (!m_radio_active) {
+#if MICROPY_PY_MACHINE_HW_SPI
+        spi_radio_idle();
+#endif
+#if MICROPY_PY_MACHINE_UART
+        uart_radio_idle();
+#endif
+    }
+}
+
 static uint8_t m_ble_evt_buf[sizeof(ble_evt_t) + (GATT_MTU_SIZE_DEFAULT)] __attribute__ ((aligned (4)));
 
 #ifdef NRF51
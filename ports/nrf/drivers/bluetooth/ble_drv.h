@@ -78,6 +78,10 @@ void ble_drv_stack_disable(void);
 
 uint8_t ble_drv_stack_enabled(void);
 
+// True between the radio notifications around each radio event, from a
+// little before the radio turns on until it turns off.
+bool ble_drv_radio_active(void);
+
 void ble_drv_address_get(ble_drv_addr_t * p_addr);
 
 bool ble_drv_uuid_add_vs(uint8_t * p_uuid, uint8_t * idx);
@@ -30,11 +30,13 @@
 #include <string.h>
 
 #include "py/runtime.h"
+#include "py/objtuple.h"
 
 #if MICROPY_PY_MACHINE_HW_SPI
 
 #include "py/nlr.h"
 #include "py/mphal.h"
+#include "py/mperrno.h"
 #include "extmod/machine_spi.h"
 #include "pin.h"
 #include "genhdr/pins.h"
@@ -44,6 +46,9 @@
 #else
 #include "nrfx_spim.h"
 #endif
+#if BLUETOOTH_SD
+#include "ble_drv.h"
+#endif
 
 /// \moduleref machine
 /// \class SPI - a master-driven serial protocol
@@ -95,12 +100,37 @@
 #define nrfx_spi_uninit             nrfx_spim_uninit
 #define nrfx_spi_xfer               nrfx_spim_xfer
 
+// Largest transfer that EasyDMA can do in one go.
+#define SPI_XFER_MAX                ((1 << SPIM0_EASYDMA_MAXCNT_SIZE) - 1)
+
+// Size of the transfers that are fitted between radio events, which at
+// 8MHz takes about as long as the notification comes before the radio.
+#define SPI_XFER_RADIO_IDLE         (255)
+
+// Data in flash is copied to RAM through a buffer of this size on the stack,
+// because EasyDMA can only read RAM.
+#define SPI_XFER_BOUNCE             (64)
+
+// State of the EasyDMA transfer in progress, which is split into chunks.
+typedef struct _machine_hard_spi_xfer_t {
+    const uint8_t *src;
+    uint8_t *dest;
+    volatile size_t len;        // bytes left after the chunk in progress
+    volatile bool busy;
+    volatile bool radio_wait;   // next chunk waits until the radio is idle
+    bool radio_idle;            // only start chunks while the radio is idle
+    bool callback;              // schedule the callback when done
+} machine_hard_spi_xfer_t;
+
 #endif // NRFX_SPIM_ENABLED
 
 typedef struct _machine_hard_spi_obj_t {
     mp_obj_base_t       base;
     const nrfx_spi_t   * p_spi;    // Driver instance
     nrfx_spi_config_t  * p_config; // pointer to volatile part
+#if NRFX_SPIM_ENABLED
+    machine_hard_spi_xfer_t * xfer; // asynchronous transfer state
+#endif
 } machine_hard_spi_obj_t;
 
 STATIC const nrfx_spi_t machine_spi_instances[] = {
@@ -116,18 +146,30 @@ STATIC const nrfx_spi_t machine_spi_instances[] = {
 
 STATIC nrfx_spi_config_t configs[MP_ARRAY_SIZE(machine_spi_instances)];
 
+#if NRFX_SPIM_ENABLED
+STATIC machine_hard_spi_xfer_t xfers[MP_ARRAY_SIZE(machine_spi_instances)];
+#define SPI_XFER(n) , .xfer = &xfers[n]
+#else
+#define SPI_XFER(n)
+#endif
+
 STATIC const machine_hard_spi_obj_t machine_hard_spi_obj[] = {
-    {{&machine_hard_spi_type}, .p_spi = &machine_spi_instances[0], .p_config = &configs[0]},
-    {{&machine_hard_spi_type}, .p_spi = &machine_spi_instances[1], .p_config = &configs[1]},
+    {{&machine_hard_spi_type}, .p_spi = &machine_spi_instances[0], .p_config = &configs[0] SPI_XFER(0)},
+    {{&machine_hard_spi_type}, .p_spi = &machine_spi_instances[1], .p_config = &configs[1] SPI_XFER(1)},
 #if defined(NRF52_SERIES)
-    {{&machine_hard_spi_type}, .p_spi = &machine_spi_instances[2], .p_config = &configs[2]},
+    {{&machine_hard_spi_type}, .p_spi = &machine_spi_instances[2], .p_config = &configs[2] SPI_XFER(2)},
 #if defined(NRF52840_XXAA) && NRFX_SPIM_ENABLED
-    {{&machine_hard_spi_type}, .p_spi = &machine_spi_instances[3], .p_config = &configs[3]},
+    {{&machine_hard_spi_type}, .p_spi = &machine_spi_instances[3], .p_config = &configs[3] SPI_XFER(3)},
 #endif // NRF52840_XXAA && NRFX_SPIM_ENABLED
 #endif // NRF52_SERIES
 };
 
 void spi_init0(void) {
+#if NRFX_SPIM_ENABLED
+    for (size_t i = 0; i < MP_ARRAY_SIZE(machine_hard_spi_obj); i++) {
+        MP_STATE_PORT(machine_spi_async)[i] = MP_OBJ_NULL;
+    }
+#endif
 }
 
 STATIC int spi_find(mp_obj_t id) {
@@ -151,6 +193,125 @@ STATIC int spi_find(mp_obj_t id) {
     }
 }
 
+#if NRFX_SPIM_ENABLED
+
+STATIC bool spi_radio_active(const machine_hard_spi_xfer_t *xfer) {
+#if BLUETOOTH_SD
+    return xfer->radio_idle && ble_drv_radio_active();
+#else
+    return false;
+#endif
+}
+
+// Start the next chunk of the transfer, called from thread mode with the
+// transfer not yet started or from the interrupts once a chunk is done.
+STATIC void spi_xfer_next(const machine_hard_spi_obj_t *self) {
+    machine_hard_spi_xfer_t *xfer = self->xfer;
+    size_t len = MIN(xfer->len, xfer->radio_idle ? SPI_XFER_RADIO_IDLE : SPI_XFER_MAX);
+    nrfx_spi_xfer_desc_t xfer_desc = {
+        .p_tx_buffer = xfer->src,
+        .tx_length   = xfer->src != NULL ? len : 0,
+        .p_rx_buffer = xfer->dest,
+        .rx_length   = xfer->dest != NULL ? len : 0
+    };
+    if (xfer->src != NULL) {
+        xfer->src += len;
+    }
+    if (xfer->dest != NULL) {
+        xfer->dest += len;
+    }
+    xfer->len -= len;
+    nrfx_spi_xfer(self->p_spi, &xfer_desc, 0);
+}
+
+STATIC void spi_event_handler(nrfx_spim_evt_t const *p_event, void *p_context) {
+    const machine_hard_spi_obj_t *self = p_context;
+    machine_hard_spi_xfer_t *xfer = self->xfer;
+    if (xfer->len > 0) {
+        if (spi_radio_active(xfer)) {
+            // the radio notification starts it again
+            xfer->radio_wait = true;
+        } else {
+            spi_xfer_next(self);
+        }
+        return;
+    }
+    xfer->busy = false;
+    if (xfer->callback) {
+        mp_obj_tuple_t *async = MP_OBJ_TO_PTR(MP_STATE_PORT(machine_spi_async)[self->p_spi->drv_inst_idx]);
+        mp_sched_schedule(async->items[0], MP_OBJ_FROM_PTR(self));
+    }
+}
+
+void spi_radio_idle(void) {
+    for (size_t i = 0; i < MP_ARRAY_SIZE(machine_hard_spi_obj); i++) {
+        const machine_hard_spi_obj_t *self = &machine_hard_spi_obj[i];
+        if (self->xfer->radio_wait) {
+            self->xfer->radio_wait = false;
+            spi_xfer_next(self);
+        }
+    }
+}
+
+STATIC void spi_xfer_start(const machine_hard_spi_obj_t *self, size_t len, const void *src, void *dest, bool radio_idle) {
+    machine_hard_spi_xfer_t *xfer = self->xfer;
+    xfer->src = src;
+    xfer->dest = dest;
+    xfer->len = len;
+    xfer->radio_idle = radio_idle;
+    xfer->busy = true;
+    bool start = true;
+    NRFX_CRITICAL_SECTION_ENTER();
+    // the radio notification can't come between the check and the flag
+    if (spi_radio_active(xfer)) {
+        xfer->radio_wait = true;
+        start = false;
+    }
+    NRFX_CRITICAL_SECTION_EXIT();
+    if (start) {
+        spi_xfer_next(self);
+    }
+}
+
+STATIC void spi_xfer_wait(const machine_hard_spi_obj_t *self) {
+    while (self->xfer->busy) {
+        __WFI();
+    }
+}
+
+void spi_transfer(const machine_hard_spi_obj_t * self, size_t len, const void * src, void * dest) {
+    // finish any asynchronous transfer first
+    spi_xfer_wait(self);
+    self->xfer->callback = false;
+
+    const uint8_t *src_buf = src;
+    uint8_t *dest_buf = dest;
+    uint8_t bounce[SPI_XFER_BOUNCE];
+    while (len > 0) {
+        size_t chunk = len;
+        const uint8_t *chunk_src = src_buf;
+        if (src_buf != NULL && !nrfx_is_in_ram(src_buf)) {
+            chunk = MIN(chunk, sizeof(bounce));
+            memcpy(bounce, src_buf, chunk);
+            chunk_src = bounce;
+        }
+        spi_xfer_start(self, chunk, chunk_src, dest_buf, false);
+        spi_xfer_wait(self);
+        if (src_buf != NULL) {
+            src_buf += chunk;
+        }
+        if (dest_buf != NULL) {
+            dest_buf += chunk;
+        }
+        len -= chunk;
+    }
+}
+
+#else
+
+void spi_radio_idle(void) {
+}
+
 void spi_transfer(const machine_hard_spi_obj_t * self, size_t len, const void * src, void * dest) {
     nrfx_spi_xfer_desc_t xfer_desc = {
         .p_tx_buffer = src,
@@ -162,6 +323,8 @@ void spi_transfer(const machine_hard_spi_obj_t * self, size_t len, const void *
     nrfx_spi_xfer(self->p_spi, &xfer_desc, 0);
 }
 
+#endif // NRFX_SPIM_ENABLED
+
 /******************************************************************************/
 /* MicroPython bindings for machine API                                       */
 
@@ -252,6 +415,62 @@ STATIC mp_obj_t machine_spi_deinit(mp_obj_t self) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(machine_spi_deinit_obj, machine_spi_deinit);
 
+#if NRFX_SPIM_ENABLED
+
+/// \method write_async(buf, callback=None, *, radio_idle=False)
+/// Start writing `buf` by EasyDMA and return at once.  When the write is
+/// done `callback` is scheduled with the SPI object.  With `radio_idle`
+/// the data goes in short chunks that are only started while the BLE radio
+/// is idle.
+STATIC mp_obj_t mp_machine_spi_write_async(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_buf, ARG_callback, ARG_radio_idle };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_buf,        MP_ARG_REQUIRED | MP_ARG_OBJ },
+        { MP_QSTR_callback,   MP_ARG_OBJ, {.u_obj = mp_const_none} },
+        { MP_QSTR_radio_idle, MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = false} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    const machine_hard_spi_obj_t *self = MP_OBJ_TO_PTR(pos_args[0]);
+    if (self->xfer->busy) {
+        mp_raise_OSError(MP_EBUSY);
+    }
+
+    mp_obj_t buf = args[ARG_buf].u_obj;
+    mp_buffer_info_t src;
+    mp_get_buffer_raise(buf, &src, MP_BUFFER_READ);
+    if (!nrfx_is_in_ram(src.buf)) {
+        // EasyDMA can only read RAM
+        buf = mp_obj_new_bytearray(src.len, src.buf);
+        mp_get_buffer_raise(buf, &src, MP_BUFFER_READ);
+    }
+    if (src.len == 0) {
+        if (args[ARG_callback].u_obj != mp_const_none) {
+            mp_sched_schedule(args[ARG_callback].u_obj, pos_args[0]);
+        }
+        return mp_const_none;
+    }
+
+    // keep the buffer and the callback alive until the transfer is done
+    mp_obj_t items[2] = {args[ARG_callback].u_obj, buf};
+    MP_STATE_PORT(machine_spi_async)[self->p_spi->drv_inst_idx] = mp_obj_new_tuple(2, items);
+    self->xfer->callback = args[ARG_callback].u_obj != mp_const_none;
+    spi_xfer_start(self, src.len, src.buf, NULL, args[ARG_radio_idle].u_bool);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mp_machine_spi_write_async_obj, 2, mp_machine_spi_write_async);
+
+/// \method busy()
+/// Return whether an asynchronous write is in progress.
+STATIC mp_obj_t mp_machine_spi_busy(mp_obj_t self_in) {
+    const machine_hard_spi_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    return mp_obj_new_bool(self->xfer->busy);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mp_machine_spi_busy_obj, mp_machine_spi_busy);
+
+#endif // NRFX_SPIM_ENABLED
+
 STATIC const mp_rom_map_elem_t machine_spi_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_init), MP_ROM_PTR(&machine_spi_init_obj) },
     { MP_ROM_QSTR(MP_QSTR_deinit), MP_ROM_PTR(&machine_spi_deinit_obj) },
@@ -260,6 +479,10 @@ STATIC const mp_rom_map_elem_t machine_spi_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_readinto), MP_ROM_PTR(&mp_machine_spi_readinto_obj) },
     { MP_ROM_QSTR(MP_QSTR_write), MP_ROM_PTR(&mp_machine_spi_write_obj) },
     { MP_ROM_QSTR(MP_QSTR_write_readinto), MP_ROM_PTR(&mp_machine_spi_write_readinto_obj) },
+#if NRFX_SPIM_ENABLED
+    { MP_ROM_QSTR(MP_QSTR_write_async), MP_ROM_PTR(&mp_machine_spi_write_async_obj) },
+    { MP_ROM_QSTR(MP_QSTR_busy), MP_ROM_PTR(&mp_machine_spi_busy_obj) },
+#endif
 
     { MP_ROM_QSTR(MP_QSTR_MSB), MP_ROM_INT(NRF_SPI_BIT_ORDER_MSB_FIRST) },
     { MP_ROM_QSTR(MP_QSTR_LSB), MP_ROM_INT(NRF_SPI_BIT_ORDER_LSB_FIRST) },
@@ -361,19 +584,33 @@ STATIC void machine_hard_spi_init(mp_obj_t self_in, mp_arg_val_t *args) {
     self->p_config->orc  = 0xFF; // Overrun character
     self->p_config->bit_order = (args[ARG_INIT_firstbit].u_int == 0) ? NRF_SPI_BIT_ORDER_MSB_FIRST : NRF_SPI_BIT_ORDER_LSB_FIRST;
 
+#if NRFX_SPIM_ENABLED
+    // Transfers are done by EasyDMA with an interrupt at the end of each one.
+    nrfx_spim_evt_handler_t handler = spi_event_handler;
+    spi_xfer_wait(self);
+#else
+    nrfx_spi_evt_handler_t handler = NULL;
+#endif
+
     // Set context to this instance of SPI
-    nrfx_err_t err_code = nrfx_spi_init(self->p_spi, self->p_config, NULL, (void *)self);
+    nrfx_err_t err_code = nrfx_spi_init(self->p_spi, self->p_config, handler, (void *)self);
 
     if (err_code == NRFX_ERROR_INVALID_STATE) {
         // Instance already initialized, deinitialize first.
         nrfx_spi_uninit(self->p_spi);
         // Initialize again.
-        nrfx_spi_init(self->p_spi, self->p_config, NULL, (void *)self);
+        nrfx_spi_init(self->p_spi, self->p_config, handler, (void *)self);
     }
 }
 
 STATIC void machine_hard_spi_deinit(mp_obj_t self_in) {
     const machine_hard_spi_obj_t *self = MP_OBJ_TO_PTR(self_in);
+#if NRFX_SPIM_ENABLED
+    // abandon any asynchronous transfer
+    self->xfer->radio_wait = false;
+    self->xfer->busy = false;
+    MP_STATE_PORT(machine_spi_async)[self->p_spi->drv_inst_idx] = MP_OBJ_NULL;
+#endif
     nrfx_spi_uninit(self->p_spi);
 }
 
@@ -30,6 +30,7 @@ typedef struct _machine_hard_spi_obj_t machine_hard_spi_obj_t;
 extern const mp_obj_type_t machine_hard_spi_type;
 
 void spi_init0(void);
+void spi_radio_idle(void);
 void spi_transfer(const machine_hard_spi_obj_t * self,
                   size_t                         len,
                   const void *                   src,
@@ -36,6 +36,7 @@
 #include "py/mperrno.h"
 #include "py/mphal.h"
 #include "py/ringbuf.h"
+#include "py/objtuple.h"
 #include "pin.h"
 #include "genhdr/pins.h"
 #include "lib/utils/interrupt_char.h"
@@ -50,6 +51,9 @@
 #else
 #include "nrfx_uarte.h"
 #endif
+#if BLUETOOTH_SD
+#include "ble_drv.h"
+#endif
 
 
 #if MICROPY_PY_MACHINE_UART
@@ -59,6 +63,15 @@ typedef struct _machine_hard_uart_buf_t {
     uint8_t rx_buf[1];
     uint8_t rx_ringbuf_array[64];
     volatile ringbuf_t rx_ringbuf;
+#if NRFX_UARTE_ENABLED
+    // state of the EasyDMA write in progress, which is split into chunks
+    const uint8_t *tx_src;
+    volatile size_t tx_len;         // bytes left after the chunk in progress
+    volatile bool tx_busy;
+    volatile bool tx_radio_wait;    // next chunk waits until the radio is idle
+    bool tx_radio_idle;             // only start chunks while the radio is idle
+    bool tx_callback;               // schedule the callback when done
+#endif
 } machine_hard_uart_buf_t;
 
 #if NRFX_UARTE_ENABLED
@@ -77,6 +90,7 @@ typedef struct _machine_hard_uart_buf_t {
 #define NRF_UART_HWFC_DISABLED    NRF_UARTE_HWFC_DISABLED
 #define NRF_UART_PARITY_EXCLUDED  NRF_UARTE_PARITY_EXCLUDED
 #define NRFX_UART_EVT_RX_DONE     NRFX_UARTE_EVT_RX_DONE
+#define NRFX_UART_EVT_TX_DONE     NRFX_UARTE_EVT_TX_DONE
 
 #define NRF_UART_BAUDRATE_1200    NRF_UARTE_BAUDRATE_1200
 #define NRF_UART_BAUDRATE_2400    NRF_UARTE_BAUDRATE_2400
@@ -93,6 +107,12 @@ typedef struct _machine_hard_uart_buf_t {
 #define NRF_UART_BAUDRATE_250000  NRF_UARTE_BAUDRATE_250000
 #define NRF_UART_BAUDRATE_1000000 NRF_UARTE_BAUDRATE_1000000
 
+// Largest write that EasyDMA can do in one go.
+#define UART_XFER_MAX             ((1 << UARTE0_EASYDMA_MAXCNT_SIZE) - 1)
+
+// Size of the writes that are fitted between radio events.
+#define UART_XFER_RADIO_IDLE      (32)
+
 #endif
 
 typedef struct _machine_hard_uart_obj_t {
@@ -110,6 +130,11 @@ STATIC const machine_hard_uart_obj_t machine_hard_uart_obj[] = {
 };
 
 void uart_init0(void) {
+#if NRFX_UARTE_ENABLED
+    for (size_t i = 0; i < MP_ARRAY_SIZE(machine_hard_uart_obj); i++) {
+        MP_STATE_PORT(machine_uart_async)[i] = MP_OBJ_NULL;
+    }
+#endif
 }
 
 STATIC int uart_find(mp_obj_t id) {
@@ -121,8 +146,102 @@ STATIC int uart_find(mp_obj_t id) {
     mp_raise_ValueError(MP_ERROR_TEXT("UART doesn't exist"));
 }
 
+#if NRFX_UARTE_ENABLED
+
+STATIC bool uart_radio_active(const machine_hard_uart_buf_t *buf) {
+#if BLUETOOTH_SD
+    return buf->tx_radio_idle && ble_drv_radio_active();
+#else
+    return false;
+#endif
+}
+
+// Start the next chunk of the write, called from thread mode with the
+// write not yet started or from the interrupts once a chunk is done.
+STATIC void uart_xfer_next(const machine_hard_uart_obj_t *self) {
+    machine_hard_uart_buf_t *buf = self->buf;
+    size_t len = MIN(buf->tx_len, buf->tx_radio_idle ? UART_XFER_RADIO_IDLE : UART_XFER_MAX);
+    const uint8_t *src = buf->tx_src;
+    buf->tx_src += len;
+    buf->tx_len -= len;
+    nrfx_uart_tx(self->p_uart, src, len);
+}
+
+STATIC void uart_xfer_done(const machine_hard_uart_obj_t *self) {
+    machine_hard_uart_buf_t *buf = self->buf;
+    if (!buf->tx_busy) {
+        // a single character from uart_tx_char
+        return;
+    }
+    if (buf->tx_len > 0) {
+        if (uart_radio_active(buf)) {
+            // the radio notification starts it again
+            buf->tx_radio_wait = true;
+        } else {
+            uart_xfer_next(self);
+        }
+        return;
+    }
+    buf->tx_busy = false;
+    if (buf->tx_callback) {
+        mp_obj_tuple_t *async = MP_OBJ_TO_PTR(MP_STATE_PORT(machine_uart_async)[self - machine_hard_uart_obj]);
+        mp_sched_schedule(async->items[0], MP_OBJ_FROM_PTR(self));
+    }
+}
+
+void uart_radio_idle(void) {
+    for (size_t i = 0; i < MP_ARRAY_SIZE(machine_hard_uart_obj); i++) {
+        const machine_hard_uart_obj_t *self = &machine_hard_uart_obj[i];
+        if (self->buf->tx_radio_wait) {
+            self->buf->tx_radio_wait = false;
+            uart_xfer_next(self);
+        }
+    }
+}
+
+STATIC void uart_xfer_start(const machine_hard_uart_obj_t *self, const uint8_t *src, size_t len, bool radio_idle) {
+    machine_hard_uart_buf_t *buf = self->buf;
+    while (nrfx_uart_tx_in_progress(self->p_uart)) {
+        ;
+    }
+    buf->tx_src = src;
+    buf->tx_len = len;
+    buf->tx_radio_idle = radio_idle;
+    buf->tx_busy = true;
+    bool start = true;
+    NRFX_CRITICAL_SECTION_ENTER();
+    // the radio notification can't come between the check and the flag
+    if (uart_radio_active(buf)) {
+        buf->tx_radio_wait = true;
+        start = false;
+    }
+    NRFX_CRITICAL_SECTION_EXIT();
+    if (start) {
+        uart_xfer_next(self);
+    }
+}
+
+STATIC void uart_xfer_wait(const machine_hard_uart_obj_t *self) {
+    while (self->buf->tx_busy) {
+        __WFI();
+    }
+}
+
+#else
+
+void uart_radio_idle(void) {
+}
+
+#endif // NRFX_UARTE_ENABLED
+
 STATIC void uart_event_handler(nrfx_uart_event_t const *p_event, void *p_context) {
     machine_hard_uart_obj_t *self = p_context;
+#if NRFX_UARTE_ENABLED
+    if (p_event->type == NRFX_UART_EVT_TX_DONE) {
+        uart_xfer_done(self);
+        return;
+    }
+#endif
     if (p_event->type == NRFX_UART_EVT_RX_DONE) {
         int chr = self->buf->rx_buf[0];
         nrfx_uart_rx(self->p_uart, &self->buf->rx_buf[0], 1);
@@ -146,6 +265,9 @@ int uart_rx_char(const machine_hard_uart_obj_t * self) {
 }
 
 STATIC nrfx_err_t uart_tx_char(const machine_hard_uart_obj_t * self, int c) {
+#if NRFX_UARTE_ENABLED
+    uart_xfer_wait(self);
+#endif
     while (nrfx_uart_tx_in_progress(self->p_uart)) {
         ;
     }
@@ -290,16 +412,79 @@ STATIC mp_obj_t machine_hard_uart_sendbreak(mp_obj_t self_in) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(machine_hard_uart_sendbreak_obj, machine_hard_uart_sendbreak);
 
+#if NRFX_UARTE_ENABLED
+
+/// \method write_async(buf, callback=None, *, radio_idle=False)
+/// Start writing `buf` by EasyDMA and return at once.  When the write is
+/// done `callback` is scheduled with the UART object.  With `radio_idle`
+/// the data goes in short chunks that are only started while the BLE radio
+/// is idle.
+STATIC mp_obj_t machine_hard_uart_write_async(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_buf, ARG_callback, ARG_radio_idle };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_buf,        MP_ARG_REQUIRED | MP_ARG_OBJ },
+        { MP_QSTR_callback,   MP_ARG_OBJ, {.u_obj = mp_const_none} },
+        { MP_QSTR_radio_idle, MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = false} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    const machine_hard_uart_obj_t *self = MP_OBJ_TO_PTR(pos_args[0]);
+    if (self->buf->tx_busy) {
+        mp_raise_OSError(MP_EBUSY);
+    }
+
+    mp_obj_t data = args[ARG_buf].u_obj;
+    mp_buffer_info_t src;
+    mp_get_buffer_raise(data, &src, MP_BUFFER_READ);
+    if (!nrfx_is_in_ram(src.buf)) {
+        // EasyDMA can only read RAM
+        data = mp_obj_new_bytearray(src.len, src.buf);
+        mp_get_buffer_raise(data, &src, MP_BUFFER_READ);
+    }
+    if (src.len == 0) {
+        if (args[ARG_callback].u_obj != mp_const_none) {
+            mp_sched_schedule(args[ARG_callback].u_obj, pos_args[0]);
+        }
+        return mp_const_none;
+    }
+
+    // keep the buffer and the callback alive until the write is done
+    mp_obj_t items[2] = {args[ARG_callback].u_obj, data};
+    MP_STATE_PORT(machine_uart_async)[self - machine_hard_uart_obj] = mp_obj_new_tuple(2, items);
+    self->buf->tx_callback = args[ARG_callback].u_obj != mp_const_none;
+    uart_xfer_start(self, src.buf, src.len, args[ARG_radio_idle].u_bool);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(machine_hard_uart_write_async_obj, 2, machine_hard_uart_write_async);
+
+/// \method busy()
+/// Return whether an asynchronous write is in progress.
+STATIC mp_obj_t machine_hard_uart_busy(mp_obj_t self_in) {
+    const machine_hard_uart_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    return mp_obj_new_bool(self->buf->tx_busy);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(machine_hard_uart_busy_obj, machine_hard_uart_busy);
+
+#endif // NRFX_UARTE_ENABLED
+
 STATIC const mp_rom_map_elem_t machine_hard_uart_locals_dict_table[] = {
     // instance methods
     { MP_ROM_QSTR(MP_QSTR_read), MP_ROM_PTR(&mp_stream_read_obj) },
     { MP_ROM_QSTR(MP_QSTR_readline), MP_ROM_PTR(&mp_stream_unbuffered_readline_obj) },
+#if MICROPY_STREAMS_READLINE_INTO
+    { MP_ROM_QSTR(MP_QSTR_readline_into), MP_ROM_PTR(&mp_stream_unbuffered_readline_into_obj) },
+#endif
     { MP_ROM_QSTR(MP_QSTR_readinto), MP_ROM_PTR(&mp_stream_readinto_obj) },
     { MP_ROM_QSTR(MP_QSTR_write), MP_ROM_PTR(&mp_stream_write_obj) },
 
     { MP_ROM_QSTR(MP_QSTR_writechar), MP_ROM_PTR(&machine_hard_uart_writechar_obj) },
     { MP_ROM_QSTR(MP_QSTR_readchar), MP_ROM_PTR(&machine_hard_uart_readchar_obj) },
     { MP_ROM_QSTR(MP_QSTR_sendbreak), MP_ROM_PTR(&machine_hard_uart_sendbreak_obj) },
+#if NRFX_UARTE_ENABLED
+    { MP_ROM_QSTR(MP_QSTR_write_async), MP_ROM_PTR(&machine_hard_uart_write_async_obj) },
+    { MP_ROM_QSTR(MP_QSTR_busy), MP_ROM_PTR(&machine_hard_uart_busy_obj) },
+#endif
 
     // class constants
 /*
@@ -329,6 +514,16 @@ STATIC mp_uint_t machine_hard_uart_write(mp_obj_t self_in, const void *buf_in, m
     const byte *buf = buf_in;
 
     nrfx_err_t err = NRFX_SUCCESS;
+#if NRFX_UARTE_ENABLED
+    if (nrfx_is_in_ram(buf)) {
+        // let EasyDMA send the whole buffer
+        uart_xfer_wait(self);
+        self->buf->tx_callback = false;
+        uart_xfer_start(self, buf, size, false);
+        uart_xfer_wait(self);
+        return size;
+    }
+#endif
     for (int i = 0; i < size; i++) {
         err = uart_tx_char(self, (int)((uint8_t *)buf)[i]);
     }
@@ -37,6 +37,7 @@ extern const mp_obj_type_t machine_hard_uart_type;
 void uart_init0(void);
 void uart_deinit(void);
 void uart_irq_handler(mp_uint_t uart_id);
+void uart_radio_idle(void);
 
 bool uart_rx_any(const machine_hard_uart_obj_t * uart_obj);
 int uart_rx_char(const machine_hard_uart_obj_t * uart_obj);
@@ -313,6 +313,10 @@ extern const struct _mp_obj_module_t ble_module;
     /* stdio is repeated on this UART object if it's not null */ \
     struct _machine_hard_uart_obj_t *board_stdio_uart; \
     \
+    /* callback and buffer of each asynchronous SPI and UART write */ \
+    mp_obj_t machine_spi_async[4]; \
+    mp_obj_t machine_uart_async[1]; \
+    \
     ROOT_POINTERS_MUSIC \
     ROOT_POINTERS_SOFTPWM \
     \
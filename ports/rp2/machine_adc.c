@@ -25,13 +25,29 @@
  */
 
 #include "py/runtime.h"
+#include "py/mperrno.h"
 #include "py/mphal.h"
 #include "hardware/adc.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "modmachine.h"
 
 #define ADC_IS_VALID_GPIO(gpio) ((gpio) >= 26 && (gpio) <= 29)
 #define ADC_CHANNEL_FROM_GPIO(gpio) ((gpio) - 26)
 #define ADC_CHANNEL_TEMPSENSOR (4)
 
+// The ADC is clocked at 48MHz and each conversion takes 96 cycles.
+#define ADC_CLOCK_HZ (48000000)
+#define ADC_MAX_SAMPLE_RATE (ADC_CLOCK_HZ / 96)
+
+// State of timed conversions, which are moved from the ADC FIFO to memory by
+// DMA.  There is only one ADC so only one such conversion can run at a time.
+// Continuous conversions use two channels, one for each half of the buffer,
+// each chained to the other.
+STATIC int adc_timed_dma_chan[2] = {-1, -1};
+STATIC uint16_t *adc_timed_buf;
+STATIC size_t adc_timed_half_len;
+
 STATIC uint16_t adc_config_and_read_u16(uint32_t channel) {
     adc_select_input(channel);
     uint32_t raw = adc_read();
@@ -40,6 +56,101 @@ STATIC uint16_t adc_config_and_read_u16(uint32_t channel) {
     return raw << (16 - bits) | raw >> (2 * bits - 16);
 }
 
+STATIC void adc_timed_dma_irq_handler(void) {
+    for (size_t i = 0; i < 2; ++i) {
+        int chan = adc_timed_dma_chan[i];
+        if (chan >= 0 && (dma_hw->ints1 & (1u << chan))) {
+            dma_hw->ints1 = 1u << chan;
+            // Re-arm this half for when the other channel chains back to it.
+            dma_channel_set_write_addr(chan, adc_timed_buf + i * adc_timed_half_len, false);
+            mp_sched_schedule(MP_STATE_PORT(machine_adc_timed_callback), MP_OBJ_NEW_SMALL_INT(i));
+        }
+    }
+}
+
+STATIC void adc_timed_dma_config(int chan, int chain_to, uint16_t *dest, size_t len) {
+    dma_channel_config c = dma_channel_get_default_config(chan);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_16);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_dreq(&c, DREQ_ADC);
+    // Chaining a channel to itself disables chaining.
+    channel_config_set_chain_to(&c, chain_to);
+    dma_channel_configure(chan, &c, dest, &adc_hw->fifo, len, false);
+}
+
+STATIC void adc_timed_stop(void) {
+    adc_run(false);
+    uint32_t mask = 0;
+    for (size_t i = 0; i < 2; ++i) {
+        if (adc_timed_dma_chan[i] >= 0) {
+            dma_channel_set_irq1_enabled(adc_timed_dma_chan[i], false);
+            mask |= 1u << adc_timed_dma_chan[i];
+        }
+    }
+    if (mask) {
+        dma_hw->abort = mask;
+        while (dma_hw->abort & mask) {
+        }
+        dma_hw->ints1 = mask;
+    }
+    if (adc_timed_dma_chan[1] >= 0) {
+        irq_set_enabled(DMA_IRQ_1, false);
+        irq_remove_handler(DMA_IRQ_1, adc_timed_dma_irq_handler);
+    }
+    for (size_t i = 0; i < 2; ++i) {
+        if (adc_timed_dma_chan[i] >= 0) {
+            dma_channel_unclaim(adc_timed_dma_chan[i]);
+            adc_timed_dma_chan[i] = -1;
+        }
+    }
+    adc_fifo_setup(false, false, 0, false, false);
+    adc_fifo_drain();
+    adc_set_clkdiv(0);
+    MP_STATE_PORT(machine_adc_timed_buf) = MP_OBJ_NULL;
+    MP_STATE_PORT(machine_adc_timed_callback) = MP_OBJ_NULL;
+}
+
+// Start sampling the given channel into buf at the given rate, either once, or
+// continuously with two chained DMA channels each filling half of buf.
+STATIC void adc_timed_start(uint32_t channel, uint16_t *buf, size_t len, mp_int_t rate, bool continuous) {
+    adc_timed_dma_chan[0] = dma_claim_unused_channel(false);
+    if (continuous) {
+        adc_timed_dma_chan[1] = dma_claim_unused_channel(false);
+    }
+    if (adc_timed_dma_chan[0] < 0 || (continuous && adc_timed_dma_chan[1] < 0)) {
+        adc_timed_stop();
+        mp_raise_OSError(MP_EBUSY);
+    }
+
+    adc_timed_buf = buf;
+    if (continuous) {
+        adc_timed_half_len = len / 2;
+        adc_timed_dma_config(adc_timed_dma_chan[0], adc_timed_dma_chan[1], buf, adc_timed_half_len);
+        adc_timed_dma_config(adc_timed_dma_chan[1], adc_timed_dma_chan[0], buf + adc_timed_half_len, adc_timed_half_len);
+        irq_set_exclusive_handler(DMA_IRQ_1, adc_timed_dma_irq_handler);
+        dma_channel_set_irq1_enabled(adc_timed_dma_chan[0], true);
+        dma_channel_set_irq1_enabled(adc_timed_dma_chan[1], true);
+        irq_set_enabled(DMA_IRQ_1, true);
+    } else {
+        adc_timed_dma_config(adc_timed_dma_chan[0], adc_timed_dma_chan[0], buf, len);
+    }
+
+    adc_select_input(channel);
+    // A sample is taken every (1 + div) ADC clock cycles.
+    adc_set_clkdiv((float)ADC_CLOCK_HZ / rate - 1);
+    adc_fifo_setup(true, true, 1, false, false);
+    adc_fifo_drain();
+    dma_channel_start(adc_timed_dma_chan[0]);
+    adc_run(true);
+}
+
+void machine_adc_deinit(void) {
+    if (adc_timed_dma_chan[0] >= 0) {
+        adc_timed_stop();
+    }
+}
+
 /******************************************************************************/
 // MicroPython bindings for machine.ADC
 
@@ -103,12 +214,75 @@ STATIC mp_obj_t machine_adc_make_new(const mp_obj_type_t *type, size_t n_args, s
 // read_u16()
 STATIC mp_obj_t machine_adc_read_u16(mp_obj_t self_in) {
     machine_adc_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (adc_timed_dma_chan[0] >= 0) {
+        mp_raise_OSError(MP_EBUSY);
+    }
     return MP_OBJ_NEW_SMALL_INT(adc_config_and_read_u16(self->channel));
 }
 MP_DEFINE_CONST_FUN_OBJ_1(machine_adc_read_u16_obj, machine_adc_read_u16);
 
+// read_timed_into(buf, rate, callback=None)
+STATIC mp_obj_t machine_adc_read_timed_into(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_buf, ARG_rate, ARG_callback };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_buf, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_rate, MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_callback, MP_ARG_OBJ, {.u_obj = mp_const_none} },
+    };
+    machine_adc_obj_t *self = MP_OBJ_TO_PTR(pos_args[0]);
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[ARG_buf].u_obj, &bufinfo, MP_BUFFER_WRITE);
+    size_t len = bufinfo.len / sizeof(uint16_t);
+    mp_int_t rate = args[ARG_rate].u_int;
+    bool continuous = args[ARG_callback].u_obj != mp_const_none;
+    if (((uintptr_t)bufinfo.buf & 1) || len < (continuous ? 2 : 1)) {
+        mp_raise_ValueError(MP_ERROR_TEXT("invalid buffer"));
+    }
+    if (rate <= 0 || rate > ADC_MAX_SAMPLE_RATE) {
+        mp_raise_ValueError(MP_ERROR_TEXT("invalid rate"));
+    }
+    if (adc_timed_dma_chan[0] >= 0) {
+        mp_raise_OSError(MP_EBUSY);
+    }
+
+    MP_STATE_PORT(machine_adc_timed_buf) = args[ARG_buf].u_obj;
+    MP_STATE_PORT(machine_adc_timed_callback) = args[ARG_callback].u_obj;
+    adc_timed_start(self->channel, bufinfo.buf, len, rate, continuous);
+
+    if (!continuous) {
+        // Wait for the buffer to fill, stopping the ADC if interrupted.
+        nlr_buf_t nlr;
+        if (nlr_push(&nlr) == 0) {
+            while (dma_channel_is_busy(adc_timed_dma_chan[0])) {
+                MICROPY_EVENT_POLL_HOOK
+            }
+            nlr_pop();
+        } else {
+            adc_timed_stop();
+            nlr_jump(nlr.ret_val);
+        }
+        adc_timed_stop();
+    }
+
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_KW(machine_adc_read_timed_into_obj, 3, machine_adc_read_timed_into);
+
+// stop_timed()
+STATIC mp_obj_t machine_adc_stop_timed(mp_obj_t self_in) {
+    (void)self_in;
+    machine_adc_deinit();
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_1(machine_adc_stop_timed_obj, machine_adc_stop_timed);
+
 STATIC const mp_rom_map_elem_t machine_adc_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_read_u16), MP_ROM_PTR(&machine_adc_read_u16_obj) },
+    { MP_ROM_QSTR(MP_QSTR_read_timed_into), MP_ROM_PTR(&machine_adc_read_timed_into_obj) },
+    { MP_ROM_QSTR(MP_QSTR_stop_timed), MP_ROM_PTR(&machine_adc_stop_timed_obj) },
 
     { MP_ROM_QSTR(MP_QSTR_CORE_TEMP), MP_ROM_INT(ADC_CHANNEL_TEMPSENSOR) },
 };
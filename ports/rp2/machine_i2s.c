@@ -0,0 +1,299 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "py/runtime.h"
+#include "py/mperrno.h"
+#include "py/mphal.h"
+#include "extmod/machine_i2s.h"
+#include "modmachine.h"
+
+#include "hardware/clocks.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/pio.h"
+
+#if MICROPY_PY_MACHINE_I2S
+
+// I2S(0) and I2S(1) each run a PIO state machine, fed by two DMA channels
+// that are chained to each other, one for each half of a buffer.  When a
+// channel finishes, its half is moved to or from the ring buffer while the
+// other channel works on the other half.  The PIO programs always clock out
+// stereo frames, and drive SCK and WS as side-set pins, so WS must be the pin
+// after SCK.
+
+// Size of each half of the DMA buffer: 2.7ms of 16-bit stereo at 48kHz.
+#define I2S_DMA_HALF_SIZE (512)
+
+// Two instructions per bit, and the loop counters are patched with the
+// number of bits per sample.  Side-set bit 0 is SCK and bit 1 is WS.
+STATIC const uint16_t machine_i2s_tx_program[] = {
+    0x6001, //  0: out pins, 1          side 0b00   ; left, WS low
+    0x0840, //  1: jmp x--, 0           side 0b01
+    0x7001, //  2: out pins, 1          side 0b10   ; last bit, WS changes
+    0xf820, //  3: set x, bits - 2      side 0b11
+    0x7001, //  4: out pins, 1          side 0b10   ; right, WS high
+    0x1844, //  5: jmp x--, 4           side 0b11
+    0x6001, //  6: out pins, 1          side 0b00   ; last bit, WS changes
+    0xe820, //  7: set x, bits - 2      side 0b01   ; entry point
+};
+#define TX_SET_X_0 (3)
+#define TX_SET_X_1 (7)
+#define TX_ENTRY (7)
+
+// Data is sampled on the rising edge of SCK.
+STATIC const uint16_t machine_i2s_rx_program[] = {
+    0x4801, //  0: in pins, 1           side 0b01   ; left, WS low
+    0x0040, //  1: jmp x--, 0           side 0b00
+    0x4801, //  2: in pins, 1           side 0b01
+    0xb042, //  3: nop                  side 0b10   ; WS changes
+    0x5801, //  4: in pins, 1           side 0b11   ; last bit
+    0xf020, //  5: set x, bits - 3      side 0b10
+    0x5801, //  6: in pins, 1           side 0b11   ; right, WS high
+    0x1046, //  7: jmp x--, 6           side 0b10
+    0x5801, //  8: in pins, 1           side 0b11
+    0xa042, //  9: nop                  side 0b00   ; WS changes
+    0x4801, // 10: in pins, 1           side 0b01   ; last bit
+    0xe020, // 11: set x, bits - 3      side 0b00   ; entry point
+};
+#define RX_SET_X_0 (5)
+#define RX_SET_X_1 (11)
+#define RX_ENTRY (11)
+
+typedef struct _machine_i2s_port_obj_t {
+    machine_i2s_obj_t i2s;
+    PIO pio;
+    int sm;
+    uint prog_offset;
+    uint16_t prog_instr[MP_ARRAY_SIZE(machine_i2s_rx_program)];
+    pio_program_t prog;
+    int dma_chan[2];
+    uint32_t dma_buf[2 * I2S_DMA_HALF_SIZE / 4];
+} machine_i2s_port_obj_t;
+
+// Number of running objects, which share the DMA_IRQ_0 handler.
+STATIC size_t machine_i2s_irq_users;
+
+machine_i2s_obj_t *mp_machine_i2s_port_get(mp_int_t id) {
+    if (id != 0 && id != 1) {
+        mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("I2S(%d) doesn't exist"), id);
+    }
+    machine_i2s_port_obj_t *self = MP_STATE_PORT(machine_i2s_obj)[id];
+    if (self == NULL) {
+        self = m_new0(machine_i2s_port_obj_t, 1);
+        self->i2s.base.type = &machine_i2s_type;
+        self->i2s.id = id;
+        self->sm = -1;
+        self->dma_chan[0] = -1;
+        self->dma_chan[1] = -1;
+        MP_STATE_PORT(machine_i2s_obj)[id] = self;
+    }
+    return &self->i2s;
+}
+
+STATIC void machine_i2s_dma_irq(void) {
+    for (size_t id = 0; id < MP_ARRAY_SIZE(MP_STATE_PORT(machine_i2s_obj)); ++id) {
+        machine_i2s_port_obj_t *self = MP_STATE_PORT(machine_i2s_obj)[id];
+        if (self == NULL) {
+            continue;
+        }
+        for (size_t i = 0; i < 2; ++i) {
+            int chan = self->dma_chan[i];
+            if (chan >= 0 && (dma_hw->ints0 & (1u << chan))) {
+                dma_hw->ints0 = 1u << chan;
+                uint8_t *buf = (uint8_t *)self->dma_buf + i * I2S_DMA_HALF_SIZE;
+                // Re-arm this half for when the other channel chains back to it.
+                if (self->i2s.mode == MACHINE_I2S_RX) {
+                    machine_i2s_dma_rx(&self->i2s, buf, I2S_DMA_HALF_SIZE, true);
+                    dma_channel_set_write_addr(chan, buf, false);
+                } else {
+                    machine_i2s_dma_tx(&self->i2s, buf, I2S_DMA_HALF_SIZE, true);
+                    dma_channel_set_read_addr(chan, buf, false);
+                }
+            }
+        }
+    }
+}
+
+STATIC void machine_i2s_dma_config(machine_i2s_port_obj_t *self, size_t i) {
+    bool rx = self->i2s.mode == MACHINE_I2S_RX;
+    int chan = self->dma_chan[i];
+    uint8_t *buf = (uint8_t *)self->dma_buf + i * I2S_DMA_HALF_SIZE;
+    dma_channel_config c = dma_channel_get_default_config(chan);
+    // A 16-bit sample takes one FIFO entry, as a narrow write is replicated
+    // across the entry and a narrow read takes its low half.
+    channel_config_set_transfer_data_size(&c, self->i2s.bits == 16 ? DMA_SIZE_16 : DMA_SIZE_32);
+    channel_config_set_read_increment(&c, !rx);
+    channel_config_set_write_increment(&c, rx);
+    channel_config_set_dreq(&c, pio_get_dreq(self->pio, self->sm, !rx));
+    channel_config_set_chain_to(&c, self->dma_chan[i ^ 1]);
+    size_t count = I2S_DMA_HALF_SIZE / (self->i2s.bits / 8);
+    if (rx) {
+        dma_channel_configure(chan, &c, buf, &self->pio->rxf[self->sm], count, false);
+    } else {
+        dma_channel_configure(chan, &c, &self->pio->txf[self->sm], buf, count, false);
+    }
+}
+
+// Claim a state machine on a PIO with room for the program.
+STATIC bool machine_i2s_claim_sm(machine_i2s_port_obj_t *self) {
+    PIO pios[2] = {pio0, pio1};
+    for (size_t i = 0; i < 2; ++i) {
+        if (!pio_can_add_program(pios[i], &self->prog)) {
+            continue;
+        }
+        int sm = pio_claim_unused_sm(pios[i], false);
+        if (sm >= 0) {
+            self->pio = pios[i];
+            self->sm = sm;
+            self->prog_offset = pio_add_program(pios[i], &self->prog);
+            return true;
+        }
+    }
+    return false;
+}
+
+void mp_machine_i2s_port_start(machine_i2s_obj_t *i2s) {
+    machine_i2s_port_obj_t *self = (machine_i2s_port_obj_t *)i2s;
+    bool rx = i2s->mode == MACHINE_I2S_RX;
+    uint sck = mp_hal_get_pin_obj(i2s->sck);
+    uint ws = mp_hal_get_pin_obj(i2s->ws);
+    uint sd = mp_hal_get_pin_obj(i2s->sd);
+    if (ws != sck + 1) {
+        mp_raise_ValueError(MP_ERROR_TEXT("ws must be the pin after sck"));
+    }
+
+    // Make the program for the number of bits per sample.
+    uint entry;
+    if (rx) {
+        memcpy(self->prog_instr, machine_i2s_rx_program, sizeof(machine_i2s_rx_program));
+        self->prog_instr[RX_SET_X_0] |= i2s->bits - 3;
+        self->prog_instr[RX_SET_X_1] |= i2s->bits - 3;
+        self->prog.length = MP_ARRAY_SIZE(machine_i2s_rx_program);
+        entry = RX_ENTRY;
+    } else {
+        memcpy(self->prog_instr, machine_i2s_tx_program, sizeof(machine_i2s_tx_program));
+        self->prog_instr[TX_SET_X_0] |= i2s->bits - 2;
+        self->prog_instr[TX_SET_X_1] |= i2s->bits - 2;
+        self->prog.length = MP_ARRAY_SIZE(machine_i2s_tx_program);
+        entry = TX_ENTRY;
+    }
+    self->prog.instructions = self->prog_instr;
+    self->prog.origin = -1;
+
+    if (!machine_i2s_claim_sm(self)) {
+        mp_raise_OSError(MP_EBUSY);
+    }
+    self->dma_chan[0] = dma_claim_unused_channel(false);
+    self->dma_chan[1] = dma_claim_unused_channel(false);
+    if (self->dma_chan[0] < 0 || self->dma_chan[1] < 0) {
+        mp_machine_i2s_port_stop(i2s);
+        mp_raise_OSError(MP_EBUSY);
+    }
+
+    pio_sm_config c = pio_get_default_sm_config();
+    sm_config_set_wrap(&c, self->prog_offset, self->prog_offset + self->prog.length - 1);
+    sm_config_set_sideset(&c, 2, false, false);
+    sm_config_set_sideset_pins(&c, sck);
+    if (rx) {
+        sm_config_set_in_pins(&c, sd);
+        sm_config_set_in_shift(&c, false, true, i2s->bits);
+        sm_config_set_fifo_join(&c, PIO_FIFO_JOIN_RX);
+    } else {
+        sm_config_set_out_pins(&c, sd, 1);
+        sm_config_set_out_shift(&c, false, true, i2s->bits);
+        sm_config_set_fifo_join(&c, PIO_FIFO_JOIN_TX);
+    }
+    // Two instructions per bit, two channels per frame.
+    sm_config_set_clkdiv(&c, (float)clock_get_hz(clk_sys) / ((float)i2s->rate * i2s->bits * 4));
+    pio_gpio_init(self->pio, sck);
+    pio_gpio_init(self->pio, ws);
+    pio_sm_set_consecutive_pindirs(self->pio, self->sm, sck, 2, true);
+    if (!rx) {
+        pio_gpio_init(self->pio, sd);
+    }
+    pio_sm_set_consecutive_pindirs(self->pio, self->sm, sd, 1, !rx);
+    pio_sm_init(self->pio, self->sm, self->prog_offset + entry, &c);
+
+    memset(self->dma_buf, 0, sizeof(self->dma_buf));
+    machine_i2s_dma_config(self, 0);
+    machine_i2s_dma_config(self, 1);
+    if (machine_i2s_irq_users++ == 0) {
+        irq_add_shared_handler(DMA_IRQ_0, machine_i2s_dma_irq, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    }
+    dma_channel_set_irq0_enabled(self->dma_chan[0], true);
+    dma_channel_set_irq0_enabled(self->dma_chan[1], true);
+    dma_channel_start(self->dma_chan[0]);
+    pio_sm_set_enabled(self->pio, self->sm, true);
+}
+
+void mp_machine_i2s_port_stop(machine_i2s_obj_t *i2s) {
+    machine_i2s_port_obj_t *self = (machine_i2s_port_obj_t *)i2s;
+    if (self->sm >= 0) {
+        pio_sm_set_enabled(self->pio, self->sm, false);
+    }
+    uint32_t mask = 0;
+    for (size_t i = 0; i < 2; ++i) {
+        if (self->dma_chan[i] >= 0) {
+            dma_channel_set_irq0_enabled(self->dma_chan[i], false);
+            mask |= 1u << self->dma_chan[i];
+        }
+    }
+    if (mask) {
+        dma_hw->abort = mask;
+        while (dma_hw->abort & mask) {
+        }
+        dma_hw->ints0 = mask;
+    }
+    if (self->dma_chan[0] >= 0 && self->dma_chan[1] >= 0 && --machine_i2s_irq_users == 0) {
+        irq_remove_handler(DMA_IRQ_0, machine_i2s_dma_irq);
+    }
+    for (size_t i = 0; i < 2; ++i) {
+        if (self->dma_chan[i] >= 0) {
+            dma_channel_unclaim(self->dma_chan[i]);
+            self->dma_chan[i] = -1;
+        }
+    }
+    if (self->sm >= 0) {
+        pio_sm_clear_fifos(self->pio, self->sm);
+        pio_sm_unclaim(self->pio, self->sm);
+        pio_remove_program(self->pio, &self->prog, self->prog_offset);
+        self->sm = -1;
+    }
+}
+
+void machine_i2s_deinit_all(void) {
+    for (size_t i = 0; i < MP_ARRAY_SIZE(MP_STATE_PORT(machine_i2s_obj)); ++i) {
+        machine_i2s_port_obj_t *self = MP_STATE_PORT(machine_i2s_obj)[i];
+        if (self != NULL) {
+            machine_i2s_deinit(&self->i2s);
+            MP_STATE_PORT(machine_i2s_obj)[i] = NULL;
+        }
+    }
+}
+
+#endif // MICROPY_PY_MACHINE_I2S
@@ -325,6 +325,9 @@ STATIC const mp_rom_map_elem_t machine_uart_locals_dict_table[] = {
 
     { MP_ROM_QSTR(MP_QSTR_read), MP_ROM_PTR(&mp_stream_read_obj) },
     { MP_ROM_QSTR(MP_QSTR_readline), MP_ROM_PTR(&mp_stream_unbuffered_readline_obj) },
+#if MICROPY_STREAMS_READLINE_INTO
+    { MP_ROM_QSTR(MP_QSTR_readline_into), MP_ROM_PTR(&mp_stream_unbuffered_readline_into_obj) },
+#endif
     { MP_ROM_QSTR(MP_QSTR_readinto), MP_ROM_PTR(&mp_stream_readinto_obj) },
     { MP_ROM_QSTR(MP_QSTR_write), MP_ROM_PTR(&mp_stream_write_obj) },
 
@@ -342,7 +345,7 @@ STATIC mp_uint_t machine_uart_read(mp_obj_t self_in, void *buf_in, mp_uint_t siz
     uint64_t timeout_char_us = (uint64_t)self->timeout_char * 1000;
     uint8_t *dest = buf_in;
 
-    for (size_t i = 0; i < size; i++) {
+    for (size_t i = 0; i < size;) {
         // Wait for the first/next character
         while (ringbuf_avail(&self->read_buffer) == 0) {
             if (time_us_64() > t) {  // timed out
@@ -359,7 +362,8 @@ STATIC mp_uint_t machine_uart_read(mp_obj_t self_in, void *buf_in, mp_uint_t siz
             uart_drain_rx_fifo(self);
             self->read_lock = false;
         }
-        *dest++ = ringbuf_get(&(self->read_buffer));
+        // Take all that has arrived in one go
+        i += ringbuf_get_bytes(&self->read_buffer, dest + i, size - i);
         t = time_us_64() + timeout_char_us;
     }
     return size;
@@ -370,13 +374,9 @@ STATIC mp_uint_t machine_uart_write(mp_obj_t self_in, const void *buf_in, mp_uin
     uint64_t t = time_us_64() + (uint64_t)self->timeout * 1000;
     uint64_t timeout_char_us = (uint64_t)self->timeout_char * 1000;
     const uint8_t *src = buf_in;
-    size_t i = 0;
 
     // Put as many bytes as possible into the transmit buffer.
-    while (i < size && ringbuf_free(&(self->write_buffer)) > 0) {
-        ringbuf_put(&(self->write_buffer), *src++);
-        ++i;
-    }
+    size_t i = ringbuf_put_bytes(&self->write_buffer, src, size);
 
     // Kickstart the UART transmit.
     self->write_lock = true;
@@ -397,8 +397,7 @@ STATIC mp_uint_t machine_uart_write(mp_obj_t self_in, const void *buf_in, mp_uin
             }
             MICROPY_EVENT_POLL_HOOK
         }
-        ringbuf_put(&(self->write_buffer), *src++);
-        ++i;
+        i += ringbuf_put_bytes(&self->write_buffer, src + i, size - i);
         t = time_us_64() + timeout_char_us;
         self->write_lock = true;
         uart_fill_tx_fifo(self);
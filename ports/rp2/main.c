@@ -136,8 +136,12 @@ int main(int argc, char **argv) {
 
     soft_reset_exit:
         mp_printf(MP_PYTHON_PRINTER, "MPY: soft reboot\n");
+        #if MICROPY_PY_MACHINE_I2S
+        machine_i2s_deinit_all();
+        #endif
         rp2_pio_deinit();
         machine_pin_deinit();
+        machine_adc_deinit();
         #if MICROPY_PY_THREAD
         mp_thread_deinit();
         #endif
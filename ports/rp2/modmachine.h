@@ -14,5 +14,7 @@ extern const mp_obj_type_t machine_wdt_type;
 
 void machine_pin_init(void);
 void machine_pin_deinit(void);
+void machine_adc_deinit(void);
+void machine_i2s_deinit_all(void);
 
 #endif // MICROPY_INCLUDED_RP2_MODMACHINE_H
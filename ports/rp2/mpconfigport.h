@@ -38,6 +38,12 @@
 #define MICROPY_HW_ENABLE_UART_REPL             (0) // useful if there is no USB
 #define MICROPY_HW_ENABLE_USBDEV                (1)
 
+// Object representation (a board can select MICROPY_OBJ_REPR_C to store
+// floats without allocating them)
+#ifndef MICROPY_OBJ_REPR
+#define MICROPY_OBJ_REPR                        (MICROPY_OBJ_REPR_A)
+#endif
+
 // Memory allocation policies
 #define MICROPY_GC_STACK_ENTRY_TYPE             uint16_t
 #define MICROPY_ALLOC_PATH_MAX                  (128)
@@ -45,6 +51,7 @@
 
 // MicroPython emitters
 #define MICROPY_PERSISTENT_CODE_LOAD            (1)
+#define MICROPY_PERSISTENT_CODE_SAVE            (1)
 #define MICROPY_EMIT_THUMB                      (1)
 #define MICROPY_EMIT_THUMB_ARMV7M               (0)
 #define MICROPY_EMIT_INLINE_THUMB               (1)
@@ -54,18 +61,23 @@
 // Python internal features
 #define MICROPY_READER_VFS                      (1)
 #define MICROPY_ENABLE_GC                       (1)
+#define MICROPY_GC_PARALLEL_MARK                (1)
+#define MICROPY_GC_STATS                        (1)
 #define MICROPY_ENABLE_FINALISER                (1)
 #define MICROPY_STACK_CHECK                     (1)
 #define MICROPY_ENABLE_EMERGENCY_EXCEPTION_BUF  (1)
 #define MICROPY_KBD_EXCEPTION                   (1)
 #define MICROPY_HELPER_REPL                     (1)
 #define MICROPY_REPL_AUTO_INDENT                (1)
+#define MICROPY_REPL_FILE_TRANSFER              (1)
 #define MICROPY_LONGINT_IMPL                    (MICROPY_LONGINT_IMPL_MPZ)
 #define MICROPY_ENABLE_SOURCE_LINE              (1)
 #define MICROPY_FLOAT_IMPL                      (MICROPY_FLOAT_IMPL_FLOAT)
 #define MICROPY_STREAMS_NON_BLOCK               (1)
+#define MICROPY_STREAMS_READLINE_INTO           (1)
 #define MICROPY_MODULE_BUILTIN_INIT             (1)
 #define MICROPY_MODULE_WEAK_LINKS               (1)
+#define MICROPY_MODULE_MPY_CACHE                (1)
 #define MICROPY_CAN_OVERRIDE_BUILTINS           (1)
 #define MICROPY_ENABLE_SCHEDULER                (1)
 #define MICROPY_SCHEDULER_DEPTH                 (8)
@@ -99,6 +111,7 @@
 #define MICROPY_PY_MATH_FACTORIAL               (1)
 #define MICROPY_PY_MATH_ISCLOSE                 (1)
 #define MICROPY_PY_CMATH                        (1)
+#define MICROPY_PY_STRUCT_OBJECT                (1)
 #define MICROPY_PY_IO_IOBASE                    (1)
 #define MICROPY_PY_IO_FILEIO                    (1)
 #define MICROPY_PY_SYS_MAXSIZE                  (1)
@@ -108,13 +121,20 @@
 #define MICROPY_PY_UERRNO                       (1)
 #define MICROPY_PY_THREAD                       (1)
 #define MICROPY_PY_THREAD_GIL                   (0)
+#define MICROPY_PY_THREAD_CHANNEL               (1)
+#define MICROPY_PY_THREAD_QUEUE                 (1)
 
 // Extended modules
 #define MICROPY_EPOCH_IS_1970                   (1)
 #define MICROPY_PY_UASYNCIO                     (1)
 #define MICROPY_PY_UCTYPES                      (1)
+#define MICROPY_PY_UCTYPES_COMPILE              (1)
 #define MICROPY_PY_UZLIB                        (1)
+#define MICROPY_PY_UZLIB_COMPRESS               (1)
 #define MICROPY_PY_UJSON                        (1)
+#define MICROPY_PY_UJSON_OBJECT_HOOK            (1)
+#define MICROPY_PY_UJSON_ITERLOAD               (1)
+#define MICROPY_PY_UCBOR                        (1)
 #define MICROPY_PY_URE                          (1)
 #define MICROPY_PY_URE_MATCH_GROUPS             (1)
 #define MICROPY_PY_URE_MATCH_SPAN_START_END     (1)
@@ -122,6 +142,7 @@
 #define MICROPY_PY_UHASHLIB                     (1)
 #define MICROPY_PY_UBINASCII                    (1)
 #define MICROPY_PY_UBINASCII_CRC32              (1)
+#define MICROPY_PY_UBINASCII_CRC32_HW           (1)
 #define MICROPY_PY_UTIME_MP_HAL                 (1)
 #define MICROPY_PY_URANDOM                      (1)
 #define MICROPY_PY_URANDOM_EXTRA_FUNCS          (1)
@@ -130,14 +151,24 @@
 #define MICROPY_PY_MACHINE                      (1)
 #define MICROPY_PY_MACHINE_PIN_MAKE_NEW         mp_pin_make_new
 #define MICROPY_PY_MACHINE_PULSE                (1)
+#define MICROPY_PY_MACHINE_PINGROUP             (1)
 #define MICROPY_PY_MACHINE_I2C                  (1)
+#define MICROPY_PY_MACHINE_I2C_TRANSFER_BATCH   (1)
+#define MICROPY_PY_MACHINE_I2S                  (1)
 #define MICROPY_PY_MACHINE_SPI                  (1)
 #define MICROPY_PY_MACHINE_SPI_MSB              (SPI_MSB_FIRST)
 #define MICROPY_PY_MACHINE_SPI_LSB              (SPI_LSB_FIRST)
+#define MICROPY_PY_MACHINE_SDCARD_SPI           (1)
 #define MICROPY_PY_FRAMEBUF                     (1)
+#define MICROPY_PY_DISPLAY                      (1)
+#define MICROPY_PY_NRF24L01                     (1)
 #define MICROPY_VFS                             (1)
 #define MICROPY_VFS_LFS2                        (1)
 #define MICROPY_VFS_FAT                         (1)
+#define MICROPY_VFS_BLOCKDEV_CACHE              (1)
+#define MICROPY_VFS_MMAP                        (1)
+#define MICROPY_VFS_FAT_READAHEAD_BLOCKS        (8)
+#define MICROPY_VFS_IMPORT_STAT_CACHE           (1)
 
 // fatfs configuration
 #define MICROPY_FATFS_ENABLE_LFN                (1)
@@ -175,8 +206,13 @@ extern const struct _mp_obj_module_t mp_module_utime;
     void *machine_pin_irq_obj[30]; \
     void *rp2_pio_irq_obj[2]; \
     void *rp2_state_machine_irq_obj[8]; \
+    mp_obj_t rp2_state_machine_dma_buf[8][2]; \
+    mp_obj_t rp2_state_machine_dma_callback[8][2]; \
     void *rp2_uart_rx_buffer[2]; \
     void *rp2_uart_tx_buffer[2]; \
+    mp_obj_t machine_adc_timed_buf; \
+    mp_obj_t machine_adc_timed_callback; \
+    struct _machine_i2s_port_obj_t *machine_i2s_obj[2]; \
 
 #define MP_STATE_PORT MP_STATE_VM
 
@@ -30,6 +30,7 @@
 #include "lib/timeutils/timeutils.h"
 #include "tusb.h"
 #include "uart.h"
+#include "hardware/dma.h"
 #include "hardware/rtc.h"
 
 #if MICROPY_HW_ENABLE_UART_REPL
@@ -140,3 +141,48 @@ uint64_t mp_hal_time_ns(void) {
     uint64_t s = timeutils_seconds_since_epoch(t.year, t.month, t.day, t.hour, t.min, t.sec);
     return s * 1000000000ULL;
 }
+
+#if MICROPY_PY_UBINASCII_CRC32_HW
+
+#include "extmod/uzlib/tinf.h"
+
+// Below this length setting up the DMA costs more than it saves
+#define CRC32_DMA_MIN_LEN (64)
+
+STATIC uint32_t crc32_bitrev(uint32_t x) {
+    x = (x >> 16) | (x << 16);
+    x = ((x >> 8) & 0x00ff00ff) | ((x & 0x00ff00ff) << 8);
+    x = ((x >> 4) & 0x0f0f0f0f) | ((x & 0x0f0f0f0f) << 4);
+    x = ((x >> 2) & 0x33333333) | ((x & 0x33333333) << 2);
+    x = ((x >> 1) & 0x55555555) | ((x & 0x55555555) << 1);
+    return x;
+}
+
+// Compute the CRC by DMA'ing the buffer to a dummy location, with the DMA
+// sniffer calculating a CRC-32 of the bit-reversed data.  Reading the result
+// back bit-reversed and inverted gives the same value as zlib's crc32(), so
+// the sniffer is seeded with the inverse of that for a previous crc.
+uint32_t mp_hal_crc32(uint32_t crc, const void *buf, size_t len) {
+    int chan = len < CRC32_DMA_MIN_LEN ? -1 : dma_claim_unused_channel(false);
+    if (chan < 0) {
+        return uzlib_crc32(buf, len, crc ^ 0xffffffff) ^ 0xffffffff;
+    }
+
+    static uint8_t dummy;
+    dma_channel_config c = dma_channel_get_default_config(chan);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_sniff_enable(&c, true);
+    dma_sniffer_enable(chan, 0x1, true);
+    dma_hw->sniff_ctrl |= DMA_SNIFF_CTRL_OUT_REV_BITS | DMA_SNIFF_CTRL_OUT_INV_BITS;
+    dma_hw->sniff_data = crc32_bitrev(~crc);
+    dma_channel_configure(chan, &c, &dummy, buf, len, true);
+    dma_channel_wait_for_finish_blocking(chan);
+    crc = dma_hw->sniff_data;
+    dma_sniffer_disable();
+    dma_channel_unclaim(chan);
+    return crc;
+}
+
+#endif
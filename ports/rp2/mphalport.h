@@ -110,4 +110,22 @@ static inline void mp_hal_pin_od_high(mp_hal_pin_obj_t pin) {
     gpio_set_dir(pin, GPIO_IN);
 }
 
+// All pins are in a single SIO port.
+static inline uintptr_t mp_hal_pin_port(mp_hal_pin_obj_t pin) {
+    return 0;
+}
+
+static inline uint32_t mp_hal_pin_port_mask(mp_hal_pin_obj_t pin) {
+    return 1u << pin;
+}
+
+static inline void mp_hal_pin_port_write(uintptr_t port, uint32_t set_mask, uint32_t clr_mask) {
+    sio_hw->gpio_set = set_mask;
+    sio_hw->gpio_clr = clr_mask;
+}
+
+static inline uint32_t mp_hal_pin_port_read(uintptr_t port) {
+    return sio_hw->gpio_in;
+}
+
 #endif // MICROPY_INCLUDED_RP2_MPHALPORT_H
@@ -29,6 +29,7 @@
 #include "py/mpthread.h"
 #include "pico/stdlib.h"
 #include "pico/multicore.h"
+#include "hardware/sync.h"
 
 #if MICROPY_PY_THREAD
 
@@ -41,9 +42,19 @@ STATIC void *core1_arg = NULL;
 STATIC uint32_t *core1_stack = NULL;
 STATIC size_t core1_stack_num_words = 0;
 
+#if MICROPY_GC_PARALLEL_MARK
+STATIC spin_lock_t *gc_parallel_spinlock;
+STATIC uint32_t gc_parallel_helper_stack[256];
+#endif
+
 void mp_thread_init(void) {
     mp_thread_set_state(&mp_state_ctx.thread);
     core1_entry = NULL;
+    #if MICROPY_GC_PARALLEL_MARK
+    if (gc_parallel_spinlock == NULL) {
+        gc_parallel_spinlock = spin_lock_init(spin_lock_claim_unused(true));
+    }
+    #endif
 }
 
 void mp_thread_deinit(void) {
@@ -101,6 +112,32 @@ void mp_thread_create(void *(*entry)(void *), void *arg, size_t *stack_size) {
     *stack_size -= 512;
 }
 
+#if MICROPY_GC_PARALLEL_MARK
+STATIC void gc_parallel_helper_entry(void) {
+    gc_parallel_mark_helper();
+    // returning from here will loop the core forever (WFI)
+}
+
+bool gc_parallel_helper_start(void) {
+    // Only borrow core1 when it's idle, otherwise a thread on core1 could be
+    // modifying the heap (there is no GIL), or the GC is running on core1.
+    if (core1_entry != NULL) {
+        return false;
+    }
+    multicore_reset_core1();
+    multicore_launch_core1_with_stack(gc_parallel_helper_entry, gc_parallel_helper_stack, sizeof(gc_parallel_helper_stack));
+    return true;
+}
+
+void gc_parallel_lock(void) {
+    spin_lock_unsafe_blocking(gc_parallel_spinlock);
+}
+
+void gc_parallel_unlock(void) {
+    spin_unlock_unsafe(gc_parallel_spinlock);
+}
+#endif
+
 void mp_thread_start(void) {
 }
 
@@ -76,36 +76,96 @@ STATIC mp_obj_t rp2_flash_make_new(const mp_obj_type_t *type, size_t n_args, siz
     return MP_OBJ_FROM_PTR(&rp2_flash_obj);
 }
 
+// Nothing may execute from flash while it is erased or programmed, so these
+// operations are done with interrupts disabled.  They are split into single
+// sectors (for erase) and pages (for program), with interrupts enabled again
+// between each, so a large write delays interrupt handlers (eg ones feeding
+// PIO state machines) by at most the time taken by one of these pieces.
+STATIC void rp2_flash_erase(uint32_t addr, size_t len) {
+    for (size_t i = 0; i < len; i += FLASH_SECTOR_SIZE) {
+        uint32_t atomic_state = MICROPY_BEGIN_ATOMIC_SECTION();
+        flash_range_erase(addr + i, FLASH_SECTOR_SIZE);
+        MICROPY_END_ATOMIC_SECTION(atomic_state);
+    }
+}
+
+STATIC void rp2_flash_program(uint32_t addr, const uint8_t *buf, size_t len) {
+    // Data which is itself in flash (eg a frozen bytes object) can't be read
+    // while programming, so it is copied to RAM a page at a time.
+    uint8_t page[FLASH_PAGE_SIZE];
+    bool buf_in_flash = (uintptr_t)buf >= XIP_BASE && (uintptr_t)buf < SRAM_BASE;
+    for (size_t i = 0; i < len; i += FLASH_PAGE_SIZE) {
+        size_t n = MIN(FLASH_PAGE_SIZE, len - i);
+        const uint8_t *src = buf + i;
+        if (buf_in_flash) {
+            memcpy(page, src, n);
+            src = page;
+        }
+        uint32_t atomic_state = MICROPY_BEGIN_ATOMIC_SECTION();
+        flash_range_program(addr + i, src, n);
+        MICROPY_END_ATOMIC_SECTION(atomic_state);
+    }
+}
+
+STATIC int rp2_flash_bdev_readblocks(mp_obj_t self_in, uint32_t block_num, uint32_t block_off, uint8_t *buf, size_t len, bool ext) {
+    rp2_flash_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    (void)ext;
+    uint32_t offset = block_num * BLOCK_SIZE_BYTES + block_off;
+    memcpy(buf, (void *)(XIP_BASE + self->flash_base + offset), len);
+    return 0;
+}
+
+STATIC int rp2_flash_bdev_writeblocks(mp_obj_t self_in, uint32_t block_num, uint32_t block_off, const uint8_t *buf, size_t len, bool ext) {
+    rp2_flash_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    uint32_t offset = block_num * BLOCK_SIZE_BYTES + block_off;
+    if (!ext) {
+        rp2_flash_erase(self->flash_base + offset, len);
+    }
+    rp2_flash_program(self->flash_base + offset, buf, len);
+    return 0;
+}
+
 STATIC mp_obj_t rp2_flash_readblocks(size_t n_args, const mp_obj_t *args) {
-    rp2_flash_obj_t *self = MP_OBJ_TO_PTR(args[0]);
-    uint32_t offset = mp_obj_get_int(args[1]) * BLOCK_SIZE_BYTES;
     mp_buffer_info_t bufinfo;
     mp_get_buffer_raise(args[2], &bufinfo, MP_BUFFER_WRITE);
-    if (n_args == 4) {
-        offset += mp_obj_get_int(args[3]);
-    }
-    memcpy(bufinfo.buf, (void *)(XIP_BASE + self->flash_base + offset), bufinfo.len);
+    uint32_t block_off = n_args == 4 ? mp_obj_get_int(args[3]) : 0;
+    rp2_flash_bdev_readblocks(args[0], mp_obj_get_int(args[1]), block_off, bufinfo.buf, bufinfo.len, n_args == 4);
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(rp2_flash_readblocks_obj, 3, 4, rp2_flash_readblocks);
 
 STATIC mp_obj_t rp2_flash_writeblocks(size_t n_args, const mp_obj_t *args) {
-    rp2_flash_obj_t *self = MP_OBJ_TO_PTR(args[0]);
-    uint32_t offset = mp_obj_get_int(args[1]) * BLOCK_SIZE_BYTES;
     mp_buffer_info_t bufinfo;
     mp_get_buffer_raise(args[2], &bufinfo, MP_BUFFER_READ);
-    if (n_args == 3) {
-        flash_range_erase(self->flash_base + offset, bufinfo.len);
-        // TODO check return value
-    } else {
-        offset += mp_obj_get_int(args[3]);
-    }
-    flash_range_program(self->flash_base + offset, bufinfo.buf, bufinfo.len);
-    // TODO check return value
+    uint32_t block_off = n_args == 4 ? mp_obj_get_int(args[3]) : 0;
+    rp2_flash_bdev_writeblocks(args[0], mp_obj_get_int(args[1]), block_off, bufinfo.buf, bufinfo.len, n_args == 4);
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(rp2_flash_writeblocks_obj, 3, 4, rp2_flash_writeblocks);
 
+#if MICROPY_VFS_MMAP
+STATIC const uint8_t *rp2_flash_bdev_mmap(mp_obj_t self_in, uint32_t block_num, uint32_t *num_blocks) {
+    rp2_flash_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    uint32_t n = self->flash_size / BLOCK_SIZE_BYTES;
+    if (block_num >= n) {
+        return NULL;
+    }
+    // Flash programming and erasing flush the XIP cache, so reads through XIP are coherent
+    *num_blocks = n - block_num;
+    return (const uint8_t *)(XIP_BASE + self->flash_base + block_num * BLOCK_SIZE_BYTES);
+}
+#endif
+
+STATIC const mp_block_dev_p_t rp2_flash_block_dev_p = {
+    .readblocks_obj = &rp2_flash_readblocks_obj,
+    .writeblocks_obj = &rp2_flash_writeblocks_obj,
+    .readblocks = rp2_flash_bdev_readblocks,
+    .writeblocks = rp2_flash_bdev_writeblocks,
+    #if MICROPY_VFS_MMAP
+    .mmap = rp2_flash_bdev_mmap,
+    #endif
+};
+
 STATIC mp_obj_t rp2_flash_ioctl(mp_obj_t self_in, mp_obj_t cmd_in, mp_obj_t arg_in) {
     rp2_flash_obj_t *self = MP_OBJ_TO_PTR(self_in);
     mp_int_t cmd = mp_obj_get_int(cmd_in);
@@ -122,8 +182,7 @@ STATIC mp_obj_t rp2_flash_ioctl(mp_obj_t self_in, mp_obj_t cmd_in, mp_obj_t arg_
             return MP_OBJ_NEW_SMALL_INT(BLOCK_SIZE_BYTES);
         case MP_BLOCKDEV_IOCTL_BLOCK_ERASE: {
             uint32_t offset = mp_obj_get_int(arg_in) * BLOCK_SIZE_BYTES;
-            flash_range_erase(self->flash_base + offset, BLOCK_SIZE_BYTES);
-            // TODO check return value
+            rp2_flash_erase(self->flash_base + offset, BLOCK_SIZE_BYTES);
             return MP_OBJ_NEW_SMALL_INT(0);
         }
         default:
@@ -143,5 +202,6 @@ const mp_obj_type_t rp2_flash_type = {
     { &mp_type_type },
     .name = MP_QSTR_Flash,
     .make_new = rp2_flash_make_new,
+    .protocol = &rp2_flash_block_dev_p,
     .locals_dict = (mp_obj_dict_t *)&rp2_flash_locals_dict,
 };
@@ -30,10 +30,12 @@
 #include "py/runtime.h"
 #include "py/mperrno.h"
 #include "py/mphal.h"
+#include "py/stream.h"
 #include "lib/utils/mpirq.h"
 #include "modrp2.h"
 
 #include "hardware/clocks.h"
+#include "hardware/dma.h"
 #include "hardware/irq.h"
 #include "hardware/pio.h"
 
@@ -65,8 +67,22 @@ typedef struct _rp2_state_machine_irq_obj_t {
     uint8_t trigger;
 } rp2_state_machine_irq_obj_t;
 
+// DMA transfers to the TX FIFO (index 0) and from the RX FIFO (index 1) of a
+// StateMachine.  In loop mode a control channel, triggered when the data
+// channel completes, writes the buffer address back to the data channel to
+// restart it, so the buffer is streamed continuously without the CPU.
+#define RP2_SM_DMA_TX (0)
+#define RP2_SM_DMA_RX (1)
+
+typedef struct _rp2_state_machine_dma_t {
+    int8_t data_chan[2];
+    int8_t ctrl_chan[2];
+    uint32_t addr[2];
+} rp2_state_machine_dma_t;
+
 STATIC const rp2_state_machine_obj_t rp2_state_machine_obj[8];
 STATIC uint8_t rp2_state_machine_initial_pc[8];
+STATIC rp2_state_machine_dma_t rp2_state_machine_dma[8];
 
 STATIC mp_obj_t rp2_state_machine_init_helper(const rp2_state_machine_obj_t *self, size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args);
 
@@ -101,6 +117,52 @@ STATIC void pio1_irq0(void) {
     pio_irq0(pio1);
 }
 
+// Schedule the callback of each StateMachine DMA transfer that completed.
+STATIC void rp2_state_machine_dma_irq(void) {
+    for (size_t id = 0; id < 8; ++id) {
+        for (size_t dir = 0; dir < 2; ++dir) {
+            int chan = rp2_state_machine_dma[id].data_chan[dir];
+            if (chan >= 0 && (dma_hw->ints0 & (1u << chan))) {
+                dma_hw->ints0 = 1u << chan;
+                mp_obj_t callback = MP_STATE_PORT(rp2_state_machine_dma_callback)[id][dir];
+                if (callback != MP_OBJ_NULL && callback != mp_const_none) {
+                    mp_sched_schedule(callback, MP_OBJ_FROM_PTR(&rp2_state_machine_obj[id]));
+                }
+            }
+        }
+    }
+}
+
+STATIC void rp2_state_machine_dma_stop(size_t id, size_t dir) {
+    rp2_state_machine_dma_t *dma = &rp2_state_machine_dma[id];
+    if (dma->data_chan[dir] < 0) {
+        return;
+    }
+    uint32_t mask = 1u << dma->data_chan[dir];
+    if (dma->ctrl_chan[dir] >= 0) {
+        mask |= 1u << dma->ctrl_chan[dir];
+    }
+    dma_channel_set_irq0_enabled(dma->data_chan[dir], false);
+    dma_hw->abort = mask;
+    while (dma_hw->abort & mask) {
+    }
+    dma_hw->ints0 = mask;
+    dma_channel_unclaim(dma->data_chan[dir]);
+    if (dma->ctrl_chan[dir] >= 0) {
+        dma_channel_unclaim(dma->ctrl_chan[dir]);
+    }
+    dma->data_chan[dir] = -1;
+    dma->ctrl_chan[dir] = -1;
+    MP_STATE_PORT(rp2_state_machine_dma_buf)[id][dir] = MP_OBJ_NULL;
+    MP_STATE_PORT(rp2_state_machine_dma_callback)[id][dir] = MP_OBJ_NULL;
+}
+
+STATIC bool rp2_state_machine_dma_busy(size_t id, size_t dir) {
+    rp2_state_machine_dma_t *dma = &rp2_state_machine_dma[id];
+    // A looping transfer only stops when explicitly stopped.
+    return dma->data_chan[dir] >= 0 && (dma->ctrl_chan[dir] >= 0 || dma_channel_is_busy(dma->data_chan[dir]));
+}
+
 void rp2_pio_init(void) {
     // Reset all PIO instruction memory.
     pio_clear_instruction_memory(pio0);
@@ -111,6 +173,14 @@ void rp2_pio_init(void) {
     memset(MP_STATE_PORT(rp2_state_machine_irq_obj), 0, sizeof(MP_STATE_PORT(rp2_state_machine_irq_obj)));
     irq_set_exclusive_handler(PIO0_IRQ_0, pio0_irq0);
     irq_set_exclusive_handler(PIO1_IRQ_0, pio1_irq0);
+
+    // Set up DMA completion interrupts for StateMachine FIFOs.
+    memset(rp2_state_machine_dma, -1, sizeof(rp2_state_machine_dma));
+    memset(MP_STATE_PORT(rp2_state_machine_dma_buf), 0, sizeof(MP_STATE_PORT(rp2_state_machine_dma_buf)));
+    memset(MP_STATE_PORT(rp2_state_machine_dma_callback), 0, sizeof(MP_STATE_PORT(rp2_state_machine_dma_callback)));
+    // The handler is shared with machine.I2S.
+    irq_add_shared_handler(DMA_IRQ_0, rp2_state_machine_dma_irq, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(DMA_IRQ_0, true);
 }
 
 void rp2_pio_deinit(void) {
@@ -118,6 +188,14 @@ void rp2_pio_deinit(void) {
     irq_set_mask_enabled((1u << PIO0_IRQ_0) | (1u << PIO0_IRQ_1), false);
     irq_remove_handler(PIO0_IRQ_0, pio0_irq0);
     irq_remove_handler(PIO1_IRQ_0, pio1_irq0);
+
+    // Stop all StateMachine DMA transfers.
+    for (size_t id = 0; id < 8; ++id) {
+        rp2_state_machine_dma_stop(id, RP2_SM_DMA_TX);
+        rp2_state_machine_dma_stop(id, RP2_SM_DMA_RX);
+    }
+    irq_set_enabled(DMA_IRQ_0, false);
+    irq_remove_handler(DMA_IRQ_0, rp2_state_machine_dma_irq);
 }
 
 /******************************************************************************/
@@ -715,6 +793,128 @@ STATIC mp_obj_t rp2_state_machine_put(size_t n_args, const mp_obj_t *args) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(rp2_state_machine_put_obj, 2, 3, rp2_state_machine_put);
 
+STATIC void rp2_state_machine_dma_start(const rp2_state_machine_obj_t *self, size_t dir, mp_obj_t buf_in, bool loop, mp_obj_t callback) {
+    bool is_tx = dir == RP2_SM_DMA_TX;
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, is_tx ? MP_BUFFER_READ : MP_BUFFER_WRITE);
+
+    // The buffer's element size gives the size of each FIFO transfer.
+    size_t elem_size;
+    enum dma_channel_transfer_size transfer_size;
+    switch (bufinfo.typecode == BYTEARRAY_TYPECODE ? 'b' : bufinfo.typecode | 0x20) {
+        case 'b':
+            elem_size = 1;
+            transfer_size = DMA_SIZE_8;
+            break;
+        case 'h':
+            elem_size = 2;
+            transfer_size = DMA_SIZE_16;
+            break;
+        case 'i':
+        case 'l':
+            elem_size = 4;
+            transfer_size = DMA_SIZE_32;
+            break;
+        default:
+            mp_raise_ValueError("unsupported buffer type");
+    }
+    if (bufinfo.len < elem_size || ((uintptr_t)bufinfo.buf & (elem_size - 1))) {
+        mp_raise_ValueError("invalid buffer");
+    }
+
+    rp2_state_machine_dma_stop(self->id, dir);
+
+    rp2_state_machine_dma_t *dma = &rp2_state_machine_dma[self->id];
+    int data_chan = dma_claim_unused_channel(false);
+    int ctrl_chan = loop ? dma_claim_unused_channel(false) : -1;
+    if (data_chan < 0 || (loop && ctrl_chan < 0)) {
+        if (data_chan >= 0) {
+            dma_channel_unclaim(data_chan);
+        }
+        if (ctrl_chan >= 0) {
+            dma_channel_unclaim(ctrl_chan);
+        }
+        mp_raise_OSError(MP_EBUSY);
+    }
+    dma->data_chan[dir] = data_chan;
+    dma->ctrl_chan[dir] = ctrl_chan;
+    dma->addr[dir] = (uint32_t)bufinfo.buf;
+    MP_STATE_PORT(rp2_state_machine_dma_buf)[self->id][dir] = buf_in;
+    MP_STATE_PORT(rp2_state_machine_dma_callback)[self->id][dir] = callback;
+
+    dma_channel_config c = dma_channel_get_default_config(data_chan);
+    channel_config_set_transfer_data_size(&c, transfer_size);
+    channel_config_set_read_increment(&c, is_tx);
+    channel_config_set_write_increment(&c, !is_tx);
+    channel_config_set_dreq(&c, pio_get_dreq(self->pio, self->sm, is_tx));
+    if (loop) {
+        channel_config_set_chain_to(&c, ctrl_chan);
+    }
+    if (is_tx) {
+        dma_channel_configure(data_chan, &c, &self->pio->txf[self->sm], bufinfo.buf, bufinfo.len / elem_size, false);
+    } else {
+        dma_channel_configure(data_chan, &c, bufinfo.buf, &self->pio->rxf[self->sm], bufinfo.len / elem_size, false);
+    }
+
+    if (loop) {
+        // Writing to the address register's trigger alias restarts the data channel.
+        c = dma_channel_get_default_config(ctrl_chan);
+        channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+        channel_config_set_read_increment(&c, false);
+        channel_config_set_write_increment(&c, false);
+        dma_channel_configure(ctrl_chan, &c,
+            is_tx ? &dma_hw->ch[data_chan].al3_read_addr_trig : &dma_hw->ch[data_chan].al2_write_addr_trig,
+            &dma->addr[dir], 1, false);
+    }
+
+    dma_hw->ints0 = 1u << data_chan;
+    dma_channel_set_irq0_enabled(data_chan, true);
+    dma_channel_start(data_chan);
+}
+
+STATIC mp_obj_t rp2_state_machine_dma_helper(size_t dir, size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_buf, ARG_loop, ARG_callback };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_buf, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_loop, MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = false} },
+        { MP_QSTR_callback, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = mp_const_none} },
+    };
+    rp2_state_machine_obj_t *self = MP_OBJ_TO_PTR(pos_args[0]);
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+    rp2_state_machine_dma_start(self, dir, args[ARG_buf].u_obj, args[ARG_loop].u_bool, args[ARG_callback].u_obj);
+    return mp_const_none;
+}
+
+// StateMachine.put_dma(buf, *, loop=False, callback=None)
+STATIC mp_obj_t rp2_state_machine_put_dma(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    return rp2_state_machine_dma_helper(RP2_SM_DMA_TX, n_args, pos_args, kw_args);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(rp2_state_machine_put_dma_obj, 2, rp2_state_machine_put_dma);
+
+// StateMachine.get_dma(buf, *, loop=False, callback=None)
+STATIC mp_obj_t rp2_state_machine_get_dma(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    return rp2_state_machine_dma_helper(RP2_SM_DMA_RX, n_args, pos_args, kw_args);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(rp2_state_machine_get_dma_obj, 2, rp2_state_machine_get_dma);
+
+// StateMachine.dma_active()
+STATIC mp_obj_t rp2_state_machine_dma_active(mp_obj_t self_in) {
+    rp2_state_machine_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    return mp_obj_new_bool(rp2_state_machine_dma_busy(self->id, RP2_SM_DMA_TX)
+        || rp2_state_machine_dma_busy(self->id, RP2_SM_DMA_RX));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(rp2_state_machine_dma_active_obj, rp2_state_machine_dma_active);
+
+// StateMachine.dma_stop()
+STATIC mp_obj_t rp2_state_machine_dma_stop_all(mp_obj_t self_in) {
+    rp2_state_machine_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    rp2_state_machine_dma_stop(self->id, RP2_SM_DMA_TX);
+    rp2_state_machine_dma_stop(self->id, RP2_SM_DMA_RX);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(rp2_state_machine_dma_stop_obj, rp2_state_machine_dma_stop_all);
+
 // StateMachine.rx_fifo()
 STATIC mp_obj_t rp2_state_machine_rx_fifo(mp_obj_t self_in) {
     rp2_state_machine_obj_t *self = MP_OBJ_TO_PTR(self_in);
@@ -792,17 +992,45 @@ STATIC const mp_rom_map_elem_t rp2_state_machine_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_exec), MP_ROM_PTR(&rp2_state_machine_exec_obj) },
     { MP_ROM_QSTR(MP_QSTR_get), MP_ROM_PTR(&rp2_state_machine_get_obj) },
     { MP_ROM_QSTR(MP_QSTR_put), MP_ROM_PTR(&rp2_state_machine_put_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get_dma), MP_ROM_PTR(&rp2_state_machine_get_dma_obj) },
+    { MP_ROM_QSTR(MP_QSTR_put_dma), MP_ROM_PTR(&rp2_state_machine_put_dma_obj) },
+    { MP_ROM_QSTR(MP_QSTR_dma_active), MP_ROM_PTR(&rp2_state_machine_dma_active_obj) },
+    { MP_ROM_QSTR(MP_QSTR_dma_stop), MP_ROM_PTR(&rp2_state_machine_dma_stop_obj) },
     { MP_ROM_QSTR(MP_QSTR_rx_fifo), MP_ROM_PTR(&rp2_state_machine_rx_fifo_obj) },
     { MP_ROM_QSTR(MP_QSTR_tx_fifo), MP_ROM_PTR(&rp2_state_machine_tx_fifo_obj) },
     { MP_ROM_QSTR(MP_QSTR_irq), MP_ROM_PTR(&rp2_state_machine_irq_obj) },
 };
 STATIC MP_DEFINE_CONST_DICT(rp2_state_machine_locals_dict, rp2_state_machine_locals_dict_table);
 
+// Polling gives readable when get_dma has finished filling its buffer, and
+// writable when put_dma has finished sending its buffer (or if none is running).
+STATIC mp_uint_t rp2_state_machine_ioctl(mp_obj_t self_in, mp_uint_t request, uintptr_t arg, int *errcode) {
+    rp2_state_machine_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (request == MP_STREAM_POLL) {
+        uintptr_t flags = arg;
+        mp_uint_t ret = 0;
+        if ((flags & MP_STREAM_POLL_RD) && !rp2_state_machine_dma_busy(self->id, RP2_SM_DMA_RX)) {
+            ret |= MP_STREAM_POLL_RD;
+        }
+        if ((flags & MP_STREAM_POLL_WR) && !rp2_state_machine_dma_busy(self->id, RP2_SM_DMA_TX)) {
+            ret |= MP_STREAM_POLL_WR;
+        }
+        return ret;
+    }
+    *errcode = MP_EINVAL;
+    return MP_STREAM_ERROR;
+}
+
+STATIC const mp_stream_p_t rp2_state_machine_stream_p = {
+    .ioctl = rp2_state_machine_ioctl,
+};
+
 const mp_obj_type_t rp2_state_machine_type = {
     { &mp_type_type },
     .name = MP_QSTR_StateMachine,
     .print = rp2_state_machine_print,
     .make_new = rp2_state_machine_make_new,
+    .protocol = &rp2_state_machine_stream_p,
     .locals_dict = (mp_obj_dict_t *)&rp2_state_machine_locals_dict,
 };
 
@@ -8,5 +8,6 @@ TEXT1_ADDR = 0x08020000
 
 # MicroPython settings
 MICROPY_PY_LWIP = 1
+MICROPY_PY_LWIP_WND_SCALE = 1
 MICROPY_PY_USSL = 1
 MICROPY_SSL_MBEDTLS = 1
@@ -19,5 +19,6 @@ endif
 
 # MicroPython settings
 MICROPY_PY_LWIP = 1
+MICROPY_PY_LWIP_WND_SCALE = 1
 MICROPY_PY_USSL = 1
 MICROPY_SSL_MBEDTLS = 1
@@ -6,6 +6,7 @@
 #define MICROPY_HW_ENABLE_RNG       (1)
 #define MICROPY_HW_ENABLE_RTC       (1)
 #define MICROPY_HW_ENABLE_USB       (1)
+#define MICROPY_HW_ENABLE_DMA2D     (1)
 
 // HSE is 8MHz
 #define MICROPY_HW_CLK_PLLM (8)
@@ -81,6 +82,7 @@
 #define MICROPY_HW_SDRAM_STARTUP_TEST             (1)
 #define MICROPY_HEAP_START  ((sdram_valid) ? sdram_start() : &_heap_start)
 #define MICROPY_HEAP_END    ((sdram_valid) ? sdram_end() : &_heap_end)
+#define MICROPY_GC_SPLIT_HEAP (1)
 
 // Timing configuration for 90 Mhz (11.90ns) of SD clock frequency (180Mhz/2)
 #define MICROPY_HW_SDRAM_TIMING_TMRD        (2)
@@ -98,6 +98,7 @@ void STM32F7DISC_board_early_init(void);
 #define MICROPY_HW_SDRAM_STARTUP_TEST             (1)
 #define MICROPY_HEAP_START              sdram_start()
 #define MICROPY_HEAP_END                sdram_end()
+#define MICROPY_GC_SPLIT_HEAP           (1)
 
 // Timing configuration for 90 Mhz (11.90ns) of SD clock frequency (180Mhz/2)
 #define MICROPY_HW_SDRAM_TIMING_TMRD        (2)
@@ -44,6 +44,8 @@
 #define CAN_HandleTypeDef           FDCAN_HandleTypeDef
 #define CanTxMsgTypeDef             FDCAN_TxHeaderTypeDef
 #define CanRxMsgTypeDef             FDCAN_RxHeaderTypeDef
+
+#define CAN_FD_MAX_DATA             (64)
 #endif
 
 enum {
@@ -68,6 +70,7 @@ typedef struct _pyb_can_obj_t {
     mp_uint_t can_id : 8;
     bool is_enabled : 1;
     bool extframe : 1;
+    bool fd : 1; // FDCAN only: send and receive CAN FD frames of up to 64 bytes
     byte rx_state0;
     byte rx_state1;
     uint16_t num_error_warning;
@@ -86,6 +89,10 @@ void can_deinit(pyb_can_obj_t *self);
 void can_clearfilter(pyb_can_obj_t *self, uint32_t f, uint8_t bank);
 int can_receive(CAN_HandleTypeDef *can, int fifo, CanRxMsgTypeDef *msg, uint8_t *data, uint32_t timeout_ms);
 HAL_StatusTypeDef CAN_Transmit(CAN_HandleTypeDef *hcan, uint32_t Timeout);
+#if MICROPY_HW_ENABLE_FDCAN
+size_t can_dlc_to_len(uint32_t dlc);
+uint32_t can_len_to_dlc(size_t len);
+#endif
 void pyb_can_handle_callback(pyb_can_obj_t *self, uint fifo_id, mp_obj_t callback, mp_obj_t irq_reason);
 
 #endif // MICROPY_HW_ENABLE_CAN
@@ -103,6 +103,25 @@ static const DMA_InitTypeDef dma_init_struct_spi_i2c = {
     #endif
 };
 
+#if MICROPY_PY_MACHINE_I2S && (defined(STM32F4) || defined(STM32F7))
+// Parameters to dma_init() for I2S, which runs a circular transfer of 16-bit
+// words for as long as it is active
+static const DMA_InitTypeDef dma_init_struct_i2s = {
+    .Channel = 0,
+    .Direction = 0,
+    .PeriphInc = DMA_PINC_DISABLE,
+    .MemInc = DMA_MINC_ENABLE,
+    .PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD,
+    .MemDataAlignment = DMA_MDATAALIGN_HALFWORD,
+    .Mode = DMA_CIRCULAR,
+    .Priority = DMA_PRIORITY_HIGH,
+    .FIFOMode = DMA_FIFOMODE_DISABLE,
+    .FIFOThreshold = DMA_FIFO_THRESHOLD_FULL,
+    .MemBurst = DMA_MBURST_SINGLE,
+    .PeriphBurst = DMA_PBURST_SINGLE
+};
+#endif
+
 #if ENABLE_SDIO && !defined(STM32H7)
 // Parameters to dma_init() for SDIO tx and rx.
 static const DMA_InitTypeDef dma_init_struct_sdio = {
@@ -131,6 +150,25 @@ static const DMA_InitTypeDef dma_init_struct_sdio = {
 };
 #endif
 
+#if defined(MICROPY_HW_QSPIFLASH_SIZE_BITS_LOG2) && MICROPY_HW_QSPI_USE_DMA
+// Parameters to dma_nohal_init() for QSPI rx, which reads whole words from
+// the QSPI FIFO in direct mode
+static const DMA_InitTypeDef dma_init_struct_qspi = {
+    .Channel = 0,
+    .Direction = 0,
+    .PeriphInc = DMA_PINC_DISABLE,
+    .MemInc = DMA_MINC_ENABLE,
+    .PeriphDataAlignment = DMA_PDATAALIGN_WORD,
+    .MemDataAlignment = DMA_MDATAALIGN_WORD,
+    .Mode = DMA_NORMAL,
+    .Priority = DMA_PRIORITY_HIGH,
+    .FIFOMode = DMA_FIFOMODE_DISABLE,
+    .FIFOThreshold = DMA_FIFO_THRESHOLD_FULL,
+    .MemBurst = DMA_MBURST_SINGLE,
+    .PeriphBurst = DMA_PBURST_SINGLE,
+};
+#endif
+
 #if defined(MICROPY_HW_ENABLE_DAC) && MICROPY_HW_ENABLE_DAC
 // Default parameters to dma_init() for DAC tx
 static const DMA_InitTypeDef dma_init_struct_dac = {
@@ -253,6 +291,13 @@ const dma_descr_t dma_DAC_2_TX = { DMA1_Stream6, DMA_CHANNEL_7, dma_id_6,   &dma
 const dma_descr_t dma_SPI_3_TX = { DMA1_Stream7, DMA_CHANNEL_0, dma_id_7,   &dma_init_struct_spi_i2c };
 const dma_descr_t dma_I2C_1_TX = { DMA1_Stream7, DMA_CHANNEL_1, dma_id_7,   &dma_init_struct_spi_i2c };
 const dma_descr_t dma_I2C_2_TX = { DMA1_Stream7, DMA_CHANNEL_7, dma_id_7,   &dma_init_struct_spi_i2c };
+#if MICROPY_PY_MACHINE_I2S
+// I2S uses the streams of its SPI peripheral, and keeps them while active.
+const dma_descr_t dma_I2S_3_RX = { DMA1_Stream2, DMA_CHANNEL_0, dma_id_2,   &dma_init_struct_i2s };
+const dma_descr_t dma_I2S_2_RX = { DMA1_Stream3, DMA_CHANNEL_0, dma_id_3,   &dma_init_struct_i2s };
+const dma_descr_t dma_I2S_2_TX = { DMA1_Stream4, DMA_CHANNEL_0, dma_id_4,   &dma_init_struct_i2s };
+const dma_descr_t dma_I2S_3_TX = { DMA1_Stream7, DMA_CHANNEL_0, dma_id_7,   &dma_init_struct_i2s };
+#endif
 /* not preferred streams
 const dma_descr_t dma_SPI_3_RX = { DMA1_Stream0, DMA_CHANNEL_0, dma_id_0,   &dma_init_struct_spi_i2c };
 const dma_descr_t dma_I2C_1_TX = { DMA1_Stream6, DMA_CHANNEL_1, dma_id_6,   &dma_init_struct_spi_i2c };
@@ -282,6 +327,9 @@ const dma_descr_t dma_SPI_6_RX = { DMA2_Stream6, DMA_CHANNEL_1, dma_id_14,  &dma
 // #if ENABLE_SDIO
 // const dma_descr_t dma_SDIO_0 = { DMA2_Stream6, DMA_CHANNEL_4, dma_id_14,  &dma_init_struct_sdio };
 // #endif
+#if defined(MICROPY_HW_QSPIFLASH_SIZE_BITS_LOG2) && MICROPY_HW_QSPI_USE_DMA
+const dma_descr_t dma_QUADSPI = { DMA2_Stream7, DMA_CHANNEL_3, dma_id_15,  &dma_init_struct_qspi };
+#endif
 /* not preferred streams
 const dma_descr_t dma_SPI_1_TX = { DMA2_Stream3, DMA_CHANNEL_3, dma_id_11,  &dma_init_struct_spi_i2c };
 const dma_descr_t dma_SPI_1_RX = { DMA2_Stream0, DMA_CHANNEL_3, dma_id_8,   &dma_init_struct_spi_i2c };
@@ -1004,6 +1052,85 @@ void dma_invalidate_channel(const dma_descr_t *dma_descr) {
     }
 }
 
+#if MICROPY_PY_STM_DMA
+
+// Descriptors for streams claimed at run time, which are then not handed out
+// again until released.  The user of such a stream sets up the rest of the
+// DMA_InitTypeDef itself after dma_init().
+static const DMA_InitTypeDef dma_init_struct_dynamic = {
+    .Channel = 0,
+    .Direction = 0,
+    .PeriphInc = DMA_PINC_DISABLE,
+    .MemInc = DMA_MINC_ENABLE,
+    .PeriphDataAlignment = DMA_PDATAALIGN_BYTE,
+    .MemDataAlignment = DMA_MDATAALIGN_BYTE,
+    .Mode = DMA_NORMAL,
+    .Priority = DMA_PRIORITY_LOW,
+    .FIFOMode = DMA_FIFOMODE_ENABLE,
+    .FIFOThreshold = DMA_FIFO_THRESHOLD_FULL,
+    .MemBurst = DMA_MBURST_SINGLE,
+    .PeriphBurst = DMA_PBURST_SINGLE
+};
+
+static dma_descr_t dma_dynamic_descr[NSTREAM];
+static uint32_t dma_dynamic_mask = 0;
+
+// Only DMA2 can do memory-to-memory transfers.  Its streams are tried in this
+// order, starting with those used by the fewest descriptors above.
+static const uint8_t dma_mem2mem_order[] = {
+    dma_id_8, dma_id_9, dma_id_15, dma_id_14, dma_id_10, dma_id_12, dma_id_13, dma_id_11,
+};
+
+// Claim stream dma_id (0-7 for DMA1, 8-15 for DMA2) with the given channel, or
+// if dma_id is negative a DMA2 stream for memory-to-memory transfers.  Returns
+// NULL if the stream is claimed, or is in use by a peripheral at the moment.
+const dma_descr_t *dma_claim_stream(int dma_id, uint32_t channel) {
+    mp_uint_t irq_state = MICROPY_BEGIN_ATOMIC_SECTION();
+    uint32_t busy = dma_enable_mask | dma_dynamic_mask;
+    if (dma_id < 0) {
+        for (size_t i = 0; i < MP_ARRAY_SIZE(dma_mem2mem_order); ++i) {
+            if (!(busy & (1 << dma_mem2mem_order[i]))) {
+                dma_id = dma_mem2mem_order[i];
+                break;
+            }
+        }
+    } else if (busy & (1 << dma_id)) {
+        dma_id = -1;
+    }
+    if (dma_id >= 0) {
+        dma_dynamic_mask |= 1 << dma_id;
+    }
+    MICROPY_END_ATOMIC_SECTION(irq_state);
+    if (dma_id < 0) {
+        return NULL;
+    }
+
+    dma_descr_t *descr = &dma_dynamic_descr[dma_id];
+    uint32_t base = dma_id < NSTREAMS_PER_CONTROLLER ? DMA1_Stream0_BASE : DMA2_Stream0_BASE;
+    descr->instance = (DMA_Stream_TypeDef *)(base + (DMA1_Stream1_BASE - DMA1_Stream0_BASE) * (dma_id % NSTREAMS_PER_CONTROLLER));
+    descr->sub_instance = channel << DMA_SxCR_CHSEL_Pos;
+    descr->id = dma_id;
+    descr->init = &dma_init_struct_dynamic;
+    return descr;
+}
+
+void dma_release_stream(const dma_descr_t *dma_descr) {
+    dma_invalidate_channel(dma_descr);
+    dma_dynamic_mask &= ~(1 << dma_descr->id);
+}
+
+int dma_descr_get_id(const dma_descr_t *dma_descr) {
+    return dma_descr->id;
+}
+
+// Whether the stream of a peripheral's descriptor is claimed, in which case
+// the peripheral must do its transfer without DMA.
+bool dma_stream_is_claimed(const dma_descr_t *dma_descr) {
+    return dma_descr != NULL && (dma_dynamic_mask & (1 << dma_descr->id));
+}
+
+#endif // MICROPY_PY_STM_DMA
+
 // Called from the SysTick handler
 // We use LSB of tick to select which controller to process
 static void dma_idle_handler(uint32_t tick) {
@@ -57,6 +57,11 @@ extern const dma_descr_t dma_SDMMC_2;
 extern const dma_descr_t dma_SPI_6_RX;
 extern const dma_descr_t dma_SDIO_0;
 extern const dma_descr_t dma_DCMI_0;
+extern const dma_descr_t dma_QUADSPI;
+extern const dma_descr_t dma_I2S_2_RX;
+extern const dma_descr_t dma_I2S_2_TX;
+extern const dma_descr_t dma_I2S_3_RX;
+extern const dma_descr_t dma_I2S_3_TX;
 
 #elif defined(STM32L0)
 
@@ -103,6 +108,15 @@ void dma_init_handle(DMA_HandleTypeDef *dma, const dma_descr_t *dma_descr, uint3
 void dma_deinit(const dma_descr_t *dma_descr);
 void dma_invalidate_channel(const dma_descr_t *dma_descr);
 
+#if MICROPY_PY_STM_DMA
+const dma_descr_t *dma_claim_stream(int dma_id, uint32_t channel);
+void dma_release_stream(const dma_descr_t *dma_descr);
+int dma_descr_get_id(const dma_descr_t *dma_descr);
+bool dma_stream_is_claimed(const dma_descr_t *dma_descr);
+#else
+#define dma_stream_is_claimed(dma_descr) (false)
+#endif
+
 void dma_nohal_init(const dma_descr_t *descr, uint32_t config);
 void dma_nohal_deinit(const dma_descr_t *descr);
 void dma_nohal_start(const dma_descr_t *descr, uint32_t src_addr, uint32_t dst_addr, uint16_t len);
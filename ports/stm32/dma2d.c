@@ -0,0 +1,128 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "py/mphal.h"
+#include "dma2d.h"
+
+#if MICROPY_HW_ENABLE_DMA2D
+
+// Below this many pixels the CPU is faster than setting up a transfer.
+#ifndef MICROPY_HW_DMA2D_MIN_PIXELS
+#define MICROPY_HW_DMA2D_MIN_PIXELS (256)
+#endif
+
+#define DMA2D_TIMEOUT_MS (100)
+
+// Colour modes, the same for the foreground (FGPFCCR) and output (OPFCCR).
+#define DMA2D_CM_RGB565 (2)
+#define DMA2D_CM_L8 (5)
+
+// Transfer modes for the CR register.
+#define DMA2D_MODE_M2M (0)
+#define DMA2D_MODE_R2M (3)
+
+STATIC bool dma2d_enabled;
+
+void dma2d_deinit(void) {
+    if (dma2d_enabled) {
+        // stop any transfer into a buffer that is about to be freed
+        if (DMA2D->CR & DMA2D_CR_START) {
+            DMA2D->CR |= DMA2D_CR_ABORT;
+        }
+        mp_hal_framebuf_wait();
+        __HAL_RCC_DMA2D_CLK_DISABLE();
+        dma2d_enabled = false;
+    }
+}
+
+void mp_hal_framebuf_wait(void) {
+    if (!dma2d_enabled) {
+        return;
+    }
+    uint32_t start = HAL_GetTick();
+    while (DMA2D->CR & DMA2D_CR_START) {
+        if (HAL_GetTick() - start >= DMA2D_TIMEOUT_MS) {
+            DMA2D->CR |= DMA2D_CR_ABORT;
+            start = HAL_GetTick();
+        }
+    }
+    DMA2D->IFCR = DMA2D->ISR;
+}
+
+// Check that a transfer fits the engine's limits, and wait for the previous
+// transfer to finish before the registers are reprogrammed.
+STATIC bool dma2d_prepare(unsigned int w, unsigned int h, unsigned int offset) {
+    if (w * h < MICROPY_HW_DMA2D_MIN_PIXELS
+        || w > (DMA2D_NLR_PL >> DMA2D_NLR_PL_Pos)
+        || h > (DMA2D_NLR_NL >> DMA2D_NLR_NL_Pos)
+        || offset > (DMA2D_OOR_LO >> DMA2D_OOR_LO_Pos)) {
+        return false;
+    }
+    if (!dma2d_enabled) {
+        __HAL_RCC_DMA2D_CLK_ENABLE();
+        dma2d_enabled = true;
+    }
+    mp_hal_framebuf_wait();
+    return true;
+}
+
+STATIC void dma2d_start(uint32_t mode, void *dest, unsigned int dest_offset, unsigned int w, unsigned int h) {
+    DMA2D->OMAR = (uint32_t)dest;
+    DMA2D->OOR = dest_offset;
+    DMA2D->NLR = w << DMA2D_NLR_PL_Pos | h << DMA2D_NLR_NL_Pos;
+    DMA2D->CR = mode << DMA2D_CR_MODE_Pos | DMA2D_CR_START;
+}
+
+bool mp_hal_framebuf_fill(void *dest, unsigned int stride, unsigned int w, unsigned int h, unsigned int bpp, uint32_t col) {
+    // register-to-memory transfers can't write 8-bit pixels
+    if (bpp != 16 || !dma2d_prepare(w, h, stride - w)) {
+        return false;
+    }
+    // make sure dirty cache lines aren't later written over the new pixels
+    MP_HAL_CLEANINVALIDATE_DCACHE(dest, ((h - 1) * stride + w) * 2);
+    DMA2D->OPFCCR = DMA2D_CM_RGB565;
+    DMA2D->OCOLR = col & 0xffff;
+    dma2d_start(DMA2D_MODE_R2M, dest, stride - w, w, h);
+    return true;
+}
+
+bool mp_hal_framebuf_copy(void *dest, unsigned int dest_stride, const void *src, unsigned int src_stride, unsigned int w, unsigned int h, unsigned int bpp) {
+    if (src_stride - w > (DMA2D_FGOR_LO >> DMA2D_FGOR_LO_Pos) || !dma2d_prepare(w, h, dest_stride - w)) {
+        return false;
+    }
+    // in memory-to-memory mode the pixel size comes from the foreground format
+    uint32_t cm = bpp == 16 ? DMA2D_CM_RGB565 : DMA2D_CM_L8;
+    MP_HAL_CLEAN_DCACHE(src, ((h - 1) * src_stride + w) * bpp / 8);
+    MP_HAL_CLEANINVALIDATE_DCACHE(dest, ((h - 1) * dest_stride + w) * bpp / 8);
+    DMA2D->FGMAR = (uint32_t)src;
+    DMA2D->FGOR = src_stride - w;
+    DMA2D->FGPFCCR = cm;
+    DMA2D->OPFCCR = cm;
+    dma2d_start(DMA2D_MODE_M2M, dest, dest_stride - w, w, h);
+    return true;
+}
+
+#endif // MICROPY_HW_ENABLE_DMA2D
@@ -0,0 +1,40 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef MICROPY_INCLUDED_STM32_DMA2D_H
+#define MICROPY_INCLUDED_STM32_DMA2D_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Offload of framebuf fills and copies to the DMA2D (Chrom-ART) engine, see
+// MICROPY_PY_FRAMEBUF_ACCEL.
+bool mp_hal_framebuf_fill(void *dest, unsigned int stride, unsigned int w, unsigned int h, unsigned int bpp, uint32_t col);
+bool mp_hal_framebuf_copy(void *dest, unsigned int dest_stride, const void *src, unsigned int src_stride, unsigned int w, unsigned int h, unsigned int bpp);
+void mp_hal_framebuf_wait(void);
+
+void dma2d_deinit(void);
+
+#endif // MICROPY_INCLUDED_STM32_DMA2D_H
@@ -32,6 +32,7 @@
 #include "modnetwork.h"
 #include "mpu.h"
 #include "eth.h"
+#include "extmod/network_ptp.h"
 
 #if defined(MICROPY_HW_ETH_MDC)
 
@@ -64,19 +65,25 @@
 #if defined(STM32H7)
 #define RX_DESCR_3_OWN_Pos      (31)
 #define RX_DESCR_3_IOC_Pos      (30)
+#define RX_DESCR_3_CTXT_Pos     (30) // in write-back format
 #define RX_DESCR_3_BUF1V_Pos    (24)
 #define RX_DESCR_3_PL_Msk       (0x7fff)
+#define RX_DESCR_1_TSA_Pos      (14) // in write-back format
 
 #define TX_DESCR_3_OWN_Pos      (31)
 #define TX_DESCR_3_LD_Pos       (29)
 #define TX_DESCR_3_FD_Pos       (28)
 #define TX_DESCR_3_CIC_Pos      (16)
+#define TX_DESCR_3_TTSS_Pos     (17) // in write-back format
+#define TX_DESCR_3_FL_Msk       (0x7fff)
+#define TX_DESCR_2_TTSE_Pos     (30)
 #define TX_DESCR_2_B1L_Pos      (0)
 #define TX_DESCR_2_B1L_Msk      (0x3fff << TX_DESCR_2_B1L_Pos)
 #else
 #define RX_DESCR_0_OWN_Pos      (31)
 #define RX_DESCR_0_FL_Pos       (16)
 #define RX_DESCR_0_FL_Msk       (0x3fff << RX_DESCR_0_FL_Pos)
+#define RX_DESCR_0_TSV_Pos      (7) // with enhanced descriptors
 #define RX_DESCR_1_RER_Pos      (15)
 #define RX_DESCR_1_RCH_Pos      (14)
 #define RX_DESCR_1_RBS2_Pos     (16)
@@ -86,9 +93,11 @@
 #define TX_DESCR_0_LS_Pos       (29)
 #define TX_DESCR_0_FS_Pos       (28)
 #define TX_DESCR_0_DP_Pos       (26)
+#define TX_DESCR_0_TTSE_Pos     (25)
 #define TX_DESCR_0_CIC_Pos      (22)
 #define TX_DESCR_0_TER_Pos      (21)
 #define TX_DESCR_0_TCH_Pos      (20)
+#define TX_DESCR_0_TTSS_Pos     (17)
 #define TX_DESCR_1_TBS1_Pos     (0)
 #endif
 
@@ -99,25 +108,60 @@
 #define RX_BUF_SIZE (1524) // includes 4-byte CRC at end
 #define TX_BUF_SIZE (1524)
 
+// On F7 and H7 the DMA region is 32k, which leaves room for RX buffers that are
+// lent to lwIP as the payload of the pbuf of a frame, rather than copying the
+// frame.  Elsewhere the region is 16k, and every received frame is copied.
+#if defined(STM32F7) || defined(STM32H7)
+#define RX_BUF_NUM (8)
+#define RX_BUF_LOAN_NUM (8)
+#define TX_BUF_NUM (5)
+#define ETH_DMA_SIZE (32768)
+#define ETH_DMA_MPU_SIZE (MPU_REGION_SIZE_32KB)
+#else
 #define RX_BUF_NUM (5)
+#define RX_BUF_LOAN_NUM (0)
 #define TX_BUF_NUM (5)
+#define ETH_DMA_SIZE (16384)
+#define ETH_DMA_MPU_SIZE (MPU_REGION_SIZE_16KB)
+#endif
+#define RX_BUF_TOTAL (RX_BUF_NUM + RX_BUF_LOAN_NUM)
+
+// Outgoing pbufs in memory that the ETH DMA cannot read are copied to a TX buffer
+#if defined(STM32H7)
+// (the DMA cannot read the DTCM)
+#define ETH_DMA_CAN_READ(addr) ((uintptr_t)(addr) < 0x20000000 || (uintptr_t)(addr) >= 0x20020000)
+#else
+// (the DMA cannot read the CCM)
+#define ETH_DMA_CAN_READ(addr) ((uintptr_t)(addr) < 0x10000000 || (uintptr_t)(addr) >= 0x10010000)
+#endif
 
+// With PTP on F4/F7 the descriptors are the enhanced ones, which have room for
+// a timestamp.  On H7 the timestamp is written back over the descriptor.
 typedef struct _eth_dma_rx_descr_t {
     volatile uint32_t rdes0, rdes1, rdes2, rdes3;
+    #if MICROPY_HW_ETH_PTP && !defined(STM32H7)
+    volatile uint32_t rdes4, rdes5, rdes6, rdes7;
+    #endif
 } eth_dma_rx_descr_t;
 
 typedef struct _eth_dma_tx_descr_t {
     volatile uint32_t tdes0, tdes1, tdes2, tdes3;
+    #if MICROPY_HW_ETH_PTP && !defined(STM32H7)
+    volatile uint32_t tdes4, tdes5, tdes6, tdes7;
+    #endif
 } eth_dma_tx_descr_t;
 
 typedef struct _eth_dma_t {
     eth_dma_rx_descr_t rx_descr[RX_BUF_NUM];
     eth_dma_tx_descr_t tx_descr[TX_BUF_NUM];
-    uint8_t rx_buf[RX_BUF_NUM * RX_BUF_SIZE] __attribute__((aligned(4)));
+    uint8_t rx_buf[RX_BUF_TOTAL * RX_BUF_SIZE] __attribute__((aligned(4)));
     uint8_t tx_buf[TX_BUF_NUM * TX_BUF_SIZE] __attribute__((aligned(4)));
     size_t rx_descr_idx;
     size_t tx_descr_idx;
-    uint8_t padding[16384 - 15408];
+    uint8_t padding[ETH_DMA_SIZE
+                    - (RX_BUF_NUM + TX_BUF_NUM) * sizeof(eth_dma_rx_descr_t)
+                    - (RX_BUF_TOTAL + TX_BUF_NUM) * RX_BUF_SIZE
+                    - 2 * sizeof(size_t)];
 } eth_dma_t;
 
 typedef struct _eth_t {
@@ -126,12 +170,82 @@ typedef struct _eth_t {
     struct dhcp dhcp_struct;
 } eth_t;
 
-static eth_dma_t eth_dma __attribute__((aligned(16384)));
+static eth_dma_t eth_dma __attribute__((aligned(ETH_DMA_SIZE)));
+
+// Index of the RX buffer given to each RX descriptor
+STATIC uint8_t eth_rx_descr_buf[RX_BUF_NUM];
+
+#if RX_BUF_LOAN_NUM
+// RX buffers that are lent to lwIP, and those that are free to give to a descriptor
+STATIC struct pbuf_custom eth_rx_pbuf[RX_BUF_TOTAL];
+STATIC uint32_t eth_rx_buf_lent;
+STATIC uint32_t eth_rx_buf_spare;
+#endif
+
+// Frames sent straight from their pbufs keep a reference to the pbuf in the
+// entry of their last TX descriptor, until the DMA is done with that descriptor
+STATIC struct pbuf *eth_tx_pbuf[TX_BUF_NUM];
+
+#if MICROPY_HW_ETH_PTP
+
+// PTP time stamp control register bits, the same on F4/F7 and H7
+#define PTP_TSCR_TSE        (1 << 0)
+#define PTP_TSCR_TSFCU      (1 << 1)
+#define PTP_TSCR_TSSTI      (1 << 2)
+#define PTP_TSCR_TSSTU      (1 << 3)
+#define PTP_TSCR_TSARU      (1 << 5)
+#define PTP_TSCR_TSSARFE    (1 << 8)
+#define PTP_TSCR_TSSSR      (1 << 9)
+#define PTP_TSCR_TSPTPPSV2E (1 << 10)
+#define PTP_TSCR_TSSIPV4FE  (1 << 13)
+
+#define PTP_TSLUR_ADDSUB    (1U << 31)
+
+#if defined(STM32H7)
+#define ETH_PTP_TSCR MACTSCR
+#define ETH_PTP_SSIR MACSSIR
+#define ETH_PTP_SSIR_Pos (16)
+#define ETH_PTP_TSHR MACSTSR
+#define ETH_PTP_TSLR MACSTNR
+#define ETH_PTP_TSHUR MACSTSUR
+#define ETH_PTP_TSLUR MACSTNUR
+#define ETH_PTP_TSAR MACTSAR
+#else
+#define ETH_PTP_TSCR PTPTSCR
+#define ETH_PTP_SSIR PTPSSIR
+#define ETH_PTP_SSIR_Pos (0)
+#define ETH_PTP_TSHR PTPTSHR
+#define ETH_PTP_TSLR PTPTSLR
+#define ETH_PTP_TSHUR PTPTSHUR
+#define ETH_PTP_TSLUR PTPTSLUR
+#define ETH_PTP_TSAR PTPTSAR
+#endif
+
+typedef struct _eth_ptp_t {
+    uint32_t addend; // of the clock at its nominal frequency
+    int32_t ppb;
+    bool rx_valid; // rx_time is that of the frame being processed
+    bool tx_want; // timestamp the next frame sent
+    bool tx_pending; // the frame at tx_idx is to be timestamped
+    bool tx_valid;
+    size_t tx_idx;
+    network_ptp_time_t rx_time;
+    network_ptp_time_t tx_time;
+} eth_ptp_t;
+
+STATIC eth_ptp_t eth_ptp;
+
+#endif
 
 eth_t eth_instance;
 
 STATIC void eth_mac_deinit(eth_t *self);
-STATIC void eth_process_frame(eth_t *self, size_t len, const uint8_t *buf);
+STATIC size_t eth_process_frame(eth_t *self, size_t len, size_t buf_idx);
+STATIC void eth_tx_pbuf_free_all(void);
+#if MICROPY_HW_ETH_PTP
+STATIC void eth_ptp_init(uint32_t hclk);
+STATIC void eth_ptp_tx_capture(void);
+#endif
 
 STATIC void eth_phy_write(uint32_t reg, uint32_t val) {
     #if defined(STM32H7)
@@ -197,7 +311,7 @@ void eth_set_trace(eth_t *self, uint32_t value) {
 STATIC int eth_mac_init(eth_t *self) {
     // Configure MPU
     uint32_t irq_state = mpu_config_start();
-    mpu_config_region(MPU_REGION_ETH, (uint32_t)&eth_dma, MPU_CONFIG_ETH(MPU_REGION_SIZE_16KB));
+    mpu_config_region(MPU_REGION_ETH, (uint32_t)&eth_dma, MPU_CONFIG_ETH(ETH_DMA_MPU_SIZE));
     mpu_config_end(irq_state);
 
     // Configure GPIO
@@ -342,6 +456,8 @@ STATIC int eth_mac_init(eth_t *self) {
     // Burst mode configuration
     #if defined(STM32H7)
     ETH->DMASBMR = ETH->DMASBMR & ~ETH_DMASBMR_AAL & ~ETH_DMASBMR_FB;
+    #elif MICROPY_HW_ETH_PTP
+    ETH->DMABMR = ETH_DMABMR_EDE; // enhanced descriptors, with timestamps
     #else
     ETH->DMABMR = 0;
     #endif
@@ -360,22 +476,38 @@ STATIC int eth_mac_init(eth_t *self) {
     ;
     #endif
 
+    // Give RX buffers to the descriptors, skipping those that lwIP may still
+    // hold from before a restart, and keep the rest as spares
+    #if RX_BUF_LOAN_NUM
+    uint32_t rx_buf_avail = ((1 << RX_BUF_TOTAL) - 1) & ~eth_rx_buf_lent;
+    for (size_t i = 0; i < RX_BUF_NUM; ++i) {
+        eth_rx_descr_buf[i] = __builtin_ctz(rx_buf_avail);
+        rx_buf_avail &= rx_buf_avail - 1;
+    }
+    eth_rx_buf_spare = rx_buf_avail;
+    #else
+    for (size_t i = 0; i < RX_BUF_NUM; ++i) {
+        eth_rx_descr_buf[i] = i;
+    }
+    #endif
+
     // Configure RX descriptor lists
     for (size_t i = 0; i < RX_BUF_NUM; ++i) {
+        uint8_t *buf = &eth_dma.rx_buf[eth_rx_descr_buf[i] * RX_BUF_SIZE];
         #if defined(STM32H7)
         eth_dma.rx_descr[i].rdes3 =
             1 << RX_DESCR_3_OWN_Pos
                 | (1 << RX_DESCR_3_BUF1V_Pos) // buf1 address valid
                 | (1 << RX_DESCR_3_IOC_Pos) // Interrupt Enabled on Completion
         ;
-        eth_dma.rx_descr[i].rdes0 = (uint32_t)&eth_dma.rx_buf[i * RX_BUF_SIZE]; // buf 1 address
+        eth_dma.rx_descr[i].rdes0 = (uint32_t)buf; // buf 1 address
         #else
         eth_dma.rx_descr[i].rdes0 = 1 << RX_DESCR_0_OWN_Pos;
         eth_dma.rx_descr[i].rdes1 =
             1 << RX_DESCR_1_RCH_Pos // chained
                 | RX_BUF_SIZE << RX_DESCR_1_RBS1_Pos
         ;
-        eth_dma.rx_descr[i].rdes2 = (uint32_t)&eth_dma.rx_buf[i * RX_BUF_SIZE];
+        eth_dma.rx_descr[i].rdes2 = (uint32_t)buf;
         eth_dma.rx_descr[i].rdes3 = (uint32_t)&eth_dma.rx_descr[(i + 1) % RX_BUF_NUM];
         #endif
     }
@@ -387,7 +519,8 @@ STATIC int eth_mac_init(eth_t *self) {
     #endif
     eth_dma.rx_descr_idx = 0;
 
-    // Configure TX descriptor lists
+    // Configure TX descriptor lists, dropping pbufs of frames that were queued
+    eth_tx_pbuf_free_all();
     for (size_t i = 0; i < TX_BUF_NUM; ++i) {
         #if defined(STM32H7)
         eth_dma.tx_descr[i].tdes0 = 0;
@@ -444,6 +577,10 @@ STATIC int eth_mac_init(eth_t *self) {
     ETH->MACA0LR = mac[3] << 24 | mac[2] << 16 | mac[1] << 8 | mac[0];
     mp_hal_delay_ms(2);
 
+    #if MICROPY_HW_ETH_PTP
+    eth_ptp_init(hclk);
+    #endif
+
     // Set main MAC control register
     ETH->MACCR =
         (phy_scsr & PHY_SCSR_SPEED_Msk) == PHY_SCSR_SPEED_10FULL ? ETH_MACCR_DM
@@ -493,13 +630,21 @@ STATIC void eth_mac_deinit(eth_t *self) {
     #endif
 }
 
-STATIC int eth_tx_buf_get(size_t len, uint8_t **buf) {
-    if (len > TX_BUF_SIZE) {
-        return -MP_EINVAL;
+STATIC void eth_tx_pbuf_free_all(void) {
+    MICROPY_PY_LWIP_ENTER
+    for (size_t i = 0; i < TX_BUF_NUM; ++i) {
+        if (eth_tx_pbuf[i] != NULL) {
+            pbuf_free(eth_tx_pbuf[i]);
+            eth_tx_pbuf[i] = NULL;
+        }
     }
+    MICROPY_PY_LWIP_EXIT
+}
 
-    // Wait for DMA to release the current TX descriptor (if it has it)
-    eth_dma_tx_descr_t *tx_descr = &eth_dma.tx_descr[eth_dma.tx_descr_idx];
+// Wait for DMA to release the given TX descriptor (if it has it), and release
+// the pbuf it was sending
+STATIC int eth_tx_descr_wait(size_t idx) {
+    eth_dma_tx_descr_t *tx_descr = &eth_dma.tx_descr[idx];
     uint32_t t0 = mp_hal_ticks_ms();
     for (;;) {
         #if defined(STM32H7)
@@ -515,6 +660,29 @@ STATIC int eth_tx_buf_get(size_t len, uint8_t **buf) {
             return -MP_ETIMEDOUT;
         }
     }
+    #if MICROPY_HW_ETH_PTP
+    if (eth_ptp.tx_pending && idx == eth_ptp.tx_idx) {
+        // Keep the send time before the descriptor is reused
+        eth_ptp_tx_capture();
+    }
+    #endif
+    if (eth_tx_pbuf[idx] != NULL) {
+        pbuf_free(eth_tx_pbuf[idx]);
+        eth_tx_pbuf[idx] = NULL;
+    }
+    return 0;
+}
+
+STATIC int eth_tx_buf_get(size_t len, uint8_t **buf) {
+    if (len > TX_BUF_SIZE) {
+        return -MP_EINVAL;
+    }
+
+    int ret = eth_tx_descr_wait(eth_dma.tx_descr_idx);
+    if (ret < 0) {
+        return ret;
+    }
+    eth_dma_tx_descr_t *tx_descr = &eth_dma.tx_descr[eth_dma.tx_descr_idx];
 
     #if defined(STM32H7)
     // Update TX descriptor with length and buffer pointer
@@ -532,13 +700,51 @@ STATIC int eth_tx_buf_get(size_t len, uint8_t **buf) {
     return 0;
 }
 
+STATIC void eth_tx_dma_notify(void) {
+    // Notify ETH DMA that there is a new TX descriptor for sending
+    __DMB();
+    #if defined(STM32H7)
+    if (ETH->DMACSR & ETH_DMACSR_TBU) {
+        ETH->DMACSR = ETH_DMACSR_TBU;
+    }
+    ETH->DMACTDTPR = (uint32_t)&eth_dma.tx_descr[eth_dma.tx_descr_idx];
+    #else
+    if (ETH->DMASR & ETH_DMASR_TBUS) {
+        ETH->DMASR = ETH_DMASR_TBUS;
+        ETH->DMATPDR = 0;
+    }
+    #endif
+}
+
+#if MICROPY_HW_ETH_PTP
+// Returns whether the frame being queued, whose last descriptor is at the
+// given index, should be timestamped
+STATIC bool eth_ptp_tx_ttse(size_t last_idx) {
+    if (!eth_ptp.tx_want) {
+        return false;
+    }
+    eth_ptp.tx_pending = true;
+    eth_ptp.tx_valid = false;
+    eth_ptp.tx_idx = last_idx;
+    return true;
+}
+#endif
+
 STATIC int eth_tx_buf_send(void) {
     // Get TX descriptor and move to next one
     eth_dma_tx_descr_t *tx_descr = &eth_dma.tx_descr[eth_dma.tx_descr_idx];
+    #if MICROPY_HW_ETH_PTP
+    uint32_t ttse = eth_ptp_tx_ttse(eth_dma.tx_descr_idx);
+    #else
+    const uint32_t ttse = 0;
+    #endif
     eth_dma.tx_descr_idx = (eth_dma.tx_descr_idx + 1) % TX_BUF_NUM;
 
     // Schedule to send next outgoing frame
     #if defined(STM32H7)
+    if (ttse) {
+        tx_descr->tdes2 |= 1 << TX_DESCR_2_TTSE_Pos;
+    }
     tx_descr->tdes3 =
         1 << TX_DESCR_3_OWN_Pos     // owned by DMA
             | 1 << TX_DESCR_3_LD_Pos // last segment
@@ -552,30 +758,103 @@ STATIC int eth_tx_buf_send(void) {
             | 1 << TX_DESCR_0_FS_Pos // first segment
             | 3 << TX_DESCR_0_CIC_Pos // enable all checksums inserted by hardware
             | 1 << TX_DESCR_0_TCH_Pos // TX descriptor is chained
+            | ttse << TX_DESCR_0_TTSE_Pos // timestamp the frame
     ;
     #endif
 
-    // Notify ETH DMA that there is a new TX descriptor for sending
-    __DMB();
-    #if defined(STM32H7)
-    if (ETH->DMACSR & ETH_DMACSR_TBU) {
-        ETH->DMACSR = ETH_DMACSR_TBU;
+    eth_tx_dma_notify();
+    return 0;
+}
+
+// Send a frame straight from the payloads of its pbuf chain, using one TX
+// descriptor per pbuf.  Returns 1 if the frame can't be sent this way.
+STATIC int eth_tx_pbuf_send(struct pbuf *p) {
+    size_t n = pbuf_clen(p);
+    if (n > TX_BUF_NUM) {
+        return 1;
     }
-    ETH->DMACTDTPR = (uint32_t)&eth_dma.tx_descr[eth_dma.tx_descr_idx];
-    #else
-    if (ETH->DMASR & ETH_DMASR_TBUS) {
-        ETH->DMASR = ETH_DMASR_TBUS;
-        ETH->DMATPDR = 0;
+    for (struct pbuf *q = p; q != NULL; q = q->next) {
+        if (q->len == 0
+            || !ETH_DMA_CAN_READ(q->payload)
+            || !ETH_DMA_CAN_READ((uint8_t *)q->payload + q->len - 1)) {
+            return 1;
+        }
+    }
+
+    // Get all the descriptors first, so the frame is either queued whole or not at all
+    size_t idx = eth_dma.tx_descr_idx;
+    for (size_t i = 0; i < n; ++i) {
+        int ret = eth_tx_descr_wait((idx + i) % TX_BUF_NUM);
+        if (ret < 0) {
+            return ret;
+        }
     }
+
+    // Fill in the descriptors with buffer pointers and lengths
+    for (struct pbuf *q = p; q != NULL; q = q->next) {
+        eth_dma_tx_descr_t *tx_descr = &eth_dma.tx_descr[idx];
+        MP_HAL_CLEAN_DCACHE(q->payload, q->len);
+        #if defined(STM32H7)
+        tx_descr->tdes0 = (uint32_t)q->payload;
+        tx_descr->tdes2 = q->len & TX_DESCR_2_B1L_Msk;
+        #else
+        tx_descr->tdes1 = q->len << TX_DESCR_1_TBS1_Pos;
+        tx_descr->tdes2 = (uint32_t)q->payload;
+        tx_descr->tdes3 = (uint32_t)&eth_dma.tx_descr[(idx + 1) % TX_BUF_NUM];
+        #endif
+        idx = (idx + 1) % TX_BUF_NUM;
+    }
+
+    // Keep the pbuf until the DMA releases the last descriptor
+    size_t last = (idx + TX_BUF_NUM - 1) % TX_BUF_NUM;
+    pbuf_ref(p);
+    eth_tx_pbuf[last] = p;
+    #if MICROPY_HW_ETH_PTP
+    uint32_t ttse = eth_ptp_tx_ttse(last);
+    #else
+    const uint32_t ttse = 0;
     #endif
 
+    // Give the descriptors to the DMA, the first one last so it doesn't start
+    // sending before the whole frame is ready
+    for (size_t i = n; i-- > 0;) {
+        eth_dma_tx_descr_t *tx_descr = &eth_dma.tx_descr[(eth_dma.tx_descr_idx + i) % TX_BUF_NUM];
+        #if defined(STM32H7)
+        if (i == 0 && ttse) {
+            tx_descr->tdes2 |= 1 << TX_DESCR_2_TTSE_Pos;
+        }
+        tx_descr->tdes3 =
+            1 << TX_DESCR_3_OWN_Pos     // owned by DMA
+                | (i == n - 1) << TX_DESCR_3_LD_Pos // last segment
+                | (i == 0) << TX_DESCR_3_FD_Pos // first segment
+                | 3 << TX_DESCR_3_CIC_Pos // enable all checksums inserted by hardware
+                | (i == 0 ? p->tot_len & TX_DESCR_3_FL_Msk : 0) // frame length
+        ;
+        #else
+        tx_descr->tdes0 =
+            1 << TX_DESCR_0_OWN_Pos     // owned by DMA
+                | (i == n - 1) << TX_DESCR_0_LS_Pos // last segment
+                | (i == 0) << TX_DESCR_0_FS_Pos // first segment
+                | 3 << TX_DESCR_0_CIC_Pos // enable all checksums inserted by hardware
+                | 1 << TX_DESCR_0_TCH_Pos // TX descriptor is chained
+                | (i == 0 && ttse) << TX_DESCR_0_TTSE_Pos // timestamp the frame
+        ;
+        #endif
+        if (i != 0) {
+            __DMB();
+        }
+    }
+    eth_dma.tx_descr_idx = idx;
+
+    eth_tx_dma_notify();
     return 0;
 }
 
-STATIC void eth_dma_rx_free(void) {
-    // Get RX descriptor, RX buffer and move to next one
+STATIC void eth_dma_rx_free(size_t buf_idx) {
+    // Get RX descriptor, give it the RX buffer and move to next one
     eth_dma_rx_descr_t *rx_descr = &eth_dma.rx_descr[eth_dma.rx_descr_idx];
-    uint8_t *buf = &eth_dma.rx_buf[eth_dma.rx_descr_idx * RX_BUF_SIZE];
+    uint8_t *buf = &eth_dma.rx_buf[buf_idx * RX_BUF_SIZE];
+    eth_rx_descr_buf[eth_dma.rx_descr_idx] = buf_idx;
     eth_dma.rx_descr_idx = (eth_dma.rx_descr_idx + 1) % RX_BUF_NUM;
 
     // Schedule to get next incoming frame
@@ -603,6 +882,38 @@ STATIC void eth_dma_rx_free(void) {
     #endif
 }
 
+#if MICROPY_HW_ETH_PTP
+// Gets the receive time of the frame in the given RX descriptor, if it has one
+STATIC bool eth_ptp_rx_timestamp(size_t idx) {
+    eth_dma_rx_descr_t *rx_descr = &eth_dma.rx_descr[idx];
+    #if defined(STM32H7)
+    if (!(rx_descr->rdes1 & (1 << RX_DESCR_1_TSA_Pos))) {
+        return false;
+    }
+    // The timestamp is in a context descriptor after the frame, which the DMA
+    // writes just after the frame's own descriptor
+    rx_descr = &eth_dma.rx_descr[(idx + 1) % RX_BUF_NUM];
+    for (size_t i = 0; rx_descr->rdes3 & (1 << RX_DESCR_3_OWN_Pos); ++i) {
+        if (i > 1000) {
+            return false;
+        }
+    }
+    if (!(rx_descr->rdes3 & (1 << RX_DESCR_3_CTXT_Pos))) {
+        return false;
+    }
+    eth_ptp.rx_time.sec = rx_descr->rdes1;
+    eth_ptp.rx_time.nsec = rx_descr->rdes0;
+    #else
+    if (!(rx_descr->rdes0 & (1 << RX_DESCR_0_TSV_Pos))) {
+        return false;
+    }
+    eth_ptp.rx_time.sec = rx_descr->rdes7;
+    eth_ptp.rx_time.nsec = rx_descr->rdes6;
+    #endif
+    return true;
+}
+#endif
+
 void ETH_IRQHandler(void) {
     #if defined(STM32H7)
     uint32_t sr = ETH->DMACSR;
@@ -626,6 +937,14 @@ void ETH_IRQHandler(void) {
                 // No more RX descriptors ready to read
                 break;
             }
+            #if MICROPY_HW_ETH_PTP
+            if (rx_descr_l->rdes3 & (1 << RX_DESCR_3_CTXT_Pos)) {
+                // A context descriptor with the timestamp of a frame that was
+                // already processed, so give it straight back
+                eth_dma_rx_free(eth_rx_descr_buf[eth_dma.rx_descr_idx]);
+                continue;
+            }
+            #endif
             #else
             eth_dma_rx_descr_t *rx_descr = &eth_dma.rx_descr[eth_dma.rx_descr_idx];
             if (rx_descr->rdes0 & (1 << RX_DESCR_0_OWN_Pos)) {
@@ -641,19 +960,167 @@ void ETH_IRQHandler(void) {
             size_t len = (rx_descr->rdes0 & RX_DESCR_0_FL_Msk) >> RX_DESCR_0_FL_Pos;
             #endif
             len -= 4; // discard CRC at end
-            #if defined(STM32H7)
-            uint8_t *buf = &eth_dma.rx_buf[eth_dma.rx_descr_idx * RX_BUF_SIZE];
-            #else
-            uint8_t *buf = (uint8_t *)rx_descr->rdes2;
+            size_t buf_idx = eth_rx_descr_buf[eth_dma.rx_descr_idx];
+
+            // Process frame, which may lend the buffer to lwIP and return a
+            // spare one to give to the descriptor instead
+            #if MICROPY_HW_ETH_PTP
+            eth_ptp.rx_valid = eth_ptp_rx_timestamp(eth_dma.rx_descr_idx);
             #endif
+            buf_idx = eth_process_frame(&eth_instance, len, buf_idx);
+            #if MICROPY_HW_ETH_PTP
+            eth_ptp.rx_valid = false;
+            #endif
+            eth_dma_rx_free(buf_idx);
+        }
+    }
+}
+
+#if MICROPY_HW_ETH_PTP
 
-            // Process frame
-            eth_process_frame(&eth_instance, len, buf);
-            eth_dma_rx_free();
+/*******************************************************************************/
+// PTP hardware clock
+
+STATIC void eth_ptp_wait(uint32_t bits) {
+    uint32_t t0 = mp_hal_ticks_ms();
+    while ((ETH->ETH_PTP_TSCR & bits) && mp_hal_ticks_ms() - t0 < 10) {
+    }
+}
+
+STATIC void eth_ptp_init(uint32_t hclk) {
+    // The clock is updated at up to half of HCLK, and is fine-tuned by the
+    // addend, whose overflows make the updates.  The sub-second counter rolls
+    // over at 10^9 so it counts nanoseconds.
+    uint32_t ssinc = (2000000000 + hclk - 1) / hclk;
+    eth_ptp.addend = ((uint64_t)1000000000 << 32) / ssinc / hclk;
+    eth_ptp.ppb = 0;
+    eth_ptp.rx_valid = false;
+    eth_ptp.tx_want = false;
+    eth_ptp.tx_pending = false;
+    eth_ptp.tx_valid = false;
+
+    // Timestamp all received frames, so UDP sockets can get them too
+    ETH->ETH_PTP_TSCR =
+        PTP_TSCR_TSE
+        | PTP_TSCR_TSSSR
+        | PTP_TSCR_TSSARFE
+        | PTP_TSCR_TSPTPPSV2E
+        | PTP_TSCR_TSSIPV4FE
+    ;
+    ETH->ETH_PTP_SSIR = ssinc << ETH_PTP_SSIR_Pos;
+    ETH->ETH_PTP_TSAR = eth_ptp.addend;
+    ETH->ETH_PTP_TSCR |= PTP_TSCR_TSARU;
+    eth_ptp_wait(PTP_TSCR_TSARU);
+    ETH->ETH_PTP_TSCR |= PTP_TSCR_TSFCU;
+    ETH->ETH_PTP_TSHUR = 0;
+    ETH->ETH_PTP_TSLUR = 0;
+    ETH->ETH_PTP_TSCR |= PTP_TSCR_TSSTI;
+    eth_ptp_wait(PTP_TSCR_TSSTI);
+}
+
+// Gets the send time of the timestamped frame, if the DMA is done with it
+STATIC void eth_ptp_tx_capture(void) {
+    eth_dma_tx_descr_t *tx_descr = &eth_dma.tx_descr[eth_ptp.tx_idx];
+    #if defined(STM32H7)
+    if (tx_descr->tdes3 & (1 << TX_DESCR_3_OWN_Pos)) {
+        return;
+    }
+    if (tx_descr->tdes3 & (1 << TX_DESCR_3_TTSS_Pos)) {
+        eth_ptp.tx_time.sec = tx_descr->tdes1;
+        eth_ptp.tx_time.nsec = tx_descr->tdes0;
+        eth_ptp.tx_valid = true;
+    }
+    #else
+    if (tx_descr->tdes0 & (1 << TX_DESCR_0_OWN_Pos)) {
+        return;
+    }
+    if (tx_descr->tdes0 & (1 << TX_DESCR_0_TTSS_Pos)) {
+        eth_ptp.tx_time.sec = tx_descr->tdes7;
+        eth_ptp.tx_time.nsec = tx_descr->tdes6;
+        eth_ptp.tx_valid = true;
+    }
+    #endif
+    eth_ptp.tx_pending = false;
+}
+
+void network_ptp_hal_get_time(network_ptp_time_t *t) {
+    // Read the seconds again in case they changed while reading the nanoseconds
+    uint32_t sec;
+    do {
+        sec = ETH->ETH_PTP_TSHR;
+        t->nsec = ETH->ETH_PTP_TSLR & 0x7fffffff;
+    } while (ETH->ETH_PTP_TSHR != sec);
+    t->sec = sec;
+}
+
+void network_ptp_hal_set_time(const network_ptp_time_t *t) {
+    eth_ptp_wait(PTP_TSCR_TSSTI | PTP_TSCR_TSSTU);
+    ETH->ETH_PTP_TSHUR = t->sec;
+    ETH->ETH_PTP_TSLUR = t->nsec;
+    ETH->ETH_PTP_TSCR |= PTP_TSCR_TSSTI;
+    eth_ptp_wait(PTP_TSCR_TSSTI);
+}
+
+void network_ptp_hal_step(int64_t ns) {
+    bool sub = ns < 0;
+    if (sub) {
+        ns = -ns;
+    }
+    uint32_t sec = ns / 1000000000;
+    uint32_t nsec = ns % 1000000000;
+    if (sub) {
+        // The nanoseconds to subtract are given as their complement to 10^9,
+        // and on H7 so are the seconds, to 2^32
+        #if defined(STM32H7)
+        sec = -sec;
+        #endif
+        if (nsec != 0) {
+            nsec = 1000000000 - nsec;
         }
     }
+    eth_ptp_wait(PTP_TSCR_TSSTI | PTP_TSCR_TSSTU);
+    ETH->ETH_PTP_TSHUR = sec;
+    ETH->ETH_PTP_TSLUR = (sub ? PTP_TSLUR_ADDSUB : 0) | nsec;
+    ETH->ETH_PTP_TSCR |= PTP_TSCR_TSSTU;
+    eth_ptp_wait(PTP_TSCR_TSSTU);
 }
 
+void network_ptp_hal_set_freq(int32_t ppb) {
+    eth_ptp.ppb = ppb;
+    eth_ptp_wait(PTP_TSCR_TSARU);
+    ETH->ETH_PTP_TSAR = eth_ptp.addend + (int64_t)eth_ptp.addend * ppb / 1000000000;
+    ETH->ETH_PTP_TSCR |= PTP_TSCR_TSARU;
+}
+
+int32_t network_ptp_hal_get_freq(void) {
+    return eth_ptp.ppb;
+}
+
+bool network_ptp_hal_rx_timestamp(network_ptp_time_t *t) {
+    if (!eth_ptp.rx_valid) {
+        return false;
+    }
+    *t = eth_ptp.rx_time;
+    return true;
+}
+
+void network_ptp_hal_tx_request(bool enable) {
+    eth_ptp.tx_want = enable;
+}
+
+bool network_ptp_hal_tx_timestamp(network_ptp_time_t *t) {
+    if (eth_ptp.tx_pending) {
+        eth_ptp_tx_capture();
+    }
+    if (!eth_ptp.tx_valid) {
+        return false;
+    }
+    *t = eth_ptp.tx_time;
+    return true;
+}
+
+#endif // MICROPY_HW_ETH_PTP
+
 /*******************************************************************************/
 // ETH-LwIP bindings
 
@@ -688,11 +1155,15 @@ STATIC err_t eth_netif_output(struct netif *netif, struct pbuf *p) {
     LINK_STATS_INC(link.xmit);
     eth_trace(netif->state, (size_t)-1, p, NETUTILS_TRACE_IS_TX | NETUTILS_TRACE_NEWLINE);
 
-    uint8_t *buf;
-    int ret = eth_tx_buf_get(p->tot_len, &buf);
-    if (ret == 0) {
-        pbuf_copy_partial(p, buf, p->tot_len, 0);
-        ret = eth_tx_buf_send();
+    int ret = eth_tx_pbuf_send(p);
+    if (ret == 1) {
+        // Copy the frame to a TX buffer instead
+        uint8_t *buf;
+        ret = eth_tx_buf_get(p->tot_len, &buf);
+        if (ret == 0) {
+            pbuf_copy_partial(p, buf, p->tot_len, 0);
+            ret = eth_tx_buf_send();
+        }
     }
 
     return ret ? ERR_BUF : ERR_OK;
@@ -751,11 +1222,39 @@ STATIC void eth_lwip_deinit(eth_t *self) {
     MICROPY_PY_LWIP_EXIT
 }
 
-STATIC void eth_process_frame(eth_t *self, size_t len, const uint8_t *buf) {
+#if RX_BUF_LOAN_NUM
+STATIC void eth_rx_pbuf_free(struct pbuf *p) {
+    // The RX buffer is no longer used by lwIP
+    size_t buf_idx = (struct pbuf_custom *)p - &eth_rx_pbuf[0];
+    eth_rx_buf_lent &= ~(1 << buf_idx);
+    eth_rx_buf_spare |= 1 << buf_idx;
+}
+#endif
+
+// Passes the frame in the given RX buffer to lwIP, and returns the index of
+// the RX buffer to use for the next frame
+STATIC size_t eth_process_frame(eth_t *self, size_t len, size_t buf_idx) {
+    uint8_t *buf = &eth_dma.rx_buf[buf_idx * RX_BUF_SIZE];
     eth_trace(self, len, buf, NETUTILS_TRACE_NEWLINE);
 
     struct netif *netif = &self->netif;
     if (netif->flags & NETIF_FLAG_LINK_UP) {
+        #if RX_BUF_LOAN_NUM
+        if (eth_rx_buf_spare) {
+            // Lend the buffer to lwIP as the payload of the pbuf, which gives
+            // it back when the pbuf is freed
+            struct pbuf_custom *pc = &eth_rx_pbuf[buf_idx];
+            pc->custom_free_function = eth_rx_pbuf_free;
+            struct pbuf *p = pbuf_alloced_custom(PBUF_RAW, len, PBUF_REF, pc, buf, RX_BUF_SIZE);
+            eth_rx_buf_lent |= 1 << buf_idx;
+            if (netif->input(p, netif) != ERR_OK) {
+                pbuf_free(p);
+            }
+            buf_idx = __builtin_ctz(eth_rx_buf_spare);
+            eth_rx_buf_spare &= ~(1 << buf_idx);
+            return buf_idx;
+        }
+        #endif
         struct pbuf *p = pbuf_alloc(PBUF_RAW, len, PBUF_POOL);
         if (p != NULL) {
             pbuf_take(p, buf, len);
@@ -764,6 +1263,7 @@ STATIC void eth_process_frame(eth_t *self, size_t len, const uint8_t *buf) {
             }
         }
     }
+    return buf_idx;
 }
 
 struct netif *eth_netif(eth_t *self) {
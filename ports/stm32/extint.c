@@ -652,6 +652,12 @@ void Handle_EXTI_Irq(uint32_t line) {
                 return;
             }
             #endif
+            #if MICROPY_PY_WIZNET5K && MICROPY_PY_LWIP
+            extern bool wiznet5k_irq(const pin_obj_t *pin);
+            if (*cb == MP_OBJ_SENTINEL && wiznet5k_irq(MP_OBJ_TO_PTR(pyb_extint_callback_arg[line]))) {
+                return;
+            }
+            #endif
             if (*cb != mp_const_none) {
                 // If it's a soft IRQ handler then just schedule callback for later
                 if (!pyb_extint_hard_irq[line]) {
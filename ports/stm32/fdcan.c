@@ -44,11 +44,27 @@
 #define FDCAN_ELEMENT_MASK_FIDX  (0x7f000000) // Filter Index
 #define FDCAN_ELEMENT_MASK_ANMF  (0x80000000) // Accepted Non-matching Frame
 
+// Data length codes 9 to 15 stand for the longer CAN FD frame lengths
+STATIC const uint8_t fdcan_dlc_len[16] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64};
+
+size_t can_dlc_to_len(uint32_t dlc) {
+    return fdcan_dlc_len[dlc & 0xf];
+}
+
+// Return the smallest data length code that can hold len bytes.
+uint32_t can_len_to_dlc(size_t len) {
+    uint32_t dlc = 0;
+    while (dlc < 15 && fdcan_dlc_len[dlc] < len) {
+        ++dlc;
+    }
+    return dlc;
+}
+
 bool can_init(pyb_can_obj_t *can_obj, uint32_t mode, uint32_t prescaler, uint32_t sjw, uint32_t bs1, uint32_t bs2, bool auto_restart) {
     (void)auto_restart;
 
     FDCAN_InitTypeDef *init = &can_obj->can.Init;
-    init->FrameFormat = FDCAN_FRAME_CLASSIC;
+    init->FrameFormat = can_obj->fd ? FDCAN_FRAME_FD_NO_BRS : FDCAN_FRAME_CLASSIC;
     init->Mode = mode;
 
     init->NominalPrescaler = prescaler; // tq = NominalPrescaler x (1/fdcan_ker_ck)
@@ -72,19 +88,29 @@ bool can_init(pyb_can_obj_t *can_obj, uint32_t mode, uint32_t prescaler, uint32_
     init->ExtFiltersNbr = 0; // Not used
 
     init->TxEventsNbr = 16;  // 32 / 2
-    init->RxBuffersNbr = 32; // 64 / 2
     init->TxBuffersNbr = 16; // 32 / 2
-
-    init->RxFifo0ElmtsNbr = 64; // 128 / 2
-    init->RxFifo0ElmtSize = FDCAN_DATA_BYTES_8;
-
-    init->RxFifo1ElmtsNbr = 64; // 128 / 2
-    init->RxFifo1ElmtSize = FDCAN_DATA_BYTES_8;
-
     init->TxFifoQueueElmtsNbr = 16; // Tx fifo elements
-    init->TxElmtSize = FDCAN_DATA_BYTES_8;
     init->TxFifoQueueMode = FDCAN_TX_FIFO_OPERATION;
 
+    if (can_obj->fd) {
+        // 64-byte elements take 18 words each, so use fewer of them to stay
+        // within this CAN's half of the Message RAM.
+        init->RxBuffersNbr = 0; // Not used
+        init->RxFifo0ElmtsNbr = 16;
+        init->RxFifo0ElmtSize = FDCAN_DATA_BYTES_64;
+        init->RxFifo1ElmtsNbr = 16;
+        init->RxFifo1ElmtSize = FDCAN_DATA_BYTES_64;
+        init->TxBuffersNbr = 0;
+        init->TxElmtSize = FDCAN_DATA_BYTES_64;
+    } else {
+        init->RxBuffersNbr = 32; // 64 / 2
+        init->RxFifo0ElmtsNbr = 64; // 128 / 2
+        init->RxFifo0ElmtSize = FDCAN_DATA_BYTES_8;
+        init->RxFifo1ElmtsNbr = 64; // 128 / 2
+        init->RxFifo1ElmtSize = FDCAN_DATA_BYTES_8;
+        init->TxElmtSize = FDCAN_DATA_BYTES_8;
+    }
+
     FDCAN_GlobalTypeDef *CANx = NULL;
     const pin_obj_t *pins[2];
 
@@ -248,10 +274,14 @@ int can_receive(FDCAN_HandleTypeDef *can, int fifo, FDCAN_RxHeaderTypeDef *hdr,
     hdr->FDFormat = *address & FDCAN_ELEMENT_MASK_FDF;
     hdr->FilterIndex = (*address & FDCAN_ELEMENT_MASK_FIDX) >> 24;
     hdr->IsFilterMatchingFrame = (*address++ & FDCAN_ELEMENT_MASK_ANMF) >> 31;
+    if (!hdr->FDFormat && hdr->DataLength > 8) {
+        // a classic frame has at most 8 bytes, whatever its DLC
+        hdr->DataLength = 8;
+    }
 
     // Copy data
     uint8_t *pdata = (uint8_t *)address;
-    for (uint32_t i = 0; i < 8; ++i) { // TODO use DLCtoBytes[hdr->DataLength] for length > 8
+    for (size_t i = can_dlc_to_len(hdr->DataLength); i > 0; --i) {
         *data++ = *pdata++;
     }
 
@@ -266,6 +266,26 @@ static void flash_bdev_irq_handler(void) {
     }
 }
 
+#if MICROPY_VFS_MMAP
+// Return the address in flash of the given block, and the number of blocks
+// that follow it contiguously in the same flash segment.
+const uint8_t *flash_bdev_get_addr(uint32_t block, uint32_t *num_blocks) {
+    uint32_t flash_addr = convert_block_to_flash_addr(block);
+    if (flash_addr == -1) {
+        // bad block number
+        return NULL;
+    }
+    // Write back the RAM cache so that flash holds the current contents
+    flash_bdev_ioctl(BDEV_IOCTL_SYNC, 0);
+    if (block < FLASH_MEM_SEG1_NUM_BLOCKS) {
+        *num_blocks = FLASH_MEM_SEG1_NUM_BLOCKS - block;
+    } else {
+        *num_blocks = FLASH_MEM_SEG1_NUM_BLOCKS + FLASH_MEM_SEG2_NUM_BLOCKS - block;
+    }
+    return (const uint8_t *)flash_addr;
+}
+#endif
+
 bool flash_bdev_readblock(uint8_t *dest, uint32_t block) {
     // non-MBR block, get data from flash memory, possibly via cache
     uint32_t flash_addr = convert_block_to_flash_addr(block);
@@ -14,13 +14,22 @@
 
 #define LWIP_CHKSUM_ALGORITHM           3
 #define LWIP_CHECKSUM_CTRL_PER_NETIF    1
+#define LWIP_SUPPORT_CUSTOM_PBUF        1 // eth.c lends RX buffers to lwIP
 
 #define LWIP_ARP                        1
 #define LWIP_ETHERNET                   1
 #define LWIP_RAW                        1
 #define LWIP_NETCONN                    0
 #define LWIP_SOCKET                     0
-#define LWIP_STATS                      0
+#define LWIP_STATS                      1 // only the memory stats, for network.lwip_stats()
+#define LINK_STATS                      0
+#define ETHARP_STATS                    0
+#define IP_STATS                        0
+#define IPFRAG_STATS                    0
+#define ICMP_STATS                      0
+#define IGMP_STATS                      0
+#define UDP_STATS                       0
+#define TCP_STATS                       0
 #define LWIP_NETIF_HOSTNAME             1
 #define LWIP_NETIF_EXT_STATUS_CALLBACK  1
 
@@ -34,7 +43,7 @@
 #define LWIP_IGMP                       1
 
 #define LWIP_NUM_NETIF_CLIENT_DATA      LWIP_MDNS_RESPONDER
-#define MEMP_NUM_UDP_PCB                (4 + LWIP_MDNS_RESPONDER)
+#define MEMP_NUM_UDP_PCB                (6 + LWIP_MDNS_RESPONDER) // 2 for the PTP slave
 #define MEMP_NUM_SYS_TIMEOUT            (LWIP_NUM_SYS_TIMEOUT_INTERNAL + LWIP_MDNS_RESPONDER)
 
 #define SO_REUSE                        1
@@ -72,6 +81,17 @@ extern uint32_t rng_get(void);
 #define MEMP_NUM_TCP_SEG (32)
 #endif
 
+#if MICROPY_PY_LWIP_WND_SCALE
+// For boards with plenty of RAM: a receive window 4 times larger, which needs
+// window scaling, and a pbuf pool that can hold it.  Sockets that don't need
+// the speed can use SO_RCVBUF to limit their share.
+#define LWIP_WND_SCALE (1)
+#define TCP_RCV_SCALE (2)
+#undef TCP_WND
+#define TCP_WND (32 * TCP_MSS)
+#define PBUF_POOL_SIZE (40)
+#endif
+
 typedef uint32_t sys_prot_t;
 
 #endif // MICROPY_INCLUDED_STM32_LWIP_LWIPOPTS_H
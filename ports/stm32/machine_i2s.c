@@ -0,0 +1,233 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "py/runtime.h"
+#include "py/mperrno.h"
+#include "py/mphal.h"
+#include "extmod/machine_i2s.h"
+#include "dma.h"
+#include "pin.h"
+#include "modmachine.h"
+
+#if MICROPY_PY_MACHINE_I2S
+
+// I2S(2) and I2S(3) are the I2S modes of SPI2 and SPI3.  Each runs a circular
+// DMA transfer over a buffer of two halves, and the half-transfer and
+// transfer-complete interrupts move one half to or from the ring buffer
+// while the DMA works on the other.  The DMA buffer always holds stereo
+// frames, as the peripheral sends both channels.
+
+// Size of each half of the DMA buffer: 2.7ms of 16-bit stereo at 48kHz.
+#define I2S_DMA_HALF_SIZE (512)
+
+typedef struct _machine_i2s_port_obj_t {
+    machine_i2s_obj_t i2s;
+    I2S_HandleTypeDef hi2s;
+    DMA_HandleTypeDef hdma;
+    const dma_descr_t *dma_descr;
+    uint8_t *dma_alloc;
+    uint8_t *dma_buf; // dma_alloc aligned to a cache line
+} machine_i2s_port_obj_t;
+
+machine_i2s_obj_t *mp_machine_i2s_port_get(mp_int_t id) {
+    if (id != 2 && id != 3) {
+        mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("I2S(%d) doesn't exist"), id);
+    }
+    machine_i2s_port_obj_t *self = MP_STATE_PORT(machine_i2s_obj)[id - 2];
+    if (self == NULL) {
+        self = m_new0(machine_i2s_port_obj_t, 1);
+        self->i2s.base.type = &machine_i2s_type;
+        self->i2s.id = id;
+        MP_STATE_PORT(machine_i2s_obj)[id - 2] = self;
+    }
+    return &self->i2s;
+}
+
+// Set the I2S clock from PLLI2S, for a VCO input of 1MHz: 107.25MHz suits the
+// rates that are multiples of 11025Hz and 86MHz the others.
+STATIC void machine_i2s_clock_config(uint32_t rate) {
+    uint32_t plln = 258, pllr = 3;
+    if (rate % 11025 == 0) {
+        plln = 429;
+        pllr = 4;
+    }
+    RCC_PeriphCLKInitTypeDef clk = {0};
+    clk.PeriphClockSelection = RCC_PERIPHCLK_I2S;
+    #if defined(STM32F7)
+    clk.I2sClockSelection = RCC_I2SCLKSOURCE_PLLI2S;
+    clk.PLLI2S.PLLI2SQ = 2;
+    #endif
+    #if defined(RCC_PLLI2SCFGR_PLLI2SP)
+    clk.PLLI2S.PLLI2SP = RCC_PLLI2SP_DIV2;
+    #endif
+    #if defined(RCC_PLLI2SCFGR_PLLI2SM)
+    clk.PLLI2S.PLLI2SM = MICROPY_HW_CLK_PLLM;
+    #endif
+    clk.PLLI2S.PLLI2SN = plln * MICROPY_HW_CLK_PLLM / (HSE_VALUE / 1000000);
+    clk.PLLI2S.PLLI2SR = pllr;
+    HAL_RCCEx_PeriphCLKConfig(&clk);
+}
+
+STATIC void machine_i2s_pin_config(mp_obj_t pin_in, uint8_t unit) {
+    const pin_obj_t *pin = pin_find(pin_in);
+    if (!mp_hal_pin_config_alt(pin, MP_HAL_PIN_MODE_ALT, MP_HAL_PIN_PULL_NONE, AF_FN_I2S, unit)) {
+        mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("Pin(%q) doesn't have I2S%d"), pin->name, unit);
+    }
+}
+
+void mp_machine_i2s_port_start(machine_i2s_obj_t *i2s) {
+    machine_i2s_port_obj_t *self = (machine_i2s_port_obj_t *)i2s;
+    bool rx = i2s->mode == MACHINE_I2S_RX;
+
+    machine_i2s_pin_config(i2s->sck, i2s->id);
+    machine_i2s_pin_config(i2s->ws, i2s->id);
+    machine_i2s_pin_config(i2s->sd, i2s->id);
+
+    if (self->dma_alloc == NULL) {
+        self->dma_alloc = m_new(uint8_t, 2 * I2S_DMA_HALF_SIZE + 31);
+        self->dma_buf = (uint8_t *)(((uintptr_t)self->dma_alloc + 31) & ~31);
+    }
+    memset(self->dma_buf, 0, 2 * I2S_DMA_HALF_SIZE);
+    MP_HAL_CLEANINVALIDATE_DCACHE(self->dma_buf, 2 * I2S_DMA_HALF_SIZE);
+
+    machine_i2s_clock_config(i2s->rate);
+    I2S_HandleTypeDef *hi2s = &self->hi2s;
+    memset(hi2s, 0, sizeof(*hi2s));
+    if (i2s->id == 2) {
+        __HAL_RCC_SPI2_CLK_ENABLE();
+        hi2s->Instance = SPI2;
+        self->dma_descr = rx ? &dma_I2S_2_RX : &dma_I2S_2_TX;
+    } else {
+        __HAL_RCC_SPI3_CLK_ENABLE();
+        hi2s->Instance = SPI3;
+        self->dma_descr = rx ? &dma_I2S_3_RX : &dma_I2S_3_TX;
+    }
+    hi2s->Init.Mode = rx ? I2S_MODE_MASTER_RX : I2S_MODE_MASTER_TX;
+    hi2s->Init.Standard = I2S_STANDARD_PHILIPS;
+    hi2s->Init.DataFormat = i2s->bits == 16 ? I2S_DATAFORMAT_16B : I2S_DATAFORMAT_32B;
+    hi2s->Init.MCLKOutput = I2S_MCLKOUTPUT_DISABLE;
+    hi2s->Init.AudioFreq = i2s->rate;
+    hi2s->Init.CPOL = I2S_CPOL_LOW;
+    #if defined(STM32F4)
+    hi2s->Init.ClockSource = I2S_CLOCK_PLL;
+    hi2s->Init.FullDuplexMode = I2S_FULLDUPLEXMODE_DISABLE;
+    #endif
+    if (HAL_I2S_Init(hi2s) != HAL_OK) {
+        mp_raise_ValueError(MP_ERROR_TEXT("I2S init failed"));
+    }
+
+    // The stream may have been set up for SPI with the same channel, so make
+    // dma_init() apply the circular configuration.
+    dma_invalidate_channel(self->dma_descr);
+    dma_init(&self->hdma, self->dma_descr, rx ? DMA_PERIPH_TO_MEMORY : DMA_MEMORY_TO_PERIPH, hi2s);
+    // The DMA counts 16-bit samples, or 32-bit ones in two halves.
+    uint16_t n = 2 * I2S_DMA_HALF_SIZE / (i2s->bits / 8);
+    HAL_StatusTypeDef status;
+    if (rx) {
+        hi2s->hdmarx = &self->hdma;
+        status = HAL_I2S_Receive_DMA(hi2s, (uint16_t *)self->dma_buf, n);
+    } else {
+        hi2s->hdmatx = &self->hdma;
+        status = HAL_I2S_Transmit_DMA(hi2s, (uint16_t *)self->dma_buf, n);
+    }
+    if (status != HAL_OK) {
+        mp_machine_i2s_port_stop(i2s);
+        mp_raise_OSError(MP_EIO);
+    }
+}
+
+void mp_machine_i2s_port_stop(machine_i2s_obj_t *i2s) {
+    machine_i2s_port_obj_t *self = (machine_i2s_port_obj_t *)i2s;
+    HAL_I2S_DMAStop(&self->hi2s);
+    HAL_I2S_DeInit(&self->hi2s);
+    dma_deinit(self->dma_descr);
+    // Let the next user of the stream, eg SPI, configure it again.
+    dma_invalidate_channel(self->dma_descr);
+    if (i2s->id == 2) {
+        __HAL_RCC_SPI2_CLK_DISABLE();
+    } else {
+        __HAL_RCC_SPI3_CLK_DISABLE();
+    }
+}
+
+void machine_i2s_deinit_all(void) {
+    for (size_t i = 0; i < MP_ARRAY_SIZE(MP_STATE_PORT(machine_i2s_obj)); ++i) {
+        machine_i2s_port_obj_t *self = MP_STATE_PORT(machine_i2s_obj)[i];
+        if (self != NULL) {
+            machine_i2s_deinit(&self->i2s);
+            MP_STATE_PORT(machine_i2s_obj)[i] = NULL;
+        }
+    }
+}
+
+// The peripheral sends a 32-bit sample as its upper half then its lower half,
+// which the DMA stores as two 16-bit words in that order.
+STATIC void machine_i2s_swap_halves(uint8_t *buf, size_t len) {
+    uint32_t *p = (uint32_t *)buf;
+    for (size_t i = 0; i < len / 4; ++i) {
+        p[i] = p[i] << 16 | p[i] >> 16;
+    }
+}
+
+STATIC void machine_i2s_dma_half(I2S_HandleTypeDef *hi2s, size_t half) {
+    machine_i2s_port_obj_t *self = (machine_i2s_port_obj_t *)((uint8_t *)hi2s - offsetof(machine_i2s_port_obj_t, hi2s));
+    uint8_t *buf = self->dma_buf + half * I2S_DMA_HALF_SIZE;
+    if (self->i2s.mode == MACHINE_I2S_RX) {
+        MP_HAL_CLEANINVALIDATE_DCACHE(buf, I2S_DMA_HALF_SIZE);
+        if (self->i2s.bits == 32) {
+            machine_i2s_swap_halves(buf, I2S_DMA_HALF_SIZE);
+        }
+        machine_i2s_dma_rx(&self->i2s, buf, I2S_DMA_HALF_SIZE, true);
+        // Write back the changes made in place before the DMA comes back here.
+        MP_HAL_CLEANINVALIDATE_DCACHE(buf, I2S_DMA_HALF_SIZE);
+    } else {
+        machine_i2s_dma_tx(&self->i2s, buf, I2S_DMA_HALF_SIZE, true);
+        if (self->i2s.bits == 32) {
+            machine_i2s_swap_halves(buf, I2S_DMA_HALF_SIZE);
+        }
+        MP_HAL_CLEAN_DCACHE(buf, I2S_DMA_HALF_SIZE);
+    }
+}
+
+void HAL_I2S_RxHalfCpltCallback(I2S_HandleTypeDef *hi2s) {
+    machine_i2s_dma_half(hi2s, 0);
+}
+
+void HAL_I2S_RxCpltCallback(I2S_HandleTypeDef *hi2s) {
+    machine_i2s_dma_half(hi2s, 1);
+}
+
+void HAL_I2S_TxHalfCpltCallback(I2S_HandleTypeDef *hi2s) {
+    machine_i2s_dma_half(hi2s, 0);
+}
+
+void HAL_I2S_TxCpltCallback(I2S_HandleTypeDef *hi2s) {
+    machine_i2s_dma_half(hi2s, 1);
+}
+
+#endif // MICROPY_PY_MACHINE_I2S
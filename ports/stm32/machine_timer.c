@@ -35,17 +35,22 @@ const mp_obj_type_t machine_timer_type;
 STATIC void machine_timer_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
     machine_timer_obj_t *self = MP_OBJ_TO_PTR(self_in);
     qstr mode = self->mode == SOFT_TIMER_MODE_ONE_SHOT ? MP_QSTR_ONE_SHOT : MP_QSTR_PERIODIC;
-    mp_printf(print, "Timer(mode=%q, period=%u)", mode, self->delta_ms);
+    #if SOFT_TIMER_TICKS_PER_MS == 1
+    mp_printf(print, "Timer(mode=%q, period=%u)", mode, self->delta);
+    #else
+    mp_printf(print, "Timer(mode=%q, period=%u, tick_hz=%u)", mode, self->delta, SOFT_TIMER_TICKS_PER_MS * 1000);
+    #endif
 }
 
 STATIC mp_obj_t machine_timer_init_helper(machine_timer_obj_t *self, size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
-    enum { ARG_mode, ARG_callback, ARG_period, ARG_tick_hz, ARG_freq, };
+    enum { ARG_mode, ARG_callback, ARG_period, ARG_tick_hz, ARG_freq, ARG_slack, };
     static const mp_arg_t allowed_args[] = {
         { MP_QSTR_mode,         MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = SOFT_TIMER_MODE_PERIODIC} },
         { MP_QSTR_callback,     MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
         { MP_QSTR_period,       MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 0xffffffff} },
         { MP_QSTR_tick_hz,      MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 1000} },
         { MP_QSTR_freq,         MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+        { MP_QSTR_slack,        MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 0} },
     };
 
     // Parse args
@@ -54,32 +59,38 @@ STATIC mp_obj_t machine_timer_init_helper(machine_timer_obj_t *self, size_t n_ar
 
     self->mode = args[ARG_mode].u_int;
 
-    uint64_t delta_ms = self->delta_ms;
+    // The period and slack are converted to soft timer ticks
+    const uint32_t ticks_per_s = SOFT_TIMER_TICKS_PER_MS * 1000;
+    uint64_t delta = self->delta;
     if (args[ARG_freq].u_obj != mp_const_none) {
         // Frequency specified in Hz
         #if MICROPY_PY_BUILTINS_FLOAT
-        delta_ms = (uint32_t)(MICROPY_FLOAT_CONST(1000.0) / mp_obj_get_float(args[ARG_freq].u_obj));
+        delta = (uint32_t)((mp_float_t)ticks_per_s / mp_obj_get_float(args[ARG_freq].u_obj));
         #else
-        delta_ms = 1000 / mp_obj_get_int(args[ARG_freq].u_obj);
+        delta = ticks_per_s / mp_obj_get_int(args[ARG_freq].u_obj);
         #endif
     } else if (args[ARG_period].u_int != 0xffffffff) {
         // Period specified
-        delta_ms = (uint64_t)args[ARG_period].u_int * 1000 / args[ARG_tick_hz].u_int;
+        delta = (uint64_t)args[ARG_period].u_int * ticks_per_s / args[ARG_tick_hz].u_int;
     }
 
-    if (delta_ms < 1) {
-        delta_ms = 1;
-    } else if (delta_ms >= 0x40000000) {
+    if (delta < 1) {
+        delta = 1;
+    } else if (delta >= 0x40000000) {
         mp_raise_ValueError(MP_ERROR_TEXT("period too large"));
     }
-    self->delta_ms = (uint32_t)delta_ms;
+    self->delta = (uint32_t)delta;
+
+    // Slack is in the units of the period
+    uint64_t slack = (uint64_t)args[ARG_slack].u_int * ticks_per_s / args[ARG_tick_hz].u_int;
+    soft_timer_set_slack(self, MIN(slack, 0x40000000));
 
     if (args[ARG_callback].u_obj != MP_OBJ_NULL) {
         self->py_callback = args[ARG_callback].u_obj;
     }
 
     if (self->py_callback != mp_const_none) {
-        soft_timer_insert(self, self->delta_ms);
+        soft_timer_insert(self, self->delta);
     }
 
     return mp_const_none;
@@ -89,7 +100,8 @@ STATIC mp_obj_t machine_timer_make_new(const mp_obj_type_t *type, size_t n_args,
     machine_timer_obj_t *self = m_new_obj(machine_timer_obj_t);
     self->pairheap.base.type = &machine_timer_type;
     self->flags = SOFT_TIMER_FLAG_PY_CALLBACK | SOFT_TIMER_FLAG_GC_ALLOCATED;
-    self->delta_ms = 1000;
+    self->delta = 1000 * SOFT_TIMER_TICKS_PER_MS;
+    self->slack_mask = 0;
     self->py_callback = mp_const_none;
 
     // Get timer id (only soft timer (-1) supported at the moment)
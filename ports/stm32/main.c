@@ -34,6 +34,7 @@
 #include "py/mphal.h"
 #include "lib/mp-readline/readline.h"
 #include "lib/utils/pyexec.h"
+#include "lib/utils/stdout_buffer.h"
 #include "lib/oofatfs/ff.h"
 #include "lib/littlefs/lfs1.h"
 #include "lib/littlefs/lfs1_util.h"
@@ -63,6 +64,7 @@
 #include "gccollect.h"
 #include "factoryreset.h"
 #include "modmachine.h"
+#include "portmodules.h"
 #include "softtimer.h"
 #include "i2c.h"
 #include "spi.h"
@@ -81,6 +83,7 @@
 #include "accel.h"
 #include "servo.h"
 #include "dac.h"
+#include "dma2d.h"
 #include "can.h"
 #include "modnetwork.h"
 
@@ -490,7 +493,15 @@ soft_reset:
     mp_stack_set_limit((char *)&_estack - (char *)&_sstack - 1024);
 
     // GC init
+    #if MICROPY_GC_SPLIT_HEAP && MICROPY_HW_SDRAM_SIZE
+    // internal SRAM is preferred for small objects and SDRAM for large ones
+    gc_init(&_heap_start, &_heap_end);
+    if (sdram_valid) {
+        gc_add_region(sdram_start(), sdram_end(), GC_REGION_FLAG_LARGE);
+    }
+    #else
     gc_init(MICROPY_HEAP_START, MICROPY_HEAP_END);
+    #endif
 
     #if MICROPY_ENABLE_PYSTACK
     static mp_obj_t pystack[384];
@@ -518,6 +529,7 @@ soft_reset:
     pin_init0();
     extint_init0();
     timer_init0();
+    soft_timer_init();
 
     #if MICROPY_HW_ENABLE_CAN
     can_init0();
@@ -628,6 +640,8 @@ soft_reset_exit:
 
     // soft reset
 
+    mp_hal_stdout_buffer_flush();
+
     MICROPY_BOARD_START_SOFT_RESET(&state);
 
     #if MICROPY_HW_ENABLE_STORAGE
@@ -653,7 +667,16 @@ soft_reset_exit:
     #if MICROPY_HW_ENABLE_CAN
     can_deinit_all();
     #endif
+    #if MICROPY_PY_MACHINE_I2S
+    machine_i2s_deinit_all();
+    #endif
+    #if MICROPY_PY_STM_DMA
+    stm_dma_deinit_all();
+    #endif
     machine_deinit();
+    #if MICROPY_HW_ENABLE_DMA2D
+    dma2d_deinit();
+    #endif
 
     #if MICROPY_PY_THREAD
     pyb_thread_deinit();
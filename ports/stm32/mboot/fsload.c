@@ -27,6 +27,7 @@
 #include <string.h>
 
 #include "py/mphal.h"
+#include "extmod/uzlib/uzlib.h"
 #include "mboot.h"
 #include "pack.h"
 #include "vfs.h"
@@ -36,8 +37,18 @@
 #define MBOOT_FSLOAD_DEFAULT_BLOCK_SIZE (4096)
 #endif
 
+// Size of the buffer that element data is read into and written to flash from.
+// Larger buffers mean fewer (and longer) filesystem reads and flash writes.
+#ifndef MBOOT_FSLOAD_BUFFER_SIZE
+#define MBOOT_FSLOAD_BUFFER_SIZE (2048)
+#endif
+
 #if MBOOT_FSLOAD
 
+#if MBOOT_FSLOAD_BUFFER_SIZE < 274
+#error MBOOT_FSLOAD_BUFFER_SIZE must hold the DFU target header
+#endif
+
 #if !(MBOOT_VFS_FAT || MBOOT_VFS_LFS1 || MBOOT_VFS_LFS2)
 #error Must enable at least one VFS component
 #endif
@@ -72,13 +83,65 @@ static inline int input_stream_read(size_t len, uint8_t *buf) {
 }
 #endif
 
+#if defined(CRC_CR_REV_IN) && defined(CRC_POL_POL)
+// Use the CRC peripheral, which computes the standard CRC-32 when its input
+// and output are bit reversed.  The result is not inverted, as in the DFU suffix.
+
+static void fsload_crc_init(void) {
+    __HAL_RCC_CRC_CLK_ENABLE();
+    CRC->INIT = 0xffffffff;
+    CRC->POL = 0x04c11db7;
+    CRC->CR = CRC_CR_REV_IN_0 | CRC_CR_REV_OUT | CRC_CR_RESET;
+}
+
+static void fsload_crc_update(const uint8_t *buf, size_t len) {
+    while (len--) {
+        *(volatile uint8_t *)&CRC->DR = *buf++;
+    }
+}
+
+static uint32_t fsload_crc_final(void) {
+    return CRC->DR;
+}
+
+#else
+
+static uint32_t fsload_crc;
+
+static void fsload_crc_init(void) {
+    fsload_crc = 0xffffffff;
+}
+
+static void fsload_crc_update(const uint8_t *buf, size_t len) {
+    fsload_crc = uzlib_crc32(buf, len, fsload_crc);
+}
+
+static uint32_t fsload_crc_final(void) {
+    return fsload_crc;
+}
+
+#endif
+
+// Read from the input stream and include the data in the CRC of the file.
+static int fsload_read(size_t len, uint8_t *buf) {
+    int res = input_stream_read(len, buf);
+    if (res > 0) {
+        fsload_crc_update(buf, res);
+    }
+    return res;
+}
+
+static uint8_t fsload_buf[MBOOT_FSLOAD_BUFFER_SIZE] __attribute__((aligned(8)));
+
 static int fsload_program_file(bool write_to_flash) {
     // Parse DFU
-    uint8_t buf[512];
+    uint8_t *buf = fsload_buf;
     size_t file_offset;
 
+    fsload_crc_init();
+
     // Read file header, <5sBIB
-    int res = input_stream_read(11, buf);
+    int res = fsload_read(11, buf);
     if (res != 11) {
         return -MBOOT_ERRNO_DFU_READ_ERROR;
     }
@@ -98,7 +161,7 @@ static int fsload_program_file(bool write_to_flash) {
     uint32_t total_size = get_le32(buf + 6);
 
     // Read target header, <6sBi255sII
-    res = input_stream_read(274, buf);
+    res = fsload_read(274, buf);
     if (res != 274) {
         return -MBOOT_ERRNO_DFU_READ_ERROR;
     }
@@ -118,7 +181,7 @@ static int fsload_program_file(bool write_to_flash) {
     // Parse each element
     for (size_t elem = 0; elem < num_elems; ++elem) {
         // Read element header, <II
-        res = input_stream_read(8, buf);
+        res = fsload_read(8, buf);
         if (res != 8) {
             return -MBOOT_ERRNO_DFU_READ_ERROR;
         }
@@ -144,10 +207,10 @@ static int fsload_program_file(bool write_to_flash) {
         // Read element data and possibly write to flash
         for (uint32_t s = elem_size; s;) {
             uint32_t l = s;
-            if (l > sizeof(buf)) {
-                l = sizeof(buf);
+            if (l > sizeof(fsload_buf)) {
+                l = sizeof(fsload_buf);
             }
-            res = input_stream_read(l, buf);
+            res = fsload_read(l, buf);
             if (res != l) {
                 return -MBOOT_ERRNO_DFU_READ_ERROR;
             }
@@ -172,19 +235,23 @@ static int fsload_program_file(bool write_to_flash) {
         return -MBOOT_ERRNO_DFU_INVALID_SIZE;
     }
 
-    // Read trailing info
+    // Read trailing info, the CRC32 of the file excludes its last 4 bytes
     res = input_stream_read(16, buf);
     if (res != 16) {
         return -MBOOT_ERRNO_DFU_READ_ERROR;
     }
+    fsload_crc_update(buf, 12);
 
-    // TODO validate CRC32
+    if (get_le32(buf + 12) != fsload_crc_final()) {
+        return -MBOOT_ERRNO_DFU_INVALID_CRC;
+    }
 
     return 0;
 }
 
 static int fsload_validate_and_program_file(void *stream, const stream_methods_t *meth, const char *fname) {
-    // First pass verifies the file, second pass programs it
+    // First pass verifies the file, including its CRC, second pass programs it.
+    // A corrupt file is thus rejected before any flash is erased.
     for (unsigned int pass = 0; pass <= 1; ++pass) {
         led_state_all(pass == 0 ? 2 : 4);
         int res = meth->open(stream, fname);
@@ -525,6 +525,17 @@ static int mboot_flash_page_erase(uint32_t addr, uint32_t *next_addr) {
 
     *next_addr = sector_start + sector_size;
 
+    // Skip the erase if the sector is already blank, which is much quicker to
+    // check than to erase, eg for flash beyond the end of the previous firmware.
+    const volatile uint32_t *sector_data = (const volatile uint32_t *)sector_start;
+    size_t i = 0;
+    while (i < sector_size / sizeof(uint32_t) && sector_data[i] == 0xffffffff) {
+        ++i;
+    }
+    if (i == sector_size / sizeof(uint32_t)) {
+        return 0;
+    }
+
     // Erase the flash page.
     int ret = flash_erase(sector_start, sector_size / sizeof(uint32_t));
     if (ret != 0) {
@@ -49,6 +49,7 @@ enum {
     MBOOT_ERRNO_DFU_INVALID_SIZE,
     MBOOT_ERRNO_DFU_TOO_MANY_TARGETS,
     MBOOT_ERRNO_DFU_READ_ERROR,
+    MBOOT_ERRNO_DFU_INVALID_CRC,
 
     MBOOT_ERRNO_FSLOAD_NO_FSLOAD = 220,
     MBOOT_ERRNO_FSLOAD_NO_MOUNT,
@@ -35,8 +35,10 @@
 #include "py/mphal.h"
 #include "extmod/machine_mem.h"
 #include "extmod/machine_signal.h"
+#include "extmod/machine_pingroup.h"
 #include "extmod/machine_pulse.h"
 #include "extmod/machine_i2c.h"
+#include "extmod/machine_i2s.h"
 #include "extmod/machine_spi.h"
 #include "lib/utils/pyexec.h"
 #include "lib/oofatfs/ff.h"
@@ -50,6 +52,7 @@
 #include "storage.h"
 #include "pin.h"
 #include "timer.h"
+#include "softtimer.h"
 #include "usb.h"
 #include "rtc.h"
 #include "i2c.h"
@@ -343,6 +346,9 @@ STATIC mp_obj_t machine_freq(size_t n_args, const mp_obj_t *args) {
             void NORETURN __fatal_error(const char *msg);
             __fatal_error("can't change freq");
         }
+        #if MICROPY_HW_SOFTTIMER_TIM
+        soft_timer_tim_update_freq();
+        #endif
         return mp_const_none;
         #endif
     }
@@ -416,6 +422,9 @@ STATIC const mp_rom_map_elem_t machine_module_globals_table[] = {
 
     { MP_ROM_QSTR(MP_QSTR_Pin),                 MP_ROM_PTR(&pin_type) },
     { MP_ROM_QSTR(MP_QSTR_Signal),              MP_ROM_PTR(&machine_signal_type) },
+    #if MICROPY_PY_MACHINE_PINGROUP
+    { MP_ROM_QSTR(MP_QSTR_PinGroup),            MP_ROM_PTR(&machine_pingroup_type) },
+    #endif
 
     { MP_ROM_QSTR(MP_QSTR_RTC),                 MP_ROM_PTR(&pyb_rtc_type) },
     { MP_ROM_QSTR(MP_QSTR_ADC),                 MP_ROM_PTR(&machine_adc_type) },
@@ -427,6 +436,9 @@ STATIC const mp_rom_map_elem_t machine_module_globals_table[] = {
     #endif
     { MP_ROM_QSTR(MP_QSTR_SoftI2C),             MP_ROM_PTR(&mp_machine_soft_i2c_type) },
     #endif
+    #if MICROPY_PY_MACHINE_I2S
+    { MP_ROM_QSTR(MP_QSTR_I2S),                 MP_ROM_PTR(&machine_i2s_type) },
+    #endif
     #if MICROPY_PY_MACHINE_SPI
     { MP_ROM_QSTR(MP_QSTR_SPI),                 MP_ROM_PTR(&machine_hard_spi_type) },
     { MP_ROM_QSTR(MP_QSTR_SoftSPI),             MP_ROM_PTR(&mp_machine_soft_spi_type) },
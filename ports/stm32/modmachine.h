@@ -34,6 +34,7 @@ extern const mp_obj_type_t machine_hard_i2c_type;
 
 void machine_init(void);
 void machine_deinit(void);
+void machine_i2s_deinit_all(void);
 
 MP_DECLARE_CONST_FUN_OBJ_VAR_BETWEEN(machine_info_obj);
 MP_DECLARE_CONST_FUN_OBJ_0(machine_unique_id_obj);
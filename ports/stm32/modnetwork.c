@@ -45,6 +45,8 @@
 #include "lwip/dns.h"
 #include "lwip/dhcp.h"
 #include "lwip/apps/mdns.h"
+#include "lwip/memp.h"
+#include "lwip/stats.h"
 #include "extmod/network_cyw43.h"
 #include "drivers/cyw43/cyw43.h"
 
@@ -122,6 +124,44 @@ STATIC mp_obj_t network_route(void) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_0(network_route_obj, network_route);
 
+#if MICROPY_PY_LWIP && MEM_STATS && MEMP_STATS
+
+// network.lwip_stats(): a dict of the use of lwIP's heap, named "MEM", and of
+// each of its memory pools, named as in lwip/priv/memp_std.h.  Each value is a
+// tuple of (available, used, max_used, failures).
+STATIC mp_obj_t network_lwip_stats(void) {
+    static const char *const memp_names[] = {
+        #define LWIP_MEMPOOL(name, num, size, desc) #name,
+        #include "lwip/priv/memp_std.h"
+    };
+
+    // Take a copy first, the dict can't be built with the lwIP lock held
+    mp_uint_t stats[1 + MEMP_MAX][4];
+    MICROPY_PY_LWIP_ENTER
+    for (size_t i = 0; i <= MEMP_MAX; ++i) {
+        const struct stats_mem *s = i == 0 ? &lwip_stats.mem : lwip_stats.memp[i - 1];
+        stats[i][0] = s->avail;
+        stats[i][1] = s->used;
+        stats[i][2] = s->max;
+        stats[i][3] = s->err;
+    }
+    MICROPY_PY_LWIP_EXIT
+
+    mp_obj_t dict = mp_obj_new_dict(1 + MEMP_MAX);
+    for (size_t i = 0; i <= MEMP_MAX; ++i) {
+        const char *name = i == 0 ? "MEM" : memp_names[i - 1];
+        mp_obj_t items[4];
+        for (size_t j = 0; j < 4; ++j) {
+            items[j] = mp_obj_new_int_from_uint(stats[i][j]);
+        }
+        mp_obj_dict_store(dict, mp_obj_new_str(name, strlen(name)), mp_obj_new_tuple(4, items));
+    }
+    return dict;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(network_lwip_stats_obj, network_lwip_stats);
+
+#endif
+
 STATIC const mp_rom_map_elem_t mp_module_network_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_network) },
 
@@ -140,6 +180,9 @@ STATIC const mp_rom_map_elem_t mp_module_network_globals_table[] = {
     #endif
 
     { MP_ROM_QSTR(MP_QSTR_route), MP_ROM_PTR(&network_route_obj) },
+    #if MICROPY_PY_LWIP && MEM_STATS && MEMP_STATS
+    { MP_ROM_QSTR(MP_QSTR_lwip_stats), MP_ROM_PTR(&network_lwip_stats_obj) },
+    #endif
 
     // Constants
     #if MICROPY_PY_NETWORK_CYW43
@@ -37,6 +37,15 @@
 #define MICROPY_PY_STM (1)
 #endif
 
+// Whether to include stm.DMA, for transfers on DMA streams claimed at run time
+#ifndef MICROPY_PY_STM_DMA
+#if defined(STM32F4) || defined(STM32F7)
+#define MICROPY_PY_STM_DMA (MICROPY_PY_STM)
+#else
+#define MICROPY_PY_STM_DMA (0)
+#endif
+#endif
+
 // Whether to include the pyb module
 #ifndef MICROPY_PY_PYB
 #define MICROPY_PY_PYB (1)
@@ -72,11 +81,24 @@
 #define MICROPY_HW_ENABLE_ADC (1)
 #endif
 
+// Whether the I2S alternate functions of the pins are available, for machine.I2S
+#ifndef MICROPY_HW_ENABLE_I2S2
+#define MICROPY_HW_ENABLE_I2S2 (MICROPY_PY_MACHINE_I2S)
+#endif
+#ifndef MICROPY_HW_ENABLE_I2S3
+#define MICROPY_HW_ENABLE_I2S3 (MICROPY_PY_MACHINE_I2S)
+#endif
+
 // Whether to enable the DAC peripheral, exposed as pyb.DAC
 #ifndef MICROPY_HW_ENABLE_DAC
 #define MICROPY_HW_ENABLE_DAC (0)
 #endif
 
+// Whether to offload framebuf fills and blits to the DMA2D peripheral
+#ifndef MICROPY_HW_ENABLE_DMA2D
+#define MICROPY_HW_ENABLE_DMA2D (0)
+#endif
+
 // Whether to enable the DCMI peripheral
 #ifndef MICROPY_HW_ENABLE_DCMI
 #define MICROPY_HW_ENABLE_DCMI (0)
@@ -147,6 +169,15 @@
 #define MICROPY_HW_FLASH_MOUNT_AT_BOOT (MICROPY_HW_ENABLE_STORAGE)
 #endif
 
+// Whether the ETH MAC keeps a PTP clock and timestamps frames with it
+#ifndef MICROPY_HW_ETH_PTP
+#if defined(MICROPY_HW_ETH_MDC)
+#define MICROPY_HW_ETH_PTP (1)
+#else
+#define MICROPY_HW_ETH_PTP (0)
+#endif
+#endif
+
 // The volume label used when creating the flash filesystem
 #ifndef MICROPY_HW_FLASH_FS_LABEL
 #define MICROPY_HW_FLASH_FS_LABEL "pybflash"
@@ -172,6 +203,14 @@
 #define MICROPY_HW_TIM_IS_RESERVED(tim_id) (false)
 #endif
 
+// Hardware timer that drives the soft timers (machine.Timer) with microsecond
+// resolution, interrupting only when a timer is due.  It can be 2, for the
+// 32-bit TIM2, which is then reserved.  With 0 SysTick drives them with
+// millisecond resolution.
+#ifndef MICROPY_HW_SOFTTIMER_TIM
+#define MICROPY_HW_SOFTTIMER_TIM (0)
+#endif
+
 // Function to determine if the given uart_id is reserved for system use or not.
 #ifndef MICROPY_HW_UART_IS_RESERVED
 #define MICROPY_HW_UART_IS_RESERVED(uart_id) (false)
@@ -365,6 +404,16 @@
 #define MICROPY_HW_SPIFLASH_ENABLE_CACHE (0)
 #endif
 
+// Whether the hardware QSPI uses DMA to read from the flash in indirect mode,
+// rather than the CPU polling its FIFO.
+#ifndef MICROPY_HW_QSPI_USE_DMA
+#if defined(STM32F4) || defined(STM32F7)
+#define MICROPY_HW_QSPI_USE_DMA (1)
+#else
+#define MICROPY_HW_QSPI_USE_DMA (0)
+#endif
+#endif
+
 // Enable the storage sub-system if a block device is defined
 #if defined(MICROPY_HW_BDEV_IOCTL)
 #define MICROPY_HW_ENABLE_STORAGE (1)
@@ -59,26 +59,33 @@
 #define MICROPY_OPT_COMPUTED_GOTO   (1)
 #define MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE (0)
 #define MICROPY_OPT_MPZ_BITWISE     (1)
+#define MICROPY_OPT_ARG_SLOT_CACHE  (1)
 #define MICROPY_OPT_MATH_FACTORIAL  (1)
 
 // Python internal features
 #define MICROPY_READER_VFS          (1)
 #define MICROPY_ENABLE_GC           (1)
+#define MICROPY_GC_STATS            (1)
 #define MICROPY_ENABLE_FINALISER    (1)
 #define MICROPY_STACK_CHECK         (1)
 #define MICROPY_ENABLE_EMERGENCY_EXCEPTION_BUF (1)
 #define MICROPY_EMERGENCY_EXCEPTION_BUF_SIZE (0)
 #define MICROPY_KBD_EXCEPTION       (1)
+#ifndef MICROPY_HAL_STDOUT_BUFFER_SIZE
+#define MICROPY_HAL_STDOUT_BUFFER_SIZE (256)
+#endif
 #define MICROPY_HELPER_REPL         (1)
 #define MICROPY_REPL_INFO           (1)
 #define MICROPY_REPL_EMACS_KEYS     (1)
 #define MICROPY_REPL_AUTO_INDENT    (1)
+#define MICROPY_REPL_FILE_TRANSFER  (MICROPY_PY_UZLIB)
 #define MICROPY_LONGINT_IMPL        (MICROPY_LONGINT_IMPL_MPZ)
 #define MICROPY_ENABLE_SOURCE_LINE  (1)
 #ifndef MICROPY_FLOAT_IMPL // can be configured by each board via mpconfigboard.mk
 #define MICROPY_FLOAT_IMPL          (MICROPY_FLOAT_IMPL_FLOAT)
 #endif
 #define MICROPY_STREAMS_NON_BLOCK   (1)
+#define MICROPY_STREAMS_READLINE_INTO (1)
 #define MICROPY_MODULE_BUILTIN_INIT (1)
 #define MICROPY_MODULE_WEAK_LINKS   (1)
 #define MICROPY_CAN_OVERRIDE_BUILTINS (1)
@@ -86,6 +93,10 @@
 #define MICROPY_ENABLE_SCHEDULER    (1)
 #define MICROPY_SCHEDULER_DEPTH     (8)
 #define MICROPY_VFS                 (1)
+#define MICROPY_VFS_BLOCKDEV_CACHE  (1)
+#define MICROPY_VFS_MMAP            (1)
+#define MICROPY_VFS_FAT_READAHEAD_BLOCKS (8)
+#define MICROPY_VFS_IMPORT_STAT_CACHE (1)
 
 // control over Python builtins
 #define MICROPY_PY_FUNCTION_ATTRS   (1)
@@ -119,7 +130,10 @@
 #define MICROPY_PY_MATH_SPECIAL_FUNCTIONS (1)
 #define MICROPY_PY_MATH_ISCLOSE     (1)
 #define MICROPY_PY_MATH_FACTORIAL   (1)
+#define MICROPY_PY_MATH_FSUM        (1)
+#define MICROPY_PY_MATH_APPLY       (1)
 #define MICROPY_PY_CMATH            (1)
+#define MICROPY_PY_STRUCT_OBJECT    (1)
 #define MICROPY_PY_IO               (1)
 #define MICROPY_PY_IO_IOBASE        (1)
 #define MICROPY_PY_IO_FILEIO        (MICROPY_VFS_FAT || MICROPY_VFS_LFS1 || MICROPY_VFS_LFS2)
@@ -142,6 +156,9 @@
 #ifndef MICROPY_PY_UCTYPES
 #define MICROPY_PY_UCTYPES          (1)
 #endif
+#ifndef MICROPY_PY_UCTYPES_COMPILE
+#define MICROPY_PY_UCTYPES_COMPILE  (1)
+#endif
 #ifndef MICROPY_PY_UZLIB
 #define MICROPY_PY_UZLIB            (1)
 #endif
@@ -172,6 +189,7 @@
 #endif
 #define MICROPY_PY_OS_DUPTERM       (3)
 #define MICROPY_PY_UOS_DUPTERM_BUILTIN_STREAM (1)
+#define MICROPY_PY_OS_DUPTERM_RX_BUF_SIZE (32)
 #ifndef MICROPY_PY_URANDOM
 #define MICROPY_PY_URANDOM          (1)
 #define MICROPY_PY_URANDOM_SEED_INIT_FUNC (rng_get())
@@ -179,6 +197,9 @@
 #ifndef MICROPY_PY_URANDOM_EXTRA_FUNCS
 #define MICROPY_PY_URANDOM_EXTRA_FUNCS (1)
 #endif
+#ifndef MICROPY_PY_URANDOM_XOSHIRO
+#define MICROPY_PY_URANDOM_XOSHIRO  (1)
+#endif
 #define MICROPY_PY_USELECT          (1)
 #ifndef MICROPY_PY_UTIME
 #define MICROPY_PY_UTIME            (1)
@@ -191,19 +212,37 @@
 #ifndef MICROPY_PY_MACHINE
 #define MICROPY_PY_MACHINE          (1)
 #define MICROPY_PY_MACHINE_PULSE    (1)
+#define MICROPY_PY_MACHINE_PINGROUP (1)
 #define MICROPY_PY_MACHINE_PIN_MAKE_NEW mp_pin_make_new
 #define MICROPY_PY_MACHINE_I2C      (1)
+#define MICROPY_PY_MACHINE_I2C_TRANSFER_BATCH (1)
 #define MICROPY_PY_MACHINE_SPI      (1)
 #define MICROPY_PY_MACHINE_SPI_MSB  (SPI_FIRSTBIT_MSB)
 #define MICROPY_PY_MACHINE_SPI_LSB  (SPI_FIRSTBIT_LSB)
 #endif
+#ifndef MICROPY_PY_MACHINE_I2S
+#if defined(STM32F405xx) || defined(STM32F407xx) || defined(STM32F411xE) || defined(STM32F427xx) || defined(STM32F429xx) || defined(STM32F7)
+#define MICROPY_PY_MACHINE_I2S      (MICROPY_PY_MACHINE)
+#else
+#define MICROPY_PY_MACHINE_I2S      (0)
+#endif
+#endif
 #define MICROPY_HW_SOFTSPI_MIN_DELAY (0)
 #define MICROPY_HW_SOFTSPI_MAX_BAUDRATE (HAL_RCC_GetSysClockFreq() / 48)
 #define MICROPY_PY_UWEBSOCKET       (MICROPY_PY_LWIP)
 #define MICROPY_PY_WEBREPL          (MICROPY_PY_LWIP)
+#define MICROPY_PY_USOCKET_DNS_CACHE (MICROPY_PY_LWIP)
+#define MICROPY_PY_USOCKET_BATCH    (MICROPY_PY_LWIP)
+#define MICROPY_PY_USOCKET_POOL     (MICROPY_PY_LWIP)
+#define MICROPY_PY_NETWORK_PTP      (MICROPY_PY_LWIP && MICROPY_HW_ETH_PTP)
+#define MICROPY_PY_LWIP_UDP_QUEUE_LEN (4)
 #ifndef MICROPY_PY_FRAMEBUF
 #define MICROPY_PY_FRAMEBUF         (1)
 #endif
+#define MICROPY_PY_FRAMEBUF_ACCEL   (MICROPY_PY_FRAMEBUF && MICROPY_HW_ENABLE_DMA2D)
+#ifndef MICROPY_PY_DISPLAY
+#define MICROPY_PY_DISPLAY          (MICROPY_PY_FRAMEBUF)
+#endif
 #ifndef MICROPY_PY_USOCKET
 #define MICROPY_PY_USOCKET          (1)
 #endif
@@ -380,6 +419,12 @@ struct _mp_bluetooth_btstack_root_pointers_t;
     /* pointers to all UART objects (if they have been created) */ \
     struct _pyb_uart_obj_t *pyb_uart_obj_all[MICROPY_HW_MAX_UART + MICROPY_HW_MAX_LPUART]; \
     \
+    /* pointers to I2S(2) and I2S(3) (if they have been created) */ \
+    struct _machine_i2s_port_obj_t *machine_i2s_obj[2]; \
+    \
+    /* stm.DMA objects, by stream */ \
+    struct _stm_dma_obj_t *stm_dma_obj[16]; \
+    \
     /* pointers to all CAN objects (if they have been created) */ \
     struct _pyb_can_obj_t *pyb_can_obj_all[MICROPY_HW_MAX_CAN]; \
     \
@@ -400,8 +445,9 @@ struct _mp_bluetooth_btstack_root_pointers_t;
 
 #define MP_SSIZE_MAX (0x7fffffff)
 
-// Assume that if we already defined the obj repr then we also defined these items
-#ifndef MICROPY_OBJ_REPR
+// Assume that if we already defined the integer types (as mpconfigport_nanbox.h
+// does) then we also defined these items; a board may still select MICROPY_OBJ_REPR_C
+#ifndef UINT_FMT
 #define UINT_FMT "%u"
 #define INT_FMT "%d"
 typedef int mp_int_t; // must be pointer size
@@ -436,6 +482,7 @@ static inline mp_uint_t disable_irq(void) {
     do { \
         extern void mp_handle_pending(bool); \
         mp_handle_pending(true); \
+        MICROPY_HAL_STDOUT_BUFFER_POLL \
         if (pyb_thread_enabled) { \
             MP_THREAD_GIL_EXIT(); \
             pyb_thread_yield(); \
@@ -451,6 +498,7 @@ static inline mp_uint_t disable_irq(void) {
     do { \
         extern void mp_handle_pending(bool); \
         mp_handle_pending(true); \
+        MICROPY_HAL_STDOUT_BUFFER_POLL \
         __WFI(); \
     } while (0);
 
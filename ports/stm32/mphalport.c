@@ -5,6 +5,7 @@
 #include "py/mperrno.h"
 #include "py/mphal.h"
 #include "extmod/misc.h"
+#include "lib/utils/stdout_buffer.h"
 #include "usb.h"
 #include "uart.h"
 
@@ -32,6 +33,7 @@ MP_WEAK uintptr_t mp_hal_stdio_poll(uintptr_t poll_flags) {
 }
 
 MP_WEAK int mp_hal_stdin_rx_chr(void) {
+    mp_hal_stdout_buffer_flush();
     for (;;) {
         #if 0
         #ifdef USE_HOST_MODE
@@ -57,7 +59,20 @@ void mp_hal_stdout_tx_str(const char *str) {
     mp_hal_stdout_tx_strn(str, strlen(str));
 }
 
+#if MICROPY_HAL_STDOUT_BUFFER_SIZE
 MP_WEAK void mp_hal_stdout_tx_strn(const char *str, size_t len) {
+    if (__get_IPSR() == 0) {
+        mp_hal_stdout_buffer_write(str, len);
+    } else {
+        // an IRQ handler may have interrupted a write to the buffer
+        mp_hal_stdout_tx_strn_direct(str, len);
+    }
+}
+
+void mp_hal_stdout_tx_strn_direct(const char *str, size_t len) {
+#else
+MP_WEAK void mp_hal_stdout_tx_strn(const char *str, size_t len) {
+#endif
     if (MP_STATE_PORT(pyb_stdio_uart) != NULL) {
         uart_tx_strn(MP_STATE_PORT(pyb_stdio_uart), str, len);
     }
@@ -25,9 +25,11 @@
  */
 
 #include "py/runtime.h"
+#include "py/objint.h"
 #include "py/mphal.h"
 #include "modnetwork.h"
 #include "eth.h"
+#include "extmod/network_ptp.h"
 
 #if defined(MICROPY_HW_ETH_MDC)
 
@@ -100,6 +102,12 @@ STATIC mp_obj_t network_lan_status(size_t n_args, const mp_obj_t *args) {
         return MP_OBJ_NEW_SMALL_INT(eth_link_status(self->eth));
     }
 
+    #if MICROPY_PY_NETWORK_PTP
+    if (mp_obj_str_get_qstr(args[1]) == MP_QSTR_ptp) {
+        return network_ptp_slave_status();
+    }
+    #endif
+
     mp_raise_ValueError(MP_ERROR_TEXT("unknown status param"));
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(network_lan_status_obj, 1, 2, network_lan_status);
@@ -145,12 +153,106 @@ STATIC mp_obj_t network_lan_config(size_t n_args, const mp_obj_t *args, mp_map_t
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_KW(network_lan_config_obj, 1, network_lan_config);
 
+#if MICROPY_HW_ETH_PTP
+
+STATIC mp_obj_t network_lan_ptp_time(size_t n_args, const mp_obj_t *args) {
+    network_ptp_time_t t;
+
+    if (n_args == 1) {
+        MICROPY_PY_LWIP_ENTER
+        network_ptp_hal_get_time(&t);
+        MICROPY_PY_LWIP_EXIT
+        mp_obj_t tuple[2] = { mp_obj_new_int_from_uint(t.sec), mp_obj_new_int_from_uint(t.nsec) };
+        return mp_obj_new_tuple(2, tuple);
+    } else {
+        mp_obj_t *items;
+        mp_obj_get_array_fixed_n(args[1], 2, &items);
+        t.sec = mp_obj_get_int_truncated(items[0]);
+        t.nsec = mp_obj_get_int(items[1]);
+        if (t.nsec >= 1000000000) {
+            mp_raise_ValueError(NULL);
+        }
+        MICROPY_PY_LWIP_ENTER
+        network_ptp_hal_set_time(&t);
+        MICROPY_PY_LWIP_EXIT
+        return mp_const_none;
+    }
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(network_lan_ptp_time_obj, 1, 2, network_lan_ptp_time);
+
+STATIC mp_obj_t network_lan_ptp_adjust(mp_obj_t self_in, mp_obj_t ns_in) {
+    (void)self_in;
+    int64_t ns;
+    if (mp_obj_is_int(ns_in) && !mp_obj_is_small_int(ns_in)) {
+        mp_obj_int_to_bytes_impl(ns_in, false, sizeof(ns), (byte *)&ns);
+    } else {
+        ns = mp_obj_get_int(ns_in);
+    }
+    MICROPY_PY_LWIP_ENTER
+    network_ptp_hal_step(ns);
+    MICROPY_PY_LWIP_EXIT
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(network_lan_ptp_adjust_obj, network_lan_ptp_adjust);
+
+STATIC mp_obj_t network_lan_ptp_freq(size_t n_args, const mp_obj_t *args) {
+    if (n_args == 1) {
+        return mp_obj_new_int(network_ptp_hal_get_freq());
+    }
+    mp_int_t ppb = mp_obj_get_int(args[1]);
+    if (ppb < -1000000 || ppb > 1000000) {
+        mp_raise_ValueError(NULL);
+    }
+    MICROPY_PY_LWIP_ENTER
+    network_ptp_hal_set_freq(ppb);
+    MICROPY_PY_LWIP_EXIT
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(network_lan_ptp_freq_obj, 1, 2, network_lan_ptp_freq);
+
+#endif
+
+#if MICROPY_PY_NETWORK_PTP
+STATIC mp_obj_t network_lan_ptp_slave(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_active, ARG_domain };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_active, MP_ARG_REQUIRED | MP_ARG_BOOL, {.u_bool = false} },
+        { MP_QSTR_domain, MP_ARG_INT, {.u_int = 0} },
+    };
+    network_lan_obj_t *self = MP_OBJ_TO_PTR(pos_args[0]);
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    int ret = 0;
+    MICROPY_PY_LWIP_ENTER
+    if (args[ARG_active].u_bool) {
+        ret = network_ptp_slave_start(eth_netif(self->eth), args[ARG_domain].u_int);
+    } else {
+        network_ptp_slave_stop();
+    }
+    MICROPY_PY_LWIP_EXIT
+    if (ret < 0) {
+        mp_raise_OSError(-ret);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(network_lan_ptp_slave_obj, 2, network_lan_ptp_slave);
+#endif
+
 STATIC const mp_rom_map_elem_t network_lan_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_active), MP_ROM_PTR(&network_lan_active_obj) },
     { MP_ROM_QSTR(MP_QSTR_isconnected), MP_ROM_PTR(&network_lan_isconnected_obj) },
     { MP_ROM_QSTR(MP_QSTR_ifconfig), MP_ROM_PTR(&network_lan_ifconfig_obj) },
     { MP_ROM_QSTR(MP_QSTR_status), MP_ROM_PTR(&network_lan_status_obj) },
     { MP_ROM_QSTR(MP_QSTR_config), MP_ROM_PTR(&network_lan_config_obj) },
+    #if MICROPY_HW_ETH_PTP
+    { MP_ROM_QSTR(MP_QSTR_ptp_time), MP_ROM_PTR(&network_lan_ptp_time_obj) },
+    { MP_ROM_QSTR(MP_QSTR_ptp_adjust), MP_ROM_PTR(&network_lan_ptp_adjust_obj) },
+    { MP_ROM_QSTR(MP_QSTR_ptp_freq), MP_ROM_PTR(&network_lan_ptp_freq_obj) },
+    #endif
+    #if MICROPY_PY_NETWORK_PTP
+    { MP_ROM_QSTR(MP_QSTR_ptp_slave), MP_ROM_PTR(&network_lan_ptp_slave_obj) },
+    #endif
 };
 STATIC MP_DEFINE_CONST_DICT(network_lan_locals_dict, network_lan_locals_dict_table);
 
@@ -28,8 +28,12 @@
 #include <string.h>
 
 #include "py/runtime.h"
+#include "py/mperrno.h"
 #include "py/mphal.h"
 #include "spi.h"
+#include "extint.h"
+#include "irq.h"
+#include "pendsv.h"
 #include "modnetwork.h"
 
 #if MICROPY_PY_WIZNET5K && MICROPY_PY_LWIP
@@ -44,6 +48,9 @@
 #define TRACE_ETH_TX (0x0002)
 #define TRACE_ETH_RX (0x0004)
 
+// SPI transfers at least this long, ie frame data, use DMA; register accesses are polled
+#define WIZ_SPI_DMA_MIN_LEN (16)
+
 /*******************************************************************************/
 // Wiznet5k Ethernet driver in MACRAW mode
 
@@ -53,6 +60,8 @@ typedef struct _wiznet5k_obj_t {
     const spi_t *spi;
     mp_hal_pin_obj_t cs;
     mp_hal_pin_obj_t rst;
+    mp_hal_pin_obj_t pin_int;
+    bool tx_pending;
     uint8_t eth_frame[1514];
     uint32_t trace_flags;
     struct netif netif;
@@ -64,12 +73,14 @@ STATIC wiznet5k_obj_t wiznet5k_obj;
 
 STATIC void wiznet5k_lwip_init(wiznet5k_obj_t *self);
 
+// Only the lwIP poll, which runs in PENDSV, has to be kept out of an SPI access, so
+// higher priority interrupts, including the SPI DMA, are left enabled.
 STATIC void wiz_cris_enter(void) {
-    wiznet5k_obj.cris_state = MICROPY_BEGIN_ATOMIC_SECTION();
+    wiznet5k_obj.cris_state = raise_irq_pri(IRQ_PRI_PENDSV);
 }
 
 STATIC void wiz_cris_exit(void) {
-    MICROPY_END_ATOMIC_SECTION(wiznet5k_obj.cris_state);
+    restore_irq_pri(wiznet5k_obj.cris_state);
 }
 
 STATIC void wiz_cs_select(void) {
@@ -81,13 +92,21 @@ STATIC void wiz_cs_deselect(void) {
 }
 
 STATIC void wiz_spi_read(uint8_t *buf, uint32_t len) {
-    HAL_StatusTypeDef status = HAL_SPI_Receive(wiznet5k_obj.spi->spi, buf, len, 5000);
-    (void)status;
+    if (len >= WIZ_SPI_DMA_MIN_LEN) {
+        spi_transfer(wiznet5k_obj.spi, len, NULL, buf, 5000);
+    } else {
+        HAL_StatusTypeDef status = HAL_SPI_Receive(wiznet5k_obj.spi->spi, buf, len, 5000);
+        (void)status;
+    }
 }
 
 STATIC void wiz_spi_write(const uint8_t *buf, uint32_t len) {
-    HAL_StatusTypeDef status = HAL_SPI_Transmit(wiznet5k_obj.spi->spi, (uint8_t *)buf, len, 5000);
-    (void)status;
+    if (len >= WIZ_SPI_DMA_MIN_LEN) {
+        spi_transfer(wiznet5k_obj.spi, len, buf, NULL, 5000);
+    } else {
+        HAL_StatusTypeDef status = HAL_SPI_Transmit(wiznet5k_obj.spi->spi, (uint8_t *)buf, len, 5000);
+        (void)status;
+    }
 }
 
 STATIC void wiznet5k_init(void) {
@@ -136,10 +155,25 @@ STATIC void wiznet5k_init(void) {
     }
 
     // Hook the Wiznet into lwIP
+    wiznet5k_obj.tx_pending = false;
     wiznet5k_lwip_init(&wiznet5k_obj);
+
+    #if MICROPY_PY_WIZNET5K == 5500
+    // With the INTn pin connected, received frames are read as soon as they arrive
+    // rather than at the next periodic lwIP poll
+    if (wiznet5k_obj.pin_int != NULL) {
+        setSn_IMR(0, Sn_IR_RECV);
+        setSIMR(1 << 0);
+        mp_hal_pin_config(wiznet5k_obj.pin_int, MP_HAL_PIN_MODE_INPUT, MP_HAL_PIN_PULL_UP, 0);
+        extint_set(wiznet5k_obj.pin_int, GPIO_MODE_IT_FALLING);
+    }
+    #endif
 }
 
 STATIC void wiznet5k_deinit(void) {
+    if (wiznet5k_obj.pin_int != NULL) {
+        extint_register_pin(wiznet5k_obj.pin_int, GPIO_MODE_IT_FALLING, false, mp_const_none);
+    }
     for (struct netif *netif = netif_list; netif != NULL; netif = netif->next) {
         if (netif == &wiznet5k_obj.netif) {
             netif_remove(netif);
@@ -154,34 +188,90 @@ STATIC void wiznet5k_get_mac_address(wiznet5k_obj_t *self, uint8_t mac[6]) {
     getSHAR(mac);
 }
 
-STATIC void wiznet5k_send_ethernet(wiznet5k_obj_t *self, size_t len, const uint8_t *buf) {
-    uint8_t ip[4] = {1, 1, 1, 1}; // dummy
-    int ret = WIZCHIP_EXPORT(sendto)(0, (byte *)buf, len, ip, 11); // dummy port
-    if (ret != len) {
-        printf("wiznet5k_send_ethernet: fatal error %d\n", ret);
-        netif_set_link_down(&self->netif);
-        netif_set_down(&self->netif);
-    }
+STATIC void wiznet5k_fatal(wiznet5k_obj_t *self) {
+    netif_set_link_down(&self->netif);
+    netif_set_down(&self->netif);
 }
 
-// Stores the frame in self->eth_frame and returns number of bytes in the frame, 0 for no frame
-STATIC uint16_t wiznet5k_recv_ethernet(wiznet5k_obj_t *self) {
-    uint16_t len = getSn_RX_RSR(0);
-    if (len == 0) {
-        return 0;
+// Wait until the frame given to the chip by the last SEND command has gone
+STATIC int wiznet5k_wait_tx(wiznet5k_obj_t *self) {
+    while (self->tx_pending) {
+        uint8_t ir = getSn_IR(0);
+        if (ir & (Sn_IR_SENDOK | Sn_IR_TIMEOUT)) {
+            setSn_IR(0, ir & (Sn_IR_SENDOK | Sn_IR_TIMEOUT));
+            self->tx_pending = false;
+        } else if (getSn_SR(0) == SOCK_CLOSED) {
+            return SOCKERR_SOCKCLOSED;
+        }
     }
+    return 0;
+}
 
-    byte ip[4];
-    uint16_t port;
-    int ret = WIZCHIP_EXPORT(recvfrom)(0, self->eth_frame, 1514, ip, &port);
-    if (ret <= 0) {
-        printf("wiznet5k_poll: fatal error len=%u ret=%d\n", len, ret);
-        netif_set_link_down(&self->netif);
-        netif_set_down(&self->netif);
-        return 0;
+// Writes the frame straight from the pbuf chain into the TX buffer and starts sending it.
+// The chip sends the frame while lwIP carries on, and only the next frame waits for it.
+STATIC int wiznet5k_send_ethernet(wiznet5k_obj_t *self, struct pbuf *p) {
+    uint16_t len = p->tot_len;
+    if (len > getSn_TxMAX(0)) {
+        return SOCKERR_DATALEN;
     }
+    int ret = wiznet5k_wait_tx(self);
+    if (ret != 0) {
+        return ret;
+    }
+    while (getSn_TX_FSR(0) < len) {
+        if (getSn_SR(0) == SOCK_CLOSED) {
+            return SOCKERR_SOCKCLOSED;
+        }
+    }
+    for (struct pbuf *q = p; q != NULL; q = q->next) {
+        wiz_send_data(0, q->payload, q->len);
+    }
+    setSn_CR(0, Sn_CR_SEND);
+    while (getSn_CR(0)) {
+    }
+    self->tx_pending = true;
+    return len;
+}
+
+// Reads all the frames waiting in the RX buffer straight into pbufs and passes them to
+// lwIP.  The space is handed back to the chip with one RECV command per burst of frames,
+// rather than two per frame.
+STATIC void wiznet5k_recv_ethernet(wiznet5k_obj_t *self) {
+    uint16_t avail;
+    while ((avail = getSn_RX_RSR(0)) != 0) {
+        while (avail >= 2) {
+            // Each frame starts with its length, which includes these 2 bytes
+            uint8_t head[2];
+            wiz_recv_data(0, head, 2);
+            uint16_t len = (head[0] << 8 | head[1]) - 2;
+            if (len > 1514 || len > avail - 2) {
+                printf("wiznet5k_poll: fatal error len=%u avail=%u\n", len, avail);
+                WIZCHIP_EXPORT(close)(0);
+                wiznet5k_fatal(self);
+                return;
+            }
+            avail -= 2 + len;
 
-    return ret;
+            struct pbuf *p = pbuf_alloc(PBUF_RAW, len, PBUF_POOL);
+            if (p == NULL) {
+                wiz_recv_ignore(0, len);
+                continue;
+            }
+            for (struct pbuf *q = p; q != NULL; q = q->next) {
+                wiz_recv_data(0, q->payload, q->len);
+            }
+            if (self->trace_flags & TRACE_ETH_RX) {
+                pbuf_copy_partial(p, self->eth_frame, len, 0);
+                netutils_ethernet_trace(MP_PYTHON_PRINTER, len, self->eth_frame, NETUTILS_TRACE_NEWLINE);
+            }
+            if (self->netif.input(p, &self->netif) != ERR_OK) {
+                pbuf_free(p);
+            }
+        }
+        setSn_CR(0, Sn_CR_RECV);
+        while (getSn_CR(0)) {
+        }
+    }
 }
 
 /*******************************************************************************/
@@ -189,11 +279,15 @@ STATIC uint16_t wiznet5k_recv_ethernet(wiznet5k_obj_t *self) {
 
 STATIC err_t wiznet5k_netif_output(struct netif *netif, struct pbuf *p) {
     wiznet5k_obj_t *self = netif->state;
-    pbuf_copy_partial(p, self->eth_frame, p->tot_len, 0);
     if (self->trace_flags & TRACE_ETH_TX) {
+        pbuf_copy_partial(p, self->eth_frame, p->tot_len, 0);
         netutils_ethernet_trace(MP_PYTHON_PRINTER, p->tot_len, self->eth_frame, NETUTILS_TRACE_IS_TX | NETUTILS_TRACE_NEWLINE);
     }
-    wiznet5k_send_ethernet(self, p->tot_len, self->eth_frame);
+    int ret = wiznet5k_send_ethernet(self, p);
+    if (ret != p->tot_len) {
+        printf("wiznet5k_send_ethernet: fatal error %d\n", ret);
+        wiznet5k_fatal(self);
+    }
     return ERR_OK;
 }
 
@@ -241,37 +335,48 @@ void wiznet5k_poll(void) {
     if (!(self->netif.flags & NETIF_FLAG_LINK_UP)) {
         return;
     }
-    uint16_t len;
-    while ((len = wiznet5k_recv_ethernet(self)) > 0) {
-        if (self->trace_flags & TRACE_ETH_RX) {
-            netutils_ethernet_trace(MP_PYTHON_PRINTER, len, self->eth_frame, NETUTILS_TRACE_NEWLINE);
-        }
-        struct pbuf *p = pbuf_alloc(PBUF_RAW, len, PBUF_POOL);
-        if (p != NULL) {
-            pbuf_take(p, self->eth_frame, len);
-            if (self->netif.input(p, &self->netif) != ERR_OK) {
-                pbuf_free(p);
-            }
-        }
+    #if MICROPY_PY_WIZNET5K == 5500
+    if (self->pin_int != NULL) {
+        // Acknowledge the interrupt before reading, so a frame that arrives later raises it again
+        setSn_IR(0, Sn_IR_RECV);
+    }
+    #endif
+    wiznet5k_recv_ethernet(self);
+}
+
+// Called from the EXTI handler for pins set up by extint_set, returns true if it is ours
+bool wiznet5k_irq(const pin_obj_t *pin) {
+    if (pin != wiznet5k_obj.pin_int) {
+        return false;
     }
+    pendsv_schedule_dispatch(PENDSV_DISPATCH_WIZNET5K, wiznet5k_poll);
+    return true;
 }
 
 /*******************************************************************************/
 // MicroPython bindings
 
-// WIZNET5K([spi, pin_cs, pin_rst])
+// WIZNET5K([spi, pin_cs, pin_rst[, pin_int]])
 STATIC mp_obj_t wiznet5k_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
     // check arguments
-    mp_arg_check_num(n_args, n_kw, 3, 3, false);
+    mp_arg_check_num(n_args, n_kw, 3, 4, false);
 
     const spi_t *spi = spi_from_mp_obj(args[0]);
     mp_hal_pin_obj_t cs = pin_find(args[1]);
     mp_hal_pin_obj_t rst = pin_find(args[2]);
+    mp_hal_pin_obj_t pin_int = NULL;
+    if (n_args > 3 && args[3] != mp_const_none) {
+        #if MICROPY_PY_WIZNET5K == 5500
+        pin_int = pin_find(args[3]);
+        #else
+        mp_raise_ValueError(MP_ERROR_TEXT("pin_int needs a W5500"));
+        #endif
+    }
 
     // Access the existing object, if it has been constructed with the same hardware interface
     if (wiznet5k_obj.base.type == &mod_network_nic_type_wiznet5k) {
         if (!(wiznet5k_obj.spi == spi && wiznet5k_obj.cs == cs && wiznet5k_obj.rst == rst
-              && wiznet5k_obj.netif.flags != 0)) {
+              && wiznet5k_obj.pin_int == pin_int && wiznet5k_obj.netif.flags != 0)) {
             wiznet5k_deinit();
         }
     }
@@ -282,6 +387,7 @@ STATIC mp_obj_t wiznet5k_make_new(const mp_obj_type_t *type, size_t n_args, size
     wiznet5k_obj.spi = spi;
     wiznet5k_obj.cs = cs;
     wiznet5k_obj.rst = rst;
+    wiznet5k_obj.pin_int = pin_int;
     wiznet5k_obj.trace_flags = 0;
 
     // Return wiznet5k object
@@ -438,7 +544,18 @@ STATIC mp_obj_t send_ethernet_wrapper(mp_obj_t self_in, mp_obj_t buf_in) {
     wiznet5k_obj_t *self = MP_OBJ_TO_PTR(self_in);
     mp_buffer_info_t buf;
     mp_get_buffer_raise(buf_in, &buf, MP_BUFFER_READ);
-    wiznet5k_send_ethernet(self, buf.len, buf.buf);
+    struct pbuf *p = pbuf_alloc(PBUF_RAW, buf.len, PBUF_REF);
+    if (p == NULL) {
+        mp_raise_OSError(MP_ENOMEM);
+    }
+    p->payload = buf.buf;
+    MICROPY_PY_LWIP_ENTER
+    int ret = wiznet5k_send_ethernet(self, p);
+    MICROPY_PY_LWIP_EXIT
+    pbuf_free(p);
+    if (ret != (int)buf.len) {
+        mp_raise_OSError(MP_EIO);
+    }
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(send_ethernet_obj, send_ethernet_wrapper);
@@ -33,6 +33,9 @@ enum {
     #if MICROPY_PY_NETWORK_CYW43
     PENDSV_DISPATCH_CYW43,
     #endif
+    #if MICROPY_PY_WIZNET5K
+    PENDSV_DISPATCH_WIZNET5K,
+    #endif
     #endif
     #if MICROPY_PY_BLUETOOTH && !MICROPY_PY_BLUETOOTH_USE_SYNC_EVENTS
     PENDSV_DISPATCH_BLUETOOTH_HCI,
@@ -40,4 +40,7 @@ MP_DECLARE_CONST_FUN_OBJ_1(time_sleep_us_obj);
 MP_DECLARE_CONST_FUN_OBJ_0(mod_os_sync_obj);
 MP_DECLARE_CONST_FUN_OBJ_VAR_BETWEEN(mod_os_dupterm_obj);
 
+extern const mp_obj_type_t stm_dma_type;
+void stm_dma_deinit_all(void);
+
 #endif // MICROPY_INCLUDED_STM32_PORTMODULES_H
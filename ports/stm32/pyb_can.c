@@ -172,9 +172,9 @@ STATIC uint32_t pyb_can_get_source_freq() {
     return can_kern_clk;
 }
 
-// init(mode, extframe=False, prescaler=100, *, sjw=1, bs1=6, bs2=8)
+// init(mode, extframe=False, prescaler=100, *, sjw=1, bs1=6, bs2=8, fd=False)
 STATIC mp_obj_t pyb_can_init_helper(pyb_can_obj_t *self, size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
-    enum { ARG_mode, ARG_extframe, ARG_prescaler, ARG_sjw, ARG_bs1, ARG_bs2, ARG_auto_restart, ARG_baudrate, ARG_sample_point };
+    enum { ARG_mode, ARG_extframe, ARG_prescaler, ARG_sjw, ARG_bs1, ARG_bs2, ARG_auto_restart, ARG_baudrate, ARG_sample_point, ARG_fd };
     static const mp_arg_t allowed_args[] = {
         { MP_QSTR_mode,         MP_ARG_REQUIRED | MP_ARG_INT,   {.u_int = CAN_MODE_NORMAL} },
         { MP_QSTR_extframe,     MP_ARG_BOOL,                    {.u_bool = false} },
@@ -185,6 +185,7 @@ STATIC mp_obj_t pyb_can_init_helper(pyb_can_obj_t *self, size_t n_args, const mp
         { MP_QSTR_auto_restart, MP_ARG_KW_ONLY | MP_ARG_BOOL,   {.u_bool = false} },
         { MP_QSTR_baudrate,     MP_ARG_KW_ONLY | MP_ARG_INT,    {.u_int = 0} },
         { MP_QSTR_sample_point, MP_ARG_KW_ONLY | MP_ARG_INT,    {.u_int = 75} }, // 75% sampling point
+        { MP_QSTR_fd,           MP_ARG_KW_ONLY | MP_ARG_BOOL,   {.u_bool = false} },
     };
 
     // parse args
@@ -192,6 +193,13 @@ STATIC mp_obj_t pyb_can_init_helper(pyb_can_obj_t *self, size_t n_args, const mp
     mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
 
     self->extframe = args[ARG_extframe].u_bool;
+    #if MICROPY_HW_ENABLE_FDCAN
+    self->fd = args[ARG_fd].u_bool;
+    #else
+    if (args[ARG_fd].u_bool) {
+        mp_raise_ValueError(MP_ERROR_TEXT("CAN FD not supported"));
+    }
+    #endif
 
     // set the CAN configuration values
     memset(&self->can, 0, sizeof(self->can));
@@ -445,7 +453,11 @@ STATIC mp_obj_t pyb_can_send(size_t n_args, const mp_obj_t *pos_args, mp_map_t *
     uint8_t data[1];
     pyb_buf_get_for_send(args[ARG_data].u_obj, &bufinfo, data);
 
+    #if MICROPY_HW_ENABLE_FDCAN
+    if (bufinfo.len > (self->fd ? CAN_FD_MAX_DATA : 8)) {
+    #else
     if (bufinfo.len > 8) {
+    #endif
         mp_raise_ValueError(MP_ERROR_TEXT("CAN data field too long"));
     }
 
@@ -453,13 +465,15 @@ STATIC mp_obj_t pyb_can_send(size_t n_args, const mp_obj_t *pos_args, mp_map_t *
     CanTxMsgTypeDef tx_msg;
 
     #if MICROPY_HW_ENABLE_FDCAN
-    uint8_t tx_data[8];
+    // An FD frame longer than 8 bytes is padded with zeros up to a length
+    // that its DLC can encode.
+    uint8_t tx_data[CAN_FD_MAX_DATA] = {0};
     tx_msg.MessageMarker = 0;
     tx_msg.ErrorStateIndicator = FDCAN_ESI_ACTIVE;
     tx_msg.BitRateSwitch = FDCAN_BRS_OFF;
-    tx_msg.FDFormat = FDCAN_CLASSIC_CAN;
+    tx_msg.FDFormat = bufinfo.len > 8 ? FDCAN_FD_CAN : FDCAN_CLASSIC_CAN;
     tx_msg.TxEventFifoControl = FDCAN_NO_TX_EVENTS;
-    tx_msg.DataLength = (bufinfo.len << 16); // TODO DLC for len > 8
+    tx_msg.DataLength = can_len_to_dlc(bufinfo.len) << 16;
 
     if (self->extframe) {
         tx_msg.Identifier = args[ARG_id].u_int & 0x1FFFFFFF;
@@ -525,48 +539,24 @@ STATIC mp_obj_t pyb_can_send(size_t n_args, const mp_obj_t *pos_args, mp_map_t *
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_KW(pyb_can_send_obj, 1, pyb_can_send);
 
-// recv(fifo, list=None, *, timeout=5000)
-STATIC mp_obj_t pyb_can_recv(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
-    enum { ARG_fifo, ARG_list, ARG_timeout };
-    static const mp_arg_t allowed_args[] = {
-        { MP_QSTR_fifo,    MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 0} },
-        { MP_QSTR_list,    MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
-        { MP_QSTR_timeout, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 5000} },
-    };
-
-    // parse args
-    pyb_can_obj_t *self = MP_OBJ_TO_PTR(pos_args[0]);
-    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
-    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
-
-    // receive the data
-    CanRxMsgTypeDef rx_msg;
-    #if MICROPY_HW_ENABLE_FDCAN
-    uint8_t rx_data[8];
-    #else
-    uint8_t *rx_data = rx_msg.Data;
-    #endif
-
-    mp_uint_t fifo = args[ARG_fifo].u_int;
+STATIC mp_uint_t pyb_can_get_fifo(mp_int_t fifo) {
     if (fifo == 0) {
-        fifo = CAN_FIFO0;
+        return CAN_FIFO0;
     } else if (fifo == 1) {
-        fifo = CAN_FIFO1;
+        return CAN_FIFO1;
     } else {
         mp_raise_TypeError(NULL);
     }
+}
 
-    int ret = can_receive(&self->can, fifo, &rx_msg, rx_data, args[ARG_timeout].u_int);
+// Receive one message from the FIFO, waiting up to timeout ms for it, and
+// return the length of its data.
+STATIC size_t pyb_can_recv_msg(pyb_can_obj_t *self, mp_uint_t fifo, CanRxMsgTypeDef *rx_msg, uint8_t *rx_data, uint32_t timeout) {
+    int ret = can_receive(&self->can, fifo, rx_msg, rx_data, timeout);
     if (ret < 0) {
         mp_raise_OSError(-ret);
     }
 
-    #if MICROPY_HW_ENABLE_FDCAN
-    uint32_t rx_dlc = rx_msg.DataLength;
-    #else
-    uint32_t rx_dlc = rx_msg.DLC;
-    #endif
-
     // Manage the rx state machine
     if ((fifo == CAN_FIFO0 && self->rxcallback0 != mp_const_none) ||
         (fifo == CAN_FIFO1 && self->rxcallback1 != mp_const_none)) {
@@ -594,54 +584,145 @@ STATIC mp_obj_t pyb_can_recv(size_t n_args, const mp_obj_t *pos_args, mp_map_t *
         }
     }
 
-    // Create the tuple, or get the list, that will hold the return values
-    // Also populate the fourth element, either a new bytes or reuse existing memoryview
+    #if MICROPY_HW_ENABLE_FDCAN
+    return can_dlc_to_len(rx_msg->DataLength);
+    #else
+    return rx_msg->DLC;
+    #endif
+}
+
+// Check that a user supplied list can hold a message, and return its items.
+STATIC mp_obj_t *pyb_can_get_msg_list(mp_obj_t list_in) {
+    // User should provide a list of length at least 4 to hold the values
+    if (!mp_obj_is_type(list_in, &mp_type_list)) {
+        mp_raise_TypeError(NULL);
+    }
+    mp_obj_list_t *list = MP_OBJ_TO_PTR(list_in);
+    if (list->len < 4) {
+        mp_raise_ValueError(NULL);
+    }
+    // Fourth element must be a memoryview which we assume points to a
+    // byte-like array which is large enough, and then we resize it inplace
+    if (!mp_obj_is_type(list->items[3], &mp_type_memoryview)) {
+        mp_raise_TypeError(NULL);
+    }
+    mp_obj_array_t *mv = MP_OBJ_TO_PTR(list->items[3]);
+    if (!(mv->typecode == (MP_OBJ_ARRAY_TYPECODE_FLAG_RW | BYTEARRAY_TYPECODE)
+          || (mv->typecode | 0x20) == (MP_OBJ_ARRAY_TYPECODE_FLAG_RW | 'b'))) {
+        mp_raise_ValueError(NULL);
+    }
+    return list->items;
+}
+
+// Populate the first 3 values of a message tuple/list
+STATIC void pyb_can_store_msg_header(mp_obj_t *items, const CanRxMsgTypeDef *rx_msg) {
+    #if MICROPY_HW_ENABLE_FDCAN
+    items[0] = MP_OBJ_NEW_SMALL_INT(rx_msg->Identifier);
+    items[1] = rx_msg->RxFrameType == FDCAN_REMOTE_FRAME ? mp_const_true : mp_const_false;
+    items[2] = MP_OBJ_NEW_SMALL_INT(rx_msg->FilterIndex);
+    #else
+    items[0] = MP_OBJ_NEW_SMALL_INT((rx_msg->IDE == CAN_ID_STD ? rx_msg->StdId : rx_msg->ExtId));
+    items[1] = rx_msg->RTR == CAN_RTR_REMOTE ? mp_const_true : mp_const_false;
+    items[2] = MP_OBJ_NEW_SMALL_INT(rx_msg->FMI);
+    #endif
+}
+
+// Receive one message into a user supplied list, without allocating.
+STATIC void pyb_can_recv_into_list(pyb_can_obj_t *self, mp_uint_t fifo, mp_obj_t list, uint32_t timeout) {
+    CanRxMsgTypeDef rx_msg;
+    #if MICROPY_HW_ENABLE_FDCAN
+    uint8_t rx_data[CAN_FD_MAX_DATA];
+    #else
+    uint8_t *rx_data = rx_msg.Data;
+    #endif
+    size_t rx_len = pyb_can_recv_msg(self, fifo, &rx_msg, rx_data, timeout);
+    mp_obj_t *items = pyb_can_get_msg_list(list);
+    mp_obj_array_t *mv = MP_OBJ_TO_PTR(items[3]);
+    mv->len = rx_len;
+    memcpy(mv->items, rx_data, rx_len);
+    pyb_can_store_msg_header(items, &rx_msg);
+}
+
+// recv(fifo, list=None, *, timeout=5000)
+STATIC mp_obj_t pyb_can_recv(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_fifo, ARG_list, ARG_timeout };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_fifo,    MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_list,    MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+        { MP_QSTR_timeout, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 5000} },
+    };
+
+    // parse args
+    pyb_can_obj_t *self = MP_OBJ_TO_PTR(pos_args[0]);
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    mp_uint_t fifo = pyb_can_get_fifo(args[ARG_fifo].u_int);
     mp_obj_t ret_obj = args[ARG_list].u_obj;
-    mp_obj_t *items;
-    if (ret_obj == mp_const_none) {
-        ret_obj = mp_obj_new_tuple(4, NULL);
-        items = ((mp_obj_tuple_t *)MP_OBJ_TO_PTR(ret_obj))->items;
-        items[3] = mp_obj_new_bytes(rx_data, rx_dlc);
-    } else {
-        // User should provide a list of length at least 4 to hold the values
-        if (!mp_obj_is_type(ret_obj, &mp_type_list)) {
-            mp_raise_TypeError(NULL);
-        }
-        mp_obj_list_t *list = MP_OBJ_TO_PTR(ret_obj);
-        if (list->len < 4) {
-            mp_raise_ValueError(NULL);
-        }
-        items = list->items;
-        // Fourth element must be a memoryview which we assume points to a
-        // byte-like array which is large enough, and then we resize it inplace
-        if (!mp_obj_is_type(items[3], &mp_type_memoryview)) {
-            mp_raise_TypeError(NULL);
-        }
-        mp_obj_array_t *mv = MP_OBJ_TO_PTR(items[3]);
-        if (!(mv->typecode == (MP_OBJ_ARRAY_TYPECODE_FLAG_RW | BYTEARRAY_TYPECODE)
-              || (mv->typecode | 0x20) == (MP_OBJ_ARRAY_TYPECODE_FLAG_RW | 'b'))) {
-            mp_raise_ValueError(NULL);
-        }
-        mv->len = rx_dlc;
-        memcpy(mv->items, rx_data, rx_dlc);
+
+    if (ret_obj != mp_const_none) {
+        // Reuse the given list and its memoryview
+        pyb_can_recv_into_list(self, fifo, ret_obj, args[ARG_timeout].u_int);
+        return ret_obj;
     }
 
-    // Populate the first 3 values of the tuple/list
+    // receive the data
+    CanRxMsgTypeDef rx_msg;
     #if MICROPY_HW_ENABLE_FDCAN
-    items[0] = MP_OBJ_NEW_SMALL_INT(rx_msg.Identifier);
-    items[1] = rx_msg.RxFrameType == FDCAN_REMOTE_FRAME ? mp_const_true : mp_const_false;
-    items[2] = MP_OBJ_NEW_SMALL_INT(rx_msg.FilterIndex);
+    uint8_t rx_data[CAN_FD_MAX_DATA];
     #else
-    items[0] = MP_OBJ_NEW_SMALL_INT((rx_msg.IDE == CAN_ID_STD ? rx_msg.StdId : rx_msg.ExtId));
-    items[1] = rx_msg.RTR == CAN_RTR_REMOTE ? mp_const_true : mp_const_false;
-    items[2] = MP_OBJ_NEW_SMALL_INT(rx_msg.FMI);
+    uint8_t *rx_data = rx_msg.Data;
     #endif
+    size_t rx_len = pyb_can_recv_msg(self, fifo, &rx_msg, rx_data, args[ARG_timeout].u_int);
+
+    // Create the tuple that will hold the return values
+    ret_obj = mp_obj_new_tuple(4, NULL);
+    mp_obj_t *items = ((mp_obj_tuple_t *)MP_OBJ_TO_PTR(ret_obj))->items;
+    items[3] = mp_obj_new_bytes(rx_data, rx_len);
+    pyb_can_store_msg_header(items, &rx_msg);
 
     // Return the result
     return ret_obj;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_KW(pyb_can_recv_obj, 1, pyb_can_recv);
 
+// recv_into(fifo, msgs, *, timeout=5000)
+// Receive as many messages as are waiting, up to len(msgs), into the lists in
+// msgs, waiting up to timeout ms for the first one.  Returns the number received.
+STATIC mp_obj_t pyb_can_recv_into(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_fifo, ARG_msgs, ARG_timeout };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_fifo,    MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_msgs,    MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_timeout, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 5000} },
+    };
+
+    // parse args
+    pyb_can_obj_t *self = MP_OBJ_TO_PTR(pos_args[0]);
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    mp_uint_t fifo = pyb_can_get_fifo(args[ARG_fifo].u_int);
+    size_t len;
+    mp_obj_t *msgs;
+    mp_obj_get_array(args[ARG_msgs].u_obj, &len, &msgs);
+
+    // Check all the lists first, so a bad one doesn't lose received messages
+    for (size_t i = 0; i < len; ++i) {
+        pyb_can_get_msg_list(msgs[i]);
+    }
+
+    size_t n = 0;
+    if (len > 0) {
+        pyb_can_recv_into_list(self, fifo, msgs[0], args[ARG_timeout].u_int);
+        for (n = 1; n < len && __HAL_CAN_MSG_PENDING(&self->can, fifo) != 0; ++n) {
+            pyb_can_recv_into_list(self, fifo, msgs[n], 0);
+        }
+    }
+    return MP_OBJ_NEW_SMALL_INT(n);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(pyb_can_recv_into_obj, 1, pyb_can_recv_into);
+
 // initfilterbanks(n)
 STATIC mp_obj_t pyb_can_initfilterbanks(mp_obj_t self, mp_obj_t bank_in) {
     #if MICROPY_HW_ENABLE_FDCAN
@@ -835,6 +916,41 @@ error:
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_KW(pyb_can_setfilter_obj, 1, pyb_can_setfilter);
 
+// setfilterids(bank, fifo, ids)
+// Set list filters, starting at the given bank, that accept exactly the given
+// ids, and return the number of banks used.  Each bank holds as many ids as
+// it can: 4 standard or 2 extended ids with bxCAN, 2 ids with FDCAN.
+STATIC mp_obj_t pyb_can_setfilterids(size_t n_args, const mp_obj_t *args) {
+    pyb_can_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+    mp_int_t bank = mp_obj_get_int(args[1]);
+    size_t len;
+    mp_obj_t *ids;
+    mp_obj_get_array(args[3], &len, &ids);
+
+    #if MICROPY_HW_ENABLE_FDCAN
+    mp_obj_t mode = MP_OBJ_NEW_SMALL_INT(FDCAN_FILTER_DUAL);
+    size_t per_bank = 2;
+    #else
+    mp_obj_t mode = MP_OBJ_NEW_SMALL_INT(self->extframe ? LIST32 : LIST16);
+    size_t per_bank = self->extframe ? 2 : 4;
+    #endif
+
+    size_t n_banks = 0;
+    for (size_t i = 0; i < len; i += per_bank, ++n_banks) {
+        // fill a partly used bank by repeating its last id
+        mp_obj_t params[4];
+        for (size_t j = 0; j < per_bank; ++j) {
+            params[j] = ids[MIN(i + j, len - 1)];
+        }
+        mp_obj_t setfilter_args[5] = {
+            args[0], MP_OBJ_NEW_SMALL_INT(bank + n_banks), mode, args[2], mp_obj_new_tuple(per_bank, params),
+        };
+        pyb_can_setfilter(5, setfilter_args, (mp_map_t *)&mp_const_empty_map);
+    }
+    return MP_OBJ_NEW_SMALL_INT(n_banks);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(pyb_can_setfilterids_obj, 4, 4, pyb_can_setfilterids);
+
 STATIC mp_obj_t pyb_can_rxcallback(mp_obj_t self_in, mp_obj_t fifo_in, mp_obj_t callback_in) {
     pyb_can_obj_t *self = MP_OBJ_TO_PTR(self_in);
     mp_int_t fifo = mp_obj_get_int(fifo_in);
@@ -886,8 +1002,10 @@ STATIC const mp_rom_map_elem_t pyb_can_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_any), MP_ROM_PTR(&pyb_can_any_obj) },
     { MP_ROM_QSTR(MP_QSTR_send), MP_ROM_PTR(&pyb_can_send_obj) },
     { MP_ROM_QSTR(MP_QSTR_recv), MP_ROM_PTR(&pyb_can_recv_obj) },
+    { MP_ROM_QSTR(MP_QSTR_recv_into), MP_ROM_PTR(&pyb_can_recv_into_obj) },
     { MP_ROM_QSTR(MP_QSTR_initfilterbanks), MP_ROM_PTR(&pyb_can_initfilterbanks_obj) },
     { MP_ROM_QSTR(MP_QSTR_setfilter), MP_ROM_PTR(&pyb_can_setfilter_obj) },
+    { MP_ROM_QSTR(MP_QSTR_setfilterids), MP_ROM_PTR(&pyb_can_setfilterids_obj) },
     { MP_ROM_QSTR(MP_QSTR_clearfilter), MP_ROM_PTR(&pyb_can_clearfilter_obj) },
     { MP_ROM_QSTR(MP_QSTR_rxcallback), MP_ROM_PTR(&pyb_can_rxcallback_obj) },
 
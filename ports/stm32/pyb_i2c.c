@@ -527,6 +527,13 @@ void i2c_er_irq_handler(mp_uint_t i2c_id) {
     #endif
 }
 
+// DMA is used if the option is set and IRQs are enabled, unless one of the
+// streams is claimed by stm.DMA.
+STATIC bool pyb_i2c_can_use_dma(const pyb_i2c_obj_t *self) {
+    return *self->use_dma && query_irq() == IRQ_STATE_ENABLED
+           && !dma_stream_is_claimed(self->tx_dma_descr) && !dma_stream_is_claimed(self->rx_dma_descr);
+}
+
 STATIC HAL_StatusTypeDef i2c_wait_dma_finished(I2C_HandleTypeDef *i2c, uint32_t timeout) {
     // Note: we can't use WFI to idle in this loop because the DMA completion
     // interrupt may occur before the WFI.  Hence we miss it and have to wait
@@ -767,7 +774,7 @@ STATIC mp_obj_t pyb_i2c_send(size_t n_args, const mp_obj_t *pos_args, mp_map_t *
     pyb_buf_get_for_send(args[0].u_obj, &bufinfo, data);
 
     // if option is set and IRQs are enabled then we can use DMA
-    bool use_dma = *self->use_dma && query_irq() == IRQ_STATE_ENABLED;
+    bool use_dma = pyb_i2c_can_use_dma(self);
 
     DMA_HandleTypeDef tx_dma;
     if (use_dma) {
@@ -846,7 +853,7 @@ STATIC mp_obj_t pyb_i2c_recv(size_t n_args, const mp_obj_t *pos_args, mp_map_t *
     mp_obj_t o_ret = pyb_buf_get_for_recv(args[0].u_obj, &vstr);
 
     // if option is set and IRQs are enabled then we can use DMA
-    bool use_dma = *self->use_dma && query_irq() == IRQ_STATE_ENABLED;
+    bool use_dma = pyb_i2c_can_use_dma(self);
 
     DMA_HandleTypeDef rx_dma;
     if (use_dma) {
@@ -943,7 +950,7 @@ STATIC mp_obj_t pyb_i2c_mem_read(size_t n_args, const mp_obj_t *pos_args, mp_map
     }
 
     // if option is set and IRQs are enabled then we can use DMA
-    bool use_dma = *self->use_dma && query_irq() == IRQ_STATE_ENABLED;
+    bool use_dma = pyb_i2c_can_use_dma(self);
 
     HAL_StatusTypeDef status;
     if (!use_dma) {
@@ -1012,7 +1019,7 @@ STATIC mp_obj_t pyb_i2c_mem_write(size_t n_args, const mp_obj_t *pos_args, mp_ma
     }
 
     // if option is set and IRQs are enabled then we can use DMA
-    bool use_dma = *self->use_dma && query_irq() == IRQ_STATE_ENABLED;
+    bool use_dma = pyb_i2c_can_use_dma(self);
 
     HAL_StatusTypeDef status;
     if (!use_dma) {
@@ -28,6 +28,7 @@
 
 #include "py/mperrno.h"
 #include "py/mphal.h"
+#include "dma.h"
 #include "mpu.h"
 #include "qspi.h"
 #include "pin_static_af.h"
@@ -52,6 +53,24 @@
 #define MICROPY_HW_QSPI_CS_HIGH_CYCLES  2  // nCS stays high for 2 cycles
 #endif
 
+#ifndef MICROPY_HW_QSPI_MPU_REGION_SIZE
+#define MICROPY_HW_QSPI_MPU_REGION_SIZE 2  // size in MiB of the memory-mapped window
+#endif
+
+#if MICROPY_HW_QSPI_MPU_REGION_SIZE < 2 || MICROPY_HW_QSPI_MPU_REGION_SIZE > 16 || (MICROPY_HW_QSPI_MPU_REGION_SIZE & 1)
+#error MICROPY_HW_QSPI_MPU_REGION_SIZE must be a multiple of 2 between 2 and 16
+#endif
+
+// Reads shorter than this are done by the CPU, to save setting up the DMA
+#define QSPI_DMA_MIN_LEN (64)
+
+// The DMA can't write to CCM RAM, so reads into there are done by the CPU
+#if defined(CCMDATARAM_BASE)
+#define QSPI_DMA_CAN_WRITE(addr) ((uintptr_t)(addr) - CCMDATARAM_BASE >= 0x10000)
+#else
+#define QSPI_DMA_CAN_WRITE(addr) (1)
+#endif
+
 #if (MICROPY_HW_QSPIFLASH_SIZE_BITS_LOG2 - 3 - 1) >= 24
 #define QSPI_CMD 0xec
 #define QSPI_ADSIZE 3
@@ -74,11 +93,12 @@ static inline void qspi_mpu_enable_mapped(void) {
     // for the memory-mapped region, so 3 MPU regions are used to disable access
     // to everything except the valid address space, using holes in the bottom
     // of the regions and nesting them.
-    // At the moment this is hard-coded to 2MiB of QSPI address space.
+    // The size of the window is MICROPY_HW_QSPI_MPU_REGION_SIZE, which is made
+    // of holes of 2MiB subregions in the bottom 16MiB region.
     uint32_t irq_state = mpu_config_start();
     mpu_config_region(MPU_REGION_QSPI1, QSPI_MAP_ADDR, MPU_CONFIG_DISABLE(0x01, MPU_REGION_SIZE_256MB));
     mpu_config_region(MPU_REGION_QSPI2, QSPI_MAP_ADDR, MPU_CONFIG_DISABLE(0x0f, MPU_REGION_SIZE_32MB));
-    mpu_config_region(MPU_REGION_QSPI3, QSPI_MAP_ADDR, MPU_CONFIG_DISABLE(0x01, MPU_REGION_SIZE_16MB));
+    mpu_config_region(MPU_REGION_QSPI3, QSPI_MAP_ADDR, MPU_CONFIG_DISABLE((1 << (MICROPY_HW_QSPI_MPU_REGION_SIZE / 2)) - 1, MPU_REGION_SIZE_16MB));
     mpu_config_end(irq_state);
 }
 
@@ -320,6 +340,37 @@ STATIC void qspi_read_cmd_qaddr_qdata(void *self_in, uint8_t cmd, uint32_t addr,
     QUADSPI->ABR = 0; // alternate byte: disable continuous read mode
     QUADSPI->AR = addr; // addres to read from
 
+    #if MICROPY_HW_QSPI_USE_DMA
+    if (((uintptr_t)dest & 3) == 0 && len >= QSPI_DMA_MIN_LEN && QSPI_DMA_CAN_WRITE(dest)) {
+        // Read in whole words using DMA, leaving any remaining bytes for below
+        size_t dma_len = len & ~3;
+        if (dma_len > 0xffff * 4) {
+            dma_len = 0xffff * 4;
+        }
+        // Flush and invalidate the cache so the CPU then reads what the DMA wrote
+        MP_HAL_CLEANINVALIDATE_DCACHE(dest, dma_len);
+        uint32_t dma_config =
+            2 << DMA_SxCR_MSIZE_Pos // MSIZE word
+                | 2 << DMA_SxCR_PSIZE_Pos // PSIZE word
+                | 0 << DMA_SxCR_DIR_Pos // DIR periph-to-mem
+        ;
+        dma_nohal_init(&dma_QUADSPI, dma_config);
+        dma_nohal_start(&dma_QUADSPI, (uint32_t)dest, (uint32_t)&QUADSPI->DR, dma_len / 4);
+        QUADSPI->CR |= QUADSPI_CR_DMAEN;
+
+        // Wait until the transfer is complete and the DMA has taken its words
+        // from the FIFO; dma_nohal_deinit then waits for the DMA to finish
+        while (!(QUADSPI->SR & QUADSPI_SR_TCF)
+               || ((QUADSPI->SR >> QUADSPI_SR_FLEVEL_Pos) & 0x3f) > len - dma_len) {
+        }
+        dma_nohal_deinit(&dma_QUADSPI);
+        QUADSPI->CR &= ~QUADSPI_CR_DMAEN;
+
+        dest += dma_len;
+        len -= dma_len;
+    }
+    #endif
+
     // Read in the data 4 bytes at a time if dest is aligned
     if (((uintptr_t)dest & 3) == 0) {
         while (len >= 4) {
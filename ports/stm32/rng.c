@@ -24,6 +24,8 @@
  * THE SOFTWARE.
  */
 
+#include <string.h>
+
 #include "rtc.h"
 #include "rng.h"
 
@@ -55,6 +57,18 @@ uint32_t rng_get(void) {
     return RNG->DR;
 }
 
+// Fill a buffer with hardware random bytes, using all 32 bits of each number.
+void rng_get_bytes(uint8_t *buf, size_t len) {
+    for (; len >= 4; buf += 4, len -= 4) {
+        uint32_t r = rng_get();
+        memcpy(buf, &r, 4);
+    }
+    if (len > 0) {
+        uint32_t r = rng_get();
+        memcpy(buf, &r, len);
+    }
+}
+
 // Return a 30-bit hardware generated random number.
 STATIC mp_obj_t pyb_rng_get(void) {
     return mp_obj_new_int(rng_get() >> 2);
@@ -29,6 +29,7 @@
 #include "py/obj.h"
 
 uint32_t rng_get(void);
+void rng_get_bytes(uint8_t *buf, size_t len);
 
 MP_DECLARE_CONST_FUN_OBJ_0(pyb_rng_get_obj);
 
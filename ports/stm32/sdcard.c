@@ -27,6 +27,7 @@
 #include <string.h>
 
 #include "py/runtime.h"
+#include "py/mperrno.h"
 #include "py/mphal.h"
 #include "lib/oofatfs/ff.h"
 #include "extmod/vfs_fat.h"
@@ -789,6 +790,28 @@ STATIC mp_obj_t pyb_sdcard_writeblocks(mp_obj_t self, mp_obj_t block_num, mp_obj
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_3(pyb_sdcard_writeblocks_obj, pyb_sdcard_writeblocks);
 
+STATIC int pyb_sdcard_bdev_readblocks(mp_obj_t self, uint32_t block_num, uint32_t block_off, uint8_t *buf, size_t len, bool ext) {
+    if (ext) {
+        // Only the simple block interface is supported
+        return -MP_EINVAL;
+    }
+    return sdcard_read_blocks(buf, block_num, len / SDCARD_BLOCK_SIZE) == 0 ? 0 : -MP_EIO;
+}
+
+STATIC int pyb_sdcard_bdev_writeblocks(mp_obj_t self, uint32_t block_num, uint32_t block_off, const uint8_t *buf, size_t len, bool ext) {
+    if (ext) {
+        return -MP_EINVAL;
+    }
+    return sdcard_write_blocks(buf, block_num, len / SDCARD_BLOCK_SIZE) == 0 ? 0 : -MP_EIO;
+}
+
+STATIC const mp_block_dev_p_t pyb_sdcard_block_dev_p = {
+    .readblocks_obj = &pyb_sdcard_readblocks_obj,
+    .writeblocks_obj = &pyb_sdcard_writeblocks_obj,
+    .readblocks = pyb_sdcard_bdev_readblocks,
+    .writeblocks = pyb_sdcard_bdev_writeblocks,
+};
+
 STATIC mp_obj_t pyb_sdcard_ioctl(mp_obj_t self, mp_obj_t cmd_in, mp_obj_t arg_in) {
     mp_int_t cmd = mp_obj_get_int(cmd_in);
     switch (cmd) {
@@ -837,6 +860,7 @@ const mp_obj_type_t pyb_sdcard_type = {
     { &mp_type_type },
     .name = MP_QSTR_SDCard,
     .make_new = pyb_sdcard_make_new,
+    .protocol = &pyb_sdcard_block_dev_p,
     .locals_dict = (mp_obj_dict_t *)&pyb_sdcard_locals_dict,
 };
 #endif
@@ -846,6 +870,7 @@ const mp_obj_type_t pyb_mmcard_type = {
     { &mp_type_type },
     .name = MP_QSTR_MMCard,
     .make_new = pyb_mmcard_make_new,
+    .protocol = &pyb_sdcard_block_dev_p,
     .locals_dict = (mp_obj_dict_t *)&pyb_sdcard_locals_dict,
 };
 #endif
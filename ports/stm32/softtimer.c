@@ -29,7 +29,31 @@
 #include "py/mphal.h"
 #include "py/runtime.h"
 #include "irq.h"
+#include "pendsv.h"
 #include "softtimer.h"
+#include "timer.h"
+
+#if MICROPY_HW_SOFTTIMER_TIM
+
+// The hardware timer is a 32-bit counter at 1MHz, and the next deadline is
+// programmed into its channel 1 compare register, so there is an interrupt
+// only when a soft timer is due.
+
+// TIM5 is the other 32-bit timer, but its IRQ handler belongs to the servo
+#if MICROPY_HW_SOFTTIMER_TIM != 2
+#error MICROPY_HW_SOFTTIMER_TIM must be 2
+#endif
+#if defined(STM32L0)
+#error TIM2 is 16-bit on STM32L0
+#endif
+
+#define SOFT_TIMER_TIM TIM2
+#define SOFT_TIMER_IRQn TIM2_IRQn
+#define SOFT_TIMER_CLK_ENABLE __HAL_RCC_TIM2_CLK_ENABLE
+
+#define TICKS_DIFF(t1, t0) ((int32_t)((t1) - (t0)))
+
+#else
 
 #define TICKS_PERIOD 0x80000000
 #define TICKS_DIFF(t1, t0) ((int32_t)(((t1 - t0 + TICKS_PERIOD / 2) & (TICKS_PERIOD - 1)) - TICKS_PERIOD / 2))
@@ -38,18 +62,96 @@ extern __IO uint32_t uwTick;
 
 volatile uint32_t soft_timer_next;
 
+#endif
+
 // Pointer to the pairheap of soft timer objects.
 // This may contain bss/data pointers as well as GC-heap pointers,
 // and is explicitly GC traced by soft_timer_gc_mark_all().
 STATIC soft_timer_entry_t *soft_timer_heap;
 
+// The time a timer is due, after rounding up to the grid of its slack so that
+// timers due close together can be run by the same interrupt.  The grid is a
+// power of two, which divides the period of the tick counter.
+static inline uint32_t soft_timer_due(soft_timer_entry_t *e) {
+    return (e->expiry + e->slack_mask) & ~e->slack_mask;
+}
+
 STATIC int soft_timer_lt(mp_pairheap_t *n1, mp_pairheap_t *n2) {
     soft_timer_entry_t *e1 = (soft_timer_entry_t *)n1;
     soft_timer_entry_t *e2 = (soft_timer_entry_t *)n2;
-    return TICKS_DIFF(e1->expiry_ms, e2->expiry_ms) < 0;
+    return TICKS_DIFF(soft_timer_due(e1), soft_timer_due(e2)) < 0;
 }
 
-STATIC void soft_timer_schedule_systick(uint32_t ticks_ms) {
+uint32_t soft_timer_ticks(void) {
+    #if MICROPY_HW_SOFTTIMER_TIM
+    return SOFT_TIMER_TIM->CNT;
+    #else
+    return uwTick;
+    #endif
+}
+
+#if MICROPY_HW_SOFTTIMER_TIM
+
+void soft_timer_tim_update_freq(void) {
+    // Changing the prescaler needs an update event, which resets the counter,
+    // so put the count back afterwards
+    uint32_t irq_state = disable_irq();
+    TIM_TypeDef *tim = SOFT_TIMER_TIM;
+    uint32_t cnt = tim->CNT;
+    tim->PSC = timer_get_source_freq(MICROPY_HW_SOFTTIMER_TIM) / 1000000 - 1;
+    tim->CR1 |= TIM_CR1_URS; // the update event must not raise an interrupt
+    tim->EGR = TIM_EGR_UG;
+    tim->CNT = cnt;
+    enable_irq(irq_state);
+}
+
+void soft_timer_init(void) {
+    SOFT_TIMER_CLK_ENABLE();
+    TIM_TypeDef *tim = SOFT_TIMER_TIM;
+    tim->CR1 = 0;
+    tim->DIER = 0;
+    tim->CCMR1 = 0; // channel 1 is a frozen output compare
+    tim->ARR = 0xffffffff;
+    tim->CNT = 0;
+    soft_timer_tim_update_freq();
+    tim->SR = 0;
+    tim->CR1 |= TIM_CR1_CEN;
+    NVIC_SetPriority(SOFT_TIMER_IRQn, IRQ_PRI_TIMX);
+    HAL_NVIC_EnableIRQ(SOFT_TIMER_IRQn);
+}
+
+void soft_timer_tim_irq_handler(void) {
+    TIM_TypeDef *tim = SOFT_TIMER_TIM;
+    if (tim->SR & TIM_SR_CC1IF) {
+        tim->SR = ~TIM_SR_CC1IF;
+        pendsv_schedule_dispatch(PENDSV_DISPATCH_SOFT_TIMER, soft_timer_handler);
+    }
+}
+
+STATIC void soft_timer_schedule_at(uint32_t ticks) {
+    TIM_TypeDef *tim = SOFT_TIMER_TIM;
+    uint32_t irq_state = disable_irq();
+    tim->CCR1 = ticks;
+    tim->SR = ~TIM_SR_CC1IF;
+    tim->DIER |= TIM_DIER_CC1IE;
+    if (TICKS_DIFF(ticks, tim->CNT) <= 0) {
+        // The counter may have passed the compare value before it was set, so
+        // there'd be no match until the counter wraps
+        pendsv_schedule_dispatch(PENDSV_DISPATCH_SOFT_TIMER, soft_timer_handler);
+    }
+    enable_irq(irq_state);
+}
+
+STATIC void soft_timer_schedule_none(void) {
+    SOFT_TIMER_TIM->DIER &= ~TIM_DIER_CC1IE;
+}
+
+#else
+
+void soft_timer_init(void) {
+}
+
+STATIC void soft_timer_schedule_at(uint32_t ticks_ms) {
     uint32_t irq_state = disable_irq();
     uint32_t uw_tick = uwTick;
     if (TICKS_DIFF(ticks_ms, uw_tick) <= 0) {
@@ -60,6 +162,13 @@ STATIC void soft_timer_schedule_systick(uint32_t ticks_ms) {
     enable_irq(irq_state);
 }
 
+STATIC void soft_timer_schedule_none(void) {
+    // Set largest delay possible
+    soft_timer_next = uwTick;
+}
+
+#endif
+
 void soft_timer_deinit(void) {
     // Pop off all the nodes which are allocated on the GC-heap.
     uint32_t irq_state = raise_irq_pri(IRQ_PRI_PENDSV);
@@ -78,9 +187,9 @@ void soft_timer_deinit(void) {
 
 // Must be executed at IRQ_PRI_PENDSV
 void soft_timer_handler(void) {
-    uint32_t ticks_ms = uwTick;
+    uint32_t ticks = soft_timer_ticks();
     soft_timer_entry_t *heap = soft_timer_heap;
-    while (heap != NULL && TICKS_DIFF(heap->expiry_ms, ticks_ms) <= 0) {
+    while (heap != NULL && TICKS_DIFF(soft_timer_due(heap), ticks) <= 0) {
         soft_timer_entry_t *entry = heap;
         heap = (soft_timer_entry_t *)mp_pairheap_pop(soft_timer_lt, &heap->pairheap);
         if (entry->flags & SOFT_TIMER_FLAG_PY_CALLBACK) {
@@ -89,17 +198,17 @@ void soft_timer_handler(void) {
             entry->c_callback(entry);
         }
         if (entry->mode == SOFT_TIMER_MODE_PERIODIC) {
-            entry->expiry_ms += entry->delta_ms;
+            entry->expiry += entry->delta;
             heap = (soft_timer_entry_t *)mp_pairheap_push(soft_timer_lt, &heap->pairheap, &entry->pairheap);
         }
     }
     soft_timer_heap = heap;
     if (heap == NULL) {
-        // No more timers left, set largest delay possible
-        soft_timer_next = uwTick;
+        // No more timers left
+        soft_timer_schedule_none();
     } else {
-        // Set soft_timer_next so SysTick calls us back at the correct time
-        soft_timer_schedule_systick(heap->expiry_ms);
+        // Arrange to be called back at the correct time
+        soft_timer_schedule_at(soft_timer_due(heap));
     }
 }
 
@@ -121,21 +230,32 @@ void soft_timer_gc_mark_all(void) {
     restore_irq_pri(irq_state);
 }
 
-void soft_timer_static_init(soft_timer_entry_t *entry, uint16_t mode, uint32_t delta_ms, void (*cb)(soft_timer_entry_t *)) {
+void soft_timer_static_init(soft_timer_entry_t *entry, uint16_t mode, uint32_t delta, void (*cb)(soft_timer_entry_t *)) {
     entry->flags = 0;
     entry->mode = mode;
-    entry->delta_ms = delta_ms;
+    entry->delta = delta;
+    entry->slack_mask = 0;
     entry->c_callback = cb;
 }
 
-void soft_timer_insert(soft_timer_entry_t *entry, uint32_t initial_delta_ms) {
+// Allow the timer to run up to slack ticks late, so it can share an interrupt
+// with other timers.  The slack is rounded down to a power of two.
+void soft_timer_set_slack(soft_timer_entry_t *entry, uint32_t slack) {
+    uint32_t mask = 0;
+    while (mask < slack >> 1) {
+        mask = mask << 1 | 1;
+    }
+    entry->slack_mask = slack == 0 ? 0 : mask;
+}
+
+void soft_timer_insert(soft_timer_entry_t *entry, uint32_t initial_delta) {
     mp_pairheap_init_node(soft_timer_lt, &entry->pairheap);
-    entry->expiry_ms = mp_hal_ticks_ms() + initial_delta_ms;
+    entry->expiry = soft_timer_ticks() + initial_delta;
     uint32_t irq_state = raise_irq_pri(IRQ_PRI_PENDSV);
     soft_timer_heap = (soft_timer_entry_t *)mp_pairheap_push(soft_timer_lt, &soft_timer_heap->pairheap, &entry->pairheap);
     if (entry == soft_timer_heap) {
-        // This new timer became the earliest one so set soft_timer_next
-        soft_timer_schedule_systick(entry->expiry_ms);
+        // This new timer became the earliest one so reschedule
+        soft_timer_schedule_at(soft_timer_due(entry));
     }
     restore_irq_pri(irq_state);
 }
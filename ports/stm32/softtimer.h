@@ -34,26 +34,44 @@
 #define SOFT_TIMER_MODE_ONE_SHOT (1)
 #define SOFT_TIMER_MODE_PERIODIC (2)
 
+// Soft timers count in microseconds when driven by a hardware timer, and in
+// milliseconds when driven by SysTick.
+#if MICROPY_HW_SOFTTIMER_TIM
+#define SOFT_TIMER_TICKS_PER_MS (1000)
+#else
+#define SOFT_TIMER_TICKS_PER_MS (1)
+#endif
+
 typedef struct _soft_timer_entry_t {
     mp_pairheap_t pairheap;
     uint16_t flags;
     uint16_t mode;
-    uint32_t expiry_ms;
-    uint32_t delta_ms; // for periodic mode
+    uint32_t expiry; // in ticks, before rounding up for the slack
+    uint32_t delta; // for periodic mode, in ticks
+    uint32_t slack_mask; // expiry is rounded up to a multiple of this plus 1
     union {
         void (*c_callback)(struct _soft_timer_entry_t *);
         mp_obj_t py_callback;
     };
 } soft_timer_entry_t;
 
+#if !MICROPY_HW_SOFTTIMER_TIM
 extern volatile uint32_t soft_timer_next;
+#endif
 
+void soft_timer_init(void);
 void soft_timer_deinit(void);
 void soft_timer_handler(void);
 void soft_timer_gc_mark_all(void);
+#if MICROPY_HW_SOFTTIMER_TIM
+void soft_timer_tim_irq_handler(void);
+void soft_timer_tim_update_freq(void);
+#endif
 
-void soft_timer_static_init(soft_timer_entry_t *entry, uint16_t mode, uint32_t delta_ms, void (*cb)(soft_timer_entry_t *));
-void soft_timer_insert(soft_timer_entry_t *entry, uint32_t initial_delta_ms);
+uint32_t soft_timer_ticks(void);
+void soft_timer_static_init(soft_timer_entry_t *entry, uint16_t mode, uint32_t delta, void (*cb)(soft_timer_entry_t *));
+void soft_timer_set_slack(soft_timer_entry_t *entry, uint32_t slack);
+void soft_timer_insert(soft_timer_entry_t *entry, uint32_t initial_delta);
 void soft_timer_remove(soft_timer_entry_t *entry);
 
 #endif // MICROPY_INCLUDED_STM32_SOFTTIMER_H
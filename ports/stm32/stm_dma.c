@@ -0,0 +1,389 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "py/runtime.h"
+#include "py/mperrno.h"
+#include "py/mphal.h"
+#include "dma.h"
+#include "portmodules.h"
+
+#if MICROPY_PY_STM_DMA
+
+// stm.DMA claims a DMA stream, so it is not used by SPI or I2C, and runs
+// memory-to-memory transfers or transfers to and from a peripheral register.
+// A peripheral transfer can be circular, and double-buffered, where the
+// stream switches between two buffers so one can be processed while the
+// other is filled (or drained).  A completion callback is scheduled at the
+// end of a transfer, or of each buffer.
+
+#define STM_DMA_MEM2MEM (-1)
+
+typedef struct _stm_dma_obj_t {
+    mp_obj_base_t base;
+    const dma_descr_t *descr;
+    uint8_t id;
+    uint8_t channel;
+    uint8_t priority;
+    bool error;
+    mp_obj_t callback;
+    mp_obj_t buf[3]; // kept alive while the transfer runs
+    void *dest[2]; // memory buffers written by the transfer
+    size_t dest_len;
+    DMA_HandleTypeDef hdma;
+} stm_dma_obj_t;
+
+STATIC const uint32_t stm_dma_priority[] = {
+    DMA_PRIORITY_LOW, DMA_PRIORITY_MEDIUM, DMA_PRIORITY_HIGH, DMA_PRIORITY_VERY_HIGH,
+};
+
+STATIC void stm_dma_stop_transfer(stm_dma_obj_t *self) {
+    if (self->hdma.Instance != NULL) {
+        HAL_DMA_Abort(&self->hdma);
+        dma_deinit(self->descr);
+        self->hdma.Instance = NULL;
+    }
+    self->buf[0] = self->buf[1] = self->buf[2] = MP_OBJ_NULL;
+}
+
+STATIC void stm_dma_release(stm_dma_obj_t *self) {
+    if (self->descr != NULL) {
+        stm_dma_stop_transfer(self);
+        dma_release_stream(self->descr);
+        MP_STATE_PORT(stm_dma_obj)[self->id] = NULL;
+        self->descr = NULL;
+    }
+}
+
+void stm_dma_deinit_all(void) {
+    for (size_t i = 0; i < MP_ARRAY_SIZE(MP_STATE_PORT(stm_dma_obj)); ++i) {
+        if (MP_STATE_PORT(stm_dma_obj)[i] != NULL) {
+            stm_dma_release(MP_STATE_PORT(stm_dma_obj)[i]);
+        }
+    }
+}
+
+STATIC stm_dma_obj_t *stm_dma_get(mp_obj_t self_in) {
+    stm_dma_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (self->descr == NULL) {
+        mp_raise_OSError(MP_EPERM);
+    }
+    return self;
+}
+
+STATIC void stm_dma_done(DMA_HandleTypeDef *hdma, size_t target) {
+    stm_dma_obj_t *self = hdma->Parent;
+    if (self->dest[target] != NULL) {
+        MP_HAL_CLEANINVALIDATE_DCACHE(self->dest[target], self->dest_len);
+    }
+    if (self->callback != mp_const_none) {
+        mp_sched_schedule(self->callback, MP_OBJ_FROM_PTR(self));
+    }
+}
+
+STATIC void stm_dma_xfer_cplt(DMA_HandleTypeDef *hdma) {
+    stm_dma_done(hdma, 0);
+}
+
+STATIC void stm_dma_xfer_m1_cplt(DMA_HandleTypeDef *hdma) {
+    stm_dma_done(hdma, 1);
+}
+
+STATIC void stm_dma_xfer_error(DMA_HandleTypeDef *hdma) {
+    stm_dma_obj_t *self = hdma->Parent;
+    self->error = true;
+    if (self->callback != mp_const_none) {
+        mp_sched_schedule(self->callback, MP_OBJ_FROM_PTR(self));
+    }
+}
+
+STATIC void stm_dma_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
+    stm_dma_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (self->descr == NULL) {
+        mp_printf(print, "DMA(deinit)");
+    } else {
+        mp_printf(print, "DMA(%u, %u, %u, priority=%u)", self->id / 8 + 1, self->id % 8, self->channel, self->priority);
+    }
+}
+
+// DMA([controller, stream[, channel]], *, priority=DMA.PRIORITY_LOW)
+STATIC mp_obj_t stm_dma_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *all_args) {
+    enum { ARG_controller, ARG_stream, ARG_channel, ARG_priority };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_controller, MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_stream, MP_ARG_INT, {.u_int = -1} },
+        { MP_QSTR_channel, MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_priority, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 0} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all_kw_array(n_args, n_kw, all_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    int id = STM_DMA_MEM2MEM;
+    if (args[ARG_controller].u_int != 0 || args[ARG_stream].u_int != -1) {
+        mp_int_t controller = args[ARG_controller].u_int;
+        mp_int_t stream = args[ARG_stream].u_int;
+        if (controller < 1 || controller > 2 || stream < 0 || stream > 7) {
+            mp_raise_ValueError(MP_ERROR_TEXT("invalid stream"));
+        }
+        id = (controller - 1) * 8 + stream;
+    }
+    mp_uint_t channel = args[ARG_channel].u_int;
+    if (channel > DMA_SxCR_CHSEL >> DMA_SxCR_CHSEL_Pos) {
+        mp_raise_ValueError(MP_ERROR_TEXT("invalid channel"));
+    }
+    mp_uint_t priority = args[ARG_priority].u_int;
+    if (priority >= MP_ARRAY_SIZE(stm_dma_priority)) {
+        mp_raise_ValueError(MP_ERROR_TEXT("invalid priority"));
+    }
+
+    const dma_descr_t *descr = dma_claim_stream(id, channel);
+    if (descr == NULL) {
+        mp_raise_OSError(MP_EBUSY);
+    }
+    stm_dma_obj_t *self = m_new0(stm_dma_obj_t, 1);
+    self->base.type = type;
+    self->descr = descr;
+    self->id = dma_descr_get_id(descr);
+    self->channel = channel;
+    self->priority = priority;
+    self->callback = mp_const_none;
+    MP_STATE_PORT(stm_dma_obj)[self->id] = self;
+    return MP_OBJ_FROM_PTR(self);
+}
+
+// Get the address of a transfer end, which is an integer address (a
+// peripheral register) or a buffer of at least len bytes.
+STATIC uint32_t stm_dma_get_addr(mp_obj_t obj, size_t len, int flags, bool *is_buf) {
+    mp_buffer_info_t bufinfo;
+    if (!mp_obj_is_int(obj) && mp_get_buffer(obj, &bufinfo, flags)) {
+        if (bufinfo.len < len) {
+            mp_raise_ValueError(MP_ERROR_TEXT("buffer too small"));
+        }
+        *is_buf = true;
+        return (uint32_t)bufinfo.buf;
+    }
+    *is_buf = false;
+    return mp_obj_get_int_truncated(obj);
+}
+
+// DMA.start(src, dst, count, *, size=1, circular=False, callback=None)
+STATIC mp_obj_t stm_dma_start(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_src, ARG_dst, ARG_count, ARG_size, ARG_circular, ARG_callback };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_src, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+        { MP_QSTR_dst, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+        { MP_QSTR_count, MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_size, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 1} },
+        { MP_QSTR_circular, MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = false} },
+        { MP_QSTR_callback, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+    };
+    stm_dma_obj_t *self = stm_dma_get(pos_args[0]);
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    if (self->hdma.Instance != NULL && HAL_DMA_GetState(&self->hdma) == HAL_DMA_STATE_BUSY) {
+        mp_raise_OSError(MP_EBUSY);
+    }
+    mp_int_t count = args[ARG_count].u_int;
+    mp_int_t size = args[ARG_size].u_int;
+    if (count <= 0 || count > 65535) {
+        mp_raise_ValueError(MP_ERROR_TEXT("invalid count"));
+    }
+    if (size != 1 && size != 2 && size != 4) {
+        mp_raise_ValueError(MP_ERROR_TEXT("invalid size"));
+    }
+    size_t len = count * size;
+
+    // Two buffers on the memory side of a peripheral transfer make it
+    // double-buffered.
+    mp_obj_t src = args[ARG_src].u_obj;
+    mp_obj_t dst = args[ARG_dst].u_obj;
+    mp_obj_t *items = NULL;
+    mp_obj_t second = MP_OBJ_NULL;
+    uint32_t dir;
+    bool src_buf, dst_buf, second_buf = true;
+    uint32_t src_addr, dst_addr, second_addr = 0;
+    if (mp_obj_is_type(dst, &mp_type_tuple) || mp_obj_is_type(dst, &mp_type_list)) {
+        mp_obj_get_array_fixed_n(dst, 2, &items);
+        dst = items[0];
+        second = items[1];
+        src_addr = stm_dma_get_addr(src, len, MP_BUFFER_READ, &src_buf);
+        dst_addr = stm_dma_get_addr(dst, len, MP_BUFFER_WRITE, &dst_buf);
+        second_addr = stm_dma_get_addr(second, len, MP_BUFFER_WRITE, &second_buf);
+        dir = DMA_PERIPH_TO_MEMORY;
+    } else if (mp_obj_is_type(src, &mp_type_tuple) || mp_obj_is_type(src, &mp_type_list)) {
+        mp_obj_get_array_fixed_n(src, 2, &items);
+        src = items[0];
+        second = items[1];
+        src_addr = stm_dma_get_addr(src, len, MP_BUFFER_READ, &src_buf);
+        second_addr = stm_dma_get_addr(second, len, MP_BUFFER_READ, &second_buf);
+        dst_addr = stm_dma_get_addr(dst, len, MP_BUFFER_WRITE, &dst_buf);
+        dir = DMA_MEMORY_TO_PERIPH;
+    } else {
+        src_addr = stm_dma_get_addr(src, len, MP_BUFFER_READ, &src_buf);
+        dst_addr = stm_dma_get_addr(dst, len, MP_BUFFER_WRITE, &dst_buf);
+        if (!src_buf && dst_buf) {
+            dir = DMA_PERIPH_TO_MEMORY;
+        } else if (src_buf && !dst_buf) {
+            dir = DMA_MEMORY_TO_PERIPH;
+        } else {
+            dir = DMA_MEMORY_TO_MEMORY;
+        }
+    }
+    bool peripheral_buf = dir == DMA_PERIPH_TO_MEMORY ? src_buf : dir == DMA_MEMORY_TO_PERIPH ? dst_buf : false;
+    if (peripheral_buf || !second_buf) {
+        mp_raise_ValueError(MP_ERROR_TEXT("peripheral must be an address"));
+    }
+    if (dir == DMA_MEMORY_TO_MEMORY) {
+        if (self->id < 8) {
+            mp_raise_ValueError(MP_ERROR_TEXT("DMA1 can't do memory to memory"));
+        }
+        if (args[ARG_circular].u_bool) {
+            mp_raise_ValueError(MP_ERROR_TEXT("memory to memory can't be circular"));
+        }
+    }
+
+    dma_init(&self->hdma, self->descr, dir, self);
+    DMA_InitTypeDef *init = &self->hdma.Init;
+    // The HAL takes the source as the peripheral end of a memory-to-memory
+    // transfer.
+    init->PeriphInc = dir == DMA_MEMORY_TO_MEMORY ? DMA_PINC_ENABLE : DMA_PINC_DISABLE;
+    init->MemInc = DMA_MINC_ENABLE;
+    init->PeriphDataAlignment = size == 1 ? DMA_PDATAALIGN_BYTE : size == 2 ? DMA_PDATAALIGN_HALFWORD : DMA_PDATAALIGN_WORD;
+    init->MemDataAlignment = size == 1 ? DMA_MDATAALIGN_BYTE : size == 2 ? DMA_MDATAALIGN_HALFWORD : DMA_MDATAALIGN_WORD;
+    init->Mode = args[ARG_circular].u_bool || second != MP_OBJ_NULL ? DMA_CIRCULAR : DMA_NORMAL;
+    init->Priority = stm_dma_priority[self->priority];
+    HAL_DMA_Init(&self->hdma);
+    // Make the next peripheral to use this stream configure it afresh.
+    dma_invalidate_channel(self->descr);
+
+    self->error = false;
+    self->callback = args[ARG_callback].u_obj;
+    self->buf[0] = src;
+    self->buf[1] = dst;
+    self->buf[2] = second;
+    self->dest[0] = dst_buf ? (void *)dst_addr : NULL;
+    self->dest[1] = dir == DMA_PERIPH_TO_MEMORY && second != MP_OBJ_NULL ? (void *)second_addr : NULL;
+    self->dest_len = len;
+    if (src_buf) {
+        MP_HAL_CLEAN_DCACHE((void *)src_addr, len);
+        if (dir == DMA_MEMORY_TO_PERIPH && second != MP_OBJ_NULL) {
+            MP_HAL_CLEAN_DCACHE((void *)second_addr, len);
+        }
+    }
+    for (size_t i = 0; i < 2; ++i) {
+        if (self->dest[i] != NULL) {
+            MP_HAL_CLEANINVALIDATE_DCACHE(self->dest[i], len);
+        }
+    }
+
+    self->hdma.XferCpltCallback = stm_dma_xfer_cplt;
+    self->hdma.XferHalfCpltCallback = NULL;
+    self->hdma.XferM1CpltCallback = stm_dma_xfer_m1_cplt;
+    self->hdma.XferM1HalfCpltCallback = NULL;
+    self->hdma.XferErrorCallback = stm_dma_xfer_error;
+    HAL_StatusTypeDef status;
+    if (second == MP_OBJ_NULL) {
+        status = HAL_DMA_Start_IT(&self->hdma, src_addr, dst_addr, count);
+    } else {
+        // The HAL takes the memory end from src or dst according to the
+        // direction, and the second buffer is always on the memory end.
+        status = HAL_DMAEx_MultiBufferStart_IT(&self->hdma, src_addr, dst_addr, second_addr, count);
+    }
+    if (status != HAL_OK) {
+        stm_dma_stop_transfer(self);
+        mp_raise_OSError(MP_EIO);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(stm_dma_start_obj, 4, stm_dma_start);
+
+STATIC mp_obj_t stm_dma_stop(mp_obj_t self_in) {
+    stm_dma_stop_transfer(stm_dma_get(self_in));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(stm_dma_stop_obj, stm_dma_stop);
+
+// Whether a transfer is running; raises OSError if the last one failed.
+STATIC mp_obj_t stm_dma_active(mp_obj_t self_in) {
+    stm_dma_obj_t *self = stm_dma_get(self_in);
+    if (self->error) {
+        mp_raise_OSError(MP_EIO);
+    }
+    return mp_obj_new_bool(self->hdma.Instance != NULL && HAL_DMA_GetState(&self->hdma) == HAL_DMA_STATE_BUSY);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(stm_dma_active_obj, stm_dma_active);
+
+// Number of items left to transfer, to or from the current buffer.
+STATIC mp_obj_t stm_dma_remaining(mp_obj_t self_in) {
+    stm_dma_obj_t *self = stm_dma_get(self_in);
+    if (self->hdma.Instance == NULL) {
+        return MP_OBJ_NEW_SMALL_INT(0);
+    }
+    return MP_OBJ_NEW_SMALL_INT(__HAL_DMA_GET_COUNTER(&self->hdma));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(stm_dma_remaining_obj, stm_dma_remaining);
+
+// Index of the buffer that a double-buffered transfer is working on; the
+// other one is free to be used.
+STATIC mp_obj_t stm_dma_target(mp_obj_t self_in) {
+    stm_dma_obj_t *self = stm_dma_get(self_in);
+    if (self->hdma.Instance == NULL) {
+        return MP_OBJ_NEW_SMALL_INT(0);
+    }
+    return MP_OBJ_NEW_SMALL_INT((self->hdma.Instance->CR & DMA_SxCR_CT) != 0);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(stm_dma_target_obj, stm_dma_target);
+
+STATIC mp_obj_t stm_dma_deinit(mp_obj_t self_in) {
+    stm_dma_release(MP_OBJ_TO_PTR(self_in));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(stm_dma_deinit_obj, stm_dma_deinit);
+
+STATIC const mp_rom_map_elem_t stm_dma_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_start), MP_ROM_PTR(&stm_dma_start_obj) },
+    { MP_ROM_QSTR(MP_QSTR_stop), MP_ROM_PTR(&stm_dma_stop_obj) },
+    { MP_ROM_QSTR(MP_QSTR_active), MP_ROM_PTR(&stm_dma_active_obj) },
+    { MP_ROM_QSTR(MP_QSTR_remaining), MP_ROM_PTR(&stm_dma_remaining_obj) },
+    { MP_ROM_QSTR(MP_QSTR_target), MP_ROM_PTR(&stm_dma_target_obj) },
+    { MP_ROM_QSTR(MP_QSTR_deinit), MP_ROM_PTR(&stm_dma_deinit_obj) },
+
+    { MP_ROM_QSTR(MP_QSTR_PRIORITY_LOW), MP_ROM_INT(0) },
+    { MP_ROM_QSTR(MP_QSTR_PRIORITY_MEDIUM), MP_ROM_INT(1) },
+    { MP_ROM_QSTR(MP_QSTR_PRIORITY_HIGH), MP_ROM_INT(2) },
+    { MP_ROM_QSTR(MP_QSTR_PRIORITY_VERY_HIGH), MP_ROM_INT(3) },
+};
+STATIC MP_DEFINE_CONST_DICT(stm_dma_locals_dict, stm_dma_locals_dict_table);
+
+const mp_obj_type_t stm_dma_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_DMA,
+    .print = stm_dma_print,
+    .make_new = stm_dma_make_new,
+    .locals_dict = (mp_obj_dict_t *)&stm_dma_locals_dict,
+};
+
+#endif // MICROPY_PY_STM_DMA
@@ -325,60 +325,104 @@ STATIC mp_obj_t pyb_flash_make_new(const mp_obj_type_t *type, size_t n_args, siz
     return MP_OBJ_FROM_PTR(self);
 }
 
-STATIC mp_obj_t pyb_flash_readblocks(size_t n_args, const mp_obj_t *args) {
-    pyb_flash_obj_t *self = MP_OBJ_TO_PTR(args[0]);
-    uint32_t block_num = mp_obj_get_int(args[1]);
-    mp_buffer_info_t bufinfo;
-    mp_get_buffer_raise(args[2], &bufinfo, MP_BUFFER_WRITE);
-    mp_uint_t ret = -MP_EIO;
-    if (n_args == 3) {
+STATIC int pyb_flash_bdev_readblocks(mp_obj_t self_in, uint32_t block_num, uint32_t block_off, uint8_t *buf, size_t len, bool ext) {
+    pyb_flash_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    int ret = -MP_EIO;
+    if (!ext) {
         // Cast self->start to signed in case it's pyb_flash_obj with negative start
         block_num += FLASH_PART1_START_BLOCK + (int32_t)self->start / FLASH_BLOCK_SIZE;
-        ret = storage_read_blocks(bufinfo.buf, block_num, bufinfo.len / FLASH_BLOCK_SIZE);
+        ret = storage_read_blocks(buf, block_num, len / FLASH_BLOCK_SIZE);
     }
     #if defined(MICROPY_HW_BDEV_READBLOCKS_EXT)
     else if (self != &pyb_flash_obj) {
         // Extended block read on a sub-section of the flash storage
-        uint32_t offset = mp_obj_get_int(args[3]);
         if ((block_num * PYB_FLASH_NATIVE_BLOCK_SIZE) >= self->len) {
             ret = -MP_EFAULT; // Bad address
         } else {
             block_num += self->start / PYB_FLASH_NATIVE_BLOCK_SIZE;
-            ret = MICROPY_HW_BDEV_READBLOCKS_EXT(bufinfo.buf, block_num, offset, bufinfo.len);
+            ret = MICROPY_HW_BDEV_READBLOCKS_EXT(buf, block_num, block_off, len);
         }
     }
     #endif
-    return MP_OBJ_NEW_SMALL_INT(ret);
+    return ret;
 }
-STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(pyb_flash_readblocks_obj, 3, 4, pyb_flash_readblocks);
 
-STATIC mp_obj_t pyb_flash_writeblocks(size_t n_args, const mp_obj_t *args) {
-    pyb_flash_obj_t *self = MP_OBJ_TO_PTR(args[0]);
-    uint32_t block_num = mp_obj_get_int(args[1]);
-    mp_buffer_info_t bufinfo;
-    mp_get_buffer_raise(args[2], &bufinfo, MP_BUFFER_READ);
-    mp_uint_t ret = -MP_EIO;
-    if (n_args == 3) {
+STATIC int pyb_flash_bdev_writeblocks(mp_obj_t self_in, uint32_t block_num, uint32_t block_off, const uint8_t *buf, size_t len, bool ext) {
+    pyb_flash_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    int ret = -MP_EIO;
+    if (!ext) {
         // Cast self->start to signed in case it's pyb_flash_obj with negative start
         block_num += FLASH_PART1_START_BLOCK + (int32_t)self->start / FLASH_BLOCK_SIZE;
-        ret = storage_write_blocks(bufinfo.buf, block_num, bufinfo.len / FLASH_BLOCK_SIZE);
+        ret = storage_write_blocks(buf, block_num, len / FLASH_BLOCK_SIZE);
     }
     #if defined(MICROPY_HW_BDEV_WRITEBLOCKS_EXT)
     else if (self != &pyb_flash_obj) {
         // Extended block write on a sub-section of the flash storage
-        uint32_t offset = mp_obj_get_int(args[3]);
         if ((block_num * PYB_FLASH_NATIVE_BLOCK_SIZE) >= self->len) {
             ret = -MP_EFAULT; // Bad address
         } else {
             block_num += self->start / PYB_FLASH_NATIVE_BLOCK_SIZE;
-            ret = MICROPY_HW_BDEV_WRITEBLOCKS_EXT(bufinfo.buf, block_num, offset, bufinfo.len);
+            ret = MICROPY_HW_BDEV_WRITEBLOCKS_EXT(buf, block_num, block_off, len);
         }
     }
     #endif
+    return ret;
+}
+
+STATIC mp_obj_t pyb_flash_readblocks(size_t n_args, const mp_obj_t *args) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[2], &bufinfo, MP_BUFFER_WRITE);
+    uint32_t block_off = n_args == 4 ? mp_obj_get_int(args[3]) : 0;
+    int ret = pyb_flash_bdev_readblocks(args[0], mp_obj_get_int(args[1]), block_off, bufinfo.buf, bufinfo.len, n_args == 4);
+    return MP_OBJ_NEW_SMALL_INT(ret);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(pyb_flash_readblocks_obj, 3, 4, pyb_flash_readblocks);
+
+STATIC mp_obj_t pyb_flash_writeblocks(size_t n_args, const mp_obj_t *args) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[2], &bufinfo, MP_BUFFER_READ);
+    uint32_t block_off = n_args == 4 ? mp_obj_get_int(args[3]) : 0;
+    int ret = pyb_flash_bdev_writeblocks(args[0], mp_obj_get_int(args[1]), block_off, bufinfo.buf, bufinfo.len, n_args == 4);
     return MP_OBJ_NEW_SMALL_INT(ret);
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(pyb_flash_writeblocks_obj, 3, 4, pyb_flash_writeblocks);
 
+#if MICROPY_VFS_MMAP && MICROPY_HW_ENABLE_INTERNAL_FLASH_STORAGE && !defined(SPIFLASH)
+#define PYB_FLASH_MMAP (1)
+STATIC const uint8_t *pyb_flash_bdev_mmap(mp_obj_t self_in, uint32_t block_num, uint32_t *num_blocks) {
+    pyb_flash_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    // Cast self->start to signed in case it's pyb_flash_obj with negative start
+    int32_t block = (int32_t)block_num + (int32_t)self->start / FLASH_BLOCK_SIZE;
+    if (block < 0) {
+        // the emulated partition table is not stored in flash
+        return NULL;
+    }
+    uint32_t n;
+    const uint8_t *addr = flash_bdev_get_addr(block, &n);
+    if (addr != NULL && self != &pyb_flash_obj) {
+        uint32_t len_blocks = self->len / FLASH_BLOCK_SIZE;
+        if (block_num >= len_blocks) {
+            return NULL;
+        }
+        n = MIN(n, len_blocks - block_num);
+    }
+    *num_blocks = n;
+    return addr;
+}
+#else
+#define PYB_FLASH_MMAP (0)
+#endif
+
+STATIC const mp_block_dev_p_t pyb_flash_block_dev_p = {
+    .readblocks_obj = &pyb_flash_readblocks_obj,
+    .writeblocks_obj = &pyb_flash_writeblocks_obj,
+    .readblocks = pyb_flash_bdev_readblocks,
+    .writeblocks = pyb_flash_bdev_writeblocks,
+    #if PYB_FLASH_MMAP
+    .mmap = pyb_flash_bdev_mmap,
+    #endif
+};
+
 STATIC mp_obj_t pyb_flash_ioctl(mp_obj_t self_in, mp_obj_t cmd_in, mp_obj_t arg_in) {
     pyb_flash_obj_t *self = MP_OBJ_TO_PTR(self_in);
     mp_int_t cmd = mp_obj_get_int(cmd_in);
@@ -461,6 +505,7 @@ const mp_obj_type_t pyb_flash_type = {
     .name = MP_QSTR_Flash,
     .print = pyb_flash_print,
     .make_new = pyb_flash_make_new,
+    .protocol = &pyb_flash_block_dev_p,
     .locals_dict = (mp_obj_dict_t *)&pyb_flash_locals_dict,
 };
 
@@ -57,6 +57,7 @@ bool flash_bdev_readblock(uint8_t *dest, uint32_t block);
 bool flash_bdev_writeblock(const uint8_t *src, uint32_t block);
 int flash_bdev_readblocks_ext(uint8_t *dest, uint32_t block, uint32_t offset, uint32_t len);
 int flash_bdev_writeblocks_ext(const uint8_t *src, uint32_t block, uint32_t offset, uint32_t len);
+const uint8_t *flash_bdev_get_addr(uint32_t block, uint32_t *num_blocks);
 
 typedef struct _spi_bdev_t {
     mp_spiflash_t spiflash;
@@ -26,6 +26,7 @@
 
 #include "py/runtime.h"
 #include "py/mphal.h"
+#include "py/profile.h"
 #include "irq.h"
 #include "pendsv.h"
 #include "systick.h"
@@ -54,9 +55,15 @@ void SysTick_Handler(void) {
         f(uw_tick);
     }
 
+    #if MICROPY_SAMPLING_PROFILE
+    mp_prof_sample_tick();
+    #endif
+
+    #if !MICROPY_HW_SOFTTIMER_TIM
     if (soft_timer_next == uw_tick) {
         pendsv_schedule_dispatch(PENDSV_DISPATCH_SOFT_TIMER, soft_timer_handler);
     }
+    #endif
 
     #if MICROPY_PY_THREAD
     if (pyb_thread_enabled) {
@@ -30,6 +30,7 @@
 #include "py/runtime.h"
 #include "py/gc.h"
 #include "timer.h"
+#include "softtimer.h"
 #include "servo.h"
 #include "pin.h"
 #include "irq.h"
@@ -77,6 +78,9 @@
 //
 // TIM6:
 //  - ADC, DAC for read_timed and write_timed
+//
+// TIM2, if MICROPY_HW_SOFTTIMER_TIM is 2:
+//  - soft timers (machine.Timer), output compare channel 1
 
 typedef enum {
     CHANNEL_MODE_PWM_NORMAL,
@@ -897,7 +901,7 @@ STATIC mp_obj_t pyb_timer_make_new(const mp_obj_type_t *type, size_t n_args, siz
     }
 
     // check if the timer is reserved for system use or not
-    if (MICROPY_HW_TIM_IS_RESERVED(tim_id)) {
+    if (MICROPY_HW_TIM_IS_RESERVED(tim_id) || tim_id == MICROPY_HW_SOFTTIMER_TIM) {
         mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("Timer(%d) is reserved"), tim_id);
     }
 
@@ -1622,6 +1626,12 @@ STATIC void timer_handle_irq_channel(pyb_timer_obj_t *tim, uint8_t channel, mp_o
 }
 
 void timer_irq_handler(uint tim_id) {
+    #if MICROPY_HW_SOFTTIMER_TIM
+    if (tim_id == MICROPY_HW_SOFTTIMER_TIM) {
+        soft_timer_tim_irq_handler();
+        return;
+    }
+    #endif
     if (tim_id - 1 < PYB_TIMER_OBJ_ALL_NUM) {
         // get the timer object
         pyb_timer_obj_t *tim = MP_STATE_PORT(pyb_timer_obj_all)[tim_id - 1];
@@ -36,6 +36,7 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
 
 #include "usbd_cdc_msc_hid.h"
 #include "usbd_cdc_interface.h"
@@ -294,18 +295,29 @@ int8_t usbd_cdc_receive(usbd_cdc_state_t *cdc_in, size_t len) {
     usbd_cdc_itf_t *cdc = (usbd_cdc_itf_t *)cdc_in;
 
     // copy the incoming data into the circular buffer
-    for (const uint8_t *src = cdc->rx_packet_buf, *top = cdc->rx_packet_buf + len; src < top; ++src) {
-        if (cdc->attached_to_repl && *src == mp_interrupt_char) {
-            pendsv_kbd_intr();
-        } else {
-            uint16_t next_put = (cdc->rx_buf_put + 1) & (USBD_CDC_RX_DATA_SIZE - 1);
-            if (next_put == cdc->rx_buf_get) {
-                // overflow, we just discard the rest of the chars
-                break;
+    if (cdc->attached_to_repl && mp_interrupt_char != -1) {
+        // look at each char for the interrupt char
+        for (const uint8_t *src = cdc->rx_packet_buf, *top = cdc->rx_packet_buf + len; src < top; ++src) {
+            if (*src == mp_interrupt_char) {
+                pendsv_kbd_intr();
+            } else {
+                uint16_t next_put = (cdc->rx_buf_put + 1) & (USBD_CDC_RX_DATA_SIZE - 1);
+                if (next_put == cdc->rx_buf_get) {
+                    // overflow, we just discard the rest of the chars
+                    break;
+                }
+                cdc->rx_user_buf[cdc->rx_buf_put] = *src;
+                cdc->rx_buf_put = next_put;
             }
-            cdc->rx_user_buf[cdc->rx_buf_put] = *src;
-            cdc->rx_buf_put = next_put;
         }
+    } else {
+        // copy as much as fits, in at most two pieces; on overflow the rest is discarded
+        uint16_t put = cdc->rx_buf_put;
+        size_t n = MIN(len, (size_t)((cdc->rx_buf_get - put - 1) & (USBD_CDC_RX_DATA_SIZE - 1)));
+        size_t n1 = MIN(n, (size_t)(USBD_CDC_RX_DATA_SIZE - put));
+        memcpy(&cdc->rx_user_buf[put], cdc->rx_packet_buf, n1);
+        memcpy(&cdc->rx_user_buf[0], cdc->rx_packet_buf + n1, n - n1);
+        cdc->rx_buf_put = (put + n) & (USBD_CDC_RX_DATA_SIZE - 1);
     }
 
     if ((cdc->flow & USBD_CDC_FLOWCONTROL_RTS) && (usbd_cdc_rx_buffer_full(cdc))) {
@@ -339,7 +351,7 @@ int usbd_cdc_tx_flow(usbd_cdc_itf_t *cdc, const uint8_t *buf, uint32_t len) {
 // timout in milliseconds.
 // Returns number of bytes written to the device.
 int usbd_cdc_tx(usbd_cdc_itf_t *cdc, const uint8_t *buf, uint32_t len, uint32_t timeout) {
-    for (uint32_t i = 0; i < len; i++) {
+    for (uint32_t i = 0; i < len;) {
         // Wait until the device is connected and the buffer has space, with a given timeout
         uint32_t start = HAL_GetTick();
         while (cdc->connect_state == USBD_CDC_CONNECT_STATE_DISCONNECTED || usbd_cdc_tx_buffer_full(cdc)) {
@@ -356,13 +368,19 @@ int usbd_cdc_tx(usbd_cdc_itf_t *cdc, const uint8_t *buf, uint32_t len, uint32_t
             __WFI(); // enter sleep mode, waiting for interrupt
         }
 
-        // Write data to device buffer
-        usbd_cdc_tx_buffer_put(cdc, buf[i], false);
+        // Write as much data as fits, up to the end of the device buffer, and
+        // start sending it while the rest is copied
+        uint16_t in = usbd_cdc_tx_buffer_mask(cdc->tx_buf_ptr_in);
+        uint32_t n = MIN(len - i, (uint32_t)(USBD_CDC_TX_DATA_SIZE - usbd_cdc_tx_buffer_size(cdc)));
+        n = MIN(n, (uint32_t)(USBD_CDC_TX_DATA_SIZE - in));
+        memcpy(&cdc->tx_buf[in], buf + i, n);
+        __DMB(); // data must be in the buffer before the IRQ can see it
+        cdc->tx_buf_ptr_in += n;
+        i += n;
+        usbd_cdc_try_tx(cdc);
     }
 
-    usbd_cdc_try_tx(cdc);
-
-    // Success, return number of bytes read
+    // Success, return number of bytes written
     return len;
 }
 
@@ -413,7 +431,7 @@ int usbd_cdc_rx_num(usbd_cdc_itf_t *cdc) {
 // Returns number of bytes read from the device.
 int usbd_cdc_rx(usbd_cdc_itf_t *cdc, uint8_t *buf, uint32_t len, uint32_t timeout) {
     // loop to read bytes
-    for (uint32_t i = 0; i < len; i++) {
+    for (uint32_t i = 0; i < len;) {
         // Wait until we have at least 1 byte to read
         uint32_t start = HAL_GetTick();
         while (cdc->rx_buf_put == cdc->rx_buf_get) {
@@ -430,9 +448,12 @@ int usbd_cdc_rx(usbd_cdc_itf_t *cdc, uint8_t *buf, uint32_t len, uint32_t timeou
             __WFI(); // enter sleep mode, waiting for interrupt
         }
 
-        // Copy byte from device to user buffer
-        buf[i] = cdc->rx_user_buf[cdc->rx_buf_get];
-        cdc->rx_buf_get = (cdc->rx_buf_get + 1) & (USBD_CDC_RX_DATA_SIZE - 1);
+        // Copy what is available, up to the end of the device buffer, to the user buffer
+        uint16_t get = cdc->rx_buf_get, put = cdc->rx_buf_put;
+        uint32_t n = MIN(len - i, (uint32_t)((put > get ? put : USBD_CDC_RX_DATA_SIZE) - get));
+        memcpy(buf + i, &cdc->rx_user_buf[get], n);
+        cdc->rx_buf_get = (get + n) & (USBD_CDC_RX_DATA_SIZE - 1);
+        i += n;
     }
     usbd_cdc_rx_check_resume(cdc);
 
@@ -31,12 +31,22 @@
   ******************************************************************************
   */
 
+// With a high-speed CDC endpoint the default buffers hold several 512-byte
+// packets, so that each IN transfer can carry a few of them.
 #ifndef USBD_CDC_RX_DATA_SIZE
+#if CDC_DATA_MAX_PACKET_SIZE > CDC_DATA_FS_MAX_PACKET_SIZE
+#define USBD_CDC_RX_DATA_SIZE (4096)
+#else
 #define USBD_CDC_RX_DATA_SIZE (1024) // this must be 2 or greater, and a power of 2
 #endif
+#endif
 #ifndef USBD_CDC_TX_DATA_SIZE
+#if CDC_DATA_MAX_PACKET_SIZE > CDC_DATA_FS_MAX_PACKET_SIZE
+#define USBD_CDC_TX_DATA_SIZE (4096)
+#else
 #define USBD_CDC_TX_DATA_SIZE (1024) // This must be a power of 2 and no greater than 16384
 #endif
+#endif
 
 // Values for connect_state
 #define USBD_CDC_CONNECT_STATE_DISCONNECTED (0)
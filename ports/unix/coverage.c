@@ -585,6 +585,38 @@ STATIC mp_obj_t extra_coverage(void) {
         ringbuf.iget = 0;
         ringbuf_put(&ringbuf, 0xaa);
         mp_printf(&mp_plat_print, "%d\n", ringbuf_get16(&ringbuf));
+
+        // Bulk put/get, wrapping around the end of the buffer.
+        byte data[120];
+        for (size_t i = 0; i < sizeof(data); ++i) {
+            data[i] = i;
+        }
+        ringbuf.iput = 90;
+        ringbuf.iget = 90;
+        mp_printf(&mp_plat_print, "%d\n", (int)ringbuf_put_bytes(&ringbuf, data, 20));
+        mp_printf(&mp_plat_print, "%d %d\n", ringbuf_free(&ringbuf), ringbuf_avail(&ringbuf));
+        memset(data, 0, 20);
+        mp_printf(&mp_plat_print, "%d\n", (int)ringbuf_get_bytes(&ringbuf, data, 30));
+        mp_printf(&mp_plat_print, "%d %d\n", data[0], data[19]);
+
+        // Bulk put into a nearly full ringbuf, and get from an empty one.
+        mp_printf(&mp_plat_print, "%d\n", (int)ringbuf_put_bytes(&ringbuf, data, sizeof(data)));
+        mp_printf(&mp_plat_print, "%d %d\n", ringbuf_free(&ringbuf), ringbuf_avail(&ringbuf));
+        mp_printf(&mp_plat_print, "%d\n", (int)ringbuf_get_bytes(&ringbuf, data, sizeof(data)));
+        mp_printf(&mp_plat_print, "%d\n", (int)ringbuf_get_bytes(&ringbuf, data, sizeof(data)));
+
+        // Zero-copy spans.
+        uint8_t *span;
+        ringbuf.iput = 95;
+        ringbuf.iget = 95;
+        mp_printf(&mp_plat_print, "%d\n", (int)ringbuf_put_span(&ringbuf, &span));
+        span[0] = 0x42;
+        ringbuf_put_commit(&ringbuf, 5);
+        mp_printf(&mp_plat_print, "%d %d\n", (int)ringbuf_put_span(&ringbuf, &span), ringbuf.iput);
+        mp_printf(&mp_plat_print, "%d\n", (int)ringbuf_peek_span(&ringbuf, &span));
+        mp_printf(&mp_plat_print, "%d\n", span[0]);
+        ringbuf_drop(&ringbuf, 5);
+        mp_printf(&mp_plat_print, "%d %d\n", (int)ringbuf_peek_span(&ringbuf, &span), ringbuf.iget);
     }
 
     // pairheap
@@ -31,6 +31,12 @@
 
 #include "lib/utils/gchelper.h"
 
+#if MICROPY_GC_PARALLEL_MARK
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#endif
+
 #if MICROPY_ENABLE_GC
 
 void gc_collect(void) {
@@ -50,4 +56,68 @@ void gc_collect(void) {
     // gc_dump_info();
 }
 
+#if MICROPY_GC_PARALLEL_MARK
+// The helper is a plain pthread, it doesn't touch any MicroPython thread state.
+// It's created by the first collection and then sleeps until the next one
+// wakes it, and it's only used when there's more than one CPU to run it on,
+// otherwise the collector would just spin until the helper was scheduled.
+
+STATIC volatile char gc_parallel_spinlock;
+STATIC pthread_mutex_t gc_parallel_helper_mutex = PTHREAD_MUTEX_INITIALIZER;
+STATIC pthread_cond_t gc_parallel_helper_cond = PTHREAD_COND_INITIALIZER;
+// 0 until the first collection, then 1 if the helper exists or -1 if not
+STATIC int gc_parallel_helper_status;
+STATIC bool gc_parallel_helper_wanted;
+
+STATIC void *gc_parallel_helper_entry(void *arg) {
+    (void)arg;
+    for (;;) {
+        pthread_mutex_lock(&gc_parallel_helper_mutex);
+        while (!gc_parallel_helper_wanted) {
+            pthread_cond_wait(&gc_parallel_helper_cond, &gc_parallel_helper_mutex);
+        }
+        gc_parallel_helper_wanted = false;
+        pthread_mutex_unlock(&gc_parallel_helper_mutex);
+        gc_parallel_mark_helper();
+    }
+    return NULL;
+}
+
+bool gc_parallel_helper_start(void) {
+    pthread_mutex_lock(&gc_parallel_helper_mutex);
+    if (gc_parallel_helper_status == 0) {
+        gc_parallel_helper_status = -1;
+        if (sysconf(_SC_NPROCESSORS_ONLN) > 1) {
+            // the helper inherits a mask that blocks all signals, so they
+            // still go to the MicroPython threads
+            sigset_t all, old;
+            sigfillset(&all);
+            pthread_sigmask(SIG_SETMASK, &all, &old);
+            pthread_t t;
+            if (pthread_create(&t, NULL, gc_parallel_helper_entry, NULL) == 0) {
+                pthread_detach(t);
+                gc_parallel_helper_status = 1;
+            }
+            pthread_sigmask(SIG_SETMASK, &old, NULL);
+        }
+    }
+    bool started = gc_parallel_helper_status > 0;
+    if (started) {
+        gc_parallel_helper_wanted = true;
+        pthread_cond_signal(&gc_parallel_helper_cond);
+    }
+    pthread_mutex_unlock(&gc_parallel_helper_mutex);
+    return started;
+}
+
+void gc_parallel_lock(void) {
+    while (__atomic_test_and_set(&gc_parallel_spinlock, __ATOMIC_ACQUIRE)) {
+    }
+}
+
+void gc_parallel_unlock(void) {
+    __atomic_clear(&gc_parallel_spinlock, __ATOMIC_RELEASE);
+}
+#endif
+
 #endif // MICROPY_ENABLE_GC
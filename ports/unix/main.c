@@ -46,6 +46,7 @@
 #include "py/stackctrl.h"
 #include "py/mphal.h"
 #include "py/mpthread.h"
+#include "py/heapimage.h"
 #include "extmod/misc.h"
 #include "extmod/vfs.h"
 #include "extmod/vfs_posix.h"
@@ -415,6 +416,51 @@ STATIC void set_sys_argv(char *argv[], int argc, int start_arg) {
     }
 }
 
+#if MICROPY_QSTR_SNAPSHOT || MICROPY_HEAP_IMAGE
+// Read a whole file into a buffer from malloc, returns NULL on error.
+STATIC byte *read_whole_file(const char *path, size_t *len_out) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    byte *buf = len > 0 ? malloc(len) : NULL;
+    if (buf != NULL && fread(buf, 1, len, f) != (size_t)len) {
+        free(buf);
+        buf = NULL;
+    }
+    fclose(f);
+    *len_out = len;
+    return buf;
+}
+#endif
+
+#if MICROPY_QSTR_SNAPSHOT
+// Load a file written from micropython.qstr_snapshot().  The data is used in
+// place so it's never freed.
+STATIC void load_qstr_snapshot(const char *path) {
+    size_t len;
+    byte *buf = read_whole_file(path, &len);
+    if (buf != NULL && !qstr_snapshot_load(buf, len)) {
+        free(buf);
+    }
+}
+#endif
+
+#if MICROPY_HEAP_IMAGE
+// Restore a file written from micropython.heap_image_save(), returns true if
+// it was restored.
+STATIC bool restore_heap_image(const char *path) {
+    size_t len;
+    byte *buf = read_whole_file(path, &len);
+    bool restored = buf != NULL && mp_heap_image_restore(buf, len);
+    free(buf);
+    return restored;
+}
+#endif
+
 #ifdef _WIN32
 #define PATHLIST_SEP_CHAR ';'
 #else
@@ -457,8 +503,15 @@ MP_NOINLINE int main_(int argc, char **argv) {
 
     #if MICROPY_ENABLE_GC
     char *heap = malloc(heap_size);
+    #if MICROPY_GC_SPLIT_HEAP
+    // split the heap into two regions to exercise the multi-region support,
+    // with large allocations preferring the second one
+    gc_init(heap, heap + heap_size / 2);
+    gc_add_region(heap + heap_size / 2, heap + heap_size, GC_REGION_FLAG_LARGE);
+    #else
     gc_init(heap, heap + heap_size);
     #endif
+    #endif
 
     #if MICROPY_ENABLE_PYSTACK
     static mp_obj_t pystack[1024];
@@ -467,6 +520,23 @@ MP_NOINLINE int main_(int argc, char **argv) {
 
     mp_init();
 
+    // the heap image includes the mounted filesystems and all qstrs
+    bool restored = false;
+    #if MICROPY_HEAP_IMAGE
+    char *heap_image_path = getenv("MICROPYHEAPIMAGE");
+    if (heap_image_path != NULL) {
+        restored = restore_heap_image(heap_image_path);
+    }
+    #endif
+
+    #if MICROPY_QSTR_SNAPSHOT
+    char *qstr_snapshot_path = getenv("MICROPYQSTRSNAPSHOT");
+    if (qstr_snapshot_path != NULL && !restored) {
+        load_qstr_snapshot(qstr_snapshot_path);
+    }
+    #endif
+    (void)restored;
+
     #if MICROPY_EMIT_NATIVE
     // Set default emitter options
     MP_STATE_VM(default_emit_opt) = emit_opt;
@@ -475,7 +545,7 @@ MP_NOINLINE int main_(int argc, char **argv) {
     #endif
 
     #if MICROPY_VFS_POSIX
-    {
+    if (!restored) {
         // Mount the host FS at the root of our internal VFS
         mp_obj_t args[2] = {
             mp_type_vfs_posix.make_new(&mp_type_vfs_posix, 0, 0, NULL),
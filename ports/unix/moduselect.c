@@ -37,6 +37,12 @@
 #include <errno.h>
 #include <poll.h>
 
+#if MICROPY_PY_USELECT_EPOLL
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#endif
+
 #include "py/runtime.h"
 #include "py/stream.h"
 #include "py/obj.h"
@@ -51,9 +57,301 @@
 extern const mp_obj_type_t mp_type_socket;
 #endif
 
+#if MICROPY_PY_USELECT_URING
+extern const mp_obj_type_t mp_type_uring;
+#endif
+
 // Flags for poll()
 #define FLAG_ONESHOT (1)
 
+STATIC int get_fd(mp_obj_t fdlike) {
+    if (mp_obj_is_obj(fdlike)) {
+        const mp_stream_p_t *stream_p = mp_get_stream_raise(fdlike, MP_STREAM_OP_IOCTL);
+        int err;
+        mp_uint_t res = stream_p->ioctl(fdlike, MP_STREAM_GET_FILENO, 0, &err);
+        if (res != MP_STREAM_ERROR) {
+            return res;
+        }
+    }
+    return mp_obj_get_int(fdlike);
+}
+
+#if MICROPY_PY_USELECT_EPOLL
+
+/// \class Poll - poll class, using epoll
+//
+// With epoll the kernel keeps the set of registered fds, so a poll only looks
+// at the fds that are ready instead of at every registered one.  The kernel
+// drops an fd from the set when it's closed, so unlike with poll() a closed
+// fd is not reported with POLLNVAL.  Regular files can't be used with epoll;
+// they are kept in file_map and are always ready, as with poll().
+
+typedef struct _mp_obj_poll_t {
+    mp_obj_base_t base;
+    int epfd;
+    int flags;
+    size_t alloc;
+    short iter_cnt;
+    short iter_idx;
+    struct epoll_event *events;
+    mp_map_t obj_map; // maps fd to the registered object (or fd)
+    mp_map_t file_map; // maps fd of a regular file to its eventmask
+    // callee-owned tuple
+    mp_obj_t ret_tuple;
+} mp_obj_poll_t;
+
+STATIC int poll_epoll_ctl(mp_obj_poll_t *self, int op, int fd, mp_uint_t flags) {
+    struct epoll_event ev;
+    ev.events = flags;
+    ev.data.fd = fd;
+    int ret = epoll_ctl(self->epfd, op, fd, &ev);
+    if (ret < 0 && op == EPOLL_CTL_MOD && errno == ENOENT) {
+        // The fd was closed, and so removed by the kernel, then reopened
+        ret = epoll_ctl(self->epfd, EPOLL_CTL_ADD, fd, &ev);
+    }
+    return ret < 0 ? errno : 0;
+}
+
+/// \method register(obj[, eventmask])
+STATIC mp_obj_t poll_register(size_t n_args, const mp_obj_t *args) {
+    mp_obj_poll_t *self = MP_OBJ_TO_PTR(args[0]);
+    int fd = get_fd(args[1]);
+    mp_obj_t fd_obj = MP_OBJ_NEW_SMALL_INT(fd);
+
+    mp_uint_t flags;
+    if (n_args == 3) {
+        flags = mp_obj_get_int(args[2]);
+    } else {
+        flags = POLLIN | POLLOUT;
+    }
+
+    mp_map_elem_t *file_elem = mp_map_lookup(&self->file_map, fd_obj, MP_MAP_LOOKUP);
+    if (file_elem != NULL) {
+        file_elem->value = MP_OBJ_NEW_SMALL_INT(flags);
+        return mp_const_false;
+    }
+
+    bool is_new = mp_map_lookup(&self->obj_map, fd_obj, MP_MAP_LOOKUP) == NULL;
+    int err = poll_epoll_ctl(self, is_new ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, fd, flags);
+    if (err == EPERM) {
+        // A regular file, always ready
+        mp_map_lookup(&self->file_map, fd_obj, MP_MAP_LOOKUP_ADD_IF_NOT_FOUND)->value = MP_OBJ_NEW_SMALL_INT(flags);
+    } else if (err != 0) {
+        mp_raise_OSError(err);
+    }
+
+    mp_map_lookup(&self->obj_map, fd_obj, MP_MAP_LOOKUP_ADD_IF_NOT_FOUND)->value = args[1];
+    // Keep at least one slot more than the number of regular files for epoll_wait
+    if (self->obj_map.used >= self->alloc) {
+        self->events = m_renew(struct epoll_event, self->events, self->alloc, self->alloc + 4);
+        self->alloc += 4;
+    }
+    return mp_obj_new_bool(is_new);
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(poll_register_obj, 2, 3, poll_register);
+
+/// \method unregister(obj)
+STATIC mp_obj_t poll_unregister(mp_obj_t self_in, mp_obj_t obj_in) {
+    mp_obj_poll_t *self = MP_OBJ_TO_PTR(self_in);
+    int fd = get_fd(obj_in);
+    mp_obj_t fd_obj = MP_OBJ_NEW_SMALL_INT(fd);
+    if (mp_map_lookup(&self->obj_map, fd_obj, MP_MAP_LOOKUP_REMOVE_IF_FOUND) != NULL) {
+        if (mp_map_lookup(&self->file_map, fd_obj, MP_MAP_LOOKUP_REMOVE_IF_FOUND) == NULL) {
+            // This fails if the fd was closed, but then it's already removed
+            epoll_ctl(self->epfd, EPOLL_CTL_DEL, fd, NULL);
+        }
+    }
+
+    // TODO raise KeyError if obj didn't exist in map
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_2(poll_unregister_obj, poll_unregister);
+
+/// \method modify(obj, eventmask)
+STATIC mp_obj_t poll_modify(mp_obj_t self_in, mp_obj_t obj_in, mp_obj_t eventmask_in) {
+    mp_obj_poll_t *self = MP_OBJ_TO_PTR(self_in);
+    int fd = get_fd(obj_in);
+    mp_obj_t fd_obj = MP_OBJ_NEW_SMALL_INT(fd);
+    mp_uint_t flags = mp_obj_get_int(eventmask_in);
+    if (mp_map_lookup(&self->obj_map, fd_obj, MP_MAP_LOOKUP) == NULL) {
+        // obj doesn't exist in poller
+        mp_raise_OSError(MP_ENOENT);
+    }
+    mp_map_elem_t *file_elem = mp_map_lookup(&self->file_map, fd_obj, MP_MAP_LOOKUP);
+    if (file_elem != NULL) {
+        file_elem->value = MP_OBJ_NEW_SMALL_INT(flags);
+    } else {
+        int err = poll_epoll_ctl(self, EPOLL_CTL_MOD, fd, flags);
+        if (err != 0) {
+            mp_raise_OSError(err);
+        }
+    }
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_3(poll_modify_obj, poll_modify);
+
+STATIC int poll_poll_internal(size_t n_args, const mp_obj_t *args) {
+    mp_obj_poll_t *self = MP_OBJ_TO_PTR(args[0]);
+
+    // work out timeout (it's given already in ms)
+    int timeout = -1;
+    int flags = 0;
+    if (n_args >= 2) {
+        if (args[1] != mp_const_none) {
+            mp_int_t timeout_i = mp_obj_get_int(args[1]);
+            if (timeout_i >= 0) {
+                timeout = timeout_i;
+            }
+        }
+        if (n_args >= 3) {
+            flags = mp_obj_get_int(args[2]);
+        }
+    }
+
+    self->flags = flags;
+
+    // Regular files are ready for whatever they are registered for
+    size_t n_files = 0;
+    for (size_t i = 0; self->file_map.used != 0 && i < self->file_map.alloc; ++i) {
+        if (mp_map_slot_is_filled(&self->file_map, i)) {
+            mp_uint_t revents = MP_OBJ_SMALL_INT_VALUE(self->file_map.table[i].value) & (POLLIN | POLLOUT);
+            if (revents != 0) {
+                struct epoll_event *ev = &self->events[self->alloc - 1 - n_files++];
+                ev->events = revents;
+                ev->data.fd = MP_OBJ_SMALL_INT_VALUE(self->file_map.table[i].key);
+                if (flags & FLAG_ONESHOT) {
+                    self->file_map.table[i].value = MP_OBJ_NEW_SMALL_INT(0);
+                }
+            }
+        }
+    }
+    if (n_files != 0) {
+        timeout = 0;
+    }
+
+    int n_ready;
+    MP_HAL_RETRY_SYSCALL(n_ready, epoll_wait(self->epfd, self->events, self->alloc - n_files, timeout), mp_raise_OSError(err));
+
+    if (flags & FLAG_ONESHOT) {
+        for (int i = 0; i < n_ready; ++i) {
+            poll_epoll_ctl(self, EPOLL_CTL_MOD, self->events[i].data.fd, 0);
+        }
+    }
+
+    // Move the regular files down to follow the fds returned by epoll
+    memmove(&self->events[n_ready], &self->events[self->alloc - n_files], n_files * sizeof(struct epoll_event));
+    return n_ready + n_files;
+}
+
+// Return the (obj, revents) for the given entry in the events array
+STATIC void poll_get_event(mp_obj_poll_t *self, size_t i, mp_obj_t *items) {
+    struct epoll_event *ev = &self->events[i];
+    mp_obj_t fd_obj = MP_OBJ_NEW_SMALL_INT(ev->data.fd);
+    mp_map_elem_t *elem = mp_map_lookup(&self->obj_map, fd_obj, MP_MAP_LOOKUP);
+    // If there's an object stored, return it, otherwise raw fd
+    items[0] = elem != NULL ? elem->value : fd_obj;
+    items[1] = MP_OBJ_NEW_SMALL_INT(ev->events);
+}
+
+/// \method poll([timeout])
+/// Timeout is in milliseconds.
+STATIC mp_obj_t poll_poll(size_t n_args, const mp_obj_t *args) {
+    int n_ready = poll_poll_internal(n_args, args);
+
+    if (n_ready == 0) {
+        return mp_const_empty_tuple;
+    }
+
+    mp_obj_poll_t *self = MP_OBJ_TO_PTR(args[0]);
+
+    mp_obj_list_t *ret_list = MP_OBJ_TO_PTR(mp_obj_new_list(n_ready, NULL));
+    for (int i = 0; i < n_ready; i++) {
+        mp_obj_tuple_t *t = MP_OBJ_TO_PTR(mp_obj_new_tuple(2, NULL));
+        poll_get_event(self, i, t->items);
+        ret_list->items[i] = MP_OBJ_FROM_PTR(t);
+    }
+
+    return MP_OBJ_FROM_PTR(ret_list);
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(poll_poll_obj, 1, 3, poll_poll);
+
+STATIC mp_obj_t poll_ipoll(size_t n_args, const mp_obj_t *args) {
+    mp_obj_poll_t *self = MP_OBJ_TO_PTR(args[0]);
+
+    if (self->ret_tuple == MP_OBJ_NULL) {
+        self->ret_tuple = mp_obj_new_tuple(2, NULL);
+    }
+
+    int n_ready = poll_poll_internal(n_args, args);
+    self->iter_cnt = n_ready;
+    self->iter_idx = 0;
+
+    return args[0];
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(poll_ipoll_obj, 1, 3, poll_ipoll);
+
+STATIC mp_obj_t poll_iternext(mp_obj_t self_in) {
+    mp_obj_poll_t *self = MP_OBJ_TO_PTR(self_in);
+
+    if (self->iter_idx >= self->iter_cnt) {
+        return MP_OBJ_STOP_ITERATION;
+    }
+
+    mp_obj_tuple_t *t = MP_OBJ_TO_PTR(self->ret_tuple);
+    poll_get_event(self, self->iter_idx++, t->items);
+    return MP_OBJ_FROM_PTR(t);
+}
+
+STATIC mp_obj_t poll_del(mp_obj_t self_in) {
+    mp_obj_poll_t *self = MP_OBJ_TO_PTR(self_in);
+    if (self->epfd >= 0) {
+        close(self->epfd);
+        self->epfd = -1;
+    }
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_1(poll_del_obj, poll_del);
+
+STATIC const mp_rom_map_elem_t poll_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR___del__), MP_ROM_PTR(&poll_del_obj) },
+    { MP_ROM_QSTR(MP_QSTR_register), MP_ROM_PTR(&poll_register_obj) },
+    { MP_ROM_QSTR(MP_QSTR_unregister), MP_ROM_PTR(&poll_unregister_obj) },
+    { MP_ROM_QSTR(MP_QSTR_modify), MP_ROM_PTR(&poll_modify_obj) },
+    { MP_ROM_QSTR(MP_QSTR_poll), MP_ROM_PTR(&poll_poll_obj) },
+    { MP_ROM_QSTR(MP_QSTR_ipoll), MP_ROM_PTR(&poll_ipoll_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(poll_locals_dict, poll_locals_dict_table);
+
+STATIC const mp_obj_type_t mp_type_poll = {
+    { &mp_type_type },
+    .name = MP_QSTR_poll,
+    .getiter = mp_identity_getiter,
+    .iternext = poll_iternext,
+    .locals_dict = (void *)&poll_locals_dict,
+};
+
+STATIC mp_obj_t select_poll(size_t n_args, const mp_obj_t *args) {
+    int alloc = 4;
+    if (n_args > 0) {
+        alloc = MAX(1, mp_obj_get_int(args[0]));
+    }
+    int epfd;
+    MP_HAL_RETRY_SYSCALL(epfd, epoll_create1(EPOLL_CLOEXEC), mp_raise_OSError(err));
+    mp_obj_poll_t *poll = m_new_obj_with_finaliser(mp_obj_poll_t);
+    poll->base.type = &mp_type_poll;
+    poll->epfd = epfd;
+    poll->events = m_new(struct epoll_event, alloc);
+    poll->alloc = alloc;
+    poll->iter_cnt = 0;
+    mp_map_init(&poll->obj_map, 0);
+    mp_map_init(&poll->file_map, 0);
+    poll->ret_tuple = MP_OBJ_NULL;
+    return MP_OBJ_FROM_PTR(poll);
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp_select_poll_obj, 0, 1, select_poll);
+
+#else
+
 /// \class Poll - poll class
 
 typedef struct _mp_obj_poll_t {
@@ -69,18 +367,6 @@ typedef struct _mp_obj_poll_t {
     mp_obj_t ret_tuple;
 } mp_obj_poll_t;
 
-STATIC int get_fd(mp_obj_t fdlike) {
-    if (mp_obj_is_obj(fdlike)) {
-        const mp_stream_p_t *stream_p = mp_get_stream_raise(fdlike, MP_STREAM_OP_IOCTL);
-        int err;
-        mp_uint_t res = stream_p->ioctl(fdlike, MP_STREAM_GET_FILENO, 0, &err);
-        if (res != MP_STREAM_ERROR) {
-            return res;
-        }
-    }
-    return mp_obj_get_int(fdlike);
-}
-
 /// \method register(obj[, eventmask])
 STATIC mp_obj_t poll_register(size_t n_args, const mp_obj_t *args) {
     mp_obj_poll_t *self = MP_OBJ_TO_PTR(args[0]);
@@ -336,9 +622,14 @@ STATIC mp_obj_t select_poll(size_t n_args, const mp_obj_t *args) {
 }
 MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp_select_poll_obj, 0, 1, select_poll);
 
+#endif // MICROPY_PY_USELECT_EPOLL
+
 STATIC const mp_rom_map_elem_t mp_module_select_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_uselect) },
     { MP_ROM_QSTR(MP_QSTR_poll), MP_ROM_PTR(&mp_select_poll_obj) },
+    #if MICROPY_PY_USELECT_URING
+    { MP_ROM_QSTR(MP_QSTR_uring), MP_ROM_PTR(&mp_type_uring) },
+    #endif
     { MP_ROM_QSTR(MP_QSTR_POLLIN), MP_ROM_INT(POLLIN) },
     { MP_ROM_QSTR(MP_QSTR_POLLOUT), MP_ROM_INT(POLLOUT) },
     { MP_ROM_QSTR(MP_QSTR_POLLERR), MP_ROM_INT(POLLERR) },
@@ -0,0 +1,348 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "py/mpconfig.h"
+
+#if MICROPY_PY_USELECT_URING
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#include "py/runtime.h"
+#include "py/stream.h"
+#include "py/mphal.h"
+
+// uselect.uring: queues of reads and writes that are handed to the kernel in
+// one system call, using Linux's io_uring.  This saves a system call per read
+// or write when many sockets (or other fds) have data to move, and the ring's
+// fd can be polled to learn when operations complete.
+//
+// Each operation takes a slot in ops[], which keeps the buffer and the user's
+// token alive until the kernel reports that the operation is complete.  The
+// slot index is the user_data of the operation.
+
+typedef struct _mp_obj_uring_t {
+    mp_obj_base_t base;
+    int fd;
+    unsigned sq_entries;
+    unsigned cq_entries;
+    // submission queue
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    struct io_uring_sqe *sqes;
+    // completion queue
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_cqe *cqes;
+    // mappings of the rings
+    void *sq_ring;
+    size_t sq_ring_size;
+    void *cq_ring;
+    size_t cq_ring_size;
+    size_t sqes_size;
+    // operations queued but not yet submitted, and in total not yet complete
+    unsigned n_queued;
+    unsigned n_ops;
+    unsigned free_hint;
+    mp_obj_t *ops; // (token, buffer) of each operation, indexed by slot
+} mp_obj_uring_t;
+
+STATIC void uring_check_open(mp_obj_uring_t *self) {
+    if (self->fd < 0) {
+        mp_raise_OSError(MP_EBADF);
+    }
+}
+
+STATIC void uring_unmap(mp_obj_uring_t *self) {
+    if (self->sqes != NULL) {
+        munmap(self->sqes, self->sqes_size);
+        self->sqes = NULL;
+    }
+    if (self->cq_ring != NULL && self->cq_ring != self->sq_ring) {
+        munmap(self->cq_ring, self->cq_ring_size);
+    }
+    self->cq_ring = NULL;
+    if (self->sq_ring != NULL) {
+        munmap(self->sq_ring, self->sq_ring_size);
+        self->sq_ring = NULL;
+    }
+}
+
+// Submit the queued operations, and wait for at least min_complete of all the
+// operations to be complete
+STATIC void uring_enter(mp_obj_uring_t *self, unsigned min_complete) {
+    unsigned flags = min_complete ? IORING_ENTER_GETEVENTS : 0;
+    int ret;
+    MP_HAL_RETRY_SYSCALL(ret, syscall(__NR_io_uring_enter, self->fd, self->n_queued, min_complete, flags, NULL, 0), {
+        if (err != EBUSY && err != EAGAIN) {
+            mp_raise_OSError(err);
+        }
+        // The completion queue is full, or the kernel is short of memory,
+        // so the caller must take completions before submitting more
+        ret = 0;
+    });
+    self->n_queued -= ret;
+}
+
+STATIC void uring_queue(mp_obj_uring_t *self, int opcode, mp_obj_t obj_in, mp_obj_t buf_in, mp_obj_t token, int access) {
+    uring_check_open(self);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, access);
+
+    int fd;
+    if (mp_obj_is_int(obj_in)) {
+        fd = mp_obj_get_int(obj_in);
+    } else {
+        const mp_stream_p_t *stream_p = mp_get_stream_raise(obj_in, MP_STREAM_OP_IOCTL);
+        int err;
+        fd = stream_p->ioctl(obj_in, MP_STREAM_GET_FILENO, 0, &err);
+        if (fd == (int)MP_STREAM_ERROR) {
+            mp_raise_OSError(err);
+        }
+    }
+
+    // Each complete operation needs a place in the completion queue
+    if (self->n_ops >= self->cq_entries) {
+        mp_raise_OSError(MP_ENOBUFS);
+    }
+    unsigned tail = *self->sq_tail;
+    if (tail - __atomic_load_n(self->sq_head, __ATOMIC_ACQUIRE) >= self->sq_entries) {
+        // The submission queue is full, so hand it to the kernel now
+        uring_enter(self, 0);
+        if (tail - __atomic_load_n(self->sq_head, __ATOMIC_ACQUIRE) >= self->sq_entries) {
+            mp_raise_OSError(MP_ENOBUFS);
+        }
+    }
+
+    unsigned slot = self->free_hint;
+    while (self->ops[slot] != MP_OBJ_NULL) {
+        slot = (slot + 1) % self->cq_entries;
+    }
+    self->free_hint = (slot + 1) % self->cq_entries;
+    mp_obj_t op[2] = { token, buf_in };
+    self->ops[slot] = mp_obj_new_tuple(2, op);
+    ++self->n_ops;
+
+    unsigned idx = tail & *self->sq_mask;
+    struct io_uring_sqe *sqe = &self->sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->addr = (uintptr_t)bufinfo.buf;
+    sqe->len = bufinfo.len;
+    sqe->off = (uint64_t)-1; // the current position, for files
+    sqe->user_data = slot;
+    self->sq_array[idx] = idx;
+    __atomic_store_n(self->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ++self->n_queued;
+}
+
+/// \method readinto(obj, buf, token=None)
+/// Queue a read from obj (a stream with a file descriptor, or an fd) into buf.
+STATIC mp_obj_t uring_readinto(size_t n_args, const mp_obj_t *args) {
+    mp_obj_uring_t *self = MP_OBJ_TO_PTR(args[0]);
+    uring_queue(self, IORING_OP_READ, args[1], args[2], n_args > 3 ? args[3] : mp_const_none, MP_BUFFER_WRITE);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(uring_readinto_obj, 3, 4, uring_readinto);
+
+/// \method write(obj, buf, token=None)
+/// Queue a write of buf to obj.
+STATIC mp_obj_t uring_write(size_t n_args, const mp_obj_t *args) {
+    mp_obj_uring_t *self = MP_OBJ_TO_PTR(args[0]);
+    uring_queue(self, IORING_OP_WRITE, args[1], args[2], n_args > 3 ? args[3] : mp_const_none, MP_BUFFER_READ);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(uring_write_obj, 3, 4, uring_write);
+
+/// \method submit(wait=0)
+/// Hand the queued operations to the kernel, and wait until at least wait
+/// operations are complete.  Returns the number of complete operations.
+STATIC mp_obj_t uring_submit(size_t n_args, const mp_obj_t *args) {
+    mp_obj_uring_t *self = MP_OBJ_TO_PTR(args[0]);
+    uring_check_open(self);
+    mp_int_t wait = n_args > 1 ? mp_obj_get_int(args[1]) : 0;
+    if (wait < 0 || (mp_uint_t)wait > self->n_ops) {
+        mp_raise_ValueError(NULL);
+    }
+    // Completions that were already taken by the kernel count towards wait
+    unsigned ready = __atomic_load_n(self->cq_tail, __ATOMIC_ACQUIRE) - *self->cq_head;
+    unsigned min_complete = (mp_uint_t)wait > ready ? wait - ready : 0;
+    if (self->n_queued != 0 || min_complete != 0) {
+        uring_enter(self, min_complete);
+    }
+    return MP_OBJ_NEW_SMALL_INT(__atomic_load_n(self->cq_tail, __ATOMIC_ACQUIRE) - *self->cq_head);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(uring_submit_obj, 1, 2, uring_submit);
+
+/// \method complete()
+/// Return a list of (token, result) of the operations that are complete, in
+/// the order they completed.  The result is the number of bytes moved, or a
+/// negative errno value if the operation failed.
+STATIC mp_obj_t uring_complete(mp_obj_t self_in) {
+    mp_obj_uring_t *self = MP_OBJ_TO_PTR(self_in);
+    uring_check_open(self);
+    unsigned head = *self->cq_head;
+    unsigned tail = __atomic_load_n(self->cq_tail, __ATOMIC_ACQUIRE);
+    mp_obj_t list = mp_obj_new_list(0, NULL);
+    for (; head != tail; ++head) {
+        struct io_uring_cqe *cqe = &self->cqes[head & *self->cq_mask];
+        size_t slot = cqe->user_data;
+        mp_obj_t *op;
+        mp_obj_get_array_fixed_n(self->ops[slot], 2, &op);
+        mp_obj_t item[2] = { op[0], MP_OBJ_NEW_SMALL_INT(cqe->res) };
+        mp_obj_list_append(list, mp_obj_new_tuple(2, item));
+        self->ops[slot] = MP_OBJ_NULL;
+        --self->n_ops;
+        // Free the entry as it's read, so a failed append can't take it twice
+        __atomic_store_n(self->cq_head, head + 1, __ATOMIC_RELEASE);
+    }
+    return list;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(uring_complete_obj, uring_complete);
+
+STATIC mp_obj_t uring_close(mp_obj_t self_in) {
+    mp_obj_uring_t *self = MP_OBJ_TO_PTR(self_in);
+    if (self->fd >= 0) {
+        uring_unmap(self);
+        close(self->fd);
+        self->fd = -1;
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(uring_close_obj, uring_close);
+
+STATIC mp_uint_t uring_ioctl(mp_obj_t self_in, mp_uint_t request, uintptr_t arg, int *errcode) {
+    mp_obj_uring_t *self = MP_OBJ_TO_PTR(self_in);
+    (void)arg;
+    switch (request) {
+        case MP_STREAM_GET_FILENO:
+            // The ring's fd is readable while there are completions to take
+            return self->fd;
+        case MP_STREAM_CLOSE:
+            uring_close(self_in);
+            return 0;
+        default:
+            *errcode = MP_EINVAL;
+            return MP_STREAM_ERROR;
+    }
+}
+
+STATIC mp_obj_t uring_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 0, 1, false);
+    mp_int_t entries = n_args > 0 ? mp_obj_get_int(args[0]) : 32;
+    if (entries < 1 || entries > 4096) {
+        mp_raise_ValueError(NULL);
+    }
+
+    // Allocate first, so the fd can't leak if allocation fails
+    mp_obj_uring_t *self = m_new_obj_with_finaliser(mp_obj_uring_t);
+    memset(self, 0, sizeof(*self));
+    self->base.type = type;
+    self->fd = -1;
+    // The kernel gives twice as many completion entries as submission entries
+    self->ops = m_new0(mp_obj_t, 2 * entries);
+
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    int fd;
+    MP_HAL_RETRY_SYSCALL(fd, syscall(__NR_io_uring_setup, entries, &p), mp_raise_OSError(err));
+    self->fd = fd;
+    self->sq_entries = p.sq_entries;
+    // Entries are rounded up to a power of two, but only the slots allocated
+    // above are used
+    self->cq_entries = MIN(p.cq_entries, 2 * entries);
+
+    // Map the rings, which may share one mapping
+    self->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    self->cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        self->sq_ring_size = MAX(self->sq_ring_size, self->cq_ring_size);
+        self->cq_ring_size = self->sq_ring_size;
+    }
+    self->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    void *sq_ring = mmap(NULL, self->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    void *cq_ring = sq_ring;
+    if (!(p.features & IORING_FEAT_SINGLE_MMAP) && sq_ring != MAP_FAILED) {
+        cq_ring = mmap(NULL, self->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    }
+    void *sqes = MAP_FAILED;
+    if (cq_ring != MAP_FAILED) {
+        sqes = mmap(NULL, self->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    }
+    self->sq_ring = sq_ring == MAP_FAILED ? NULL : sq_ring;
+    self->cq_ring = cq_ring == MAP_FAILED ? NULL : cq_ring;
+    self->sqes = sqes == MAP_FAILED ? NULL : sqes;
+    if (sqes == MAP_FAILED) {
+        int err = errno;
+        uring_close(MP_OBJ_FROM_PTR(self));
+        mp_raise_OSError(err);
+    }
+
+    uint8_t *sq = sq_ring;
+    self->sq_head = (unsigned *)(sq + p.sq_off.head);
+    self->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+    self->sq_mask = (unsigned *)(sq + p.sq_off.ring_mask);
+    self->sq_array = (unsigned *)(sq + p.sq_off.array);
+    uint8_t *cq = cq_ring;
+    self->cq_head = (unsigned *)(cq + p.cq_off.head);
+    self->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+    self->cq_mask = (unsigned *)(cq + p.cq_off.ring_mask);
+    self->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+
+    return MP_OBJ_FROM_PTR(self);
+}
+
+STATIC const mp_rom_map_elem_t uring_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR___del__), MP_ROM_PTR(&uring_close_obj) },
+    { MP_ROM_QSTR(MP_QSTR_close), MP_ROM_PTR(&uring_close_obj) },
+    { MP_ROM_QSTR(MP_QSTR_readinto), MP_ROM_PTR(&uring_readinto_obj) },
+    { MP_ROM_QSTR(MP_QSTR_write), MP_ROM_PTR(&uring_write_obj) },
+    { MP_ROM_QSTR(MP_QSTR_submit), MP_ROM_PTR(&uring_submit_obj) },
+    { MP_ROM_QSTR(MP_QSTR_complete), MP_ROM_PTR(&uring_complete_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(uring_locals_dict, uring_locals_dict_table);
+
+STATIC const mp_stream_p_t uring_stream_p = {
+    .ioctl = uring_ioctl,
+};
+
+const mp_obj_type_t mp_type_uring = {
+    { &mp_type_type },
+    .name = MP_QSTR_uring,
+    .make_new = uring_make_new,
+    .protocol = &uring_stream_p,
+    .locals_dict = (void *)&uring_locals_dict,
+};
+
+#endif // MICROPY_PY_USELECT_URING
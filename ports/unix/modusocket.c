@@ -25,6 +25,11 @@
  * THE SOFTWARE.
  */
 
+// For sendmmsg and recvmmsg
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
 #include <stdio.h>
 #include <assert.h>
 #include <string.h>
@@ -38,6 +43,7 @@
 #include <netdb.h>
 #include <errno.h>
 #include <math.h>
+#include <poll.h>
 
 #include "py/objtuple.h"
 #include "py/objstr.h"
@@ -46,6 +52,7 @@
 #include "py/builtin.h"
 #include "py/mphal.h"
 #include "py/mpthread.h"
+#include "extmod/misc.h"
 
 /*
   The idea of this module is to implement reasonable minimum of
@@ -126,8 +133,36 @@ STATIC mp_uint_t socket_write(mp_obj_t o_in, const void *buf, mp_uint_t size, in
 
 STATIC mp_uint_t socket_ioctl(mp_obj_t o_in, mp_uint_t request, uintptr_t arg, int *errcode) {
     mp_obj_socket_t *self = MP_OBJ_TO_PTR(o_in);
-    (void)arg;
     switch (request) {
+        case MP_STREAM_POLL: {
+            // Used by usocket.Pool to check an idle connection, uselect uses the fd
+            struct pollfd pfd = { .fd = self->fd, .events = 0 };
+            if (arg & MP_STREAM_POLL_RD) {
+                pfd.events |= POLLIN;
+            }
+            if (arg & MP_STREAM_POLL_WR) {
+                pfd.events |= POLLOUT;
+            }
+            if (poll(&pfd, 1, 0) < 0) {
+                *errcode = errno;
+                return MP_STREAM_ERROR;
+            }
+            mp_uint_t ret = 0;
+            if (pfd.revents & POLLIN) {
+                ret |= MP_STREAM_POLL_RD;
+            }
+            if (pfd.revents & POLLOUT) {
+                ret |= MP_STREAM_POLL_WR;
+            }
+            if (pfd.revents & POLLERR) {
+                ret |= MP_STREAM_POLL_ERR;
+            }
+            if (pfd.revents & POLLHUP) {
+                ret |= MP_STREAM_POLL_HUP;
+            }
+            return ret & (arg | MP_STREAM_POLL_ERR | MP_STREAM_POLL_HUP);
+        }
+
         case MP_STREAM_CLOSE:
             // There's a POSIX drama regarding return value of close in general,
             // and EINTR error in particular. See e.g.
@@ -319,6 +354,164 @@ STATIC mp_obj_t socket_sendto(size_t n_args, const mp_obj_t *args) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(socket_sendto_obj, 3, 4, socket_sendto);
 
+#if MICROPY_PY_USOCKET_BATCH
+// The batches are passed to the kernel in one sendmmsg/recvmmsg call where
+// those exist (Linux), otherwise one call is made per datagram
+#if defined(__linux__)
+#define SOCKET_BATCH_MMSG (1)
+// The most datagrams the kernel takes in one call
+#define SOCKET_BATCH_MAX (1024)
+#else
+#define SOCKET_BATCH_MMSG (0)
+#endif
+
+STATIC mp_obj_t socket_sendto_many(mp_obj_t self_in, mp_obj_t bufs_in, mp_obj_t addr_in) {
+    mp_obj_socket_t *self = MP_OBJ_TO_PTR(self_in);
+
+    size_t n;
+    mp_obj_t *bufs;
+    mp_obj_get_array(bufs_in, &n, &bufs);
+
+    // A list gives an address for each datagram, otherwise they all go to the same place
+    mp_obj_t *addrs = NULL;
+    mp_buffer_info_t addr_bi;
+    if (mp_obj_is_type(addr_in, &mp_type_list)) {
+        mp_obj_get_array_fixed_n(addr_in, n, &addrs);
+    } else {
+        mp_get_buffer_raise(addr_in, &addr_bi, MP_BUFFER_READ);
+    }
+
+    #if SOCKET_BATCH_MMSG
+    size_t batch = MIN(n, SOCKET_BATCH_MAX);
+    struct mmsghdr *msgs = m_new0(struct mmsghdr, batch);
+    struct iovec *iovs = m_new(struct iovec, batch);
+    size_t i = 0;
+    while (i < n) {
+        size_t m = MIN(n - i, batch);
+        for (size_t j = 0; j < m; ++j) {
+            mp_buffer_info_t bufinfo;
+            mp_get_buffer_raise(bufs[i + j], &bufinfo, MP_BUFFER_READ);
+            if (addrs != NULL) {
+                mp_get_buffer_raise(addrs[i + j], &addr_bi, MP_BUFFER_READ);
+            }
+            iovs[j].iov_base = bufinfo.buf;
+            iovs[j].iov_len = bufinfo.len;
+            msgs[j].msg_hdr.msg_iov = &iovs[j];
+            msgs[j].msg_hdr.msg_iovlen = 1;
+            msgs[j].msg_hdr.msg_name = addr_bi.buf;
+            msgs[j].msg_hdr.msg_namelen = addr_bi.len;
+        }
+        int out_n;
+        MP_HAL_RETRY_SYSCALL(out_n, sendmmsg(self->fd, msgs, m, 0), {
+            if (i == 0) {
+                mp_raise_OSError(err);
+            }
+        });
+        if (out_n == -1) {
+            // Report the datagrams that were sent
+            break;
+        }
+        i += out_n;
+        if ((size_t)out_n < m) {
+            break;
+        }
+    }
+    m_del(struct mmsghdr, msgs, batch);
+    m_del(struct iovec, iovs, batch);
+    #else
+    size_t i = 0;
+    for (; i < n; ++i) {
+        mp_buffer_info_t bufinfo;
+        mp_get_buffer_raise(bufs[i], &bufinfo, MP_BUFFER_READ);
+        if (addrs != NULL) {
+            mp_get_buffer_raise(addrs[i], &addr_bi, MP_BUFFER_READ);
+        }
+        ssize_t out_sz;
+        MP_HAL_RETRY_SYSCALL(out_sz, sendto(self->fd, bufinfo.buf, bufinfo.len, 0,
+            (struct sockaddr *)addr_bi.buf, addr_bi.len), {
+            if (i == 0) {
+                mp_raise_OSError(err);
+            }
+        });
+        if (out_sz == -1) {
+            // Report the datagrams that were sent
+            break;
+        }
+    }
+    #endif
+
+    return MP_OBJ_NEW_SMALL_INT(i);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(socket_sendto_many_obj, socket_sendto_many);
+
+STATIC mp_obj_t socket_recvfrom_into_many(size_t n_args, const mp_obj_t *args) {
+    mp_obj_socket_t *self = MP_OBJ_TO_PTR(args[0]);
+
+    size_t n;
+    mp_obj_t *bufs;
+    mp_obj_get_array(args[1], &n, &bufs);
+    mp_obj_t addrs = n_args > 2 ? args[2] : mp_const_none;
+
+    // Wait as usual for the first datagram, then take only those already queued
+    mp_obj_t sizes = mp_obj_new_list(0, NULL);
+    #if SOCKET_BATCH_MMSG
+    size_t m = MIN(n, SOCKET_BATCH_MAX);
+    if (m == 0) {
+        return sizes;
+    }
+    struct mmsghdr *msgs = m_new0(struct mmsghdr, m);
+    struct iovec *iovs = m_new(struct iovec, m);
+    struct sockaddr_storage *addr = m_new(struct sockaddr_storage, m);
+    for (size_t i = 0; i < m; ++i) {
+        mp_buffer_info_t bufinfo;
+        mp_get_buffer_raise(bufs[i], &bufinfo, MP_BUFFER_WRITE);
+        iovs[i].iov_base = bufinfo.buf;
+        iovs[i].iov_len = bufinfo.len;
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_hdr.msg_name = &addr[i];
+        msgs[i].msg_hdr.msg_namelen = sizeof(addr[i]);
+    }
+    int out_n;
+    MP_HAL_RETRY_SYSCALL(out_n, recvmmsg(self->fd, msgs, m, MSG_WAITFORONE, NULL), mp_raise_OSError(err));
+    for (int i = 0; i < out_n; ++i) {
+        mp_obj_list_append(sizes, MP_OBJ_NEW_SMALL_INT(msgs[i].msg_len));
+        if (addrs != mp_const_none) {
+            mp_obj_subscr(addrs, MP_OBJ_NEW_SMALL_INT(i),
+                mp_obj_from_sockaddr((struct sockaddr *)&addr[i], msgs[i].msg_hdr.msg_namelen));
+        }
+    }
+    m_del(struct mmsghdr, msgs, m);
+    m_del(struct iovec, iovs, m);
+    m_del(struct sockaddr_storage, addr, m);
+    #else
+    for (size_t i = 0; i < n; ++i) {
+        mp_buffer_info_t bufinfo;
+        mp_get_buffer_raise(bufs[i], &bufinfo, MP_BUFFER_WRITE);
+        struct sockaddr_storage addr;
+        socklen_t addr_len = sizeof(addr);
+        ssize_t out_sz;
+        MP_HAL_RETRY_SYSCALL(out_sz, recvfrom(self->fd, bufinfo.buf, bufinfo.len, i == 0 ? 0 : MSG_DONTWAIT,
+            (struct sockaddr *)&addr, &addr_len), {
+            if (i == 0) {
+                mp_raise_OSError(err);
+            }
+        });
+        if (out_sz == -1) {
+            break;
+        }
+        mp_obj_list_append(sizes, MP_OBJ_NEW_SMALL_INT(out_sz));
+        if (addrs != mp_const_none) {
+            mp_obj_subscr(addrs, MP_OBJ_NEW_SMALL_INT(i), mp_obj_from_sockaddr((struct sockaddr *)&addr, addr_len));
+        }
+    }
+    #endif
+
+    return sizes;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(socket_recvfrom_into_many_obj, 2, 3, socket_recvfrom_into_many);
+#endif
+
 STATIC mp_obj_t socket_setsockopt(size_t n_args, const mp_obj_t *args) {
     (void)n_args; // always 4
     mp_obj_socket_t *self = MP_OBJ_TO_PTR(args[0]);
@@ -459,6 +652,9 @@ STATIC const mp_rom_map_elem_t usocket_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_read), MP_ROM_PTR(&mp_stream_read_obj) },
     { MP_ROM_QSTR(MP_QSTR_readinto), MP_ROM_PTR(&mp_stream_readinto_obj) },
     { MP_ROM_QSTR(MP_QSTR_readline), MP_ROM_PTR(&mp_stream_unbuffered_readline_obj) },
+#if MICROPY_STREAMS_READLINE_INTO
+    { MP_ROM_QSTR(MP_QSTR_readline_into), MP_ROM_PTR(&mp_stream_unbuffered_readline_into_obj) },
+#endif
     { MP_ROM_QSTR(MP_QSTR_write), MP_ROM_PTR(&mp_stream_write_obj) },
     { MP_ROM_QSTR(MP_QSTR_connect), MP_ROM_PTR(&socket_connect_obj) },
     { MP_ROM_QSTR(MP_QSTR_bind), MP_ROM_PTR(&socket_bind_obj) },
@@ -468,6 +664,10 @@ STATIC const mp_rom_map_elem_t usocket_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_recvfrom), MP_ROM_PTR(&socket_recvfrom_obj) },
     { MP_ROM_QSTR(MP_QSTR_send), MP_ROM_PTR(&socket_send_obj) },
     { MP_ROM_QSTR(MP_QSTR_sendto), MP_ROM_PTR(&socket_sendto_obj) },
+    #if MICROPY_PY_USOCKET_BATCH
+    { MP_ROM_QSTR(MP_QSTR_sendto_many), MP_ROM_PTR(&socket_sendto_many_obj) },
+    { MP_ROM_QSTR(MP_QSTR_recvfrom_into_many), MP_ROM_PTR(&socket_recvfrom_into_many_obj) },
+    #endif
     { MP_ROM_QSTR(MP_QSTR_setsockopt), MP_ROM_PTR(&socket_setsockopt_obj) },
     { MP_ROM_QSTR(MP_QSTR_setblocking), MP_ROM_PTR(&socket_setblocking_obj) },
     { MP_ROM_QSTR(MP_QSTR_settimeout), MP_ROM_PTR(&socket_settimeout_obj) },
@@ -639,6 +839,9 @@ STATIC const mp_rom_map_elem_t mp_module_socket_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_usocket) },
     { MP_ROM_QSTR(MP_QSTR_socket), MP_ROM_PTR(&mp_type_socket) },
     { MP_ROM_QSTR(MP_QSTR_getaddrinfo), MP_ROM_PTR(&mod_socket_getaddrinfo_obj) },
+    #if MICROPY_PY_USOCKET_POOL
+    { MP_ROM_QSTR(MP_QSTR_Pool), MP_ROM_PTR(&mp_type_usocket_pool) },
+    #endif
     { MP_ROM_QSTR(MP_QSTR_inet_pton), MP_ROM_PTR(&mod_socket_inet_pton_obj) },
     { MP_ROM_QSTR(MP_QSTR_inet_ntop), MP_ROM_PTR(&mod_socket_inet_ntop_obj) },
     { MP_ROM_QSTR(MP_QSTR_sockaddr), MP_ROM_PTR(&mod_socket_sockaddr_obj) },
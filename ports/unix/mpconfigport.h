@@ -36,6 +36,7 @@
 
 #define MICROPY_ALLOC_PATH_MAX      (PATH_MAX)
 #define MICROPY_PERSISTENT_CODE_LOAD (1)
+#define MICROPY_PERSISTENT_CODE_LOAD_LAZY (1)
 #if !defined(MICROPY_EMIT_X64) && defined(__x86_64__)
     #define MICROPY_EMIT_X64        (1)
 #endif
@@ -52,9 +53,14 @@
     #define MICROPY_EMIT_ARM        (1)
 #endif
 #define MICROPY_COMP_MODULE_CONST   (1)
+#define MICROPY_COMP_CONST_FOLDING_COMPARE (1)
 #define MICROPY_COMP_TRIPLE_TUPLE_ASSIGN (1)
 #define MICROPY_COMP_RETURN_IF_EXPR (1)
+#define MICROPY_COMP_RANGE_COMPREHENSION (1)
 #define MICROPY_ENABLE_GC           (1)
+#define MICROPY_GC_STATS            (1)
+#define MICROPY_GC_NO_SCAN          (1)
+#define MICROPY_TRACE               (1)
 #define MICROPY_ENABLE_FINALISER    (1)
 #define MICROPY_STACK_CHECK         (1)
 #define MICROPY_MALLOC_USES_ALLOCATED_SIZE (1)
@@ -73,33 +79,83 @@
 #ifndef MICROPY_FLOAT_IMPL
 #define MICROPY_FLOAT_IMPL          (MICROPY_FLOAT_IMPL_DOUBLE)
 #endif
+#define MICROPY_FLOAT_EXACT_CONVERSION (1)
 #define MICROPY_LONGINT_IMPL        (MICROPY_LONGINT_IMPL_MPZ)
 #ifndef MICROPY_STREAMS_NON_BLOCK
 #define MICROPY_STREAMS_NON_BLOCK   (1)
 #endif
 #define MICROPY_STREAMS_POSIX_API   (1)
+#define MICROPY_STREAMS_READLINE_INTO (1)
 #define MICROPY_OPT_COMPUTED_GOTO   (1)
+#ifndef MICROPY_OPT_VM_SUPERINSTRUCTIONS
+#define MICROPY_OPT_VM_SUPERINSTRUCTIONS (1)
+#endif
+#ifndef MICROPY_OPT_VM_SMALL_INT_FAST_PATH
+#define MICROPY_OPT_VM_SMALL_INT_FAST_PATH (1)
+#endif
 #ifndef MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE
 #define MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE (1)
 #endif
+#ifndef MICROPY_OPT_MAP_COMPACT
+#define MICROPY_OPT_MAP_COMPACT (1)
+#endif
+#ifndef MICROPY_OPT_MPZ_KARATSUBA_THRESHOLD
+#define MICROPY_OPT_MPZ_KARATSUBA_THRESHOLD (48)
+#endif
+#ifndef MICROPY_OPT_MPZ_POW3_MONTGOMERY
+#define MICROPY_OPT_MPZ_POW3_MONTGOMERY (1)
+#endif
+#ifndef MICROPY_OPT_LOAD_METHOD_CACHE
+#define MICROPY_OPT_LOAD_METHOD_CACHE (!MICROPY_PY_THREAD || MICROPY_PY_THREAD_GIL)
+#endif
+#ifndef MICROPY_OPT_ARG_SLOT_CACHE
+#define MICROPY_OPT_ARG_SLOT_CACHE  (1)
+#endif
+#ifndef MICROPY_OPT_NAMEDTUPLE_FIELD_INDEX
+#define MICROPY_OPT_NAMEDTUPLE_FIELD_INDEX (1)
+#endif
+#ifndef MICROPY_OPT_CALL_BOUND_METH
+#define MICROPY_OPT_CALL_BOUND_METH (1)
+#endif
+#ifndef MICROPY_OPT_BOUND_METH_CACHE
+#define MICROPY_OPT_BOUND_METH_CACHE (!MICROPY_PY_THREAD || MICROPY_PY_THREAD_GIL)
+#endif
+#ifndef MICROPY_OPT_FIND_SUBBYTES_HORSPOOL
+#define MICROPY_OPT_FIND_SUBBYTES_HORSPOOL (1)
+#endif
+#ifndef MICROPY_QSTR_HASH_INDEX
+#define MICROPY_QSTR_HASH_INDEX     (1)
+#endif
 #define MICROPY_MODULE_WEAK_LINKS   (1)
+#define MICROPY_MODULE_FROZEN_ROM_GLOBALS (1)
 #define MICROPY_CAN_OVERRIDE_BUILTINS (1)
 #define MICROPY_VFS_POSIX_FILE      (1)
+#define MICROPY_VFS_BLOCKDEV_CACHE  (1)
+#define MICROPY_VFS_MMAP            (1)
+#define MICROPY_VFS_BLOCKDEV_CACHE_BLOCKS (8)
+#define MICROPY_VFS_FAT_READAHEAD_BLOCKS (8)
+#define MICROPY_VFS_IMPORT_STAT_CACHE (1)
 #define MICROPY_PY_FUNCTION_ATTRS   (1)
 #define MICROPY_PY_DESCRIPTORS      (1)
+#define MICROPY_PY_SLOTS            (1)
 #define MICROPY_PY_DELATTR_SETATTR  (1)
 #define MICROPY_PY_BUILTINS_STR_UNICODE (1)
+#define MICROPY_PY_BUILTINS_STR_UNICODE_INDEX (1)
 #define MICROPY_PY_BUILTINS_STR_CENTER (1)
 #define MICROPY_PY_BUILTINS_STR_PARTITION (1)
 #define MICROPY_PY_BUILTINS_STR_SPLITLINES (1)
 #define MICROPY_PY_BUILTINS_MEMORYVIEW (1)
+#define MICROPY_PY_BUILTINS_MEMORYVIEW_SPLIT (1)
 #define MICROPY_PY_BUILTINS_FROZENSET (1)
 #define MICROPY_PY_BUILTINS_COMPILE (1)
 #define MICROPY_PY_BUILTINS_NOTIMPLEMENTED (1)
+#define MICROPY_PY_BUILTINS_SORT_STABLE (1)
 #define MICROPY_PY_BUILTINS_INPUT   (1)
 #define MICROPY_PY_BUILTINS_POW3    (1)
 #define MICROPY_PY_BUILTINS_ROUND_INT    (1)
 #define MICROPY_PY_MICROPYTHON_MEM_INFO (1)
+#define MICROPY_PY_MICROPYTHON_LIST_WITH_CAPACITY (1)
+#define MICROPY_PY_MICROPYTHON_STRINGBUILDER (1)
 #define MICROPY_PY_ALL_SPECIAL_METHODS (1)
 #define MICROPY_PY_REVERSE_SPECIAL_METHODS (1)
 #define MICROPY_PY_ARRAY_SLICE_ASSIGN (1)
@@ -122,12 +178,19 @@
 #define MICROPY_PY_SYS_STDFILES     (1)
 #define MICROPY_PY_SYS_EXC_INFO     (1)
 #define MICROPY_PY_COLLECTIONS_DEQUE (1)
+#define MICROPY_PY_COLLECTIONS_DEQUE_ITER (1)
+#define MICROPY_PY_COLLECTIONS_DEQUE_SUBSCR (1)
+#define MICROPY_PY_COLLECTIONS_DEQUE_TYPED (1)
 #define MICROPY_PY_COLLECTIONS_ORDEREDDICT (1)
+#define MICROPY_PY_COLLECTIONS_INTDICT (1)
 #ifndef MICROPY_PY_MATH_SPECIAL_FUNCTIONS
 #define MICROPY_PY_MATH_SPECIAL_FUNCTIONS (1)
 #endif
 #define MICROPY_PY_MATH_ISCLOSE     (MICROPY_PY_MATH_SPECIAL_FUNCTIONS)
+#define MICROPY_PY_MATH_FSUM        (MICROPY_PY_MATH_SPECIAL_FUNCTIONS)
+#define MICROPY_PY_MATH_APPLY       (MICROPY_PY_MATH_SPECIAL_FUNCTIONS)
 #define MICROPY_PY_CMATH            (1)
+#define MICROPY_PY_STRUCT_OBJECT    (1)
 #define MICROPY_PY_IO_IOBASE        (1)
 #define MICROPY_PY_IO_FILEIO        (1)
 #define MICROPY_PY_GC_COLLECT_RETVAL (1)
@@ -142,10 +205,17 @@
 #define MICROPY_PY_UTIME_MP_HAL     (1)
 #define MICROPY_PY_UERRNO           (1)
 #define MICROPY_PY_UCTYPES          (1)
+#define MICROPY_PY_UCTYPES_COMPILE  (1)
 #define MICROPY_PY_UZLIB            (1)
+#define MICROPY_PY_UZLIB_COMPRESS   (1)
 #define MICROPY_PY_UJSON            (1)
+#define MICROPY_PY_UJSON_OBJECT_HOOK (1)
+#define MICROPY_PY_UJSON_ITERLOAD   (1)
+#define MICROPY_PY_UCBOR            (1)
+#define MICROPY_PY_INTERN_DECODED_KEYS (256)
 #define MICROPY_PY_URE              (1)
 #define MICROPY_PY_UHEAPQ           (1)
+#define MICROPY_PY_UHEAPQ_EXTRA     (1)
 #define MICROPY_PY_UTIMEQ           (1)
 #define MICROPY_PY_UHASHLIB         (1)
 #if MICROPY_PY_USSL
@@ -155,11 +225,25 @@
 #endif
 #define MICROPY_PY_UBINASCII        (1)
 #define MICROPY_PY_UBINASCII_CRC32  (1)
+#define MICROPY_PY_UBINASCII_INTO   (1)
 #define MICROPY_PY_URANDOM          (1)
+#define MICROPY_PY_URANDOM_XOSHIRO  (1)
 #ifndef MICROPY_PY_USELECT_POSIX
 #define MICROPY_PY_USELECT_POSIX    (1)
 #endif
+// Use epoll for uselect.poll (Linux only).  Closed fds are then silently
+// dropped from a poll object instead of being reported with POLLNVAL.
+#ifndef MICROPY_PY_USELECT_EPOLL
+#define MICROPY_PY_USELECT_EPOLL    (0)
+#endif
+// Provide uselect.uring, for batches of reads and writes with io_uring (Linux
+// 5.6 or later, and its headers are needed to build)
+#ifndef MICROPY_PY_USELECT_URING
+#define MICROPY_PY_USELECT_URING    (0)
+#endif
 #define MICROPY_PY_UWEBSOCKET       (1)
+#define MICROPY_PY_USOCKET_BATCH    (1)
+#define MICROPY_PY_USOCKET_POOL     (1)
 #define MICROPY_PY_MACHINE          (1)
 #define MICROPY_PY_MACHINE_PULSE    (1)
 #define MICROPY_MACHINE_MEM_GET_READ_ADDR   mod_machine_mem_get_addr
@@ -189,6 +273,7 @@ extern const struct _mp_print_t mp_stderr_print;
 
 #define MICROPY_ENABLE_EMERGENCY_EXCEPTION_BUF   (1)
 #define MICROPY_EMERGENCY_EXCEPTION_BUF_SIZE  (256)
+#define MICROPY_PREALLOCATED_EXCEPTIONS (1)
 #define MICROPY_KBD_EXCEPTION       (1)
 #define MICROPY_ASYNC_KBD_INTR      (1)
 
@@ -276,6 +361,10 @@ typedef long long mp_off_t;
 typedef long mp_off_t;
 #endif
 
+// The sampling profile is driven by SIGPROF, so it counts CPU time.
+void mp_unix_sampling_profile_timer(int enable);
+#define MICROPY_SAMPLING_PROFILE_TIMER(enable) mp_unix_sampling_profile_timer(enable)
+
 void mp_unix_alloc_exec(size_t min_size, void **ptr, size_t *size);
 void mp_unix_free_exec(void *ptr, size_t size);
 void mp_unix_mark_exec(void);
@@ -373,4 +462,16 @@ struct _mp_bluetooth_nimble_malloc_t;
 #include <sched.h>
 #define MICROPY_UNIX_MACHINE_IDLE sched_yield();
 
+#if MICROPY_PY_THREAD && !MICROPY_PY_THREAD_GIL
+// Without a GIL, lists, dicts and sets lock their storage to be thread safe.
+#ifndef MICROPY_PY_THREAD_OBJ_LOCK
+#define MICROPY_PY_THREAD_OBJ_LOCK (1)
+#endif
+#define MICROPY_PY_THREAD_OBJ_LOCK_WAIT() sched_yield()
+// Threads allocate small objects from their own buffers to avoid the GC lock.
+#ifndef MICROPY_GC_TLAB
+#define MICROPY_GC_TLAB (1)
+#endif
+#endif
+
 #endif // MICROPY_UNIX_MINIMAL
@@ -237,6 +237,10 @@ void mp_thread_create(void *(*entry)(void *), void *arg, size_t *stack_size) {
 
     mp_thread_unix_begin_atomic_section();
 
+    // adjust stack_size to provide room to recover from hitting the limit;
+    // this must be done before the new thread starts and reads it
+    *stack_size -= THREAD_STACK_OVERFLOW_MARGIN;
+
     // create thread
     pthread_t id;
     ret = pthread_create(&id, &attr, entry, arg);
@@ -245,9 +249,6 @@ void mp_thread_create(void *(*entry)(void *), void *arg, size_t *stack_size) {
         goto er;
     }
 
-    // adjust stack_size to provide room to recover from hitting the limit
-    *stack_size -= THREAD_STACK_OVERFLOW_MARGIN;
-
     // add thread to linked list of all threads
     thread_t *th = malloc(sizeof(thread_t));
     th->id = id;
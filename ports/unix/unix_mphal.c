@@ -33,6 +33,7 @@
 #include "py/mphal.h"
 #include "py/mpthread.h"
 #include "py/runtime.h"
+#include "py/profile.h"
 #include "extmod/misc.h"
 
 #ifndef _WIN32
@@ -64,6 +65,28 @@ STATIC void sighandler(int signum) {
 }
 #endif
 
+#if MICROPY_SAMPLING_PROFILE && !defined(_WIN32)
+STATIC void sigprof_handler(int signum) {
+    (void)signum;
+    mp_prof_sample_tick();
+}
+
+void mp_unix_sampling_profile_timer(int enable) {
+    struct sigaction sa;
+    sa.sa_flags = SA_RESTART;
+    sa.sa_handler = enable ? sigprof_handler : SIG_IGN;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGPROF, &sa, NULL);
+    // sample every 1ms of CPU time
+    struct itimerval it = {{0, 0}, {0, 0}};
+    if (enable) {
+        it.it_interval.tv_usec = 1000;
+        it.it_value.tv_usec = 1000;
+    }
+    setitimer(ITIMER_PROF, &it, NULL);
+}
+#endif
+
 void mp_hal_set_interrupt_char(char c) {
     // configure terminal settings to (not) let ctrl-C through
     if (c == CHAR_CTRL_C) {
@@ -0,0 +1,3 @@
+# test frozen package with its names loaded lazily
+print('frzmpy_lazy.bar')
+y = 2
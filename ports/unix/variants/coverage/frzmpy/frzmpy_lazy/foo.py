@@ -0,0 +1,4 @@
+# test frozen package with its names loaded lazily
+print('frzmpy_lazy.foo')
+class Foo:
+    x = 1
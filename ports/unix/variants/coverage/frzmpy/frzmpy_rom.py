@@ -0,0 +1,33 @@
+# test frozen module with its globals in ROM
+print('frzmpy_rom')
+X = 1
+NAME = 'rom'
+F = 1.5
+BIG = 12345678901234567890
+N = None
+count = 0
+
+def bump():
+    global count
+    count += 1
+    return count
+
+def gen():
+    yield X
+    yield NAME
+
+class Base:
+    a = 1
+    def __init__(self, v):
+        self.v = v
+    def get(self):
+        return self.v + X
+
+class Sub(Base):
+    b = 2
+    def get(self):
+        return Base.get(self) * 10
+
+if X:
+    Y = 2
+Z = bump()
@@ -0,0 +1,3 @@
+freeze_as_str("frzstr")
+freeze_as_mpy("frzmpy")
+freeze_lazy("frzmpy_lazy", {"Foo": "foo", "foo": "foo", "bar": "bar"})
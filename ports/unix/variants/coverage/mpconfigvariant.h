@@ -31,10 +31,17 @@
 #define MICROPY_PY_UOS_VFS             (1)
 
 #define MICROPY_DEBUG_PARSE_RULE_NAME  (1)
+#define MICROPY_COMP_CONST_FOLDING_LEN (1)
 #define MICROPY_OPT_MATH_FACTORIAL     (1)
 #define MICROPY_FLOAT_HIGH_QUALITY_HASH (1)
 #define MICROPY_ENABLE_SCHEDULER       (1)
+#define MICROPY_SCHEDULER_EVENT_DEPTH  (8)
+#define MICROPY_PY_THREAD_CHANNEL      (1)
+#define MICROPY_PY_THREAD_QUEUE        (1)
 #define MICROPY_READER_VFS             (1)
+#define MICROPY_PERSISTENT_CODE_LOAD_MAPPED (1)
+#define MICROPY_PERSISTENT_CODE_SAVE   (1)
+#define MICROPY_MODULE_MPY_CACHE       (1)
 #define MICROPY_REPL_EMACS_WORDS_MOVE  (1)
 #define MICROPY_REPL_EMACS_EXTRA_WORDS_MOVE (1)
 #define MICROPY_WARNINGS_CATEGORY      (1)
@@ -53,16 +60,40 @@
 #define MICROPY_PY_IO_BUFFEREDWRITER (1)
 #define MICROPY_PY_IO_RESOURCE_STREAM (1)
 #define MICROPY_PY_UASYNCIO            (1)
+#define MICROPY_PY_UASYNCIO_TIMER_WHEEL (1)
 #define MICROPY_PY_URE_DEBUG           (1)
 #define MICROPY_PY_URE_MATCH_GROUPS    (1)
 #define MICROPY_PY_URE_MATCH_SPAN_START_END (1)
 #define MICROPY_PY_URE_SUB             (1)
+#define MICROPY_PY_URE_FINDITER        (1)
+#define MICROPY_PY_URE_PIKEVM          (1)
 #define MICROPY_VFS_POSIX              (1)
+#define MICROPY_PY_USELECT_URING       (1)
 #define MICROPY_PY_FRAMEBUF            (1)
+#define MICROPY_PY_DISPLAY             (1)
+#define MICROPY_PY_NRF24L01            (1)
 #define MICROPY_PY_COLLECTIONS_NAMEDTUPLE__ASDICT (1)
+#define MICROPY_PY_COLLECTIONS_NAMEDTUPLE__MAKE_REPLACE (1)
 #define MICROPY_PY_UCRYPTOLIB          (1)
 #define MICROPY_PY_UCRYPTOLIB_CTR      (1)
 #define MICROPY_PY_MICROPYTHON_HEAP_LOCKED (1)
+#define MICROPY_GC_GENERATIONAL        (1)
+#define MICROPY_GC_INCREMENTAL         (1)
+#define MICROPY_GC_SIZE_CLASSES        (1)
+#define MICROPY_GC_SPLIT_HEAP          (1)
+#define MICROPY_GC_LARGE_PAGE_BLOCKS   (32)
+#define MICROPY_GC_PARALLEL_MARK       (1)
+#define MICROPY_GC_ARENA               (1)
+#define MICROPY_GC_COMPACT             (1)
+#define MICROPY_GC_ALLOC_PROFILE       (1)
+#define MICROPY_SAMPLING_PROFILE       (1)
+#define MICROPY_QSTR_SNAPSHOT          (1)
+#define MICROPY_HEAP_IMAGE             (1)
+#define MICROPY_JIT                    (1)
+#define MICROPY_VM_BUDGET              (1)
+#define MICROPY_PY_ARRAY_KERNELS       (1)
+#define MICROPY_FLOAT_FREELIST         (1)
+#define MICROPY_GC_POOL                (1)
 
 // use vfs's functions for import stat and builtin open
 #define mp_import_stat mp_vfs_import_stat
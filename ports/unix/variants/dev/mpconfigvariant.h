@@ -32,6 +32,7 @@
 #define MICROPY_VFS_POSIX                       (1)
 
 #define MICROPY_PY_SYS_SETTRACE                 (1)
+#define MICROPY_VM_OPCODE_STATS                 (1)
 #define MICROPY_PY_UOS_VFS                      (1)
 #define MICROPY_PY_URANDOM_EXTRA_FUNCS          (1)
 
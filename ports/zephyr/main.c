@@ -172,6 +172,10 @@ soft_reset:
     machine_pin_deinit();
     #endif
 
+    #if MICROPY_PY_ZSENSOR
+    zsensor_deinit();
+    #endif
+
     goto soft_reset;
 
     return 0;
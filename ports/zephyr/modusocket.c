@@ -29,6 +29,7 @@
 
 #include "py/runtime.h"
 #include "py/stream.h"
+#include "py/mperrno.h"
 
 #include <stdio.h>
 #include <zephyr.h>
@@ -287,6 +288,38 @@ STATIC mp_obj_t socket_recv(mp_obj_t self_in, mp_obj_t len_in) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(socket_recv_obj, socket_recv);
 
+// Receive into buf, which saves allocating a bytes object per call.
+STATIC mp_obj_t socket_recv_into(size_t n_args, const mp_obj_t *args) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[1], &bufinfo, MP_BUFFER_WRITE);
+    mp_uint_t max_len = bufinfo.len;
+    if (n_args > 2) {
+        max_len = MIN(max_len, (mp_uint_t)mp_obj_get_int(args[2]));
+    }
+    int err;
+    mp_uint_t len = sock_read(args[0], bufinfo.buf, max_len, &err);
+    if (len == MP_STREAM_ERROR) {
+        mp_raise_OSError(err);
+    }
+    return mp_obj_new_int_from_uint(len);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(socket_recv_into_obj, 2, 3, socket_recv_into);
+
+STATIC mp_obj_t socket_setblocking(mp_obj_t self_in, mp_obj_t flag_in) {
+    socket_obj_t *socket = self_in;
+    socket_check_closed(socket);
+    int flags = zsock_fcntl(socket->ctx, F_GETFL, 0);
+    RAISE_SOCK_ERRNO(flags);
+    if (mp_obj_is_true(flag_in)) {
+        flags &= ~O_NONBLOCK;
+    } else {
+        flags |= O_NONBLOCK;
+    }
+    RAISE_SOCK_ERRNO(zsock_fcntl(socket->ctx, F_SETFL, flags));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(socket_setblocking_obj, socket_setblocking);
+
 STATIC mp_obj_t socket_setsockopt(size_t n_args, const mp_obj_t *args) {
     (void)n_args; // always 4
     mp_warning(MP_WARN_CAT(RuntimeWarning), "setsockopt() not implemented");
@@ -316,6 +349,27 @@ STATIC mp_uint_t sock_ioctl(mp_obj_t o_in, mp_uint_t request, uintptr_t arg, int
             }
             return 0;
 
+        case MP_STREAM_POLL: {
+            if (socket->ctx == -1) {
+                return MP_STREAM_POLL_NVAL;
+            }
+            struct zsock_pollfd pfd = { .fd = socket->ctx, .events = arg };
+            int res = zsock_poll(&pfd, 1, 0);
+            if (res == -1) {
+                *errcode = errno;
+                return MP_STREAM_ERROR;
+            }
+            return res == 0 ? 0 : pfd.revents;
+        }
+
+        case MP_STREAM_GET_FILENO:
+            // used by mp_hal_uselect_wait to wait for sockets in zsock_poll
+            if (socket->ctx == -1) {
+                *errcode = EBADF;
+                return MP_STREAM_ERROR;
+            }
+            return socket->ctx;
+
         default:
             *errcode = MP_EINVAL;
             return MP_STREAM_ERROR;
@@ -331,6 +385,8 @@ STATIC const mp_rom_map_elem_t socket_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_accept), MP_ROM_PTR(&socket_accept_obj) },
     { MP_ROM_QSTR(MP_QSTR_send), MP_ROM_PTR(&socket_send_obj) },
     { MP_ROM_QSTR(MP_QSTR_recv), MP_ROM_PTR(&socket_recv_obj) },
+    { MP_ROM_QSTR(MP_QSTR_recv_into), MP_ROM_PTR(&socket_recv_into_obj) },
+    { MP_ROM_QSTR(MP_QSTR_setblocking), MP_ROM_PTR(&socket_setblocking_obj) },
     { MP_ROM_QSTR(MP_QSTR_setsockopt), MP_ROM_PTR(&socket_setsockopt_obj) },
 
     { MP_ROM_QSTR(MP_QSTR_read), MP_ROM_PTR(&mp_stream_read_obj) },
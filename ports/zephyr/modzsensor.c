@@ -27,17 +27,82 @@
 #include <string.h>
 
 #include "py/runtime.h"
+#include "py/stream.h"
+#include "py/mperrno.h"
 
 #include <zephyr.h>
 #include <drivers/sensor.h>
 
+#include "modzephyr.h"
+
 #if MICROPY_PY_ZSENSOR
 
+#define SENSOR_STREAM_MAX_CHANS (8)
+
 typedef struct _mp_obj_sensor_t {
     mp_obj_base_t base;
     const struct device *dev;
+    // While streaming, the trigger handler stores a sample of each channel in
+    // ring[head] and the VM takes them from ring[tail].  A sample that finds
+    // the ring full is counted in dropped.
+    struct sensor_value *ring;
+    uint16_t ring_len;
+    uint8_t n_chans;
+    uint8_t chans[SENSOR_STREAM_MAX_CHANS];
+    volatile uint16_t head;
+    volatile uint16_t tail;
+    volatile uint32_t dropped;
+    struct sensor_trigger trig;
 } mp_obj_sensor_t;
 
+// Drivers may copy the trigger, so the handler finds the sensor by its device.
+STATIC void sensor_trigger_handler(const struct device *dev, struct sensor_trigger *trig) {
+    mp_obj_sensor_t *self = NULL;
+    for (size_t i = 0; i < MP_ARRAY_SIZE(MP_STATE_PORT(zsensor_stream)); ++i) {
+        mp_obj_sensor_t *o = MP_STATE_PORT(zsensor_stream)[i];
+        if (o != NULL && o->dev == dev) {
+            self = o;
+            break;
+        }
+    }
+    if (self == NULL) {
+        return;
+    }
+    uint16_t head = self->head;
+    uint16_t next = head + 1 == self->ring_len ? 0 : head + 1;
+    if (next == self->tail || sensor_sample_fetch(dev) != 0) {
+        ++self->dropped;
+        return;
+    }
+    struct sensor_value *sample = &self->ring[head * self->n_chans];
+    for (size_t i = 0; i < self->n_chans; ++i) {
+        sensor_channel_get(dev, self->chans[i], &sample[i]);
+    }
+    self->head = next;
+}
+
+STATIC void sensor_stream_stop(mp_obj_sensor_t *self) {
+    if (self->ring == NULL) {
+        return;
+    }
+    sensor_trigger_set(self->dev, &self->trig, NULL);
+    for (size_t i = 0; i < MP_ARRAY_SIZE(MP_STATE_PORT(zsensor_stream)); ++i) {
+        if (MP_STATE_PORT(zsensor_stream)[i] == self) {
+            MP_STATE_PORT(zsensor_stream)[i] = NULL;
+        }
+    }
+    self->ring = NULL;
+}
+
+void zsensor_deinit(void) {
+    for (size_t i = 0; i < MP_ARRAY_SIZE(MP_STATE_PORT(zsensor_stream)); ++i) {
+        mp_obj_sensor_t *self = MP_STATE_PORT(zsensor_stream)[i];
+        if (self != NULL) {
+            sensor_stream_stop(self);
+        }
+    }
+}
+
 STATIC mp_obj_t sensor_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
     mp_arg_check_num(n_args, n_kw, 1, 1, false);
     mp_obj_sensor_t *o = m_new_obj(mp_obj_sensor_t);
@@ -96,12 +161,123 @@ STATIC mp_obj_t sensor_get_int(mp_obj_t self_in, mp_obj_t channel_in) {
 }
 MP_DEFINE_CONST_FUN_OBJ_2(sensor_get_int_obj, sensor_get_int);
 
+STATIC mp_obj_t sensor_start(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_channels, ARG_n, ARG_trigger };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_channels, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+        { MP_QSTR_n, MP_ARG_INT, {.u_int = 16} },
+        { MP_QSTR_trigger, MP_ARG_INT, {.u_int = SENSOR_TRIG_DATA_READY} },
+    };
+    mp_obj_sensor_t *self = MP_OBJ_TO_PTR(pos_args[0]);
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    size_t n_chans;
+    mp_obj_t *chans;
+    mp_obj_get_array(args[ARG_channels].u_obj, &n_chans, &chans);
+    mp_int_t n = args[ARG_n].u_int;
+    if (n_chans == 0 || n_chans > SENSOR_STREAM_MAX_CHANS || n < 1 || n >= 0xffff) {
+        mp_raise_ValueError(NULL);
+    }
+
+    sensor_stream_stop(self);
+    size_t slot = 0;
+    while (MP_STATE_PORT(zsensor_stream)[slot] != NULL) {
+        if (++slot == MP_ARRAY_SIZE(MP_STATE_PORT(zsensor_stream))) {
+            mp_raise_OSError(MP_EBUSY);
+        }
+    }
+
+    // The ring has one spare entry, to tell a full ring from an empty one.
+    self->ring = m_new(struct sensor_value, (n + 1) * n_chans);
+    self->ring_len = n + 1;
+    self->n_chans = n_chans;
+    for (size_t i = 0; i < n_chans; ++i) {
+        self->chans[i] = mp_obj_get_int(chans[i]);
+    }
+    self->head = 0;
+    self->tail = 0;
+    self->dropped = 0;
+    self->trig.type = args[ARG_trigger].u_int;
+    self->trig.chan = SENSOR_CHAN_ALL;
+    MP_STATE_PORT(zsensor_stream)[slot] = self;
+
+    int st = sensor_trigger_set(self->dev, &self->trig, sensor_trigger_handler);
+    if (st != 0) {
+        MP_STATE_PORT(zsensor_stream)[slot] = NULL;
+        self->ring = NULL;
+        mp_raise_OSError(-st);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(sensor_start_obj, 2, sensor_start);
+
+STATIC mp_obj_t sensor_stop(mp_obj_t self_in) {
+    sensor_stream_stop(MP_OBJ_TO_PTR(self_in));
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_1(sensor_stop_obj, sensor_stop);
+
+STATIC mp_int_t sensor_stream_any(mp_obj_sensor_t *self) {
+    if (self->ring == NULL) {
+        return 0;
+    }
+    mp_int_t n = self->head - self->tail;
+    return n < 0 ? n + self->ring_len : n;
+}
+
+STATIC mp_obj_t sensor_any(mp_obj_t self_in) {
+    return MP_OBJ_NEW_SMALL_INT(sensor_stream_any(MP_OBJ_TO_PTR(self_in)));
+}
+MP_DEFINE_CONST_FUN_OBJ_1(sensor_any_obj, sensor_any);
+
+STATIC mp_obj_t sensor_read(mp_obj_t self_in) {
+    mp_obj_sensor_t *self = MP_OBJ_TO_PTR(self_in);
+    if (sensor_stream_any(self) == 0) {
+        return mp_const_none;
+    }
+    uint16_t tail = self->tail;
+    struct sensor_value *sample = &self->ring[tail * self->n_chans];
+    mp_obj_tuple_t *t = MP_OBJ_TO_PTR(mp_obj_new_tuple(self->n_chans, NULL));
+    for (size_t i = 0; i < self->n_chans; ++i) {
+        t->items[i] = mp_obj_new_float(sample[i].val1 + (mp_float_t)sample[i].val2 / 1000000);
+    }
+    self->tail = tail + 1 == self->ring_len ? 0 : tail + 1;
+    return MP_OBJ_FROM_PTR(t);
+}
+MP_DEFINE_CONST_FUN_OBJ_1(sensor_read_obj, sensor_read);
+
+STATIC mp_obj_t sensor_dropped(mp_obj_t self_in) {
+    mp_obj_sensor_t *self = MP_OBJ_TO_PTR(self_in);
+    return mp_obj_new_int_from_uint(self->dropped);
+}
+MP_DEFINE_CONST_FUN_OBJ_1(sensor_dropped_obj, sensor_dropped);
+
+// A streaming sensor is readable for uselect when it has samples.
+STATIC mp_uint_t sensor_ioctl(mp_obj_t self_in, mp_uint_t request, uintptr_t arg, int *errcode) {
+    mp_obj_sensor_t *self = MP_OBJ_TO_PTR(self_in);
+    if (request == MP_STREAM_POLL) {
+        return (arg & MP_STREAM_POLL_RD) && sensor_stream_any(self) > 0 ? MP_STREAM_POLL_RD : 0;
+    }
+    *errcode = MP_EINVAL;
+    return MP_STREAM_ERROR;
+}
+
+STATIC const mp_stream_p_t sensor_stream_p = {
+    .ioctl = sensor_ioctl,
+};
+
 STATIC const mp_rom_map_elem_t sensor_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_measure), MP_ROM_PTR(&sensor_measure_obj) },
     { MP_ROM_QSTR(MP_QSTR_get_float), MP_ROM_PTR(&sensor_get_float_obj) },
     { MP_ROM_QSTR(MP_QSTR_get_micros), MP_ROM_PTR(&sensor_get_micros_obj) },
     { MP_ROM_QSTR(MP_QSTR_get_millis), MP_ROM_PTR(&sensor_get_millis_obj) },
     { MP_ROM_QSTR(MP_QSTR_get_int), MP_ROM_PTR(&sensor_get_int_obj) },
+    { MP_ROM_QSTR(MP_QSTR_start), MP_ROM_PTR(&sensor_start_obj) },
+    { MP_ROM_QSTR(MP_QSTR_stop), MP_ROM_PTR(&sensor_stop_obj) },
+    { MP_ROM_QSTR(MP_QSTR_any), MP_ROM_PTR(&sensor_any_obj) },
+    { MP_ROM_QSTR(MP_QSTR_read), MP_ROM_PTR(&sensor_read_obj) },
+    { MP_ROM_QSTR(MP_QSTR_dropped), MP_ROM_PTR(&sensor_dropped_obj) },
 };
 
 STATIC MP_DEFINE_CONST_DICT(sensor_locals_dict, sensor_locals_dict_table);
@@ -110,6 +286,7 @@ STATIC const mp_obj_type_t sensor_type = {
     { &mp_type_type },
     .name = MP_QSTR_Sensor,
     .make_new = sensor_make_new,
+    .protocol = &sensor_stream_p,
     .locals_dict = (void *)&sensor_locals_dict,
 };
 
@@ -134,6 +311,9 @@ STATIC const mp_rom_map_elem_t mp_module_zsensor_globals_table[] = {
     C(LIGHT),
     C(ALTITUDE),
 #undef C
+
+    { MP_ROM_QSTR(MP_QSTR_TRIG_DATA_READY), MP_ROM_INT(SENSOR_TRIG_DATA_READY) },
+    { MP_ROM_QSTR(MP_QSTR_TRIG_TIMER), MP_ROM_INT(SENSOR_TRIG_TIMER) },
 };
 
 STATIC MP_DEFINE_CONST_DICT(mp_module_zsensor_globals, mp_module_zsensor_globals_table);
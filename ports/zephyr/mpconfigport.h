@@ -68,6 +68,9 @@
 // If we have networking, we likely want errno comfort
 #define MICROPY_PY_UERRNO           (1)
 #define MICROPY_PY_USOCKET          (1)
+#define MICROPY_PY_USELECT          (1)
+// uselect sleeps in zsock_poll on the sockets instead of polling each in turn
+#define MICROPY_PY_USELECT_WAIT(poll_map, timeout_ms) mp_hal_uselect_wait(poll_map, timeout_ms)
 #endif
 #define MICROPY_PY_UBINASCII        (1)
 #define MICROPY_PY_UHASHLIB         (1)
@@ -123,7 +126,8 @@ typedef long mp_off_t;
 
 #define MICROPY_PORT_ROOT_POINTERS \
     const char *readline_hist[8]; \
-    void *machine_pin_irq_list; /* Linked list of pin irq objects */
+    void *machine_pin_irq_list; /* Linked list of pin irq objects */ \
+    void *zsensor_stream[4]; /* Sensors streaming from triggers */
 
 extern const struct _mp_obj_module_t mp_module_machine;
 extern const struct _mp_obj_module_t mp_module_time;
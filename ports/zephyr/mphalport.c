@@ -26,6 +26,12 @@
 
 #include "py/runtime.h"
 #include "py/mphal.h"
+#include "py/stream.h"
+#include "extmod/moduselect.h"
+
+#ifdef CONFIG_NET_SOCKETS
+#include <net/socket.h>
+#endif
 
 static struct k_poll_signal wait_signal;
 static struct k_poll_event wait_events[2] = {
@@ -72,3 +78,47 @@ void mp_hal_wait_sem(struct k_sem *sem, uint32_t timeout_ms) {
         }
     }
 }
+
+#if MICROPY_PY_USELECT
+// Wait for the sockets registered with uselect in zsock_poll, in slices of at
+// most 10ms between which pending events are handled.  Other streams can only
+// be polled, so if there are any the wait is at most 1ms.
+void mp_hal_uselect_wait(struct _mp_map_t *poll_map, mp_int_t timeout_ms) {
+    mp_int_t slice = 10;
+    #ifdef CONFIG_NET_SOCKETS
+    struct zsock_pollfd fds[poll_map->used + 1];
+    int nfds = 0;
+    #endif
+    for (size_t i = 0; i < poll_map->alloc; ++i) {
+        if (!mp_map_slot_is_filled(poll_map, i)) {
+            continue;
+        }
+        poll_obj_t *poll_obj = MP_OBJ_TO_PTR(poll_map->table[i].value);
+        #ifdef CONFIG_NET_SOCKETS
+        int errcode;
+        mp_uint_t fd = poll_obj->ioctl(poll_obj->obj, MP_STREAM_GET_FILENO, 0, &errcode);
+        if (fd != MP_STREAM_ERROR) {
+            fds[nfds].fd = fd;
+            fds[nfds].events = poll_obj->flags;
+            ++nfds;
+            continue;
+        }
+        #else
+        (void)poll_obj;
+        #endif
+        slice = 1;
+    }
+    if (timeout_ms != -1 && timeout_ms < slice) {
+        slice = MAX(timeout_ms, 0);
+    }
+    #ifdef CONFIG_NET_SOCKETS
+    if (nfds > 0) {
+        zsock_poll(fds, nfds, slice);
+    } else
+    #endif
+    {
+        k_msleep(slice);
+    }
+    mp_handle_pending(true);
+}
+#endif
@@ -4,6 +4,9 @@
 void mp_hal_init(void);
 void mp_hal_wait_sem(struct k_sem *sem, uint32_t timeout_ms);
 
+struct _mp_map_t;
+void mp_hal_uselect_wait(struct _mp_map_t *poll_map, mp_int_t timeout_ms);
+
 static inline mp_uint_t mp_hal_ticks_us(void) {
     return k_cyc_to_ns_floor64(k_cycle_get_32()) / 1000;
 }
@@ -76,7 +76,38 @@ void mp_arg_check_num_sig(size_t n_args, size_t n_kw, uint32_t sig) {
     }
 }
 
+#if MICROPY_OPT_ARG_SLOT_CACHE
+// Return the index of the argument called name, or 0xff if there isn't one.
+STATIC uint8_t arg_find_slot(size_t n_allowed, const mp_arg_t *allowed, mp_obj_t name) {
+    uint8_t *slot_hint = mp_arg_slot_cache(allowed, name);
+    size_t i = *slot_hint;
+    if (i < n_allowed && MP_OBJ_NEW_QSTR(allowed[i].qst) == name) {
+        return i;
+    }
+    for (i = 0; i < n_allowed; i++) {
+        if (MP_OBJ_NEW_QSTR(allowed[i].qst) == name) {
+            *slot_hint = i;
+            return i;
+        }
+    }
+    return 0xff;
+}
+#endif
+
 void mp_arg_parse_all(size_t n_pos, const mp_obj_t *pos, mp_map_t *kws, size_t n_allowed, const mp_arg_t *allowed, mp_arg_val_t *out_vals) {
+    #if MICROPY_OPT_ARG_SLOT_CACHE
+    // Keyword arguments passed as an array, as they are by a call, are matched
+    // to their arguments first, so the loop below doesn't have to search them
+    // all for each argument.
+    uint8_t kw_slot[MICROPY_OPT_ARG_SLOT_CACHE_MAX_KW];
+    bool by_slot = kws->is_fixed && kws->used <= MICROPY_OPT_ARG_SLOT_CACHE_MAX_KW && n_allowed < 0xff;
+    if (by_slot) {
+        for (size_t k = 0; k < kws->used; k++) {
+            kw_slot[k] = arg_find_slot(n_allowed, allowed, kws->table[k].key);
+        }
+    }
+    #endif
+
     size_t pos_found = 0, kws_found = 0;
     for (size_t i = 0; i < n_allowed; i++) {
         mp_obj_t given_arg;
@@ -87,7 +118,21 @@ void mp_arg_parse_all(size_t n_pos, const mp_obj_t *pos, mp_map_t *kws, size_t n
             pos_found++;
             given_arg = pos[i];
         } else {
-            mp_map_elem_t *kw = mp_map_lookup(kws, MP_OBJ_NEW_QSTR(allowed[i].qst), MP_MAP_LOOKUP);
+            mp_map_elem_t *kw;
+            #if MICROPY_OPT_ARG_SLOT_CACHE
+            if (by_slot) {
+                kw = NULL;
+                for (size_t k = 0; k < kws->used; k++) {
+                    if (kw_slot[k] == i) {
+                        kw = &kws->table[k];
+                        break;
+                    }
+                }
+            } else
+            #endif
+            {
+                kw = mp_map_lookup(kws, MP_OBJ_NEW_QSTR(allowed[i].qst), MP_MAP_LOOKUP);
+            }
             if (kw == NULL) {
                 if (allowed[i].flags & MP_ARG_REQUIRED) {
                     #if MICROPY_ERROR_REPORTING <= MICROPY_ERROR_REPORTING_TERSE
@@ -0,0 +1,227 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <assert.h>
+
+#include "py/mpconfig.h"
+
+// wrapper around everything in this file
+#if MICROPY_EMIT_RV32 || MICROPY_EMIT_INLINE_RV32
+
+#include "py/asmrv32.h"
+
+#define WORD_SIZE (4)
+#define SIGNED_FIT12(x) ((((x) & 0xfffff800) == 0) || (((x) & 0xfffff800) == 0xfffff800))
+#define SIGNED_FIT13(x) ((((x) & 0xfffff000) == 0) || (((x) & 0xfffff000) == 0xfffff000))
+#define SIGNED_FIT21(x) ((((x) & 0xfff00000) == 0) || (((x) & 0xfff00000) == 0xfff00000))
+
+void asm_rv32_end_pass(asm_rv32_t *as) {
+    (void)as;
+    #if 0
+    // make a hex dump of the machine code
+    if (as->base.pass == MP_ASM_PASS_EMIT) {
+        uint8_t *d = as->base.code_base;
+        printf("RV32 ASM:");
+        for (int i = 0; i < ((as->base.code_size + 15) & ~15); ++i) {
+            if (i % 16 == 0) {
+                printf("\n%08x:", (uint32_t)&d[i]);
+            }
+            if (i % 4 == 0) {
+                printf(" ");
+            }
+            printf("%02x", d[i]);
+        }
+        printf("\n");
+    }
+    #endif
+}
+
+void asm_rv32_entry(asm_rv32_t *as, int num_locals) {
+    // adjust the stack-pointer to store ra, s2, s3, s4, s5 and locals, 16-byte aligned
+    as->stack_adjust = (((ASM_RV32_NUM_REGS_SAVED + num_locals) * WORD_SIZE) + 15) & ~15;
+    if (SIGNED_FIT12(-as->stack_adjust)) {
+        asm_rv32_op_addi(as, ASM_RV32_REG_SP, ASM_RV32_REG_SP, -as->stack_adjust);
+    } else {
+        asm_rv32_mov_reg_i32_optimised(as, ASM_RV32_REG_SCRATCH, as->stack_adjust);
+        asm_rv32_op_sub(as, ASM_RV32_REG_SP, ASM_RV32_REG_SP, ASM_RV32_REG_SCRATCH);
+    }
+
+    // save return address (ra) and callee-save registers (s2, s3, s4, s5)
+    asm_rv32_op_sw(as, ASM_RV32_REG_RA, ASM_RV32_REG_SP, 0);
+    for (int i = 1; i < ASM_RV32_NUM_REGS_SAVED; ++i) {
+        asm_rv32_op_sw(as, ASM_RV32_REG_S2 - 1 + i, ASM_RV32_REG_SP, i * WORD_SIZE);
+    }
+}
+
+void asm_rv32_exit(asm_rv32_t *as) {
+    // restore registers
+    for (int i = ASM_RV32_NUM_REGS_SAVED - 1; i >= 1; --i) {
+        asm_rv32_op_lw(as, ASM_RV32_REG_S2 - 1 + i, ASM_RV32_REG_SP, i * WORD_SIZE);
+    }
+    asm_rv32_op_lw(as, ASM_RV32_REG_RA, ASM_RV32_REG_SP, 0);
+
+    // restore stack-pointer and return
+    if (SIGNED_FIT12(as->stack_adjust)) {
+        asm_rv32_op_addi(as, ASM_RV32_REG_SP, ASM_RV32_REG_SP, as->stack_adjust);
+    } else {
+        asm_rv32_mov_reg_i32_optimised(as, ASM_RV32_REG_SCRATCH, as->stack_adjust);
+        asm_rv32_op_add(as, ASM_RV32_REG_SP, ASM_RV32_REG_SP, ASM_RV32_REG_SCRATCH);
+    }
+
+    asm_rv32_op_jalr(as, ASM_RV32_REG_X0, ASM_RV32_REG_RA, 0);
+}
+
+STATIC uint32_t get_label_dest(asm_rv32_t *as, uint label) {
+    assert(label < as->base.max_num_labels);
+    return as->base.label_offsets[label];
+}
+
+void asm_rv32_op32(asm_rv32_t *as, uint32_t op) {
+    uint8_t *c = mp_asm_base_get_cur_to_write_bytes(&as->base, 4);
+    if (c != NULL) {
+        c[0] = op;
+        c[1] = op >> 8;
+        c[2] = op >> 16;
+        c[3] = op >> 24;
+    }
+}
+
+void asm_rv32_j_label(asm_rv32_t *as, uint label) {
+    uint32_t dest = get_label_dest(as, label);
+    int32_t rel = dest - as->base.code_offset;
+    if (as->base.pass == MP_ASM_PASS_EMIT && !SIGNED_FIT21(rel)) {
+        printf("ERROR: rv32 jump out of range\n");
+    }
+    asm_rv32_op_jal(as, ASM_RV32_REG_X0, rel);
+}
+
+void asm_rv32_bcc_reg_reg_label(asm_rv32_t *as, uint cond, uint rs1, uint rs2, uint label) {
+    uint32_t dest = get_label_dest(as, label);
+    int32_t rel = dest - as->base.code_offset;
+    // A backward label has the same offset in both passes, so it can use the short
+    // form; a forward one may be out of range of it and branches around a jump.
+    if (dest <= as->base.code_offset && SIGNED_FIT13(rel)) {
+        asm_rv32_op_bcc(as, cond, rs1, rs2, rel);
+    } else {
+        // the conditions come in pairs that differ in the lowest bit of funct3
+        asm_rv32_op_bcc(as, cond ^ 1, rs1, rs2, 8);
+        asm_rv32_j_label(as, label);
+    }
+}
+
+// convenience function; reg_dest may be the same as either source
+void asm_rv32_setcc_reg_reg_reg(asm_rv32_t *as, uint cond, uint rd, uint rs1, uint rs2) {
+    switch (cond) {
+        case ASM_RV32_CC_EQ:
+            asm_rv32_op_xor(as, rd, rs1, rs2);
+            asm_rv32_op_sltiu(as, rd, rd, 1);
+            break;
+        case ASM_RV32_CC_NE:
+            asm_rv32_op_xor(as, rd, rs1, rs2);
+            asm_rv32_op_sltu(as, rd, ASM_RV32_REG_X0, rd);
+            break;
+        case ASM_RV32_CC_LT:
+        case ASM_RV32_CC_GE:
+            asm_rv32_op_slt(as, rd, rs1, rs2);
+            break;
+        default: // ASM_RV32_CC_LTU, ASM_RV32_CC_GEU
+            asm_rv32_op_sltu(as, rd, rs1, rs2);
+            break;
+    }
+    if (cond == ASM_RV32_CC_GE || cond == ASM_RV32_CC_GEU) {
+        asm_rv32_op_xori(as, rd, rd, 1);
+    }
+}
+
+// Always emits lui and addi, so the value can be patched later on.  Returns the
+// offset of the lui instruction.
+size_t asm_rv32_mov_reg_i32(asm_rv32_t *as, uint rd, uint32_t i32) {
+    size_t loc = as->base.code_offset;
+    // addi sign extends its immediate, so round the upper part to compensate
+    uint32_t hi = (i32 + 0x800) >> 12;
+    asm_rv32_op_lui(as, rd, hi);
+    asm_rv32_op_addi(as, rd, rd, i32 - (hi << 12));
+    return loc;
+}
+
+void asm_rv32_mov_reg_i32_optimised(asm_rv32_t *as, uint rd, uint32_t i32) {
+    if (SIGNED_FIT12(i32)) {
+        asm_rv32_op_addi(as, rd, ASM_RV32_REG_X0, i32);
+    } else {
+        uint32_t hi = (i32 + 0x800) >> 12;
+        asm_rv32_op_lui(as, rd, hi);
+        if ((i32 & 0xfff) != 0) {
+            asm_rv32_op_addi(as, rd, rd, i32 - (hi << 12));
+        }
+    }
+}
+
+void asm_rv32_load_reg_reg_offset(asm_rv32_t *as, uint rd, uint rs1, int32_t offset) {
+    if (SIGNED_FIT12(offset)) {
+        asm_rv32_op_lw(as, rd, rs1, offset);
+    } else {
+        asm_rv32_mov_reg_i32_optimised(as, ASM_RV32_REG_SCRATCH, offset);
+        asm_rv32_op_add(as, ASM_RV32_REG_SCRATCH, ASM_RV32_REG_SCRATCH, rs1);
+        asm_rv32_op_lw(as, rd, ASM_RV32_REG_SCRATCH, 0);
+    }
+}
+
+void asm_rv32_store_reg_reg_offset(asm_rv32_t *as, uint rs2, uint rs1, int32_t offset) {
+    if (SIGNED_FIT12(offset)) {
+        asm_rv32_op_sw(as, rs2, rs1, offset);
+    } else {
+        asm_rv32_mov_reg_i32_optimised(as, ASM_RV32_REG_SCRATCH, offset);
+        asm_rv32_op_add(as, ASM_RV32_REG_SCRATCH, ASM_RV32_REG_SCRATCH, rs1);
+        asm_rv32_op_sw(as, rs2, ASM_RV32_REG_SCRATCH, 0);
+    }
+}
+
+void asm_rv32_mov_reg_local_addr(asm_rv32_t *as, uint rd, int local_num) {
+    uint off = local_num * WORD_SIZE;
+    if (SIGNED_FIT12(off)) {
+        asm_rv32_op_addi(as, rd, ASM_RV32_REG_SP, off);
+    } else {
+        asm_rv32_mov_reg_i32_optimised(as, rd, off);
+        asm_rv32_op_add(as, rd, rd, ASM_RV32_REG_SP);
+    }
+}
+
+void asm_rv32_mov_reg_pcrel(asm_rv32_t *as, uint rd, uint label) {
+    // Get relative offset from PC, which auipc adds to
+    uint32_t dest = get_label_dest(as, label);
+    uint32_t rel = dest - as->base.code_offset;
+    uint32_t hi = (rel + 0x800) >> 12;
+    asm_rv32_op_auipc(as, rd, hi);
+    asm_rv32_op_addi(as, rd, rd, rel - (hi << 12));
+}
+
+void asm_rv32_call_ind(asm_rv32_t *as, uint idx) {
+    asm_rv32_load_reg_reg_offset(as, ASM_RV32_REG_SCRATCH, ASM_RV32_REG_FUN_TABLE, idx * WORD_SIZE);
+    asm_rv32_op_jalr(as, ASM_RV32_REG_RA, ASM_RV32_REG_SCRATCH, 0);
+}
+
+#endif // MICROPY_EMIT_RV32 || MICROPY_EMIT_INLINE_RV32
@@ -123,8 +123,10 @@ void mp_setup_code_state(mp_code_state_t *code_state, size_t n_args, size_t n_kw
     code_state->prev = NULL;
     #endif
 
-    #if MICROPY_PY_SYS_SETTRACE
+    #if MICROPY_TRACK_CODE_STATE
     code_state->prev_state = NULL;
+    #endif
+    #if MICROPY_PY_SYS_SETTRACE
     code_state->frame = NULL;
     #endif
 
@@ -200,14 +202,20 @@ void mp_setup_code_state(mp_code_state_t *code_state, size_t n_args, size_t n_kw
         for (size_t i = 0; i < n_kw; i++) {
             // the keys in kwargs are expected to be qstr objects
             mp_obj_t wanted_arg_name = kwargs[2 * i];
-            for (size_t j = 0; j < n_pos_args + n_kwonly_args; j++) {
+            size_t j;
+            #if MICROPY_OPT_ARG_SLOT_CACHE
+            uint8_t *slot_hint = mp_arg_slot_cache(arg_names, wanted_arg_name);
+            j = *slot_hint;
+            if (j < n_pos_args + n_kwonly_args && arg_names[j] == wanted_arg_name) {
+                goto found;
+            }
+            #endif
+            for (j = 0; j < n_pos_args + n_kwonly_args; j++) {
                 if (wanted_arg_name == arg_names[j]) {
-                    if (code_state->state[n_state - 1 - j] != MP_OBJ_NULL) {
-                        mp_raise_msg_varg(&mp_type_TypeError,
-                            MP_ERROR_TEXT("function got multiple values for argument '%q'"), MP_OBJ_QSTR_VALUE(wanted_arg_name));
-                    }
-                    code_state->state[n_state - 1 - j] = kwargs[2 * i + 1];
-                    goto continue2;
+                    #if MICROPY_OPT_ARG_SLOT_CACHE
+                    *slot_hint = j;
+                    #endif
+                    goto found;
                 }
             }
             // Didn't find name match with positional args
@@ -220,7 +228,13 @@ void mp_setup_code_state(mp_code_state_t *code_state, size_t n_args, size_t n_kw
                 #endif
             }
             mp_obj_dict_store(dict, kwargs[2 * i], kwargs[2 * i + 1]);
-        continue2:;
+            continue;
+        found:
+            if (code_state->state[n_state - 1 - j] != MP_OBJ_NULL) {
+                mp_raise_msg_varg(&mp_type_TypeError,
+                    MP_ERROR_TEXT("function got multiple values for argument '%q'"), MP_OBJ_QSTR_VALUE(wanted_arg_name));
+            }
+            code_state->state[n_state - 1 - j] = kwargs[2 * i + 1];
         }
 
         DEBUG_printf("Args with kws flattened: ");
@@ -300,6 +314,34 @@ void mp_setup_code_state(mp_code_state_t *code_state, size_t n_args, size_t n_kw
     dump_args(code_state->state, n_state);
 }
 
+size_t mp_bytecode_get_location(const byte *bytecode, const byte *ip, qstr *source_file, qstr *block_name) {
+    const byte *p = bytecode;
+    MP_BC_PRELUDE_SIG_DECODE(p);
+    MP_BC_PRELUDE_SIZE_DECODE(p);
+    const byte *bytecode_start = p + n_info + n_cell;
+    #if !MICROPY_PERSISTENT_CODE
+    bytecode_start = MP_ALIGN(bytecode_start, sizeof(mp_uint_t));
+    #endif
+    size_t bc = ip > bytecode_start ? ip - bytecode_start : 0;
+    #if MICROPY_PERSISTENT_CODE
+    qstr block = p[0] | (p[1] << 8);
+    qstr source = p[2] | (p[3] << 8);
+    p += 4;
+    #else
+    qstr block = mp_decode_uint_value(p);
+    p = mp_decode_uint_skip(p);
+    qstr source = mp_decode_uint_value(p);
+    p = mp_decode_uint_skip(p);
+    #endif
+    if (source_file != NULL) {
+        *source_file = source;
+    }
+    if (block_name != NULL) {
+        *block_name = block;
+    }
+    return mp_bytecode_get_source_line(p, bc);
+}
+
 #if MICROPY_PERSISTENT_CODE_LOAD || MICROPY_PERSISTENT_CODE_SAVE
 
 // The following table encodes the number of bytes that a specific opcode
@@ -209,8 +209,10 @@ typedef struct _mp_code_state_t {
     #if MICROPY_STACKLESS
     struct _mp_code_state_t *prev;
     #endif
-    #if MICROPY_PY_SYS_SETTRACE
+    #if MICROPY_TRACK_CODE_STATE
     struct _mp_code_state_t *prev_state;
+    #endif
+    #if MICROPY_PY_SYS_SETTRACE
     struct _mp_obj_frame_t *frame;
     #endif
     // Variable-length
@@ -225,6 +227,10 @@ const byte *mp_decode_uint_skip(const byte *ptr);
 
 mp_vm_return_kind_t mp_execute_bytecode(mp_code_state_t *code_state, volatile mp_obj_t inject_exc);
 mp_code_state_t *mp_obj_fun_bc_prepare_codestate(mp_obj_t func, size_t n_args, size_t n_kw, const mp_obj_t *args);
+#if MICROPY_STACKLESS
+mp_obj_t mp_obj_closure_get_fun(mp_obj_t self_in);
+mp_code_state_t *mp_obj_closure_prepare_codestate(mp_obj_t self_in, size_t n_args, size_t n_kw, const mp_obj_t *args);
+#endif
 void mp_setup_code_state(mp_code_state_t *code_state, size_t n_args, size_t n_kw, const mp_obj_t *args);
 void mp_bytecode_print(const mp_print_t *print, const void *descr, const byte *code, mp_uint_t len, const mp_uint_t *const_table);
 void mp_bytecode_print2(const mp_print_t *print, const byte *code, size_t len, const mp_uint_t *const_table);
@@ -270,4 +276,13 @@ static inline size_t mp_bytecode_get_source_line(const byte *line_info, size_t b
     return source_line;
 }
 
+// Return the source line of the instruction at ip in the given function's
+// bytecode, as a traceback would, and the names of its file and function if
+// source_file and block_name aren't NULL.  Safe to call from an interrupt.
+size_t mp_bytecode_get_location(const byte *bytecode, const byte *ip, qstr *source_file, qstr *block_name);
+
+// Add a traceback entry to an exception for the instruction at ip in fun_bc,
+// leaving its line number to be decoded when the traceback is read.
+void mp_obj_exception_add_traceback_bc(mp_obj_t self_in, const mp_obj_fun_bc_t *fun_bc, const byte *ip);
+
 #endif // MICROPY_INCLUDED_PY_BC_H
@@ -36,6 +36,13 @@
 #include "py/builtin.h"
 #include "py/frozenmod.h"
 
+#if MICROPY_MODULE_MPY_CACHE
+#include "py/mperrno.h"
+#include "py/reader.h"
+#include "py/stream.h"
+#include "extmod/vfs.h"
+#endif
+
 #if MICROPY_DEBUG_VERBOSE // print debugging info
 #define DEBUG_PRINT (1)
 #define DEBUG_printf DEBUG_printf
@@ -179,6 +186,160 @@ STATIC void do_execute_raw_code(mp_obj_t module_obj, mp_raw_code_t *raw_code, co
 }
 #endif
 
+#if MICROPY_MODULE_MPY_CACHE
+
+// A cached .mpy is preceded by a key made of the size and modification time
+// of its source and the optimisation level it was compiled at, and is only
+// used while all of them stay the same.
+#define MPY_CACHE_KEY_LEN (10)
+
+STATIC bool mpy_cache_key(const char *file_str, byte *key) {
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        mp_obj_t *items;
+        mp_obj_get_array_fixed_n(mp_vfs_stat(mp_obj_new_str(file_str, strlen(file_str))), 10, &items);
+        mp_uint_t size = mp_obj_get_int_truncated(items[6]);
+        mp_uint_t mtime = mp_obj_get_int_truncated(items[8]);
+        nlr_pop();
+        key[0] = 'C';
+        key[1] = MP_STATE_VM(mp_optimise_value);
+        for (size_t i = 0; i < 4; ++i) {
+            key[2 + i] = size >> (8 * i);
+            key[6 + i] = mtime >> (8 * i);
+        }
+        return true;
+    } else {
+        return false;
+    }
+}
+
+// Make the name of the cache file of the given source, "dir/name.py" giving
+// "dir/__pycache__/name.mpy", and return the length of its directory part.
+STATIC size_t mpy_cache_path(vstr_t *cache, const vstr_t *file) {
+    const char *name = file->buf + file->len;
+    while (name > file->buf && name[-1] != PATH_SEP_CHAR) {
+        --name;
+    }
+    vstr_add_strn(cache, file->buf, name - file->buf);
+    vstr_add_str(cache, "__pycache__");
+    size_t dir_len = cache->len;
+    vstr_add_char(cache, PATH_SEP_CHAR);
+    vstr_add_strn(cache, name, file->buf + file->len - 2 - name);
+    vstr_add_str(cache, "mpy");
+    return dir_len;
+}
+
+STATIC mp_raw_code_t *mpy_cache_load(const char *cache_str, const byte *key) {
+    if (mp_import_stat(cache_str) != MP_IMPORT_STAT_FILE) {
+        return NULL;
+    }
+    mp_reader_t reader;
+    mp_reader_new_file(&reader, cache_str);
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        bool match = true;
+        for (size_t i = 0; i < MPY_CACHE_KEY_LEN; ++i) {
+            match &= reader.readbyte(reader.data) == key[i];
+        }
+        mp_raw_code_t *raw_code = NULL;
+        if (match) {
+            // this closes the reader
+            raw_code = mp_raw_code_load(&reader);
+        } else {
+            reader.close(reader.data);
+        }
+        nlr_pop();
+        return raw_code;
+    } else {
+        // The file is damaged or from an incompatible firmware, so compile
+        // the source again
+        reader.close(reader.data);
+        if (!mp_obj_exception_match(MP_OBJ_FROM_PTR(nlr.ret_val), MP_OBJ_FROM_PTR(&mp_type_Exception))) {
+            nlr_jump(nlr.ret_val);
+        }
+        return NULL;
+    }
+}
+
+STATIC void mpy_cache_write(void *file, const char *str, size_t len) {
+    if (mp_stream_write(MP_OBJ_FROM_PTR(file), str, len, MP_STREAM_RW_WRITE) != MP_OBJ_NEW_SMALL_INT(len)) {
+        mp_raise_OSError(MP_ENOSPC);
+    }
+}
+
+STATIC void mpy_cache_save(vstr_t *cache, size_t dir_len, mp_raw_code_t *raw_code, const byte *key) {
+    if (mp_raw_code_has_native(raw_code)) {
+        // native code compiled on the device can't be saved
+        return;
+    }
+    // The loader trusts the contents of an .mpy, so it's written to a
+    // temporary file that is only renamed to the cache file once complete,
+    // in case the device is reset part way through.
+    mp_obj_t path = mp_obj_new_str(cache->buf, cache->len);
+    vstr_add_str(cache, ".tmp");
+    mp_obj_t tmp_path = mp_obj_new_str(cache->buf, cache->len);
+    mp_obj_t volatile file = MP_OBJ_NULL;
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        mp_obj_t dir = mp_obj_new_str(cache->buf, dir_len);
+        if (mp_import_stat(mp_obj_str_get_str(dir)) != MP_IMPORT_STAT_DIR) {
+            mp_vfs_mkdir(dir);
+        }
+        mp_obj_t args[2] = { tmp_path, MP_OBJ_NEW_QSTR(MP_QSTR_wb) };
+        file = mp_vfs_open(MP_ARRAY_SIZE(args), args, (mp_map_t *)&mp_const_empty_map);
+        mp_print_t print = {MP_OBJ_TO_PTR(file), mpy_cache_write};
+        mpy_cache_write(print.data, (const char *)key, MPY_CACHE_KEY_LEN);
+        mp_raw_code_save(raw_code, &print);
+        mp_stream_close(file);
+        file = MP_OBJ_NULL;
+        mp_vfs_rename(tmp_path, path);
+        nlr_pop();
+    } else {
+        // The cache is only there to speed up imports, so failing to write it,
+        // eg to a read-only or full filesystem, isn't an error.
+        nlr_buf_t nlr2;
+        if (nlr_push(&nlr2) == 0) {
+            if (file != MP_OBJ_NULL) {
+                mp_stream_close(file);
+            }
+            mp_vfs_remove(tmp_path);
+            nlr_pop();
+        }
+        if (!mp_obj_exception_match(MP_OBJ_FROM_PTR(nlr.ret_val), MP_OBJ_FROM_PTR(&mp_type_Exception))) {
+            nlr_jump(nlr.ret_val);
+        }
+    }
+}
+
+// Load a .py file from its cached .mpy if that's up to date, otherwise
+// compile it and save the .mpy for next time.
+STATIC void do_load_with_cache(mp_obj_t module_obj, vstr_t *file) {
+    const char *file_str = vstr_null_terminated_str(file);
+    byte key[MPY_CACHE_KEY_LEN];
+    bool have_key = mpy_cache_key(file_str, key);
+    vstr_t cache;
+    vstr_init(&cache, file->len + 16);
+    size_t dir_len = mpy_cache_path(&cache, file);
+
+    mp_raw_code_t *raw_code = NULL;
+    if (have_key) {
+        raw_code = mpy_cache_load(vstr_null_terminated_str(&cache), key);
+    }
+    if (raw_code == NULL) {
+        mp_lexer_t *lex = mp_lexer_new_from_file(file_str);
+        qstr source_name = lex->source_name;
+        mp_parse_tree_t parse_tree = mp_parse(lex, MP_PARSE_FILE_INPUT);
+        raw_code = mp_compile_to_raw_code(&parse_tree, source_name, false);
+        if (have_key) {
+            mpy_cache_save(&cache, dir_len, raw_code, key);
+        }
+    }
+    vstr_clear(&cache);
+    do_execute_raw_code(module_obj, raw_code, file_str);
+}
+
+#endif // MICROPY_MODULE_MPY_CACHE
+
 STATIC void do_load(mp_obj_t module_obj, vstr_t *file) {
     #if MICROPY_MODULE_FROZEN || MICROPY_ENABLE_COMPILER || (MICROPY_PERSISTENT_CODE_LOAD && MICROPY_HAS_FILE_READER)
     char *file_str = vstr_null_terminated_str(file);
@@ -204,6 +365,9 @@ STATIC void do_load(mp_obj_t module_obj, vstr_t *file) {
     // its data) in the list of frozen files, execute it.
     #if MICROPY_MODULE_FROZEN_MPY
     if (frozen_type == MP_FROZEN_MPY) {
+        #if MICROPY_MODULE_FROZEN_ROM_GLOBALS
+        mp_frozen_mpy_init_globals(module_obj, modref);
+        #endif
         do_execute_raw_code(module_obj, modref, file_str);
         return;
     }
@@ -222,6 +386,12 @@ STATIC void do_load(mp_obj_t module_obj, vstr_t *file) {
     // If we can compile scripts then load the file and compile and execute it.
     #if MICROPY_ENABLE_COMPILER
     {
+        #if MICROPY_MODULE_MPY_CACHE
+        if (MP_STATE_VM(mpy_cache)) {
+            do_load_with_cache(module_obj, file);
+            return;
+        }
+        #endif
         mp_lexer_t *lex = mp_lexer_new_from_file(file_str);
         do_load_from_lexer(module_obj, lex);
         return;
@@ -34,6 +34,7 @@
 #include "py/emit.h"
 #include "py/compile.h"
 #include "py/runtime.h"
+#include "py/gc.h"
 #include "py/asmbase.h"
 #include "py/persistentcode.h"
 
@@ -96,6 +97,7 @@ STATIC const emit_method_table_t *emit_native_table[] = {
     &emit_native_thumb_method_table,
     &emit_native_xtensa_method_table,
     &emit_native_xtensawin_method_table,
+    &emit_native_rv32_method_table,
 };
 
 #elif MICROPY_EMIT_NATIVE
@@ -112,6 +114,8 @@ STATIC const emit_method_table_t *emit_native_table[] = {
 #define NATIVE_EMITTER(f) emit_native_xtensa_##f
 #elif MICROPY_EMIT_XTENSAWIN
 #define NATIVE_EMITTER(f) emit_native_xtensawin_##f
+#elif MICROPY_EMIT_RV32
+#define NATIVE_EMITTER(f) emit_native_rv32_##f
 #else
 #error "unknown native emitter"
 #endif
@@ -135,6 +139,7 @@ STATIC const emit_inline_asm_method_table_t *emit_asm_table[] = {
     &emit_inline_thumb_method_table,
     &emit_inline_xtensa_method_table,
     NULL,
+    &emit_inline_rv32_method_table,
 };
 
 #elif MICROPY_EMIT_INLINE_ASM
@@ -145,6 +150,9 @@ STATIC const emit_inline_asm_method_table_t *emit_asm_table[] = {
 #elif MICROPY_EMIT_INLINE_XTENSA
 #define ASM_DECORATOR_QSTR MP_QSTR_asm_xtensa
 #define ASM_EMITTER(f) emit_inline_xtensa_##f
+#elif MICROPY_EMIT_INLINE_RV32
+#define ASM_DECORATOR_QSTR MP_QSTR_asm_rv32
+#define ASM_EMITTER(f) emit_inline_rv32_##f
 #else
 #error "unknown asm emitter"
 #endif
@@ -251,6 +259,7 @@ STATIC scope_t *scope_new_and_link(compiler_t *comp, scope_kind_t kind, mp_parse
             s = s->next;
         }
         s->next = scope;
+        MP_GC_WRITE_BARRIER(s);
     }
     return scope;
 }
@@ -269,8 +278,23 @@ STATIC void apply_to_single_or_list(compiler_t *comp, mp_parse_node_t pn, pn_kin
     }
 }
 
+// Whether the statement always leaves the block that it's in
+STATIC bool node_is_jump_stmt(mp_parse_node_t pn) {
+    return MP_PARSE_NODE_IS_STRUCT_KIND(pn, PN_return_stmt)
+           || MP_PARSE_NODE_IS_STRUCT_KIND(pn, PN_raise_stmt)
+           || MP_PARSE_NODE_IS_STRUCT_KIND(pn, PN_break_stmt)
+           || MP_PARSE_NODE_IS_STRUCT_KIND(pn, PN_continue_stmt);
+}
+
 STATIC void compile_generic_all_nodes(compiler_t *comp, mp_parse_node_struct_t *pns) {
     int num_nodes = MP_PARSE_NODE_STRUCT_NUM_NODES(pns);
+    // Statements after a return, raise, break or continue are never run so no code
+    // is emitted for them.  They are still scanned in the scope pass, eg so that a
+    // yield after a return still makes a generator.
+    bool is_stmts = comp->pass > MP_PASS_SCOPE
+        && (MP_PARSE_NODE_STRUCT_KIND(pns) == PN_suite_block_stmts
+            || MP_PARSE_NODE_STRUCT_KIND(pns) == PN_simple_stmt_2
+            || MP_PARSE_NODE_STRUCT_KIND(pns) == PN_file_input_2);
     for (int i = 0; i < num_nodes; i++) {
         compile_node(comp, pns->nodes[i]);
         if (comp->compile_error != MP_OBJ_NULL) {
@@ -278,6 +302,9 @@ STATIC void compile_generic_all_nodes(compiler_t *comp, mp_parse_node_struct_t *
             compile_error_set_line(comp, pns->nodes[i]);
             return;
         }
+        if (is_stmts && node_is_jump_stmt(pns->nodes[i])) {
+            break;
+        }
     }
 }
 
@@ -847,6 +874,8 @@ STATIC bool compile_built_in_decorator(compiler_t *comp, size_t name_len, mp_par
         *emit_options = MP_EMIT_OPT_ASM;
     } else if (attr == MP_QSTR_asm_xtensa) {
         *emit_options = MP_EMIT_OPT_ASM;
+    } else if (attr == MP_QSTR_asm_rv32) {
+        *emit_options = MP_EMIT_OPT_ASM;
     #else
     } else if (attr == ASM_DECORATOR_QSTR) {
         *emit_options = MP_EMIT_OPT_ASM;
@@ -1513,61 +1542,68 @@ STATIC void compile_for_stmt_optimised_range(compiler_t *comp, mp_parse_node_t p
     }
 }
 
+// Whether pn is a call to range() that a for loop over can be optimised as
+// above, and if so get the start, end and step of the range.
+STATIC bool compile_is_optimisable_range(mp_parse_node_t pn, mp_parse_node_t *pn_range_start, mp_parse_node_t *pn_range_end, mp_parse_node_t *pn_range_step) {
+    if (!MP_PARSE_NODE_IS_STRUCT_KIND(pn, PN_atom_expr_normal)) {
+        return false;
+    }
+    mp_parse_node_struct_t *pns_it = (mp_parse_node_struct_t *)pn;
+    if (!MP_PARSE_NODE_IS_ID(pns_it->nodes[0])
+        || MP_PARSE_NODE_LEAF_ARG(pns_it->nodes[0]) != MP_QSTR_range
+        || MP_PARSE_NODE_STRUCT_KIND((mp_parse_node_struct_t *)pns_it->nodes[1]) != PN_trailer_paren) {
+        return false;
+    }
+    mp_parse_node_t pn_range_args = ((mp_parse_node_struct_t *)pns_it->nodes[1])->nodes[0];
+    mp_parse_node_t *args;
+    size_t n_args = mp_parse_node_extract_list(&pn_range_args, PN_arglist, &args);
+    if (n_args == 1) {
+        *pn_range_start = mp_parse_node_new_small_int(0);
+        *pn_range_end = args[0];
+        *pn_range_step = mp_parse_node_new_small_int(1);
+    } else if (n_args == 2) {
+        *pn_range_start = args[0];
+        *pn_range_end = args[1];
+        *pn_range_step = mp_parse_node_new_small_int(1);
+    } else if (n_args == 3) {
+        *pn_range_start = args[0];
+        *pn_range_end = args[1];
+        *pn_range_step = args[2];
+        // the step must be a non-zero constant integer to do the optimisation
+        if (!MP_PARSE_NODE_IS_SMALL_INT(*pn_range_step)
+            || MP_PARSE_NODE_LEAF_SMALL_INT(*pn_range_step) == 0) {
+            return false;
+        }
+    } else {
+        return false;
+    }
+    // arguments must be able to be compiled as standard expressions
+    if (MP_PARSE_NODE_IS_STRUCT(*pn_range_start)) {
+        int k = MP_PARSE_NODE_STRUCT_KIND((mp_parse_node_struct_t *)*pn_range_start);
+        if (k == PN_arglist_star || k == PN_arglist_dbl_star || k == PN_argument) {
+            return false;
+        }
+    }
+    if (MP_PARSE_NODE_IS_STRUCT(*pn_range_end)) {
+        int k = MP_PARSE_NODE_STRUCT_KIND((mp_parse_node_struct_t *)*pn_range_end);
+        if (k == PN_arglist_star || k == PN_arglist_dbl_star || k == PN_argument) {
+            return false;
+        }
+    }
+    return true;
+}
+
 STATIC void compile_for_stmt(compiler_t *comp, mp_parse_node_struct_t *pns) {
     // this bit optimises: for <x> in range(...), turning it into an explicitly incremented variable
-    // this is actually slower, but uses no heap memory
+    // this uses no heap memory, and is faster with MICROPY_OPT_VM_SUPERINSTRUCTIONS
     // for viper it will be much, much faster
-    if (/*comp->scope_cur->emit_options == MP_EMIT_OPT_VIPER &&*/ MP_PARSE_NODE_IS_ID(pns->nodes[0]) && MP_PARSE_NODE_IS_STRUCT_KIND(pns->nodes[1], PN_atom_expr_normal)) {
-        mp_parse_node_struct_t *pns_it = (mp_parse_node_struct_t *)pns->nodes[1];
-        if (MP_PARSE_NODE_IS_ID(pns_it->nodes[0])
-            && MP_PARSE_NODE_LEAF_ARG(pns_it->nodes[0]) == MP_QSTR_range
-            && MP_PARSE_NODE_STRUCT_KIND((mp_parse_node_struct_t *)pns_it->nodes[1]) == PN_trailer_paren) {
-            mp_parse_node_t pn_range_args = ((mp_parse_node_struct_t *)pns_it->nodes[1])->nodes[0];
-            mp_parse_node_t *args;
-            size_t n_args = mp_parse_node_extract_list(&pn_range_args, PN_arglist, &args);
-            mp_parse_node_t pn_range_start;
-            mp_parse_node_t pn_range_end;
-            mp_parse_node_t pn_range_step;
-            bool optimize = false;
-            if (1 <= n_args && n_args <= 3) {
-                optimize = true;
-                if (n_args == 1) {
-                    pn_range_start = mp_parse_node_new_small_int(0);
-                    pn_range_end = args[0];
-                    pn_range_step = mp_parse_node_new_small_int(1);
-                } else if (n_args == 2) {
-                    pn_range_start = args[0];
-                    pn_range_end = args[1];
-                    pn_range_step = mp_parse_node_new_small_int(1);
-                } else {
-                    pn_range_start = args[0];
-                    pn_range_end = args[1];
-                    pn_range_step = args[2];
-                    // the step must be a non-zero constant integer to do the optimisation
-                    if (!MP_PARSE_NODE_IS_SMALL_INT(pn_range_step)
-                        || MP_PARSE_NODE_LEAF_SMALL_INT(pn_range_step) == 0) {
-                        optimize = false;
-                    }
-                }
-                // arguments must be able to be compiled as standard expressions
-                if (optimize && MP_PARSE_NODE_IS_STRUCT(pn_range_start)) {
-                    int k = MP_PARSE_NODE_STRUCT_KIND((mp_parse_node_struct_t *)pn_range_start);
-                    if (k == PN_arglist_star || k == PN_arglist_dbl_star || k == PN_argument) {
-                        optimize = false;
-                    }
-                }
-                if (optimize && MP_PARSE_NODE_IS_STRUCT(pn_range_end)) {
-                    int k = MP_PARSE_NODE_STRUCT_KIND((mp_parse_node_struct_t *)pn_range_end);
-                    if (k == PN_arglist_star || k == PN_arglist_dbl_star || k == PN_argument) {
-                        optimize = false;
-                    }
-                }
-            }
-            if (optimize) {
-                compile_for_stmt_optimised_range(comp, pns->nodes[0], pn_range_start, pn_range_end, pn_range_step, pns->nodes[2], pns->nodes[3]);
-                return;
-            }
-        }
+    mp_parse_node_t pn_range_start;
+    mp_parse_node_t pn_range_end;
+    mp_parse_node_t pn_range_step;
+    if (MP_PARSE_NODE_IS_ID(pns->nodes[0])
+        && compile_is_optimisable_range(pns->nodes[1], &pn_range_start, &pn_range_end, &pn_range_step)) {
+        compile_for_stmt_optimised_range(comp, pns->nodes[0], pn_range_start, pn_range_end, pn_range_step, pns->nodes[2], pns->nodes[3]);
+        return;
     }
 
     START_BREAK_CONTINUE_BLOCK
@@ -2451,6 +2487,16 @@ STATIC void compile_trailer_paren_helper(compiler_t *comp, mp_parse_node_t pn_ar
     }
 }
 
+#if MICROPY_COMP_RANGE_COMPREHENSION
+// Whether the first for loop of a comprehension is over range() and can be
+// optimised like a for statement, see MICROPY_COMP_RANGE_COMPREHENSION.
+STATIC bool compile_comprehension_is_range(scope_kind_t kind, mp_parse_node_struct_t *pns_comp_for, mp_parse_node_t *pn_range_start, mp_parse_node_t *pn_range_end, mp_parse_node_t *pn_range_step) {
+    return kind != SCOPE_GEN_EXPR
+           && MP_PARSE_NODE_IS_ID(pns_comp_for->nodes[0])
+           && compile_is_optimisable_range(pns_comp_for->nodes[1], pn_range_start, pn_range_end, pn_range_step);
+}
+#endif
+
 // pns needs to have 2 nodes, first is lhs of comprehension, second is PN_comp_for node
 STATIC void compile_comprehension(compiler_t *comp, mp_parse_node_struct_t *pns, scope_kind_t kind) {
     assert(MP_PARSE_NODE_STRUCT_NUM_NODES(pns) == 2);
@@ -2470,6 +2516,19 @@ STATIC void compile_comprehension(compiler_t *comp, mp_parse_node_struct_t *pns,
     // compile the comprehension
     close_over_variables_etc(comp, this_scope, 0, 0);
 
+    #if MICROPY_COMP_RANGE_COMPREHENSION
+    mp_parse_node_t pn_range_start;
+    mp_parse_node_t pn_range_end;
+    mp_parse_node_t pn_range_step;
+    if (compile_comprehension_is_range(kind, pns_comp_for, &pn_range_start, &pn_range_end, &pn_range_step)) {
+        // pass the start and end of the range instead of the iterable
+        compile_node(comp, pn_range_start);
+        compile_node(comp, pn_range_end);
+        EMIT_ARG(call_function, 2, 0, 0);
+        return;
+    }
+    #endif
+
     compile_node(comp, pns_comp_for->nodes[1]); // source of the iterator
     if (kind == SCOPE_GEN_EXPR) {
         EMIT_ARG(get_iter, false);
@@ -2969,14 +3028,13 @@ STATIC void compile_scope_lambda_param(compiler_t *comp, mp_parse_node_t pn) {
     compile_scope_func_lambda_param(comp, pn, PN_varargslist_name, PN_varargslist_star, PN_varargslist_dbl_star);
 }
 
-STATIC void compile_scope_comp_iter(compiler_t *comp, mp_parse_node_struct_t *pns_comp_for, mp_parse_node_t pn_inner_expr, int for_depth) {
-    uint l_top = comp_next_label(comp);
-    uint l_end = comp_next_label(comp);
-    EMIT_ARG(label_assign, l_top);
-    EMIT_ARG(for_iter, l_end);
-    c_assign(comp, pns_comp_for->nodes[0], ASSIGN_STORE);
-    mp_parse_node_t pn_iter = pns_comp_for->nodes[2];
+STATIC void compile_scope_comp_iter(compiler_t *comp, mp_parse_node_struct_t *pns_comp_for, mp_parse_node_t pn_inner_expr, int stack_depth);
 
+// Compile what follows the variable of a for loop in a comprehension: any if
+// conditions and nested for loops, then the inner expression.  stack_depth is
+// the number of stack entries used by the enclosing for loops, and l_continue
+// is where the innermost one continues from.
+STATIC void compile_scope_comp_body(compiler_t *comp, mp_parse_node_t pn_iter, mp_parse_node_t pn_inner_expr, int stack_depth, uint l_continue) {
 tail_recursion:
     if (MP_PARSE_NODE_IS_NULL(pn_iter)) {
         // no more nested if/for; compile inner expression
@@ -2986,12 +3044,12 @@ tail_recursion:
             reserve_labels_for_native(comp, 1);
             EMIT(pop_top);
         } else {
-            EMIT_ARG(store_comp, comp->scope_cur->kind, 4 * for_depth + 5);
+            EMIT_ARG(store_comp, comp->scope_cur->kind, stack_depth + 1);
         }
     } else if (MP_PARSE_NODE_STRUCT_KIND((mp_parse_node_struct_t *)pn_iter) == PN_comp_if) {
         // if condition
         mp_parse_node_struct_t *pns_comp_if = (mp_parse_node_struct_t *)pn_iter;
-        c_if_cond(comp, pns_comp_if->nodes[0], false, l_top);
+        c_if_cond(comp, pns_comp_if->nodes[0], false, l_continue);
         pn_iter = pns_comp_if->nodes[1];
         goto tail_recursion;
     } else {
@@ -3000,14 +3058,54 @@ tail_recursion:
         mp_parse_node_struct_t *pns_comp_for2 = (mp_parse_node_struct_t *)pn_iter;
         compile_node(comp, pns_comp_for2->nodes[1]);
         EMIT_ARG(get_iter, true);
-        compile_scope_comp_iter(comp, pns_comp_for2, pn_inner_expr, for_depth + 1);
+        compile_scope_comp_iter(comp, pns_comp_for2, pn_inner_expr, stack_depth);
     }
+}
 
+// The iterator of this for loop is on the stack, above stack_depth entries
+// used by enclosing loops.
+STATIC void compile_scope_comp_iter(compiler_t *comp, mp_parse_node_struct_t *pns_comp_for, mp_parse_node_t pn_inner_expr, int stack_depth) {
+    uint l_top = comp_next_label(comp);
+    uint l_end = comp_next_label(comp);
+    EMIT_ARG(label_assign, l_top);
+    EMIT_ARG(for_iter, l_end);
+    c_assign(comp, pns_comp_for->nodes[0], ASSIGN_STORE);
+    compile_scope_comp_body(comp, pns_comp_for->nodes[2], pn_inner_expr, stack_depth + MP_OBJ_ITER_BUF_NSLOTS, l_top);
     EMIT_ARG(jump, l_top);
     EMIT_ARG(label_assign, l_end);
     EMIT(for_iter_end);
 }
 
+#if MICROPY_COMP_RANGE_COMPREHENSION
+// The first for loop of a comprehension over range(), with the end value and
+// then the start value on the stack.  This is compiled in the same way as
+// compile_for_stmt_optimised_range, and leaves the stack as it was before.
+STATIC void compile_scope_comp_range(compiler_t *comp, mp_parse_node_struct_t *pns_comp_for, mp_parse_node_t pn_inner_expr, mp_parse_node_t pn_step) {
+    uint l_top = comp_next_label(comp);
+    uint l_continue = comp_next_label(comp);
+    uint l_entry = comp_next_label(comp);
+    EMIT_ARG(jump, l_entry);
+    EMIT_ARG(label_assign, l_top);
+    EMIT(dup_top);
+    c_assign(comp, pns_comp_for->nodes[0], ASSIGN_STORE);
+    compile_scope_comp_body(comp, pns_comp_for->nodes[2], pn_inner_expr, 2, l_continue);
+    EMIT_ARG(label_assign, l_continue);
+    compile_node(comp, pn_step);
+    EMIT_ARG(binary_op, MP_BINARY_OP_INPLACE_ADD);
+    EMIT_ARG(label_assign, l_entry);
+    EMIT(dup_top_two);
+    EMIT(rot_two);
+    if (MP_PARSE_NODE_LEAF_SMALL_INT(pn_step) >= 0) {
+        EMIT_ARG(binary_op, MP_BINARY_OP_LESS);
+    } else {
+        EMIT_ARG(binary_op, MP_BINARY_OP_MORE);
+    }
+    EMIT_ARG(pop_jump_if, true, l_top);
+    EMIT(pop_top);
+    EMIT(pop_top);
+}
+#endif
+
 STATIC void check_for_doc_string(compiler_t *comp, mp_parse_node_t pn) {
     #if MICROPY_ENABLE_DOC_STRING
     // see http://www.python.org/dev/peps/pep-0257/
@@ -3147,6 +3245,19 @@ STATIC void compile_scope(compiler_t *comp, scope_t *scope, pass_kind_t pass) {
             scope->num_pos_args = 1;
         }
 
+        #if MICROPY_COMP_RANGE_COMPREHENSION
+        // A loop over range() gets the start and end values as arguments
+        // instead, the end named by another qstr that can't be an identifier.
+        mp_parse_node_t pn_range_start;
+        mp_parse_node_t pn_range_end;
+        mp_parse_node_t pn_range_step;
+        bool is_range = compile_comprehension_is_range(scope->kind, pns_comp_for, &pn_range_start, &pn_range_end, &pn_range_step);
+        if (is_range && comp->pass == MP_PASS_SCOPE) {
+            scope_find_or_add_id(comp->scope_cur, MP_QSTR__star_, ID_INFO_KIND_LOCAL);
+            scope->num_pos_args = 2;
+        }
+        #endif
+
         // Set the source line number for the start of the comprehension
         EMIT_ARG(set_source_line, pns->source_line);
 
@@ -3168,12 +3279,24 @@ STATIC void compile_scope(compiler_t *comp, scope_t *scope, pass_kind_t pass) {
             compile_load_id(comp, qstr_arg);
             EMIT(load_null);
             EMIT(load_null);
+        #if MICROPY_COMP_RANGE_COMPREHENSION
+        } else if (is_range) {
+            compile_load_id(comp, MP_QSTR__star_);
+            compile_load_id(comp, qstr_arg);
+        #endif
         } else {
             compile_load_id(comp, qstr_arg);
             EMIT_ARG(get_iter, true);
         }
 
-        compile_scope_comp_iter(comp, pns_comp_for, pns->nodes[0], 0);
+        #if MICROPY_COMP_RANGE_COMPREHENSION
+        if (is_range) {
+            compile_scope_comp_range(comp, pns_comp_for, pns->nodes[0], pn_range_step);
+        } else
+        #endif
+        {
+            compile_scope_comp_iter(comp, pns_comp_for, pns->nodes[0], 0);
+        }
 
         if (scope->kind == SCOPE_GEN_EXPR) {
             EMIT_ARG(load_const_tok, MP_TOKEN_KW_NONE);
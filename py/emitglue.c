@@ -34,7 +34,9 @@
 #include "py/emitglue.h"
 #include "py/runtime0.h"
 #include "py/bc.h"
+#include "py/gc.h"
 #include "py/profile.h"
+#include "py/persistentcode.h"
 
 #if MICROPY_DEBUG_VERBOSE // print debugging info
 #define DEBUG_PRINT (1)
@@ -78,6 +80,7 @@ void mp_emit_glue_assign_bytecode(mp_raw_code_t *rc, const byte *code,
     rc->n_obj = n_obj;
     rc->n_raw_code = n_raw_code;
     #endif
+    MP_GC_WRITE_BARRIER(rc);
 
     #if MICROPY_PY_SYS_SETTRACE
     mp_bytecode_prelude_t *prelude = &rc->prelude;
@@ -123,6 +126,7 @@ void mp_emit_glue_assign_native(mp_raw_code_t *rc, mp_raw_code_kind_t kind, void
     rc->n_qstr = n_qstr;
     rc->qstr_link = qstr_link;
     #endif
+    MP_GC_WRITE_BARRIER(rc);
 
     #ifdef DEBUG_PRINT
     DEBUG_printf("assign native: kind=%d fun=%p len=" UINT_FMT " n_pos_args=" UINT_FMT " flags=%x\n", kind, fun_data, fun_len, n_pos_args, (uint)scope_flags);
@@ -155,6 +159,13 @@ mp_obj_t mp_make_function_from_raw_code(const mp_raw_code_t *rc, mp_obj_t def_ar
     // def_kw_args must be MP_OBJ_NULL or a dict
     assert(def_kw_args == MP_OBJ_NULL || mp_obj_is_type(def_kw_args, &mp_type_dict));
 
+    #if MICROPY_PERSISTENT_CODE_LOAD_LAZY
+    if (rc->kind == MP_CODE_LAZY) {
+        // load the function from its .mpy file the first time it's made
+        mp_raw_code_load_lazy((mp_raw_code_t *)rc);
+    }
+    #endif
+
     // make the function, depending on the raw code kind
     mp_obj_t fun;
     switch (rc->kind) {
@@ -47,6 +47,7 @@ typedef enum {
     MP_CODE_NATIVE_PY,
     MP_CODE_NATIVE_VIPER,
     MP_CODE_NATIVE_ASM,
+    MP_CODE_LAZY, // not loaded yet, see mp_raw_code_load_lazy
 } mp_raw_code_kind_t;
 
 typedef struct _mp_qstr_link_entry_t {
@@ -64,6 +65,7 @@ typedef struct _mp_raw_code_t {
     size_t fun_data_len;
     uint16_t n_obj;
     uint16_t n_raw_code;
+    uint8_t scope_kind; // of type scope_kind_t, used to pick the children that are saved to load lazily
     #if MICROPY_PY_SYS_SETTRACE
     mp_bytecode_prelude_t prelude;
     // line_of_definition is a Python source line where the raw_code was
@@ -0,0 +1,410 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <assert.h>
+
+#include "py/emit.h"
+#include "py/asmrv32.h"
+
+#if MICROPY_EMIT_INLINE_RV32
+
+struct _emit_inline_asm_t {
+    asm_rv32_t as;
+    uint16_t pass;
+    mp_obj_t *error_slot;
+    mp_uint_t max_num_labels;
+    qstr *label_lookup;
+};
+
+STATIC void emit_inline_rv32_error_msg(emit_inline_asm_t *emit, mp_rom_error_text_t msg) {
+    *emit->error_slot = mp_obj_new_exception_msg(&mp_type_SyntaxError, msg);
+}
+
+STATIC void emit_inline_rv32_error_exc(emit_inline_asm_t *emit, mp_obj_t exc) {
+    *emit->error_slot = exc;
+}
+
+emit_inline_asm_t *emit_inline_rv32_new(mp_uint_t max_num_labels) {
+    emit_inline_asm_t *emit = m_new_obj(emit_inline_asm_t);
+    memset(&emit->as, 0, sizeof(emit->as));
+    mp_asm_base_init(&emit->as.base, max_num_labels);
+    emit->max_num_labels = max_num_labels;
+    emit->label_lookup = m_new(qstr, max_num_labels);
+    return emit;
+}
+
+void emit_inline_rv32_free(emit_inline_asm_t *emit) {
+    m_del(qstr, emit->label_lookup, emit->max_num_labels);
+    mp_asm_base_deinit(&emit->as.base, false);
+    m_del_obj(emit_inline_asm_t, emit);
+}
+
+STATIC void emit_inline_rv32_start_pass(emit_inline_asm_t *emit, pass_kind_t pass, mp_obj_t *error_slot) {
+    emit->pass = pass;
+    emit->error_slot = error_slot;
+    if (emit->pass == MP_PASS_CODE_SIZE) {
+        memset(emit->label_lookup, 0, emit->max_num_labels * sizeof(qstr));
+    }
+    mp_asm_base_start_pass(&emit->as.base, pass == MP_PASS_EMIT ? MP_ASM_PASS_EMIT : MP_ASM_PASS_COMPUTE);
+    asm_rv32_entry(&emit->as, 0);
+}
+
+STATIC void emit_inline_rv32_end_pass(emit_inline_asm_t *emit, mp_uint_t type_sig) {
+    asm_rv32_exit(&emit->as);
+    asm_rv32_end_pass(&emit->as);
+}
+
+STATIC mp_uint_t emit_inline_rv32_count_params(emit_inline_asm_t *emit, mp_uint_t n_params, mp_parse_node_t *pn_params) {
+    if (n_params > 4) {
+        emit_inline_rv32_error_msg(emit, MP_ERROR_TEXT("can only have up to 4 parameters to RISC-V assembly"));
+        return 0;
+    }
+    for (mp_uint_t i = 0; i < n_params; i++) {
+        if (!MP_PARSE_NODE_IS_ID(pn_params[i])) {
+            emit_inline_rv32_error_msg(emit, MP_ERROR_TEXT("parameters must be registers in sequence a0 to a3"));
+            return 0;
+        }
+        const char *p = qstr_str(MP_PARSE_NODE_LEAF_ARG(pn_params[i]));
+        if (!(strlen(p) == 2 && p[0] == 'a' && (mp_uint_t)p[1] == '0' + i)) {
+            emit_inline_rv32_error_msg(emit, MP_ERROR_TEXT("parameters must be registers in sequence a0 to a3"));
+            return 0;
+        }
+    }
+    return n_params;
+}
+
+STATIC bool emit_inline_rv32_label(emit_inline_asm_t *emit, mp_uint_t label_num, qstr label_id) {
+    assert(label_num < emit->max_num_labels);
+    if (emit->pass == MP_PASS_CODE_SIZE) {
+        // check for duplicate label on first pass
+        for (uint i = 0; i < emit->max_num_labels; i++) {
+            if (emit->label_lookup[i] == label_id) {
+                return false;
+            }
+        }
+    }
+    emit->label_lookup[label_num] = label_id;
+    mp_asm_base_label_assign(&emit->as.base, label_num);
+    return true;
+}
+
+typedef struct _reg_name_t { byte reg;
+                             byte name[4];
+} reg_name_t;
+STATIC const reg_name_t reg_name_table[] = {
+    {0, "zero"},
+    {1, "ra\0\0"},
+    {2, "sp\0\0"},
+    {3, "gp\0\0"},
+    {4, "tp\0\0"},
+    {5, "t0\0\0"},
+    {6, "t1\0\0"},
+    {7, "t2\0\0"},
+    {8, "s0\0\0"},
+    {8, "fp\0\0"},
+    {9, "s1\0\0"},
+    {10, "a0\0\0"},
+    {11, "a1\0\0"},
+    {12, "a2\0\0"},
+    {13, "a3\0\0"},
+    {14, "a4\0\0"},
+    {15, "a5\0\0"},
+    {16, "a6\0\0"},
+    {17, "a7\0\0"},
+    {18, "s2\0\0"},
+    {19, "s3\0\0"},
+    {20, "s4\0\0"},
+    {21, "s5\0\0"},
+    {22, "s6\0\0"},
+    {23, "s7\0\0"},
+    {24, "s8\0\0"},
+    {25, "s9\0\0"},
+    {26, "s10\0"},
+    {27, "s11\0"},
+    {28, "t3\0\0"},
+    {29, "t4\0\0"},
+    {30, "t5\0\0"},
+    {31, "t6\0\0"},
+};
+
+// return empty string in case of error, so we can attempt to parse the string
+// without a special check if it was in fact a string
+STATIC const char *get_arg_str(mp_parse_node_t pn) {
+    if (MP_PARSE_NODE_IS_ID(pn)) {
+        qstr qst = MP_PARSE_NODE_LEAF_ARG(pn);
+        return qstr_str(qst);
+    } else {
+        return "";
+    }
+}
+
+STATIC mp_uint_t get_arg_reg(emit_inline_asm_t *emit, const char *op, mp_parse_node_t pn) {
+    const char *reg_str = get_arg_str(pn);
+    if (strlen(reg_str) <= 4) {
+        for (mp_uint_t i = 0; i < MP_ARRAY_SIZE(reg_name_table); i++) {
+            const reg_name_t *r = &reg_name_table[i];
+            if (strncmp(reg_str, (const char *)r->name, 4) == 0) {
+                return r->reg;
+            }
+        }
+    }
+    emit_inline_rv32_error_exc(emit,
+        mp_obj_new_exception_msg_varg(&mp_type_SyntaxError,
+            MP_ERROR_TEXT("'%s' expects a register"), op));
+    return 0;
+}
+
+STATIC uint32_t get_arg_i(emit_inline_asm_t *emit, const char *op, mp_parse_node_t pn, int min, int max) {
+    mp_obj_t o;
+    if (!mp_parse_node_get_int_maybe(pn, &o)) {
+        emit_inline_rv32_error_exc(emit, mp_obj_new_exception_msg_varg(&mp_type_SyntaxError, MP_ERROR_TEXT("'%s' expects an integer"), op));
+        return 0;
+    }
+    uint32_t i = mp_obj_get_int_truncated(o);
+    if (min != max && ((int)i < min || (int)i > max)) {
+        emit_inline_rv32_error_exc(emit, mp_obj_new_exception_msg_varg(&mp_type_SyntaxError, MP_ERROR_TEXT("'%s' integer %d isn't within range %d..%d"), op, i, min, max));
+        return 0;
+    }
+    return i;
+}
+
+STATIC int get_arg_label(emit_inline_asm_t *emit, const char *op, mp_parse_node_t pn) {
+    if (!MP_PARSE_NODE_IS_ID(pn)) {
+        emit_inline_rv32_error_exc(emit, mp_obj_new_exception_msg_varg(&mp_type_SyntaxError, MP_ERROR_TEXT("'%s' expects a label"), op));
+        return 0;
+    }
+    qstr label_qstr = MP_PARSE_NODE_LEAF_ARG(pn);
+    for (uint i = 0; i < emit->max_num_labels; i++) {
+        if (emit->label_lookup[i] == label_qstr) {
+            return i;
+        }
+    }
+    // only need to have the labels on the last pass
+    if (emit->pass == MP_PASS_EMIT) {
+        emit_inline_rv32_error_exc(emit, mp_obj_new_exception_msg_varg(&mp_type_SyntaxError, MP_ERROR_TEXT("label '%q' not defined"), label_qstr));
+    }
+    return -1;
+}
+
+STATIC void emit_inline_rv32_j_label(emit_inline_asm_t *emit, int label) {
+    if (label < 0) {
+        // forward label not seen yet in this pass, reserve space for the jump
+        asm_rv32_op_jal(&emit->as, ASM_RV32_REG_X0, 0);
+    } else {
+        asm_rv32_j_label(&emit->as, label);
+    }
+}
+
+STATIC void emit_inline_rv32_bcc_label(emit_inline_asm_t *emit, uint cond, uint rs1, uint rs2, int label) {
+    if (label < 0) {
+        // forward label not seen yet in this pass, reserve space for the long form
+        asm_rv32_op_bcc(&emit->as, cond ^ 1, rs1, rs2, 8);
+        asm_rv32_op_jal(&emit->as, ASM_RV32_REG_X0, 0);
+    } else {
+        asm_rv32_bcc_reg_reg_label(&emit->as, cond, rs1, rs2, label);
+    }
+}
+
+#define RTYPE (0)
+#define ITYPE (1)
+#define ITYPE_SHIFT (2)
+#define LOAD (3)
+#define STORE (4)
+#define BTYPE (5)
+
+typedef struct _opcode_table_3arg_t {
+    uint16_t name; // actually a qstr, which should fit in 16 bits
+    uint8_t type : 4;
+    uint8_t funct3 : 4;
+    uint8_t funct7;
+} opcode_table_3arg_t;
+
+STATIC const opcode_table_3arg_t opcode_table_3arg[] = {
+    // arithmetic opcodes: reg, reg, reg
+    {MP_QSTR_add, RTYPE, 0, 0x00},
+    {MP_QSTR_sub, RTYPE, 0, 0x20},
+    {MP_QSTR_sll, RTYPE, 1, 0x00},
+    {MP_QSTR_slt, RTYPE, 2, 0x00},
+    {MP_QSTR_sltu, RTYPE, 3, 0x00},
+    {MP_QSTR_xor, RTYPE, 4, 0x00},
+    {MP_QSTR_srl, RTYPE, 5, 0x00},
+    {MP_QSTR_sra, RTYPE, 5, 0x20},
+    {MP_QSTR_or_, RTYPE, 6, 0x00},
+    {MP_QSTR_and_, RTYPE, 7, 0x00},
+
+    // multiply and divide opcodes (M extension): reg, reg, reg
+    {MP_QSTR_mul, RTYPE, 0, 0x01},
+    {MP_QSTR_mulh, RTYPE, 1, 0x01},
+    {MP_QSTR_mulhsu, RTYPE, 2, 0x01},
+    {MP_QSTR_mulhu, RTYPE, 3, 0x01},
+    {MP_QSTR_div, RTYPE, 4, 0x01},
+    {MP_QSTR_divu, RTYPE, 5, 0x01},
+    {MP_QSTR_rem, RTYPE, 6, 0x01},
+    {MP_QSTR_remu, RTYPE, 7, 0x01},
+
+    // immediate opcodes: reg, reg, imm
+    {MP_QSTR_addi, ITYPE, 0, 0},
+    {MP_QSTR_slti, ITYPE, 2, 0},
+    {MP_QSTR_sltiu, ITYPE, 3, 0},
+    {MP_QSTR_xori, ITYPE, 4, 0},
+    {MP_QSTR_ori, ITYPE, 6, 0},
+    {MP_QSTR_andi, ITYPE, 7, 0},
+    {MP_QSTR_slli, ITYPE_SHIFT, 1, 0x00},
+    {MP_QSTR_srli, ITYPE_SHIFT, 5, 0x00},
+    {MP_QSTR_srai, ITYPE_SHIFT, 5, 0x20},
+
+    // load/store opcodes: reg, base reg, offset
+    {MP_QSTR_lb, LOAD, 0, 0},
+    {MP_QSTR_lh, LOAD, 1, 0},
+    {MP_QSTR_lw, LOAD, 2, 0},
+    {MP_QSTR_lbu, LOAD, 4, 0},
+    {MP_QSTR_lhu, LOAD, 5, 0},
+    {MP_QSTR_sb, STORE, 0, 0},
+    {MP_QSTR_sh, STORE, 1, 0},
+    {MP_QSTR_sw, STORE, 2, 0},
+
+    // branch opcodes: reg, reg, label
+    {MP_QSTR_beq, BTYPE, ASM_RV32_CC_EQ, 0},
+    {MP_QSTR_bne, BTYPE, ASM_RV32_CC_NE, 0},
+    {MP_QSTR_blt, BTYPE, ASM_RV32_CC_LT, 0},
+    {MP_QSTR_bge, BTYPE, ASM_RV32_CC_GE, 0},
+    {MP_QSTR_bltu, BTYPE, ASM_RV32_CC_LTU, 0},
+    {MP_QSTR_bgeu, BTYPE, ASM_RV32_CC_GEU, 0},
+};
+
+STATIC void emit_inline_rv32_op(emit_inline_asm_t *emit, qstr op, mp_uint_t n_args, mp_parse_node_t *pn_args) {
+    size_t op_len;
+    const char *op_str = (const char *)qstr_data(op, &op_len);
+
+    if (n_args == 0) {
+        if (op == MP_QSTR_nop) {
+            asm_rv32_op_addi(&emit->as, ASM_RV32_REG_X0, ASM_RV32_REG_X0, 0);
+        } else {
+            goto unknown_op;
+        }
+
+    } else if (n_args == 1) {
+        if (op == MP_QSTR_j) {
+            int label = get_arg_label(emit, op_str, pn_args[0]);
+            emit_inline_rv32_j_label(emit, label);
+        } else if (op == MP_QSTR_jr) {
+            uint r0 = get_arg_reg(emit, op_str, pn_args[0]);
+            asm_rv32_op_jalr(&emit->as, ASM_RV32_REG_X0, r0, 0);
+        } else if (op == MP_QSTR_jalr) {
+            // ra is saved on entry, so the callee can return to here
+            uint r0 = get_arg_reg(emit, op_str, pn_args[0]);
+            asm_rv32_op_jalr(&emit->as, ASM_RV32_REG_RA, r0, 0);
+        } else {
+            goto unknown_op;
+        }
+
+    } else if (n_args == 2) {
+        uint r0 = get_arg_reg(emit, op_str, pn_args[0]);
+        if (op == MP_QSTR_beqz) {
+            int label = get_arg_label(emit, op_str, pn_args[1]);
+            emit_inline_rv32_bcc_label(emit, ASM_RV32_CC_EQ, r0, ASM_RV32_REG_X0, label);
+        } else if (op == MP_QSTR_bnez) {
+            int label = get_arg_label(emit, op_str, pn_args[1]);
+            emit_inline_rv32_bcc_label(emit, ASM_RV32_CC_NE, r0, ASM_RV32_REG_X0, label);
+        } else if (op == MP_QSTR_mv) {
+            uint r1 = get_arg_reg(emit, op_str, pn_args[1]);
+            asm_rv32_op_mv(&emit->as, r0, r1);
+        } else if (op == MP_QSTR_neg) {
+            uint r1 = get_arg_reg(emit, op_str, pn_args[1]);
+            asm_rv32_op_sub(&emit->as, r0, ASM_RV32_REG_X0, r1);
+        } else if (op == MP_QSTR_not_) {
+            uint r1 = get_arg_reg(emit, op_str, pn_args[1]);
+            asm_rv32_op_xori(&emit->as, r0, r1, -1);
+        } else if (op == MP_QSTR_li) {
+            // for convenience we emit lui and addi if the integer doesn't fit in addi
+            uint32_t imm = get_arg_i(emit, op_str, pn_args[1], 0, 0);
+            asm_rv32_mov_reg_i32_optimised(&emit->as, r0, imm);
+        } else if (op == MP_QSTR_lui) {
+            uint32_t imm = get_arg_i(emit, op_str, pn_args[1], 0, 0xfffff);
+            asm_rv32_op_lui(&emit->as, r0, imm);
+        } else {
+            goto unknown_op;
+        }
+
+    } else if (n_args == 3) {
+        // search table for 3 arg instructions
+        for (uint i = 0; i < MP_ARRAY_SIZE(opcode_table_3arg); i++) {
+            const opcode_table_3arg_t *o = &opcode_table_3arg[i];
+            if (op == o->name) {
+                uint r0 = get_arg_reg(emit, op_str, pn_args[0]);
+                uint r1 = get_arg_reg(emit, op_str, pn_args[1]);
+                if (o->type == RTYPE) {
+                    uint r2 = get_arg_reg(emit, op_str, pn_args[2]);
+                    asm_rv32_op_r(&emit->as, o->funct3, o->funct7, r0, r1, r2);
+                } else if (o->type == BTYPE) {
+                    int label = get_arg_label(emit, op_str, pn_args[2]);
+                    emit_inline_rv32_bcc_label(emit, o->funct3, r0, r1, label);
+                } else if (o->type == ITYPE_SHIFT) {
+                    uint32_t imm = get_arg_i(emit, op_str, pn_args[2], 0, 31);
+                    asm_rv32_op_imm(&emit->as, o->funct3, r0, r1, o->funct7 << 5 | imm);
+                } else {
+                    uint32_t imm = get_arg_i(emit, op_str, pn_args[2], -2048, 2047);
+                    if (o->type == ITYPE) {
+                        asm_rv32_op_imm(&emit->as, o->funct3, r0, r1, imm);
+                    } else if (o->type == LOAD) {
+                        asm_rv32_op_load(&emit->as, o->funct3, r0, r1, imm);
+                    } else {
+                        asm_rv32_op_store(&emit->as, o->funct3, r0, r1, imm);
+                    }
+                }
+                return;
+            }
+        }
+        goto unknown_op;
+
+    } else {
+        goto unknown_op;
+    }
+
+    return;
+
+unknown_op:
+    emit_inline_rv32_error_exc(emit, mp_obj_new_exception_msg_varg(&mp_type_SyntaxError, MP_ERROR_TEXT("unsupported RISC-V instruction '%s' with %d arguments"), op_str, n_args));
+}
+
+const emit_inline_asm_method_table_t emit_inline_rv32_method_table = {
+    #if MICROPY_DYNAMIC_COMPILER
+    emit_inline_rv32_new,
+    emit_inline_rv32_free,
+    #endif
+
+    emit_inline_rv32_start_pass,
+    emit_inline_rv32_end_pass,
+    emit_inline_rv32_count_params,
+    emit_inline_rv32_label,
+    emit_inline_rv32_op,
+};
+
+#endif // MICROPY_EMIT_INLINE_RV32
@@ -201,6 +201,37 @@ STATIC int get_arg_label(emit_inline_asm_t *emit, const char *op, mp_parse_node_
 #define RRI8 (1)
 #define RRI8_B (2)
 
+// MAC16 multiplies of two address registers, the index is op1 of the encoding
+STATIC const uint16_t mac16_aa_table[16] = {
+    MP_QSTR_umul_aa_ll, MP_QSTR_umul_aa_hl, MP_QSTR_umul_aa_lh, MP_QSTR_umul_aa_hh,
+    MP_QSTR_mul_aa_ll, MP_QSTR_mul_aa_hl, MP_QSTR_mul_aa_lh, MP_QSTR_mul_aa_hh,
+    MP_QSTR_mula_aa_ll, MP_QSTR_mula_aa_hl, MP_QSTR_mula_aa_lh, MP_QSTR_mula_aa_hh,
+    MP_QSTR_muls_aa_ll, MP_QSTR_muls_aa_hl, MP_QSTR_muls_aa_lh, MP_QSTR_muls_aa_hh,
+};
+
+// Emit a zero-overhead loop instruction of the given kind (8=loop, 9=loopnez,
+// 10=loopgtz), that repeats the code up to the label reg times.
+STATIC void emit_inline_xtensa_loop(emit_inline_asm_t *emit, uint kind, uint reg, int label) {
+    // pad with nop.n and nop so the loop body starts on a word boundary
+    mp_uint_t off = emit->as.base.code_offset;
+    if (off & 1) {
+        if ((off & 3) == 3) {
+            asm_xtensa_op16(&emit->as, 0xf03d); // nop.n
+        }
+    } else {
+        if ((off & 3) == 0) {
+            asm_xtensa_op16(&emit->as, 0xf03d); // nop.n
+        }
+        asm_xtensa_op24(&emit->as, 0x0020f0); // nop
+    }
+    uint32_t dest = emit->as.base.label_offsets[label];
+    int32_t rel = dest - emit->as.base.code_offset - 4;
+    if (emit->pass == MP_PASS_EMIT && (rel < 0 || rel > 255)) {
+        emit_inline_xtensa_error_msg(emit, MP_ERROR_TEXT("loop end not in range"));
+    }
+    asm_xtensa_op24(&emit->as, ASM_XTENSA_ENCODE_BRI8(6, kind, reg, 1, 3, rel & 0xff));
+}
+
 typedef struct _opcode_table_3arg_t {
     uint16_t name; // actually a qstr, which should fit in 16 bits
     uint8_t type;
@@ -214,8 +245,28 @@ STATIC const opcode_table_3arg_t opcode_table_3arg[] = {
     {MP_QSTR_or_, RRR, 0, 2},
     {MP_QSTR_xor, RRR, 0, 3},
     {MP_QSTR_add, RRR, 0, 8},
+    {MP_QSTR_addx2, RRR, 0, 9},
+    {MP_QSTR_addx4, RRR, 0, 10},
+    {MP_QSTR_addx8, RRR, 0, 11},
     {MP_QSTR_sub, RRR, 0, 12},
+    {MP_QSTR_subx2, RRR, 0, 13},
+    {MP_QSTR_subx4, RRR, 0, 14},
+    {MP_QSTR_subx8, RRR, 0, 15},
     {MP_QSTR_mull, RRR, 2, 8},
+    {MP_QSTR_muluh, RRR, 2, 10},
+    {MP_QSTR_mulsh, RRR, 2, 11},
+    {MP_QSTR_quou, RRR, 2, 12},
+    {MP_QSTR_quos, RRR, 2, 13},
+    {MP_QSTR_remu, RRR, 2, 14},
+    {MP_QSTR_rems, RRR, 2, 15},
+    {MP_QSTR_min, RRR, 3, 4},
+    {MP_QSTR_max, RRR, 3, 5},
+    {MP_QSTR_minu, RRR, 3, 6},
+    {MP_QSTR_maxu, RRR, 3, 7},
+    {MP_QSTR_moveqz, RRR, 3, 8},
+    {MP_QSTR_movnez, RRR, 3, 9},
+    {MP_QSTR_movltz, RRR, 3, 10},
+    {MP_QSTR_movgez, RRR, 3, 11},
 
     // load/store/addi opcodes: reg, reg, imm
     // upper nibble of type encodes the range of the immediate arg
@@ -263,6 +314,9 @@ STATIC void emit_inline_xtensa_op(emit_inline_asm_t *emit, qstr op, mp_uint_t n_
         } else if (op == MP_QSTR_jx) {
             uint r0 = get_arg_reg(emit, op_str, pn_args[0]);
             asm_xtensa_op_jx(&emit->as, r0);
+        } else if (op == MP_QSTR_ssl || op == MP_QSTR_ssr) {
+            uint r0 = get_arg_reg(emit, op_str, pn_args[0]);
+            asm_xtensa_op24(&emit->as, ASM_XTENSA_ENCODE_RRR(0, 0, 4, op == MP_QSTR_ssl, r0, 0));
         } else {
             goto unknown_op;
         }
@@ -275,6 +329,34 @@ STATIC void emit_inline_xtensa_op(emit_inline_asm_t *emit, qstr op, mp_uint_t n_
         } else if (op == MP_QSTR_bnez) {
             int label = get_arg_label(emit, op_str, pn_args[1]);
             asm_xtensa_bccz_reg_label(&emit->as, ASM_XTENSA_CCZ_NE, r0, label);
+        } else if (op == MP_QSTR_bltz) {
+            int label = get_arg_label(emit, op_str, pn_args[1]);
+            asm_xtensa_bccz_reg_label(&emit->as, ASM_XTENSA_CCZ_LT, r0, label);
+        } else if (op == MP_QSTR_bgez) {
+            int label = get_arg_label(emit, op_str, pn_args[1]);
+            asm_xtensa_bccz_reg_label(&emit->as, ASM_XTENSA_CCZ_GE, r0, label);
+        } else if (op == MP_QSTR_loop) {
+            int label = get_arg_label(emit, op_str, pn_args[1]);
+            emit_inline_xtensa_loop(emit, 8, r0, label);
+        } else if (op == MP_QSTR_loopnez) {
+            int label = get_arg_label(emit, op_str, pn_args[1]);
+            emit_inline_xtensa_loop(emit, 9, r0, label);
+        } else if (op == MP_QSTR_loopgtz) {
+            int label = get_arg_label(emit, op_str, pn_args[1]);
+            emit_inline_xtensa_loop(emit, 10, r0, label);
+        } else if (op == MP_QSTR_neg || op == MP_QSTR_abs_) {
+            uint r1 = get_arg_reg(emit, op_str, pn_args[1]);
+            asm_xtensa_op24(&emit->as, ASM_XTENSA_ENCODE_RRR(0, 0, 6, r0, op == MP_QSTR_abs_, r1));
+        } else if (op == MP_QSTR_sll) {
+            uint r1 = get_arg_reg(emit, op_str, pn_args[1]);
+            asm_xtensa_op24(&emit->as, ASM_XTENSA_ENCODE_RRR(0, 1, 10, r0, r1, 0));
+        } else if (op == MP_QSTR_srl || op == MP_QSTR_sra) {
+            uint r1 = get_arg_reg(emit, op_str, pn_args[1]);
+            asm_xtensa_op24(&emit->as, ASM_XTENSA_ENCODE_RRR(0, 1, op == MP_QSTR_srl ? 9 : 11, r0, 0, r1));
+        } else if (op == MP_QSTR_rsr || op == MP_QSTR_wsr) {
+            // special register number, eg 16 for ACCLO and 17 for ACCHI
+            uint32_t sr = get_arg_i(emit, op_str, pn_args[1], 0, 255);
+            asm_xtensa_op24(&emit->as, ASM_XTENSA_ENCODE_RSR(0, 3, op == MP_QSTR_wsr, sr, r0));
         } else if (op == MP_QSTR_mov || op == MP_QSTR_mov_n) {
             // we emit mov.n for both "mov" and "mov_n" opcodes
             uint r1 = get_arg_reg(emit, op_str, pn_args[1]);
@@ -284,10 +366,34 @@ STATIC void emit_inline_xtensa_op(emit_inline_asm_t *emit, qstr op, mp_uint_t n_
             uint32_t imm = get_arg_i(emit, op_str, pn_args[1], 0, 0);
             asm_xtensa_mov_reg_i32(&emit->as, r0, imm);
         } else {
+            // MAC16 multiply of two registers into the accumulator
+            for (uint i = 0; i < MP_ARRAY_SIZE(mac16_aa_table); i++) {
+                if (op == mac16_aa_table[i]) {
+                    uint r1 = get_arg_reg(emit, op_str, pn_args[1]);
+                    asm_xtensa_op24(&emit->as, ASM_XTENSA_ENCODE_RRR(4, i, 7, 0, r0, r1));
+                    return;
+                }
+            }
             goto unknown_op;
         }
 
     } else if (n_args == 3) {
+        if (op == MP_QSTR_slli || op == MP_QSTR_srai || op == MP_QSTR_srli) {
+            uint r0 = get_arg_reg(emit, op_str, pn_args[0]);
+            uint r1 = get_arg_reg(emit, op_str, pn_args[1]);
+            if (op == MP_QSTR_slli) {
+                uint32_t sa = 32 - get_arg_i(emit, op_str, pn_args[2], 1, 31);
+                asm_xtensa_op24(&emit->as, ASM_XTENSA_ENCODE_RRR(0, 1, sa >> 4, r0, r1, sa & 15));
+            } else if (op == MP_QSTR_srai) {
+                uint32_t sa = get_arg_i(emit, op_str, pn_args[2], 0, 31);
+                asm_xtensa_op24(&emit->as, ASM_XTENSA_ENCODE_RRR(0, 1, 2 | sa >> 4, r0, sa & 15, r1));
+            } else {
+                uint32_t sa = get_arg_i(emit, op_str, pn_args[2], 0, 15);
+                asm_xtensa_op24(&emit->as, ASM_XTENSA_ENCODE_RRR(0, 1, 4, r0, sa, r1));
+            }
+            return;
+        }
+
         // search table for 3 arg instructions
         for (uint i = 0; i < MP_ARRAY_SIZE(opcode_table_3arg); i++) {
             const opcode_table_3arg_t *o = &opcode_table_3arg[i];
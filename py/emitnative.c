@@ -58,7 +58,7 @@
 #endif
 
 // wrapper around everything in this file
-#if N_X64 || N_X86 || N_THUMB || N_ARM || N_XTENSA || N_XTENSAWIN
+#if N_X64 || N_X86 || N_THUMB || N_ARM || N_XTENSA || N_XTENSAWIN || N_RV32
 
 // C stack layout for native functions:
 //  0:                          nlr_buf_t [optional]
@@ -79,7 +79,7 @@
 //  emit->code_state_start:     fun_obj, old_globals [optional]
 //  emit->stack_start:          Python object stack             | emit->n_state
 //                              locals (reversed, L0 at end)    |
-//                              (L0-L2 may be in regs instead)
+//                              (up to 3 locals may be in regs instead)
 
 // Native emitter needs to know the following sizes and offsets of C structs (on the target):
 #if MICROPY_DYNAMIC_COMPILER
@@ -154,13 +154,32 @@ typedef enum {
     VTYPE_PTR8 = 0x00 | MP_NATIVE_TYPE_PTR8,
     VTYPE_PTR16 = 0x00 | MP_NATIVE_TYPE_PTR16,
     VTYPE_PTR32 = 0x00 | MP_NATIVE_TYPE_PTR32,
+    VTYPE_PTR32F = 0x00 | MP_NATIVE_TYPE_PTR32F,
 
     VTYPE_PTR_NONE = 0x50 | MP_NATIVE_TYPE_PTR,
 
     VTYPE_UNBOUND = 0x60 | MP_NATIVE_TYPE_OBJ,
     VTYPE_BUILTIN_CAST = 0x70 | MP_NATIVE_TYPE_OBJ,
+    VTYPE_BUILTIN_VEC = 0x80 | MP_NATIVE_TYPE_OBJ,
 } vtype_kind_t;
 
+// Names of the viper vector intrinsics, indexed by MP_NATIVE_VEC_xxx
+STATIC const uint16_t viper_vec_qstr_table[] = {
+    MP_QSTR_vadd,
+    MP_QSTR_vmac,
+    MP_QSTR_vsum,
+    MP_QSTR_vminmax,
+};
+
+STATIC int viper_vec_from_qstr(qstr qst) {
+    for (size_t i = 0; i < MP_ARRAY_SIZE(viper_vec_qstr_table); ++i) {
+        if (viper_vec_qstr_table[i] == qst) {
+            return i;
+        }
+    }
+    return -1;
+}
+
 STATIC qstr vtype_to_qstr(vtype_kind_t vtype) {
     switch (vtype) {
         case VTYPE_PYOBJ:
@@ -179,6 +198,10 @@ STATIC qstr vtype_to_qstr(vtype_kind_t vtype) {
             return MP_QSTR_ptr16;
         case VTYPE_PTR32:
             return MP_QSTR_ptr32;
+        #if MICROPY_PY_BUILTINS_FLOAT
+        case VTYPE_PTR32F:
+            return MP_QSTR_ptr32f;
+        #endif
         case VTYPE_PTR_NONE:
         default:
             return MP_QSTR_None;
@@ -197,6 +220,18 @@ typedef struct _stack_info_t {
 #define UNWIND_LABEL_UNUSED (0x7fff)
 #define UNWIND_LABEL_DO_FINAL_UNWIND (0x7ffe)
 
+// Value of reg_local_num[] for a register that doesn't hold a local
+#define REG_LOCAL_UNUSED (0xffff)
+
+// Uses inside a loop count this many times more than those outside
+#define LOCAL_USE_LOOP_WEIGHT (8)
+#define LOCAL_USE_MAX_WEIGHT (4096)
+
+typedef struct _local_use_t {
+    uint16_t local_num;
+    uint16_t weight;
+} local_use_t;
+
 typedef struct _exc_stack_entry_t {
     uint16_t label : 15;
     uint16_t is_finally : 1;
@@ -216,6 +251,20 @@ struct _emit_t {
     mp_uint_t local_vtype_alloc;
     vtype_kind_t *local_vtype;
 
+    // The local held in each of the registers in reg_local_table
+    uint16_t reg_local_num[REG_LOCAL_NUM];
+
+    // Uses of locals recorded during the stack-size pass, to choose which
+    // locals to keep in registers; a label_use_end entry that is greater
+    // than label_use_start marks a loop back to that label
+    bool track_local_use;
+    size_t local_use_alloc;
+    size_t local_use_len;
+    local_use_t *local_use;
+    mp_uint_t max_num_labels;
+    uint32_t *label_use_start;
+    uint32_t *label_use_end;
+
     mp_uint_t stack_info_alloc;
     stack_info_t *stack_info;
     vtype_kind_t saved_stack_vtype;
@@ -263,6 +312,7 @@ emit_t *EXPORT_FUN(new)(mp_obj_t * error_slot, uint *label_slot, mp_uint_t max_n
     emit->stack_info = m_new(stack_info_t, emit->stack_info_alloc);
     emit->exc_stack_alloc = 8;
     emit->exc_stack = m_new(exc_stack_entry_t, emit->exc_stack_alloc);
+    emit->max_num_labels = max_num_labels;
     emit->as = m_new0(ASM_T, 1);
     mp_asm_base_init(&emit->as->base, max_num_labels);
     return emit;
@@ -274,6 +324,11 @@ void EXPORT_FUN(free)(emit_t * emit) {
     m_del(exc_stack_entry_t, emit->exc_stack, emit->exc_stack_alloc);
     m_del(vtype_kind_t, emit->local_vtype, emit->local_vtype_alloc);
     m_del(stack_info_t, emit->stack_info, emit->stack_info_alloc);
+    m_del(local_use_t, emit->local_use, emit->local_use_alloc);
+    if (emit->label_use_start != NULL) {
+        m_del(uint32_t, emit->label_use_start, emit->max_num_labels);
+        m_del(uint32_t, emit->label_use_end, emit->max_num_labels);
+    }
     m_del_obj(emit_t, emit);
 }
 
@@ -334,6 +389,86 @@ STATIC void emit_native_mov_reg_qstr_obj(emit_t *emit, int reg_dest, qstr qst) {
     #endif
 }
 
+// Return the register that holds the given local, or -1 if it's in the C stack
+STATIC int emit_native_local_reg(emit_t *emit, mp_uint_t local_num) {
+    if (CAN_USE_REGS_FOR_LOCALS(emit)) {
+        for (int i = 0; i < REG_LOCAL_NUM; ++i) {
+            if (emit->reg_local_num[i] == local_num) {
+                return reg_local_table[i];
+            }
+        }
+    }
+    return -1;
+}
+
+STATIC void emit_native_note_local_use(emit_t *emit, mp_uint_t local_num) {
+    if (!emit->track_local_use) {
+        return;
+    }
+    if (emit->local_use_len >= emit->local_use_alloc) {
+        size_t new_alloc = emit->local_use_alloc * 2 + 16;
+        emit->local_use = m_renew(local_use_t, emit->local_use, emit->local_use_alloc, new_alloc);
+        emit->local_use_alloc = new_alloc;
+    }
+    local_use_t *use = &emit->local_use[emit->local_use_len++];
+    use->local_num = local_num;
+    use->weight = 1;
+}
+
+STATIC void emit_native_note_label(emit_t *emit, mp_uint_t label) {
+    if (emit->track_local_use && label < emit->max_num_labels) {
+        emit->label_use_start[label] = emit->local_use_len;
+    }
+}
+
+STATIC void emit_native_note_jump(emit_t *emit, mp_uint_t label) {
+    // A jump back to a label that was already assigned in this pass is a loop
+    if (emit->track_local_use && label < emit->max_num_labels
+        && emit->label_use_start[label] != UINT32_MAX) {
+        emit->label_use_end[label] = emit->local_use_len;
+    }
+}
+
+// Choose the locals to keep in registers, being those used the most with
+// uses inside loops counting more, from the uses recorded in this pass
+STATIC void emit_native_choose_reg_locals(emit_t *emit) {
+    for (mp_uint_t l = 0; l < emit->max_num_labels; ++l) {
+        uint32_t start = emit->label_use_start[l];
+        if (start != UINT32_MAX) {
+            for (uint32_t i = start; i < emit->label_use_end[l]; ++i) {
+                uint32_t weight = emit->local_use[i].weight * LOCAL_USE_LOOP_WEIGHT;
+                emit->local_use[i].weight = MIN(weight, LOCAL_USE_MAX_WEIGHT);
+            }
+        }
+    }
+
+    size_t num_locals = emit->scope->num_locals;
+    uint32_t *total = m_new0(uint32_t, num_locals);
+    for (size_t i = 0; i < emit->local_use_len; ++i) {
+        total[emit->local_use[i].local_num] += emit->local_use[i].weight;
+    }
+
+    // Pick the locals with the largest totals, then put them in the registers
+    // in order of local number, so the first locals take the first registers
+    size_t num_chosen = 0;
+    for (size_t j = 0; j < num_locals; ++j) {
+        size_t rank = 0;
+        for (size_t k = 0; k < num_locals && rank < REG_LOCAL_NUM; ++k) {
+            if (total[k] > total[j] || (total[k] == total[j] && k < j)) {
+                ++rank;
+            }
+        }
+        if (total[j] > 0 && rank < REG_LOCAL_NUM) {
+            emit->reg_local_num[num_chosen++] = j;
+        }
+    }
+    for (size_t i = num_chosen; i < REG_LOCAL_NUM; ++i) {
+        emit->reg_local_num[i] = REG_LOCAL_UNUSED;
+    }
+
+    m_del(uint32_t, total, num_locals);
+}
+
 #define emit_native_mov_state_imm_via(emit, local_num, imm, reg_temp) \
     do { \
         ASM_MOV_REG_IMM((emit)->as, (reg_temp), (imm)); \
@@ -376,6 +511,26 @@ STATIC void emit_native_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scop
         emit->local_vtype_alloc = scope->num_locals;
     }
 
+    if (pass == MP_PASS_STACK_SIZE) {
+        // Keep the first locals in registers in this pass, and record the
+        // uses of locals to choose the ones for the remaining passes
+        for (mp_uint_t i = 0; i < REG_LOCAL_NUM; ++i) {
+            emit->reg_local_num[i] = i < scope->num_locals ? i : REG_LOCAL_UNUSED;
+        }
+        emit->track_local_use = CAN_USE_REGS_FOR_LOCALS(emit) && scope->num_locals > REG_LOCAL_NUM;
+        if (emit->track_local_use) {
+            if (emit->label_use_start == NULL) {
+                emit->label_use_start = m_new(uint32_t, emit->max_num_labels);
+                emit->label_use_end = m_new(uint32_t, emit->max_num_labels);
+            }
+            memset(emit->label_use_start, 0xff, emit->max_num_labels * sizeof(uint32_t));
+            memset(emit->label_use_end, 0, emit->max_num_labels * sizeof(uint32_t));
+            emit->local_use_len = 0;
+        }
+    } else {
+        emit->track_local_use = false;
+    }
+
     // set default type for arguments
     mp_uint_t num_args = emit->scope->num_pos_args + emit->scope->num_kwonly_args;
     if (scope->scope_flags & MP_SCOPE_FLAG_VARARGS) {
@@ -424,16 +579,16 @@ STATIC void emit_native_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scop
         // Work out size of state (locals plus stack)
         // n_state counts all stack and locals, even those in registers
         emit->n_state = scope->num_locals + scope->stack_size;
+        // The first locals that are all in registers don't need a spot at the
+        // end of the state, except one in REG_LOCAL_3 that is loaded from the
+        // args array before the last arg (see below)
         int num_locals_in_regs = 0;
-        if (CAN_USE_REGS_FOR_LOCALS(emit)) {
-            num_locals_in_regs = scope->num_locals;
-            if (num_locals_in_regs > REG_LOCAL_NUM) {
-                num_locals_in_regs = REG_LOCAL_NUM;
-            }
-            // Need a spot for REG_LOCAL_3 if 4 or more args (see below)
-            if (scope->num_pos_args >= 4) {
-                --num_locals_in_regs;
+        while (num_locals_in_regs < scope->num_locals) {
+            int reg = emit_native_local_reg(emit, num_locals_in_regs);
+            if (reg == -1 || (reg == REG_LOCAL_3 && num_locals_in_regs < scope->num_pos_args - 1)) {
+                break;
             }
+            ++num_locals_in_regs;
         }
 
         // Work out where the locals and Python stack start within the C stack
@@ -492,15 +647,18 @@ STATIC void emit_native_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scop
                 r = REG_RET;
             }
             // REG_LOCAL_3 points to the args array so be sure not to overwrite it if it's still needed
-            if (i < REG_LOCAL_NUM && CAN_USE_REGS_FOR_LOCALS(emit) && (i != 2 || emit->scope->num_pos_args == 3)) {
-                ASM_MOV_REG_REG(emit->as, reg_local_table[i], r);
+            int reg_local = emit_native_local_reg(emit, i);
+            if (reg_local != -1 && (reg_local != REG_LOCAL_3 || i == emit->scope->num_pos_args - 1)) {
+                ASM_MOV_REG_REG(emit->as, reg_local, r);
             } else {
                 emit_native_mov_state_reg(emit, LOCAL_IDX_LOCAL_VAR(emit, i), r);
             }
         }
-        // Get 3rd local from the stack back into REG_LOCAL_3 if this reg couldn't be written to above
-        if (emit->scope->num_pos_args >= 4 && CAN_USE_REGS_FOR_LOCALS(emit)) {
-            ASM_MOV_REG_LOCAL(emit->as, REG_LOCAL_3, LOCAL_IDX_LOCAL_VAR(emit, 2));
+        // Get the local in REG_LOCAL_3 from the stack if this reg couldn't be written to above
+        for (int i = 0; i < emit->scope->num_pos_args - 1; i++) {
+            if (emit_native_local_reg(emit, i) == REG_LOCAL_3) {
+                ASM_MOV_REG_LOCAL(emit->as, REG_LOCAL_3, LOCAL_IDX_LOCAL_VAR(emit, i));
+            }
         }
 
         emit_native_global_exc_entry(emit);
@@ -616,8 +774,10 @@ STATIC void emit_native_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scop
 
         // cache some locals in registers, but only if no exception handlers
         if (CAN_USE_REGS_FOR_LOCALS(emit)) {
-            for (int i = 0; i < REG_LOCAL_NUM && i < scope->num_locals; ++i) {
-                ASM_MOV_REG_LOCAL(emit->as, reg_local_table[i], LOCAL_IDX_LOCAL_VAR(emit, i));
+            for (int i = 0; i < REG_LOCAL_NUM; ++i) {
+                if (emit->reg_local_num[i] != REG_LOCAL_UNUSED) {
+                    ASM_MOV_REG_LOCAL(emit->as, reg_local_table[i], LOCAL_IDX_LOCAL_VAR(emit, emit->reg_local_num[i]));
+                }
             }
         }
 
@@ -706,6 +866,10 @@ STATIC void emit_native_end_pass(emit_t *emit) {
     assert(emit->stack_size == 0);
     assert(emit->exc_stack_size == 0);
 
+    if (emit->track_local_use) {
+        emit_native_choose_reg_locals(emit);
+    }
+
     // Deal with const table accounting
     assert(emit->pass <= MP_PASS_STACK_SIZE || (emit->const_table_num_obj == emit->const_table_cur_obj));
     emit->const_table_num_obj = emit->const_table_cur_obj;
@@ -1164,6 +1328,8 @@ STATIC void emit_load_reg_with_raw_code(emit_t *emit, int reg, mp_raw_code_t *rc
 STATIC void emit_native_label_assign(emit_t *emit, mp_uint_t l) {
     DEBUG_printf("label_assign(" UINT_FMT ")\n", l);
 
+    emit_native_note_label(emit, l);
+
     bool is_finally = false;
     if (emit->exc_stack_size > 0) {
         exc_stack_entry_t *e = &emit->exc_stack[emit->exc_stack_size - 1];
@@ -1442,8 +1608,10 @@ STATIC void emit_native_load_fast(emit_t *emit, qstr qst, mp_uint_t local_num) {
         EMIT_NATIVE_VIPER_TYPE_ERROR(emit, MP_ERROR_TEXT("local '%q' used before type known"), qst);
     }
     emit_native_pre(emit);
-    if (local_num < REG_LOCAL_NUM && CAN_USE_REGS_FOR_LOCALS(emit)) {
-        emit_post_push_reg(emit, vtype, reg_local_table[local_num]);
+    emit_native_note_local_use(emit, local_num);
+    int reg_local = emit_native_local_reg(emit, local_num);
+    if (reg_local != -1) {
+        emit_post_push_reg(emit, vtype, reg_local);
     } else {
         need_reg_single(emit, REG_TEMP0, 0);
         emit_native_mov_reg_state(emit, REG_TEMP0, LOCAL_IDX_LOCAL_VAR(emit, local_num));
@@ -1486,6 +1654,12 @@ STATIC void emit_native_load_global(emit_t *emit, qstr qst, int kind) {
                 emit_post_push_imm(emit, VTYPE_BUILTIN_CAST, native_type);
                 return;
             }
+            // check for vector intrinsics
+            int vec_op = viper_vec_from_qstr(qst);
+            if (vec_op >= 0) {
+                emit_post_push_imm(emit, VTYPE_BUILTIN_VEC, vec_op);
+                return;
+            }
         }
     }
     emit_call_with_qstr_arg(emit, MP_F_LOAD_NAME + kind, qst, REG_ARG_1);
@@ -1559,6 +1733,9 @@ STATIC void emit_native_load_subscr(emit_t *emit) {
             int reg_base = REG_ARG_1;
             int reg_index = REG_ARG_2;
             emit_pre_pop_reg_flexible(emit, &vtype_base, &reg_base, reg_index, reg_index);
+            // values further down the stack may be in the registers written below
+            need_reg_single(emit, reg_index, 0);
+            need_reg_single(emit, REG_RET, 0);
             switch (vtype_base) {
                 case VTYPE_PTR8: {
                     // pointer to 8-bit memory
@@ -1595,7 +1772,8 @@ STATIC void emit_native_load_subscr(emit_t *emit) {
                     ASM_LOAD16_REG_REG(emit->as, REG_RET, reg_base); // load from (base+2*index)
                     break;
                 }
-                case VTYPE_PTR32: {
+                case VTYPE_PTR32:
+                case VTYPE_PTR32F: {
                     // pointer to 32-bit memory
                     if (index_value != 0) {
                         // index is a non-zero immediate
@@ -1622,6 +1800,7 @@ STATIC void emit_native_load_subscr(emit_t *emit) {
             int reg_index = REG_ARG_2;
             emit_pre_pop_reg_flexible(emit, &vtype_index, &reg_index, REG_ARG_1, REG_ARG_1);
             emit_pre_pop_reg(emit, &vtype_base, REG_ARG_1);
+            need_reg_single(emit, REG_RET, 0);
             if (vtype_index != VTYPE_INT && vtype_index != VTYPE_UINT) {
                 EMIT_NATIVE_VIPER_TYPE_ERROR(emit,
                     MP_ERROR_TEXT("can't load with '%q' index"), vtype_to_qstr(vtype_index));
@@ -1641,7 +1820,8 @@ STATIC void emit_native_load_subscr(emit_t *emit) {
                     ASM_LOAD16_REG_REG(emit->as, REG_RET, REG_ARG_1); // load from (base+2*index)
                     break;
                 }
-                case VTYPE_PTR32: {
+                case VTYPE_PTR32:
+                case VTYPE_PTR32F: {
                     // pointer to word-size memory
                     ASM_ADD_REG_REG(emit->as, REG_ARG_1, reg_index); // add index to base
                     ASM_ADD_REG_REG(emit->as, REG_ARG_1, reg_index); // add index to base
@@ -1655,14 +1835,23 @@ STATIC void emit_native_load_subscr(emit_t *emit) {
                         MP_ERROR_TEXT("can't load from '%q'"), vtype_to_qstr(vtype_base));
             }
         }
+        if (vtype_base == VTYPE_PTR32F) {
+            // convert the loaded bits to a float object
+            ASM_MOV_REG_REG(emit->as, REG_ARG_1, REG_RET);
+            emit_call_with_imm_arg(emit, MP_F_CONVERT_NATIVE_TO_OBJ, MP_NATIVE_TYPE_FLOAT32, REG_ARG_2);
+            emit_post_push_reg(emit, VTYPE_PYOBJ, REG_RET);
+            return;
+        }
         emit_post_push_reg(emit, VTYPE_INT, REG_RET);
     }
 }
 
 STATIC void emit_native_store_fast(emit_t *emit, qstr qst, mp_uint_t local_num) {
     vtype_kind_t vtype;
-    if (local_num < REG_LOCAL_NUM && CAN_USE_REGS_FOR_LOCALS(emit)) {
-        emit_pre_pop_reg(emit, &vtype, reg_local_table[local_num]);
+    emit_native_note_local_use(emit, local_num);
+    int reg_local = emit_native_local_reg(emit, local_num);
+    if (reg_local != -1) {
+        emit_pre_pop_reg(emit, &vtype, reg_local);
     } else {
         emit_pre_pop_reg(emit, &vtype, REG_TEMP0);
         emit_native_mov_state_reg(emit, LOCAL_IDX_LOCAL_VAR(emit, local_num), REG_TEMP0);
@@ -1759,6 +1948,23 @@ STATIC void emit_native_store_subscr(emit_t *emit) {
         // TODO The different machine architectures have very different
         // capabilities and requirements for stores, so probably best to
         // write a completely separate store-optimiser for each one.
+        if (vtype_base == VTYPE_PTR32F) {
+            // convert the value in place to the bits of a float, then store it as a uint
+            vtype_kind_t vtype_value;
+            emit_access_stack(emit, 3, &vtype_value, REG_ARG_1);
+            if (vtype_value == VTYPE_BOOL || vtype_value == VTYPE_INT || vtype_value == VTYPE_UINT) {
+                emit_call_with_imm_arg(emit, MP_F_CONVERT_NATIVE_TO_OBJ, vtype_value, REG_ARG_2);
+                ASM_MOV_REG_REG(emit->as, REG_ARG_1, REG_RET);
+            } else if (vtype_value != VTYPE_PYOBJ) {
+                EMIT_NATIVE_VIPER_TYPE_ERROR(emit,
+                    MP_ERROR_TEXT("can't store '%q'"), vtype_to_qstr(vtype_value));
+            }
+            emit_call_with_imm_arg(emit, MP_F_CONVERT_OBJ_TO_NATIVE, MP_NATIVE_TYPE_FLOAT32, REG_ARG_2);
+            stack_info_t *si = peek_stack(emit, 2);
+            si->kind = STACK_VALUE;
+            si->vtype = VTYPE_UINT;
+            emit_native_mov_state_reg(emit, emit->stack_start + emit->stack_size - 3, REG_RET);
+        }
         stack_info_t *top = peek_stack(emit, 0);
         if (top->vtype == VTYPE_INT && top->kind == STACK_IMM) {
             // index is an immediate
@@ -1775,6 +1981,8 @@ STATIC void emit_native_store_subscr(emit_t *emit) {
             #else
             emit_pre_pop_reg_flexible(emit, &vtype_value, &reg_value, reg_base, reg_index);
             #endif
+            // a value further down the stack may be in the register written below
+            need_reg_single(emit, reg_index, 0);
             if (vtype_value != VTYPE_BOOL && vtype_value != VTYPE_INT && vtype_value != VTYPE_UINT) {
                 EMIT_NATIVE_VIPER_TYPE_ERROR(emit,
                     MP_ERROR_TEXT("can't store '%q'"), vtype_to_qstr(vtype_value));
@@ -1819,7 +2027,8 @@ STATIC void emit_native_store_subscr(emit_t *emit) {
                     ASM_STORE16_REG_REG(emit->as, reg_value, reg_base); // store value to (base+2*index)
                     break;
                 }
-                case VTYPE_PTR32: {
+                case VTYPE_PTR32:
+                case VTYPE_PTR32F: {
                     // pointer to 32-bit memory
                     if (index_value != 0) {
                         // index is a non-zero immediate
@@ -1889,7 +2098,8 @@ STATIC void emit_native_store_subscr(emit_t *emit) {
                     ASM_STORE16_REG_REG(emit->as, reg_value, REG_ARG_1); // store value to (base+2*index)
                     break;
                 }
-                case VTYPE_PTR32: {
+                case VTYPE_PTR32:
+                case VTYPE_PTR32F: {
                     // pointer to 32-bit memory
                     #if N_ARM
                     asm_arm_str_reg_reg_reg(emit->as, reg_value, REG_ARG_1, reg_index);
@@ -2008,6 +2218,7 @@ STATIC void emit_native_jump(emit_t *emit, mp_uint_t label) {
     // need to commit stack because we are jumping elsewhere
     need_stack_settled(emit);
     ASM_JUMP(emit->as, label);
+    emit_native_note_jump(emit, label);
     emit_post(emit);
 }
 
@@ -2042,6 +2253,7 @@ STATIC void emit_native_jump_helper(emit_t *emit, bool cond, mp_uint_t label, bo
     } else {
         ASM_JUMP_IF_REG_ZERO(emit->as, REG_RET, label, vtype == VTYPE_PYOBJ);
     }
+    emit_native_note_jump(emit, label);
     if (!pop) {
         adjust_stack(emit, -1);
     }
@@ -2538,6 +2750,29 @@ STATIC void emit_native_binary_op(emit_t *emit, mp_binary_op_t op) {
             } else {
                 asm_xtensa_setcc_reg_reg_reg(emit->as, cc & ~0x80, REG_RET, reg_rhs, REG_ARG_2);
             }
+            #elif N_RV32
+            static uint8_t ccs[6 + 6] = {
+                // unsigned
+                ASM_RV32_CC_LTU,
+                0x80 | ASM_RV32_CC_LTU, // for GTU we'll swap args
+                ASM_RV32_CC_EQ,
+                0x80 | ASM_RV32_CC_GEU, // for LEU we'll swap args
+                ASM_RV32_CC_GEU,
+                ASM_RV32_CC_NE,
+                // signed
+                ASM_RV32_CC_LT,
+                0x80 | ASM_RV32_CC_LT, // for GT we'll swap args
+                ASM_RV32_CC_EQ,
+                0x80 | ASM_RV32_CC_GE, // for LE we'll swap args
+                ASM_RV32_CC_GE,
+                ASM_RV32_CC_NE,
+            };
+            uint8_t cc = ccs[op_idx];
+            if ((cc & 0x80) == 0) {
+                asm_rv32_setcc_reg_reg_reg(emit->as, cc, REG_RET, REG_ARG_2, reg_rhs);
+            } else {
+                asm_rv32_setcc_reg_reg_reg(emit->as, cc & ~0x80, REG_RET, reg_rhs, REG_ARG_2);
+            }
             #else
             #error not implemented
             #endif
@@ -2709,6 +2944,45 @@ STATIC void emit_native_make_closure(emit_t *emit, scope_t *scope, mp_uint_t n_c
     emit_post_push_reg(emit, VTYPE_PYOBJ, REG_RET);
 }
 
+// Vector intrinsics take pointers of the same type then an int count, and run
+// a loop over the arrays in a single call to the runtime
+STATIC void emit_native_call_viper_vec(emit_t *emit, mp_uint_t n_positional, mp_uint_t n_keyword, mp_uint_t star_flags) {
+    mp_uint_t vec_op = peek_stack(emit, n_positional + 2 * n_keyword)->data.u_imm;
+    mp_uint_t n_ptr = vec_op <= MP_NATIVE_VEC_MAC ? 2 : 1;
+    if (n_positional != n_ptr + 1 || n_keyword != 0 || star_flags) {
+        EMIT_NATIVE_VIPER_TYPE_ERROR(emit, MP_ERROR_TEXT("%q takes %d positional args"),
+            viper_vec_qstr_table[vec_op], (int)(n_ptr + 1));
+        // keep the stack consistent
+        for (mp_uint_t i = 0; i < n_positional + 2 * n_keyword + 1; ++i) {
+            emit_pre_pop_discard(emit);
+        }
+        emit_post_push_imm(emit, VTYPE_PYOBJ, 0);
+        return;
+    }
+    vtype_kind_t vtype_ptr = peek_vtype(emit, n_positional - 1);
+    bool ok = VTYPE_PTR8 <= vtype_ptr && vtype_ptr <= VTYPE_PTR32
+        && (n_ptr == 1 || peek_vtype(emit, 1) == vtype_ptr);
+    vtype_kind_t vtype_n = peek_vtype(emit, 0);
+    if (!ok || (vtype_n != VTYPE_INT && vtype_n != VTYPE_UINT)) {
+        EMIT_NATIVE_VIPER_TYPE_ERROR(emit, MP_ERROR_TEXT("%q needs ptr8, ptr16 or ptr32 args of one type then an int"),
+            viper_vec_qstr_table[vec_op]);
+    }
+    vtype_kind_t vtype_1, vtype_2, vtype_3;
+    if (n_ptr == 2) {
+        emit_pre_pop_reg_reg_reg(emit, &vtype_3, REG_ARG_4, &vtype_2, REG_ARG_3, &vtype_1, REG_ARG_2);
+    } else {
+        emit_pre_pop_reg_reg(emit, &vtype_2, REG_ARG_3, &vtype_1, REG_ARG_2);
+    }
+    emit_pre_pop_discard(emit);
+    mp_uint_t size_log2 = ok ? vtype_ptr - VTYPE_PTR8 : 0;
+    emit_call_with_imm_arg(emit, MP_F_VIPER_VEC, vec_op << 2 | size_log2, REG_ARG_1);
+    if (vec_op == MP_NATIVE_VEC_MAC || vec_op == MP_NATIVE_VEC_SUM) {
+        emit_post_push_reg(emit, VTYPE_INT, REG_RET);
+    } else {
+        emit_post_push_reg(emit, VTYPE_PYOBJ, REG_RET);
+    }
+}
+
 STATIC void emit_native_call_function(emit_t *emit, mp_uint_t n_positional, mp_uint_t n_keyword, mp_uint_t star_flags) {
     DEBUG_printf("call_function(n_pos=" UINT_FMT ", n_kw=" UINT_FMT ", star_flags=" UINT_FMT ")\n", n_positional, n_keyword, star_flags);
 
@@ -2739,6 +3013,7 @@ STATIC void emit_native_call_function(emit_t *emit, mp_uint_t n_positional, mp_u
             case VTYPE_PTR8:
             case VTYPE_PTR16:
             case VTYPE_PTR32:
+            case VTYPE_PTR32F:
             case VTYPE_PTR_NONE:
                 emit_fold_stack_top(emit, REG_ARG_1);
                 emit_post_top_set_vtype(emit, vtype_cast);
@@ -2747,6 +3022,8 @@ STATIC void emit_native_call_function(emit_t *emit, mp_uint_t n_positional, mp_u
                 // this can happen when casting a cast: int(int)
                 mp_raise_NotImplementedError(MP_ERROR_TEXT("casting"));
         }
+    } else if (vtype_fun == VTYPE_BUILTIN_VEC) {
+        emit_native_call_viper_vec(emit, n_positional, n_keyword, star_flags);
     } else {
         assert(vtype_fun == VTYPE_PYOBJ);
         if (star_flags) {
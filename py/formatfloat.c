@@ -28,26 +28,15 @@
 #if MICROPY_FLOAT_IMPL != MICROPY_FLOAT_IMPL_NONE
 
 #include <assert.h>
+#include <stdbool.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
+#include <float.h>
 #include <math.h>
+#include "py/misc.h"
 #include "py/formatfloat.h"
 
-/***********************************************************************
-
-  Routine for converting a arbitrary floating
-  point number into a string.
-
-  The code in this funcion was inspired from Fred Bayer's pdouble.c.
-  Since pdouble.c was released as Public Domain, I'm releasing this
-  code as public domain as well.
-
-  The original code can be found in https://github.com/dhylands/format-float
-
-  Dave Hylands
-
-***********************************************************************/
-
 #if MICROPY_FLOAT_IMPL == MICROPY_FLOAT_IMPL_FLOAT
 // 1 sign bit, 8 exponent bits, and 23 mantissa bits.
 // exponent values 0 and 255 are reserved, exponent can be 1 to 254.
@@ -98,6 +87,1165 @@ static inline int fp_isless1(float x) {
 
 #endif
 
+#if MICROPY_FLOAT_EXACT_CONVERSION
+
+/***********************************************************************
+
+  Exact conversion between floats and decimal strings.
+
+  Both directions work on the value of a float as m * 2^q, with m and q
+  integers.  A fast path on 64-bit integers gives the answer in almost all
+  cases, and knows when it can't; then arbitrary precision integers
+  (bignums), held on the C stack, give the exact answer.
+
+  Floats are printed by Loitsch's Grisu3, falling back to the digit
+  generation of Steele & White's Dragon4 as refined by Burger & Dybvig:
+  either the shortest digits that read back as the same float (for repr),
+  or a given number of correctly rounded digits.
+
+  Strings are read by Clinger's fast path when the digits fit in the
+  mantissa and the power of 10 is exact, or else by multiplying by a cached
+  power of 10 with 64 bits of precision while tracking the error, as done
+  by the double-conversion library.  When that is too close to a halfway
+  point to tell, the result is corrected by comparing the decimal number
+  exactly with the points halfway to the floats either side.
+
+***********************************************************************/
+
+#if MICROPY_FLOAT_IMPL == MICROPY_FLOAT_IMPL_FLOAT
+typedef uint32_t fp_bits_t;
+#define FP_FRAC_BITS (23)
+#define FP_EXP_BITS (8)
+#define FP_MAX (FLT_MAX)
+// largest exactly representable power of 10
+#define FP_POW10_EXACT (10)
+// repr uses the exponent format from this decimal exponent up
+#define FP_REPR_EXP_MIN (7)
+// range of decimal exponents of the leading digit that give a finite,
+// non-zero float
+#define FP_DEC_EXP_MIN (-46)
+#define FP_DEC_EXP_MAX (38)
+// significant digits that are enough to tell any two halfway points apart
+#define FP_PARSE_DIGITS_MAX (120)
+#define BN_FORMAT_WORDS (8)
+#define BN_PARSE_WORDS (16)
+#else
+typedef uint64_t fp_bits_t;
+#define FP_FRAC_BITS (52)
+#define FP_EXP_BITS (11)
+#define FP_MAX (DBL_MAX)
+#define FP_POW10_EXACT (22)
+#define FP_REPR_EXP_MIN (16)
+#define FP_DEC_EXP_MIN (-324)
+#define FP_DEC_EXP_MAX (308)
+#define FP_PARSE_DIGITS_MAX (780)
+#define BN_FORMAT_WORDS (40)
+#define BN_PARSE_WORDS (88)
+#endif
+
+// f == m * 2^(biased_exp - FP_EXP_BIAS) for normal floats
+#define FP_EXP_BIAS ((1 << (FP_EXP_BITS - 1)) - 1 + FP_FRAC_BITS)
+#define FP_HIDDEN_BIT ((fp_bits_t)1 << FP_FRAC_BITS)
+
+// room for the most digits that mp_format_float produces
+#define FP_DIGITS_BUF_SIZE (48)
+
+union fp_bits {
+    FPTYPE f;
+    fp_bits_t b;
+};
+
+static const FPTYPE fp_pow10[] = {
+    FPCONST(1e0), FPCONST(1e1), FPCONST(1e2), FPCONST(1e3), FPCONST(1e4), FPCONST(1e5),
+    FPCONST(1e6), FPCONST(1e7), FPCONST(1e8), FPCONST(1e9), FPCONST(1e10),
+    #if FP_POW10_EXACT > 10
+    1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+    #endif
+};
+
+// Split f >= 0, which must be finite, into m * 2^q, and return its biased
+// exponent (0 for subnormals).
+STATIC int fp_split(FPTYPE f, fp_bits_t *m, int *q) {
+    union fp_bits u = {f};
+    int biased_exp = u.b >> FP_FRAC_BITS;
+    *m = u.b & (FP_HIDDEN_BIT - 1);
+    if (biased_exp == 0) {
+        *q = 1 - FP_EXP_BIAS;
+    } else {
+        *m |= FP_HIDDEN_BIT;
+        *q = biased_exp - FP_EXP_BIAS;
+    }
+    return biased_exp;
+}
+
+// Return the float next to f >= 0 going up (dir = 1) or down (dir = -1).
+STATIC FPTYPE fp_step(FPTYPE f, int dir) {
+    union fp_bits u = {f};
+    u.b += dir;
+    return u.f;
+}
+
+/******************************************************************************/
+// Unsigned bignums, as little endian arrays of 32-bit words, with no leading
+// zero words.  The caller provides the words, enough for the largest value.
+
+typedef struct _bn_t {
+    size_t len;
+    uint32_t *d;
+} bn_t;
+
+STATIC void bn_set_u64(bn_t *a, uint64_t v) {
+    a->len = 0;
+    while (v) {
+        a->d[a->len++] = (uint32_t)v;
+        v >>= 32;
+    }
+}
+
+STATIC void bn_copy(bn_t *dest, const bn_t *src) {
+    dest->len = src->len;
+    memcpy(dest->d, src->d, src->len * sizeof(uint32_t));
+}
+
+// a = a * mul + add
+STATIC void bn_mul_add_small(bn_t *a, uint32_t mul, uint32_t add) {
+    uint64_t carry = add;
+    for (size_t i = 0; i < a->len; ++i) {
+        carry += (uint64_t)a->d[i] * mul;
+        a->d[i] = (uint32_t)carry;
+        carry >>= 32;
+    }
+    if (carry) {
+        a->d[a->len++] = (uint32_t)carry;
+    }
+}
+
+STATIC void bn_mul_pow5(bn_t *a, unsigned int n) {
+    // 5^13 is the largest power of 5 that fits in 32 bits
+    for (; n >= 13; n -= 13) {
+        bn_mul_add_small(a, 1220703125, 0);
+    }
+    if (n) {
+        uint32_t p = 1;
+        while (n--) {
+            p *= 5;
+        }
+        bn_mul_add_small(a, p, 0);
+    }
+}
+
+STATIC void bn_shl(bn_t *a, unsigned int n) {
+    if (a->len == 0 || n == 0) {
+        return;
+    }
+    size_t words = n / 32;
+    unsigned int bits = n % 32;
+    if (bits) {
+        uint32_t top = a->d[a->len - 1] >> (32 - bits);
+        for (size_t i = a->len - 1; i > 0; --i) {
+            a->d[i] = a->d[i] << bits | a->d[i - 1] >> (32 - bits);
+        }
+        a->d[0] <<= bits;
+        if (top) {
+            a->d[a->len++] = top;
+        }
+    }
+    if (words) {
+        memmove(a->d + words, a->d, a->len * sizeof(uint32_t));
+        memset(a->d, 0, words * sizeof(uint32_t));
+        a->len += words;
+    }
+}
+
+STATIC void bn_mul_pow10(bn_t *a, unsigned int n) {
+    bn_mul_pow5(a, n);
+    bn_shl(a, n);
+}
+
+STATIC int bn_cmp(const bn_t *a, const bn_t *b) {
+    if (a->len != b->len) {
+        return a->len < b->len ? -1 : 1;
+    }
+    for (size_t i = a->len; i-- > 0;) {
+        if (a->d[i] != b->d[i]) {
+            return a->d[i] < b->d[i] ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+// dest = a + b, where dest may be a
+STATIC void bn_add(bn_t *dest, const bn_t *a, const bn_t *b) {
+    if (a->len < b->len) {
+        const bn_t *t = a;
+        a = b;
+        b = t;
+    }
+    uint64_t carry = 0;
+    for (size_t i = 0; i < a->len; ++i) {
+        carry += (uint64_t)a->d[i] + (i < b->len ? b->d[i] : 0);
+        dest->d[i] = (uint32_t)carry;
+        carry >>= 32;
+    }
+    dest->len = a->len;
+    if (carry) {
+        dest->d[dest->len++] = (uint32_t)carry;
+    }
+}
+
+// a -= b * mul, which must not go negative
+STATIC void bn_sub_mul_small(bn_t *a, const bn_t *b, uint32_t mul) {
+    uint64_t carry = 0;
+    int64_t borrow = 0;
+    for (size_t i = 0; i < a->len; ++i) {
+        if (i < b->len) {
+            carry += (uint64_t)b->d[i] * mul;
+        }
+        borrow += (int64_t)a->d[i] - (uint32_t)carry;
+        carry >>= 32;
+        a->d[i] = (uint32_t)borrow;
+        borrow >>= 32;
+    }
+    while (a->len > 0 && a->d[a->len - 1] == 0) {
+        a->len--;
+    }
+}
+
+// Return r / s, which must be less than 10, and set r to the remainder.  The
+// top word of s must have its top bit set, so the quotient estimated from the
+// top words is at most one too small.
+STATIC uint32_t bn_div_digit(bn_t *r, const bn_t *s) {
+    size_t n = s->len;
+    if (r->len < n) {
+        return 0;
+    }
+    uint64_t top = r->d[n - 1];
+    if (r->len > n) {
+        top |= (uint64_t)r->d[n] << 32;
+    }
+    uint32_t q = (uint32_t)(top / ((uint64_t)s->d[n - 1] + 1));
+    if (q) {
+        bn_sub_mul_small(r, s, q);
+    }
+    while (bn_cmp(r, s) >= 0) {
+        bn_sub_mul_small(r, s, 1);
+        ++q;
+    }
+    return q;
+}
+
+/******************************************************************************/
+// float to decimal digits
+
+#define FP_DIGITS_SHORTEST (0) // the shortest digits that read back as f
+#define FP_DIGITS_SIG (1) // n significant digits
+#define FP_DIGITS_FRAC (2) // digits down to the n'th after the decimal point
+
+/******************************************************************************/
+// Fast paths on 64-bit approximations, from Loitsch's Grisu3 and the strtod
+// of the double-conversion library: the result is either known to be
+// correct or the caller falls back to bignums.
+
+// A value f * 2^e, where f is usually normalised to have its top bit set.
+typedef struct _diy_fp_t {
+    uint64_t f;
+    int e;
+} diy_fp_t;
+
+// 10^k rounded to 64 bits, for k = -348 + 8 * i.  The binary exponent of
+// entry i follows from k, see fp_cached_pow10.  Single precision builds only
+// need the middle of the table.
+#define FP_CACHED_POW10_STEP (8)
+#if MICROPY_FLOAT_IMPL == MICROPY_FLOAT_IMPL_FLOAT
+#define FP_CACHED_POW10_FIRST (35)
+#else
+#define FP_CACHED_POW10_FIRST (0)
+#endif
+static const uint64_t fp_cached_pow10_table[] = {
+    #if MICROPY_FLOAT_IMPL == MICROPY_FLOAT_IMPL_DOUBLE
+    0xfa8fd5a0081c0288ULL, 0xbaaee17fa23ebf76ULL, 0x8b16fb203055ac76ULL,
+    0xcf42894a5dce35eaULL, 0x9a6bb0aa55653b2dULL, 0xe61acf033d1a45dfULL,
+    0xab70fe17c79ac6caULL, 0xff77b1fcbebcdc4fULL, 0xbe5691ef416bd60cULL,
+    0x8dd01fad907ffc3cULL, 0xd3515c2831559a83ULL, 0x9d71ac8fada6c9b5ULL,
+    0xea9c227723ee8bcbULL, 0xaecc49914078536dULL, 0x823c12795db6ce57ULL,
+    0xc21094364dfb5637ULL, 0x9096ea6f3848984fULL, 0xd77485cb25823ac7ULL,
+    0xa086cfcd97bf97f4ULL, 0xef340a98172aace5ULL, 0xb23867fb2a35b28eULL,
+    0x84c8d4dfd2c63f3bULL, 0xc5dd44271ad3cdbaULL, 0x936b9fcebb25c996ULL,
+    0xdbac6c247d62a584ULL, 0xa3ab66580d5fdaf6ULL, 0xf3e2f893dec3f126ULL,
+    0xb5b5ada8aaff80b8ULL, 0x87625f056c7c4a8bULL, 0xc9bcff6034c13053ULL,
+    0x964e858c91ba2655ULL, 0xdff9772470297ebdULL, 0xa6dfbd9fb8e5b88fULL,
+    0xf8a95fcf88747d94ULL, 0xb94470938fa89bcfULL,
+    #endif
+    0x8a08f0f8bf0f156bULL, 0xcdb02555653131b6ULL, 0x993fe2c6d07b7facULL,
+    0xe45c10c42a2b3b06ULL, 0xaa242499697392d3ULL, 0xfd87b5f28300ca0eULL,
+    0xbce5086492111aebULL, 0x8cbccc096f5088ccULL, 0xd1b71758e219652cULL,
+    0x9c40000000000000ULL, 0xe8d4a51000000000ULL, 0xad78ebc5ac620000ULL,
+    0x813f3978f8940984ULL, 0xc097ce7bc90715b3ULL, 0x8f7e32ce7bea5c70ULL,
+    0xd5d238a4abe98068ULL,
+    #if MICROPY_FLOAT_IMPL == MICROPY_FLOAT_IMPL_DOUBLE
+    0x9f4f2726179a2245ULL, 0xed63a231d4c4fb27ULL, 0xb0de65388cc8ada8ULL,
+    0x83c7088e1aab65dbULL, 0xc45d1df942711d9aULL, 0x924d692ca61be758ULL,
+    0xda01ee641a708deaULL, 0xa26da3999aef774aULL, 0xf209787bb47d6b85ULL,
+    0xb454e4a179dd1877ULL, 0x865b86925b9bc5c2ULL, 0xc83553c5c8965d3dULL,
+    0x952ab45cfa97a0b3ULL, 0xde469fbd99a05fe3ULL, 0xa59bc234db398c25ULL,
+    0xf6c69a72a3989f5cULL, 0xb7dcbf5354e9beceULL, 0x88fcf317f22241e2ULL,
+    0xcc20ce9bd35c78a5ULL, 0x98165af37b2153dfULL, 0xe2a0b5dc971f303aULL,
+    0xa8d9d1535ce3b396ULL, 0xfb9b7cd9a4a7443cULL, 0xbb764c4ca7a44410ULL,
+    0x8bab8eefb6409c1aULL, 0xd01fef10a657842cULL, 0x9b10a4e5e9913129ULL,
+    0xe7109bfba19c0c9dULL, 0xac2820d9623bf429ULL, 0x80444b5e7aa7cf85ULL,
+    0xbf21e44003acdd2dULL, 0x8e679c2f5e44ff8fULL, 0xd433179d9c8cb841ULL,
+    0x9e19db92b4e31ba9ULL, 0xeb96bf6ebadf77d9ULL, 0xaf87023b9bf0ee6bULL,
+    #endif
+};
+
+STATIC diy_fp_t fp_cached_pow10(int i, int *k) {
+    *k = -348 + FP_CACHED_POW10_STEP * i;
+    // the exponent is floor(k * log2(10)) - 63
+    diy_fp_t p = {fp_cached_pow10_table[i - FP_CACHED_POW10_FIRST], ((*k * 1741647) >> 19) - 63};
+    return p;
+}
+
+STATIC diy_fp_t diy_fp_normalize(diy_fp_t a) {
+    while (!(a.f & 0xffc0000000000000ULL)) {
+        a.f <<= 10;
+        a.e -= 10;
+    }
+    while (!(a.f & 0x8000000000000000ULL)) {
+        a.f <<= 1;
+        a.e -= 1;
+    }
+    return a;
+}
+
+// The top 64 bits of the product, rounded.
+STATIC diy_fp_t diy_fp_mul(diy_fp_t x, diy_fp_t y) {
+    uint64_t a = x.f >> 32, b = x.f & 0xffffffff;
+    uint64_t c = y.f >> 32, d = y.f & 0xffffffff;
+    uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+    uint64_t mid = (bd >> 32) + (ad & 0xffffffff) + (bc & 0xffffffff) + (1U << 31);
+    diy_fp_t p = {ac + (ad >> 32) + (bc >> 32) + (mid >> 32), x.e + y.e + 64};
+    return p;
+}
+
+// Return a cached 10^mk such that w * 10^mk, for w with exponent w_e, has a
+// binary exponent from -60 to -32, leaving 4 to 32 bits for the integral part
+// of the digit generation.
+STATIC diy_fp_t fp_grisu_scale(int w_e, int *mk) {
+    // ceil((-60 - w_e - 1) * log10(2)), to pick the first power with a large
+    // enough exponent
+    int x = -w_e - 61;
+    int k = x >= 0 ? (x * 78913 + (1 << 18) - 1) >> 18 : -((-x * 78913) >> 18);
+    return fp_cached_pow10((348 + k - 1) / FP_CACHED_POW10_STEP + 1, mk);
+}
+
+// f as a normalised diy_fp_t, and if wanted the points halfway to the floats
+// either side of it, with the same exponent.
+STATIC diy_fp_t fp_to_diy_fp(FPTYPE f, diy_fp_t *minus, diy_fp_t *plus) {
+    fp_bits_t m;
+    int q;
+    int biased_exp = fp_split(f, &m, &q);
+    diy_fp_t w = {m, q};
+    if (plus != NULL) {
+        diy_fp_t p = {((uint64_t)m << 1) + 1, q - 1};
+        *plus = diy_fp_normalize(p);
+        if (biased_exp > 1 && m == FP_HIDDEN_BIT) {
+            minus->f = ((uint64_t)m << 2) - 1;
+            minus->e = q - 2;
+        } else {
+            minus->f = ((uint64_t)m << 1) - 1;
+            minus->e = q - 1;
+        }
+        minus->f <<= minus->e - plus->e;
+        minus->e = plus->e;
+    }
+    return diy_fp_normalize(w);
+}
+
+// The biggest power of 10 that's at most n, which must be nonzero, and the
+// number of digits of n.
+STATIC uint32_t fp_biggest_pow10(uint32_t n, int *n_digits) {
+    uint32_t p = 1;
+    *n_digits = 1;
+    while (n / p >= 10) {
+        p *= 10;
+        ++*n_digits;
+    }
+    return p;
+}
+
+// Move the last digit towards w, the float, while that stays within the
+// range that reads back as w, and check that the result is safely the
+// shortest and closest digits despite the error (unit) of the scaled values.
+STATIC bool fp_grisu_round_weed(char *digits, int nd, uint64_t dist_high_w, uint64_t unsafe_interval,
+    uint64_t rest, uint64_t ten_kappa, uint64_t unit) {
+    uint64_t small_dist = dist_high_w - unit;
+    uint64_t big_dist = dist_high_w + unit;
+    while (rest < small_dist && unsafe_interval - rest >= ten_kappa
+           && (rest + ten_kappa < small_dist || small_dist - rest >= rest + ten_kappa - small_dist)) {
+        digits[nd - 1]--;
+        rest += ten_kappa;
+    }
+    if (rest < big_dist && unsafe_interval - rest >= ten_kappa
+        && (rest + ten_kappa < big_dist || big_dist - rest > rest + ten_kappa - big_dist)) {
+        return false;
+    }
+    return 2 * unit <= rest && rest <= unsafe_interval - 4 * unit;
+}
+
+// Grisu3: the shortest digits of f > 0, or -1 if they can't be found this way.
+STATIC int fp_grisu_shortest(FPTYPE f, char *digits, int *exp10) {
+    diy_fp_t minus, plus;
+    diy_fp_t w = fp_to_diy_fp(f, &minus, &plus);
+    int mk;
+    diy_fp_t c = fp_grisu_scale(plus.e, &mk);
+    w = diy_fp_mul(w, c);
+    minus = diy_fp_mul(minus, c);
+    plus = diy_fp_mul(plus, c);
+
+    // each scaled value may be off by one unit, so look for digits strictly
+    // inside the widened interval
+    uint64_t unit = 1;
+    uint64_t too_low = minus.f - unit;
+    uint64_t too_high = plus.f + unit;
+    uint64_t unsafe_interval = too_high - too_low;
+    int shift = -w.e;
+    uint64_t one = (uint64_t)1 << shift;
+    uint32_t integrals = too_high >> shift;
+    uint64_t fractionals = too_high & (one - 1);
+    int kappa;
+    uint32_t divisor = fp_biggest_pow10(integrals, &kappa);
+    *exp10 = kappa - 1 - mk;
+    int nd = 0;
+    while (kappa > 0) {
+        digits[nd++] = '0' + integrals / divisor;
+        integrals %= divisor;
+        --kappa;
+        uint64_t rest = ((uint64_t)integrals << shift) + fractionals;
+        if (rest < unsafe_interval) {
+            return fp_grisu_round_weed(digits, nd, too_high - w.f, unsafe_interval, rest,
+                (uint64_t)divisor << shift, unit) ? nd : -1;
+        }
+        divisor /= 10;
+    }
+    for (;;) {
+        fractionals *= 10;
+        unit *= 10;
+        unsafe_interval *= 10;
+        digits[nd++] = '0' + (fractionals >> shift);
+        fractionals &= one - 1;
+        if (fractionals < unsafe_interval) {
+            return fp_grisu_round_weed(digits, nd, (too_high - w.f) * unit, unsafe_interval,
+                fractionals, one, unit) ? nd : -1;
+        }
+    }
+}
+
+// Round the nd digits, with the remainder rest out of ten_kappa and an
+// error of unit, if that can be done safely.
+STATIC bool fp_grisu_round_counted(char *digits, int nd, uint64_t rest, uint64_t ten_kappa,
+    uint64_t unit, int *exp10) {
+    if (unit >= ten_kappa || ten_kappa - unit <= unit) {
+        return false;
+    }
+    if (ten_kappa - rest > rest && ten_kappa - 2 * rest >= 2 * unit) {
+        // certainly rounds down
+        return true;
+    }
+    if (rest > unit && ten_kappa - (rest - unit) <= rest - unit) {
+        // certainly rounds up
+        int i = nd - 1;
+        for (; i > 0 && digits[i] == '9'; --i) {
+            digits[i] = '0';
+        }
+        if (digits[i] == '9') {
+            digits[0] = '1';
+            *exp10 += 1;
+        } else {
+            digits[i] += 1;
+        }
+        return true;
+    }
+    return false;
+}
+
+// Grisu3 with a number of digits fixed as for fp_digits, or -1 if they can't
+// be found this way.
+STATIC int fp_grisu_counted(FPTYPE f, int mode, int n, char *digits, int max_digits, int *exp10) {
+    diy_fp_t w = fp_to_diy_fp(f, NULL, NULL);
+    int mk;
+    w = diy_fp_mul(w, fp_grisu_scale(w.e, &mk));
+
+    uint64_t unit = 1;
+    int shift = -w.e;
+    uint64_t one = (uint64_t)1 << shift;
+    uint32_t integrals = w.f >> shift;
+    uint64_t fractionals = w.f & (one - 1);
+    int kappa;
+    uint32_t divisor = fp_biggest_pow10(integrals, &kappa);
+    *exp10 = kappa - 1 - mk;
+    int n_digits = mode == FP_DIGITS_SIG ? n : *exp10 + 1 + n;
+    if (n_digits < 0) {
+        // f is below a tenth of the last place, so it rounds to zero
+        return 0;
+    }
+    if (n_digits == 0 || n_digits > max_digits) {
+        return -1;
+    }
+    int nd = 0;
+    while (kappa > 0) {
+        digits[nd++] = '0' + integrals / divisor;
+        integrals %= divisor;
+        --kappa;
+        if (nd == n_digits) {
+            uint64_t rest = ((uint64_t)integrals << shift) + fractionals;
+            return fp_grisu_round_counted(digits, nd, rest, (uint64_t)divisor << shift, unit, exp10) ? nd : -1;
+        }
+        divisor /= 10;
+    }
+    while (nd < n_digits && fractionals > unit) {
+        fractionals *= 10;
+        unit *= 10;
+        digits[nd++] = '0' + (fractionals >> shift);
+        fractionals &= one - 1;
+    }
+    if (nd < n_digits) {
+        return -1;
+    }
+    return fp_grisu_round_counted(digits, nd, fractionals, one, unit, exp10) ? nd : -1;
+}
+
+// Add one to the last of the nd digits, carrying as needed.  Return the new
+// number of digits, which are 1 fewer for each 9 that carried.
+STATIC int fp_digits_round_up(char *digits, int nd, int *exp10) {
+    while (nd > 0 && digits[nd - 1] == '9') {
+        --nd;
+    }
+    if (nd == 0) {
+        digits[0] = '1';
+        *exp10 += 1;
+        return 1;
+    }
+    digits[nd - 1] += 1;
+    return nd;
+}
+
+// Write the decimal digits of f > 0, which must be finite, to digits, and
+// return how many there are.  *exp10 is set to the decimal exponent of the
+// first digit.  mode is one of FP_DIGITS_xxx, and rounded digits are cut at
+// max_digits.  Rounding is half to even, on the exact value of f.
+STATIC int fp_digits(FPTYPE f, int mode, int n, char *digits, int max_digits, int *exp10) {
+    int nd;
+    if (mode == FP_DIGITS_SHORTEST) {
+        nd = fp_grisu_shortest(f, digits, exp10);
+    } else {
+        nd = fp_grisu_counted(f, mode, n, digits, max_digits, exp10);
+    }
+    if (nd >= 0) {
+        return nd;
+    }
+
+    uint32_t r_d[BN_FORMAT_WORDS], s_d[BN_FORMAT_WORDS], mp_d[BN_FORMAT_WORDS];
+    uint32_t mm_d[BN_FORMAT_WORDS], t_d[BN_FORMAT_WORDS], u_d[BN_FORMAT_WORDS];
+    bn_t r = {0, r_d}, s = {0, s_d}, mp = {0, mp_d}, mm = {0, mm_d};
+    bn_t t = {0, t_d}, u = {0, u_d};
+
+    // With f = r / s, the points halfway to the floats either side are
+    // (r - mm) / s and (r + mp) / s.  Everything is scaled by 2 so these are
+    // integers, or by 4 at a power of 2 where the gap below is half the size.
+    fp_bits_t m;
+    int q;
+    int biased_exp = fp_split(f, &m, &q);
+    int unequal = biased_exp > 1 && m == FP_HIDDEN_BIT;
+    bool even = (m & 1) == 0;
+    bn_set_u64(&r, m);
+    bn_set_u64(&mm, 1);
+    if (q >= 0) {
+        bn_shl(&r, q + 1 + unequal);
+        bn_set_u64(&s, 2 << unequal);
+        bn_shl(&mm, q);
+    } else {
+        bn_shl(&r, 1 + unequal);
+        bn_set_u64(&s, 1);
+        bn_shl(&s, 1 + unequal - q);
+    }
+    bn_copy(&mp, &mm);
+    bn_shl(&mp, unequal);
+
+    // Estimate k = ceil(log10(f)) from the bit length of f, using 1233 / 4096
+    // for log10(2).  This is off by at most one, fixed below.
+    int e2 = q;
+    for (fp_bits_t bits = m; bits > 1; bits >>= 1) {
+        ++e2;
+    }
+    int k = e2 >= 0 ? (e2 * 1233 + 4095) >> 12 : -((-e2 * 1233) >> 12);
+    if (k >= 0) {
+        bn_mul_pow10(&s, k);
+    } else {
+        bn_mul_pow10(&r, -k);
+        bn_mul_pow10(&mp, -k);
+        bn_mul_pow10(&mm, -k);
+    }
+
+    // Make 10^(k-1) <= f < 10^k, or for the shortest digits put the upper
+    // halfway point below 10^k (or at it, if that reads back as f).
+    const bn_t *high = &r;
+    if (mode == FP_DIGITS_SHORTEST) {
+        bn_add(&t, &r, &mp);
+        high = &t;
+    }
+    int inclusive = mode != FP_DIGITS_SHORTEST || even;
+    while (bn_cmp(high, &s) >= !inclusive) {
+        bn_mul_add_small(&s, 10, 0);
+        ++k;
+    }
+    for (;;) {
+        bn_copy(&u, high);
+        bn_mul_add_small(&u, 10, 0);
+        if (bn_cmp(&u, &s) >= !inclusive) {
+            break;
+        }
+        bn_mul_add_small(&r, 10, 0);
+        bn_mul_add_small(&mp, 10, 0);
+        bn_mul_add_small(&mm, 10, 0);
+        if (high == &t) {
+            bn_add(&t, &r, &mp);
+        }
+        --k;
+    }
+    *exp10 = k - 1;
+
+    // shift so the top bit of s is set, as bn_div_digit needs
+    unsigned int shift = 0;
+    for (uint32_t top = s.d[s.len - 1]; !(top & 0x80000000); top <<= 1) {
+        ++shift;
+    }
+    bn_shl(&s, shift);
+    bn_shl(&r, shift);
+
+    nd = 0;
+    if (mode == FP_DIGITS_SHORTEST) {
+        bn_shl(&mp, shift);
+        bn_shl(&mm, shift);
+        for (;;) {
+            bn_mul_add_small(&r, 10, 0);
+            bn_mul_add_small(&mp, 10, 0);
+            bn_mul_add_small(&mm, 10, 0);
+            uint32_t d = bn_div_digit(&r, &s);
+            // can the digits stop here, at d or at d + 1?
+            bool stop_low = bn_cmp(&r, &mm) < even;
+            bn_add(&t, &r, &mp);
+            bool stop_high = bn_cmp(&t, &s) > -even;
+            digits[nd++] = '0' + d;
+            if (stop_low || stop_high) {
+                if (stop_high) {
+                    // take whichever of d and d + 1 is nearer to f
+                    bn_shl(&r, 1);
+                    int c = bn_cmp(&r, &s);
+                    if (!stop_low || c > 0 || (c == 0 && (d & 1))) {
+                        return fp_digits_round_up(digits, nd, exp10);
+                    }
+                }
+                return nd;
+            }
+        }
+    }
+
+    int n_digits = mode == FP_DIGITS_SIG ? n : k + n;
+    if (n_digits > max_digits) {
+        n_digits = max_digits;
+    }
+    if (n_digits < 0) {
+        // f rounds to zero
+        return 0;
+    }
+    for (; nd < n_digits; ++nd) {
+        bn_mul_add_small(&r, 10, 0);
+        digits[nd] = '0' + bn_div_digit(&r, &s);
+    }
+    // round on the remainder, half to even
+    bn_shl(&r, 1);
+    int c = bn_cmp(&r, &s);
+    if (c > 0 || (c == 0 && nd > 0 && (digits[nd - 1] & 1))) {
+        if (nd == 0) {
+            digits[0] = '1';
+            *exp10 = k;
+            return 1;
+        }
+        return fp_digits_round_up(digits, nd, exp10);
+    }
+    return nd;
+}
+
+/******************************************************************************/
+// layout of the digits
+
+// Write the digits with the decimal point after the digit of 10^0, and frac
+// digits after it, padding with zeros.
+STATIC char *fp_write_fixed(char *s, const char *digits, int nd, int exp10, int frac) {
+    int i = 0;
+    if (exp10 < 0) {
+        *s++ = '0';
+    } else {
+        for (; i <= exp10; ++i) {
+            *s++ = i < nd ? digits[i] : '0';
+        }
+    }
+    if (frac > 0) {
+        *s++ = '.';
+        for (int j = 1; j <= frac; ++j) {
+            i = exp10 + j;
+            *s++ = i >= 0 && i < nd ? digits[i] : '0';
+        }
+    }
+    return s;
+}
+
+STATIC int fp_fixed_len(int exp10, int frac) {
+    return (exp10 < 0 ? 1 : exp10 + 1) + (frac > 0 ? frac + 1 : 0);
+}
+
+// Write the digits as d.ddde+xx with frac digits after the decimal point,
+// padding with zeros.
+STATIC char *fp_write_exp(char *s, const char *digits, int nd, int exp10, int frac, char e_char) {
+    s = fp_write_fixed(s, digits, nd, 0, frac);
+    *s++ = e_char;
+    if (exp10 < 0) {
+        *s++ = '-';
+        exp10 = -exp10;
+    } else {
+        *s++ = '+';
+    }
+    if (exp10 >= 100) {
+        *s++ = '0' + exp10 / 100;
+    }
+    *s++ = '0' + exp10 / 10 % 10;
+    *s++ = '0' + exp10 % 10;
+    return s;
+}
+
+STATIC int fp_exp_len(int exp10, int frac) {
+    return 1 + (frac > 0 ? frac + 1 : 0) + (exp10 <= -100 || exp10 >= 100 ? 5 : 4);
+}
+
+STATIC int fp_strip_zeros(const char *digits, int nd) {
+    while (nd > 0 && digits[nd - 1] == '0') {
+        --nd;
+    }
+    return nd;
+}
+
+int mp_format_float(FPTYPE f, char *buf, size_t buf_size, char fmt, int prec, char sign) {
+    char *s = buf;
+
+    if (buf_size <= FPMIN_BUF_SIZE) {
+        // FPMIN_BUF_SIZE is the minimum size needed to store any FP number.
+        // If the buffer does not have enough room for this (plus null terminator)
+        // then don't try to format the float.
+
+        if (buf_size >= 2) {
+            *s++ = '?';
+        }
+        if (buf_size >= 1) {
+            *s = '\0';
+        }
+        return buf_size >= 2;
+    }
+    if (fp_signbit(f) && !fp_isnan(f)) {
+        *s++ = '-';
+        f = -f;
+    } else {
+        if (sign) {
+            *s++ = sign;
+        }
+    }
+
+    // buf_remaining contains bytes available for digits and exponent.
+    // It is buf_size minus room for the sign and null byte.
+    int buf_remaining = buf_size - 1 - (s - buf);
+
+    char uc = fmt & 0x20;
+    if (fp_isinf(f)) {
+        *s++ = 'I' ^ uc;
+        *s++ = 'N' ^ uc;
+        *s++ = 'F' ^ uc;
+        *s = '\0';
+        return s - buf;
+    } else if (fp_isnan(f)) {
+        *s++ = 'N' ^ uc;
+        *s++ = 'A' ^ uc;
+        *s++ = 'N' ^ uc;
+        *s = '\0';
+        return s - buf;
+    }
+
+    if (prec < 0) {
+        prec = 6;
+    }
+    char e_char = 'E' | uc;
+    fmt |= 0x20;
+
+    char digits[FP_DIGITS_BUF_SIZE];
+    int max_digits = MIN(FP_DIGITS_BUF_SIZE, buf_remaining);
+    int nd = 0;
+    int exp10 = 0;
+    bool zero = fp_iszero(f);
+
+    if (fmt == 'r') {
+        // the shortest digits that read back as f, laid out like 'g' but
+        // without losing digits
+        if (!zero) {
+            nd = fp_digits(f, FP_DIGITS_SHORTEST, 0, digits, max_digits, &exp10);
+        }
+        int frac = MAX(0, nd - 1 - exp10);
+        if (exp10 >= -4 && exp10 < FP_REPR_EXP_MIN && fp_fixed_len(exp10, frac) <= buf_remaining) {
+            s = fp_write_fixed(s, digits, nd, exp10, frac);
+        } else if (fp_exp_len(exp10, nd - 1) <= buf_remaining) {
+            s = fp_write_exp(s, digits, nd, exp10, nd - 1, e_char);
+        } else {
+            // the buffer is too small, so print as many digits as fit
+            fmt = 'g';
+            prec = nd;
+        }
+    }
+
+    if (fmt == 'f') {
+        for (;;) {
+            nd = zero ? 0 : fp_digits(f, FP_DIGITS_FRAC, prec, digits, max_digits, &exp10);
+            if (nd == 0) {
+                exp10 = 0;
+            }
+            if (exp10 + 1 >= buf_remaining) {
+                // too many integer digits, so use the exponent format
+                fmt = 'e';
+                break;
+            }
+            int len = fp_fixed_len(exp10, prec);
+            if (len <= buf_remaining) {
+                s = fp_write_fixed(s, digits, nd, exp10, prec);
+                break;
+            }
+            // fewer digits after the point, which may round into the integer part
+            prec -= len - buf_remaining;
+            if (prec < 0) {
+                prec = 0;
+            }
+        }
+    }
+
+    if (fmt == 'e') {
+        if (prec > buf_remaining - FPMIN_BUF_SIZE) {
+            prec = MAX(0, buf_remaining - FPMIN_BUF_SIZE);
+        }
+        if (zero) {
+            nd = 0;
+            exp10 = 0;
+        } else {
+            nd = fp_digits(f, FP_DIGITS_SIG, prec + 1, digits, max_digits, &exp10);
+        }
+        s = fp_write_exp(s, digits, nd, exp10, prec, e_char);
+    }
+
+    if (fmt == 'g') {
+        if (prec == 0) {
+            prec = 1;
+        }
+        if (prec > buf_remaining - (FPMIN_BUF_SIZE - 1)) {
+            prec = MAX(1, buf_remaining - (FPMIN_BUF_SIZE - 1));
+        }
+        for (;;) {
+            if (zero) {
+                nd = 0;
+                exp10 = 0;
+            } else {
+                nd = fp_digits(f, FP_DIGITS_SIG, prec, digits, max_digits, &exp10);
+                nd = fp_strip_zeros(digits, nd);
+            }
+            if (exp10 >= -4 && exp10 < prec) {
+                int frac = MAX(0, nd - 1 - exp10);
+                if (fp_fixed_len(exp10, frac) <= buf_remaining) {
+                    s = fp_write_fixed(s, digits, nd, exp10, frac);
+                    break;
+                }
+            } else if (fp_exp_len(exp10, nd - 1) <= buf_remaining) {
+                s = fp_write_exp(s, digits, nd, exp10, nd - 1, e_char);
+                break;
+            }
+            if (prec == 1) {
+                // can't happen with FPMIN_BUF_SIZE of room
+                break;
+            }
+            --prec;
+        }
+    }
+
+    *s = '\0';
+
+    // verify that we did not overrun the input buffer
+    assert((size_t)(s + 1 - buf) <= buf_size);
+
+    return s - buf;
+}
+
+/******************************************************************************/
+// decimal string to float
+
+// The float nearest to mant * 10^exp10, where mant has been rounded to n_mant
+// digits if inexact.  Return false if that may be wrong, in which case the
+// result is the correct float or the one below it.
+STATIC bool fp_diy_fp_strtod(uint64_t mant, int n_mant, bool inexact, int exp10, FPTYPE *result) {
+    // errors are in eighths of a unit of the last place of input.f
+    uint64_t error = inexact ? 4 : 0;
+    diy_fp_t input = {mant, 0};
+    diy_fp_t normalized = diy_fp_normalize(input);
+    error <<= input.e - normalized.e;
+    input = normalized;
+
+    int k;
+    int i = (exp10 + 348) / FP_CACHED_POW10_STEP;
+    diy_fp_t c = fp_cached_pow10(i, &k);
+    if (k != exp10) {
+        // 10^(exp10 - k) < 10^8 is exact in 64 bits
+        uint64_t adjust = 10;
+        for (int j = exp10 - k; j > 1; --j) {
+            adjust *= 10;
+        }
+        diy_fp_t a = {adjust, 0};
+        input = diy_fp_mul(input, diy_fp_normalize(a));
+        if (n_mant + exp10 - k > 19) {
+            error += 4;
+        }
+    }
+    input = diy_fp_mul(input, c);
+    // the cached power is within half a unit, the product rounded to half a
+    // unit, and the product of the errors rounded up
+    error += 4 + 4 + (error != 0);
+    normalized = diy_fp_normalize(input);
+    error <<= input.e - normalized.e;
+    input = normalized;
+
+    // the bits below the float's precision, which is less for subnormals
+    int order = 64 + input.e;
+    int precision_bits;
+    if (order >= 1 - FP_EXP_BIAS + FP_FRAC_BITS + 1) {
+        precision_bits = 64 - (FP_FRAC_BITS + 1);
+    } else if (order <= 1 - FP_EXP_BIAS) {
+        precision_bits = 64;
+    } else {
+        precision_bits = 64 - (order - (1 - FP_EXP_BIAS));
+    }
+    if (precision_bits + 3 >= 64) {
+        // too small a subnormal to work in eighths, so drop bits
+        int drop = precision_bits + 3 - 64 + 1;
+        input.f >>= drop;
+        input.e += drop;
+        error = (error >> drop) + 1 + 8;
+        precision_bits -= drop;
+    }
+    uint64_t mask = ((uint64_t)1 << precision_bits) - 1;
+    uint64_t low = (input.f & mask) * 8;
+    uint64_t half = ((uint64_t)1 << (precision_bits - 1)) * 8;
+    uint64_t m = input.f >> precision_bits;
+    int q = input.e + precision_bits;
+    if (low >= half + error) {
+        ++m;
+    }
+
+    // build the float from m * 2^q
+    if (m > 2 * FP_HIDDEN_BIT - 1) {
+        m >>= 1;
+        ++q;
+    }
+    if (q > (1 << FP_EXP_BITS) - 2 - FP_EXP_BIAS) {
+        *result = (FPTYPE)INFINITY;
+    } else if (q < 1 - FP_EXP_BIAS) {
+        *result = 0;
+    } else {
+        while (q > 1 - FP_EXP_BIAS && !(m & FP_HIDDEN_BIT)) {
+            m <<= 1;
+            --q;
+        }
+        union fp_bits u;
+        u.b = (m & (FP_HIDDEN_BIT - 1));
+        if (m & FP_HIDDEN_BIT) {
+            u.b |= (fp_bits_t)(q + FP_EXP_BIAS) << FP_FRAC_BITS;
+        }
+        *result = u.f;
+    }
+    return !(half - error < low && low < half + error);
+}
+
+// Compare the exact decimal value n * 10^n_exp10 with h * 2^h_exp2.
+STATIC int fp_cmp_halfway(const bn_t *n, int n_exp10, fp_bits_t h, int h_exp2) {
+    uint32_t a_d[BN_PARSE_WORDS], b_d[BN_PARSE_WORDS];
+    bn_t a = {0, a_d}, b = {0, b_d};
+    bn_copy(&a, n);
+    bn_set_u64(&b, h);
+    int a_exp2 = n_exp10;
+    if (n_exp10 >= 0) {
+        bn_mul_pow5(&a, n_exp10);
+    } else {
+        bn_mul_pow5(&b, -n_exp10);
+    }
+    if (a_exp2 > h_exp2) {
+        bn_shl(&a, a_exp2 - h_exp2);
+    } else {
+        bn_shl(&b, h_exp2 - a_exp2);
+    }
+    return bn_cmp(&a, &b);
+}
+
+mp_float_t mp_decimal_to_float(const char *str, const char *top, int exp10) {
+    // Read up to 19 significant digits into mant, so the value is about
+    // mant * 10^exp10, and exactly that if no digits are left over.
+    uint64_t mant = 0;
+    int n_mant = 0;
+    bool frac = false;
+    bool truncated = false;
+    bool round_up = false;
+    int n_rest = 0;
+    const char *first = NULL;
+    for (const char *p = str; p < top; ++p) {
+        unsigned int dig = *p - '0';
+        if (*p == '.') {
+            frac = true;
+        } else if (dig > 9 || (dig == 0 && first == NULL)) {
+            // a separator, or a leading zero
+            exp10 -= frac && dig == 0;
+        } else {
+            if (first == NULL) {
+                first = p;
+            }
+            if (n_mant < 19) {
+                mant = mant * 10 + dig;
+                ++n_mant;
+                exp10 -= frac;
+            } else {
+                exp10 += !frac;
+                truncated |= dig != 0;
+                if (n_rest++ == 0) {
+                    round_up = dig >= 5;
+                }
+            }
+        }
+    }
+
+    if (mant == 0) {
+        return 0;
+    }
+    int lead = exp10 + n_mant - 1;
+    if (lead > FP_DEC_EXP_MAX) {
+        return (mp_float_t)INFINITY;
+    }
+    if (lead < FP_DEC_EXP_MIN) {
+        return 0;
+    }
+
+    // Clinger's fast path: an exact mantissa times or divided by an exact
+    // power of 10 is correctly rounded.
+    if (!truncated && mant <= 2 * (uint64_t)FP_HIDDEN_BIT) {
+        if (exp10 >= 0 && exp10 <= FP_POW10_EXACT) {
+            return (FPTYPE)mant * fp_pow10[exp10];
+        }
+        if (exp10 < 0 && exp10 >= -FP_POW10_EXACT) {
+            return (FPTYPE)mant / fp_pow10[-exp10];
+        }
+        if (exp10 > FP_POW10_EXACT && exp10 <= 2 * FP_POW10_EXACT) {
+            // move some of the power into the mantissa, if it stays exact
+            uint64_t scaled = mant;
+            int i = exp10 - FP_POW10_EXACT;
+            for (; i > 0 && scaled <= 2 * (uint64_t)FP_HIDDEN_BIT; --i) {
+                scaled *= 10;
+            }
+            if (i == 0 && scaled <= 2 * (uint64_t)FP_HIDDEN_BIT) {
+                return (FPTYPE)scaled * fp_pow10[FP_POW10_EXACT];
+            }
+        }
+    }
+
+    // Try with 64 bits of precision, which also gives a starting point that
+    // is off by one float at most.
+    if (round_up) {
+        // round to the digits in mant
+        ++mant;
+    }
+    FPTYPE x;
+    if (fp_diy_fp_strtod(mant, n_mant, truncated, exp10, &x)) {
+        return x;
+    }
+    if (fp_isinf(x)) {
+        x = FP_MAX;
+    }
+
+    // The exact value is n * 10^n_exp10, where digits past the most that can
+    // affect the rounding are replaced by a nonzero digit if any are nonzero.
+    uint32_t n_d[BN_PARSE_WORDS];
+    bn_t n = {0, n_d};
+    int n_digits = 0;
+    truncated = false;
+    for (const char *p = first; p < top; ++p) {
+        unsigned int dig = *p - '0';
+        if (dig <= 9) {
+            if (n_digits < FP_PARSE_DIGITS_MAX) {
+                bn_mul_add_small(&n, 10, dig);
+                ++n_digits;
+            } else {
+                truncated |= dig != 0;
+            }
+        }
+    }
+    if (truncated) {
+        bn_mul_add_small(&n, 10, 1);
+        ++n_digits;
+    }
+    int n_exp10 = lead - (n_digits - 1);
+
+    // Step x to the float nearest to the exact value, comparing with the
+    // points halfway to the floats either side and rounding ties to even.
+    for (;;) {
+        fp_bits_t m;
+        int q;
+        int biased_exp = fp_split(x, &m, &q);
+        int c = fp_cmp_halfway(&n, n_exp10, 2 * m + 1, q - 1);
+        if (c > 0 || (c == 0 && (m & 1))) {
+            if (x == FP_MAX) {
+                return (mp_float_t)INFINITY;
+            }
+            x = fp_step(x, 1);
+            continue;
+        }
+        if (m == 0) {
+            return x;
+        }
+        if (biased_exp > 1 && m == FP_HIDDEN_BIT) {
+            c = fp_cmp_halfway(&n, n_exp10, 4 * m - 1, q - 2);
+        } else {
+            c = fp_cmp_halfway(&n, n_exp10, 2 * m - 1, q - 1);
+        }
+        if (c < 0 || (c == 0 && (m & 1))) {
+            x = fp_step(x, -1);
+            continue;
+        }
+        return x;
+    }
+}
+
+#else // MICROPY_FLOAT_EXACT_CONVERSION
+
+/***********************************************************************
+
+  Routine for converting a arbitrary floating
+  point number into a string.
+
+  The code in this funcion was inspired from Fred Bayer's pdouble.c.
+  Since pdouble.c was released as Public Domain, I'm releasing this
+  code as public domain as well.
+
+  The original code can be found in https://github.com/dhylands/format-float
+
+  Dave Hylands
+
+***********************************************************************/
+
 static const FPTYPE g_pos_pow[] = {
     #if FPDECEXP > 32
     MICROPY_FLOAT_CONST(1e256), MICROPY_FLOAT_CONST(1e128), MICROPY_FLOAT_CONST(1e64),
@@ -435,4 +1583,6 @@ int mp_format_float(FPTYPE f, char *buf, size_t buf_size, char fmt, int prec, ch
     return s - buf;
 }
 
+#endif // MICROPY_FLOAT_EXACT_CONVERSION
+
 #endif // MICROPY_FLOAT_IMPL != MICROPY_FLOAT_IMPL_NONE
@@ -94,6 +94,49 @@ STATIC const mp_raw_code_t *mp_find_frozen_mpy(const char *str, size_t len) {
     return NULL;
 }
 
+#if MICROPY_MODULE_FROZEN_ROM_GLOBALS
+
+// The namespaces of module i are mp_frozen_mpy_globals[j] for j from
+// mp_frozen_mpy_globals_index[i] up to mp_frozen_mpy_globals_index[i + 1], and
+// start out with the maps in mp_frozen_mpy_globals_rom[j].
+extern const uint16_t mp_frozen_mpy_globals_index[];
+extern const mp_map_t mp_frozen_mpy_globals_rom[];
+
+// If the module has its globals in ROM then make them the globals of module_obj,
+// keeping what the importer already stored in the latter.
+void mp_frozen_mpy_init_globals(mp_obj_t module_obj, const mp_raw_code_t *rc) {
+    size_t i = 0;
+    while (mp_frozen_mpy_content[i] != rc) {
+        ++i;
+    }
+    size_t start = mp_frozen_mpy_globals_index[i];
+    size_t end = mp_frozen_mpy_globals_index[i + 1];
+    if (start == end) {
+        return;
+    }
+
+    // a module that's imported again starts out as it was frozen
+    for (size_t j = start; j < end; ++j) {
+        mp_frozen_mpy_globals[j].map = mp_frozen_mpy_globals_rom[j];
+    }
+
+    mp_obj_module_t *module = MP_OBJ_TO_PTR(module_obj);
+    mp_obj_dict_t *globals = &mp_frozen_mpy_globals[start];
+    mp_map_t *map = &module->globals->map;
+    for (size_t j = 0; j < map->alloc; ++j) {
+        if (mp_map_slot_is_filled(map, j)) {
+            // a str equal to the frozen one, such as __path__, is left as it is
+            mp_map_elem_t *elem = mp_map_lookup(&globals->map, map->table[j].key, MP_MAP_LOOKUP);
+            if (elem == NULL || !mp_obj_equal(elem->value, map->table[j].value)) {
+                mp_obj_dict_store(MP_OBJ_FROM_PTR(globals), map->table[j].key, map->table[j].value);
+            }
+        }
+    }
+    module->globals = globals;
+}
+
+#endif
+
 #endif
 
 #if MICROPY_MODULE_FROZEN
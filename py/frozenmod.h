@@ -27,6 +27,7 @@
 #ifndef MICROPY_INCLUDED_PY_FROZENMOD_H
 #define MICROPY_INCLUDED_PY_FROZENMOD_H
 
+#include "py/obj.h"
 #include "py/lexer.h"
 
 enum {
@@ -39,4 +40,15 @@ int mp_find_frozen_module(const char *str, size_t len, void **data);
 const char *mp_find_frozen_str(const char *str, size_t *len);
 mp_import_stat_t mp_frozen_stat(const char *str);
 
+#if MICROPY_MODULE_FROZEN_MPY && MICROPY_MODULE_FROZEN_ROM_GLOBALS
+// The namespaces of frozen modules whose globals tools/mpy-tool.py put in ROM,
+// which are those globals and the locals of the classes frozen with them.
+// They live outside the heap and are copied into it when written to.
+extern mp_obj_dict_t mp_frozen_mpy_globals[];
+extern const size_t mp_frozen_mpy_globals_len;
+
+struct _mp_raw_code_t;
+void mp_frozen_mpy_init_globals(mp_obj_t module_obj, const struct _mp_raw_code_t *rc);
+#endif
+
 #endif // MICROPY_INCLUDED_PY_FROZENMOD_H
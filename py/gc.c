@@ -31,6 +31,25 @@
 
 #include "py/gc.h"
 #include "py/runtime.h"
+#include "py/trace.h"
+
+#if MICROPY_GC_INCREMENTAL || MICROPY_GC_STATS
+#include "py/mphal.h"
+#endif
+
+#if MICROPY_GC_ALLOC_PROFILE
+#include "py/bc.h"
+#endif
+
+#if MICROPY_GC_COMPACT
+#include "py/objarray.h"
+#include "py/objstr.h"
+#endif
+
+#if MICROPY_MODULE_FROZEN_MPY && MICROPY_MODULE_FROZEN_ROM_GLOBALS
+#include "py/frozenmod.h"
+#define FROZEN_GLOBALS_NUM_PTRS (mp_frozen_mpy_globals_len * sizeof(mp_obj_dict_t) / sizeof(void *))
+#endif
 
 #if MICROPY_ENABLE_GC
 
@@ -52,6 +71,8 @@
 #define WORDS_PER_BLOCK ((MICROPY_BYTES_PER_GC_BLOCK) / MP_BYTES_PER_OBJ_WORD)
 #define BYTES_PER_BLOCK (MICROPY_BYTES_PER_GC_BLOCK)
 
+// ATB = allocation table byte
+// 0b00 = FREE -- free block
 // ATB = allocation table byte
 // 0b00 = FREE -- free block
 // 0b01 = HEAD -- head of a chain of blocks
@@ -74,80 +95,372 @@
 #define ATB_2_IS_FREE(a) (((a) & ATB_MASK_2) == 0)
 #define ATB_3_IS_FREE(a) (((a) & ATB_MASK_3) == 0)
 
+// All the table macros below take the heap area that the block belongs to.
 #define BLOCK_SHIFT(block) (2 * ((block) & (BLOCKS_PER_ATB - 1)))
-#define ATB_GET_KIND(block) ((MP_STATE_MEM(gc_alloc_table_start)[(block) / BLOCKS_PER_ATB] >> BLOCK_SHIFT(block)) & 3)
-#define ATB_ANY_TO_FREE(block) do { MP_STATE_MEM(gc_alloc_table_start)[(block) / BLOCKS_PER_ATB] &= (~(AT_MARK << BLOCK_SHIFT(block))); } while (0)
-#define ATB_FREE_TO_HEAD(block) do { MP_STATE_MEM(gc_alloc_table_start)[(block) / BLOCKS_PER_ATB] |= (AT_HEAD << BLOCK_SHIFT(block)); } while (0)
-#define ATB_FREE_TO_TAIL(block) do { MP_STATE_MEM(gc_alloc_table_start)[(block) / BLOCKS_PER_ATB] |= (AT_TAIL << BLOCK_SHIFT(block)); } while (0)
-#define ATB_HEAD_TO_MARK(block) do { MP_STATE_MEM(gc_alloc_table_start)[(block) / BLOCKS_PER_ATB] |= (AT_MARK << BLOCK_SHIFT(block)); } while (0)
-#define ATB_MARK_TO_HEAD(block) do { MP_STATE_MEM(gc_alloc_table_start)[(block) / BLOCKS_PER_ATB] &= (~(AT_TAIL << BLOCK_SHIFT(block))); } while (0)
-
-#define BLOCK_FROM_PTR(ptr) (((byte *)(ptr) - MP_STATE_MEM(gc_pool_start)) / BYTES_PER_BLOCK)
-#define PTR_FROM_BLOCK(block) (((block) * BYTES_PER_BLOCK + (uintptr_t)MP_STATE_MEM(gc_pool_start)))
+#define ATB_GET_KIND(area, block) (((area)->gc_alloc_table_start[(block) / BLOCKS_PER_ATB] >> BLOCK_SHIFT(block)) & 3)
+#define ATB_ANY_TO_FREE(area, block) do { (area)->gc_alloc_table_start[(block) / BLOCKS_PER_ATB] &= (~(AT_MARK << BLOCK_SHIFT(block))); } while (0)
+#define ATB_FREE_TO_HEAD(area, block) do { (area)->gc_alloc_table_start[(block) / BLOCKS_PER_ATB] |= (AT_HEAD << BLOCK_SHIFT(block)); } while (0)
+#define ATB_FREE_TO_TAIL(area, block) do { (area)->gc_alloc_table_start[(block) / BLOCKS_PER_ATB] |= (AT_TAIL << BLOCK_SHIFT(block)); } while (0)
+#define ATB_HEAD_TO_MARK(area, block) do { (area)->gc_alloc_table_start[(block) / BLOCKS_PER_ATB] |= (AT_MARK << BLOCK_SHIFT(block)); } while (0)
+#define ATB_MARK_TO_HEAD(area, block) do { (area)->gc_alloc_table_start[(block) / BLOCKS_PER_ATB] &= (~(AT_TAIL << BLOCK_SHIFT(block))); } while (0)
+
+#if MICROPY_GC_INCREMENTAL
+// heads can stay marked in between the steps of an incremental collection
+#define ATB_IS_ALLOCATED_HEAD(area, block) (ATB_GET_KIND(area, block) == AT_HEAD || ATB_GET_KIND(area, block) == AT_MARK)
+#else
+#define ATB_IS_ALLOCATED_HEAD(area, block) (ATB_GET_KIND(area, block) == AT_HEAD)
+#endif
+
+#define BLOCK_FROM_PTR(area, ptr) (((byte *)(ptr) - (area)->gc_pool_start) / BYTES_PER_BLOCK)
+#define PTR_FROM_BLOCK(area, block) (((block) * BYTES_PER_BLOCK + (uintptr_t)(area)->gc_pool_start))
 #define ATB_FROM_BLOCK(bl) ((bl) / BLOCKS_PER_ATB)
 
+// number of blocks in the pool of an area
+#define AREA_NUM_BLOCKS(area) ((area)->gc_alloc_table_byte_len * BLOCKS_PER_ATB)
+
+#if MICROPY_GC_SPLIT_HEAP
+#define NEXT_AREA(area) ((area)->next)
+#else
+#define NEXT_AREA(area) (NULL)
+#endif
+
 #if MICROPY_ENABLE_FINALISER
 // FTB = finaliser table byte
 // if set, then the corresponding block may have a finaliser
 
 #define BLOCKS_PER_FTB (8)
 
-#define FTB_GET(block) ((MP_STATE_MEM(gc_finaliser_table_start)[(block) / BLOCKS_PER_FTB] >> ((block) & 7)) & 1)
-#define FTB_SET(block) do { MP_STATE_MEM(gc_finaliser_table_start)[(block) / BLOCKS_PER_FTB] |= (1 << ((block) & 7)); } while (0)
-#define FTB_CLEAR(block) do { MP_STATE_MEM(gc_finaliser_table_start)[(block) / BLOCKS_PER_FTB] &= (~(1 << ((block) & 7))); } while (0)
+#define FTB_GET(area, block) (((area)->gc_finaliser_table_start[(block) / BLOCKS_PER_FTB] >> ((block) & 7)) & 1)
+#define FTB_SET(area, block) do { (area)->gc_finaliser_table_start[(block) / BLOCKS_PER_FTB] |= (1 << ((block) & 7)); } while (0)
+#define FTB_CLEAR(area, block) do { (area)->gc_finaliser_table_start[(block) / BLOCKS_PER_FTB] &= (~(1 << ((block) & 7))); } while (0)
+#endif
+
+#if MICROPY_GC_GENERATIONAL
+// GTB = generation table byte
+// if set, then the corresponding head block survived a collection and belongs
+// to the old generation; minor collections neither mark nor sweep such blocks
+
+#define BLOCKS_PER_GTB (8)
+
+#define GTB_GET(area, block) (((area)->gc_generation_table_start[(block) / BLOCKS_PER_GTB] >> ((block) & 7)) & 1)
+#define GTB_SET(area, block) do { (area)->gc_generation_table_start[(block) / BLOCKS_PER_GTB] |= (1 << ((block) & 7)); } while (0)
+#define GTB_CLEAR(area, block) do { (area)->gc_generation_table_start[(block) / BLOCKS_PER_GTB] &= (~(1 << ((block) & 7))); } while (0)
+
+// during a minor collection old blocks are implicitly live and are not traced
+#define GC_IS_OLD_DURING_MINOR(area, block) (MP_STATE_MEM(gc_collect_minor) && GTB_GET(area, block))
+
+// RTB = remembered table byte
+// if set, then the corresponding old head block may hold pointers to young
+// blocks, because it was written to (see gc_write_barrier) or found as a root
+// since the last collection; a minor collection scans these blocks instead of
+// the whole old generation
+
+#define BLOCKS_PER_RTB (8)
+
+#define RTB_GET(area, block) (((area)->gc_remembered_table_start[(block) / BLOCKS_PER_RTB] >> ((block) & 7)) & 1)
+#define RTB_SET(area, block) do { (area)->gc_remembered_table_start[(block) / BLOCKS_PER_RTB] |= (1 << ((block) & 7)); } while (0)
+
+// The young blocks of an area all lie in the range [gc_young_start,
+// gc_young_end) of blocks allocated since the last collection, which is all
+// that a minor collection sweeps.
+STATIC inline void gc_young_extend(mp_state_mem_area_t *area, size_t start_block, size_t end_block) {
+    if (start_block < area->gc_young_start) {
+        area->gc_young_start = start_block;
+    }
+    if (end_block > area->gc_young_end) {
+        area->gc_young_end = end_block;
+    }
+}
+#else
+#define GC_IS_OLD_DURING_MINOR(area, block) (0)
+#endif
+
+#if MICROPY_GC_NO_SCAN
+// NTB = no-scan table byte
+// if set, then the corresponding head block holds raw data with no pointers
+// to the heap, so marking doesn't look for any in it
+
+#define BLOCKS_PER_NTB (8)
+
+#define NTB_GET(area, block) (((area)->gc_no_scan_table_start[(block) / BLOCKS_PER_NTB] >> ((block) & 7)) & 1)
+#define NTB_SET(area, block) do { (area)->gc_no_scan_table_start[(block) / BLOCKS_PER_NTB] |= (1 << ((block) & 7)); } while (0)
+#define NTB_CLEAR(area, block) do { (area)->gc_no_scan_table_start[(block) / BLOCKS_PER_NTB] &= (~(1 << ((block) & 7))); } while (0)
+#endif
+
+#if MICROPY_GC_INCREMENTAL
+// DTB = dirty table byte
+// if set, then the corresponding head block must be (re)scanned before an
+// incremental collection can finish; set for blocks allocated or written to
+// while an incremental collection is in progress
+
+#define BLOCKS_PER_DTB (8)
+
+#define DTB_GET(area, block) (((area)->gc_dirty_table_start[(block) / BLOCKS_PER_DTB] >> ((block) & 7)) & 1)
+#define DTB_SET(area, block) do { (area)->gc_dirty_table_start[(block) / BLOCKS_PER_DTB] |= (1 << ((block) & 7)); } while (0)
+#define DTB_CLEAR(area, block) do { (area)->gc_dirty_table_start[(block) / BLOCKS_PER_DTB] &= (~(1 << ((block) & 7))); } while (0)
+
+// number of blocks to scan between checks of the step deadline
+#define GC_STEP_CHECK_INTERVAL (16)
 #endif
 
 #if MICROPY_PY_THREAD && !MICROPY_PY_THREAD_GIL
-#define GC_ENTER() mp_thread_mutex_lock(&MP_STATE_MEM(gc_mutex), 1)
+#define GC_ENTER() do { mp_thread_mutex_lock(&MP_STATE_MEM(gc_mutex), 1); MP_STATE_MEM(gc_lock_count)++; } while (0)
 #define GC_EXIT() mp_thread_mutex_unlock(&MP_STATE_MEM(gc_mutex))
 #else
 #define GC_ENTER()
 #define GC_EXIT()
 #endif
 
+#if MICROPY_GC_SIZE_CLASSES
+// Size classes hold free runs of exactly 1, 2, 3 and 4 blocks, and the last
+// class holds runs of at least 8 blocks, which serves requests of 5 to 8 blocks.
+// Runs of 5 to 7 blocks are left to the linear scan of the allocation table.
+#define GC_NUM_SIZE_CLASSES (5)
+
+STATIC void gc_size_class_push(mp_state_mem_area_t *area, size_t block, size_t n_blocks) {
+    size_t cls;
+    if (n_blocks >= 8) {
+        cls = GC_NUM_SIZE_CLASSES - 1;
+    } else if (n_blocks >= 1 && n_blocks <= 4) {
+        cls = n_blocks - 1;
+    } else {
+        return;
+    }
+    uint8_t len = area->gc_size_class_len[cls];
+    if (len < MICROPY_GC_SIZE_CLASS_DEPTH) {
+        area->gc_size_class_block[cls][len] = block;
+        area->gc_size_class_len[cls] = len + 1;
+    }
+}
+
+// Take a free run of at least n_blocks (which must be 1 to 8) from the cache.
+// Allocations done by the linear scan and in-place growth of blocks don't
+// update the cache, so a cached run is only used if it is still free.
+STATIC bool gc_size_class_pop(mp_state_mem_area_t *area, size_t n_blocks, size_t *block_out) {
+    size_t cls = n_blocks <= 4 ? n_blocks - 1 : GC_NUM_SIZE_CLASSES - 1;
+    uint8_t *len = &area->gc_size_class_len[cls];
+    while (*len > 0) {
+        size_t block = area->gc_size_class_block[cls][--*len];
+        size_t n = 0;
+        while (n < n_blocks && ATB_GET_KIND(area, block + n) == AT_FREE) {
+            n += 1;
+        }
+        if (n == n_blocks) {
+            *block_out = block;
+            return true;
+        }
+    }
+    return false;
+}
+#endif
+
 // TODO waste less memory; currently requires that all entries in alloc_table have a corresponding block in pool
-void gc_init(void *start, void *end) {
+STATIC void gc_setup_area(mp_state_mem_area_t *area, void *start, void *end) {
     // align end pointer on block boundary
     end = (void *)((uintptr_t)end & (~(BYTES_PER_BLOCK - 1)));
     DEBUG_printf("Initializing GC heap: %p..%p = " UINT_FMT " bytes\n", start, end, (byte *)end - (byte *)start);
 
-    // calculate parameters for GC (T=total, A=alloc table, F=finaliser table, P=pool; all in bytes):
-    // T = A + F + P
+    // calculate parameters for GC (T=total, A=alloc table, F=finaliser table, G=generation table, R=remembered table, N=no-scan table, D=dirty table, P=pool; all in bytes):
+    // T = A + F + G + R + N + D + P
     //     F = A * BLOCKS_PER_ATB / BLOCKS_PER_FTB
+    //     G = A * BLOCKS_PER_ATB / BLOCKS_PER_GTB
+    //     R = A * BLOCKS_PER_ATB / BLOCKS_PER_RTB
+    //     N = A * BLOCKS_PER_ATB / BLOCKS_PER_NTB
+    //     D = A * BLOCKS_PER_ATB / BLOCKS_PER_DTB
     //     P = A * BLOCKS_PER_ATB * BYTES_PER_BLOCK
-    // => T = A * (1 + BLOCKS_PER_ATB / BLOCKS_PER_FTB + BLOCKS_PER_ATB * BYTES_PER_BLOCK)
+    // => T = A * (1 + BLOCKS_PER_ATB / BLOCKS_PER_FTB + BLOCKS_PER_ATB / BLOCKS_PER_GTB + BLOCKS_PER_ATB / BLOCKS_PER_RTB + BLOCKS_PER_ATB / BLOCKS_PER_NTB + BLOCKS_PER_ATB / BLOCKS_PER_DTB + BLOCKS_PER_ATB * BYTES_PER_BLOCK)
+    // (F, N and D are only present if the finaliser, no-scan and incremental options are enabled, G and R if the generational one is)
     size_t total_byte_len = (byte *)end - (byte *)start;
+    size_t bits_per_atb = MP_BITS_PER_BYTE + MP_BITS_PER_BYTE * BLOCKS_PER_ATB * BYTES_PER_BLOCK;
     #if MICROPY_ENABLE_FINALISER
-    MP_STATE_MEM(gc_alloc_table_byte_len) = total_byte_len * MP_BITS_PER_BYTE / (MP_BITS_PER_BYTE + MP_BITS_PER_BYTE * BLOCKS_PER_ATB / BLOCKS_PER_FTB + MP_BITS_PER_BYTE * BLOCKS_PER_ATB * BYTES_PER_BLOCK);
-    #else
-    MP_STATE_MEM(gc_alloc_table_byte_len) = total_byte_len / (1 + MP_BITS_PER_BYTE / 2 * BYTES_PER_BLOCK);
+    bits_per_atb += MP_BITS_PER_BYTE * BLOCKS_PER_ATB / BLOCKS_PER_FTB;
+    #endif
+    #if MICROPY_GC_GENERATIONAL
+    bits_per_atb += MP_BITS_PER_BYTE * BLOCKS_PER_ATB / BLOCKS_PER_GTB;
+    bits_per_atb += MP_BITS_PER_BYTE * BLOCKS_PER_ATB / BLOCKS_PER_RTB;
+    #endif
+    #if MICROPY_GC_NO_SCAN
+    bits_per_atb += MP_BITS_PER_BYTE * BLOCKS_PER_ATB / BLOCKS_PER_NTB;
+    #endif
+    #if MICROPY_GC_INCREMENTAL
+    bits_per_atb += MP_BITS_PER_BYTE * BLOCKS_PER_ATB / BLOCKS_PER_DTB;
     #endif
+    area->gc_alloc_table_byte_len = total_byte_len * MP_BITS_PER_BYTE / bits_per_atb;
 
-    MP_STATE_MEM(gc_alloc_table_start) = (byte *)start;
+    area->gc_alloc_table_start = (byte *)start;
+    byte *table_end = area->gc_alloc_table_start + area->gc_alloc_table_byte_len;
 
     #if MICROPY_ENABLE_FINALISER
-    size_t gc_finaliser_table_byte_len = (MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB + BLOCKS_PER_FTB - 1) / BLOCKS_PER_FTB;
-    MP_STATE_MEM(gc_finaliser_table_start) = MP_STATE_MEM(gc_alloc_table_start) + MP_STATE_MEM(gc_alloc_table_byte_len);
+    size_t gc_finaliser_table_byte_len = (area->gc_alloc_table_byte_len * BLOCKS_PER_ATB + BLOCKS_PER_FTB - 1) / BLOCKS_PER_FTB;
+    area->gc_finaliser_table_start = table_end;
+    table_end += gc_finaliser_table_byte_len;
     #endif
 
-    size_t gc_pool_block_len = MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB;
-    MP_STATE_MEM(gc_pool_start) = (byte *)end - gc_pool_block_len * BYTES_PER_BLOCK;
-    MP_STATE_MEM(gc_pool_end) = end;
+    #if MICROPY_GC_GENERATIONAL
+    size_t gc_generation_table_byte_len = (area->gc_alloc_table_byte_len * BLOCKS_PER_ATB + BLOCKS_PER_GTB - 1) / BLOCKS_PER_GTB;
+    area->gc_generation_table_start = table_end;
+    table_end += gc_generation_table_byte_len;
+    area->gc_remembered_table_byte_len = (area->gc_alloc_table_byte_len * BLOCKS_PER_ATB + BLOCKS_PER_RTB - 1) / BLOCKS_PER_RTB;
+    area->gc_remembered_table_start = table_end;
+    table_end += area->gc_remembered_table_byte_len;
+    #endif
 
-    #if MICROPY_ENABLE_FINALISER
-    assert(MP_STATE_MEM(gc_pool_start) >= MP_STATE_MEM(gc_finaliser_table_start) + gc_finaliser_table_byte_len);
+    #if MICROPY_GC_NO_SCAN
+    size_t gc_no_scan_table_byte_len = (area->gc_alloc_table_byte_len * BLOCKS_PER_ATB + BLOCKS_PER_NTB - 1) / BLOCKS_PER_NTB;
+    area->gc_no_scan_table_start = table_end;
+    table_end += gc_no_scan_table_byte_len;
+    #endif
+
+    #if MICROPY_GC_INCREMENTAL
+    area->gc_dirty_table_byte_len = (area->gc_alloc_table_byte_len * BLOCKS_PER_ATB + BLOCKS_PER_DTB - 1) / BLOCKS_PER_DTB;
+    area->gc_dirty_table_start = table_end;
+    table_end += area->gc_dirty_table_byte_len;
     #endif
 
+    size_t gc_pool_block_len = area->gc_alloc_table_byte_len * BLOCKS_PER_ATB;
+    area->gc_pool_start = (byte *)end - gc_pool_block_len * BYTES_PER_BLOCK;
+    area->gc_pool_end = end;
+
+    assert(area->gc_pool_start >= table_end);
+    (void)table_end;
+
     // clear ATBs
-    memset(MP_STATE_MEM(gc_alloc_table_start), 0, MP_STATE_MEM(gc_alloc_table_byte_len));
+    memset(area->gc_alloc_table_start, 0, area->gc_alloc_table_byte_len);
 
     #if MICROPY_ENABLE_FINALISER
     // clear FTBs
-    memset(MP_STATE_MEM(gc_finaliser_table_start), 0, gc_finaliser_table_byte_len);
+    memset(area->gc_finaliser_table_start, 0, gc_finaliser_table_byte_len);
+    #endif
+
+    #if MICROPY_GC_GENERATIONAL
+    // clear GTBs, all blocks start out in the young generation
+    memset(area->gc_generation_table_start, 0, gc_generation_table_byte_len);
+    // clear RTBs
+    memset(area->gc_remembered_table_start, 0, area->gc_remembered_table_byte_len);
+    // nothing is allocated yet
+    area->gc_young_start = gc_pool_block_len;
+    area->gc_young_end = 0;
+    #endif
+
+    #if MICROPY_GC_NO_SCAN
+    // clear NTBs
+    memset(area->gc_no_scan_table_start, 0, gc_no_scan_table_byte_len);
+    #endif
+
+    #if MICROPY_GC_INCREMENTAL
+    // clear DTBs
+    memset(area->gc_dirty_table_start, 0, area->gc_dirty_table_byte_len);
+    #endif
+
+    #if MICROPY_GC_SIZE_CLASSES
+    // the whole area is a single free run
+    memset(area->gc_size_class_len, 0, sizeof(area->gc_size_class_len));
+    gc_size_class_push(area, 0, gc_pool_block_len);
     #endif
 
     // set last free ATB index to start of heap
-    MP_STATE_MEM(gc_last_free_atb_index) = 0;
+    area->gc_last_free_atb_index = 0;
+    area->gc_last_run_atb_index = 0;
+
+    #if MICROPY_GC_SPLIT_HEAP
+    area->next = NULL;
+    area->flags = 0;
+    #endif
+
+    DEBUG_printf("GC layout:\n");
+    DEBUG_printf("  alloc table at %p, length " UINT_FMT " bytes, " UINT_FMT " blocks\n", area->gc_alloc_table_start, area->gc_alloc_table_byte_len, area->gc_alloc_table_byte_len * BLOCKS_PER_ATB);
+    #if MICROPY_ENABLE_FINALISER
+    DEBUG_printf("  finaliser table at %p, length " UINT_FMT " bytes, " UINT_FMT " blocks\n", area->gc_finaliser_table_start, gc_finaliser_table_byte_len, gc_finaliser_table_byte_len * BLOCKS_PER_FTB);
+    #endif
+    #if MICROPY_GC_GENERATIONAL
+    DEBUG_printf("  generation table at %p, length " UINT_FMT " bytes, " UINT_FMT " blocks\n", area->gc_generation_table_start, gc_generation_table_byte_len, gc_generation_table_byte_len * BLOCKS_PER_GTB);
+    DEBUG_printf("  remembered table at %p, length " UINT_FMT " bytes, " UINT_FMT " blocks\n", area->gc_remembered_table_start, area->gc_remembered_table_byte_len, area->gc_remembered_table_byte_len * BLOCKS_PER_RTB);
+    #endif
+    #if MICROPY_GC_NO_SCAN
+    DEBUG_printf("  no-scan table at %p, length " UINT_FMT " bytes, " UINT_FMT " blocks\n", area->gc_no_scan_table_start, gc_no_scan_table_byte_len, gc_no_scan_table_byte_len * BLOCKS_PER_NTB);
+    #endif
+    #if MICROPY_GC_INCREMENTAL
+    DEBUG_printf("  dirty table at %p, length " UINT_FMT " bytes, " UINT_FMT " blocks\n", area->gc_dirty_table_start, area->gc_dirty_table_byte_len, area->gc_dirty_table_byte_len * BLOCKS_PER_DTB);
+    #endif
+    DEBUG_printf("  pool at %p, length " UINT_FMT " bytes, " UINT_FMT " blocks\n", area->gc_pool_start, gc_pool_block_len * BYTES_PER_BLOCK, gc_pool_block_len);
+}
+
+#if MICROPY_GC_ALLOC_PROFILE
+// Choose the number of allocations until the next sample, at random between
+// 1 and twice the period so that the samples don't follow the pattern of
+// allocations of a loop.
+STATIC void gc_alloc_profile_next(void) {
+    // xorshift32
+    uint32_t x = MP_STATE_MEM(gc_alloc_profile_seed);
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    MP_STATE_MEM(gc_alloc_profile_seed) = x;
+    MP_STATE_MEM(gc_alloc_profile_countdown) = 1 + x % (2 * MICROPY_GC_ALLOC_PROFILE_PERIOD - 1);
+}
+
+STATIC void gc_alloc_profile_reset(void) {
+    MP_STATE_MEM(gc_alloc_profile_seed) = 0x2545f491;
+    MP_STATE_MEM(gc_alloc_profile_len) = 0;
+    gc_alloc_profile_next();
+}
+#endif
+
+void gc_init(void *start, void *end) {
+    gc_setup_area(&MP_STATE_MEM(area), start, end);
+
+    #if MICROPY_GC_GENERATIONAL
+    MP_STATE_MEM(gc_collect_minor) = 0;
+    MP_STATE_MEM(gc_minor_requested) = 0;
+    MP_STATE_MEM(gc_minor_since_major) = 0;
+    MP_STATE_MEM(gc_minor_count) = 0;
+    MP_STATE_MEM(gc_major_count) = 0;
+    #endif
+
+    #if MICROPY_GC_PARALLEL_MARK
+    MP_STATE_MEM(gc_parallel_active) = 0;
+    MP_STATE_MEM(gc_mark_pool).len = 0;
+    #endif
+
+    #if MICROPY_GC_INCREMENTAL
+    // no incremental collection is in progress
+    MP_STATE_MEM(gc_incremental_active) = 0;
+    MP_STATE_MEM(gc_step_budgeted) = 0;
+    MP_STATE_MEM(gc_step_expired) = 0;
+    MP_STATE_MEM(gc_sp) = 0;
+    #endif
+
+    #if MICROPY_GC_ARENA
+    MP_STATE_MEM(gc_arena_list) = NULL;
+    MP_STATE_THREAD(gc_arena) = NULL;
+    MP_STATE_THREAD(gc_arena_suspended) = false;
+    #endif
+
+    #if MICROPY_GC_ALLOC_PROFILE
+    gc_alloc_profile_reset();
+    #endif
+
+    #if MICROPY_FLOAT_FREELIST
+    MP_STATE_MEM(float_freelist) = NULL;
+    MP_STATE_MEM(float_freelist_len) = 0;
+    #endif
+
+    #if MICROPY_GC_POOL
+    memset(MP_STATE_MEM(gc_pool), 0, sizeof(MP_STATE_MEM(gc_pool)));
+    memset(MP_STATE_MEM(gc_pool_len), 0, sizeof(MP_STATE_MEM(gc_pool_len)));
+    MP_STATE_MEM(gc_pool_num_types) = 0;
+    #endif
+
+    #if MICROPY_GC_STATS
+    memset(&MP_STATE_MEM(gc_stats), 0, sizeof(MP_STATE_MEM(gc_stats)));
+    #endif
+
+    #if MICROPY_GC_TLAB
+    MP_STATE_MEM(gc_tlab_list) = NULL;
+    MP_STATE_MEM(gc_tlab_count) = 0;
+    MP_STATE_THREAD(gc_tlab).cur = NULL;
+    MP_STATE_THREAD(gc_tlab).end = NULL;
+    #endif
 
     // unlock the GC
     MP_STATE_THREAD(gc_lock_depth) = 0;
@@ -163,15 +476,26 @@ void gc_init(void *start, void *end) {
 
     #if MICROPY_PY_THREAD && !MICROPY_PY_THREAD_GIL
     mp_thread_mutex_init(&MP_STATE_MEM(gc_mutex));
+    MP_STATE_MEM(gc_lock_count) = 0;
     #endif
+}
 
-    DEBUG_printf("GC layout:\n");
-    DEBUG_printf("  alloc table at %p, length " UINT_FMT " bytes, " UINT_FMT " blocks\n", MP_STATE_MEM(gc_alloc_table_start), MP_STATE_MEM(gc_alloc_table_byte_len), MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB);
-    #if MICROPY_ENABLE_FINALISER
-    DEBUG_printf("  finaliser table at %p, length " UINT_FMT " bytes, " UINT_FMT " blocks\n", MP_STATE_MEM(gc_finaliser_table_start), gc_finaliser_table_byte_len, gc_finaliser_table_byte_len * BLOCKS_PER_FTB);
-    #endif
-    DEBUG_printf("  pool at %p, length " UINT_FMT " bytes, " UINT_FMT " blocks\n", MP_STATE_MEM(gc_pool_start), gc_pool_block_len * BYTES_PER_BLOCK, gc_pool_block_len);
+#if MICROPY_GC_SPLIT_HEAP
+void gc_add_region(void *start, void *end, unsigned int flags) {
+    // the area structure is stored at the start of the region itself
+    mp_state_mem_area_t *area = (mp_state_mem_area_t *)(((uintptr_t)start + sizeof(void *) - 1) & ~(sizeof(void *) - 1));
+    gc_setup_area(area, area + 1, end);
+    area->flags = flags;
+
+    GC_ENTER();
+    mp_state_mem_area_t *prev = &MP_STATE_MEM(area);
+    while (prev->next != NULL) {
+        prev = prev->next;
+    }
+    prev->next = area;
+    GC_EXIT();
 }
+#endif
 
 void gc_lock(void) {
     // This does not need to be atomic or have the GC mutex because:
@@ -191,12 +515,23 @@ bool gc_is_locked(void) {
 }
 
 // ptr should be of type void*
-#define VERIFY_PTR(ptr) ( \
+#define VERIFY_PTR(area, ptr) ( \
     ((uintptr_t)(ptr) & (BYTES_PER_BLOCK - 1)) == 0          /* must be aligned on a block */ \
-    && ptr >= (void *)MP_STATE_MEM(gc_pool_start)        /* must be above start of pool */ \
-    && ptr < (void *)MP_STATE_MEM(gc_pool_end)           /* must be below end of pool */ \
+    && ptr >= (void *)(area)->gc_pool_start              /* must be above start of pool */ \
+    && ptr < (void *)(area)->gc_pool_end                 /* must be below end of pool */ \
     )
 
+// Returns the heap area that ptr points in to, or NULL if it's not a valid
+// pointer to the start of a block.
+STATIC inline mp_state_mem_area_t *gc_get_ptr_area(const void *ptr) {
+    for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+        if (VERIFY_PTR(area, ptr)) {
+            return area;
+        }
+    }
+    return NULL;
+}
+
 #ifndef TRACE_MARK
 #if DEBUG_PRINT
 #define TRACE_MARK(block, ptr) DEBUG_printf("gc_mark(%p)\n", ptr)
@@ -205,33 +540,132 @@ bool gc_is_locked(void) {
 #endif
 #endif
 
+#if MICROPY_GC_ARENA
+// Arena allocations are aligned enough for any object, and the header takes
+// whole blocks so that the allocations never start in the arena's head block.
+#define GC_ARENA_ALIGN (8)
+#define GC_ARENA_HEADER_SIZE ((sizeof(mp_gc_arena_t) + BYTES_PER_BLOCK - 1) & ~(BYTES_PER_BLOCK - 1))
+#define GC_ARENA_NEXT(arena) ((mp_gc_arena_t *)~(arena)->next_inv)
+
+// Returns the arena that ptr points into the allocations of, or NULL.
+STATIC mp_gc_arena_t *gc_arena_find(const void *ptr) {
+    for (mp_gc_arena_t *arena = MP_STATE_MEM(gc_arena_list); arena != NULL; arena = GC_ARENA_NEXT(arena)) {
+        if ((const byte *)ptr >= (byte *)arena + GC_ARENA_HEADER_SIZE && (const byte *)ptr < (byte *)arena + arena->end) {
+            return arena;
+        }
+    }
+    return NULL;
+}
+
+// Like gc_get_ptr_area, but a pointer into the allocations of an arena is
+// changed to point to the arena itself, so the arena is kept alive as a whole.
+STATIC inline mp_state_mem_area_t *gc_get_mark_ptr_area(void **ptr) {
+    if (MP_STATE_MEM(gc_arena_list) != NULL) {
+        mp_gc_arena_t *arena = gc_arena_find(*ptr);
+        if (arena != NULL) {
+            #if MICROPY_GC_ARENA_CHECK
+            if (arena->base == MP_STATE_MEM(gc_arena_checked)) {
+                MP_STATE_MEM(gc_arena_checked_found) = true;
+            }
+            #endif
+            *ptr = arena;
+        }
+    }
+    return gc_get_ptr_area(*ptr);
+}
+#define GC_GET_MARK_PTR_AREA(ptr) gc_get_mark_ptr_area(&(ptr))
+#else
+#define GC_GET_MARK_PTR_AREA(ptr) gc_get_ptr_area(ptr)
+#endif
+
+#if MICROPY_GC_COMPACT
+// A buffer that gc_compact may move.  The addresses are stored inverted so
+// that the scan for references to the buffer doesn't find these ones.
+typedef struct _gc_compact_candidate_t {
+    uintptr_t start_inv;
+    uintptr_t slot_inv; // the object's pointer to the buffer
+    size_t n_bytes;
+    bool pinned;
+} gc_compact_candidate_t;
+
+// During the scan of gc_compact this is called for every word that's traced:
+// a value pointing anywhere into a candidate pins it, unless it's the
+// candidate's own slot.
+STATIC void gc_compact_check(void **slot) {
+    uintptr_t ptr = (uintptr_t)*slot;
+    gc_compact_candidate_t *c = MP_STATE_MEM(gc_compact_candidates);
+    for (size_t i = MP_STATE_MEM(gc_compact_num_candidates); i > 0; i--, c++) {
+        if (ptr - ~c->start_inv < c->n_bytes && (uintptr_t)slot != ~c->slot_inv) {
+            c->pinned = true;
+        }
+    }
+}
+#define GC_COMPACT_CHECK(slot) do { if (MP_STATE_MEM(gc_compact_candidates) != NULL) { gc_compact_check(slot); } } while (0)
+#else
+#define GC_COMPACT_CHECK(slot)
+#endif
+
+#if MICROPY_GC_INCREMENTAL
+// Returns true if the current incremental step has used up its time budget.
+STATIC bool gc_step_budget_exhausted(void) {
+    if (!MP_STATE_MEM(gc_step_budgeted)) {
+        return false;
+    }
+    if (MP_STATE_MEM(gc_step_expired)) {
+        return true;
+    }
+    if (++MP_STATE_MEM(gc_step_work) % GC_STEP_CHECK_INTERVAL != 0) {
+        return false;
+    }
+    MP_STATE_MEM(gc_step_expired) = mp_hal_ticks_us() - MP_STATE_MEM(gc_step_start_us) >= MP_STATE_MEM(gc_step_budget_us);
+    return MP_STATE_MEM(gc_step_expired);
+}
+#endif
+
 // Take the given block as the topmost block on the stack. Check all it's
 // children: mark the unmarked child blocks and put those newly marked
 // blocks on the stack. When all children have been checked, pop off the
 // topmost block on the stack and repeat with that one.
-STATIC void gc_mark_subtree(size_t block) {
+STATIC void MICROPY_WRAP_GC_MARK_SUBTREE(gc_mark_subtree)(mp_state_mem_area_t *area, size_t block) {
     // Start with the block passed in the argument.
+    #if MICROPY_GC_INCREMENTAL
+    // The stack may hold blocks left over from a previous incremental step.
+    size_t sp = MP_STATE_MEM(gc_sp);
+    #else
     size_t sp = 0;
+    #endif
     for (;;) {
-        // work out number of consecutive blocks in the chain starting with this one
+        // work out number of consecutive blocks in the chain starting with this
+        // one, a block without pointers is left as none
         size_t n_blocks = 0;
-        do {
-            n_blocks += 1;
-        } while (ATB_GET_KIND(block + n_blocks) == AT_TAIL);
+        #if MICROPY_GC_NO_SCAN
+        if (!NTB_GET(area, block))
+        #endif
+        {
+            do {
+                n_blocks += 1;
+            } while (ATB_GET_KIND(area, block + n_blocks) == AT_TAIL);
+        }
 
         // check this block's children
-        void **ptrs = (void **)PTR_FROM_BLOCK(block);
+        void **ptrs = (void **)PTR_FROM_BLOCK(area, block);
         for (size_t i = n_blocks * BYTES_PER_BLOCK / sizeof(void *); i > 0; i--, ptrs++) {
+            GC_COMPACT_CHECK(ptrs);
             void *ptr = *ptrs;
-            if (VERIFY_PTR(ptr)) {
+            mp_state_mem_area_t *ptr_area = GC_GET_MARK_PTR_AREA(ptr);
+            if (ptr_area != NULL) {
                 // Mark and push this pointer
-                size_t childblock = BLOCK_FROM_PTR(ptr);
-                if (ATB_GET_KIND(childblock) == AT_HEAD) {
+                size_t childblock = BLOCK_FROM_PTR(ptr_area, ptr);
+                if (ATB_GET_KIND(ptr_area, childblock) == AT_HEAD && !GC_IS_OLD_DURING_MINOR(ptr_area, childblock)) {
                     // an unmarked head, mark it, and push it on gc stack
                     TRACE_MARK(childblock, ptr);
-                    ATB_HEAD_TO_MARK(childblock);
+                    ATB_HEAD_TO_MARK(ptr_area, childblock);
                     if (sp < MICROPY_ALLOC_GC_STACK_SIZE) {
-                        MP_STATE_MEM(gc_stack)[sp++] = childblock;
+                        MP_STATE_MEM(gc_stack)[sp] = childblock;
+                        #if MICROPY_GC_SPLIT_HEAP
+                        MP_STATE_MEM(gc_area_stack)[sp] = ptr_area;
+                        #endif
+                        sp += 1;
                     } else {
                         MP_STATE_MEM(gc_stack_overflow) = 1;
                     }
@@ -244,199 +678,1803 @@ STATIC void gc_mark_subtree(size_t block) {
             break; // No, stack is empty, we're done.
         }
 
-        // pop the next block off the stack
-        block = MP_STATE_MEM(gc_stack)[--sp];
+        #if MICROPY_GC_INCREMENTAL
+        if (gc_step_budget_exhausted()) {
+            break; // Out of time, leave the rest of the stack for the next step.
+        }
+        #endif
+
+        // pop the next block off the stack
+        sp -= 1;
+        block = MP_STATE_MEM(gc_stack)[sp];
+        #if MICROPY_GC_SPLIT_HEAP
+        area = MP_STATE_MEM(gc_area_stack)[sp];
+        #endif
+    }
+    #if MICROPY_GC_INCREMENTAL
+    MP_STATE_MEM(gc_sp) = sp;
+    #endif
+}
+
+STATIC void gc_deal_with_stack_overflow(void) {
+    while (MP_STATE_MEM(gc_stack_overflow)) {
+        MP_STATE_MEM(gc_stack_overflow) = 0;
+
+        // scan entire memory looking for blocks which have been marked but not their children
+        for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+            for (size_t block = 0; block < AREA_NUM_BLOCKS(area); block++) {
+                // trace (again) if mark bit set
+                if (ATB_GET_KIND(area, block) == AT_MARK) {
+                    gc_mark_subtree(area, block);
+                }
+            }
+        }
+    }
+}
+
+#if MICROPY_GC_PARALLEL_MARK
+// The parallel mark phase runs the same depth-first marking as gc_mark_subtree
+// on two workers, each with a private stack.  A worker whose stack fills up
+// moves half of it to the shared pool, and a worker that runs out of work
+// takes half of the pool, so the rescan of the heap for a stack overflow is
+// only needed when the pool is full as well.  Marks are set with the lock
+// held because neighbouring blocks share an allocation table byte, and the
+// table is only accessed with single byte atomics while both workers run.
+
+// Heads only ever change to marked during this phase, so a kind read without
+// the lock is either current or a head that the other worker has just marked.
+#define ATB_GET_KIND_SHARED(area, block) ((__atomic_load_n(&(area)->gc_alloc_table_start[(block) / BLOCKS_PER_ATB], __ATOMIC_RELAXED) >> BLOCK_SHIFT(block)) & 3)
+
+STATIC void gc_mark_stack_push(mp_gc_mark_stack_t *stack, mp_state_mem_area_t *area, size_t block) {
+    stack->block[stack->len] = block;
+    #if MICROPY_GC_SPLIT_HEAP
+    stack->area[stack->len] = area;
+    #else
+    (void)area;
+    #endif
+    stack->len += 1;
+}
+
+// Move up to n entries from the top of one stack to another, returning the
+// number moved.
+STATIC size_t gc_mark_stack_move(mp_gc_mark_stack_t *from, mp_gc_mark_stack_t *to, size_t n) {
+    n = MIN(n, MIN(from->len, MICROPY_ALLOC_GC_STACK_SIZE - to->len));
+    for (size_t i = 0; i < n; i++) {
+        from->len -= 1;
+        to->block[to->len] = from->block[from->len];
+        #if MICROPY_GC_SPLIT_HEAP
+        to->area[to->len] = from->area[from->len];
+        #endif
+        to->len += 1;
+    }
+    return n;
+}
+
+// Returns true if this call marked the block, false if it was already marked.
+STATIC bool gc_parallel_try_mark(mp_state_mem_area_t *area, size_t block) {
+    byte *atb = &area->gc_alloc_table_start[block / BLOCKS_PER_ATB];
+    bool marked = false;
+    gc_parallel_lock();
+    byte a = __atomic_load_n(atb, __ATOMIC_RELAXED);
+    if (((a >> BLOCK_SHIFT(block)) & 3) == AT_HEAD) {
+        __atomic_store_n(atb, a | (AT_MARK << BLOCK_SHIFT(block)), __ATOMIC_RELAXED);
+        marked = true;
+    }
+    gc_parallel_unlock();
+    return marked;
+}
+
+// The caller must have counted this worker in gc_parallel_busy.
+STATIC void gc_parallel_mark_worker(mp_gc_mark_stack_t *stack) {
+    for (;;) {
+        while (stack->len > 0) {
+            if (stack->len > 1 && __atomic_load_n(&MP_STATE_MEM(gc_mark_pool).len, __ATOMIC_RELAXED) == 0) {
+                // keep the other worker supplied while there's work to spare
+                gc_parallel_lock();
+                gc_mark_stack_move(stack, &MP_STATE_MEM(gc_mark_pool), stack->len / 2);
+                gc_parallel_unlock();
+            }
+            stack->len -= 1;
+            size_t block = stack->block[stack->len];
+            #if MICROPY_GC_SPLIT_HEAP
+            mp_state_mem_area_t *area = stack->area[stack->len];
+            #else
+            mp_state_mem_area_t *area = &MP_STATE_MEM(area);
+            #endif
+
+            // work out number of consecutive blocks in the chain starting with this one
+            size_t n_blocks = 0;
+            #if MICROPY_GC_NO_SCAN
+            if (!NTB_GET(area, block))
+            #endif
+            {
+                do {
+                    n_blocks += 1;
+                } while (ATB_GET_KIND_SHARED(area, block + n_blocks) == AT_TAIL);
+            }
+
+            // check this block's children
+            void **ptrs = (void **)PTR_FROM_BLOCK(area, block);
+            for (size_t i = n_blocks * BYTES_PER_BLOCK / sizeof(void *); i > 0; i--, ptrs++) {
+                void *ptr = *ptrs;
+                mp_state_mem_area_t *ptr_area = GC_GET_MARK_PTR_AREA(ptr);
+                if (ptr_area == NULL) {
+                    continue;
+                }
+                size_t childblock = BLOCK_FROM_PTR(ptr_area, ptr);
+                // heads only ever change to marked during this phase, so only
+                // take the lock for blocks that look unmarked
+                if (ATB_GET_KIND_SHARED(ptr_area, childblock) != AT_HEAD || GC_IS_OLD_DURING_MINOR(ptr_area, childblock)
+                    || !gc_parallel_try_mark(ptr_area, childblock)) {
+                    continue;
+                }
+                TRACE_MARK(childblock, ptr);
+                if (stack->len == MICROPY_ALLOC_GC_STACK_SIZE) {
+                    // share half of the work, if there's no room then the
+                    // heap must be rescanned once marking is done
+                    gc_parallel_lock();
+                    if (gc_mark_stack_move(stack, &MP_STATE_MEM(gc_mark_pool), MICROPY_ALLOC_GC_STACK_SIZE / 2) == 0) {
+                        MP_STATE_MEM(gc_stack_overflow) = 1;
+                    }
+                    gc_parallel_unlock();
+                }
+                if (stack->len < MICROPY_ALLOC_GC_STACK_SIZE) {
+                    gc_mark_stack_push(stack, ptr_area, childblock);
+                }
+            }
+        }
+
+        // Out of work, take some from the pool, or finish when neither the
+        // pool nor any other worker has any left.
+        bool idle = false;
+        for (;;) {
+            gc_parallel_lock();
+            size_t n = gc_mark_stack_move(&MP_STATE_MEM(gc_mark_pool), stack, (MP_STATE_MEM(gc_mark_pool).len + 1) / 2);
+            if (n > 0 && idle) {
+                MP_STATE_MEM(gc_parallel_busy) += 1;
+            } else if (n == 0 && !idle) {
+                MP_STATE_MEM(gc_parallel_busy) -= 1;
+                idle = true;
+            }
+            bool done = n == 0 && MP_STATE_MEM(gc_parallel_busy) == 0;
+            gc_parallel_unlock();
+            if (n > 0) {
+                break;
+            }
+            if (done) {
+                return;
+            }
+        }
+    }
+}
+
+enum {
+    GC_PARALLEL_HELPER_NONE,
+    GC_PARALLEL_HELPER_STARTING,
+    GC_PARALLEL_HELPER_RUNNING,
+};
+
+void gc_parallel_mark_helper(void) {
+    // Join the mark phase unless the collector finished or gave up on us
+    // before we got here.
+    gc_parallel_lock();
+    bool join = MP_STATE_MEM(gc_parallel_helper_state) == GC_PARALLEL_HELPER_STARTING;
+    if (join) {
+        MP_STATE_MEM(gc_parallel_helper_state) = GC_PARALLEL_HELPER_RUNNING;
+        MP_STATE_MEM(gc_parallel_busy) += 1;
+    }
+    gc_parallel_unlock();
+    if (!join) {
+        return;
+    }
+    gc_parallel_mark_worker(&MP_STATE_MEM(gc_mark_stacks)[1]);
+    gc_parallel_lock();
+    MP_STATE_MEM(gc_parallel_helper_state) = GC_PARALLEL_HELPER_NONE;
+    gc_parallel_unlock();
+}
+
+// Mark everything reachable from the blocks put in the pool by gc_collect_root.
+STATIC void gc_parallel_mark(void) {
+    MP_STATE_MEM(gc_parallel_active) = 0;
+    MP_STATE_MEM(gc_parallel_busy) = 1;
+    MP_STATE_MEM(gc_parallel_helper_state) = GC_PARALLEL_HELPER_STARTING;
+    MP_STATE_MEM(gc_mark_stacks)[0].len = 0;
+    MP_STATE_MEM(gc_mark_stacks)[1].len = 0;
+    if (!gc_parallel_helper_start()) {
+        MP_STATE_MEM(gc_parallel_helper_state) = GC_PARALLEL_HELPER_NONE;
+    }
+    gc_parallel_mark_worker(&MP_STATE_MEM(gc_mark_stacks)[0]);
+    // A helper that hasn't joined yet is told not to, so there's only a wait
+    // for one that is still running; it has to return before anything else
+    // uses the heap.
+    for (;;) {
+        gc_parallel_lock();
+        if (MP_STATE_MEM(gc_parallel_helper_state) == GC_PARALLEL_HELPER_STARTING) {
+            MP_STATE_MEM(gc_parallel_helper_state) = GC_PARALLEL_HELPER_NONE;
+        }
+        bool done = MP_STATE_MEM(gc_parallel_helper_state) == GC_PARALLEL_HELPER_NONE;
+        gc_parallel_unlock();
+        if (done) {
+            break;
+        }
+    }
+}
+#endif
+
+#if MICROPY_FLOAT_FREELIST
+// A float on the free list, linked through the space of its value.
+typedef struct _gc_float_free_t {
+    mp_obj_base_t base;
+    struct _gc_float_free_t *next;
+} gc_float_free_t;
+
+// Keep a dead float for reuse instead of freeing its block, if the free list
+// isn't full.  Anything of a single block whose first word is the float type
+// can be reused as a float, whether or not it was one.
+STATIC bool gc_sweep_keep_float(mp_state_mem_area_t *area, size_t block) {
+    gc_float_free_t *f = (gc_float_free_t *)PTR_FROM_BLOCK(area, block);
+    if (f->base.type != &mp_type_float
+        || MP_STATE_MEM(float_freelist_len) >= MICROPY_FLOAT_FREELIST_LEN
+        || (block + 1 < AREA_NUM_BLOCKS(area) && ATB_GET_KIND(area, block + 1) == AT_TAIL)) {
+        return false;
+    }
+    f->next = MP_STATE_MEM(float_freelist);
+    MP_STATE_MEM(float_freelist) = f;
+    MP_STATE_MEM(float_freelist_len) += 1;
+    return true;
+}
+
+void *gc_float_freelist_pop(void) {
+    if (MP_STATE_MEM(float_freelist) == NULL || MP_STATE_THREAD(gc_lock_depth) > 0) {
+        // nothing to reuse, or the heap is locked and gc_alloc will deal with it
+        return NULL;
+    }
+    GC_ENTER();
+    gc_float_free_t *f = MP_STATE_MEM(float_freelist);
+    if (f != NULL) {
+        MP_STATE_MEM(float_freelist) = f->next;
+        MP_STATE_MEM(float_freelist_len) -= 1;
+        #if MICROPY_GC_INCREMENTAL
+        if (MP_STATE_MEM(gc_incremental_active)) {
+            // scan the block before the collection in progress can finish,
+            // as for a newly allocated one
+            mp_state_mem_area_t *area = gc_get_ptr_area(f);
+            DTB_SET(area, BLOCK_FROM_PTR(area, f));
+        }
+        #endif
+    }
+    GC_EXIT();
+    return f;
+}
+#endif
+
+#if MICROPY_GC_POOL
+// An object in the pool, linked through the space after its type.
+typedef struct _gc_pool_free_t {
+    mp_obj_base_t base;
+    struct _gc_pool_free_t *next;
+} gc_pool_free_t;
+
+// Keep a dead object for reuse instead of freeing its blocks, if it is of a
+// pooled type and its size isn't full.  As for floats, anything whose first
+// word is a pooled type can be reused, whether or not it was such an object.
+STATIC bool gc_sweep_keep_pooled(mp_state_mem_area_t *area, size_t block) {
+    gc_pool_free_t *o = (gc_pool_free_t *)PTR_FROM_BLOCK(area, block);
+    size_t i = 0;
+    while (i < MP_STATE_MEM(gc_pool_num_types) && MP_STATE_MEM(gc_pool_types)[i] != o->base.type) {
+        i += 1;
+    }
+    if (i == MP_STATE_MEM(gc_pool_num_types)) {
+        return false;
+    }
+    size_t n_blocks = 1;
+    while (block + n_blocks < AREA_NUM_BLOCKS(area) && ATB_GET_KIND(area, block + n_blocks) == AT_TAIL) {
+        if (++n_blocks > MICROPY_GC_POOL_MAX_BLOCKS) {
+            return false;
+        }
+    }
+    if (MP_STATE_MEM(gc_pool_len)[n_blocks - 1] >= MICROPY_GC_POOL_DEPTH) {
+        return false;
+    }
+    o->next = MP_STATE_MEM(gc_pool)[n_blocks - 1];
+    MP_STATE_MEM(gc_pool)[n_blocks - 1] = o;
+    MP_STATE_MEM(gc_pool_len)[n_blocks - 1] += 1;
+    #if MICROPY_GC_STATS
+    MP_STATE_MEM(gc_stats).pool_kept += 1;
+    #endif
+    return true;
+}
+
+STATIC void gc_pool_clear(void) {
+    memset(MP_STATE_MEM(gc_pool), 0, sizeof(MP_STATE_MEM(gc_pool)));
+    memset(MP_STATE_MEM(gc_pool_len), 0, sizeof(MP_STATE_MEM(gc_pool_len)));
+}
+
+void *gc_pool_pop(const mp_obj_type_t *type, size_t n_bytes) {
+    size_t n_blocks = (n_bytes + BYTES_PER_BLOCK - 1) / BYTES_PER_BLOCK;
+    if (n_blocks > MICROPY_GC_POOL_MAX_BLOCKS || MP_STATE_THREAD(gc_lock_depth) > 0) {
+        // too big to be pooled, or the heap is locked and gc_alloc will deal with it
+        return NULL;
+    }
+    GC_ENTER();
+    gc_pool_free_t *o = NULL;
+    gc_pool_free_t **prev = &MP_STATE_MEM(gc_pool)[n_blocks - 1];
+    for (; *prev != NULL; prev = &(*prev)->next) {
+        if ((*prev)->base.type == type) {
+            o = *prev;
+            *prev = o->next;
+            MP_STATE_MEM(gc_pool_len)[n_blocks - 1] -= 1;
+            #if MICROPY_GC_INCREMENTAL
+            if (MP_STATE_MEM(gc_incremental_active)) {
+                // scan the block before the collection in progress can finish,
+                // as for a newly allocated one
+                mp_state_mem_area_t *area = gc_get_ptr_area(o);
+                DTB_SET(area, BLOCK_FROM_PTR(area, o));
+            }
+            #endif
+            #if MICROPY_GC_STATS
+            MP_STATE_MEM(gc_stats).pool_reused += 1;
+            #endif
+            break;
+        }
+    }
+    if (o == NULL) {
+        // start keeping dead objects of this type, if there is room for it
+        size_t i = 0;
+        while (i < MP_STATE_MEM(gc_pool_num_types) && MP_STATE_MEM(gc_pool_types)[i] != type) {
+            i += 1;
+        }
+        if (i == MP_STATE_MEM(gc_pool_num_types) && i < MICROPY_GC_POOL_TYPES) {
+            MP_STATE_MEM(gc_pool_types)[i] = type;
+            MP_STATE_MEM(gc_pool_num_types) = i + 1;
+        }
+    }
+    GC_EXIT();
+    if (o != NULL) {
+        // as if newly allocated
+        memset(o, 0, n_blocks * BYTES_PER_BLOCK);
+    }
+    return o;
+}
+
+// Free the objects kept for reuse, returning true if there were any.
+STATIC bool gc_pool_release(void) {
+    gc_pool_free_t *pool[MICROPY_GC_POOL_MAX_BLOCKS];
+    GC_ENTER();
+    memcpy(pool, MP_STATE_MEM(gc_pool), sizeof(pool));
+    gc_pool_clear();
+    GC_EXIT();
+    bool released = false;
+    for (size_t i = 0; i < MICROPY_GC_POOL_MAX_BLOCKS; ++i) {
+        for (gc_pool_free_t *o = pool[i]; o != NULL;) {
+            gc_pool_free_t *next = o->next;
+            gc_free(o);
+            o = next;
+            released = true;
+        }
+    }
+    return released;
+}
+#endif
+
+#if MICROPY_GC_TLAB
+// Take back the blocks of a thread's allocation buffer that haven't been
+// handed out.  They stay marked as heads until the next sweep frees them.
+// Must be called with the GC lock held.
+STATIC void gc_tlab_retire(mp_gc_tlab_t *tlab) {
+    byte *cur = __atomic_exchange_n(&tlab->cur, tlab->end, __ATOMIC_ACQ_REL);
+    MP_STATE_MEM(gc_tlab_count) -= (tlab->end - cur) / BYTES_PER_BLOCK;
+}
+
+STATIC void gc_tlab_retire_all(void) {
+    for (mp_gc_tlab_t *tlab = MP_STATE_MEM(gc_tlab_list); tlab != NULL; tlab = tlab->next) {
+        gc_tlab_retire(tlab);
+    }
+}
+#endif
+
+#if MICROPY_HEAP_IMAGE
+void gc_drop_caches(void) {
+    GC_ENTER();
+    #if MICROPY_FLOAT_FREELIST
+    MP_STATE_MEM(float_freelist) = NULL;
+    MP_STATE_MEM(float_freelist_len) = 0;
+    #endif
+    #if MICROPY_GC_POOL
+    gc_pool_clear();
+    #endif
+    #if MICROPY_GC_TLAB
+    mp_gc_tlab_t *tlab = &MP_STATE_THREAD(gc_tlab);
+    tlab->next = NULL;
+    tlab->cur = NULL;
+    tlab->end = NULL;
+    MP_STATE_MEM(gc_tlab_list) = NULL;
+    MP_STATE_MEM(gc_tlab_count) = 0;
+    #endif
+    GC_EXIT();
+}
+#endif
+
+STATIC void gc_sweep(void) {
+    #if MICROPY_PY_GC_COLLECT_RETVAL
+    MP_STATE_MEM(gc_collected) = 0;
+    #endif
+    #if MICROPY_GC_STATS
+    size_t num_free = 0;
+    size_t num_swept = 0;
+    size_t num_blocks = 0;
+    #endif
+    #if MICROPY_FLOAT_FREELIST
+    // the free list is rebuilt from the floats that are dead now, which
+    // includes those still on the list
+    MP_STATE_MEM(float_freelist) = NULL;
+    MP_STATE_MEM(float_freelist_len) = 0;
+    #endif
+    #if MICROPY_GC_POOL
+    // likewise for the pool
+    gc_pool_clear();
+    #if MICROPY_GC_STATS
+    MP_STATE_MEM(gc_stats).pool_kept = 0;
+    #endif
+    #endif
+    #if MICROPY_GC_ARENA
+    // forget the arenas that are about to be freed
+    mp_gc_arena_t *prev_arena = NULL;
+    for (mp_gc_arena_t *arena = MP_STATE_MEM(gc_arena_list); arena != NULL; arena = GC_ARENA_NEXT(arena)) {
+        mp_state_mem_area_t *area = gc_get_ptr_area(arena);
+        size_t block = BLOCK_FROM_PTR(area, arena);
+        if (ATB_GET_KIND(area, block) == AT_HEAD && !GC_IS_OLD_DURING_MINOR(area, block)) {
+            if (prev_arena == NULL) {
+                MP_STATE_MEM(gc_arena_list) = GC_ARENA_NEXT(arena);
+            } else {
+                prev_arena->next_inv = arena->next_inv;
+            }
+        } else {
+            prev_arena = arena;
+        }
+    }
+    #endif
+    for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+        size_t start_block = 0;
+        size_t end_block = AREA_NUM_BLOCKS(area);
+        #if MICROPY_GC_GENERATIONAL
+        // all survivors are promoted, so no old block is left pointing to a young one
+        memset(area->gc_remembered_table_start, 0, area->gc_remembered_table_byte_len);
+        if (MP_STATE_MEM(gc_collect_minor)) {
+            // only blocks allocated since the last collection can be young
+            start_block = MIN(area->gc_young_start, end_block);
+            end_block = area->gc_young_end;
+        }
+        // the blocks kept for reuse below are the young ones that are left
+        area->gc_young_start = AREA_NUM_BLOCKS(area);
+        area->gc_young_end = 0;
+        #endif
+        #if MICROPY_GC_SIZE_CLASSES
+        // the size classes are rebuilt from the free runs left by this sweep,
+        // a minor one keeps the runs cached outside of the blocks it sweeps
+        if (start_block == 0 && end_block == AREA_NUM_BLOCKS(area)) {
+            memset(area->gc_size_class_len, 0, sizeof(area->gc_size_class_len));
+        }
+        size_t free_run = 0;
+        #endif
+        // free unmarked heads and their tails, continuing to the end of the
+        // last chain that starts in the range swept
+        int free_tail = 0;
+        size_t block;
+        for (block = start_block; block < end_block || (block < AREA_NUM_BLOCKS(area) && ATB_GET_KIND(area, block) == AT_TAIL); block++) {
+            switch (ATB_GET_KIND(area, block)) {
+                case AT_HEAD:
+                    #if MICROPY_GC_GENERATIONAL
+                    if (GC_IS_OLD_DURING_MINOR(area, block)) {
+                        // an old block that wasn't traced, keep it and its tail
+                        free_tail = 0;
+                        break;
+                    }
+                    GTB_CLEAR(area, block);
+                    #endif
+                    #if MICROPY_ENABLE_FINALISER
+                    if (FTB_GET(area, block)) {
+                        mp_obj_base_t *obj = (mp_obj_base_t *)PTR_FROM_BLOCK(area, block);
+                        if (obj->type != NULL) {
+                            // if the object has a type then see if it has a __del__ method
+                            mp_obj_t dest[2];
+                            mp_load_method_maybe(MP_OBJ_FROM_PTR(obj), MP_QSTR___del__, dest);
+                            if (dest[0] != MP_OBJ_NULL) {
+                                // load_method returned a method, execute it in a protected environment
+                                #if MICROPY_ENABLE_SCHEDULER
+                                mp_sched_lock();
+                                #endif
+                                mp_call_function_1_protected(dest[0], dest[1]);
+                                #if MICROPY_ENABLE_SCHEDULER
+                                mp_sched_unlock();
+                                #endif
+                            }
+                        }
+                        // clear finaliser flag
+                        FTB_CLEAR(area, block);
+                    }
+                    #endif
+                    #if MICROPY_GC_NO_SCAN
+                    // the block may be kept and reused as an object below
+                    NTB_CLEAR(area, block);
+                    #endif
+                    free_tail = 1;
+                    DEBUG_printf("gc_sweep(%p)\n", (void *)PTR_FROM_BLOCK(area, block));
+                    #if MICROPY_PY_GC_COLLECT_RETVAL
+                    MP_STATE_MEM(gc_collected)++;
+                    #endif
+                    #if MICROPY_FLOAT_FREELIST
+                    if (gc_sweep_keep_float(area, block)) {
+                        #if MICROPY_GC_GENERATIONAL
+                        gc_young_extend(area, block, block + 1);
+                        #endif
+                        free_tail = 0;
+                        break;
+                    }
+                    #endif
+                    #if MICROPY_GC_POOL
+                    if (gc_sweep_keep_pooled(area, block)) {
+                        #if MICROPY_GC_GENERATIONAL
+                        gc_young_extend(area, block, block + 1);
+                        #endif
+                        free_tail = 0;
+                        break;
+                    }
+                    #endif
+                    // fall through to free the head
+                    MP_FALLTHROUGH
+
+                case AT_TAIL:
+                    if (free_tail) {
+                        ATB_ANY_TO_FREE(area, block);
+                        #if MICROPY_GC_STATS
+                        num_swept += 1;
+                        #endif
+                        #if CLEAR_ON_SWEEP
+                        memset((void *)PTR_FROM_BLOCK(area, block), 0, BYTES_PER_BLOCK);
+                        #endif
+                    }
+                    break;
+
+                case AT_MARK:
+                    ATB_MARK_TO_HEAD(area, block);
+                    #if MICROPY_GC_GENERATIONAL
+                    // survived a collection, promote to the old generation
+                    GTB_SET(area, block);
+                    #endif
+                    free_tail = 0;
+                    break;
+            }
+
+            #if MICROPY_GC_STATS
+            num_free += ATB_GET_KIND(area, block) == AT_FREE;
+            #endif
+            #if MICROPY_GC_SIZE_CLASSES
+            if (ATB_GET_KIND(area, block) == AT_FREE) {
+                free_run += 1;
+            } else {
+                gc_size_class_push(area, block - free_run, free_run);
+                free_run = 0;
+            }
+            #endif
+        }
+
+        #if MICROPY_GC_SIZE_CLASSES
+        gc_size_class_push(area, block - free_run, free_run);
+        #endif
+        #if MICROPY_GC_STATS
+        num_blocks += block - start_block;
+        #endif
+    }
+    #if MICROPY_GC_STATS
+    mp_gc_stats_t *stats = &MP_STATE_MEM(gc_stats);
+    #if MICROPY_GC_GENERATIONAL
+    if (MP_STATE_MEM(gc_collect_minor)) {
+        // the old blocks that weren't swept are still in use
+        stats->in_use -= MIN(num_swept, stats->in_use);
+    } else
+    #endif
+    {
+        stats->in_use = num_blocks - num_free;
+    }
+    stats->marked = stats->in_use;
+    stats->swept = num_swept;
+    #endif
+}
+
+#if MICROPY_GC_GENERATIONAL
+// Old blocks act as roots for a minor collection because they may hold the
+// only reference to a young block.  Only the old blocks in the remembered set
+// can: those written to since the last collection, which the write barrier
+// recorded, and those found as roots.  Each is scanned for pointers to young
+// blocks, without tracing through other old blocks.
+STATIC void gc_mark_from_remembered_set(void) {
+    for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+        for (size_t i = 0; i < area->gc_remembered_table_byte_len; i++) {
+            if (area->gc_remembered_table_start[i] == 0) {
+                continue;
+            }
+            for (size_t block = i * BLOCKS_PER_RTB; block < (i + 1) * BLOCKS_PER_RTB; block++) {
+                if (RTB_GET(area, block) && ATB_GET_KIND(area, block) == AT_HEAD && GTB_GET(area, block)) {
+                    gc_mark_subtree(area, block);
+                }
+            }
+        }
+    }
+}
+#endif
+
+#if MICROPY_GC_INCREMENTAL
+// Continue marking from the mark stack and the dirty blocks until there is no
+// work left, or the current step runs out of time.  Returns true if marking
+// is complete and the heap can be swept.
+STATIC bool gc_incremental_mark(void) {
+    for (;;) {
+        // drain the blocks left on the mark stack
+        while (MP_STATE_MEM(gc_sp) > 0) {
+            if (gc_step_budget_exhausted()) {
+                return false;
+            }
+            size_t sp = --MP_STATE_MEM(gc_sp);
+            #if MICROPY_GC_SPLIT_HEAP
+            gc_mark_subtree(MP_STATE_MEM(gc_area_stack)[sp], MP_STATE_MEM(gc_stack)[sp]);
+            #else
+            gc_mark_subtree(&MP_STATE_MEM(area), MP_STATE_MEM(gc_stack)[sp]);
+            #endif
+        }
+
+        if (MP_STATE_MEM(gc_stack_overflow)) {
+            // the rescan of the heap can't be split up, so finish it in this step
+            MP_STATE_MEM(gc_step_budgeted) = 0;
+            gc_deal_with_stack_overflow();
+        }
+
+        // (re)scan dirty blocks, marking them if they are not already marked
+        bool found_dirty = false;
+        for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+            for (size_t i = 0; i < area->gc_dirty_table_byte_len; i++) {
+                if (area->gc_dirty_table_start[i] == 0) {
+                    continue;
+                }
+                for (size_t block = i * BLOCKS_PER_DTB; block < (i + 1) * BLOCKS_PER_DTB; block++) {
+                    if (!DTB_GET(area, block)) {
+                        continue;
+                    }
+                    DTB_CLEAR(area, block);
+                    if (ATB_GET_KIND(area, block) == AT_HEAD) {
+                        ATB_HEAD_TO_MARK(area, block);
+                    }
+                    if (ATB_GET_KIND(area, block) == AT_MARK) {
+                        found_dirty = true;
+                        gc_mark_subtree(area, block);
+                        if (MP_STATE_MEM(gc_sp) > 0) {
+                            // ran out of time while marking the children
+                            return false;
+                        }
+                    }
+                }
+            }
+        }
+
+        if (!found_dirty && !MP_STATE_MEM(gc_stack_overflow)) {
+            return true;
+        }
+    }
+}
+
+STATIC void gc_clear_dirty_tables(void) {
+    for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+        memset(area->gc_dirty_table_start, 0, area->gc_dirty_table_byte_len);
+    }
+}
+#endif
+
+#if MICROPY_GC_STATS
+// Count blocks going into or out of use, outside of a sweep.
+STATIC void gc_stats_use(size_t n_blocks, bool used) {
+    mp_gc_stats_t *stats = &MP_STATE_MEM(gc_stats);
+    if (used) {
+        stats->in_use += n_blocks;
+        if (stats->in_use > stats->peak) {
+            stats->peak = stats->in_use;
+        }
+    } else {
+        stats->in_use -= MIN(n_blocks, stats->in_use);
+    }
+}
+
+STATIC void gc_stats_pause_start(bool new_collection) {
+    mp_gc_stats_t *stats = &MP_STATE_MEM(gc_stats);
+    stats->pause_start_us = mp_hal_ticks_us();
+    if (new_collection) {
+        // the allocation rate is measured over whole cycles, from the start
+        // of one collection to the start of the next
+        mp_uint_t t = mp_hal_ticks_ms();
+        stats->cycle_alloc = stats->alloc;
+        stats->cycle_ms = t - stats->cycle_start_ms;
+        stats->cycle_start_ms = t;
+        stats->alloc = 0;
+    }
+}
+
+STATIC void gc_stats_pause_end(bool finished) {
+    mp_gc_stats_t *stats = &MP_STATE_MEM(gc_stats);
+    uint32_t pause_us = mp_hal_ticks_us() - stats->pause_start_us;
+    if (stats->pauses == 0 || pause_us < stats->pause_min_us) {
+        stats->pause_min_us = pause_us;
+    }
+    if (pause_us > stats->pause_max_us) {
+        stats->pause_max_us = pause_us;
+    }
+    stats->pause_last_us = pause_us;
+    stats->pause_total_us += pause_us;
+    stats->pauses += 1;
+    stats->collections += finished;
+}
+
+void gc_stats(mp_gc_stats_t *dest, bool reset) {
+    GC_ENTER();
+    mp_gc_stats_t *stats = &MP_STATE_MEM(gc_stats);
+    *dest = *stats;
+    if (reset) {
+        stats->collections = 0;
+        stats->pauses = 0;
+        stats->pause_min_us = 0;
+        stats->pause_max_us = 0;
+        stats->pause_total_us = 0;
+        stats->peak = stats->in_use;
+        #if MICROPY_GC_POOL
+        stats->pool_reused = 0;
+        #endif
+    }
+    GC_EXIT();
+}
+#endif
+
+void gc_collect_start(void) {
+    GC_ENTER();
+    MP_STATE_THREAD(gc_lock_depth)++;
+
+    #if MICROPY_GC_TLAB
+    // the unused blocks of the threads' buffers are freed by this collection
+    gc_tlab_retire_all();
+    #endif
+
+    #if MICROPY_GC_INCREMENTAL
+    // A step of an incremental collection in progress keeps the existing marks,
+    // mark stack and dirty blocks.
+    bool new_collection = !MP_STATE_MEM(gc_incremental_active);
+    if (new_collection) {
+        MP_STATE_MEM(gc_incremental_active) = MP_STATE_MEM(gc_step_budgeted);
+        MP_STATE_MEM(gc_sp) = 0;
+    }
+    #else
+    bool new_collection = true;
+    #endif
+
+    #if MICROPY_GC_STATS
+    gc_stats_pause_start(new_collection);
+    #endif
+    MP_TRACE(MP_TRACE_EVENT_GC_START, new_collection);
+
+    if (new_collection) {
+        #if MICROPY_GC_ALLOC_THRESHOLD
+        MP_STATE_MEM(gc_alloc_amount) = 0;
+        #endif
+        MP_STATE_MEM(gc_stack_overflow) = 0;
+
+        #if MICROPY_GC_PARALLEL_MARK
+        // Roots are put in the pool for the parallel mark phase, except for an
+        // incremental collection which is marked in steps on a single core.
+        MP_STATE_MEM(gc_mark_pool).len = 0;
+        #if MICROPY_GC_INCREMENTAL
+        MP_STATE_MEM(gc_parallel_active) = !MP_STATE_MEM(gc_incremental_active);
+        #else
+        MP_STATE_MEM(gc_parallel_active) = 1;
+        #endif
+        #if MICROPY_GC_COMPACT
+        // the workers don't look for references to the candidates of gc_compact
+        MP_STATE_MEM(gc_parallel_active) &= MP_STATE_MEM(gc_compact_candidates) == NULL;
+        #endif
+        #endif
+
+        #if MICROPY_GC_GENERATIONAL
+        // Do a minor collection if one was requested, otherwise a major one.
+        // Incremental collections are always major ones.
+        MP_STATE_MEM(gc_collect_minor) = MP_STATE_MEM(gc_minor_requested);
+        #if MICROPY_GC_INCREMENTAL
+        MP_STATE_MEM(gc_collect_minor) &= !MP_STATE_MEM(gc_incremental_active);
+        #endif
+        if (MP_STATE_MEM(gc_collect_minor)) {
+            MP_STATE_MEM(gc_minor_count)++;
+            MP_STATE_MEM(gc_minor_since_major)++;
+        } else {
+            MP_STATE_MEM(gc_major_count)++;
+            MP_STATE_MEM(gc_minor_since_major) = 0;
+        }
+        #endif
+    }
+    #if MICROPY_GC_GENERATIONAL
+    MP_STATE_MEM(gc_minor_requested) = 0;
+    #endif
+
+    // Trace root pointers.  This relies on the root pointers being organised
+    // correctly in the mp_state_ctx structure.  We scan nlr_top, dict_locals,
+    // dict_globals, then the root pointer section of mp_state_vm.
+    void **ptrs = (void **)(void *)&mp_state_ctx;
+    size_t root_start = offsetof(mp_state_ctx_t, thread.dict_locals);
+    size_t root_end = offsetof(mp_state_ctx_t, vm.qstr_last_chunk);
+    gc_collect_root(ptrs + root_start / sizeof(void *), (root_end - root_start) / sizeof(void *));
+
+    #if MICROPY_MODULE_FROZEN_MPY && MICROPY_MODULE_FROZEN_ROM_GLOBALS
+    // Trace the namespaces of frozen modules, which point into the heap once
+    // they are written to.
+    gc_collect_root((void **)mp_frozen_mpy_globals, FROZEN_GLOBALS_NUM_PTRS);
+    #endif
+
+    #if MICROPY_ENABLE_PYSTACK
+    // Trace root pointers from the Python stack.
+    ptrs = (void **)(void *)MP_STATE_THREAD(pystack_start);
+    gc_collect_root(ptrs, (MP_STATE_THREAD(pystack_cur) - MP_STATE_THREAD(pystack_start)) / sizeof(void *));
+    #endif
+}
+
+void gc_collect_root(void **ptrs, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        GC_COMPACT_CHECK(&ptrs[i]);
+        void *ptr = ptrs[i];
+        mp_state_mem_area_t *area = GC_GET_MARK_PTR_AREA(ptr);
+        if (area != NULL) {
+            size_t block = BLOCK_FROM_PTR(area, ptr);
+            if (ATB_GET_KIND(area, block) == AT_HEAD && !GC_IS_OLD_DURING_MINOR(area, block)) {
+                // An unmarked head: mark it, and mark all its children
+                TRACE_MARK(block, ptr);
+                ATB_HEAD_TO_MARK(area, block);
+                #if MICROPY_GC_PARALLEL_MARK
+                if (MP_STATE_MEM(gc_parallel_active) && MP_STATE_MEM(gc_mark_pool).len < MICROPY_ALLOC_GC_STACK_SIZE) {
+                    // the children are marked later by the parallel mark phase
+                    gc_mark_stack_push(&MP_STATE_MEM(gc_mark_pool), area, block);
+                    continue;
+                }
+                #endif
+                gc_mark_subtree(area, block);
+            }
+            #if MICROPY_GC_GENERATIONAL
+            else if (MP_STATE_MEM(gc_collect_minor) && ATB_GET_KIND(area, block) == AT_HEAD) {
+                // an old root, eg a frame or an object C code is working on,
+                // may have been written to without a barrier
+                RTB_SET(area, block);
+            }
+            #endif
+            #if MICROPY_GC_INCREMENTAL
+            else if (MP_STATE_MEM(gc_incremental_active) && ATB_GET_KIND(area, block) == AT_MARK) {
+                // a root may have been written to since it was scanned in an
+                // earlier step (eg a heap-allocated frame), so rescan it
+                DTB_SET(area, block);
+            }
+            #endif
+        }
+    }
+}
+
+void gc_collect_end(void) {
+    #if MICROPY_GC_GENERATIONAL
+    if (MP_STATE_MEM(gc_collect_minor)) {
+        gc_mark_from_remembered_set();
+    }
+    #endif
+    #if MICROPY_GC_PARALLEL_MARK
+    if (MP_STATE_MEM(gc_parallel_active)) {
+        gc_parallel_mark();
+    }
+    #endif
+    #if MICROPY_GC_INCREMENTAL
+    if (MP_STATE_MEM(gc_incremental_active)) {
+        if (!gc_incremental_mark()) {
+            // out of time, the collection continues with the next step
+            #if MICROPY_GC_STATS
+            gc_stats_pause_end(false);
+            #endif
+            MP_TRACE(MP_TRACE_EVENT_GC_END, 0);
+            MP_STATE_THREAD(gc_lock_depth)--;
+            GC_EXIT();
+            return;
+        }
+        // marking is complete, discard the dirty state before sweeping
+        gc_clear_dirty_tables();
+        MP_STATE_MEM(gc_incremental_active) = 0;
+    }
+    #endif
+    gc_deal_with_stack_overflow();
+    #if MICROPY_OPT_BOUND_METH_CACHE
+    // the cache doesn't keep its bound methods alive, so forget them all
+    memset(MP_STATE_VM(bound_meth_cache), 0, sizeof(MP_STATE_VM(bound_meth_cache)));
+    #endif
+    #if MICROPY_GC_COMPACT
+    if (MP_STATE_MEM(gc_compact_candidates) != NULL) {
+        // the scan of gc_compact only wants the references, so just unmark
+        for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+            for (size_t block = 0; block < AREA_NUM_BLOCKS(area); block++) {
+                if (ATB_GET_KIND(area, block) == AT_MARK) {
+                    ATB_MARK_TO_HEAD(area, block);
+                }
+            }
+        }
+    } else
+    #endif
+    {
+        gc_sweep();
+    }
+    #if MICROPY_GC_GENERATIONAL
+    MP_STATE_MEM(gc_collect_minor) = 0;
+    #endif
+    for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+        area->gc_last_free_atb_index = 0;
+        area->gc_last_run_atb_index = 0;
+    }
+    #if MICROPY_GC_STATS
+    gc_stats_pause_end(true);
+    #endif
+    MP_TRACE(MP_TRACE_EVENT_GC_END, 1);
+    MP_STATE_THREAD(gc_lock_depth)--;
+    GC_EXIT();
+}
+
+void gc_sweep_all(void) {
+    GC_ENTER();
+    MP_STATE_THREAD(gc_lock_depth)++;
+    #if MICROPY_GC_TLAB
+    gc_tlab_retire_all();
+    #endif
+    #if MICROPY_GC_STATS
+    gc_stats_pause_start(true);
+    #endif
+    MP_STATE_MEM(gc_stack_overflow) = 0;
+    #if MICROPY_GC_GENERATIONAL
+    // everything must be swept, regardless of generation
+    MP_STATE_MEM(gc_collect_minor) = 0;
+    #endif
+    #if MICROPY_GC_INCREMENTAL
+    if (MP_STATE_MEM(gc_incremental_active)) {
+        // abandon the incremental collection in progress so everything is swept
+        for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+            for (size_t block = 0; block < AREA_NUM_BLOCKS(area); block++) {
+                if (ATB_GET_KIND(area, block) == AT_MARK) {
+                    ATB_MARK_TO_HEAD(area, block);
+                }
+            }
+        }
+        gc_clear_dirty_tables();
+        MP_STATE_MEM(gc_incremental_active) = 0;
+        MP_STATE_MEM(gc_sp) = 0;
+    }
+    #endif
+    gc_collect_end();
+    #if MICROPY_FLOAT_FREELIST
+    // nothing is to be reused after everything has been swept
+    MP_STATE_MEM(float_freelist) = NULL;
+    MP_STATE_MEM(float_freelist_len) = 0;
+    #endif
+    #if MICROPY_GC_POOL
+    gc_pool_clear();
+    #endif
+}
+
+#if MICROPY_GC_INCREMENTAL
+// Do a time-bounded step of an incremental collection, starting a new
+// collection if none is in progress.  Returns true if the collection finished.
+bool gc_collect_step(mp_uint_t budget_us) {
+    MP_STATE_MEM(gc_step_budgeted) = 1;
+    MP_STATE_MEM(gc_step_expired) = 0;
+    MP_STATE_MEM(gc_step_budget_us) = budget_us;
+    MP_STATE_MEM(gc_step_start_us) = mp_hal_ticks_us();
+    MP_STATE_MEM(gc_step_work) = 0;
+    gc_collect();
+    MP_STATE_MEM(gc_step_budgeted) = 0;
+    return !MP_STATE_MEM(gc_incremental_active);
+}
+
+bool gc_collect_in_progress(void) {
+    return MP_STATE_MEM(gc_incremental_active);
+}
+#endif
+
+#if MICROPY_GC_GENERATIONAL || MICROPY_GC_INCREMENTAL
+void gc_write_barrier(const void *ptr_in) {
+    #if !MICROPY_GC_GENERATIONAL
+    if (!MP_STATE_MEM(gc_incremental_active)) {
+        return;
+    }
+    #endif
+    // the pointer may be into the middle of the block, eg to a struct member
+    void *ptr = (void *)((uintptr_t)ptr_in & ~(uintptr_t)(BYTES_PER_BLOCK - 1));
+    mp_state_mem_area_t *area = GC_GET_MARK_PTR_AREA(ptr);
+    if (area == NULL) {
+        // not in the heap, eg a static object or one on the stack
+        return;
+    }
+    GC_ENTER();
+    size_t block = BLOCK_FROM_PTR(area, ptr);
+    while (block > 0 && ATB_GET_KIND(area, block) == AT_TAIL) {
+        block -= 1;
+    }
+    #if MICROPY_GC_GENERATIONAL
+    if (GTB_GET(area, block)) {
+        RTB_SET(area, block);
+    }
+    #endif
+    #if MICROPY_GC_INCREMENTAL
+    if (MP_STATE_MEM(gc_incremental_active)) {
+        DTB_SET(area, block);
+    }
+    #endif
+    GC_EXIT();
+}
+#endif
+
+void gc_info(gc_info_t *info) {
+    GC_ENTER();
+    info->total = 0;
+    info->used = 0;
+    info->free = 0;
+    info->max_free = 0;
+    info->num_1block = 0;
+    info->num_2block = 0;
+    info->max_block = 0;
+    #if MICROPY_GC_GENERATIONAL
+    info->old = 0;
+    info->num_minor = MP_STATE_MEM(gc_minor_count);
+    info->num_major = MP_STATE_MEM(gc_major_count);
+    #endif
+    #if MICROPY_PY_THREAD && !MICROPY_PY_THREAD_GIL
+    info->num_lock = MP_STATE_MEM(gc_lock_count);
+    #endif
+    #if MICROPY_GC_TLAB
+    info->num_tlab = MP_STATE_MEM(gc_tlab_count);
+    #endif
+    for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+        // runs of blocks never cross the boundary of an area
+        info->total += area->gc_pool_end - area->gc_pool_start;
+        bool finish = false;
+        #if MICROPY_GC_GENERATIONAL
+        bool old = false;
+        #endif
+        for (size_t block = 0, len = 0, len_free = 0; !finish;) {
+            size_t kind = ATB_GET_KIND(area, block);
+            switch (kind) {
+                case AT_FREE:
+                    info->free += 1;
+                    len_free += 1;
+                    len = 0;
+                    break;
+
+                case AT_HEAD:
+                #if MICROPY_GC_INCREMENTAL
+                case AT_MARK: // left marked by an incremental collection in progress
+                #endif
+                    info->used += 1;
+                    len = 1;
+                    #if MICROPY_GC_GENERATIONAL
+                    old = GTB_GET(area, block);
+                    info->old += old;
+                    #endif
+                    break;
+
+                case AT_TAIL:
+                    info->used += 1;
+                    len += 1;
+                    #if MICROPY_GC_GENERATIONAL
+                    info->old += old;
+                    #endif
+                    break;
+
+                #if !MICROPY_GC_INCREMENTAL
+                case AT_MARK:
+                    // shouldn't happen
+                    break;
+                #endif
+            }
+
+            block++;
+            finish = (block == AREA_NUM_BLOCKS(area));
+            // Get next block type if possible
+            if (!finish) {
+                kind = ATB_GET_KIND(area, block);
+            }
+
+            if (finish || kind == AT_FREE || kind == AT_HEAD || kind == AT_MARK) {
+                if (len == 1) {
+                    info->num_1block += 1;
+                } else if (len == 2) {
+                    info->num_2block += 1;
+                }
+                if (len > info->max_block) {
+                    info->max_block = len;
+                }
+                if (finish || kind == AT_HEAD || kind == AT_MARK) {
+                    if (len_free > info->max_free) {
+                        info->max_free = len_free;
+                    }
+                    len_free = 0;
+                }
+            }
+        }
+    }
+
+    info->used *= BYTES_PER_BLOCK;
+    info->free *= BYTES_PER_BLOCK;
+    #if MICROPY_GC_GENERATIONAL
+    info->old *= BYTES_PER_BLOCK;
+    #endif
+    GC_EXIT();
+}
+
+#if MICROPY_GC_COMPACT
+// Returns the slot of the object that points to its data, if the object has
+// a type whose data may be moved.
+STATIC void **gc_compact_buffer_slot(mp_obj_base_t *obj) {
+    #if MICROPY_PY_BUILTINS_BYTEARRAY
+    if (obj->type == &mp_type_bytearray) {
+        return &((mp_obj_array_t *)obj)->items;
+    }
+    #endif
+    #if MICROPY_PY_ARRAY
+    if (obj->type == &mp_type_array) {
+        return &((mp_obj_array_t *)obj)->items;
+    }
+    #endif
+    if (obj->type == &mp_type_str || obj->type == &mp_type_bytes) {
+        return (void **)&((mp_obj_str_t *)obj)->data;
+    }
+    return NULL;
+}
+
+// Fill in the candidates with the buffers of objects that may be moved, the
+// ones highest in the heap first.  Returns the number found.
+STATIC MP_NOINLINE size_t gc_compact_find_candidates(gc_compact_candidate_t *candidates) {
+    size_t n = 0;
+    GC_ENTER();
+    for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+        for (size_t block = AREA_NUM_BLOCKS(area); block-- > 0 && n < MICROPY_GC_COMPACT_MAX_MOVES;) {
+            if (ATB_GET_KIND(area, block) != AT_HEAD) {
+                continue;
+            }
+            void **slot = gc_compact_buffer_slot((mp_obj_base_t *)PTR_FROM_BLOCK(area, block));
+            mp_state_mem_area_t *buf_area = slot != NULL ? gc_get_ptr_area(*slot) : NULL;
+            if (buf_area == NULL) {
+                continue;
+            }
+            size_t buf_block = BLOCK_FROM_PTR(buf_area, *slot);
+            if (ATB_GET_KIND(buf_area, buf_block) != AT_HEAD || (buf_area == area && buf_block == block)
+                #if MICROPY_ENABLE_FINALISER
+                || FTB_GET(buf_area, buf_block)
+                #endif
+                ) {
+                continue;
+            }
+            size_t n_blocks = 0;
+            do {
+                n_blocks += 1;
+            } while (ATB_GET_KIND(buf_area, buf_block + n_blocks) == AT_TAIL);
+            // keep the candidates in descending order of address, a buffer
+            // that's shared by two objects can't be moved
+            size_t i = n;
+            while (i > 0 && ~candidates[i - 1].start_inv < (uintptr_t)*slot) {
+                i -= 1;
+            }
+            if (i > 0 && ~candidates[i - 1].start_inv == (uintptr_t)*slot) {
+                candidates[i - 1].pinned = true;
+                continue;
+            }
+            memmove(&candidates[i + 1], &candidates[i], (n - i) * sizeof(gc_compact_candidate_t));
+            candidates[i].start_inv = ~(uintptr_t)*slot;
+            candidates[i].slot_inv = ~(uintptr_t)slot;
+            candidates[i].n_bytes = n_blocks * BYTES_PER_BLOCK;
+            candidates[i].pinned = false;
+            n += 1;
+        }
+    }
+    GC_EXIT();
+    return n;
+}
+
+// Move a buffer to the lowest free run below it that is big enough, if any.
+STATIC bool gc_compact_move(gc_compact_candidate_t *c) {
+    void **slot = (void **)~c->slot_inv;
+    void *buf = (void *)~c->start_inv;
+    size_t n_blocks = c->n_bytes / BYTES_PER_BLOCK;
+    GC_ENTER();
+    mp_state_mem_area_t *area = gc_get_ptr_area(buf);
+    size_t block = BLOCK_FROM_PTR(area, buf);
+    for (size_t bl = 0, run = 0; bl < block; bl++) {
+        if (ATB_GET_KIND(area, bl) != AT_FREE) {
+            run = 0;
+            continue;
+        }
+        if (++run < n_blocks) {
+            continue;
+        }
+        size_t new_block = bl + 1 - n_blocks;
+        ATB_FREE_TO_HEAD(area, new_block);
+        for (size_t tail = new_block + 1; tail <= bl; tail++) {
+            ATB_FREE_TO_TAIL(area, tail);
+        }
+        #if MICROPY_GC_GENERATIONAL
+        if (GTB_GET(area, block)) {
+            GTB_SET(area, new_block);
+        } else {
+            gc_young_extend(area, new_block, new_block + 1);
+        }
+        #endif
+        #if MICROPY_GC_NO_SCAN
+        if (NTB_GET(area, block)) {
+            NTB_SET(area, new_block);
+        }
+        #endif
+        void *new_buf = (void *)PTR_FROM_BLOCK(area, new_block);
+        memcpy(new_buf, buf, c->n_bytes);
+        *slot = new_buf;
+        GC_EXIT();
+        gc_free(buf);
+        return true;
+    }
+    GC_EXIT();
+    return false;
+}
+
+size_t gc_compact(void) {
+    #if MICROPY_GC_INCREMENTAL
+    if (MP_STATE_MEM(gc_incremental_active)) {
+        // finish the collection in progress
+        gc_collect();
+    }
+    #endif
+    // Free the dead objects first, so they don't pin anything.
+    gc_collect();
+
+    // Do a scan like a collection, without freeing anything, that pins the
+    // candidates that anything but their own object's slot refers to.
+    gc_compact_candidate_t candidates[MICROPY_GC_COMPACT_MAX_MOVES];
+    size_t n = gc_compact_find_candidates(candidates);
+    if (n == 0) {
+        return 0;
+    }
+    MP_STATE_MEM(gc_compact_candidates) = candidates;
+    MP_STATE_MEM(gc_compact_num_candidates) = n;
+    gc_collect();
+    MP_STATE_MEM(gc_compact_candidates) = NULL;
+
+    size_t moved = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (!candidates[i].pinned) {
+            moved += gc_compact_move(&candidates[i]);
+        }
+    }
+    return moved;
+}
+#endif
+
+// Find a free run of n_blocks in the given area, claiming nothing.  Returns
+// true and the first block of the run if one was found.
+STATIC bool gc_find_free_run(mp_state_mem_area_t *area, size_t n_blocks, size_t *start_block_out) {
+    #if MICROPY_GC_SIZE_CLASSES
+    // small allocations first try a free run cached by the sweep or gc_free
+    if (n_blocks <= 8 && gc_size_class_pop(area, n_blocks, start_block_out)) {
+        return true;
+    }
+    #endif
+
+    // Look for a run of n_blocks available blocks.  Only one-block
+    // allocations move gc_last_free_atb_index, so a run of more blocks is
+    // looked for from where the last one was found, and from the first free
+    // block only if there is none after that.  Otherwise each allocation of
+    // a series would scan all the blocks taken by the ones before it.
+    size_t start = area->gc_last_free_atb_index;
+    if (n_blocks > 1 && area->gc_last_run_atb_index > start) {
+        start = area->gc_last_run_atb_index;
+    }
+    size_t i;
+    size_t n_free;
+scan:
+    n_free = 0;
+    for (i = start; i < area->gc_alloc_table_byte_len; i++) {
+        byte a = area->gc_alloc_table_start[i];
+        // *FORMAT-OFF*
+        if (ATB_0_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 0; goto found; } } else { n_free = 0; }
+        if (ATB_1_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 1; goto found; } } else { n_free = 0; }
+        if (ATB_2_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 2; goto found; } } else { n_free = 0; }
+        if (ATB_3_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 3; goto found; } } else { n_free = 0; }
+        // *FORMAT-ON*
+    }
+    if (start != area->gc_last_free_atb_index) {
+        start = area->gc_last_free_atb_index;
+        goto scan;
+    }
+    return false;
+
+    // found, ending at block i inclusive
+found:
+    // Set last free ATB index to block after last block we found, for start of
+    // next scan.  To reduce fragmentation, we only do this if we were looking
+    // for a single free block, which guarantees that there are no free blocks
+    // before this one.  Also, whenever we free or shink a block we must check
+    // if this index needs adjusting (see gc_realloc and gc_free).
+    if (n_free == 1) {
+        area->gc_last_free_atb_index = (i + 1) / BLOCKS_PER_ATB;
+    } else {
+        area->gc_last_run_atb_index = (i + 1) / BLOCKS_PER_ATB;
+    }
+
+    *start_block_out = i - n_free + 1;
+    return true;
+}
+
+#if MICROPY_GC_SPLIT_HEAP
+#if MICROPY_GC_LARGE_PAGE_BLOCKS
+#if MICROPY_GC_LARGE_PAGE_BLOCKS % BLOCKS_PER_ATB != 0
+#error MICROPY_GC_LARGE_PAGE_BLOCKS must be a multiple of BLOCKS_PER_ATB
+#endif
+#define GC_ATBS_PER_PAGE (MICROPY_GC_LARGE_PAGE_BLOCKS / BLOCKS_PER_ATB)
+
+// Find a run of free pages for n_blocks in a large area.  Pages start at
+// multiples of MICROPY_GC_LARGE_PAGE_BLOCKS blocks, and a page is free when
+// all of its ATBs are zero, so the scan steps a whole page at a time.
+STATIC bool gc_find_free_pages(mp_state_mem_area_t *area, size_t n_blocks, size_t *start_block_out) {
+    size_t n_pages = (n_blocks + MICROPY_GC_LARGE_PAGE_BLOCKS - 1) / MICROPY_GC_LARGE_PAGE_BLOCKS;
+    size_t n_free = 0;
+    for (size_t i = 0; i + GC_ATBS_PER_PAGE <= area->gc_alloc_table_byte_len; i += GC_ATBS_PER_PAGE) {
+        size_t j = 0;
+        while (j < GC_ATBS_PER_PAGE && area->gc_alloc_table_start[i + j] == 0) {
+            j += 1;
+        }
+        if (j < GC_ATBS_PER_PAGE) {
+            n_free = 0;
+        } else if (++n_free == n_pages) {
+            *start_block_out = (i + GC_ATBS_PER_PAGE - n_pages * GC_ATBS_PER_PAGE) * BLOCKS_PER_ATB;
+            return true;
+        }
+    }
+    return false;
+}
+#endif
+
+// Large allocations prefer areas added with GC_REGION_FLAG_LARGE, and all other
+// allocations prefer the remaining areas.  If large areas are divided into
+// pages then a large allocation in one is rounded up to whole pages, which
+// n_blocks is updated to.
+STATIC mp_state_mem_area_t *gc_find_free_run_in_areas(size_t n_bytes, size_t *n_blocks, size_t *start_block_out) {
+    bool large = n_bytes >= MICROPY_GC_REGION_LARGE_THRESHOLD;
+    for (int pass = 0; pass < 2; pass++) {
+        for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = area->next) {
+            bool preferred = ((area->flags & GC_REGION_FLAG_LARGE) != 0) == large;
+            if (preferred != (pass == 0)) {
+                continue;
+            }
+            #if MICROPY_GC_LARGE_PAGE_BLOCKS
+            if (large && (area->flags & GC_REGION_FLAG_LARGE)) {
+                if (gc_find_free_pages(area, *n_blocks, start_block_out)) {
+                    *n_blocks = (*n_blocks + MICROPY_GC_LARGE_PAGE_BLOCKS - 1) / MICROPY_GC_LARGE_PAGE_BLOCKS * MICROPY_GC_LARGE_PAGE_BLOCKS;
+                    return area;
+                }
+                continue;
+            }
+            #endif
+            if (gc_find_free_run(area, *n_blocks, start_block_out)) {
+                return area;
+            }
+        }
+    }
+    return NULL;
+}
+#endif
+
+#if MICROPY_GC_ARENA
+#if MICROPY_GC_INCREMENTAL
+// The arena's block gets new pointers, so must be rescanned by a collection
+// in progress.
+STATIC void gc_arena_set_dirty(mp_gc_arena_t *arena) {
+    if (MP_STATE_MEM(gc_incremental_active)) {
+        GC_ENTER();
+        mp_state_mem_area_t *area = gc_get_ptr_area(arena);
+        DTB_SET(area, BLOCK_FROM_PTR(area, arena));
+        GC_EXIT();
+    }
+}
+#else
+#define gc_arena_set_dirty(arena) (void)(arena)
+#endif
+
+STATIC void *gc_arena_alloc(mp_gc_arena_t *arena, size_t n_bytes) {
+    n_bytes = (n_bytes + GC_ARENA_ALIGN - 1) & ~(GC_ARENA_ALIGN - 1);
+    if (n_bytes > arena->end - arena->cur) {
+        return NULL;
+    }
+    gc_arena_set_dirty(arena);
+    // the free part of an arena is kept zeroed
+    arena->last = arena->cur;
+    arena->cur += n_bytes;
+    return (byte *)arena + arena->last;
+}
+
+// Resize the most recent allocation of an arena in place, if it fits.
+STATIC bool gc_arena_resize(mp_gc_arena_t *arena, void *ptr, size_t n_bytes) {
+    size_t offset = (byte *)ptr - (byte *)arena;
+    n_bytes = (n_bytes + GC_ARENA_ALIGN - 1) & ~(GC_ARENA_ALIGN - 1);
+    if (offset != arena->last || n_bytes > arena->end - offset) {
+        return false;
+    }
+    if (offset + n_bytes < arena->cur) {
+        memset((byte *)arena + offset + n_bytes, 0, arena->cur - (offset + n_bytes));
+    }
+    gc_arena_set_dirty(arena);
+    arena->cur = offset + n_bytes;
+    return true;
+}
+
+STATIC void gc_arena_list_remove(mp_gc_arena_t *arena) {
+    GC_ENTER();
+    mp_gc_arena_t *prev = NULL;
+    for (mp_gc_arena_t *a = MP_STATE_MEM(gc_arena_list); a != NULL; prev = a, a = GC_ARENA_NEXT(a)) {
+        if (a == arena) {
+            if (prev == NULL) {
+                MP_STATE_MEM(gc_arena_list) = GC_ARENA_NEXT(a);
+            } else {
+                prev->next_inv = a->next_inv;
+            }
+            break;
+        }
+    }
+    GC_EXIT();
+}
+
+#if MICROPY_GC_ARENA_CHECK
+// Returns the chunk of the chain of arena chunks that ptr points into the
+// allocations of, or NULL.
+STATIC mp_gc_arena_t *gc_arena_chain_find(mp_gc_arena_t *chain, const void *ptr) {
+    for (; chain != NULL; chain = chain->prev) {
+        if ((const byte *)ptr >= (byte *)chain + GC_ARENA_HEADER_SIZE && (const byte *)ptr < (byte *)chain + chain->end) {
+            return chain;
+        }
+    }
+    return NULL;
+}
+
+STATIC bool gc_arena_refs_in(void **ptrs, size_t len, mp_gc_arena_t *chain) {
+    for (size_t i = 0; i < len; i++) {
+        if (gc_arena_chain_find(chain, ptrs[i]) != NULL) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Returns true if block holds the state of a running function or generator.
+STATIC bool gc_arena_is_code_state(void **ptrs) {
+    if (((mp_obj_base_t *)ptrs)->type == &mp_type_gen_instance) {
+        return true;
+    }
+    // a heap-allocated mp_code_state_t starts with its function
+    return gc_get_ptr_area(ptrs[0]) != NULL && ((mp_obj_base_t *)ptrs[0])->type == &mp_type_fun_bc;
+}
+
+// Returns true if anything that's still alive refers into the chunks of an
+// arena.  The C stack and the state of functions can't be checked exactly
+// because they are full of stale pointers, so a reference from them, which
+// may be a local variable, only sets *referenced.
+STATIC bool gc_arena_escaped(mp_gc_arena_t *chain, bool *referenced) {
+    // Collect with the chunks already marked, so they're not traced: what's
+    // left afterwards is alive without the help of the arena.  The collection
+    // notes whether any pointer it follows, exact or not, is into the arena.
+    GC_ENTER();
+    for (mp_gc_arena_t *chunk = chain; chunk != NULL; chunk = chunk->prev) {
+        mp_state_mem_area_t *area = gc_get_ptr_area(chunk);
+        ATB_HEAD_TO_MARK(area, BLOCK_FROM_PTR(area, chunk));
+    }
+    MP_STATE_MEM(gc_arena_checked) = chain->base;
+    MP_STATE_MEM(gc_arena_checked_found) = false;
+    GC_EXIT();
+    gc_collect();
+
+    GC_ENTER();
+    MP_STATE_MEM(gc_arena_checked) = NULL;
+    *referenced = MP_STATE_MEM(gc_arena_checked_found);
+    void **ptrs = (void **)(void *)&mp_state_ctx;
+    size_t root_start = offsetof(mp_state_ctx_t, thread.dict_locals);
+    size_t root_end = offsetof(mp_state_ctx_t, vm.qstr_last_chunk);
+    bool escaped = gc_arena_refs_in(ptrs + root_start / sizeof(void *), (root_end - root_start) / sizeof(void *), chain);
+    #if MICROPY_MODULE_FROZEN_MPY && MICROPY_MODULE_FROZEN_ROM_GLOBALS
+    escaped = escaped || gc_arena_refs_in((void **)mp_frozen_mpy_globals, FROZEN_GLOBALS_NUM_PTRS, chain);
+    #endif
+    for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL && !escaped; area = NEXT_AREA(area)) {
+        for (size_t block = 0; block < AREA_NUM_BLOCKS(area) && !escaped; block++) {
+            byte kind = ATB_GET_KIND(area, block);
+            if (kind != AT_HEAD && kind != AT_MARK) {
+                continue;
+            }
+            ptrs = (void **)PTR_FROM_BLOCK(area, block);
+            size_t n_blocks = 0;
+            do {
+                n_blocks += 1;
+            } while (ATB_GET_KIND(area, block + n_blocks) == AT_TAIL);
+            bool is_chunk = false;
+            for (mp_gc_arena_t *chunk = chain; chunk != NULL; chunk = chunk->prev) {
+                is_chunk |= (void **)chunk == ptrs;
+            }
+            if (!is_chunk && !gc_arena_is_code_state(ptrs)) {
+                escaped = gc_arena_refs_in(ptrs, n_blocks * BYTES_PER_BLOCK / sizeof(void *), chain);
+            }
+        }
+    }
+    GC_EXIT();
+    return escaped;
+}
+#endif
+
+// Add a chunk with room for n_bytes to the given arena, for the first chunk
+// base is NULL.  The chunk becomes the innermost arena of this thread.
+STATIC mp_gc_arena_t *gc_arena_new_chunk(mp_gc_arena_t *base, size_t n_bytes) {
+    n_bytes = (n_bytes + GC_ARENA_ALIGN - 1) & ~(GC_ARENA_ALIGN - 1);
+    mp_gc_arena_t *arena = gc_alloc(GC_ARENA_HEADER_SIZE + n_bytes, GC_ALLOC_FLAG_NO_ARENA);
+    if (arena == NULL) {
+        return NULL;
+    }
+    memset((byte *)arena + GC_ARENA_HEADER_SIZE, 0, n_bytes);
+    arena->prev = MP_STATE_THREAD(gc_arena);
+    arena->base = base != NULL ? base : arena;
+    arena->cur = GC_ARENA_HEADER_SIZE;
+    arena->last = 0;
+    arena->end = GC_ARENA_HEADER_SIZE + n_bytes;
+    GC_ENTER();
+    arena->next_inv = ~(uintptr_t)MP_STATE_MEM(gc_arena_list);
+    MP_STATE_MEM(gc_arena_list) = arena;
+    GC_EXIT();
+    MP_STATE_THREAD(gc_arena) = arena;
+    return arena;
+}
+
+void *gc_arena_begin(size_t n_bytes) {
+    return gc_arena_new_chunk(NULL, n_bytes);
+}
+
+bool gc_arena_suspend(const void *owner) {
+    bool suspended = MP_STATE_THREAD(gc_arena_suspended);
+    mp_gc_arena_t *arena = MP_STATE_THREAD(gc_arena);
+    if (arena != NULL) {
+        GC_ENTER();
+        mp_gc_arena_t *owner_arena = owner != NULL ? gc_arena_find(owner) : NULL;
+        GC_EXIT();
+        if (owner_arena == NULL || owner_arena->base != arena->base) {
+            MP_STATE_THREAD(gc_arena_suspended) = true;
+        }
+    }
+    return suspended;
+}
+
+void gc_arena_resume(bool suspended) {
+    MP_STATE_THREAD(gc_arena_suspended) = suspended;
+}
+
+bool gc_arena_end(void *arena_in, bool release) {
+    mp_gc_arena_t *arena = arena_in;
+
+    // Take the chunks of the arena off this thread's arenas, they are normally
+    // the innermost ones.  They are relinked through prev, oldest first.
+    mp_gc_arena_t *chain = NULL;
+    for (mp_gc_arena_t **a = &MP_STATE_THREAD(gc_arena); *a != NULL;) {
+        mp_gc_arena_t *chunk = *a;
+        if (chunk->base != arena) {
+            a = &chunk->prev;
+            continue;
+        }
+        *a = chunk->prev;
+        chunk->prev = chain;
+        chain = chunk;
+        if (chunk == arena) {
+            break;
+        }
+    }
+    // an allocation that failed may have left the arena suspended
+    MP_STATE_THREAD(gc_arena_suspended) = false;
+
+    #if MICROPY_GC_ARENA_CHECK
+    if (release && MP_STATE_THREAD(gc_lock_depth) == 0) {
+        bool referenced;
+        if (gc_arena_escaped(chain, &referenced)) {
+            return false;
+        }
+        // the C stack or a local variable may still refer into the arena
+        release = !referenced;
+    }
+    #endif
+
+    if (!release || MP_STATE_THREAD(gc_lock_depth) > 0) {
+        // the GC frees each chunk once nothing refers into it
+        while (chain != NULL) {
+            mp_gc_arena_t *chunk = chain;
+            chain = chunk->prev;
+            chunk->prev = NULL;
+        }
+        return true;
+    }
+    while (chain != NULL) {
+        mp_gc_arena_t *chunk = chain;
+        chain = chunk->prev;
+        gc_arena_list_remove(chunk);
+        gc_free(chunk);
     }
+    return true;
 }
+#endif
 
-STATIC void gc_deal_with_stack_overflow(void) {
-    while (MP_STATE_MEM(gc_stack_overflow)) {
-        MP_STATE_MEM(gc_stack_overflow) = 0;
+#if MICROPY_GC_ALLOC_PROFILE
+// Count an allocation against the line of bytecode being executed on this
+// thread.  Allocations made while no bytecode runs, such as by the compiler
+// at the REPL, aren't counted, and native code counts as its caller's line.
+STATIC void gc_alloc_profile_sample(size_t n_bytes) {
+    const mp_code_state_t *code_state = MP_STATE_THREAD(current_code_state);
+    if (code_state == NULL) {
+        return;
+    }
 
-        // scan entire memory looking for blocks which have been marked but not their children
-        for (size_t block = 0; block < MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB; block++) {
-            // trace (again) if mark bit set
-            if (ATB_GET_KIND(block) == AT_MARK) {
-                gc_mark_subtree(block);
-            }
+    qstr source_file, block_name;
+    size_t source_line = mp_bytecode_get_location(code_state->fun_bc->bytecode, code_state->ip,
+        &source_file, &block_name);
+
+    GC_ENTER();
+    mp_gc_alloc_profile_entry_t *entry = MP_STATE_MEM(gc_alloc_profile);
+    mp_gc_alloc_profile_entry_t *top = entry + MP_STATE_MEM(gc_alloc_profile_len);
+    for (; entry < top; ++entry) {
+        if (entry->source_line == source_line && entry->source_file == source_file
+            && entry->block_name == block_name) {
+            break;
         }
     }
+    if (entry == top) {
+        if (MP_STATE_MEM(gc_alloc_profile_len) == MICROPY_GC_ALLOC_PROFILE_SIZE) {
+            // the table is full, the sample is dropped
+            GC_EXIT();
+            return;
+        }
+        MP_STATE_MEM(gc_alloc_profile_len) += 1;
+        entry->source_file = source_file;
+        entry->block_name = block_name;
+        entry->source_line = source_line;
+        entry->count = 0;
+        entry->n_bytes = 0;
+    }
+    entry->count += 1;
+    entry->n_bytes += n_bytes;
+    GC_EXIT();
 }
 
-STATIC void gc_sweep(void) {
-    #if MICROPY_PY_GC_COLLECT_RETVAL
-    MP_STATE_MEM(gc_collected) = 0;
-    #endif
-    // free unmarked heads and their tails
-    int free_tail = 0;
-    for (size_t block = 0; block < MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB; block++) {
-        switch (ATB_GET_KIND(block)) {
-            case AT_HEAD:
-                #if MICROPY_ENABLE_FINALISER
-                if (FTB_GET(block)) {
-                    mp_obj_base_t *obj = (mp_obj_base_t *)PTR_FROM_BLOCK(block);
-                    if (obj->type != NULL) {
-                        // if the object has a type then see if it has a __del__ method
-                        mp_obj_t dest[2];
-                        mp_load_method_maybe(MP_OBJ_FROM_PTR(obj), MP_QSTR___del__, dest);
-                        if (dest[0] != MP_OBJ_NULL) {
-                            // load_method returned a method, execute it in a protected environment
-                            #if MICROPY_ENABLE_SCHEDULER
-                            mp_sched_lock();
-                            #endif
-                            mp_call_function_1_protected(dest[0], dest[1]);
-                            #if MICROPY_ENABLE_SCHEDULER
-                            mp_sched_unlock();
-                            #endif
-                        }
-                    }
-                    // clear finaliser flag
-                    FTB_CLEAR(block);
-                }
-                #endif
-                free_tail = 1;
-                DEBUG_printf("gc_sweep(%p)\n", (void *)PTR_FROM_BLOCK(block));
-                #if MICROPY_PY_GC_COLLECT_RETVAL
-                MP_STATE_MEM(gc_collected)++;
-                #endif
-                // fall through to free the head
-                MP_FALLTHROUGH
-
-            case AT_TAIL:
-                if (free_tail) {
-                    ATB_ANY_TO_FREE(block);
-                    #if CLEAR_ON_SWEEP
-                    memset((void *)PTR_FROM_BLOCK(block), 0, BYTES_PER_BLOCK);
-                    #endif
-                }
-                break;
-
-            case AT_MARK:
-                ATB_MARK_TO_HEAD(block);
-                free_tail = 0;
-                break;
+size_t gc_alloc_profile(mp_gc_alloc_profile_entry_t *dest, bool reset) {
+    GC_ENTER();
+    size_t len = MP_STATE_MEM(gc_alloc_profile_len);
+    // insertion sort into dest, by descending count
+    for (size_t i = 0; i < len; ++i) {
+        mp_gc_alloc_profile_entry_t *entry = &MP_STATE_MEM(gc_alloc_profile)[i];
+        size_t j = i;
+        for (; j > 0 && dest[j - 1].count < entry->count; --j) {
+            dest[j] = dest[j - 1];
         }
+        dest[j] = *entry;
     }
+    if (reset) {
+        gc_alloc_profile_reset();
+    }
+    GC_EXIT();
+    return len;
 }
+#endif
 
-void gc_collect_start(void) {
+#if MICROPY_GC_TLAB
+// Claim a run of up to MICROPY_GC_TLAB_BLOCKS free blocks for a thread's
+// allocation buffer, each marked as the head of a one-block allocation.  The
+// run starts at a free block found as for a one-block allocation, so it's
+// as cheap to find and fills the same holes.  Returns false if there are no
+// free blocks, or if it's time for a collection, which is left to gc_alloc.
+STATIC bool gc_tlab_refill(mp_gc_tlab_t *tlab) {
     GC_ENTER();
-    MP_STATE_THREAD(gc_lock_depth)++;
+
+    #if MICROPY_GC_INCREMENTAL
+    // blocks allocated during an incremental collection must be marked dirty
+    if (MP_STATE_MEM(gc_incremental_active)) {
+        GC_EXIT();
+        return false;
+    }
+    #endif
+
     #if MICROPY_GC_ALLOC_THRESHOLD
-    MP_STATE_MEM(gc_alloc_amount) = 0;
+    if (MP_STATE_MEM(gc_auto_collect_enabled) && MP_STATE_MEM(gc_alloc_amount) >= MP_STATE_MEM(gc_alloc_threshold)) {
+        GC_EXIT();
+        return false;
+    }
     #endif
-    MP_STATE_MEM(gc_stack_overflow) = 0;
 
-    // Trace root pointers.  This relies on the root pointers being organised
-    // correctly in the mp_state_ctx structure.  We scan nlr_top, dict_locals,
-    // dict_globals, then the root pointer section of mp_state_vm.
-    void **ptrs = (void **)(void *)&mp_state_ctx;
-    size_t root_start = offsetof(mp_state_ctx_t, thread.dict_locals);
-    size_t root_end = offsetof(mp_state_ctx_t, vm.qstr_last_chunk);
-    gc_collect_root(ptrs + root_start / sizeof(void *), (root_end - root_start) / sizeof(void *));
+    size_t start_block;
+    #if MICROPY_GC_SPLIT_HEAP
+    size_t n_run = 1;
+    mp_state_mem_area_t *area = gc_find_free_run_in_areas(BYTES_PER_BLOCK, &n_run, &start_block);
+    if (area == NULL) {
+    #else
+    mp_state_mem_area_t *area = &MP_STATE_MEM(area);
+    if (!gc_find_free_run(area, 1, &start_block)) {
+    #endif
+        GC_EXIT();
+        return false;
+    }
 
-    #if MICROPY_ENABLE_PYSTACK
-    // Trace root pointers from the Python stack.
-    ptrs = (void **)(void *)MP_STATE_THREAD(pystack_start);
-    gc_collect_root(ptrs, (MP_STATE_THREAD(pystack_cur) - MP_STATE_THREAD(pystack_start)) / sizeof(void *));
+    size_t n_blocks = 0;
+    do {
+        ATB_FREE_TO_HEAD(area, start_block + n_blocks);
+        n_blocks += 1;
+    } while (n_blocks < MICROPY_GC_TLAB_BLOCKS && start_block + n_blocks < AREA_NUM_BLOCKS(area)
+             && ATB_GET_KIND(area, start_block + n_blocks) == AT_FREE);
+    byte *start = (byte *)PTR_FROM_BLOCK(area, start_block);
+    memset(start, 0, n_blocks * BYTES_PER_BLOCK);
+    #if MICROPY_GC_GENERATIONAL
+    gc_young_extend(area, start_block, start_block + n_blocks);
     #endif
-}
 
-void gc_collect_root(void **ptrs, size_t len) {
-    for (size_t i = 0; i < len; i++) {
-        void *ptr = ptrs[i];
-        if (VERIFY_PTR(ptr)) {
-            size_t block = BLOCK_FROM_PTR(ptr);
-            if (ATB_GET_KIND(block) == AT_HEAD) {
-                // An unmarked head: mark it, and mark all its children
-                TRACE_MARK(block, ptr);
-                ATB_HEAD_TO_MARK(block);
-                gc_mark_subtree(block);
-            }
-        }
+    if (tlab->end == NULL) {
+        // the first buffer of this thread
+        tlab->next = MP_STATE_MEM(gc_tlab_list);
+        MP_STATE_MEM(gc_tlab_list) = tlab;
     }
-}
+    tlab->end = start + n_blocks * BYTES_PER_BLOCK;
+    __atomic_store_n(&tlab->cur, start, __ATOMIC_RELEASE);
+    MP_STATE_MEM(gc_tlab_count) += n_blocks;
+    #if MICROPY_GC_ALLOC_THRESHOLD
+    MP_STATE_MEM(gc_alloc_amount) += n_blocks;
+    #endif
+    #if MICROPY_GC_STATS
+    MP_STATE_MEM(gc_stats).alloc += n_blocks;
+    gc_stats_use(n_blocks, true);
+    #endif
 
-void gc_collect_end(void) {
-    gc_deal_with_stack_overflow();
-    gc_sweep();
-    MP_STATE_MEM(gc_last_free_atb_index) = 0;
-    MP_STATE_THREAD(gc_lock_depth)--;
     GC_EXIT();
+    return true;
 }
 
-void gc_sweep_all(void) {
-    GC_ENTER();
-    MP_STATE_THREAD(gc_lock_depth)++;
-    MP_STATE_MEM(gc_stack_overflow) = 0;
-    gc_collect_end();
-}
-
-void gc_info(gc_info_t *info) {
-    GC_ENTER();
-    info->total = MP_STATE_MEM(gc_pool_end) - MP_STATE_MEM(gc_pool_start);
-    info->used = 0;
-    info->free = 0;
-    info->max_free = 0;
-    info->num_1block = 0;
-    info->num_2block = 0;
-    info->max_block = 0;
-    bool finish = false;
-    for (size_t block = 0, len = 0, len_free = 0; !finish;) {
-        size_t kind = ATB_GET_KIND(block);
-        switch (kind) {
-            case AT_FREE:
-                info->free += 1;
-                len_free += 1;
-                len = 0;
-                break;
-
-            case AT_HEAD:
-                info->used += 1;
-                len = 1;
-                break;
-
-            case AT_TAIL:
-                info->used += 1;
-                len += 1;
-                break;
-
-            case AT_MARK:
-                // shouldn't happen
-                break;
+// Take a zeroed block from the current thread's allocation buffer, refilling
+// it if needed.  Returns NULL if gc_alloc must allocate the block instead.
+STATIC void *gc_tlab_alloc(void) {
+    mp_gc_tlab_t *tlab = &MP_STATE_THREAD(gc_tlab);
+    for (bool refilled = false;; refilled = true) {
+        // only a collection changes cur on another thread, by retiring the
+        // buffer, in which case the compare-and-swap fails
+        byte *cur = __atomic_load_n(&tlab->cur, __ATOMIC_RELAXED);
+        if (cur != tlab->end
+            && __atomic_compare_exchange_n(&tlab->cur, &cur, cur + BYTES_PER_BLOCK, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            return cur;
         }
-
-        block++;
-        finish = (block == MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB);
-        // Get next block type if possible
-        if (!finish) {
-            kind = ATB_GET_KIND(block);
+        if (refilled || !gc_tlab_refill(tlab)) {
+            return NULL;
         }
+    }
+}
 
-        if (finish || kind == AT_FREE || kind == AT_HEAD) {
-            if (len == 1) {
-                info->num_1block += 1;
-            } else if (len == 2) {
-                info->num_2block += 1;
-            }
-            if (len > info->max_block) {
-                info->max_block = len;
-            }
-            if (finish || kind == AT_HEAD) {
-                if (len_free > info->max_free) {
-                    info->max_free = len_free;
-                }
-                len_free = 0;
-            }
+void gc_tlab_release(void) {
+    mp_gc_tlab_t *tlab = &MP_STATE_THREAD(gc_tlab);
+    if (tlab->end == NULL) {
+        // this thread never had a buffer
+        return;
+    }
+    GC_ENTER();
+    gc_tlab_retire(tlab);
+    for (mp_gc_tlab_t **t = &MP_STATE_MEM(gc_tlab_list); *t != NULL; t = &(*t)->next) {
+        if (*t == tlab) {
+            *t = tlab->next;
+            break;
         }
     }
-
-    info->used *= BYTES_PER_BLOCK;
-    info->free *= BYTES_PER_BLOCK;
+    tlab->cur = NULL;
+    tlab->end = NULL;
     GC_EXIT();
 }
+#endif
 
-void *gc_alloc(size_t n_bytes, unsigned int alloc_flags) {
+void *MICROPY_WRAP_GC_ALLOC(gc_alloc)(size_t n_bytes, unsigned int alloc_flags) {
     bool has_finaliser = alloc_flags & GC_ALLOC_FLAG_HAS_FINALISER;
     size_t n_blocks = ((n_bytes + BYTES_PER_BLOCK - 1) & (~(BYTES_PER_BLOCK - 1))) / BYTES_PER_BLOCK;
     DEBUG_printf("gc_alloc(" UINT_FMT " bytes -> " UINT_FMT " blocks)\n", n_bytes, n_blocks);
@@ -451,80 +2489,152 @@ void *gc_alloc(size_t n_bytes, unsigned int alloc_flags) {
         return NULL;
     }
 
+    #if MICROPY_GC_ALLOC_PROFILE
+    // the countdown is shared by all threads, and arena and buffer allocations
+    // below don't take the lock, so it's taken here just for the countdown
     GC_ENTER();
+    bool sample = --MP_STATE_MEM(gc_alloc_profile_countdown) == 0;
+    if (sample) {
+        gc_alloc_profile_next();
+    }
+    GC_EXIT();
+    if (sample) {
+        gc_alloc_profile_sample(n_bytes);
+    }
+    #endif
 
-    size_t i;
+    #if MICROPY_GC_ARENA
+    // objects with a finaliser need a block of their own for it to be run
+    mp_gc_arena_t *arena = MP_STATE_THREAD(gc_arena);
+    if (arena != NULL && !MP_STATE_THREAD(gc_arena_suspended)
+        && !(alloc_flags & (GC_ALLOC_FLAG_HAS_FINALISER | GC_ALLOC_FLAG_NO_ARENA))) {
+        void *ptr = gc_arena_alloc(arena, n_bytes);
+        if (ptr == NULL) {
+            // grow the arena by another chunk, big enough for this allocation
+            arena = gc_arena_new_chunk(arena->base, MAX(n_bytes, arena->base->end - GC_ARENA_HEADER_SIZE));
+            if (arena == NULL) {
+                return NULL;
+            }
+            ptr = gc_arena_alloc(arena, n_bytes);
+        }
+        return ptr;
+    }
+    #endif
+
+    #if MICROPY_GC_TLAB
+    if (n_blocks == 1 && !(alloc_flags & (GC_ALLOC_FLAG_HAS_FINALISER | GC_ALLOC_FLAG_NO_SCAN))) {
+        void *ptr = gc_tlab_alloc();
+        if (ptr != NULL) {
+            return ptr;
+        }
+    }
+    #endif
+
+    GC_ENTER();
+
+    mp_state_mem_area_t *area;
     size_t end_block;
     size_t start_block;
-    size_t n_free;
     int collected = !MP_STATE_MEM(gc_auto_collect_enabled);
+    #if MICROPY_GC_GENERATIONAL
+    // Automatic collections start with a minor one, unless it's time for a major one.
+    bool try_minor = MP_STATE_MEM(gc_minor_since_major) < MICROPY_GC_GENERATIONAL_MAJOR_INTERVAL;
+    #endif
 
     #if MICROPY_GC_ALLOC_THRESHOLD
     if (!collected && MP_STATE_MEM(gc_alloc_amount) >= MP_STATE_MEM(gc_alloc_threshold)) {
         GC_EXIT();
-        gc_collect();
+        #if MICROPY_GC_GENERATIONAL
+        // after a minor collection a major one is still allowed if the allocation fails
+        collected = !try_minor;
+        MP_STATE_MEM(gc_minor_requested) = try_minor;
+        try_minor = false;
+        #else
         collected = 1;
+        #endif
+        gc_collect();
         GC_ENTER();
     }
     #endif
 
     for (;;) {
-
-        // look for a run of n_blocks available blocks
-        n_free = 0;
-        for (i = MP_STATE_MEM(gc_last_free_atb_index); i < MP_STATE_MEM(gc_alloc_table_byte_len); i++) {
-            byte a = MP_STATE_MEM(gc_alloc_table_start)[i];
-            // *FORMAT-OFF*
-            if (ATB_0_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 0; goto found; } } else { n_free = 0; }
-            if (ATB_1_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 1; goto found; } } else { n_free = 0; }
-            if (ATB_2_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 2; goto found; } } else { n_free = 0; }
-            if (ATB_3_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 3; goto found; } } else { n_free = 0; }
-            // *FORMAT-ON*
+        #if MICROPY_GC_SPLIT_HEAP
+        area = gc_find_free_run_in_areas(n_bytes, &n_blocks, &start_block);
+        if (area != NULL) {
+            break;
         }
+        #else
+        area = &MP_STATE_MEM(area);
+        if (gc_find_free_run(area, n_blocks, &start_block)) {
+            break;
+        }
+        #endif
 
         GC_EXIT();
         // nothing found!
         if (collected) {
+            #if MICROPY_GC_POOL
+            // the objects kept for reuse are given up before failing
+            if (gc_pool_release()) {
+                GC_ENTER();
+                continue;
+            }
+            #endif
             return NULL;
         }
+        #if MICROPY_GC_GENERATIONAL
+        if (try_minor) {
+            // a minor collection may free enough, if not then retry with a major one
+            DEBUG_printf("gc_alloc(" UINT_FMT "): no free mem, triggering minor GC\n", n_bytes);
+            try_minor = false;
+            MP_STATE_MEM(gc_minor_requested) = 1;
+            gc_collect();
+            GC_ENTER();
+            continue;
+        }
+        #endif
         DEBUG_printf("gc_alloc(" UINT_FMT "): no free mem, triggering GC\n", n_bytes);
         gc_collect();
         collected = 1;
         GC_ENTER();
     }
 
-    // found, ending at block i inclusive
-found:
-    // get starting and end blocks, both inclusive
-    end_block = i;
-    start_block = i - n_free + 1;
-
-    // Set last free ATB index to block after last block we found, for start of
-    // next scan.  To reduce fragmentation, we only do this if we were looking
-    // for a single free block, which guarantees that there are no free blocks
-    // before this one.  Also, whenever we free or shink a block we must check
-    // if this index needs adjusting (see gc_realloc and gc_free).
-    if (n_free == 1) {
-        MP_STATE_MEM(gc_last_free_atb_index) = (i + 1) / BLOCKS_PER_ATB;
-    }
+    // found, end block is inclusive
+    end_block = start_block + n_blocks - 1;
 
     // mark first block as used head
-    ATB_FREE_TO_HEAD(start_block);
+    ATB_FREE_TO_HEAD(area, start_block);
 
     // mark rest of blocks as used tail
     // TODO for a run of many blocks can make this more efficient
     for (size_t bl = start_block + 1; bl <= end_block; bl++) {
-        ATB_FREE_TO_TAIL(bl);
+        ATB_FREE_TO_TAIL(area, bl);
+    }
+
+    #if MICROPY_GC_GENERATIONAL
+    gc_young_extend(area, start_block, end_block + 1);
+    #endif
+
+    #if MICROPY_GC_INCREMENTAL
+    if (MP_STATE_MEM(gc_incremental_active)) {
+        // the new block will be filled with pointers to other blocks, so it
+        // must be scanned before the collection in progress can finish
+        DTB_SET(area, start_block);
     }
+    #endif
 
     // get pointer to first block
     // we must create this pointer before unlocking the GC so a collection can find it
-    void *ret_ptr = (void *)(MP_STATE_MEM(gc_pool_start) + start_block * BYTES_PER_BLOCK);
+    void *ret_ptr = (void *)(area->gc_pool_start + start_block * BYTES_PER_BLOCK);
     DEBUG_printf("gc_alloc(%p)\n", ret_ptr);
 
     #if MICROPY_GC_ALLOC_THRESHOLD
     MP_STATE_MEM(gc_alloc_amount) += n_blocks;
     #endif
+    #if MICROPY_GC_STATS
+    MP_STATE_MEM(gc_stats).alloc += n_blocks;
+    gc_stats_use(n_blocks, true);
+    #endif
 
     GC_EXIT();
 
@@ -546,13 +2656,21 @@ found:
         ((mp_obj_base_t *)ret_ptr)->type = NULL;
         // set mp_obj flag only if it has a finaliser
         GC_ENTER();
-        FTB_SET(start_block);
+        FTB_SET(area, start_block);
         GC_EXIT();
     }
     #else
     (void)has_finaliser;
     #endif
 
+    #if MICROPY_GC_NO_SCAN
+    if (alloc_flags & GC_ALLOC_FLAG_NO_SCAN) {
+        GC_ENTER();
+        NTB_SET(area, start_block);
+        GC_EXIT();
+    }
+    #endif
+
     #if EXTENSIVE_HEAP_PROFILING
     gc_dump_alloc_table();
     #endif
@@ -572,7 +2690,7 @@ void *gc_alloc_with_finaliser(mp_uint_t n_bytes) {
 
 // force the freeing of a piece of memory
 // TODO: freeing here does not call finaliser
-void gc_free(void *ptr) {
+void MICROPY_WRAP_GC_FREE(gc_free)(void *ptr) {
     if (MP_STATE_THREAD(gc_lock_depth) > 0) {
         // TODO how to deal with this error?
         return;
@@ -582,28 +2700,58 @@ void gc_free(void *ptr) {
 
     DEBUG_printf("gc_free(%p)\n", ptr);
 
+    #if MICROPY_GC_ARENA
+    mp_gc_arena_t *arena = MP_STATE_MEM(gc_arena_list) != NULL ? gc_arena_find(ptr) : NULL;
+    if (arena != NULL) {
+        // only the most recent allocation of an arena can be reclaimed
+        GC_EXIT();
+        if (gc_arena_resize(arena, ptr, 0)) {
+            arena->last = 0;
+        }
+    } else
+    #endif
     if (ptr == NULL) {
         GC_EXIT();
     } else {
         // get the GC block number corresponding to this pointer
-        assert(VERIFY_PTR(ptr));
-        size_t block = BLOCK_FROM_PTR(ptr);
-        assert(ATB_GET_KIND(block) == AT_HEAD);
+        mp_state_mem_area_t *area = gc_get_ptr_area(ptr);
+        assert(area != NULL);
+        size_t block = BLOCK_FROM_PTR(area, ptr);
+        assert(ATB_IS_ALLOCATED_HEAD(area, block));
 
         #if MICROPY_ENABLE_FINALISER
-        FTB_CLEAR(block);
+        FTB_CLEAR(area, block);
+        #endif
+        #if MICROPY_GC_NO_SCAN
+        NTB_CLEAR(area, block);
+        #endif
+        #if MICROPY_GC_INCREMENTAL
+        DTB_CLEAR(area, block);
+        #endif
+        #if MICROPY_GC_GENERATIONAL
+        GTB_CLEAR(area, block);
         #endif
 
         // set the last_free pointer to this block if it's earlier in the heap
-        if (block / BLOCKS_PER_ATB < MP_STATE_MEM(gc_last_free_atb_index)) {
-            MP_STATE_MEM(gc_last_free_atb_index) = block / BLOCKS_PER_ATB;
+        if (block / BLOCKS_PER_ATB < area->gc_last_free_atb_index) {
+            area->gc_last_free_atb_index = block / BLOCKS_PER_ATB;
         }
 
         // free head and all of its tail blocks
+        #if MICROPY_GC_SIZE_CLASSES || MICROPY_GC_STATS
+        size_t start_block = block;
+        #endif
         do {
-            ATB_ANY_TO_FREE(block);
+            ATB_ANY_TO_FREE(area, block);
             block += 1;
-        } while (ATB_GET_KIND(block) == AT_TAIL);
+        } while (ATB_GET_KIND(area, block) == AT_TAIL);
+
+        #if MICROPY_GC_SIZE_CLASSES
+        gc_size_class_push(area, start_block, block - start_block);
+        #endif
+        #if MICROPY_GC_STATS
+        gc_stats_use(block - start_block, false);
+        #endif
 
         GC_EXIT();
 
@@ -615,14 +2763,15 @@ void gc_free(void *ptr) {
 
 size_t gc_nbytes(const void *ptr) {
     GC_ENTER();
-    if (VERIFY_PTR(ptr)) {
-        size_t block = BLOCK_FROM_PTR(ptr);
-        if (ATB_GET_KIND(block) == AT_HEAD) {
+    mp_state_mem_area_t *area = gc_get_ptr_area(ptr);
+    if (area != NULL) {
+        size_t block = BLOCK_FROM_PTR(area, ptr);
+        if (ATB_IS_ALLOCATED_HEAD(area, block)) {
             // work out number of consecutive blocks in the chain starting with this on
             size_t n_blocks = 0;
             do {
                 n_blocks += 1;
-            } while (ATB_GET_KIND(block + n_blocks) == AT_TAIL);
+            } while (ATB_GET_KIND(area, block + n_blocks) == AT_TAIL);
             GC_EXIT();
             return n_blocks * BYTES_PER_BLOCK;
         }
@@ -680,12 +2829,35 @@ void *gc_realloc(void *ptr_in, size_t n_bytes, bool allow_move) {
 
     void *ptr = ptr_in;
 
+    #if MICROPY_GC_ARENA
+    mp_gc_arena_t *arena = MP_STATE_MEM(gc_arena_list) != NULL ? gc_arena_find(ptr) : NULL;
+    if (arena != NULL) {
+        if (gc_arena_resize(arena, ptr, n_bytes)) {
+            return ptr;
+        }
+        if (!allow_move) {
+            return NULL;
+        }
+        // The size of the allocation isn't known, but it can't extend past
+        // the used part of the arena.  The old memory stays in the arena, and
+        // the new memory only comes from the active arena if that's the one
+        // the old memory is in.
+        mp_gc_arena_t *active = MP_STATE_THREAD(gc_arena);
+        void *ptr_out = gc_alloc(n_bytes, active != NULL && active->base == arena->base ? 0 : GC_ALLOC_FLAG_NO_ARENA);
+        if (ptr_out != NULL) {
+            memcpy(ptr_out, ptr, MIN(n_bytes, arena->cur - (size_t)((byte *)ptr - (byte *)arena)));
+        }
+        return ptr_out;
+    }
+    #endif
+
     GC_ENTER();
 
     // get the GC block number corresponding to this pointer
-    assert(VERIFY_PTR(ptr));
-    size_t block = BLOCK_FROM_PTR(ptr);
-    assert(ATB_GET_KIND(block) == AT_HEAD);
+    mp_state_mem_area_t *area = gc_get_ptr_area(ptr);
+    assert(area != NULL);
+    size_t block = BLOCK_FROM_PTR(area, ptr);
+    assert(ATB_IS_ALLOCATED_HEAD(area, block));
 
     // compute number of new blocks that are requested
     size_t new_blocks = (n_bytes + BYTES_PER_BLOCK - 1) / BYTES_PER_BLOCK;
@@ -698,9 +2870,9 @@ void *gc_realloc(void *ptr_in, size_t n_bytes, bool allow_move) {
     // efficiently shrink it (see below for shrinking code).
     size_t n_free = 0;
     size_t n_blocks = 1; // counting HEAD block
-    size_t max_block = MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB;
+    size_t max_block = AREA_NUM_BLOCKS(area);
     for (size_t bl = block + n_blocks; bl < max_block; bl++) {
-        byte block_type = ATB_GET_KIND(bl);
+        byte block_type = ATB_GET_KIND(area, bl);
         if (block_type == AT_TAIL) {
             n_blocks++;
             continue;
@@ -726,14 +2898,21 @@ void *gc_realloc(void *ptr_in, size_t n_bytes, bool allow_move) {
     if (new_blocks < n_blocks) {
         // free unneeded tail blocks
         for (size_t bl = block + new_blocks, count = n_blocks - new_blocks; count > 0; bl++, count--) {
-            ATB_ANY_TO_FREE(bl);
+            ATB_ANY_TO_FREE(area, bl);
         }
 
         // set the last_free pointer to end of this block if it's earlier in the heap
-        if ((block + new_blocks) / BLOCKS_PER_ATB < MP_STATE_MEM(gc_last_free_atb_index)) {
-            MP_STATE_MEM(gc_last_free_atb_index) = (block + new_blocks) / BLOCKS_PER_ATB;
+        if ((block + new_blocks) / BLOCKS_PER_ATB < area->gc_last_free_atb_index) {
+            area->gc_last_free_atb_index = (block + new_blocks) / BLOCKS_PER_ATB;
         }
 
+        #if MICROPY_GC_SIZE_CLASSES
+        gc_size_class_push(area, block + new_blocks, n_blocks - new_blocks);
+        #endif
+        #if MICROPY_GC_STATS
+        gc_stats_use(n_blocks - new_blocks, false);
+        #endif
+
         GC_EXIT();
 
         #if EXTENSIVE_HEAP_PROFILING
@@ -747,9 +2926,19 @@ void *gc_realloc(void *ptr_in, size_t n_bytes, bool allow_move) {
     if (new_blocks <= n_blocks + n_free) {
         // mark few more blocks as used tail
         for (size_t bl = block + n_blocks; bl < block + new_blocks; bl++) {
-            assert(ATB_GET_KIND(bl) == AT_FREE);
-            ATB_FREE_TO_TAIL(bl);
+            assert(ATB_GET_KIND(area, bl) == AT_FREE);
+            ATB_FREE_TO_TAIL(area, bl);
+        }
+        #if MICROPY_GC_STATS
+        gc_stats_use(new_blocks - n_blocks, true);
+        #endif
+
+        #if MICROPY_GC_INCREMENTAL
+        if (MP_STATE_MEM(gc_incremental_active)) {
+            // the grown block must be rescanned, see comment in gc_alloc
+            DTB_SET(area, block);
         }
+        #endif
 
         GC_EXIT();
 
@@ -768,10 +2957,21 @@ void *gc_realloc(void *ptr_in, size_t n_bytes, bool allow_move) {
         return ptr_in;
     }
 
+    // the new chain keeps the flags of the old one, and isn't in an arena
+    // because the old one wasn't
+    unsigned int alloc_flags = GC_ALLOC_FLAG_NO_ARENA;
     #if MICROPY_ENABLE_FINALISER
-    bool ftb_state = FTB_GET(block);
-    #else
-    bool ftb_state = false;
+    if (FTB_GET(area, block)) {
+        alloc_flags |= GC_ALLOC_FLAG_HAS_FINALISER;
+    }
+    #endif
+    #if MICROPY_GC_NO_SCAN
+    if (NTB_GET(area, block)) {
+        alloc_flags |= GC_ALLOC_FLAG_NO_SCAN;
+    }
+    #endif
+    #if MICROPY_GC_GENERATIONAL
+    bool old = GTB_GET(area, block);
     #endif
 
     GC_EXIT();
@@ -782,7 +2982,7 @@ void *gc_realloc(void *ptr_in, size_t n_bytes, bool allow_move) {
     }
 
     // can't resize inplace; try to find a new contiguous chain
-    void *ptr_out = gc_alloc(n_bytes, ftb_state);
+    void *ptr_out = gc_alloc(n_bytes, alloc_flags);
 
     // check that the alloc succeeded
     if (ptr_out == NULL) {
@@ -792,6 +2992,23 @@ void *gc_realloc(void *ptr_in, size_t n_bytes, bool allow_move) {
     DEBUG_printf("gc_realloc(%p -> %p)\n", ptr_in, ptr_out);
     memcpy(ptr_out, ptr_in, n_blocks * BYTES_PER_BLOCK);
     gc_free(ptr_in);
+
+    #if MICROPY_GC_GENERATIONAL
+    if (old) {
+        // The new chain stays in the old generation like the one it replaces,
+        // as whatever points to it was updated without a write barrier, and
+        // the next minor collection scans it for the young blocks it may hold.
+        GC_ENTER();
+        void *ptr_old = ptr_out;
+        area = GC_GET_MARK_PTR_AREA(ptr_old);
+        if (area != NULL) {
+            block = BLOCK_FROM_PTR(area, ptr_old);
+            GTB_SET(area, block);
+            RTB_SET(area, block);
+        }
+        GC_EXIT();
+    }
+    #endif
     return ptr_out;
 }
 #endif // Alternative gc_realloc impl
@@ -803,134 +3020,147 @@ void gc_dump_info(void) {
         (uint)info.total, (uint)info.used, (uint)info.free);
     mp_printf(&mp_plat_print, " No. of 1-blocks: %u, 2-blocks: %u, max blk sz: %u, max free sz: %u\n",
         (uint)info.num_1block, (uint)info.num_2block, (uint)info.max_block, (uint)info.max_free);
+    #if MICROPY_GC_GENERATIONAL
+    mp_printf(&mp_plat_print, " old: %u, minor collections: %u, major collections: %u\n",
+        (uint)info.old, (uint)info.num_minor, (uint)info.num_major);
+    #endif
+    #if MICROPY_PY_THREAD && !MICROPY_PY_THREAD_GIL
+    mp_printf(&mp_plat_print, " lock acquisitions: %u", (uint)info.num_lock);
+    #if MICROPY_GC_TLAB
+    mp_printf(&mp_plat_print, ", thread buffer allocs: %u", (uint)info.num_tlab);
+    #endif
+    mp_printf(&mp_plat_print, "\n");
+    #endif
 }
 
 void gc_dump_alloc_table(void) {
     GC_ENTER();
     static const size_t DUMP_BYTES_PER_LINE = 64;
-    #if !EXTENSIVE_HEAP_PROFILING
-    // When comparing heap output we don't want to print the starting
-    // pointer of the heap because it changes from run to run.
-    mp_printf(&mp_plat_print, "GC memory layout; from %p:", MP_STATE_MEM(gc_pool_start));
-    #endif
-    for (size_t bl = 0; bl < MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB; bl++) {
-        if (bl % DUMP_BYTES_PER_LINE == 0) {
-            // a new line of blocks
-            {
-                // check if this line contains only free blocks
-                size_t bl2 = bl;
-                while (bl2 < MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB && ATB_GET_KIND(bl2) == AT_FREE) {
-                    bl2++;
-                }
-                if (bl2 - bl >= 2 * DUMP_BYTES_PER_LINE) {
-                    // there are at least 2 lines containing only free blocks, so abbreviate their printing
-                    mp_printf(&mp_plat_print, "\n       (%u lines all free)", (uint)(bl2 - bl) / DUMP_BYTES_PER_LINE);
-                    bl = bl2 & (~(DUMP_BYTES_PER_LINE - 1));
-                    if (bl >= MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB) {
-                        // got to end of heap
-                        break;
-                    }
-                }
-            }
-            // print header for new line of blocks
-            // (the cast to uint32_t is for 16-bit ports)
-            // mp_printf(&mp_plat_print, "\n%05x: ", (uint)(PTR_FROM_BLOCK(bl) & (uint32_t)0xfffff));
-            mp_printf(&mp_plat_print, "\n%05x: ", (uint)((bl * BYTES_PER_BLOCK) & (uint32_t)0xfffff));
-        }
-        int c = ' ';
-        switch (ATB_GET_KIND(bl)) {
-            case AT_FREE:
-                c = '.';
-                break;
-            /* this prints out if the object is reachable from BSS or STACK (for unix only)
-            case AT_HEAD: {
-                c = 'h';
-                void **ptrs = (void**)(void*)&mp_state_ctx;
-                mp_uint_t len = offsetof(mp_state_ctx_t, vm.stack_top) / sizeof(mp_uint_t);
-                for (mp_uint_t i = 0; i < len; i++) {
-                    mp_uint_t ptr = (mp_uint_t)ptrs[i];
-                    if (VERIFY_PTR(ptr) && BLOCK_FROM_PTR(ptr) == bl) {
-                        c = 'B';
-                        break;
+    for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+        #if !EXTENSIVE_HEAP_PROFILING
+        // When comparing heap output we don't want to print the starting
+        // pointer of the heap because it changes from run to run.
+        mp_printf(&mp_plat_print, "GC memory layout; from %p:", area->gc_pool_start);
+        #endif
+        for (size_t bl = 0; bl < AREA_NUM_BLOCKS(area); bl++) {
+            if (bl % DUMP_BYTES_PER_LINE == 0) {
+                // a new line of blocks
+                {
+                    // check if this line contains only free blocks
+                    size_t bl2 = bl;
+                    while (bl2 < AREA_NUM_BLOCKS(area) && ATB_GET_KIND(area, bl2) == AT_FREE) {
+                        bl2++;
                     }
-                }
-                if (c == 'h') {
-                    ptrs = (void**)&c;
-                    len = ((mp_uint_t)MP_STATE_THREAD(stack_top) - (mp_uint_t)&c) / sizeof(mp_uint_t);
-                    for (mp_uint_t i = 0; i < len; i++) {
-                        mp_uint_t ptr = (mp_uint_t)ptrs[i];
-                        if (VERIFY_PTR(ptr) && BLOCK_FROM_PTR(ptr) == bl) {
-                            c = 'S';
+                    if (bl2 - bl >= 2 * DUMP_BYTES_PER_LINE) {
+                        // there are at least 2 lines containing only free blocks, so abbreviate their printing
+                        mp_printf(&mp_plat_print, "\n       (%u lines all free)", (uint)(bl2 - bl) / DUMP_BYTES_PER_LINE);
+                        bl = bl2 & (~(DUMP_BYTES_PER_LINE - 1));
+                        if (bl >= AREA_NUM_BLOCKS(area)) {
+                            // got to end of area
                             break;
                         }
                     }
                 }
-                break;
+                // print header for new line of blocks
+                // (the cast to uint32_t is for 16-bit ports)
+                // mp_printf(&mp_plat_print, "\n%05x: ", (uint)(PTR_FROM_BLOCK(bl) & (uint32_t)0xfffff));
+                mp_printf(&mp_plat_print, "\n%05x: ", (uint)((bl * BYTES_PER_BLOCK) & (uint32_t)0xfffff));
             }
-            */
-            /* this prints the uPy object type of the head block */
-            case AT_HEAD: {
-                void **ptr = (void **)(MP_STATE_MEM(gc_pool_start) + bl * BYTES_PER_BLOCK);
-                if (*ptr == &mp_type_tuple) {
-                    c = 'T';
-                } else if (*ptr == &mp_type_list) {
-                    c = 'L';
-                } else if (*ptr == &mp_type_dict) {
-                    c = 'D';
-                } else if (*ptr == &mp_type_str || *ptr == &mp_type_bytes) {
-                    c = 'S';
-                }
-                #if MICROPY_PY_BUILTINS_BYTEARRAY
-                else if (*ptr == &mp_type_bytearray) {
-                    c = 'A';
-                }
-                #endif
-                #if MICROPY_PY_ARRAY
-                else if (*ptr == &mp_type_array) {
-                    c = 'A';
-                }
-                #endif
-                #if MICROPY_PY_BUILTINS_FLOAT
-                else if (*ptr == &mp_type_float) {
-                    c = 'F';
-                }
-                #endif
-                else if (*ptr == &mp_type_fun_bc) {
-                    c = 'B';
-                } else if (*ptr == &mp_type_module) {
-                    c = 'M';
-                } else {
+            int c = ' ';
+            switch (ATB_GET_KIND(area, bl)) {
+                case AT_FREE:
+                    c = '.';
+                    break;
+                /* this prints out if the object is reachable from BSS or STACK (for unix only)
+                case AT_HEAD: {
                     c = 'h';
-                    #if 0
-                    // This code prints "Q" for qstr-pool data, and "q" for qstr-str
-                    // data.  It can be useful to see how qstrs are being allocated,
-                    // but is disabled by default because it is very slow.
-                    for (qstr_pool_t *pool = MP_STATE_VM(last_pool); c == 'h' && pool != NULL; pool = pool->prev) {
-                        if ((qstr_pool_t *)ptr == pool) {
-                            c = 'Q';
+                    void **ptrs = (void**)(void*)&mp_state_ctx;
+                    mp_uint_t len = offsetof(mp_state_ctx_t, vm.stack_top) / sizeof(mp_uint_t);
+                    for (mp_uint_t i = 0; i < len; i++) {
+                        mp_uint_t ptr = (mp_uint_t)ptrs[i];
+                        if (VERIFY_PTR(ptr) && BLOCK_FROM_PTR(ptr) == bl) {
+                            c = 'B';
                             break;
                         }
-                        for (const byte **q = pool->qstrs, **q_top = pool->qstrs + pool->len; q < q_top; q++) {
-                            if ((const byte *)ptr == *q) {
-                                c = 'q';
+                    }
+                    if (c == 'h') {
+                        ptrs = (void**)&c;
+                        len = ((mp_uint_t)MP_STATE_THREAD(stack_top) - (mp_uint_t)&c) / sizeof(mp_uint_t);
+                        for (mp_uint_t i = 0; i < len; i++) {
+                            mp_uint_t ptr = (mp_uint_t)ptrs[i];
+                            if (VERIFY_PTR(ptr) && BLOCK_FROM_PTR(ptr) == bl) {
+                                c = 'S';
                                 break;
                             }
                         }
                     }
+                    break;
+                }
+                */
+                /* this prints the uPy object type of the head block */
+                case AT_HEAD: {
+                    void **ptr = (void **)(area->gc_pool_start + bl * BYTES_PER_BLOCK);
+                    if (*ptr == &mp_type_tuple) {
+                        c = 'T';
+                    } else if (*ptr == &mp_type_list) {
+                        c = 'L';
+                    } else if (*ptr == &mp_type_dict) {
+                        c = 'D';
+                    } else if (*ptr == &mp_type_str || *ptr == &mp_type_bytes) {
+                        c = 'S';
+                    }
+                    #if MICROPY_PY_BUILTINS_BYTEARRAY
+                    else if (*ptr == &mp_type_bytearray) {
+                        c = 'A';
+                    }
+                    #endif
+                    #if MICROPY_PY_ARRAY
+                    else if (*ptr == &mp_type_array) {
+                        c = 'A';
+                    }
                     #endif
+                    #if MICROPY_PY_BUILTINS_FLOAT
+                    else if (*ptr == &mp_type_float) {
+                        c = 'F';
+                    }
+                    #endif
+                    else if (*ptr == &mp_type_fun_bc) {
+                        c = 'B';
+                    } else if (*ptr == &mp_type_module) {
+                        c = 'M';
+                    } else {
+                        c = 'h';
+                        #if 0
+                        // This code prints "Q" for qstr-pool data, and "q" for qstr-str
+                        // data.  It can be useful to see how qstrs are being allocated,
+                        // but is disabled by default because it is very slow.
+                        for (qstr_pool_t *pool = MP_STATE_VM(last_pool); c == 'h' && pool != NULL; pool = pool->prev) {
+                            if ((qstr_pool_t *)ptr == pool) {
+                                c = 'Q';
+                                break;
+                            }
+                            for (const byte **q = pool->qstrs, **q_top = pool->qstrs + pool->len; q < q_top; q++) {
+                                if ((const byte *)ptr == *q) {
+                                    c = 'q';
+                                    break;
+                                }
+                            }
+                        }
+                        #endif
+                    }
+                    break;
                 }
-                break;
+                case AT_TAIL:
+                    c = '=';
+                    break;
+                case AT_MARK:
+                    c = 'm';
+                    break;
             }
-            case AT_TAIL:
-                c = '=';
-                break;
-            case AT_MARK:
-                c = 'm';
-                break;
+            mp_printf(&mp_plat_print, "%c", c);
         }
-        mp_printf(&mp_plat_print, "%c", c);
+        mp_print_str(&mp_plat_print, "\n");
     }
-    mp_print_str(&mp_plat_print, "\n");
     GC_EXIT();
 }
 
@@ -29,8 +29,20 @@
 #include <stdbool.h>
 #include <stddef.h>
 
+#include "py/mpconfig.h"
+
 void gc_init(void *start, void *end);
 
+#if MICROPY_GC_SPLIT_HEAP
+enum {
+    // the region is preferred for large allocations (eg slow external RAM)
+    GC_REGION_FLAG_LARGE = 1,
+};
+
+// Add another area of RAM to the heap, must be called after gc_init.
+void gc_add_region(void *start, void *end, unsigned int flags);
+#endif
+
 // These lock/unlock functions can be nested.
 // They can be used to prevent the GC from allocating/freeing.
 void gc_lock(void);
@@ -46,8 +58,55 @@ void gc_collect_end(void);
 // Use this function to sweep the whole heap and run all finalisers
 void gc_sweep_all(void);
 
+#if MICROPY_GC_INCREMENTAL
+// Do a time-bounded step of an incremental collection; returns true when done.
+bool gc_collect_step(mp_uint_t budget_us);
+bool gc_collect_in_progress(void);
+#endif
+
+#if MICROPY_GC_GENERATIONAL || MICROPY_GC_INCREMENTAL
+// Any C code that stores a pointer to a heap object into an existing heap
+// block must call this on the block that was written to (a pointer anywhere
+// into it will do): an old block is then scanned by the next minor collection,
+// and while an incremental collection is in progress the block gets rescanned.
+void gc_write_barrier(const void *ptr);
+#define MP_GC_WRITE_BARRIER(ptr) gc_write_barrier(ptr)
+#else
+#define MP_GC_WRITE_BARRIER(ptr) (void)(ptr)
+#endif
+
+#if MICROPY_FLOAT_FREELIST
+// Take a float object that the last collection found dead, or return NULL.
+void *gc_float_freelist_pop(void);
+#endif
+
+#if MICROPY_GC_POOL
+struct _mp_obj_type_t;
+// Take a zeroed block of n_bytes that held an object of the given type when
+// the last collection found it dead, or return NULL.  Dead objects of a type
+// are only kept once this has been called for it.  The caller sets the type.
+void *gc_pool_pop(const struct _mp_obj_type_t *type, size_t n_bytes);
+#endif
+
+#if MICROPY_GC_PARALLEL_MARK
+// A port that enables parallel marking must implement these.  The helper is
+// started on another core to call gc_parallel_mark_helper, and start returns
+// false if no core is available.  A helper that calls in after the collector
+// has finished marking returns straight away.  The lock must work between
+// both cores.
+bool gc_parallel_helper_start(void);
+void gc_parallel_lock(void);
+void gc_parallel_unlock(void);
+
+void gc_parallel_mark_helper(void);
+#endif
+
 enum {
     GC_ALLOC_FLAG_HAS_FINALISER = 1,
+    // the allocation must not come from the active arena
+    GC_ALLOC_FLAG_NO_ARENA = 2,
+    // the allocation holds no pointers to the heap, so the GC doesn't scan it
+    GC_ALLOC_FLAG_NO_SCAN = 4,
 };
 
 void *gc_alloc(size_t n_bytes, unsigned int alloc_flags);
@@ -55,14 +114,88 @@ void gc_free(void *ptr); // does not call finaliser
 size_t gc_nbytes(const void *ptr);
 void *gc_realloc(void *ptr, size_t n_bytes, bool allow_move);
 
+#if MICROPY_GC_ARENA
+// Start an arena with room for n_bytes on the current thread.  Until it ends,
+// allocations without a finaliser that fit are bump-allocated from it, and
+// gc_free/gc_realloc of those only reclaim or resize the most recent one.
+// Returns NULL if there is no memory for the arena.
+void *gc_arena_begin(size_t n_bytes);
+// End an arena.  If release is true then the arena's memory is freed at once,
+// so nothing allocated in it may be referenced afterwards, otherwise it's left
+// to be collected like any other block.  Returns false, without freeing the
+// arena, if the check finds something outside the arena that refers into it.
+// The check also leaves the arena to be collected if a local variable or the
+// C stack may refer into it.
+bool gc_arena_end(void *arena, bool release);
+// Memory that replaces the buffer of an existing object must live as long as
+// the object, so it may only come from the active arena if the object, which
+// owner points to or into, is in that arena too.  Otherwise allocations come
+// from the heap until gc_arena_resume is passed the value returned here, or
+// the arena ends.  For memory that belongs to the VM owner is NULL.
+bool gc_arena_suspend(const void *owner);
+void gc_arena_resume(bool suspended);
+#define MP_GC_ARENA_SUSPEND(owner) gc_arena_suspend(owner)
+#define MP_GC_ARENA_RESUME(suspended) gc_arena_resume(suspended)
+#else
+#define MP_GC_ARENA_SUSPEND(owner) ((void)(owner), false)
+#define MP_GC_ARENA_RESUME(suspended) (void)(suspended)
+#endif
+
+#if MICROPY_GC_TLAB
+// Give the blocks left in the current thread's allocation buffer back to the
+// heap.  A thread must call this before it finishes.
+void gc_tlab_release(void);
+#endif
+
+#if MICROPY_GC_COMPACT
+// Move the data of bytearray, array, bytes and str objects into free memory
+// lower in the heap, where nothing else refers to the data, so that free
+// memory gets merged into larger runs.  Returns the number of buffers moved.
+// On ports without a GIL no other thread may be running.
+size_t gc_compact(void);
+#endif
+
+#if MICROPY_HEAP_IMAGE
+// Forget the free lists and allocation buffers, which refer to blocks of the
+// heap, before its contents are replaced by a heap image.  Only the calling
+// thread may be running.
+void gc_drop_caches(void);
+#endif
+
+#if MICROPY_GC_ALLOC_PROFILE
+struct _mp_gc_alloc_profile_entry_t;
+// Copy the lines sampled by the allocation profile to dest, which must have
+// room for MICROPY_GC_ALLOC_PROFILE_SIZE entries, most sampled line first.
+// Returns the number of entries.  If reset is true the profile starts over.
+size_t gc_alloc_profile(struct _mp_gc_alloc_profile_entry_t *dest, bool reset);
+#endif
+
+#if MICROPY_GC_STATS
+struct _mp_gc_stats_t;
+// Copy the history of collections to dest.  If reset is true the counts and
+// pause times start over.
+void gc_stats(struct _mp_gc_stats_t *dest, bool reset);
+#endif
+
 typedef struct _gc_info_t {
-    size_t total;
-    size_t used;
-    size_t free;
-    size_t max_free;
+    size_t total; // in bytes
+    size_t used; // in bytes
+    size_t free; // in bytes
+    size_t max_free; // largest free run, in blocks
     size_t num_1block;
     size_t num_2block;
-    size_t max_block;
+    size_t max_block; // largest allocation, in blocks
+    #if MICROPY_GC_GENERATIONAL
+    size_t old;
+    size_t num_minor;
+    size_t num_major;
+    #endif
+    #if MICROPY_PY_THREAD && !MICROPY_PY_THREAD_GIL
+    size_t num_lock; // times the GC lock was taken
+    #endif
+    #if MICROPY_GC_TLAB
+    size_t num_tlab; // allocations from thread buffers, without the lock
+    #endif
 } gc_info_t;
 
 void gc_info(gc_info_t *info);
@@ -0,0 +1,267 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "py/heapimage.h"
+#include "py/gc.h"
+#include "py/runtime.h"
+#include "genhdr/mpversion.h"
+
+#if MICROPY_HEAP_IMAGE
+
+// An image is this header followed by the VM state, the GC settings and then,
+// for each heap area, its state and its memory (the tables and the pool).
+// There is no relocation information: the GC is conservative so can't tell
+// which words are pointers, and the heap also points into the firmware, so
+// an image can only be restored by the same firmware with the heap at the
+// same address.
+typedef struct _mp_heap_image_header_t {
+    uint32_t magic;
+    uint32_t firmware; // identifies the firmware that made the image
+    uint32_t checksum; // of everything after the header
+    uint32_t num_areas;
+    size_t len; // number of bytes after the header
+} mp_heap_image_header_t;
+
+// The GC settings that the application may have changed.
+typedef struct _mp_heap_image_gc_t {
+    uint16_t gc_auto_collect_enabled;
+    #if MICROPY_GC_ALLOC_THRESHOLD
+    size_t gc_alloc_amount;
+    size_t gc_alloc_threshold;
+    #endif
+} mp_heap_image_gc_t;
+
+#if MICROPY_GC_SPLIT_HEAP
+#define NEXT_AREA(area) ((area)->next)
+#else
+#define NEXT_AREA(area) (NULL)
+#endif
+
+#define HEAP_IMAGE_MAGIC (0x4948504d) // "MPHI"
+#define HEAP_IMAGE_HASH_INIT (2166136261)
+
+// FNV-1a
+STATIC uint32_t heap_image_hash(uint32_t h, const void *buf, size_t len) {
+    for (const byte *p = buf, *top = p + len; p < top; ++p) {
+        h = (h ^ *p) * 16777619;
+    }
+    return h;
+}
+
+STATIC uint32_t heap_image_firmware(void) {
+    const uintptr_t layout[] = {
+        (uintptr_t)&mp_state_ctx,
+        (uintptr_t)&mp_type_type,
+        (uintptr_t)&mp_heap_image_restore,
+        sizeof(mp_state_ctx_t),
+        MP_QSTRnumber_of,
+    };
+    static const char version[] = MICROPY_GIT_HASH " " MICROPY_BUILD_DATE;
+    uint32_t h = heap_image_hash(HEAP_IMAGE_HASH_INIT, layout, sizeof(layout));
+    return heap_image_hash(h, version, sizeof(version));
+}
+
+// Pass each part of the image after the header to fun.
+STATIC bool heap_image_walk(mp_heap_image_write_t fun, void *env) {
+    mp_heap_image_gc_t gc;
+    memset(&gc, 0, sizeof(gc));
+    gc.gc_auto_collect_enabled = MP_STATE_MEM(gc_auto_collect_enabled);
+    #if MICROPY_GC_ALLOC_THRESHOLD
+    gc.gc_alloc_amount = MP_STATE_MEM(gc_alloc_amount);
+    gc.gc_alloc_threshold = MP_STATE_MEM(gc_alloc_threshold);
+    #endif
+    if (!fun(env, &mp_state_ctx.vm, sizeof(mp_state_vm_t)) || !fun(env, &gc, sizeof(gc))) {
+        return false;
+    }
+    for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+        if (!fun(env, area, sizeof(mp_state_mem_area_t))
+            || !fun(env, area->gc_alloc_table_start, area->gc_pool_end - area->gc_alloc_table_start)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+typedef struct _heap_image_sum_t {
+    uint32_t checksum;
+    uint32_t num_areas;
+    size_t len;
+} heap_image_sum_t;
+
+STATIC bool heap_image_sum(void *env, const void *buf, size_t len) {
+    heap_image_sum_t *sum = env;
+    sum->checksum = heap_image_hash(sum->checksum, buf, len);
+    sum->len += len;
+    return true;
+}
+
+bool mp_heap_image_save(mp_heap_image_write_t write, void *env) {
+    #if MICROPY_GC_ARENA
+    if (MP_STATE_THREAD(gc_arena) != NULL) {
+        mp_raise_msg(&mp_type_RuntimeError, MP_ERROR_TEXT("can't save heap in an arena"));
+    }
+    #endif
+    #if MICROPY_QSTR_SNAPSHOT
+    // the qstrs would refer to the snapshot, which the image already includes
+    if (MP_STATE_VM(qstr_snapshot) != NULL) {
+        mp_raise_msg(&mp_type_RuntimeError, MP_ERROR_TEXT("can't save heap with qstr snapshot"));
+    }
+    #endif
+    #if MICROPY_PERSISTENT_CODE_LOAD_MAPPED
+    // the constants would refer to mapped files, which the image can't include
+    if (MP_STATE_VM(persistent_code_mapped)) {
+        mp_raise_msg(&mp_type_RuntimeError, MP_ERROR_TEXT("can't save heap with mapped .mpy"));
+    }
+    #endif
+
+    // a full collection finishes any incremental one and frees the garbage,
+    // and the heap must not change while the image is written
+    gc_collect();
+    #if MICROPY_GC_ARENA
+    if (MP_STATE_MEM(gc_arena_list) != NULL) {
+        mp_raise_msg(&mp_type_RuntimeError, MP_ERROR_TEXT("can't save heap in an arena"));
+    }
+    #endif
+    gc_lock();
+
+    mp_heap_image_header_t header;
+    heap_image_sum_t sum = { HEAP_IMAGE_HASH_INIT, 0, 0 };
+    heap_image_walk(heap_image_sum, &sum);
+    header.magic = HEAP_IMAGE_MAGIC;
+    header.firmware = heap_image_firmware();
+    header.checksum = sum.checksum;
+    header.num_areas = 0;
+    for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+        header.num_areas += 1;
+    }
+    header.len = sum.len;
+
+    bool ok = false;
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        ok = write(env, &header, sizeof(header)) && heap_image_walk(write, env);
+        nlr_pop();
+    } else {
+        gc_unlock();
+        nlr_jump(nlr.ret_val);
+    }
+    gc_unlock();
+    return ok;
+}
+
+bool mp_heap_image_restore(const byte *image, size_t len) {
+    const mp_heap_image_header_t *header = (const mp_heap_image_header_t *)image;
+    if (len < sizeof(mp_heap_image_header_t)
+        || header->magic != HEAP_IMAGE_MAGIC
+        || header->firmware != heap_image_firmware()
+        || header->len != len - sizeof(mp_heap_image_header_t)
+        || header->checksum != heap_image_hash(HEAP_IMAGE_HASH_INIT, header + 1, header->len)) {
+        return false;
+    }
+
+    // check that the heap areas are where they were
+    const byte *top = image + len;
+    const byte *areas = (const byte *)(header + 1) + sizeof(mp_state_vm_t) + sizeof(mp_heap_image_gc_t);
+    const byte *p = areas;
+    size_t num_areas = 0;
+    for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+        mp_state_mem_area_t saved;
+        if (p + sizeof(saved) > top) {
+            return false;
+        }
+        memcpy(&saved, p, sizeof(saved));
+        if (saved.gc_alloc_table_start != area->gc_alloc_table_start || saved.gc_pool_end != area->gc_pool_end) {
+            return false;
+        }
+        p += sizeof(saved) + (area->gc_pool_end - area->gc_alloc_table_start);
+        num_areas += 1;
+    }
+    if (num_areas != header->num_areas || p != top) {
+        return false;
+    }
+
+    // the blocks that this boot's free lists and allocation buffers refer to
+    // may be in use in the image
+    gc_drop_caches();
+
+    // restore the VM state, except for what belongs to this boot
+    #if MICROPY_PY_THREAD && !MICROPY_PY_THREAD_GIL
+    mp_thread_mutex_t qstr_mutex = MP_STATE_VM(qstr_mutex);
+    #endif
+    #if MICROPY_PY_THREAD_GIL
+    mp_thread_mutex_t gil_mutex = MP_STATE_VM(gil_mutex);
+    #endif
+    memcpy(&mp_state_ctx.vm, header + 1, sizeof(mp_state_vm_t));
+    #if MICROPY_PY_THREAD && !MICROPY_PY_THREAD_GIL
+    MP_STATE_VM(qstr_mutex) = qstr_mutex;
+    #endif
+    #if MICROPY_PY_THREAD_GIL
+    MP_STATE_VM(gil_mutex) = gil_mutex;
+    #endif
+    MP_STATE_VM(mp_pending_exception) = MP_OBJ_NULL;
+    #if MICROPY_ENABLE_SCHEDULER
+    MP_STATE_VM(sched_state) = MP_SCHED_IDLE;
+    MP_STATE_VM(sched_len) = 0;
+    MP_STATE_VM(sched_idx) = 0;
+    #if MICROPY_SCHEDULER_EVENT_DEPTH
+    MP_STATE_VM(sched_event_head) = 0;
+    MP_STATE_VM(sched_event_tail) = 0;
+    #endif
+    #endif
+    #if MICROPY_PY_SYS_EXC_INFO
+    MP_STATE_VM(cur_exception) = NULL;
+    #endif
+
+    mp_heap_image_gc_t gc;
+    memcpy(&gc, areas - sizeof(gc), sizeof(gc));
+    MP_STATE_MEM(gc_auto_collect_enabled) = gc.gc_auto_collect_enabled;
+    #if MICROPY_GC_ALLOC_THRESHOLD
+    MP_STATE_MEM(gc_alloc_amount) = gc.gc_alloc_amount;
+    MP_STATE_MEM(gc_alloc_threshold) = gc.gc_alloc_threshold;
+    #endif
+
+    p = areas;
+    for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+        mp_state_mem_area_t saved;
+        memcpy(&saved, p, sizeof(saved));
+        #if MICROPY_GC_SPLIT_HEAP
+        saved.next = area->next;
+        #endif
+        p += sizeof(saved);
+        size_t n = area->gc_pool_end - area->gc_alloc_table_start;
+        memcpy(area->gc_alloc_table_start, p, n);
+        p += n;
+        *area = saved;
+    }
+
+    mp_locals_set(&MP_STATE_VM(dict_main));
+    mp_globals_set(&MP_STATE_VM(dict_main));
+    return true;
+}
+
+#endif // MICROPY_HEAP_IMAGE
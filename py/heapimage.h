@@ -0,0 +1,49 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef MICROPY_INCLUDED_PY_HEAPIMAGE_H
+#define MICROPY_INCLUDED_PY_HEAPIMAGE_H
+
+#include "py/mpstate.h"
+
+#if MICROPY_HEAP_IMAGE
+
+// Called to write the next len bytes of an image, returns false on error.
+// It must not allocate on the heap.
+typedef bool (*mp_heap_image_write_t)(void *env, const void *buf, size_t len);
+
+// Write an image of the heap and the state of the VM.  Raises an exception if
+// it can't be done now, and returns false if write returned false.
+bool mp_heap_image_save(mp_heap_image_write_t write, void *env);
+
+// Restore an image written by mp_heap_image_save, which must be word aligned
+// and can be freed afterwards.  This must be called straight after mp_init.
+// Returns false if the image is corrupt or from different firmware, or the
+// heap isn't at the same address, in which case nothing was changed.
+bool mp_heap_image_restore(const byte *image, size_t len);
+
+#endif
+
+#endif // MICROPY_INCLUDED_PY_HEAPIMAGE_H
@@ -0,0 +1,885 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "py/jit.h"
+#include "py/bc0.h"
+#include "py/bc.h"
+#include "py/emit.h"
+#include "py/gc.h"
+#include "py/runtime.h"
+
+#if MICROPY_JIT
+
+#define DEBUG_PRINT (0)
+
+#if DEBUG_PRINT // print debugging info
+#define DEBUG_printf DEBUG_printf
+#else // don't print debugging info
+#define DEBUG_printf(...) (void)0
+#endif
+
+// The native emitter for the target, as selected by py/compile.c
+#if MICROPY_EMIT_X64
+#define NATIVE_EMITTER(f) emit_native_x64_##f
+#elif MICROPY_EMIT_X86
+#define NATIVE_EMITTER(f) emit_native_x86_##f
+#elif MICROPY_EMIT_THUMB
+#define NATIVE_EMITTER(f) emit_native_thumb_##f
+#elif MICROPY_EMIT_ARM
+#define NATIVE_EMITTER(f) emit_native_arm_##f
+#elif MICROPY_EMIT_XTENSA
+#define NATIVE_EMITTER(f) emit_native_xtensa_##f
+#elif MICROPY_EMIT_XTENSAWIN
+#define NATIVE_EMITTER(f) emit_native_xtensawin_##f
+#elif MICROPY_EMIT_RV32
+#define NATIVE_EMITTER(f) emit_native_rv32_##f
+#endif
+#define NATIVE_EMITTER_TABLE (&NATIVE_EMITTER(method_table))
+
+// The bytecode is translated by replaying it through the native emitter, as if
+// the compiler was compiling the function with @micropython.native.  Before that
+// the reachable code is walked to find the stack depth at each instruction, that
+// the compiler otherwise gives to the emitter, and to check that the translation
+// can behave exactly like the bytecode:
+//  - code with exception handlers, and generators, aren't supported
+//  - native code doesn't check that a local is bound before loading it, so each
+//    load must be of a local that's bound on all paths to it
+//  - native code implements deleting a local by setting it to None
+// Native code doesn't check for pending exceptions and thread switches, so these
+// are checked by a call to jit_loop_check before each backward jump.
+
+// Limit the size of functions translated, to bound the memory that's needed
+#define JIT_MAX_CODE_LEN (8192)
+
+// Number of labels that the native emitter uses for itself, see compile.c
+#define JIT_LABEL_BASE (6)
+
+// Flags for each offset in the bytecode
+#define JIT_FLAG_INSN (0x01) // a reachable instruction starts here
+#define JIT_FLAG_FALL_IN (0x02) // reached from the previous instruction
+#define JIT_FLAG_JUMP (0x04) // target of a jump
+#define JIT_FLAG_FOR_ITER (0x08) // target of FOR_ITER, with the iterator popped
+#define JIT_FLAG_QUEUED (0x10) // needs to be walked (again)
+
+// Value of jit_stack_effect's to_next for instructions that don't continue
+#define JIT_NO_NEXT (0x7fff)
+
+typedef struct _jit_point_t {
+    uint32_t bound; // locals that are bound on all paths to here
+    uint16_t depth; // stack depth
+    uint16_t label; // first label, for targets of jumps
+    uint8_t flags;
+} jit_point_t;
+
+typedef struct _jit_t {
+    const byte *code; // start of the bytecode
+    const mp_uint_t *const_table;
+    jit_point_t *point; // for each offset in the bytecode
+    size_t len; // offsets up to here are walked
+    size_t *todo; // offsets still to walk
+    size_t todo_len;
+    size_t todo_alloc;
+    uint32_t cells; // locals that hold a cell
+    size_t num_locals; // locals used
+    size_t num_labels; // labels for the targets of jumps
+    uint16_t scope_flags; // extra flags needed by the emitter
+} jit_t;
+
+typedef struct _jit_insn_t {
+    mp_uint_t arg; // the argument, whatever its encoding
+    size_t next; // offset of the next instruction
+    size_t target; // offset of the jump target, for jumps
+    byte op; // the opcode, with MULTI opcodes turned into their general form
+    byte extra; // the extra byte, if the opcode has one
+} jit_insn_t;
+
+STATIC mp_obj_t jit_loop_check(void) {
+    MICROPY_VM_HOOK_LOOP
+    mp_handle_pending(true);
+    #if MICROPY_PY_THREAD_GIL
+    #if MICROPY_PY_THREAD_GIL_VM_DIVISOR
+    static int gil_divisor = MICROPY_PY_THREAD_GIL_VM_DIVISOR;
+    if (--gil_divisor == 0)
+    #endif
+    {
+        #if MICROPY_PY_THREAD_GIL_VM_DIVISOR
+        gil_divisor = MICROPY_PY_THREAD_GIL_VM_DIVISOR;
+        #endif
+        #if MICROPY_ENABLE_SCHEDULER
+        // can only switch threads if the scheduler is unlocked
+        if (MP_STATE_VM(sched_state) == MP_SCHED_IDLE)
+        #endif
+        {
+            MP_THREAD_GIL_EXIT();
+            MP_THREAD_GIL_ENTER();
+        }
+    }
+    #endif
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(jit_loop_check_obj, jit_loop_check);
+
+// mp_decode_uint is only available without persistent code
+STATIC mp_uint_t jit_decode_uint(const byte **ptr) {
+    mp_uint_t unum = 0;
+    byte val;
+    const byte *p = *ptr;
+    do {
+        val = *p++;
+        unum = (unum << 7) | (val & 0x7f);
+    } while ((val & 0x80) != 0);
+    *ptr = p;
+    return unum;
+}
+
+STATIC void jit_decode(const jit_t *j, size_t offset, jit_insn_t *insn) {
+    const byte *ip = j->code + offset;
+    byte op = *ip++;
+    insn->arg = 0;
+    insn->target = 0;
+    insn->extra = 0;
+    if (op >= MP_BC_LOAD_CONST_SMALL_INT_MULTI) {
+        // opcodes with the argument in the opcode
+        if (op < MP_BC_LOAD_CONST_SMALL_INT_MULTI + MP_BC_LOAD_CONST_SMALL_INT_MULTI_NUM) {
+            insn->arg = (mp_int_t)op - MP_BC_LOAD_CONST_SMALL_INT_MULTI - MP_BC_LOAD_CONST_SMALL_INT_MULTI_EXCESS;
+            op = MP_BC_LOAD_CONST_SMALL_INT;
+        } else if (op < MP_BC_LOAD_FAST_MULTI + MP_BC_LOAD_FAST_MULTI_NUM) {
+            insn->arg = op - MP_BC_LOAD_FAST_MULTI;
+            op = MP_BC_LOAD_FAST_N;
+        } else if (op < MP_BC_STORE_FAST_MULTI + MP_BC_STORE_FAST_MULTI_NUM) {
+            insn->arg = op - MP_BC_STORE_FAST_MULTI;
+            op = MP_BC_STORE_FAST_N;
+        } else if (op < MP_BC_UNARY_OP_MULTI + MP_BC_UNARY_OP_MULTI_NUM) {
+            insn->arg = op - MP_BC_UNARY_OP_MULTI;
+            op = MP_BC_UNARY_OP_MULTI;
+        } else {
+            insn->arg = op - MP_BC_BINARY_OP_MULTI;
+            op = MP_BC_BINARY_OP_MULTI;
+        }
+    } else {
+        switch (MP_BC_FORMAT(op)) {
+            case MP_BC_FORMAT_QSTR:
+                #if MICROPY_PERSISTENT_CODE
+                insn->arg = ip[0] | ip[1] << 8;
+                ip += 2;
+                #else
+                insn->arg = jit_decode_uint(&ip);
+                #endif
+                #if MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE
+                if (op == MP_BC_LOAD_NAME || op == MP_BC_LOAD_GLOBAL
+                    || op == MP_BC_LOAD_ATTR || op == MP_BC_STORE_ATTR) {
+                    // skip the cache byte
+                    ip += 1;
+                }
+                #endif
+                break;
+            case MP_BC_FORMAT_VAR_UINT:
+                if (op == MP_BC_LOAD_CONST_SMALL_INT) {
+                    mp_int_t num = 0;
+                    if ((ip[0] & 0x40) != 0) {
+                        // number is negative
+                        num--;
+                    }
+                    do {
+                        num = (num << 7) | (*ip & 0x7f);
+                    } while ((*ip++ & 0x80) != 0);
+                    insn->arg = num;
+                } else if (op == MP_BC_LOAD_CONST_OBJ
+                           || op == MP_BC_MAKE_FUNCTION || op == MP_BC_MAKE_FUNCTION_DEFARGS
+                           || op == MP_BC_MAKE_CLOSURE || op == MP_BC_MAKE_CLOSURE_DEFARGS) {
+                    #if MICROPY_PERSISTENT_CODE
+                    insn->arg = j->const_table[jit_decode_uint(&ip)];
+                    #else
+                    ip = (const byte *)MP_ALIGN(ip, sizeof(mp_uint_t));
+                    insn->arg = *(const mp_uint_t *)ip;
+                    ip += sizeof(mp_uint_t);
+                    #endif
+                } else {
+                    insn->arg = jit_decode_uint(&ip);
+                }
+                break;
+            case MP_BC_FORMAT_OFFSET: {
+                size_t label = ip[0] | ip[1] << 8;
+                ip += 2;
+                if (op == MP_BC_FOR_ITER) {
+                    // the only unsigned label that's supported
+                    insn->target = ip - j->code + label;
+                } else {
+                    insn->target = ip - j->code + label - 0x8000;
+                }
+                break;
+            }
+            default:
+                break;
+        }
+        if ((op & MP_BC_MASK_EXTRA_BYTE) == 0) {
+            insn->extra = *ip++;
+        }
+    }
+    insn->op = op;
+    insn->next = ip - j->code;
+}
+
+// Work out the change in stack depth from an instruction to the next one, and
+// to its jump target if it has one.  Returns false if it can't be translated.
+STATIC bool jit_stack_effect(const jit_insn_t *insn, int *to_next, int *to_target) {
+    int n = 0;
+    *to_target = 0;
+    switch (insn->op) {
+        case MP_BC_LOAD_CONST_FALSE:
+        case MP_BC_LOAD_CONST_NONE:
+        case MP_BC_LOAD_CONST_TRUE:
+        case MP_BC_LOAD_CONST_SMALL_INT:
+        case MP_BC_LOAD_CONST_STRING:
+        case MP_BC_LOAD_CONST_OBJ:
+        case MP_BC_LOAD_NULL:
+        case MP_BC_LOAD_FAST_N:
+        case MP_BC_LOAD_DEREF:
+        case MP_BC_LOAD_NAME:
+        case MP_BC_LOAD_GLOBAL:
+        case MP_BC_LOAD_METHOD:
+        case MP_BC_LOAD_BUILD_CLASS:
+        case MP_BC_DUP_TOP:
+        case MP_BC_MAKE_FUNCTION:
+        case MP_BC_IMPORT_FROM:
+        case MP_BC_BUILD_MAP:
+            n = 1;
+            break;
+        case MP_BC_LOAD_ATTR:
+        case MP_BC_DELETE_NAME:
+        case MP_BC_DELETE_GLOBAL:
+        case MP_BC_ROT_TWO:
+        case MP_BC_ROT_THREE:
+        case MP_BC_GET_ITER:
+        case MP_BC_UNARY_OP_MULTI:
+            break;
+        case MP_BC_LOAD_SUPER_METHOD:
+        case MP_BC_LOAD_SUBSCR:
+        case MP_BC_STORE_FAST_N:
+        case MP_BC_STORE_DEREF:
+        case MP_BC_STORE_NAME:
+        case MP_BC_STORE_GLOBAL:
+        case MP_BC_POP_TOP:
+        case MP_BC_MAKE_FUNCTION_DEFARGS:
+        case MP_BC_IMPORT_NAME:
+        case MP_BC_IMPORT_STAR:
+        case MP_BC_BINARY_OP_MULTI:
+            n = -1;
+            break;
+        case MP_BC_STORE_ATTR:
+        case MP_BC_STORE_MAP:
+            n = -2;
+            break;
+        case MP_BC_STORE_SUBSCR:
+            n = -3;
+            break;
+        case MP_BC_DUP_TOP_TWO:
+            n = 2;
+            break;
+        case MP_BC_JUMP:
+        case MP_BC_RETURN_VALUE:
+        case MP_BC_RAISE_OBJ:
+            n = JIT_NO_NEXT;
+            break;
+        case MP_BC_POP_JUMP_IF_TRUE:
+        case MP_BC_POP_JUMP_IF_FALSE:
+            n = -1;
+            *to_target = -1;
+            break;
+        case MP_BC_JUMP_IF_TRUE_OR_POP:
+        case MP_BC_JUMP_IF_FALSE_OR_POP:
+            n = -1;
+            break;
+        case MP_BC_GET_ITER_STACK:
+            n = MP_OBJ_ITER_BUF_NSLOTS - 1;
+            break;
+        case MP_BC_FOR_ITER:
+            n = 1;
+            *to_target = -(int)MP_OBJ_ITER_BUF_NSLOTS;
+            break;
+        case MP_BC_BUILD_TUPLE:
+        case MP_BC_BUILD_LIST:
+        case MP_BC_BUILD_SET:
+        case MP_BC_BUILD_SLICE:
+            n = 1 - (int)insn->arg;
+            break;
+        case MP_BC_STORE_COMP:
+            n = (!MICROPY_PY_BUILTINS_SET || (insn->arg & 3) == 1) ? -2 : -1;
+            break;
+        case MP_BC_UNPACK_SEQUENCE:
+            n = (int)insn->arg - 1;
+            break;
+        case MP_BC_UNPACK_EX:
+            n = (insn->arg & 0xff) + (insn->arg >> 8);
+            break;
+        case MP_BC_MAKE_CLOSURE:
+            n = 1 - insn->extra;
+            break;
+        case MP_BC_MAKE_CLOSURE_DEFARGS:
+            n = -1 - insn->extra;
+            break;
+        case MP_BC_CALL_FUNCTION:
+        case MP_BC_CALL_FUNCTION_VAR_KW:
+        case MP_BC_CALL_METHOD:
+        case MP_BC_CALL_METHOD_VAR_KW:
+            n = -(int)((insn->arg & 0xff) + 2 * (insn->arg >> 8));
+            if (insn->op == MP_BC_CALL_FUNCTION_VAR_KW || insn->op == MP_BC_CALL_METHOD_VAR_KW) {
+                n -= 2;
+            }
+            if (insn->op == MP_BC_CALL_METHOD || insn->op == MP_BC_CALL_METHOD_VAR_KW) {
+                n -= 1;
+            }
+            break;
+        default:
+            // exception handling, generators, deleting locals, and raise-from
+            // which the native emitter doesn't support
+            return false;
+    }
+    *to_next = n;
+    return true;
+}
+
+STATIC jit_point_t *jit_point(jit_t *j, size_t offset) {
+    if (offset >= j->len) {
+        size_t len = offset + 1 + 32;
+        j->point = m_renew(jit_point_t, j->point, j->len, len);
+        memset(j->point + j->len, 0, (len - j->len) * sizeof(jit_point_t));
+        j->len = len;
+    }
+    return &j->point[offset];
+}
+
+// Record that the given offset is reached with the given stack depth and bound
+// locals.  Returns false if it's reached with different stack depths.
+STATIC bool jit_reach(jit_t *j, size_t offset, int depth, uint32_t bound, uint8_t flags) {
+    if (offset >= JIT_MAX_CODE_LEN || depth < 0) {
+        return false;
+    }
+    jit_point_t *p = jit_point(j, offset);
+    if (p->flags & JIT_FLAG_INSN) {
+        if (p->depth != depth) {
+            return false;
+        }
+        if ((p->bound & bound) == p->bound) {
+            p->flags |= flags;
+            return true;
+        }
+        p->bound &= bound;
+    } else {
+        p->depth = depth;
+        p->bound = bound;
+    }
+    p->flags |= JIT_FLAG_INSN | flags;
+    if (!(p->flags & JIT_FLAG_QUEUED)) {
+        p->flags |= JIT_FLAG_QUEUED;
+        if (j->todo_len >= j->todo_alloc) {
+            j->todo = m_renew(size_t, j->todo, j->todo_alloc, j->todo_alloc * 2);
+            j->todo_alloc *= 2;
+        }
+        j->todo[j->todo_len++] = offset;
+    }
+    return true;
+}
+
+// Walk all the reachable code, starting with the given locals bound.  Returns
+// false if the function can't be translated.
+STATIC bool jit_analyse(jit_t *j, uint32_t bound) {
+    j->todo_alloc = 16;
+    j->todo = m_new(size_t, j->todo_alloc);
+    if (!jit_reach(j, 0, 0, bound, 0)) {
+        return false;
+    }
+    while (j->todo_len > 0) {
+        size_t offset = j->todo[--j->todo_len];
+        jit_point_t *p = &j->point[offset];
+        p->flags &= ~JIT_FLAG_QUEUED;
+        jit_insn_t insn;
+        jit_decode(j, offset, &insn);
+        int to_next, to_target;
+        if (!jit_stack_effect(&insn, &to_next, &to_target)) {
+            DEBUG_printf("jit: unsupported opcode 0x%02x\n", insn.op);
+            return false;
+        }
+        bound = p->bound;
+        int depth = p->depth;
+        switch (insn.op) {
+            case MP_BC_LOAD_FAST_N:
+            case MP_BC_LOAD_DEREF:
+            case MP_BC_STORE_FAST_N:
+            case MP_BC_STORE_DEREF: {
+                if (insn.arg >= 32) {
+                    return false;
+                }
+                uint32_t mask = (uint32_t)1 << insn.arg;
+                if (insn.op == MP_BC_STORE_FAST_N || insn.op == MP_BC_STORE_DEREF) {
+                    bound |= mask;
+                } else if (!(bound & mask) && !(insn.op == MP_BC_LOAD_FAST_N && (j->cells & mask))) {
+                    // the local may not be bound, so the bytecode may raise NameError
+                    DEBUG_printf("jit: local %u may be unbound\n", (uint)insn.arg);
+                    return false;
+                }
+                if (insn.arg >= j->num_locals) {
+                    j->num_locals = insn.arg + 1;
+                }
+                break;
+            }
+            case MP_BC_LOAD_NAME:
+            case MP_BC_LOAD_GLOBAL:
+            case MP_BC_STORE_NAME:
+            case MP_BC_STORE_GLOBAL:
+            case MP_BC_DELETE_NAME:
+            case MP_BC_DELETE_GLOBAL:
+            case MP_BC_LOAD_BUILD_CLASS:
+            case MP_BC_MAKE_FUNCTION:
+            case MP_BC_MAKE_FUNCTION_DEFARGS:
+            case MP_BC_MAKE_CLOSURE:
+            case MP_BC_MAKE_CLOSURE_DEFARGS:
+            case MP_BC_IMPORT_NAME:
+            case MP_BC_IMPORT_FROM:
+            case MP_BC_IMPORT_STAR:
+                j->scope_flags |= MP_SCOPE_FLAG_REFGLOBALS;
+                break;
+        }
+        if (to_target != 0 || insn.op == MP_BC_JUMP
+            || insn.op == MP_BC_JUMP_IF_TRUE_OR_POP || insn.op == MP_BC_JUMP_IF_FALSE_OR_POP) {
+            uint8_t flags = insn.op == MP_BC_FOR_ITER ? JIT_FLAG_FOR_ITER : JIT_FLAG_JUMP;
+            if (!jit_reach(j, insn.target, depth + to_target, bound, flags)) {
+                return false;
+            }
+        }
+        if (to_next != JIT_NO_NEXT) {
+            if (!jit_reach(j, insn.next, depth + to_next, bound, JIT_FLAG_FALL_IN)) {
+                return false;
+            }
+        }
+    }
+
+    // Give a label to each target of a jump, and check that the loop ends
+    // that are reached from FOR_ITER can be given the right stack depth
+    for (size_t offset = 0; offset < j->len; ++offset) {
+        jit_point_t *p = &j->point[offset];
+        if (p->flags & (JIT_FLAG_JUMP | JIT_FLAG_FOR_ITER)) {
+            if ((p->flags & (JIT_FLAG_FOR_ITER | JIT_FLAG_FALL_IN)) == (JIT_FLAG_FOR_ITER | JIT_FLAG_FALL_IN)) {
+                return false;
+            }
+            p->label = j->num_labels;
+            j->num_labels += ((p->flags & JIT_FLAG_JUMP) != 0) + ((p->flags & JIT_FLAG_FOR_ITER) != 0);
+        }
+    }
+    return true;
+}
+
+STATIC mp_uint_t jit_label(const jit_t *j, size_t offset, bool for_iter) {
+    const jit_point_t *p = &j->point[offset];
+    mp_uint_t label = JIT_LABEL_BASE + p->label;
+    if (!for_iter && (p->flags & JIT_FLAG_FOR_ITER)) {
+        // the label after the end of the FOR_ITER loop
+        ++label;
+    }
+    return label;
+}
+
+STATIC void jit_emit_insn(const jit_t *j, emit_t *emit, const jit_insn_t *insn) {
+    const emit_method_table_t *t = NATIVE_EMITTER_TABLE;
+    mp_uint_t arg = insn->arg;
+    byte op = insn->op;
+    scope_t child;
+    switch (op) {
+        case MP_BC_LOAD_CONST_FALSE:
+        case MP_BC_LOAD_CONST_NONE:
+        case MP_BC_LOAD_CONST_TRUE:
+            t->load_const_tok(emit, MP_TOKEN_KW_FALSE + (op - MP_BC_LOAD_CONST_FALSE));
+            break;
+        case MP_BC_LOAD_CONST_SMALL_INT:
+            t->load_const_small_int(emit, (mp_int_t)arg);
+            break;
+        case MP_BC_LOAD_CONST_STRING:
+            t->load_const_str(emit, arg);
+            break;
+        case MP_BC_LOAD_CONST_OBJ:
+            t->load_const_obj(emit, (mp_obj_t)arg);
+            break;
+        case MP_BC_LOAD_NULL:
+            t->load_null(emit);
+            break;
+        case MP_BC_LOAD_FAST_N:
+            t->load_id.local(emit, MP_QSTR_, arg, MP_EMIT_IDOP_LOCAL_FAST);
+            break;
+        case MP_BC_LOAD_DEREF:
+            t->load_id.local(emit, MP_QSTR_, arg, MP_EMIT_IDOP_LOCAL_DEREF);
+            break;
+        case MP_BC_LOAD_NAME:
+        case MP_BC_LOAD_GLOBAL:
+            t->load_id.global(emit, arg, op - MP_BC_LOAD_NAME);
+            break;
+        case MP_BC_LOAD_ATTR:
+            t->attr(emit, arg, MP_EMIT_ATTR_LOAD);
+            break;
+        case MP_BC_LOAD_METHOD:
+        case MP_BC_LOAD_SUPER_METHOD:
+            t->load_method(emit, arg, op == MP_BC_LOAD_SUPER_METHOD);
+            break;
+        case MP_BC_LOAD_BUILD_CLASS:
+            t->load_build_class(emit);
+            break;
+        case MP_BC_LOAD_SUBSCR:
+            t->subscr(emit, MP_EMIT_SUBSCR_LOAD);
+            break;
+        case MP_BC_STORE_FAST_N:
+            t->store_id.local(emit, MP_QSTR_, arg, MP_EMIT_IDOP_LOCAL_FAST);
+            break;
+        case MP_BC_STORE_DEREF:
+            t->store_id.local(emit, MP_QSTR_, arg, MP_EMIT_IDOP_LOCAL_DEREF);
+            break;
+        case MP_BC_STORE_NAME:
+        case MP_BC_STORE_GLOBAL:
+            t->store_id.global(emit, arg, op - MP_BC_STORE_NAME);
+            break;
+        case MP_BC_STORE_ATTR:
+            // also deletes the attribute if the value is NULL
+            t->attr(emit, arg, MP_EMIT_ATTR_STORE);
+            break;
+        case MP_BC_STORE_SUBSCR:
+            t->subscr(emit, MP_EMIT_SUBSCR_STORE);
+            break;
+        case MP_BC_DELETE_NAME:
+        case MP_BC_DELETE_GLOBAL:
+            t->delete_id.global(emit, arg, op - MP_BC_DELETE_NAME);
+            break;
+        case MP_BC_DUP_TOP:
+            t->dup_top(emit);
+            break;
+        case MP_BC_DUP_TOP_TWO:
+            t->dup_top_two(emit);
+            break;
+        case MP_BC_POP_TOP:
+            t->pop_top(emit);
+            break;
+        case MP_BC_ROT_TWO:
+            t->rot_two(emit);
+            break;
+        case MP_BC_ROT_THREE:
+            t->rot_three(emit);
+            break;
+        case MP_BC_JUMP:
+            t->jump(emit, jit_label(j, insn->target, false));
+            break;
+        case MP_BC_POP_JUMP_IF_TRUE:
+        case MP_BC_POP_JUMP_IF_FALSE:
+            t->pop_jump_if(emit, op == MP_BC_POP_JUMP_IF_TRUE, jit_label(j, insn->target, false));
+            break;
+        case MP_BC_JUMP_IF_TRUE_OR_POP:
+        case MP_BC_JUMP_IF_FALSE_OR_POP:
+            t->jump_if_or_pop(emit, op == MP_BC_JUMP_IF_TRUE_OR_POP, jit_label(j, insn->target, false));
+            break;
+        case MP_BC_GET_ITER:
+        case MP_BC_GET_ITER_STACK:
+            t->get_iter(emit, op == MP_BC_GET_ITER_STACK);
+            break;
+        case MP_BC_FOR_ITER:
+            t->for_iter(emit, jit_label(j, insn->target, true));
+            break;
+        case MP_BC_BUILD_TUPLE:
+        case MP_BC_BUILD_LIST:
+        case MP_BC_BUILD_MAP:
+        case MP_BC_BUILD_SET:
+        case MP_BC_BUILD_SLICE:
+            t->build(emit, arg, op - MP_BC_BUILD_TUPLE);
+            break;
+        case MP_BC_STORE_MAP:
+            t->store_map(emit);
+            break;
+        case MP_BC_STORE_COMP: {
+            // the lower 2 bits of the argument are the collection type
+            scope_kind_t kind;
+            mp_uint_t n = 0;
+            if ((arg & 3) == 0) {
+                kind = SCOPE_LIST_COMP;
+            } else if (!MICROPY_PY_BUILTINS_SET || (arg & 3) == 1) {
+                kind = SCOPE_DICT_COMP;
+                n = 1;
+            } else {
+                kind = SCOPE_SET_COMP;
+            }
+            t->store_comp(emit, kind, (arg >> 2) - n);
+            break;
+        }
+        case MP_BC_UNPACK_SEQUENCE:
+            t->unpack_sequence(emit, arg);
+            break;
+        case MP_BC_UNPACK_EX:
+            t->unpack_ex(emit, arg & 0xff, arg >> 8);
+            break;
+        case MP_BC_MAKE_FUNCTION:
+        case MP_BC_MAKE_FUNCTION_DEFARGS:
+            // the emitter only needs the raw code of the child scope
+            child.raw_code = (mp_raw_code_t *)(uintptr_t)arg;
+            t->make_function(emit, &child, op == MP_BC_MAKE_FUNCTION_DEFARGS, 0);
+            break;
+        case MP_BC_MAKE_CLOSURE:
+        case MP_BC_MAKE_CLOSURE_DEFARGS:
+            child.raw_code = (mp_raw_code_t *)(uintptr_t)arg;
+            t->make_closure(emit, &child, insn->extra, op == MP_BC_MAKE_CLOSURE_DEFARGS, 0);
+            break;
+        case MP_BC_CALL_FUNCTION:
+        case MP_BC_CALL_FUNCTION_VAR_KW:
+            t->call_function(emit, arg & 0xff, arg >> 8,
+                op == MP_BC_CALL_FUNCTION ? 0 : MP_EMIT_STAR_FLAG_SINGLE | MP_EMIT_STAR_FLAG_DOUBLE);
+            break;
+        case MP_BC_CALL_METHOD:
+        case MP_BC_CALL_METHOD_VAR_KW:
+            t->call_method(emit, arg & 0xff, arg >> 8,
+                op == MP_BC_CALL_METHOD ? 0 : MP_EMIT_STAR_FLAG_SINGLE | MP_EMIT_STAR_FLAG_DOUBLE);
+            break;
+        case MP_BC_RETURN_VALUE:
+            t->return_value(emit);
+            break;
+        case MP_BC_RAISE_OBJ:
+            t->raise_varargs(emit, 1);
+            break;
+        case MP_BC_IMPORT_NAME:
+        case MP_BC_IMPORT_FROM:
+            t->import(emit, arg, op - MP_BC_IMPORT_NAME);
+            break;
+        case MP_BC_IMPORT_STAR:
+            t->import(emit, MP_QSTR_, MP_EMIT_IMPORT_STAR);
+            break;
+        case MP_BC_UNARY_OP_MULTI:
+            t->unary_op(emit, arg);
+            break;
+        default:
+            assert(op == MP_BC_BINARY_OP_MULTI);
+            t->binary_op(emit, arg);
+            break;
+    }
+}
+
+STATIC void jit_emit_pass(const jit_t *j, emit_t *emit, uint *label_slot, pass_kind_t pass, scope_t *scope) {
+    const emit_method_table_t *t = NATIVE_EMITTER_TABLE;
+    *label_slot = 0;
+    t->start_pass(emit, pass, scope);
+    *label_slot = JIT_LABEL_BASE;
+    int depth = 0;
+    for (size_t offset = 0; offset < j->len;) {
+        const jit_point_t *p = &j->point[offset];
+        if (!(p->flags & JIT_FLAG_INSN)) {
+            // not reachable
+            ++offset;
+            continue;
+        }
+        if (p->flags & JIT_FLAG_FOR_ITER) {
+            // FOR_ITER jumps here with the iterator still on the stack
+            t->adjust_stack_size(emit, p->depth + MP_OBJ_ITER_BUF_NSLOTS - depth);
+            t->label_assign(emit, jit_label(j, offset, true));
+            t->for_iter_end(emit);
+        } else if (!(p->flags & JIT_FLAG_FALL_IN) && p->depth != depth) {
+            t->adjust_stack_size(emit, p->depth - depth);
+        }
+        depth = p->depth;
+        if (p->flags & JIT_FLAG_JUMP) {
+            t->label_assign(emit, jit_label(j, offset, false));
+        }
+        jit_insn_t insn;
+        jit_decode(j, offset, &insn);
+        if (insn.target <= offset && insn.op != MP_BC_FOR_ITER && MP_BC_FORMAT(insn.op) == MP_BC_FORMAT_OFFSET) {
+            // check for pending exceptions before a backward jump, like the VM
+            t->load_const_obj(emit, MP_OBJ_FROM_PTR(&jit_loop_check_obj));
+            t->call_function(emit, 0, 0, 0);
+            t->pop_top(emit);
+        }
+        jit_emit_insn(j, emit, &insn);
+        int to_next, to_target;
+        jit_stack_effect(&insn, &to_next, &to_target);
+        if (to_next != JIT_NO_NEXT) {
+            depth += to_next;
+        } else if (insn.op != MP_BC_JUMP) {
+            // the returned or raised object was popped
+            depth -= 1;
+        }
+        offset = insn.next;
+    }
+    if (depth != 0) {
+        t->adjust_stack_size(emit, -depth);
+    }
+    t->end_pass(emit);
+}
+
+STATIC mp_obj_fun_bc_t *jit_translate(mp_obj_fun_bc_t *fun) {
+    // decode the prelude
+    const byte *ip = fun->bytecode;
+    MP_BC_PRELUDE_SIG_DECODE(ip);
+    (void)n_state;
+    if (n_exc_stack != 0 || (scope_flags & MP_SCOPE_FLAG_GENERATOR)) {
+        return NULL;
+    }
+    MP_BC_PRELUDE_SIZE_DECODE(ip);
+    const byte *code_info = ip;
+    #if MICROPY_PERSISTENT_CODE
+    qstr simple_name = code_info[0] | (code_info[1] << 8);
+    qstr source_file = code_info[2] | (code_info[3] << 8);
+    #else
+    qstr simple_name = jit_decode_uint(&code_info);
+    qstr source_file = jit_decode_uint(&code_info);
+    #endif
+    ip += n_info;
+    const byte *cell_info = ip;
+    ip += n_cell;
+    #if !MICROPY_PERSISTENT_CODE
+    ip = MP_ALIGN(ip, sizeof(mp_uint_t));
+    #endif
+
+    jit_t j = {
+        .code = ip,
+        .const_table = fun->const_table,
+    };
+    size_t n_args = n_pos_args + n_kwonly_args
+        + ((scope_flags & MP_SCOPE_FLAG_VARARGS) != 0)
+        + ((scope_flags & MP_SCOPE_FLAG_VARKEYWORDS) != 0);
+    j.num_locals = n_args;
+    for (size_t i = 0; i < n_cell; ++i) {
+        if (cell_info[i] >= 32) {
+            return NULL;
+        }
+        j.cells |= (uint32_t)1 << cell_info[i];
+        if (cell_info[i] >= j.num_locals) {
+            j.num_locals = cell_info[i] + 1;
+        }
+    }
+    if (n_args >= 32 || !jit_analyse(&j, ((uint32_t)1 << n_args) - 1)) {
+        return NULL;
+    }
+
+    // make a scope for the emitter with the arguments and cells of the function
+    scope_t scope;
+    memset(&scope, 0, sizeof(scope));
+    scope.kind = SCOPE_FUNCTION;
+    scope.raw_code = mp_emit_glue_new_raw_code();
+    scope.source_file = source_file;
+    scope.simple_name = simple_name;
+    scope.scope_flags = scope_flags | j.scope_flags;
+    scope.emit_options = MP_EMIT_OPT_NATIVE_PYTHON;
+    scope.num_pos_args = n_pos_args;
+    scope.num_kwonly_args = n_kwonly_args;
+    scope.num_def_pos_args = n_def_pos_args;
+    scope.num_locals = j.num_locals;
+    scope.id_info_alloc = n_args + n_cell;
+    scope.id_info = m_new0(id_info_t, scope.id_info_alloc);
+    for (size_t i = 0; i < n_args; ++i) {
+        id_info_t *id = &scope.id_info[scope.id_info_len++];
+        id->kind = (j.cells >> i) & 1 ? ID_INFO_KIND_CELL : ID_INFO_KIND_LOCAL;
+        id->flags = ID_FLAG_IS_PARAM;
+        id->local_num = i;
+        id->qst = i < n_pos_args + n_kwonly_args ? MP_OBJ_QSTR_VALUE(fun->const_table[i]) : MP_QSTR_;
+    }
+    for (size_t i = 0; i < n_cell; ++i) {
+        if (cell_info[i] >= n_args) {
+            id_info_t *id = &scope.id_info[scope.id_info_len++];
+            id->kind = ID_INFO_KIND_CELL;
+            id->local_num = cell_info[i];
+            id->qst = MP_QSTR_;
+        }
+    }
+
+    // translate, with the same passes as the compiler
+    mp_obj_t error = MP_OBJ_NULL;
+    uint next_label = 0;
+    emit_t *emit = NATIVE_EMITTER(new)(&error, &next_label, JIT_LABEL_BASE + j.num_labels);
+    jit_emit_pass(&j, emit, &next_label, MP_PASS_STACK_SIZE, &scope);
+    if (error == MP_OBJ_NULL) {
+        jit_emit_pass(&j, emit, &next_label, MP_PASS_CODE_SIZE, &scope);
+    }
+    if (error == MP_OBJ_NULL) {
+        jit_emit_pass(&j, emit, &next_label, MP_PASS_EMIT, &scope);
+    }
+    NATIVE_EMITTER(free)(emit);
+    m_del(id_info_t, scope.id_info, scope.id_info_alloc);
+    m_del(jit_point_t, j.point, j.len);
+    m_del(size_t, j.todo, j.todo_alloc);
+    if (error != MP_OBJ_NULL) {
+        DEBUG_printf("jit: not translated\n");
+        return NULL;
+    }
+
+    // make the function for the native code, with the same defaults and globals
+    mp_obj_t def_args = MP_OBJ_NULL;
+    if (n_def_pos_args > 0) {
+        def_args = mp_obj_new_tuple(n_def_pos_args, fun->extra_args);
+    }
+    mp_obj_t def_kw_args = MP_OBJ_NULL;
+    if (scope_flags & MP_SCOPE_FLAG_DEFKWARGS) {
+        def_kw_args = fun->extra_args[n_def_pos_args];
+    }
+    mp_obj_fun_bc_t *native = MP_OBJ_TO_PTR(mp_make_function_from_raw_code(scope.raw_code, def_args, def_kw_args));
+    native->globals = fun->globals;
+    DEBUG_printf("jit: translated %s to %p\n", qstr_str(simple_name), native->bytecode);
+    return native;
+}
+
+bool mp_jit_promote(mp_obj_fun_bc_t *fun) {
+    #if MICROPY_PY_SYS_SETTRACE
+    if (MP_STATE_THREAD(prof_trace_callback) != MP_OBJ_NULL) {
+        // tracing needs the bytecode
+        return false;
+    }
+    #endif
+    if (fun->jit_fun == NULL) {
+        if (fun->jit_count == MP_JIT_COUNT_FAILED || gc_is_locked()) {
+            return false;
+        }
+        fun->jit_count = MP_JIT_COUNT_FAILED;
+        nlr_buf_t nlr;
+        if (nlr_push(&nlr) == 0) {
+            fun->jit_fun = jit_translate(fun);
+            MP_GC_WRITE_BARRIER(fun);
+            nlr_pop();
+        }
+        if (fun->jit_fun == NULL) {
+            return false;
+        }
+        fun->jit_count = MICROPY_JIT_THRESHOLD;
+    }
+    return true;
+}
+
+mp_obj_t mp_jit_call(mp_obj_fun_bc_t *fun, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_obj_fun_bc_t *native = fun->jit_fun;
+    mp_call_fun_t f = MICROPY_MAKE_POINTER_CALLABLE((void *)native->bytecode);
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        mp_obj_t ret = f(MP_OBJ_FROM_PTR(native), n_args, n_kw, args);
+        nlr_pop();
+        return ret;
+    }
+    // Native code doesn't add to the traceback, so go back to running the
+    // bytecode for later calls
+    fun->jit_fun = NULL;
+    fun->jit_count = MP_JIT_COUNT_FAILED;
+    nlr_jump(nlr.ret_val);
+}
+
+#endif // MICROPY_JIT
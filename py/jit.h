@@ -0,0 +1,55 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef MICROPY_INCLUDED_PY_JIT_H
+#define MICROPY_INCLUDED_PY_JIT_H
+
+#include "py/objfun.h"
+
+#if MICROPY_JIT
+
+// A bytecode function counts its calls and backward jumps in jit_count.  Once
+// that reaches MICROPY_JIT_THRESHOLD the function is translated to native code
+// and later calls run the translation, or if it can't be translated jit_count
+// is set to this value so that it isn't tried again.
+#define MP_JIT_COUNT_FAILED ((mp_uint_t)-1)
+
+static inline void mp_jit_count(mp_obj_fun_bc_t *fun) {
+    if (fun->jit_count < MICROPY_JIT_THRESHOLD) {
+        ++fun->jit_count;
+    }
+}
+
+// Translate the function if that wasn't done yet, and return true if it can
+// be called with mp_jit_call.
+bool mp_jit_promote(mp_obj_fun_bc_t *fun);
+
+// Call the native code translation of the function.  If an exception comes
+// out of it then the function goes back to running as bytecode.
+mp_obj_t mp_jit_call(mp_obj_fun_bc_t *fun, size_t n_args, size_t n_kw, const mp_obj_t *args);
+
+#endif
+
+#endif // MICROPY_INCLUDED_PY_JIT_H
@@ -119,6 +119,30 @@ STATIC bool is_tail_of_identifier(mp_lexer_t *lex) {
     return is_head_of_identifier(lex) || is_digit(lex);
 }
 
+// as is_tail_of_identifier, inline for the loop in next_run
+static inline bool is_tail_of_identifier_char(unichar c) {
+    return (unichar)((c | 0x20) - 'a') < 26 || (unichar)(c - '0') < 10 || c == '_'
+           || (c >= 0x80 && c != MP_LEXER_EOF);
+}
+
+// Readers that have a readblock function are read a block at a time, which
+// saves a call through the reader for each byte.
+STATIC unichar read_byte(mp_lexer_t *lex) {
+    if (lex->buf_cur < lex->buf_end) {
+        return *lex->buf_cur++;
+    }
+    if (lex->reader.readblock == NULL) {
+        return lex->reader.readbyte(lex->reader.data);
+    }
+    size_t len = lex->reader.readblock(lex->reader.data, &lex->buf_cur);
+    if (len == 0) {
+        lex->buf_end = lex->buf_cur;
+        return MP_LEXER_EOF;
+    }
+    lex->buf_end = lex->buf_cur + len;
+    return *lex->buf_cur++;
+}
+
 STATIC void next_char(mp_lexer_t *lex) {
     if (lex->chr0 == '\n') {
         // a new line
@@ -134,14 +158,14 @@ STATIC void next_char(mp_lexer_t *lex) {
 
     lex->chr0 = lex->chr1;
     lex->chr1 = lex->chr2;
-    lex->chr2 = lex->reader.readbyte(lex->reader.data);
+    lex->chr2 = read_byte(lex);
 
     if (lex->chr1 == '\r') {
         // CR is a new line, converted to LF
         lex->chr1 = '\n';
         if (lex->chr2 == '\n') {
             // CR LF is a single new line, throw out the extra LF
-            lex->chr2 = lex->reader.readbyte(lex->reader.data);
+            lex->chr2 = read_byte(lex);
         }
     }
 
@@ -151,6 +175,47 @@ STATIC void next_char(mp_lexer_t *lex) {
     }
 }
 
+// Move over a run of spaces, or of identifier characters which are added to
+// the token text, taking them straight from the block being read rather than
+// one at a time with next_char.  The run must cover the cached characters,
+// so only does something in the middle of a long run; the caller finishes
+// the run with next_char.
+STATIC void next_run(mp_lexer_t *lex, bool ident) {
+    const byte *p = lex->buf_cur;
+    if (ident) {
+        if (!is_tail_of_identifier_char(lex->chr1) || !is_tail_of_identifier_char(lex->chr2)) {
+            return;
+        }
+        while (p < lex->buf_end && is_tail_of_identifier_char(*p)) {
+            ++p;
+        }
+    } else {
+        if (lex->chr1 != ' ' || lex->chr2 != ' ') {
+            return;
+        }
+        while (p < lex->buf_end && *p == ' ') {
+            ++p;
+        }
+    }
+    size_t n = p - lex->buf_cur;
+    if (n < 3) {
+        return;
+    }
+    // chr0, chr1, chr2 and the run are consumed up to the last 3 characters
+    // of the run, which become the new cached characters
+    if (ident) {
+        vstr_add_byte(&lex->vstr, lex->chr0);
+        vstr_add_byte(&lex->vstr, lex->chr1);
+        vstr_add_byte(&lex->vstr, lex->chr2);
+        vstr_add_strn(&lex->vstr, (const char *)lex->buf_cur, n - 3);
+    }
+    lex->chr0 = p[-3];
+    lex->chr1 = p[-2];
+    lex->chr2 = p[-1];
+    lex->column += n;
+    lex->buf_cur = p;
+}
+
 STATIC void indent_push(mp_lexer_t *lex, size_t indent) {
     if (lex->num_indent_level >= lex->alloc_indent_level) {
         lex->indent_level = m_renew(uint16_t, lex->indent_level, lex->alloc_indent_level, lex->alloc_indent_level + MICROPY_ALLOC_LEXEL_INDENT_INC);
@@ -432,6 +497,9 @@ STATIC bool skip_whitespace(mp_lexer_t *lex, bool stop_at_newline) {
             had_physical_newline = true;
             next_char(lex);
         } else if (is_whitespace(lex)) {
+            if (is_char(lex, ' ')) {
+                next_run(lex, false);
+            }
             next_char(lex);
         } else if (is_char(lex, '#')) {
             next_char(lex);
@@ -559,6 +627,7 @@ void mp_lexer_to_next(mp_lexer_t *lex) {
 
         // get tail chars
         while (!is_end(lex) && is_tail_of_identifier(lex)) {
+            next_run(lex, true);
             vstr_add_byte(&lex->vstr, CUR_CHAR(lex));
             next_char(lex);
         }
@@ -567,8 +636,12 @@ void mp_lexer_to_next(mp_lexer_t *lex) {
         // We also check for __debug__ here and convert it to its value.  This is
         // so the parser gives a syntax error on, eg, x.__debug__.  Otherwise, we
         // need to check for this special token in many places in the compiler.
+        // The table is sorted, so it's binary searched.
         const char *s = vstr_null_terminated_str(&lex->vstr);
-        for (size_t i = 0; i < MP_ARRAY_SIZE(tok_kw); i++) {
+        size_t lo = 0;
+        size_t hi = MP_ARRAY_SIZE(tok_kw);
+        while (lo < hi) {
+            size_t i = (lo + hi) / 2;
             int cmp = strcmp(s, tok_kw[i]);
             if (cmp == 0) {
                 lex->tok_kind = MP_TOKEN_KW_FALSE + i;
@@ -577,8 +650,9 @@ void mp_lexer_to_next(mp_lexer_t *lex) {
                 }
                 break;
             } else if (cmp < 0) {
-                // Table is sorted and comparison was less-than, so stop searching
-                break;
+                hi = i;
+            } else {
+                lo = i + 1;
             }
         }
 
@@ -695,6 +769,8 @@ mp_lexer_t *mp_lexer_new(qstr src_name, mp_reader_t reader) {
 
     lex->source_name = src_name;
     lex->reader = reader;
+    lex->buf_cur = NULL;
+    lex->buf_end = NULL;
     lex->line = 1;
     lex->column = (size_t)-2; // account for 3 dummy bytes
     lex->emit_dent = 0;
@@ -156,6 +156,8 @@ typedef enum _mp_token_kind_t {
 typedef struct _mp_lexer_t {
     qstr source_name;           // name of source
     mp_reader_t reader;         // stream source
+    const byte *buf_cur;        // rest of the block from reader.readblock, if any
+    const byte *buf_end;
 
     unichar chr0, chr1, chr2;   // current cached characters from source
 
@@ -31,7 +31,9 @@
 
 #include "py/mpconfig.h"
 #include "py/misc.h"
+#include "py/objstr.h"
 #include "py/runtime.h"
+#include "py/gc.h"
 
 #if MICROPY_DEBUG_VERBOSE // print debugging info
 #define DEBUG_PRINT (1)
@@ -65,18 +67,143 @@ STATIC size_t get_hash_alloc_greater_or_equal_to(size_t x) {
 /******************************************************************************/
 /* map                                                                        */
 
+#if MICROPY_OPT_MAP_COMPACT
+
+// A hash map (one that isn't an ordered array) keeps its entries packed at
+// the start of the table in the order they were added, which is also the
+// order they are iterated in.  A deleted entry stays in place with its key
+// set to MP_OBJ_SENTINEL until the table is rehashed.
+//
+// A table of up to MAP_SMALL_ALLOC entries has nothing else and is searched
+// linearly, so it takes the same memory as before.  In a bigger table the
+// alloc entries are followed by the number of entries added so far, counting
+// the deleted ones, and then the index: a power-of-two sized array in which
+// the hash of a key selects a slot and linear probing is used.  Each index
+// slot is empty or holds the position of an entry.  The index has at least
+// 1.5 slots per entry, so probing always reaches an empty slot, and its slots
+// are 1, 2 or 4 bytes wide depending on alloc.
+
+#define MAP_SMALL_ALLOC (8)
+#define MAP_INDEX_EMPTY ((size_t)-1)
+
+// Round alloc * 1.5 up to a power of two.
+static inline size_t map_index_len(size_t alloc) {
+    size_t n = alloc + alloc / 2 - 1;
+    n |= n >> 1;
+    n |= n >> 2;
+    n |= n >> 4;
+    n |= n >> 8;
+    n |= n >> 16;
+    #if SIZE_MAX > 0xffffffff
+    n |= n >> 32;
+    #endif
+    return n + 1;
+}
+
+static inline size_t map_index_width(size_t alloc) {
+    return alloc < 0xff ? 1 : alloc < 0xffff ? 2 : 4;
+}
+
+STATIC size_t map_table_size(size_t alloc) {
+    size_t size = alloc * sizeof(mp_map_elem_t);
+    if (alloc > MAP_SMALL_ALLOC) {
+        size += sizeof(size_t) + map_index_len(alloc) * map_index_width(alloc);
+    }
+    return size;
+}
+
+static inline size_t *map_num_entries(const mp_map_t *map) {
+    return (size_t *)&map->table[map->alloc];
+}
+
+static inline void *map_index(const mp_map_t *map) {
+    return map_num_entries(map) + 1;
+}
+
+STATIC size_t map_index_get(const void *index, size_t width, size_t pos) {
+    size_t value;
+    if (width == 1) {
+        value = ((const uint8_t *)index)[pos];
+        return value == 0xff ? MAP_INDEX_EMPTY : value;
+    } else if (width == 2) {
+        value = ((const uint16_t *)index)[pos];
+        return value == 0xffff ? MAP_INDEX_EMPTY : value;
+    } else {
+        value = ((const uint32_t *)index)[pos];
+        return value == 0xffffffff ? MAP_INDEX_EMPTY : value;
+    }
+}
+
+STATIC void map_index_set(void *index, size_t width, size_t pos, size_t value) {
+    if (width == 1) {
+        ((uint8_t *)index)[pos] = value;
+    } else if (width == 2) {
+        ((uint16_t *)index)[pos] = value;
+    } else {
+        ((uint32_t *)index)[pos] = value;
+    }
+}
+
+STATIC mp_map_elem_t *map_table_init(mp_map_elem_t *table, size_t alloc) {
+    memset(table, 0, alloc * sizeof(mp_map_elem_t));
+    if (alloc > MAP_SMALL_ALLOC) {
+        *(size_t *)&table[alloc] = 0;
+        // all bits set marks an empty index slot, for any slot width
+        memset((size_t *)&table[alloc] + 1, 0xff, map_index_len(alloc) * map_index_width(alloc));
+    }
+    return table;
+}
+
+STATIC mp_map_elem_t *map_table_new(size_t alloc) {
+    return map_table_init((mp_map_elem_t *)m_new(byte, map_table_size(alloc)), alloc);
+}
+
+STATIC void map_table_free(mp_map_elem_t *table, size_t alloc) {
+    #if MICROPY_PY_THREAD_OBJ_LOCK
+    // other threads may still be reading the table, leave it to the GC
+    (void)table;
+    (void)alloc;
+    #else
+    m_del(byte, table, map_table_size(alloc));
+    #endif
+}
+
+#else
+
+STATIC size_t map_table_size(size_t alloc) {
+    return alloc * sizeof(mp_map_elem_t);
+}
+
+STATIC mp_map_elem_t *map_table_new(size_t alloc) {
+    return m_new0(mp_map_elem_t, alloc);
+}
+
+STATIC void map_table_free(mp_map_elem_t *table, size_t alloc) {
+    #if MICROPY_PY_THREAD_OBJ_LOCK
+    // other threads may still be reading the table, leave it to the GC
+    (void)table;
+    (void)alloc;
+    #else
+    m_del(mp_map_elem_t, table, alloc);
+    #endif
+}
+
+#endif
+
 void mp_map_init(mp_map_t *map, size_t n) {
     if (n == 0) {
         map->alloc = 0;
         map->table = NULL;
     } else {
         map->alloc = n;
-        map->table = m_new0(mp_map_elem_t, map->alloc);
+        map->table = map_table_new(map->alloc);
+        MP_GC_WRITE_BARRIER(map);
     }
     map->used = 0;
     map->all_keys_are_qstrs = 1;
     map->is_fixed = 0;
     map->is_ordered = 0;
+    map->copy_on_write = 0;
 }
 
 void mp_map_init_fixed_table(mp_map_t *map, size_t n, const mp_obj_t *table) {
@@ -85,45 +212,321 @@ void mp_map_init_fixed_table(mp_map_t *map, size_t n, const mp_obj_t *table) {
     map->all_keys_are_qstrs = 1;
     map->is_fixed = 1;
     map->is_ordered = 1;
+    map->copy_on_write = 0;
     map->table = (mp_map_elem_t *)table;
 }
 
+// Initialise dest as a copy of src, which may be a fixed table.
+void mp_map_copy(mp_map_t *dest, const mp_map_t *src) {
+    #if MICROPY_OPT_MAP_COMPACT
+    if (src->is_ordered) {
+        // an ordered array is copied into a hash map
+        mp_map_init(dest, src->used);
+        for (size_t i = 0; i < src->used; i++) {
+            mp_map_lookup(dest, src->table[i].key, MP_MAP_LOOKUP_ADD_IF_NOT_FOUND)->value = src->table[i].value;
+        }
+        return;
+    }
+    #endif
+    mp_map_init(dest, src->alloc);
+    dest->used = src->used;
+    dest->all_keys_are_qstrs = src->all_keys_are_qstrs;
+    dest->is_ordered = src->is_ordered;
+    if (src->alloc != 0) {
+        memcpy(dest->table, src->table, map_table_size(src->alloc));
+    }
+}
+
+#if MICROPY_MODULE_FROZEN_ROM_GLOBALS
+// Replace the fixed table of a copy-on-write map, which is an ordered array in
+// ROM, by a hash map on the heap with the same items, so it can be modified.
+void mp_map_make_writable(mp_map_t *map) {
+    MP_THREAD_OBJ_LOCK(map);
+    if (map->copy_on_write) {
+        mp_map_t copy;
+        bool arena_suspended = MP_GC_ARENA_SUSPEND(map);
+        mp_map_init(&copy, map->used);
+        MP_GC_ARENA_RESUME(arena_suspended);
+        for (size_t i = 0; i < map->used; i++) {
+            mp_map_lookup(&copy, map->table[i].key, MP_MAP_LOOKUP_ADD_IF_NOT_FOUND)->value = map->table[i].value;
+        }
+        *map = copy;
+        MP_GC_WRITE_BARRIER(map);
+    }
+    MP_THREAD_OBJ_UNLOCK(map);
+}
+#endif
+
 // Differentiate from mp_map_clear() - semantics is different
 void mp_map_deinit(mp_map_t *map) {
     if (!map->is_fixed) {
-        m_del(mp_map_elem_t, map->table, map->alloc);
+        map_table_free(map->table, map->alloc);
     }
     map->used = map->alloc = 0;
 }
 
 void mp_map_clear(mp_map_t *map) {
+    MP_THREAD_OBJ_LOCK(map);
     if (!map->is_fixed) {
-        m_del(mp_map_elem_t, map->table, map->alloc);
+        map_table_free(map->table, map->alloc);
     }
     map->alloc = 0;
     map->used = 0;
     map->all_keys_are_qstrs = 1;
     map->is_fixed = 0;
+    map->copy_on_write = 0;
     map->table = NULL;
+    MP_THREAD_OBJ_UNLOCK(map);
+}
+
+#if !MICROPY_PY_THREAD_OBJ_LOCK
+#define map_lookup mp_map_lookup
+#endif
+
+STATIC mp_uint_t map_hash(mp_obj_t index) {
+    // fast path for common cases of qstr and small int, which hashes to itself
+    if (mp_obj_is_qstr(index)) {
+        return qstr_hash(MP_OBJ_QSTR_VALUE(index));
+    } else if (mp_obj_is_small_int(index)) {
+        return MP_OBJ_SMALL_INT_VALUE(index);
+    } else {
+        return MP_OBJ_SMALL_INT_VALUE(mp_unary_op(MP_UNARY_OP_HASH, index));
+    }
+}
+
+// Compare keys that are not the same object.  Two different small ints are
+// never equal, so they don't need the generic comparison.
+static inline bool map_keys_equal(mp_obj_t key, mp_obj_t index) {
+    return !(mp_obj_is_small_int(key) && mp_obj_is_small_int(index)) && mp_obj_equal(key, index);
+}
+
+#if MICROPY_PY_THREAD_OBJ_LOCK
+
+// Hashing or comparing a key of any other type may run Python code, which
+// must not run holding the lock of a map or set: it may take the lock of
+// another object, or wait for a thread that is waiting for this lock.
+STATIC bool map_key_is_native(mp_obj_t key) {
+    return mp_obj_is_int(key) || mp_obj_is_str_or_bytes(key) || mp_obj_is_float(key)
+           || mp_obj_is_bool(key) || key == mp_const_none;
+}
+
+// Get the hash of index for a lookup in the table of obj.  If index isn't
+// native then its hash is got with the lock of obj released and kept in
+// *index_hash, and false is returned so that the lookup starts over.  If
+// index_hash is NULL then obj isn't locked.
+STATIC bool map_hash_index(const void *obj, mp_obj_t index, mp_obj_t *index_hash, mp_uint_t *hash) {
+    if (index_hash == NULL || map_key_is_native(index)) {
+        *hash = map_hash(index);
+        return true;
+    }
+    if (*index_hash != MP_OBJ_NULL) {
+        *hash = MP_OBJ_SMALL_INT_VALUE(*index_hash);
+        return true;
+    }
+    mp_thread_obj_unlock(obj);
+    *index_hash = MP_OBJ_NEW_SMALL_INT(map_hash(index));
+    mp_thread_obj_lock(obj);
+    return false;
+}
+
+// Hash the keys copied into hashes, storing each hash as the value, with the
+// lock of obj released.
+STATIC void map_hash_copies(const void *obj, mp_map_elem_t *hashes, size_t n) {
+    mp_thread_obj_unlock(obj);
+    for (size_t i = 0; i < n; i++) {
+        hashes[i].value = MP_OBJ_NEW_SMALL_INT(map_hash(hashes[i].key));
+    }
+    mp_thread_obj_lock(obj);
+}
+
+// Compare the key of elem with index, which is not the same object.  If that
+// may run Python code then it's done with the lock of the map released, and
+// if the table or the key changed meanwhile then *changed is set and true is
+// returned, and the lookup starts over.  If index_hash is NULL then the map
+// isn't locked.
+STATIC bool map_elem_equal(mp_map_t *map, mp_map_elem_t *elem, mp_obj_t index, mp_obj_t *index_hash, bool *changed) {
+    mp_obj_t key = elem->key;
+    if (index_hash == NULL || (map_key_is_native(key) && map_key_is_native(index))) {
+        return map_keys_equal(key, index);
+    }
+    mp_map_elem_t *table = map->table;
+    mp_thread_obj_unlock(map);
+    bool equal = mp_obj_equal(key, index);
+    mp_thread_obj_lock(map);
+    *changed = map->table != table || elem->key != key;
+    return equal || *changed;
+}
+
+// Get the hashes of the keys of a map for a rehash, if one of them isn't
+// native.  The keys are then copied in table order into *hashes and hashed
+// with the lock released.  Returns false if the table changed meanwhile.
+STATIC bool map_hash_keys(mp_map_t *map, mp_map_elem_t **hashes) {
+    *hashes = NULL;
+    mp_map_elem_t *table = map->table;
+    size_t alloc = map->alloc;
+    size_t k = 0;
+    while (k < alloc && (!mp_map_slot_is_filled(map, k) || map_key_is_native(table[k].key))) {
+        k++;
+    }
+    if (k == alloc) {
+        return true;
+    }
+    size_t n = map->used;
+    mp_map_elem_t *h = m_new(mp_map_elem_t, n);
+    for (size_t i = 0, j = 0; i < alloc; i++) {
+        if (mp_map_slot_is_filled(map, i)) {
+            h[j++].key = table[i].key;
+        }
+    }
+    map_hash_copies(map, h, n);
+    if (map->table != table || map->used != n) {
+        return false;
+    }
+    for (size_t i = 0, j = 0; i < alloc; i++) {
+        if (mp_map_slot_is_filled(map, i) && table[i].key != h[j++].key) {
+            return false;
+        }
+    }
+    *hashes = h;
+    return true;
+}
+
+// map_lookup returns this when its table changed while the lock was released,
+// and the lookup has to start over.
+#define MAP_LOOKUP_CHANGED ((mp_map_elem_t *)1)
+#define MAP_ELEM_EQUAL(elem) map_elem_equal(map, elem, index, index_hash, &changed)
+#define MAP_RETURN_IF_CHANGED(changed) do { if (changed) { return MAP_LOOKUP_CHANGED; } } while (0)
+
+#else
+
+#define MAP_ELEM_EQUAL(elem) map_keys_equal((elem)->key, index)
+#define MAP_RETURN_IF_CHANGED(changed) (void)(changed)
+
+#endif
+
+// Add key, which isn't in the map, to a new table that has room for it,
+// without comparing it with the other keys.
+STATIC mp_map_elem_t *map_insert_new(mp_map_t *map, mp_obj_t key, mp_uint_t hash) {
+    mp_map_elem_t *elem;
+    #if MICROPY_OPT_MAP_COMPACT
+    if (map->alloc <= MAP_SMALL_ALLOC) {
+        elem = &map->table[map->used];
+    } else {
+        void *map_idx = map_index(map);
+        size_t width = map_index_width(map->alloc);
+        size_t mask = map_index_len(map->alloc) - 1;
+        size_t pos = hash & mask;
+        while (map_index_get(map_idx, width, pos) != MAP_INDEX_EMPTY) {
+            pos = (pos + 1) & mask;
+        }
+        size_t *num_entries = map_num_entries(map);
+        map_index_set(map_idx, width, pos, *num_entries);
+        elem = &map->table[(*num_entries)++];
+    }
+    #else
+    size_t pos = hash % map->alloc;
+    while (map->table[pos].key != MP_OBJ_NULL) {
+        pos = (pos + 1) % map->alloc;
+    }
+    elem = &map->table[pos];
+    #endif
+    map->used++;
+    elem->key = key;
+    if (!mp_obj_is_qstr(key)) {
+        map->all_keys_are_qstrs = 0;
+    }
+    return elem;
+}
+
+#if MICROPY_OPT_MAP_COMPACT
+// Drop the deleted entries by moving the others down, then rebuild the index.
+// This makes room for more entries without allocating memory.  hashes, if not
+// NULL, has the hashes of the entries in order.
+STATIC void map_pack(mp_map_t *map, const mp_map_elem_t *hashes) {
+    size_t n = 0;
+    for (size_t i = 0; i < map->alloc; i++) {
+        if (mp_map_slot_is_filled(map, i)) {
+            map->table[n++] = map->table[i];
+        }
+    }
+    memset(&map->table[n], 0, (map->alloc - n) * sizeof(mp_map_elem_t));
+    if (map->alloc <= MAP_SMALL_ALLOC) {
+        return;
+    }
+    *map_num_entries(map) = n;
+    void *map_idx = map_index(map);
+    size_t width = map_index_width(map->alloc);
+    size_t mask = map_index_len(map->alloc) - 1;
+    memset(map_idx, 0xff, (mask + 1) * width);
+    for (size_t i = 0; i < n; i++) {
+        mp_uint_t hash = hashes != NULL ? (mp_uint_t)MP_OBJ_SMALL_INT_VALUE(hashes[i].value) : map_hash(map->table[i].key);
+        size_t pos = hash & mask;
+        while (map_index_get(map_idx, width, pos) != MAP_INDEX_EMPTY) {
+            pos = (pos + 1) & mask;
+        }
+        map_index_set(map_idx, width, pos, i);
+    }
 }
+#endif
 
-STATIC void mp_map_rehash(mp_map_t *map) {
+// Make room for more entries in a map.  With object locks this returns false,
+// having changed nothing, if the table changed while the keys were hashed.
+STATIC bool mp_map_rehash(mp_map_t *map) {
+    mp_map_elem_t *hashes = NULL;
+    #if MICROPY_PY_THREAD_OBJ_LOCK
+    if (!map_hash_keys(map, &hashes)) {
+        return false;
+    }
+    #endif
     size_t old_alloc = map->alloc;
+    #if MICROPY_OPT_MAP_COMPACT
+    // The table is rehashed when it runs out of entries.  If at least 1/8 of
+    // them are deleted then it's enough to pack the table.  Packing moves
+    // entries that other threads may hold pointers to, so with object locks
+    // a new table is always made.
+    if (!MICROPY_PY_THREAD_OBJ_LOCK && map->used < old_alloc - old_alloc / 8) {
+        map_pack(map, hashes);
+        return true;
+    }
+    // Otherwise grow the table, leaving room to add some more entries before
+    // the next rehash.
+    size_t new_alloc = get_hash_alloc_greater_or_equal_to(map->used + map->used / 4 + 1);
+    bool arena_suspended = MP_GC_ARENA_SUSPEND(map);
+    mp_map_elem_t *new_table = (mp_map_elem_t *)m_new_maybe(byte, map_table_size(new_alloc));
+    MP_GC_ARENA_RESUME(arena_suspended);
+    if (new_table == NULL) {
+        if (map->used < old_alloc) {
+            // pack the table instead, to not fail when the heap is locked
+            map_pack(map, hashes);
+            return true;
+        }
+        m_malloc_fail(map_table_size(new_alloc));
+    }
+    map_table_init(new_table, new_alloc);
+    #else
     size_t new_alloc = get_hash_alloc_greater_or_equal_to(map->alloc + 1);
+    bool arena_suspended = MP_GC_ARENA_SUSPEND(map);
+    mp_map_elem_t *new_table = map_table_new(new_alloc);
+    MP_GC_ARENA_RESUME(arena_suspended);
+    #endif
     DEBUG_printf("mp_map_rehash(%p): " UINT_FMT " -> " UINT_FMT "\n", map, old_alloc, new_alloc);
     mp_map_elem_t *old_table = map->table;
-    mp_map_elem_t *new_table = m_new0(mp_map_elem_t, new_alloc);
     // If we reach this point, table resizing succeeded, now we can edit the old map.
     map->alloc = new_alloc;
     map->used = 0;
     map->all_keys_are_qstrs = 1;
     map->table = new_table;
-    for (size_t i = 0; i < old_alloc; i++) {
-        if (old_table[i].key != MP_OBJ_NULL && old_table[i].key != MP_OBJ_SENTINEL) {
-            mp_map_lookup(map, old_table[i].key, MP_MAP_LOOKUP_ADD_IF_NOT_FOUND)->value = old_table[i].value;
+    MP_GC_WRITE_BARRIER(map);
+    // the keys are all different, so they don't need to be compared
+    for (size_t i = 0, j = 0; i < old_alloc; i++) {
+        mp_obj_t key = old_table[i].key;
+        if (key != MP_OBJ_NULL && key != MP_OBJ_SENTINEL) {
+            mp_uint_t hash = hashes != NULL ? (mp_uint_t)MP_OBJ_SMALL_INT_VALUE(hashes[j++].value) : map_hash(key);
+            map_insert_new(map, key, hash)->value = old_table[i].value;
         }
     }
-    m_del(mp_map_elem_t, old_table, old_alloc);
+    map_table_free(old_table, old_alloc);
+    return true;
 }
 
 // MP_MAP_LOOKUP behaviour:
@@ -132,9 +535,21 @@ STATIC void mp_map_rehash(mp_map_t *map) {
 //  - returns slot, with key non-null and value=MP_OBJ_NULL if it was added
 // MP_MAP_LOOKUP_REMOVE_IF_FOUND behaviour:
 //  - returns NULL if not found, else the slot if was found in with key null and value non-null
-mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t lookup_kind) {
+#if MICROPY_PY_THREAD_OBJ_LOCK
+// With object locks the lock of the map is held, unless index_hash is NULL,
+// and MAP_LOOKUP_CHANGED may be returned.
+STATIC mp_map_elem_t *map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t lookup_kind, mp_obj_t *index_hash) {
+#else
+mp_map_elem_t *map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t lookup_kind) {
+#endif
     // If the map is a fixed array then we must only be called for a lookup
     assert(!map->is_fixed || lookup_kind == MP_MAP_LOOKUP);
+    bool changed = false;
+
+    if (lookup_kind == MP_MAP_LOOKUP_ADD_IF_NOT_FOUND) {
+        // the caller is going to store a value in the returned slot
+        MP_GC_WRITE_BARRIER(map->table);
+    }
 
     // Work out if we can compare just pointers
     bool compare_only_ptrs = map->all_keys_are_qstrs;
@@ -158,7 +573,8 @@ mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t
     // if the map is an ordered array then we must do a brute force linear search
     if (map->is_ordered) {
         for (mp_map_elem_t *elem = &map->table[0], *top = &map->table[map->used]; elem < top; elem++) {
-            if (elem->key == index || (!compare_only_ptrs && mp_obj_equal(elem->key, index))) {
+            if (elem->key == index || (!compare_only_ptrs && MAP_ELEM_EQUAL(elem))) {
+                MAP_RETURN_IF_CHANGED(changed);
                 #if MICROPY_PY_COLLECTIONS_ORDEREDDICT
                 if (MP_UNLIKELY(lookup_kind == MP_MAP_LOOKUP_REMOVE_IF_FOUND)) {
                     // remove the found element by moving the rest of the array down
@@ -206,14 +622,101 @@ mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t
         }
     }
 
-    // get hash of index, with fast path for common case of qstr
+    #if MICROPY_PY_THREAD_OBJ_LOCK
     mp_uint_t hash;
-    if (mp_obj_is_qstr(index)) {
-        hash = qstr_hash(MP_OBJ_QSTR_VALUE(index));
-    } else {
-        hash = MP_OBJ_SMALL_INT_VALUE(mp_unary_op(MP_UNARY_OP_HASH, index));
-    }
+    MAP_RETURN_IF_CHANGED(!map_hash_index(map, index, index_hash, &hash));
+    #else
+    mp_uint_t hash = map_hash(index);
+    #endif
 
+    #if MICROPY_OPT_MAP_COMPACT
+    for (;;) {
+        if (map->alloc <= MAP_SMALL_ALLOC) {
+            // a small table is searched linearly, up to the first unused entry
+            mp_map_elem_t *elem = &map->table[0], *top = &map->table[map->alloc];
+            for (; elem < top && elem->key != MP_OBJ_NULL; elem++) {
+                if (elem->key == index
+                    || (!compare_only_ptrs && elem->key != MP_OBJ_SENTINEL && MAP_ELEM_EQUAL(elem))) {
+                    MAP_RETURN_IF_CHANGED(changed);
+                    if (lookup_kind == MP_MAP_LOOKUP_REMOVE_IF_FOUND) {
+                        map->used--;
+                        elem->key = MP_OBJ_SENTINEL;
+                    }
+                    return elem;
+                }
+            }
+            if (lookup_kind != MP_MAP_LOOKUP_ADD_IF_NOT_FOUND) {
+                return NULL;
+            }
+            if (elem < top) {
+                map->used++;
+                elem->key = index;
+                elem->value = MP_OBJ_NULL;
+                if (!mp_obj_is_qstr(index)) {
+                    map->all_keys_are_qstrs = 0;
+                }
+                return elem;
+            }
+            MAP_RETURN_IF_CHANGED(!mp_map_rehash(map));
+            continue;
+        }
+        void *map_idx = map_index(map);
+        size_t width = map_index_width(map->alloc);
+        size_t mask = map_index_len(map->alloc) - 1;
+        size_t pos = hash & mask;
+        size_t avail_pos = MAP_INDEX_EMPTY;
+        for (;;) {
+            size_t i = map_index_get(map_idx, width, pos);
+            if (i == MAP_INDEX_EMPTY) {
+                // found empty index slot, so index is not in table
+                break;
+            }
+            mp_map_elem_t *elem = &map->table[i];
+            if (elem->key == MP_OBJ_SENTINEL) {
+                // found deleted entry, its index slot can be reused
+                if (avail_pos == MAP_INDEX_EMPTY) {
+                    avail_pos = pos;
+                }
+            } else if (elem->key == index || (!compare_only_ptrs && MAP_ELEM_EQUAL(elem))) {
+                MAP_RETURN_IF_CHANGED(changed);
+                // found index
+                if (lookup_kind == MP_MAP_LOOKUP_REMOVE_IF_FOUND) {
+                    // delete the entry, keeping elem->value so that caller can access it if needed
+                    map->used--;
+                    elem->key = MP_OBJ_SENTINEL;
+                }
+                return elem;
+            }
+            pos = (pos + 1) & mask;
+        }
+        if (lookup_kind != MP_MAP_LOOKUP_ADD_IF_NOT_FOUND) {
+            return NULL;
+        }
+        size_t *num_entries = map_num_entries(map);
+        if (*num_entries < map->alloc) {
+            // append a new entry
+            if (avail_pos == MAP_INDEX_EMPTY) {
+                avail_pos = pos;
+            }
+            #if MICROPY_PY_THREAD_OBJ_LOCK
+            // another thread may have reused the slot while the lock was released
+            size_t avail_i = map_index_get(map_idx, width, avail_pos);
+            MAP_RETURN_IF_CHANGED(avail_i != MAP_INDEX_EMPTY && map->table[avail_i].key != MP_OBJ_SENTINEL);
+            #endif
+            map_index_set(map_idx, width, avail_pos, *num_entries);
+            mp_map_elem_t *elem = &map->table[(*num_entries)++];
+            map->used++;
+            elem->key = index;
+            elem->value = MP_OBJ_NULL;
+            if (!mp_obj_is_qstr(index)) {
+                map->all_keys_are_qstrs = 0;
+            }
+            return elem;
+        }
+        // no more room for entries, rehash the table and search again
+        MAP_RETURN_IF_CHANGED(!mp_map_rehash(map));
+    }
+    #else
     size_t pos = hash % map->alloc;
     size_t start_pos = pos;
     mp_map_elem_t *avail_slot = NULL;
@@ -222,6 +725,8 @@ mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t
         if (slot->key == MP_OBJ_NULL) {
             // found NULL slot, so index is not in table
             if (lookup_kind == MP_MAP_LOOKUP_ADD_IF_NOT_FOUND) {
+                // another thread may have reused the slot while the lock was released
+                MAP_RETURN_IF_CHANGED(MICROPY_PY_THREAD_OBJ_LOCK && avail_slot != NULL && avail_slot->key != MP_OBJ_SENTINEL);
                 map->used += 1;
                 if (avail_slot == NULL) {
                     avail_slot = slot;
@@ -240,7 +745,8 @@ mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t
             if (avail_slot == NULL) {
                 avail_slot = slot;
             }
-        } else if (slot->key == index || (!compare_only_ptrs && mp_obj_equal(slot->key, index))) {
+        } else if (slot->key == index || (!compare_only_ptrs && MAP_ELEM_EQUAL(slot))) {
+            MAP_RETURN_IF_CHANGED(changed);
             // found index
             // Note: CPython does not replace the index; try x={True:'true'};x[1]='one';x
             if (lookup_kind == MP_MAP_LOOKUP_REMOVE_IF_FOUND) {
@@ -265,6 +771,7 @@ mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t
             if (lookup_kind == MP_MAP_LOOKUP_ADD_IF_NOT_FOUND) {
                 if (avail_slot != NULL) {
                     // there was an available slot, so use that
+                    MAP_RETURN_IF_CHANGED(MICROPY_PY_THREAD_OBJ_LOCK && avail_slot->key != MP_OBJ_SENTINEL);
                     map->used++;
                     avail_slot->key = index;
                     avail_slot->value = MP_OBJ_NULL;
@@ -274,7 +781,7 @@ mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t
                     return avail_slot;
                 } else {
                     // not enough room in table, rehash it
-                    mp_map_rehash(map);
+                    MAP_RETURN_IF_CHANGED(!mp_map_rehash(map));
                     // restart the search for the new element
                     start_pos = pos = hash % map->alloc;
                 }
@@ -283,8 +790,89 @@ mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t
             }
         }
     }
+    #endif
+}
+
+// Get the value of the slot that a lookup returned, or MP_OBJ_NULL if there's
+// none.  A removed slot has its value cleared so that the GC can collect it,
+// and an added slot that has no value yet is given value.
+STATIC mp_obj_t map_slot_value(mp_map_elem_t *elem, mp_map_lookup_kind_t lookup_kind, mp_obj_t value) {
+    if (elem == NULL) {
+        return MP_OBJ_NULL;
+    }
+    mp_obj_t ret = elem->value;
+    if (lookup_kind == MP_MAP_LOOKUP_REMOVE_IF_FOUND) {
+        elem->value = MP_OBJ_NULL;
+    } else if (lookup_kind == MP_MAP_LOOKUP_ADD_IF_NOT_FOUND && ret == MP_OBJ_NULL) {
+        elem->value = ret = value;
+    }
+    return ret;
+}
+
+#if MICROPY_PY_THREAD_OBJ_LOCK
+
+// Look up index in a mutable map while holding its object lock.  Under the
+// same hold of the lock, store is stored in the slot if it's not MP_OBJ_NULL,
+// and map_slot_value is applied to *value if value isn't NULL.  Hashing or
+// comparing keys and growing the table can all raise, so unless only qstrs
+// are being compared the lookup runs under an nlr handler that releases the
+// lock.  The lock is released while Python code runs, and if the table
+// changed meanwhile then the lookup starts over.
+STATIC mp_map_elem_t *map_lookup_locked(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t lookup_kind, mp_obj_t store, mp_obj_t *value) {
+    mp_obj_t index_hash = MP_OBJ_NULL;
+    size_t depth = mp_thread_obj_lock(map);
+    mp_map_elem_t *elem;
+    if (lookup_kind == MP_MAP_LOOKUP && mp_obj_is_qstr(index) && map->all_keys_are_qstrs) {
+        elem = map_lookup(map, index, lookup_kind, &index_hash);
+    } else {
+        nlr_buf_t nlr;
+        if (nlr_push(&nlr) == 0) {
+            do {
+                elem = map_lookup(map, index, lookup_kind, &index_hash);
+            } while (elem == MAP_LOOKUP_CHANGED);
+            nlr_pop();
+        } else {
+            mp_thread_obj_unlock_to(map, depth);
+            nlr_jump(nlr.ret_val);
+        }
+    }
+    if (store != MP_OBJ_NULL) {
+        elem->value = store;
+    }
+    if (value != NULL) {
+        *value = map_slot_value(elem, lookup_kind, *value);
+    }
+    mp_thread_obj_unlock_to(map, depth);
+    return elem;
 }
 
+mp_map_elem_t *MICROPY_WRAP_MP_MAP_LOOKUP(mp_map_lookup)(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t lookup_kind) {
+    if (map->is_fixed) {
+        return map_lookup(map, index, lookup_kind, NULL);
+    }
+    return map_lookup_locked(map, index, lookup_kind, MP_OBJ_NULL, NULL);
+}
+
+void mp_map_store(mp_map_t *map, mp_obj_t index, mp_obj_t value) {
+    map_lookup_locked(map, index, MP_MAP_LOOKUP_ADD_IF_NOT_FOUND, value, NULL);
+}
+
+mp_obj_t mp_map_lookup_value(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t lookup_kind, mp_obj_t value) {
+    if (map->is_fixed) {
+        return map_slot_value(map_lookup(map, index, lookup_kind, NULL), lookup_kind, value);
+    }
+    map_lookup_locked(map, index, lookup_kind, MP_OBJ_NULL, &value);
+    return value;
+}
+
+#else
+
+mp_obj_t mp_map_lookup_value(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t lookup_kind, mp_obj_t value) {
+    return map_slot_value(mp_map_lookup(map, index, lookup_kind), lookup_kind, value);
+}
+
+#endif // MICROPY_PY_THREAD_OBJ_LOCK
+
 /******************************************************************************/
 /* set                                                                        */
 
@@ -294,25 +882,123 @@ void mp_set_init(mp_set_t *set, size_t n) {
     set->alloc = n;
     set->used = 0;
     set->table = m_new0(mp_obj_t, set->alloc);
+    MP_GC_WRITE_BARRIER(set);
+}
+
+#if MICROPY_PY_THREAD_OBJ_LOCK
+
+// Compare the element at pos in the table of a set with index, as
+// map_elem_equal does for a map.
+STATIC bool set_elem_equal(mp_set_t *set, size_t pos, mp_obj_t index, bool *changed) {
+    mp_obj_t elem = set->table[pos];
+    if (map_key_is_native(elem) && map_key_is_native(index)) {
+        return map_keys_equal(elem, index);
+    }
+    mp_obj_t *table = set->table;
+    mp_thread_obj_unlock(set);
+    bool equal = mp_obj_equal(elem, index);
+    mp_thread_obj_lock(set);
+    *changed = set->table != table || table[pos] != elem;
+    return equal || *changed;
 }
 
-STATIC void mp_set_rehash(mp_set_t *set) {
+// Get the hashes of the elements of a set for a rehash, as map_hash_keys
+// does for a map.
+STATIC bool set_hash_keys(mp_set_t *set, mp_map_elem_t **hashes) {
+    *hashes = NULL;
+    mp_obj_t *table = set->table;
+    size_t alloc = set->alloc;
+    size_t k = 0;
+    while (k < alloc && (!mp_set_slot_is_filled(set, k) || map_key_is_native(table[k]))) {
+        k++;
+    }
+    if (k == alloc) {
+        return true;
+    }
+    size_t n = set->used;
+    mp_map_elem_t *h = m_new(mp_map_elem_t, n);
+    for (size_t i = 0, j = 0; i < alloc; i++) {
+        if (mp_set_slot_is_filled(set, i)) {
+            h[j++].key = table[i];
+        }
+    }
+    map_hash_copies(set, h, n);
+    if (set->table != table || set->used != n) {
+        return false;
+    }
+    for (size_t i = 0, j = 0; i < alloc; i++) {
+        if (mp_set_slot_is_filled(set, i) && table[i] != h[j++].key) {
+            return false;
+        }
+    }
+    *hashes = h;
+    return true;
+}
+
+// set_lookup returns this when its table changed while the lock was released.
+#define SET_LOOKUP_CHANGED MP_OBJ_SENTINEL
+#define SET_ELEM_EQUAL(pos) set_elem_equal(set, pos, index, &changed)
+#define SET_RETURN_IF_CHANGED(changed) do { if (changed) { return SET_LOOKUP_CHANGED; } } while (0)
+
+#else
+
+#define set_lookup mp_set_lookup
+#define SET_ELEM_EQUAL(pos) map_keys_equal(set->table[pos], index)
+#define SET_RETURN_IF_CHANGED(changed) (void)(changed)
+
+#endif
+
+// Make room for more elements in a set.  With object locks this returns
+// false, having changed nothing, if the table changed while the elements were
+// hashed.
+STATIC bool mp_set_rehash(mp_set_t *set) {
+    mp_map_elem_t *hashes = NULL;
+    #if MICROPY_PY_THREAD_OBJ_LOCK
+    if (!set_hash_keys(set, &hashes)) {
+        return false;
+    }
+    #endif
     size_t old_alloc = set->alloc;
     mp_obj_t *old_table = set->table;
-    set->alloc = get_hash_alloc_greater_or_equal_to(set->alloc + 1);
-    set->used = 0;
-    set->table = m_new0(mp_obj_t, set->alloc);
-    for (size_t i = 0; i < old_alloc; i++) {
-        if (old_table[i] != MP_OBJ_NULL && old_table[i] != MP_OBJ_SENTINEL) {
-            mp_set_lookup(set, old_table[i], MP_MAP_LOOKUP_ADD_IF_NOT_FOUND);
+    size_t new_alloc = get_hash_alloc_greater_or_equal_to(set->alloc + 1);
+    bool arena_suspended = MP_GC_ARENA_SUSPEND(set);
+    mp_obj_t *new_table = m_new0(mp_obj_t, new_alloc);
+    MP_GC_ARENA_RESUME(arena_suspended);
+    set->alloc = new_alloc;
+    set->table = new_table;
+    MP_GC_WRITE_BARRIER(set);
+    // the elements are all different, so they don't need to be compared
+    for (size_t i = 0, j = 0; i < old_alloc; i++) {
+        mp_obj_t elem = old_table[i];
+        if (elem != MP_OBJ_NULL && elem != MP_OBJ_SENTINEL) {
+            mp_uint_t hash = hashes != NULL ? (mp_uint_t)MP_OBJ_SMALL_INT_VALUE(hashes[j++].value) : map_hash(elem);
+            size_t pos = hash % new_alloc;
+            while (new_table[pos] != MP_OBJ_NULL) {
+                pos = (pos + 1) % new_alloc;
+            }
+            new_table[pos] = elem;
         }
     }
+    #if !MICROPY_PY_THREAD_OBJ_LOCK
     m_del(mp_obj_t, old_table, old_alloc);
+    #endif
+    return true;
 }
 
-mp_obj_t mp_set_lookup(mp_set_t *set, mp_obj_t index, mp_map_lookup_kind_t lookup_kind) {
+#if MICROPY_PY_THREAD_OBJ_LOCK
+// With object locks the lock of the set is held and SET_LOOKUP_CHANGED may
+// be returned.
+STATIC mp_obj_t set_lookup(mp_set_t *set, mp_obj_t index, mp_map_lookup_kind_t lookup_kind, mp_obj_t *index_hash) {
+#else
+mp_obj_t set_lookup(mp_set_t *set, mp_obj_t index, mp_map_lookup_kind_t lookup_kind) {
+#endif
     // Note: lookup_kind can be MP_MAP_LOOKUP_ADD_IF_NOT_FOUND_OR_REMOVE_IF_FOUND which
     // is handled by using bitwise operations.
+    bool changed = false;
+
+    if (lookup_kind & MP_MAP_LOOKUP_ADD_IF_NOT_FOUND) {
+        MP_GC_WRITE_BARRIER(set->table);
+    }
 
     if (set->alloc == 0) {
         if (lookup_kind & MP_MAP_LOOKUP_ADD_IF_NOT_FOUND) {
@@ -321,7 +1007,12 @@ mp_obj_t mp_set_lookup(mp_set_t *set, mp_obj_t index, mp_map_lookup_kind_t looku
             return MP_OBJ_NULL;
         }
     }
-    mp_uint_t hash = MP_OBJ_SMALL_INT_VALUE(mp_unary_op(MP_UNARY_OP_HASH, index));
+    #if MICROPY_PY_THREAD_OBJ_LOCK
+    mp_uint_t hash;
+    SET_RETURN_IF_CHANGED(!map_hash_index(set, index, index_hash, &hash));
+    #else
+    mp_uint_t hash = map_hash(index);
+    #endif
     size_t pos = hash % set->alloc;
     size_t start_pos = pos;
     mp_obj_t *avail_slot = NULL;
@@ -330,6 +1021,8 @@ mp_obj_t mp_set_lookup(mp_set_t *set, mp_obj_t index, mp_map_lookup_kind_t looku
         if (elem == MP_OBJ_NULL) {
             // found NULL slot, so index is not in table
             if (lookup_kind & MP_MAP_LOOKUP_ADD_IF_NOT_FOUND) {
+                // another thread may have reused the slot while the lock was released
+                SET_RETURN_IF_CHANGED(MICROPY_PY_THREAD_OBJ_LOCK && avail_slot != NULL && *avail_slot != MP_OBJ_SENTINEL);
                 if (avail_slot == NULL) {
                     avail_slot = &set->table[pos];
                 }
@@ -344,7 +1037,8 @@ mp_obj_t mp_set_lookup(mp_set_t *set, mp_obj_t index, mp_map_lookup_kind_t looku
             if (avail_slot == NULL) {
                 avail_slot = &set->table[pos];
             }
-        } else if (mp_obj_equal(elem, index)) {
+        } else if (elem == index || SET_ELEM_EQUAL(pos)) {
+            SET_RETURN_IF_CHANGED(changed);
             // found index
             if (lookup_kind & MP_MAP_LOOKUP_REMOVE_IF_FOUND) {
                 // delete element
@@ -367,12 +1061,13 @@ mp_obj_t mp_set_lookup(mp_set_t *set, mp_obj_t index, mp_map_lookup_kind_t looku
             if (lookup_kind & MP_MAP_LOOKUP_ADD_IF_NOT_FOUND) {
                 if (avail_slot != NULL) {
                     // there was an available slot, so use that
+                    SET_RETURN_IF_CHANGED(MICROPY_PY_THREAD_OBJ_LOCK && *avail_slot != MP_OBJ_SENTINEL);
                     set->used++;
                     *avail_slot = index;
                     return index;
                 } else {
                     // not enough room in table, rehash it
-                    mp_set_rehash(set);
+                    SET_RETURN_IF_CHANGED(!mp_set_rehash(set));
                     // restart the search for the new element
                     start_pos = pos = hash % set->alloc;
                 }
@@ -383,10 +1078,36 @@ mp_obj_t mp_set_lookup(mp_set_t *set, mp_obj_t index, mp_map_lookup_kind_t looku
     }
 }
 
+#if MICROPY_PY_THREAD_OBJ_LOCK
+// Set elements are compared with mp_obj_equal, which can raise, so lookups
+// always run under an nlr handler that releases the object lock.  The lock is
+// released while Python code runs, and if the table changed meanwhile then
+// the lookup starts over.
+mp_obj_t mp_set_lookup(mp_set_t *set, mp_obj_t index, mp_map_lookup_kind_t lookup_kind) {
+    mp_obj_t index_hash = MP_OBJ_NULL;
+    size_t depth = mp_thread_obj_lock(set);
+    mp_obj_t elem;
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        do {
+            elem = set_lookup(set, index, lookup_kind, &index_hash);
+        } while (elem == SET_LOOKUP_CHANGED);
+        nlr_pop();
+    } else {
+        mp_thread_obj_unlock_to(set, depth);
+        nlr_jump(nlr.ret_val);
+    }
+    mp_thread_obj_unlock_to(set, depth);
+    return elem;
+}
+#endif
+
 mp_obj_t mp_set_remove_first(mp_set_t *set) {
+    mp_obj_t elem = MP_OBJ_NULL;
+    MP_THREAD_OBJ_LOCK(set);
     for (size_t pos = 0; pos < set->alloc; pos++) {
         if (mp_set_slot_is_filled(set, pos)) {
-            mp_obj_t elem = set->table[pos];
+            elem = set->table[pos];
             // delete element
             set->used--;
             if (set->table[(pos + 1) % set->alloc] == MP_OBJ_NULL) {
@@ -395,17 +1116,22 @@ mp_obj_t mp_set_remove_first(mp_set_t *set) {
             } else {
                 set->table[pos] = MP_OBJ_SENTINEL;
             }
-            return elem;
+            break;
         }
     }
-    return MP_OBJ_NULL;
+    MP_THREAD_OBJ_UNLOCK(set);
+    return elem;
 }
 
 void mp_set_clear(mp_set_t *set) {
+    MP_THREAD_OBJ_LOCK(set);
+    #if !MICROPY_PY_THREAD_OBJ_LOCK
     m_del(mp_obj_t, set->table, set->alloc);
+    #endif
     set->alloc = 0;
     set->used = 0;
     set->table = NULL;
+    MP_THREAD_OBJ_UNLOCK(set);
 }
 
 #endif // MICROPY_PY_BUILTINS_SET
@@ -26,11 +26,381 @@
 
 #include "py/builtin.h"
 
+#if MICROPY_PY_ARRAY_KERNELS
+#include "py/binary.h"
+#include "py/objarray.h"
+#include "py/runtime.h"
+#endif
+
 #if MICROPY_PY_ARRAY
 
+#if MICROPY_PY_ARRAY_KERNELS
+
+// The kernels run a loop over the raw elements for each typecode, without
+// boxing them.  Integer arithmetic is done unsigned, so it wraps like storing
+// an out of range value into an array does.
+
+#define ARRAY_KERNEL_INT_TYPES(X) \
+    X('b', int8_t, uint8_t) \
+    X('B', uint8_t, uint8_t) \
+    X('h', int16_t, uint16_t) \
+    X('H', uint16_t, uint16_t) \
+    X('i', int, unsigned int) \
+    X('I', unsigned int, unsigned int) \
+    X('l', long, unsigned long) \
+    X('L', unsigned long, unsigned long) \
+    X('q', long long, unsigned long long) \
+    X('Q', unsigned long long, unsigned long long)
+
+#if MICROPY_PY_BUILTINS_FLOAT
+#define ARRAY_KERNEL_FLOAT_TYPES(X) \
+    X('f', float, float) \
+    X('d', double, double)
+#else
+#define ARRAY_KERNEL_FLOAT_TYPES(X)
+#endif
+
+// Number of elements converted at a time through a buffer on the C stack
+#define ARRAY_KERNEL_CHUNK (16)
+
+enum {
+    ARRAY_KERNEL_ADD,
+    ARRAY_KERNEL_SUB,
+    ARRAY_KERNEL_MUL,
+};
+
+typedef struct _array_kernel_arg_t {
+    void *items;
+    size_t len;
+    char typecode; // as used by the kernels, with bytearray being 'B'
+    char obj_typecode; // of the object
+} array_kernel_arg_t;
+
+STATIC void array_kernel_get_arg(mp_obj_t obj, array_kernel_arg_t *arg, mp_uint_t flags) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(obj, &bufinfo, flags);
+    arg->obj_typecode = bufinfo.typecode;
+    arg->typecode = bufinfo.typecode == BYTEARRAY_TYPECODE ? 'B' : bufinfo.typecode;
+    switch (arg->typecode) {
+        #define ARRAY_KERNEL_TYPECODE_CASE(tc, T, UT) case tc:
+        ARRAY_KERNEL_INT_TYPES(ARRAY_KERNEL_TYPECODE_CASE)
+        ARRAY_KERNEL_FLOAT_TYPES(ARRAY_KERNEL_TYPECODE_CASE)
+        break;
+        default:
+            mp_raise_ValueError(MP_ERROR_TEXT("bad typecode"));
+    }
+    arg->items = bufinfo.buf;
+    arg->len = bufinfo.len / mp_binary_get_size('@', arg->typecode, NULL);
+}
+
+STATIC void array_kernel_check_same(const array_kernel_arg_t *a, const array_kernel_arg_t *b) {
+    if (a->typecode != b->typecode) {
+        mp_raise_ValueError(MP_ERROR_TEXT("bad typecode"));
+    }
+    if (a->len != b->len) {
+        mp_raise_ValueError(MP_ERROR_TEXT("buffers must be the same length"));
+    }
+}
+
+#define ARRAY_KERNEL_BINOP_LOOP(T, UT, OP) \
+    if (b != NULL) { \
+        for (size_t i = 0; i < n; ++i) { \
+            d[i] = (T)((UT)a[i] OP (UT)b[i]); \
+        } \
+    } else { \
+        for (size_t i = 0; i < n; ++i) { \
+            d[i] = (T)((UT)a[i] OP (UT)s); \
+        } \
+    }
+
+#define ARRAY_KERNEL_BINOP_CASE(tc, T, UT, GET_SCALAR) \
+    case tc: { \
+        T *d = dst; \
+        const T *a = src_a; \
+        const T *b = src_b; \
+        T s = b == NULL ? (T)GET_SCALAR(scalar) : 0; \
+        if (op == ARRAY_KERNEL_ADD) { \
+            ARRAY_KERNEL_BINOP_LOOP(T, UT, +) \
+        } else if (op == ARRAY_KERNEL_SUB) { \
+            ARRAY_KERNEL_BINOP_LOOP(T, UT, -) \
+        } else { \
+            ARRAY_KERNEL_BINOP_LOOP(T, UT, *) \
+        } \
+        break; \
+    }
+#define ARRAY_KERNEL_BINOP_INT_CASE(tc, T, UT) ARRAY_KERNEL_BINOP_CASE(tc, T, UT, mp_obj_get_int_truncated)
+#define ARRAY_KERNEL_BINOP_FLOAT_CASE(tc, T, UT) ARRAY_KERNEL_BINOP_CASE(tc, T, UT, mp_obj_get_float)
+
+// src_b is NULL to use the scalar instead
+STATIC void array_kernel_binop(int op, char typecode, void *dst, const void *src_a, const void *src_b, mp_obj_t scalar, size_t n) {
+    switch (typecode) {
+        ARRAY_KERNEL_INT_TYPES(ARRAY_KERNEL_BINOP_INT_CASE)
+        ARRAY_KERNEL_FLOAT_TYPES(ARRAY_KERNEL_BINOP_FLOAT_CASE)
+    }
+}
+
+STATIC mp_obj_t array_kernel_binop_helper(int op, size_t n_args, const mp_obj_t *args) {
+    array_kernel_arg_t a, b, out;
+    array_kernel_get_arg(args[0], &a, MP_BUFFER_READ);
+    bool b_is_scalar = mp_obj_is_int(args[1]) || mp_obj_is_float(args[1]);
+    if (!b_is_scalar) {
+        array_kernel_get_arg(args[1], &b, MP_BUFFER_READ);
+        array_kernel_check_same(&a, &b);
+    }
+    mp_obj_t out_obj;
+    if (n_args > 2 && args[2] != mp_const_none) {
+        out_obj = args[2];
+        array_kernel_get_arg(out_obj, &out, MP_BUFFER_WRITE);
+        array_kernel_check_same(&a, &out);
+    } else {
+        out_obj = mp_obj_new_array(a.obj_typecode, a.len);
+        out.items = ((mp_obj_array_t *)MP_OBJ_TO_PTR(out_obj))->items;
+    }
+    array_kernel_binop(op, a.typecode, out.items, a.items, b_is_scalar ? NULL : b.items, args[1], a.len);
+    return out_obj;
+}
+
+STATIC mp_obj_t array_kernel_add(size_t n_args, const mp_obj_t *args) {
+    return array_kernel_binop_helper(ARRAY_KERNEL_ADD, n_args, args);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(array_kernel_add_obj, 2, 3, array_kernel_add);
+
+STATIC mp_obj_t array_kernel_sub(size_t n_args, const mp_obj_t *args) {
+    return array_kernel_binop_helper(ARRAY_KERNEL_SUB, n_args, args);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(array_kernel_sub_obj, 2, 3, array_kernel_sub);
+
+STATIC mp_obj_t array_kernel_mul(size_t n_args, const mp_obj_t *args) {
+    return array_kernel_binop_helper(ARRAY_KERNEL_MUL, n_args, args);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(array_kernel_mul_obj, 2, 3, array_kernel_mul);
+
+// Sum of a[i], or of a[i] * b[i] if b isn't NULL
+#define ARRAY_KERNEL_SUM_INT_CASE(tc, T, UT) \
+    case tc: { \
+        const T *a = src_a; \
+        const T *b = src_b; \
+        unsigned long long acc = 0; \
+        if (b != NULL) { \
+            for (size_t i = 0; i < n; ++i) { \
+                acc += (unsigned long long)a[i] * (unsigned long long)b[i]; \
+            } \
+        } else { \
+            for (size_t i = 0; i < n; ++i) { \
+                acc += (unsigned long long)a[i]; \
+            } \
+        } \
+        if ((T)-1 > 0) { \
+            return mp_obj_new_int_from_ull(acc); \
+        } else { \
+            return mp_obj_new_int_from_ll((long long)acc); \
+        } \
+    }
+#define ARRAY_KERNEL_SUM_FLOAT_CASE(tc, T, UT) \
+    case tc: { \
+        const T *a = src_a; \
+        const T *b = src_b; \
+        mp_float_t acc = 0; \
+        if (b != NULL) { \
+            for (size_t i = 0; i < n; ++i) { \
+                acc += (mp_float_t)a[i] * (mp_float_t)b[i]; \
+            } \
+        } else { \
+            for (size_t i = 0; i < n; ++i) { \
+                acc += (mp_float_t)a[i]; \
+            } \
+        } \
+        return mp_obj_new_float(acc); \
+    }
+
+STATIC mp_obj_t array_kernel_sum_helper(char typecode, const void *src_a, const void *src_b, size_t n) {
+    switch (typecode) {
+        ARRAY_KERNEL_INT_TYPES(ARRAY_KERNEL_SUM_INT_CASE)
+        ARRAY_KERNEL_FLOAT_TYPES(ARRAY_KERNEL_SUM_FLOAT_CASE)
+    }
+    return MP_OBJ_NEW_SMALL_INT(0);
+}
+
+STATIC mp_obj_t array_kernel_sum(mp_obj_t a_in) {
+    array_kernel_arg_t a;
+    array_kernel_get_arg(a_in, &a, MP_BUFFER_READ);
+    return array_kernel_sum_helper(a.typecode, a.items, NULL, a.len);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(array_kernel_sum_obj, array_kernel_sum);
+
+STATIC mp_obj_t array_kernel_dot(mp_obj_t a_in, mp_obj_t b_in) {
+    array_kernel_arg_t a, b;
+    array_kernel_get_arg(a_in, &a, MP_BUFFER_READ);
+    array_kernel_get_arg(b_in, &b, MP_BUFFER_READ);
+    array_kernel_check_same(&a, &b);
+    return array_kernel_sum_helper(a.typecode, a.items, b.items, a.len);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(array_kernel_dot_obj, array_kernel_dot);
+
+// Index of the smallest element, or of the largest if is_max
+#define ARRAY_KERNEL_MINMAX_CASE(tc, T, UT) \
+    case tc: { \
+        const T *a = src; \
+        for (size_t i = 1; i < n; ++i) { \
+            if (is_max ? a[i] > a[best] : a[i] < a[best]) { \
+                best = i; \
+            } \
+        } \
+        break; \
+    }
+
+STATIC size_t array_kernel_minmax_index(char typecode, const void *src, size_t n, bool is_max) {
+    size_t best = 0;
+    switch (typecode) {
+        ARRAY_KERNEL_INT_TYPES(ARRAY_KERNEL_MINMAX_CASE)
+        ARRAY_KERNEL_FLOAT_TYPES(ARRAY_KERNEL_MINMAX_CASE)
+    }
+    return best;
+}
+
+STATIC mp_obj_t array_kernel_minmax(mp_obj_t a_in, bool is_max) {
+    array_kernel_arg_t a;
+    array_kernel_get_arg(a_in, &a, MP_BUFFER_READ);
+    if (a.len == 0) {
+        mp_raise_ValueError(MP_ERROR_TEXT("arg is an empty sequence"));
+    }
+    size_t best = array_kernel_minmax_index(a.typecode, a.items, a.len, is_max);
+    return mp_binary_get_val_array(a.typecode, a.items, best);
+}
+
+STATIC mp_obj_t array_kernel_min(mp_obj_t a_in) {
+    return array_kernel_minmax(a_in, false);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(array_kernel_min_obj, array_kernel_min);
+
+STATIC mp_obj_t array_kernel_max(mp_obj_t a_in) {
+    return array_kernel_minmax(a_in, true);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(array_kernel_max_obj, array_kernel_max);
+
+// Conversion goes through a buffer of long long if both typecodes are integer
+// and there's no scale, else through a buffer of mp_float_t.  Converting a
+// float to an integer truncates it and saturates at the limits of the type.
+// Without float support the scale is an integer.
+
+#define ARRAY_KERNEL_LOAD_CASE(tc, T, UT) \
+    case tc: { \
+        const T *s = (const T *)src + offset; \
+        for (size_t i = 0; i < n; ++i) { \
+            buf[i] = s[i]; \
+        } \
+        break; \
+    }
+#define ARRAY_KERNEL_STORE_CASE(tc, T, UT) \
+    case tc: { \
+        T *d = (T *)dst + offset; \
+        for (size_t i = 0; i < n; ++i) { \
+            d[i] = (T)buf[i]; \
+        } \
+        break; \
+    }
+
+STATIC void array_kernel_load_int(char typecode, const void *src, size_t offset, long long *buf, size_t n) {
+    switch (typecode) {
+        ARRAY_KERNEL_INT_TYPES(ARRAY_KERNEL_LOAD_CASE)
+    }
+}
+
+STATIC void array_kernel_store_int(char typecode, void *dst, size_t offset, const long long *buf, size_t n) {
+    switch (typecode) {
+        ARRAY_KERNEL_INT_TYPES(ARRAY_KERNEL_STORE_CASE)
+    }
+}
+
+#if MICROPY_PY_BUILTINS_FLOAT
+
+#define ARRAY_KERNEL_STORE_SATURATE_CASE(tc, T, UT) \
+    case tc: { \
+        T *d = (T *)dst + offset; \
+        const T max = (T)-1 > 0 ? (T)-1 : (T)((UT)-1 >> 1); \
+        const T min = (T)-1 > 0 ? 0 : (T)(-max - 1); \
+        for (size_t i = 0; i < n; ++i) { \
+            mp_float_t v = buf[i]; \
+            d[i] = v >= (mp_float_t)max ? max : v <= (mp_float_t)min ? min : v == v ? (T)v : 0; \
+        } \
+        break; \
+    }
+
+STATIC void array_kernel_load_float(char typecode, const void *src, size_t offset, mp_float_t *buf, size_t n) {
+    switch (typecode) {
+        ARRAY_KERNEL_INT_TYPES(ARRAY_KERNEL_LOAD_CASE)
+        ARRAY_KERNEL_FLOAT_TYPES(ARRAY_KERNEL_LOAD_CASE)
+    }
+}
+
+STATIC void array_kernel_store_float(char typecode, void *dst, size_t offset, const mp_float_t *buf, size_t n) {
+    switch (typecode) {
+        ARRAY_KERNEL_INT_TYPES(ARRAY_KERNEL_STORE_SATURATE_CASE)
+        ARRAY_KERNEL_FLOAT_TYPES(ARRAY_KERNEL_STORE_CASE)
+    }
+}
+
+#endif
+
+STATIC mp_obj_t array_kernel_convert(size_t n_args, const mp_obj_t *args) {
+    array_kernel_arg_t dst, src;
+    array_kernel_get_arg(args[0], &dst, MP_BUFFER_WRITE);
+    array_kernel_get_arg(args[1], &src, MP_BUFFER_READ);
+    if (dst.len != src.len) {
+        mp_raise_ValueError(MP_ERROR_TEXT("buffers must be the same length"));
+    }
+    bool has_scale = n_args > 2 && args[2] != mp_const_none;
+    #if MICROPY_PY_BUILTINS_FLOAT
+    if (has_scale || dst.typecode == 'f' || dst.typecode == 'd' || src.typecode == 'f' || src.typecode == 'd') {
+        mp_float_t scale = has_scale ? mp_obj_get_float(args[2]) : 1;
+        mp_float_t buf[ARRAY_KERNEL_CHUNK];
+        for (size_t offset = 0; offset < src.len; offset += ARRAY_KERNEL_CHUNK) {
+            size_t n = MIN(ARRAY_KERNEL_CHUNK, src.len - offset);
+            array_kernel_load_float(src.typecode, src.items, offset, buf, n);
+            if (has_scale) {
+                for (size_t i = 0; i < n; ++i) {
+                    buf[i] *= scale;
+                }
+            }
+            array_kernel_store_float(dst.typecode, dst.items, offset, buf, n);
+        }
+        return mp_const_none;
+    }
+    #else
+    mp_int_t scale = has_scale ? mp_obj_get_int(args[2]) : 1;
+    #endif
+    long long buf[ARRAY_KERNEL_CHUNK];
+    for (size_t offset = 0; offset < src.len; offset += ARRAY_KERNEL_CHUNK) {
+        size_t n = MIN(ARRAY_KERNEL_CHUNK, src.len - offset);
+        array_kernel_load_int(src.typecode, src.items, offset, buf, n);
+        #if !MICROPY_PY_BUILTINS_FLOAT
+        if (has_scale) {
+            for (size_t i = 0; i < n; ++i) {
+                buf[i] *= scale;
+            }
+        }
+        #endif
+        array_kernel_store_int(dst.typecode, dst.items, offset, buf, n);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(array_kernel_convert_obj, 2, 3, array_kernel_convert);
+
+#endif // MICROPY_PY_ARRAY_KERNELS
+
 STATIC const mp_rom_map_elem_t mp_module_array_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_uarray) },
     { MP_ROM_QSTR(MP_QSTR_array), MP_ROM_PTR(&mp_type_array) },
+    #if MICROPY_PY_ARRAY_KERNELS
+    { MP_ROM_QSTR(MP_QSTR_add), MP_ROM_PTR(&array_kernel_add_obj) },
+    { MP_ROM_QSTR(MP_QSTR_sub), MP_ROM_PTR(&array_kernel_sub_obj) },
+    { MP_ROM_QSTR(MP_QSTR_mul), MP_ROM_PTR(&array_kernel_mul_obj) },
+    { MP_ROM_QSTR(MP_QSTR_sum), MP_ROM_PTR(&array_kernel_sum_obj) },
+    { MP_ROM_QSTR(MP_QSTR_dot), MP_ROM_PTR(&array_kernel_dot_obj) },
+    { MP_ROM_QSTR(MP_QSTR_min), MP_ROM_PTR(&array_kernel_min_obj) },
+    { MP_ROM_QSTR(MP_QSTR_max), MP_ROM_PTR(&array_kernel_max_obj) },
+    { MP_ROM_QSTR(MP_QSTR_convert), MP_ROM_PTR(&array_kernel_convert_obj) },
+    #endif
 };
 
 STATIC MP_DEFINE_CONST_DICT(mp_module_array_globals, mp_module_array_globals_table);
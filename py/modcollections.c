@@ -37,6 +37,9 @@ STATIC const mp_rom_map_elem_t mp_module_collections_globals_table[] = {
     #if MICROPY_PY_COLLECTIONS_ORDEREDDICT
     { MP_ROM_QSTR(MP_QSTR_OrderedDict), MP_ROM_PTR(&mp_type_ordereddict) },
     #endif
+    #if MICROPY_PY_COLLECTIONS_INTDICT
+    { MP_ROM_QSTR(MP_QSTR_IntDict), MP_ROM_PTR(&mp_type_intdict) },
+    #endif
 };
 
 STATIC MP_DEFINE_CONST_DICT(mp_module_collections_globals, mp_module_collections_globals_table);
@@ -26,10 +26,36 @@
 
 #include "py/mpstate.h"
 #include "py/obj.h"
+#include "py/runtime.h"
 #include "py/gc.h"
 
 #if MICROPY_PY_GC && MICROPY_ENABLE_GC
 
+#if MICROPY_GC_INCREMENTAL
+// collect(budget_us=None): run a garbage collection, or a time-bounded step of one
+STATIC mp_obj_t py_gc_collect(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_budget_us };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_budget_us, MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+    if (args[ARG_budget_us].u_obj != mp_const_none) {
+        mp_int_t budget_us = mp_obj_get_int(args[ARG_budget_us].u_obj);
+        if (budget_us < 0) {
+            mp_raise_ValueError(NULL);
+        }
+        return mp_obj_new_bool(gc_collect_step(budget_us));
+    }
+    gc_collect();
+    #if MICROPY_PY_GC_COLLECT_RETVAL
+    return MP_OBJ_NEW_SMALL_INT(MP_STATE_MEM(gc_collected));
+    #else
+    return mp_const_none;
+    #endif
+}
+MP_DEFINE_CONST_FUN_OBJ_KW(gc_collect_obj, 0, py_gc_collect);
+#else
 // collect(): run a garbage collection
 STATIC mp_obj_t py_gc_collect(void) {
     gc_collect();
@@ -40,6 +66,7 @@ STATIC mp_obj_t py_gc_collect(void) {
     #endif
 }
 MP_DEFINE_CONST_FUN_OBJ_0(gc_collect_obj, py_gc_collect);
+#endif
 
 // disable(): disable the garbage collector
 STATIC mp_obj_t gc_disable(void) {
@@ -76,6 +103,71 @@ STATIC mp_obj_t gc_mem_alloc(void) {
 }
 MP_DEFINE_CONST_FUN_OBJ_0(gc_mem_alloc_obj, gc_mem_alloc);
 
+#if MICROPY_GC_GENERATIONAL
+// mem_collections(): return a tuple of the number of minor and major collections
+STATIC mp_obj_t gc_mem_collections(void) {
+    mp_obj_t tuple[2] = {
+        mp_obj_new_int_from_uint(MP_STATE_MEM(gc_minor_count)),
+        mp_obj_new_int_from_uint(MP_STATE_MEM(gc_major_count)),
+    };
+    return mp_obj_new_tuple(2, tuple);
+}
+MP_DEFINE_CONST_FUN_OBJ_0(gc_mem_collections_obj, gc_mem_collections);
+#endif
+
+#if MICROPY_GC_COMPACT
+// compact(): move data to reduce fragmentation, return the largest free block
+STATIC mp_obj_t py_gc_compact(void) {
+    gc_compact();
+    gc_info_t info;
+    gc_info(&info);
+    return MP_OBJ_NEW_SMALL_INT(info.max_free * MICROPY_BYTES_PER_GC_BLOCK);
+}
+MP_DEFINE_CONST_FUN_OBJ_0(gc_compact_obj, py_gc_compact);
+#endif
+
+#if MICROPY_GC_STATS
+// stats(reset=False): return a dict of the history of collections, in bytes
+// and microseconds
+STATIC mp_obj_t py_gc_stats(size_t n_args, const mp_obj_t *args) {
+    mp_gc_stats_t stats;
+    gc_stats(&stats, n_args > 0 && mp_obj_is_true(args[0]));
+    gc_info_t info;
+    gc_info(&info);
+    mp_uint_t alloc_rate = 0;
+    if (stats.cycle_ms > 0) {
+        alloc_rate = (uint64_t)stats.cycle_alloc * MICROPY_BYTES_PER_GC_BLOCK * 1000 / stats.cycle_ms;
+    }
+    const struct {
+        qstr key;
+        mp_uint_t value;
+    } items[] = {
+        { MP_QSTR_collections, stats.collections },
+        { MP_QSTR_pauses, stats.pauses },
+        { MP_QSTR_pause_min_us, stats.pause_min_us },
+        { MP_QSTR_pause_avg_us, stats.pauses ? (mp_uint_t)(stats.pause_total_us / stats.pauses) : 0 },
+        { MP_QSTR_pause_max_us, stats.pause_max_us },
+        { MP_QSTR_pause_last_us, stats.pause_last_us },
+        { MP_QSTR_marked, stats.marked * MICROPY_BYTES_PER_GC_BLOCK },
+        { MP_QSTR_swept, stats.swept * MICROPY_BYTES_PER_GC_BLOCK },
+        { MP_QSTR_peak, MAX(stats.peak * MICROPY_BYTES_PER_GC_BLOCK, info.used) },
+        { MP_QSTR_alloc, stats.alloc * MICROPY_BYTES_PER_GC_BLOCK },
+        { MP_QSTR_alloc_rate, alloc_rate },
+        { MP_QSTR_max_free, info.max_free * MICROPY_BYTES_PER_GC_BLOCK },
+        #if MICROPY_GC_POOL
+        { MP_QSTR_pool_kept, stats.pool_kept },
+        { MP_QSTR_pool_reused, stats.pool_reused },
+        #endif
+    };
+    mp_obj_t dict = mp_obj_new_dict(MP_ARRAY_SIZE(items));
+    for (size_t i = 0; i < MP_ARRAY_SIZE(items); ++i) {
+        mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(items[i].key), mp_obj_new_int_from_uint(items[i].value));
+    }
+    return dict;
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(gc_stats_obj, 0, 1, py_gc_stats);
+#endif
+
 #if MICROPY_GC_ALLOC_THRESHOLD
 STATIC mp_obj_t gc_threshold(size_t n_args, const mp_obj_t *args) {
     if (n_args == 0) {
@@ -103,6 +195,15 @@ STATIC const mp_rom_map_elem_t mp_module_gc_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_isenabled), MP_ROM_PTR(&gc_isenabled_obj) },
     { MP_ROM_QSTR(MP_QSTR_mem_free), MP_ROM_PTR(&gc_mem_free_obj) },
     { MP_ROM_QSTR(MP_QSTR_mem_alloc), MP_ROM_PTR(&gc_mem_alloc_obj) },
+    #if MICROPY_GC_GENERATIONAL
+    { MP_ROM_QSTR(MP_QSTR_mem_collections), MP_ROM_PTR(&gc_mem_collections_obj) },
+    #endif
+    #if MICROPY_GC_COMPACT
+    { MP_ROM_QSTR(MP_QSTR_compact), MP_ROM_PTR(&gc_compact_obj) },
+    #endif
+    #if MICROPY_GC_STATS
+    { MP_ROM_QSTR(MP_QSTR_stats), MP_ROM_PTR(&gc_stats_obj) },
+    #endif
     #if MICROPY_GC_ALLOC_THRESHOLD
     { MP_ROM_QSTR(MP_QSTR_threshold), MP_ROM_PTR(&gc_threshold_obj) },
     #endif
@@ -24,7 +24,10 @@
  * THE SOFTWARE.
  */
 
+#include <string.h>
+
 #include "py/builtin.h"
+#include "py/binary.h"
 #include "py/runtime.h"
 
 #if MICROPY_PY_BUILTINS_FLOAT && MICROPY_PY_MATH
@@ -200,7 +203,354 @@ MATH_FUN_1(gamma, tgamma)
 // lgamma(x): return the natural logarithm of the gamma function of x
 MATH_FUN_1(lgamma, lgamma)
 #endif
-// TODO: fsum
+
+#if MICROPY_PY_MATH_FSUM || MICROPY_PY_MATH_APPLY
+
+// Gets the floats of an iterable one at a time.  The items of an array('f')
+// or array('d') are read straight from its memory, without float objects.
+typedef struct _math_float_iter_t {
+    mp_obj_t iter;
+    const void *buf;
+    size_t len;
+    size_t idx;
+    char typecode;
+    mp_obj_iter_buf_t iter_buf;
+} math_float_iter_t;
+
+STATIC bool math_get_float_buffer(mp_obj_t obj, mp_buffer_info_t *bufinfo, mp_uint_t flags) {
+    return mp_get_buffer(obj, bufinfo, flags) && (bufinfo->typecode == 'f' || bufinfo->typecode == 'd');
+}
+
+STATIC void math_float_iter_init(math_float_iter_t *it, mp_obj_t obj) {
+    mp_buffer_info_t bufinfo;
+    if (math_get_float_buffer(obj, &bufinfo, MP_BUFFER_READ)) {
+        it->iter = MP_OBJ_NULL;
+        it->buf = bufinfo.buf;
+        it->typecode = bufinfo.typecode;
+        it->len = bufinfo.len / mp_binary_get_size('@', bufinfo.typecode, NULL);
+        it->idx = 0;
+    } else {
+        it->iter = mp_getiter(obj, &it->iter_buf);
+    }
+}
+
+STATIC bool math_float_iter_next(math_float_iter_t *it, mp_float_t *x) {
+    if (it->iter == MP_OBJ_NULL) {
+        if (it->idx >= it->len) {
+            return false;
+        }
+        if (it->typecode == 'f') {
+            *x = ((const float *)it->buf)[it->idx++];
+        } else {
+            *x = (mp_float_t)((const double *)it->buf)[it->idx++];
+        }
+        return true;
+    }
+    mp_obj_t item = mp_iternext(it->iter);
+    if (item == MP_OBJ_STOP_ITERATION) {
+        return false;
+    }
+    *x = mp_obj_get_float(item);
+    return true;
+}
+
+#endif
+
+#if MICROPY_PY_MATH_FSUM
+
+// fsum(iterable): return an accurate sum of the values, using Shewchuk's
+// algorithm as CPython does: the exact sum is kept as a list of partial sums
+// that don't overlap, so no bits are lost to rounding on the way
+STATIC mp_obj_t mp_math_fsum(mp_obj_t iterable) {
+    mp_float_t partials_stack[32];
+    mp_float_t *partials = partials_stack;
+    size_t partials_alloc = MP_ARRAY_SIZE(partials_stack);
+    size_t n = 0;
+    mp_float_t special_sum = 0;
+    mp_float_t inf_sum = 0;
+
+    math_float_iter_t it;
+    math_float_iter_init(&it, iterable);
+    mp_float_t x;
+    while (math_float_iter_next(&it, &x)) {
+        mp_float_t xsave = x;
+        size_t i = 0;
+        for (size_t j = 0; j < n; ++j) {
+            mp_float_t y = partials[j];
+            if (MICROPY_FLOAT_C_FUN(fabs)(x) < MICROPY_FLOAT_C_FUN(fabs)(y)) {
+                mp_float_t t = x;
+                x = y;
+                y = t;
+            }
+            mp_float_t hi = x + y;
+            mp_float_t lo = y - (hi - x);
+            if (lo != 0) {
+                partials[i++] = lo;
+            }
+            x = hi;
+        }
+        n = i;
+        if (x != 0) {
+            if (!isfinite(x)) {
+                // a nonfinite x could arise either from an inf or nan in the
+                // input or from an intermediate overflow
+                if (isfinite(xsave)) {
+                    if (partials != partials_stack) {
+                        m_del(mp_float_t, partials, partials_alloc);
+                    }
+                    mp_raise_msg(&mp_type_OverflowError, MP_ERROR_TEXT("intermediate overflow in fsum"));
+                }
+                if (isinf(xsave)) {
+                    inf_sum += xsave;
+                }
+                special_sum += xsave;
+                // reset partials
+                n = 0;
+            } else {
+                if (n == partials_alloc) {
+                    if (partials == partials_stack) {
+                        partials = m_new(mp_float_t, partials_alloc * 2);
+                        memcpy(partials, partials_stack, sizeof(partials_stack));
+                    } else {
+                        partials = m_renew(mp_float_t, partials, partials_alloc, partials_alloc * 2);
+                    }
+                    partials_alloc *= 2;
+                }
+                partials[n++] = x;
+            }
+        }
+    }
+
+    mp_float_t hi = 0;
+    if (special_sum != 0) {
+        if (isnan(inf_sum)) {
+            // inf - inf
+            mp_raise_ValueError(MP_ERROR_TEXT("-inf + inf in fsum"));
+        }
+        hi = special_sum;
+    } else if (n > 0) {
+        // sum the partials from the top, stopping when the sum becomes inexact
+        mp_float_t lo = 0;
+        hi = partials[--n];
+        while (n > 0) {
+            x = hi;
+            mp_float_t y = partials[--n];
+            hi = x + y;
+            lo = y - (hi - x);
+            if (lo != 0) {
+                break;
+            }
+        }
+        // round half-even if the sum of the rest lies exactly halfway
+        // between two floats
+        if (n > 0 && ((lo < 0 && partials[n - 1] < 0) || (lo > 0 && partials[n - 1] > 0))) {
+            mp_float_t y = lo * 2;
+            x = hi + y;
+            if (y == x - hi) {
+                hi = x;
+            }
+        }
+    }
+    if (partials != partials_stack) {
+        m_del(mp_float_t, partials, partials_alloc);
+    }
+    return mp_obj_new_float(hi);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mp_math_fsum_obj, mp_math_fsum);
+
+// prod(iterable, *, start=1): return the product of start and the values
+STATIC mp_obj_t mp_math_prod(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_start };
+    static const mp_arg_t allowed_args[] = {
+        {MP_QSTR_start, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = MP_OBJ_NEW_SMALL_INT(1)}},
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+    mp_obj_t result = args[ARG_start].u_obj;
+
+    mp_buffer_info_t bufinfo;
+    if (math_get_float_buffer(pos_args[0], &bufinfo, MP_BUFFER_READ)
+        && (mp_obj_is_int(result) || mp_obj_is_float(result))) {
+        // multiply the floats of an array without creating objects
+        math_float_iter_t it;
+        math_float_iter_init(&it, pos_args[0]);
+        if (it.len == 0) {
+            return result;
+        }
+        mp_float_t p = mp_obj_get_float(result);
+        mp_float_t x;
+        while (math_float_iter_next(&it, &x)) {
+            p *= x;
+        }
+        return mp_obj_new_float(p);
+    }
+
+    mp_obj_iter_buf_t iter_buf;
+    mp_obj_t iter = mp_getiter(pos_args[0], &iter_buf);
+    mp_obj_t item;
+    while ((item = mp_iternext(iter)) != MP_OBJ_STOP_ITERATION) {
+        result = mp_binary_op(MP_BINARY_OP_MULTIPLY, result, item);
+    }
+    return result;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mp_math_prod_obj, 1, mp_math_prod);
+
+// dist(p, q): return the Euclidean distance between two points, scaling
+// the sum of squares by the largest difference so it can't overflow
+STATIC mp_obj_t mp_math_dist(mp_obj_t p_obj, mp_obj_t q_obj) {
+    math_float_iter_t p_it, q_it;
+    math_float_iter_init(&p_it, p_obj);
+    math_float_iter_init(&q_it, q_obj);
+    mp_float_t scale = 0;
+    mp_float_t ssq = 1;
+    mp_float_t nan_diff = 0;
+    for (;;) {
+        mp_float_t px, qx;
+        bool p_more = math_float_iter_next(&p_it, &px);
+        bool q_more = math_float_iter_next(&q_it, &qx);
+        if (p_more != q_more) {
+            mp_raise_ValueError(MP_ERROR_TEXT("both points must have the same number of dimensions"));
+        }
+        if (!p_more) {
+            break;
+        }
+        mp_float_t d = MICROPY_FLOAT_C_FUN(fabs)(px - qx);
+        if (isnan(d)) {
+            nan_diff = d;
+        } else if (isinf(d) || isinf(scale)) {
+            scale = d > scale ? d : scale;
+        } else if (d > scale) {
+            ssq = 1 + ssq * (scale / d) * (scale / d);
+            scale = d;
+        } else if (d != 0) {
+            ssq += (d / scale) * (d / scale);
+        }
+    }
+    if (isinf(scale)) {
+        // an infinite difference wins over a nan, as for hypot()
+        return mp_obj_new_float(scale);
+    }
+    if (isnan(nan_diff)) {
+        return mp_obj_new_float(nan_diff);
+    }
+    return mp_obj_new_float(scale * MICROPY_FLOAT_C_FUN(sqrt)(ssq));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(mp_math_dist_obj, mp_math_dist);
+
+#endif
+
+#if MICROPY_PY_MATH_APPLY
+
+typedef struct _math_apply_fun_t {
+    const mp_obj_fun_builtin_fixed_t *obj;
+    mp_float_t (*f)(mp_float_t);
+} math_apply_fun_t;
+
+// The functions of this module that apply() calls straight from C
+STATIC const math_apply_fun_t math_apply_funs[] = {
+    { &mp_math_sqrt_obj, MICROPY_FLOAT_C_FUN(sqrt) },
+    { &mp_math_exp_obj, MICROPY_FLOAT_C_FUN(exp) },
+    #if MICROPY_PY_MATH_SPECIAL_FUNCTIONS
+    { &mp_math_expm1_obj, MICROPY_FLOAT_C_FUN(expm1) },
+    { &mp_math_log2_obj, MICROPY_FLOAT_C_FUN(log2) },
+    { &mp_math_log10_obj, MICROPY_FLOAT_C_FUN(log10) },
+    { &mp_math_cosh_obj, MICROPY_FLOAT_C_FUN(cosh) },
+    { &mp_math_sinh_obj, MICROPY_FLOAT_C_FUN(sinh) },
+    { &mp_math_tanh_obj, MICROPY_FLOAT_C_FUN(tanh) },
+    { &mp_math_acosh_obj, MICROPY_FLOAT_C_FUN(acosh) },
+    { &mp_math_asinh_obj, MICROPY_FLOAT_C_FUN(asinh) },
+    { &mp_math_atanh_obj, MICROPY_FLOAT_C_FUN(atanh) },
+    { &mp_math_erf_obj, MICROPY_FLOAT_C_FUN(erf) },
+    { &mp_math_erfc_obj, MICROPY_FLOAT_C_FUN(erfc) },
+    { &mp_math_gamma_obj, MICROPY_FLOAT_C_FUN(tgamma) },
+    { &mp_math_lgamma_obj, MICROPY_FLOAT_C_FUN(lgamma) },
+    #endif
+    { &mp_math_cos_obj, MICROPY_FLOAT_C_FUN(cos) },
+    { &mp_math_sin_obj, MICROPY_FLOAT_C_FUN(sin) },
+    { &mp_math_tan_obj, MICROPY_FLOAT_C_FUN(tan) },
+    { &mp_math_acos_obj, MICROPY_FLOAT_C_FUN(acos) },
+    { &mp_math_asin_obj, MICROPY_FLOAT_C_FUN(asin) },
+    { &mp_math_atan_obj, MICROPY_FLOAT_C_FUN(atan) },
+    { &mp_math_fabs_obj, MICROPY_FLOAT_C_FUN(fabs_func) },
+    { &mp_math_ceil_obj, MICROPY_FLOAT_C_FUN(ceil) },
+    { &mp_math_floor_obj, MICROPY_FLOAT_C_FUN(floor) },
+    { &mp_math_trunc_obj, MICROPY_FLOAT_C_FUN(trunc) },
+};
+
+STATIC void math_apply_store(const mp_buffer_info_t *dst_info, size_t i, mp_float_t y) {
+    if (dst_info->typecode == 'f') {
+        ((float *)dst_info->buf)[i] = (float)y;
+    } else {
+        ((double *)dst_info->buf)[i] = y;
+    }
+}
+
+// apply(func, src, dst): store func(x) for each value x of src in dst, an
+// array('f') or array('d') of the same length, and return dst.  The functions
+// of this module are called from C without creating float objects; other
+// callables are called with each value.  dst may be the same array as src.
+STATIC mp_obj_t mp_math_apply(mp_obj_t func, mp_obj_t src, mp_obj_t dst) {
+    mp_buffer_info_t dst_info;
+    if (!math_get_float_buffer(dst, &dst_info, MP_BUFFER_WRITE)) {
+        mp_raise_TypeError(MP_ERROR_TEXT("dst must be an array of floats"));
+    }
+    size_t len = dst_info.len / mp_binary_get_size('@', dst_info.typecode, NULL);
+
+    mp_float_t (*f)(mp_float_t) = NULL;
+    for (size_t i = 0; i < MP_ARRAY_SIZE(math_apply_funs); ++i) {
+        if (func == MP_OBJ_FROM_PTR(math_apply_funs[i].obj)) {
+            f = math_apply_funs[i].f;
+            break;
+        }
+    }
+
+    math_float_iter_t it;
+    math_float_iter_init(&it, src);
+    if (it.iter == MP_OBJ_NULL && it.len != len) {
+        mp_raise_ValueError(MP_ERROR_TEXT("src and dst must have the same length"));
+    }
+
+    if (f != NULL && it.iter == MP_OBJ_NULL && it.typecode == dst_info.typecode
+        && mp_binary_get_size('@', dst_info.typecode, NULL) == sizeof(mp_float_t)) {
+        // both arrays hold mp_float_t, so run the function straight over them
+        const mp_float_t *s = it.buf;
+        mp_float_t *d = dst_info.buf;
+        for (size_t i = 0; i < len; ++i) {
+            mp_float_t x = s[i];
+            mp_float_t y = f(x);
+            if ((isnan(y) && !isnan(x)) || (isinf(y) && !isinf(x))) {
+                math_error();
+            }
+            d[i] = y;
+        }
+        return dst;
+    }
+
+    size_t i = 0;
+    mp_float_t x;
+    while (math_float_iter_next(&it, &x)) {
+        if (i == len) {
+            mp_raise_ValueError(MP_ERROR_TEXT("src and dst must have the same length"));
+        }
+        mp_float_t y;
+        if (f != NULL) {
+            y = f(x);
+            if ((isnan(y) && !isnan(x)) || (isinf(y) && !isinf(x))) {
+                math_error();
+            }
+        } else {
+            y = mp_obj_get_float(mp_call_function_1(func, mp_obj_new_float(x)));
+        }
+        math_apply_store(&dst_info, i++, y);
+    }
+    if (i != len) {
+        mp_raise_ValueError(MP_ERROR_TEXT("src and dst must have the same length"));
+    }
+    return dst;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(mp_math_apply_obj, mp_math_apply);
+
+#endif
 
 #if MICROPY_PY_MATH_ISCLOSE
 STATIC mp_obj_t mp_math_isclose(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
@@ -412,6 +762,14 @@ STATIC const mp_rom_map_elem_t mp_module_math_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_trunc), MP_ROM_PTR(&mp_math_trunc_obj) },
     { MP_ROM_QSTR(MP_QSTR_radians), MP_ROM_PTR(&mp_math_radians_obj) },
     { MP_ROM_QSTR(MP_QSTR_degrees), MP_ROM_PTR(&mp_math_degrees_obj) },
+    #if MICROPY_PY_MATH_FSUM
+    { MP_ROM_QSTR(MP_QSTR_fsum), MP_ROM_PTR(&mp_math_fsum_obj) },
+    { MP_ROM_QSTR(MP_QSTR_prod), MP_ROM_PTR(&mp_math_prod_obj) },
+    { MP_ROM_QSTR(MP_QSTR_dist), MP_ROM_PTR(&mp_math_dist_obj) },
+    #endif
+    #if MICROPY_PY_MATH_APPLY
+    { MP_ROM_QSTR(MP_QSTR_apply), MP_ROM_PTR(&mp_math_apply_obj) },
+    #endif
     #if MICROPY_PY_MATH_FACTORIAL
     { MP_ROM_QSTR(MP_QSTR_factorial), MP_ROM_PTR(&mp_math_factorial_obj) },
     #endif
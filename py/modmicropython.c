@@ -25,12 +25,19 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 
 #include "py/builtin.h"
 #include "py/stackctrl.h"
 #include "py/runtime.h"
 #include "py/gc.h"
 #include "py/mphal.h"
+#include "py/heapimage.h"
+#include "py/profile.h"
+#include "py/vmstats.h"
+#include "py/objlist.h"
+#include "py/stream.h"
+#include "py/trace.h"
 
 // Various builtins specific to MicroPython runtime,
 // living in micropython module
@@ -45,6 +52,18 @@ STATIC mp_obj_t mp_micropython_opt_level(size_t n_args, const mp_obj_t *args) {
     }
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp_micropython_opt_level_obj, 0, 1, mp_micropython_opt_level);
+
+#if MICROPY_MODULE_MPY_CACHE
+STATIC mp_obj_t mp_micropython_mpy_cache(size_t n_args, const mp_obj_t *args) {
+    if (n_args == 0) {
+        return mp_obj_new_bool(MP_STATE_VM(mpy_cache));
+    } else {
+        MP_STATE_VM(mpy_cache) = mp_obj_is_true(args[0]);
+        return mp_const_none;
+    }
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp_micropython_mpy_cache_obj, 0, 1, mp_micropython_mpy_cache);
+#endif
 #endif
 
 #if MICROPY_PY_MICROPYTHON_MEM_INFO
@@ -107,6 +126,39 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp_micropython_qstr_info_obj, 0, 1, m
 
 #endif // MICROPY_PY_MICROPYTHON_MEM_INFO
 
+#if MICROPY_QSTR_SNAPSHOT
+STATIC mp_obj_t mp_micropython_qstr_snapshot(void) {
+    vstr_t vstr;
+    size_t len = qstr_snapshot(NULL, 0);
+    vstr_init_len(&vstr, len);
+    // retry if another thread interned a string in the meantime
+    while ((len = qstr_snapshot((byte *)vstr.buf, vstr.len)) > vstr.len) {
+        vstr_clear(&vstr);
+        vstr_init_len(&vstr, len);
+    }
+    vstr.len = len;
+    return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(mp_micropython_qstr_snapshot_obj, mp_micropython_qstr_snapshot);
+#endif
+
+#if MICROPY_HEAP_IMAGE
+STATIC bool mp_micropython_heap_image_write(void *env, const void *buf, size_t len) {
+    int errcode;
+    mp_uint_t n = mp_stream_write_exactly(MP_OBJ_FROM_PTR(env), buf, len, &errcode);
+    return errcode == 0 && n == len;
+}
+
+STATIC mp_obj_t mp_micropython_heap_image_save(mp_obj_t stream) {
+    mp_get_stream_raise(stream, MP_STREAM_OP_WRITE);
+    if (!mp_heap_image_save(mp_micropython_heap_image_write, MP_OBJ_TO_PTR(stream))) {
+        mp_raise_OSError(MP_EIO);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mp_micropython_heap_image_save_obj, mp_micropython_heap_image_save);
+#endif
+
 #if MICROPY_PY_MICROPYTHON_STACK_USE
 STATIC mp_obj_t mp_micropython_stack_use(void) {
     return MP_OBJ_NEW_SMALL_INT(mp_stack_usage());
@@ -142,6 +194,311 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_0(mp_micropython_heap_locked_obj, mp_micropython_
 #endif
 #endif
 
+#if MICROPY_GC_ARENA
+typedef struct _mp_obj_arena_t {
+    mp_obj_base_t base;
+    size_t size;
+    void *arena;
+} mp_obj_arena_t;
+
+STATIC mp_obj_t mp_micropython_arena_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 0, 1, false);
+    mp_obj_arena_t *self = m_new_obj(mp_obj_arena_t);
+    self->base.type = type;
+    self->size = n_args > 0 ? mp_obj_get_int(args[0]) : 4096;
+    self->arena = NULL;
+    return MP_OBJ_FROM_PTR(self);
+}
+
+STATIC mp_obj_t mp_micropython_arena___enter__(mp_obj_t self_in) {
+    mp_obj_arena_t *self = MP_OBJ_TO_PTR(self_in);
+    if (self->arena != NULL) {
+        mp_raise_msg(&mp_type_RuntimeError, MP_ERROR_TEXT("arena already active"));
+    }
+    self->arena = gc_arena_begin(self->size);
+    if (self->arena == NULL) {
+        m_malloc_fail(self->size);
+    }
+    return self_in;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mp_micropython_arena___enter___obj, mp_micropython_arena___enter__);
+
+STATIC mp_obj_t mp_micropython_arena___exit__(size_t n_args, const mp_obj_t *args) {
+    (void)n_args;
+    mp_obj_arena_t *self = MP_OBJ_TO_PTR(args[0]);
+    void *arena = self->arena;
+    if (arena != NULL) {
+        self->arena = NULL;
+        // A propagating exception may have been allocated in the arena, so
+        // in that case the arena is left for the GC to free.
+        if (!gc_arena_end(arena, args[1] == mp_const_none)) {
+            mp_raise_msg(&mp_type_RuntimeError, MP_ERROR_TEXT("arena object escaped"));
+        }
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp_micropython_arena___exit___obj, 4, 4, mp_micropython_arena___exit__);
+
+STATIC const mp_rom_map_elem_t mp_micropython_arena_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR___enter__), MP_ROM_PTR(&mp_micropython_arena___enter___obj) },
+    { MP_ROM_QSTR(MP_QSTR___exit__), MP_ROM_PTR(&mp_micropython_arena___exit___obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(mp_micropython_arena_locals_dict, mp_micropython_arena_locals_dict_table);
+
+STATIC const mp_obj_type_t mp_micropython_arena_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_arena,
+    .make_new = mp_micropython_arena_make_new,
+    .locals_dict = (mp_obj_dict_t *)&mp_micropython_arena_locals_dict,
+};
+#endif
+
+#if MICROPY_PY_MICROPYTHON_LIST_WITH_CAPACITY
+STATIC mp_obj_t mp_micropython_list_with_capacity(mp_obj_t capacity_in) {
+    mp_int_t capacity = mp_obj_get_int(capacity_in);
+    if (capacity < 0) {
+        mp_raise_ValueError(NULL);
+    }
+    mp_obj_list_t *list = MP_OBJ_TO_PTR(mp_obj_new_list(capacity, NULL));
+    list->len = 0;
+    mp_seq_clear(list->items, 0, list->alloc, sizeof(*list->items));
+    return MP_OBJ_FROM_PTR(list);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mp_micropython_list_with_capacity_obj, mp_micropython_list_with_capacity);
+#endif
+
+#if MICROPY_PY_MICROPYTHON_STRINGBUILDER
+typedef struct _mp_obj_stringbuilder_t {
+    mp_obj_base_t base;
+    const mp_obj_type_t *value_type; // str or bytes, the type getvalue returns
+    vstr_t vstr;
+} mp_obj_stringbuilder_t;
+
+STATIC void stringbuilder_add(mp_obj_stringbuilder_t *self, const char *str, size_t len) {
+    vstr_t *vstr = &self->vstr;
+    if (vstr->len + len > vstr->alloc) {
+        // Grow by at least the current length, so that a run of appends
+        // takes linear time overall.
+        vstr_hint_size(vstr, MAX(len, vstr->len));
+    }
+    vstr_add_strn(vstr, str, len);
+}
+
+STATIC void stringbuilder_add_obj(mp_obj_stringbuilder_t *self, mp_obj_t arg) {
+    // A str builder only takes str, so that getvalue always gives valid UTF-8.
+    if (self->value_type == &mp_type_str && !mp_obj_is_str(arg)) {
+        mp_raise_TypeError(MP_ERROR_TEXT("can't convert to str implicitly"));
+    }
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(arg, &bufinfo, MP_BUFFER_READ);
+    stringbuilder_add(self, bufinfo.buf, bufinfo.len);
+}
+
+STATIC mp_obj_t mp_micropython_stringbuilder_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 0, 2, false);
+    mp_obj_stringbuilder_t *self = m_new_obj(mp_obj_stringbuilder_t);
+    self->base.type = type;
+    self->value_type = &mp_type_str;
+    if (n_args > 0 && !mp_obj_is_str(args[0])) {
+        // Anything other than a str gives a bytes builder.
+        self->value_type = &mp_type_bytes;
+    }
+    vstr_init(&self->vstr, n_args > 1 ? mp_obj_get_int(args[1]) : 16);
+    if (n_args > 0) {
+        stringbuilder_add_obj(self, args[0]);
+    }
+    return MP_OBJ_FROM_PTR(self);
+}
+
+STATIC mp_obj_t mp_micropython_stringbuilder_unary_op(mp_unary_op_t op, mp_obj_t self_in) {
+    mp_obj_stringbuilder_t *self = MP_OBJ_TO_PTR(self_in);
+    switch (op) {
+        case MP_UNARY_OP_BOOL:
+            return mp_obj_new_bool(self->vstr.len != 0);
+        case MP_UNARY_OP_LEN:
+            return MP_OBJ_NEW_SMALL_INT(self->vstr.len);
+        default:
+            return MP_OBJ_NULL; // op not supported
+    }
+}
+
+STATIC mp_obj_t mp_micropython_stringbuilder_binary_op(mp_binary_op_t op, mp_obj_t lhs_in, mp_obj_t rhs_in) {
+    if (op != MP_BINARY_OP_INPLACE_ADD) {
+        return MP_OBJ_NULL; // op not supported
+    }
+    stringbuilder_add_obj(MP_OBJ_TO_PTR(lhs_in), rhs_in);
+    return lhs_in;
+}
+
+STATIC mp_obj_t mp_micropython_stringbuilder_write(mp_obj_t self_in, mp_obj_t arg) {
+    mp_obj_stringbuilder_t *self = MP_OBJ_TO_PTR(self_in);
+    size_t len = self->vstr.len;
+    stringbuilder_add_obj(self, arg);
+    return MP_OBJ_NEW_SMALL_INT(self->vstr.len - len);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(mp_micropython_stringbuilder_write_obj, mp_micropython_stringbuilder_write);
+
+// The builder's buffer becomes the data of the returned object, without
+// being copied, and the builder starts again empty.
+STATIC mp_obj_t mp_micropython_stringbuilder_getvalue(mp_obj_t self_in) {
+    mp_obj_stringbuilder_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_obj_t value = mp_obj_new_str_from_vstr(self->value_type, &self->vstr);
+    self->vstr.len = 0;
+    return value;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mp_micropython_stringbuilder_getvalue_obj, mp_micropython_stringbuilder_getvalue);
+
+STATIC mp_uint_t mp_micropython_stringbuilder_stream_write(mp_obj_t self_in, const void *buf, mp_uint_t size, int *errcode) {
+    (void)errcode;
+    stringbuilder_add(MP_OBJ_TO_PTR(self_in), buf, size);
+    return size;
+}
+
+STATIC const mp_stream_p_t mp_micropython_stringbuilder_stream_p = {
+    .write = mp_micropython_stringbuilder_stream_write,
+    .is_text = true,
+};
+
+STATIC const mp_rom_map_elem_t mp_micropython_stringbuilder_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_write), MP_ROM_PTR(&mp_micropython_stringbuilder_write_obj) },
+    { MP_ROM_QSTR(MP_QSTR_getvalue), MP_ROM_PTR(&mp_micropython_stringbuilder_getvalue_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(mp_micropython_stringbuilder_locals_dict, mp_micropython_stringbuilder_locals_dict_table);
+
+STATIC const mp_obj_type_t mp_micropython_stringbuilder_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_StringBuilder,
+    .make_new = mp_micropython_stringbuilder_make_new,
+    .unary_op = mp_micropython_stringbuilder_unary_op,
+    .binary_op = mp_micropython_stringbuilder_binary_op,
+    .protocol = &mp_micropython_stringbuilder_stream_p,
+    .locals_dict = (mp_obj_dict_t *)&mp_micropython_stringbuilder_locals_dict,
+};
+#endif
+
+#if MICROPY_GC_ALLOC_PROFILE
+STATIC mp_obj_t mp_micropython_alloc_profile(size_t n_args, const mp_obj_t *args) {
+    bool reset = n_args > 0 && mp_obj_is_true(args[0]);
+    mp_gc_alloc_profile_entry_t *entries = m_new(mp_gc_alloc_profile_entry_t, MICROPY_GC_ALLOC_PROFILE_SIZE);
+    size_t len = gc_alloc_profile(entries, reset);
+    mp_obj_t list = mp_obj_new_list(len, NULL);
+    for (size_t i = 0; i < len; ++i) {
+        mp_obj_t tuple[5] = {
+            MP_OBJ_NEW_QSTR(entries[i].source_file),
+            MP_OBJ_NEW_SMALL_INT(entries[i].source_line),
+            MP_OBJ_NEW_QSTR(entries[i].block_name),
+            mp_obj_new_int_from_uint(entries[i].count),
+            mp_obj_new_int_from_uint(entries[i].n_bytes),
+        };
+        mp_obj_list_store(list, MP_OBJ_NEW_SMALL_INT(i), mp_obj_new_tuple(5, tuple));
+    }
+    m_del(mp_gc_alloc_profile_entry_t, entries, MICROPY_GC_ALLOC_PROFILE_SIZE);
+    return list;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp_micropython_alloc_profile_obj, 0, 1, mp_micropython_alloc_profile);
+#endif
+
+#if MICROPY_SAMPLING_PROFILE
+STATIC mp_obj_t mp_micropython_profile_start(size_t n_args, const mp_obj_t *args) {
+    mp_int_t period = n_args > 0 ? mp_obj_get_int(args[0]) : 1;
+    if (period < 1 || period > 0xffff) {
+        mp_raise_ValueError(NULL);
+    }
+    mp_prof_sample_start(period);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp_micropython_profile_start_obj, 0, 1, mp_micropython_profile_start);
+
+STATIC mp_obj_t mp_micropython_profile_stop(void) {
+    mp_prof_sample_stop();
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(mp_micropython_profile_stop_obj, mp_micropython_profile_stop);
+
+STATIC mp_obj_t mp_micropython_profile_dump(size_t n_args, const mp_obj_t *args) {
+    if (n_args == 0) {
+        mp_prof_sample_dump(MP_PYTHON_PRINTER);
+    } else {
+        mp_get_stream_raise(args[0], MP_STREAM_OP_WRITE);
+        mp_print_t print = {MP_OBJ_TO_PTR(args[0]), mp_stream_write_adaptor};
+        mp_prof_sample_dump(&print);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp_micropython_profile_dump_obj, 0, 1, mp_micropython_profile_dump);
+#endif
+
+#if MICROPY_VM_OPCODE_STATS
+STATIC mp_obj_t mp_micropython_vm_stats(size_t n_args, const mp_obj_t *args) {
+    if (n_args == 0 || args[0] == mp_const_none) {
+        mp_vm_stats_dump(MP_PYTHON_PRINTER);
+    } else {
+        mp_get_stream_raise(args[0], MP_STREAM_OP_WRITE);
+        mp_print_t print = {MP_OBJ_TO_PTR(args[0]), mp_stream_write_adaptor};
+        mp_vm_stats_dump(&print);
+    }
+    if (n_args > 1 && mp_obj_is_true(args[1])) {
+        mp_vm_stats_reset();
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp_micropython_vm_stats_obj, 0, 2, mp_micropython_vm_stats);
+#endif
+
+#if MICROPY_TRACE
+STATIC mp_obj_t mp_micropython_trace(size_t n_args, const mp_obj_t *args) {
+    if (n_args == 0) {
+        return mp_obj_new_bool(MP_STATE_VM(trace_enabled));
+    }
+    MP_STATE_VM(trace_enabled) = mp_obj_is_true(args[0]);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp_micropython_trace_obj, 0, 1, mp_micropython_trace);
+
+STATIC mp_obj_t mp_micropython_trace_mark(mp_obj_t arg_in) {
+    MP_TRACE(MP_TRACE_EVENT_MARK, mp_obj_get_int_truncated(arg_in));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mp_micropython_trace_mark_obj, mp_micropython_trace_mark);
+
+STATIC mp_obj_t mp_micropython_trace_dump(size_t n_args, const mp_obj_t *args) {
+    // events aren't recorded while the ring is read, so it's consistent
+    bool enabled = MP_STATE_VM(trace_enabled);
+    MP_STATE_VM(trace_enabled) = false;
+    vstr_t vstr;
+    vstr_init(&vstr, 12 + 8 * MICROPY_TRACE_SIZE);
+    mp_trace_dump(&vstr);
+    if (n_args > 1 && mp_obj_is_true(args[1])) {
+        mp_trace_reset();
+    }
+    MP_STATE_VM(trace_enabled) = enabled;
+    if (n_args == 0 || args[0] == mp_const_none) {
+        return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
+    }
+    int errcode;
+    mp_stream_rw(args[0], vstr.buf, vstr.len, &errcode, MP_STREAM_RW_WRITE);
+    vstr_clear(&vstr);
+    if (errcode != 0) {
+        mp_raise_OSError(errcode);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp_micropython_trace_dump_obj, 0, 2, mp_micropython_trace_dump);
+#endif
+
+#if MICROPY_VM_BUDGET
+STATIC mp_obj_t mp_micropython_vm_budget(size_t n_args, const mp_obj_t *args) {
+    if (n_args == 0) {
+        return mp_obj_new_int(mp_vm_budget_get());
+    }
+    mp_obj_t exc = n_args > 1 ? args[1] : MP_OBJ_NULL;
+    // a budget set by the script keeps the host's handler
+    mp_vm_budget_set(mp_obj_get_int(args[0]), exc, MP_STATE_VM(vm_budget_handler));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp_micropython_vm_budget_obj, 0, 2, mp_micropython_vm_budget);
+#endif
+
 #if MICROPY_ENABLE_EMERGENCY_EXCEPTION_BUF && (MICROPY_EMERGENCY_EXCEPTION_BUF_SIZE == 0)
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(mp_alloc_emergency_exception_buf_obj, mp_alloc_emergency_exception_buf);
 #endif
@@ -162,6 +519,23 @@ STATIC mp_obj_t mp_micropython_schedule(mp_obj_t function, mp_obj_t arg) {
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(mp_micropython_schedule_obj, mp_micropython_schedule);
+
+#if MICROPY_SCHEDULER_EVENT_DEPTH
+STATIC mp_obj_t mp_micropython_schedule_event(size_t n_args, const mp_obj_t *args) {
+    mp_int_t value = n_args > 2 ? mp_obj_get_int(args[2]) : 0;
+    return mp_obj_new_bool(mp_sched_event(args[0], args[1], value));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp_micropython_schedule_event_obj, 2, 3, mp_micropython_schedule_event);
+
+STATIC mp_obj_t mp_micropython_schedule_event_stats(void) {
+    mp_obj_t tuple[2] = {
+        MP_OBJ_NEW_SMALL_INT(mp_sched_num_events()),
+        mp_obj_new_int_from_uint(MP_STATE_VM(sched_event_overflow)),
+    };
+    return mp_obj_new_tuple(2, tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(mp_micropython_schedule_event_stats_obj, mp_micropython_schedule_event_stats);
+#endif
 #endif
 
 STATIC const mp_rom_map_elem_t mp_module_micropython_globals_table[] = {
@@ -169,6 +543,9 @@ STATIC const mp_rom_map_elem_t mp_module_micropython_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_const), MP_ROM_PTR(&mp_identity_obj) },
     #if MICROPY_ENABLE_COMPILER
     { MP_ROM_QSTR(MP_QSTR_opt_level), MP_ROM_PTR(&mp_micropython_opt_level_obj) },
+    #if MICROPY_MODULE_MPY_CACHE
+    { MP_ROM_QSTR(MP_QSTR_mpy_cache), MP_ROM_PTR(&mp_micropython_mpy_cache_obj) },
+    #endif
     #endif
     #if MICROPY_PY_MICROPYTHON_MEM_INFO
     #if MICROPY_MEM_STATS
@@ -179,6 +556,12 @@ STATIC const mp_rom_map_elem_t mp_module_micropython_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_mem_info), MP_ROM_PTR(&mp_micropython_mem_info_obj) },
     { MP_ROM_QSTR(MP_QSTR_qstr_info), MP_ROM_PTR(&mp_micropython_qstr_info_obj) },
     #endif
+    #if MICROPY_QSTR_SNAPSHOT
+    { MP_ROM_QSTR(MP_QSTR_qstr_snapshot), MP_ROM_PTR(&mp_micropython_qstr_snapshot_obj) },
+    #endif
+    #if MICROPY_HEAP_IMAGE
+    { MP_ROM_QSTR(MP_QSTR_heap_image_save), MP_ROM_PTR(&mp_micropython_heap_image_save_obj) },
+    #endif
     #if MICROPY_PY_MICROPYTHON_STACK_USE
     { MP_ROM_QSTR(MP_QSTR_stack_use), MP_ROM_PTR(&mp_micropython_stack_use_obj) },
     #endif
@@ -195,11 +578,43 @@ STATIC const mp_rom_map_elem_t mp_module_micropython_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_heap_locked), MP_ROM_PTR(&mp_micropython_heap_locked_obj) },
     #endif
     #endif
+    #if MICROPY_GC_ARENA
+    { MP_ROM_QSTR(MP_QSTR_arena), MP_ROM_PTR(&mp_micropython_arena_type) },
+    #endif
+    #if MICROPY_PY_MICROPYTHON_LIST_WITH_CAPACITY
+    { MP_ROM_QSTR(MP_QSTR_list_with_capacity), MP_ROM_PTR(&mp_micropython_list_with_capacity_obj) },
+    #endif
+    #if MICROPY_PY_MICROPYTHON_STRINGBUILDER
+    { MP_ROM_QSTR(MP_QSTR_StringBuilder), MP_ROM_PTR(&mp_micropython_stringbuilder_type) },
+    #endif
+    #if MICROPY_GC_ALLOC_PROFILE
+    { MP_ROM_QSTR(MP_QSTR_alloc_profile), MP_ROM_PTR(&mp_micropython_alloc_profile_obj) },
+    #endif
+    #if MICROPY_SAMPLING_PROFILE
+    { MP_ROM_QSTR(MP_QSTR_profile_start), MP_ROM_PTR(&mp_micropython_profile_start_obj) },
+    { MP_ROM_QSTR(MP_QSTR_profile_stop), MP_ROM_PTR(&mp_micropython_profile_stop_obj) },
+    { MP_ROM_QSTR(MP_QSTR_profile_dump), MP_ROM_PTR(&mp_micropython_profile_dump_obj) },
+    #endif
+    #if MICROPY_VM_OPCODE_STATS
+    { MP_ROM_QSTR(MP_QSTR_vm_stats), MP_ROM_PTR(&mp_micropython_vm_stats_obj) },
+    #endif
+    #if MICROPY_TRACE
+    { MP_ROM_QSTR(MP_QSTR_trace), MP_ROM_PTR(&mp_micropython_trace_obj) },
+    { MP_ROM_QSTR(MP_QSTR_trace_mark), MP_ROM_PTR(&mp_micropython_trace_mark_obj) },
+    { MP_ROM_QSTR(MP_QSTR_trace_dump), MP_ROM_PTR(&mp_micropython_trace_dump_obj) },
+    #endif
+    #if MICROPY_VM_BUDGET
+    { MP_ROM_QSTR(MP_QSTR_vm_budget), MP_ROM_PTR(&mp_micropython_vm_budget_obj) },
+    #endif
     #if MICROPY_KBD_EXCEPTION
     { MP_ROM_QSTR(MP_QSTR_kbd_intr), MP_ROM_PTR(&mp_micropython_kbd_intr_obj) },
     #endif
     #if MICROPY_ENABLE_SCHEDULER
     { MP_ROM_QSTR(MP_QSTR_schedule), MP_ROM_PTR(&mp_micropython_schedule_obj) },
+    #if MICROPY_SCHEDULER_EVENT_DEPTH
+    { MP_ROM_QSTR(MP_QSTR_schedule_event), MP_ROM_PTR(&mp_micropython_schedule_event_obj) },
+    { MP_ROM_QSTR(MP_QSTR_schedule_event_stats), MP_ROM_PTR(&mp_micropython_schedule_event_stats_obj) },
+    #endif
     #endif
 };
 
@@ -250,6 +250,236 @@ STATIC mp_obj_t struct_pack_into(size_t n_args, const mp_obj_t *args) {
 }
 MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(struct_pack_into_obj, 3, MP_OBJ_FUN_ARGS_MAX, struct_pack_into);
 
+#if MICROPY_PY_STRUCT_OBJECT
+
+// A Struct object holds its format already parsed, as a sequence of codes
+// each with a type char and repeat count, so that the format string isn't
+// walked again on each pack and unpack.
+
+typedef struct _struct_code_t {
+    mp_uint_t cnt; // repeat count, or length for 's'
+    char type;
+} struct_code_t;
+
+typedef struct _mp_obj_struct_t {
+    mp_obj_base_t base;
+    mp_obj_t format;
+    size_t size;
+    size_t num_items;
+    size_t num_codes;
+    char fmt_type;
+    struct_code_t codes[];
+} mp_obj_struct_t;
+
+typedef struct _mp_obj_struct_iter_t {
+    mp_obj_base_t base;
+    mp_fun_1_t iternext;
+    mp_obj_struct_t *st;
+    mp_obj_t buf;
+    size_t offset;
+} mp_obj_struct_iter_t;
+
+STATIC const mp_obj_type_t struct_type;
+
+STATIC mp_obj_t struct_obj_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 1, 1, false);
+    const char *fmt = mp_obj_str_get_str(args[0]);
+    size_t total_sz;
+    size_t num_items = calc_size_items(fmt, &total_sz);
+    char fmt_type = get_fmt_type(&fmt);
+
+    size_t num_codes = 0;
+    for (const char *f = fmt; *f; ++f) {
+        num_codes += !unichar_isdigit(*f);
+    }
+
+    mp_obj_struct_t *o = m_new_obj_var(mp_obj_struct_t, struct_code_t, num_codes);
+    o->base.type = type;
+    o->format = args[0];
+    o->size = total_sz;
+    o->num_items = num_items;
+    o->num_codes = num_codes;
+    o->fmt_type = fmt_type;
+    for (size_t i = 0; *fmt; fmt++) {
+        mp_uint_t cnt = 1;
+        if (unichar_isdigit(*fmt)) {
+            cnt = get_fmt_num(&fmt);
+        }
+        o->codes[i].cnt = cnt;
+        o->codes[i].type = *fmt;
+        ++i;
+    }
+    return MP_OBJ_FROM_PTR(o);
+}
+
+// Return a pointer into the buffer at offset, checking that size bytes fit there
+STATIC byte *struct_obj_get_buf(mp_obj_struct_t *self, mp_obj_t buf_in, mp_int_t offset, mp_uint_t flags) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, flags);
+    if (offset < 0) {
+        // negative offsets are relative to the end of the buffer
+        offset += bufinfo.len;
+    }
+    if (offset < 0 || (size_t)offset + self->size > bufinfo.len) {
+        mp_raise_ValueError(MP_ERROR_TEXT("buffer too small"));
+    }
+    return (byte *)bufinfo.buf + offset;
+}
+
+STATIC void struct_obj_unpack_internal(mp_obj_struct_t *self, byte *p, mp_obj_t *items) {
+    byte *p_base = p;
+    for (size_t i = 0; i < self->num_codes; ++i) {
+        const struct_code_t *c = &self->codes[i];
+        if (c->type == 's') {
+            *items++ = mp_obj_new_bytes(p, c->cnt);
+            p += c->cnt;
+        } else {
+            for (mp_uint_t cnt = c->cnt; cnt > 0; --cnt) {
+                *items++ = mp_binary_get_val(self->fmt_type, c->type, p_base, &p);
+            }
+        }
+    }
+}
+
+// This function assumes there is enough room in p to store all the values, and
+// like struct_pack_into_internal it stops at whichever of the format and the
+// arguments runs out first
+STATIC void struct_obj_pack_internal(mp_obj_struct_t *self, byte *p, size_t n_args, const mp_obj_t *args) {
+    byte *p_base = p;
+    size_t i = 0;
+    for (size_t j = 0; j < self->num_codes && i < n_args; ++j) {
+        const struct_code_t *c = &self->codes[j];
+        if (c->type == 's') {
+            mp_buffer_info_t bufinfo;
+            mp_get_buffer_raise(args[i++], &bufinfo, MP_BUFFER_READ);
+            mp_uint_t to_copy = MIN(c->cnt, bufinfo.len);
+            memcpy(p, bufinfo.buf, to_copy);
+            memset(p + to_copy, 0, c->cnt - to_copy);
+            p += c->cnt;
+        } else {
+            for (mp_uint_t cnt = c->cnt; cnt > 0 && i < n_args; --cnt) {
+                mp_binary_set_val(self->fmt_type, c->type, args[i++], p_base, &p);
+            }
+        }
+    }
+}
+
+STATIC mp_obj_t struct_obj_pack(size_t n_args, const mp_obj_t *args) {
+    mp_obj_struct_t *self = MP_OBJ_TO_PTR(args[0]);
+    vstr_t vstr;
+    vstr_init_len(&vstr, self->size);
+    memset(vstr.buf, 0, self->size);
+    struct_obj_pack_internal(self, (byte *)vstr.buf, n_args - 1, &args[1]);
+    return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(struct_obj_pack_obj, 1, MP_OBJ_FUN_ARGS_MAX, struct_obj_pack);
+
+STATIC mp_obj_t struct_obj_pack_into(size_t n_args, const mp_obj_t *args) {
+    mp_obj_struct_t *self = MP_OBJ_TO_PTR(args[0]);
+    byte *p = struct_obj_get_buf(self, args[1], mp_obj_get_int(args[2]), MP_BUFFER_WRITE);
+    struct_obj_pack_internal(self, p, n_args - 3, &args[3]);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(struct_obj_pack_into_obj, 3, MP_OBJ_FUN_ARGS_MAX, struct_obj_pack_into);
+
+// Struct.unpack_from(buffer, offset=0, out=None)
+// If out is given it must be a list with one element per value, and the values
+// are stored there instead of in a new tuple.
+STATIC mp_obj_t struct_obj_unpack_from(size_t n_args, const mp_obj_t *args) {
+    mp_obj_struct_t *self = MP_OBJ_TO_PTR(args[0]);
+    mp_int_t offset = 0;
+    if (n_args > 2) {
+        offset = mp_obj_get_int(args[2]);
+    }
+    byte *p = struct_obj_get_buf(self, args[1], offset, MP_BUFFER_READ);
+    mp_obj_t res;
+    size_t len;
+    mp_obj_t *items;
+    if (n_args > 3 && args[3] != mp_const_none) {
+        if (!mp_obj_is_type(args[3], &mp_type_list)) {
+            mp_raise_TypeError(NULL);
+        }
+        res = args[3];
+        mp_obj_list_get(res, &len, &items);
+        if (len != self->num_items) {
+            mp_raise_ValueError(MP_ERROR_TEXT("wrong number of items"));
+        }
+    } else {
+        res = mp_obj_new_tuple(self->num_items, NULL);
+        mp_obj_tuple_get(res, &len, &items);
+    }
+    struct_obj_unpack_internal(self, p, items);
+    return res;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(struct_obj_unpack_from_obj, 2, 4, struct_obj_unpack_from);
+
+STATIC mp_obj_t struct_obj_iter_unpack_iternext(mp_obj_t self_in) {
+    mp_obj_struct_iter_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(self->buf, &bufinfo, MP_BUFFER_READ);
+    if (self->offset + self->st->size > bufinfo.len) {
+        return MP_OBJ_STOP_ITERATION;
+    }
+    mp_obj_tuple_t *res = MP_OBJ_TO_PTR(mp_obj_new_tuple(self->st->num_items, NULL));
+    struct_obj_unpack_internal(self->st, (byte *)bufinfo.buf + self->offset, res->items);
+    self->offset += self->st->size;
+    return MP_OBJ_FROM_PTR(res);
+}
+
+STATIC mp_obj_t struct_obj_iter_unpack(mp_obj_t self_in, mp_obj_t buf_in) {
+    mp_obj_struct_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_READ);
+    if (self->size == 0 || bufinfo.len % self->size != 0) {
+        mp_raise_ValueError(MP_ERROR_TEXT("buffer size must be a multiple of struct size"));
+    }
+    mp_obj_struct_iter_t *o = m_new_obj(mp_obj_struct_iter_t);
+    o->base.type = &mp_type_polymorph_iter;
+    o->iternext = struct_obj_iter_unpack_iternext;
+    o->st = self;
+    o->buf = buf_in;
+    o->offset = 0;
+    return MP_OBJ_FROM_PTR(o);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(struct_obj_iter_unpack_obj, struct_obj_iter_unpack);
+
+STATIC const mp_rom_map_elem_t struct_obj_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_pack), MP_ROM_PTR(&struct_obj_pack_obj) },
+    { MP_ROM_QSTR(MP_QSTR_pack_into), MP_ROM_PTR(&struct_obj_pack_into_obj) },
+    { MP_ROM_QSTR(MP_QSTR_unpack), MP_ROM_PTR(&struct_obj_unpack_from_obj) },
+    { MP_ROM_QSTR(MP_QSTR_unpack_from), MP_ROM_PTR(&struct_obj_unpack_from_obj) },
+    { MP_ROM_QSTR(MP_QSTR_iter_unpack), MP_ROM_PTR(&struct_obj_iter_unpack_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(struct_obj_locals_dict, struct_obj_locals_dict_table);
+
+STATIC void struct_obj_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest) {
+    if (dest[0] != MP_OBJ_NULL) {
+        // can't store or delete attributes
+        return;
+    }
+    mp_obj_struct_t *self = MP_OBJ_TO_PTR(self_in);
+    if (attr == MP_QSTR_size) {
+        dest[0] = MP_OBJ_NEW_SMALL_INT(self->size);
+    } else if (attr == MP_QSTR_format) {
+        dest[0] = self->format;
+    } else {
+        // methods
+        mp_map_elem_t *elem = mp_map_lookup((mp_map_t *)&struct_obj_locals_dict.map, MP_OBJ_NEW_QSTR(attr), MP_MAP_LOOKUP);
+        if (elem != NULL) {
+            mp_convert_member_lookup(self_in, &struct_type, elem->value, dest);
+        }
+    }
+}
+
+STATIC const mp_obj_type_t struct_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_Struct,
+    .make_new = struct_obj_make_new,
+    .attr = struct_obj_attr,
+};
+
+#endif // MICROPY_PY_STRUCT_OBJECT
+
 STATIC const mp_rom_map_elem_t mp_module_struct_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_ustruct) },
     { MP_ROM_QSTR(MP_QSTR_calcsize), MP_ROM_PTR(&struct_calcsize_obj) },
@@ -257,6 +487,9 @@ STATIC const mp_rom_map_elem_t mp_module_struct_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_pack_into), MP_ROM_PTR(&struct_pack_into_obj) },
     { MP_ROM_QSTR(MP_QSTR_unpack), MP_ROM_PTR(&struct_unpack_from_obj) },
     { MP_ROM_QSTR(MP_QSTR_unpack_from), MP_ROM_PTR(&struct_unpack_from_obj) },
+    #if MICROPY_PY_STRUCT_OBJECT
+    { MP_ROM_QSTR(MP_QSTR_Struct), MP_ROM_PTR(&struct_type) },
+    #endif
 };
 
 STATIC MP_DEFINE_CONST_DICT(mp_module_struct_globals, mp_module_struct_globals_table);
@@ -184,11 +184,34 @@ STATIC mp_obj_t mp_sys_settrace(mp_obj_t obj) {
 MP_DEFINE_CONST_FUN_OBJ_1(mp_sys_settrace_obj, mp_sys_settrace);
 #endif // MICROPY_PY_SYS_SETTRACE
 
+#if MICROPY_MULTIPLE_INSTANCES
+// These objects belong to the running instance, so can't be in the ROM table.
+STATIC mp_obj_t mp_sys_getattr(mp_obj_t attr) {
+    switch (MP_OBJ_QSTR_VALUE(attr)) {
+        case MP_QSTR_path:
+            return MP_OBJ_FROM_PTR(&MP_STATE_VM(mp_sys_path_obj));
+        case MP_QSTR_argv:
+            return MP_OBJ_FROM_PTR(&MP_STATE_VM(mp_sys_argv_obj));
+        #if MICROPY_PY_SYS_MODULES
+        case MP_QSTR_modules:
+            return MP_OBJ_FROM_PTR(&MP_STATE_VM(mp_loaded_modules_dict));
+        #endif
+        default:
+            return MP_OBJ_NULL;
+    }
+}
+MP_DEFINE_CONST_FUN_OBJ_1(mp_sys_getattr_obj, mp_sys_getattr);
+#endif
+
 STATIC const mp_rom_map_elem_t mp_module_sys_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_sys) },
 
+    #if MICROPY_MULTIPLE_INSTANCES
+    { MP_ROM_QSTR(MP_QSTR___getattr__), MP_ROM_PTR(&mp_sys_getattr_obj) },
+    #else
     { MP_ROM_QSTR(MP_QSTR_path), MP_ROM_PTR(&MP_STATE_VM(mp_sys_path_obj)) },
     { MP_ROM_QSTR(MP_QSTR_argv), MP_ROM_PTR(&MP_STATE_VM(mp_sys_argv_obj)) },
+    #endif
     { MP_ROM_QSTR(MP_QSTR_version), MP_ROM_PTR(&mp_sys_version_obj) },
     { MP_ROM_QSTR(MP_QSTR_version_info), MP_ROM_PTR(&mp_sys_version_info_obj) },
     { MP_ROM_QSTR(MP_QSTR_implementation), MP_ROM_PTR(&mp_sys_implementation_obj) },
@@ -228,7 +251,7 @@ STATIC const mp_rom_map_elem_t mp_module_sys_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_stderr), MP_ROM_PTR(&mp_sys_stderr_obj) },
     #endif
 
-    #if MICROPY_PY_SYS_MODULES
+    #if MICROPY_PY_SYS_MODULES && !MICROPY_MULTIPLE_INSTANCES
     { MP_ROM_QSTR(MP_QSTR_modules), MP_ROM_PTR(&MP_STATE_VM(mp_loaded_modules_dict)) },
     #endif
     #if MICROPY_PY_SYS_EXC_INFO
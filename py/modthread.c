@@ -29,6 +29,9 @@
 
 #include "py/runtime.h"
 #include "py/stackctrl.h"
+#include "py/stream.h"
+#include "py/mphal.h"
+#include "py/gc.h"
 
 #if MICROPY_PY_THREAD
 
@@ -42,6 +45,67 @@
 #define DEBUG_printf(...) (void)0
 #endif
 
+#if MICROPY_PY_THREAD_OBJ_LOCK
+
+/****************************************************************/
+// Object locks
+
+// These are spin locks: they are only held for short, non-blocking sections
+// that touch the storage of an object, so waiting is rare and brief.
+
+STATIC mp_thread_obj_lock_t *thread_obj_lock_get(const void *obj) {
+    uintptr_t addr = (uintptr_t)obj / MICROPY_BYTES_PER_GC_BLOCK;
+    return &MP_STATE_VM(thread_obj_lock)[(addr ^ (addr >> 6)) & (MICROPY_PY_THREAD_OBJ_LOCK_NUM - 1)];
+}
+
+size_t mp_thread_obj_lock(const void *obj) {
+    mp_thread_obj_lock_t *lock = thread_obj_lock_get(obj);
+    struct _mp_state_thread_t *ts = mp_thread_get_state();
+    if (lock->owner == ts) {
+        return lock->depth++;
+    }
+    for (;;) {
+        struct _mp_state_thread_t *expected = NULL;
+        if (__atomic_compare_exchange_n(&lock->owner, &expected, ts, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            break;
+        }
+        MICROPY_PY_THREAD_OBJ_LOCK_WAIT();
+    }
+    lock->depth = 1;
+    return 0;
+}
+
+void mp_thread_obj_unlock_to(const void *obj, size_t depth) {
+    mp_thread_obj_lock_t *lock = thread_obj_lock_get(obj);
+    if (lock->owner != mp_thread_get_state()) {
+        return;
+    }
+    lock->depth = depth;
+    if (depth == 0) {
+        __atomic_store_n(&lock->owner, NULL, __ATOMIC_RELEASE);
+    }
+}
+
+void mp_thread_obj_unlock(const void *obj) {
+    mp_thread_obj_unlock_to(obj, thread_obj_lock_get(obj)->depth - 1);
+}
+
+mp_obj_t mp_thread_obj_call_locked(const void *obj, mp_fun_var_t fun, size_t n_args, const mp_obj_t *args) {
+    size_t depth = mp_thread_obj_lock(obj);
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        mp_obj_t ret = fun(n_args, args);
+        nlr_pop();
+        mp_thread_obj_unlock_to(obj, depth);
+        return ret;
+    } else {
+        mp_thread_obj_unlock_to(obj, depth);
+        nlr_jump(nlr.ret_val);
+    }
+}
+
+#endif // MICROPY_PY_THREAD_OBJ_LOCK
+
 /****************************************************************/
 // Lock object
 
@@ -123,6 +187,359 @@ STATIC const mp_obj_type_t mp_type_thread_lock = {
     .locals_dict = (mp_obj_dict_t *)&thread_lock_locals_dict,
 };
 
+#if MICROPY_PY_THREAD_CHANNEL
+
+/****************************************************************/
+// Channel object
+
+// A ring of bytes holding messages, each a 2-byte length followed by the data.
+// One thread sends and one thread receives: the sender only writes head and
+// the receiver only writes tail, so neither needs a lock, and on ports
+// without a GIL the two can run truly in parallel on different cores.  Sending
+// and receiving copy data in and out of the ring and do not allocate.
+
+typedef struct _mp_obj_thread_channel_t {
+    mp_obj_base_t base;
+    uint32_t mask;
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    byte *buf;
+} mp_obj_thread_channel_t;
+
+STATIC void thread_channel_copy_in(mp_obj_thread_channel_t *self, uint32_t pos, const byte *src, size_t len) {
+    for (size_t i = 0; i < len; ++i) {
+        self->buf[(pos + i) & self->mask] = src[i];
+    }
+}
+
+STATIC void thread_channel_copy_out(mp_obj_thread_channel_t *self, uint32_t pos, byte *dest, size_t len) {
+    for (size_t i = 0; i < len; ++i) {
+        dest[i] = self->buf[(pos + i) & self->mask];
+    }
+}
+
+// Returns the length of the next message, or -1 if there is none.
+STATIC mp_int_t thread_channel_peek(mp_obj_thread_channel_t *self) {
+    uint32_t tail = self->tail;
+    if (self->head == tail) {
+        return -1;
+    }
+    __sync_synchronize();
+    byte hdr[2];
+    thread_channel_copy_out(self, tail, hdr, 2);
+    return hdr[0] | hdr[1] << 8;
+}
+
+STATIC void thread_channel_consume(mp_obj_thread_channel_t *self, byte *dest, size_t len) {
+    uint32_t tail = self->tail;
+    thread_channel_copy_out(self, tail + 2, dest, len);
+    // The data must be copied out before the sender can reuse its space.
+    __sync_synchronize();
+    self->tail = tail + 2 + len;
+}
+
+STATIC mp_obj_t thread_channel_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 1, 1, false);
+    mp_int_t size = mp_obj_get_int(args[0]);
+    if (size < 16 || size > 0x10000000) {
+        mp_raise_ValueError(NULL);
+    }
+    // Round the size up to a power of 2 so positions can be masked.
+    uint32_t capacity = 16;
+    while (capacity < (uint32_t)size) {
+        capacity <<= 1;
+    }
+    mp_obj_thread_channel_t *self = m_new_obj(mp_obj_thread_channel_t);
+    self->base.type = type;
+    self->mask = capacity - 1;
+    self->head = 0;
+    self->tail = 0;
+    self->buf = m_new(byte, capacity);
+    return MP_OBJ_FROM_PTR(self);
+}
+
+// Channel.send(buf): queue a copy of buf, returning False if there is no room.
+STATIC mp_obj_t thread_channel_send(mp_obj_t self_in, mp_obj_t buf_in) {
+    mp_obj_thread_channel_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_READ);
+    if (bufinfo.len > 0xffff || bufinfo.len + 2 > self->mask + 1) {
+        mp_raise_ValueError(MP_ERROR_TEXT("message too long"));
+    }
+    uint32_t head = self->head;
+    uint32_t free = self->mask + 1 - (head - self->tail);
+    if (bufinfo.len + 2 > free) {
+        return mp_const_false;
+    }
+    byte hdr[2] = { bufinfo.len & 0xff, bufinfo.len >> 8 };
+    thread_channel_copy_in(self, head, hdr, 2);
+    thread_channel_copy_in(self, head + 2, bufinfo.buf, bufinfo.len);
+    // The message must be complete before the receiver can see it.
+    __sync_synchronize();
+    self->head = head + 2 + bufinfo.len;
+    return mp_const_true;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(thread_channel_send_obj, thread_channel_send);
+
+// Channel.recv(): return the next message as bytes, or None if there is none.
+STATIC mp_obj_t thread_channel_recv(mp_obj_t self_in) {
+    mp_obj_thread_channel_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_int_t len = thread_channel_peek(self);
+    if (len < 0) {
+        return mp_const_none;
+    }
+    vstr_t vstr;
+    vstr_init_len(&vstr, len);
+    thread_channel_consume(self, (byte *)vstr.buf, len);
+    return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(thread_channel_recv_obj, thread_channel_recv);
+
+// Channel.recv_into(buf): copy the next message into buf and return its
+// length, or return None if there is none.
+STATIC mp_obj_t thread_channel_recv_into(mp_obj_t self_in, mp_obj_t buf_in) {
+    mp_obj_thread_channel_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_WRITE);
+    mp_int_t len = thread_channel_peek(self);
+    if (len < 0) {
+        return mp_const_none;
+    }
+    if ((size_t)len > bufinfo.len) {
+        // Leave the message in the channel so it can be read with a larger buffer.
+        mp_raise_ValueError(MP_ERROR_TEXT("buffer too small"));
+    }
+    thread_channel_consume(self, bufinfo.buf, len);
+    return MP_OBJ_NEW_SMALL_INT(len);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(thread_channel_recv_into_obj, thread_channel_recv_into);
+
+// Channel.any(): return the length of the next message, or -1 if there is none.
+STATIC mp_obj_t thread_channel_any(mp_obj_t self_in) {
+    return MP_OBJ_NEW_SMALL_INT(thread_channel_peek(MP_OBJ_TO_PTR(self_in)));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(thread_channel_any_obj, thread_channel_any);
+
+STATIC mp_uint_t thread_channel_ioctl(mp_obj_t self_in, mp_uint_t request, uintptr_t arg, int *errcode) {
+    mp_obj_thread_channel_t *self = MP_OBJ_TO_PTR(self_in);
+    if (request == MP_STREAM_POLL) {
+        mp_uint_t ret = 0;
+        if ((arg & MP_STREAM_POLL_RD) && self->head != self->tail) {
+            ret |= MP_STREAM_POLL_RD;
+        }
+        if ((arg & MP_STREAM_POLL_WR) && self->head - self->tail + 2 <= self->mask) {
+            // at least an empty message fits
+            ret |= MP_STREAM_POLL_WR;
+        }
+        return ret;
+    }
+    *errcode = MP_EINVAL;
+    return MP_STREAM_ERROR;
+}
+
+STATIC const mp_stream_p_t thread_channel_stream_p = {
+    .ioctl = thread_channel_ioctl,
+};
+
+STATIC const mp_rom_map_elem_t thread_channel_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_send), MP_ROM_PTR(&thread_channel_send_obj) },
+    { MP_ROM_QSTR(MP_QSTR_recv), MP_ROM_PTR(&thread_channel_recv_obj) },
+    { MP_ROM_QSTR(MP_QSTR_recv_into), MP_ROM_PTR(&thread_channel_recv_into_obj) },
+    { MP_ROM_QSTR(MP_QSTR_any), MP_ROM_PTR(&thread_channel_any_obj) },
+};
+
+STATIC MP_DEFINE_CONST_DICT(thread_channel_locals_dict, thread_channel_locals_dict_table);
+
+STATIC const mp_obj_type_t mp_type_thread_channel = {
+    { &mp_type_type },
+    .name = MP_QSTR_Channel,
+    .make_new = thread_channel_make_new,
+    .protocol = &thread_channel_stream_p,
+    .locals_dict = (mp_obj_dict_t *)&thread_channel_locals_dict,
+};
+
+#endif // MICROPY_PY_THREAD_CHANNEL
+
+#if MICROPY_PY_THREAD_QUEUE
+
+/****************************************************************/
+// Queue object
+
+// A ring of objects that any number of threads put to and get from.  The
+// mutex is only held while the ring is changed; a thread that has to wait
+// for an item or for room releases the GIL and polls, so it never blocks
+// other threads from using the queue.
+
+typedef struct _mp_obj_thread_queue_t {
+    mp_obj_base_t base;
+    mp_thread_mutex_t mutex;
+    size_t alloc;
+    size_t len;
+    size_t head; // index of the oldest item
+    mp_obj_t *items;
+} mp_obj_thread_queue_t;
+
+STATIC mp_obj_t thread_queue_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 1, 1, false);
+    mp_int_t maxsize = mp_obj_get_int(args[0]);
+    if (maxsize <= 0) {
+        mp_raise_ValueError(NULL);
+    }
+    mp_obj_thread_queue_t *self = m_new_obj(mp_obj_thread_queue_t);
+    self->base.type = type;
+    mp_thread_mutex_init(&self->mutex);
+    self->alloc = maxsize;
+    self->len = 0;
+    self->head = 0;
+    self->items = m_new0(mp_obj_t, maxsize);
+    return MP_OBJ_FROM_PTR(self);
+}
+
+// Try to put (if item is not MP_OBJ_NULL) or get an item, returning false if
+// the queue is full or empty.
+STATIC bool thread_queue_try(mp_obj_thread_queue_t *self, mp_obj_t *item) {
+    mp_thread_mutex_lock(&self->mutex, 1);
+    bool ok;
+    if (*item != MP_OBJ_NULL) {
+        ok = self->len < self->alloc;
+        if (ok) {
+            size_t i = self->head + self->len++;
+            self->items[i < self->alloc ? i : i - self->alloc] = *item;
+        }
+    } else {
+        ok = self->len > 0;
+        if (ok) {
+            *item = self->items[self->head];
+            // don't keep the item alive
+            self->items[self->head] = MP_OBJ_NULL;
+            self->head = self->head + 1 < self->alloc ? self->head + 1 : 0;
+            self->len -= 1;
+        }
+    }
+    mp_thread_mutex_unlock(&self->mutex);
+    return ok;
+}
+
+// Put or get an item, waiting for room or for an item if block is true, for
+// at most timeout seconds if timeout is not None.
+STATIC void thread_queue_wait(mp_obj_thread_queue_t *self, mp_obj_t *item, mp_obj_t block, mp_obj_t timeout) {
+    if (thread_queue_try(self, item)) {
+        return;
+    }
+    if (!mp_obj_is_true(block)) {
+        mp_raise_OSError(MP_EAGAIN);
+    }
+    mp_uint_t timeout_ms = 0;
+    if (timeout != mp_const_none) {
+        #if MICROPY_PY_BUILTINS_FLOAT
+        timeout_ms = (mp_uint_t)(mp_obj_get_float(timeout) * 1000);
+        #else
+        timeout_ms = mp_obj_get_int(timeout) * 1000;
+        #endif
+    }
+    mp_uint_t start = mp_hal_ticks_ms();
+    while (!thread_queue_try(self, item)) {
+        if (timeout != mp_const_none && mp_hal_ticks_ms() - start >= timeout_ms) {
+            mp_raise_OSError(MP_ETIMEDOUT);
+        }
+        #ifdef MICROPY_EVENT_POLL_HOOK
+        MICROPY_EVENT_POLL_HOOK
+        #else
+        MP_THREAD_GIL_EXIT();
+        MP_THREAD_GIL_ENTER();
+        #endif
+    }
+}
+
+// Queue.put(item, block=True, timeout=None)
+STATIC mp_obj_t thread_queue_put(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_item, ARG_block, ARG_timeout };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_item, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+        { MP_QSTR_block, MP_ARG_OBJ, {.u_rom_obj = MP_ROM_TRUE} },
+        { MP_QSTR_timeout, MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+    mp_obj_t item = args[ARG_item].u_obj;
+    thread_queue_wait(MP_OBJ_TO_PTR(pos_args[0]), &item, args[ARG_block].u_obj, args[ARG_timeout].u_obj);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(thread_queue_put_obj, 2, thread_queue_put);
+
+// Queue.get(block=True, timeout=None)
+STATIC mp_obj_t thread_queue_get(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_block, ARG_timeout };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_block, MP_ARG_OBJ, {.u_rom_obj = MP_ROM_TRUE} },
+        { MP_QSTR_timeout, MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+    mp_obj_t item = MP_OBJ_NULL;
+    thread_queue_wait(MP_OBJ_TO_PTR(pos_args[0]), &item, args[ARG_block].u_obj, args[ARG_timeout].u_obj);
+    return item;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(thread_queue_get_obj, 1, thread_queue_get);
+
+STATIC mp_obj_t thread_queue_qsize(mp_obj_t self_in) {
+    mp_obj_thread_queue_t *self = MP_OBJ_TO_PTR(self_in);
+    return MP_OBJ_NEW_SMALL_INT(self->len);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(thread_queue_qsize_obj, thread_queue_qsize);
+
+STATIC mp_obj_t thread_queue_empty(mp_obj_t self_in) {
+    mp_obj_thread_queue_t *self = MP_OBJ_TO_PTR(self_in);
+    return mp_obj_new_bool(self->len == 0);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(thread_queue_empty_obj, thread_queue_empty);
+
+STATIC mp_obj_t thread_queue_full(mp_obj_t self_in) {
+    mp_obj_thread_queue_t *self = MP_OBJ_TO_PTR(self_in);
+    return mp_obj_new_bool(self->len == self->alloc);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(thread_queue_full_obj, thread_queue_full);
+
+STATIC mp_uint_t thread_queue_ioctl(mp_obj_t self_in, mp_uint_t request, uintptr_t arg, int *errcode) {
+    mp_obj_thread_queue_t *self = MP_OBJ_TO_PTR(self_in);
+    if (request == MP_STREAM_POLL) {
+        mp_uint_t ret = 0;
+        if ((arg & MP_STREAM_POLL_RD) && self->len > 0) {
+            ret |= MP_STREAM_POLL_RD;
+        }
+        if ((arg & MP_STREAM_POLL_WR) && self->len < self->alloc) {
+            ret |= MP_STREAM_POLL_WR;
+        }
+        return ret;
+    }
+    *errcode = MP_EINVAL;
+    return MP_STREAM_ERROR;
+}
+
+STATIC const mp_stream_p_t thread_queue_stream_p = {
+    .ioctl = thread_queue_ioctl,
+};
+
+STATIC const mp_rom_map_elem_t thread_queue_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_put), MP_ROM_PTR(&thread_queue_put_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get), MP_ROM_PTR(&thread_queue_get_obj) },
+    { MP_ROM_QSTR(MP_QSTR_qsize), MP_ROM_PTR(&thread_queue_qsize_obj) },
+    { MP_ROM_QSTR(MP_QSTR_empty), MP_ROM_PTR(&thread_queue_empty_obj) },
+    { MP_ROM_QSTR(MP_QSTR_full), MP_ROM_PTR(&thread_queue_full_obj) },
+};
+
+STATIC MP_DEFINE_CONST_DICT(thread_queue_locals_dict, thread_queue_locals_dict_table);
+
+STATIC const mp_obj_type_t mp_type_thread_queue = {
+    { &mp_type_type },
+    .name = MP_QSTR_Queue,
+    .make_new = thread_queue_make_new,
+    .protocol = &thread_queue_stream_p,
+    .locals_dict = (mp_obj_dict_t *)&thread_queue_locals_dict,
+};
+
+#endif // MICROPY_PY_THREAD_QUEUE
+
 /****************************************************************/
 // _thread module
 
@@ -148,6 +565,9 @@ typedef struct _thread_entry_args_t {
     mp_obj_dict_t *dict_locals;
     mp_obj_dict_t *dict_globals;
     size_t stack_size;
+    #if MICROPY_ENABLE_PYSTACK
+    byte *pystack;
+    #endif
     mp_obj_t fun;
     size_t n_args;
     size_t n_kw;
@@ -166,14 +586,30 @@ STATIC void *thread_entry(void *args_in) {
     mp_stack_set_limit(args->stack_size);
 
     #if MICROPY_ENABLE_PYSTACK
-    // TODO threading and pystack is not fully supported, for now just make a small stack
-    mp_obj_t mini_pystack[128];
-    mp_pystack_init(mini_pystack, &mini_pystack[128]);
+    // The pystack is allocated by the parent and kept alive by args
+    mp_pystack_init(args->pystack, args->pystack + MICROPY_PYSTACK_THREAD_SIZE);
     #endif
 
     // The GC starts off unlocked on this thread.
     ts.gc_lock_depth = 0;
 
+    #if MICROPY_GC_ARENA
+    // No arena is active on a new thread.
+    ts.gc_arena = NULL;
+    ts.gc_arena_suspended = false;
+    #endif
+
+    #if MICROPY_GC_TLAB
+    // The allocation buffer is claimed on the first allocation.
+    ts.gc_tlab.cur = NULL;
+    ts.gc_tlab.end = NULL;
+    #endif
+
+    #if MICROPY_TRACK_CODE_STATE
+    // No function is running yet on a new thread.
+    ts.current_code_state = NULL;
+    #endif
+
     // set locals and globals from the calling context
     mp_locals_set(args->dict_locals);
     mp_globals_set(args->dict_globals);
@@ -210,6 +646,10 @@ STATIC void *thread_entry(void *args_in) {
 
     DEBUG_printf("[thread] finish ts=%p\n", &ts);
 
+    #if MICROPY_GC_TLAB
+    gc_tlab_release();
+    #endif
+
     // signal that we are finished
     mp_thread_finish();
 
@@ -218,7 +658,22 @@ STATIC void *thread_entry(void *args_in) {
     return NULL;
 }
 
-STATIC mp_obj_t mod_thread_start_new_thread(size_t n_args, const mp_obj_t *args) {
+// start_new_thread(function, args, kwargs=None, *, stack_size=None, priority=-1, core=-1)
+STATIC mp_obj_t mod_thread_start_new_thread(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_function, ARG_args, ARG_kwargs, ARG_stack_size, ARG_priority, ARG_core };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_function, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+        { MP_QSTR_args, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+        { MP_QSTR_kwargs, MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+        { MP_QSTR_stack_size, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+        #if MICROPY_PY_THREAD_CREATE_EX
+        { MP_QSTR_priority, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = -1} },
+        { MP_QSTR_core, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = -1} },
+        #endif
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
     // This structure holds the Python function and arguments for thread entry.
     // We copy all arguments into this structure to keep ownership of them.
     // We must be very careful about root pointers because this pointer may
@@ -228,19 +683,19 @@ STATIC mp_obj_t mod_thread_start_new_thread(size_t n_args, const mp_obj_t *args)
     // get positional arguments
     size_t pos_args_len;
     mp_obj_t *pos_args_items;
-    mp_obj_get_array(args[1], &pos_args_len, &pos_args_items);
+    mp_obj_get_array(args[ARG_args].u_obj, &pos_args_len, &pos_args_items);
 
     // check for keyword arguments
-    if (n_args == 2) {
+    if (args[ARG_kwargs].u_obj == mp_const_none) {
         // just position arguments
         th_args = m_new_obj_var(thread_entry_args_t, mp_obj_t, pos_args_len);
         th_args->n_kw = 0;
     } else {
         // positional and keyword arguments
-        if (mp_obj_get_type(args[2]) != &mp_type_dict) {
+        if (mp_obj_get_type(args[ARG_kwargs].u_obj) != &mp_type_dict) {
             mp_raise_TypeError(MP_ERROR_TEXT("expecting a dict for keyword args"));
         }
-        mp_map_t *map = &((mp_obj_dict_t *)MP_OBJ_TO_PTR(args[2]))->map;
+        mp_map_t *map = &((mp_obj_dict_t *)MP_OBJ_TO_PTR(args[ARG_kwargs].u_obj))->map;
         th_args = m_new_obj_var(thread_entry_args_t, mp_obj_t, pos_args_len + 2 * map->used);
         th_args->n_kw = map->used;
         // copy across the keyword arguments
@@ -261,17 +716,30 @@ STATIC mp_obj_t mod_thread_start_new_thread(size_t n_args, const mp_obj_t *args)
     th_args->dict_globals = mp_globals_get();
 
     // set the stack size to use
-    th_args->stack_size = thread_stack_size;
+    if (args[ARG_stack_size].u_obj == mp_const_none) {
+        th_args->stack_size = thread_stack_size;
+    } else {
+        th_args->stack_size = mp_obj_get_int(args[ARG_stack_size].u_obj);
+    }
+
+    #if MICROPY_ENABLE_PYSTACK
+    // allocate the pystack here, so that failing to do so is raised to the caller
+    th_args->pystack = m_new(byte, MICROPY_PYSTACK_THREAD_SIZE);
+    #endif
 
     // set the function for thread entry
-    th_args->fun = args[0];
+    th_args->fun = args[ARG_function].u_obj;
 
     // spawn the thread!
+    #if MICROPY_PY_THREAD_CREATE_EX
+    mp_thread_create_ex(thread_entry, th_args, &th_args->stack_size, args[ARG_priority].u_int, args[ARG_core].u_int);
+    #else
     mp_thread_create(thread_entry, th_args, &th_args->stack_size);
+    #endif
 
     return mp_const_none;
 }
-STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_thread_start_new_thread_obj, 2, 3, mod_thread_start_new_thread);
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mod_thread_start_new_thread_obj, 2, mod_thread_start_new_thread);
 
 STATIC mp_obj_t mod_thread_exit(void) {
     mp_raise_type(&mp_type_SystemExit);
@@ -291,6 +759,12 @@ STATIC const mp_rom_map_elem_t mp_module_thread_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_start_new_thread), MP_ROM_PTR(&mod_thread_start_new_thread_obj) },
     { MP_ROM_QSTR(MP_QSTR_exit), MP_ROM_PTR(&mod_thread_exit_obj) },
     { MP_ROM_QSTR(MP_QSTR_allocate_lock), MP_ROM_PTR(&mod_thread_allocate_lock_obj) },
+    #if MICROPY_PY_THREAD_CHANNEL
+    { MP_ROM_QSTR(MP_QSTR_Channel), MP_ROM_PTR(&mp_type_thread_channel) },
+    #endif
+    #if MICROPY_PY_THREAD_QUEUE
+    { MP_ROM_QSTR(MP_QSTR_Queue), MP_ROM_PTR(&mp_type_thread_queue) },
+    #endif
 };
 
 STATIC MP_DEFINE_CONST_DICT(mp_module_thread_globals, mp_module_thread_globals_table);
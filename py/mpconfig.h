@@ -159,6 +159,206 @@
 #define MICROPY_GC_ALLOC_THRESHOLD (1)
 #endif
 
+// Keep a history of the collections, their pauses and the amount allocated
+// between them, for gc.stats().  Costs a couple of counter updates per
+// allocation and a timer read at each end of a collection.
+#ifndef MICROPY_GC_STATS
+#define MICROPY_GC_STATS (0)
+#endif
+
+// Support generational GC: blocks that survive a collection are promoted to an
+// old generation, and automatic collections first try a cheaper minor
+// collection which only marks and sweeps the young generation.  Costs 2 bits of
+// heap per GC block for the generation and remembered tables, and requires C
+// code that stores references into existing heap blocks to use
+// MP_GC_WRITE_BARRIER, as for MICROPY_GC_INCREMENTAL.
+#ifndef MICROPY_GC_GENERATIONAL
+#define MICROPY_GC_GENERATIONAL (0)
+#endif
+
+// Maximum number of consecutive automatic minor collections before a major
+// (full) collection is done to reclaim garbage in the old generation.
+#ifndef MICROPY_GC_GENERATIONAL_MAJOR_INTERVAL
+#define MICROPY_GC_GENERATIONAL_MAJOR_INTERVAL (8)
+#endif
+
+// Support incremental GC: gc.collect(budget_us=...) marks the heap in
+// time-bounded steps, with the remaining steps done from mp_handle_pending.
+// Requires mp_hal_ticks_us(), costs 1 bit of heap per GC block for the dirty
+// table, and requires C code that stores references into existing heap blocks
+// to use MP_GC_WRITE_BARRIER (this is done by the core container types).
+#ifndef MICROPY_GC_INCREMENTAL
+#define MICROPY_GC_INCREMENTAL (0)
+#endif
+
+// Time budget in microseconds of each incremental GC step done by mp_handle_pending.
+#ifndef MICROPY_GC_INCREMENTAL_STEP_US
+#define MICROPY_GC_INCREMENTAL_STEP_US (500)
+#endif
+
+// Support size-class free lists in the GC: free runs of 1, 2, 3, 4 and at least
+// 8 blocks are cached when they are swept or freed, so most small allocations
+// don't need to scan the allocation table.
+#ifndef MICROPY_GC_SIZE_CLASSES
+#define MICROPY_GC_SIZE_CLASSES (0)
+#endif
+
+// Number of free runs cached for each GC size class.
+#ifndef MICROPY_GC_SIZE_CLASS_DEPTH
+#define MICROPY_GC_SIZE_CLASS_DEPTH (16)
+#endif
+
+// Whether to keep objects of some types found dead by the GC, by their size in
+// blocks, so that a new object of the same type and size reuses one instead of
+// being allocated.  Generators, coroutines and uasyncio tasks are pooled, which
+// cuts the allocations and fragmentation of programs that start many short
+// lived tasks.
+#ifndef MICROPY_GC_POOL
+#define MICROPY_GC_POOL (0)
+#endif
+
+// Largest object, in blocks, kept by the GC pool.
+#ifndef MICROPY_GC_POOL_MAX_BLOCKS
+#define MICROPY_GC_POOL_MAX_BLOCKS (16)
+#endif
+
+// Number of objects of each size kept by the GC pool after a collection.
+#ifndef MICROPY_GC_POOL_DEPTH
+#define MICROPY_GC_POOL_DEPTH (8)
+#endif
+
+// Number of types whose objects can be kept by the GC pool.
+#ifndef MICROPY_GC_POOL_TYPES
+#define MICROPY_GC_POOL_TYPES (4)
+#endif
+
+// Support a GC heap made of multiple discontiguous regions: after gc_init the
+// port can call gc_add_region for each additional area of RAM, for example
+// external PSRAM or SDRAM next to internal SRAM.
+#ifndef MICROPY_GC_SPLIT_HEAP
+#define MICROPY_GC_SPLIT_HEAP (0)
+#endif
+
+// Allocations of at least this many bytes prefer regions added with
+// GC_REGION_FLAG_LARGE, smaller ones prefer the other regions.
+#ifndef MICROPY_GC_REGION_LARGE_THRESHOLD
+#define MICROPY_GC_REGION_LARGE_THRESHOLD (1024)
+#endif
+
+// If non-zero, regions added with GC_REGION_FLAG_LARGE are divided into pages
+// of this many blocks (a multiple of 4), and an allocation there of at least
+// MICROPY_GC_REGION_LARGE_THRESHOLD bytes takes whole pages.  Big buffers then
+// don't leave small holes in these regions when they are freed.
+#ifndef MICROPY_GC_LARGE_PAGE_BLOCKS
+#define MICROPY_GC_LARGE_PAGE_BLOCKS (0)
+#endif
+
+// Support allocations flagged as holding no pointers to the heap, which the
+// GC doesn't scan when marking.  The data of bytearray, array, str and bytes
+// objects is allocated this way (see m_malloc_no_scan), so big buffers of
+// bytes take no time to mark and can't keep dead objects alive by chance.
+#ifndef MICROPY_GC_NO_SCAN
+#define MICROPY_GC_NO_SCAN (0)
+#endif
+
+// Support marking of the heap by two cores in parallel during a full (not
+// incremental) collection, with the work shared through a pool of blocks.
+// The port must provide gc_parallel_helper_start, gc_parallel_lock and
+// gc_parallel_unlock (see py/gc.h), and must only start the helper when no
+// other thread can modify the heap.
+#ifndef MICROPY_GC_PARALLEL_MARK
+#define MICROPY_GC_PARALLEL_MARK (0)
+#endif
+
+// Support allocation arenas: while an arena is active on a thread, that
+// thread's allocations are bump-allocated from a single heap block, which is
+// released as a whole when the arena ends (see gc_arena_begin).
+#ifndef MICROPY_GC_ARENA
+#define MICROPY_GC_ARENA (0)
+#endif
+
+// Give each thread a small buffer of free blocks claimed from the heap, from
+// which it allocates one-block objects without taking the GC lock.  Only has
+// an effect when threads run without a GIL.
+#ifndef MICROPY_GC_TLAB
+#define MICROPY_GC_TLAB (0)
+#endif
+
+// Number of blocks claimed at a time for a thread's allocation buffer.
+#ifndef MICROPY_GC_TLAB_BLOCKS
+#define MICROPY_GC_TLAB_BLOCKS (16)
+#endif
+
+// Whether ending an arena checks that nothing outside it still refers to
+// memory inside it.  This needs a full collection, so is only done by default
+// in builds with assertions enabled.
+#ifndef MICROPY_GC_ARENA_CHECK
+#ifdef NDEBUG
+#define MICROPY_GC_ARENA_CHECK (0)
+#else
+#define MICROPY_GC_ARENA_CHECK (MICROPY_GC_ARENA)
+#endif
+#endif
+
+// Support compaction of the heap with gc_compact, which moves the data of
+// bytearray, array, bytes and str objects into free memory lower down when
+// nothing but the object itself refers to the data.
+#ifndef MICROPY_GC_COMPACT
+#define MICROPY_GC_COMPACT (0)
+#endif
+
+// Maximum number of buffers considered for moving by one gc_compact call.
+#ifndef MICROPY_GC_COMPACT_MAX_MOVES
+#define MICROPY_GC_COMPACT_MAX_MOVES (32)
+#endif
+
+// Support sampling of allocations by the source line of the bytecode that
+// made them, to find out where a program allocates (see gc_alloc_profile).
+#ifndef MICROPY_GC_ALLOC_PROFILE
+#define MICROPY_GC_ALLOC_PROFILE (0)
+#endif
+
+// Maximum number of distinct source lines kept by the allocation profile.
+#ifndef MICROPY_GC_ALLOC_PROFILE_SIZE
+#define MICROPY_GC_ALLOC_PROFILE_SIZE (32)
+#endif
+
+// The allocation profile records about one in this many allocations, at
+// random intervals.
+#ifndef MICROPY_GC_ALLOC_PROFILE_PERIOD
+#define MICROPY_GC_ALLOC_PROFILE_PERIOD (8)
+#endif
+
+// Support a statistical profiler (micropython.profile_start) which counts the
+// stacks of bytecode functions seen by a port's timer interrupt, that calls
+// mp_prof_sample_tick.  It costs much less than sys.settrace.
+#ifndef MICROPY_SAMPLING_PROFILE
+#define MICROPY_SAMPLING_PROFILE (0)
+#endif
+
+// Maximum number of distinct stacks counted by the sampling profile.
+#ifndef MICROPY_SAMPLING_PROFILE_SIZE
+#define MICROPY_SAMPLING_PROFILE_SIZE (32)
+#endif
+
+// Maximum number of frames kept per stack; outer frames beyond this are cut.
+#ifndef MICROPY_SAMPLING_PROFILE_DEPTH
+#define MICROPY_SAMPLING_PROFILE_DEPTH (8)
+#endif
+
+// Hook to start (enable is true) or stop the timer calling mp_prof_sample_tick,
+// for ports that don't call it from a timer that always runs.
+#ifndef MICROPY_SAMPLING_PROFILE_TIMER
+#define MICROPY_SAMPLING_PROFILE_TIMER(enable)
+#endif
+
+// Support saving an image of the heap and the VM state (mp_heap_image_save),
+// which the same firmware can restore at startup instead of running the
+// imports again.  Requires the heap to be at the same address every boot.
+#ifndef MICROPY_HEAP_IMAGE
+#define MICROPY_HEAP_IMAGE (0)
+#endif
+
 // Number of bytes to allocate initially when creating new chunks to store
 // interned string data.  Smaller numbers lead to more chunks being needed
 // and more wastage at the end of the chunk.  Larger numbers lead to wasted
@@ -252,6 +452,21 @@
 #define MICROPY_QSTR_BYTES_IN_HASH (2)
 #endif
 
+// Whether to keep a hash index of all qstrs so that interning a string
+// doesn't need a linear search of every qstr pool.  The index is a table on
+// the heap that is rebuilt at twice the size when it gets half full, so uses
+// 2 to 4 words per qstr.
+#ifndef MICROPY_QSTR_HASH_INDEX
+#define MICROPY_QSTR_HASH_INDEX (0)
+#endif
+
+// Whether the interned strings created at runtime can be saved to a snapshot
+// with qstr_snapshot(), which the port can load at the next startup with
+// qstr_snapshot_load() so they don't have to be interned again
+#ifndef MICROPY_QSTR_SNAPSHOT
+#define MICROPY_QSTR_SNAPSHOT (0)
+#endif
+
 // Avoid using C stack when making Python function calls. C stack still
 // may be used if there's no free heap.
 #ifndef MICROPY_STACKLESS
@@ -283,6 +498,21 @@
 #define MICROPY_PERSISTENT_CODE_LOAD (0)
 #endif
 
+// Whether nested functions of an .mpy file that was saved with lazy loading
+// (mpy-cross -mlazy-load) are only loaded from the file when first used
+#ifndef MICROPY_PERSISTENT_CODE_LOAD_LAZY
+#define MICROPY_PERSISTENT_CODE_LOAD_LAZY (0)
+#endif
+
+// Whether str and bytes constants of an .mpy file that was saved with
+// null-terminated strings (mpy-cross -mmapped-str) refer to the file in place,
+// instead of being copied to the heap, when the file can be mapped into memory.
+// Requires MICROPY_READER_VFS and MICROPY_VFS_MMAP.  The mapping is kept for as
+// long as the program runs, so such a file must not be changed once imported
+#ifndef MICROPY_PERSISTENT_CODE_LOAD_MAPPED
+#define MICROPY_PERSISTENT_CODE_LOAD_MAPPED (0)
+#endif
+
 // Whether to support saving of persistent code
 #ifndef MICROPY_PERSISTENT_CODE_SAVE
 #define MICROPY_PERSISTENT_CODE_SAVE (0)
@@ -354,14 +584,24 @@
 #define MICROPY_EMIT_XTENSAWIN (0)
 #endif
 
+// Whether to emit RISC-V RV32 native code
+#ifndef MICROPY_EMIT_RV32
+#define MICROPY_EMIT_RV32 (0)
+#endif
+
+// Whether to enable the RISC-V RV32 inline assembler
+#ifndef MICROPY_EMIT_INLINE_RV32
+#define MICROPY_EMIT_INLINE_RV32 (0)
+#endif
+
 // Convenience definition for whether any native emitter is enabled
-#define MICROPY_EMIT_NATIVE (MICROPY_EMIT_X64 || MICROPY_EMIT_X86 || MICROPY_EMIT_THUMB || MICROPY_EMIT_ARM || MICROPY_EMIT_XTENSA || MICROPY_EMIT_XTENSAWIN)
+#define MICROPY_EMIT_NATIVE (MICROPY_EMIT_X64 || MICROPY_EMIT_X86 || MICROPY_EMIT_THUMB || MICROPY_EMIT_ARM || MICROPY_EMIT_XTENSA || MICROPY_EMIT_XTENSAWIN || MICROPY_EMIT_RV32)
 
 // Select prelude-as-bytes-object for certain emitters
 #define MICROPY_EMIT_NATIVE_PRELUDE_AS_BYTES_OBJ (MICROPY_EMIT_XTENSAWIN)
 
 // Convenience definition for whether any inline assembler emitter is enabled
-#define MICROPY_EMIT_INLINE_ASM (MICROPY_EMIT_INLINE_THUMB || MICROPY_EMIT_INLINE_XTENSA)
+#define MICROPY_EMIT_INLINE_ASM (MICROPY_EMIT_INLINE_THUMB || MICROPY_EMIT_INLINE_XTENSA || MICROPY_EMIT_INLINE_RV32)
 
 // Convenience definition for whether any native or inline assembler emitter is enabled
 #define MICROPY_EMIT_MACHINE_CODE (MICROPY_EMIT_NATIVE || MICROPY_EMIT_INLINE_ASM)
@@ -378,6 +618,17 @@
 #endif
 #endif
 
+// Whether bytecode functions that are called often, or that run many loop
+// iterations, are translated at runtime to native code with the native emitter
+#ifndef MICROPY_JIT
+#define MICROPY_JIT (0)
+#endif
+
+// Number of calls plus backward jumps after which a function is translated
+#ifndef MICROPY_JIT_THRESHOLD
+#define MICROPY_JIT_THRESHOLD (1000)
+#endif
+
 /*****************************************************************************/
 /* Compiler configuration                                                    */
 
@@ -406,6 +657,19 @@
 #define MICROPY_COMP_CONST_FOLDING (1)
 #endif
 
+// Whether to fold comparisons of integer constants, and conditional expressions
+// with a constant condition; eg 1 < 2 rewritten as True
+#ifndef MICROPY_COMP_CONST_FOLDING_COMPARE
+#define MICROPY_COMP_CONST_FOLDING_COMPARE (0)
+#endif
+
+// Whether to fold len() of a string, bytes or tuple of literals; eg len("ab")
+// rewritten as 2.  This is not compatible with CPython if a module or function
+// redefines len, so a port should only enable it for code known not to.
+#ifndef MICROPY_COMP_CONST_FOLDING_LEN
+#define MICROPY_COMP_CONST_FOLDING_LEN (0)
+#endif
+
 // Whether to enable optimisations for constant literals, eg OrderedDict
 #ifndef MICROPY_COMP_CONST_LITERAL
 #define MICROPY_COMP_CONST_LITERAL (1)
@@ -421,6 +685,12 @@
 #define MICROPY_COMP_CONST (1)
 #endif
 
+// Whether "from module import id" can use constants of another module that
+// were given to mp_parse_const_module; requires MICROPY_COMP_CONST
+#ifndef MICROPY_COMP_CONST_IMPORT
+#define MICROPY_COMP_CONST_IMPORT (0)
+#endif
+
 // Whether to enable optimisation of: a, b = c, d
 // Costs 124 bytes (Thumb2)
 #ifndef MICROPY_COMP_DOUBLE_TUPLE_ASSIGN
@@ -433,6 +703,14 @@
 #define MICROPY_COMP_TRIPLE_TUPLE_ASSIGN (0)
 #endif
 
+// Whether to compile a list, dict or set comprehension whose first for loop is
+// over range() like a for statement over range(), without a range object or
+// an iterator.  The same conditions apply, and the start and end of the range
+// are evaluated in the enclosing scope and passed to the comprehension.
+#ifndef MICROPY_COMP_RANGE_COMPREHENSION
+#define MICROPY_COMP_RANGE_COMPREHENSION (0)
+#endif
+
 // Whether to enable optimisation of: return a if b else c
 // Costs about 80 bytes (Thumb2) and saves 2 bytes of bytecode for each use
 #ifndef MICROPY_COMP_RETURN_IF_EXPR
@@ -479,6 +757,55 @@
 #define MICROPY_DEBUG_VM_STACK_OVERFLOW (0)
 #endif
 
+// Whether the VM counts the opcodes it dispatches, the pairs of consecutive
+// opcodes, and the binary ops by the types of their operands, for
+// micropython.vm_stats.  This disables the superinstructions and the small
+// int fast path, and slows down the VM.
+#ifndef MICROPY_VM_OPCODE_STATS
+#define MICROPY_VM_OPCODE_STATS (0)
+#endif
+
+// Maximum number of distinct opcode pairs counted.
+#ifndef MICROPY_VM_OPCODE_STATS_PAIRS
+#define MICROPY_VM_OPCODE_STATS_PAIRS (512)
+#endif
+
+// Maximum number of distinct binary op and operand type combinations counted.
+#ifndef MICROPY_VM_OPCODE_STATS_BINOPS
+#define MICROPY_VM_OPCODE_STATS_BINOPS (64)
+#endif
+
+// Whether to keep a ring of timestamped events (see py/trace.h), such as the
+// start and end of a garbage collection and the run of a scheduled function,
+// for micropython.trace_dump.  Recording an event while tracing is enabled
+// costs a timestamp and a few stores, and no lock.
+#ifndef MICROPY_TRACE
+#define MICROPY_TRACE (0)
+#endif
+
+// Number of events kept in the trace ring, must be a power of 2 up to 32768.
+#ifndef MICROPY_TRACE_SIZE
+#define MICROPY_TRACE_SIZE (256)
+#endif
+
+// Timestamp of a trace event, in microseconds.
+#ifndef MICROPY_TRACE_TIME
+#define MICROPY_TRACE_TIME() mp_hal_ticks_us()
+#endif
+
+// Atomically increment the uint32_t at p and return its old value.  Ports
+// without atomic instructions (eg Cortex-M0) must provide this.
+#ifndef MICROPY_TRACE_ATOMIC_INC
+#define MICROPY_TRACE_ATOMIC_INC(p) __atomic_fetch_add((p), 1, __ATOMIC_RELAXED)
+#endif
+
+// Whether the VM can stop a script after a budget of ticks, counted on each
+// jump opcode and each entry to a bytecode function (see mp_vm_budget_set).
+// While the budget is not set this costs a load and a compare per tick.
+#ifndef MICROPY_VM_BUDGET
+#define MICROPY_VM_BUDGET (0)
+#endif
+
 /*****************************************************************************/
 /* Optimisations                                                             */
 
@@ -497,12 +824,133 @@
 #define MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE (0)
 #endif
 
+// Whether the VM executes common sequences of opcodes as one, for example a
+// small-int add of two local variables stored to a third, a comparison
+// followed by a conditional jump, or the step and test of a for loop over
+// range().  It looks ahead at the following opcodes
+// so the bytecode isn't changed.  Requires MICROPY_OPT_COMPUTED_GOTO and has
+// no effect with MICROPY_PY_SYS_SETTRACE.
+#ifndef MICROPY_OPT_VM_SUPERINSTRUCTIONS
+#define MICROPY_OPT_VM_SUPERINSTRUCTIONS (0)
+#endif
+
+// Whether the VM does binary ops on two small ints (arithmetic, comparison,
+// bitwise and shift) inline, only calling mp_binary_op for other operands or
+// when the result would overflow a small int.  Always done for the ops that
+// are part of superinstructions.
+#ifndef MICROPY_OPT_VM_SMALL_INT_FAST_PATH
+#define MICROPY_OPT_VM_SMALL_INT_FAST_PATH (0)
+#endif
+
+// Whether to cache the methods found in the classes of instances, in a table
+// indexed by type and attribute name, to save searching through the base
+// classes on each call.  All entries are invalidated when a class is created
+// or has an attribute stored or deleted.  Only safe with a GIL.
+#ifndef MICROPY_OPT_LOAD_METHOD_CACHE
+#define MICROPY_OPT_LOAD_METHOD_CACHE (0)
+#endif
+
+// Number of entries in the method cache, must be a power of 2.
+#ifndef MICROPY_OPT_LOAD_METHOD_CACHE_SIZE
+#define MICROPY_OPT_LOAD_METHOD_CACHE_SIZE (64)
+#endif
+
+// Whether to remember which parameter each keyword argument of a call went
+// to, in a table of bytes indexed by the function's table of parameter names
+// and the keyword, so calls made the same way skip searching the names.  An
+// entry is checked against the names before use, so it never needs to be
+// invalidated.  Applies to Python functions and to mp_arg_parse_all.
+#ifndef MICROPY_OPT_ARG_SLOT_CACHE
+#define MICROPY_OPT_ARG_SLOT_CACHE (0)
+#endif
+
+// Number of entries in the parameter slot cache, must be a power of 2.
+#ifndef MICROPY_OPT_ARG_SLOT_CACHE_SIZE
+#define MICROPY_OPT_ARG_SLOT_CACHE_SIZE (64)
+#endif
+
+// Whether a namedtuple type keeps a hash table from the names of its fields
+// to their index, so an attribute is found without searching all the names.
+// Costs about two bytes per field for each namedtuple type.
+#ifndef MICROPY_OPT_NAMEDTUPLE_FIELD_INDEX
+#define MICROPY_OPT_NAMEDTUPLE_FIELD_INDEX (0)
+#endif
+
+// Whether a call of a bound method by the CALL_FUNCTION opcode passes self
+// in the stack slot of the method, so the arguments aren't copied by
+// mp_call_method_self_n_kw.
+#ifndef MICROPY_OPT_CALL_BOUND_METH
+#define MICROPY_OPT_CALL_BOUND_METH (0)
+#endif
+
+// Whether to keep the bound methods made recently, indexed by the method and
+// the instance, so taking the same method of the same instance again (eg to
+// register a callback) returns the same object instead of allocating a new
+// one.  The cache isn't traced by the GC and is emptied by each collection,
+// and bound methods made while an allocation arena is active aren't cached.
+// Only safe with a GIL.
+#ifndef MICROPY_OPT_BOUND_METH_CACHE
+#define MICROPY_OPT_BOUND_METH_CACHE (0)
+#endif
+
+// Number of entries in the bound method cache, must be a power of 2.
+#ifndef MICROPY_OPT_BOUND_METH_CACHE_SIZE
+#define MICROPY_OPT_BOUND_METH_CACHE_SIZE (16)
+#endif
+
+// Most keyword arguments in a call to a native function that
+// mp_arg_parse_all looks up through the parameter slot cache.
+#ifndef MICROPY_OPT_ARG_SLOT_CACHE_MAX_KW
+#define MICROPY_OPT_ARG_SLOT_CACHE_MAX_KW (8)
+#endif
+
+// Whether hash maps keep their entries packed in insertion order, with a
+// separate index of 1, 2 or 4 byte slots for the hash lookup.  Dicts then
+// iterate in insertion order, like in CPython, and OrderedDict is a hash map
+// rather than an array that is searched linearly.  Lookups that miss are
+// faster because the index is never more than 2/3 full.
+#ifndef MICROPY_OPT_MAP_COMPACT
+#define MICROPY_OPT_MAP_COMPACT (0)
+#endif
+
 // Whether to use fast versions of bitwise operations (and, or, xor) when the
 // arguments are both positive.  Increases Thumb2 code size by about 250 bytes.
 #ifndef MICROPY_OPT_MPZ_BITWISE
 #define MICROPY_OPT_MPZ_BITWISE (0)
 #endif
 
+// Number of digits from which both operands of a big-int multiplication are
+// multiplied with the Karatsuba algorithm, which needs temporary memory of
+// about 7 times the size of the shorter operand.  0 disables it.
+#ifndef MICROPY_OPT_MPZ_KARATSUBA_THRESHOLD
+#define MICROPY_OPT_MPZ_KARATSUBA_THRESHOLD (0)
+#endif
+
+// Whether pow(a, b, m) with an odd positive m uses Montgomery multiplication
+// and a sliding window over the exponent, with a table of up to
+// 2**(MICROPY_OPT_MPZ_POW3_WINDOW - 1) precomputed powers of the size of m.
+#ifndef MICROPY_OPT_MPZ_POW3_MONTGOMERY
+#define MICROPY_OPT_MPZ_POW3_MONTGOMERY (0)
+#endif
+
+// Maximum size in bits of the sliding window used by pow(a, b, m).
+#ifndef MICROPY_OPT_MPZ_POW3_WINDOW
+#define MICROPY_OPT_MPZ_POW3_WINDOW (4)
+#endif
+
+
+// Whether searches for substrings of at least
+// MICROPY_OPT_FIND_SUBBYTES_HORSPOOL_MIN_LEN bytes, in str.find, bytes.split
+// and the like, switch to the Boyer-Moore-Horspool algorithm when the first
+// byte of the substring turns out to be common.  This uses a 256 byte table
+// on the C stack.
+#ifndef MICROPY_OPT_FIND_SUBBYTES_HORSPOOL
+#define MICROPY_OPT_FIND_SUBBYTES_HORSPOOL (0)
+#endif
+
+#ifndef MICROPY_OPT_FIND_SUBBYTES_HORSPOOL_MIN_LEN
+#define MICROPY_OPT_FIND_SUBBYTES_HORSPOOL_MIN_LEN (8)
+#endif
 
 // Whether math.factorial is large, fast and recursive (1) or small and slow (0).
 #ifndef MICROPY_OPT_MATH_FACTORIAL
@@ -512,6 +960,22 @@
 /*****************************************************************************/
 /* Python internal features                                                  */
 
+// Whether to support many independent interpreter instances in one process.
+// The state of each instance is in its own mp_state_ctx_t, which the host
+// allocates (zeroed) and selects for the calling thread with
+// mp_state_ctx_set() before calling gc_init/mp_init or running any code.
+// Instances can run concurrently on different threads, but the _thread
+// module is not supported in this mode.
+#ifndef MICROPY_MULTIPLE_INSTANCES
+#define MICROPY_MULTIPLE_INSTANCES (0)
+#endif
+
+// Storage class of the pointer to the current instance, which must be local
+// to each thread
+#ifndef MICROPY_STATE_CTX_THREAD_LOCAL
+#define MICROPY_STATE_CTX_THREAD_LOCAL __thread
+#endif
+
 // Whether to enable import of external modules
 // When disabled, only importing of built-in modules is supported
 // When enabled, a port must implement mp_import_stat (among other things)
@@ -577,12 +1041,28 @@
 #define MICROPY_PYSTACK_ALIGN (8)
 #endif
 
+// Size in bytes of the Python stack of each thread started by _thread, which
+// is allocated on the heap.  With MICROPY_STACKLESS this bounds the depth of
+// Python calls in the thread rather than its C stack size does.
+#ifndef MICROPY_PYSTACK_THREAD_SIZE
+#define MICROPY_PYSTACK_THREAD_SIZE (512 * sizeof(mp_obj_t))
+#endif
+
 // Whether to check C stack usage. C stack used for calling Python functions,
 // etc. Not checking means segfault on overflow.
 #ifndef MICROPY_STACK_CHECK
 #define MICROPY_STACK_CHECK (0)
 #endif
 
+// Whether to raise shared, read-only instances of exceptions that are raised
+// often, to save allocating them: StopIteration without a value and OSError
+// with one of a few errno values, such as EAGAIN.  Such an exception gets no
+// traceback while it's handled in the function it's raised in, and is copied
+// to a new object, which has a traceback, when it propagates out of a function.
+#ifndef MICROPY_PREALLOCATED_EXCEPTIONS
+#define MICROPY_PREALLOCATED_EXCEPTIONS (0)
+#endif
+
 // Whether to have an emergency exception buffer
 #ifndef MICROPY_ENABLE_EMERGENCY_EXCEPTION_BUF
 #define MICROPY_ENABLE_EMERGENCY_EXCEPTION_BUF (0)
@@ -598,6 +1078,27 @@
 #define MICROPY_KBD_EXCEPTION (0)
 #endif
 
+// Size of a line buffer for stdout, so that print() and mp_printf() output
+// reaches the UART/USB and dupterm in whole lines instead of one write per
+// fragment (see lib/utils/stdout_buffer.c); 0 disables it
+#ifndef MICROPY_HAL_STDOUT_BUFFER_SIZE
+#define MICROPY_HAL_STDOUT_BUFFER_SIZE (0)
+#endif
+
+// Buffered stdout output that is older than this is sent with the next write
+#ifndef MICROPY_HAL_STDOUT_BUFFER_TIMEOUT_MS
+#define MICROPY_HAL_STDOUT_BUFFER_TIMEOUT_MS (20)
+#endif
+
+// For a port's MICROPY_EVENT_POLL_HOOK, to send buffered stdout when idle
+#if MICROPY_HAL_STDOUT_BUFFER_SIZE
+#define MICROPY_HAL_STDOUT_BUFFER_POLL \
+    extern void mp_hal_stdout_buffer_flush(void); \
+    mp_hal_stdout_buffer_flush();
+#else
+#define MICROPY_HAL_STDOUT_BUFFER_POLL
+#endif
+
 // Prefer to raise KeyboardInterrupt asynchronously (from signal or interrupt
 // handler) - if supported by a particular port.
 #ifndef MICROPY_ASYNC_KBD_INTR
@@ -639,6 +1140,12 @@
 #define MICROPY_REPL_AUTO_INDENT (0)
 #endif
 
+// Whether the raw REPL supports the binary file transfer commands (Ctrl-E P
+// and Ctrl-E G), which need uzlib for their CRC32
+#ifndef MICROPY_REPL_FILE_TRANSFER
+#define MICROPY_REPL_FILE_TRANSFER (0)
+#endif
+
 // Whether port requires event-driven REPL functions
 #ifndef MICROPY_REPL_EVENT_DRIVEN
 #define MICROPY_REPL_EVENT_DRIVEN (0)
@@ -734,6 +1241,27 @@ typedef double mp_float_t;
 #define MICROPY_FLOAT_HIGH_QUALITY_HASH (0)
 #endif
 
+// Whether float to string conversion prints the shortest digits that read
+// back as the same float (as repr), and rounds exactly for formatting, and
+// whether string to float conversion is correctly rounded.  Uses a few
+// hundred bytes of stack for the cases that need big integer arithmetic.
+#ifndef MICROPY_FLOAT_EXACT_CONVERSION
+#define MICROPY_FLOAT_EXACT_CONVERSION (0)
+#endif
+
+// Whether to keep float objects found dead by the GC on a free list, so that
+// creating a float usually takes one from the list instead of searching the
+// heap.  Only has an effect when floats are allocated on the heap (object
+// representations A and B).
+#ifndef MICROPY_FLOAT_FREELIST
+#define MICROPY_FLOAT_FREELIST (0)
+#endif
+
+// Maximum number of float objects kept on the free list by each collection.
+#ifndef MICROPY_FLOAT_FREELIST_LEN
+#define MICROPY_FLOAT_FREELIST_LEN (64)
+#endif
+
 // Enable features which improve CPython compatibility
 // but may lead to more code size/memory usage.
 // TODO: Originally intended as generic category to not
@@ -762,6 +1290,12 @@ typedef double mp_float_t;
 #define MICROPY_STREAMS_POSIX_API (0)
 #endif
 
+// Whether to provide the readline_into() stream method, which reads a line
+// into a caller-supplied buffer without allocating
+#ifndef MICROPY_STREAMS_READLINE_INTO
+#define MICROPY_STREAMS_READLINE_INTO (0)
+#endif
+
 // Whether to call __init__ when importing builtin modules for the first time
 #ifndef MICROPY_MODULE_BUILTIN_INIT
 #define MICROPY_MODULE_BUILTIN_INIT (0)
@@ -792,6 +1326,21 @@ typedef double mp_float_t;
 #define MICROPY_MODULE_FROZEN (MICROPY_MODULE_FROZEN_STR || MICROPY_MODULE_FROZEN_MPY)
 #endif
 
+// Whether tools/mpy-tool.py can put the globals of frozen .mpy modules in ROM,
+// with the functions and simple classes that they define.  Such a namespace is
+// copied to the heap the first time that it's written to.
+#ifndef MICROPY_MODULE_FROZEN_ROM_GLOBALS
+#define MICROPY_MODULE_FROZEN_ROM_GLOBALS (0)
+#endif
+
+// Whether an imported .py file can be saved as an .mpy in a __pycache__
+// directory next to it, and that loaded instead until the source changes.
+// It is turned on at runtime with micropython.mpy_cache(True), and needs
+// MICROPY_VFS and both saving and loading of persistent code.
+#ifndef MICROPY_MODULE_MPY_CACHE
+#define MICROPY_MODULE_MPY_CACHE (0)
+#endif
+
 // Whether you can override builtins in the builtins module
 #ifndef MICROPY_CAN_OVERRIDE_BUILTINS
 #define MICROPY_CAN_OVERRIDE_BUILTINS (0)
@@ -826,6 +1375,13 @@ typedef double mp_float_t;
 #define MICROPY_SCHEDULER_DEPTH (4)
 #endif
 
+// Number of entries in the scheduler's event ring, used by mp_sched_event to
+// queue callbacks with a payload captured at interrupt time (0 to disable).
+// Must be a power of 2, at most 128.
+#ifndef MICROPY_SCHEDULER_EVENT_DEPTH
+#define MICROPY_SCHEDULER_EVENT_DEPTH (0)
+#endif
+
 // Support for generic VFS sub-system
 #ifndef MICROPY_VFS
 #define MICROPY_VFS (0)
@@ -841,6 +1397,54 @@ typedef double mp_float_t;
 #define MICROPY_VFS_FAT (0)
 #endif
 
+// Whether the results of mp_vfs_import_stat are cached, keyed by mount and
+// path.  The cache is cleared by any mount, umount, chdir, mkdir, rmdir,
+// remove, rename or open for writing done through the VFS, but not by changes
+// made directly through a filesystem or block device object.
+#ifndef MICROPY_VFS_IMPORT_STAT_CACHE
+#define MICROPY_VFS_IMPORT_STAT_CACHE (0)
+#endif
+
+// Number of entries in the import stat cache, must be a power of 2.
+#ifndef MICROPY_VFS_IMPORT_STAT_CACHE_SIZE
+#define MICROPY_VFS_IMPORT_STAT_CACHE_SIZE (32)
+#endif
+
+// Number of blocks VfsFat reads ahead, in a single multi-block read, when file
+// data is read one sector at a time in order; set to 0 to disable read-ahead
+#ifndef MICROPY_VFS_FAT_READAHEAD_BLOCKS
+#define MICROPY_VFS_FAT_READAHEAD_BLOCKS (0)
+#endif
+
+// Whether block devices used by VfsFat and VfsLfs go through a block cache,
+// which keeps recently read blocks and coalesces consecutive block writes
+#ifndef MICROPY_VFS_BLOCKDEV_CACHE
+#define MICROPY_VFS_BLOCKDEV_CACHE (0)
+#endif
+
+// Number of whole blocks kept by the block cache (LRU replacement)
+#ifndef MICROPY_VFS_BLOCKDEV_CACHE_BLOCKS
+#define MICROPY_VFS_BLOCKDEV_CACHE_BLOCKS (4)
+#endif
+
+// Maximum number of consecutive blocks held back for a single coalesced write,
+// set to 0 to write blocks through immediately
+#ifndef MICROPY_VFS_BLOCKDEV_WRITEBACK_BLOCKS
+#define MICROPY_VFS_BLOCKDEV_WRITEBACK_BLOCKS (4)
+#endif
+
+// Whether to provide uos.mmap, giving read-only buffer access to files and
+// memory-mapped block devices without copying their contents to the heap
+#ifndef MICROPY_VFS_MMAP
+#define MICROPY_VFS_MMAP (0)
+#endif
+
+// Size in bytes of the window used by uos.mmap to read files which can't be
+// mapped directly (must be a power of 2)
+#ifndef MICROPY_VFS_MMAP_WINDOW
+#define MICROPY_VFS_MMAP_WINDOW (256)
+#endif
+
 /*****************************************************************************/
 /* Fine control over Python builtins, classes, modules, etc                  */
 
@@ -870,6 +1474,14 @@ typedef double mp_float_t;
 #define MICROPY_PY_DELATTR_SETATTR (0)
 #endif
 
+// Whether to support __slots__ in classes, whose instances then hold the
+// attributes named in it in an array rather than in a map.  An instance
+// only has a map for other attributes if a class it derives from has no
+// __slots__, or "__dict__" is one of them.
+#ifndef MICROPY_PY_SLOTS
+#define MICROPY_PY_SLOTS (0)
+#endif
+
 // Support for async/await/async for/async with
 #ifndef MICROPY_PY_ASYNC_AWAIT
 #define MICROPY_PY_ASYNC_AWAIT (1)
@@ -899,6 +1511,13 @@ typedef double mp_float_t;
 #define MICROPY_PY_BUILTINS_STR_UNICODE (0)
 #endif
 
+// Whether str objects note if they are ASCII-only, so they are indexed in
+// constant time, and keep an index of character offsets after the data of long
+// non-ASCII strings, so indexing and slicing them doesn't scan from the start
+#ifndef MICROPY_PY_BUILTINS_STR_UNICODE_INDEX
+#define MICROPY_PY_BUILTINS_STR_UNICODE_INDEX (0)
+#endif
+
 // Whether to check for valid UTF-8 when converting bytes to str
 #ifndef MICROPY_PY_BUILTINS_STR_UNICODE_CHECK
 #define MICROPY_PY_BUILTINS_STR_UNICODE_CHECK (MICROPY_PY_BUILTINS_STR_UNICODE)
@@ -949,6 +1568,12 @@ typedef double mp_float_t;
 #define MICROPY_PY_BUILTINS_MEMORYVIEW_ITEMSIZE (0)
 #endif
 
+// Whether to support memoryview.split(), which splits a memoryview of bytes
+// into memoryviews without copying (a MicroPython extension)
+#ifndef MICROPY_PY_BUILTINS_MEMORYVIEW_SPLIT
+#define MICROPY_PY_BUILTINS_MEMORYVIEW_SPLIT (0)
+#endif
+
 // Whether to support set object
 #ifndef MICROPY_PY_BUILTINS_SET
 #define MICROPY_PY_BUILTINS_SET (1)
@@ -1068,6 +1693,14 @@ typedef double mp_float_t;
 #define MICROPY_PY_BUILTINS_INPUT (0)
 #endif
 
+// Whether list.sort and sorted use a stable merge sort, as Python requires,
+// rather than an in-place quicksort.  The merge sort is adaptive, so data
+// that is already (nearly) in order is cheap to sort, but it needs temporary
+// buffers of up to 1.5 times the length of the list, or 3 times with a key.
+#ifndef MICROPY_PY_BUILTINS_SORT_STABLE
+#define MICROPY_PY_BUILTINS_SORT_STABLE (0)
+#endif
+
 // Whether to support min/max functions
 #ifndef MICROPY_PY_BUILTINS_MIN_MAX
 #define MICROPY_PY_BUILTINS_MIN_MAX (1)
@@ -1114,6 +1747,16 @@ typedef double mp_float_t;
 #define MICROPY_PY_MICROPYTHON_HEAP_LOCKED (0)
 #endif
 
+// Whether to provide the "micropython.list_with_capacity" function
+#ifndef MICROPY_PY_MICROPYTHON_LIST_WITH_CAPACITY
+#define MICROPY_PY_MICROPYTHON_LIST_WITH_CAPACITY (0)
+#endif
+
+// Whether to provide the "micropython.StringBuilder" type
+#ifndef MICROPY_PY_MICROPYTHON_STRINGBUILDER
+#define MICROPY_PY_MICROPYTHON_STRINGBUILDER (0)
+#endif
+
 // Whether to provide "array" module. Note that large chunk of the
 // underlying code is shared with "bytearray" builtin type, so to
 // get real savings, it should be disabled too.
@@ -1121,6 +1764,12 @@ typedef double mp_float_t;
 #define MICROPY_PY_ARRAY (1)
 #endif
 
+// Whether to provide elementwise arithmetic, reductions and conversion for
+// arrays as functions in the "array" module, as loops over the raw elements
+#ifndef MICROPY_PY_ARRAY_KERNELS
+#define MICROPY_PY_ARRAY_KERNELS (0)
+#endif
+
 // Whether to support slice assignments for array (and bytearray).
 // This is rarely used, but adds ~0.5K of code.
 #ifndef MICROPY_PY_ARRAY_SLICE_ASSIGN
@@ -1143,16 +1792,43 @@ typedef double mp_float_t;
 #define MICROPY_PY_COLLECTIONS_DEQUE (0)
 #endif
 
+// Whether "ucollections.deque" supports iteration
+#ifndef MICROPY_PY_COLLECTIONS_DEQUE_ITER
+#define MICROPY_PY_COLLECTIONS_DEQUE_ITER (0)
+#endif
+
+// Whether "ucollections.deque" supports indexing
+#ifndef MICROPY_PY_COLLECTIONS_DEQUE_SUBSCR
+#define MICROPY_PY_COLLECTIONS_DEQUE_SUBSCR (0)
+#endif
+
+// Whether "ucollections.deque" can store numbers in a packed array, with a
+// running sum, given a typecode
+#ifndef MICROPY_PY_COLLECTIONS_DEQUE_TYPED
+#define MICROPY_PY_COLLECTIONS_DEQUE_TYPED (0)
+#endif
+
 // Whether to provide "collections.OrderedDict" type
 #ifndef MICROPY_PY_COLLECTIONS_ORDEREDDICT
 #define MICROPY_PY_COLLECTIONS_ORDEREDDICT (0)
 #endif
 
+// Whether to provide ucollections.IntDict, a mapping with int keys that keeps
+// a dense range of them in an array
+#ifndef MICROPY_PY_COLLECTIONS_INTDICT
+#define MICROPY_PY_COLLECTIONS_INTDICT (0)
+#endif
+
 // Whether to provide the _asdict function for namedtuple
 #ifndef MICROPY_PY_COLLECTIONS_NAMEDTUPLE__ASDICT
 #define MICROPY_PY_COLLECTIONS_NAMEDTUPLE__ASDICT (0)
 #endif
 
+// Whether to provide the _make and _replace functions for namedtuple
+#ifndef MICROPY_PY_COLLECTIONS_NAMEDTUPLE__MAKE_REPLACE
+#define MICROPY_PY_COLLECTIONS_NAMEDTUPLE__MAKE_REPLACE (0)
+#endif
+
 // Whether to provide "math" module
 #ifndef MICROPY_PY_MATH
 #define MICROPY_PY_MATH (1)
@@ -1173,6 +1849,16 @@ typedef double mp_float_t;
 #define MICROPY_PY_MATH_ISCLOSE (0)
 #endif
 
+// Whether to provide math.fsum, math.prod and math.dist functions
+#ifndef MICROPY_PY_MATH_FSUM
+#define MICROPY_PY_MATH_FSUM (0)
+#endif
+
+// Whether to provide math.apply function, to run a math function over an array
+#ifndef MICROPY_PY_MATH_APPLY
+#define MICROPY_PY_MATH_APPLY (0)
+#endif
+
 // Whether to provide fix for atan2 Inf handling.
 #ifndef MICROPY_PY_MATH_ATAN2_FIX_INFNAN
 #define MICROPY_PY_MATH_ATAN2_FIX_INFNAN (0)
@@ -1249,6 +1935,11 @@ typedef double mp_float_t;
 #define MICROPY_PY_STRUCT (1)
 #endif
 
+// Whether to provide the "struct.Struct" class
+#ifndef MICROPY_PY_STRUCT_OBJECT
+#define MICROPY_PY_STRUCT_OBJECT (0)
+#endif
+
 // Whether to provide "sys" module
 #ifndef MICROPY_PY_SYS
 #define MICROPY_PY_SYS (1)
@@ -1285,6 +1976,10 @@ typedef double mp_float_t;
 #define MICROPY_PY_SYS_SETTRACE (0)
 #endif
 
+// Whether the VM keeps MP_STATE_THREAD(current_code_state), and the chain of
+// code states of its callers, up to date (needed by settrace and profilers)
+#define MICROPY_TRACK_CODE_STATE (MICROPY_PY_SYS_SETTRACE || MICROPY_GC_ALLOC_PROFILE || MICROPY_SAMPLING_PROFILE)
+
 // Whether to provide "sys.getsizeof" function
 #ifndef MICROPY_PY_SYS_GETSIZEOF
 #define MICROPY_PY_SYS_GETSIZEOF (0)
@@ -1301,6 +1996,12 @@ typedef double mp_float_t;
 #define MICROPY_PY_SYS_STDIO_BUFFER (0)
 #endif
 
+// Number of characters to read at once from a uos.dupterm() stream that is
+// implemented in Python, instead of calling its readinto() per character
+#ifndef MICROPY_PY_OS_DUPTERM_RX_BUF_SIZE
+#define MICROPY_PY_OS_DUPTERM_RX_BUF_SIZE (0)
+#endif
+
 // Whether to provide "uerrno" module
 #ifndef MICROPY_PY_UERRNO
 #define MICROPY_PY_UERRNO (0)
@@ -1349,12 +2050,62 @@ typedef double mp_float_t;
 #define MICROPY_PY_THREAD_GIL_VM_DIVISOR (32)
 #endif
 
+// Whether lists, dicts, sets and instance attributes guard their storage with
+// per-object locks so they can be shared between threads when there is no GIL
+#ifndef MICROPY_PY_THREAD_OBJ_LOCK
+#define MICROPY_PY_THREAD_OBJ_LOCK (0)
+#endif
+
+// Number of locks shared out between objects by address; a power of 2
+#ifndef MICROPY_PY_THREAD_OBJ_LOCK_NUM
+#define MICROPY_PY_THREAD_OBJ_LOCK_NUM (64)
+#endif
+
+// Hook called while spinning on an object lock held by another thread
+#ifndef MICROPY_PY_THREAD_OBJ_LOCK_WAIT
+#define MICROPY_PY_THREAD_OBJ_LOCK_WAIT()
+#endif
+
+// Whether _thread.start_new_thread accepts priority and core arguments, which
+// are passed to mp_thread_create_ex provided by the port
+#ifndef MICROPY_PY_THREAD_CREATE_EX
+#define MICROPY_PY_THREAD_CREATE_EX (0)
+#endif
+
+// Whether to provide _thread.Channel, a lock-free single-producer/single-consumer
+// message queue for passing data between two threads without allocating
+#ifndef MICROPY_PY_THREAD_CHANNEL
+#define MICROPY_PY_THREAD_CHANNEL (0)
+#endif
+
+// Whether to provide _thread.Queue, a bounded queue of objects for any number
+// of producer and consumer threads, with blocking put and get
+#ifndef MICROPY_PY_THREAD_QUEUE
+#define MICROPY_PY_THREAD_QUEUE (0)
+#endif
+
 // Extended modules
 
 #ifndef MICROPY_PY_UASYNCIO
 #define MICROPY_PY_UASYNCIO (0)
 #endif
 
+// Whether uasyncio's TaskQueue keeps tasks that are due a short time from now
+// in a timer wheel, with O(1) push and remove, rather than in its heap
+#ifndef MICROPY_PY_UASYNCIO_TIMER_WHEEL
+#define MICROPY_PY_UASYNCIO_TIMER_WHEEL (0)
+#endif
+
+// Number of slots of the timer wheel, a power of 2
+#ifndef MICROPY_PY_UASYNCIO_TIMER_WHEEL_SLOTS
+#define MICROPY_PY_UASYNCIO_TIMER_WHEEL_SLOTS (64)
+#endif
+
+// Milliseconds per slot of the timer wheel, a power of 2
+#ifndef MICROPY_PY_UASYNCIO_TIMER_WHEEL_SLOT_MS
+#define MICROPY_PY_UASYNCIO_TIMER_WHEEL_SLOT_MS (8)
+#endif
+
 #ifndef MICROPY_PY_UCTYPES
 #define MICROPY_PY_UCTYPES (0)
 #endif
@@ -1365,14 +2116,52 @@ typedef double mp_float_t;
 #define MICROPY_PY_UCTYPES_NATIVE_C_TYPES (1)
 #endif
 
+// Whether to provide uctypes.compile and uctypes.unpack_all
+#ifndef MICROPY_PY_UCTYPES_COMPILE
+#define MICROPY_PY_UCTYPES_COMPILE (0)
+#endif
+
 #ifndef MICROPY_PY_UZLIB
 #define MICROPY_PY_UZLIB (0)
 #endif
 
+// Whether to provide uzlib.compress and uzlib.CompressIO
+#ifndef MICROPY_PY_UZLIB_COMPRESS
+#define MICROPY_PY_UZLIB_COMPRESS (0)
+#endif
+
 #ifndef MICROPY_PY_UJSON
 #define MICROPY_PY_UJSON (0)
 #endif
 
+// Whether to support the object_hook argument to ujson.load and ujson.loads
+#ifndef MICROPY_PY_UJSON_OBJECT_HOOK
+#define MICROPY_PY_UJSON_OBJECT_HOOK (0)
+#endif
+
+// Whether to provide ujson.iterload
+#ifndef MICROPY_PY_UJSON_ITERLOAD
+#define MICROPY_PY_UJSON_ITERLOAD (0)
+#endif
+
+// Maximum number of new qstrs that ujson and ucbor make for the str keys of
+// the dicts they decode, so the same key of many dicts shares its data and is
+// compared by pointer.  Qstrs are never freed, so this bounds how much of the
+// qstr pool untrusted input can take up.  Set to 0 to not intern any keys
+#ifndef MICROPY_PY_INTERN_DECODED_KEYS
+#define MICROPY_PY_INTERN_DECODED_KEYS (0)
+#endif
+
+// Maximum length in bytes of a dict key that ujson and ucbor intern
+#ifndef MICROPY_PY_INTERN_DECODED_KEYS_MAX_LEN
+#define MICROPY_PY_INTERN_DECODED_KEYS_MAX_LEN (16)
+#endif
+
+// Whether to provide the "ucbor" module, for CBOR encoding and decoding
+#ifndef MICROPY_PY_UCBOR
+#define MICROPY_PY_UCBOR (0)
+#endif
+
 #ifndef MICROPY_PY_URE
 #define MICROPY_PY_URE (0)
 #endif
@@ -1393,10 +2182,27 @@ typedef double mp_float_t;
 #define MICROPY_PY_URE_SUB (0)
 #endif
 
+// Whether to provide the "finditer" function and method
+#ifndef MICROPY_PY_URE_FINDITER
+#define MICROPY_PY_URE_FINDITER (0)
+#endif
+
+// Whether to match with a Pike VM instead of the recursive backtracking engine;
+// it takes linear time in the subject length and doesn't recurse on the C stack
+// per subject char, but needs heap memory proportional to the pattern size
+#ifndef MICROPY_PY_URE_PIKEVM
+#define MICROPY_PY_URE_PIKEVM (0)
+#endif
+
 #ifndef MICROPY_PY_UHEAPQ
 #define MICROPY_PY_UHEAPQ (0)
 #endif
 
+// Whether to include: nsmallest, nlargest, merge and the KeyHeap type
+#ifndef MICROPY_PY_UHEAPQ_EXTRA
+#define MICROPY_PY_UHEAPQ_EXTRA (0)
+#endif
+
 // Optimized heap queue for relative timestamps
 #ifndef MICROPY_PY_UTIMEQ
 #define MICROPY_PY_UTIMEQ (0)
@@ -1440,6 +2246,18 @@ typedef double mp_float_t;
 #define MICROPY_PY_UBINASCII_CRC32 (0)
 #endif
 
+// Whether to provide ubinascii's hexlify_into, unhexlify_into, a2b_base64_into
+// and b2a_base64_into, and the Base64Encoder and Base64Decoder types
+#ifndef MICROPY_PY_UBINASCII_INTO
+#define MICROPY_PY_UBINASCII_INTO (0)
+#endif
+
+// Whether ubinascii.crc32 uses the port function mp_hal_crc32(), eg to use
+// hardware; it has the semantics of zlib's crc32(crc, buf, len)
+#ifndef MICROPY_PY_UBINASCII_CRC32_HW
+#define MICROPY_PY_UBINASCII_CRC32_HW (0)
+#endif
+
 #ifndef MICROPY_PY_URANDOM
 #define MICROPY_PY_URANDOM (0)
 #endif
@@ -1449,6 +2267,12 @@ typedef double mp_float_t;
 #define MICROPY_PY_URANDOM_EXTRA_FUNCS (0)
 #endif
 
+// Whether urandom uses the xoshiro128++ generator instead of Yasmarang; it
+// has a longer period and better statistics for 12 more bytes of state
+#ifndef MICROPY_PY_URANDOM_XOSHIRO
+#define MICROPY_PY_URANDOM_XOSHIRO (0)
+#endif
+
 #ifndef MICROPY_PY_MACHINE
 #define MICROPY_PY_MACHINE (0)
 #endif
@@ -1458,20 +2282,80 @@ typedef double mp_float_t;
 #define MICROPY_PY_MACHINE_PULSE (0)
 #endif
 
+// Whether to provide machine.PinGroup, to read and write several pins at
+// once through their GPIO port registers (requires mp_hal_pin_port hooks)
+#ifndef MICROPY_PY_MACHINE_PINGROUP
+#define MICROPY_PY_MACHINE_PINGROUP (0)
+#endif
+
 #ifndef MICROPY_PY_MACHINE_I2C
 #define MICROPY_PY_MACHINE_I2C (0)
 #endif
 
+// Whether to provide machine.I2S, streaming through a ring buffer fed by DMA
+// (requires the mp_machine_i2s_port hooks)
+#ifndef MICROPY_PY_MACHINE_I2S
+#define MICROPY_PY_MACHINE_I2S (0)
+#endif
+
+// Whether to provide I2C.transfer_batch, to run a list of operations in one call
+#ifndef MICROPY_PY_MACHINE_I2C_TRANSFER_BATCH
+#define MICROPY_PY_MACHINE_I2C_TRANSFER_BATCH (0)
+#endif
+
 #ifndef MICROPY_PY_MACHINE_SPI
 #define MICROPY_PY_MACHINE_SPI (0)
 #endif
 
+// Whether to provide machine.SDCard for an SD card on a machine.SPI bus
+// (requires the mp_hal_pin functions for the CS pin)
+#ifndef MICROPY_PY_MACHINE_SDCARD_SPI
+#define MICROPY_PY_MACHINE_SDCARD_SPI (0)
+#endif
+
 #ifndef MICROPY_PY_USSL
 #define MICROPY_PY_USSL (0)
 // Whether to add finaliser code to ussl objects
 #define MICROPY_PY_USSL_FINALISER (0)
 #endif
 
+// Whether usocket objects provide sendto_many() and recvfrom_into_many(), to
+// handle a batch of datagrams in one call
+#ifndef MICROPY_PY_USOCKET_BATCH
+#define MICROPY_PY_USOCKET_BATCH (0)
+#endif
+
+// Whether to provide usocket.Pool, which keeps idle connections open for reuse
+#ifndef MICROPY_PY_USOCKET_POOL
+#define MICROPY_PY_USOCKET_POOL (0)
+#endif
+
+// Whether usocket.getaddrinfo keeps the IPv4 addresses it resolves in a small
+// cache, shared by all sockets, for up to the given time (names resolved by
+// the cache are returned without a DNS query)
+#ifndef MICROPY_PY_USOCKET_DNS_CACHE
+#define MICROPY_PY_USOCKET_DNS_CACHE (0)
+#endif
+#ifndef MICROPY_PY_USOCKET_DNS_CACHE_SIZE
+#define MICROPY_PY_USOCKET_DNS_CACHE_SIZE (8)
+#endif
+#ifndef MICROPY_PY_USOCKET_DNS_CACHE_TTL_MS
+#define MICROPY_PY_USOCKET_DNS_CACHE_TTL_MS (300000)
+#endif
+
+// Whether to include a PTP slave, and receive timestamps for lwIP UDP sockets,
+// for a network interface with a hardware PTP clock (the port provides the
+// network_ptp_hal_xxx functions in extmod/network_ptp.h)
+#ifndef MICROPY_PY_NETWORK_PTP
+#define MICROPY_PY_NETWORK_PTP (0)
+#endif
+
+// Whether to provide ussl session objects, so a client can resume a previous
+// TLS session instead of doing a full handshake (mbedtls only)
+#ifndef MICROPY_PY_USSL_SESSION
+#define MICROPY_PY_USSL_SESSION (0)
+#endif
+
 #ifndef MICROPY_PY_UWEBSOCKET
 #define MICROPY_PY_UWEBSOCKET (0)
 #endif
@@ -1480,6 +2364,22 @@ typedef double mp_float_t;
 #define MICROPY_PY_FRAMEBUF (0)
 #endif
 
+// Whether the port provides mp_hal_framebuf_fill/copy/wait to offload
+// framebuf fills and blits to hardware
+#ifndef MICROPY_PY_FRAMEBUF_ACCEL
+#define MICROPY_PY_FRAMEBUF_ACCEL (0)
+#endif
+
+// Whether to provide the "_nrf24l01" module, a driver for nRF24L01+ radios
+#ifndef MICROPY_PY_NRF24L01
+#define MICROPY_PY_NRF24L01 (0)
+#endif
+
+// Whether to provide the "_display" module, to send framebufs to displays
+#ifndef MICROPY_PY_DISPLAY
+#define MICROPY_PY_DISPLAY (0)
+#endif
+
 #ifndef MICROPY_PY_BTREE
 #define MICROPY_PY_BTREE (0)
 #endif
@@ -1522,6 +2422,49 @@ typedef double mp_float_t;
 #define MICROPY_WRAP_MP_SCHED_SCHEDULE(f) f
 #endif
 
+#ifndef MICROPY_WRAP_MP_SCHED_EVENT
+#define MICROPY_WRAP_MP_SCHED_EVENT(f) f
+#endif
+
+// The functions below are the hot paths of the VM and the GC, which a port
+// can move to fast RAM when the rest of the code runs from cached flash.
+
+#ifndef MICROPY_WRAP_MP_EXECUTE_BYTECODE
+#define MICROPY_WRAP_MP_EXECUTE_BYTECODE(f) f
+#endif
+
+#ifndef MICROPY_WRAP_MP_BINARY_OP
+#define MICROPY_WRAP_MP_BINARY_OP(f) f
+#endif
+
+#ifndef MICROPY_WRAP_MP_LOAD_GLOBAL
+#define MICROPY_WRAP_MP_LOAD_GLOBAL(f) f
+#endif
+
+#ifndef MICROPY_WRAP_MP_LOAD_NAME
+#define MICROPY_WRAP_MP_LOAD_NAME(f) f
+#endif
+
+#ifndef MICROPY_WRAP_MP_MAP_LOOKUP
+#define MICROPY_WRAP_MP_MAP_LOOKUP(f) f
+#endif
+
+#ifndef MICROPY_WRAP_MP_OBJ_GET_TYPE
+#define MICROPY_WRAP_MP_OBJ_GET_TYPE(f) f
+#endif
+
+#ifndef MICROPY_WRAP_GC_ALLOC
+#define MICROPY_WRAP_GC_ALLOC(f) f
+#endif
+
+#ifndef MICROPY_WRAP_GC_FREE
+#define MICROPY_WRAP_GC_FREE(f) f
+#endif
+
+#ifndef MICROPY_WRAP_GC_MARK_SUBTREE
+#define MICROPY_WRAP_GC_MARK_SUBTREE(f) f
+#endif
+
 /*****************************************************************************/
 /* Miscellaneous settings                                                    */
 
@@ -1717,5 +2660,39 @@ typedef double mp_float_t;
 #error "MICROPY_PY_SYS_SETTRACE requires MICROPY_COMP_CONST to be disabled"
 #endif
 #endif
+#if MICROPY_JIT && (!MICROPY_EMIT_NATIVE || MICROPY_DYNAMIC_COMPILER)
+#error "MICROPY_JIT requires a native emitter and no dynamic compiler"
+#endif
+#if MICROPY_OBJ_REPR == MICROPY_OBJ_REPR_C && MICROPY_FLOAT_IMPL == MICROPY_FLOAT_IMPL_DOUBLE
+#error "MICROPY_OBJ_REPR_C requires MICROPY_FLOAT_IMPL_FLOAT"
+#endif
+
+// The float free list only applies when floats live on the garbage-collected heap.
+#if MICROPY_FLOAT_FREELIST && (!MICROPY_ENABLE_GC || !MICROPY_PY_BUILTINS_FLOAT \
+    || MICROPY_OBJ_REPR == MICROPY_OBJ_REPR_C || MICROPY_OBJ_REPR == MICROPY_OBJ_REPR_D)
+#undef MICROPY_FLOAT_FREELIST
+#define MICROPY_FLOAT_FREELIST (0)
+#endif
+
+// The GC pool keeps objects of the garbage-collected heap.
+#if MICROPY_GC_POOL && !MICROPY_ENABLE_GC
+#undef MICROPY_GC_POOL
+#define MICROPY_GC_POOL (0)
+#endif
+
+#if MICROPY_MULTIPLE_INSTANCES && MICROPY_PY_THREAD
+#error "MICROPY_MULTIPLE_INSTANCES is not supported with MICROPY_PY_THREAD"
+#endif
+
+// The sys module finds the objects of the running instance with __getattr__.
+#if MICROPY_MULTIPLE_INSTANCES && !MICROPY_MODULE_GETATTR
+#error "MICROPY_MULTIPLE_INSTANCES requires MICROPY_MODULE_GETATTR"
+#endif
+
+// Thread allocation buffers are only needed when the GC has a lock.
+#if MICROPY_GC_TLAB && (!MICROPY_ENABLE_GC || !MICROPY_PY_THREAD || MICROPY_PY_THREAD_GIL)
+#undef MICROPY_GC_TLAB
+#define MICROPY_GC_TLAB (0)
+#endif
 
 #endif // MICROPY_INCLUDED_PY_MPCONFIG_H
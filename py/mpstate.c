@@ -30,4 +30,8 @@
 mp_dynamic_compiler_t mp_dynamic_compiler = {0};
 #endif
 
+#if MICROPY_MULTIPLE_INSTANCES
+MICROPY_STATE_CTX_THREAD_LOCAL mp_state_ctx_t *mp_state_ctx_ptr;
+#else
 mp_state_ctx_t mp_state_ctx;
+#endif
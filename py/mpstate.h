@@ -46,6 +46,8 @@ typedef struct mp_dynamic_compiler_t {
     uint8_t small_int_bits; // must be <= host small_int_bits
     bool opt_cache_map_lookup_in_bytecode;
     bool py_builtins_str_unicode;
+    bool lazy_load;
+    bool mapped_str;
     uint8_t native_arch;
     uint8_t nlr_buf_num_regs;
 } mp_dynamic_compiler_t;
@@ -62,12 +64,20 @@ typedef struct _mp_sched_item_t {
     mp_obj_t arg;
 } mp_sched_item_t;
 
-// This structure hold information about the memory allocation system.
-typedef struct _mp_state_mem_t {
-    #if MICROPY_MEM_STATS
-    size_t total_bytes_allocated;
-    size_t current_bytes_allocated;
-    size_t peak_bytes_allocated;
+typedef struct _mp_sched_event_t {
+    mp_obj_t func;
+    mp_obj_t arg;
+    mp_int_t value;
+    mp_uint_t ticks_us;
+    mp_uint_t count;
+} mp_sched_event_t;
+
+// This structure holds the layout and allocation state of a single GC heap
+// region (area).
+typedef struct _mp_state_mem_area_t {
+    #if MICROPY_GC_SPLIT_HEAP
+    struct _mp_state_mem_area_t *next;
+    unsigned int flags;
     #endif
 
     byte *gc_alloc_table_start;
@@ -75,11 +85,165 @@ typedef struct _mp_state_mem_t {
     #if MICROPY_ENABLE_FINALISER
     byte *gc_finaliser_table_start;
     #endif
+    #if MICROPY_GC_GENERATIONAL
+    byte *gc_generation_table_start;
+    byte *gc_remembered_table_start;
+    size_t gc_remembered_table_byte_len;
+    size_t gc_young_start;
+    size_t gc_young_end;
+    #endif
+    #if MICROPY_GC_NO_SCAN
+    byte *gc_no_scan_table_start;
+    #endif
+    #if MICROPY_GC_INCREMENTAL
+    byte *gc_dirty_table_start;
+    size_t gc_dirty_table_byte_len;
+    #endif
     byte *gc_pool_start;
     byte *gc_pool_end;
 
+    size_t gc_last_free_atb_index;
+    // where the last run of more than one block was found, to look for the
+    // next one from there rather than from gc_last_free_atb_index
+    size_t gc_last_run_atb_index;
+
+    #if MICROPY_GC_SIZE_CLASSES
+    // Free runs cached per size class, entries may be stale and are checked
+    // against the allocation table before they are used.
+    MICROPY_GC_STACK_ENTRY_TYPE gc_size_class_block[5][MICROPY_GC_SIZE_CLASS_DEPTH];
+    uint8_t gc_size_class_len[5];
+    #endif
+} mp_state_mem_area_t;
+
+#if MICROPY_GC_PARALLEL_MARK
+// A stack of blocks that are marked but whose children still need scanning,
+// used by the workers of a parallel mark phase and as their shared pool.
+typedef struct _mp_gc_mark_stack_t {
+    size_t len;
+    MICROPY_GC_STACK_ENTRY_TYPE block[MICROPY_ALLOC_GC_STACK_SIZE];
+    #if MICROPY_GC_SPLIT_HEAP
+    mp_state_mem_area_t *area[MICROPY_ALLOC_GC_STACK_SIZE];
+    #endif
+} mp_gc_mark_stack_t;
+#endif
+
+#if MICROPY_GC_ARENA
+// Header at the start of each heap block (chunk) of an allocation arena; an
+// arena gets another chunk when the existing ones are full.  The offsets
+// are relative to the header, and the link to the next arena of the list of
+// all arenas is stored inverted so it doesn't keep that arena alive.
+typedef struct _mp_gc_arena_t {
+    struct _mp_gc_arena_t *prev; // enclosing arena or chunk of the same thread, if any
+    struct _mp_gc_arena_t *base; // first chunk of the arena
+    uintptr_t next_inv;
+    size_t cur; // next free byte
+    size_t last; // most recent allocation, or 0 if it can't be resized in place
+    size_t end;
+} mp_gc_arena_t;
+#endif
+
+#if MICROPY_GC_TLAB
+// A thread's allocation buffer: blocks from cur up to end are each already
+// marked as the head of a one-block allocation and are handed out by the
+// thread.  A collection retires every buffer on the list by moving cur to
+// end, so cur is only ever changed with an atomic operation.
+typedef struct _mp_gc_tlab_t {
+    struct _mp_gc_tlab_t *next;
+    byte *cur;
+    byte *end;
+} mp_gc_tlab_t;
+#endif
+
+#if MICROPY_GC_ALLOC_PROFILE
+// Allocations sampled at one line of source code.
+typedef struct _mp_gc_alloc_profile_entry_t {
+    qstr source_file;
+    qstr block_name;
+    size_t source_line;
+    size_t count; // number of sampled allocations
+    size_t n_bytes; // total size of the sampled allocations
+} mp_gc_alloc_profile_entry_t;
+#endif
+
+#if MICROPY_GC_STATS
+// The history of collections kept for gc.stats().  Amounts are in blocks.
+typedef struct _mp_gc_stats_t {
+    size_t collections; // completed collections
+    size_t pauses; // also counts each step of an incremental collection
+    uint32_t pause_min_us;
+    uint32_t pause_max_us;
+    uint32_t pause_last_us;
+    uint64_t pause_total_us;
+    mp_uint_t pause_start_us;
+    size_t marked; // blocks in use after the last sweep
+    size_t swept; // blocks freed by the last sweep
+    size_t in_use; // blocks in use now, counted as they change
+    size_t peak; // most blocks in use at once
+    size_t alloc; // blocks allocated since the last collection started
+    #if MICROPY_GC_POOL
+    size_t pool_kept; // dead objects kept for reuse by the last sweep
+    size_t pool_reused; // objects reused from the pool
+    #endif
+    size_t cycle_alloc; // blocks allocated between the starts of the last two collections
+    mp_uint_t cycle_ms; // time between the starts of the last two collections
+    mp_uint_t cycle_start_ms;
+} mp_gc_stats_t;
+#endif
+
+#if MICROPY_SAMPLING_PROFILE
+// A stack counted by the sampling profile, innermost frame first.  Holding
+// the bytecode keeps its function's names alive until the profile is dumped.
+typedef struct _mp_prof_sample_entry_t {
+    const byte *bytecode[MICROPY_SAMPLING_PROFILE_DEPTH];
+    size_t source_line[MICROPY_SAMPLING_PROFILE_DEPTH];
+    uint16_t depth;
+    bool truncated; // outer frames were cut
+    size_t count;
+} mp_prof_sample_entry_t;
+#endif
+
+#if MICROPY_VM_OPCODE_STATS
+// Consecutive opcodes (first << 8 | second), and binary ops by the names of
+// the types of their operands, counted by py/vmstats.c.
+typedef struct _mp_vm_stats_pair_t {
+    uint16_t key;
+    size_t count;
+} mp_vm_stats_pair_t;
+
+typedef struct _mp_vm_stats_binop_t {
+    qstr lhs;
+    qstr rhs;
+    byte op;
+    size_t count;
+} mp_vm_stats_binop_t;
+#endif
+
+#if MICROPY_TRACE
+// An event in the trace ring, see py/trace.h.
+typedef struct _mp_trace_entry_t {
+    uint32_t time;
+    uint16_t event;
+    uint16_t arg;
+} mp_trace_entry_t;
+#endif
+
+// This structure hold information about the memory allocation system.
+typedef struct _mp_state_mem_t {
+    #if MICROPY_MEM_STATS
+    size_t total_bytes_allocated;
+    size_t current_bytes_allocated;
+    size_t peak_bytes_allocated;
+    #endif
+
+    // The area passed to gc_init, followed by any areas added with gc_add_region.
+    mp_state_mem_area_t area;
+
     int gc_stack_overflow;
     MICROPY_GC_STACK_ENTRY_TYPE gc_stack[MICROPY_ALLOC_GC_STACK_SIZE];
+    #if MICROPY_GC_SPLIT_HEAP
+    // the area of each block on gc_stack
+    mp_state_mem_area_t *gc_area_stack[MICROPY_ALLOC_GC_STACK_SIZE];
+    #endif
 
     // This variable controls auto garbage collection.  If set to 0 then the
     // GC won't automatically run when gc_alloc can't find enough blocks.  But
@@ -91,18 +255,130 @@ typedef struct _mp_state_mem_t {
     size_t gc_alloc_threshold;
     #endif
 
-    size_t gc_last_free_atb_index;
+    #if MICROPY_GC_GENERATIONAL
+    // State of the generational collector; gc_collect_minor is non-zero while a
+    // minor collection is in progress.
+    uint8_t gc_collect_minor;
+    uint8_t gc_minor_requested;
+    size_t gc_minor_since_major;
+    size_t gc_minor_count;
+    size_t gc_major_count;
+    #endif
+
+    #if MICROPY_GC_INCREMENTAL
+    // State of an incremental collection; the mark stack depth is kept between
+    // steps, and gc_step_* bound the amount of work done in the current step.
+    uint8_t gc_incremental_active;
+    uint8_t gc_step_budgeted;
+    uint8_t gc_step_expired;
+    size_t gc_sp;
+    size_t gc_step_work;
+    mp_uint_t gc_step_start_us;
+    mp_uint_t gc_step_budget_us;
+    #endif
+
+    #if MICROPY_GC_PARALLEL_MARK
+    // State of the parallel mark phase; the pool and gc_parallel_* are shared
+    // by the workers and only accessed with gc_parallel_lock held.
+    uint8_t gc_parallel_active;
+    volatile uint8_t gc_parallel_busy;
+    volatile uint8_t gc_parallel_helper_state;
+    mp_gc_mark_stack_t gc_mark_pool;
+    mp_gc_mark_stack_t gc_mark_stacks[2];
+    #endif
+
+    #if MICROPY_GC_COMPACT
+    // The buffers being checked for references by gc_compact, if any.
+    struct _gc_compact_candidate_t *gc_compact_candidates;
+    size_t gc_compact_num_candidates;
+    #endif
+
+    #if MICROPY_GC_ARENA
+    // All arenas that have been started and not yet freed, including ones
+    // that ended while an exception propagated and are left to the GC.
+    mp_gc_arena_t *gc_arena_list;
+    #if MICROPY_GC_ARENA_CHECK
+    // The arena that gc_arena_end is checking, and whether the collection it
+    // does found a pointer into it.
+    mp_gc_arena_t *gc_arena_checked;
+    bool gc_arena_checked_found;
+    #endif
+    #endif
+
+    #if MICROPY_GC_ALLOC_PROFILE
+    // Allocations left until the next sample, the state of the generator of
+    // the random intervals between samples, and the lines sampled so far.
+    size_t gc_alloc_profile_countdown;
+    uint32_t gc_alloc_profile_seed;
+    size_t gc_alloc_profile_len;
+    mp_gc_alloc_profile_entry_t gc_alloc_profile[MICROPY_GC_ALLOC_PROFILE_SIZE];
+    #endif
+
+    #if MICROPY_FLOAT_FREELIST
+    // Floats found dead by the last sweep, reused by mp_obj_new_float; the
+    // list is rebuilt by each sweep so it doesn't need to be a root pointer.
+    struct _gc_float_free_t *float_freelist;
+    size_t float_freelist_len;
+    #endif
+
+    #if MICROPY_GC_POOL
+    // Objects found dead by the last sweep, by their size in blocks, reused
+    // by gc_pool_pop; rebuilt by each sweep like the float free list.  Only
+    // objects of the types that gc_pool_pop has been asked for are kept.
+    struct _gc_pool_free_t *gc_pool[MICROPY_GC_POOL_MAX_BLOCKS];
+    uint8_t gc_pool_len[MICROPY_GC_POOL_MAX_BLOCKS];
+    const mp_obj_type_t *gc_pool_types[MICROPY_GC_POOL_TYPES];
+    size_t gc_pool_num_types;
+    #endif
+
+    #if MICROPY_GC_TLAB
+    // The allocation buffers of all running threads, and the number of blocks
+    // handed out from them.
+    mp_gc_tlab_t *gc_tlab_list;
+    size_t gc_tlab_count;
+    #endif
 
     #if MICROPY_PY_GC_COLLECT_RETVAL
     size_t gc_collected;
     #endif
 
+    #if MICROPY_GC_STATS
+    mp_gc_stats_t gc_stats;
+    #endif
+
     #if MICROPY_PY_THREAD && !MICROPY_PY_THREAD_GIL
-    // This is a global mutex used to make the GC thread-safe.
+    // This is a global mutex used to make the GC thread-safe, and the number
+    // of times it has been taken.
     mp_thread_mutex_t gc_mutex;
+    size_t gc_lock_count;
     #endif
 } mp_state_mem_t;
 
+#if MICROPY_OPT_LOAD_METHOD_CACHE
+// A method found in a class dict by a lookup on an instance of type.  It's
+// kept as the slot of the dict it was found in, so is valid while the dict
+// has the same table and the slot still has the same key.
+typedef struct _mp_method_cache_entry_t {
+    const mp_obj_type_t *type;
+    size_t version; // version of the classes at the time of the lookup
+    mp_map_t *map;
+    mp_map_elem_t *table;
+    size_t index;
+    qstr attr;
+} mp_method_cache_entry_t;
+#endif
+
+#if MICROPY_VFS_IMPORT_STAT_CACHE
+// The result of an import stat of a path within a mounted filesystem.  The path
+// is kept only as its hash and length; vfs is NULL for an unused entry.
+typedef struct _mp_vfs_import_stat_cache_entry_t {
+    struct _mp_vfs_mount_t *vfs;
+    mp_uint_t hash;
+    uint16_t len;
+    uint8_t stat; // an mp_import_stat_t
+} mp_vfs_import_stat_cache_entry_t;
+#endif
+
 // This structure hold runtime and VM information.  It includes a section
 // which contains root pointers that must be scanned by the GC.
 typedef struct _mp_state_vm_t {
@@ -115,6 +391,11 @@ typedef struct _mp_state_vm_t {
 
     qstr_pool_t *last_pool;
 
+    #if MICROPY_QSTR_HASH_INDEX
+    // open-addressed hash table of all qstrs, or NULL if not built
+    struct _qstr_index_t *qstr_index;
+    #endif
+
     // non-heap memory for creating an exception if we can't allocate RAM
     mp_obj_exception_t mp_emergency_exception_obj;
 
@@ -142,6 +423,9 @@ typedef struct _mp_state_vm_t {
 
     #if MICROPY_ENABLE_SCHEDULER
     mp_sched_item_t sched_queue[MICROPY_SCHEDULER_DEPTH];
+    #if MICROPY_SCHEDULER_EVENT_DEPTH
+    mp_sched_event_t sched_event_ring[MICROPY_SCHEDULER_EVENT_DEPTH];
+    #endif
     #endif
 
     // current exception being handled, for sys.exc_info()
@@ -157,6 +441,11 @@ typedef struct _mp_state_vm_t {
     // dictionary for the __main__ module
     mp_obj_dict_t dict_main;
 
+    #if MICROPY_MULTIPLE_INSTANCES
+    // the __main__ module itself, which can't be in ROM with many instances
+    mp_obj_module_t module_main;
+    #endif
+
     // these two lists must be initialised per port, after the call to mp_init
     mp_obj_list_t mp_sys_path_obj;
     mp_obj_list_t mp_sys_argv_obj;
@@ -171,6 +460,11 @@ typedef struct _mp_state_vm_t {
     mp_obj_t track_reloc_code_list;
     #endif
 
+    #if MICROPY_COMP_CONST_IMPORT
+    // constants of other modules for the parser, see mp_parse_const_module
+    mp_obj_dict_t *parse_const_modules;
+    #endif
+
     // include any root pointers defined by a port
     MICROPY_PORT_ROOT_POINTERS
 
@@ -197,6 +491,14 @@ typedef struct _mp_state_vm_t {
     mp_obj_t bluetooth;
     #endif
 
+    #if MICROPY_SAMPLING_PROFILE
+    mp_prof_sample_entry_t prof_sample[MICROPY_SAMPLING_PROFILE_SIZE];
+    #endif
+
+    #if MICROPY_VM_BUDGET
+    mp_obj_t vm_budget_exc;
+    #endif
+
     //
     // END ROOT POINTER SECTION
     ////////////////////////////////////////////////////////////
@@ -207,6 +509,23 @@ typedef struct _mp_state_vm_t {
     size_t qstr_last_alloc;
     size_t qstr_last_used;
 
+    #if MICROPY_QSTR_SNAPSHOT
+    // the loaded qstr snapshot and the pool made from it
+    // (the pool is also reachable from last_pool)
+    const struct _qstr_snapshot_t *qstr_snapshot;
+    qstr_pool_t *qstr_snapshot_pool;
+    #endif
+
+    #if MICROPY_PERSISTENT_CODE_LOAD_MAPPED
+    // set once a str or bytes constant refers to a mapped .mpy file
+    bool persistent_code_mapped;
+    #endif
+
+    #if MICROPY_PY_INTERN_DECODED_KEYS
+    // number of qstrs made by mp_obj_str_intern_key
+    size_t intern_key_count;
+    #endif
+
     #if MICROPY_PY_THREAD && !MICROPY_PY_THREAD_GIL
     // This is a global mutex used to make qstr interning thread-safe.
     mp_thread_mutex_t qstr_mutex;
@@ -214,6 +533,9 @@ typedef struct _mp_state_vm_t {
 
     #if MICROPY_ENABLE_COMPILER
     mp_uint_t mp_optimise_value;
+    #if MICROPY_MODULE_MPY_CACHE
+    bool mpy_cache;
+    #endif
     #if MICROPY_EMIT_NATIVE
     uint8_t default_emit_opt; // one of MP_EMIT_OPT_xxx
     #endif
@@ -228,12 +550,82 @@ typedef struct _mp_state_vm_t {
     volatile int16_t sched_state;
     uint8_t sched_len;
     uint8_t sched_idx;
+    #if MICROPY_SCHEDULER_EVENT_DEPTH
+    // The event ring has a single producer, which only writes head, and a
+    // single consumer (the VM), which only writes tail.
+    volatile uint8_t sched_event_head;
+    volatile uint8_t sched_event_tail;
+    // Number of events that did not fit in the ring and are yet to be folded
+    // into the count of the next queued event, and the total of all such events.
+    mp_uint_t sched_event_coalesced;
+    mp_uint_t sched_event_overflow;
+    #endif
     #endif
 
     #if MICROPY_PY_THREAD_GIL
     // This is a global mutex used to make the VM/runtime thread-safe.
     mp_thread_mutex_t gil_mutex;
     #endif
+
+    #if MICROPY_PY_THREAD_OBJ_LOCK
+    // locks guarding mutable objects, see mp_thread_obj_lock
+    mp_thread_obj_lock_t thread_obj_lock[MICROPY_PY_THREAD_OBJ_LOCK_NUM];
+    #endif
+
+    #if MICROPY_OPT_LOAD_METHOD_CACHE
+    // Version of the classes, which changes when a class is created or has
+    // an attribute stored or deleted, and the cache of method lookups.
+    size_t type_version;
+    mp_method_cache_entry_t method_cache[MICROPY_OPT_LOAD_METHOD_CACHE_SIZE];
+    #endif
+
+    #if MICROPY_OPT_ARG_SLOT_CACHE
+    // hints of the parameter slot of a keyword argument, see mp_arg_slot_cache
+    uint8_t arg_slot_cache[MICROPY_OPT_ARG_SLOT_CACHE_SIZE];
+    #endif
+
+    #if MICROPY_OPT_BOUND_METH_CACHE
+    // Not a root pointer section: the entries are cleared before each sweep.
+    mp_obj_t bound_meth_cache[MICROPY_OPT_BOUND_METH_CACHE_SIZE];
+    #endif
+
+    #if MICROPY_VFS_IMPORT_STAT_CACHE
+    // Not a root pointer section: entries are cleared whenever a mount is removed.
+    mp_vfs_import_stat_cache_entry_t vfs_import_stat_cache[MICROPY_VFS_IMPORT_STAT_CACHE_SIZE];
+    #endif
+
+    #if MICROPY_SAMPLING_PROFILE
+    // Whether samples are taken, ticks per sample and until the next one, and
+    // the number of samples lost because prof_sample was full.
+    volatile bool prof_sample_running;
+    uint16_t prof_sample_period;
+    uint16_t prof_sample_countdown;
+    size_t prof_sample_dropped;
+    #endif
+
+    #if MICROPY_VM_OPCODE_STATS
+    byte vm_stats_prev_opcode;
+    size_t vm_stats_opcode[256];
+    mp_vm_stats_pair_t vm_stats_pair[MICROPY_VM_OPCODE_STATS_PAIRS];
+    mp_vm_stats_binop_t vm_stats_binop[MICROPY_VM_OPCODE_STATS_BINOPS];
+    size_t vm_stats_pair_dropped;
+    size_t vm_stats_binop_dropped;
+    #endif
+
+    #if MICROPY_TRACE
+    // Whether events are recorded, the number of events recorded since the
+    // last reset, and the last MICROPY_TRACE_SIZE of them.
+    volatile bool trace_enabled;
+    uint32_t trace_count;
+    mp_trace_entry_t trace_ring[MICROPY_TRACE_SIZE];
+    #endif
+
+    #if MICROPY_VM_BUDGET
+    // Ticks left until the budget expires, or 0 if there is no budget, and the
+    // host's function called when it expires.
+    mp_int_t vm_budget;
+    bool (*vm_budget_handler)(void);
+    #endif
 } mp_state_vm_t;
 
 // This structure holds state that is specific to a given thread.
@@ -255,6 +647,10 @@ typedef struct _mp_state_thread_t {
     // Locking of the GC is done per thread.
     uint16_t gc_lock_depth;
 
+    #if MICROPY_GC_TLAB
+    mp_gc_tlab_t gc_tlab;
+    #endif
+
     ////////////////////////////////////////////////////////////
     // START ROOT POINTER SECTION
     // Everything that needs GC scanning must start here, and
@@ -266,9 +662,23 @@ typedef struct _mp_state_thread_t {
 
     nlr_buf_t *nlr_top;
 
+    // The value of a StopIteration that an iternext function signalled by
+    // returning MP_OBJ_STOP_ITERATION, see mp_make_stop_iteration().
+    mp_obj_t stop_iteration_arg;
+
+    #if MICROPY_GC_ARENA
+    // The innermost active arena of this thread.
+    mp_gc_arena_t *gc_arena;
+    // Whether allocations come from the heap even though an arena is active.
+    bool gc_arena_suspended;
+    #endif
+
     #if MICROPY_PY_SYS_SETTRACE
     mp_obj_t prof_trace_callback;
     bool prof_callback_is_executing;
+    #endif
+
+    #if MICROPY_TRACK_CODE_STATE
     struct _mp_code_state_t *current_code_state;
     #endif
 } mp_state_thread_t;
@@ -281,7 +691,21 @@ typedef struct _mp_state_ctx_t {
     mp_state_mem_t mem;
 } mp_state_ctx_t;
 
+#if MICROPY_MULTIPLE_INSTANCES
+// Each thread runs the instance that it last selected with mp_state_ctx_set.
+extern MICROPY_STATE_CTX_THREAD_LOCAL mp_state_ctx_t *mp_state_ctx_ptr;
+#define mp_state_ctx (*mp_state_ctx_ptr)
+
+static inline mp_state_ctx_t *mp_state_ctx_get(void) {
+    return mp_state_ctx_ptr;
+}
+
+static inline void mp_state_ctx_set(mp_state_ctx_t *ctx) {
+    mp_state_ctx_ptr = ctx;
+}
+#else
 extern mp_state_ctx_t mp_state_ctx;
+#endif
 
 #define MP_STATE_VM(x) (mp_state_ctx.vm.x)
 #define MP_STATE_MEM(x) (mp_state_ctx.mem.x)
@@ -41,6 +41,11 @@ struct _mp_state_thread_t;
 struct _mp_state_thread_t *mp_thread_get_state(void);
 void mp_thread_set_state(struct _mp_state_thread_t *state);
 void mp_thread_create(void *(*entry)(void *), void *arg, size_t *stack_size);
+#if MICROPY_PY_THREAD_CREATE_EX
+// Create a thread with the given priority and pinned to the given core, where
+// -1 for either means the port's default.
+void mp_thread_create_ex(void *(*entry)(void *), void *arg, size_t *stack_size, int priority, int core);
+#endif
 void mp_thread_start(void);
 void mp_thread_finish(void);
 void mp_thread_mutex_init(mp_thread_mutex_t *mutex);
@@ -49,6 +54,32 @@ void mp_thread_mutex_unlock(mp_thread_mutex_t *mutex);
 
 #endif // MICROPY_PY_THREAD
 
+#if MICROPY_PY_THREAD_OBJ_LOCK
+#include "py/obj.h"
+
+// A lock guarding the storage of mutable objects.  Objects share a fixed
+// table of these, selected by address, and a lock may be taken recursively
+// by the thread that owns it.
+typedef struct _mp_thread_obj_lock_t {
+    struct _mp_state_thread_t *volatile owner;
+    size_t depth;
+} mp_thread_obj_lock_t;
+
+// Returns the depth the lock was held at before, for mp_thread_obj_unlock_to.
+size_t mp_thread_obj_lock(const void *obj);
+void mp_thread_obj_unlock(const void *obj);
+// Restore the lock to the given depth, used when an exception unwinds a
+// region that holds the lock.
+void mp_thread_obj_unlock_to(const void *obj, size_t depth);
+// Call fun(n_args, args) holding the lock of obj, releasing it again if fun raises.
+mp_obj_t mp_thread_obj_call_locked(const void *obj, mp_fun_var_t fun, size_t n_args, const mp_obj_t *args);
+#define MP_THREAD_OBJ_LOCK(obj) mp_thread_obj_lock(obj)
+#define MP_THREAD_OBJ_UNLOCK(obj) mp_thread_obj_unlock(obj)
+#else
+#define MP_THREAD_OBJ_LOCK(obj) (void)0
+#define MP_THREAD_OBJ_UNLOCK(obj) (void)0
+#endif
+
 #if MICROPY_PY_THREAD && MICROPY_PY_THREAD_GIL
 #include "py/mpstate.h"
 #define MP_THREAD_GIL_ENTER() mp_thread_mutex_lock(&MP_STATE_VM(gil_mutex), 1)
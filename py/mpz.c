@@ -457,6 +457,140 @@ STATIC size_t mpn_mul(mpz_dig_t *idig, mpz_dig_t *jdig, size_t jlen, mpz_dig_t *
     return ilen;
 }
 
+#if MICROPY_OPT_MPZ_KARATSUBA_THRESHOLD || MICROPY_OPT_MPZ_POW3_MONTGOMERY
+
+/* computes i += j, where i has ilen digits and j has jlen <= ilen digits
+   the numbers need not be normalised; a carry out of i is discarded
+*/
+STATIC void mpn_add_inpl_fixed(mpz_dig_t *idig, size_t ilen, const mpz_dig_t *jdig, size_t jlen) {
+    mpz_dbl_dig_t carry = 0;
+    for (size_t n = 0; n < ilen && (n < jlen || carry != 0); ++n) {
+        carry += (mpz_dbl_dig_t)idig[n];
+        if (n < jlen) {
+            carry += (mpz_dbl_dig_t)jdig[n];
+        }
+        idig[n] = carry & DIG_MASK;
+        carry >>= DIG_SIZE;
+    }
+}
+
+/* computes i -= j, where i has ilen digits and j has jlen <= ilen digits
+   the numbers need not be normalised; assumes i >= j
+*/
+STATIC void mpn_sub_inpl_fixed(mpz_dig_t *idig, size_t ilen, const mpz_dig_t *jdig, size_t jlen) {
+    mpz_dbl_dig_signed_t borrow = 0;
+    for (size_t n = 0; n < ilen && (n < jlen || borrow != 0); ++n) {
+        borrow += (mpz_dbl_dig_t)idig[n];
+        if (n < jlen) {
+            borrow -= (mpz_dbl_dig_t)jdig[n];
+        }
+        idig[n] = borrow & DIG_MASK;
+        borrow >>= DIG_SIZE;
+    }
+}
+
+#endif
+
+#if MICROPY_OPT_MPZ_KARATSUBA_THRESHOLD
+
+#if MICROPY_OPT_MPZ_KARATSUBA_THRESHOLD < 4
+#error "MICROPY_OPT_MPZ_KARATSUBA_THRESHOLD must be at least 4"
+#endif
+
+/* returns the number of digits of scratch memory needed by mpn_mul_karatsuba
+   for operands of n digits
+*/
+STATIC size_t mpn_karatsuba_scratch_len(size_t n) {
+    size_t len = 0;
+    while (n >= MICROPY_OPT_MPZ_KARATSUBA_THRESHOLD) {
+        n = n - n / 2 + 1;
+        len += 4 * n;
+    }
+    return len;
+}
+
+/* computes i = j * k, where j and k have n digits and i gets all 2n digits
+   the numbers need not be normalised; i, j and k must not overlap
+   needs mpn_karatsuba_scratch_len(n) digits of scratch memory
+*/
+STATIC void mpn_mul_karatsuba(mpz_dig_t *idig, const mpz_dig_t *jdig, const mpz_dig_t *kdig, size_t n, mpz_dig_t *scratch) {
+    if (n < MICROPY_OPT_MPZ_KARATSUBA_THRESHOLD) {
+        memset(idig, 0, 2 * n * sizeof(mpz_dig_t));
+        mpn_mul(idig, (mpz_dig_t *)jdig, n, (mpz_dig_t *)kdig, n);
+        return;
+    }
+
+    // split j and k into a low part of h digits and a high part of l digits
+    size_t h = n / 2;
+    size_t l = n - h;
+
+    // the products of the low parts and of the high parts go straight into i
+    mpn_mul_karatsuba(idig, jdig, kdig, h, scratch);
+    mpn_mul_karatsuba(idig + 2 * h, jdig + h, kdig + h, l, scratch);
+
+    // the middle term is (j0 + j1) * (k0 + k1) - j0 * k0 - j1 * k1
+    mpz_dig_t *jsum = scratch;
+    mpz_dig_t *ksum = jsum + l + 1;
+    mpz_dig_t *mid = ksum + l + 1;
+    memcpy(jsum, jdig + h, l * sizeof(mpz_dig_t));
+    jsum[l] = 0;
+    mpn_add_inpl_fixed(jsum, l + 1, jdig, h);
+    memcpy(ksum, kdig + h, l * sizeof(mpz_dig_t));
+    ksum[l] = 0;
+    mpn_add_inpl_fixed(ksum, l + 1, kdig, h);
+    mpn_mul_karatsuba(mid, jsum, ksum, l + 1, mid + 2 * (l + 1));
+    mpn_sub_inpl_fixed(mid, 2 * (l + 1), idig, 2 * h);
+    mpn_sub_inpl_fixed(mid, 2 * (l + 1), idig + 2 * h, 2 * l);
+
+    // add the middle term to i, shifted up by h digits (h >= 2 so it fits)
+    mpn_add_inpl_fixed(idig + h, 2 * n - h, mid, 2 * (l + 1));
+}
+
+/* computes i = j * k like mpn_mul, for j and k of at least
+   MICROPY_OPT_MPZ_KARATSUBA_THRESHOLD digits; the longer operand is split
+   into pieces the size of the shorter one, which are multiplied by Karatsuba
+   returns number of digits in i
+   assumes enough memory in i; assumes normalised j, k
+*/
+STATIC size_t mpn_mul_big(mpz_dig_t *idig, const mpz_dig_t *jdig, size_t jlen, const mpz_dig_t *kdig, size_t klen) {
+    if (jlen < klen) {
+        const mpz_dig_t *t = jdig;
+        jdig = kdig;
+        kdig = t;
+        size_t tl = jlen;
+        jlen = klen;
+        klen = tl;
+    }
+
+    size_t ilen = jlen + klen;
+    size_t n = klen;
+    size_t scratch_len = mpn_karatsuba_scratch_len(n);
+    mpz_dig_t *prod = m_new(mpz_dig_t, 3 * n + scratch_len);
+    mpz_dig_t *piece = prod + 2 * n;
+
+    memset(idig, 0, ilen * sizeof(mpz_dig_t));
+    for (size_t off = 0; off < jlen; off += n) {
+        const mpz_dig_t *p = jdig + off;
+        if (jlen - off < n) {
+            // the last piece is shorter, so pad it with zeros
+            memcpy(piece, p, (jlen - off) * sizeof(mpz_dig_t));
+            memset(piece + jlen - off, 0, (n - (jlen - off)) * sizeof(mpz_dig_t));
+            p = piece;
+        }
+        mpn_mul_karatsuba(prod, p, kdig, n, piece + n);
+        mpn_add_inpl_fixed(idig + off, ilen - off, prod, MIN(2 * n, ilen - off));
+    }
+
+    m_del(mpz_dig_t, prod, 3 * n + scratch_len);
+
+    while (ilen > 0 && idig[ilen - 1] == 0) {
+        --ilen;
+    }
+    return ilen;
+}
+
+#endif
+
 /* natural_div - quo * den + new_num = old_num (ie num is replaced with rem)
    assumes den != 0
    assumes num_dig has enough memory to be extended by 1 digit
@@ -1305,8 +1439,15 @@ void mpz_mul_inpl(mpz_t *dest, const mpz_t *lhs, const mpz_t *rhs) {
     }
 
     mpz_need_dig(dest, lhs->len + rhs->len); // min mem l+r-1, max mem l+r
-    memset(dest->dig, 0, dest->alloc * sizeof(mpz_dig_t));
-    dest->len = mpn_mul(dest->dig, lhs->dig, lhs->len, rhs->dig, rhs->len);
+    #if MICROPY_OPT_MPZ_KARATSUBA_THRESHOLD
+    if (lhs->len >= MICROPY_OPT_MPZ_KARATSUBA_THRESHOLD && rhs->len >= MICROPY_OPT_MPZ_KARATSUBA_THRESHOLD) {
+        dest->len = mpn_mul_big(dest->dig, lhs->dig, lhs->len, rhs->dig, rhs->len);
+    } else
+    #endif
+    {
+        memset(dest->dig, 0, dest->alloc * sizeof(mpz_dig_t));
+        dest->len = mpn_mul(dest->dig, lhs->dig, lhs->len, rhs->dig, rhs->len);
+    }
 
     if (lhs->neg == rhs->neg) {
         dest->neg = 0;
@@ -1351,6 +1492,183 @@ void mpz_pow_inpl(mpz_t *dest, const mpz_t *lhs, const mpz_t *rhs) {
     mpz_free(n);
 }
 
+#if MICROPY_OPT_MPZ_POW3_MONTGOMERY
+
+// State of Montgomery multiplication modulo m, an odd number of n digits,
+// with R = 2**(n * DIG_SIZE).
+typedef struct _mpn_mont_t {
+    const mpz_dig_t *m;
+    size_t n;
+    mpz_dig_t minv; // -1 / m modulo 2**DIG_SIZE
+    mpz_dig_t *t; // 2n + 1 digits for the product
+    #if MICROPY_OPT_MPZ_KARATSUBA_THRESHOLD
+    mpz_dig_t *scratch;
+    #endif
+} mpn_mont_t;
+
+// computes -1 / d modulo 2**DIG_SIZE, for odd d
+STATIC mpz_dig_t mpn_mont_inverse(mpz_dig_t d) {
+    // d * d = 1 modulo 8, and each Newton step doubles the number of correct bits
+    mpz_dbl_dig_t x = d;
+    for (int i = 0; i < 4; ++i) {
+        x = (x * (2 - (mpz_dbl_dig_t)d * x)) & DIG_MASK;
+    }
+    return (0 - x) & DIG_MASK;
+}
+
+/* computes r = a * b / R modulo m, for a, b < m of n digits
+   r gets n digits and can be the same as a or b
+*/
+STATIC void mpn_mont_mul(const mpn_mont_t *mt, mpz_dig_t *r, const mpz_dig_t *a, const mpz_dig_t *b) {
+    size_t n = mt->n;
+    mpz_dig_t *t = mt->t;
+
+    #if MICROPY_OPT_MPZ_KARATSUBA_THRESHOLD
+    if (n >= MICROPY_OPT_MPZ_KARATSUBA_THRESHOLD) {
+        mpn_mul_karatsuba(t, a, b, n, mt->scratch);
+    } else
+    #endif
+    {
+        memset(t, 0, 2 * n * sizeof(mpz_dig_t));
+        mpn_mul(t, (mpz_dig_t *)a, n, (mpz_dig_t *)b, n);
+    }
+    t[2 * n] = 0;
+
+    // add multiples of m to clear the low n digits of t, one digit at a time
+    for (size_t i = 0; i < n; ++i) {
+        mpz_dbl_dig_t u = ((mpz_dbl_dig_t)t[i] * mt->minv) & DIG_MASK;
+        mpz_dbl_dig_t carry = 0;
+        for (size_t j = 0; j < n; ++j) {
+            carry += (mpz_dbl_dig_t)t[i + j] + u * mt->m[j]; // will never overflow so long as DIG_SIZE <= 8*sizeof(mpz_dbl_dig_t)/2
+            t[i + j] = carry & DIG_MASK;
+            carry >>= DIG_SIZE;
+        }
+        for (size_t j = i + n; carry != 0; ++j) {
+            carry += t[j];
+            t[j] = carry & DIG_MASK;
+            carry >>= DIG_SIZE;
+        }
+    }
+
+    // the high n + 1 digits of t are now less than 2m, reduce them below m
+    mpz_dig_t *hi = t + n;
+    bool ge = hi[n] != 0;
+    if (!ge) {
+        size_t i = n;
+        while (i > 0 && hi[i - 1] == mt->m[i - 1]) {
+            --i;
+        }
+        ge = i == 0 || hi[i - 1] > mt->m[i - 1];
+    }
+    if (ge) {
+        mpn_sub_inpl_fixed(hi, n + 1, mt->m, n);
+    }
+    memcpy(r, hi, n * sizeof(mpz_dig_t));
+}
+
+STATIC bool mpz_get_bit(const mpz_t *z, size_t bit) {
+    return (z->dig[bit / DIG_SIZE] >> (bit % DIG_SIZE)) & 1;
+}
+
+/* computes dest = (lhs ** rhs) % mod, for odd positive mod and positive rhs
+   can have dest, lhs, rhs the same; mod can't be the same as dest
+*/
+STATIC void mpz_pow3_montgomery(mpz_t *dest, const mpz_t *lhs, const mpz_t *rhs, const mpz_t *mod) {
+    size_t n = mod->len;
+
+    // the base in Montgomery form, x = (lhs % mod) * R % mod
+    mpz_t x, quo;
+    mpz_init_zero(&x);
+    mpz_init_zero(&quo);
+    mpz_divmod_inpl(&quo, &x, lhs, mod);
+    mpz_shl_inpl(&x, &x, n * DIG_SIZE);
+    mpz_divmod_inpl(&quo, &x, &x, mod);
+    mpz_deinit(&quo);
+
+    // choose the size of the window from the number of bits in the exponent
+    size_t nbits = (rhs->len - 1) * DIG_SIZE;
+    for (mpz_dig_t d = rhs->dig[rhs->len - 1]; d != 0; d >>= 1) {
+        ++nbits;
+    }
+    size_t w = nbits > 671 ? 6 : nbits > 239 ? 5 : nbits > 79 ? 4 : nbits > 23 ? 3 : nbits > 6 ? 2 : 1;
+    if (w > MICROPY_OPT_MPZ_POW3_WINDOW) {
+        w = MICROPY_OPT_MPZ_POW3_WINDOW;
+    }
+    size_t ntab = (size_t)1 << (w - 1);
+
+    // the table holds x, x**3, x**5, ... x**(2 * ntab - 1) in Montgomery form
+    mpn_mont_t mt;
+    mt.m = mod->dig;
+    mt.n = n;
+    mt.minv = mpn_mont_inverse(mod->dig[0]);
+    size_t mem_len = (ntab + 1) * n + 2 * n + 1;
+    #if MICROPY_OPT_MPZ_KARATSUBA_THRESHOLD
+    mem_len += mpn_karatsuba_scratch_len(n);
+    #endif
+    mpz_dig_t *tab = m_new(mpz_dig_t, mem_len);
+    mpz_dig_t *acc = tab + ntab * n;
+    mt.t = acc + n;
+    #if MICROPY_OPT_MPZ_KARATSUBA_THRESHOLD
+    mt.scratch = mt.t + 2 * n + 1;
+    #endif
+    memset(tab, 0, n * sizeof(mpz_dig_t));
+    memcpy(tab, x.dig, x.len * sizeof(mpz_dig_t));
+    mpz_deinit(&x);
+    if (ntab > 1) {
+        mpn_mont_mul(&mt, acc, tab, tab);
+        for (size_t i = 1; i < ntab; ++i) {
+            mpn_mont_mul(&mt, tab + i * n, tab + (i - 1) * n, acc);
+        }
+    }
+
+    // go through the exponent from the top bit, taking runs of up to w bits
+    // that start and end with a 1 bit
+    bool started = false;
+    size_t i = nbits;
+    while (i > 0) {
+        if (!mpz_get_bit(rhs, i - 1)) {
+            mpn_mont_mul(&mt, acc, acc, acc);
+            --i;
+            continue;
+        }
+        size_t low = i > w ? i - w : 0;
+        while (!mpz_get_bit(rhs, low)) {
+            ++low;
+        }
+        size_t val = 0;
+        for (size_t j = i; j > low; --j) {
+            val = val << 1 | mpz_get_bit(rhs, j - 1);
+            if (started) {
+                mpn_mont_mul(&mt, acc, acc, acc);
+            }
+        }
+        if (started) {
+            mpn_mont_mul(&mt, acc, acc, tab + (val >> 1) * n);
+        } else {
+            memcpy(acc, tab + (val >> 1) * n, n * sizeof(mpz_dig_t));
+            started = true;
+        }
+        i = low;
+    }
+
+    // take the result out of Montgomery form by multiplying it by 1
+    memset(tab, 0, n * sizeof(mpz_dig_t));
+    tab[0] = 1;
+    mpn_mont_mul(&mt, acc, acc, tab);
+
+    mpz_need_dig(dest, n);
+    memcpy(dest->dig, acc, n * sizeof(mpz_dig_t));
+    dest->len = n;
+    while (dest->len > 0 && dest->dig[dest->len - 1] == 0) {
+        --dest->len;
+    }
+    dest->neg = 0;
+
+    m_del(mpz_dig_t, tab, mem_len);
+}
+
+#endif
+
 /* computes dest = (lhs ** rhs) % mod
    can have dest, lhs, rhs the same; mod can't be the same as dest
 */
@@ -1366,6 +1684,13 @@ void mpz_pow3_inpl(mpz_t *dest, const mpz_t *lhs, const mpz_t *rhs, const mpz_t
         return;
     }
 
+    #if MICROPY_OPT_MPZ_POW3_MONTGOMERY
+    if (!mod->neg && (mod->dig[0] & 1) != 0) {
+        mpz_pow3_montgomery(dest, lhs, rhs, mod);
+        return;
+    }
+    #endif
+
     mpz_t *x = mpz_clone(lhs);
     mpz_t *n = mpz_clone(rhs);
     mpz_t quo;
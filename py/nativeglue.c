@@ -25,6 +25,7 @@
  */
 
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
@@ -60,6 +61,10 @@ int mp_native_type_from_qstr(qstr qst) {
             return MP_NATIVE_TYPE_PTR16;
         case MP_QSTR_ptr32:
             return MP_NATIVE_TYPE_PTR32;
+        #if MICROPY_PY_BUILTINS_FLOAT
+        case MP_QSTR_ptr32f:
+            return MP_NATIVE_TYPE_PTR32F;
+        #endif
         default:
             return -1;
     }
@@ -76,6 +81,15 @@ mp_uint_t mp_native_from_obj(mp_obj_t obj, mp_uint_t type) {
         case MP_NATIVE_TYPE_INT:
         case MP_NATIVE_TYPE_UINT:
             return mp_obj_get_int_truncated(obj);
+        #if MICROPY_PY_BUILTINS_FLOAT
+        case MP_NATIVE_TYPE_FLOAT32: {
+            union { uint32_t i;
+                    float f;
+            } fpu;
+            fpu.f = mp_obj_get_float_to_f(obj);
+            return fpu.i;
+        }
+        #endif
         default: { // cast obj to a pointer
             mp_buffer_info_t bufinfo;
             if (mp_get_buffer(obj, &bufinfo, MP_BUFFER_READ)) {
@@ -104,6 +118,14 @@ mp_obj_t mp_native_to_obj(mp_uint_t val, mp_uint_t type) {
             return mp_obj_new_int(val);
         case MP_NATIVE_TYPE_UINT:
             return mp_obj_new_int_from_uint(val);
+        #if MICROPY_PY_BUILTINS_FLOAT
+        case MP_NATIVE_TYPE_FLOAT32: {
+            union { uint32_t i;
+                    float f;
+            } fpu = {val};
+            return mp_obj_new_float_from_f(fpu.f);
+        }
+        #endif
         default: // a pointer
             // we return just the value of the pointer as an integer
             return mp_obj_new_int_from_uint(val);
@@ -227,6 +249,62 @@ STATIC bool mp_native_yield_from(mp_obj_t gen, mp_obj_t send_value, mp_obj_t *re
     return false;
 }
 
+// The loops are kept simple so that the C compiler can vectorise them for the
+// target where it's able to, for example with SSE on x86-64
+#define VIPER_VEC_CASES(size_log2, T) \
+    case MP_NATIVE_VEC_ADD << 2 | (size_log2): { \
+        T *dst = (T *)arg1; \
+        const T *src = (const T *)arg2; \
+        for (mp_int_t i = 0; i < (mp_int_t)arg3; ++i) { \
+            dst[i] += src[i]; \
+        } \
+        return (mp_uint_t)mp_const_none; \
+    } \
+    case MP_NATIVE_VEC_MAC << 2 | (size_log2): { \
+        const T *a = (const T *)arg1; \
+        const T *b = (const T *)arg2; \
+        mp_uint_t acc = 0; \
+        for (mp_int_t i = 0; i < (mp_int_t)arg3; ++i) { \
+            acc += (mp_uint_t)a[i] * b[i]; \
+        } \
+        return acc; \
+    } \
+    case MP_NATIVE_VEC_SUM << 2 | (size_log2): { \
+        const T *src = (const T *)arg1; \
+        mp_uint_t acc = 0; \
+        for (mp_int_t i = 0; i < (mp_int_t)arg2; ++i) { \
+            acc += src[i]; \
+        } \
+        return acc; \
+    } \
+    case MP_NATIVE_VEC_MINMAX << 2 | (size_log2): { \
+        const T *src = (const T *)arg1; \
+        if ((mp_int_t)arg2 <= 0) { \
+            mp_raise_ValueError(MP_ERROR_TEXT("arg is an empty sequence")); \
+        } \
+        T min = src[0], max = src[0]; \
+        for (mp_int_t i = 1; i < (mp_int_t)arg2; ++i) { \
+            min = src[i] < min ? src[i] : min; \
+            max = src[i] > max ? src[i] : max; \
+        } \
+        mp_obj_t items[2] = {mp_obj_new_int_from_uint(min), mp_obj_new_int_from_uint(max)}; \
+        return (mp_uint_t)mp_obj_new_tuple(2, items); \
+    }
+
+// Implements the viper vector intrinsics over arrays of unsigned 8, 16 or 32
+// bit elements, the same as loading and storing them through ptr8/16/32
+STATIC mp_uint_t mp_native_viper_vec(mp_uint_t op, mp_uint_t arg1, mp_uint_t arg2, mp_uint_t arg3) {
+    MP_STATIC_ASSERT(offsetof(mp_fun_table_t, viper_vec) == MP_F_VIPER_VEC * sizeof(void *));
+    switch (op) {
+        VIPER_VEC_CASES(0, uint8_t)
+        VIPER_VEC_CASES(1, uint16_t)
+        VIPER_VEC_CASES(2, uint32_t)
+        default:
+            assert(0);
+            return 0;
+    }
+}
+
 #if !MICROPY_PY_BUILTINS_FLOAT
 
 STATIC mp_obj_t mp_obj_new_float_from_f(float f) {
@@ -342,6 +420,8 @@ const mp_fun_table_t mp_fun_table = {
     &mp_stream_readinto_obj,
     &mp_stream_unbuffered_readline_obj,
     &mp_stream_write_obj,
+    // Additional entries for native code, starts at index 80
+    mp_native_viper_vec,
 };
 
 #endif // MICROPY_EMIT_NATIVE
@@ -82,9 +82,18 @@ typedef enum {
     MP_F_SMALL_INT_MODULO,
     MP_F_NATIVE_YIELD_FROM,
     MP_F_SETJMP,
+    // Entries after the ones for the dynamic runtime, see mp_fun_table_t
+    MP_F_VIPER_VEC = 80,
     MP_F_NUMBER_OF,
 } mp_fun_kind_t;
 
+// Operations of the viper vector intrinsics, combined with the log2 of the
+// element size in bytes as (op << 2 | log2_size)
+#define MP_NATIVE_VEC_ADD (0) // vadd(dst, src, n): dst[i] += src[i]
+#define MP_NATIVE_VEC_MAC (1) // vmac(a, b, n): sum of a[i] * b[i]
+#define MP_NATIVE_VEC_SUM (2) // vsum(src, n): sum of src[i]
+#define MP_NATIVE_VEC_MINMAX (3) // vminmax(src, n): (min, max) of src[i]
+
 typedef struct _mp_fun_table_t {
     mp_const_obj_t const_none;
     mp_const_obj_t const_false;
@@ -170,6 +179,8 @@ typedef struct _mp_fun_table_t {
     const mp_obj_fun_builtin_var_t *stream_readinto_obj;
     const mp_obj_fun_builtin_var_t *stream_unbuffered_readline_obj;
     const mp_obj_fun_builtin_var_t *stream_write_obj;
+    // Additional entries for native code, starts at index 80
+    mp_uint_t (*viper_vec)(mp_uint_t op, mp_uint_t arg1, mp_uint_t arg2, mp_uint_t arg3);
 } mp_fun_table_t;
 
 extern const mp_fun_table_t mp_fun_table;
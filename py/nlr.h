@@ -42,6 +42,7 @@
 #define MICROPY_NLR_NUM_REGS_AARCH64        (13)
 #define MICROPY_NLR_NUM_REGS_XTENSA         (10)
 #define MICROPY_NLR_NUM_REGS_XTENSAWIN      (17)
+#define MICROPY_NLR_NUM_REGS_RV32I          (14)
 
 // *FORMAT-OFF*
 
@@ -79,6 +80,9 @@
 #elif defined(__xtensa__)
     #define MICROPY_NLR_XTENSA (1)
     #define MICROPY_NLR_NUM_REGS (MICROPY_NLR_NUM_REGS_XTENSA)
+#elif defined(__riscv) && __riscv_xlen == 32
+    #define MICROPY_NLR_RV32I (1)
+    #define MICROPY_NLR_NUM_REGS (MICROPY_NLR_NUM_REGS_RV32I)
 #elif defined(__powerpc__)
     #define MICROPY_NLR_POWERPC (1)
     // this could be less but using 128 for safety
@@ -0,0 +1,89 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "py/mpstate.h" // needed for NLR defs
+
+#if MICROPY_NLR_RV32I
+
+// RISC-V callee-saved registers are s0-s11, plus sp, and ra is needed to return.
+// They are stored in the order ra, s0-s11, sp, the same as newlib's setjmp.
+
+// Implemented purely as inline assembly, so there is no prologue that would
+// change sp and ra before they are saved.
+__asm(
+    ".text                   \n"
+    ".align 2                \n"
+    ".global nlr_push        \n"
+    "nlr_push:               \n"
+    "sw ra,   8(a0)          \n" // 8 == offsetof(nlr_buf_t, regs)
+    "sw s0,  12(a0)          \n"
+    "sw s1,  16(a0)          \n"
+    "sw s2,  20(a0)          \n"
+    "sw s3,  24(a0)          \n"
+    "sw s4,  28(a0)          \n"
+    "sw s5,  32(a0)          \n"
+    "sw s6,  36(a0)          \n"
+    "sw s7,  40(a0)          \n"
+    "sw s8,  44(a0)          \n"
+    "sw s9,  48(a0)          \n"
+    "sw s10, 52(a0)          \n"
+    "sw s11, 56(a0)          \n"
+    "sw sp,  60(a0)          \n"
+    "j nlr_push_tail         \n" // do the rest in C
+    );
+
+NORETURN void nlr_jump(void *val) {
+    MP_NLR_JUMP_HEAD(val, top)
+
+    MP_STATIC_ASSERT(offsetof(nlr_buf_t, regs) == 8); // asm assumes it
+
+    __asm volatile (
+        "mv a0, %0               \n" // a0 points to nlr_buf
+        "lw ra,   8(a0)          \n" // restore regs...
+        "lw s0,  12(a0)          \n"
+        "lw s1,  16(a0)          \n"
+        "lw s2,  20(a0)          \n"
+        "lw s3,  24(a0)          \n"
+        "lw s4,  28(a0)          \n"
+        "lw s5,  32(a0)          \n"
+        "lw s6,  36(a0)          \n"
+        "lw s7,  40(a0)          \n"
+        "lw s8,  44(a0)          \n"
+        "lw s9,  48(a0)          \n"
+        "lw s10, 52(a0)          \n"
+        "lw s11, 56(a0)          \n"
+        "lw sp,  60(a0)          \n"
+        "li a0, 1                \n" // return 1, non-local return
+        "ret                     \n"
+        :                           // output operands
+        : "r" (top)                 // input operands
+        :                           // clobbered registers
+        );
+
+    MP_UNREACHABLE
+}
+
+#endif // MICROPY_NLR_RV32I
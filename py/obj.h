@@ -409,7 +409,8 @@ typedef struct _mp_map_t {
     size_t all_keys_are_qstrs : 1;
     size_t is_fixed : 1;    // if set, table is fixed/read-only and can't be modified
     size_t is_ordered : 1;  // if set, table is an ordered array, not a hash map
-    size_t used : (8 * sizeof(size_t) - 3);
+    size_t copy_on_write : 1; // if set, the fixed table is copied to the heap when written to
+    size_t used : (8 * sizeof(size_t) - 4);
     size_t alloc;
     mp_map_elem_t *table;
 } mp_map_t;
@@ -430,10 +431,26 @@ static inline bool mp_map_slot_is_filled(const mp_map_t *map, size_t pos) {
 void mp_map_init(mp_map_t *map, size_t n);
 void mp_map_init_fixed_table(mp_map_t *map, size_t n, const mp_obj_t *table);
 mp_map_t *mp_map_new(size_t n);
+void mp_map_copy(mp_map_t *dest, const mp_map_t *src);
+#if MICROPY_MODULE_FROZEN_ROM_GLOBALS
+void mp_map_make_writable(mp_map_t *map);
+#endif
 void mp_map_deinit(mp_map_t *map);
 void mp_map_free(mp_map_t *map);
 mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t lookup_kind);
 void mp_map_clear(mp_map_t *map);
+// Store value under index, which must not be a fixed map.
+#if MICROPY_PY_THREAD_OBJ_LOCK
+void mp_map_store(mp_map_t *map, mp_obj_t index, mp_obj_t value);
+#else
+static inline void mp_map_store(mp_map_t *map, mp_obj_t index, mp_obj_t value) {
+    mp_map_lookup(map, index, MP_MAP_LOOKUP_ADD_IF_NOT_FOUND)->value = value;
+}
+#endif
+// Look up index and return the value of its slot, or MP_OBJ_NULL if there's
+// none.  A removed slot has its value cleared, and an added slot that has no
+// value yet is given value.
+mp_obj_t mp_map_lookup_value(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t lookup_kind, mp_obj_t value);
 void mp_map_dump(mp_map_t *map);
 
 // Underlying set implementation (not set object)
@@ -610,6 +627,7 @@ extern const mp_obj_type_t mp_type_map; // map (the python builtin, not the dict
 extern const mp_obj_type_t mp_type_enumerate;
 extern const mp_obj_type_t mp_type_filter;
 extern const mp_obj_type_t mp_type_deque;
+extern const mp_obj_type_t mp_type_intdict;
 extern const mp_obj_type_t mp_type_dict;
 extern const mp_obj_type_t mp_type_ordereddict;
 extern const mp_obj_type_t mp_type_range;
@@ -628,6 +646,8 @@ extern const mp_obj_type_t mp_type_fun_builtin_2;
 extern const mp_obj_type_t mp_type_fun_builtin_3;
 extern const mp_obj_type_t mp_type_fun_builtin_var;
 extern const mp_obj_type_t mp_type_fun_bc;
+extern const mp_obj_type_t mp_type_closure;
+extern const mp_obj_type_t mp_type_bound_meth;
 extern const mp_obj_type_t mp_type_module;
 extern const mp_obj_type_t mp_type_staticmethod;
 extern const mp_obj_type_t mp_type_classmethod;
@@ -762,6 +782,7 @@ mp_obj_t mp_obj_new_dict(size_t n_args);
 mp_obj_t mp_obj_new_set(size_t n_args, mp_obj_t *items);
 mp_obj_t mp_obj_new_slice(mp_obj_t start, mp_obj_t stop, mp_obj_t step);
 mp_obj_t mp_obj_new_bound_meth(mp_obj_t meth, mp_obj_t self);
+mp_obj_t mp_obj_bound_meth_unpack(mp_obj_t bound_meth, mp_obj_t *self); // returns the method
 mp_obj_t mp_obj_new_getitem_iter(mp_obj_t *args, mp_obj_iter_buf_t *iter_buf);
 mp_obj_t mp_obj_new_module(qstr module_name);
 mp_obj_t mp_obj_new_memoryview(byte typecode, size_t nitems, void *items);
@@ -833,6 +854,11 @@ const char *mp_obj_str_get_str(mp_obj_t self_in); // use this only if you need t
 const char *mp_obj_str_get_data(mp_obj_t self_in, size_t *len);
 mp_obj_t mp_obj_str_intern(mp_obj_t str);
 mp_obj_t mp_obj_str_intern_checked(mp_obj_t obj);
+#if MICROPY_PY_INTERN_DECODED_KEYS
+mp_obj_t mp_obj_str_intern_key(mp_obj_t key);
+#else
+#define mp_obj_str_intern_key(key) (key)
+#endif
 void mp_str_print_quoted(const mp_print_t *print, const byte *str_data, size_t str_len, bool is_bytes);
 
 #if MICROPY_PY_BUILTINS_FLOAT
@@ -106,11 +106,22 @@ STATIC mp_obj_array_t *array_new(char typecode, size_t n) {
     o->typecode = typecode;
     o->free = 0;
     o->len = n;
-    o->items = m_new(byte, typecode_size * o->len);
+    if (typecode == 'O' || typecode == 'P' || typecode == 'S') {
+        // items that are pointers must keep what they refer to alive
+        o->items = m_new(byte, typecode_size * o->len);
+    } else {
+        o->items = m_new_no_scan(byte, typecode_size * o->len);
+    }
     return o;
 }
 #endif
 
+#if MICROPY_PY_ARRAY && MICROPY_PY_ARRAY_KERNELS
+mp_obj_t mp_obj_new_array(char typecode, size_t n) {
+    return MP_OBJ_FROM_PTR(array_new(typecode, n));
+}
+#endif
+
 #if MICROPY_PY_BUILTINS_BYTEARRAY || MICROPY_PY_ARRAY
 STATIC mp_obj_t array_construct(char typecode, mp_obj_t initializer) {
     // bytearrays can be raw-initialised from anything with the buffer protocol
@@ -236,15 +247,93 @@ STATIC mp_obj_t memoryview_make_new(const mp_obj_type_t *type_in, size_t n_args,
     return MP_OBJ_FROM_PTR(self);
 }
 
-#if MICROPY_PY_BUILTINS_MEMORYVIEW_ITEMSIZE
+#if MICROPY_PY_BUILTINS_MEMORYVIEW_SPLIT
+// memoryview.split(sep, maxsplit=-1) is like bytes.split(sep, maxsplit), but
+// returns an iterator that yields each part as a memoryview of the original
+// buffer, so nothing is copied.
+
+typedef struct _mp_obj_memoryview_split_it_t {
+    mp_obj_base_t base;
+    mp_obj_array_t *view;
+    mp_obj_t sep;
+    mp_int_t splits;
+    size_t pos; // start of the next part, or past the end when done
+} mp_obj_memoryview_split_it_t;
+
+STATIC mp_obj_t memoryview_split_it_iternext(mp_obj_t self_in) {
+    mp_obj_memoryview_split_it_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_obj_array_t *view = self->view;
+    if (self->pos > view->len) {
+        return MP_OBJ_STOP_ITERATION;
+    }
+    const byte *buf = (const byte *)view->items + view->memview_offset;
+    mp_buffer_info_t sep;
+    mp_get_buffer_raise(self->sep, &sep, MP_BUFFER_READ);
+    const byte *p = NULL;
+    if (self->splits != 0) {
+        p = find_subbytes(buf + self->pos, view->len - self->pos, sep.buf, sep.len, 1);
+    }
+    size_t end = p == NULL ? view->len : (size_t)(p - buf);
+    mp_obj_array_t *res = m_new_obj(mp_obj_array_t);
+    *res = *view;
+    res->memview_offset += self->pos;
+    res->len = end - self->pos;
+    if (p == NULL) {
+        self->pos = view->len + 1;
+    } else {
+        self->pos = end + sep.len;
+        if (self->splits > 0) {
+            self->splits--;
+        }
+    }
+    return MP_OBJ_FROM_PTR(res);
+}
+
+STATIC const mp_obj_type_t mp_type_memoryview_split_it = {
+    { &mp_type_type },
+    .name = MP_QSTR_iterator,
+    .getiter = mp_identity_getiter,
+    .iternext = memoryview_split_it_iternext,
+};
+
+STATIC mp_obj_t memoryview_split(size_t n_args, const mp_obj_t *args) {
+    mp_obj_array_t *self = MP_OBJ_TO_PTR(args[0]);
+    if (mp_binary_get_size('@', self->typecode & TYPECODE_MASK, NULL) != 1) {
+        mp_raise_TypeError(MP_ERROR_TEXT("memoryview of bytes required"));
+    }
+    mp_buffer_info_t sep;
+    mp_get_buffer_raise(args[1], &sep, MP_BUFFER_READ);
+    if (sep.len == 0) {
+        mp_raise_ValueError(MP_ERROR_TEXT("empty separator"));
+    }
+    mp_obj_memoryview_split_it_t *o = m_new_obj(mp_obj_memoryview_split_it_t);
+    o->base.type = &mp_type_memoryview_split_it;
+    o->view = self;
+    o->sep = args[1];
+    o->splits = n_args > 2 ? mp_obj_get_int(args[2]) : -1;
+    o->pos = 0;
+    return MP_OBJ_FROM_PTR(o);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(memoryview_split_obj, 2, 3, memoryview_split);
+#endif
+
+#if MICROPY_PY_BUILTINS_MEMORYVIEW_ITEMSIZE || MICROPY_PY_BUILTINS_MEMORYVIEW_SPLIT
 STATIC void memoryview_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest) {
     if (dest[0] != MP_OBJ_NULL) {
         return;
     }
+    #if MICROPY_PY_BUILTINS_MEMORYVIEW_ITEMSIZE
     if (attr == MP_QSTR_itemsize) {
         mp_obj_array_t *self = MP_OBJ_TO_PTR(self_in);
         dest[0] = MP_OBJ_NEW_SMALL_INT(mp_binary_get_size('@', self->typecode & TYPECODE_MASK, NULL));
     }
+    #endif
+    #if MICROPY_PY_BUILTINS_MEMORYVIEW_SPLIT
+    if (attr == MP_QSTR_split) {
+        dest[0] = MP_OBJ_FROM_PTR(&memoryview_split_obj);
+        dest[1] = self_in;
+    }
+    #endif
 }
 #endif
 
@@ -616,7 +705,7 @@ const mp_obj_type_t mp_type_memoryview = {
     .getiter = array_iterator_new,
     .unary_op = array_unary_op,
     .binary_op = array_binary_op,
-    #if MICROPY_PY_BUILTINS_MEMORYVIEW_ITEMSIZE
+    #if MICROPY_PY_BUILTINS_MEMORYVIEW_ITEMSIZE || MICROPY_PY_BUILTINS_MEMORYVIEW_SPLIT
     .attr = memoryview_attr,
     #endif
     .subscr = array_subscr,
@@ -49,6 +49,11 @@ typedef struct _mp_obj_array_t {
     void *items;
 } mp_obj_array_t;
 
+#if MICROPY_PY_ARRAY_KERNELS
+// Create an array of n uninitialised elements
+mp_obj_t mp_obj_new_array(char typecode, size_t n);
+#endif
+
 #if MICROPY_PY_BUILTINS_MEMORYVIEW
 static inline void mp_obj_memoryview_init(mp_obj_array_t *self, size_t typecode, size_t offset, size_t len, void *items) {
     self->base.type = &mp_type_memoryview;
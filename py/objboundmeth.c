@@ -78,6 +78,29 @@ mp_obj_t mp_call_method_self_n_kw(mp_obj_t meth, mp_obj_t self, size_t n_args, s
     return res;
 }
 
+#if MICROPY_CPYTHON_COMPAT || MICROPY_OPT_BOUND_METH_CACHE
+STATIC mp_obj_t bound_meth_binary_op(mp_binary_op_t op, mp_obj_t lhs_in, mp_obj_t rhs_in) {
+    // Bound methods of the same method of the same instance are equal, so it
+    // doesn't matter whether the cache returned the same object for both.
+    if (op != MP_BINARY_OP_EQUAL || !mp_obj_is_type(rhs_in, &mp_type_bound_meth)) {
+        return MP_OBJ_NULL; // op not supported
+    }
+    mp_obj_bound_meth_t *lhs = MP_OBJ_TO_PTR(lhs_in);
+    mp_obj_bound_meth_t *rhs = MP_OBJ_TO_PTR(rhs_in);
+    return mp_obj_new_bool(lhs->self == rhs->self && mp_obj_equal(lhs->meth, rhs->meth));
+}
+
+STATIC mp_obj_t bound_meth_unary_op(mp_unary_op_t op, mp_obj_t self_in) {
+    mp_obj_bound_meth_t *self = MP_OBJ_TO_PTR(self_in);
+    switch (op) {
+        case MP_UNARY_OP_HASH:
+            return MP_OBJ_NEW_SMALL_INT(((mp_uint_t)self->self ^ (mp_uint_t)self->meth) >> 2);
+        default:
+            return MP_OBJ_NULL; // op not supported
+    }
+}
+#endif
+
 STATIC mp_obj_t bound_meth_call(mp_obj_t self_in, size_t n_args, size_t n_kw, const mp_obj_t *args) {
     mp_obj_bound_meth_t *self = MP_OBJ_TO_PTR(self_in);
     return mp_call_method_self_n_kw(self->meth, self->self, n_args, n_kw, args);
@@ -95,22 +118,50 @@ STATIC void bound_meth_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest) {
 }
 #endif
 
-STATIC const mp_obj_type_t mp_type_bound_meth = {
+const mp_obj_type_t mp_type_bound_meth = {
     { &mp_type_type },
     .name = MP_QSTR_bound_method,
     #if MICROPY_ERROR_REPORTING == MICROPY_ERROR_REPORTING_DETAILED
     .print = bound_meth_print,
     #endif
     .call = bound_meth_call,
+    #if MICROPY_CPYTHON_COMPAT || MICROPY_OPT_BOUND_METH_CACHE
+    .unary_op = bound_meth_unary_op,
+    .binary_op = bound_meth_binary_op,
+    #endif
     #if MICROPY_PY_FUNCTION_ATTRS
     .attr = bound_meth_attr,
     #endif
 };
 
 mp_obj_t mp_obj_new_bound_meth(mp_obj_t meth, mp_obj_t self) {
+    #if MICROPY_OPT_BOUND_METH_CACHE
+    size_t hash = ((uintptr_t)self >> 3) ^ ((uintptr_t)meth >> 2);
+    mp_obj_t *entry = &MP_STATE_VM(bound_meth_cache)[hash & (MICROPY_OPT_BOUND_METH_CACHE_SIZE - 1)];
+    if (*entry != MP_OBJ_NULL) {
+        mp_obj_bound_meth_t *o = MP_OBJ_TO_PTR(*entry);
+        if (o->meth == meth && o->self == self) {
+            return *entry;
+        }
+    }
+    #endif
     mp_obj_bound_meth_t *o = m_new_obj(mp_obj_bound_meth_t);
     o->base.type = &mp_type_bound_meth;
     o->meth = meth;
     o->self = self;
+    #if MICROPY_OPT_BOUND_METH_CACHE && MICROPY_GC_ARENA
+    // a bound method in an arena is freed with the arena, behind the cache's back
+    if (MP_STATE_THREAD(gc_arena) == NULL) {
+        *entry = MP_OBJ_FROM_PTR(o);
+    }
+    #elif MICROPY_OPT_BOUND_METH_CACHE
+    *entry = MP_OBJ_FROM_PTR(o);
+    #endif
     return MP_OBJ_FROM_PTR(o);
 }
+
+mp_obj_t mp_obj_bound_meth_unpack(mp_obj_t bound_meth, mp_obj_t *self) {
+    mp_obj_bound_meth_t *o = MP_OBJ_TO_PTR(bound_meth);
+    *self = o->self;
+    return o->meth;
+}
@@ -28,6 +28,7 @@
 
 #include "py/obj.h"
 #include "py/runtime.h"
+#include "py/bc.h"
 
 typedef struct _mp_obj_closure_t {
     mp_obj_base_t base;
@@ -59,6 +60,33 @@ STATIC mp_obj_t closure_call(mp_obj_t self_in, size_t n_args, size_t n_kw, const
     }
 }
 
+#if MICROPY_STACKLESS
+mp_obj_t mp_obj_closure_get_fun(mp_obj_t self_in) {
+    mp_obj_closure_t *self = MP_OBJ_TO_PTR(self_in);
+    return self->fun;
+}
+
+// The VM calls a closure of a bytecode function without recursing, by
+// running the code state made here.  It holds copies of the arguments, so
+// the concatenated array isn't needed once the code state is made.
+mp_code_state_t *mp_obj_closure_prepare_codestate(mp_obj_t self_in, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_obj_closure_t *self = MP_OBJ_TO_PTR(self_in);
+    size_t n_total = self->n_closed + n_args + 2 * n_kw;
+    mp_obj_t args_stack[5];
+    mp_obj_t *args2 = args_stack;
+    if (n_total > MP_ARRAY_SIZE(args_stack)) {
+        args2 = m_new(mp_obj_t, n_total);
+    }
+    memcpy(args2, self->closed, self->n_closed * sizeof(mp_obj_t));
+    memcpy(args2 + self->n_closed, args, (n_args + 2 * n_kw) * sizeof(mp_obj_t));
+    mp_code_state_t *code_state = mp_obj_fun_bc_prepare_codestate(self->fun, self->n_closed + n_args, n_kw, args2);
+    if (args2 != args_stack) {
+        m_del(mp_obj_t, args2, n_total);
+    }
+    return code_state;
+}
+#endif
+
 #if MICROPY_ERROR_REPORTING == MICROPY_ERROR_REPORTING_DETAILED
 STATIC void closure_print(const mp_print_t *print, mp_obj_t o_in, mp_print_kind_t kind) {
     (void)kind;
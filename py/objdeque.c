@@ -24,35 +24,144 @@
  * THE SOFTWARE.
  */
 
-#include <unistd.h> // for ssize_t
 #include <string.h>
 
 #include "py/mpconfig.h"
 #if MICROPY_PY_COLLECTIONS_DEQUE
 
 #include "py/runtime.h"
+#include "py/gc.h"
+#include "py/binary.h"
 
+// The items are kept in a ring of alloc = maxlen + 1 slots, with i_get the
+// index of the leftmost item and i_put that of the free slot after the
+// rightmost one, so the deque is empty when i_get == i_put.  A typed deque
+// stores numbers in a packed array like array.array does, and keeps the sum
+// of its items up to date as they are added and removed.
 typedef struct _mp_obj_deque_t {
     mp_obj_base_t base;
     size_t alloc;
     size_t i_get;
     size_t i_put;
-    mp_obj_t *items;
+    void *items;
     uint32_t flags;
     #define FLAG_CHECK_OVERFLOW 1
+    #if MICROPY_PY_COLLECTIONS_DEQUE_TYPED
+    char typecode; // 0 for a deque of objects
+    uint8_t item_size;
+    union {
+        long long i;
+        #if MICROPY_PY_BUILTINS_FLOAT
+        mp_float_t f;
+        #endif
+    } sum;
+    #endif
 } mp_obj_deque_t;
 
-STATIC mp_obj_t deque_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
-    mp_arg_check_num(n_args, n_kw, 2, 3, false);
+#if MICROPY_PY_COLLECTIONS_DEQUE_TYPED
+#define DEQUE_IS_TYPED(self) ((self)->typecode != 0)
+#else
+#define DEQUE_IS_TYPED(self) (false)
+#endif
 
-    /* Initialization from existing sequence is not supported, so an empty
-       tuple must be passed as such. */
-    if (args[0] != mp_const_empty_tuple) {
-        mp_raise_ValueError(NULL);
+STATIC mp_obj_t mp_obj_deque_append(mp_obj_t self_in, mp_obj_t arg);
+
+STATIC size_t deque_len(const mp_obj_deque_t *self) {
+    size_t len = self->i_put - self->i_get;
+    if (self->i_put < self->i_get) {
+        len += self->alloc;
+    }
+    return len;
+}
+
+// Return the index in the ring of the item at position i from the left.
+STATIC size_t deque_ring_index(const mp_obj_deque_t *self, size_t i) {
+    i += self->i_get;
+    if (i >= self->alloc) {
+        i -= self->alloc;
+    }
+    return i;
+}
+
+STATIC size_t deque_ring_next(const mp_obj_deque_t *self, size_t i) {
+    return i + 1 == self->alloc ? 0 : i + 1;
+}
+
+STATIC size_t deque_ring_prev(const mp_obj_deque_t *self, size_t i) {
+    return (i == 0 ? self->alloc : i) - 1;
+}
+
+#if MICROPY_PY_COLLECTIONS_DEQUE_TYPED
+STATIC void deque_sum_update(mp_obj_deque_t *self, size_t i, bool add) {
+    const byte *p = (const byte *)self->items + i * self->item_size;
+    #if MICROPY_PY_BUILTINS_FLOAT
+    if (self->typecode == 'f' || self->typecode == 'd') {
+        mp_float_t v = self->typecode == 'f' ? (mp_float_t)*(const float *)p : (mp_float_t)*(const double *)p;
+        self->sum.f += add ? v : -v;
+        return;
+    }
+    #endif
+    // lower case typecodes are the signed ones
+    long long v = mp_binary_get_int(self->item_size, self->typecode >= 'a', MP_ENDIANNESS_BIG, p);
+    self->sum.i += add ? v : -v;
+}
+#endif
+
+STATIC mp_obj_t deque_load(mp_obj_deque_t *self, size_t i) {
+    #if MICROPY_PY_COLLECTIONS_DEQUE_TYPED
+    if (DEQUE_IS_TYPED(self)) {
+        return mp_binary_get_val_array(self->typecode, self->items, i);
+    }
+    #endif
+    return ((mp_obj_t *)self->items)[i];
+}
+
+// Store an item into a free slot of the ring.
+STATIC void deque_store(mp_obj_deque_t *self, size_t i, mp_obj_t value) {
+    #if MICROPY_PY_COLLECTIONS_DEQUE_TYPED
+    if (DEQUE_IS_TYPED(self)) {
+        mp_binary_set_val_array(self->typecode, self->items, i, value);
+        deque_sum_update(self, i, true);
+        return;
+    }
+    #endif
+    ((mp_obj_t *)self->items)[i] = value;
+    MP_GC_WRITE_BARRIER(self->items);
+}
+
+// Free the slot of an item that is removed from the ring.
+STATIC void deque_free(mp_obj_deque_t *self, size_t i) {
+    #if MICROPY_PY_COLLECTIONS_DEQUE_TYPED
+    if (DEQUE_IS_TYPED(self)) {
+        deque_sum_update(self, i, false);
+        return;
+    }
+    #endif
+    // don't keep the item alive
+    ((mp_obj_t *)self->items)[i] = MP_OBJ_NULL;
+}
+
+STATIC void deque_check_overflow(mp_obj_deque_t *self) {
+    if (self->flags & FLAG_CHECK_OVERFLOW && deque_ring_next(self, self->i_put) == self->i_get) {
+        mp_raise_msg(&mp_type_IndexError, MP_ERROR_TEXT("full"));
     }
+}
+
+STATIC mp_obj_t deque_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    enum { ARG_iterable, ARG_maxlen, ARG_flags, ARG_typecode };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_iterable, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+        { MP_QSTR_maxlen, MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_flags, MP_ARG_INT, {.u_int = 0} },
+        #if MICROPY_PY_COLLECTIONS_DEQUE_TYPED
+        { MP_QSTR_typecode, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+        #endif
+    };
+    mp_arg_val_t parsed[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all_kw_array(n_args, n_kw, args, MP_ARRAY_SIZE(allowed_args), allowed_args, parsed);
 
     // Protect against -1 leading to zero-length allocation and bad array access
-    mp_int_t maxlen = mp_obj_get_int(args[1]);
+    mp_int_t maxlen = parsed[ARG_maxlen].u_int;
     if (maxlen < 0) {
         mp_raise_ValueError(NULL);
     }
@@ -61,30 +170,79 @@ STATIC mp_obj_t deque_make_new(const mp_obj_type_t *type, size_t n_args, size_t
     o->base.type = type;
     o->alloc = maxlen + 1;
     o->i_get = o->i_put = 0;
-    o->items = m_new0(mp_obj_t, o->alloc);
+    o->flags = parsed[ARG_flags].u_int;
 
-    if (n_args > 2) {
-        o->flags = mp_obj_get_int(args[2]);
+    #if MICROPY_PY_COLLECTIONS_DEQUE_TYPED
+    o->typecode = 0;
+    o->sum.i = 0;
+    #if MICROPY_PY_BUILTINS_FLOAT
+    o->sum.f = 0;
+    #endif
+    if (parsed[ARG_typecode].u_obj != mp_const_none) {
+        size_t len;
+        const char *typecode = mp_obj_str_get_data(parsed[ARG_typecode].u_obj, &len);
+        #if MICROPY_PY_BUILTINS_FLOAT
+        const char *allowed = "bBhHiIlLqQfd";
+        #else
+        const char *allowed = "bBhHiIlLqQ";
+        #endif
+        if (len != 1 || strchr(allowed, typecode[0]) == NULL) {
+            mp_raise_ValueError(MP_ERROR_TEXT("bad typecode"));
+        }
+        o->typecode = typecode[0];
+        o->item_size = mp_binary_get_size('@', o->typecode, NULL);
+        o->items = m_new0(byte, o->alloc * o->item_size);
+    } else
+    #endif
+    {
+        o->items = m_new0(mp_obj_t, o->alloc);
+    }
+
+    if (parsed[ARG_iterable].u_obj != mp_const_empty_tuple) {
+        mp_obj_t iter = mp_getiter(parsed[ARG_iterable].u_obj, NULL);
+        mp_obj_t item;
+        while ((item = mp_iternext(iter)) != MP_OBJ_STOP_ITERATION) {
+            mp_obj_deque_append(MP_OBJ_FROM_PTR(o), item);
+        }
     }
 
     return MP_OBJ_FROM_PTR(o);
 }
 
+STATIC void deque_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
+    mp_obj_deque_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_print_str(print, "deque([");
+    for (size_t i = 0, len = deque_len(self); i < len; ++i) {
+        if (i > 0) {
+            mp_print_str(print, ", ");
+        }
+        mp_obj_print_helper(print, deque_load(self, deque_ring_index(self, i)), PRINT_REPR);
+    }
+    mp_printf(print, "], maxlen=%u", (uint)(self->alloc - 1));
+    #if MICROPY_PY_COLLECTIONS_DEQUE_TYPED
+    if (DEQUE_IS_TYPED(self)) {
+        mp_printf(print, ", typecode='%c'", self->typecode);
+    }
+    #endif
+    mp_print_str(print, ")");
+}
+
 STATIC mp_obj_t deque_unary_op(mp_unary_op_t op, mp_obj_t self_in) {
     mp_obj_deque_t *self = MP_OBJ_TO_PTR(self_in);
     switch (op) {
         case MP_UNARY_OP_BOOL:
             return mp_obj_new_bool(self->i_get != self->i_put);
-        case MP_UNARY_OP_LEN: {
-            ssize_t len = self->i_put - self->i_get;
-            if (len < 0) {
-                len += self->alloc;
-            }
-            return MP_OBJ_NEW_SMALL_INT(len);
-        }
+        case MP_UNARY_OP_LEN:
+            return MP_OBJ_NEW_SMALL_INT(deque_len(self));
         #if MICROPY_PY_SYS_GETSIZEOF
         case MP_UNARY_OP_SIZEOF: {
-            size_t sz = sizeof(*self) + sizeof(mp_obj_t) * self->alloc;
+            size_t item_size = sizeof(mp_obj_t);
+            #if MICROPY_PY_COLLECTIONS_DEQUE_TYPED
+            if (DEQUE_IS_TYPED(self)) {
+                item_size = self->item_size;
+            }
+            #endif
+            size_t sz = sizeof(*self) + item_size * self->alloc;
             return MP_OBJ_NEW_SMALL_INT(sz);
         }
         #endif
@@ -93,65 +251,229 @@ STATIC mp_obj_t deque_unary_op(mp_unary_op_t op, mp_obj_t self_in) {
     }
 }
 
-STATIC mp_obj_t mp_obj_deque_append(mp_obj_t self_in, mp_obj_t arg) {
+#if MICROPY_PY_COLLECTIONS_DEQUE_SUBSCR
+STATIC mp_obj_t deque_subscr(mp_obj_t self_in, mp_obj_t index, mp_obj_t value) {
+    if (value == MP_OBJ_NULL) {
+        // delete not supported
+        return MP_OBJ_NULL;
+    }
     mp_obj_deque_t *self = MP_OBJ_TO_PTR(self_in);
-
-    size_t new_i_put = self->i_put + 1;
-    if (new_i_put == self->alloc) {
-        new_i_put = 0;
+    size_t i = deque_ring_index(self, mp_get_index(self->base.type, deque_len(self), index, false));
+    if (value == MP_OBJ_SENTINEL) {
+        // load
+        return deque_load(self, i);
+    } else {
+        // store
+        #if MICROPY_PY_COLLECTIONS_DEQUE_TYPED
+        if (DEQUE_IS_TYPED(self)) {
+            // convert the value into the free slot first, as that may fail
+            deque_store(self, self->i_put, value);
+            deque_free(self, i);
+            memcpy((byte *)self->items + i * self->item_size,
+                (byte *)self->items + self->i_put * self->item_size, self->item_size);
+            return mp_const_none;
+        }
+        #endif
+        ((mp_obj_t *)self->items)[i] = value;
+        MP_GC_WRITE_BARRIER(self->items);
+        return mp_const_none;
     }
+}
+#endif
 
-    if (self->flags & FLAG_CHECK_OVERFLOW && new_i_put == self->i_get) {
-        mp_raise_msg(&mp_type_IndexError, MP_ERROR_TEXT("full"));
+#if MICROPY_PY_COLLECTIONS_DEQUE_ITER
+typedef struct _mp_obj_deque_it_t {
+    mp_obj_base_t base;
+    mp_fun_1_t iternext;
+    mp_obj_t deque;
+    size_t cur;
+} mp_obj_deque_it_t;
+
+STATIC mp_obj_t deque_it_iternext(mp_obj_t self_in) {
+    mp_obj_deque_it_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_obj_deque_t *deque = MP_OBJ_TO_PTR(self->deque);
+    if (self->cur < deque_len(deque)) {
+        return deque_load(deque, deque_ring_index(deque, self->cur++));
+    } else {
+        return MP_OBJ_STOP_ITERATION;
     }
+}
 
-    self->items[self->i_put] = arg;
-    self->i_put = new_i_put;
+STATIC mp_obj_t deque_getiter(mp_obj_t o_in, mp_obj_iter_buf_t *iter_buf) {
+    assert(sizeof(mp_obj_deque_it_t) <= sizeof(mp_obj_iter_buf_t));
+    mp_obj_deque_it_t *o = (mp_obj_deque_it_t *)iter_buf;
+    o->base.type = &mp_type_polymorph_iter;
+    o->iternext = deque_it_iternext;
+    o->deque = o_in;
+    o->cur = 0;
+    return MP_OBJ_FROM_PTR(o);
+}
+#endif
 
-    if (self->i_get == new_i_put) {
-        if (++self->i_get == self->alloc) {
-            self->i_get = 0;
-        }
+STATIC mp_obj_t mp_obj_deque_append(mp_obj_t self_in, mp_obj_t arg) {
+    mp_obj_deque_t *self = MP_OBJ_TO_PTR(self_in);
+    deque_check_overflow(self);
+
+    // There is always a free slot at i_put, so the item is stored before
+    // anything is dropped, in case it can't be converted to the typecode.
+    deque_store(self, self->i_put, arg);
+    self->i_put = deque_ring_next(self, self->i_put);
+
+    if (self->i_get == self->i_put) {
+        // full, so drop the leftmost item
+        deque_free(self, self->i_get);
+        self->i_get = deque_ring_next(self, self->i_get);
     }
 
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(deque_append_obj, mp_obj_deque_append);
 
-STATIC mp_obj_t deque_popleft(mp_obj_t self_in) {
+STATIC mp_obj_t deque_appendleft(mp_obj_t self_in, mp_obj_t arg) {
     mp_obj_deque_t *self = MP_OBJ_TO_PTR(self_in);
+    deque_check_overflow(self);
+
+    size_t new_i_get = deque_ring_prev(self, self->i_get);
+    deque_store(self, new_i_get, arg);
+    self->i_get = new_i_get;
 
     if (self->i_get == self->i_put) {
-        mp_raise_msg(&mp_type_IndexError, MP_ERROR_TEXT("empty"));
+        // full, so drop the rightmost item
+        self->i_put = deque_ring_prev(self, self->i_put);
+        deque_free(self, self->i_put);
     }
 
-    mp_obj_t ret = self->items[self->i_get];
-    self->items[self->i_get] = MP_OBJ_NULL;
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(deque_appendleft_obj, deque_appendleft);
+
+STATIC mp_obj_t deque_extend_helper(mp_obj_t self_in, mp_obj_t arg_in, mp_fun_2_t add) {
+    if (arg_in == self_in) {
+        // take a copy so the iteration isn't disturbed by the items added
+        arg_in = mp_obj_new_tuple(deque_len(MP_OBJ_TO_PTR(self_in)), NULL);
+        mp_obj_tuple_t *t = MP_OBJ_TO_PTR(arg_in);
+        for (size_t i = 0; i < t->len; ++i) {
+            mp_obj_deque_t *self = MP_OBJ_TO_PTR(self_in);
+            t->items[i] = deque_load(self, deque_ring_index(self, i));
+        }
+    }
+    mp_obj_t iter = mp_getiter(arg_in, NULL);
+    mp_obj_t item;
+    while ((item = mp_iternext(iter)) != MP_OBJ_STOP_ITERATION) {
+        add(self_in, item);
+    }
+    return mp_const_none;
+}
+
+STATIC mp_obj_t deque_extend(mp_obj_t self_in, mp_obj_t arg_in) {
+    return deque_extend_helper(self_in, arg_in, mp_obj_deque_append);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(deque_extend_obj, deque_extend);
+
+STATIC mp_obj_t deque_extendleft(mp_obj_t self_in, mp_obj_t arg_in) {
+    return deque_extend_helper(self_in, arg_in, deque_appendleft);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(deque_extendleft_obj, deque_extendleft);
 
-    if (++self->i_get == self->alloc) {
-        self->i_get = 0;
+STATIC void deque_check_empty(mp_obj_deque_t *self) {
+    if (self->i_get == self->i_put) {
+        mp_raise_msg(&mp_type_IndexError, MP_ERROR_TEXT("empty"));
     }
+}
 
+STATIC mp_obj_t deque_popleft(mp_obj_t self_in) {
+    mp_obj_deque_t *self = MP_OBJ_TO_PTR(self_in);
+    deque_check_empty(self);
+    mp_obj_t ret = deque_load(self, self->i_get);
+    deque_free(self, self->i_get);
+    self->i_get = deque_ring_next(self, self->i_get);
     return ret;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(deque_popleft_obj, deque_popleft);
 
-#if 0
+STATIC mp_obj_t deque_pop(mp_obj_t self_in) {
+    mp_obj_deque_t *self = MP_OBJ_TO_PTR(self_in);
+    deque_check_empty(self);
+    self->i_put = deque_ring_prev(self, self->i_put);
+    mp_obj_t ret = deque_load(self, self->i_put);
+    deque_free(self, self->i_put);
+    return ret;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(deque_pop_obj, deque_pop);
+
+STATIC mp_obj_t deque_rotate(size_t n_args, const mp_obj_t *args) {
+    mp_obj_deque_t *self = MP_OBJ_TO_PTR(args[0]);
+    mp_int_t len = deque_len(self);
+    if (len == 0) {
+        return mp_const_none;
+    }
+    mp_int_t n = n_args > 1 ? mp_obj_get_int(args[1]) : 1;
+    // steps to the right, taking the shorter way round
+    n %= len;
+    if (n < 0) {
+        n += len;
+    }
+    if (n <= len / 2) {
+        while (n--) {
+            mp_obj_t item = deque_pop(args[0]);
+            deque_appendleft(args[0], item);
+        }
+    } else {
+        for (n = len - n; n--;) {
+            mp_obj_t item = deque_popleft(args[0]);
+            mp_obj_deque_append(args[0], item);
+        }
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(deque_rotate_obj, 1, 2, deque_rotate);
+
 STATIC mp_obj_t deque_clear(mp_obj_t self_in) {
     mp_obj_deque_t *self = MP_OBJ_TO_PTR(self_in);
     self->i_get = self->i_put = 0;
-    mp_seq_clear(self->items, 0, self->alloc, sizeof(*self->items));
+    #if MICROPY_PY_COLLECTIONS_DEQUE_TYPED
+    if (DEQUE_IS_TYPED(self)) {
+        self->sum.i = 0;
+        #if MICROPY_PY_BUILTINS_FLOAT
+        self->sum.f = 0;
+        #endif
+        return mp_const_none;
+    }
+    #endif
+    mp_seq_clear((mp_obj_t *)self->items, 0, self->alloc, sizeof(mp_obj_t));
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(deque_clear_obj, deque_clear);
+
+#if MICROPY_PY_COLLECTIONS_DEQUE_TYPED
+// The sum of the items of a typed deque, kept as they are added and removed.
+STATIC mp_obj_t deque_sum(mp_obj_t self_in) {
+    mp_obj_deque_t *self = MP_OBJ_TO_PTR(self_in);
+    if (!DEQUE_IS_TYPED(self)) {
+        mp_raise_TypeError(MP_ERROR_TEXT("deque has no typecode"));
+    }
+    #if MICROPY_PY_BUILTINS_FLOAT
+    if (self->typecode == 'f' || self->typecode == 'd') {
+        return mp_obj_new_float(self->sum.f);
+    }
+    #endif
+    return mp_obj_new_int_from_ll(self->sum.i);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(deque_sum_obj, deque_sum);
 #endif
 
 STATIC const mp_rom_map_elem_t deque_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_append), MP_ROM_PTR(&deque_append_obj) },
-    #if 0
+    { MP_ROM_QSTR(MP_QSTR_appendleft), MP_ROM_PTR(&deque_appendleft_obj) },
     { MP_ROM_QSTR(MP_QSTR_clear), MP_ROM_PTR(&deque_clear_obj) },
-    #endif
+    { MP_ROM_QSTR(MP_QSTR_extend), MP_ROM_PTR(&deque_extend_obj) },
+    { MP_ROM_QSTR(MP_QSTR_extendleft), MP_ROM_PTR(&deque_extendleft_obj) },
+    { MP_ROM_QSTR(MP_QSTR_pop), MP_ROM_PTR(&deque_pop_obj) },
     { MP_ROM_QSTR(MP_QSTR_popleft), MP_ROM_PTR(&deque_popleft_obj) },
+    { MP_ROM_QSTR(MP_QSTR_rotate), MP_ROM_PTR(&deque_rotate_obj) },
+    #if MICROPY_PY_COLLECTIONS_DEQUE_TYPED
+    { MP_ROM_QSTR(MP_QSTR_sum), MP_ROM_PTR(&deque_sum_obj) },
+    #endif
 };
 
 STATIC MP_DEFINE_CONST_DICT(deque_locals_dict, deque_locals_dict_table);
@@ -159,8 +481,15 @@ STATIC MP_DEFINE_CONST_DICT(deque_locals_dict, deque_locals_dict_table);
 const mp_obj_type_t mp_type_deque = {
     { &mp_type_type },
     .name = MP_QSTR_deque,
+    .print = deque_print,
     .make_new = deque_make_new,
     .unary_op = deque_unary_op,
+    #if MICROPY_PY_COLLECTIONS_DEQUE_SUBSCR
+    .subscr = deque_subscr,
+    #endif
+    #if MICROPY_PY_COLLECTIONS_DEQUE_ITER
+    .getiter = deque_getiter,
+    #endif
     .locals_dict = (mp_obj_dict_t *)&deque_locals_dict,
 };
 
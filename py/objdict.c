@@ -51,19 +51,22 @@ STATIC mp_obj_t dict_update(size_t n_args, const mp_obj_t *args, mp_map_t *kwarg
 // the iteration is held in *cur and should be initialised with zero for the
 // first call.  Will return NULL when no more elements are available.
 STATIC mp_map_elem_t *dict_iter_next(mp_obj_dict_t *dict, size_t *cur) {
-    size_t max = dict->map.alloc;
     mp_map_t *map = &dict->map;
+    mp_map_elem_t *elem = NULL;
+    MP_THREAD_OBJ_LOCK(map);
+    size_t max = map->alloc;
 
     size_t i = *cur;
     for (; i < max; i++) {
         if (mp_map_slot_is_filled(map, i)) {
             *cur = i + 1;
-            return &(map->table[i]);
+            elem = &(map->table[i]);
+            break;
         }
     }
 
-    assert(map->used == 0 || i == max);
-    return NULL;
+    MP_THREAD_OBJ_UNLOCK(map);
+    return elem;
 }
 
 STATIC void dict_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
@@ -104,7 +107,7 @@ mp_obj_t mp_obj_dict_make_new(const mp_obj_type_t *type, size_t n_args, size_t n
     mp_obj_t dict_out = mp_obj_new_dict(0);
     mp_obj_dict_t *dict = MP_OBJ_TO_PTR(dict_out);
     dict->base.type = type;
-    #if MICROPY_PY_COLLECTIONS_ORDEREDDICT
+    #if MICROPY_PY_COLLECTIONS_ORDEREDDICT && !MICROPY_OPT_MAP_COMPACT
     if (type == &mp_type_ordereddict) {
         dict->map.is_ordered = 1;
     }
@@ -220,8 +223,14 @@ STATIC mp_obj_t dict_subscr(mp_obj_t self_in, mp_obj_t index, mp_obj_t value) {
 /******************************************************************************/
 /* dict methods                                                               */
 
-STATIC void mp_ensure_not_fixed(const mp_obj_dict_t *dict) {
+STATIC void mp_ensure_not_fixed(mp_obj_dict_t *dict) {
     if (dict->map.is_fixed) {
+        #if MICROPY_MODULE_FROZEN_ROM_GLOBALS
+        if (dict->map.copy_on_write) {
+            mp_map_make_writable(&dict->map);
+            return;
+        }
+        #endif
         mp_raise_TypeError(NULL);
     }
 }
@@ -240,14 +249,10 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_1(dict_clear_obj, dict_clear);
 mp_obj_t mp_obj_dict_copy(mp_obj_t self_in) {
     mp_check_self(mp_obj_is_dict_or_ordereddict(self_in));
     mp_obj_dict_t *self = MP_OBJ_TO_PTR(self_in);
-    mp_obj_t other_out = mp_obj_new_dict(self->map.alloc);
+    mp_obj_t other_out = mp_obj_new_dict(0);
     mp_obj_dict_t *other = MP_OBJ_TO_PTR(other_out);
     other->base.type = self->base.type;
-    other->map.used = self->map.used;
-    other->map.all_keys_are_qstrs = self->map.all_keys_are_qstrs;
-    other->map.is_fixed = 0;
-    other->map.is_ordered = self->map.is_ordered;
-    memcpy(other->map.table, self->map.table, self->map.alloc * sizeof(mp_map_elem_t));
+    mp_map_copy(&other->map, &self->map);
     return other_out;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(dict_copy_obj, mp_obj_dict_copy);
@@ -290,26 +295,15 @@ STATIC mp_obj_t dict_get_helper(size_t n_args, const mp_obj_t *args, mp_map_look
     if (lookup_kind != MP_MAP_LOOKUP) {
         mp_ensure_not_fixed(self);
     }
-    mp_map_elem_t *elem = mp_map_lookup(&self->map, args[1], lookup_kind);
-    mp_obj_t value;
-    if (elem == NULL || elem->value == MP_OBJ_NULL) {
-        if (n_args == 2) {
-            if (lookup_kind == MP_MAP_LOOKUP_REMOVE_IF_FOUND) {
-                nlr_raise(mp_obj_new_exception_arg1(&mp_type_KeyError, args[1]));
-            } else {
-                value = mp_const_none;
-            }
-        } else {
-            value = args[2];
-        }
-        if (lookup_kind == MP_MAP_LOOKUP_ADD_IF_NOT_FOUND) {
-            elem->value = value;
-        }
-    } else {
-        value = elem->value;
-        if (lookup_kind == MP_MAP_LOOKUP_REMOVE_IF_FOUND) {
-            elem->value = MP_OBJ_NULL; // so that GC can collect the deleted value
+    // the value is read and written under the same lookup, so that another
+    // thread can't change the slot in between
+    mp_obj_t deflt = n_args == 3 ? args[2] : mp_const_none;
+    mp_obj_t value = mp_map_lookup_value(&self->map, args[1], lookup_kind, deflt);
+    if (value == MP_OBJ_NULL) {
+        if (n_args == 2 && lookup_kind == MP_MAP_LOOKUP_REMOVE_IF_FOUND) {
+            nlr_raise(mp_obj_new_exception_arg1(&mp_type_KeyError, args[1]));
         }
+        value = deflt;
     }
     return value;
 }
@@ -333,9 +327,18 @@ STATIC mp_obj_t dict_popitem(mp_obj_t self_in) {
     mp_check_self(mp_obj_is_dict_or_ordereddict(self_in));
     mp_obj_dict_t *self = MP_OBJ_TO_PTR(self_in);
     mp_ensure_not_fixed(self);
+    MP_THREAD_OBJ_LOCK(&self->map);
     if (self->map.used == 0) {
+        MP_THREAD_OBJ_UNLOCK(&self->map);
         mp_raise_msg(&mp_type_KeyError, MP_ERROR_TEXT("popitem(): dictionary is empty"));
     }
+    #if MICROPY_OPT_MAP_COMPACT
+    // entries are in insertion order, so take the last one like CPython does
+    size_t cur = self->map.alloc;
+    while (!mp_map_slot_is_filled(&self->map, --cur)) {
+    }
+    mp_map_elem_t *next = &self->map.table[cur];
+    #else
     size_t cur = 0;
     #if MICROPY_PY_COLLECTIONS_ORDEREDDICT
     if (self->map.is_ordered) {
@@ -344,10 +347,12 @@ STATIC mp_obj_t dict_popitem(mp_obj_t self_in) {
     #endif
     mp_map_elem_t *next = dict_iter_next(self, &cur);
     assert(next);
+    #endif
     self->map.used--;
     mp_obj_t items[] = {next->key, next->value};
     next->key = MP_OBJ_SENTINEL; // must mark key as sentinel to indicate that it was deleted
     next->value = MP_OBJ_NULL;
+    MP_THREAD_OBJ_UNLOCK(&self->map);
     mp_obj_t tuple = mp_obj_new_tuple(2, items);
 
     return tuple;
@@ -370,7 +375,7 @@ STATIC mp_obj_t dict_update(size_t n_args, const mp_obj_t *args, mp_map_t *kwarg
                 size_t cur = 0;
                 mp_map_elem_t *elem = NULL;
                 while ((elem = dict_iter_next((mp_obj_dict_t *)MP_OBJ_TO_PTR(args[1]), &cur)) != NULL) {
-                    mp_map_lookup(&self->map, elem->key, MP_MAP_LOOKUP_ADD_IF_NOT_FOUND)->value = elem->value;
+                    mp_map_store(&self->map, elem->key, elem->value);
                 }
             }
         } else {
@@ -387,7 +392,7 @@ STATIC mp_obj_t dict_update(size_t n_args, const mp_obj_t *args, mp_map_t *kwarg
                     || stop != MP_OBJ_STOP_ITERATION) {
                     mp_raise_ValueError(MP_ERROR_TEXT("dict update sequence has wrong length"));
                 } else {
-                    mp_map_lookup(&self->map, key, MP_MAP_LOOKUP_ADD_IF_NOT_FOUND)->value = value;
+                    mp_map_store(&self->map, key, value);
                 }
             }
         }
@@ -396,7 +401,7 @@ STATIC mp_obj_t dict_update(size_t n_args, const mp_obj_t *args, mp_map_t *kwarg
     // update the dict with any keyword args
     for (size_t i = 0; i < kwargs->alloc; i++) {
         if (mp_map_slot_is_filled(kwargs, i)) {
-            mp_map_lookup(&self->map, kwargs->table[i].key, MP_MAP_LOOKUP_ADD_IF_NOT_FOUND)->value = kwargs->table[i].value;
+            mp_map_store(&self->map, kwargs->table[i].key, kwargs->table[i].value);
         }
     }
 
@@ -625,13 +630,22 @@ size_t mp_obj_dict_len(mp_obj_t self_in) {
 mp_obj_t mp_obj_dict_store(mp_obj_t self_in, mp_obj_t key, mp_obj_t value) {
     mp_check_self(mp_obj_is_dict_or_ordereddict(self_in));
     mp_obj_dict_t *self = MP_OBJ_TO_PTR(self_in);
+    #if MICROPY_MODULE_FROZEN_ROM_GLOBALS
+    if (self->map.copy_on_write) {
+        // storing the value that's already there doesn't need a copy
+        mp_map_elem_t *elem = mp_map_lookup(&self->map, key, MP_MAP_LOOKUP);
+        if (elem != NULL && elem->value == value) {
+            return self_in;
+        }
+    }
+    #endif
     mp_ensure_not_fixed(self);
-    mp_map_lookup(&self->map, key, MP_MAP_LOOKUP_ADD_IF_NOT_FOUND)->value = value;
+    mp_map_store(&self->map, key, value);
     return self_in;
 }
 
 mp_obj_t mp_obj_dict_delete(mp_obj_t self_in, mp_obj_t key) {
     mp_obj_t args[2] = {self_in, key};
-    dict_get_helper(2, args, MP_MAP_LOOKUP_REMOVE_IF_FOUND);
+    dict_pop(2, args);
     return self_in;
 }
@@ -30,6 +30,7 @@
 #include <assert.h>
 #include <stdio.h>
 
+#include "py/bc.h"
 #include "py/objlist.h"
 #include "py/objstr.h"
 #include "py/objtuple.h"
@@ -247,6 +248,13 @@ void mp_obj_exception_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest) {
     if (dest[0] != MP_OBJ_NULL) {
         // store/delete attribute
         if (attr == MP_QSTR___traceback__ && dest[1] == mp_const_none) {
+            #if MICROPY_PREALLOCATED_EXCEPTIONS
+            if (mp_obj_exception_is_preallocated(self)) {
+                // Never has a traceback
+                dest[0] = MP_OBJ_NULL;
+                return;
+            }
+            #endif
             // We allow 'exc.__traceback__ = None' assignment as low-level
             // optimization of pre-allocating exception instance and raising
             // it repeatedly - this avoids memory allocation during raise.
@@ -357,19 +365,61 @@ MP_DEFINE_EXCEPTION(Exception, BaseException)
 
 // *FORMAT-ON*
 
+#if MICROPY_PREALLOCATED_EXCEPTIONS
+
+STATIC const mp_rom_obj_tuple_t oserror_eagain_args = {{&mp_type_tuple}, 1, {MP_ROM_INT(MP_EAGAIN)}};
+STATIC const mp_rom_obj_tuple_t oserror_etimedout_args = {{&mp_type_tuple}, 1, {MP_ROM_INT(MP_ETIMEDOUT)}};
+STATIC const mp_rom_obj_tuple_t oserror_einprogress_args = {{&mp_type_tuple}, 1, {MP_ROM_INT(MP_EINPROGRESS)}};
+STATIC const mp_rom_obj_tuple_t oserror_enoent_args = {{&mp_type_tuple}, 1, {MP_ROM_INT(MP_ENOENT)}};
+
+// These are never modified: the VM doesn't add traceback entries to them, and
+// copies them with mp_obj_exception_copy_preallocated when they need one.
+const mp_obj_exception_t mp_const_preallocated_exceptions[MP_NUM_PREALLOCATED_EXCEPTIONS] = {
+    {{&mp_type_StopIteration}, 0, 0, NULL, (mp_obj_tuple_t *)&mp_const_empty_tuple_obj},
+    {{&mp_type_OSError}, 0, 0, NULL, (mp_obj_tuple_t *)&oserror_eagain_args},
+    {{&mp_type_OSError}, 0, 0, NULL, (mp_obj_tuple_t *)&oserror_etimedout_args},
+    {{&mp_type_OSError}, 0, 0, NULL, (mp_obj_tuple_t *)&oserror_einprogress_args},
+    {{&mp_type_OSError}, 0, 0, NULL, (mp_obj_tuple_t *)&oserror_enoent_args},
+};
+
+// Return a new exception object with the type and args of the given preallocated
+// one, so a traceback can be added to it, or the given one if there's no memory.
+mp_obj_t mp_obj_exception_copy_preallocated(mp_obj_t self_in) {
+    const mp_obj_exception_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_obj_exception_t *o = m_new_obj_maybe(mp_obj_exception_t);
+    if (o == NULL) {
+        return self_in;
+    }
+    o->base.type = self->base.type;
+    o->traceback_data = NULL;
+    o->args = self->args;
+    return MP_OBJ_FROM_PTR(o);
+}
+
+#endif
+
 mp_obj_t mp_obj_new_exception(const mp_obj_type_t *exc_type) {
-    assert(exc_type->make_new == mp_obj_exception_make_new);
-    return mp_obj_exception_make_new(exc_type, 0, 0, NULL);
+    return mp_obj_new_exception_args(exc_type, 0, NULL);
 }
 
 // "Optimized" version for common(?) case of having 1 exception arg
 mp_obj_t mp_obj_new_exception_arg1(const mp_obj_type_t *exc_type, mp_obj_t arg) {
-    assert(exc_type->make_new == mp_obj_exception_make_new);
-    return mp_obj_exception_make_new(exc_type, 1, 0, &arg);
+    return mp_obj_new_exception_args(exc_type, 1, &arg);
 }
 
 mp_obj_t mp_obj_new_exception_args(const mp_obj_type_t *exc_type, size_t n_args, const mp_obj_t *args) {
     assert(exc_type->make_new == mp_obj_exception_make_new);
+    #if MICROPY_PREALLOCATED_EXCEPTIONS
+    if (n_args <= 1) {
+        for (size_t i = 0; i < MP_NUM_PREALLOCATED_EXCEPTIONS; ++i) {
+            const mp_obj_exception_t *o = &mp_const_preallocated_exceptions[i];
+            if (o->base.type == exc_type && o->args->len == n_args
+                && (n_args == 0 || o->args->items[0] == args[0])) {
+                return MP_OBJ_FROM_PTR(o);
+            }
+        }
+    }
+    #endif
     return mp_obj_exception_make_new(exc_type, n_args, 0, args);
 }
 
@@ -564,16 +614,26 @@ bool mp_obj_exception_match(mp_obj_t exc, mp_const_obj_t exc_type) {
 
 void mp_obj_exception_clear_traceback(mp_obj_t self_in) {
     GET_NATIVE_EXCEPTION(self, self_in);
+    #if MICROPY_PREALLOCATED_EXCEPTIONS
+    if (mp_obj_exception_is_preallocated(self)) {
+        return;
+    }
+    #endif
     // just set the traceback to the null object
     // we don't want to call any memory management functions here
     self->traceback_data = NULL;
 }
 
-void mp_obj_exception_add_traceback(mp_obj_t self_in, qstr file, size_t line, qstr block) {
-    GET_NATIVE_EXCEPTION(self, self_in);
+// Return room for a new traceback entry, or NULL if there is none.
+STATIC size_t *mp_obj_exception_new_traceback_entry(mp_obj_exception_t *self) {
+    // if memory allocation fails (eg because gc is locked), just return NULL
 
-    // append this traceback info to traceback data
-    // if memory allocation fails (eg because gc is locked), just return
+    #if MICROPY_PREALLOCATED_EXCEPTIONS
+    if (mp_obj_exception_is_preallocated(self)) {
+        // Shared and read-only, so can't hold a traceback
+        return NULL;
+    }
+    #endif
 
     if (self->traceback_data == NULL) {
         self->traceback_data = m_new_maybe(size_t, TRACEBACK_ENTRY_LEN);
@@ -587,29 +647,30 @@ void mp_obj_exception_add_traceback(mp_obj_t self_in, qstr file, size_t line, qs
                 self->traceback_alloc = EMG_BUF_TRACEBACK_SIZE / sizeof(size_t);
             } else {
                 // Can't allocate and no room in emergency buffer
-                return;
+                return NULL;
             }
             #else
             // Can't allocate
-            return;
+            return NULL;
             #endif
         } else {
             // Allocated the traceback data on the heap
             self->traceback_alloc = TRACEBACK_ENTRY_LEN;
+            MP_GC_WRITE_BARRIER(self);
         }
         self->traceback_len = 0;
     } else if (self->traceback_len + TRACEBACK_ENTRY_LEN > self->traceback_alloc) {
         #if MICROPY_ENABLE_EMERGENCY_EXCEPTION_BUF
         if (self->traceback_data == (size_t *)MP_STATE_VM(mp_emergency_exception_buf)) {
             // Can't resize the emergency buffer
-            return;
+            return NULL;
         }
         #endif
         // be conservative with growing traceback data
         size_t *tb_data = m_renew_maybe(size_t, self->traceback_data, self->traceback_alloc,
             self->traceback_alloc + TRACEBACK_ENTRY_LEN, true);
         if (tb_data == NULL) {
-            return;
+            return NULL;
         }
         self->traceback_data = tb_data;
         self->traceback_alloc += TRACEBACK_ENTRY_LEN;
@@ -617,9 +678,31 @@ void mp_obj_exception_add_traceback(mp_obj_t self_in, qstr file, size_t line, qs
 
     size_t *tb_data = &self->traceback_data[self->traceback_len];
     self->traceback_len += TRACEBACK_ENTRY_LEN;
-    tb_data[0] = file;
-    tb_data[1] = line;
-    tb_data[2] = block;
+    return tb_data;
+}
+
+void mp_obj_exception_add_traceback(mp_obj_t self_in, qstr file, size_t line, qstr block) {
+    GET_NATIVE_EXCEPTION(self, self_in);
+    size_t *tb_data = mp_obj_exception_new_traceback_entry(self);
+    if (tb_data != NULL) {
+        tb_data[0] = file;
+        tb_data[1] = line;
+        tb_data[2] = block;
+    }
+}
+
+// Add an entry for the instruction at ip in fun_bc, without decoding its line
+// number yet.  Such an entry has MP_QSTRnull as its file, which a compiled
+// function never has, and holds fun_bc so the bytecode stays alive until
+// mp_obj_exception_get_traceback decodes the entry in place.
+void mp_obj_exception_add_traceback_bc(mp_obj_t self_in, const mp_obj_fun_bc_t *fun_bc, const byte *ip) {
+    GET_NATIVE_EXCEPTION(self, self_in);
+    size_t *tb_data = mp_obj_exception_new_traceback_entry(self);
+    if (tb_data != NULL) {
+        tb_data[0] = MP_QSTRnull;
+        tb_data[1] = (size_t)ip;
+        tb_data[2] = (size_t)fun_bc;
+    }
 }
 
 void mp_obj_exception_get_traceback(mp_obj_t self_in, size_t *n, size_t **values) {
@@ -629,6 +712,16 @@ void mp_obj_exception_get_traceback(mp_obj_t self_in, size_t *n, size_t **values
         *n = 0;
         *values = NULL;
     } else {
+        size_t *tb = self->traceback_data;
+        for (size_t i = 0; i < self->traceback_len; i += TRACEBACK_ENTRY_LEN) {
+            if (tb[i] == MP_QSTRnull) {
+                const mp_obj_fun_bc_t *fun_bc = (const mp_obj_fun_bc_t *)tb[i + 2];
+                qstr file, block;
+                tb[i + 1] = mp_bytecode_get_location(fun_bc->bytecode, (const byte *)tb[i + 1], &file, &block);
+                tb[i] = file;
+                tb[i + 2] = block;
+            }
+        }
         *n = self->traceback_len;
         *values = self->traceback_data;
     }
@@ -40,6 +40,18 @@ typedef struct _mp_obj_exception_t {
 void mp_obj_exception_print(const mp_print_t *print, mp_obj_t o_in, mp_print_kind_t kind);
 void mp_obj_exception_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest);
 
+#if MICROPY_PREALLOCATED_EXCEPTIONS
+#define MP_NUM_PREALLOCATED_EXCEPTIONS (5)
+extern const mp_obj_exception_t mp_const_preallocated_exceptions[MP_NUM_PREALLOCATED_EXCEPTIONS];
+
+static inline bool mp_obj_exception_is_preallocated(const void *exc) {
+    return (const mp_obj_exception_t *)exc >= &mp_const_preallocated_exceptions[0]
+           && (const mp_obj_exception_t *)exc < &mp_const_preallocated_exceptions[MP_NUM_PREALLOCATED_EXCEPTIONS];
+}
+
+mp_obj_t mp_obj_exception_copy_preallocated(mp_obj_t self_in);
+#endif
+
 #define MP_DEFINE_EXCEPTION(exc_name, base_name) \
     const mp_obj_type_t mp_type_##exc_name = { \
         { &mp_type_type }, \
@@ -31,6 +31,7 @@
 
 #include "py/parsenum.h"
 #include "py/runtime.h"
+#include "py/gc.h"
 
 #if MICROPY_PY_BUILTINS_FLOAT
 
@@ -108,7 +109,13 @@ STATIC void float_print(const mp_print_t *print, mp_obj_t o_in, mp_print_kind_t
     char buf[32];
     const int precision = 16;
     #endif
-    mp_format_float(o_val, buf, sizeof(buf), 'g', precision, '\0');
+    #if MICROPY_FLOAT_EXACT_CONVERSION && MICROPY_OBJ_REPR != MICROPY_OBJ_REPR_C
+    // the shortest digits that read back as the same float
+    const char fmt = 'r';
+    #else
+    const char fmt = 'g';
+    #endif
+    mp_format_float(o_val, buf, sizeof(buf), fmt, precision, '\0');
     mp_print_str(print, buf);
     if (strchr(buf, '.') == NULL && strchr(buf, 'e') == NULL && strchr(buf, 'n') == NULL) {
         // Python floats always have decimal point (unless inf or nan)
@@ -187,7 +194,14 @@ const mp_obj_type_t mp_type_float = {
 #if MICROPY_OBJ_REPR != MICROPY_OBJ_REPR_C && MICROPY_OBJ_REPR != MICROPY_OBJ_REPR_D
 
 mp_obj_t mp_obj_new_float(mp_float_t value) {
+    #if MICROPY_FLOAT_FREELIST
+    mp_obj_float_t *o = gc_float_freelist_pop();
+    if (o == NULL) {
+        o = m_new(mp_obj_float_t, 1);
+    }
+    #else
     mp_obj_float_t *o = m_new(mp_obj_float_t, 1);
+    #endif
     o->base.type = &mp_type_float;
     o->value = value;
     return MP_OBJ_FROM_PTR(o);
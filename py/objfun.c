@@ -33,6 +33,7 @@
 #include "py/runtime.h"
 #include "py/bc.h"
 #include "py/stackctrl.h"
+#include "py/jit.h"
 
 #if MICROPY_DEBUG_VERBOSE // print debugging info
 #define DEBUG_PRINT (1)
@@ -256,6 +257,19 @@ STATIC mp_obj_t fun_bc_call(mp_obj_t self_in, size_t n_args, size_t n_kw, const
 
     mp_obj_fun_bc_t *self = MP_OBJ_TO_PTR(self_in);
 
+    #if MICROPY_JIT
+    if (self->jit_count < MICROPY_JIT_THRESHOLD) {
+        ++self->jit_count;
+    } else if (
+        #if MICROPY_VM_BUDGET
+        // native code doesn't count ticks, so run bytecode while there's a budget
+        MP_STATE_VM(vm_budget) == 0 &&
+        #endif
+        mp_jit_promote(self)) {
+        return mp_jit_call(self, n_args, n_kw, args);
+    }
+    #endif
+
     size_t n_state, state_size;
     DECODE_CODESTATE_SIZE(self->bytecode, n_state, state_size);
 
@@ -393,6 +407,10 @@ mp_obj_t mp_obj_new_fun_bc(mp_obj_t def_args_in, mp_obj_t def_kw_args, const byt
     o->globals = mp_globals_get();
     o->bytecode = code;
     o->const_table = const_table;
+    #if MICROPY_JIT
+    o->jit_count = 0;
+    o->jit_fun = NULL;
+    #endif
     if (def_args != NULL) {
         memcpy(o->extra_args, def_args->items, n_def_args * sizeof(mp_obj_t));
     }
@@ -36,6 +36,10 @@ typedef struct _mp_obj_fun_bc_t {
     #if MICROPY_PY_SYS_SETTRACE
     const struct _mp_raw_code_t *rc;
     #endif
+    #if MICROPY_JIT
+    mp_uint_t jit_count;            // calls plus backward jumps, see py/jit.h
+    struct _mp_obj_fun_bc_t *jit_fun; // native code translation of this function
+    #endif
     // the following extra_args array is allocated space to take (in order):
     //  - values of positional default args (if any)
     //  - a single slot for default kw args dict (if it has them)
@@ -29,6 +29,7 @@
 #include <assert.h>
 
 #include "py/runtime.h"
+#include "py/gc.h"
 #include "py/bc.h"
 #include "py/objstr.h"
 #include "py/objgenerator.h"
@@ -50,6 +51,22 @@ typedef struct _mp_obj_gen_instance_t {
     mp_code_state_t code_state;
 } mp_obj_gen_instance_t;
 
+// Allocate a generator object, with room for local stack and exception stack.
+STATIC mp_obj_gen_instance_t *gen_instance_new(size_t n_state, size_t n_exc_stack) {
+    size_t n_bytes = sizeof(mp_obj_gen_instance_t) + n_state * sizeof(mp_obj_t) + n_exc_stack * sizeof(mp_exc_stack_t);
+    #if MICROPY_GC_POOL
+    // reuse the frame of a generator of the same size that has been collected
+    mp_obj_gen_instance_t *o = gc_pool_pop(&mp_type_gen_instance, n_bytes);
+    if (o == NULL) {
+        o = m_malloc(n_bytes);
+    }
+    #else
+    mp_obj_gen_instance_t *o = m_malloc(n_bytes);
+    #endif
+    o->base.type = &mp_type_gen_instance;
+    return o;
+}
+
 STATIC mp_obj_t gen_wrap_call(mp_obj_t self_in, size_t n_args, size_t n_kw, const mp_obj_t *args) {
     // A generating function is just a bytecode function with type mp_type_gen_wrap
     mp_obj_fun_bc_t *self_fun = MP_OBJ_TO_PTR(self_in);
@@ -58,10 +75,7 @@ STATIC mp_obj_t gen_wrap_call(mp_obj_t self_in, size_t n_args, size_t n_kw, cons
     const uint8_t *ip = self_fun->bytecode;
     MP_BC_PRELUDE_SIG_DECODE(ip);
 
-    // allocate the generator object, with room for local stack and exception stack
-    mp_obj_gen_instance_t *o = m_new_obj_var(mp_obj_gen_instance_t, byte,
-        n_state * sizeof(mp_obj_t) + n_exc_stack * sizeof(mp_exc_stack_t));
-    o->base.type = &mp_type_gen_instance;
+    mp_obj_gen_instance_t *o = gen_instance_new(n_state, n_exc_stack);
 
     o->pend_exc = mp_const_none;
     o->code_state.fun_bc = self_fun;
@@ -103,10 +117,7 @@ STATIC mp_obj_t native_gen_wrap_call(mp_obj_t self_in, size_t n_args, size_t n_k
     MP_BC_PRELUDE_SIG_DECODE_INTO(ip, n_state, n_exc_stack_unused, scope_flags, n_pos_args, n_kwonly_args, n_def_args);
     size_t n_exc_stack = 0;
 
-    // Allocate the generator object, with room for local stack and exception stack
-    mp_obj_gen_instance_t *o = m_new_obj_var(mp_obj_gen_instance_t, byte,
-        n_state * sizeof(mp_obj_t) + n_exc_stack * sizeof(mp_exc_stack_t));
-    o->base.type = &mp_type_gen_instance;
+    mp_obj_gen_instance_t *o = gen_instance_new(n_state, n_exc_stack);
 
     // Parse the input arguments and set up the code state
     o->pend_exc = mp_const_none;
@@ -202,6 +213,9 @@ mp_vm_return_kind_t mp_obj_gen_resume(mp_obj_t self_in, mp_obj_t send_value, mp_
 
     mp_globals_set(self->code_state.old_globals);
 
+    // The state of the generator was written to while it ran
+    MP_GC_WRITE_BARRIER(self);
+
     // Mark as not running
     self->pend_exc = mp_const_none;
 
@@ -326,6 +340,7 @@ STATIC mp_obj_t gen_instance_pend_throw(mp_obj_t self_in, mp_obj_t exc_in) {
     }
     mp_obj_t prev = self->pend_exc;
     self->pend_exc = exc_in;
+    MP_GC_WRITE_BARRIER(self);
     return prev;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(gen_instance_pend_throw_obj, gen_instance_pend_throw);
@@ -0,0 +1,411 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "py/mpconfig.h"
+#if MICROPY_PY_COLLECTIONS_INTDICT
+
+#include "py/runtime.h"
+#include "py/gc.h"
+
+// An IntDict is a mapping with int keys.  Keys in a dense range are kept in
+// an array of values, so such a table costs about one word per entry: items[i]
+// holds the value of key first + i, or MP_OBJ_NULL if that key isn't present.
+// The range grows to take a new small int key as long as it stays at least
+// half full, and any other key goes in an ordinary map.  A key is never in
+// both.  Iteration is over the range in key order, then the other keys.
+typedef struct _mp_obj_intdict_t {
+    mp_obj_base_t base;
+    mp_int_t first;
+    size_t len; // number of keys the range covers
+    size_t alloc;
+    size_t used; // number of keys present in the range
+    mp_obj_t *items;
+    mp_map_t others;
+} mp_obj_intdict_t;
+
+// a range of up to this many keys is allowed to be less than half full
+#define INTDICT_MIN_SPAN (8)
+
+// Return the key with a bool turned into a small int, raising if it's not an int.
+STATIC mp_obj_t intdict_check_key(mp_obj_t key) {
+    if (mp_obj_is_bool(key)) {
+        return MP_OBJ_NEW_SMALL_INT(key == mp_const_true);
+    } else if (!mp_obj_is_int(key)) {
+        mp_raise_TypeError(MP_ERROR_TEXT("key must be an int"));
+    }
+    return key;
+}
+
+// Return the position of key in the range, or -1 if it's outside the range.
+STATIC mp_int_t intdict_pos(const mp_obj_intdict_t *self, mp_obj_t key) {
+    if (mp_obj_is_small_int(key)) {
+        mp_uint_t pos = (mp_uint_t)(MP_OBJ_SMALL_INT_VALUE(key) - self->first);
+        if (pos < self->len) {
+            return pos;
+        }
+    }
+    return -1;
+}
+
+STATIC mp_obj_t intdict_lookup(mp_obj_intdict_t *self, mp_obj_t key) {
+    key = intdict_check_key(key);
+    mp_int_t pos = intdict_pos(self, key);
+    if (pos >= 0) {
+        return self->items[pos];
+    }
+    mp_map_elem_t *elem = mp_map_lookup(&self->others, key, MP_MAP_LOOKUP);
+    return elem == NULL ? MP_OBJ_NULL : elem->value;
+}
+
+// Remove key and return its value, or MP_OBJ_NULL if it's not present.
+STATIC mp_obj_t intdict_remove(mp_obj_intdict_t *self, mp_obj_t key) {
+    key = intdict_check_key(key);
+    mp_int_t pos = intdict_pos(self, key);
+    if (pos >= 0) {
+        mp_obj_t value = self->items[pos];
+        if (value != MP_OBJ_NULL) {
+            self->items[pos] = MP_OBJ_NULL;
+            // free the range if it's empty, otherwise drop any empty slots at its end
+            if (--self->used == 0) {
+                self->len = 0;
+            }
+            while (self->len > 0 && self->items[self->len - 1] == MP_OBJ_NULL) {
+                --self->len;
+            }
+        }
+        return value;
+    }
+    mp_map_elem_t *elem = mp_map_lookup(&self->others, key, MP_MAP_LOOKUP_REMOVE_IF_FOUND);
+    if (elem == NULL) {
+        return MP_OBJ_NULL;
+    }
+    mp_obj_t value = elem->value;
+    elem->value = MP_OBJ_NULL;
+    return value;
+}
+
+// Grow the range to cover key k if it would stay at least half full, moving
+// in any other keys that it then covers.  Return whether the range covers k.
+STATIC bool intdict_grow(mp_obj_intdict_t *self, mp_int_t k) {
+    mp_int_t lo = k;
+    mp_int_t hi = k;
+    if (self->len > 0) {
+        lo = MIN(lo, self->first);
+        hi = MAX(hi, self->first + (mp_int_t)self->len - 1);
+    }
+    size_t span = (mp_uint_t)(hi - lo) + 1;
+    if (span > 2 * (self->used + 1) && span > INTDICT_MIN_SPAN) {
+        return false;
+    }
+    if (span > self->alloc) {
+        size_t new_alloc = MAX(span, self->alloc + self->alloc / 2);
+        self->items = m_renew(mp_obj_t, self->items, self->alloc, new_alloc);
+        self->alloc = new_alloc;
+    }
+    size_t shift = self->len > 0 ? (mp_uint_t)(self->first - lo) : 0;
+    memmove(self->items + shift, self->items, self->len * sizeof(mp_obj_t));
+    mp_seq_clear(self->items, 0, shift, sizeof(mp_obj_t));
+    mp_seq_clear(self->items, shift + self->len, span, sizeof(mp_obj_t));
+    self->first = lo;
+    self->len = span;
+    for (size_t i = 0; self->others.used > 0 && i < self->others.alloc; ++i) {
+        if (mp_map_slot_is_filled(&self->others, i)) {
+            mp_int_t pos = intdict_pos(self, self->others.table[i].key);
+            if (pos >= 0) {
+                mp_map_elem_t *elem = mp_map_lookup(&self->others, self->others.table[i].key, MP_MAP_LOOKUP_REMOVE_IF_FOUND);
+                self->items[pos] = elem->value;
+                elem->value = MP_OBJ_NULL;
+                self->used++;
+            }
+        }
+    }
+    MP_GC_WRITE_BARRIER(self->items);
+    return true;
+}
+
+STATIC mp_obj_t intdict_store(mp_obj_t self_in, mp_obj_t key, mp_obj_t value) {
+    mp_obj_intdict_t *self = MP_OBJ_TO_PTR(self_in);
+    key = intdict_check_key(key);
+    mp_int_t pos = intdict_pos(self, key);
+    if (pos < 0 && mp_obj_is_small_int(key) && intdict_grow(self, MP_OBJ_SMALL_INT_VALUE(key))) {
+        pos = intdict_pos(self, key);
+    }
+    if (pos >= 0) {
+        if (self->items[pos] == MP_OBJ_NULL) {
+            self->used++;
+        }
+        self->items[pos] = value;
+        MP_GC_WRITE_BARRIER(self->items);
+    } else {
+        mp_map_store(&self->others, key, value);
+    }
+    return mp_const_none;
+}
+
+STATIC mp_obj_t intdict_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 0, 1, false);
+
+    mp_obj_intdict_t *o = m_new_obj(mp_obj_intdict_t);
+    o->base.type = type;
+    o->first = 0;
+    o->len = 0;
+    o->alloc = 0;
+    o->used = 0;
+    o->items = NULL;
+    mp_map_init(&o->others, 0);
+    if (n_args == 0) {
+        return MP_OBJ_FROM_PTR(o);
+    }
+
+    // take the items of a mapping, or an iterable of (key, value) pairs
+    mp_obj_t iter = args[0];
+    if (mp_obj_is_dict_or_ordereddict(args[0]) || mp_obj_is_type(args[0], &mp_type_intdict)) {
+        iter = mp_call_function_0(mp_load_attr(args[0], MP_QSTR_items));
+    }
+    iter = mp_getiter(iter, NULL);
+    mp_obj_t item;
+    while ((item = mp_iternext(iter)) != MP_OBJ_STOP_ITERATION) {
+        mp_obj_t *pair;
+        mp_obj_get_array_fixed_n(item, 2, &pair);
+        intdict_store(MP_OBJ_FROM_PTR(o), pair[0], pair[1]);
+    }
+    return MP_OBJ_FROM_PTR(o);
+}
+
+/******************************************************************************/
+/* iteration                                                                  */
+
+// The position of an iterator counts through the range and then the slots of
+// the map of other keys.
+typedef struct _mp_obj_intdict_it_t {
+    mp_obj_base_t base;
+    mp_fun_1_t iternext;
+    mp_obj_t intdict;
+    size_t cur;
+} mp_obj_intdict_it_t;
+
+// Find the next entry from the iterator, returning false at the end.
+STATIC bool intdict_it_next(mp_obj_t self_in, mp_obj_t *key, mp_obj_t *value) {
+    mp_obj_intdict_it_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_obj_intdict_t *intdict = MP_OBJ_TO_PTR(self->intdict);
+    for (; self->cur < intdict->len; ++self->cur) {
+        if (intdict->items[self->cur] != MP_OBJ_NULL) {
+            *key = MP_OBJ_NEW_SMALL_INT(intdict->first + (mp_int_t)self->cur);
+            *value = intdict->items[self->cur++];
+            return true;
+        }
+    }
+    for (size_t i = self->cur - intdict->len; i < intdict->others.alloc; ++i) {
+        if (mp_map_slot_is_filled(&intdict->others, i)) {
+            self->cur = intdict->len + i + 1;
+            *key = intdict->others.table[i].key;
+            *value = intdict->others.table[i].value;
+            return true;
+        }
+    }
+    self->cur = intdict->len + intdict->others.alloc;
+    return false;
+}
+
+STATIC mp_obj_t intdict_it_iternext_keys(mp_obj_t self_in) {
+    mp_obj_t key, value;
+    return intdict_it_next(self_in, &key, &value) ? key : MP_OBJ_STOP_ITERATION;
+}
+
+STATIC mp_obj_t intdict_it_iternext_values(mp_obj_t self_in) {
+    mp_obj_t key, value;
+    return intdict_it_next(self_in, &key, &value) ? value : MP_OBJ_STOP_ITERATION;
+}
+
+STATIC mp_obj_t intdict_it_iternext_items(mp_obj_t self_in) {
+    mp_obj_t items[2];
+    if (!intdict_it_next(self_in, &items[0], &items[1])) {
+        return MP_OBJ_STOP_ITERATION;
+    }
+    return mp_obj_new_tuple(2, items);
+}
+
+STATIC mp_obj_t intdict_new_iter(mp_obj_t self_in, mp_fun_1_t iternext, mp_obj_iter_buf_t *iter_buf) {
+    assert(sizeof(mp_obj_intdict_it_t) <= sizeof(mp_obj_iter_buf_t));
+    mp_obj_intdict_it_t *o = iter_buf == NULL ? m_new_obj(mp_obj_intdict_it_t) : (mp_obj_intdict_it_t *)iter_buf;
+    o->base.type = &mp_type_polymorph_iter;
+    o->iternext = iternext;
+    o->intdict = self_in;
+    o->cur = 0;
+    return MP_OBJ_FROM_PTR(o);
+}
+
+STATIC mp_obj_t intdict_getiter(mp_obj_t self_in, mp_obj_iter_buf_t *iter_buf) {
+    return intdict_new_iter(self_in, intdict_it_iternext_keys, iter_buf);
+}
+
+/******************************************************************************/
+/* IntDict                                                                    */
+
+STATIC void intdict_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
+    (void)kind;
+    mp_obj_iter_buf_t iter_buf;
+    mp_obj_t iter = intdict_getiter(self_in, &iter_buf);
+    mp_obj_t key, value;
+    bool first = true;
+    mp_print_str(print, "IntDict({");
+    while (intdict_it_next(iter, &key, &value)) {
+        if (!first) {
+            mp_print_str(print, ", ");
+        }
+        first = false;
+        mp_obj_print_helper(print, key, PRINT_REPR);
+        mp_print_str(print, ": ");
+        mp_obj_print_helper(print, value, PRINT_REPR);
+    }
+    mp_print_str(print, "})");
+}
+
+STATIC mp_obj_t intdict_unary_op(mp_unary_op_t op, mp_obj_t self_in) {
+    mp_obj_intdict_t *self = MP_OBJ_TO_PTR(self_in);
+    size_t len = self->used + self->others.used;
+    switch (op) {
+        case MP_UNARY_OP_BOOL:
+            return mp_obj_new_bool(len != 0);
+        case MP_UNARY_OP_LEN:
+            return MP_OBJ_NEW_SMALL_INT(len);
+        #if MICROPY_PY_SYS_GETSIZEOF
+        case MP_UNARY_OP_SIZEOF: {
+            size_t sz = sizeof(*self) + self->alloc * sizeof(mp_obj_t) + self->others.alloc * sizeof(mp_map_elem_t);
+            return MP_OBJ_NEW_SMALL_INT(sz);
+        }
+        #endif
+        default:
+            return MP_OBJ_NULL; // op not supported
+    }
+}
+
+STATIC mp_obj_t intdict_binary_op(mp_binary_op_t op, mp_obj_t lhs_in, mp_obj_t rhs_in) {
+    if (op != MP_BINARY_OP_CONTAINS) {
+        return MP_OBJ_NULL; // op not supported
+    }
+    if (!mp_obj_is_int(rhs_in) && !mp_obj_is_bool(rhs_in)) {
+        return mp_const_false;
+    }
+    return mp_obj_new_bool(intdict_lookup(MP_OBJ_TO_PTR(lhs_in), rhs_in) != MP_OBJ_NULL);
+}
+
+STATIC mp_obj_t intdict_subscr(mp_obj_t self_in, mp_obj_t index, mp_obj_t value) {
+    mp_obj_intdict_t *self = MP_OBJ_TO_PTR(self_in);
+    if (value == MP_OBJ_SENTINEL) {
+        // load
+        mp_obj_t ret = intdict_lookup(self, index);
+        if (ret == MP_OBJ_NULL) {
+            nlr_raise(mp_obj_new_exception_arg1(&mp_type_KeyError, index));
+        }
+        return ret;
+    } else if (value == MP_OBJ_NULL) {
+        // delete
+        if (intdict_remove(self, index) == MP_OBJ_NULL) {
+            nlr_raise(mp_obj_new_exception_arg1(&mp_type_KeyError, index));
+        }
+        return mp_const_none;
+    } else {
+        // store
+        return intdict_store(self_in, index, value);
+    }
+}
+
+STATIC mp_obj_t intdict_get(size_t n_args, const mp_obj_t *args) {
+    mp_obj_t value = intdict_lookup(MP_OBJ_TO_PTR(args[0]), args[1]);
+    if (value == MP_OBJ_NULL) {
+        value = n_args > 2 ? args[2] : mp_const_none;
+    }
+    return value;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(intdict_get_obj, 2, 3, intdict_get);
+
+STATIC mp_obj_t intdict_pop(size_t n_args, const mp_obj_t *args) {
+    mp_obj_t value = intdict_remove(MP_OBJ_TO_PTR(args[0]), args[1]);
+    if (value == MP_OBJ_NULL) {
+        if (n_args < 3) {
+            nlr_raise(mp_obj_new_exception_arg1(&mp_type_KeyError, args[1]));
+        }
+        value = args[2];
+    }
+    return value;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(intdict_pop_obj, 2, 3, intdict_pop);
+
+STATIC mp_obj_t intdict_clear(mp_obj_t self_in) {
+    mp_obj_intdict_t *self = MP_OBJ_TO_PTR(self_in);
+    m_del(mp_obj_t, self->items, self->alloc);
+    self->items = NULL;
+    self->first = 0;
+    self->len = 0;
+    self->alloc = 0;
+    self->used = 0;
+    mp_map_clear(&self->others);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(intdict_clear_obj, intdict_clear);
+
+STATIC mp_obj_t intdict_keys(mp_obj_t self_in) {
+    return intdict_new_iter(self_in, intdict_it_iternext_keys, NULL);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(intdict_keys_obj, intdict_keys);
+
+STATIC mp_obj_t intdict_values(mp_obj_t self_in) {
+    return intdict_new_iter(self_in, intdict_it_iternext_values, NULL);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(intdict_values_obj, intdict_values);
+
+STATIC mp_obj_t intdict_items(mp_obj_t self_in) {
+    return intdict_new_iter(self_in, intdict_it_iternext_items, NULL);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(intdict_items_obj, intdict_items);
+
+STATIC const mp_rom_map_elem_t intdict_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_clear), MP_ROM_PTR(&intdict_clear_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get), MP_ROM_PTR(&intdict_get_obj) },
+    { MP_ROM_QSTR(MP_QSTR_items), MP_ROM_PTR(&intdict_items_obj) },
+    { MP_ROM_QSTR(MP_QSTR_keys), MP_ROM_PTR(&intdict_keys_obj) },
+    { MP_ROM_QSTR(MP_QSTR_pop), MP_ROM_PTR(&intdict_pop_obj) },
+    { MP_ROM_QSTR(MP_QSTR_values), MP_ROM_PTR(&intdict_values_obj) },
+};
+
+STATIC MP_DEFINE_CONST_DICT(intdict_locals_dict, intdict_locals_dict_table);
+
+const mp_obj_type_t mp_type_intdict = {
+    { &mp_type_type },
+    .name = MP_QSTR_IntDict,
+    .print = intdict_print,
+    .make_new = intdict_make_new,
+    .unary_op = intdict_unary_op,
+    .binary_op = intdict_binary_op,
+    .subscr = intdict_subscr,
+    .getiter = intdict_getiter,
+    .locals_dict = (mp_obj_dict_t *)&intdict_locals_dict,
+};
+
+#endif // MICROPY_PY_COLLECTIONS_INTDICT
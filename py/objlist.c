@@ -28,17 +28,64 @@
 #include <assert.h>
 
 #include "py/objlist.h"
+#include "py/objstr.h"
 #include "py/runtime.h"
 #include "py/stackctrl.h"
+#include "py/gc.h"
 
 STATIC mp_obj_t mp_obj_new_list_iterator(mp_obj_t list, size_t cur, mp_obj_iter_buf_t *iter_buf);
 STATIC mp_obj_list_t *list_new(size_t n);
 STATIC mp_obj_t list_extend(mp_obj_t self_in, mp_obj_t arg_in);
-STATIC mp_obj_t list_pop(size_t n_args, const mp_obj_t *args);
+STATIC mp_obj_t list_pop_unlocked(size_t n_args, const mp_obj_t *args);
 
 // TODO: Move to mpconfig.h
 #define LIST_MIN_ALLOC 4
 
+#if MICROPY_PY_THREAD_OBJ_LOCK
+// A list shared between threads holds its object lock while its items are
+// changed.  The items array is then never shrunk or freed, only replaced by
+// a larger one, so a len and items pair read together under the lock stays
+// valid to read from after the lock is released.
+#define LIST_CALL(fun, n_args, args) mp_thread_obj_call_locked(MP_OBJ_TO_PTR((args)[0]), fun, n_args, args)
+#else
+#define LIST_CALL(fun, n_args, args) fun(n_args, args)
+#endif
+
+// Grow the items of a list to new_alloc entries, returning false if there's
+// not enough memory.  The new entries are not cleared.
+STATIC bool list_grow(mp_obj_list_t *self, size_t new_alloc) {
+    #if MICROPY_PY_THREAD_OBJ_LOCK
+    mp_obj_t *items = m_renew_maybe(mp_obj_t, self->items, self->alloc, new_alloc, false);
+    if (items == NULL) {
+        bool arena_suspended = MP_GC_ARENA_SUSPEND(self);
+        items = m_new_maybe(mp_obj_t, new_alloc);
+        MP_GC_ARENA_RESUME(arena_suspended);
+        if (items == NULL) {
+            return false;
+        }
+        memcpy(items, self->items, self->alloc * sizeof(mp_obj_t));
+    }
+    self->items = items;
+    MP_GC_WRITE_BARRIER(self);
+    #else
+    self->items = m_renew(mp_obj_t, self->items, self->alloc, new_alloc);
+    #endif
+    self->alloc = new_alloc;
+    return true;
+}
+
+// Shrink the items of a list to new_alloc entries, if that's allowed.
+STATIC void list_shrink(mp_obj_list_t *self, size_t new_alloc) {
+    #if MICROPY_PY_THREAD_OBJ_LOCK
+    // other threads may still be reading the items
+    (void)self;
+    (void)new_alloc;
+    #else
+    self->items = m_renew(mp_obj_t, self->items, self->alloc, new_alloc);
+    self->alloc = new_alloc;
+    #endif
+}
+
 /******************************************************************************/
 /* list                                                                       */
 
@@ -104,15 +151,19 @@ STATIC mp_obj_t list_unary_op(mp_unary_op_t op, mp_obj_t self_in) {
 }
 
 STATIC mp_obj_t list_binary_op(mp_binary_op_t op, mp_obj_t lhs, mp_obj_t rhs) {
-    mp_obj_list_t *o = MP_OBJ_TO_PTR(lhs);
+    size_t len;
+    mp_obj_t *items;
+    mp_obj_list_get(lhs, &len, &items);
     switch (op) {
         case MP_BINARY_OP_ADD: {
             if (!mp_obj_is_type(rhs, &mp_type_list)) {
                 return MP_OBJ_NULL; // op not supported
             }
-            mp_obj_list_t *p = MP_OBJ_TO_PTR(rhs);
-            mp_obj_list_t *s = list_new(o->len + p->len);
-            mp_seq_cat(s->items, o->items, o->len, p->items, p->len, mp_obj_t);
+            size_t p_len;
+            mp_obj_t *p_items;
+            mp_obj_list_get(rhs, &p_len, &p_items);
+            mp_obj_list_t *s = list_new(len + p_len);
+            mp_seq_cat(s->items, items, len, p_items, p_len, mp_obj_t);
             return MP_OBJ_FROM_PTR(s);
         }
         case MP_BINARY_OP_INPLACE_ADD: {
@@ -127,8 +178,8 @@ STATIC mp_obj_t list_binary_op(mp_binary_op_t op, mp_obj_t lhs, mp_obj_t rhs) {
             if (n < 0) {
                 n = 0;
             }
-            mp_obj_list_t *s = list_new(o->len * n);
-            mp_seq_multiply(o->items, sizeof(*o->items), o->len, n, s->items);
+            mp_obj_list_t *s = list_new(len * n);
+            mp_seq_multiply(items, sizeof(*items), len, n, s->items);
             return MP_OBJ_FROM_PTR(s);
         }
         case MP_BINARY_OP_EQUAL:
@@ -143,8 +194,10 @@ STATIC mp_obj_t list_binary_op(mp_binary_op_t op, mp_obj_t lhs, mp_obj_t rhs) {
                 return MP_OBJ_NULL; // op not supported
             }
 
-            mp_obj_list_t *another = MP_OBJ_TO_PTR(rhs);
-            bool res = mp_seq_cmp_objs(op, o->items, o->len, another->items, another->len);
+            size_t another_len;
+            mp_obj_t *another_items;
+            mp_obj_list_get(rhs, &another_len, &another_items);
+            bool res = mp_seq_cmp_objs(op, items, len, another_items, another_len);
             return mp_obj_new_bool(res);
         }
 
@@ -153,80 +206,92 @@ STATIC mp_obj_t list_binary_op(mp_binary_op_t op, mp_obj_t lhs, mp_obj_t rhs) {
     }
 }
 
-STATIC mp_obj_t list_subscr(mp_obj_t self_in, mp_obj_t index, mp_obj_t value) {
+#if MICROPY_PY_BUILTINS_SLICE
+// Delete a slice of a list if value is MP_OBJ_NULL, else replace it with the
+// items of value.  The bounds of the slice, which may call __int__, and the
+// items of value, which may be another list, are got before taking the lock.
+STATIC mp_obj_t list_store_slice(mp_obj_t self_in, mp_obj_t index, mp_obj_t value) {
+    mp_obj_list_t *self = MP_OBJ_TO_PTR(self_in);
+    size_t value_len = 0;
+    mp_obj_t *value_items = NULL;
+    if (value != MP_OBJ_NULL) {
+        mp_obj_get_array(value, &value_len, &value_items);
+    }
+    mp_bound_slice_t slice;
+    if (!mp_seq_get_fast_slice_indexes(self->len, index, &slice)) {
+        mp_raise_NotImplementedError(NULL);
+    }
+    MP_THREAD_OBJ_LOCK(self);
     if (value == MP_OBJ_NULL) {
-        // delete
-        #if MICROPY_PY_BUILTINS_SLICE
-        if (mp_obj_is_type(index, &mp_type_slice)) {
-            mp_obj_list_t *self = MP_OBJ_TO_PTR(self_in);
-            mp_bound_slice_t slice;
-            if (!mp_seq_get_fast_slice_indexes(self->len, index, &slice)) {
-                mp_raise_NotImplementedError(NULL);
+        value_items = self->items; // not read, as value_len is 0
+    }
+    #if MICROPY_PY_THREAD_OBJ_LOCK
+    // another thread may have made the list shorter meanwhile
+    if (slice.stop > (mp_int_t)self->len) {
+        slice.stop = self->len;
+        slice.start = MIN(slice.start, slice.stop);
+    }
+    #endif
+    mp_int_t len_adj = value_len - (slice.stop - slice.start);
+    if (len_adj > 0) {
+        if (self->len + len_adj > self->alloc) {
+            // TODO: Might optimize memory copies here by checking if block can
+            // be grown inplace or not
+            if (!list_grow(self, self->len + len_adj)) {
+                MP_THREAD_OBJ_UNLOCK(self);
+                m_malloc_fail((self->len + len_adj) * sizeof(mp_obj_t));
             }
-
-            mp_int_t len_adj = slice.start - slice.stop;
-            assert(len_adj <= 0);
-            mp_seq_replace_slice_no_grow(self->items, self->len, slice.start, slice.stop, self->items /*NULL*/, 0, sizeof(*self->items));
-            // Clear "freed" elements at the end of list
-            mp_seq_clear(self->items, self->len + len_adj, self->len, sizeof(*self->items));
-            self->len += len_adj;
-            return mp_const_none;
         }
-        #endif
-        mp_obj_t args[2] = {self_in, index};
-        list_pop(2, args);
-        return mp_const_none;
-    } else if (value == MP_OBJ_SENTINEL) {
+        mp_seq_replace_slice_grow_inplace(self->items, self->len,
+            slice.start, slice.stop, value_items, value_len, len_adj, sizeof(*self->items));
+    } else {
+        mp_seq_replace_slice_no_grow(self->items, self->len,
+            slice.start, slice.stop, value_items, value_len, sizeof(*self->items));
+        // Clear "freed" elements at the end of list
+        mp_seq_clear(self->items, self->len + len_adj, self->len, sizeof(*self->items));
+        // TODO: apply allocation policy re: alloc_size
+    }
+    self->len += len_adj;
+    MP_GC_WRITE_BARRIER(self->items);
+    MP_THREAD_OBJ_UNLOCK(self);
+    return mp_const_none;
+}
+#endif
+
+STATIC mp_obj_t list_subscr(mp_obj_t self_in, mp_obj_t index, mp_obj_t value) {
+    if (value == MP_OBJ_SENTINEL) {
         // load
         mp_obj_list_t *self = MP_OBJ_TO_PTR(self_in);
+        size_t len;
+        mp_obj_t *items;
+        mp_obj_list_get(self_in, &len, &items);
         #if MICROPY_PY_BUILTINS_SLICE
         if (mp_obj_is_type(index, &mp_type_slice)) {
             mp_bound_slice_t slice;
-            if (!mp_seq_get_fast_slice_indexes(self->len, index, &slice)) {
-                return mp_seq_extract_slice(self->len, self->items, &slice);
+            if (!mp_seq_get_fast_slice_indexes(len, index, &slice)) {
+                return mp_seq_extract_slice(len, items, &slice);
             }
             mp_obj_list_t *res = list_new(slice.stop - slice.start);
-            mp_seq_copy(res->items, self->items + slice.start, res->len, mp_obj_t);
+            mp_seq_copy(res->items, items + slice.start, res->len, mp_obj_t);
             return MP_OBJ_FROM_PTR(res);
         }
         #endif
-        size_t index_val = mp_get_index(self->base.type, self->len, index, false);
-        return self->items[index_val];
+        size_t index_val = mp_get_index(self->base.type, len, index, false);
+        return items[index_val];
+    }
+    // store or delete
+    #if MICROPY_PY_BUILTINS_SLICE
+    if (mp_obj_is_type(index, &mp_type_slice)) {
+        return list_store_slice(self_in, index, value);
+    }
+    #endif
+    if (value == MP_OBJ_NULL) {
+        mp_obj_t args[2] = {self_in, index};
+        LIST_CALL(list_pop_unlocked, 2, args);
     } else {
-        #if MICROPY_PY_BUILTINS_SLICE
-        if (mp_obj_is_type(index, &mp_type_slice)) {
-            mp_obj_list_t *self = MP_OBJ_TO_PTR(self_in);
-            size_t value_len;
-            mp_obj_t *value_items;
-            mp_obj_get_array(value, &value_len, &value_items);
-            mp_bound_slice_t slice_out;
-            if (!mp_seq_get_fast_slice_indexes(self->len, index, &slice_out)) {
-                mp_raise_NotImplementedError(NULL);
-            }
-            mp_int_t len_adj = value_len - (slice_out.stop - slice_out.start);
-            if (len_adj > 0) {
-                if (self->len + len_adj > self->alloc) {
-                    // TODO: Might optimize memory copies here by checking if block can
-                    // be grown inplace or not
-                    self->items = m_renew(mp_obj_t, self->items, self->alloc, self->len + len_adj);
-                    self->alloc = self->len + len_adj;
-                }
-                mp_seq_replace_slice_grow_inplace(self->items, self->len,
-                    slice_out.start, slice_out.stop, value_items, value_len, len_adj, sizeof(*self->items));
-            } else {
-                mp_seq_replace_slice_no_grow(self->items, self->len,
-                    slice_out.start, slice_out.stop, value_items, value_len, sizeof(*self->items));
-                // Clear "freed" elements at the end of list
-                mp_seq_clear(self->items, self->len + len_adj, self->len, sizeof(*self->items));
-                // TODO: apply allocation policy re: alloc_size
-            }
-            self->len += len_adj;
-            return mp_const_none;
-        }
-        #endif
         mp_obj_list_store(self_in, index, value);
-        return mp_const_none;
     }
+    return mp_const_none;
 }
 
 STATIC mp_obj_t list_getiter(mp_obj_t o_in, mp_obj_iter_buf_t *iter_buf) {
@@ -236,38 +301,60 @@ STATIC mp_obj_t list_getiter(mp_obj_t o_in, mp_obj_iter_buf_t *iter_buf) {
 mp_obj_t mp_obj_list_append(mp_obj_t self_in, mp_obj_t arg) {
     mp_check_self(mp_obj_is_type(self_in, &mp_type_list));
     mp_obj_list_t *self = MP_OBJ_TO_PTR(self_in);
+    MP_THREAD_OBJ_LOCK(self);
     if (self->len >= self->alloc) {
-        self->items = m_renew(mp_obj_t, self->items, self->alloc, self->alloc * 2);
-        self->alloc *= 2;
+        if (!list_grow(self, self->alloc * 2)) {
+            MP_THREAD_OBJ_UNLOCK(self);
+            m_malloc_fail(self->alloc * 2 * sizeof(mp_obj_t));
+        }
         mp_seq_clear(self->items, self->len + 1, self->alloc, sizeof(*self->items));
     }
     self->items[self->len++] = arg;
+    MP_GC_WRITE_BARRIER(self->items);
+    MP_THREAD_OBJ_UNLOCK(self);
     return mp_const_none; // return None, as per CPython
 }
 
 STATIC mp_obj_t list_extend(mp_obj_t self_in, mp_obj_t arg_in) {
     mp_check_self(mp_obj_is_type(self_in, &mp_type_list));
-    if (mp_obj_is_type(arg_in, &mp_type_list)) {
+    if (mp_obj_is_type(arg_in, &mp_type_list) || mp_obj_is_type(arg_in, &mp_type_tuple)) {
         mp_obj_list_t *self = MP_OBJ_TO_PTR(self_in);
-        mp_obj_list_t *arg = MP_OBJ_TO_PTR(arg_in);
+        size_t arg_len;
+        mp_obj_t *arg_items;
+        // get the items of arg before taking the lock of self, so that two
+        // lists extended by each other in two threads can't deadlock
+        mp_obj_get_array(arg_in, &arg_len, &arg_items);
+        MP_THREAD_OBJ_LOCK(self);
+        if (arg_in == self_in) {
+            arg_len = self->len;
+        }
 
-        if (self->len + arg->len > self->alloc) {
-            // TODO: use alloc policy for "4"
-            self->items = m_renew(mp_obj_t, self->items, self->alloc, self->len + arg->len + 4);
-            self->alloc = self->len + arg->len + 4;
-            mp_seq_clear(self->items, self->len + arg->len, self->alloc, sizeof(*self->items));
+        if (self->len + arg_len > self->alloc) {
+            // at least double the allocation, like append does, so that a
+            // sequence of extends takes linear time overall
+            size_t new_alloc = MAX(self->len + arg_len, self->alloc * 2);
+            if (!list_grow(self, new_alloc)) {
+                MP_THREAD_OBJ_UNLOCK(self);
+                m_malloc_fail(new_alloc * sizeof(mp_obj_t));
+            }
+            mp_seq_clear(self->items, self->len + arg_len, self->alloc, sizeof(*self->items));
+        }
+        if (arg_in == self_in) {
+            // arg is self, so get its items again in case they moved
+            arg_items = self->items;
         }
 
-        memcpy(self->items + self->len, arg->items, sizeof(mp_obj_t) * arg->len);
-        self->len += arg->len;
+        memcpy(self->items + self->len, arg_items, sizeof(mp_obj_t) * arg_len);
+        self->len += arg_len;
+        MP_GC_WRITE_BARRIER(self->items);
+        MP_THREAD_OBJ_UNLOCK(self);
     } else {
         list_extend_from_iter(self_in, arg_in);
     }
     return mp_const_none; // return None, as per CPython
 }
 
-STATIC mp_obj_t list_pop(size_t n_args, const mp_obj_t *args) {
-    mp_check_self(mp_obj_is_type(args[0], &mp_type_list));
+STATIC mp_obj_t list_pop_unlocked(size_t n_args, const mp_obj_t *args) {
     mp_obj_list_t *self = MP_OBJ_TO_PTR(args[0]);
     if (self->len == 0) {
         mp_raise_msg(&mp_type_IndexError, MP_ERROR_TEXT("pop from empty list"));
@@ -279,12 +366,283 @@ STATIC mp_obj_t list_pop(size_t n_args, const mp_obj_t *args) {
     // Clear stale pointer from slot which just got freed to prevent GC issues
     self->items[self->len] = MP_OBJ_NULL;
     if (self->alloc > LIST_MIN_ALLOC && self->alloc > 2 * self->len) {
-        self->items = m_renew(mp_obj_t, self->items, self->alloc, self->alloc / 2);
-        self->alloc /= 2;
+        list_shrink(self, self->alloc / 2);
     }
     return ret;
 }
 
+STATIC mp_obj_t list_pop(size_t n_args, const mp_obj_t *args) {
+    mp_check_self(mp_obj_is_type(args[0], &mp_type_list));
+    return LIST_CALL(list_pop_unlocked, n_args, args);
+}
+
+#if MICROPY_PY_BUILTINS_SORT_STABLE
+
+// A stable, adaptive merge sort after Timsort: the array is cut into runs that
+// are already in order (strictly descending ones are reversed), short runs are
+// extended to a minimum length by binary insertion, and the runs are merged
+// pairwise from a stack.  Data that is already sorted takes n-1 comparisons.
+// An element is w consecutive objects, of which the first is the sort key:
+// with a key function each element is a (key, item) pair.
+
+// The merged run lengths grow at least as fast as Fibonacci numbers, so this
+// many runs can't be pending at once.
+#define SORT_MAX_RUNS (sizeof(size_t) * 8 * 3 / 2)
+
+enum {
+    SORT_CMP_OBJ,
+    SORT_CMP_SMALL_INT,
+    SORT_CMP_STR,
+};
+
+typedef struct _sort_t {
+    mp_obj_t *a;
+    mp_obj_t *tmp;
+    size_t w;
+    uint8_t cmp;
+    bool reverse;
+} sort_t;
+
+// Whether key a goes strictly before key b.  Lists of only small ints or
+// only str are compared directly; comparing other objects can raise.
+STATIC bool sort_lt(const sort_t *s, mp_obj_t a, mp_obj_t b) {
+    if (s->reverse) {
+        mp_obj_t t = a;
+        a = b;
+        b = t;
+    }
+    switch (s->cmp) {
+        case SORT_CMP_SMALL_INT:
+            return MP_OBJ_SMALL_INT_VALUE(a) < MP_OBJ_SMALL_INT_VALUE(b);
+        case SORT_CMP_STR: {
+            GET_STR_DATA_LEN(a, a_data, a_len);
+            GET_STR_DATA_LEN(b, b_data, b_len);
+            return mp_seq_cmp_bytes(MP_BINARY_OP_LESS, a_data, a_len, b_data, b_len);
+        }
+        default:
+            return mp_obj_is_true(mp_binary_op(MP_BINARY_OP_LESS, a, b));
+    }
+}
+
+#define SORT_KEY(s, i) ((s)->a[(i) * (s)->w])
+
+STATIC void sort_move(const sort_t *s, mp_obj_t *dest, const mp_obj_t *src, size_t n) {
+    memmove(dest, src, n * s->w * sizeof(mp_obj_t));
+}
+
+// Return the first index in [lo, hi) whose key goes after the given key or, if
+// strict is false, doesn't go before it.  The keys in [lo, hi) must be in order.
+STATIC size_t sort_search(const sort_t *s, mp_obj_t key, size_t lo, size_t hi, bool strict) {
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (strict ? sort_lt(s, key, SORT_KEY(s, mid)) : !sort_lt(s, SORT_KEY(s, mid), key)) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return lo;
+}
+
+// Sort [lo, hi) by binary insertion, given that [lo, start) is in order.
+STATIC void sort_insertion(const sort_t *s, size_t lo, size_t start, size_t hi) {
+    mp_obj_t elem[2];
+    for (size_t i = start; i < hi; ++i) {
+        size_t pos = sort_search(s, SORT_KEY(s, i), lo, i, true);
+        if (pos < i) {
+            sort_move(s, elem, &s->a[i * s->w], 1);
+            sort_move(s, &s->a[(pos + 1) * s->w], &s->a[pos * s->w], i - pos);
+            sort_move(s, &s->a[pos * s->w], elem, 1);
+        }
+    }
+}
+
+// Return the length of the run starting at lo, made ascending.
+STATIC size_t sort_count_run(const sort_t *s, size_t lo, size_t hi) {
+    size_t i = lo + 1;
+    if (i == hi) {
+        return 1;
+    }
+    if (sort_lt(s, SORT_KEY(s, i), SORT_KEY(s, lo))) {
+        // only a strictly descending run can be reversed without losing stability
+        while (++i < hi && sort_lt(s, SORT_KEY(s, i), SORT_KEY(s, i - 1))) {
+        }
+        mp_obj_t elem[2];
+        for (size_t l = lo, r = i - 1; l < r; ++l, --r) {
+            sort_move(s, elem, &s->a[l * s->w], 1);
+            sort_move(s, &s->a[l * s->w], &s->a[r * s->w], 1);
+            sort_move(s, &s->a[r * s->w], elem, 1);
+        }
+    } else {
+        while (++i < hi && !sort_lt(s, SORT_KEY(s, i), SORT_KEY(s, i - 1))) {
+        }
+    }
+    return i - lo;
+}
+
+// Merge the adjacent runs [lo, mid) and [mid, hi), copying the shorter one
+// out to the temporary buffer, which holds half of the elements.
+STATIC void sort_merge(const sort_t *s, size_t lo, size_t mid, size_t hi) {
+    // the ends of the runs that are already in place are left alone
+    lo = sort_search(s, SORT_KEY(s, mid), lo, mid, true);
+    if (lo == mid) {
+        return;
+    }
+    hi = sort_search(s, SORT_KEY(s, mid - 1), mid, hi, false);
+
+    size_t w = s->w;
+    mp_obj_t *a = s->a;
+    mp_obj_t *tmp = s->tmp;
+    if (mid - lo <= hi - mid) {
+        // merge from the front, taking the left run from tmp
+        size_t n = mid - lo;
+        sort_move(s, tmp, &a[lo * w], n);
+        size_t i = 0, j = mid, k = lo;
+        while (i < n && j < hi) {
+            if (sort_lt(s, a[j * w], tmp[i * w])) {
+                sort_move(s, &a[k++ * w], &a[j++ * w], 1);
+            } else {
+                sort_move(s, &a[k++ * w], &tmp[i++ * w], 1);
+            }
+        }
+        sort_move(s, &a[k * w], &tmp[i * w], n - i);
+    } else {
+        // merge from the back, taking the right run from tmp
+        size_t n = hi - mid;
+        sort_move(s, tmp, &a[mid * w], n);
+        size_t i = mid, j = n, k = hi;
+        while (i > lo && j > 0) {
+            if (sort_lt(s, tmp[(j - 1) * w], a[(i - 1) * w])) {
+                sort_move(s, &a[--k * w], &a[--i * w], 1);
+            } else {
+                sort_move(s, &a[--k * w], &tmp[--j * w], 1);
+            }
+        }
+        sort_move(s, &a[lo * w], tmp, j);
+    }
+}
+
+STATIC void sort_timsort(sort_t *s, size_t n) {
+    // pick a minimum run length so that n / min_run is close to a power of 2
+    size_t min_run = n;
+    size_t extra = 0;
+    while (min_run >= 64) {
+        extra |= min_run & 1;
+        min_run >>= 1;
+    }
+    min_run += extra;
+
+    if (n > min_run) {
+        s->tmp = m_new(mp_obj_t, (n / 2) * s->w);
+    }
+
+    struct {
+        size_t base;
+        size_t len;
+    } runs[SORT_MAX_RUNS];
+    size_t n_runs = 0;
+    size_t lo = 0;
+    for (;;) {
+        if (lo < n) {
+            size_t len = sort_count_run(s, lo, n);
+            if (len < min_run) {
+                size_t forced = MIN(min_run, n - lo);
+                sort_insertion(s, lo, lo + len, lo + forced);
+                len = forced;
+            }
+            runs[n_runs].base = lo;
+            runs[n_runs].len = len;
+            ++n_runs;
+            lo += len;
+        }
+        // Merge runs until the lengths on the stack decrease faster than the
+        // Fibonacci numbers, or down to a single run at the end.
+        while (n_runs > 1) {
+            size_t i = n_runs - 2;
+            if (lo == n
+                || (i > 0 && runs[i - 1].len <= runs[i].len + runs[i + 1].len)
+                || (i > 1 && runs[i - 2].len <= runs[i - 1].len + runs[i].len)) {
+                if (i > 0 && runs[i - 1].len < runs[i + 1].len) {
+                    --i;
+                }
+            } else if (runs[i].len > runs[i + 1].len) {
+                break;
+            }
+            sort_merge(s, runs[i].base, runs[i + 1].base, runs[i + 1].base + runs[i + 1].len);
+            runs[i].len += runs[i + 1].len;
+            if (i + 2 < n_runs) {
+                runs[i + 1] = runs[i + 2];
+            }
+            --n_runs;
+        }
+        if (lo == n) {
+            break;
+        }
+    }
+
+    if (s->tmp != NULL) {
+        m_del(mp_obj_t, s->tmp, (n / 2) * s->w);
+    }
+}
+
+STATIC void list_sort_stable(mp_obj_list_t *self, mp_obj_t key_fn, bool reverse) {
+    size_t n = self->len;
+    sort_t s = { .w = key_fn == MP_OBJ_NULL ? 1 : 2, .tmp = NULL, .reverse = reverse };
+
+    // with a key function, each key is computed once and sorted along with its item
+    mp_obj_t *work = NULL;
+    if (key_fn != MP_OBJ_NULL) {
+        work = m_new(mp_obj_t, 2 * n);
+        for (size_t i = 0; i < n; ++i) {
+            work[2 * i + 1] = self->items[i];
+        }
+        for (size_t i = 0; i < n; ++i) {
+            work[2 * i] = mp_call_function_1(key_fn, work[2 * i + 1]);
+        }
+    }
+
+    s.cmp = SORT_CMP_SMALL_INT;
+    for (size_t i = 0; i < n; ++i) {
+        mp_obj_t key = work == NULL ? self->items[i] : work[2 * i];
+        if (!mp_obj_is_small_int(key)) {
+            s.cmp = SORT_CMP_OBJ;
+            break;
+        }
+    }
+    if (s.cmp == SORT_CMP_OBJ) {
+        s.cmp = SORT_CMP_STR;
+        for (size_t i = 0; i < n; ++i) {
+            mp_obj_t key = work == NULL ? self->items[i] : work[2 * i];
+            if (!mp_obj_is_str(key)) {
+                s.cmp = SORT_CMP_OBJ;
+                break;
+            }
+        }
+    }
+
+    // A comparison that raises would leave the elements half merged, so they
+    // are sorted in a copy unless the comparisons can't fail.
+    if (work == NULL && s.cmp == SORT_CMP_OBJ) {
+        work = m_new(mp_obj_t, n);
+        memcpy(work, self->items, n * sizeof(mp_obj_t));
+    }
+    s.a = work == NULL ? self->items : work;
+
+    sort_timsort(&s, n);
+
+    if (work != NULL) {
+        if (self->len != n) {
+            mp_raise_ValueError(MP_ERROR_TEXT("list modified during sort"));
+        }
+        for (size_t i = 0; i < n; ++i) {
+            self->items[i] = work[i * s.w + s.w - 1];
+        }
+        m_del(mp_obj_t, work, n * s.w);
+    }
+}
+
+#else
+
 STATIC void mp_quicksort(mp_obj_t *head, mp_obj_t *tail, mp_obj_t key_fn, mp_obj_t binop_less_result) {
     MP_STACK_CHECK();
     while (head < tail) {
@@ -317,7 +675,9 @@ STATIC void mp_quicksort(mp_obj_t *head, mp_obj_t *tail, mp_obj_t key_fn, mp_obj
     }
 }
 
-// TODO Python defines sort to be stable but ours is not
+#endif
+
+// Without MICROPY_PY_BUILTINS_SORT_STABLE the sort is not stable, as Python defines it to be
 mp_obj_t mp_obj_list_sort(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
     static const mp_arg_t allowed_args[] = {
         { MP_QSTR_key, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
@@ -335,9 +695,14 @@ mp_obj_t mp_obj_list_sort(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_
     mp_obj_list_t *self = MP_OBJ_TO_PTR(pos_args[0]);
 
     if (self->len > 1) {
+        #if MICROPY_PY_BUILTINS_SORT_STABLE
+        list_sort_stable(self, args.key.u_obj == mp_const_none ? MP_OBJ_NULL : args.key.u_obj,
+            args.reverse.u_bool);
+        #else
         mp_quicksort(self->items, self->items + self->len - 1,
             args.key.u_obj == mp_const_none ? MP_OBJ_NULL : args.key.u_obj,
             args.reverse.u_bool ? mp_const_false : mp_const_true);
+        #endif
     }
 
     return mp_const_none;
@@ -346,34 +711,89 @@ mp_obj_t mp_obj_list_sort(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_
 STATIC mp_obj_t list_clear(mp_obj_t self_in) {
     mp_check_self(mp_obj_is_type(self_in, &mp_type_list));
     mp_obj_list_t *self = MP_OBJ_TO_PTR(self_in);
+    MP_THREAD_OBJ_LOCK(self);
     self->len = 0;
-    self->items = m_renew(mp_obj_t, self->items, self->alloc, LIST_MIN_ALLOC);
-    self->alloc = LIST_MIN_ALLOC;
+    list_shrink(self, LIST_MIN_ALLOC);
     mp_seq_clear(self->items, 0, self->alloc, sizeof(*self->items));
+    MP_THREAD_OBJ_UNLOCK(self);
     return mp_const_none;
 }
 
+STATIC mp_obj_t list_copy_unlocked(size_t n_args, const mp_obj_t *args) {
+    (void)n_args;
+    mp_obj_list_t *self = MP_OBJ_TO_PTR(args[0]);
+    return mp_obj_new_list(self->len, self->items);
+}
+
 STATIC mp_obj_t list_copy(mp_obj_t self_in) {
     mp_check_self(mp_obj_is_type(self_in, &mp_type_list));
-    mp_obj_list_t *self = MP_OBJ_TO_PTR(self_in);
-    return mp_obj_new_list(self->len, self->items);
+    return LIST_CALL(list_copy_unlocked, 1, &self_in);
 }
 
+#if MICROPY_PY_THREAD_OBJ_LOCK
+// Find the first of items start to stop that equals value, from a len and
+// items pair of a list.  __eq__ may run Python code, so the lock of the list
+// isn't held while comparing, and items that another thread has cleared
+// meanwhile are skipped.  Returns stop if none is equal, else the index and
+// the item in *found.
+STATIC size_t list_find(const mp_obj_t *items, size_t start, size_t stop, mp_obj_t value, mp_obj_t *found) {
+    for (; start < stop; start++) {
+        mp_obj_t item = items[start];
+        if (item != MP_OBJ_NULL && mp_obj_equal(item, value)) {
+            *found = item;
+            break;
+        }
+    }
+    return start;
+}
+#endif
+
 STATIC mp_obj_t list_count(mp_obj_t self_in, mp_obj_t value) {
     mp_check_self(mp_obj_is_type(self_in, &mp_type_list));
-    mp_obj_list_t *self = MP_OBJ_TO_PTR(self_in);
-    return mp_seq_count_obj(self->items, self->len, value);
+    size_t len;
+    mp_obj_t *items;
+    mp_obj_list_get(self_in, &len, &items);
+    #if MICROPY_PY_THREAD_OBJ_LOCK
+    size_t count = 0;
+    mp_obj_t found;
+    for (size_t i = list_find(items, 0, len, value, &found); i < len; i = list_find(items, i + 1, len, value, &found)) {
+        count++;
+    }
+    return MP_OBJ_NEW_SMALL_INT(count);
+    #else
+    return mp_seq_count_obj(items, len, value);
+    #endif
 }
 
 STATIC mp_obj_t list_index(size_t n_args, const mp_obj_t *args) {
     mp_check_self(mp_obj_is_type(args[0], &mp_type_list));
-    mp_obj_list_t *self = MP_OBJ_TO_PTR(args[0]);
-    return mp_seq_index_obj(self->items, self->len, n_args, args);
+    size_t len;
+    mp_obj_t *items;
+    mp_obj_list_get(args[0], &len, &items);
+    #if MICROPY_PY_THREAD_OBJ_LOCK
+    size_t start = 0;
+    size_t stop = len;
+    if (n_args >= 3) {
+        start = mp_get_index(&mp_type_list, len, args[2], true);
+        if (n_args >= 4) {
+            stop = mp_get_index(&mp_type_list, len, args[3], true);
+        }
+    }
+    mp_obj_t found;
+    size_t i = list_find(items, start, stop, args[1], &found);
+    if (i >= stop) {
+        mp_raise_ValueError(MP_ERROR_TEXT("object not in sequence"));
+    }
+    return MP_OBJ_NEW_SMALL_INT(i);
+    #else
+    return mp_seq_index_obj(items, len, n_args, args);
+    #endif
 }
 
 STATIC mp_obj_t list_insert(mp_obj_t self_in, mp_obj_t idx, mp_obj_t obj) {
     mp_check_self(mp_obj_is_type(self_in, &mp_type_list));
     mp_obj_list_t *self = MP_OBJ_TO_PTR(self_in);
+    MP_THREAD_OBJ_LOCK(self);
     // insert has its own strange index logic
     mp_int_t index = MP_OBJ_SMALL_INT_VALUE(idx);
     if (index < 0) {
@@ -386,35 +806,72 @@ STATIC mp_obj_t list_insert(mp_obj_t self_in, mp_obj_t idx, mp_obj_t obj) {
         index = self->len;
     }
 
-    mp_obj_list_append(self_in, mp_const_none);
+    if (self->len >= self->alloc) {
+        if (!list_grow(self, self->alloc * 2)) {
+            MP_THREAD_OBJ_UNLOCK(self);
+            m_malloc_fail(self->alloc * 2 * sizeof(mp_obj_t));
+        }
+        mp_seq_clear(self->items, self->len + 1, self->alloc, sizeof(*self->items));
+    }
+    self->len++;
 
     for (mp_int_t i = self->len - 1; i > index; i--) {
         self->items[i] = self->items[i - 1];
     }
     self->items[index] = obj;
+    MP_GC_WRITE_BARRIER(self->items);
+    MP_THREAD_OBJ_UNLOCK(self);
 
     return mp_const_none;
 }
 
 mp_obj_t mp_obj_list_remove(mp_obj_t self_in, mp_obj_t value) {
     mp_check_self(mp_obj_is_type(self_in, &mp_type_list));
+    #if MICROPY_PY_THREAD_OBJ_LOCK
+    // the item is found without holding the lock, so pop it only if it's
+    // still in the same place, and otherwise search again
+    mp_obj_list_t *self = MP_OBJ_TO_PTR(self_in);
+    for (;;) {
+        size_t len;
+        mp_obj_t *items;
+        mp_obj_list_get(self_in, &len, &items);
+        mp_obj_t found;
+        size_t i = list_find(items, 0, len, value, &found);
+        if (i == len) {
+            mp_raise_ValueError(MP_ERROR_TEXT("object not in sequence"));
+        }
+        MP_THREAD_OBJ_LOCK(self);
+        bool same = i < self->len && self->items[i] == found;
+        if (same) {
+            mp_obj_t args[] = {self_in, MP_OBJ_NEW_SMALL_INT(i)};
+            list_pop_unlocked(2, args);
+        }
+        MP_THREAD_OBJ_UNLOCK(self);
+        if (same) {
+            return mp_const_none;
+        }
+    }
+    #else
     mp_obj_t args[] = {self_in, value};
     args[1] = list_index(2, args);
-    list_pop(2, args);
+    list_pop_unlocked(2, args);
 
     return mp_const_none;
+    #endif
 }
 
 STATIC mp_obj_t list_reverse(mp_obj_t self_in) {
     mp_check_self(mp_obj_is_type(self_in, &mp_type_list));
     mp_obj_list_t *self = MP_OBJ_TO_PTR(self_in);
 
+    MP_THREAD_OBJ_LOCK(self);
     mp_int_t len = self->len;
     for (mp_int_t i = 0; i < len / 2; i++) {
         mp_obj_t a = self->items[i];
         self->items[i] = self->items[len - i - 1];
         self->items[len - i - 1] = a;
     }
+    MP_THREAD_OBJ_UNLOCK(self);
 
     return mp_const_none;
 }
@@ -485,8 +942,10 @@ mp_obj_t mp_obj_new_list(size_t n, mp_obj_t *items) {
 
 void mp_obj_list_get(mp_obj_t self_in, size_t *len, mp_obj_t **items) {
     mp_obj_list_t *self = MP_OBJ_TO_PTR(self_in);
+    MP_THREAD_OBJ_LOCK(self);
     *len = self->len;
     *items = self->items;
+    MP_THREAD_OBJ_UNLOCK(self);
 }
 
 void mp_obj_list_set_len(mp_obj_t self_in, size_t len) {
@@ -496,10 +955,18 @@ void mp_obj_list_set_len(mp_obj_t self_in, size_t len) {
     self->len = len;
 }
 
+STATIC mp_obj_t list_store_unlocked(size_t n_args, const mp_obj_t *args) {
+    (void)n_args;
+    mp_obj_list_t *self = MP_OBJ_TO_PTR(args[0]);
+    size_t i = mp_get_index(self->base.type, self->len, args[1], false);
+    self->items[i] = args[2];
+    MP_GC_WRITE_BARRIER(self->items);
+    return mp_const_none;
+}
+
 void mp_obj_list_store(mp_obj_t self_in, mp_obj_t index, mp_obj_t value) {
-    mp_obj_list_t *self = MP_OBJ_TO_PTR(self_in);
-    size_t i = mp_get_index(self->base.type, self->len, index, false);
-    self->items[i] = value;
+    mp_obj_t args[3] = {self_in, index, value};
+    LIST_CALL(list_store_unlocked, 3, args);
 }
 
 /******************************************************************************/
@@ -514,9 +981,11 @@ typedef struct _mp_obj_list_it_t {
 
 STATIC mp_obj_t list_it_iternext(mp_obj_t self_in) {
     mp_obj_list_it_t *self = MP_OBJ_TO_PTR(self_in);
-    mp_obj_list_t *list = MP_OBJ_TO_PTR(self->list);
-    if (self->cur < list->len) {
-        mp_obj_t o_out = list->items[self->cur];
+    size_t len;
+    mp_obj_t *items;
+    mp_obj_list_get(self->list, &len, &items);
+    if (self->cur < len) {
+        mp_obj_t o_out = items[self->cur];
         self->cur += 1;
         return o_out;
     } else {
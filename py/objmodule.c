@@ -76,7 +76,12 @@ STATIC void module_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest) {
     } else {
         // delete/store attribute
         mp_obj_dict_t *dict = self->globals;
-        if (dict->map.is_fixed) {
+        if (dict->map.is_fixed
+            #if MICROPY_MODULE_FROZEN_ROM_GLOBALS
+            // the globals of a frozen module are copied when written to
+            && !dict->map.copy_on_write
+            #endif
+            ) {
             #if MICROPY_CAN_OVERRIDE_BUILTINS
             if (dict == &mp_module_builtins_globals) {
                 if (MP_STATE_VM(mp_module_builtins_override_dict) == NULL) {
@@ -136,7 +141,9 @@ mp_obj_t mp_obj_new_module(qstr module_name) {
 // Global module table and related functions
 
 STATIC const mp_rom_map_elem_t mp_builtin_module_table[] = {
+    #if !MICROPY_MULTIPLE_INSTANCES
     { MP_ROM_QSTR(MP_QSTR___main__), MP_ROM_PTR(&mp_module___main__) },
+    #endif
     { MP_ROM_QSTR(MP_QSTR_builtins), MP_ROM_PTR(&mp_module_builtins) },
     { MP_ROM_QSTR(MP_QSTR_micropython), MP_ROM_PTR(&mp_module_micropython) },
 
@@ -185,6 +192,9 @@ STATIC const mp_rom_map_elem_t mp_builtin_module_table[] = {
     #if MICROPY_PY_UJSON
     { MP_ROM_QSTR(MP_QSTR_ujson), MP_ROM_PTR(&mp_module_ujson) },
     #endif
+    #if MICROPY_PY_UCBOR
+    { MP_ROM_QSTR(MP_QSTR_ucbor), MP_ROM_PTR(&mp_module_ucbor) },
+    #endif
     #if MICROPY_PY_URE
     { MP_ROM_QSTR(MP_QSTR_ure), MP_ROM_PTR(&mp_module_ure) },
     #endif
@@ -224,6 +234,12 @@ STATIC const mp_rom_map_elem_t mp_builtin_module_table[] = {
     #if MICROPY_PY_FRAMEBUF
     { MP_ROM_QSTR(MP_QSTR_framebuf), MP_ROM_PTR(&mp_module_framebuf) },
     #endif
+    #if MICROPY_PY_DISPLAY
+    { MP_ROM_QSTR(MP_QSTR__display), MP_ROM_PTR(&mp_module_display) },
+    #endif
+    #if MICROPY_PY_NRF24L01
+    { MP_ROM_QSTR(MP_QSTR__nrf24l01), MP_ROM_PTR(&mp_module_nrf24l01) },
+    #endif
     #if MICROPY_PY_BTREE
     { MP_ROM_QSTR(MP_QSTR_btree), MP_ROM_PTR(&mp_module_btree) },
     #endif
@@ -263,7 +279,7 @@ mp_obj_t mp_module_get(qstr module_name) {
 
 void mp_module_register(qstr qst, mp_obj_t module) {
     mp_map_t *mp_loaded_modules_map = &MP_STATE_VM(mp_loaded_modules_dict).map;
-    mp_map_lookup(mp_loaded_modules_map, MP_OBJ_NEW_QSTR(qst), MP_MAP_LOOKUP_ADD_IF_NOT_FOUND)->value = module;
+    mp_map_store(mp_loaded_modules_map, MP_OBJ_NEW_QSTR(qst), module);
 }
 
 #if MICROPY_MODULE_WEAK_LINKS
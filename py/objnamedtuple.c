@@ -35,6 +35,21 @@
 #if MICROPY_PY_COLLECTIONS
 
 size_t mp_obj_namedtuple_find_field(const mp_obj_namedtuple_type_t *type, qstr name) {
+    #if MICROPY_OPT_NAMEDTUPLE_FIELD_INDEX
+    size_t mask = type->index_mask;
+    if (mask != 0) {
+        const byte *index = (const byte *)&type->fields[type->n_fields];
+        for (size_t i = name & mask;; i = (i + 1) & mask) {
+            size_t id = index[i];
+            if (id == 0) {
+                return (size_t)-1;
+            }
+            if (type->fields[id - 1] == name) {
+                return id - 1;
+            }
+        }
+    }
+    #endif
     for (size_t i = 0; i < type->n_fields; i++) {
         if (type->fields[i] == name) {
             return i;
@@ -51,7 +66,9 @@ STATIC mp_obj_t namedtuple_asdict(mp_obj_t self_in) {
     // make it an OrderedDict
     mp_obj_dict_t *dictObj = MP_OBJ_TO_PTR(dict);
     dictObj->base.type = &mp_type_ordereddict;
+    #if !MICROPY_OPT_MAP_COMPACT
     dictObj->map.is_ordered = 1;
+    #endif
     for (size_t i = 0; i < self->tuple.len; ++i) {
         mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(fields[i]), self->tuple.items[i]);
     }
@@ -60,6 +77,65 @@ STATIC mp_obj_t namedtuple_asdict(mp_obj_t self_in) {
 MP_DEFINE_CONST_FUN_OBJ_1(namedtuple_asdict_obj, namedtuple_asdict);
 #endif
 
+STATIC mp_obj_t namedtuple_make_new(const mp_obj_type_t *type_in, size_t n_args, size_t n_kw, const mp_obj_t *args);
+
+#if MICROPY_PY_COLLECTIONS_NAMEDTUPLE__MAKE_REPLACE
+STATIC mp_obj_t namedtuple_make(mp_obj_t type_in, mp_obj_t iterable) {
+    // a tuple or list is used as is, anything else is made into a tuple
+    if (!mp_obj_is_type(iterable, &mp_type_tuple) && !mp_obj_is_type(iterable, &mp_type_list)) {
+        iterable = mp_call_function_1(MP_OBJ_FROM_PTR(&mp_type_tuple), iterable);
+    }
+    size_t len;
+    mp_obj_t *items;
+    mp_obj_get_array(iterable, &len, &items);
+    return namedtuple_make_new(MP_OBJ_TO_PTR(type_in), len, 0, items);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(namedtuple_make_fun_obj, namedtuple_make);
+STATIC MP_DEFINE_CONST_CLASSMETHOD_OBJ(namedtuple_make_obj, MP_ROM_PTR(&namedtuple_make_fun_obj));
+
+STATIC mp_obj_t namedtuple_replace(size_t n_args, const mp_obj_t *args, mp_map_t *kw_args) {
+    if (n_args != 1) {
+        mp_raise_TypeError(NULL);
+    }
+    mp_obj_namedtuple_t *self = MP_OBJ_TO_PTR(args[0]);
+    const mp_obj_namedtuple_type_t *type = (const mp_obj_namedtuple_type_t *)self->tuple.base.type;
+    mp_obj_tuple_t *tuple = MP_OBJ_TO_PTR(mp_obj_new_tuple(self->tuple.len, self->tuple.items));
+    tuple->base.type = self->tuple.base.type;
+    for (size_t i = 0; i < kw_args->alloc; i++) {
+        if (mp_map_slot_is_filled(kw_args, i)) {
+            qstr kw = mp_obj_str_get_qstr(kw_args->table[i].key);
+            size_t id = mp_obj_namedtuple_find_field(type, kw);
+            if (id == (size_t)-1) {
+                #if MICROPY_ERROR_REPORTING <= MICROPY_ERROR_REPORTING_TERSE
+                mp_raise_ValueError(NULL);
+                #else
+                mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("unexpected field name '%q'"), kw);
+                #endif
+            }
+            tuple->items[id] = kw_args->table[i].value;
+        }
+    }
+    return MP_OBJ_FROM_PTR(tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(namedtuple_replace_obj, 1, namedtuple_replace);
+#endif
+
+#if MICROPY_PY_COLLECTIONS_NAMEDTUPLE__ASDICT || MICROPY_PY_COLLECTIONS_NAMEDTUPLE__MAKE_REPLACE
+STATIC const mp_rom_map_elem_t namedtuple_locals_dict_table[] = {
+    #if MICROPY_PY_COLLECTIONS_NAMEDTUPLE__ASDICT
+    { MP_ROM_QSTR(MP_QSTR__asdict), MP_ROM_PTR(&namedtuple_asdict_obj) },
+    #endif
+    #if MICROPY_PY_COLLECTIONS_NAMEDTUPLE__MAKE_REPLACE
+    { MP_ROM_QSTR(MP_QSTR__make), MP_ROM_PTR(&namedtuple_make_obj) },
+    { MP_ROM_QSTR(MP_QSTR__replace), MP_ROM_PTR(&namedtuple_replace_obj) },
+    #endif
+};
+STATIC MP_DEFINE_CONST_DICT(namedtuple_locals_dict, namedtuple_locals_dict_table);
+#define NAMEDTUPLE_HAS_LOCALS_DICT (1)
+#else
+#define NAMEDTUPLE_HAS_LOCALS_DICT (0)
+#endif
+
 STATIC void namedtuple_print(const mp_print_t *print, mp_obj_t o_in, mp_print_kind_t kind) {
     (void)kind;
     mp_obj_namedtuple_t *o = MP_OBJ_TO_PTR(o_in);
@@ -72,15 +148,15 @@ STATIC void namedtuple_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest) {
     if (dest[0] == MP_OBJ_NULL) {
         // load attribute
         mp_obj_namedtuple_t *self = MP_OBJ_TO_PTR(self_in);
-        #if MICROPY_PY_COLLECTIONS_NAMEDTUPLE__ASDICT
-        if (attr == MP_QSTR__asdict) {
-            dest[0] = MP_OBJ_FROM_PTR(&namedtuple_asdict_obj);
-            dest[1] = self_in;
-            return;
-        }
-        #endif
         size_t id = mp_obj_namedtuple_find_field((mp_obj_namedtuple_type_t *)self->tuple.base.type, attr);
         if (id == (size_t)-1) {
+            #if NAMEDTUPLE_HAS_LOCALS_DICT
+            // the methods, as the type has its own attr the generic lookup isn't done
+            mp_map_elem_t *elem = mp_map_lookup((mp_map_t *)&namedtuple_locals_dict.map, MP_OBJ_NEW_QSTR(attr), MP_MAP_LOOKUP);
+            if (elem != NULL) {
+                mp_convert_member_lookup(self_in, self->tuple.base.type, elem->value, dest);
+            }
+            #endif
             return;
         }
         dest[0] = self->tuple.items[id];
@@ -142,12 +218,39 @@ STATIC mp_obj_t namedtuple_make_new(const mp_obj_type_t *type_in, size_t n_args,
 }
 
 mp_obj_namedtuple_type_t *mp_obj_new_namedtuple_base(size_t n_fields, mp_obj_t *fields) {
+    #if MICROPY_OPT_NAMEDTUPLE_FIELD_INDEX
+    // the index is at most half full, and only up to 255 fields fit in a byte
+    size_t index_len = 0;
+    if (n_fields < 256) {
+        index_len = 4;
+        while (index_len < 2 * n_fields) {
+            index_len *= 2;
+        }
+    }
+    mp_obj_namedtuple_type_t *o = m_new_obj_var(mp_obj_namedtuple_type_t, byte, n_fields * sizeof(qstr) + index_len);
+    #else
     mp_obj_namedtuple_type_t *o = m_new_obj_var(mp_obj_namedtuple_type_t, qstr, n_fields);
+    #endif
     memset(&o->base, 0, sizeof(o->base));
     o->n_fields = n_fields;
     for (size_t i = 0; i < n_fields; i++) {
         o->fields[i] = mp_obj_str_get_qstr(fields[i]);
     }
+    #if MICROPY_OPT_NAMEDTUPLE_FIELD_INDEX
+    o->index_mask = index_len - 1;
+    if (index_len != 0) {
+        // a repeated name is put after the first, so the first is found
+        byte *index = (byte *)&o->fields[n_fields];
+        memset(index, 0, index_len);
+        for (size_t id = 0; id < n_fields; id++) {
+            size_t i = o->fields[id] & o->index_mask;
+            while (index[i] != 0) {
+                i = (i + 1) & o->index_mask;
+            }
+            index[i] = id + 1;
+        }
+    }
+    #endif
     return o;
 }
 
@@ -164,6 +267,9 @@ STATIC mp_obj_t mp_obj_new_namedtuple_type(qstr name, size_t n_fields, mp_obj_t
     o->base.subscr = mp_obj_tuple_subscr;
     o->base.getiter = mp_obj_tuple_getiter;
     o->base.parent = &mp_type_tuple;
+    #if NAMEDTUPLE_HAS_LOCALS_DICT
+    o->base.locals_dict = (mp_obj_dict_t *)&namedtuple_locals_dict;
+    #endif
     return MP_OBJ_FROM_PTR(o);
 }
 
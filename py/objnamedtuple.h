@@ -30,6 +30,12 @@
 
 typedef struct _mp_obj_namedtuple_type_t {
     mp_obj_type_t base;
+    #if MICROPY_OPT_NAMEDTUPLE_FIELD_INDEX
+    // The index follows the fields, as a hash table of 1 + the index of the
+    // field with the name, or 0 for an empty entry.  A mask of 0 means there
+    // is no index and the fields are searched in turn.
+    size_t index_mask;
+    #endif
     size_t n_fields;
     qstr fields[];
 } mp_obj_namedtuple_type_t;
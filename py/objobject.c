@@ -28,6 +28,7 @@
 
 #include "py/objtype.h"
 #include "py/runtime.h"
+#include "py/gc.h"
 
 typedef struct _mp_obj_object_t {
     mp_obj_base_t base;
@@ -63,6 +64,21 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_1(object___new___fun_obj, object___new__);
 STATIC MP_DEFINE_CONST_STATICMETHOD_OBJ(object___new___obj, MP_ROM_PTR(&object___new___fun_obj));
 
 #if MICROPY_PY_DELATTR_SETATTR
+#if MICROPY_PY_SLOTS
+// Return the slot of self for attr, or NULL if it isn't one of its slots, in
+// which case attr can only be stored in self->members if there are any.
+STATIC mp_obj_t *object_get_slot(mp_obj_instance_t *self, mp_obj_t attr) {
+    size_t len;
+    const char *str = mp_obj_str_get_data(attr, &len);
+    qstr q = qstr_find_strn(str, len);
+    mp_obj_t *slot = q == MP_QSTRnull ? NULL : mp_obj_instance_get_slot(self, q);
+    if (slot == NULL && ((const mp_obj_class_t *)self->base.type)->no_dict) {
+        mp_raise_msg(&mp_type_AttributeError, MP_ERROR_TEXT("no such attribute"));
+    }
+    return slot;
+}
+#endif
+
 STATIC mp_obj_t object___setattr__(mp_obj_t self_in, mp_obj_t attr, mp_obj_t value) {
     if (!mp_obj_is_instance_type(mp_obj_get_type(self_in))) {
         mp_raise_TypeError(MP_ERROR_TEXT("arg must be user-type"));
@@ -73,7 +89,15 @@ STATIC mp_obj_t object___setattr__(mp_obj_t self_in, mp_obj_t attr, mp_obj_t val
     }
 
     mp_obj_instance_t *self = MP_OBJ_TO_PTR(self_in);
-    mp_map_lookup(&self->members, attr, MP_MAP_LOOKUP_ADD_IF_NOT_FOUND)->value = value;
+    #if MICROPY_PY_SLOTS
+    mp_obj_t *slot = object_get_slot(self, attr);
+    if (slot != NULL) {
+        *slot = value;
+        MP_GC_WRITE_BARRIER(slot);
+        return mp_const_none;
+    }
+    #endif
+    mp_map_store(&self->members, attr, value);
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_3(object___setattr___obj, object___setattr__);
@@ -88,6 +112,16 @@ STATIC mp_obj_t object___delattr__(mp_obj_t self_in, mp_obj_t attr) {
     }
 
     mp_obj_instance_t *self = MP_OBJ_TO_PTR(self_in);
+    #if MICROPY_PY_SLOTS
+    mp_obj_t *slot = object_get_slot(self, attr);
+    if (slot != NULL) {
+        if (*slot == MP_OBJ_NULL) {
+            mp_raise_msg(&mp_type_AttributeError, MP_ERROR_TEXT("no such attribute"));
+        }
+        *slot = MP_OBJ_NULL;
+        return mp_const_none;
+    }
+    #endif
     if (mp_map_lookup(&self->members, attr, MP_MAP_LOOKUP_REMOVE_IF_FOUND) == NULL) {
         mp_raise_msg(&mp_type_AttributeError, MP_ERROR_TEXT("no such attribute"));
     }
@@ -129,17 +129,21 @@ STATIC mp_obj_t set_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_
 
 STATIC mp_obj_t set_it_iternext(mp_obj_t self_in) {
     mp_obj_set_it_t *self = MP_OBJ_TO_PTR(self_in);
-    size_t max = self->set->set.alloc;
     mp_set_t *set = &self->set->set;
+    mp_obj_t elem = MP_OBJ_STOP_ITERATION;
+    MP_THREAD_OBJ_LOCK(set);
+    size_t max = set->alloc;
 
     for (size_t i = self->cur; i < max; i++) {
         if (mp_set_slot_is_filled(set, i)) {
             self->cur = i + 1;
-            return set->table[i];
+            elem = set->table[i];
+            break;
         }
     }
 
-    return MP_OBJ_STOP_ITERATION;
+    MP_THREAD_OBJ_UNLOCK(set);
+    return elem;
 }
 
 STATIC mp_obj_t set_getiter(mp_obj_t set_in, mp_obj_iter_buf_t *iter_buf) {
@@ -40,6 +40,9 @@ STATIC mp_obj_t str_modulo_format(mp_obj_t pattern, size_t n_args, const mp_obj_
 
 STATIC mp_obj_t mp_obj_new_bytes_iterator(mp_obj_t str, mp_obj_iter_buf_t *iter_buf);
 STATIC NORETURN void bad_implicit_conversion(mp_obj_t self_in);
+#if MICROPY_PY_BUILTINS_STR_UNICODE_INDEX
+STATIC size_t str_index_alloc(const byte *data, size_t len, size_t *charlen);
+#endif
 
 /******************************************************************************/
 /* str                                                                        */
@@ -176,6 +179,14 @@ mp_obj_t mp_obj_str_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_
                 mp_obj_str_t *o = MP_OBJ_TO_PTR(mp_obj_new_str_copy(type, NULL, str_len));
                 o->data = str_data;
                 o->hash = str_hash;
+                #if MICROPY_PY_BUILTINS_STR_UNICODE_INDEX
+                // the data is shared with the bytes object so there is no room for an index
+                size_t charlen;
+                str_index_alloc(str_data, str_len, &charlen);
+                if (charlen == 0) {
+                    o->hash |= MP_OBJ_STR_FLAG_ASCII;
+                }
+                #endif
                 return MP_OBJ_FROM_PTR(o);
             } else {
                 mp_buffer_info_t bufinfo;
@@ -276,26 +287,74 @@ wrong_args:
 
 // like strstr but with specified length and allows \0 bytes
 // TODO replace with something more efficient/standard
+#if MICROPY_OPT_FIND_SUBBYTES_HORSPOOL
+// Search forwards with the Boyer-Moore-Horspool algorithm: on a mismatch the
+// haystack byte under the end of the needle gives how far the needle can move
+// along, up to its length (capped at 255 to keep the table small).  Building
+// the table has a cost, so this is only used once a search turns out to be
+// slow with memchr.
+STATIC const byte *find_subbytes_horspool(const byte *haystack, size_t hlen, const byte *needle, size_t nlen) {
+    uint8_t skip[256];
+    memset(skip, MIN(nlen, 255), sizeof(skip));
+    for (size_t i = nlen > 255 ? nlen - 255 : 0; i < nlen - 1; ++i) {
+        skip[needle[i]] = nlen - 1 - i;
+    }
+    byte last = needle[nlen - 1];
+    for (const byte *p = haystack, *end = haystack + hlen - nlen; p <= end;) {
+        byte c = p[nlen - 1];
+        if (c == last && memcmp(p, needle, nlen - 1) == 0) {
+            return p;
+        }
+        p += skip[c];
+    }
+    return NULL;
+}
+#endif
+
 const byte *find_subbytes(const byte *haystack, size_t hlen, const byte *needle, size_t nlen, int direction) {
-    if (hlen >= nlen) {
-        size_t str_index, str_index_end;
-        if (direction > 0) {
-            str_index = 0;
-            str_index_end = hlen - nlen;
-        } else {
-            str_index = hlen - nlen;
-            str_index_end = 0;
+    if (hlen < nlen) {
+        return NULL;
+    }
+    if (nlen == 0) {
+        return direction > 0 ? haystack : haystack + hlen;
+    }
+    const byte *end = haystack + hlen - nlen;
+    if (direction > 0) {
+        // Use memchr, which is usually optimised to scan a word at a time, to
+        // skip to each candidate first byte.
+        #if MICROPY_OPT_FIND_SUBBYTES_HORSPOOL
+        size_t misses = 0;
+        const byte *window = haystack;
+        #endif
+        for (const byte *p = haystack; p <= end; ++p) {
+            p = memchr(p, needle[0], end - p + 1);
+            if (p == NULL) {
+                break;
+            }
+            if (memcmp(p + 1, needle + 1, nlen - 1) == 0) {
+                return p;
+            }
+            #if MICROPY_OPT_FIND_SUBBYTES_HORSPOOL
+            // If memchr stops more often than every nlen bytes then the first
+            // byte of the needle is common here, so search the rest with
+            // Horspool, which moves along by about nlen bytes per step.
+            if (++misses % 16 == 0) {
+                if (nlen >= MICROPY_OPT_FIND_SUBBYTES_HORSPOOL_MIN_LEN
+                    && (size_t)(p - window) < 16 * nlen && end - p >= 256) {
+                    return find_subbytes_horspool(p + 1, hlen - (p + 1 - haystack), needle, nlen);
+                }
+                window = p;
+            }
+            #endif
         }
-        for (;;) {
-            if (memcmp(&haystack[str_index], needle, nlen) == 0) {
-                // found
-                return haystack + str_index;
+    } else {
+        for (const byte *p = end;; --p) {
+            if (*p == needle[0] && memcmp(p + 1, needle + 1, nlen - 1) == 0) {
+                return p;
             }
-            if (str_index == str_index_end) {
-                // not found
+            if (p == haystack) {
                 break;
             }
-            str_index += direction;
         }
     }
     return NULL;
@@ -415,9 +474,9 @@ mp_obj_t mp_obj_str_binary_op(mp_binary_op_t op, mp_obj_t lhs_in, mp_obj_t rhs_i
 
 #if !MICROPY_PY_BUILTINS_STR_UNICODE
 // objstrunicode defines own version
-const byte *str_index_to_ptr(const mp_obj_type_t *type, const byte *self_data, size_t self_len,
+const byte *str_index_to_ptr(mp_obj_t self_in, const byte *self_data, size_t self_len,
     mp_obj_t index, bool is_slice) {
-    size_t index_val = mp_get_index(type, self_len, index, is_slice);
+    size_t index_val = mp_get_index(mp_obj_get_type(self_in), self_len, index, is_slice);
     return self_data + index_val;
 }
 #endif
@@ -558,14 +617,9 @@ mp_obj_t mp_obj_str_split(size_t n_args, const mp_obj_t *args) {
 
         for (;;) {
             const byte *start = s;
-            for (;;) {
-                if (splits == 0 || s + sep_len > top) {
-                    s = top;
-                    break;
-                } else if (memcmp(s, sep_str, sep_len) == 0) {
-                    break;
-                }
-                s++;
+            s = splits == 0 ? NULL : find_subbytes(s, top - s, (const byte *)sep_str, sep_len, 1);
+            if (s == NULL) {
+                s = top;
             }
             mp_obj_list_append(res, mp_obj_new_str_of_type(self_type, start, s - start));
             if (s >= top) {
@@ -709,10 +763,10 @@ STATIC mp_obj_t str_finder(size_t n_args, const mp_obj_t *args, int direction, b
     const byte *start = haystack;
     const byte *end = haystack + haystack_len;
     if (n_args >= 3 && args[2] != mp_const_none) {
-        start = str_index_to_ptr(self_type, haystack, haystack_len, args[2], true);
+        start = str_index_to_ptr(args[0], haystack, haystack_len, args[2], true);
     }
     if (n_args >= 4 && args[3] != mp_const_none) {
-        end = str_index_to_ptr(self_type, haystack, haystack_len, args[3], true);
+        end = str_index_to_ptr(args[0], haystack, haystack_len, args[3], true);
     }
 
     if (end < start) {
@@ -732,7 +786,7 @@ STATIC mp_obj_t str_finder(size_t n_args, const mp_obj_t *args, int direction, b
         // found
         #if MICROPY_PY_BUILTINS_STR_UNICODE
         if (self_type == &mp_type_str) {
-            return MP_OBJ_NEW_SMALL_INT(utf8_ptr_to_index(haystack, p));
+            return MP_OBJ_NEW_SMALL_INT(str_ptr_to_index(args[0], haystack, p));
         }
         #endif
         return MP_OBJ_NEW_SMALL_INT(p - haystack);
@@ -761,13 +815,12 @@ MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(str_rindex_obj, 2, 4, str_rindex);
 
 // TODO: (Much) more variety in args
 STATIC mp_obj_t str_startswith(size_t n_args, const mp_obj_t *args) {
-    const mp_obj_type_t *self_type = mp_obj_get_type(args[0]);
     GET_STR_DATA_LEN(args[0], str, str_len);
     size_t prefix_len;
     const char *prefix = mp_obj_str_get_data(args[1], &prefix_len);
     const byte *start = str;
     if (n_args > 2) {
-        start = str_index_to_ptr(self_type, str, str_len, args[2], true);
+        start = str_index_to_ptr(args[0], str, str_len, args[2], true);
     }
     if (prefix_len + (start - str) > str_len) {
         return mp_const_false;
@@ -1736,10 +1789,10 @@ STATIC mp_obj_t str_count(size_t n_args, const mp_obj_t *args) {
     const byte *start = haystack;
     const byte *end = haystack + haystack_len;
     if (n_args >= 3 && args[2] != mp_const_none) {
-        start = str_index_to_ptr(self_type, haystack, haystack_len, args[2], true);
+        start = str_index_to_ptr(args[0], haystack, haystack_len, args[2], true);
     }
     if (n_args >= 4 && args[3] != mp_const_none) {
-        end = str_index_to_ptr(self_type, haystack, haystack_len, args[3], true);
+        end = str_index_to_ptr(args[0], haystack, haystack_len, args[3], true);
     }
 
     // if needle_len is zero then we count each gap between characters as an occurrence
@@ -2022,6 +2075,47 @@ const mp_obj_type_t mp_type_bytes = {
 // The zero-length bytes object, with data that includes a null-terminating byte
 const mp_obj_str_t mp_const_empty_bytes_obj = {{&mp_type_bytes}, 0, 0, (const byte *)""};
 
+#if MICROPY_PY_BUILTINS_STR_UNICODE_INDEX
+// Return the number of bytes to allocate for the data of a str object: the data
+// itself, the null byte and, for a long non-ASCII string, its character index.
+// The number of characters is returned in *charlen, or 0 if the data is ASCII.
+STATIC size_t str_index_alloc(const byte *data, size_t len, size_t *charlen) {
+    size_t n = 0;
+    byte all = 0;
+    for (const byte *top = data + len; data < top; ++data) {
+        all |= *data;
+        n += !UTF8_IS_CONT(*data);
+    }
+    *charlen = UTF8_IS_NONASCII(all) ? n : 0;
+    if (*charlen <= MP_OBJ_STR_INDEX_STRIDE) {
+        return len + 1;
+    }
+    return ((len + 4) & ~3) + (1 + (n - 1) / MP_OBJ_STR_INDEX_STRIDE) * sizeof(uint32_t);
+}
+
+// Write the character index of a str object after its data, if room was made
+// for it by str_index_alloc, and return the flags to put in its hash field.
+STATIC mp_uint_t str_index_init(byte *data, size_t len, size_t charlen, size_t alloc) {
+    if (charlen == 0) {
+        return MP_OBJ_STR_FLAG_ASCII;
+    } else if (alloc == len + 1) {
+        return 0;
+    }
+    uint32_t *index = (uint32_t *)MP_OBJ_STR_INDEX(data, len);
+    index[0] = charlen;
+    size_t n = 0;
+    for (size_t i = 0; i < len; ++i) {
+        if (!UTF8_IS_CONT(data[i])) {
+            if (n != 0 && n % MP_OBJ_STR_INDEX_STRIDE == 0) {
+                index[n / MP_OBJ_STR_INDEX_STRIDE] = i;
+            }
+            ++n;
+        }
+    }
+    return MP_OBJ_STR_FLAG_INDEX;
+}
+#endif
+
 // Create a str/bytes object using the given data.  New memory is allocated and
 // the data is copied across.  This function should only be used if the type is bytes,
 // or if the type is str and the string data is known to be not interned.
@@ -2031,10 +2125,22 @@ mp_obj_t mp_obj_new_str_copy(const mp_obj_type_t *type, const byte *data, size_t
     o->len = len;
     if (data) {
         o->hash = qstr_compute_hash(data, len);
-        byte *p = m_new(byte, len + 1);
+        size_t alloc = len + 1;
+        #if MICROPY_PY_BUILTINS_STR_UNICODE_INDEX
+        size_t charlen = 0;
+        if (type == &mp_type_str) {
+            alloc = str_index_alloc(data, len, &charlen);
+        }
+        #endif
+        byte *p = m_new_no_scan(byte, alloc);
         o->data = p;
         memcpy(p, data, len * sizeof(byte));
         p[len] = '\0'; // for now we add null for compatibility with C ASCIIZ strings
+        #if MICROPY_PY_BUILTINS_STR_UNICODE_INDEX
+        if (type == &mp_type_str) {
+            o->hash |= str_index_init(p, len, charlen, alloc);
+        }
+        #endif
     }
     return MP_OBJ_FROM_PTR(o);
 }
@@ -2074,12 +2180,24 @@ mp_obj_t mp_obj_new_str_from_vstr(const mp_obj_type_t *type, vstr_t *vstr) {
     o->base.type = type;
     o->len = vstr->len;
     o->hash = qstr_compute_hash((byte *)vstr->buf, vstr->len);
-    if (vstr->len + 1 == vstr->alloc) {
+    size_t alloc = vstr->len + 1;
+    #if MICROPY_PY_BUILTINS_STR_UNICODE_INDEX
+    size_t charlen = 0;
+    if (type == &mp_type_str) {
+        alloc = str_index_alloc((byte *)vstr->buf, vstr->len, &charlen);
+    }
+    #endif
+    if (alloc == vstr->alloc) {
         o->data = (byte *)vstr->buf;
     } else {
-        o->data = (byte *)m_renew(char, vstr->buf, vstr->alloc, vstr->len + 1);
+        o->data = (byte *)m_renew(char, vstr->buf, vstr->alloc, alloc);
     }
     ((byte *)o->data)[o->len] = '\0'; // add null byte
+    #if MICROPY_PY_BUILTINS_STR_UNICODE_INDEX
+    if (type == &mp_type_str) {
+        o->hash |= str_index_init((byte *)o->data, o->len, charlen, alloc);
+    }
+    #endif
     vstr->buf = NULL;
     vstr->alloc = 0;
     return MP_OBJ_FROM_PTR(o);
@@ -2107,6 +2225,31 @@ mp_obj_t mp_obj_str_intern_checked(mp_obj_t obj) {
     return mp_obj_new_str_via_qstr((const char *)data, len);
 }
 
+#if MICROPY_PY_INTERN_DECODED_KEYS
+// Returns a short str key of a decoded dict as a qstr, making a new one only
+// while fewer than MICROPY_PY_INTERN_DECODED_KEYS have been made this way.
+// Any other key is returned as it is.
+mp_obj_t mp_obj_str_intern_key(mp_obj_t key) {
+    if (!mp_obj_is_type(key, &mp_type_str)) {
+        return key;
+    }
+    mp_obj_str_t *o = MP_OBJ_TO_PTR(key);
+    if (o->len > MICROPY_PY_INTERN_DECODED_KEYS_MAX_LEN) {
+        return key;
+    }
+    qstr q = qstr_find_strn((const char *)o->data, o->len);
+    if (q == MP_QSTRnull) {
+        // the count is shared by all threads so is only changed with the qstr lock held
+        q = qstr_from_strn_limited((const char *)o->data, o->len,
+            &MP_STATE_VM(intern_key_count), MICROPY_PY_INTERN_DECODED_KEYS);
+        if (q == MP_QSTRnull) {
+            return key;
+        }
+    }
+    return MP_OBJ_NEW_QSTR(q);
+}
+#endif
+
 mp_obj_t mp_obj_new_bytes(const byte *data, size_t len) {
     return mp_obj_new_str_copy(&mp_type_bytes, data, len);
 }
@@ -38,11 +38,27 @@ typedef struct _mp_obj_str_t {
 
 #define MP_DEFINE_STR_OBJ(obj_name, str) mp_obj_str_t obj_name = {{&mp_type_str}, 0, sizeof(str) - 1, (const byte *)str}
 
+#if MICROPY_PY_BUILTINS_STR_UNICODE_INDEX
+// A hash only uses the low MICROPY_QSTR_BYTES_IN_HASH bytes of the hash field,
+// so str objects made by mp_obj_new_str_copy and mp_obj_new_str_from_vstr keep
+// flags about their data above it.  With MP_OBJ_STR_FLAG_INDEX the data is
+// followed by its null byte, padding to a 4-byte boundary, the number of
+// characters as a uint32_t and then the byte offset of every
+// MP_OBJ_STR_INDEX_STRIDE'th character, starting from the first multiple.
+#define MP_OBJ_STR_HASH_MASK ((1 << (8 * MICROPY_QSTR_BYTES_IN_HASH)) - 1)
+#define MP_OBJ_STR_FLAG_ASCII (0x10000) // every byte is below 0x80
+#define MP_OBJ_STR_FLAG_INDEX (0x20000) // the data is followed by a character index
+#define MP_OBJ_STR_INDEX_STRIDE (32)
+#define MP_OBJ_STR_INDEX(data, len) ((const uint32_t *)((data) + (((len) + 4) & ~3)))
+#else
+#define MP_OBJ_STR_HASH_MASK ((mp_uint_t)-1)
+#endif
+
 // use this macro to extract the string hash
 // warning: the hash can be 0, meaning invalid, and must then be explicitly computed from the data
 #define GET_STR_HASH(str_obj_in, str_hash) \
     mp_uint_t str_hash; if (mp_obj_is_qstr(str_obj_in)) \
-    { str_hash = qstr_hash(MP_OBJ_QSTR_VALUE(str_obj_in)); } else { str_hash = ((mp_obj_str_t *)MP_OBJ_TO_PTR(str_obj_in))->hash; }
+    { str_hash = qstr_hash(MP_OBJ_QSTR_VALUE(str_obj_in)); } else { str_hash = ((mp_obj_str_t *)MP_OBJ_TO_PTR(str_obj_in))->hash & MP_OBJ_STR_HASH_MASK; }
 
 // use this macro to extract the string length
 #define GET_STR_LEN(str_obj_in, str_len) \
@@ -71,8 +87,11 @@ mp_obj_t mp_obj_new_str_of_type(const mp_obj_type_t *type, const byte *data, siz
 mp_obj_t mp_obj_str_binary_op(mp_binary_op_t op, mp_obj_t lhs_in, mp_obj_t rhs_in);
 mp_int_t mp_obj_str_get_buffer(mp_obj_t self_in, mp_buffer_info_t *bufinfo, mp_uint_t flags);
 
-const byte *str_index_to_ptr(const mp_obj_type_t *type, const byte *self_data, size_t self_len,
+const byte *str_index_to_ptr(mp_obj_t self_in, const byte *self_data, size_t self_len,
     mp_obj_t index, bool is_slice);
+#if MICROPY_PY_BUILTINS_STR_UNICODE
+size_t str_ptr_to_index(mp_obj_t self_in, const byte *self_data, const byte *ptr);
+#endif
 const byte *find_subbytes(const byte *haystack, size_t hlen, const byte *needle, size_t nlen, int direction);
 
 MP_DECLARE_CONST_FUN_OBJ_VAR_BETWEEN(str_encode_obj);
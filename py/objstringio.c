@@ -31,6 +31,7 @@
 #include "py/objstr.h"
 #include "py/objstringio.h"
 #include "py/runtime.h"
+#include "py/gc.h"
 #include "py/stream.h"
 
 #if MICROPY_PY_IO
@@ -69,7 +70,10 @@ STATIC mp_uint_t stringio_read(mp_obj_t o_in, void *buf, mp_uint_t size, int *er
 
 STATIC void stringio_copy_on_write(mp_obj_stringio_t *o) {
     const void *buf = o->vstr->buf;
+    bool arena_suspended = MP_GC_ARENA_SUSPEND(o);
     o->vstr->buf = m_new(char, o->vstr->len);
+    MP_GC_ARENA_RESUME(arena_suspended);
+    MP_GC_WRITE_BARRIER(o->vstr);
     o->vstr->fixed_buf = false;
     o->ref_obj = MP_OBJ_NULL;
     memcpy(o->vstr->buf, buf, o->vstr->len);
@@ -226,6 +230,9 @@ STATIC const mp_rom_map_elem_t stringio_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_read), MP_ROM_PTR(&mp_stream_read_obj) },
     { MP_ROM_QSTR(MP_QSTR_readinto), MP_ROM_PTR(&mp_stream_readinto_obj) },
     { MP_ROM_QSTR(MP_QSTR_readline), MP_ROM_PTR(&mp_stream_unbuffered_readline_obj) },
+#if MICROPY_STREAMS_READLINE_INTO
+    { MP_ROM_QSTR(MP_QSTR_readline_into), MP_ROM_PTR(&mp_stream_unbuffered_readline_into_obj) },
+#endif
     { MP_ROM_QSTR(MP_QSTR_write), MP_ROM_PTR(&mp_stream_write_obj) },
     { MP_ROM_QSTR(MP_QSTR_seek), MP_ROM_PTR(&mp_stream_seek_obj) },
     { MP_ROM_QSTR(MP_QSTR_tell), MP_ROM_PTR(&mp_stream_tell_obj) },
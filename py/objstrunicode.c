@@ -28,6 +28,7 @@
 #include <string.h>
 #include <assert.h>
 
+#include "py/unicode.h"
 #include "py/objstr.h"
 #include "py/objlist.h"
 #include "py/runtime.h"
@@ -98,13 +99,38 @@ STATIC void uni_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t
     }
 }
 
+#if MICROPY_PY_BUILTINS_STR_UNICODE_INDEX
+// Return the MP_OBJ_STR_FLAG_xxx flags of a str, which are 0 for an interned one.
+STATIC mp_uint_t str_index_flags(mp_obj_t self_in) {
+    if (mp_obj_is_qstr(self_in)) {
+        return 0;
+    }
+    return ((mp_obj_str_t *)MP_OBJ_TO_PTR(self_in))->hash & ~MP_OBJ_STR_HASH_MASK;
+}
+#endif
+
+// Return the number of characters in a str.
+STATIC size_t str_charlen(mp_obj_t self_in, const byte *self_data, size_t self_len) {
+    #if MICROPY_PY_BUILTINS_STR_UNICODE_INDEX
+    mp_uint_t flags = str_index_flags(self_in);
+    if (flags & MP_OBJ_STR_FLAG_ASCII) {
+        return self_len;
+    } else if (flags & MP_OBJ_STR_FLAG_INDEX) {
+        return MP_OBJ_STR_INDEX(self_data, self_len)[0];
+    }
+    #else
+    (void)self_in;
+    #endif
+    return utf8_charlen(self_data, self_len);
+}
+
 STATIC mp_obj_t uni_unary_op(mp_unary_op_t op, mp_obj_t self_in) {
     GET_STR_DATA_LEN(self_in, str_data, str_len);
     switch (op) {
         case MP_UNARY_OP_BOOL:
             return mp_obj_new_bool(str_len != 0);
         case MP_UNARY_OP_LEN:
-            return MP_OBJ_NEW_SMALL_INT(utf8_charlen(str_data, str_len));
+            return MP_OBJ_NEW_SMALL_INT(str_charlen(self_in, str_data, str_len));
         default:
             return MP_OBJ_NULL; // op not supported
     }
@@ -112,10 +138,11 @@ STATIC mp_obj_t uni_unary_op(mp_unary_op_t op, mp_obj_t self_in) {
 
 // Convert an index into a pointer to its lead byte. Out of bounds indexing will raise IndexError or
 // be capped to the first/last character of the string, depending on is_slice.
-const byte *str_index_to_ptr(const mp_obj_type_t *type, const byte *self_data, size_t self_len,
+const byte *str_index_to_ptr(mp_obj_t self_in, const byte *self_data, size_t self_len,
     mp_obj_t index, bool is_slice) {
     // All str functions also handle bytes objects, and they call str_index_to_ptr(),
     // so it must handle bytes.
+    const mp_obj_type_t *type = mp_obj_get_type(self_in);
     if (type == &mp_type_bytes) {
         // Taken from objstr.c:str_index_to_ptr()
         size_t index_val = mp_get_index(type, self_len, index, is_slice);
@@ -132,6 +159,34 @@ const byte *str_index_to_ptr(const mp_obj_type_t *type, const byte *self_data, s
         mp_raise_msg_varg(&mp_type_TypeError, MP_ERROR_TEXT("string indices must be integers, not %s"), mp_obj_get_type_str(index));
     }
     const byte *s, *top = self_data + self_len;
+    #if MICROPY_PY_BUILTINS_STR_UNICODE_INDEX
+    // With the number of characters known the index is checked up front, then
+    // found directly in ASCII data, or from the nearest entry of the index.
+    mp_uint_t flags = str_index_flags(self_in);
+    if (flags != 0) {
+        mp_int_t charlen = str_charlen(self_in, self_data, self_len);
+        if (i < 0) {
+            i += charlen;
+        }
+        if (i < 0 || i >= charlen) {
+            if (is_slice) {
+                return i < 0 ? self_data : top;
+            }
+            mp_raise_msg(&mp_type_IndexError, MP_ERROR_TEXT("string index out of range"));
+        }
+        if (flags & MP_OBJ_STR_FLAG_ASCII) {
+            return self_data + i;
+        }
+        s = self_data;
+        if (i >= MP_OBJ_STR_INDEX_STRIDE) {
+            s += MP_OBJ_STR_INDEX(self_data, self_len)[i / MP_OBJ_STR_INDEX_STRIDE];
+        }
+        for (i %= MP_OBJ_STR_INDEX_STRIDE; i > 0; --i) {
+            s = utf8_next_char(s);
+        }
+        return s;
+    }
+    #endif
     if (i < 0) {
         // Negative indexing is performed by counting from the end of the string.
         for (s = top - 1; i; --s) {
@@ -174,6 +229,35 @@ const byte *str_index_to_ptr(const mp_obj_type_t *type, const byte *self_data, s
     return s;
 }
 
+// Convert a pointer to a lead byte into the index of its character.
+size_t str_ptr_to_index(mp_obj_t self_in, const byte *self_data, const byte *ptr) {
+    #if MICROPY_PY_BUILTINS_STR_UNICODE_INDEX
+    mp_uint_t flags = str_index_flags(self_in);
+    if (flags & MP_OBJ_STR_FLAG_ASCII) {
+        return ptr - self_data;
+    } else if (flags & MP_OBJ_STR_FLAG_INDEX) {
+        // binary search for the last entry of the index at or before ptr
+        const uint32_t *index = MP_OBJ_STR_INDEX(self_data, ((mp_obj_str_t *)MP_OBJ_TO_PTR(self_in))->len);
+        size_t lo = 0;
+        size_t hi = (index[0] - 1) / MP_OBJ_STR_INDEX_STRIDE;
+        size_t offset = ptr - self_data;
+        while (lo < hi) {
+            size_t mid = (lo + hi + 1) / 2;
+            if (index[mid] <= offset) {
+                lo = mid;
+            } else {
+                hi = mid - 1;
+            }
+        }
+        size_t base = lo ? index[lo] : 0;
+        return lo * MP_OBJ_STR_INDEX_STRIDE + utf8_ptr_to_index(self_data + base, ptr);
+    }
+    #else
+    (void)self_in;
+    #endif
+    return utf8_ptr_to_index(self_data, ptr);
+}
+
 STATIC mp_obj_t str_subscr(mp_obj_t self_in, mp_obj_t index, mp_obj_t value) {
     const mp_obj_type_t *type = mp_obj_get_type(self_in);
     assert(type == &mp_type_str);
@@ -194,14 +278,14 @@ STATIC mp_obj_t str_subscr(mp_obj_t self_in, mp_obj_t index, mp_obj_t value) {
 
             const byte *pstart, *pstop;
             if (ostart != mp_const_none) {
-                pstart = str_index_to_ptr(type, self_data, self_len, ostart, true);
+                pstart = str_index_to_ptr(self_in, self_data, self_len, ostart, true);
             } else {
                 pstart = self_data;
             }
             if (ostop != mp_const_none) {
                 // pstop will point just after the stop character. This depends on
                 // the \0 at the end of the string.
-                pstop = str_index_to_ptr(type, self_data, self_len, ostop, true);
+                pstop = str_index_to_ptr(self_in, self_data, self_len, ostop, true);
             } else {
                 pstop = self_data + self_len;
             }
@@ -211,7 +295,7 @@ STATIC mp_obj_t str_subscr(mp_obj_t self_in, mp_obj_t index, mp_obj_t value) {
             return mp_obj_new_str_of_type(type, (const byte *)pstart, pstop - pstart);
         }
         #endif
-        const byte *s = str_index_to_ptr(type, self_data, self_len, index, false);
+        const byte *s = str_index_to_ptr(self_in, self_data, self_len, index, false);
         int len = 1;
         if (UTF8_IS_NONASCII(*s)) {
             // Count the number of 1 bits (after the first)
@@ -32,6 +32,7 @@
 
 #include "py/objtype.h"
 #include "py/runtime.h"
+#include "py/gc.h"
 
 #if MICROPY_DEBUG_VERBOSE // print debugging info
 #define DEBUG_PRINT (1)
@@ -99,7 +100,14 @@ STATIC
 mp_obj_instance_t *mp_obj_new_instance(const mp_obj_type_t *class, const mp_obj_type_t **native_base) {
     size_t num_native_bases = instance_count_native_bases(class, native_base);
     assert(num_native_bases < 2);
+    #if MICROPY_PY_SLOTS
+    size_t n_slots = ((const mp_obj_class_t *)class)->n_slots;
+    mp_obj_instance_t *o = m_new_obj_var(mp_obj_instance_t, mp_obj_t, num_native_bases + n_slots);
+    // the slots start out unset
+    memset(o->subobj + num_native_bases, 0, n_slots * sizeof(mp_obj_t));
+    #else
     mp_obj_instance_t *o = m_new_obj_var(mp_obj_instance_t, mp_obj_t, num_native_bases);
+    #endif
     o->base.type = class;
     mp_map_init(&o->members, 0);
     // Initialise the native base-class slot (should be 1 at most) with a valid
@@ -131,6 +139,13 @@ struct class_lookup_data {
     size_t meth_offset;
     mp_obj_t *dest;
     bool is_type;
+    #if MICROPY_OPT_LOAD_METHOD_CACHE
+    // set to the dict and slot the attribute was found in, unless a native
+    // base was asked for it or it was found in the dict of a native type
+    bool seen_native;
+    mp_map_t *found_map;
+    mp_map_elem_t *found_elem;
+    #endif
 };
 
 STATIC void mp_obj_class_lookup(struct class_lookup_data *lookup, const mp_obj_type_t *type) {
@@ -170,6 +185,12 @@ STATIC void mp_obj_class_lookup(struct class_lookup_data *lookup, const mp_obj_t
                         obj_obj = obj->subobj[0];
                     } else {
                         obj_obj = MP_OBJ_FROM_PTR(obj);
+                        #if MICROPY_OPT_LOAD_METHOD_CACHE
+                        if (!lookup->seen_native) {
+                            lookup->found_map = locals_map;
+                            lookup->found_elem = elem;
+                        }
+                        #endif
                     }
                     mp_convert_member_lookup(obj_obj, type, elem->value, lookup->dest);
                 }
@@ -190,6 +211,9 @@ STATIC void mp_obj_class_lookup(struct class_lookup_data *lookup, const mp_obj_t
         // but some attributes of native types may be handled using .load_attr method,
         // so make sure we try to lookup those too.
         if (lookup->obj != NULL && !lookup->is_type && mp_obj_is_native_type(type) && type != &mp_type_object /* object is not a real type */) {
+            #if MICROPY_OPT_LOAD_METHOD_CACHE
+            lookup->seen_native = true;
+            #endif
             mp_load_method_maybe(lookup->obj->subobj[0], lookup->attr, lookup->dest);
             if (lookup->dest[0] != MP_OBJ_NULL) {
                 return;
@@ -233,7 +257,7 @@ STATIC void mp_obj_class_lookup(struct class_lookup_data *lookup, const mp_obj_t
     }
 }
 
-STATIC void instance_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
+void mp_obj_instance_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
     mp_obj_instance_t *self = MP_OBJ_TO_PTR(self_in);
     qstr meth = (kind == PRINT_STR) ? MP_QSTR___str__ : MP_QSTR___repr__;
     mp_obj_t member[2] = {MP_OBJ_NULL};
@@ -384,7 +408,7 @@ const byte mp_unary_op_method_name[MP_UNARY_OP_NUM_RUNTIME] = {
     #endif
 };
 
-STATIC mp_obj_t instance_unary_op(mp_unary_op_t op, mp_obj_t self_in) {
+mp_obj_t mp_obj_instance_unary_op(mp_unary_op_t op, mp_obj_t self_in) {
     mp_obj_instance_t *self = MP_OBJ_TO_PTR(self_in);
 
     #if MICROPY_PY_SYS_GETSIZEOF
@@ -395,6 +419,9 @@ STATIC mp_obj_t instance_unary_op(mp_unary_op_t op, mp_obj_t self_in) {
 
         size_t sz = sizeof(*self) + sizeof(*self->subobj) * num_native_bases
             + sizeof(*self->members.table) * self->members.alloc;
+        #if MICROPY_PY_SLOTS
+        sz += sizeof(*self->subobj) * ((const mp_obj_class_t *)self->base.type)->n_slots;
+        #endif
         return MP_OBJ_NEW_SMALL_INT(sz);
     }
     #endif
@@ -522,7 +549,7 @@ const byte mp_binary_op_method_name[MP_BINARY_OP_NUM_RUNTIME] = {
     #endif
 };
 
-STATIC mp_obj_t instance_binary_op(mp_binary_op_t op, mp_obj_t lhs_in, mp_obj_t rhs_in) {
+mp_obj_t mp_obj_instance_binary_op(mp_binary_op_t op, mp_obj_t lhs_in, mp_obj_t rhs_in) {
     // Note: For ducktyping, CPython does not look in the instance members or use
     // __getattr__ or __getattribute__.  It only looks in the class dictionary.
     mp_obj_instance_t *lhs = MP_OBJ_TO_PTR(lhs_in);
@@ -574,6 +601,142 @@ retry:;
     return res;
 }
 
+#if MICROPY_OPT_LOAD_METHOD_CACHE
+STATIC inline mp_method_cache_entry_t *method_cache_entry(const mp_obj_type_t *type, qstr attr) {
+    size_t hash = ((uintptr_t)type >> 4) ^ attr;
+    return &MP_STATE_VM(method_cache)[hash & (MICROPY_OPT_LOAD_METHOD_CACHE_SIZE - 1)];
+}
+
+// Returns true if member bound to an instance is a bound method.
+STATIC inline bool method_cache_binds_self(mp_obj_t member) {
+    return mp_obj_is_obj(member)
+           && (((mp_obj_base_t *)MP_OBJ_TO_PTR(member))->type->flags
+               & (MP_TYPE_FLAG_BINDS_SELF | MP_TYPE_FLAG_BUILTIN_FUN)) == MP_TYPE_FLAG_BINDS_SELF;
+}
+
+// Return the element of a class dict that entry says attr was found in for
+// an instance of type, or NULL if the entry is for something else or stale.
+STATIC inline mp_map_elem_t *method_cache_get(mp_method_cache_entry_t *entry, const mp_obj_type_t *type, qstr attr) {
+    if (entry->type == type && entry->attr == attr
+        && entry->version == MP_STATE_VM(type_version)) {
+        mp_map_t *map = entry->map;
+        if (map->table == entry->table && entry->index < map->alloc) {
+            mp_map_elem_t *elem = &map->table[entry->index];
+            if (elem->key == MP_OBJ_NEW_QSTR(attr)) {
+                return elem;
+            }
+        }
+    }
+    return NULL;
+}
+
+// Remember the class dict element that lookup found attr in.
+STATIC void method_cache_set(mp_method_cache_entry_t *entry, const mp_obj_type_t *type, qstr attr, const struct class_lookup_data *lookup) {
+    entry->type = type;
+    entry->version = MP_STATE_VM(type_version);
+    entry->map = lookup->found_map;
+    entry->table = lookup->found_map->table;
+    entry->index = lookup->found_elem - lookup->found_map->table;
+    entry->attr = attr;
+}
+
+// Must be called after any change to a class that could change the result
+// of an attribute lookup.
+STATIC void method_cache_invalidate(void) {
+    if (++MP_STATE_VM(type_version) == 0) {
+        // the version wrapped around so start again with an empty cache
+        memset(MP_STATE_VM(method_cache), 0, sizeof(MP_STATE_VM(method_cache)));
+        MP_STATE_VM(type_version) = 1;
+    }
+}
+#endif
+
+#if MICROPY_PY_SLOTS
+// The descriptor put in the dict of a class for each name in its __slots__.
+typedef struct _mp_obj_slot_t {
+    mp_obj_base_t base;
+    uint16_t index; // in subobj[] of an instance
+    uint16_t name;
+} mp_obj_slot_t;
+
+STATIC void slot_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
+    (void)kind;
+    mp_obj_slot_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_printf(print, "<member '%q'>", self->name);
+}
+
+STATIC const mp_obj_type_t mp_type_member_descriptor = {
+    { &mp_type_type },
+    .name = MP_QSTR_member_descriptor,
+    .print = slot_print,
+};
+
+STATIC inline bool is_slot(mp_obj_t member) {
+    return member != MP_OBJ_NULL && mp_obj_is_type(member, &mp_type_member_descriptor);
+}
+
+#if MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE
+mp_obj_t *mp_obj_instance_get_own_slot(mp_obj_instance_t *self, qstr attr, uint8_t *idx_cache) {
+    const mp_obj_type_t *type = self->base.type;
+    // The dict of the instance's own class is searched first by a lookup,
+    // so a slot found there can't be shadowed by anything else.
+    mp_map_t *map = &type->locals_dict->map;
+    mp_obj_t key = MP_OBJ_NEW_QSTR(attr);
+    mp_map_elem_t *elem;
+    size_t idx = *idx_cache;
+    if (idx < map->alloc && map->table[idx].key == key) {
+        elem = &map->table[idx];
+    } else {
+        elem = mp_map_lookup(map, key, MP_MAP_LOOKUP);
+        if (elem == NULL) {
+            return NULL;
+        }
+        *idx_cache = (elem - &map->table[0]) & 0xff;
+    }
+    if (!is_slot(elem->value)) {
+        return NULL;
+    }
+    return &self->subobj[((mp_obj_slot_t *)MP_OBJ_TO_PTR(elem->value))->index];
+}
+#endif
+
+mp_obj_t *mp_obj_instance_get_slot(mp_obj_instance_t *self, qstr attr) {
+    const mp_obj_type_t *type = self->base.type;
+    if (((const mp_obj_class_t *)type)->n_slots == 0) {
+        return NULL;
+    }
+    mp_obj_t member;
+    #if MICROPY_OPT_LOAD_METHOD_CACHE
+    mp_method_cache_entry_t *entry = method_cache_entry(type, attr);
+    mp_map_elem_t *elem = method_cache_get(entry, type, attr);
+    if (elem != NULL) {
+        member = elem->value;
+    } else
+    #endif
+    {
+        mp_obj_t dest[2] = {MP_OBJ_NULL, MP_OBJ_NULL};
+        struct class_lookup_data lookup = {
+            .obj = self,
+            .attr = attr,
+            .meth_offset = 0,
+            .dest = dest,
+            .is_type = false,
+        };
+        mp_obj_class_lookup(&lookup, type);
+        member = dest[0];
+        #if MICROPY_OPT_LOAD_METHOD_CACHE
+        if (is_slot(member) && lookup.found_elem != NULL) {
+            method_cache_set(entry, type, attr, &lookup);
+        }
+        #endif
+    }
+    if (!is_slot(member)) {
+        return NULL;
+    }
+    return &self->subobj[((mp_obj_slot_t *)MP_OBJ_TO_PTR(member))->index];
+}
+#endif
+
 STATIC void mp_obj_instance_load_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest) {
     // logic: look in instance members then class locals
     assert(mp_obj_is_instance_type(mp_obj_get_type(self_in)));
@@ -598,6 +761,26 @@ STATIC void mp_obj_instance_load_attr(mp_obj_t self_in, qstr attr, mp_obj_t *des
         return;
     }
     #endif
+    #if MICROPY_OPT_LOAD_METHOD_CACHE
+    mp_method_cache_entry_t *entry = method_cache_entry(self->base.type, attr);
+    elem = method_cache_get(entry, self->base.type, attr);
+    if (elem != NULL) {
+        if (method_cache_binds_self(elem->value)) {
+            dest[0] = elem->value;
+            dest[1] = self_in;
+            return;
+        }
+        #if MICROPY_PY_SLOTS
+        if (is_slot(elem->value)) {
+            dest[0] = self->subobj[((mp_obj_slot_t *)MP_OBJ_TO_PTR(elem->value))->index];
+            if (dest[0] != MP_OBJ_NULL) {
+                return;
+            }
+            goto try_getattr;
+        }
+        #endif
+    }
+    #endif
     struct class_lookup_data lookup = {
         .obj = self,
         .attr = attr,
@@ -607,9 +790,30 @@ STATIC void mp_obj_instance_load_attr(mp_obj_t self_in, qstr attr, mp_obj_t *des
     };
     mp_obj_class_lookup(&lookup, self->base.type);
     mp_obj_t member = dest[0];
+    #if MICROPY_PY_SLOTS
+    if (is_slot(member)) {
+        #if MICROPY_OPT_LOAD_METHOD_CACHE
+        if (lookup.found_elem != NULL) {
+            method_cache_set(entry, self->base.type, attr, &lookup);
+        }
+        #endif
+        dest[0] = self->subobj[((mp_obj_slot_t *)MP_OBJ_TO_PTR(member))->index];
+        if (dest[0] != MP_OBJ_NULL) {
+            return;
+        }
+        // an unset slot is looked for with __getattr__
+        goto try_getattr;
+    }
+    #endif
     if (member != MP_OBJ_NULL) {
         if (!(self->base.type->flags & MP_TYPE_FLAG_HAS_SPECIAL_ACCESSORS)) {
             // Class doesn't have any special accessors to check so return straightaway
+            #if MICROPY_OPT_LOAD_METHOD_CACHE
+            if (lookup.found_elem != NULL && dest[1] == self_in) {
+                // a method was found in a class dict, remember where
+                method_cache_set(entry, self->base.type, attr, &lookup);
+            }
+            #endif
             return;
         }
 
@@ -648,6 +852,9 @@ STATIC void mp_obj_instance_load_attr(mp_obj_t self_in, qstr attr, mp_obj_t *des
         return;
     }
 
+#if MICROPY_PY_SLOTS
+try_getattr:
+#endif
     // try __getattr__
     if (attr != MP_QSTR___getattr__) {
         #if MICROPY_PY_DELATTR_SETATTR
@@ -782,18 +989,35 @@ STATIC bool mp_obj_instance_store_attr(mp_obj_t self_in, qstr attr, mp_obj_t val
 
 skip_special_accessors:
 
+    #if MICROPY_PY_SLOTS
+    mp_obj_t *slot = mp_obj_instance_get_slot(self, attr);
+    if (slot != NULL) {
+        if (value == MP_OBJ_NULL && *slot == MP_OBJ_NULL) {
+            // can't delete an unset slot
+            return false;
+        }
+        *slot = value;
+        MP_GC_WRITE_BARRIER(slot);
+        return true;
+    }
+    if (((const mp_obj_class_t *)self->base.type)->no_dict) {
+        // no other attributes can be stored
+        return false;
+    }
+    #endif
+
     if (value == MP_OBJ_NULL) {
         // delete attribute
         mp_map_elem_t *elem = mp_map_lookup(&self->members, MP_OBJ_NEW_QSTR(attr), MP_MAP_LOOKUP_REMOVE_IF_FOUND);
         return elem != NULL;
     } else {
         // store attribute
-        mp_map_lookup(&self->members, MP_OBJ_NEW_QSTR(attr), MP_MAP_LOOKUP_ADD_IF_NOT_FOUND)->value = value;
+        mp_map_store(&self->members, MP_OBJ_NEW_QSTR(attr), value);
         return true;
     }
 }
 
-STATIC void mp_obj_instance_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest) {
+void mp_obj_instance_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest) {
     if (dest[0] == MP_OBJ_NULL) {
         mp_obj_instance_load_attr(self_in, attr, dest);
     } else {
@@ -803,7 +1027,7 @@ STATIC void mp_obj_instance_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest) {
     }
 }
 
-STATIC mp_obj_t instance_subscr(mp_obj_t self_in, mp_obj_t index, mp_obj_t value) {
+mp_obj_t mp_obj_instance_subscr(mp_obj_t self_in, mp_obj_t index, mp_obj_t value) {
     mp_obj_instance_t *self = MP_OBJ_TO_PTR(self_in);
     mp_obj_t member[4] = {MP_OBJ_NULL, MP_OBJ_NULL, index, value};
     struct class_lookup_data lookup = {
@@ -900,7 +1124,7 @@ mp_obj_t mp_obj_instance_getiter(mp_obj_t self_in, mp_obj_iter_buf_t *iter_buf)
     }
 }
 
-STATIC mp_int_t instance_get_buffer(mp_obj_t self_in, mp_buffer_info_t *bufinfo, mp_uint_t flags) {
+mp_int_t mp_obj_instance_get_buffer(mp_obj_t self_in, mp_buffer_info_t *bufinfo, mp_uint_t flags) {
     mp_obj_instance_t *self = MP_OBJ_TO_PTR(self_in);
     mp_obj_t member[2] = {MP_OBJ_NULL};
     struct class_lookup_data lookup = {
@@ -1018,7 +1242,7 @@ STATIC void type_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest) {
             if (!dict) {
                 dict = &mp_const_empty_dict_obj;
             }
-            if (dict->map.is_fixed) {
+            if (dict->map.is_fixed && !dict->map.copy_on_write) {
                 dest[0] = MP_OBJ_FROM_PTR(dict);
             } else {
                 dest[0] = mp_obj_dict_copy(MP_OBJ_FROM_PTR(dict));
@@ -1058,6 +1282,11 @@ STATIC void type_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest) {
         if (self->locals_dict != NULL) {
             assert(mp_obj_is_dict_or_ordereddict(MP_OBJ_FROM_PTR(self->locals_dict))); // MicroPython restriction, for now
             mp_map_t *locals_map = &self->locals_dict->map;
+            #if MICROPY_MODULE_FROZEN_ROM_GLOBALS
+            if (locals_map->copy_on_write) {
+                mp_map_make_writable(locals_map);
+            }
+            #endif
             if (locals_map->is_fixed) {
                 // can't apply delete/store to a fixed map
                 return;
@@ -1067,6 +1296,9 @@ STATIC void type_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest) {
                 mp_map_elem_t *elem = mp_map_lookup(locals_map, MP_OBJ_NEW_QSTR(attr), MP_MAP_LOOKUP_REMOVE_IF_FOUND);
                 if (elem != NULL) {
                     dest[0] = MP_OBJ_NULL; // indicate success
+                    #if MICROPY_OPT_LOAD_METHOD_CACHE
+                    method_cache_invalidate();
+                    #endif
                 }
             } else {
                 #if ENABLE_SPECIAL_ACCESSORS
@@ -1083,9 +1315,11 @@ STATIC void type_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest) {
                 #endif
 
                 // store attribute
-                mp_map_elem_t *elem = mp_map_lookup(locals_map, MP_OBJ_NEW_QSTR(attr), MP_MAP_LOOKUP_ADD_IF_NOT_FOUND);
-                elem->value = dest[1];
+                mp_map_store(locals_map, MP_OBJ_NEW_QSTR(attr), dest[1]);
                 dest[0] = MP_OBJ_NULL; // indicate success
+                #if MICROPY_OPT_LOAD_METHOD_CACHE
+                method_cache_invalidate();
+                #endif
             }
         }
     }
@@ -1101,6 +1335,64 @@ const mp_obj_type_t mp_type_type = {
     .attr = type_attr,
 };
 
+#if MICROPY_PY_SLOTS
+// Give a new class the slots of its bases, followed by one for each name in
+// its own __slots__, which gets a descriptor in the class dict.
+STATIC void class_init_slots(mp_obj_class_t *cls, size_t bases_len, const mp_obj_t *bases_items, size_t num_native_bases) {
+    size_t n_slots = 0;
+    bool no_dict = true;
+    for (size_t i = 0; i < bases_len; i++) {
+        const mp_obj_type_t *t = MP_OBJ_TO_PTR(bases_items[i]);
+        if (!mp_obj_is_instance_type(t)) {
+            continue;
+        }
+        const mp_obj_class_t *base = (const mp_obj_class_t *)t;
+        no_dict &= base->no_dict;
+        if (base->n_slots != 0) {
+            // the slots of only one base can go at the start of an instance
+            const mp_obj_type_t *native_base;
+            if (n_slots != 0 || (size_t)instance_count_native_bases(t, &native_base) != num_native_bases) {
+                mp_raise_TypeError(MP_ERROR_TEXT("multiple bases have instance lay-out conflict"));
+            }
+            n_slots = base->n_slots;
+        }
+    }
+
+    mp_obj_t locals_dict = MP_OBJ_FROM_PTR(cls->type.locals_dict);
+    mp_map_elem_t *elem = mp_map_lookup(&cls->type.locals_dict->map, MP_OBJ_NEW_QSTR(MP_QSTR___slots__), MP_MAP_LOOKUP);
+    if (elem == NULL) {
+        no_dict = false;
+    } else {
+        mp_obj_t names = elem->value;
+        if (mp_obj_is_str(names)) {
+            // a single name
+            names = mp_obj_new_tuple(1, &names);
+        }
+        mp_obj_iter_buf_t iter_buf;
+        mp_obj_t iterable = mp_getiter(names, &iter_buf);
+        mp_obj_t name_obj;
+        while ((name_obj = mp_iternext(iterable)) != MP_OBJ_STOP_ITERATION) {
+            qstr name = mp_obj_str_get_qstr(name_obj);
+            if (name == MP_QSTR___dict__) {
+                no_dict = false;
+                continue;
+            }
+            if (mp_map_lookup(&cls->type.locals_dict->map, MP_OBJ_NEW_QSTR(name), MP_MAP_LOOKUP) != NULL) {
+                mp_raise_msg_varg(&mp_type_ValueError,
+                    MP_ERROR_TEXT("'%q' in __slots__ conflicts with class variable"), name);
+            }
+            mp_obj_slot_t *slot = m_new_obj(mp_obj_slot_t);
+            slot->base.type = &mp_type_member_descriptor;
+            slot->index = num_native_bases + n_slots++;
+            slot->name = name;
+            mp_obj_dict_store(locals_dict, MP_OBJ_NEW_QSTR(name), MP_OBJ_FROM_PTR(slot));
+        }
+    }
+    cls->n_slots = n_slots;
+    cls->no_dict = no_dict;
+}
+#endif
+
 mp_obj_t mp_obj_new_type(qstr name, mp_obj_t bases_tuple, mp_obj_t locals_dict) {
     // Verify input objects have expected type
     if (!mp_obj_is_type(bases_tuple, &mp_type_tuple)) {
@@ -1134,26 +1426,37 @@ mp_obj_t mp_obj_new_type(qstr name, mp_obj_t bases_tuple, mp_obj_t locals_dict)
         }
         #if ENABLE_SPECIAL_ACCESSORS
         if (mp_obj_is_instance_type(t)) {
-            t->flags |= MP_TYPE_FLAG_IS_SUBCLASSED;
+            // a class frozen in ROM is marked as subclassed already
+            if (!(t->flags & MP_TYPE_FLAG_IS_SUBCLASSED)) {
+                t->flags |= MP_TYPE_FLAG_IS_SUBCLASSED;
+            }
             base_flags |= t->flags & MP_TYPE_FLAG_HAS_SPECIAL_ACCESSORS;
         }
         #endif
     }
 
+    #if MICROPY_PY_SLOTS
+    mp_obj_type_t *o = &m_new0(mp_obj_class_t, 1)->type;
+    #else
     mp_obj_type_t *o = m_new0(mp_obj_type_t, 1);
+    #endif
+    #if MICROPY_OPT_LOAD_METHOD_CACHE
+    // the new type may be at the address of a type that's been freed
+    method_cache_invalidate();
+    #endif
     o->base.type = &mp_type_type;
     o->flags = base_flags;
     o->name = name;
-    o->print = instance_print;
+    o->print = mp_obj_instance_print;
     o->make_new = mp_obj_instance_make_new;
     o->call = mp_obj_instance_call;
-    o->unary_op = instance_unary_op;
-    o->binary_op = instance_binary_op;
+    o->unary_op = mp_obj_instance_unary_op;
+    o->binary_op = mp_obj_instance_binary_op;
     o->attr = mp_obj_instance_attr;
-    o->subscr = instance_subscr;
+    o->subscr = mp_obj_instance_subscr;
     o->getiter = mp_obj_instance_getiter;
     // o->iternext = ; not implemented
-    o->buffer_p.get_buffer = instance_get_buffer;
+    o->buffer_p.get_buffer = mp_obj_instance_get_buffer;
 
     if (bases_len > 0) {
         // Inherit protocol from a base class. This allows to define an
@@ -1196,6 +1499,10 @@ mp_obj_t mp_obj_new_type(qstr name, mp_obj_t bases_tuple, mp_obj_t locals_dict)
         mp_raise_TypeError(MP_ERROR_TEXT("multiple bases have instance lay-out conflict"));
     }
 
+    #if MICROPY_PY_SLOTS
+    class_init_slots((mp_obj_class_t *)o, bases_len, bases_items, num_native_bases);
+    #endif
+
     mp_map_t *locals_map = &o->locals_dict->map;
     mp_map_elem_t *elem = mp_map_lookup(locals_map, MP_OBJ_NEW_QSTR(MP_QSTR___new__), MP_MAP_LOOKUP);
     if (elem != NULL) {
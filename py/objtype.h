@@ -37,6 +37,26 @@ typedef struct _mp_obj_instance_t {
     // TODO maybe cache __getattr__ and __setattr__ for efficient lookup of them
 } mp_obj_instance_t;
 
+#if MICROPY_PY_SLOTS
+// A class defined in Python.  Its instances hold the attributes named in the
+// __slots__ of it and its bases in subobj[], after the native base object if
+// there is one.
+typedef struct _mp_obj_class_t {
+    mp_obj_type_t type;
+    uint16_t n_slots;
+    // set if instances can only have the attributes in their slots
+    bool no_dict;
+} mp_obj_class_t;
+
+// Return the slot of instance self holding attr, or NULL if it has none.
+mp_obj_t *mp_obj_instance_get_slot(mp_obj_instance_t *self, qstr attr);
+#if MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE
+// The same, for the VM, if attr is a slot of the instance's own class, which
+// must have slots, with idx_cache a hint to where attr is in its dict.
+mp_obj_t *mp_obj_instance_get_own_slot(mp_obj_instance_t *self, qstr attr, uint8_t *idx_cache);
+#endif
+#endif
+
 #if MICROPY_CPYTHON_COMPAT
 // this is needed for object.__new__
 mp_obj_instance_t *mp_obj_new_instance(const mp_obj_type_t *cls, const mp_obj_type_t **native_base);
@@ -54,4 +74,35 @@ mp_obj_t mp_obj_instance_make_new(const mp_obj_type_t *self_in, size_t n_args, s
 // this needs to be exposed for mp_getiter
 mp_obj_t mp_obj_instance_getiter(mp_obj_t self_in, mp_obj_iter_buf_t *iter_buf);
 
+// these are exposed for MP_OBJ_TYPE_FROZEN_CLASS
+void mp_obj_instance_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind);
+mp_obj_t mp_obj_instance_unary_op(mp_unary_op_t op, mp_obj_t self_in);
+mp_obj_t mp_obj_instance_binary_op(mp_binary_op_t op, mp_obj_t lhs_in, mp_obj_t rhs_in);
+void mp_obj_instance_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest);
+mp_obj_t mp_obj_instance_subscr(mp_obj_t self_in, mp_obj_t index, mp_obj_t value);
+mp_int_t mp_obj_instance_get_buffer(mp_obj_t self_in, mp_buffer_info_t *bufinfo, mp_uint_t flags);
+
+#if MICROPY_MODULE_FROZEN_ROM_GLOBALS
+// The fields of the type of a class that tools/mpy-tool.py freezes in ROM, the
+// same as mp_obj_new_type sets for a class with no special accessors and at
+// most one base, which is also frozen.  The class is marked as subclassed from
+// the start, so that its flags never need to change.
+#define MP_OBJ_TYPE_FROZEN_CLASS(name_, parent_, locals_dict_) \
+    .base = { &mp_type_type }, \
+    .flags = MP_TYPE_FLAG_IS_SUBCLASSED | MP_TYPE_FLAG_EQ_NOT_REFLEXIVE \
+        | MP_TYPE_FLAG_EQ_CHECKS_OTHER_TYPE | MP_TYPE_FLAG_EQ_HAS_NEQ_TEST, \
+    .name = (name_), \
+    .print = mp_obj_instance_print, \
+    .make_new = mp_obj_instance_make_new, \
+    .call = mp_obj_instance_call, \
+    .unary_op = mp_obj_instance_unary_op, \
+    .binary_op = mp_obj_instance_binary_op, \
+    .attr = mp_obj_instance_attr, \
+    .subscr = mp_obj_instance_subscr, \
+    .getiter = mp_obj_instance_getiter, \
+    .buffer_p = { .get_buffer = mp_obj_instance_get_buffer }, \
+    .parent = (parent_), \
+    .locals_dict = (locals_dict_)
+#endif
+
 #endif // MICROPY_INCLUDED_PY_OBJTYPE_H
@@ -25,6 +25,7 @@
  */
 
 #include "py/pairheap.h"
+#include "py/gc.h"
 
 // The mp_pairheap_t.next pointer can take one of the following values:
 //   - NULL: the node is the top of the heap
@@ -43,6 +44,8 @@ mp_pairheap_t *mp_pairheap_meld(mp_pairheap_lt_t lt, mp_pairheap_t *heap1, mp_pa
     if (heap2 == NULL) {
         return heap1;
     }
+    MP_GC_WRITE_BARRIER(heap1);
+    MP_GC_WRITE_BARRIER(heap2);
     if (lt(heap1, heap2)) {
         if (heap1->child == NULL) {
             heap1->child = heap2;
@@ -107,6 +110,7 @@ mp_pairheap_t *mp_pairheap_delete(mp_pairheap_lt_t lt, mp_pairheap_t *heap, mp_p
     parent = NEXT_GET_RIGHTMOST_PARENT(parent->next);
 
     // Replace node with pairing of its children
+    MP_GC_WRITE_BARRIER(parent);
     mp_pairheap_t *next;
     if (node == parent->child && node->child == NULL) {
         if (NEXT_IS_RIGHTMOST_PARENT(node->next)) {
@@ -136,9 +140,11 @@ mp_pairheap_t *mp_pairheap_delete(mp_pairheap_lt_t lt, mp_pairheap_t *heap, mp_p
         if (node == NULL) {
             node = n;
         } else {
+            MP_GC_WRITE_BARRIER(n);
             n->next = node;
         }
     }
+    MP_GC_WRITE_BARRIER(node);
     node->next = next;
     if (NEXT_IS_RIGHTMOST_PARENT(next)) {
         parent->child_last = node;
@@ -603,11 +603,150 @@ STATIC bool fold_logical_constants(parser_t *parser, uint8_t rule_id, size_t *nu
         pop_result(parser);
         push_result_node(parser, pn);
         return true;
+
+    #if MICROPY_COMP_CONST_FOLDING_COMPARE
+    } else if (rule_id == RULE_comparison) {
+        // folding for comparison of integers: < > == <= >= !=, including chained ones
+        bool result = true;
+        mp_obj_t arg0;
+        if (!mp_parse_node_get_int_maybe(peek_result(parser, *num_args - 1), &arg0)) {
+            return false;
+        }
+        for (ssize_t i = *num_args - 2; i >= 1; i -= 2) {
+            mp_parse_node_t pn_op = peek_result(parser, i);
+            mp_obj_t arg1;
+            if (!MP_PARSE_NODE_IS_TOKEN(pn_op)
+                || MP_PARSE_NODE_LEAF_ARG(pn_op) == MP_TOKEN_KW_IN
+                || !mp_parse_node_get_int_maybe(peek_result(parser, i - 1), &arg1)) {
+                return false;
+            }
+            mp_binary_op_t op = MP_BINARY_OP_LESS + (MP_PARSE_NODE_LEAF_ARG(pn_op) - MP_TOKEN_OP_LESS);
+            result = result && mp_obj_is_true(mp_binary_op(op, arg0, arg1));
+            arg0 = arg1;
+        }
+        for (size_t i = *num_args; i > 0; i--) {
+            pop_result(parser);
+        }
+        push_result_node(parser, mp_parse_node_new_leaf(MP_PARSE_NODE_TOKEN, result ? MP_TOKEN_KW_TRUE : MP_TOKEN_KW_FALSE));
+        return true;
+
+    } else if (rule_id == RULE_test_if_expr) {
+        // folding for conditional expression with a constant condition: x if c else y
+        mp_parse_node_struct_t *pns_if_else = (mp_parse_node_struct_t *)peek_result(parser, 0);
+        mp_parse_node_t pn;
+        if (mp_parse_node_is_const_true(pns_if_else->nodes[0])) {
+            pn = peek_result(parser, 1);
+        } else if (mp_parse_node_is_const_false(pns_if_else->nodes[0])) {
+            pn = pns_if_else->nodes[1];
+        } else {
+            return false;
+        }
+        pop_result(parser);
+        pop_result(parser);
+        push_result_node(parser, pn);
+        return true;
+    #endif
     }
 
     return false;
 }
 
+#if MICROPY_COMP_CONST_FOLDING_LEN
+// A node that is a literal, so can be dropped without changing what the code does
+STATIC bool parse_node_is_literal(mp_parse_node_t pn) {
+    return (MP_PARSE_NODE_IS_LEAF(pn) && !MP_PARSE_NODE_IS_ID(pn))
+           || MP_PARSE_NODE_IS_STRUCT_KIND(pn, RULE_const_object);
+}
+
+// Get the length of a string, bytes or tuple of literals, or return -1
+STATIC mp_int_t parse_node_get_len_maybe(mp_parse_node_t pn) {
+    if (MP_PARSE_NODE_IS_LEAF(pn)
+        && (MP_PARSE_NODE_LEAF_KIND(pn) == MP_PARSE_NODE_STRING || MP_PARSE_NODE_LEAF_KIND(pn) == MP_PARSE_NODE_BYTES)) {
+        if (MP_PARSE_NODE_LEAF_KIND(pn) == MP_PARSE_NODE_BYTES) {
+            return qstr_len(MP_PARSE_NODE_LEAF_ARG(pn));
+        }
+        return MP_OBJ_SMALL_INT_VALUE(mp_obj_len(MP_OBJ_NEW_QSTR(MP_PARSE_NODE_LEAF_ARG(pn))));
+    } else if (MP_PARSE_NODE_IS_STRUCT_KIND(pn, RULE_const_object)) {
+        mp_obj_t o;
+        mp_parse_node_struct_t *pns = (mp_parse_node_struct_t *)pn;
+        #if MICROPY_OBJ_REPR == MICROPY_OBJ_REPR_D
+        o = (uint64_t)pns->nodes[0] | ((uint64_t)pns->nodes[1] << 32);
+        #else
+        o = (mp_obj_t)pns->nodes[0];
+        #endif
+        if (mp_obj_is_str_or_bytes(o)) {
+            return MP_OBJ_SMALL_INT_VALUE(mp_obj_len(o));
+        }
+    } else if (MP_PARSE_NODE_IS_STRUCT_KIND(pn, RULE_atom_paren)) {
+        mp_parse_node_t pn_list = ((mp_parse_node_struct_t *)pn)->nodes[0];
+        if (MP_PARSE_NODE_IS_NULL(pn_list)) {
+            // empty tuple
+            return 0;
+        }
+        if (!MP_PARSE_NODE_IS_STRUCT_KIND(pn_list, RULE_testlist_comp)) {
+            return -1;
+        }
+        mp_parse_node_struct_t *pns = (mp_parse_node_struct_t *)pn_list;
+        if (!parse_node_is_literal(pns->nodes[0])) {
+            return -1;
+        }
+        if (MP_PARSE_NODE_IS_STRUCT_KIND(pns->nodes[1], RULE_testlist_comp_3b)) {
+            // tuple of one item, with trailing comma
+            return 1;
+        } else if (MP_PARSE_NODE_IS_STRUCT_KIND(pns->nodes[1], RULE_testlist_comp_3c)) {
+            // tuple of many items
+            mp_parse_node_struct_t *pns2 = (mp_parse_node_struct_t *)pns->nodes[1];
+            size_t n = MP_PARSE_NODE_STRUCT_NUM_NODES(pns2);
+            for (size_t i = 0; i < n; ++i) {
+                if (!parse_node_is_literal(pns2->nodes[i])) {
+                    return -1;
+                }
+            }
+            return 1 + n;
+        } else if (parse_node_is_literal(pns->nodes[1])) {
+            // tuple with 2 items
+            return 2;
+        }
+    }
+    return -1;
+}
+#endif
+
+#if MICROPY_COMP_CONST_IMPORT
+// Make the constants of a module that were given to mp_parse_const_module
+// available as constants of the module being parsed, for each of the names
+// with the form: from <module> import <name>
+STATIC void import_constants(parser_t *parser) {
+    mp_obj_dict_t *modules = MP_STATE_VM(parse_const_modules);
+    mp_parse_node_t pn_module = peek_result(parser, 1);
+    if (modules == NULL || !MP_PARSE_NODE_IS_ID(pn_module)) {
+        return;
+    }
+    mp_map_elem_t *elem = mp_map_lookup(&modules->map, MP_OBJ_NEW_QSTR(MP_PARSE_NODE_LEAF_ARG(pn_module)), MP_MAP_LOOKUP);
+    if (elem == NULL) {
+        return;
+    }
+    mp_map_t *consts = mp_obj_dict_get_map(elem->value);
+    mp_parse_node_t pn_names = peek_result(parser, 0);
+    if (MP_PARSE_NODE_IS_STRUCT_KIND(pn_names, RULE_import_as_names_paren)) {
+        pn_names = ((mp_parse_node_struct_t *)pn_names)->nodes[0];
+    }
+    mp_parse_node_t *nodes;
+    size_t n = mp_parse_node_extract_list(&pn_names, RULE_import_as_names, &nodes);
+    for (size_t i = 0; i < n; ++i) {
+        if (!MP_PARSE_NODE_IS_STRUCT_KIND(nodes[i], RULE_import_as_name)) {
+            continue;
+        }
+        mp_parse_node_struct_t *pns = (mp_parse_node_struct_t *)nodes[i];
+        elem = mp_map_lookup(consts, MP_OBJ_NEW_QSTR(MP_PARSE_NODE_LEAF_ARG(pns->nodes[0])), MP_MAP_LOOKUP);
+        if (elem != NULL) {
+            mp_parse_node_t pn_id = MP_PARSE_NODE_IS_NULL(pns->nodes[1]) ? pns->nodes[0] : pns->nodes[1];
+            mp_map_lookup(&parser->consts, MP_OBJ_NEW_QSTR(MP_PARSE_NODE_LEAF_ARG(pn_id)), MP_MAP_LOOKUP_ADD_IF_NOT_FOUND)->value = elem->value;
+        }
+    }
+}
+#endif
+
 STATIC bool fold_constants(parser_t *parser, uint8_t rule_id, size_t num_args) {
     // this code does folding of arbitrary integer expressions, eg 1 + 2 * 3 + 4
     // it does not do partial folding, eg 1 + 2 + x -> 3 + x
@@ -749,6 +888,19 @@ STATIC bool fold_constants(parser_t *parser, uint8_t rule_id, size_t num_args) {
         return false;
     #endif
 
+    #if MICROPY_COMP_CONST_FOLDING_LEN
+    } else if (rule_id == RULE_atom_expr_normal
+               && MP_PARSE_NODE_IS_ID(peek_result(parser, 1))
+               && MP_PARSE_NODE_LEAF_ARG(peek_result(parser, 1)) == MP_QSTR_len
+               && MP_PARSE_NODE_IS_STRUCT_KIND(peek_result(parser, 0), RULE_trailer_paren)) {
+        // len(<literal>)
+        mp_int_t len = parse_node_get_len_maybe(((mp_parse_node_struct_t *)peek_result(parser, 0))->nodes[0]);
+        if (len < 0) {
+            return false;
+        }
+        arg0 = MP_OBJ_NEW_SMALL_INT(len);
+    #endif
+
     #if MICROPY_COMP_MODULE_CONST
     } else if (rule_id == RULE_atom_expr_normal) {
         mp_parse_node_t pn0 = peek_result(parser, 1);
@@ -775,6 +927,12 @@ STATIC bool fold_constants(parser_t *parser, uint8_t rule_id, size_t num_args) {
         arg0 = dest[0];
     #endif
 
+    #if MICROPY_COMP_CONST_IMPORT
+    } else if (rule_id == RULE_import_from) {
+        import_constants(parser);
+        return false;
+    #endif
+
     } else {
         return false;
     }
@@ -830,7 +988,9 @@ STATIC void push_result_rule(parser_t *parser, size_t src_line, uint8_t rule_id,
     push_result_node(parser, (mp_parse_node_t)pn);
 }
 
-mp_parse_tree_t mp_parse(mp_lexer_t *lex, mp_parse_input_kind_t input_kind) {
+// If const_module is not MP_QSTRnull then the constants of the parsed code
+// are stored for other modules to import from the module with that name
+STATIC mp_parse_tree_t parse(mp_lexer_t *lex, mp_parse_input_kind_t input_kind, qstr const_module) {
 
     // initialise parser and allocate memory for its stacks
 
@@ -1125,6 +1285,25 @@ mp_parse_tree_t mp_parse(mp_lexer_t *lex, mp_parse_input_kind_t input_kind) {
         }
     }
 
+    #if MICROPY_COMP_CONST_IMPORT
+    if (const_module != MP_QSTRnull) {
+        // store the public constants, ones starting with an underscore aren't exported
+        mp_obj_t consts = mp_obj_new_dict(0);
+        for (size_t i = 0; i < parser.consts.alloc; ++i) {
+            if (mp_map_slot_is_filled(&parser.consts, i)
+                && qstr_str(MP_OBJ_QSTR_VALUE(parser.consts.table[i].key))[0] != '_') {
+                mp_obj_dict_store(consts, parser.consts.table[i].key, parser.consts.table[i].value);
+            }
+        }
+        if (MP_STATE_VM(parse_const_modules) == NULL) {
+            MP_STATE_VM(parse_const_modules) = MP_OBJ_TO_PTR(mp_obj_new_dict(0));
+        }
+        mp_obj_dict_store(MP_OBJ_FROM_PTR(MP_STATE_VM(parse_const_modules)), MP_OBJ_NEW_QSTR(const_module), consts);
+    }
+    #else
+    (void)const_module;
+    #endif
+
     #if MICROPY_COMP_CONST
     mp_map_deinit(&parser.consts);
     #endif
@@ -1176,6 +1355,17 @@ mp_parse_tree_t mp_parse(mp_lexer_t *lex, mp_parse_input_kind_t input_kind) {
     return parser.tree;
 }
 
+mp_parse_tree_t mp_parse(mp_lexer_t *lex, mp_parse_input_kind_t input_kind) {
+    return parse(lex, input_kind, MP_QSTRnull);
+}
+
+#if MICROPY_COMP_CONST_IMPORT
+void mp_parse_const_module(mp_lexer_t *lex, qstr module) {
+    mp_parse_tree_t tree = parse(lex, MP_PARSE_FILE_INPUT, module);
+    mp_parse_tree_clear(&tree);
+}
+#endif
+
 void mp_parse_tree_clear(mp_parse_tree_t *tree) {
     mp_parse_chunk_t *chunk = tree->chunk;
     while (chunk != NULL) {
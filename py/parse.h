@@ -102,6 +102,12 @@ typedef struct _mp_parse_t {
 // the parser will raise an exception if an error occurred
 // the parser will free the lexer before it returns
 mp_parse_tree_t mp_parse(struct _mp_lexer_t *lex, mp_parse_input_kind_t input_kind);
+
+#if MICROPY_COMP_CONST_IMPORT
+// parse a module only to store its constants, so that other modules parsed after
+// it can use them with: from <module> import <name>
+void mp_parse_const_module(struct _mp_lexer_t *lex, qstr module);
+#endif
 void mp_parse_tree_clear(mp_parse_tree_t *tree);
 
 #endif // MICROPY_INCLUDED_PY_PARSE_H
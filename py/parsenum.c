@@ -31,6 +31,7 @@
 #include "py/parsenumbase.h"
 #include "py/parsenum.h"
 #include "py/smallint.h"
+#include "py/formatfloat.h"
 
 #if MICROPY_PY_BUILTINS_FLOAT
 #include <math.h>
@@ -238,7 +239,12 @@ mp_obj_t mp_parse_num_decimal(const char *str, size_t len, bool allow_imag, bool
         parse_dec_in_t in = PARSE_DEC_IN_INTG;
         bool exp_neg = false;
         int exp_val = 0;
+        #if MICROPY_FLOAT_EXACT_CONVERSION
+        // the digits of the mantissa are converted by mp_decimal_to_float
+        const char *mant_top = NULL;
+        #else
         int exp_extra = 0;
+        #endif
         while (str < top) {
             unsigned int dig = *str++;
             if ('0' <= dig && dig <= '9') {
@@ -251,6 +257,7 @@ mp_obj_t mp_parse_num_decimal(const char *str, size_t len, bool allow_imag, bool
                         exp_val = 10 * exp_val + dig;
                     }
                 } else {
+                    #if !MICROPY_FLOAT_EXACT_CONVERSION
                     if (dec_val < DEC_VAL_MAX) {
                         // dec_val won't overflow so keep accumulating
                         dec_val = 10 * dec_val + dig;
@@ -264,11 +271,15 @@ mp_obj_t mp_parse_num_decimal(const char *str, size_t len, bool allow_imag, bool
                             ++exp_extra;
                         }
                     }
+                    #endif
                 }
             } else if (in == PARSE_DEC_IN_INTG && dig == '.') {
                 in = PARSE_DEC_IN_FRAC;
             } else if (in != PARSE_DEC_IN_EXP && ((dig | 0x20) == 'e')) {
                 in = PARSE_DEC_IN_EXP;
+                #if MICROPY_FLOAT_EXACT_CONVERSION
+                mant_top = str - 1;
+                #endif
                 if (str < top) {
                     if (str[0] == '+') {
                         str++;
@@ -297,6 +308,12 @@ mp_obj_t mp_parse_num_decimal(const char *str, size_t len, bool allow_imag, bool
             exp_val = -exp_val;
         }
 
+        #if MICROPY_FLOAT_EXACT_CONVERSION
+        if (mant_top == NULL) {
+            mant_top = imag ? str - 1 : str;
+        }
+        dec_val = mp_decimal_to_float(str_val_start, mant_top, exp_val);
+        #else
         // apply the exponent, making sure it's not a subnormal value
         exp_val += exp_extra;
         if (exp_val < SMALL_NORMAL_EXP) {
@@ -314,6 +331,7 @@ mp_obj_t mp_parse_num_decimal(const char *str, size_t len, bool allow_imag, bool
         } else {
             dec_val *= MICROPY_FLOAT_C_FUN(pow)(10, exp_val);
         }
+        #endif
     }
 
     // negate value if needed
@@ -35,6 +35,7 @@
 #include "py/bc0.h"
 #include "py/objstr.h"
 #include "py/mpthread.h"
+#include "py/gc.h"
 
 #if MICROPY_PERSISTENT_CODE_LOAD || MICROPY_PERSISTENT_CODE_SAVE
 
@@ -48,6 +49,18 @@
 #define MPY_FEATURE_ARCH_DYNAMIC MPY_FEATURE_ARCH
 #endif
 
+#if MICROPY_DYNAMIC_COMPILER
+#define MPY_FEATURE_LAZY_DYNAMIC (mp_dynamic_compiler.lazy_load ? MPY_FEATURE_LAZY : 0)
+#else
+#define MPY_FEATURE_LAZY_DYNAMIC (0)
+#endif
+
+#if MICROPY_DYNAMIC_COMPILER
+#define MPY_FEATURE_MAPPED_STR_DYNAMIC (mp_dynamic_compiler.mapped_str ? MPY_FEATURE_MAPPED_STR : 0)
+#else
+#define MPY_FEATURE_MAPPED_STR_DYNAMIC (MICROPY_PERSISTENT_CODE_LOAD_MAPPED ? MPY_FEATURE_MAPPED_STR : 0)
+#endif
+
 #if MICROPY_PERSISTENT_CODE_LOAD || (MICROPY_PERSISTENT_CODE_SAVE && !MICROPY_DYNAMIC_COMPILER)
 // The bytecode will depend on the number of bits in a small-int, and
 // this function computes that (could make it a fixed constant, but it
@@ -147,8 +160,31 @@ STATIC byte *extract_prelude(const byte **ip, bytecode_prelude_t *prelude) {
 
 #include "py/parsenum.h"
 
+#if MICROPY_PERSISTENT_CODE_LOAD_MAPPED && !(MICROPY_READER_VFS && MICROPY_VFS_MMAP)
+#error "MICROPY_PERSISTENT_CODE_LOAD_MAPPED requires MICROPY_READER_VFS and MICROPY_VFS_MMAP"
+#endif
+
+// The .mpy file that is being loaded.  Its bytes are read through
+// mpy_file_readbyte(), which takes them a block at a time from readers that
+// have a readblock function, so that read_bytes() can copy whole runs of
+// machine code and data instead of reading them a byte at a time.
+typedef struct _mpy_file_t {
+    byte feature; // MPY_FEATURE_LAZY and MPY_FEATURE_MAPPED_STR if set in the header
+    mp_reader_t *reader; // reader that the bytes are passed through from
+    const byte *cur; // rest of the last block from reader->readblock
+    const byte *end;
+    #if MICROPY_PERSISTENT_CODE_LOAD_LAZY
+    mp_obj_t file; // name of the file to load nested functions from later, or MP_OBJ_NULL
+    size_t pos; // offset in the file of the next byte
+    #endif
+    #if MICROPY_PERSISTENT_CODE_LOAD_MAPPED
+    bool mapped; // the blocks of reader are memory that stays for good
+    #endif
+} mpy_file_t;
+
 STATIC int read_byte(mp_reader_t *reader);
 STATIC size_t read_uint(mp_reader_t *reader, byte **out);
+STATIC mp_raw_code_t *load_raw_code(mp_reader_t *reader, qstr_window_t *qw, mpy_file_t *mf);
 
 #if MICROPY_EMIT_MACHINE_CODE
 
@@ -186,6 +222,11 @@ STATIC void arch_link_qstr(uint8_t *pc, bool is_obj, qstr qst) {
         // qstr number, movw instruction
         asm_thumb_rewrite_mov(pc, val); // movw
     }
+    #elif MICROPY_EMIT_RV32
+    // lui and addi, rounding the upper part up as addi sign extends the lower part
+    uint32_t *insn = (uint32_t *)pc;
+    insn[0] = (insn[0] & 0xfff) | ((val + 0x800) & 0xfffff000);
+    insn[1] = (insn[1] & 0xfffff) | val << 20;
     #endif
 }
 
@@ -237,13 +278,81 @@ void mp_native_relocate(void *ri_in, uint8_t *text, uintptr_t reloc_text) {
 
 #endif
 
+STATIC mp_uint_t mpy_file_readbyte(void *data) {
+    mpy_file_t *mf = data;
+    if (mf->cur == mf->end) {
+        if (mf->reader->readblock == NULL) {
+            #if MICROPY_PERSISTENT_CODE_LOAD_LAZY
+            ++mf->pos;
+            #endif
+            return mf->reader->readbyte(mf->reader->data);
+        }
+        size_t len = mf->reader->readblock(mf->reader->data, &mf->cur);
+        mf->end = mf->cur + len;
+        if (len == 0) {
+            return MP_READER_EOF;
+        }
+    }
+    #if MICROPY_PERSISTENT_CODE_LOAD_LAZY
+    ++mf->pos;
+    #endif
+    return *mf->cur++;
+}
+
+// Makes reader, which reads from mf, pass through the bytes of src.
+STATIC void mpy_file_init(mpy_file_t *mf, mp_reader_t *reader, mp_reader_t *src) {
+    mf->reader = src;
+    mf->cur = NULL;
+    mf->end = NULL;
+    #if MICROPY_PERSISTENT_CODE_LOAD_MAPPED
+    mf->mapped = false;
+    #endif
+    reader->data = mf;
+    reader->readbyte = mpy_file_readbyte;
+    reader->close = NULL;
+    reader->readblock = NULL;
+}
+
+// Returns a pointer to the next bytes of reader, at most *len of them, and
+// sets *len to how many there are, consuming them.  Returns NULL if the
+// reader can't give its bytes as blocks.
+STATIC const byte *read_block(mp_reader_t *reader, size_t *len) {
+    if (reader->readbyte != mpy_file_readbyte) {
+        return NULL;
+    }
+    mpy_file_t *mf = reader->data;
+    if (mf->cur == mf->end) {
+        if (mf->reader->readblock == NULL) {
+            return NULL;
+        }
+        size_t block_len = mf->reader->readblock(mf->reader->data, &mf->cur);
+        mf->end = mf->cur + block_len;
+    }
+    const byte *buf = mf->cur;
+    *len = MIN(*len, (size_t)(mf->end - mf->cur));
+    mf->cur += *len;
+    #if MICROPY_PERSISTENT_CODE_LOAD_LAZY
+    mf->pos += *len;
+    #endif
+    return buf;
+}
+
 STATIC int read_byte(mp_reader_t *reader) {
     return reader->readbyte(reader->data);
 }
 
 STATIC void read_bytes(mp_reader_t *reader, byte *buf, size_t len) {
-    while (len-- > 0) {
-        *buf++ = reader->readbyte(reader->data);
+    while (len > 0) {
+        size_t n = len;
+        const byte *block = read_block(reader, &n);
+        if (block == NULL || n == 0) {
+            *buf++ = reader->readbyte(reader->data);
+            --len;
+        } else {
+            memcpy(buf, block, n);
+            buf += n;
+            len -= n;
+        }
     }
 }
 
@@ -274,24 +383,59 @@ STATIC qstr load_qstr(mp_reader_t *reader, qstr_window_t *qw) {
         return qstr_window_access(qw, len >> 1);
     }
     len >>= 1;
-    char *str = m_new(char, len);
+    // Most names are short, so only use the heap for long ones, to save
+    // allocating and freeing a buffer for each new qstr of an .mpy file.
+    char buf[32];
+    char *str = buf;
+    if (len > sizeof(buf)) {
+        str = m_new(char, len);
+    }
     read_bytes(reader, (byte *)str, len);
     qstr qst = qstr_from_strn(str, len);
-    m_del(char, str, len);
+    if (str != buf) {
+        m_del(char, str, len);
+    }
     qstr_window_push(qw, qst);
     return qst;
 }
 
-STATIC mp_obj_t load_obj(mp_reader_t *reader) {
+#if MICROPY_PERSISTENT_CODE_LOAD_MAPPED
+// Makes a str or bytes object that refers to its null-terminated data in place
+STATIC mp_obj_t load_str_mapped(mp_reader_t *reader, const mp_obj_type_t *type, size_t len) {
+    size_t n = len + 1;
+    const byte *data = read_block(reader, &n);
+    if (data == NULL || n != len + 1 || data[len] != '\0') {
+        mp_raise_ValueError(MP_ERROR_TEXT("incompatible .mpy file"));
+    }
+    mp_obj_str_t *o = m_new_obj(mp_obj_str_t);
+    o->base.type = type;
+    o->hash = qstr_compute_hash(data, len);
+    o->len = len;
+    o->data = data;
+    MP_STATE_VM(persistent_code_mapped) = true;
+    return MP_OBJ_FROM_PTR(o);
+}
+#endif
+
+STATIC mp_obj_t load_obj(mp_reader_t *reader, mpy_file_t *mf) {
     byte obj_type = read_byte(reader);
     if (obj_type == 'e') {
         return MP_OBJ_FROM_PTR(&mp_const_ellipsis_obj);
     } else {
         size_t len = read_uint(reader, NULL);
+        bool is_str = obj_type == 's' || obj_type == 'b';
+        #if MICROPY_PERSISTENT_CODE_LOAD_MAPPED
+        if (is_str && mf->mapped && (mf->feature & MPY_FEATURE_MAPPED_STR)) {
+            return load_str_mapped(reader, obj_type == 's' ? &mp_type_str : &mp_type_bytes, len);
+        }
+        #endif
         vstr_t vstr;
         vstr_init_len(&vstr, len);
         read_bytes(reader, (byte *)vstr.buf, len);
-        if (obj_type == 's' || obj_type == 'b') {
+        if (is_str) {
+            if (mf->feature & MPY_FEATURE_MAPPED_STR) {
+                read_byte(reader); // the null byte
+            }
             return mp_obj_new_str_from_vstr(obj_type == 's' ? &mp_type_str : &mp_type_bytes, &vstr);
         } else if (obj_type == 'i') {
             return mp_parse_num_integer(vstr.buf, vstr.len, 10, NULL);
@@ -349,7 +493,130 @@ STATIC void load_bytecode(mp_reader_t *reader, qstr_window_t *qw, byte *ip, byte
     }
 }
 
-STATIC mp_raw_code_t *load_raw_code(mp_reader_t *reader, qstr_window_t *qw) {
+#if MICROPY_PERSISTENT_CODE_LOAD_LAZY
+
+// Where a nested function that isn't loaded yet is in its .mpy file
+typedef struct _mp_raw_code_lazy_t {
+    mp_obj_t file;
+    size_t offset;
+    size_t len;
+    uint32_t hash;
+    byte feature; // feature bits of the file
+} mp_raw_code_lazy_t;
+
+// FNV-1a hash of the next len bytes, to check that the file hasn't changed
+// by the time a nested function is loaded from it
+STATIC uint32_t read_hash(mp_reader_t *reader, byte *buf, size_t len) {
+    uint32_t hash = 2166136261u;
+    while (len > 0) {
+        byte b;
+        size_t n = len;
+        const byte *block = read_block(reader, &n);
+        if (block == NULL || n == 0) {
+            b = read_byte(reader);
+            block = &b;
+            n = 1;
+        }
+        len -= n;
+        if (buf != NULL) {
+            memcpy(buf, block, n);
+            buf += n;
+        }
+        while (n-- > 0) {
+            hash = (hash ^ *block++) * 16777619u;
+        }
+    }
+    return hash;
+}
+
+void mp_raw_code_load_lazy(mp_raw_code_t *rc) {
+    // Without a GIL another thread may be loading the same function, and the
+    // placeholder is only read and replaced with its lock held.
+    MP_THREAD_OBJ_LOCK(rc);
+    if (rc->kind != MP_CODE_LAZY) {
+        MP_THREAD_OBJ_UNLOCK(rc);
+        return;
+    }
+    mp_raw_code_lazy_t lz = *(const mp_raw_code_lazy_t *)rc->fun_data;
+    MP_THREAD_OBJ_UNLOCK(rc);
+
+    // Read the data of the function from the file, the reader has no way to seek
+    mp_reader_t file_reader;
+    mp_reader_new_file(&file_reader, mp_obj_str_get_str(lz.file));
+    mpy_file_t mf;
+    mp_reader_t reader;
+    mpy_file_init(&mf, &reader, &file_reader);
+    read_hash(&reader, NULL, lz.offset);
+    byte *buf = m_new(byte, lz.len);
+    uint32_t hash = read_hash(&reader, buf, lz.len);
+    file_reader.close(file_reader.data);
+    if (hash != lz.hash) {
+        m_del(byte, buf, lz.len);
+        mp_raise_ValueError(MP_ERROR_TEXT("incompatible .mpy file"));
+    }
+
+    // Load it, leaving its own nested functions to be loaded later
+    mp_reader_t mem_reader;
+    mp_reader_new_mem(&mem_reader, buf, lz.len, lz.len);
+    mpy_file_init(&mf, &reader, &mem_reader);
+    mf.feature = lz.feature;
+    mf.file = lz.file;
+    mf.pos = lz.offset;
+    qstr_window_t qw;
+    qw.idx = 0;
+    mp_raw_code_t *rc_new = load_raw_code(&reader, &qw, &mf);
+    mem_reader.close(mem_reader.data);
+
+    // Replace the placeholder in place, that's what the parent refers to.  The
+    // kind is set last so that a thread that doesn't take the lock only sees
+    // the new kind once the rest of the raw code is there.
+    MP_THREAD_OBJ_LOCK(rc);
+    if (rc->kind == MP_CODE_LAZY) {
+        mp_raw_code_kind_t kind = rc_new->kind;
+        rc_new->kind = MP_CODE_LAZY;
+        *rc = *rc_new;
+        MP_GC_WRITE_BARRIER(rc);
+        #if MICROPY_PY_THREAD_OBJ_LOCK
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        #endif
+        rc->kind = kind;
+    }
+    MP_THREAD_OBJ_UNLOCK(rc);
+    m_del_obj(mp_raw_code_t, rc_new);
+}
+
+#endif
+
+STATIC mp_raw_code_t *load_child(mp_reader_t *reader, qstr_window_t *qw, mpy_file_t *mf) {
+    if (!(mf->feature & MPY_FEATURE_LAZY)) {
+        return load_raw_code(reader, qw, mf);
+    }
+
+    // The child is preceded by its length and whether to load it lazily, and
+    // has its own qstr window
+    size_t len_lazy = read_uint(reader, NULL);
+    #if MICROPY_PERSISTENT_CODE_LOAD_LAZY
+    if ((len_lazy & 1) && mf->file != MP_OBJ_NULL) {
+        // Skip over the child and make a placeholder to load it on first use
+        mp_raw_code_lazy_t *lz = m_new_obj(mp_raw_code_lazy_t);
+        lz->file = mf->file;
+        lz->offset = mf->pos;
+        lz->len = len_lazy >> 1;
+        lz->hash = read_hash(reader, NULL, lz->len);
+        lz->feature = mf->feature;
+        mp_raw_code_t *rc = mp_emit_glue_new_raw_code();
+        rc->kind = MP_CODE_LAZY;
+        rc->fun_data = lz;
+        return rc;
+    }
+    #endif
+    (void)len_lazy;
+    qstr_window_t child_qw;
+    child_qw.idx = 0;
+    return load_raw_code(reader, &child_qw, mf);
+}
+
+STATIC mp_raw_code_t *load_raw_code(mp_reader_t *reader, qstr_window_t *qw, mpy_file_t *mf) {
     // Load function kind and data length
     size_t kind_len = read_uint(reader, NULL);
     int kind = (kind_len & 3) + MP_CODE_BYTECODE;
@@ -486,10 +753,10 @@ STATIC mp_raw_code_t *load_raw_code(mp_reader_t *reader, qstr_window_t *qw) {
 
         // Load constant objects and raw code children
         for (size_t i = 0; i < n_obj; ++i) {
-            *ct++ = (mp_uint_t)load_obj(reader);
+            *ct++ = (mp_uint_t)load_obj(reader, mf);
         }
         for (size_t i = 0; i < n_raw_code; ++i) {
-            *ct++ = (mp_uint_t)(uintptr_t)load_raw_code(reader, qw);
+            *ct++ = (mp_uint_t)(uintptr_t)load_child(reader, qw, mf);
         }
     }
 
@@ -546,7 +813,25 @@ STATIC mp_raw_code_t *load_raw_code(mp_reader_t *reader, qstr_window_t *qw) {
     return rc;
 }
 
-mp_raw_code_t *mp_raw_code_load(mp_reader_t *reader) {
+// If file is not MP_OBJ_NULL then it's the name that reader reads from, to
+// load nested functions from later.  If mapped is true then the blocks of src
+// are memory that stays for good, which constants can refer to.
+STATIC mp_raw_code_t *raw_code_load(mp_reader_t *src, mp_obj_t file, bool mapped) {
+    mpy_file_t mf;
+    mp_reader_t file_reader;
+    mp_reader_t *reader = &file_reader;
+    mpy_file_init(&mf, reader, src);
+    #if MICROPY_PERSISTENT_CODE_LOAD_MAPPED
+    mf.mapped = mapped;
+    #else
+    (void)mapped;
+    #endif
+    #if MICROPY_PERSISTENT_CODE_LOAD_LAZY
+    mf.file = file;
+    mf.pos = 0;
+    #else
+    (void)file;
+    #endif
     byte header[4];
     read_bytes(reader, header, sizeof(header));
     if (header[0] != 'M'
@@ -562,13 +847,18 @@ mp_raw_code_t *mp_raw_code_load(mp_reader_t *reader) {
             mp_raise_ValueError(MP_ERROR_TEXT("incompatible .mpy arch"));
         }
     }
+    mf.feature = header[2] & (MPY_FEATURE_LAZY | MPY_FEATURE_MAPPED_STR);
     qstr_window_t qw;
     qw.idx = 0;
-    mp_raw_code_t *rc = load_raw_code(reader, &qw);
-    reader->close(reader->data);
+    mp_raw_code_t *rc = load_raw_code(reader, &qw, &mf);
+    src->close(src->data);
     return rc;
 }
 
+mp_raw_code_t *mp_raw_code_load(mp_reader_t *reader) {
+    return raw_code_load(reader, MP_OBJ_NULL, false);
+}
+
 mp_raw_code_t *mp_raw_code_load_mem(const byte *buf, size_t len) {
     mp_reader_t reader;
     mp_reader_new_mem(&reader, buf, len, 0);
@@ -579,8 +869,23 @@ mp_raw_code_t *mp_raw_code_load_mem(const byte *buf, size_t len) {
 
 mp_raw_code_t *mp_raw_code_load_file(const char *filename) {
     mp_reader_t reader;
+    #if MICROPY_PERSISTENT_CODE_LOAD_MAPPED
+    bool mapped = mp_reader_new_file_mapped(&reader, filename);
+    #else
+    bool mapped = false;
     mp_reader_new_file(&reader, filename);
-    return mp_raw_code_load(&reader);
+    #endif
+    #if MICROPY_PERSISTENT_CODE_LOAD_LAZY
+    // Nested functions are only left in the file when it's named by an
+    // absolute path, a relative one may name another file, or none, once
+    // the current directory changes.
+    if (filename[0] == '/') {
+        return raw_code_load(&reader, mp_obj_new_str(filename, strlen(filename)), mapped);
+    }
+    return raw_code_load(&reader, MP_OBJ_NULL, mapped);
+    #else
+    return raw_code_load(&reader, MP_OBJ_NULL, mapped);
+    #endif
 }
 
 #endif // MICROPY_HAS_FILE_READER
@@ -590,6 +895,7 @@ mp_raw_code_t *mp_raw_code_load_file(const char *filename) {
 #if MICROPY_PERSISTENT_CODE_SAVE
 
 #include "py/objstr.h"
+#include "py/scope.h"
 
 STATIC void mp_print_bytes(mp_print_t *print, const byte *data, size_t len) {
     print->print_strn(print->data, (const char *)data, len);
@@ -639,6 +945,9 @@ STATIC void save_obj(mp_print_t *print, mp_obj_t o) {
         mp_print_bytes(print, &obj_type, 1);
         mp_print_uint(print, len);
         mp_print_bytes(print, (const byte *)str, len);
+        if (MPY_FEATURE_MAPPED_STR_DYNAMIC) {
+            mp_print_bytes(print, (const byte *)"", 1);
+        }
     } else if (MP_OBJ_TO_PTR(o) == &mp_const_ellipsis_obj) {
         byte obj_type = 'e';
         mp_print_bytes(print, &obj_type, 1);
@@ -688,6 +997,8 @@ STATIC void save_bytecode(mp_print_t *print, qstr_window_t *qw, const byte *ip,
     }
 }
 
+STATIC void save_child(mp_print_t *print, mp_raw_code_t *parent, mp_raw_code_t *rc, qstr_window_t *qstr_window);
+
 STATIC void save_raw_code(mp_print_t *print, mp_raw_code_t *rc, qstr_window_t *qstr_window) {
     // Save function kind and data length
     mp_print_uint(print, (rc->fun_data_len << 2) | (rc->kind - MP_CODE_BYTECODE));
@@ -769,12 +1080,37 @@ STATIC void save_raw_code(mp_print_t *print, mp_raw_code_t *rc, qstr_window_t *q
             save_obj(print, (mp_obj_t)*const_table++);
         }
         for (size_t i = 0; i < rc->n_raw_code; ++i) {
-            save_raw_code(print, (mp_raw_code_t *)(uintptr_t)*const_table++, qstr_window);
+            save_child(print, rc, (mp_raw_code_t *)(uintptr_t)*const_table++, qstr_window);
         }
     }
 }
 
-STATIC bool mp_raw_code_has_native(mp_raw_code_t *rc) {
+STATIC void save_child(mp_print_t *print, mp_raw_code_t *parent, mp_raw_code_t *rc, qstr_window_t *qstr_window) {
+    if (!MPY_FEATURE_LAZY_DYNAMIC) {
+        save_raw_code(print, rc, qstr_window);
+        return;
+    }
+
+    // Functions and classes of a module or class are made when the module is
+    // imported, so only the ones within functions are worth loading lazily.
+    // Lambdas and comprehensions are small, so load those straight away too.
+    bool lazy = parent->scope_kind != SCOPE_MODULE && parent->scope_kind != SCOPE_CLASS
+        && (rc->scope_kind == SCOPE_FUNCTION || rc->scope_kind == SCOPE_CLASS);
+
+    // Encode the child with its own qstr window first, to save its length before it
+    vstr_t vstr;
+    mp_print_t pr;
+    vstr_init_print(&vstr, 64, &pr);
+    qstr_window_t qw;
+    qw.idx = 0;
+    memset(qw.window, 0, sizeof(qw.window));
+    save_raw_code(&pr, rc, &qw);
+    mp_print_uint(print, vstr.len << 1 | lazy);
+    mp_print_bytes(print, (const byte *)vstr.buf, vstr.len);
+    vstr_clear(&vstr);
+}
+
+bool mp_raw_code_has_native(mp_raw_code_t *rc) {
     if (rc->kind != MP_CODE_BYTECODE) {
         return true;
     }
@@ -800,13 +1136,14 @@ void mp_raw_code_save(mp_raw_code_t *rc, mp_print_t *print) {
     // header contains:
     //  byte  'M'
     //  byte  version
-    //  byte  feature flags
+    //  byte  feature flags, native arch, MPY_FEATURE_LAZY and MPY_FEATURE_MAPPED_STR
     //  byte  number of bits in a small int
     //  uint  size of qstr window
     byte header[4] = {
         'M',
         MPY_VERSION,
-        MPY_FEATURE_ENCODE_FLAGS(MPY_FEATURE_FLAGS_DYNAMIC),
+        MPY_FEATURE_ENCODE_FLAGS(MPY_FEATURE_FLAGS_DYNAMIC) | MPY_FEATURE_LAZY_DYNAMIC
+        | MPY_FEATURE_MAPPED_STR_DYNAMIC,
         #if MICROPY_DYNAMIC_COMPILER
         mp_dynamic_compiler.small_int_bits,
         #else
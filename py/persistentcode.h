@@ -39,7 +39,17 @@
 
 // Macros to encode/decode native architecture to/from the feature byte
 #define MPY_FEATURE_ENCODE_ARCH(arch) ((arch) << 2)
-#define MPY_FEATURE_DECODE_ARCH(feat) ((feat) >> 2)
+#define MPY_FEATURE_DECODE_ARCH(feat) (((feat) >> 2) & 0xf)
+
+// Feature bit set when each nested function is preceded by its length and a
+// bit that says whether to load it lazily, and is encoded with its own qstr
+// window, so it can be loaded on its own
+#define MPY_FEATURE_LAZY (0x40)
+
+// Feature bit set when each str and bytes constant is followed by a null byte,
+// which isn't counted in its length, so the constant can be used in place when
+// the .mpy file is mapped into memory
+#define MPY_FEATURE_MAPPED_STR (0x80)
 
 // The feature flag bits encode the compile-time config options that
 // affect the generate bytecode.
@@ -77,6 +87,8 @@
     #define MPY_FEATURE_ARCH (MP_NATIVE_ARCH_XTENSA)
 #elif MICROPY_EMIT_XTENSAWIN
     #define MPY_FEATURE_ARCH (MP_NATIVE_ARCH_XTENSAWIN)
+#elif MICROPY_EMIT_RV32
+    #define MPY_FEATURE_ARCH (MP_NATIVE_ARCH_RV32IMC)
 #else
     #define MPY_FEATURE_ARCH (MP_NATIVE_ARCH_NONE)
 #endif
@@ -101,14 +113,19 @@ enum {
     MP_NATIVE_ARCH_ARMV7EMDP,
     MP_NATIVE_ARCH_XTENSA,
     MP_NATIVE_ARCH_XTENSAWIN,
+    MP_NATIVE_ARCH_RV32IMC,
 };
 
 mp_raw_code_t *mp_raw_code_load(mp_reader_t *reader);
 mp_raw_code_t *mp_raw_code_load_mem(const byte *buf, size_t len);
 mp_raw_code_t *mp_raw_code_load_file(const char *filename);
+#if MICROPY_PERSISTENT_CODE_LOAD_LAZY
+void mp_raw_code_load_lazy(mp_raw_code_t *rc);
+#endif
 
 void mp_raw_code_save(mp_raw_code_t *rc, mp_print_t *print);
 void mp_raw_code_save_file(mp_raw_code_t *rc, const char *filename);
+bool mp_raw_code_has_native(mp_raw_code_t *rc);
 
 void mp_native_relocate(void *reloc, uint8_t *text, uintptr_t reloc_text);
 
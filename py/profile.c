@@ -24,9 +24,12 @@
  * THE SOFTWARE.
  */
 
+#include <string.h>
+
 #include "py/profile.h"
 #include "py/bc0.h"
 #include "py/gc.h"
+#include "py/persistentcode.h"
 
 #if MICROPY_PY_SYS_SETTRACE
 
@@ -181,6 +184,11 @@ const mp_obj_type_t mp_type_settrace_codeobj = {
 };
 
 mp_obj_t mp_obj_new_code(const mp_raw_code_t *rc) {
+    #if MICROPY_PERSISTENT_CODE_LOAD_LAZY
+    if (rc->kind == MP_CODE_LAZY) {
+        mp_raw_code_load_lazy((mp_raw_code_t *)rc);
+    }
+    #endif
     mp_obj_code_t *o = m_new_obj_maybe(mp_obj_code_t);
     if (o == NULL) {
         return MP_OBJ_NULL;
@@ -980,3 +988,109 @@ void mp_prof_print_instr(const byte *ip, mp_code_state_t *code_state) {
 #endif // MICROPY_PROF_INSTR_DEBUG_PRINT_ENABLE
 
 #endif // MICROPY_PY_SYS_SETTRACE
+
+#if MICROPY_SAMPLING_PROFILE
+
+/******************************************************************************/
+// sampling profile
+
+void mp_prof_sample_start(uint16_t period) {
+    MICROPY_SAMPLING_PROFILE_TIMER(false);
+    mp_uint_t atomic_state = MICROPY_BEGIN_ATOMIC_SECTION();
+    MP_STATE_VM(prof_sample_running) = false;
+    memset(MP_STATE_VM(prof_sample), 0, sizeof(MP_STATE_VM(prof_sample)));
+    MP_STATE_VM(prof_sample_period) = period;
+    MP_STATE_VM(prof_sample_countdown) = period;
+    MP_STATE_VM(prof_sample_dropped) = 0;
+    MP_STATE_VM(prof_sample_running) = true;
+    MICROPY_END_ATOMIC_SECTION(atomic_state);
+    MICROPY_SAMPLING_PROFILE_TIMER(true);
+}
+
+void mp_prof_sample_stop(void) {
+    MP_STATE_VM(prof_sample_running) = false;
+    MICROPY_SAMPLING_PROFILE_TIMER(false);
+}
+
+STATIC bool prof_sample_equal(const mp_prof_sample_entry_t *a, const mp_prof_sample_entry_t *b) {
+    if (a->depth != b->depth || a->truncated != b->truncated) {
+        return false;
+    }
+    for (size_t i = 0; i < a->depth; ++i) {
+        if (a->bytecode[i] != b->bytecode[i] || a->source_line[i] != b->source_line[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// This runs in an interrupt, so it only reads the chain of code states and
+// the bytecode, and doesn't allocate.  The line of a frame is that of the
+// last instruction which could have called out or raised.
+void mp_prof_sample_tick(void) {
+    if (!MP_STATE_VM(prof_sample_running) || --MP_STATE_VM(prof_sample_countdown) > 0) {
+        return;
+    }
+    MP_STATE_VM(prof_sample_countdown) = MP_STATE_VM(prof_sample_period);
+
+    mp_prof_sample_entry_t sample;
+    memset(&sample, 0, sizeof(sample));
+    uintptr_t hash = 0;
+    const mp_code_state_t *code_state = MP_STATE_THREAD(current_code_state);
+    for (; code_state != NULL && sample.depth < MICROPY_SAMPLING_PROFILE_DEPTH; code_state = code_state->prev_state) {
+        const byte *bytecode = code_state->fun_bc->bytecode;
+        size_t source_line = mp_bytecode_get_location(bytecode, code_state->ip, NULL, NULL);
+        sample.bytecode[sample.depth] = bytecode;
+        sample.source_line[sample.depth] = source_line;
+        sample.depth += 1;
+        hash = hash * 33 + ((uintptr_t)bytecode ^ source_line);
+    }
+    sample.truncated = code_state != NULL;
+    sample.count = 1;
+
+    // find the stack in the table by linear probing, or add it
+    size_t i = hash % MICROPY_SAMPLING_PROFILE_SIZE;
+    for (size_t n = 0; n < MICROPY_SAMPLING_PROFILE_SIZE; ++n) {
+        mp_prof_sample_entry_t *entry = &MP_STATE_VM(prof_sample)[i];
+        if (entry->count == 0) {
+            *entry = sample;
+            return;
+        }
+        if (prof_sample_equal(entry, &sample)) {
+            entry->count += 1;
+            return;
+        }
+        i = (i + 1) % MICROPY_SAMPLING_PROFILE_SIZE;
+    }
+    MP_STATE_VM(prof_sample_dropped) += 1;
+}
+
+// Samples may still be taken while this runs: they only add entries or
+// increment counts, and an interrupt is never seen half done.
+void mp_prof_sample_dump(const mp_print_t *print) {
+    for (size_t i = 0; i < MICROPY_SAMPLING_PROFILE_SIZE; ++i) {
+        const mp_prof_sample_entry_t *entry = &MP_STATE_VM(prof_sample)[i];
+        size_t count = entry->count;
+        if (count == 0) {
+            continue;
+        }
+        if (entry->truncated) {
+            mp_print_str(print, "[truncated];");
+        }
+        if (entry->depth == 0) {
+            mp_print_str(print, "[no bytecode]");
+        }
+        // collapsed stacks list the outermost frame first
+        for (size_t j = entry->depth; j-- > 0;) {
+            qstr source_file, block_name;
+            mp_bytecode_get_location(entry->bytecode[j], NULL, &source_file, &block_name);
+            mp_printf(print, "%q:%q:%u%s", source_file, block_name, (uint)entry->source_line[j], j > 0 ? ";" : "");
+        }
+        mp_printf(print, " %u\n", (uint)count);
+    }
+    if (MP_STATE_VM(prof_sample_dropped) != 0) {
+        mp_printf(print, "[dropped] %u\n", (uint)MP_STATE_VM(prof_sample_dropped));
+    }
+}
+
+#endif // MICROPY_SAMPLING_PROFILE
@@ -76,4 +76,20 @@ void mp_prof_print_instr(const byte *ip, mp_code_state_t *code_state);
 #endif
 
 #endif // MICROPY_PY_SYS_SETTRACE
+
+#if MICROPY_SAMPLING_PROFILE
+
+// Clear the sampling profile and count a sample every period ticks.
+void mp_prof_sample_start(uint16_t period);
+void mp_prof_sample_stop(void);
+
+// To be called by the port from a periodic timer interrupt.
+void mp_prof_sample_tick(void);
+
+// Print the stacks sampled so far, one line per stack, as "frame;frame count"
+// with frames written as "file:function:line", outermost first.  This is the
+// collapsed format read by flamegraph.pl and similar tools.
+void mp_prof_sample_dump(const mp_print_t *print);
+
+#endif // MICROPY_SAMPLING_PROFILE
 #endif // MICROPY_INCLUDED_PY_PROFILING_H
@@ -9,6 +9,7 @@ set(MICROPY_SOURCE_PY
     ${MICROPY_PY_DIR}/argcheck.c
     ${MICROPY_PY_DIR}/asmarm.c
     ${MICROPY_PY_DIR}/asmbase.c
+    ${MICROPY_PY_DIR}/asmrv32.c
     ${MICROPY_PY_DIR}/asmthumb.c
     ${MICROPY_PY_DIR}/asmx64.c
     ${MICROPY_PY_DIR}/asmx86.c
@@ -22,9 +23,11 @@ set(MICROPY_SOURCE_PY
     ${MICROPY_PY_DIR}/emitbc.c
     ${MICROPY_PY_DIR}/emitcommon.c
     ${MICROPY_PY_DIR}/emitglue.c
+    ${MICROPY_PY_DIR}/emitinlinerv32.c
     ${MICROPY_PY_DIR}/emitinlinethumb.c
     ${MICROPY_PY_DIR}/emitinlinextensa.c
     ${MICROPY_PY_DIR}/emitnarm.c
+    ${MICROPY_PY_DIR}/emitnrv32.c
     ${MICROPY_PY_DIR}/emitnthumb.c
     ${MICROPY_PY_DIR}/emitnx64.c
     ${MICROPY_PY_DIR}/emitnx86.c
@@ -33,6 +36,8 @@ set(MICROPY_SOURCE_PY
     ${MICROPY_PY_DIR}/formatfloat.c
     ${MICROPY_PY_DIR}/frozenmod.c
     ${MICROPY_PY_DIR}/gc.c
+    ${MICROPY_PY_DIR}/heapimage.c
+    ${MICROPY_PY_DIR}/jit.c
     ${MICROPY_PY_DIR}/lexer.c
     ${MICROPY_PY_DIR}/malloc.c
     ${MICROPY_PY_DIR}/map.c
@@ -54,6 +59,7 @@ set(MICROPY_SOURCE_PY
     ${MICROPY_PY_DIR}/nativeglue.c
     ${MICROPY_PY_DIR}/nlr.c
     ${MICROPY_PY_DIR}/nlrpowerpc.c
+    ${MICROPY_PY_DIR}/nlrrv32.c
     ${MICROPY_PY_DIR}/nlrsetjmp.c
     ${MICROPY_PY_DIR}/nlrthumb.c
     ${MICROPY_PY_DIR}/nlrx64.c
@@ -68,6 +74,7 @@ set(MICROPY_SOURCE_PY
     ${MICROPY_PY_DIR}/objclosure.c
     ${MICROPY_PY_DIR}/objcomplex.c
     ${MICROPY_PY_DIR}/objdeque.c
+    ${MICROPY_PY_DIR}/objintdict.c
     ${MICROPY_PY_DIR}/objdict.c
     ${MICROPY_PY_DIR}/objenumerate.c
     ${MICROPY_PY_DIR}/objexcept.c
@@ -119,8 +126,10 @@ set(MICROPY_SOURCE_PY
     ${MICROPY_PY_DIR}/smallint.c
     ${MICROPY_PY_DIR}/stackctrl.c
     ${MICROPY_PY_DIR}/stream.c
+    ${MICROPY_PY_DIR}/trace.c
     ${MICROPY_PY_DIR}/unicode.c
     ${MICROPY_PY_DIR}/vm.c
+    ${MICROPY_PY_DIR}/vmstats.c
     ${MICROPY_PY_DIR}/vstr.c
     ${MICROPY_PY_DIR}/warning.c
 )
@@ -60,9 +60,11 @@ PY_CORE_O_BASENAME = $(addprefix py/,\
 	nlraarch64.o \
 	nlrpowerpc.o \
 	nlrxtensa.o \
+	nlrrv32.o \
 	nlrsetjmp.o \
 	malloc.o \
 	gc.o \
+	heapimage.o \
 	pystack.o \
 	qstr.o \
 	vstr.o \
@@ -90,11 +92,17 @@ PY_CORE_O_BASENAME = $(addprefix py/,\
 	emitnxtensa.o \
 	emitinlinextensa.o \
 	emitnxtensawin.o \
+	asmrv32.o \
+	emitnrv32.o \
+	emitinlinerv32.o \
 	formatfloat.o \
 	parsenumbase.o \
 	parsenum.o \
 	emitglue.o \
 	persistentcode.o \
+	jit.o \
+	vmstats.o \
+	trace.o \
 	runtime.o \
 	runtime_utils.o \
 	scheduler.o \
@@ -115,6 +123,7 @@ PY_CORE_O_BASENAME = $(addprefix py/,\
 	objclosure.o \
 	objcomplex.o \
 	objdeque.o \
+	objintdict.o \
 	objdict.o \
 	objenumerate.o \
 	objexcept.o \
@@ -176,6 +185,7 @@ PY_EXTMOD_O_BASENAME = \
 	extmod/moduasyncio.o \
 	extmod/moductypes.o \
 	extmod/modujson.o \
+	extmod/moducbor.o \
 	extmod/modure.o \
 	extmod/moduzlib.o \
 	extmod/moduheapq.o \
@@ -188,16 +198,22 @@ PY_EXTMOD_O_BASENAME = \
 	extmod/machine_pinbase.o \
 	extmod/machine_signal.o \
 	extmod/machine_pulse.o \
+	extmod/machine_pingroup.o \
+	extmod/machine_i2s.o \
 	extmod/machine_i2c.o \
 	extmod/machine_spi.o \
+	extmod/machine_sdcard_spi.o \
 	extmod/modbluetooth.o \
 	extmod/modussl_axtls.o \
 	extmod/modussl_mbedtls.o \
 	extmod/modurandom.o \
 	extmod/moduselect.o \
+	extmod/modusocket_pool.o \
 	extmod/moduwebsocket.o \
 	extmod/modwebrepl.o \
 	extmod/modframebuf.o \
+	extmod/moddisplay.o \
+	extmod/modnrf24l01.o \
 	extmod/vfs.o \
 	extmod/vfs_blockdev.o \
 	extmod/vfs_reader.o \
@@ -207,6 +223,7 @@ PY_EXTMOD_O_BASENAME = \
 	extmod/vfs_fat_diskio.o \
 	extmod/vfs_fat_file.o \
 	extmod/vfs_lfs.o \
+	extmod/vfs_mmap.o \
 	extmod/utime_mphal.o \
 	extmod/uos_dupterm.o \
 	lib/embed/abort_.o \
@@ -73,6 +73,10 @@
     #error unimplemented qstr length decoding
 #endif
 
+#if MICROPY_QSTR_HASH_INDEX && MICROPY_QSTR_BYTES_IN_HASH < 2
+#error MICROPY_QSTR_HASH_INDEX requires MICROPY_QSTR_BYTES_IN_HASH >= 2
+#endif
+
 #if MICROPY_PY_THREAD && !MICROPY_PY_THREAD_GIL
 #define QSTR_ENTER() mp_thread_mutex_lock(&MP_STATE_VM(qstr_mutex), 1)
 #define QSTR_EXIT() mp_thread_mutex_unlock(&MP_STATE_VM(qstr_mutex))
@@ -125,6 +129,19 @@ void qstr_init(void) {
     MP_STATE_VM(last_pool) = (qstr_pool_t *)&CONST_POOL; // we won't modify the const_pool since it has no allocated room left
     MP_STATE_VM(qstr_last_chunk) = NULL;
 
+    #if MICROPY_QSTR_HASH_INDEX
+    MP_STATE_VM(qstr_index) = NULL;
+    #endif
+
+    #if MICROPY_QSTR_SNAPSHOT
+    MP_STATE_VM(qstr_snapshot) = NULL;
+    MP_STATE_VM(qstr_snapshot_pool) = NULL;
+    #endif
+
+    #if MICROPY_PY_INTERN_DECODED_KEYS
+    MP_STATE_VM(intern_key_count) = 0;
+    #endif
+
     #if MICROPY_PY_THREAD && !MICROPY_PY_THREAD_GIL
     mp_thread_mutex_init(&MP_STATE_VM(qstr_mutex));
     #endif
@@ -140,12 +157,59 @@ STATIC const byte *find_qstr(qstr q) {
     return pool->qstrs[q - pool->total_prev_len];
 }
 
+#if MICROPY_QSTR_HASH_INDEX
+
+// The mask is stored with the table so that a lookup in another thread always
+// sees a consistent pair.
+typedef struct _qstr_index_t {
+    size_t mask; // number of entries minus one
+    qstr table[];
+} qstr_index_t;
+
+STATIC void qstr_index_insert(qstr_index_t *index, const byte *q_ptr, qstr q) {
+    size_t h = Q_GET_HASH(q_ptr) & index->mask;
+    while (index->table[h] != 0) {
+        h = (h + 1) & index->mask;
+    }
+    index->table[h] = q;
+}
+
+// Make a new index that is less than half full.  If there's no memory for it
+// then lookups fall back to a linear search, and it's tried again when the
+// next pool is added.  The old index is left for the GC to free, in case a
+// lookup in another thread is still using it.
+STATIC void qstr_index_rebuild(void) {
+    size_t len = 16;
+    while (len <= 2 * QSTR_TOTAL()) {
+        len <<= 1;
+    }
+    qstr_index_t *index = m_new_obj_var_maybe(qstr_index_t, qstr, len);
+    MP_STATE_VM(qstr_index) = NULL;
+    if (index == NULL) {
+        return;
+    }
+    index->mask = len - 1;
+    memset(index->table, 0, len * sizeof(qstr));
+    for (qstr_pool_t *pool = MP_STATE_VM(last_pool); pool != NULL; pool = pool->prev) {
+        for (size_t i = 0; i < pool->len; ++i) {
+            qstr q = pool->total_prev_len + i;
+            if (q != MP_QSTRnull) {
+                qstr_index_insert(index, pool->qstrs[i], q);
+            }
+        }
+    }
+    MP_STATE_VM(qstr_index) = index;
+}
+
+#endif // MICROPY_QSTR_HASH_INDEX
+
 // qstr_mutex must be taken while in this function
 STATIC qstr qstr_add(const byte *q_ptr) {
     DEBUG_printf("QSTR: add hash=%d len=%d data=%.*s\n", Q_GET_HASH(q_ptr), Q_GET_LENGTH(q_ptr), Q_GET_LENGTH(q_ptr), Q_GET_DATA(q_ptr));
 
     // make sure we have room in the pool for a new qstr
-    if (MP_STATE_VM(last_pool)->len >= MP_STATE_VM(last_pool)->alloc) {
+    bool new_pool = MP_STATE_VM(last_pool)->len >= MP_STATE_VM(last_pool)->alloc;
+    if (new_pool) {
         size_t new_alloc = MP_STATE_VM(last_pool)->alloc * 2;
         #ifdef MICROPY_QSTR_EXTRA_POOL
         // Put a lower bound on the allocation size in case the extra qstr pool has few entries
@@ -166,17 +230,176 @@ STATIC qstr qstr_add(const byte *q_ptr) {
 
     // add the new qstr
     MP_STATE_VM(last_pool)->qstrs[MP_STATE_VM(last_pool)->len++] = q_ptr;
+    qstr q = MP_STATE_VM(last_pool)->total_prev_len + MP_STATE_VM(last_pool)->len - 1;
+
+    #if MICROPY_QSTR_HASH_INDEX
+    if (MP_STATE_VM(qstr_index) != NULL && 2 * QSTR_TOTAL() <= MP_STATE_VM(qstr_index)->mask + 1) {
+        qstr_index_insert(MP_STATE_VM(qstr_index), q_ptr, q);
+    } else if (MP_STATE_VM(qstr_index) != NULL || new_pool) {
+        qstr_index_rebuild();
+    }
+    #else
+    (void)new_pool;
+    #endif
 
     // return id for the newly-added qstr
-    return MP_STATE_VM(last_pool)->total_prev_len + MP_STATE_VM(last_pool)->len - 1;
+    return q;
+}
+
+#if MICROPY_QSTR_SNAPSHOT
+
+// A snapshot holds the qstrs that came after the const pools when it was made.
+// The header is followed by a hash index of those qstrs, and then by their
+// data in the same format as in a chunk.  The snapshot must be word aligned.
+typedef struct _qstr_snapshot_t {
+    uint32_t magic; // identifies the format and the qstr config
+    uint32_t const_check; // checksum of the const qstrs
+    uint32_t base; // number of const qstrs
+    uint32_t len; // number of qstrs in the snapshot
+    uint32_t index_mask; // number of index entries minus one
+    uint16_t index[]; // 1 + the qstr's position in the snapshot, or 0 if empty
+} qstr_snapshot_t;
+
+#define QSTR_SNAPSHOT_MAGIC (0x51530100 | MICROPY_QSTR_BYTES_IN_HASH << 4 | MICROPY_QSTR_BYTES_IN_LEN)
+
+STATIC size_t qstr_const_total(void) {
+    return CONST_POOL.total_prev_len + CONST_POOL.len;
+}
+
+// This only uses the stored hashes and lengths so is quick to compute.
+STATIC uint32_t qstr_const_check(void) {
+    uint32_t check = 0;
+    for (qstr q = 1; q < qstr_const_total(); ++q) {
+        const byte *qd = find_qstr(q);
+        check = (check << 5 | check >> 27) ^ (Q_GET_HASH(qd) + Q_GET_LENGTH(qd));
+    }
+    return check;
+}
+
+STATIC qstr qstr_snapshot_find(mp_uint_t str_hash, const char *str, size_t str_len) {
+    const qstr_snapshot_t *snap = MP_STATE_VM(qstr_snapshot);
+    const qstr_pool_t *pool = MP_STATE_VM(qstr_snapshot_pool);
+    // the index is at most half full so there is always an empty entry
+    for (size_t h = str_hash & snap->index_mask; snap->index[h] != 0; h = (h + 1) & snap->index_mask) {
+        const byte *q = pool->qstrs[snap->index[h] - 1];
+        if (Q_GET_HASH(q) == str_hash && Q_GET_LENGTH(q) == str_len && memcmp(Q_GET_DATA(q), str, str_len) == 0) {
+            return pool->total_prev_len + snap->index[h] - 1;
+        }
+    }
+    return 0;
+}
+
+// Make a snapshot of all qstrs that are not in the const pools.  Returns the
+// size of the snapshot, which is only written to dest if it fits in dest_len.
+size_t qstr_snapshot(byte *dest, size_t dest_len) {
+    QSTR_ENTER();
+    size_t base = qstr_const_total();
+    size_t n = MIN(QSTR_TOTAL() - base, 0xfffe);
+    size_t index_len = 1;
+    while (index_len < 2 * n) {
+        index_len <<= 1;
+    }
+    size_t size = sizeof(qstr_snapshot_t) + index_len * sizeof(uint16_t);
+    for (size_t i = 0; i < n; ++i) {
+        size += Q_GET_ALLOC(find_qstr(base + i));
+    }
+    if (dest != NULL && size <= dest_len) {
+        qstr_snapshot_t *snap = (qstr_snapshot_t *)dest;
+        snap->magic = QSTR_SNAPSHOT_MAGIC;
+        snap->const_check = qstr_const_check();
+        snap->base = base;
+        snap->len = n;
+        snap->index_mask = index_len - 1;
+        memset(snap->index, 0, index_len * sizeof(uint16_t));
+        byte *p = (byte *)&snap->index[index_len];
+        for (size_t i = 0; i < n; ++i) {
+            const byte *qd = find_qstr(base + i);
+            size_t h = Q_GET_HASH(qd) & snap->index_mask;
+            while (snap->index[h] != 0) {
+                h = (h + 1) & snap->index_mask;
+            }
+            snap->index[h] = i + 1;
+            memcpy(p, qd, Q_GET_ALLOC(qd));
+            p += Q_GET_ALLOC(qd);
+        }
+    }
+    QSTR_EXIT();
+    return size;
+}
+
+// Load a snapshot made by qstr_snapshot(), normally straight after qstr_init().
+// The qstr data is used in place so buf must stay valid, eg by being in flash.
+// Returns false if the snapshot doesn't match this firmware or qstrs were
+// already added.
+bool qstr_snapshot_load(const byte *buf, size_t len) {
+    const qstr_snapshot_t *snap = (const qstr_snapshot_t *)buf;
+    if (len < sizeof(qstr_snapshot_t)
+        || snap->magic != QSTR_SNAPSHOT_MAGIC
+        || snap->base != qstr_const_total()
+        || snap->len == 0
+        || snap->const_check != qstr_const_check()
+        || MP_STATE_VM(qstr_snapshot) != NULL
+        || QSTR_TOTAL() != snap->base) {
+        return false;
+    }
+    const byte *p = (const byte *)&snap->index[snap->index_mask + 1];
+    const byte *top = buf + len;
+    qstr_pool_t *pool = m_new_obj_var_maybe(qstr_pool_t, const char *, snap->len);
+    if (pool == NULL) {
+        return false;
+    }
+    for (size_t i = 0; i < snap->len; ++i) {
+        if (p + MICROPY_QSTR_BYTES_IN_HASH + MICROPY_QSTR_BYTES_IN_LEN > top || p + Q_GET_ALLOC(p) > top) {
+            m_del_var(qstr_pool_t, const char *, snap->len, pool);
+            return false;
+        }
+        pool->qstrs[i] = p;
+        p += Q_GET_ALLOC(p);
+    }
+    pool->prev = MP_STATE_VM(last_pool);
+    pool->total_prev_len = snap->base;
+    pool->alloc = snap->len;
+    pool->len = snap->len;
+    MP_STATE_VM(last_pool) = pool;
+    MP_STATE_VM(qstr_snapshot) = snap;
+    MP_STATE_VM(qstr_snapshot_pool) = pool;
+    #if MICROPY_QSTR_HASH_INDEX
+    qstr_index_rebuild();
+    #endif
+    return true;
 }
 
+#endif // MICROPY_QSTR_SNAPSHOT
+
 qstr qstr_find_strn(const char *str, size_t str_len) {
     // work out hash of str
     mp_uint_t str_hash = qstr_compute_hash((const byte *)str, str_len);
 
+    #if MICROPY_QSTR_HASH_INDEX
+    const qstr_index_t *index = MP_STATE_VM(qstr_index);
+    if (index != NULL) {
+        for (size_t h = str_hash & index->mask; index->table[h] != 0; h = (h + 1) & index->mask) {
+            const byte *q = find_qstr(index->table[h]);
+            if (Q_GET_HASH(q) == str_hash && Q_GET_LENGTH(q) == str_len && memcmp(Q_GET_DATA(q), str, str_len) == 0) {
+                return index->table[h];
+            }
+        }
+        return 0;
+    }
+    #endif
+
     // search pools for the data
     for (qstr_pool_t *pool = MP_STATE_VM(last_pool); pool != NULL; pool = pool->prev) {
+        #if MICROPY_QSTR_SNAPSHOT
+        if (pool == MP_STATE_VM(qstr_snapshot_pool)) {
+            // the snapshot has a hash index so doesn't need a linear search
+            qstr q = qstr_snapshot_find(str_hash, str, str_len);
+            if (q != 0) {
+                return q;
+            }
+            continue;
+        }
+        #endif
         for (const byte **q = pool->qstrs, **q_top = pool->qstrs + pool->len; q < q_top; q++) {
             if (Q_GET_HASH(*q) == str_hash && Q_GET_LENGTH(*q) == str_len && memcmp(Q_GET_DATA(*q), str, str_len) == 0) {
                 return pool->total_prev_len + (q - pool->qstrs);
@@ -192,8 +415,8 @@ qstr qstr_from_str(const char *str) {
     return qstr_from_strn(str, strlen(str));
 }
 
-qstr qstr_from_strn(const char *str, size_t len) {
-    QSTR_ENTER();
+// Must be called with the qstr lock held, which is released if this raises.
+STATIC qstr qstr_from_strn_locked(const char *str, size_t len) {
     qstr q = qstr_find_strn(str, len);
     if (q == 0) {
         // qstr does not exist in interned pool so need to add it
@@ -204,6 +427,9 @@ qstr qstr_from_strn(const char *str, size_t len) {
             mp_raise_msg(&mp_type_RuntimeError, MP_ERROR_TEXT("name too long"));
         }
 
+        // interned strings are never freed, so they can't be in an arena
+        bool arena_suspended = MP_GC_ARENA_SUSPEND(NULL);
+
         // compute number of bytes needed to intern this string
         size_t n_bytes = MICROPY_QSTR_BYTES_IN_HASH + MICROPY_QSTR_BYTES_IN_LEN + len + 1;
 
@@ -251,10 +477,30 @@ qstr qstr_from_strn(const char *str, size_t len) {
         memcpy(q_ptr + MICROPY_QSTR_BYTES_IN_HASH + MICROPY_QSTR_BYTES_IN_LEN, str, len);
         q_ptr[MICROPY_QSTR_BYTES_IN_HASH + MICROPY_QSTR_BYTES_IN_LEN + len] = '\0';
         q = qstr_add(q_ptr);
+        MP_GC_ARENA_RESUME(arena_suspended);
+    }
+    return q;
+}
+
+qstr qstr_from_strn(const char *str, size_t len) {
+    QSTR_ENTER();
+    qstr q = qstr_from_strn_locked(str, len);
+    QSTR_EXIT();
+    return q;
+}
+
+#if MICROPY_PY_INTERN_DECODED_KEYS
+qstr qstr_from_strn_limited(const char *str, size_t len, size_t *count, size_t limit) {
+    QSTR_ENTER();
+    qstr q = qstr_find_strn(str, len);
+    if (q == MP_QSTRnull && *count < limit) {
+        q = qstr_from_strn_locked(str, len);
+        *count += 1;
     }
     QSTR_EXIT();
     return q;
 }
+#endif
 
 mp_uint_t qstr_hash(qstr q) {
     const byte *qd = find_qstr(q);
@@ -64,12 +64,23 @@ qstr qstr_find_strn(const char *str, size_t str_len); // returns MP_QSTRnull if
 
 qstr qstr_from_str(const char *str);
 qstr qstr_from_strn(const char *str, size_t len);
+#if MICROPY_PY_INTERN_DECODED_KEYS
+// Like qstr_from_strn, but a new qstr is only made if *count is below limit,
+// and then *count is incremented, with the qstr lock held.  Returns
+// MP_QSTRnull if the qstr doesn't exist and the limit is reached.
+qstr qstr_from_strn_limited(const char *str, size_t len, size_t *count, size_t limit);
+#endif
 
 mp_uint_t qstr_hash(qstr q);
 const char *qstr_str(qstr q);
 size_t qstr_len(qstr q);
 const byte *qstr_data(qstr q, size_t *len);
 
+#if MICROPY_QSTR_SNAPSHOT
+size_t qstr_snapshot(byte *dest, size_t dest_len);
+bool qstr_snapshot_load(const byte *buf, size_t len);
+#endif
+
 void qstr_pool_info(size_t *n_pool, size_t *n_qstr, size_t *n_str_data_bytes, size_t *n_total_bytes);
 void qstr_dump_data(void);
 
@@ -48,6 +48,14 @@ STATIC mp_uint_t mp_reader_mem_readbyte(void *data) {
     }
 }
 
+STATIC size_t mp_reader_mem_readblock(void *data, const byte **buf) {
+    mp_reader_mem_t *reader = (mp_reader_mem_t *)data;
+    size_t len = reader->end - reader->cur;
+    *buf = reader->cur;
+    reader->cur = reader->end;
+    return len;
+}
+
 STATIC void mp_reader_mem_close(void *data) {
     mp_reader_mem_t *reader = (mp_reader_mem_t *)data;
     if (reader->free_len > 0) {
@@ -65,6 +73,7 @@ void mp_reader_new_mem(mp_reader_t *reader, const byte *buf, size_t len, size_t
     reader->data = rm;
     reader->readbyte = mp_reader_mem_readbyte;
     reader->close = mp_reader_mem_close;
+    reader->readblock = mp_reader_mem_readblock;
 }
 
 #if MICROPY_READER_POSIX
@@ -81,26 +90,45 @@ typedef struct _mp_reader_posix_t {
     byte buf[20];
 } mp_reader_posix_t;
 
-STATIC mp_uint_t mp_reader_posix_readbyte(void *data) {
-    mp_reader_posix_t *reader = (mp_reader_posix_t *)data;
+// Returns false at the end of the file.
+STATIC bool mp_reader_posix_fill(mp_reader_posix_t *reader) {
     if (reader->pos >= reader->len) {
         if (reader->len == 0) {
-            return MP_READER_EOF;
+            return false;
         } else {
             MP_THREAD_GIL_EXIT();
             int n = read(reader->fd, reader->buf, sizeof(reader->buf));
             MP_THREAD_GIL_ENTER();
             if (n <= 0) {
                 reader->len = 0;
-                return MP_READER_EOF;
+                return false;
             }
             reader->len = n;
             reader->pos = 0;
         }
     }
+    return true;
+}
+
+STATIC mp_uint_t mp_reader_posix_readbyte(void *data) {
+    mp_reader_posix_t *reader = (mp_reader_posix_t *)data;
+    if (!mp_reader_posix_fill(reader)) {
+        return MP_READER_EOF;
+    }
     return reader->buf[reader->pos++];
 }
 
+STATIC size_t mp_reader_posix_readblock(void *data, const byte **buf) {
+    mp_reader_posix_t *reader = (mp_reader_posix_t *)data;
+    if (!mp_reader_posix_fill(reader)) {
+        return 0;
+    }
+    size_t len = reader->len - reader->pos;
+    *buf = reader->buf + reader->pos;
+    reader->pos = reader->len;
+    return len;
+}
+
 STATIC void mp_reader_posix_close(void *data) {
     mp_reader_posix_t *reader = (mp_reader_posix_t *)data;
     if (reader->close_fd) {
@@ -130,6 +158,7 @@ void mp_reader_new_file_from_fd(mp_reader_t *reader, int fd, bool close_fd) {
     reader->data = rp;
     reader->readbyte = mp_reader_posix_readbyte;
     reader->close = mp_reader_posix_close;
+    reader->readblock = mp_reader_posix_readblock;
 }
 
 #if !MICROPY_VFS_POSIX
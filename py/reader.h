@@ -33,14 +33,20 @@
 // it can be called again after returning MP_READER_EOF, and in that case must return MP_READER_EOF
 #define MP_READER_EOF ((mp_uint_t)(-1))
 
+// the optional readblock function returns the number of bytes that are next in
+// the stream and stores a pointer to them in *buf, consuming them; they must
+// stay valid until the next call to the reader, and 0 is returned at the end
+// of the stream
 typedef struct _mp_reader_t {
     void *data;
     mp_uint_t (*readbyte)(void *data);
     void (*close)(void *data);
+    size_t (*readblock)(void *data, const byte **buf);
 } mp_reader_t;
 
 void mp_reader_new_mem(mp_reader_t *reader, const byte *buf, size_t len, size_t free_len);
 void mp_reader_new_file(mp_reader_t *reader, const char *filename);
 void mp_reader_new_file_from_fd(mp_reader_t *reader, int fd, bool close_fd);
+bool mp_reader_new_file_mapped(mp_reader_t *reader, const char *filename); // true if mapped into memory
 
 #endif // MICROPY_INCLUDED_PY_READER_H
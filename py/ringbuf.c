@@ -23,6 +23,8 @@
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
  * THE SOFTWARE.
  */
+#include <string.h>
+
 #include "ringbuf.h"
 
 int ringbuf_get16(ringbuf_t *r) {
@@ -30,10 +32,7 @@ int ringbuf_get16(ringbuf_t *r) {
     if (v == -1) {
         return v;
     }
-    r->iget += 2;
-    if (r->iget >= r->size) {
-        r->iget -= r->size;
-    }
+    ringbuf_drop(r, 2);
     return v;
 }
 
@@ -68,6 +67,79 @@ int ringbuf_put16(ringbuf_t *r, uint16_t v) {
     }
     r->buf[r->iput] = (v >> 8) & 0xff;
     r->buf[iput_a] = v & 0xff;
+    RINGBUF_BARRIER();
     r->iput = iput_b;
     return 0;
 }
+
+size_t ringbuf_peek_span(ringbuf_t *r, uint8_t **data) {
+    uint32_t iget = r->iget;
+    uint32_t iput = r->iput;
+    *data = &r->buf[iget];
+    return iput >= iget ? iput - iget : r->size - iget;
+}
+
+void ringbuf_drop(ringbuf_t *r, size_t len) {
+    uint32_t iget = r->iget + len;
+    if (iget >= r->size) {
+        iget -= r->size;
+    }
+    RINGBUF_BARRIER();
+    r->iget = iget;
+}
+
+size_t ringbuf_put_span(ringbuf_t *r, uint8_t **data) {
+    uint32_t iget = r->iget;
+    uint32_t iput = r->iput;
+    *data = &r->buf[iput];
+    if (iget > iput) {
+        return iget - iput - 1;
+    }
+    // the byte before iget is always left free
+    return r->size - iput - (iget == 0);
+}
+
+void ringbuf_put_commit(ringbuf_t *r, size_t len) {
+    uint32_t iput = r->iput + len;
+    if (iput >= r->size) {
+        iput -= r->size;
+    }
+    RINGBUF_BARRIER();
+    r->iput = iput;
+}
+
+size_t ringbuf_get_bytes(ringbuf_t *r, uint8_t *data, size_t len) {
+    size_t n = 0;
+    while (n < len) {
+        uint8_t *span;
+        size_t span_len = ringbuf_peek_span(r, &span);
+        if (span_len == 0) {
+            break;
+        }
+        if (span_len > len - n) {
+            span_len = len - n;
+        }
+        memcpy(data + n, span, span_len);
+        ringbuf_drop(r, span_len);
+        n += span_len;
+    }
+    return n;
+}
+
+size_t ringbuf_put_bytes(ringbuf_t *r, const uint8_t *data, size_t len) {
+    size_t n = 0;
+    while (n < len) {
+        uint8_t *span;
+        size_t span_len = ringbuf_put_span(r, &span);
+        if (span_len == 0) {
+            break;
+        }
+        if (span_len > len - n) {
+            span_len = len - n;
+        }
+        memcpy(span, data + n, span_len);
+        ringbuf_put_commit(r, span_len);
+        n += span_len;
+    }
+    return n;
+}
@@ -33,6 +33,20 @@
 #include "py/mpconfig.h" // For inline.
 #endif
 
+// A ring buffer is safe without locking when there is a single producer (for
+// example an ISR) calling the put functions and a single consumer calling the
+// get, peek and drop functions.  Only the producer writes iput and only the
+// consumer writes iget, each after the bytes it covers have been accessed.
+// This holds on single-core MCUs; with more cores or for several producers
+// or consumers the caller must still lock.
+
+// Keep the compiler from moving buffer accesses past an update of an index.
+#if defined(__GNUC__)
+#define RINGBUF_BARRIER() __atomic_signal_fence(__ATOMIC_SEQ_CST)
+#else
+#define RINGBUF_BARRIER()
+#endif
+
 typedef struct _ringbuf_t {
     uint8_t *buf;
     uint16_t size;
@@ -56,10 +70,13 @@ static inline int ringbuf_get(ringbuf_t *r) {
     if (r->iget == r->iput) {
         return -1;
     }
-    uint8_t v = r->buf[r->iget++];
-    if (r->iget >= r->size) {
-        r->iget = 0;
+    uint32_t iget_new = r->iget + 1;
+    if (iget_new >= r->size) {
+        iget_new = 0;
     }
+    uint8_t v = r->buf[r->iget];
+    RINGBUF_BARRIER();
+    r->iget = iget_new;
     return v;
 }
 
@@ -79,6 +96,7 @@ static inline int ringbuf_put(ringbuf_t *r, uint8_t v) {
         return -1;
     }
     r->buf[r->iput] = v;
+    RINGBUF_BARRIER();
     r->iput = iput_new;
     return 0;
 }
@@ -96,4 +114,19 @@ int ringbuf_get16(ringbuf_t *r);
 int ringbuf_peek16(ringbuf_t *r);
 int ringbuf_put16(ringbuf_t *r, uint16_t v);
 
+// Copy up to len bytes out of, or into, the buffer with at most two memcpy
+// calls, returning the number of bytes copied.
+size_t ringbuf_get_bytes(ringbuf_t *r, uint8_t *data, size_t len);
+size_t ringbuf_put_bytes(ringbuf_t *r, const uint8_t *data, size_t len);
+
+// Zero-copy access.  ringbuf_peek_span sets *data to the next bytes to get
+// and returns how many can be read there before the buffer wraps around, and
+// ringbuf_drop then releases len of them.  ringbuf_put_span similarly returns
+// the free bytes at *data that can be filled in place, and ringbuf_put_commit
+// makes len of them available to the consumer.
+size_t ringbuf_peek_span(ringbuf_t *r, uint8_t **data);
+void ringbuf_drop(ringbuf_t *r, size_t len);
+size_t ringbuf_put_span(ringbuf_t *r, uint8_t **data);
+void ringbuf_put_commit(ringbuf_t *r, size_t len);
+
 #endif // MICROPY_INCLUDED_PY_RINGBUF_H
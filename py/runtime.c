@@ -43,6 +43,7 @@
 #include "py/builtin.h"
 #include "py/stackctrl.h"
 #include "py/gc.h"
+#include "py/vmstats.h"
 
 #if MICROPY_DEBUG_VERBOSE // print debugging info
 #define DEBUG_PRINT (1)
@@ -53,10 +54,12 @@
 #define DEBUG_OP_printf(...) (void)0
 #endif
 
+#if !MICROPY_MULTIPLE_INSTANCES
 const mp_obj_module_t mp_module___main__ = {
     .base = { &mp_type_module },
     .globals = (mp_obj_dict_t *)&MP_STATE_VM(dict_main),
 };
+#endif
 
 void mp_init(void) {
     qstr_init();
@@ -67,6 +70,12 @@ void mp_init(void) {
     MP_STATE_VM(sched_state) = MP_SCHED_IDLE;
     MP_STATE_VM(sched_idx) = 0;
     MP_STATE_VM(sched_len) = 0;
+    #if MICROPY_SCHEDULER_EVENT_DEPTH
+    MP_STATE_VM(sched_event_head) = 0;
+    MP_STATE_VM(sched_event_tail) = 0;
+    MP_STATE_VM(sched_event_coalesced) = 0;
+    MP_STATE_VM(sched_event_overflow) = 0;
+    #endif
     #endif
 
     #if MICROPY_ENABLE_EMERGENCY_EXCEPTION_BUF
@@ -82,9 +91,22 @@ void mp_init(void) {
     MP_STATE_VM(mp_kbd_exception).args = (mp_obj_tuple_t *)&mp_const_empty_tuple_obj;
     #endif
 
+    #if MICROPY_OPT_LOAD_METHOD_CACHE
+    // no methods are cached, version 0 is never current
+    MP_STATE_VM(type_version) = 1;
+    memset(MP_STATE_VM(method_cache), 0, sizeof(MP_STATE_VM(method_cache)));
+    #endif
+
+    #if MICROPY_OPT_BOUND_METH_CACHE
+    memset(MP_STATE_VM(bound_meth_cache), 0, sizeof(MP_STATE_VM(bound_meth_cache)));
+    #endif
+
     #if MICROPY_ENABLE_COMPILER
     // optimization disabled by default
     MP_STATE_VM(mp_optimise_value) = 0;
+    #if MICROPY_MODULE_MPY_CACHE
+    MP_STATE_VM(mpy_cache) = false;
+    #endif
     #if MICROPY_EMIT_NATIVE
     MP_STATE_VM(default_emit_opt) = MP_EMIT_OPT_NONE;
     #endif
@@ -96,6 +118,11 @@ void mp_init(void) {
     // initialise the __main__ module
     mp_obj_dict_init(&MP_STATE_VM(dict_main), 1);
     mp_obj_dict_store(MP_OBJ_FROM_PTR(&MP_STATE_VM(dict_main)), MP_OBJ_NEW_QSTR(MP_QSTR___name__), MP_OBJ_NEW_QSTR(MP_QSTR___main__));
+    #if MICROPY_MULTIPLE_INSTANCES
+    MP_STATE_VM(module_main).base.type = &mp_type_module;
+    MP_STATE_VM(module_main).globals = &MP_STATE_VM(dict_main);
+    mp_module_register(MP_QSTR___main__, MP_OBJ_FROM_PTR(&mp_module___main__));
+    #endif
 
     // locals = globals for outer module (see Objects/frameobject.c/PyFrame_New())
     mp_locals_set(&MP_STATE_VM(dict_main));
@@ -110,6 +137,10 @@ void mp_init(void) {
     MP_STATE_VM(track_reloc_code_list) = MP_OBJ_NULL;
     #endif
 
+    #if MICROPY_COMP_CONST_IMPORT
+    MP_STATE_VM(parse_const_modules) = NULL;
+    #endif
+
     #if MICROPY_PY_OS_DUPTERM
     for (size_t i = 0; i < MICROPY_PY_OS_DUPTERM; ++i) {
         MP_STATE_VM(dupterm_objs[i]) = MP_OBJ_NULL;
@@ -120,6 +151,9 @@ void mp_init(void) {
     // initialise the VFS sub-system
     MP_STATE_VM(vfs_cur) = NULL;
     MP_STATE_VM(vfs_mount_table) = NULL;
+    #if MICROPY_VFS_IMPORT_STAT_CACHE
+    memset(MP_STATE_VM(vfs_import_stat_cache), 0, sizeof(MP_STATE_VM(vfs_import_stat_cache)));
+    #endif
     #endif
 
     #if MICROPY_PY_SYS_ATEXIT
@@ -129,9 +163,27 @@ void mp_init(void) {
     #if MICROPY_PY_SYS_SETTRACE
     MP_STATE_THREAD(prof_trace_callback) = MP_OBJ_NULL;
     MP_STATE_THREAD(prof_callback_is_executing) = false;
+    #endif
+
+    #if MICROPY_TRACK_CODE_STATE
     MP_STATE_THREAD(current_code_state) = NULL;
     #endif
 
+    #if MICROPY_VM_OPCODE_STATS
+    mp_vm_stats_reset();
+    #endif
+
+    #if MICROPY_VM_BUDGET
+    mp_vm_budget_set(0, MP_OBJ_NULL, NULL);
+    #endif
+
+    #if MICROPY_SAMPLING_PROFILE
+    // samples from before a soft reset refer to the old heap
+    MP_STATE_VM(prof_sample_running) = false;
+    memset(MP_STATE_VM(prof_sample), 0, sizeof(MP_STATE_VM(prof_sample)));
+    MP_STATE_VM(prof_sample_dropped) = 0;
+    #endif
+
     #if MICROPY_PY_BLUETOOTH
     MP_STATE_VM(bluetooth) = MP_OBJ_NULL;
     #endif
@@ -157,7 +209,7 @@ void mp_deinit(void) {
     #endif
 }
 
-mp_obj_t mp_load_name(qstr qst) {
+mp_obj_t MICROPY_WRAP_MP_LOAD_NAME(mp_load_name)(qstr qst) {
     // logic: search locals, globals, builtins
     DEBUG_OP_printf("load name %s\n", qstr_str(qst));
     // If we're at the outer scope (locals == globals), dispatch to load_global right away
@@ -170,7 +222,7 @@ mp_obj_t mp_load_name(qstr qst) {
     return mp_load_global(qst);
 }
 
-mp_obj_t mp_load_global(qstr qst) {
+mp_obj_t MICROPY_WRAP_MP_LOAD_GLOBAL(mp_load_global)(qstr qst) {
     // logic: search globals, builtins
     DEBUG_OP_printf("load global %s\n", qstr_str(qst));
     mp_map_elem_t *elem = mp_map_lookup(&mp_globals_get()->map, MP_OBJ_NEW_QSTR(qst), MP_MAP_LOOKUP);
@@ -305,9 +357,13 @@ mp_obj_t mp_unary_op(mp_unary_op_t op, mp_obj_t arg) {
     }
 }
 
-mp_obj_t mp_binary_op(mp_binary_op_t op, mp_obj_t lhs, mp_obj_t rhs) {
+mp_obj_t MICROPY_WRAP_MP_BINARY_OP(mp_binary_op)(mp_binary_op_t op, mp_obj_t lhs, mp_obj_t rhs) {
     DEBUG_OP_printf("binary " UINT_FMT " %q %p %p\n", op, mp_binary_op_method_name[op], lhs, rhs);
 
+    #if MICROPY_VM_OPCODE_STATS
+    mp_vm_stats_binary_op(op, lhs, rhs);
+    #endif
+
     // TODO correctly distinguish inplace operators for mutable objects
     // lookup logic that CPython uses for +=:
     //   check for implemented +=
@@ -1282,13 +1338,18 @@ mp_vm_return_kind_t mp_resume(mp_obj_t self_in, mp_obj_t send_value, mp_obj_t th
     }
 
     if (type->iternext != NULL && send_value == mp_const_none) {
+        MP_STATE_THREAD(stop_iteration_arg) = MP_OBJ_NULL;
         mp_obj_t ret = type->iternext(self_in);
         *ret_val = ret;
         if (ret != MP_OBJ_STOP_ITERATION) {
             return MP_VM_RETURN_YIELD;
         } else {
-            // Emulate raise StopIteration()
-            // Special case, handled in vm.c
+            // Emulate raise StopIteration(), with the value passed to
+            // mp_make_stop_iteration() if there was one
+            if (MP_STATE_THREAD(stop_iteration_arg) != MP_OBJ_NULL) {
+                *ret_val = MP_STATE_THREAD(stop_iteration_arg);
+                MP_STATE_THREAD(stop_iteration_arg) = MP_OBJ_NULL;
+            }
             return MP_VM_RETURN_NORMAL;
         }
     }
@@ -1396,7 +1457,13 @@ mp_obj_t mp_import_from(mp_obj_t module, qstr name) {
 
     mp_obj_t dest[2];
 
+    #if MICROPY_MODULE_GETATTR
+    // A module's __getattr__ raises AttributeError for the names it doesn't
+    // provide, which in a package may still be submodules to import below.
+    mp_load_method_protected(module, name, dest, false);
+    #else
     mp_load_method_maybe(module, name, dest);
+    #endif
 
     if (dest[1] != MP_OBJ_NULL) {
         // Hopefully we can't import bound method from an object
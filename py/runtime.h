@@ -72,10 +72,27 @@ void mp_handle_pending_tail(mp_uint_t atomic_state);
 #if MICROPY_ENABLE_SCHEDULER
 void mp_sched_lock(void);
 void mp_sched_unlock(void);
+#if MICROPY_SCHEDULER_EVENT_DEPTH
+#define mp_sched_num_events() ((uint8_t)(MP_STATE_VM(sched_event_head) - MP_STATE_VM(sched_event_tail)))
+#define mp_sched_num_pending() (MP_STATE_VM(sched_len) + mp_sched_num_events())
+bool mp_sched_event(mp_obj_t function, mp_obj_t arg, mp_int_t value);
+#else
 #define mp_sched_num_pending() (MP_STATE_VM(sched_len))
+#endif
 bool mp_sched_schedule(mp_obj_t function, mp_obj_t arg);
 #endif
 
+#if MICROPY_VM_BUDGET
+// When the budget of ticks expires the handler is called, if there is one.  It
+// can return true to let the script go on, after setting a new budget, or
+// false to raise exc (or RuntimeError if exc is MP_OBJ_NULL) in the script.
+void mp_vm_budget_set(mp_int_t ticks, mp_obj_t exc, bool (*handler)(void));
+static inline mp_int_t mp_vm_budget_get(void) {
+    return MP_STATE_VM(vm_budget);
+}
+mp_obj_t mp_vm_budget_expired(void);
+#endif
+
 // extra printing method specifically for mp_obj_t's which are integral type
 int mp_print_mp_int(const mp_print_t *print, mp_obj_t x, int base, int base_char, int flags, char fill, int width, int prec);
 
@@ -88,6 +105,17 @@ void mp_arg_parse_all_kw_array(size_t n_pos, size_t n_kw, const mp_obj_t *args,
 NORETURN void mp_arg_error_terse_mismatch(void);
 NORETURN void mp_arg_error_unimpl_kw(void);
 
+#if MICROPY_OPT_ARG_SLOT_CACHE
+// Return the cache entry for a keyword argument called name, given to a
+// function whose parameter names are in table.  The entry holds the index of
+// the parameter last found with that name, or anything else, so it must be
+// checked against the table before it's used.
+static inline uint8_t *mp_arg_slot_cache(const void *table, mp_obj_t name) {
+    size_t hash = ((uintptr_t)table ^ (uintptr_t)name) >> 3;
+    return &MP_STATE_VM(arg_slot_cache)[hash & (MICROPY_OPT_ARG_SLOT_CACHE_SIZE - 1)];
+}
+#endif
+
 static inline mp_obj_dict_t *mp_locals_get(void) {
     return MP_STATE_THREAD(dict_locals);
 }
@@ -154,6 +182,13 @@ mp_obj_t mp_iternext_allow_raise(mp_obj_t o); // may return MP_OBJ_STOP_ITERATIO
 mp_obj_t mp_iternext(mp_obj_t o); // will always return MP_OBJ_STOP_ITERATION instead of raising StopIteration(...)
 mp_vm_return_kind_t mp_resume(mp_obj_t self_in, mp_obj_t send_value, mp_obj_t throw_value, mp_obj_t *ret_val);
 
+// For an iternext function to finish with a value, like raising StopIteration(o)
+// but without creating the exception.  Only mp_resume() reads the value back.
+static inline mp_obj_t mp_make_stop_iteration(mp_obj_t o) {
+    MP_STATE_THREAD(stop_iteration_arg) = o;
+    return MP_OBJ_STOP_ITERATION;
+}
+
 mp_obj_t mp_make_raise_obj(mp_obj_t o);
 
 mp_obj_t mp_import_name(qstr name, mp_obj_t fromlist, mp_obj_t level);
@@ -49,6 +49,9 @@
 #define MP_NATIVE_TYPE_PTR8 (0x05)
 #define MP_NATIVE_TYPE_PTR16 (0x06)
 #define MP_NATIVE_TYPE_PTR32 (0x07)
+#define MP_NATIVE_TYPE_PTR32F (0x08)
+// Not a viper type: converts a float to and from the bits of a 32-bit float
+#define MP_NATIVE_TYPE_FLOAT32 (0x09)
 
 // Bytecode and runtime boundaries for unary ops
 #define MP_UNARY_OP_NUM_BYTECODE    (MP_UNARY_OP_NOT + 1)
@@ -27,6 +27,10 @@
 #include <stdio.h>
 
 #include "py/runtime.h"
+#include "py/gc.h"
+#include "py/mphal.h"
+#include "py/smallint.h"
+#include "py/trace.h"
 
 void MICROPY_WRAP_MP_SCHED_EXCEPTION(mp_sched_exception)(mp_obj_t exc) {
     MP_STATE_VM(mp_pending_exception) = exc;
@@ -45,23 +49,79 @@ void MICROPY_WRAP_MP_SCHED_KEYBOARD_INTERRUPT(mp_sched_keyboard_interrupt)(void)
 }
 #endif
 
+#if MICROPY_VM_BUDGET
+void mp_vm_budget_set(mp_int_t ticks, mp_obj_t exc, bool (*handler)(void)) {
+    MP_STATE_VM(vm_budget) = ticks > 0 ? ticks : 0;
+    MP_STATE_VM(vm_budget_exc) = exc;
+    MP_STATE_VM(vm_budget_handler) = handler;
+}
+
+// Called by the VM when the budget reaches 0.  Returns the exception to raise,
+// or MP_OBJ_NULL to carry on.
+mp_obj_t mp_vm_budget_expired(void) {
+    bool (*handler)(void) = MP_STATE_VM(vm_budget_handler);
+    if (handler != NULL && handler()) {
+        return MP_OBJ_NULL;
+    }
+    // The exception is raised once; a handler that wants the script stopped
+    // even if it catches the exception can set MP_STATE_VM(vm_budget) to 1
+    // before returning, to be called again on the next tick.
+    mp_obj_t exc = MP_STATE_VM(vm_budget_exc);
+    if (exc == MP_OBJ_NULL) {
+        return mp_obj_new_exception_msg(&mp_type_RuntimeError, MP_ERROR_TEXT("VM budget exceeded"));
+    }
+    return mp_make_raise_obj(exc);
+}
+#endif
+
 #if MICROPY_ENABLE_SCHEDULER
 
 #define IDX_MASK(i) ((i) & (MICROPY_SCHEDULER_DEPTH - 1))
 
 // This is a macro so it is guaranteed to be inlined in functions like
 // mp_sched_schedule that may be located in a special memory region.
-#define mp_sched_full() (mp_sched_num_pending() == MICROPY_SCHEDULER_DEPTH)
+#define mp_sched_full() (MP_STATE_VM(sched_len) == MICROPY_SCHEDULER_DEPTH)
 
 static inline bool mp_sched_empty(void) {
     MP_STATIC_ASSERT(MICROPY_SCHEDULER_DEPTH <= 255); // MICROPY_SCHEDULER_DEPTH must fit in 8 bits
     MP_STATIC_ASSERT((IDX_MASK(MICROPY_SCHEDULER_DEPTH) == 0)); // MICROPY_SCHEDULER_DEPTH must be a power of 2
 
-    return mp_sched_num_pending() == 0;
+    return MP_STATE_VM(sched_len) == 0;
 }
 
+#if MICROPY_SCHEDULER_EVENT_DEPTH
+
+#define EVENT_IDX_MASK(i) ((i) & (MICROPY_SCHEDULER_EVENT_DEPTH - 1))
+
+// Call an event's handler as handler(arg, value, ticks_us, count), printing any
+// exception.  The arguments are only converted to objects here, so an event is
+// queued without touching the heap.
+STATIC void mp_sched_event_dispatch(const mp_sched_event_t *event) {
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        mp_obj_t args[4] = {
+            event->arg,
+            mp_obj_new_int(event->value),
+            MP_OBJ_NEW_SMALL_INT(event->ticks_us),
+            mp_obj_new_int_from_uint(event->count),
+        };
+        mp_call_function_n_kw(event->func, 4, 0, args);
+        nlr_pop();
+    } else {
+        mp_obj_print_exception(&mp_plat_print, MP_OBJ_FROM_PTR(nlr.ret_val));
+    }
+}
+
+#endif
+
 // A variant of this is inlined in the VM at the pending exception check
 void mp_handle_pending(bool raise_exc) {
+    #if MICROPY_GC_INCREMENTAL
+    // use this opportunity to make progress on an incremental collection
+    if (gc_collect_in_progress() && !gc_is_locked()) {
+        gc_collect_step(MICROPY_GC_INCREMENTAL_STEP_US);
+    }
+    #endif
     if (MP_STATE_VM(sched_state) == MP_SCHED_PENDING) {
         mp_uint_t atomic_state = MICROPY_BEGIN_ATOMIC_SECTION();
         // Re-check state is still pending now that we're in the atomic section.
@@ -93,7 +153,21 @@ void mp_handle_pending_tail(mp_uint_t atomic_state) {
         MP_STATE_VM(sched_idx) = IDX_MASK(MP_STATE_VM(sched_idx) + 1);
         --MP_STATE_VM(sched_len);
         MICROPY_END_ATOMIC_SECTION(atomic_state);
+        MP_TRACE(MP_TRACE_EVENT_SCHED_START, 0);
         mp_call_function_1_protected(item.func, item.arg);
+        MP_TRACE(MP_TRACE_EVENT_SCHED_END, 0);
+    #if MICROPY_SCHEDULER_EVENT_DEPTH
+    } else if (mp_sched_num_events()) {
+        uint8_t tail = MP_STATE_VM(sched_event_tail);
+        mp_sched_event_t event = MP_STATE_VM(sched_event_ring)[EVENT_IDX_MASK(tail)];
+        // The entry must be copied out before the producer can reuse it.
+        __sync_synchronize();
+        MP_STATE_VM(sched_event_tail) = tail + 1;
+        MICROPY_END_ATOMIC_SECTION(atomic_state);
+        MP_TRACE(MP_TRACE_EVENT_SCHED_START, 1);
+        mp_sched_event_dispatch(&event);
+        MP_TRACE(MP_TRACE_EVENT_SCHED_END, 0);
+    #endif
     } else {
         MICROPY_END_ATOMIC_SECTION(atomic_state);
     }
@@ -144,10 +218,53 @@ bool MICROPY_WRAP_MP_SCHED_SCHEDULE(mp_sched_schedule)(mp_obj_t function, mp_obj
     return ret;
 }
 
+#if MICROPY_SCHEDULER_EVENT_DEPTH
+// Queue a call to function(arg, value, ticks_us, count) in the event ring, with
+// the current time as the timestamp.  This does not allocate or take a lock so
+// it can be called from a hard IRQ, but there must only be one producer at a
+// time (eg events are queued from a single interrupt priority level).
+//
+// If the ring is full the event is coalesced: it is counted, and folded into
+// the count of the next event that is queued.  Returns false in that case.
+bool MICROPY_WRAP_MP_SCHED_EVENT(mp_sched_event)(mp_obj_t function, mp_obj_t arg, mp_int_t value) {
+    MP_STATIC_ASSERT(MICROPY_SCHEDULER_EVENT_DEPTH <= 128); // indices must wrap in 8 bits
+    MP_STATIC_ASSERT((EVENT_IDX_MASK(MICROPY_SCHEDULER_EVENT_DEPTH) == 0)); // MICROPY_SCHEDULER_EVENT_DEPTH must be a power of 2
+
+    mp_uint_t ticks_us = mp_hal_ticks_us() & (MICROPY_PY_UTIME_TICKS_PERIOD - 1);
+    uint8_t head = MP_STATE_VM(sched_event_head);
+    if (mp_sched_num_events() == MICROPY_SCHEDULER_EVENT_DEPTH) {
+        ++MP_STATE_VM(sched_event_coalesced);
+        ++MP_STATE_VM(sched_event_overflow);
+        return false;
+    }
+    mp_sched_event_t *event = &MP_STATE_VM(sched_event_ring)[EVENT_IDX_MASK(head)];
+    event->func = function;
+    event->arg = arg;
+    event->value = value;
+    event->ticks_us = ticks_us;
+    event->count = 1 + MP_STATE_VM(sched_event_coalesced);
+    MP_STATE_VM(sched_event_coalesced) = 0;
+    // The entry must be complete before the consumer can see it.
+    __sync_synchronize();
+    MP_STATE_VM(sched_event_head) = head + 1;
+    if (MP_STATE_VM(sched_state) == MP_SCHED_IDLE) {
+        MP_STATE_VM(sched_state) = MP_SCHED_PENDING;
+    }
+    MICROPY_SCHED_HOOK_SCHEDULED;
+    return true;
+}
+#endif
+
 #else // MICROPY_ENABLE_SCHEDULER
 
 // A variant of this is inlined in the VM at the pending exception check
 void mp_handle_pending(bool raise_exc) {
+    #if MICROPY_GC_INCREMENTAL
+    // use this opportunity to make progress on an incremental collection
+    if (gc_collect_in_progress() && !gc_is_locked()) {
+        gc_collect_step(MICROPY_GC_INCREMENTAL_STEP_US);
+    }
+    #endif
     if (MP_STATE_VM(mp_pending_exception) != MP_OBJ_NULL) {
         mp_obj_t obj = MP_STATE_VM(mp_pending_exception);
         MP_STATE_VM(mp_pending_exception) = MP_OBJ_NULL;
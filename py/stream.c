@@ -394,6 +394,51 @@ STATIC mp_obj_t stream_unbuffered_readline(size_t n_args, const mp_obj_t *args)
 }
 MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp_stream_unbuffered_readline_obj, 1, 2, stream_unbuffered_readline);
 
+#if MICROPY_STREAMS_READLINE_INTO
+// Like readline() but store the line in the given buffer, which can be a
+// memoryview slice, so no heap allocation is needed.  Reading stops after a
+// newline, at EOF, or when the buffer (or nbytes, if given) is full.
+STATIC mp_obj_t stream_unbuffered_readline_into(size_t n_args, const mp_obj_t *args) {
+    const mp_stream_p_t *stream_p = mp_get_stream(args[0]);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[1], &bufinfo, MP_BUFFER_WRITE);
+
+    size_t len = bufinfo.len;
+    if (n_args > 2) {
+        mp_int_t max_size = mp_obj_get_int(args[2]);
+        if (max_size >= 0 && (size_t)max_size < len) {
+            len = max_size;
+        }
+    }
+
+    byte *p = bufinfo.buf;
+    size_t n = 0;
+    while (n < len) {
+        int error;
+        mp_uint_t out_sz = stream_p->read(args[0], p + n, 1, &error);
+        if (out_sz == MP_STREAM_ERROR) {
+            if (mp_is_nonblocking_error(error)) {
+                // Same as readline(): None if nothing was read at all
+                if (n == 0) {
+                    return mp_const_none;
+                }
+                break;
+            }
+            mp_raise_OSError(error);
+        }
+        if (out_sz == 0) {
+            break;
+        }
+        if (p[n++] == '\n') {
+            break;
+        }
+    }
+
+    return MP_OBJ_NEW_SMALL_INT(n);
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp_stream_unbuffered_readline_into_obj, 2, 3, stream_unbuffered_readline_into);
+#endif
+
 // TODO take an optional extra argument (what does it do exactly?)
 STATIC mp_obj_t stream_unbuffered_readlines(mp_obj_t self) {
     mp_obj_t lines = mp_obj_new_list(0, NULL);
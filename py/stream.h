@@ -43,6 +43,8 @@
 #define MP_STREAM_GET_DATA_OPTS (8)  // Get data/message options
 #define MP_STREAM_SET_DATA_OPTS (9)  // Set data/message options
 #define MP_STREAM_GET_FILENO    (10) // Get fileno of underlying file
+#define MP_STREAM_MMAP          (11) // Map part of a file read-only into memory
+#define MP_STREAM_MUNMAP        (12) // Release a mapping made by MP_STREAM_MMAP
 
 // These poll ioctl values are compatible with Linux
 #define MP_STREAM_POLL_RD       (0x0001)
@@ -60,6 +62,18 @@ struct mp_stream_seek_t {
     int whence;
 };
 
+// Argument structure for MP_STREAM_MMAP and MP_STREAM_MUNMAP
+struct mp_stream_mmap_t {
+    // Range of the file to map, set by the caller; it lies within the file.
+    mp_off_t offset;
+    size_t len;
+    // Address of the mapped range, set by MP_STREAM_MMAP.
+    const byte *addr;
+    // Set by MP_STREAM_MMAP if the mapping must be released with MP_STREAM_MUNMAP.
+    void *map_base;
+    size_t map_len;
+};
+
 // seek ioctl "whence" values
 #define MP_SEEK_SET (0)
 #define MP_SEEK_CUR (1)
@@ -79,6 +93,7 @@ MP_DECLARE_CONST_FUN_OBJ_VAR_BETWEEN(mp_stream_read_obj);
 MP_DECLARE_CONST_FUN_OBJ_VAR_BETWEEN(mp_stream_read1_obj);
 MP_DECLARE_CONST_FUN_OBJ_VAR_BETWEEN(mp_stream_readinto_obj);
 MP_DECLARE_CONST_FUN_OBJ_VAR_BETWEEN(mp_stream_unbuffered_readline_obj);
+MP_DECLARE_CONST_FUN_OBJ_VAR_BETWEEN(mp_stream_unbuffered_readline_into_obj);
 MP_DECLARE_CONST_FUN_OBJ_1(mp_stream_unbuffered_readlines_obj);
 MP_DECLARE_CONST_FUN_OBJ_VAR_BETWEEN(mp_stream_write_obj);
 MP_DECLARE_CONST_FUN_OBJ_2(mp_stream_write1_obj);
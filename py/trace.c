@@ -0,0 +1,86 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "py/mphal.h"
+#include "py/trace.h"
+
+#if MICROPY_TRACE
+
+// The dump of the ring is a header followed by the events, oldest first, all
+// little-endian:
+//
+//     header: "MPTR" <format version: u8> <event size: u8> <events: u16>
+//             <events recorded since the last reset: u32>
+//     event: <time in us: u32> <event: u16> <arg: u16>
+//
+// Fewer events than were recorded means the oldest were overwritten.
+
+#define TRACE_FORMAT_VERSION (1)
+
+void mp_trace_record(uint16_t event, uint16_t arg) {
+    // Claiming a slot with an atomic increment lets interrupts and other
+    // threads record events at the same time without a lock.
+    uint32_t i = MICROPY_TRACE_ATOMIC_INC(&MP_STATE_VM(trace_count));
+    mp_trace_entry_t *entry = &MP_STATE_VM(trace_ring)[i & (MICROPY_TRACE_SIZE - 1)];
+    entry->time = MICROPY_TRACE_TIME();
+    entry->event = event;
+    entry->arg = arg;
+}
+
+STATIC void trace_add_u16(vstr_t *vstr, uint16_t val) {
+    byte *buf = (byte *)vstr_add_len(vstr, 2);
+    buf[0] = val;
+    buf[1] = val >> 8;
+}
+
+STATIC void trace_add_u32(vstr_t *vstr, uint32_t val) {
+    trace_add_u16(vstr, val);
+    trace_add_u16(vstr, val >> 16);
+}
+
+void mp_trace_dump(vstr_t *vstr) {
+    uint32_t count = MP_STATE_VM(trace_count);
+    size_t len = MIN(count, MICROPY_TRACE_SIZE);
+    vstr_add_strn(vstr, "MPTR", 4);
+    vstr_add_byte(vstr, TRACE_FORMAT_VERSION);
+    vstr_add_byte(vstr, 8);
+    trace_add_u16(vstr, len);
+    trace_add_u32(vstr, count);
+    for (uint32_t i = count - len; i != count; ++i) {
+        const mp_trace_entry_t *entry = &MP_STATE_VM(trace_ring)[i & (MICROPY_TRACE_SIZE - 1)];
+        trace_add_u32(vstr, entry->time);
+        trace_add_u16(vstr, entry->event);
+        trace_add_u16(vstr, entry->arg);
+    }
+}
+
+void mp_trace_reset(void) {
+    MP_STATE_VM(trace_count) = 0;
+}
+
+#endif // MICROPY_TRACE
@@ -0,0 +1,80 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef MICROPY_INCLUDED_PY_TRACE_H
+#define MICROPY_INCLUDED_PY_TRACE_H
+
+#include "py/mpstate.h"
+
+#if MICROPY_TRACE
+
+// The events of the trace ring, and the meaning of their argument.  The
+// values are part of the format read by tools/mptrace.py, so new events are
+// added at the end.
+typedef enum {
+    MP_TRACE_EVENT_NONE,
+    MP_TRACE_EVENT_GC_START, // 1 for a new collection, 0 for a further step of one
+    MP_TRACE_EVENT_GC_END, // 1 if the collection finished, 0 if it continues later
+    MP_TRACE_EVENT_SCHED_START, // 0 for a scheduled function, 1 for a scheduled event
+    MP_TRACE_EVENT_SCHED_END, // 0
+    MP_TRACE_EVENT_IRQ, // 1 for a hard IRQ, 0 for one that schedules its handler
+    MP_TRACE_EVENT_SOCKET, // one of mp_trace_socket_t
+    MP_TRACE_EVENT_TASK, // bits 3 to 18 of the address of the task that runs next
+    MP_TRACE_EVENT_MARK, // the argument of micropython.trace_mark
+    MP_TRACE_EVENT_PORT = 0x100, // the first of the events a port may define
+} mp_trace_event_t;
+
+typedef enum {
+    MP_TRACE_SOCKET_RECV = 1,
+    MP_TRACE_SOCKET_ACCEPT,
+    MP_TRACE_SOCKET_CONNECTED,
+    MP_TRACE_SOCKET_ERROR,
+} mp_trace_socket_t;
+
+// Add an event to the ring, overwriting the oldest.  Safe to call from an
+// interrupt handler and from other threads, but an event that overwrites
+// one still being written by an interrupted context can be torn.
+void mp_trace_record(uint16_t event, uint16_t arg);
+
+// Write the events in the ring, oldest first, in the format described in
+// py/trace.c.
+void mp_trace_dump(vstr_t *vstr);
+
+void mp_trace_reset(void);
+
+#define MP_TRACE(event, arg) \
+    do { \
+        if (MP_STATE_VM(trace_enabled)) { \
+            mp_trace_record((event), (arg)); \
+        } \
+    } while (0)
+
+#else
+
+#define MP_TRACE(event, arg)
+
+#endif
+
+#endif // MICROPY_INCLUDED_PY_TRACE_H
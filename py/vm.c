@@ -30,11 +30,92 @@
 #include <assert.h>
 
 #include "py/emitglue.h"
+#include "py/gc.h"
+#include "py/objexcept.h"
+#include "py/objlist.h"
 #include "py/objtype.h"
 #include "py/runtime.h"
 #include "py/bc0.h"
 #include "py/bc.h"
 #include "py/profile.h"
+#include "py/jit.h"
+
+// Backward jumps count towards translating the function to native code, so
+// that a function running a long loop is translated by its next call.
+#if MICROPY_JIT
+#define JIT_COUNT_BACKWARD_JUMP() do { if ((mp_int_t)slab < 0) { mp_jit_count(code_state->fun_bc); } } while (0)
+#else
+#define JIT_COUNT_BACKWARD_JUMP()
+#endif
+
+// Superinstructions skip the tracing and counting of the opcodes after the
+// first one.
+#define SUPERINSTRUCTIONS (MICROPY_OPT_VM_SUPERINSTRUCTIONS && MICROPY_OPT_COMPUTED_GOTO && !MICROPY_PY_SYS_SETTRACE && !MICROPY_VM_OPCODE_STATS)
+
+// The superinstructions use the small-int fast path for their binary ops.
+// With opcode stats all binary ops go through mp_binary_op to be counted.
+#define SMALL_INT_FAST_PATH ((MICROPY_OPT_VM_SMALL_INT_FAST_PATH || SUPERINSTRUCTIONS) && !MICROPY_VM_OPCODE_STATS)
+
+#if MICROPY_VM_OPCODE_STATS
+#include "py/vmstats.h"
+#define OPCODE_STATS(ip) mp_vm_stats_opcode(*(ip))
+#else
+#define OPCODE_STATS(ip)
+#endif
+
+// A tick of the budget, on each jump and each entry to the VM.
+#if MICROPY_VM_BUDGET
+#define VM_BUDGET_TICK() do { \
+        if (MP_STATE_VM(vm_budget) > 0 && --MP_STATE_VM(vm_budget) == 0) { \
+            MARK_EXC_IP_SELECTIVE(); \
+            mp_obj_t exc = mp_vm_budget_expired(); \
+            if (exc != MP_OBJ_NULL) { \
+                RAISE(exc); \
+            } \
+        } \
+} while (0)
+#else
+#define VM_BUDGET_TICK()
+#endif
+
+#if SUPERINSTRUCTIONS
+#include "py/objtuple.h"
+#endif
+#if SMALL_INT_FAST_PATH
+#include "py/smallint.h"
+#endif
+
+#if MICROPY_STACKLESS
+// Whether a call to fun can be run by this activation of mp_execute_bytecode,
+// pushing its code state rather than a C stack frame.  That's the case for a
+// bytecode function or a closure of one, unless the function is due to run
+// its JIT translation, which is done through fun_bc_call.
+static inline bool stackless_callable(mp_obj_t fun) {
+    const mp_obj_type_t *type = mp_obj_get_type(fun);
+    if (type == &mp_type_closure) {
+        fun = mp_obj_closure_get_fun(fun);
+        type = mp_obj_get_type(fun);
+    }
+    if (type != &mp_type_fun_bc) {
+        return false;
+    }
+    #if MICROPY_JIT
+    mp_obj_fun_bc_t *self = MP_OBJ_TO_PTR(fun);
+    if (self->jit_count >= MICROPY_JIT_THRESHOLD && self->jit_count != MP_JIT_COUNT_FAILED) {
+        return false;
+    }
+    mp_jit_count(self);
+    #endif
+    return true;
+}
+
+static inline mp_code_state_t *stackless_prepare_codestate(mp_obj_t fun, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    if (mp_obj_is_type(fun, &mp_type_closure)) {
+        return mp_obj_closure_prepare_codestate(fun, n_args, n_kw, args);
+    }
+    return mp_obj_fun_bc_prepare_codestate(fun, n_args, n_kw, args);
+}
+#endif
 
 // *FORMAT-OFF*
 
@@ -172,6 +253,15 @@
     } \
 } while(0)
 
+#elif MICROPY_TRACK_CODE_STATE
+
+// The profilers only need to know which functions are running.
+#define FRAME_SETUP() MP_STATE_THREAD(current_code_state) = code_state
+#define FRAME_ENTER() code_state->prev_state = MP_STATE_THREAD(current_code_state)
+#define FRAME_LEAVE() MP_STATE_THREAD(current_code_state) = code_state->prev_state
+#define FRAME_UPDATE()
+#define TRACE_TICK(current_ip, current_sp, is_exception)
+
 #else // MICROPY_PY_SYS_SETTRACE
 #define FRAME_SETUP()
 #define FRAME_ENTER()
@@ -197,13 +287,103 @@ static inline mp_map_elem_t *mp_map_cached_lookup(mp_map_t *map, qstr qst, uint8
 }
 #endif
 
+#if SMALL_INT_FAST_PATH
+// Fast path for the binary ops on small ints that are common in loops.
+// Returns MP_OBJ_NULL if the op must be done by mp_binary_op, which includes
+// any result that doesn't fit in a small int and any op that can raise.
+static inline mp_obj_t mp_vm_small_int_binary_op(mp_uint_t op, mp_obj_t lhs, mp_obj_t rhs) {
+    if (!mp_obj_is_small_int(lhs) || !mp_obj_is_small_int(rhs)) {
+        return MP_OBJ_NULL;
+    }
+    mp_int_t l = MP_OBJ_SMALL_INT_VALUE(lhs);
+    mp_int_t r = MP_OBJ_SMALL_INT_VALUE(rhs);
+    switch (op) {
+        case MP_BINARY_OP_LESS: return mp_obj_new_bool(l < r);
+        case MP_BINARY_OP_MORE: return mp_obj_new_bool(l > r);
+        case MP_BINARY_OP_EQUAL: return mp_obj_new_bool(l == r);
+        case MP_BINARY_OP_LESS_EQUAL: return mp_obj_new_bool(l <= r);
+        case MP_BINARY_OP_MORE_EQUAL: return mp_obj_new_bool(l >= r);
+        case MP_BINARY_OP_NOT_EQUAL: return mp_obj_new_bool(l != r);
+        case MP_BINARY_OP_OR:
+        case MP_BINARY_OP_INPLACE_OR: return MP_OBJ_NEW_SMALL_INT(l | r);
+        case MP_BINARY_OP_XOR:
+        case MP_BINARY_OP_INPLACE_XOR: return MP_OBJ_NEW_SMALL_INT(l ^ r);
+        case MP_BINARY_OP_AND:
+        case MP_BINARY_OP_INPLACE_AND: return MP_OBJ_NEW_SMALL_INT(l & r);
+        case MP_BINARY_OP_ADD:
+        case MP_BINARY_OP_INPLACE_ADD: l += r; break;
+        case MP_BINARY_OP_SUBTRACT:
+        case MP_BINARY_OP_INPLACE_SUBTRACT: l -= r; break;
+        case MP_BINARY_OP_MULTIPLY:
+        case MP_BINARY_OP_INPLACE_MULTIPLY:
+            if (mp_small_int_mul_overflow(l, r)) {
+                return MP_OBJ_NULL;
+            }
+            return MP_OBJ_NEW_SMALL_INT(l * r);
+        case MP_BINARY_OP_LSHIFT:
+        case MP_BINARY_OP_INPLACE_LSHIFT:
+            if (r < 0 || r >= (mp_int_t)(sizeof(l) * MP_BITS_PER_BYTE)
+                || l > (MP_SMALL_INT_MAX >> r) || l < (MP_SMALL_INT_MIN >> r)) {
+                return MP_OBJ_NULL;
+            }
+            l <<= r;
+            break;
+        case MP_BINARY_OP_RSHIFT:
+        case MP_BINARY_OP_INPLACE_RSHIFT:
+            if (r < 0 || r >= (mp_int_t)(sizeof(l) * MP_BITS_PER_BYTE)) {
+                return MP_OBJ_NULL;
+            }
+            return MP_OBJ_NEW_SMALL_INT(l >> r);
+        default: return MP_OBJ_NULL;
+    }
+    // the sum or difference of two small ints, or a small int shifted left by
+    // less than the above limits, can't overflow a machine word
+    if (!MP_SMALL_INT_FITS(l)) {
+        return MP_OBJ_NULL;
+    }
+    return MP_OBJ_NEW_SMALL_INT(l);
+}
+#endif
+
+#if SUPERINSTRUCTIONS
+
+// Fast path for subscripting a list or tuple with a small int in range.
+// Returns MP_OBJ_NULL if the load must be done by mp_obj_subscr.
+static inline mp_obj_t mp_vm_subscr_fast(mp_obj_t base, mp_obj_t index) {
+    if (!mp_obj_is_small_int(index)) {
+        return MP_OBJ_NULL;
+    }
+    size_t len;
+    mp_obj_t *items;
+    if (mp_obj_is_type(base, &mp_type_list)) {
+        mp_obj_list_t *list = MP_OBJ_TO_PTR(base);
+        len = list->len;
+        items = list->items;
+    } else if (mp_obj_is_type(base, &mp_type_tuple)) {
+        mp_obj_tuple_t *tuple = MP_OBJ_TO_PTR(base);
+        len = tuple->len;
+        items = tuple->items;
+    } else {
+        return MP_OBJ_NULL;
+    }
+    mp_int_t i = MP_OBJ_SMALL_INT_VALUE(index);
+    if (i < 0) {
+        i += len;
+    }
+    if ((mp_uint_t)i >= len) {
+        return MP_OBJ_NULL;
+    }
+    return items[i];
+}
+#endif
+
 // fastn has items in reverse order (fastn[0] is local[0], fastn[-1] is local[1], etc)
 // sp points to bottom of stack which grows up
 // returns:
 //  MP_VM_RETURN_NORMAL, sp valid, return value in *sp
 //  MP_VM_RETURN_YIELD, ip, sp valid, yielded value in *sp
 //  MP_VM_RETURN_EXCEPTION, exception in state[0]
-mp_vm_return_kind_t mp_execute_bytecode(mp_code_state_t *code_state, volatile mp_obj_t inject_exc) {
+mp_vm_return_kind_t MICROPY_WRAP_MP_EXECUTE_BYTECODE(mp_execute_bytecode)(mp_code_state_t *code_state, volatile mp_obj_t inject_exc) {
 #define SELECTIVE_EXC_IP (0)
 #if SELECTIVE_EXC_IP
 #define MARK_EXC_IP_SELECTIVE() { code_state->ip = ip; } /* stores ip 1 byte past last opcode */
@@ -216,6 +396,7 @@ mp_vm_return_kind_t mp_execute_bytecode(mp_code_state_t *code_state, volatile mp
     #include "py/vmentrytable.h"
     #define DISPATCH() do { \
         TRACE(ip); \
+        OPCODE_STATS(ip); \
         MARK_EXC_IP_GLOBAL(); \
         TRACE_TICK(ip, sp, false); \
         goto *entry_table[*ip++]; \
@@ -274,6 +455,7 @@ outer_dispatch_loop:
             mp_obj_t *sp = code_state->sp;
             mp_obj_t obj_shared;
             MICROPY_VM_HOOK_INIT
+            VM_BUDGET_TICK();
 
             // If we have exception to inject, now that we finish setting up
             // execution context, raise it. This works as if MP_BC_RAISE_OBJ
@@ -294,6 +476,7 @@ dispatch_loop:
                 DISPATCH();
 #else
                 TRACE(ip);
+                OPCODE_STATS(ip);
                 MARK_EXC_IP_GLOBAL();
                 TRACE_TICK(ip, sp, false);
                 switch (*ip++) {
@@ -424,14 +607,24 @@ dispatch_loop:
                     DECODE_QSTR;
                     mp_obj_t top = TOP();
                     mp_map_elem_t *elem = NULL;
+                    mp_obj_t obj = MP_OBJ_NULL;
                     if (mp_obj_is_instance_type(mp_obj_get_type(top))) {
                         mp_obj_instance_t *self = MP_OBJ_TO_PTR(top);
-                        elem = mp_map_cached_lookup(&self->members, qst, (uint8_t*)ip);
+                        #if MICROPY_PY_SLOTS
+                        if (((mp_obj_class_t *)self->base.type)->n_slots != 0) {
+                            mp_obj_t *slot = mp_obj_instance_get_own_slot(self, qst, (uint8_t *)ip);
+                            if (slot != NULL) {
+                                obj = *slot;
+                            }
+                        }
+                        #endif
+                        if (obj == MP_OBJ_NULL) {
+                            elem = mp_map_cached_lookup(&self->members, qst, (uint8_t*)ip);
+                        }
                     }
-                    mp_obj_t obj;
                     if (elem != NULL) {
                         obj = elem->value;
-                    } else {
+                    } else if (obj == MP_OBJ_NULL) {
                         obj = mp_load_attr(top, qst);
                     }
                     SET_TOP(obj);
@@ -464,6 +657,13 @@ dispatch_loop:
                 ENTRY(MP_BC_LOAD_SUBSCR): {
                     MARK_EXC_IP_SELECTIVE();
                     mp_obj_t index = POP();
+                    #if SUPERINSTRUCTIONS
+                    mp_obj_t obj = mp_vm_subscr_fast(TOP(), index);
+                    if (obj != MP_OBJ_NULL) {
+                        SET_TOP(obj);
+                        DISPATCH();
+                    }
+                    #endif
                     SET_TOP(mp_obj_subscr(TOP(), index, MP_OBJ_SENTINEL));
                     DISPATCH();
                 }
@@ -515,12 +715,30 @@ dispatch_loop:
                     DECODE_QSTR;
                     mp_map_elem_t *elem = NULL;
                     mp_obj_t top = TOP();
+                    #if MICROPY_PY_SLOTS
+                    mp_obj_t *slot = NULL;
+                    #endif
                     if (mp_obj_is_instance_type(mp_obj_get_type(top)) && sp[-1] != MP_OBJ_NULL) {
                         mp_obj_instance_t *self = MP_OBJ_TO_PTR(top);
-                        elem = mp_map_cached_lookup(&self->members, qst, (uint8_t*)ip);
+                        #if MICROPY_PY_SLOTS
+                        if (((mp_obj_class_t *)self->base.type)->n_slots != 0
+                            && !(self->base.type->flags & MP_TYPE_FLAG_HAS_SPECIAL_ACCESSORS)) {
+                            slot = mp_obj_instance_get_own_slot(self, qst, (uint8_t *)ip);
+                        }
+                        if (slot == NULL)
+                        #endif
+                        {
+                            elem = mp_map_cached_lookup(&self->members, qst, (uint8_t*)ip);
+                        }
                     }
                     if (elem != NULL) {
                         elem->value = sp[-1];
+                        MP_GC_WRITE_BARRIER(elem);
+                    #if MICROPY_PY_SLOTS
+                    } else if (slot != NULL) {
+                        *slot = sp[-1];
+                        MP_GC_WRITE_BARRIER(slot);
+                    #endif
                     } else {
                         mp_store_attr(sp[0], qst, sp[-1]);
                     }
@@ -604,6 +822,7 @@ dispatch_loop:
                 ENTRY(MP_BC_JUMP): {
                     DECODE_SLABEL;
                     ip += slab;
+                    JIT_COUNT_BACKWARD_JUMP();
                     DISPATCH_WITH_PEND_EXC_CHECK();
                 }
 
@@ -611,6 +830,7 @@ dispatch_loop:
                     DECODE_SLABEL;
                     if (mp_obj_is_true(POP())) {
                         ip += slab;
+                        JIT_COUNT_BACKWARD_JUMP();
                     }
                     DISPATCH_WITH_PEND_EXC_CHECK();
                 }
@@ -619,6 +839,7 @@ dispatch_loop:
                     DECODE_SLABEL;
                     if (!mp_obj_is_true(POP())) {
                         ip += slab;
+                        JIT_COUNT_BACKWARD_JUMP();
                     }
                     DISPATCH_WITH_PEND_EXC_CHECK();
                 }
@@ -909,7 +1130,16 @@ unwind_jump:;
                     DECODE_UINT;
                     mp_obj_t obj = sp[-(unum >> 2)];
                     if ((unum & 3) == 0) {
-                        mp_obj_list_append(obj, sp[0]);
+                        // The list of a comprehension can't be seen by other code
+                        // until it's complete, so store into it without its lock
+                        // while there's room.
+                        mp_obj_list_t *list = MP_OBJ_TO_PTR(obj);
+                        if (list->len < list->alloc) {
+                            list->items[list->len++] = sp[0];
+                            MP_GC_WRITE_BARRIER(list->items);
+                        } else {
+                            mp_obj_list_append(obj, sp[0]);
+                        }
                         sp--;
                     } else if (!MICROPY_PY_BUILTINS_SET || (unum & 3) == 1) {
                         mp_obj_dict_store(obj, sp[0], sp[-1]);
@@ -978,12 +1208,24 @@ unwind_jump:;
                     // unum & 0xff == n_positional
                     // (unum >> 8) & 0xff == n_keyword
                     sp -= (unum & 0xff) + ((unum >> 7) & 0x1fe);
+                    mp_obj_t fun = *sp;
+                    size_t n_args = unum & 0xff;
+                    mp_obj_t *args = sp + 1;
+                    #if MICROPY_OPT_CALL_BOUND_METH
+                    if (mp_obj_is_type(fun, &mp_type_bound_meth)) {
+                        // Stack layout: bound_meth arg0 ... <- TOS, becomes
+                        // self arg0 ... so the method is called on the stack
+                        fun = mp_obj_bound_meth_unpack(fun, sp);
+                        n_args += 1;
+                        args = sp;
+                    }
+                    #endif
                     #if MICROPY_STACKLESS
-                    if (mp_obj_get_type(*sp) == &mp_type_fun_bc) {
+                    if (stackless_callable(fun)) {
                         code_state->ip = ip;
                         code_state->sp = sp;
                         code_state->exc_sp_idx = MP_CODE_STATE_EXC_SP_IDX_FROM_PTR(exc_stack, exc_sp);
-                        mp_code_state_t *new_state = mp_obj_fun_bc_prepare_codestate(*sp, unum & 0xff, (unum >> 8) & 0xff, sp + 1);
+                        mp_code_state_t *new_state = stackless_prepare_codestate(fun, n_args, (unum >> 8) & 0xff, args);
                         #if !MICROPY_ENABLE_PYSTACK
                         if (new_state == NULL) {
                             // Couldn't allocate codestate on heap: in the strict case raise
@@ -1002,7 +1244,7 @@ unwind_jump:;
                         }
                     }
                     #endif
-                    SET_TOP(mp_call_function_n_kw(*sp, unum & 0xff, (unum >> 8) & 0xff, sp + 1));
+                    SET_TOP(mp_call_function_n_kw(fun, n_args, (unum >> 8) & 0xff, args));
                     DISPATCH();
                 }
 
@@ -1016,7 +1258,7 @@ unwind_jump:;
                     // fun arg0 arg1 ... kw0 val0 kw1 val1 ... seq dict <- TOS
                     sp -= (unum & 0xff) + ((unum >> 7) & 0x1fe) + 2;
                     #if MICROPY_STACKLESS
-                    if (mp_obj_get_type(*sp) == &mp_type_fun_bc) {
+                    if (stackless_callable(*sp)) {
                         code_state->ip = ip;
                         code_state->sp = sp;
                         code_state->exc_sp_idx = MP_CODE_STATE_EXC_SP_IDX_FROM_PTR(exc_stack, exc_sp);
@@ -1024,7 +1266,7 @@ unwind_jump:;
                         mp_call_args_t out_args;
                         mp_call_prepare_args_n_kw_var(false, unum, sp, &out_args);
 
-                        mp_code_state_t *new_state = mp_obj_fun_bc_prepare_codestate(out_args.fun,
+                        mp_code_state_t *new_state = stackless_prepare_codestate(out_args.fun,
                             out_args.n_args, out_args.n_kw, out_args.args);
                         #if !MICROPY_ENABLE_PYSTACK
                         // Freeing args at this point does not follow a LIFO order so only do it if
@@ -1060,7 +1302,7 @@ unwind_jump:;
                     // (unum >> 8) & 0xff == n_keyword
                     sp -= (unum & 0xff) + ((unum >> 7) & 0x1fe) + 1;
                     #if MICROPY_STACKLESS
-                    if (mp_obj_get_type(*sp) == &mp_type_fun_bc) {
+                    if (stackless_callable(*sp)) {
                         code_state->ip = ip;
                         code_state->sp = sp;
                         code_state->exc_sp_idx = MP_CODE_STATE_EXC_SP_IDX_FROM_PTR(exc_stack, exc_sp);
@@ -1069,7 +1311,7 @@ unwind_jump:;
                         size_t n_kw = (unum >> 8) & 0xff;
                         int adjust = (sp[1] == MP_OBJ_NULL) ? 0 : 1;
 
-                        mp_code_state_t *new_state = mp_obj_fun_bc_prepare_codestate(*sp, n_args + adjust, n_kw, sp + 2 - adjust);
+                        mp_code_state_t *new_state = stackless_prepare_codestate(*sp, n_args + adjust, n_kw, sp + 2 - adjust);
                         #if !MICROPY_ENABLE_PYSTACK
                         if (new_state == NULL) {
                             // Couldn't allocate codestate on heap: in the strict case raise
@@ -1101,7 +1343,7 @@ unwind_jump:;
                     // fun self arg0 arg1 ... kw0 val0 kw1 val1 ... seq dict <- TOS
                     sp -= (unum & 0xff) + ((unum >> 7) & 0x1fe) + 3;
                     #if MICROPY_STACKLESS
-                    if (mp_obj_get_type(*sp) == &mp_type_fun_bc) {
+                    if (stackless_callable(*sp)) {
                         code_state->ip = ip;
                         code_state->sp = sp;
                         code_state->exc_sp_idx = MP_CODE_STATE_EXC_SP_IDX_FROM_PTR(exc_stack, exc_sp);
@@ -1109,7 +1351,7 @@ unwind_jump:;
                         mp_call_args_t out_args;
                         mp_call_prepare_args_n_kw_var(true, unum, sp, &out_args);
 
-                        mp_code_state_t *new_state = mp_obj_fun_bc_prepare_codestate(out_args.fun,
+                        mp_code_state_t *new_state = stackless_prepare_codestate(out_args.fun,
                             out_args.n_args, out_args.n_kw, out_args.args);
                         #if !MICROPY_ENABLE_PYSTACK
                         // Freeing args at this point does not follow a LIFO order so only do it if
@@ -1305,11 +1547,50 @@ yield:
 
 #if MICROPY_OPT_COMPUTED_GOTO
                 ENTRY(MP_BC_LOAD_CONST_SMALL_INT_MULTI):
-                    PUSH(MP_OBJ_NEW_SMALL_INT((mp_int_t)ip[-1] - MP_BC_LOAD_CONST_SMALL_INT_MULTI - MP_BC_LOAD_CONST_SMALL_INT_MULTI_EXCESS));
+                    obj_shared = MP_OBJ_NEW_SMALL_INT((mp_int_t)ip[-1] - MP_BC_LOAD_CONST_SMALL_INT_MULTI - MP_BC_LOAD_CONST_SMALL_INT_MULTI_EXCESS);
+                    #if SUPERINSTRUCTIONS
+                    if ((mp_uint_t)ip[0] - MP_BC_BINARY_OP_MULTI < MP_BC_BINARY_OP_MULTI_NUM) {
+                        // LOAD_CONST_SMALL_INT y; BINARY_OP, with the lhs on the stack
+                        mp_obj_t res = mp_vm_small_int_binary_op(ip[0] - MP_BC_BINARY_OP_MULTI, TOP(), obj_shared);
+                        if (res != MP_OBJ_NULL) {
+                            sp -= 1;
+                            obj_shared = res;
+                            if (*ip++ == MP_BC_BINARY_OP_MULTI + MP_BINARY_OP_INPLACE_ADD) {
+                                goto range_loop_step;
+                            }
+                            goto binary_op_result;
+                        }
+                    }
+                    #endif
+                    PUSH(obj_shared);
                     DISPATCH();
 
                 ENTRY(MP_BC_LOAD_FAST_MULTI):
                     obj_shared = fastn[MP_BC_LOAD_FAST_MULTI - (mp_int_t)ip[-1]];
+                    #if SUPERINSTRUCTIONS
+                    {
+                        // LOAD_FAST x; LOAD_FAST y or LOAD_CONST_SMALL_INT y; BINARY_OP or LOAD_SUBSCR
+                        mp_obj_t rhs;
+                        if ((mp_uint_t)ip[0] - MP_BC_LOAD_FAST_MULTI < MP_BC_LOAD_FAST_MULTI_NUM) {
+                            rhs = fastn[MP_BC_LOAD_FAST_MULTI - (mp_int_t)ip[0]];
+                        } else if ((mp_uint_t)ip[0] - MP_BC_LOAD_CONST_SMALL_INT_MULTI < MP_BC_LOAD_CONST_SMALL_INT_MULTI_NUM) {
+                            rhs = MP_OBJ_NEW_SMALL_INT((mp_int_t)ip[0] - MP_BC_LOAD_CONST_SMALL_INT_MULTI - MP_BC_LOAD_CONST_SMALL_INT_MULTI_EXCESS);
+                        } else {
+                            goto load_check;
+                        }
+                        mp_obj_t res = MP_OBJ_NULL;
+                        if ((mp_uint_t)ip[1] - MP_BC_BINARY_OP_MULTI < MP_BC_BINARY_OP_MULTI_NUM) {
+                            res = mp_vm_small_int_binary_op(ip[1] - MP_BC_BINARY_OP_MULTI, obj_shared, rhs);
+                        } else if (ip[1] == MP_BC_LOAD_SUBSCR && obj_shared != MP_OBJ_NULL) {
+                            res = mp_vm_subscr_fast(obj_shared, rhs);
+                        }
+                        if (res != MP_OBJ_NULL) {
+                            ip += 2;
+                            obj_shared = res;
+                            goto binary_op_result;
+                        }
+                    }
+                    #endif
                     goto load_check;
 
                 ENTRY(MP_BC_STORE_FAST_MULTI):
@@ -1325,9 +1606,101 @@ yield:
                     MARK_EXC_IP_SELECTIVE();
                     mp_obj_t rhs = POP();
                     mp_obj_t lhs = TOP();
+                    #if SUPERINSTRUCTIONS
+                    obj_shared = mp_vm_small_int_binary_op(ip[-1] - MP_BC_BINARY_OP_MULTI, lhs, rhs);
+                    if (obj_shared == MP_OBJ_NULL) {
+                        obj_shared = mp_binary_op(ip[-1] - MP_BC_BINARY_OP_MULTI, lhs, rhs);
+                    }
+                    sp--;
+                    goto binary_op_result;
+                    #else
+                    #if SMALL_INT_FAST_PATH
+                    mp_obj_t res = mp_vm_small_int_binary_op(ip[-1] - MP_BC_BINARY_OP_MULTI, lhs, rhs);
+                    if (res != MP_OBJ_NULL) {
+                        SET_TOP(res);
+                        DISPATCH();
+                    }
+                    #endif
                     SET_TOP(mp_binary_op(ip[-1] - MP_BC_BINARY_OP_MULTI, lhs, rhs));
                     DISPATCH();
+                    #endif
+                }
+
+                #if SUPERINSTRUCTIONS
+                binary_op_result:
+                    // The result of a binary op is in obj_shared, and goes straight
+                    // to a following STORE_FAST or conditional jump if there's one.
+                    if ((mp_uint_t)ip[0] - MP_BC_STORE_FAST_MULTI < MP_BC_STORE_FAST_MULTI_NUM) {
+                        fastn[MP_BC_STORE_FAST_MULTI - (mp_int_t)ip[0]] = obj_shared;
+                        ip += 1;
+                        DISPATCH();
+                    }
+                    if ((ip[0] == MP_BC_POP_JUMP_IF_FALSE || ip[0] == MP_BC_POP_JUMP_IF_TRUE)
+                        && (obj_shared == mp_const_false || obj_shared == mp_const_true)) {
+                        bool jump = (obj_shared == mp_const_true) == (ip[0] == MP_BC_POP_JUMP_IF_TRUE);
+                        ip += 1;
+                        DECODE_SLABEL;
+                        if (jump) {
+                            ip += slab;
+                            JIT_COUNT_BACKWARD_JUMP();
+                        }
+                        DISPATCH_WITH_PEND_EXC_CHECK();
+                    }
+                    PUSH(obj_shared);
+                    DISPATCH();
+
+                range_loop_step: {
+                    // The next value of the variable of a for loop over range(),
+                    // as compiled by compile_for_stmt_optimised_range, is in
+                    // obj_shared and is followed by the loop test, either
+                    // DUP_TOP_TWO; ROT_TWO with the end value on the stack, or
+                    // DUP_TOP; LOAD_CONST_SMALL_INT end; then BINARY_OP LESS or
+                    // MORE; POP_JUMP_IF_TRUE to DUP_TOP; STORE_FAST var.  All of
+                    // this is done here, so each iteration takes one dispatch.
+                    mp_obj_t end;
+                    const byte *ip_test = ip + 2;
+                    if (ip[0] == MP_BC_DUP_TOP_TWO && ip[1] == MP_BC_ROT_TWO) {
+                        end = TOP();
+                    } else if (ip[0] == MP_BC_DUP_TOP
+                               && (mp_uint_t)ip[1] - MP_BC_LOAD_CONST_SMALL_INT_MULTI < MP_BC_LOAD_CONST_SMALL_INT_MULTI_NUM) {
+                        end = MP_OBJ_NEW_SMALL_INT((mp_int_t)ip[1] - MP_BC_LOAD_CONST_SMALL_INT_MULTI - MP_BC_LOAD_CONST_SMALL_INT_MULTI_EXCESS);
+                    } else if (ip[0] == MP_BC_DUP_TOP && ip[1] == MP_BC_LOAD_CONST_SMALL_INT) {
+                        mp_int_t num = 0;
+                        if ((ip_test[0] & 0x40) != 0) {
+                            num--;
+                        }
+                        do {
+                            num = (num << 7) | (*ip_test & 0x7f);
+                        } while ((*ip_test++ & 0x80) != 0);
+                        end = MP_OBJ_NEW_SMALL_INT(num);
+                    } else {
+                        goto binary_op_result;
+                    }
+                    if (!mp_obj_is_small_int(end) || ip_test[1] != MP_BC_POP_JUMP_IF_TRUE) {
+                        goto binary_op_result;
+                    }
+                    bool jump;
+                    if (ip_test[0] == MP_BC_BINARY_OP_MULTI + MP_BINARY_OP_LESS) {
+                        jump = MP_OBJ_SMALL_INT_VALUE(obj_shared) < MP_OBJ_SMALL_INT_VALUE(end);
+                    } else if (ip_test[0] == MP_BC_BINARY_OP_MULTI + MP_BINARY_OP_MORE) {
+                        jump = MP_OBJ_SMALL_INT_VALUE(obj_shared) > MP_OBJ_SMALL_INT_VALUE(end);
+                    } else {
+                        goto binary_op_result;
+                    }
+                    PUSH(obj_shared);
+                    ip = ip_test + 2;
+                    DECODE_SLABEL;
+                    if (jump) {
+                        ip += slab;
+                        JIT_COUNT_BACKWARD_JUMP();
+                        if (ip[0] == MP_BC_DUP_TOP && (mp_uint_t)ip[1] - MP_BC_STORE_FAST_MULTI < MP_BC_STORE_FAST_MULTI_NUM) {
+                            fastn[MP_BC_STORE_FAST_MULTI - (mp_int_t)ip[1]] = obj_shared;
+                            ip += 2;
+                        }
+                    }
+                    DISPATCH_WITH_PEND_EXC_CHECK();
                 }
+                #endif
 
                 ENTRY_DEFAULT:
                     MARK_EXC_IP_SELECTIVE();
@@ -1348,6 +1721,13 @@ yield:
                     } else if (ip[-1] < MP_BC_BINARY_OP_MULTI + MP_BC_BINARY_OP_MULTI_NUM) {
                         mp_obj_t rhs = POP();
                         mp_obj_t lhs = TOP();
+                        #if SMALL_INT_FAST_PATH
+                        mp_obj_t res = mp_vm_small_int_binary_op(ip[-1] - MP_BC_BINARY_OP_MULTI, lhs, rhs);
+                        if (res != MP_OBJ_NULL) {
+                            SET_TOP(res);
+                            DISPATCH();
+                        }
+                        #endif
                         SET_TOP(mp_binary_op(ip[-1] - MP_BC_BINARY_OP_MULTI, lhs, rhs));
                         DISPATCH();
                     } else
@@ -1367,6 +1747,7 @@ yield:
 
 pending_exception_check:
                 MICROPY_VM_HOOK_LOOP
+                VM_BUDGET_TICK();
 
                 #if MICROPY_ENABLE_SCHEDULER
                 // This is an inlined variant of mp_handle_pending
@@ -1470,27 +1851,24 @@ unwind_loop:
             if (nlr.ret_val != &mp_const_GeneratorExit_obj
                 && *code_state->ip != MP_BC_END_FINALLY
                 && *code_state->ip != MP_BC_RAISE_LAST) {
-                const byte *ip = code_state->fun_bc->bytecode;
-                MP_BC_PRELUDE_SIG_DECODE(ip);
-                MP_BC_PRELUDE_SIZE_DECODE(ip);
-                const byte *bytecode_start = ip + n_info + n_cell;
-                #if !MICROPY_PERSISTENT_CODE
-                // so bytecode is aligned
-                bytecode_start = MP_ALIGN(bytecode_start, sizeof(mp_uint_t));
-                #endif
-                size_t bc = code_state->ip - bytecode_start;
-                #if MICROPY_PERSISTENT_CODE
-                qstr block_name = ip[0] | (ip[1] << 8);
-                qstr source_file = ip[2] | (ip[3] << 8);
-                ip += 4;
-                #else
-                qstr block_name = mp_decode_uint_value(ip);
-                ip = mp_decode_uint_skip(ip);
-                qstr source_file = mp_decode_uint_value(ip);
-                ip = mp_decode_uint_skip(ip);
+                #if MICROPY_PREALLOCATED_EXCEPTIONS
+                if (mp_obj_exception_is_preallocated(nlr.ret_val)) {
+                    // A preallocated exception has no traceback while it's
+                    // handled in this function, and is copied to an object that
+                    // can have one if it propagates out of it.
+                    mp_exc_stack_t *h = exc_sp;
+                    while (h >= exc_stack && h->handler <= code_state->ip) {
+                        --h;
+                    }
+                    if (h < exc_stack) {
+                        nlr.ret_val = MP_OBJ_TO_PTR(mp_obj_exception_copy_preallocated(MP_OBJ_FROM_PTR(nlr.ret_val)));
+                    }
+                }
                 #endif
-                size_t source_line = mp_bytecode_get_source_line(ip, bc);
-                mp_obj_exception_add_traceback(MP_OBJ_FROM_PTR(nlr.ret_val), source_file, source_line, block_name);
+                // Only the function and ip are recorded here; the line number
+                // is decoded if and when the traceback is looked at, because
+                // most exceptions are caught and never printed.
+                mp_obj_exception_add_traceback_bc(MP_OBJ_FROM_PTR(nlr.ret_val), code_state->fun_bc, code_state->ip);
             }
 
             while (exc_sp >= exc_stack && exc_sp->handler <= code_state->ip) {
@@ -0,0 +1,111 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "py/vmstats.h"
+#include "py/persistentcode.h"
+
+#if MICROPY_VM_OPCODE_STATS
+
+// The pairs and binary ops are counted in fixed size tables, found by
+// hashing and linear probing.  Once a table is full, counts of further
+// keys are dropped.
+
+void mp_vm_stats_opcode(byte op) {
+    MP_STATE_VM(vm_stats_opcode)[op] += 1;
+
+    uint16_t key = MP_STATE_VM(vm_stats_prev_opcode) << 8 | op;
+    MP_STATE_VM(vm_stats_prev_opcode) = op;
+    size_t i = (key * 2654435761u) % MICROPY_VM_OPCODE_STATS_PAIRS;
+    for (size_t n = 0; n < MICROPY_VM_OPCODE_STATS_PAIRS; ++n) {
+        mp_vm_stats_pair_t *pair = &MP_STATE_VM(vm_stats_pair)[i];
+        if (pair->count == 0) {
+            pair->key = key;
+        }
+        if (pair->key == key) {
+            pair->count += 1;
+            return;
+        }
+        i = (i + 1) % MICROPY_VM_OPCODE_STATS_PAIRS;
+    }
+    MP_STATE_VM(vm_stats_pair_dropped) += 1;
+}
+
+void mp_vm_stats_binary_op(mp_binary_op_t op, mp_obj_t lhs, mp_obj_t rhs) {
+    // count by type name, so that no type needs to be kept alive
+    qstr lhs_name = mp_obj_get_type(lhs)->name;
+    qstr rhs_name = mp_obj_get_type(rhs)->name;
+    size_t i = (op + lhs_name * 31 + rhs_name * 961) % MICROPY_VM_OPCODE_STATS_BINOPS;
+    for (size_t n = 0; n < MICROPY_VM_OPCODE_STATS_BINOPS; ++n) {
+        mp_vm_stats_binop_t *binop = &MP_STATE_VM(vm_stats_binop)[i];
+        if (binop->count == 0) {
+            binop->op = op;
+            binop->lhs = lhs_name;
+            binop->rhs = rhs_name;
+        }
+        if (binop->op == op && binop->lhs == lhs_name && binop->rhs == rhs_name) {
+            binop->count += 1;
+            return;
+        }
+        i = (i + 1) % MICROPY_VM_OPCODE_STATS_BINOPS;
+    }
+    MP_STATE_VM(vm_stats_binop_dropped) += 1;
+}
+
+void mp_vm_stats_reset(void) {
+    memset(MP_STATE_VM(vm_stats_opcode), 0, sizeof(MP_STATE_VM(vm_stats_opcode)));
+    memset(MP_STATE_VM(vm_stats_pair), 0, sizeof(MP_STATE_VM(vm_stats_pair)));
+    memset(MP_STATE_VM(vm_stats_binop), 0, sizeof(MP_STATE_VM(vm_stats_binop)));
+    MP_STATE_VM(vm_stats_prev_opcode) = 0;
+    MP_STATE_VM(vm_stats_pair_dropped) = 0;
+    MP_STATE_VM(vm_stats_binop_dropped) = 0;
+}
+
+void mp_vm_stats_dump(const mp_print_t *print) {
+    mp_printf(print, "vm_stats 1 %u\n", MPY_VERSION);
+    for (size_t i = 0; i < 256; ++i) {
+        if (MP_STATE_VM(vm_stats_opcode)[i] != 0) {
+            mp_printf(print, "op %u %u\n", (uint)i, (uint)MP_STATE_VM(vm_stats_opcode)[i]);
+        }
+    }
+    for (size_t i = 0; i < MICROPY_VM_OPCODE_STATS_PAIRS; ++i) {
+        const mp_vm_stats_pair_t *pair = &MP_STATE_VM(vm_stats_pair)[i];
+        if (pair->count != 0) {
+            mp_printf(print, "pair %u %u %u\n", pair->key >> 8, pair->key & 0xff, (uint)pair->count);
+        }
+    }
+    for (size_t i = 0; i < MICROPY_VM_OPCODE_STATS_BINOPS; ++i) {
+        const mp_vm_stats_binop_t *binop = &MP_STATE_VM(vm_stats_binop)[i];
+        if (binop->count != 0) {
+            mp_printf(print, "binop %u %q %q %u\n", binop->op, binop->lhs, binop->rhs, (uint)binop->count);
+        }
+    }
+    mp_printf(print, "dropped pair %u\n", (uint)MP_STATE_VM(vm_stats_pair_dropped));
+    mp_printf(print, "dropped binop %u\n", (uint)MP_STATE_VM(vm_stats_binop_dropped));
+}
+
+#endif // MICROPY_VM_OPCODE_STATS
@@ -0,0 +1,55 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef MICROPY_INCLUDED_PY_VMSTATS_H
+#define MICROPY_INCLUDED_PY_VMSTATS_H
+
+#include "py/runtime.h"
+
+#if MICROPY_VM_OPCODE_STATS
+
+// Count an opcode dispatched by the VM, and the pair it makes with the
+// opcode dispatched before it.
+void mp_vm_stats_opcode(byte op);
+
+// Count a binary op by the operator and the types of its operands.
+void mp_vm_stats_binary_op(mp_binary_op_t op, mp_obj_t lhs, mp_obj_t rhs);
+
+void mp_vm_stats_reset(void);
+
+// Print the counts, one per line, in a format that tools/vmstats.py reads:
+//
+//     vm_stats <format version> <bytecode version>
+//     op <opcode> <count>
+//     pair <opcode> <next opcode> <count>
+//     binop <operator> <lhs type> <rhs type> <count>
+//     dropped <pair|binop> <count>
+//
+// Opcodes and operators are numbers, as in py/bc0.h and py/runtime0.h.
+void mp_vm_stats_dump(const mp_print_t *print);
+
+#endif
+
+#endif // MICROPY_INCLUDED_PY_VMSTATS_H
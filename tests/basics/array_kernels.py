@@ -0,0 +1,55 @@
+# test array kernel functions (MicroPython extension)
+try:
+    import uarray as array
+
+    array.add
+except (ImportError, AttributeError):
+    print("SKIP")
+    raise SystemExit
+
+a = array.array("h", [1, 2, -3, 32767])
+b = array.array("h", [10, 20, 30, 1])
+
+# elementwise, with an array or a number
+print(array.add(a, b))
+print(array.sub(a, b))
+print(array.mul(a, 3))
+print(array.add(bytearray(b"\x01\x02"), 255))
+print(array.mul(array.array("I", [0x10000, 3]), array.array("I", [0x10000, 5])))
+
+# in place
+array.add(a, b, a)
+print(a)
+out = array.array("h", [0] * 4)
+print(array.sub(a, 1, out) is out, out)
+
+# reductions
+print(array.sum(a), array.dot(a, b), array.min(a), array.max(a))
+print(array.sum(array.array("B", [200, 200])), array.sum(array.array("i")))
+print(array.dot(array.array("b", [-1, 2]), array.array("b", [3, 4])))
+print(array.min(bytearray(b"\x05\x01\x09")), array.max(memoryview(b"\x05\x01\x09")))
+
+# conversion
+h = array.array("h", [0, 0, 0])
+array.convert(h, array.array("i", [1, 65537, -65536]))
+print(h)
+array.convert(h, array.array("b", [1, -1, 2]), 100)
+print(h)
+
+# errors
+try:
+    array.min(array.array("i"))
+except ValueError:
+    print("ValueError")
+try:
+    array.add(a, array.array("i", [1, 2, 3, 4]))
+except ValueError:
+    print("ValueError")
+try:
+    array.add(a, array.array("h", [1]))
+except ValueError:
+    print("ValueError")
+try:
+    array.sum(array.array("b", [1]), 1)
+except TypeError:
+    print("TypeError")
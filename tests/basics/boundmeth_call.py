@@ -0,0 +1,41 @@
+# test calling and comparing bound methods taken from instances
+
+
+class A:
+    def __init__(self, x):
+        self.x = x
+
+    def f(self, *args, **kw):
+        return (self.x, args, sorted(kw.items()))
+
+    def g(self, a, b=2):
+        return self.x + a + b
+
+
+a = A(1)
+b = A(10)
+
+# calls through a bound method held in a variable
+f = a.f
+print(f())
+print(f(1, 2, 3, 4, 5, 6))
+print(f(1, k=2))
+g = b.g
+print(g(1), g(1, 3), g(a=1, b=1))
+
+# a bound method in a container and passed to builtins
+print(list(map(a.g, range(3))))
+fs = [a.f, b.f]
+print([h(0) for h in fs])
+
+# taking the same method twice
+print(a.f == a.f, a.f != a.f, a.f == b.f, a.f == a.g)
+print(hash(a.f) == hash(a.f))
+d = {a.f: 1, b.f: 2}
+print(d[a.f], d[b.f])
+
+# wrong number of arguments is reported for the method
+try:
+    g()
+except TypeError:
+    print("TypeError")
@@ -0,0 +1,17 @@
+# test searching long bytes, where the first byte of the needle is common
+
+h = b"ab" * 300 + b"abc" + b"ab" * 300 + b"abcd"
+for n in (b"abc", b"ababababc", b"abababababababababababababc", b"abcd", b"ababcd", b"bab", b"abx"):
+    print(n, h.find(n), h.rfind(n), h.count(n), len(h.split(n)), n in h)
+
+# the needle at the very start and end
+h = b"x" + b"e" * 1000 + b"y"
+for n in (b"xeeeeeeee", b"eeeeeeeey", b"eeeeeeeeee", b"eeeeeeeex"):
+    print(n, h.find(n), h.rfind(n), h.find(n, 500), h.find(n, 0, 600))
+
+# needle bytes that repeat, and a needle longer than 255 bytes
+h = bytes(range(256)) * 8
+print(h.find(bytes(range(10, 20)) * 2), h.find(bytes(range(256)) + b"\x00\x01"), h.find(bytes(range(256)) * 2 + b"\x01"))
+
+s = "hello world " * 100 + "hello there"
+print(s.find("hello there"), s.index("hello there"), s.split("hello w")[-1])
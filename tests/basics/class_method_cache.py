@@ -0,0 +1,53 @@
+# test that looking up methods repeatedly sees changes to classes
+
+
+class A:
+    def f(self):
+        return "A.f"
+
+
+class B(A):
+    pass
+
+
+def call(o):
+    return o.f()
+
+
+b = B()
+print(call(b), call(b))
+
+# replace the method in the base class
+A.f = lambda self: "A.f2"
+print(call(b))
+
+# override it in the derived class
+B.f = lambda self: "B.f"
+print(call(b))
+
+# remove the override
+del B.f
+print(call(b))
+
+# an instance attribute shadows the method
+b.f = lambda: "b.f"
+print(call(b))
+del b.f
+print(call(b))
+
+# a class attribute that isn't a function
+A.f = 42
+try:
+    call(b)
+except TypeError:
+    print("TypeError")
+print(b.f)
+
+# new classes with the same method name, created and freed in a loop
+for i in range(5):
+
+    class D:
+        def f(self, i=i):
+            return i
+
+    print(call(D()))
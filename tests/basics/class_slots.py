@@ -0,0 +1,173 @@
+# test __slots__
+
+try:
+    class Probe:
+        __slots__ = ("x",)
+
+    Probe().x = 1
+    Probe().y = 1
+    print("SKIP")
+    raise SystemExit
+except AttributeError:
+    pass
+
+
+class Point:
+    __slots__ = ("x", "y")
+
+    def __init__(self, x, y):
+        self.x = x
+        self.y = y
+
+
+p = Point(1, 2)
+print(p.x, p.y)
+p.x += 10
+print(p.x)
+
+# attributes not in __slots__ can't be set
+try:
+    p.z = 3
+except AttributeError:
+    print("AttributeError")
+
+
+
+# an unset slot
+class Pair:
+    __slots__ = ("a", "b")
+
+
+q = Pair()
+try:
+    q.a
+except AttributeError:
+    print("AttributeError")
+q.a = 5
+print(q.a)
+
+# deleting a slot
+del p.y
+try:
+    p.y
+except AttributeError:
+    print("AttributeError")
+try:
+    del p.y
+except AttributeError:
+    print("AttributeError")
+p.y = 7
+print(p.y)
+
+
+# a single name as a str
+class One:
+    __slots__ = "v"
+
+
+o = One()
+o.v = 1
+print(o.v)
+
+
+# __dict__ in __slots__ allows other attributes
+class Dyn:
+    __slots__ = ("a", "__dict__")
+
+
+d = Dyn()
+d.a = 1
+d.b = 2
+print(d.a, d.b)
+
+
+# slots are inherited, and a subclass without __slots__ has a dict
+class Point3(Point):
+    __slots__ = ("z",)
+
+    def __init__(self, x, y, z):
+        super().__init__(x, y)
+        self.z = z
+
+
+p3 = Point3(1, 2, 3)
+print(p3.x, p3.y, p3.z)
+try:
+    p3.w = 4
+except AttributeError:
+    print("AttributeError")
+
+
+class Loose(Point):
+    pass
+
+
+l = Loose(1, 2)
+l.w = 4
+print(l.x, l.y, l.w)
+
+
+# __getattr__ is called for an unset slot
+class Lazy:
+    __slots__ = ("v",)
+
+    def __getattr__(self, name):
+        return "default " + name
+
+
+z = Lazy()
+print(z.v)
+z.v = 1
+print(z.v)
+
+
+# object.__setattr__ and object.__delattr__ work on slots
+class Frozen:
+    __slots__ = ("v",)
+
+    def __init__(self, v):
+        object.__setattr__(self, "v", v)
+
+    def __setattr__(self, name, value):
+        raise AttributeError("frozen")
+
+
+f = Frozen(3)
+print(f.v)
+try:
+    f.v = 4
+except AttributeError:
+    print("AttributeError")
+object.__delattr__(f, "v")
+try:
+    f.v
+except AttributeError:
+    print("AttributeError")
+
+# a name in __slots__ can't also be a class variable
+try:
+
+    class Bad:
+        __slots__ = ("x",)
+        x = 1
+
+except ValueError:
+    print("ValueError")
+
+
+# two bases with slots can't be combined
+class A:
+    __slots__ = ("a",)
+
+
+class B:
+    __slots__ = ("b",)
+
+
+try:
+
+    class AB(A, B):
+        pass
+
+except TypeError:
+    print("TypeError")
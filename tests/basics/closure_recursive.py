@@ -0,0 +1,44 @@
+# test recursive calls of closures, with the various ways of passing arguments
+
+
+def make(a, b, c, d, e, f):
+    def rec(n, *args, k=0, **kw):
+        if n == 0:
+            return a + b + c + d + e + f + sum(args) + k + sum(kw.values())
+        return 1 + rec(n - 1, *args, k=k, **kw)
+
+    return rec
+
+
+rec = make(1, 2, 3, 4, 5, 6)
+print(rec(0), rec(10), rec(10, 1, 2), rec(10, k=3, z=4))
+
+
+def outer():
+    x = 1
+
+    def fib(n):
+        return n if n < 2 else fib(n - 1) + fib(n - 2) + x - 1
+
+    return fib
+
+
+print(outer()(15))
+
+
+# a closure that is a method, so called with self
+class A:
+    pass
+
+
+def add_method():
+    y = 2
+
+    def count(self, n):
+        return 0 if n == 0 else y + self.count(n - 1)
+
+    A.count = count
+
+
+add_method()
+print(A().count(20))
@@ -0,0 +1,42 @@
+# test comprehensions over range, mostly to check optimisation of this pair
+
+print([x for x in range(5)])
+print([x for x in range(2, 7)])
+print([x for x in range(10, 0, -3)])
+print([x for x in range(-3)])
+print([x for x in range(3, 3)])
+print({x: x * x for x in range(1, 5)})
+print(sorted({x % 3 for x in range(10)}))
+
+# the end is evaluated once, before the loop
+n = 3
+print([n for x in range(n) for n in range(2)])
+
+# conditions and nested loops
+print([x for x in range(12) if x % 3 if x & 1])
+print([(x, y) for x in range(4) for y in range(x, 3)])
+print([[y for y in range(x)] for x in range(4)])
+
+# the loop variable doesn't leak, and is captured per closure
+x = "outer"
+print([x for x in range(2)], x)
+print([f() for f in [lambda: x for x in range(3)]])
+
+# arguments evaluated in the enclosing class scope
+class A:
+    a = 2
+    b = [x for x in range(a, a + 3)]
+
+
+print(A.b)
+
+# step, * and ** args, and keyword args aren't optimised
+print([x for x in range(*(1, 6, 2))])
+try:
+    [x for x in range(1, 2, 0)]
+except ValueError:
+    print("ValueError")
+try:
+    [x for x in range(end=1)]
+except TypeError:
+    print("TypeError")
@@ -10,17 +10,19 @@ except ImportError:
     raise SystemExit
 
 
-# Initial sequence is not supported
-try:
-    deque([1, 2, 3], 10)
-except ValueError:
-    print("ValueError")
+# Initial sequence
+d = deque([1, 2, 3], 10)
+print(len(d), d.popleft())
+
+# Initial sequence longer than maxlen
+d = deque([1, 2, 3], 2)
+print(len(d), d.popleft())
 
-# Not even empty list, only empty tuple
+# Initial sequence that overflows
 try:
-    deque([], 10)
-except ValueError:
-    print("ValueError")
+    deque([1, 2, 3], 2, True)
+except IndexError as e:
+    print(repr(e))
 
 # Only fixed-size deques are supported, so length arg is mandatory
 try:
@@ -0,0 +1,88 @@
+# test indexing, iteration and operations at both ends of a deque
+try:
+    try:
+        from ucollections import deque
+    except ImportError:
+        from collections import deque
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+try:
+    deque((), 1)[0]
+except TypeError:
+    print("SKIP")
+    raise SystemExit
+except IndexError:
+    pass
+
+# initial items, dropping from the left when there are too many
+d = deque(range(5), 3)
+print(d, len(d))
+print(list(d))
+
+# indexing
+print(d[0], d[1], d[2], d[-1], d[-3])
+d[0] = 10
+d[-1] = 12
+print(d)
+for i in (3, -4):
+    try:
+        d[i]
+    except IndexError:
+        print("IndexError")
+
+# both ends
+d = deque((), 3)
+d.append(1)
+d.appendleft(0)
+d.append(2)
+print(d)
+d.appendleft(-1)
+print(d)
+d.append(3)
+print(d)
+print(d.pop(), d.popleft(), d)
+print(d.pop(), d)
+try:
+    d.pop()
+except IndexError:
+    print("IndexError")
+
+# extend, extendleft
+d = deque((), 4)
+d.extend([1, 2, 3])
+d.extendleft("ab")
+print(d)
+d.extend(d)
+print(d)
+
+# rotate
+d = deque(range(5), 5)
+d.rotate()
+print(d)
+d.rotate(2)
+print(d)
+d.rotate(-4)
+print(d)
+d.rotate(12)
+print(d)
+deque((), 2).rotate(3)
+
+# iteration and membership
+d = deque((), 3)
+for i in range(10):
+    d.append(i)
+print([x for x in d], 8 in d, 1 in d)
+
+# clear
+d.clear()
+print(d, len(d), bool(d))
+d.append(1)
+print(d)
+
+# maxlen of zero
+d = deque((), 0)
+d.append(1)
+d.appendleft(2)
+print(d, len(d))
@@ -0,0 +1,64 @@
+# test deques that store numbers in a packed array
+try:
+    from ucollections import deque
+
+    deque((), 1, typecode="i")
+except (ImportError, TypeError):
+    print("SKIP")
+    raise SystemExit
+
+d = deque((), 3, typecode="h")
+print(d, d.sum())
+for i in range(1, 6):
+    d.append(i)
+    print(d, d.sum())
+d.appendleft(-10)
+print(d, d.sum())
+d[1] = 100
+print(d, d.sum())
+print(d.pop(), d.popleft(), d.sum())
+d.rotate()
+print(d.sum())
+d.clear()
+print(d, d.sum())
+
+# unsigned and 64-bit items
+d = deque([255, 255], 2, typecode="B")
+print(d, d.sum())
+d = deque([1 << 40, 1 << 40, 1 << 40], 2, typecode="q")
+print(d.sum())
+
+# a failed conversion leaves the deque as it was
+d = deque([1, 2], 2, typecode="i")
+for op in (d.append, d.appendleft):
+    try:
+        op("x")
+    except TypeError:
+        print("TypeError")
+try:
+    d[0] = None
+except TypeError:
+    print("TypeError")
+print(d, d.sum())
+
+# overflow checking
+d = deque((), 1, 1, typecode="l")
+d.append(1)
+try:
+    d.append(2)
+except IndexError:
+    print("IndexError")
+print(d)
+
+# bad typecodes
+for tc in ("x", "ii", "O"):
+    try:
+        deque((), 1, typecode=tc)
+    except ValueError:
+        print("ValueError")
+
+# only typed deques have a sum
+try:
+    deque((), 1).sum()
+except TypeError:
+    print("TypeError")
@@ -0,0 +1,54 @@
+# test dicts that have many items added and deleted, so their tables are
+# packed, grown and shrunk
+
+# a sliding window of keys
+d = {}
+for i in range(1000):
+    d[i] = i
+    if i >= 10:
+        del d[i - 10]
+print(len(d), sorted(d), sum(d.values()))
+
+# delete and add the same keys again
+d = {str(i): i for i in range(20)}
+for n in range(50):
+    k = str(n % 20)
+    del d[k]
+    print(k in d, end=" ")
+    d[k] = n
+print()
+print(len(d), sorted(d.items()) == sorted((str(i), 30 + i) for i in range(20)))
+
+# grow a dict a lot, then delete most of it and grow it again
+d = {}
+for i in range(2000):
+    d[i] = -i
+for i in range(1990):
+    del d[i]
+print(len(d), sorted(d))
+for i in range(500):
+    d["k%d" % i] = i
+print(len(d), d[1995], d["k499"], 5 in d, "k500" in d)
+
+# popitem until empty, from a big dict
+d = {i: i * i for i in range(300)}
+s = 0
+while d:
+    s += d.popitem()[1]
+print(s)
+
+# copies of a big dict are independent of the original
+d = {i: i for i in range(400)}
+d2 = d.copy()
+for i in range(0, 400, 2):
+    del d[i]
+d2[1000] = 1
+print(len(d), len(d2), 0 in d, 0 in d2, 1000 in d)
+
+# keys that compare equal
+d = {1: "a", 2.0: "b"}
+d[True] = "c"
+d[2] = "d"
+print(len(d), d[1], d[2.0])
+del d[1.0]
+print(len(d), 1 in d, True in d)
@@ -68,3 +68,20 @@ try:
         print(x)
 except TypeError:
     print('TypeError')
+
+# assigning to the variable or the end in the body doesn't alter the loop
+def f(n):
+    for x in range(n):
+        print(x)
+        x += 10
+        n = 1
+    for x in range(100, 250, 50):
+        print(x)
+    for x in range(3, -3, -2):
+        print(x)
+f(3)
+
+# a range crossing the small-int boundary
+big = 1 << 62
+for x in range(big - 2, big + 1):
+    print(x - big)
@@ -0,0 +1,49 @@
+# test repeated calls with keyword arguments, which may be matched to their
+# parameters using what was found by earlier calls
+
+# same names at different positions in different functions
+def f(a, b, c):
+    return (a, b, c)
+
+
+def g(c, b, a):
+    return (a, b, c)
+
+
+for i in range(3):
+    print(f(1, c=3, b=2), g(1, a=3, b=2))
+    print(f(c=i, a=1, b=2), g(a=i, c=1, b=2))
+
+# a function is freed and another one created with different parameters
+for params in ("x, y", "y, x", "y, z, x", "z, y"):
+    exec("def h(%s):\n    return (%s)" % (params, params))
+    try:
+        print(h(x=1, y=2))
+    except TypeError:
+        print("TypeError")
+
+# errors are still found on repeated calls
+for i in range(2):
+    try:
+        f(1, a=2, b=3)
+    except TypeError:
+        print("TypeError")
+    try:
+        f(1, 2, d=3)
+    except TypeError:
+        print("TypeError")
+
+# many parameters, with keyword-only ones
+def k(a, b=2, c=3, d=4, e=5, *, f=6, g, h=8, **kw):
+    return (a, b, c, d, e, f, g, h, sorted(kw.items()))
+
+
+for i in range(3):
+    print(k(1, e=i, g=7))
+    print(k(g=i, a=1, h=0, z=9))
+
+# native functions with keyword arguments
+l = [3, 1, 2]
+for i in range(3):
+    l.sort(reverse=bool(i & 1), key=lambda x: -x)
+    print(l)
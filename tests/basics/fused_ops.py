@@ -0,0 +1,94 @@
+# test sequences of opcodes that the VM may execute as one, with operands
+# that do and don't take the fast path
+
+
+def arith(a, b):
+    c = a + b
+    d = a - 1
+    e = a & b
+    f = a | 3
+    g = a ^ b
+    return c, d, e, f, g
+
+
+print(arith(5, 3))
+print(arith(-7, 2))
+print(arith(True, 2))
+
+
+def add(a, b):
+    c = a + b
+    return c
+
+
+print(add("a", "b"), add([1], [2]))
+
+# results that don't fit in a small int
+big = 1 << 62
+print(arith(big, big)[:2])
+print(arith(-big, -big)[:2])
+print(arith(1 << 30, 1 << 30)[0])
+
+
+def cmp(a, b):
+    r = []
+    if a < b:
+        r.append("<")
+    if a > b:
+        r.append(">")
+    if a == b:
+        r.append("==")
+    if a <= b:
+        r.append("<=")
+    if not a >= b:
+        r.append("not >=")
+    if a != b:
+        r.append("!=")
+    return r
+
+
+print(cmp(1, 2), cmp(2, 1), cmp(2, 2))
+print(cmp("a", "b"))
+
+
+def loop(n):
+    i = 0
+    s = 0
+    while i < n:
+        s += i
+        i += 1
+    return s
+
+
+print(loop(100))
+
+
+def subscr(l, i):
+    return l[i], l[-1], l[0]
+
+
+print(subscr([1, 2, 3], 1))
+print(subscr((4, 5, 6), -2))
+print(subscr("abc", 2))
+print(subscr({0: "a", 1: "b", -1: "c"}, 1))
+try:
+    subscr([1, 2, 3], 3)
+except IndexError:
+    print("IndexError")
+try:
+    subscr((), 0)
+except IndexError:
+    print("IndexError")
+
+
+# unbound local as the first operand
+def unbound():
+    if False:
+        x = 1
+    return x + 1
+
+
+try:
+    unbound()
+except NameError:
+    print("NameError")
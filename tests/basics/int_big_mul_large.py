@@ -0,0 +1,31 @@
+# tests multiplication and modular power of large ints, which may use
+# algorithms other than schoolbook multiplication above some size
+
+# operands of many sizes, both balanced and unbalanced
+for i in (200, 700, 1000, 1600, 3000):
+    for j in (200, 1000, 3000):
+        a = 3 ** i - 1
+        b = 7 ** j + 1
+        print(i, j, a * b % 1000000007, (a * b) // a == b, a * -b == -(a * b))
+
+# squaring
+a = 5 ** 2500 - 3
+print(a * a % 1000000007, a * a == a ** 2)
+
+# numbers with long runs of zero and all-ones digits
+a = (1 << 4000) - 1
+b = (1 << 3000) + 1
+print(a * b == (a << 3000) + a)
+print((a * a) >> 7990)
+
+# modular power with odd, even and large moduli
+m_odd = 2 ** 1279 - 1
+m_even = 2 ** 1000 + 6
+for base in (2, 3, 12345678901234567890, 7 ** 600):
+    for m in (m_odd, m_even, 10 ** 300 + 7):
+        print(pow(base, 65537, m) % 1000000007)
+        print(pow(base, m - 2, m) % 1000000007)
+
+# Fermat: for a prime modulus p, pow(a, p - 1, p) == 1
+p = 2 ** 521 - 1
+print(pow(3, p - 1, p), pow(-3, p - 1, p), pow(p - 1, 3, p) == p - 1)
@@ -0,0 +1,33 @@
+# test binary ops on small ints whose results overflow to big ints
+
+# values around the small-int limits of 32- and 64-bit ports
+vals = [0, 1, -1, 3, -7, 0x3FFF, 0x3FFFFFFF, -0x40000000, 0x3FFFFFFFFFFFFFFF, -0x4000000000000000]
+
+for a in vals:
+    for b in vals:
+        print(a + b, a - b, a * b, a < b, a == b, a & b, a | b, a ^ b)
+
+for a in vals:
+    for s in (0, 1, 2, 29, 30, 31, 32, 62, 63, 64, 100):
+        print(a << s, a >> s)
+
+# in-place versions
+x = 0x3FFFFFFF
+x += 1
+print(x)
+x = 0x3FFFFFFF
+x *= 4
+print(x)
+x = 1
+x <<= 62
+print(x)
+x = -1
+x >>= 200
+print(x)
+
+# errors must still come from the generic path
+for op in (lambda: 1 << -1, lambda: 1 >> -1):
+    try:
+        op()
+    except ValueError:
+        print("ValueError")
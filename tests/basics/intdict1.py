@@ -0,0 +1,63 @@
+# test ucollections.IntDict, checking it against a dict
+
+try:
+    from ucollections import IntDict
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+d = IntDict()
+print(d, len(d), bool(d))
+
+# dense keys, sparse keys, negative keys and big ints
+ref = {}
+for k in list(range(20)) + [-5, 100, 1000000, -1000000, 2**70, 21, 19, 18, 25, -3]:
+    d[k] = k * 2
+    ref[k] = k * 2
+print(len(d) == len(ref), sorted(d.items()) == sorted(ref.items()))
+print(d[0], d[19], d[-5], d[2**70], d.get(50), d.get(50, "x"), 100 in d, 101 in d, "a" in d)
+
+# the range grows over keys that were stored outside it
+for k in range(-10, 120):
+    d[k] = k
+    ref[k] = k
+print(sorted(d.items()) == sorted(ref.items()))
+
+# delete from the ends and the middle
+for k in (119, 118, -10, 50, 2**70, 1000000):
+    del d[k]
+    del ref[k]
+print(sorted(d.keys()) == sorted(ref.keys()), sorted(d.values()) == sorted(ref.values()))
+print(d.pop(0), d.pop(0, "none"), len(d) == len(ref) - 1)
+
+# bools are the same keys as 0 and 1
+d[True] = "one"
+print(d[1], True in d, d.get(False))
+
+# errors
+for k in (0, 2**70, -1000, "a"):
+    try:
+        d[k]
+    except (KeyError, TypeError) as e:
+        print(type(e).__name__, e)
+try:
+    del d[0]
+except KeyError as e:
+    print("KeyError", e)
+try:
+    d.pop(12345)
+except KeyError as e:
+    print("KeyError", e)
+
+# construct from a dict, pairs and another IntDict; iteration is in key order
+d = IntDict({3: "c", 1: "a", 2: "b"})
+print(d, list(d), list(d.values()))
+print(IntDict([(5, 1), (4, 2)]), IntDict(d))
+
+# emptying the table lets it start again anywhere
+del d[1], d[2], d[3]
+d[1000] = 0
+d[1001] = 1
+print(d, len(d))
+d.clear()
+print(d, len(d))
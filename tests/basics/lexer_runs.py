@@ -0,0 +1,34 @@
+# test lexing of long runs of identifier characters and spaces
+
+abcdefghijklmnopqrstuvwxyz_ABCDEFGHIJKLMNOPQRSTUVWXYZ_0123456789 = 1
+print(abcdefghijklmnopqrstuvwxyz_ABCDEFGHIJKLMNOPQRSTUVWXYZ_0123456789)
+
+# names of all lengths, ending at the end of the input
+for n in range(1, 12):
+    name = "x" * n
+    exec(name + " = " + str(n))
+    print(eval(name))
+    print(eval("(" + "  " * n + name + " " * n + ")"))
+
+# keywords and names that are prefixes of keywords
+for src in ("True", "None", "Fals", "Falsey", "yield_", "await_", "__debug__", "w", "with_"):
+    try:
+        print(src, eval(src))
+    except NameError:
+        print(src, "NameError")
+    except SyntaxError:
+        print(src, "SyntaxError")
+
+# deep indentation with long runs of spaces, and CR LF line endings
+src = "if 1:\n" + "".join(" " * (4 * i) + "if 1:\n" for i in range(1, 8)) + " " * 32 + "print('deep')\n"
+exec(src)
+exec(src.replace("\n", "\r\n"))
+
+# spaces inside lines and before comments
+exec("a     =     3      +      4          # comment\nprint(a        )")
+
+# a line continuation after a run of spaces
+exec("b = 1 +          \\\n        2\nprint(b)")
+
+# a long name split by the end of the input
+exec("longnamelongname = 5\nprint(longnamelongname)")
@@ -0,0 +1,21 @@
+# test list.extend and += growing the list, including from itself
+
+l = [1, 2]
+l.extend(l)
+print(l)
+l += l
+print(l)
+l.extend((5, 6))
+print(l)
+l += (7,)
+print(l)
+
+# many extends
+l = []
+for i in range(100):
+    l.extend((i, -i))
+print(len(l), l[:6], l[-4:], sum(l))
+l = []
+for i in range(100):
+    l += [i] * 3
+print(len(l), l[-3:])
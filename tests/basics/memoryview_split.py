@@ -0,0 +1,37 @@
+# test memoryview.split(), a MicroPython extension
+try:
+    memoryview(b"").split
+except (NameError, AttributeError):
+    print("SKIP")
+    raise SystemExit
+
+m = memoryview(b"a,bb,,ccc,")
+print([bytes(x) for x in m.split(b",")])
+print([bytes(x) for x in m.split(b",", 2)])
+print([bytes(x) for x in m.split(b",", 0)])
+print([bytes(x) for x in m.split(b"bb,,")])
+print([bytes(x) for x in m.split(b"x")])
+print([bytes(x) for x in memoryview(b"").split(b",")])
+
+# the parts are views of the original buffer
+b = bytearray(b"key=value")
+k, v = memoryview(b).split(b"=")
+v[0] = ord("V")
+print(b, type(k), len(k), bytes(k))
+
+# on a slice of a memoryview, with a separator that's not bytes
+m = memoryview(b"--x\r\ny\r\nz--")[2:-2]
+print([bytes(x) for x in m.split(bytearray(b"\r\n"))])
+
+# it's an iterator
+it = memoryview(b"1 2").split(b" ")
+print(bytes(next(it)), bytes(next(it)))
+try:
+    next(it)
+except StopIteration:
+    print("StopIteration")
+
+try:
+    memoryview(b"ab").split(b"")
+except ValueError:
+    print("ValueError")
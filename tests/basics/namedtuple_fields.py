@@ -0,0 +1,22 @@
+# test looking up the fields of namedtuples with many or repeated names
+
+try:
+    try:
+        from ucollections import namedtuple
+    except ImportError:
+        from collections import namedtuple
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+N = namedtuple("N", ["f%d" % i for i in range(100)])
+n = N(*range(100))
+print(sum(getattr(n, "f%d" % i) for i in range(100)))
+print(n.f99, n.f50)
+
+try:
+    n.g
+except AttributeError:
+    print("AttributeError")
+
+print(N(*range(99), f99=-1).f99)
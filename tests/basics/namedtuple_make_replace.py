@@ -0,0 +1,46 @@
+try:
+    try:
+        from ucollections import namedtuple
+    except ImportError:
+        from collections import namedtuple
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+T = namedtuple("Tup", ["baz", "foo", "bar"])
+
+try:
+    T._make
+except AttributeError:
+    print("SKIP")
+    raise SystemExit
+
+# _make from a list, a tuple and any other iterable
+print(T._make([1, 2, 3]))
+print(T._make((1, 2, 3)))
+print(T._make(range(3)))
+print(T._make(iter("abc")).foo)
+t = T(4, 5, 6)
+print(t._make([7, 8, 9]))
+
+try:
+    T._make([1, 2])
+except TypeError:
+    print("TypeError")
+
+# _replace makes a new namedtuple with some fields changed
+u = t._replace(foo=50)
+print(u, t)
+print(type(u) is T)
+print(t._replace())
+print(t._replace(bar=0, baz=1))
+
+try:
+    t._replace(qux=1)
+except ValueError:
+    print("ValueError")
+
+# field access with many fields
+N = namedtuple("N", ["f%d" % i for i in range(40)])
+n = N(*range(40))
+print(n.f0, n.f17, n.f39, n._replace(f39=-1).f39)
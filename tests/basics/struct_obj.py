@@ -0,0 +1,55 @@
+# test struct.Struct objects
+
+try:
+    import ustruct as struct
+except:
+    try:
+        import struct
+    except ImportError:
+        print("SKIP")
+        raise SystemExit
+
+if not hasattr(struct, "Struct"):
+    print("SKIP")
+    raise SystemExit
+
+s = struct.Struct("<BHi")
+print(s.size, s.format)
+print(s.pack(1, 2, -3))
+print(s.unpack(b"\x01\x02\x00\xfd\xff\xff\xff"))
+print(s.unpack_from(b"xx\x01\x02\x00\xfd\xff\xff\xff", 2))
+print(s.unpack_from(b"xx\x01\x02\x00\xfd\xff\xff\xff", -7))
+
+# repeat counts and strings
+s = struct.Struct(">2H3sb")
+print(s.size, s.pack(1, 2, b"ab", -1))
+print(s.unpack(s.pack(1, 2, b"abcd", -1)))
+
+# alignment in native mode matches the module functions
+for fmt in ("bi", "@hq", "3bI", "2BH"):
+    print(struct.Struct(fmt).size == struct.calcsize(fmt))
+
+# pack_into
+buf = bytearray(8)
+struct.Struct("<HH").pack_into(buf, 2, 0x1234, 0x5678)
+print(buf)
+struct.Struct("<H").pack_into(buf, -2, 0xABCD)
+print(buf)
+
+# iter_unpack
+rec = struct.Struct("<hB")
+print(list(rec.iter_unpack(b"\x01\x00\x02\xff\xff\x03")))
+print(list(rec.iter_unpack(b"")))
+
+# buffer too small, or not a multiple of the size
+for f in (
+    lambda: rec.unpack(b"\x01\x00"),
+    lambda: rec.unpack_from(b"\x01\x00\x02", 1),
+    lambda: rec.unpack_from(b"\x01\x00\x02", -4),
+    lambda: rec.pack_into(bytearray(4), 2, 1, 2),
+    lambda: rec.iter_unpack(b"\x01\x00\x02\x03"),
+):
+    try:
+        f()
+    except Exception:
+        print("Exception")
@@ -0,0 +1,41 @@
+# test MicroPython-specific features of struct.Struct
+
+try:
+    import ustruct as struct
+except:
+    try:
+        import struct
+    except ImportError:
+        print("SKIP")
+        raise SystemExit
+
+if not hasattr(struct, "Struct"):
+    print("SKIP")
+    raise SystemExit
+
+# unpack_from can store the values into an existing list
+s = struct.Struct("<hH2s")
+out = [None] * 3
+buf = b"\xff\xff\x02\x00ab\x03\x00\x04\x00cd"
+print(s.unpack_from(buf, 0, out) is out, out)
+print(s.unpack_from(buf, 6, out), out)
+print(s.unpack_from(buf, 0, None))
+
+for l in ([], [0] * 4):
+    try:
+        s.unpack_from(buf, 0, l)
+    except ValueError:
+        print("ValueError")
+
+try:
+    s.unpack_from(buf, 0, (1, 2, 3))
+except TypeError:
+    print("TypeError")
+
+# O and S work as with the module functions
+class A:
+    pass
+
+a = A()
+o = struct.Struct("<O")
+print(o.unpack(o.pack(a))[0] is a)
@@ -1,7 +1,7 @@
 """
 categories: Types,float
 description: uPy and CPython outputs formats may differ
-cause: Unknown
+cause: Ports built without ``MICROPY_FLOAT_EXACT_CONVERSION`` format floats with an approximate algorithm, which chooses the format before rounding and may give a different last digit.
 workaround: Unknown
 """
 print("%.1g" % -9.9)
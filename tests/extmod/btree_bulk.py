@@ -0,0 +1,39 @@
+# Test btree bulk_load, write-back blocksize and stats
+
+try:
+    import btree
+    import uio
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+f = uio.BytesIO()
+db = btree.open(f, pagesize=512, blocksize=2048)
+
+print(db.bulk_load((("%04d" % i).encode(), ("v%d" % i).encode()) for i in range(1000)))
+print(len(list(db.keys())), db[b"0000"], db[b"0999"])
+
+# keys must be strictly ascending, items before the bad one are stored
+try:
+    db.bulk_load([(b"2", b"x"), (b"1", b"y")])
+except ValueError:
+    print("ValueError")
+print(db[b"2"], b"1" in db)
+try:
+    db.bulk_load([(b"3", b"x"), (b"3", b"y")])
+except ValueError:
+    print("ValueError")
+
+print(sorted(db.stats().keys()))
+db.close()
+
+# reopen without write-back buffering and check the data reached the stream
+f.seek(0)
+db = btree.open(f)
+print(db[b"0500"], db[b"3"])
+db.close()
+
+try:
+    btree.open(uio.BytesIO(), blocksize=-1)
+except ValueError:
+    print("ValueError")
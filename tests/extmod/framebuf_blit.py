@@ -0,0 +1,77 @@
+# Test FrameBuffer.blit with a key, palette and scale.
+
+try:
+    import framebuf
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+
+def printbuf(fbuf, w, h):
+    print("--8<--")
+    for y in range(h):
+        print(" ".join("%x" % fbuf.pixel(x, y) for x in range(w)))
+    print("-->8--")
+
+
+w = 6
+h = 5
+fbuf = framebuf.FrameBuffer(bytearray(w * h * 2), w, h, framebuf.RGB565)
+
+# same format, with clipping at each edge
+src = framebuf.FrameBuffer(bytearray(3 * 2 * 2), 3, 2, framebuf.RGB565)
+src.fill(0xAB)
+src.pixel(1, 0, 0xCD)
+for x, y in ((0, 0), (-1, 4), (4, -1)):
+    fbuf.fill(0)
+    fbuf.blit(src, x, y)
+    printbuf(fbuf, w, h)
+
+# same format with a transparent key
+fbuf.fill(0x11)
+fbuf.blit(src, 1, 1, 0xAB)
+printbuf(fbuf, w, h)
+
+# same format for GS8
+gs8 = framebuf.FrameBuffer(bytearray(w * h), w, h, framebuf.GS8)
+src8 = framebuf.FrameBuffer(bytearray(b"\x01\x02\x03\x04"), 2, 2, framebuf.GS8)
+gs8.blit(src8, 4, 3)
+gs8.blit(src8, 0, 0, 2)
+printbuf(gs8, w, h)
+
+# mono and GS4 to RGB565 through a palette
+pal = framebuf.FrameBuffer(bytearray(16 * 2), 16, 1, framebuf.RGB565)
+for i in range(16):
+    pal.pixel(i, 0, 0x100 + i)
+mono = framebuf.FrameBuffer(bytearray(b"\x05\x02\x00"), 3, 3, framebuf.MONO_VLSB)
+fbuf.fill(0)
+fbuf.blit(mono, 1, 1, -1, pal)
+printbuf(fbuf, w, h)
+gs4 = framebuf.FrameBuffer(bytearray(b"\x01\x2f"), 2, 2, framebuf.GS4_HMSB)
+fbuf.fill(0)
+fbuf.blit(gs4, 0, 0, 0x100, pal)
+printbuf(fbuf, w, h)
+
+# a palette shorter than the source's colours leaves the rest unmapped
+fbuf.fill(0)
+fbuf.blit(gs4, 0, 0, -1, framebuf.FrameBuffer(bytearray(b"\x34\x12"), 1, 1, framebuf.RGB565))
+printbuf(fbuf, w, h)
+
+# scaled, clipped, with key and palette
+fbuf.fill(0)
+fbuf.clear_dirty()
+fbuf.blit(mono, -1, 0, 0x100, pal, 2)
+printbuf(fbuf, w, h)
+print(fbuf.dirty())
+
+# invalid arguments
+try:
+    fbuf.blit(mono, 0, 0, -1, None, 0)
+except ValueError:
+    print("ValueError")
+try:
+    fbuf.blit(mono, 0, 0, -1, bytearray(2))
+except TypeError:
+    print("TypeError")
+fbuf.wait()
+print(fbuf.dirty())
@@ -0,0 +1,56 @@
+try:
+    import framebuf
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+w = 10
+h = 10
+buf = bytearray(w * h * 2)
+fbuf = framebuf.FrameBuffer(buf, w, h, framebuf.RGB565)
+
+# nothing drawn yet
+print(fbuf.dirty())
+
+# each drawing method grows the dirty region
+fbuf.pixel(3, 4, 0xFFFF)
+print(fbuf.dirty())
+fbuf.pixel(3, 4)
+print(fbuf.dirty())
+fbuf.fill_rect(5, 5, 2, 3, 0xFFFF)
+print(fbuf.dirty())
+fbuf.clear_dirty()
+fbuf.line(8, 1, 6, 2, 0xFFFF)
+print(fbuf.dirty())
+fbuf.clear_dirty()
+fbuf.text("a", 4, 6, 0xFFFF)
+print(fbuf.dirty())
+fbuf.clear_dirty()
+fbuf.blit(framebuf.FrameBuffer(bytearray(8), 2, 2, framebuf.RGB565), -1, 2)
+print(fbuf.dirty())
+fbuf.clear_dirty()
+fbuf.fill(0)
+print(fbuf.dirty())
+
+# drawing outside the framebuffer doesn't mark anything
+fbuf.clear_dirty()
+fbuf.pixel(-1, 0, 0xFFFF)
+fbuf.fill_rect(w, 0, 5, 5, 0xFFFF)
+fbuf.line(-5, -5, -1, -1, 0xFFFF)
+fbuf.text("abc", 0, h, 0xFFFF)
+print(fbuf.dirty())
+
+# rows of the dirty region, as bytes of the buffer
+fbuf.fill_rect(2, 1, 3, 2, 0x1234)
+for row in fbuf.dirty_rows():
+    print(bytes(row))
+fbuf.clear_dirty()
+print(list(fbuf.dirty_rows()))
+
+# packed and vertical formats round the rows out to whole bytes
+fbuf = framebuf.FrameBuffer(bytearray(2 * 16), 16, 16, framebuf.MONO_VLSB)
+fbuf.pixel(3, 9, 1)
+print(fbuf.dirty(), [bytes(r) for r in fbuf.dirty_rows()])
+fbuf = framebuf.FrameBuffer(bytearray(2 * 3), 16, 3, framebuf.MONO_HLSB)
+fbuf.hline(6, 1, 4, 1)
+print(fbuf.dirty(), [bytes(r) for r in fbuf.dirty_rows()])
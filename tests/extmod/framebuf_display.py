@@ -0,0 +1,78 @@
+# test sending framebufs to displays with _display
+
+try:
+    import framebuf, _display
+    from machine import PinBase
+except (ImportError, AttributeError):
+    print("SKIP")
+    raise SystemExit
+
+
+class Pin(PinBase):
+    def __init__(self, name, log):
+        self.name = name
+        self.log = log
+
+    def value(self, v=None):
+        self.log.append("%s=%d" % (self.name, v))
+
+
+class I2C:
+    def writevto(self, addr, bufs):
+        print("i2c", hex(addr), bytes(bufs[0]), bytes(bufs[1]))
+
+
+class SPI:
+    def __init__(self, log):
+        self.log = log
+
+    def write(self, buf):
+        print(" ".join(self.log), bytes(buf))
+        self.log.clear()
+
+
+# SSD1306 over I2C
+fb = framebuf.FrameBuffer(bytearray(8 * 2), 8, 16, framebuf.MONO_VLSB)
+bus = _display.Bus(I2C(), 0x3C)
+bus.cmd(0xAE)
+bus.data(b"\x01\x02")
+
+# nothing drawn, nothing sent
+fb.clear_dirty()
+bus.show_mono(fb, 0, False)
+
+# a dirty rectangle within one page
+fb.pixel(2, 3, 1)
+fb.pixel(4, 5, 1)
+bus.show_mono(fb, 0, False)
+bus.show_mono(fb, 0, False)
+
+# whole rows are sent at once
+fb.fill(1)
+bus.show_mono(fb, 32, False)
+
+# an explicit region, clipped to the framebuf
+bus.show_mono(fb, 0, False, (6, 8, 10, 10))
+
+# SH1106 page addressing
+fb.fill(0)
+fb.pixel(1, 0, 1)
+fb.pixel(2, 9, 1)
+bus.show_mono(fb, 2, True)
+
+# RGB565 over SPI with DC and CS pins
+log = []
+bus = _display.Bus(SPI(log), Pin("dc", log), Pin("cs", log))
+fb = framebuf.FrameBuffer(bytearray(4 * 4 * 2), 4, 4, framebuf.RGB565)
+fb.clear_dirty()
+fb.pixel(1, 2, 0x1234)
+fb.pixel(2, 2, 0xABCD)
+bus.show_rgb565(fb, 0, 0)
+fb.fill_rect(0, 1, 4, 2, 0xF800)
+bus.show_rgb565(fb, 10, 20)
+
+# wrong format
+try:
+    bus.show_mono(fb, 0, False)
+except ValueError:
+    print("ValueError")
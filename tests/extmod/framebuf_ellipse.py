@@ -0,0 +1,36 @@
+try:
+    import framebuf
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+
+def printbuf():
+    print("--8<--")
+    for y in range(h):
+        print("".join("#" if fbuf.pixel(x, y) else "." for x in range(w)))
+    print("-->8--")
+
+
+w = 16
+h = 12
+fbuf = framebuf.FrameBuffer(bytearray(w * h), w, h, framebuf.GS8)
+
+# outline and filled
+for fill in (False, True):
+    fbuf.fill(0)
+    fbuf.ellipse(7, 5, 6, 4, 1, fill)
+    printbuf()
+
+# single quadrants
+for mask in (0b0001, 0b0010, 0b0100, 0b1000):
+    fbuf.fill(0)
+    fbuf.ellipse(7, 5, 3, 3, 1, True, mask)
+    printbuf()
+
+# degenerate and clipped
+fbuf.fill(0)
+fbuf.ellipse(2, 2, 0, 0, 1)
+fbuf.ellipse(8, 2, 4, 0, 1)
+fbuf.ellipse(14, 10, 3, 3, 1, True)
+printbuf()
@@ -0,0 +1,73 @@
+# Test FrameBuffer.text with a framebuf.Font.
+
+try:
+    import framebuf
+
+    framebuf.Font
+except (ImportError, AttributeError):
+    print("SKIP")
+    raise SystemExit
+
+
+def printbuf(fbuf, w, h, fmt="%x"):
+    print("--8<--")
+    for y in range(h):
+        print(" ".join(fmt % fbuf.pixel(x, y) for x in range(w)))
+    print("-->8--")
+
+
+# 1-bit font with glyphs for "?" and "A", 4 pixels high
+font1 = framebuf.Font(
+    b"F\x01\x04\x00?\x00\x03\x00"
+    b"\x1a\x00\x00\x00\x03\x04"  # ?
+    b"\x1e\x00\x00\x00\x00\x00"  # @ (missing)
+    b"\x1e\x00\x00\x00\x04\x05"  # A
+    b"\xe0\x20\x40\x40"
+    b"\x60\x90\xf0\x90"
+)
+# 4-bit anti-aliased font with a single 2x2 glyph for "A"
+font4 = framebuf.Font(b"F\x04\x02\x00A\x00\x01\x00" b"\x0e\x00\x00\x00\x02\x03" b"\xf8\x40")
+
+print(font1.size("A?"), font1.size(""), font4.size("AAA"))
+
+# unknown characters are drawn as "?"
+fbuf = framebuf.FrameBuffer(bytearray(12 * 5), 12, 5, framebuf.GS8)
+fbuf.text("AB", 0, 0, 1, font1)
+printbuf(fbuf, 12, 5)
+print(fbuf.dirty())
+
+# clipping
+fbuf.fill(0)
+fbuf.text("AA", -2, 3, 1, font1)
+printbuf(fbuf, 12, 5)
+
+# blending into each format
+for fmt, w, col, bg in (
+    (framebuf.GS8, 4, 0xF0, 0x0F),
+    (framebuf.GS4_HMSB, 4, 0xF, 0x0),
+    (framebuf.RGB565, 8, 0xF800, 0x001F),
+    (framebuf.MONO_HLSB, 8, 1, 0),
+):
+    fbuf = framebuf.FrameBuffer(bytearray(8 * 2 * 2), w, 2, fmt)
+    fbuf.fill(bg)
+    fbuf.text("A", 1, 0, col, font4)
+    printbuf(fbuf, 3, 2)
+
+# the built-in font is used without a font or with None
+buf = bytearray(8)
+fbuf = framebuf.FrameBuffer(buf, 8, 8, framebuf.MONO_VLSB)
+fbuf.text("|", 0, 0, 1, None)
+print(buf)
+
+try:
+    framebuf.Font(b"X\x01\x04\x00?\x00\x03\x00")
+except ValueError:
+    print("ValueError")
+try:
+    framebuf.Font(b"F\x01\x04\x00?\x00\x03\x00")
+except ValueError:
+    print("ValueError")
+try:
+    fbuf.text("A", 0, 0, 1, 1)
+except TypeError:
+    print("TypeError")
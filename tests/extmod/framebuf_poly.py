@@ -0,0 +1,37 @@
+try:
+    import framebuf
+    from array import array
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+
+def printbuf():
+    print("--8<--")
+    for y in range(h):
+        print("".join("#" if fbuf.pixel(x, y) else "." for x in range(w)))
+    print("-->8--")
+
+
+w = 16
+h = 12
+fbuf = framebuf.FrameBuffer(bytearray(w * h), w, h, framebuf.GS8)
+
+# triangle, outline and filled
+tri = array("h", [0, 0, 10, 3, 3, 9])
+for fill in (False, True):
+    fbuf.fill(0)
+    fbuf.poly(2, 1, tri, 1, fill)
+    printbuf()
+
+# concave shape clipped by the edges
+arrow = array("b", [-3, 0, 4, -6, 11, 0, 4, 6, 4, 2])
+fbuf.fill(0)
+fbuf.poly(3, 5, arrow, 1, True)
+printbuf()
+
+# a single point and no points
+fbuf.fill(0)
+fbuf.poly(5, 5, array("h", [1, 1]), 1, True)
+fbuf.poly(5, 5, array("h"), 1, True)
+printbuf()
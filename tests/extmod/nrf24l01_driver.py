@@ -0,0 +1,169 @@
+# test the _nrf24l01 driver against a simulated radio
+
+try:
+    import _nrf24l01
+    from machine import PinBase
+except (ImportError, AttributeError):
+    print("SKIP")
+    raise SystemExit
+
+CONFIG = 0x00
+SETUP_RETR = 0x04
+RF_SETUP = 0x06
+STATUS = 0x07
+RX_ADDR_P0 = 0x0A
+FIFO_STATUS = 0x17
+DYNPD = 0x1C
+FEATURE = 0x1D
+
+
+class Pin(PinBase):
+    OUT = 1
+    IRQ_FALLING = 2
+
+    def __init__(self, chip=None):
+        self.chip = chip
+        self.v = 0
+        self.handler = None
+
+    def init(self, mode, value):
+        self.v = value
+
+    def value(self, v=None):
+        if v is None:
+            return self.v
+        self.v = v
+        if self.chip:
+            self.chip.update()
+
+    def irq(self, handler, trigger=None):
+        self.handler = handler
+
+
+# The radio: registers and FIFOs, with packets going out over the air as soon
+# as CE is high in PTX mode, and coming in from the air in PRX mode.
+class Chip:
+    def __init__(self):
+        self.regs = bytearray(0x1E)
+        self.regs[STATUS] = 0x0E
+        self.rx_fifo = []
+        self.tx_fifo = []
+        self.air = []  # packets waiting to be received
+        self.sent = []  # packets sent and acknowledged
+        self.fail = 0  # number of packets not to acknowledge
+        self.ce = Pin(self)
+        self.nspi = 0
+
+    def fifo_status(self):
+        return (
+            (not self.rx_fifo)
+            | (len(self.rx_fifo) == 3) << 1
+            | (not self.tx_fifo) << 4
+            | (len(self.tx_fifo) == 3) << 5
+        )
+
+    def update(self):
+        if not self.ce.v or not self.regs[CONFIG] & 2:
+            return
+        if self.regs[CONFIG] & 1:
+            while self.air and len(self.rx_fifo) < 3:
+                self.rx_fifo.append(self.air.pop(0))
+                self.regs[STATUS] |= 0x40
+        else:
+            while self.tx_fifo and not self.regs[STATUS] & 0x10:
+                if self.fail:
+                    self.fail -= 1
+                    self.regs[STATUS] |= 0x10
+                else:
+                    self.sent.append(self.tx_fifo.pop(0))
+                    self.regs[STATUS] |= 0x20
+
+    def write_readinto(self, wr, rd):
+        self.nspi += 1
+        self.update()
+        cmd = wr[0]
+        data = bytes(wr[1:])
+        rd[0] = self.regs[STATUS]
+        if cmd < 0x20:
+            rd[1] = self.fifo_status() if cmd == FIFO_STATUS else self.regs[cmd]
+        elif cmd < 0x40:
+            reg = cmd & 0x1F
+            if reg == STATUS:
+                self.regs[STATUS] &= ~data[0]
+            elif len(data) == 1:
+                self.regs[reg] = data[0]
+            else:
+                print("addr", hex(reg), data)
+        elif cmd == 0x60:
+            rd[1] = len(self.rx_fifo[0])
+        elif cmd == 0x61:
+            rd[1:] = self.rx_fifo.pop(0)
+        elif cmd == 0xA0:
+            self.tx_fifo.append(data)
+        elif cmd == 0xE1:
+            self.tx_fifo = []
+        elif cmd == 0xE2:
+            self.rx_fifo = []
+
+
+# set up with 2Mbps and the smallest RX buffer
+chip = Chip()
+nrf = _nrf24l01.NRF24L01(chip, Pin(), chip.ce, payload_size=4, speed=_nrf24l01.SPEED_2M, rxbuf=0)
+print(hex(chip.regs[CONFIG]), hex(chip.regs[SETUP_RETR]), hex(chip.regs[RF_SETUP]))
+print(chip.regs[DYNPD], chip.regs[FEATURE])
+nrf.open_tx_pipe(b"1Node")
+nrf.open_rx_pipe(1, b"2Node")
+nrf.start_listening()
+print(hex(chip.regs[CONFIG]), chip.ce.v)
+
+# receive, polling; the buffer holds 6 packets of 4 bytes
+print(nrf.recv(), nrf.any())
+chip.air = [bytes([97 + i] * 4) for i in range(10)]
+print(nrf.any())
+print([nrf.recv() for i in range(7)])
+print(nrf.stats())
+
+# send with sync, padded to the payload size
+print(nrf.send(b"xy"), chip.sent)
+print(hex(chip.regs[CONFIG]), chip.ce.v)
+
+# a packet that is not acknowledged
+chip.fail = 1
+print(nrf.send(b"zz"), chip.tx_fifo, nrf.stats())
+
+# packets queued without sync go out back to back
+chip.sent = []
+for i in range(6):
+    nrf.send(bytes([i]), False)
+print(nrf.send(b"6"), chip.sent)
+print(nrf.stats())
+
+# too long
+try:
+    nrf.send(b"12345")
+except ValueError:
+    print("ValueError")
+
+# dynamic payloads, with an IRQ pin
+chip = Chip()
+irq = Pin()
+nrf = _nrf24l01.NRF24L01(chip, Pin(), chip.ce, irq, payload_size=0)
+print(chip.regs[DYNPD], chip.regs[FEATURE], irq.handler is not None)
+nrf.open_rx_pipe(0, b"3Node")
+nrf.start_listening()
+chip.air = [b"a", b"bcd", b"efghijklmnopqrstuvwxyz0123456789"]
+n = chip.nspi
+print(nrf.any(), chip.nspi == n)
+irq.handler(irq)
+print(nrf.any())
+print(nrf.recv(), nrf.recv(), nrf.recv(), nrf.recv())
+print(nrf.any())
+
+# sending switches pipe 0 to the TX address for the ACKs, and back
+nrf.open_tx_pipe(b"4Node")
+nrf.send(b"123", False)
+print(chip.sent, chip.tx_fifo)
+irq.handler(irq)
+print(chip.sent, hex(chip.regs[CONFIG]))
+nrf.deinit()
+print(irq.handler, hex(chip.regs[CONFIG]), chip.ce.v)
@@ -14,6 +14,14 @@ async def foo():
     return 42
 
 
+async def none():
+    pass
+
+
+async def exc():
+    return ValueError("value")
+
+
 async def main():
     # Call function directly via an await
     print(await foo())
@@ -22,5 +30,15 @@ async def main():
     task = asyncio.create_task(foo())
     print(await task)
 
+    # Await on a task that has already finished, more than once
+    task = asyncio.create_task(foo())
+    await asyncio.sleep(0)
+    print(task.done(), await task, await task)
+
+    # A task returning None, and one returning an exception instance
+    print(await asyncio.create_task(none()))
+    e = await asyncio.create_task(exc())
+    print(type(e).__name__, e)
+
 
 asyncio.run(main())
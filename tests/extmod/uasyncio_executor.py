@@ -0,0 +1,58 @@
+# Test running blocking functions with run_in_executor
+
+try:
+    import uasyncio as asyncio
+except ImportError:
+    try:
+        import asyncio
+    except ImportError:
+        print("SKIP")
+        raise SystemExit
+
+try:
+    asyncio.run_in_executor
+except AttributeError:
+    print("SKIP")
+    raise SystemExit
+
+import utime as time
+
+
+def blocking(x, ms):
+    time.sleep_ms(ms)
+    return x * 2
+
+
+def failing():
+    raise ValueError("failed")
+
+
+async def ticker(log):
+    for i in range(3):
+        log.append("tick")
+        await asyncio.sleep_ms(0)
+
+
+async def main():
+    asyncio.start_executor(workers=2)
+
+    # results and exceptions are passed back to the caller
+    print(await asyncio.run_in_executor(blocking, 21, 1))
+    try:
+        await asyncio.run_in_executor(failing)
+    except ValueError as er:
+        print("ValueError", er)
+
+    # other tasks get to run
+    log = []
+    t = asyncio.create_task(ticker(log))
+    print(await asyncio.run_in_executor(blocking, 1, 10))
+    await t
+    print(log)
+
+    # many jobs at once
+    res = await asyncio.gather(*(asyncio.run_in_executor(blocking, i, 1) for i in range(10)))
+    print(res)
+
+
+asyncio.run(main())
@@ -0,0 +1,119 @@
+# Test AsyncFile streams
+
+try:
+    import uasyncio as asyncio
+    import uio as io
+except ImportError:
+    try:
+        import asyncio, io
+    except ImportError:
+        print("SKIP")
+        raise SystemExit
+
+try:
+    asyncio.AsyncFile
+except AttributeError:
+    print("SKIP")
+    raise SystemExit
+
+import utime as time
+
+
+# A file-like object where every operation is slow, and which records them
+class SlowFile:
+    def __init__(self, data=b""):
+        self.f = io.BytesIO(data)
+        self.ops = []
+
+    def _op(self, name):
+        self.ops.append(name)
+        time.sleep_ms(5)
+
+    def read(self, n=-1):
+        self._op("read")
+        return self.f.read(n)
+
+    def readinto(self, buf):
+        self._op("readinto")
+        return self.f.readinto(buf)
+
+    def readline(self):
+        self._op("readline")
+        return self.f.readline()
+
+    def write(self, buf):
+        self._op("write")
+        return self.f.write(buf)
+
+    def flush(self):
+        self._op("flush")
+
+    def seek(self, offset, whence=0):
+        return self.f.seek(offset, whence)
+
+    def tell(self):
+        return self.f.tell()
+
+    def close(self):
+        self._op("close")
+
+    def getvalue(self):
+        return self.f.getvalue()
+
+
+ticks = 0
+
+
+async def ticker():
+    global ticks
+    while True:
+        ticks += 1
+        await asyncio.sleep_ms(1)
+
+
+async def main():
+    global ticks
+    t = asyncio.create_task(ticker())
+    await asyncio.sleep_ms(0)
+
+    # reading
+    sf = SlowFile(bytes(range(256)) * 8 + b"line1\nline2\n")
+    af = asyncio.AsyncFile(sf, chunk=512)
+    ticks = 0
+    data = await af.read(2048)
+    print(len(data), data == bytes(range(256)) * 8, ticks > 0)
+    print(await af.readline(), await af.readline(), await af.readline())
+    af.seek(100)
+    print(af.tell())
+    buf = bytearray(1000)
+    print(await af.readinto(buf), buf[0], buf[-1])
+    af.seek(0)
+    print(len(await af.read()))
+    print(await af.read(), await af.read(0))
+
+    # writing
+    sf = SlowFile()
+    ticks = 0
+    async with asyncio.AsyncFile(sf, chunk=100) as af:
+        af.write(b"x" * 1000)
+        af.write("text")
+        print(len(sf.getvalue()))
+        await af.drain()
+        print(len(sf.getvalue()), sf.getvalue()[-5:], ticks > 0)
+        af.write(b"end")
+        await af.flush()
+        print(sf.getvalue()[-7:], sf.ops[-1])
+    print(sf.ops[-1])
+
+    # errors from the operation are raised in the calling task
+    sf = SlowFile()
+    sf.read = None
+    try:
+        await asyncio.AsyncFile(sf).read(10)
+    except TypeError:
+        print("TypeError")
+
+    t.cancel()
+
+
+asyncio.run(main())
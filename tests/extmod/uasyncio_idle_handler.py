@@ -0,0 +1,90 @@
+# Test Loop.set_idle_handler, which is called with the time until the next task
+# is due when the loop has nothing else to wait for
+
+try:
+    import uasyncio as asyncio
+    import utime
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+loop = asyncio.get_event_loop()
+if not hasattr(loop, "set_idle_handler"):
+    print("SKIP")
+    raise SystemExit
+
+calls = []
+
+
+def idle(ms):
+    calls.append(ms)
+    utime.sleep_ms(ms)
+
+
+def idle_short(ms):
+    # returning before the deadline is allowed, the handler is called again
+    calls.append(ms)
+    utime.sleep_ms(1)
+
+
+async def task(ms):
+    await asyncio.sleep_ms(ms)
+    print("task", ms)
+
+
+async def main():
+    t0 = utime.ticks_ms()
+    await asyncio.sleep(0)
+    print("no wait", calls)
+    await asyncio.gather(task(20), task(50))
+    print(utime.ticks_diff(utime.ticks_ms(), t0) >= 50)
+    print(len(calls) >= 2, all(0 < ms <= 50 for ms in calls))
+
+
+loop.set_idle_handler(idle)
+print(loop.get_idle_handler() is idle)
+asyncio.run(main())
+
+calls.clear()
+loop.set_idle_handler(idle_short)
+asyncio.run(main())
+print(len(calls) > 10)
+
+# the handler is given the time less the latency, and isn't called for shorter waits
+calls.clear()
+loop.set_idle_handler(idle, 10)
+asyncio.run(main())
+print(all(ms <= 40 for ms in calls))
+
+# with io=True the handler is also called while streams are waited on, with -1
+# if no task is due, and a stream that becomes ready wakes the loop
+try:
+    import usocket
+except ImportError:
+    usocket = None
+if usocket:
+    s = usocket.socket(usocket.AF_INET, usocket.SOCK_DGRAM)
+    addr = usocket.getaddrinfo("127.0.0.1", 8003)[0][-1]
+    s.bind(addr)
+    s.setblocking(False)
+
+    def idle_io(ms):
+        calls.append(ms)
+        if ms < 0:
+            # no task is due, so a datagram arriving is all that can wake the loop
+            s.sendto(b"wake", addr)
+
+    async def reader():
+        print("read", await asyncio.StreamReader(s).read(8))
+
+    calls.clear()
+    loop.set_idle_handler(idle_io, 0, True)
+    asyncio.run(reader())
+    print(calls)
+    s.close()
+else:
+    print("read b'wake'")
+    print([-1])
+
+loop.set_idle_handler(None)
+print(loop.get_idle_handler())
@@ -0,0 +1,39 @@
+# Test that many sleeping tasks wake in order of their deadlines, with some cancelled
+
+try:
+    from utime import ticks_diff
+    import uasyncio as asyncio
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+order = []
+
+
+async def sleeper(i, ms):
+    await asyncio.sleep_ms(ms)
+    order.append(i)
+
+
+async def main():
+    # deadlines from after the tasks have all started to well beyond a second,
+    # created out of order
+    delays = [200 + (i * 37) % 101 * 13 for i in range(101)]
+    ts = [asyncio.create_task(sleeper(i, d)) for i, d in enumerate(delays)]
+    await asyncio.sleep_ms(20)
+    # Each task's deadline is counted from when it started to sleep, which
+    # under load may be later for one than another, so the expected order is
+    # taken from the deadlines the tasks are actually waiting for.
+    t0 = ts[0].ph_key
+    deadlines = [ticks_diff(t.ph_key, t0) for t in ts]
+    cancelled = [t.cancel() for t in ts[::3]]
+    for t in ts:
+        try:
+            await t
+        except asyncio.CancelledError:
+            pass
+    kept = [i for i in range(len(ts)) if i % 3 or not cancelled[i // 3]]
+    print(len(order) > 60, order == sorted(kept, key=lambda i: (deadlines[i], i)))
+
+
+asyncio.run(main())
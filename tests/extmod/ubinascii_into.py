@@ -0,0 +1,56 @@
+# test ubinascii functions that write into a buffer, and the streaming codecs
+
+try:
+    import ubinascii
+
+    ubinascii.a2b_base64_into
+except (ImportError, AttributeError):
+    print("SKIP")
+    raise SystemExit
+
+buf = bytearray(16)
+print(ubinascii.hexlify_into(b"\x01\xab\xff", buf), buf[:6])
+print(ubinascii.hexlify_into(b"\x01\xab\xff", buf, ":"), buf[:8])
+print(ubinascii.unhexlify_into(b"01abFF", buf), buf[:3])
+print(ubinascii.b2a_base64_into(b"hello", buf), buf[:8])
+print(ubinascii.a2b_base64_into(b"aGVsbG8=", buf), buf[:5])
+print(ubinascii.a2b_base64_into(b"aGVs\nbG8=", memoryview(buf)[4:]), buf[4:9])
+
+# the buffer must be large enough
+for f, arg in (
+    (ubinascii.hexlify_into, b"12345678"),
+    (ubinascii.b2a_base64_into, b"1234567890123"),
+    (ubinascii.a2b_base64_into, b"MTIzNDU2Nzg5MDEyMzQ1Njc4"),
+):
+    try:
+        f(arg, bytearray(15))
+    except ValueError as er:
+        print(er)
+try:
+    ubinascii.a2b_base64_into(b"aGVsbG8", buf)
+except ValueError as er:
+    print(er)
+
+print(ubinascii.b2a_base64(b"hello", newline=False))
+
+# streaming encoder, in pieces of every size
+data = bytes(range(40))
+for n in range(1, 8):
+    enc = ubinascii.Base64Encoder()
+    out = b"".join(enc.update(data[i : i + n]) for i in range(0, len(data), n))
+    out += enc.finish()
+    print(n, out == ubinascii.b2a_base64(data, newline=False))
+
+# streaming decoder
+enc = ubinascii.b2a_base64(data)
+for n in range(1, 8):
+    dec = ubinascii.Base64Decoder()
+    out = b"".join(dec.update(enc[i : i + n]) for i in range(0, len(enc), n))
+    out += dec.finish()
+    print(n, out == data)
+dec = ubinascii.Base64Decoder()
+print(dec.update(b"aGVsbG"))
+try:
+    dec.finish()
+except ValueError as er:
+    print(er)
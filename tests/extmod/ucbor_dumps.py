@@ -0,0 +1,65 @@
+# test ucbor.dumps and ucbor.dump, against examples from RFC 8949 appendix A
+
+try:
+    import ucbor
+    from uio import BytesIO
+    from ubinascii import hexlify
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+for obj in (
+    0,
+    23,
+    24,
+    100,
+    1000,
+    1000000,
+    1000000000000,
+    18446744073709551615,
+    -1,
+    -10,
+    -1000,
+    -18446744073709551616,
+    False,
+    True,
+    None,
+    "",
+    "a",
+    "IETF",
+    "ü",
+    "水",
+    b"",
+    b"\x01\x02\x03\x04",
+    bytearray(b"ab"),
+    memoryview(b"xyz")[1:],
+    [],
+    (1, 2, 3),
+    [1, [2, 3], [4, 5]],
+    list(range(1, 26)),
+    {},
+    {1: 2, 3: 4},
+    {"a": 1},
+    ["a", {"b": "c"}],
+):
+    print(hexlify(ucbor.dumps(obj)))
+
+# too big for CBOR's 64-bit integers
+for n in (18446744073709551616, -18446744073709551617):
+    try:
+        ucbor.dumps(n)
+    except OverflowError:
+        print("OverflowError")
+
+# unsupported types
+for obj in (object(), {1, 2}, ucbor):
+    try:
+        ucbor.dumps(obj)
+    except TypeError:
+        print("TypeError")
+
+# dump writes the same encoding to a stream, including long items
+obj = {"k": list(range(200)), "b": b"\xaa" * 300, "s": "x" * 100}
+s = BytesIO()
+ucbor.dump(obj, s)
+print(s.getvalue() == ucbor.dumps(obj), len(s.getvalue()))
@@ -0,0 +1,16 @@
+# test ucbor.dumps with floats
+
+try:
+    import ucbor
+    from ubinascii import hexlify
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+# floats that are exact in single precision use the 4-byte encoding
+for f in (0.0, -0.0, 1.5, 100000.0, -4.0, float("inf"), float("-inf")):
+    print(hexlify(ucbor.dumps(f)))
+
+# others round trip
+for f in (0.1, 1e300, -1.1, 3.14159):
+    print(ucbor.loads(ucbor.dumps(f)) == f)
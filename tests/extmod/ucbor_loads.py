@@ -0,0 +1,94 @@
+# test ucbor.loads and ucbor.load
+
+try:
+    import ucbor
+    from uio import BytesIO
+    from ubinascii import unhexlify
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+# examples from RFC 8949 appendix A
+for h in (
+    "00",
+    "17",
+    "1818",
+    "1903e8",
+    "1a000f4240",
+    "1b000000e8d4a51000",
+    "1bffffffffffffffff",
+    "20",
+    "3903e7",
+    "3bffffffffffffffff",
+    "f4",
+    "f5",
+    "f6",
+    "f7",
+    "60",
+    "6449455446",
+    "62c3bc",
+    "40",
+    "4401020304",
+    "80",
+    "83010203",
+    "8301820203820405",
+    "a0",
+    "a201020304",
+    "a26161016162820203",
+    "826161a161626163",
+    # tags are skipped over
+    "c074323031332d30332d32315432303a30343a30305a",
+    "d82076687474703a2f2f7777772e6578616d706c652e636f6d",
+    # indefinite length items
+    "5f42010243030405ff",
+    "7f657374726561646d696e67ff",
+    "9fff",
+    "9f018202039f0405ffff",
+    "83018202039f0405ff",
+    "bf61610161629f0203ffff",
+    "bf6346756ef563416d7421ff",
+):
+    print(ucbor.loads(unhexlify(h)))
+
+# round trip of a telemetry-like record
+rec = {"id": 42, "t": 1618033988749, "v": [1, -2, 300000], "ok": True, "tag": "node-7", "raw": b"\x00\xff"}
+print(ucbor.loads(ucbor.dumps(rec)) == rec)
+
+# invalid data
+for h in (
+    "",
+    "18",
+    "1c",
+    "62c3",
+    "830102",
+    "a1616101a1",
+    "ff",
+    "f0",
+    "5f6161ff",
+    "9f01",
+    "0000",
+    "7a7fffffff",
+    "9b7fffffffffffffff",
+):
+    try:
+        ucbor.loads(unhexlify(h))
+    except ValueError:
+        print("ValueError", h)
+
+# load reads one item at a time from a stream
+s = BytesIO(ucbor.dumps([1, "two"]) + ucbor.dumps({"a": b"x"}) + ucbor.dumps(3))
+print(ucbor.load(s), ucbor.load(s), ucbor.load(s))
+try:
+    ucbor.load(s)
+except ValueError:
+    print("ValueError")
+
+# zero-copy decoding of byte strings
+data = ucbor.dumps([b"abc", "abc", {"k": b"\x01\x02"}])
+obj = ucbor.loads(data, zerocopy=True)
+print(type(obj[0]), bytes(obj[0]), type(obj[1]), bytes(obj[2]["k"]))
+try:
+    obj[0][0] = 1
+except TypeError:
+    print("TypeError")
+print(type(ucbor.loads(data)[0]))
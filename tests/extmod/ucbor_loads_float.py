@@ -0,0 +1,34 @@
+# test ucbor.loads with floats, against examples from RFC 8949 appendix A
+
+try:
+    import ucbor
+    from ubinascii import unhexlify
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+for h, f in (
+    ("f90000", 0.0),
+    ("f93c00", 1.0),
+    ("fb3ff199999999999a", 1.1),
+    ("f93e00", 1.5),
+    ("f97bff", 65504.0),
+    ("fa47c35000", 100000.0),
+    ("fb7e37e43c8800759c", 1e300),
+    ("f90001", 5.960464477539063e-08),
+    ("f90400", 6.103515625e-05),
+    ("f9c400", -4.0),
+    ("fbc010666666666666", -4.1),
+    ("f97c00", float("inf")),
+    ("f9fc00", float("-inf")),
+    ("fa7f800000", float("inf")),
+    ("fb7ff0000000000000", float("inf")),
+):
+    print(h, ucbor.loads(unhexlify(h)) == f)
+
+# negative zero
+print(str(ucbor.loads(unhexlify("f98000"))))
+
+# NaN
+x = ucbor.loads(unhexlify("f97e00"))
+print(x != x)
@@ -0,0 +1,23 @@
+# test that ucbor interns the short str keys of the dicts it decodes
+
+try:
+    import ucbor
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+recs = ucbor.loads(ucbor.dumps([{"cbor_id": 1, "cbor_name": "a"}, {"cbor_id": 2, "cbor_name": "b"}]))
+if list(recs[0])[0] is not list(recs[1])[0]:
+    print("SKIP")
+    raise SystemExit
+
+print(sorted(recs[0].items()), sorted(recs[1].items()))
+print([k1 is k2 for k1, k2 in zip(sorted(recs[0]), sorted(recs[1]))])
+
+# keys of indefinite-length maps are interned too
+d = ucbor.loads(b"\xbf\x67cbor_ix\x01\xff")
+print(d, list(d)[0] is list(ucbor.loads(b"\xa1\x67cbor_ix\x02"))[0])
+
+# values and keys that aren't str are not interned
+d = ucbor.loads(ucbor.dumps({1: "cbor_value", b"cbor_bytes": 2}))
+print(sorted(d.items(), key=repr))
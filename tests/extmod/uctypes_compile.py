@@ -0,0 +1,86 @@
+# test uctypes.compile and uctypes.unpack_all
+
+try:
+    import uctypes
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+if not hasattr(uctypes, "compile"):
+    print("SKIP")
+    raise SystemExit
+
+HEADER = {
+    "len": uctypes.UINT16 | 2,
+    "kind": uctypes.UINT8 | 0,
+    "flags": uctypes.UINT8 | 1,
+}
+
+DESC = {
+    "header": (0, HEADER),
+    "seq": uctypes.UINT32 | 4,
+    "hi": uctypes.BFUINT8 | 8 | 4 << uctypes.BF_POS | 4 << uctypes.BF_LEN,
+    "lo": uctypes.BFUINT8 | 8 | 0 << uctypes.BF_POS | 4 << uctypes.BF_LEN,
+    "arr": (uctypes.ARRAY | 10, uctypes.INT16 | 3),
+    "data": (uctypes.ARRAY | 16, uctypes.UINT8 | 4),
+    "items": (uctypes.ARRAY | 20, 2, {"a": uctypes.UINT8 | 0, "b": uctypes.INT8 | 1}),
+}
+
+buf = bytearray(b"\x01\x02\x34\x12\x78\x56\x34\x12\xab\x00\xff\xff\x02\x00\x03\x00abcd\x10\xf0\x20\xe0")
+CDESC = uctypes.compile(DESC)
+print(type(CDESC))
+print(uctypes.compile(CDESC) is CDESC)
+
+for layout in (uctypes.LITTLE_ENDIAN, uctypes.BIG_ENDIAN, uctypes.NATIVE):
+    s = uctypes.struct(uctypes.addressof(buf), DESC, layout)
+    c = uctypes.struct(uctypes.addressof(buf), CDESC, layout)
+    print(uctypes.sizeof(DESC, layout) == uctypes.sizeof(CDESC, layout), uctypes.sizeof(s) == uctypes.sizeof(c))
+    for v in (s, c):
+        print(v.header.len, v.header.kind, v.header.flags, v.seq, v.hi, v.lo)
+        print(v.arr[0], v.arr[2], bytes(v.data), v.items[0].a, v.items[1].b)
+
+c = uctypes.struct(uctypes.addressof(buf), CDESC, uctypes.LITTLE_ENDIAN)
+
+# aggregate fields are made once
+print(c.header is c.header, c.data is c.data)
+
+# stores go to memory through compiled descriptors too
+c.header.len = 0x1122
+c.seq = 7
+c.hi = 0xC
+c.arr[1] = -5
+c.data[0] = 0x41
+c.items[1].a = 9
+print(buf[:16], bytes(buf[20:]))
+
+try:
+    c.header = 1
+except TypeError:
+    print("TypeError")
+
+try:
+    c.missing
+except KeyError:
+    print("KeyError")
+
+# all scalar fields in order of offset
+print(uctypes.unpack_all(c))
+print(uctypes.unpack_all(c.header))
+print(uctypes.unpack_all(uctypes.struct(uctypes.addressof(buf), HEADER, uctypes.LITTLE_ENDIAN)))
+
+# descriptors reached through pointers aren't compiled, so they can be recursive
+NODE = {"val": uctypes.UINT32 | 0}
+NODE["next"] = (uctypes.PTR | 4, NODE)
+n = uctypes.struct(uctypes.addressof(buf), uctypes.compile(NODE), uctypes.LITTLE_ENDIAN)
+print(n.val)
+
+for bad in (1, (uctypes.PTR | 0, uctypes.UINT8), {"x": "y"}):
+    try:
+        uctypes.compile(bad)
+    except TypeError:
+        print("TypeError")
+
+try:
+    uctypes.unpack_all(c.arr)
+except TypeError:
+    print("TypeError")
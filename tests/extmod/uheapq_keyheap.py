@@ -0,0 +1,56 @@
+# test uheapq.KeyHeap, a heap ordered by int keys computed once per item
+
+try:
+    from uheapq import KeyHeap
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+h = KeyHeap(None)
+print(len(h), bool(h))
+try:
+    h.pop()
+except IndexError:
+    print("IndexError")
+try:
+    h.peek()
+except IndexError:
+    print("IndexError")
+try:
+    h.push("not an int")
+except TypeError:
+    print("TypeError")
+
+for x in (5, -3, 9, 0, 5, 2):
+    h.push(x)
+print(len(h), bool(h), h.peek(), h.peekkey())
+print([h.pop() for _ in range(len(h))])
+
+# the key is called once per item, and items with equal keys pop in the
+# order they were pushed
+calls = []
+
+
+def key(item):
+    calls.append(item[0])
+    return item[1]
+
+
+h = KeyHeap(key)
+for item in [("a", 3), ("b", 1), ("c", 3), ("d", 2), ("e", 1), ("f", 3)]:
+    h.push(item)
+print(calls, h.peekkey())
+print([h.pop()[0] for _ in range(len(h))])
+print(len(calls))
+
+# heapify an iterable in place, then keep using the heap
+h = KeyHeap(lambda s: len(s), ["ccc", "a", "bb", "dddd", "", "ee"])
+h.push("fff")
+out = []
+while h:
+    out.append(h.pop())
+print(out)
+
+# large keys
+h = KeyHeap(None, [1 << 30, -(1 << 30), 0])
+print(h.pop(), h.pop(), h.pop())
@@ -0,0 +1,49 @@
+# test uheapq.nsmallest, nlargest and merge
+
+try:
+    import uheapq as heapq
+except ImportError:
+    try:
+        import heapq
+    except ImportError:
+        print("SKIP")
+        raise SystemExit
+
+try:
+    heapq.nsmallest
+except AttributeError:
+    print("SKIP")
+    raise SystemExit
+
+data = [5, 1, 9, 3, 7, 3, 8, 2, 6, 0, 4]
+for n in (-1, 0, 1, 3, 11, 20):
+    print(n, heapq.nsmallest(n, data), heapq.nlargest(n, data))
+print(heapq.nsmallest(3, iter(data)), heapq.nlargest(2, range(10)))
+print(heapq.nsmallest(3, []), heapq.nlargest(3, ()))
+
+# with a key, ties keep their original order
+words = ["pear", "fig", "apple", "kiwi", "plum", "date", "banana"]
+print(heapq.nsmallest(4, words, key=len))
+print(heapq.nlargest(4, words, key=len))
+pairs = [(i % 3, i) for i in range(10)]
+print(heapq.nsmallest(5, pairs, key=lambda p: p[0]))
+print(heapq.nlargest(5, pairs, key=lambda p: p[0]))
+
+# merge
+print(list(heapq.merge()))
+print(list(heapq.merge([1, 4, 7], [2, 5, 8], [3, 6, 9])))
+print(list(heapq.merge([], [1, 1], [], [0, 1, 2])))
+print(list(heapq.merge([1, 3], (x * 2 for x in range(4)))))
+print(list(heapq.merge(["b", "ccc"], ["a", "dd"], key=len)))
+print(list(heapq.merge([9, 5, 1], [8, 4], [7, 7], reverse=True)))
+print(list(heapq.merge([(1, "a"), (2, "a")], [(1, "b"), (2, "b")], key=lambda t: t[0])))
+
+# merge doesn't start the iterables until it's iterated over
+def gen(name, values):
+    print("start", name)
+    yield from values
+
+
+m = heapq.merge(gen("a", [1, 3]), gen("b", [2]))
+print("created")
+print(next(m), list(m))
@@ -17,6 +17,13 @@ s = StringIO()
 json.dump({"a": (2, [3, None])}, s)
 print(s.getvalue())
 
+# output larger than the internal chunk, including a single long string
+obj = {"k%d" % i: [i, "v" * i] for i in range(40)}
+obj["long"] = "x" * 300
+s = StringIO()
+json.dump(obj, s)
+print(s.getvalue() == json.dumps(obj), len(s.getvalue()))
+
 # dump to a small-int not allowed
 try:
     json.dump(123, 1)
@@ -0,0 +1,42 @@
+# test ujson.iterload, which parses the top-level list or dict one item at a time
+
+try:
+    from uio import StringIO
+    import ujson as json
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+if not hasattr(json, "iterload"):
+    print("SKIP")
+    raise SystemExit
+
+# items of a top-level list
+for item in json.iterload(StringIO('[1, "two", [3, [4]], {"five": 5}, null, true]')):
+    print(item)
+
+# a top-level dict gives (key, value) pairs
+for item in json.iterload(StringIO(' {"a": 1, "b": {"c": [2, 3]}, "d": {}} ')):
+    print(item)
+
+# empty containers
+print(list(json.iterload(StringIO("[]"))))
+print(list(json.iterload(StringIO("{ }"))))
+
+# object_hook applies to nested dicts
+print(list(json.iterload(StringIO('[{"a": 1}, [{"b": 2}]]'), object_hook=sorted)))
+
+# items come out before the rest of the stream is looked at
+it = json.iterload(StringIO("[1, 2, x"))
+print(next(it), next(it))
+try:
+    next(it)
+except ValueError:
+    print("ValueError")
+
+# malformed streams
+for s in ("", "1", '"a"', "[1, 2", '{"a"}', '{"a": 1', "[1] 2", "[[1]"):
+    try:
+        print(list(json.iterload(StringIO(s))))
+    except ValueError:
+        print("ValueError", repr(s))
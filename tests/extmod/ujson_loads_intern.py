@@ -0,0 +1,35 @@
+# test that ujson interns the short str keys of the dicts it decodes
+
+try:
+    import ujson as json
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+
+def key(s):
+    return list(json.loads(s))[0]
+
+
+# keys of separate decodes are the same object if they are interned
+if key('{"probe_key": 0}') is not key('{"probe_key": 1}'):
+    print("SKIP")
+    raise SystemExit
+
+# records share their keys
+recs = json.loads('[{"rec_id": 1, "rec_name": "a"}, {"rec_id": 2, "rec_name": "b"}]')
+print(sorted(recs[0].items()), sorted(recs[1].items()))
+print([k1 is k2 for k1, k2 in zip(sorted(recs[0]), sorted(recs[1]))])
+print(recs[1]["rec_id"], recs[0]["rec_name"])
+
+# values, list items and long keys are not interned
+print(json.loads('["item_x"]')[0] is json.loads('["item_x"]')[0])
+print(json.loads('{"k": "value_x"}')["k"] is json.loads('{"k": "value_x"}')["k"])
+long_key = '{"a_key_that_is_too_long_to_intern": 0}'
+print(key(long_key) is key(long_key), key(long_key) == "a_key_that_is_too_long_to_intern")
+
+# only a bounded number of new keys are interned
+json.loads("{%s}" % ", ".join('"many_%d": 0' % i for i in range(1000)))
+print(key('{"many_0": 0}') is key('{"many_0": 1}'))
+print(key('{"many_999": 0}') is key('{"many_999": 1}'))
+print(key('{"after_many": 0}') is key('{"after_many": 1}'), key('{"after_many": 0}'))
@@ -0,0 +1,39 @@
+# test the object_hook argument to ujson.load and ujson.loads
+
+try:
+    from uio import StringIO
+    import ujson as json
+except ImportError:
+    try:
+        from io import StringIO
+        import json
+    except ImportError:
+        print("SKIP")
+        raise SystemExit
+
+try:
+    json.loads("{}", object_hook=None)
+except TypeError:
+    print("SKIP")
+    raise SystemExit
+
+# the hook is called with each dict once it's complete, innermost first
+def hook(d):
+    print("hook", sorted(d.items()))
+    return d
+
+
+print(json.loads('{"a": {"b": 1}, "c": [{"d": 2}, {}]}', object_hook=hook) is not None)
+
+# the result of the hook replaces the dict, so it can filter keys
+def keep_id(d):
+    return {k: v for k, v in d.items() if k == "id"}
+
+
+print(json.loads('[{"id": 1, "x": "big"}, {"id": 2, "y": [1, 2, 3]}]', object_hook=keep_id))
+print(json.load(StringIO('{"id": 0, "sub": {"id": 3, "z": 1}}'), object_hook=lambda d: d.get("id")))
+print(json.loads('{"a": {"b": {"c": {}}}}', object_hook=len))
+
+# lists and scalars are not passed to the hook
+print(json.loads("[1, [2, 3]]", object_hook=keep_id))
+print(json.loads("1", object_hook=keep_id))
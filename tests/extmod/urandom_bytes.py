@@ -0,0 +1,50 @@
+# test urandom.randbytes_into
+
+try:
+    import urandom as random
+except ImportError:
+    try:
+        import random
+    except ImportError:
+        print("SKIP")
+        raise SystemExit
+
+try:
+    random.randbytes_into
+except AttributeError:
+    print("SKIP")
+    raise SystemExit
+
+# fills the whole buffer, for lengths that are and aren't a multiple of 4
+for n in range(10):
+    buf = bytearray(n)
+    print(n, random.randbytes_into(buf), len(buf))
+
+# all byte values appear, in every position of a word
+buf = bytearray(4096)
+random.randbytes_into(buf)
+for i in range(4):
+    print(len(set(buf[j] for j in range(i, len(buf), 4))) > 200)
+
+# the output depends on the seed
+random.seed(1)
+a = bytearray(7)
+random.randbytes_into(a)
+random.seed(1)
+b = bytearray(7)
+random.randbytes_into(b)
+random.seed(2)
+c = bytearray(7)
+random.randbytes_into(c)
+print(a == b, a == c)
+
+# a memoryview slice is filled in place
+buf = bytearray(8)
+random.randbytes_into(memoryview(buf)[2:4])
+print(buf[:2], buf[4:])
+
+# the buffer must be writable
+try:
+    random.randbytes_into(b"1234")
+except TypeError:
+    print("TypeError")
@@ -0,0 +1,39 @@
+try:
+    import ure as re
+except ImportError:
+    try:
+        import re
+    except ImportError:
+        print("SKIP")
+        raise SystemExit
+
+try:
+    re.finditer
+except AttributeError:
+    print("SKIP")
+    raise SystemExit
+
+
+def print_matches(it):
+    print([m.group(0) for m in it])
+
+
+print_matches(re.finditer("[0-9]+", "t=12 h=40 p=1013"))
+print_matches(re.finditer("x", "abc"))
+print_matches(re.finditer("a*", "baaa"))
+print_matches(re.finditer("a*", "aab"))
+print_matches(re.finditer("", "ab"))
+print_matches(re.finditer(b"[a-c]", b"xaybzc"))
+
+r = re.compile("([a-z]+)=([0-9]+)")
+for m in r.finditer("t=12, h=40"):
+    print(m.group(1), m.group(2))
+
+# Matching is done as the iterator is advanced
+it = r.finditer("a=1 b=2")
+print(next(it).group(0))
+print(next(it).group(0))
+try:
+    next(it)
+except StopIteration:
+    print("StopIteration")
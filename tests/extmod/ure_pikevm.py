@@ -0,0 +1,40 @@
+# Test patterns which need the non-backtracking (Pike VM) engine
+
+try:
+    import ure as re
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+try:
+    re.match("(a*)*", "aaa")
+except RuntimeError:
+    # Backtracking engine, see ure_stack_overflow.py
+    print("SKIP")
+    raise SystemExit
+
+# Empty loops
+print(re.match("(a*)*", "aaa").group(0))
+print(re.match("(a|)*b", "aab").group(0))
+
+# Exponential for a backtracking engine
+print(re.match("(a*)*b", "a" * 30))
+print(re.search("(x+x+)+y", "x" * 30))
+print(re.match("(a|aa)+$", "a" * 40).group(0) == "a" * 40)
+
+# Long subjects don't recurse on the C stack
+print(len(re.match("(ab)*", "ab" * 5000).group(0)))
+print(len(re.match(".*c", "x" * 20000 + "c").group(0)))
+
+# Priorities are the same as for backtracking
+m = re.match("(a+?)(a*)", "aaa")
+print(m.group(1), m.group(2))
+m = re.match("(a|ab)(c|bcd)(d*)", "abcd")
+print(m.group(1), m.group(2), m.group(3))
+print(re.search("a|ab", "xab").group(0))
+
+# Searching with a literal first char
+print(re.search("b+c", "aaabbbc").group(0))
+print(re.search("bc", "aaabbb"))
+print(re.search("^b", "ab"))
+print(re.search("b$", "abab").group(0))
@@ -11,3 +11,7 @@ try:
     re.match("(a*)*", "aaa")
 except RuntimeError:
     print("RuntimeError")
+else:
+    # Not a backtracking engine, see ure_pikevm.py
+    print("SKIP")
+    raise SystemExit
@@ -0,0 +1,85 @@
+# test usocket.Pool of idle connections
+
+try:
+    import uio, utime, usocket
+
+    uio.IOBase
+    usocket.Pool
+except (ImportError, AttributeError):
+    print("SKIP")
+    raise SystemExit
+
+
+class Conn(uio.IOBase):
+    def __init__(self, name):
+        self.name = name
+        self.readable = False
+
+    def ioctl(self, req, arg):
+        if req == 3:  # MP_STREAM_POLL
+            return arg & 1 if self.readable else 0
+        if req == 4:  # MP_STREAM_CLOSE
+            print("close", self.name)
+        return 0
+
+    def __repr__(self):
+        return "<Conn %s>" % self.name
+
+
+key_a = ("a.example", 80, False)
+key_b = ("b.example", 443, True)
+
+p = usocket.Pool(size=3)
+print(len(p), bool(p))
+print(p.get(key_a))
+
+# a connection is taken out by get
+p.put(key_a, Conn("a1"))
+print(len(p), bool(p))
+print(p.get(("a.example", 80, False)))
+print(len(p), p.get(key_a))
+
+# the key must match, and the newest connection is taken first
+p.put(key_a, Conn("a1"))
+p.put(key_b, Conn("b1"))
+p.put(key_a, Conn("a2"))
+print(p.get(key_b), p.get(key_b))
+print(p.get(key_a), p.get(key_a), len(p))
+
+# a connection that polls as readable was closed by the peer, so is dropped
+c = Conn("a3")
+p.put(key_a, Conn("a1"))
+p.put(key_a, c)
+c.readable = True
+print(p.get(key_a), len(p))
+
+# a full pool closes its oldest connection
+p = usocket.Pool(size=2)
+p.put(key_a, Conn("a1"))
+p.put(key_a, Conn("a2"))
+p.put(key_b, Conn("b1"))
+print(p.get(key_a), p.get(key_a))
+
+# close closes everything
+p.put(key_a, Conn("a3"))
+p.close()
+print(len(p))
+
+# connections idle for too long are closed
+p = usocket.Pool(idle_ms=50)
+p.put(key_a, Conn("a1"))
+utime.sleep_ms(100)
+p.put(key_b, Conn("b1"))
+print(len(p), p.get(key_a))
+
+# only streams can be put in the pool
+try:
+    p.put(key_a, 1)
+except OSError:
+    print("OSError")
+
+# invalid arguments
+try:
+    usocket.Pool(size=0)
+except ValueError:
+    print("ValueError")
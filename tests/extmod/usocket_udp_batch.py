@@ -0,0 +1,48 @@
+# test sending and receiving batches of UDP datagrams
+
+try:
+    import usocket as socket
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+s = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+if not hasattr(s, "recvfrom_into_many"):
+    print("SKIP")
+    raise SystemExit
+
+addr = socket.getaddrinfo("127.0.0.1", 8001)[0][-1]
+s.bind(addr)
+s.settimeout(1)
+
+# all datagrams to the same address
+print(s.sendto_many([b"one", b"two", bytearray(b"three")], addr))
+
+# more buffers than datagrams waiting
+bufs = [bytearray(8) for _ in range(4)]
+addrs = [None] * 4
+sizes = s.recvfrom_into_many(bufs, addrs)
+print(sizes)
+for buf, size in zip(bufs, sizes):
+    print(buf[:size])
+print(addrs[0] == addrs[2], addrs[3])
+
+# an address for each datagram, and a datagram larger than its buffer
+print(s.sendto_many([b"four", b"fivefivefive"], [addr, addr]))
+bufs = [bytearray(4), memoryview(bytearray(6))]
+print(s.recvfrom_into_many(bufs), [bytes(b) for b in bufs])
+
+# nothing waiting
+s.settimeout(0)
+try:
+    s.recvfrom_into_many(bufs)
+except OSError:
+    print("OSError")
+
+# the list of addresses must match the datagrams
+try:
+    s.sendto_many([b"six"], [addr, addr])
+except ValueError:
+    print("ValueError")
+
+s.close()
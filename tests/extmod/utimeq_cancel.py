@@ -0,0 +1,55 @@
+# test cancelling utimeq entries by the handle that push() returns
+
+try:
+    from utimeq import utimeq
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+h = utimeq(10)
+handles = {}
+for t in (50, 10, 40, 20, 30, 60):
+    handles[t] = h.push(t, t, None)
+print(len(set(handles.values())))
+
+# cancel the head, one in the middle, and the last pushed
+print(h.cancel(handles[10]), h.cancel(handles[40]), h.cancel(handles[60]))
+print(h.cancel(handles[10]), len(h))
+
+res = [0, 0, 0]
+out = []
+while h:
+    h.pop(res)
+    out.append(res[1])
+print(out)
+
+# a cancelled slot can be reused
+h.push(5, "a", None)
+hb = h.push(5, "b", None)
+h.push(5, "c", None)
+h.cancel(hb)
+h.pop(res)
+print(res[1], end=" ")
+h.pop(res)
+print(res[1], len(h))
+
+# cancel in random order from a full queue, checking the order stays right
+import urandom
+
+urandom.seed(1)
+for trial in range(20):
+    h = utimeq(10)
+    hs = [(h.push(urandom.getrandbits(8), i, None), i) for i in range(10)]
+    kept = []
+    for hd, i in hs:
+        if urandom.getrandbits(1):
+            h.cancel(hd)
+        else:
+            kept.append(i)
+    times = []
+    while h:
+        h.pop(res)
+        times.append(res[0])
+    assert times == sorted(times), times
+    assert len(times) == len(kept)
+print("OK")
@@ -0,0 +1,50 @@
+try:
+    import uzlib as zlib
+    import uio as io
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+try:
+    zlib.compress
+except AttributeError:
+    print("SKIP")
+    raise SystemExit
+
+data = b"temp=23.5 humidity=40 " * 40 + bytes(range(256)) + b"temp=23.5 humidity=40 " * 40
+
+# Round trip for raw deflate, zlib and gzip streams, with various windows and levels
+for wbits in (-9, -15, 9, 10, 15, 25, 31):
+    for level in (-1, 0, 1, 9):
+        comp = zlib.compress(data, level, wbits)
+        if wbits < 16:
+            print(wbits, level, zlib.decompress(comp, wbits) == data, len(comp) < len(data))
+        out = zlib.DecompIO(io.BytesIO(comp), wbits).read()
+        print(wbits, level, out == data)
+
+# Empty input
+print(zlib.decompress(zlib.compress(b"")))
+
+# Stream compression, closed by the with statement
+buf = io.BytesIO()
+with zlib.CompressIO(buf, 10) as f:
+    for i in range(0, len(data), 13):
+        f.write(data[i : i + 13])
+print(zlib.decompress(buf.getvalue()) == data)
+
+# Writing after close
+try:
+    f.write(b"x")
+except OSError:
+    print("OSError")
+
+# Invalid arguments
+for args in ((8,), (16,), (-16,), (32,)):
+    try:
+        zlib.CompressIO(io.BytesIO(), *args)
+    except ValueError:
+        print("ValueError")
+try:
+    zlib.compress(b"", 10)
+except ValueError:
+    print("ValueError")
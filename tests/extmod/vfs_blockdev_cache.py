@@ -0,0 +1,96 @@
+# Test the block cache beneath VfsFat and VfsLfs2 using a RAM device
+
+try:
+    import uos
+
+    uos.VfsFat
+    uos.VfsLfs2
+except (ImportError, AttributeError):
+    print("SKIP")
+    raise SystemExit
+
+
+class RAMBlockDevice:
+    def __init__(self, block_size, blocks):
+        self.block_size = block_size
+        self.data = bytearray(block_size * blocks)
+        self.reads = 0
+        self.writes = 0
+        self.written = 0
+
+    def readblocks(self, block, buf, off=0):
+        self.reads += 1
+        addr = block * self.block_size + off
+        buf[:] = self.data[addr : addr + len(buf)]
+
+    def writeblocks(self, block, buf, off=None):
+        self.writes += 1
+        self.written += len(buf)
+        if off is None:
+            off = 0
+        addr = block * self.block_size + off
+        self.data[addr : addr + len(buf)] = buf
+
+    def ioctl(self, op, arg):
+        if op == 4:  # block count
+            return len(self.data) // self.block_size
+        if op == 5:  # block size
+            return self.block_size
+        if op == 6:  # erase block
+            return 0
+
+
+# check the port has the block cache
+bdev = RAMBlockDevice(1024, 30)
+uos.VfsLfs2.mkfs(bdev)
+try:
+    uos.VfsLfs2(bdev, cache=True)
+except TypeError:
+    print("SKIP")
+    raise SystemExit
+
+
+def test(vfs, bdev, coalesce):
+    for i in range(5):
+        with vfs.open("f%d" % i, "w") as f:
+            f.write("x%d" % i * 100)
+    print(sorted(vfs.ilistdir()) == sorted(vfs.ilistdir()))
+    bdev.reads = 0
+    print(sorted(x[0] for x in vfs.ilistdir()), vfs.stat("f3")[6])
+    print("cached", bdev.reads == 0)
+    with vfs.open("f1", "r") as f:
+        print(f.read(8))
+
+    # a large write reaches the device and is read back correctly
+    data = bytes(range(256)) * 40
+    bdev.writes = bdev.written = 0
+    with vfs.open("big", "wb") as f:
+        f.write(data)
+    if coalesce:
+        # whole blocks are written in runs
+        print("writes", bdev.writes <= bdev.written // bdev.block_size)
+    with vfs.open("big", "rb") as f:
+        print(f.read() == data)
+
+
+# FAT, cached by default
+bdev = RAMBlockDevice(512, 64)
+uos.VfsFat.mkfs(bdev)
+vfs = uos.VfsFat(bdev)
+test(vfs, bdev, True)
+uos.mount(vfs, "/ramdisk")
+uos.umount("/ramdisk")
+
+# everything reached the device, so a new instance sees the same files
+vfs = uos.VfsFat(bdev)
+print(sorted(x[0] for x in vfs.ilistdir()))
+with vfs.open("f4", "r") as f:
+    print(f.read(6))
+
+# littlefs with the cache enabled
+bdev = RAMBlockDevice(1024, 40)
+uos.VfsLfs2.mkfs(bdev)
+vfs = uos.VfsLfs2(bdev, cache=True)
+test(vfs, bdev, False)
+vfs = uos.VfsLfs2(bdev)
+print(sorted(x[0] for x in vfs.ilistdir()))
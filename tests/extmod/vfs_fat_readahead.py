@@ -0,0 +1,86 @@
+# Test VfsFat reading ahead when a file is read sequentially in small pieces
+
+try:
+    import uos
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+try:
+    uos.VfsFat
+except AttributeError:
+    print("SKIP")
+    raise SystemExit
+
+
+class RAMBlockDevice:
+    SEC_SIZE = 512
+
+    def __init__(self, blocks):
+        self.data = bytearray(blocks * self.SEC_SIZE)
+        self.reads = []
+
+    def readblocks(self, n, buf):
+        self.reads.append((n, len(buf) // self.SEC_SIZE))
+        buf[:] = self.data[n * self.SEC_SIZE : n * self.SEC_SIZE + len(buf)]
+
+    def writeblocks(self, n, buf):
+        self.data[n * self.SEC_SIZE : n * self.SEC_SIZE + len(buf)] = buf
+
+    def ioctl(self, op, arg):
+        if op == 4:  # MP_BLOCKDEV_IOCTL_BLOCK_COUNT
+            return len(self.data) // self.SEC_SIZE
+        if op == 5:  # MP_BLOCKDEV_IOCTL_BLOCK_SIZE
+            return self.SEC_SIZE
+
+
+try:
+    bdev = RAMBlockDevice(100)
+except MemoryError:
+    print("SKIP")
+    raise SystemExit
+
+uos.VfsFat.mkfs(bdev)
+vfs = uos.VfsFat(bdev)
+uos.mount(vfs, "/ramdisk")
+
+data = bytes(i * 7 & 0xFF for i in range(10000))
+with open("/ramdisk/file", "wb") as f:
+    f.write(data)
+
+# read in small pieces, which the device sees as fewer multi-block reads
+uos.umount("/ramdisk")
+uos.mount(vfs, "/ramdisk")
+bdev.reads = []
+with open("/ramdisk/file", "rb") as f:
+    buf = b""
+    while True:
+        b = f.read(100)
+        if not b:
+            break
+        buf += b
+print(buf == data)
+print(len(bdev.reads) < 10000 // 512, max(n for _, n in bdev.reads) > 1)
+
+# data read ahead is replaced by data written to the same sectors
+with open("/ramdisk/file", "r+b") as f:
+    print(f.read(100) == data[:100])
+    f.seek(2000)
+    f.write(b"x" * 100)
+    f.flush()
+    f.seek(1900)
+    print(f.read(300) == data[1900:2000] + b"x" * 100 + data[2100:2200])
+with open("/ramdisk/file", "rb") as f:
+    f.seek(1950)
+    print(f.read(100) == data[1950:2000] + b"x" * 50)
+
+# reading the end of the file and a second file doesn't fail
+with open("/ramdisk/file2", "wb") as f:
+    f.write(b"hello")
+with open("/ramdisk/file", "rb") as f:
+    f.seek(9950)
+    print(len(f.read(100)))
+with open("/ramdisk/file2", "rb") as f:
+    print(f.read())
+
+uos.umount("/ramdisk")
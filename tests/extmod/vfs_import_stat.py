@@ -0,0 +1,108 @@
+# Test that imports from a mounted filesystem see changes made through uos
+
+try:
+    import usys as sys
+    import uos
+
+    uos.VfsLfs2
+except (ImportError, AttributeError):
+    print("SKIP")
+    raise SystemExit
+
+
+class RAMBlockDevice:
+    ERASE_BLOCK_SIZE = 1024
+
+    def __init__(self, blocks):
+        self.data = bytearray(blocks * self.ERASE_BLOCK_SIZE)
+        self.reads = 0
+
+    def readblocks(self, block, buf, off=0):
+        self.reads += 1
+        addr = block * self.ERASE_BLOCK_SIZE + off
+        buf[:] = self.data[addr : addr + len(buf)]
+
+    def writeblocks(self, block, buf, off=0):
+        addr = block * self.ERASE_BLOCK_SIZE + off
+        self.data[addr : addr + len(buf)] = buf
+
+    def ioctl(self, op, arg):
+        if op == 4:  # block count
+            return len(self.data) // self.ERASE_BLOCK_SIZE
+        if op == 5:  # block size
+            return self.ERASE_BLOCK_SIZE
+        if op == 6:  # erase block
+            return 0
+
+
+def try_import(name):
+    try:
+        __import__(name)
+    except ImportError:
+        print(name, "not found")
+    sys.modules.pop(name, None)
+
+
+bdev = RAMBlockDevice(30)
+uos.VfsLfs2.mkfs(bdev)
+uos.mount(uos.VfsLfs2(bdev), "/lfs")
+sys.path.insert(0, "/lfs")
+
+# a module that doesn't exist
+try_import("mod1")
+try_import("mod1")
+
+# create it
+with open("/lfs/mod1.py", "w") as f:
+    f.write('print("mod1")\n')
+try_import("mod1")
+
+# replace it by a package
+uos.remove("/lfs/mod1.py")
+try_import("mod1")
+uos.mkdir("/lfs/mod1")
+with open("/lfs/mod1/__init__.py", "w") as f:
+    f.write('print("package mod1")\n')
+try_import("mod1")
+
+# rename the package
+uos.rename("/lfs/mod1", "/lfs/mod2")
+try_import("mod1")
+try_import("mod2")
+
+# remove the package
+uos.remove("/lfs/mod2/__init__.py")
+uos.rmdir("/lfs/mod2")
+try_import("mod2")
+
+# a module relative to the current directory
+with open("/lfs/mod3.py", "w") as f:
+    f.write('print("mod3")\n')
+sys.path[0] = ""
+try_import("mod3")
+uos.chdir("/lfs")
+try_import("mod3")
+uos.chdir("/")
+
+# a module on a filesystem that's remounted with different contents
+sys.path[0] = "/lfs"
+uos.umount("/lfs")
+bdev2 = RAMBlockDevice(30)
+uos.VfsLfs2.mkfs(bdev2)
+vfs2 = uos.VfsLfs2(bdev2)
+uos.mount(vfs2, "/lfs")
+try_import("mod3")
+with open("/lfs/mod4.py", "w") as f:
+    f.write('print("mod4")\n')
+uos.umount("/lfs")
+uos.mount(vfs2, "/lfs")
+try_import("mod4")
+
+# repeated failed lookups don't need to read the filesystem again
+try_import("mod5")
+n = bdev2.reads
+try_import("mod5")
+print(bdev2.reads - n)
+
+uos.umount("/lfs")
+sys.path.pop(0)
@@ -0,0 +1,110 @@
+# Test VfsLfs tuning options, the per-file buffer pool and cached statvfs
+
+import gc
+
+try:
+    import uos
+
+    uos.VfsLfs1
+    uos.VfsLfs2
+except (ImportError, AttributeError):
+    print("SKIP")
+    raise SystemExit
+
+
+class RAMBlockDevice:
+    ERASE_BLOCK_SIZE = 1024
+
+    def __init__(self, blocks):
+        self.data = bytearray(blocks * self.ERASE_BLOCK_SIZE)
+        self.n_reads = 0
+
+    def readblocks(self, block, buf, off):
+        self.n_reads += 1
+        addr = block * self.ERASE_BLOCK_SIZE + off
+        for i in range(len(buf)):
+            buf[i] = self.data[addr + i]
+
+    def writeblocks(self, block, buf, off):
+        addr = block * self.ERASE_BLOCK_SIZE + off
+        for i in range(len(buf)):
+            self.data[addr + i] = buf[i]
+
+    def ioctl(self, op, arg):
+        if op == 4:  # block count
+            return len(self.data) // self.ERASE_BLOCK_SIZE
+        if op == 5:  # block size
+            return self.ERASE_BLOCK_SIZE
+        if op == 6:  # erase block
+            return 0
+
+
+def test(bdev, vfs_class, **kw):
+    print("test", vfs_class)
+
+    vfs_class.mkfs(bdev, **kw)
+    vfs = vfs_class(bdev, **kw)
+    st0 = vfs.statvfs("/")
+
+    # statvfs without any writes in between does not touch the device
+    n = bdev.n_reads
+    print(vfs.statvfs("/") == st0, bdev.n_reads == n)
+
+    # write and read back files, reusing the per-file buffers
+    for i in range(6):
+        with vfs.open("file%d" % i, "w") as f:
+            f.write(bytes(range(i, i + 200)) * 4)
+    for i in range(6):
+        with vfs.open("file%d" % i, "rb") as f:
+            print(i, f.read() == bytes(range(i, i + 200)) * 4)
+
+    # several files open at the same time
+    fs = [vfs.open("file%d" % i, "rb") for i in range(4)]
+    print([len(f.read()) for f in fs])
+    for f in fs:
+        f.close()
+
+    # files left open are closed by their finaliser
+    for i in range(4):
+        vfs.open("file%d" % i, "rb")
+    gc.collect()
+    with vfs.open("file0", "rb") as f:
+        print(len(f.read()))
+
+    # failed open must not lose the buffer
+    try:
+        vfs.open("missing", "r")
+    except OSError:
+        print("OSError")
+
+    # the cached count follows the writes
+    st1 = vfs.statvfs("/")
+    print(st1[3] < st0[3])
+    for i in range(6):
+        vfs.remove("file%d" % i)
+    print(vfs.statvfs("/")[3] == st0[3])
+
+
+bdev = RAMBlockDevice(30)
+test(bdev, uos.VfsLfs1)
+test(bdev, uos.VfsLfs1, readsize=64, progsize=64, lookahead=64)
+test(bdev, uos.VfsLfs2)
+test(bdev, uos.VfsLfs2, readsize=64, progsize=64, cachesize=512, lookahead=64, blockcycles=500)
+test(bdev, uos.VfsLfs2, blockcycles=-1)
+
+# invalid options
+for kw in (
+    {"readsize": 0},
+    {"lookahead": 12},
+    {"cachesize": 48},
+    {"cachesize": 768},
+    {"blockcycles": 0},
+):
+    try:
+        uos.VfsLfs2(bdev, **kw)
+    except ValueError:
+        print("ValueError", sorted(kw))
+try:
+    uos.VfsLfs1(bdev, lookahead=16)
+except ValueError:
+    print("ValueError lfs1 lookahead")
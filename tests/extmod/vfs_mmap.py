@@ -0,0 +1,120 @@
+# Test uos.mmap on files of filesystems on a RAM block device
+
+try:
+    import uos
+
+    uos.mmap
+except (ImportError, AttributeError):
+    print("SKIP")
+    raise SystemExit
+
+if not (hasattr(uos, "VfsFat") or hasattr(uos, "VfsLfs2")):
+    print("SKIP")
+    raise SystemExit
+
+
+class RAMBlockDevice:
+    ERASE_BLOCK_SIZE = 512
+
+    def __init__(self, blocks):
+        self.data = bytearray(blocks * self.ERASE_BLOCK_SIZE)
+
+    def readblocks(self, block, buf, off=0):
+        addr = block * self.ERASE_BLOCK_SIZE + off
+        for i in range(len(buf)):
+            buf[i] = self.data[addr + i]
+
+    def writeblocks(self, block, buf, off=None):
+        if off is None:
+            # erase, then write
+            off = 0
+        addr = block * self.ERASE_BLOCK_SIZE + off
+        for i in range(len(buf)):
+            self.data[addr + i] = buf[i]
+
+    def ioctl(self, op, arg):
+        if op == 4:  # block count
+            return len(self.data) // self.ERASE_BLOCK_SIZE
+        if op == 5:  # block size
+            return self.ERASE_BLOCK_SIZE
+        if op == 6:  # erase block
+            return 0
+
+
+data = bytes(i * 7 & 0xFF for i in range(1500))
+
+
+def test(vfs_class):
+    print(vfs_class)
+    bdev = RAMBlockDevice(64)
+    vfs_class.mkfs(bdev)
+    vfs = vfs_class(bdev)
+    with vfs.open("data", "wb") as f:
+        f.write(data)
+
+    f = vfs.open("data", "rb")
+    f.seek(10)
+    with uos.mmap(f) as m:
+        # a Python block device isn't memory mapped, so reads go through a window
+        print(m, len(m), bool(m))
+        print(m[0], m[1], m[-1], m[777], m[1499])
+        print(m[100:110] == data[100:110], m[250:260] == data[250:260])
+        print(m[:] == data, m[1490:2000] == data[1490:])
+        print(m[5:5], m[-3:] == data[-3:])
+        try:
+            m[1500]
+        except IndexError:
+            print("IndexError")
+        try:
+            m[0] = 1
+        except TypeError:
+            print("TypeError")
+        # the buffer protocol reads the whole range into RAM
+        mv = memoryview(m)
+        print(len(mv), mv[1234] == data[1234], bytes(mv[3:6]) == data[3:6])
+        print(m[600])
+    print(m)
+    try:
+        m[0]
+    except ValueError:
+        print("ValueError")
+
+    # the file position is preserved
+    print(f.tell())
+
+    # offset and length
+    m = uos.mmap(f, 20, 1000)
+    print(len(m), m[:] == data[1000:1020], bytes(m) == data[1000:1020])
+    m = uos.mmap(f, 0, 1500)
+    print(len(m), m[:], bytes(m))
+    for args in ((-1,), (0, -1), (0, 1501), (501, 1000)):
+        try:
+            uos.mmap(f, *args)
+        except ValueError:
+            print("ValueError", args)
+    f.close()
+
+    # an empty file
+    with vfs.open("empty", "wb") as f:
+        pass
+    with vfs.open("empty", "rb") as f:
+        m = uos.mmap(f)
+        print(len(m), bool(m), m[:], bytes(m))
+
+
+if hasattr(uos, "VfsFat"):
+    test(uos.VfsFat)
+if hasattr(uos, "VfsLfs2"):
+    test(uos.VfsLfs2)
+
+# block devices must be memory mapped
+try:
+    uos.mmap(RAMBlockDevice(4))
+except OSError as er:
+    print("OSError")
+
+# objects that are not streams
+try:
+    uos.mmap(1)
+except OSError:
+    print("OSError")
@@ -0,0 +1,42 @@
+# Test uos.mmap on a file of the host filesystem, which is mapped directly
+
+try:
+    import uos
+
+    uos.mmap
+    uos.VfsPosix
+except (ImportError, AttributeError):
+    print("SKIP")
+    raise SystemExit
+
+# We need a file for testing that doesn't already exist.
+temp_file = "micropy_test_mmap"
+try:
+    uos.stat(temp_file)
+    print("SKIP")
+    raise SystemExit
+except OSError:
+    pass
+
+data = bytes(i * 7 & 0xFF for i in range(10000))
+with open(temp_file, "wb") as f:
+    f.write(data)
+
+f = open(temp_file, "rb")
+m = uos.mmap(f)
+print(m, m[0], m[-1], m[5000:5010] == data[5000:5010])
+mv = memoryview(m)
+print(len(mv), mv[9999] == data[9999], bytes(mv[100:200]) == data[100:200])
+
+# an offset that is not page aligned
+m2 = uos.mmap(f, 100, 4097)
+print(m2, bytes(m2) == data[4097:4197])
+m2.close()
+print(m2)
+
+# the mapping stays valid after the file is closed
+f.close()
+print(m[1234] == data[1234], m[:] == data)
+m.close()
+
+uos.remove(temp_file)
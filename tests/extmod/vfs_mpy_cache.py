@@ -0,0 +1,114 @@
+# test caching of compiled .py files as .mpy in __pycache__
+
+import usys
+
+try:
+    import uio, uos, micropython
+
+    uio.IOBase
+    uos.mount
+    micropython.mpy_cache
+except (ImportError, AttributeError):
+    print("SKIP")
+    raise SystemExit
+
+
+class UserFile(uio.IOBase):
+    def __init__(self, fs, path, mode):
+        self.fs = fs
+        self.path = path
+        self.write_mode = "w" in mode
+        self.data = bytearray() if self.write_mode else fs.files[path][0]
+        self.pos = 0
+
+    def readinto(self, buf):
+        n = min(len(buf), len(self.data) - self.pos)
+        buf[:n] = self.data[self.pos : self.pos + n]
+        self.pos += n
+        return n
+
+    def write(self, buf):
+        self.data += buf
+        return len(buf)
+
+    def ioctl(self, req, arg):
+        if req == 4 and self.write_mode:  # MP_STREAM_CLOSE
+            self.fs.files[self.path] = (bytes(self.data), self.fs.time)
+        return 0
+
+
+class UserFS:
+    def __init__(self, files):
+        self.files = {path: (data, 1) for path, data in files.items()}
+        self.dirs = set()
+        self.time = 1
+
+    def mount(self, readonly, mksfs):
+        pass
+
+    def umount(self):
+        pass
+
+    def stat(self, path):
+        if path in self.dirs:
+            return (0x4000, 0, 0, 0, 0, 0, 0, 0, 0, 0)
+        if path in self.files:
+            data, mtime = self.files[path]
+            return (0x8000, 0, 0, 0, 0, 0, len(data), mtime, mtime, mtime)
+        raise OSError
+
+    def open(self, path, mode):
+        print("open", path, mode)
+        return UserFile(self, path, mode)
+
+    def mkdir(self, path):
+        print("mkdir", path)
+        self.dirs.add(path)
+
+    def remove(self, path):
+        del self.files[path]
+
+    def rename(self, old_path, new_path):
+        print("rename", old_path, new_path)
+        self.files[new_path] = self.files.pop(old_path)
+
+
+fs = UserFS({"/cachemod.py": b"print('cachemod', 1)"})
+uos.mount(fs, "/userfs")
+usys.path.append("/userfs")
+micropython.mpy_cache(True)
+print(micropython.mpy_cache())
+
+
+def import_cachemod():
+    import cachemod
+
+    del usys.modules["cachemod"]
+
+
+# compiled from source, and the cache is written
+import_cachemod()
+print(fs.files["/__pycache__/cachemod.mpy"][0][:1])
+
+# loaded from the cache
+import_cachemod()
+
+# the source changes, so it's compiled again
+fs.time = 2
+fs.files["/cachemod.py"] = (b"print('cachemod', 2)", fs.time)
+import_cachemod()
+import_cachemod()
+
+# a cache file from an incompatible firmware is replaced
+data = bytearray(fs.files["/__pycache__/cachemod.mpy"][0])
+data[11] = 0  # .mpy version
+fs.files["/__pycache__/cachemod.mpy"] = (bytes(data), 2)
+import_cachemod()
+import_cachemod()
+
+# without the cache the source is always compiled
+micropython.mpy_cache(False)
+import_cachemod()
+
+uos.umount("/userfs")
+usys.path.pop()
@@ -0,0 +1,58 @@
+try:
+    import uio
+    import uwebsocket
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+
+def mask(data, key):
+    return bytes(b ^ key[i & 3] for i, b in enumerate(data))
+
+
+# masked payloads of various lengths and alignments
+key = b"\x12\x34\x56\x78"
+for n in (1, 3, 4, 5, 11, 64, 127, 300):
+    payload = bytes(i & 0xFF for i in range(n))
+    hdr = bytes([0x82, 0x80 | n]) if n < 126 else bytes([0x82, 0xFE, n >> 8, n & 0xFF])
+    ws = uwebsocket.websocket(uio.BytesIO(hdr + key + mask(payload, key)))
+    # read in odd-sized pieces so the mask position is carried over
+    out = b""
+    while True:
+        d = ws.read(7)
+        if not d:
+            break
+        out += d
+    print(n, out == payload)
+
+# 64-bit length
+ws = uwebsocket.websocket(uio.BytesIO(b"\x81\x7f" + bytes(7) + b"\x05hello"))
+print(ws.read(5))
+
+# a fragmented message with a control frame in the middle, received whole
+frames = b"\x02\x03abc" + b"\x89\x02hi" + b"\x00\x02de" + b"\x80\x01f" + b"\x81\x02gh"
+ws = uwebsocket.websocket(uio.BytesIO(frames))
+buf = bytearray(16)
+n = ws.recv_into(buf)
+print(n, buf[:n], ws.ioctl(8))
+n = ws.recv_into(buf)
+print(n, buf[:n], ws.ioctl(8))
+print(ws.recv_into(buf))
+
+# a message longer than the buffer is truncated, but its length is returned
+ws = uwebsocket.websocket(uio.BytesIO(b"\x82\x0a0123456789\x82\x00\x82\x01z"))
+buf = bytearray(4)
+print(ws.recv_into(buf), buf)
+print(ws.recv_into(buf))
+print(ws.recv_into(buf), buf[:1])
+
+# large writes are split into frames with 16-bit lengths
+s = uio.BytesIO()
+ws = uwebsocket.websocket(s)
+ws.ioctl(9, 2)
+print(ws.write(b"x" * 70000))
+data = s.getvalue()
+print(len(data), data[:4], data[65539 : 65539 + 4])
+ws = uwebsocket.websocket(uio.BytesIO(data))
+print(ws.recv_into(bytearray(70000)), ws.ioctl(8))
+
@@ -0,0 +1,25 @@
+# test array kernel functions with floats (MicroPython extension)
+try:
+    import uarray as array
+
+    array.add
+except (ImportError, AttributeError):
+    print("SKIP")
+    raise SystemExit
+
+f = array.array("f", [0.5, 1.5, -2.0])
+print(array.mul(f, 2), array.add(f, f), array.sub(f, 0.5))
+print(array.sum(f), array.dot(f, f), array.min(f), array.max(f))
+
+# scaled conversion, saturating at the limits of integer types
+h = array.array("h", [0, 0, 0])
+array.convert(h, f, 30000)
+print(h)
+array.convert(h, f)
+print(h)
+b = bytearray(3)
+array.convert(b, array.array("d", [-1.0, 255.9, 1e10]))
+print(b)
+d = array.array("d", [0, 0])
+array.convert(d, array.array("h", [-5, 7]), 0.5)
+print(d)
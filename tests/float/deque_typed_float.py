@@ -0,0 +1,19 @@
+# test deques that store floats in a packed array
+try:
+    from ucollections import deque
+
+    deque((), 1, typecode="f")
+except (ImportError, TypeError):
+    print("SKIP")
+    raise SystemExit
+
+# a moving average
+d = deque((), 4, typecode="f")
+for x in (1.5, 2.5, 2.0, 4.0, 5.0, 6.5):
+    d.append(x)
+    print(d.sum() / len(d))
+print(d)
+
+d = deque([0.25, 0.5], 2, typecode="d")
+d[0] = 1
+print(d, d.sum())
@@ -0,0 +1,60 @@
+# test correctly rounded conversion between floats and strings, requiring
+# double-precision
+
+if "%.2e" % 1.125 != "1.12e+00":
+    # no exact float conversion
+    print("SKIP")
+    raise SystemExit
+
+# repr gives the shortest digits that read back as the same float
+for x in (
+    0.1,
+    0.1 + 0.2,
+    1 / 3,
+    2 / 3,
+    100.0,
+    1e15 + 0.3,
+    1e16,
+    1.5e-5,
+    1e22,
+    1e23,
+    9007199254740993.0,
+    5e-324,
+    2.2250738585072014e-308,
+    1.7976931348623157e308,
+):
+    print(repr(x), repr(-x))
+
+# and reads back, for values spread over the whole range
+x = 1.0
+for i in range(2000):
+    x *= 3.7
+    if x == float("inf"):
+        x = 3e-323
+    if float(repr(x)) != x:
+        print("round trip failed", repr(x))
+
+# digits are rounded on the exact value, with ties to even
+print("%.2f %.2f %.1f %.0f %.0f %.0f" % (2.675, 1.125, 0.25, 0.5, 1.5, 2.5))
+print("%.20f" % 0.1)
+print("%.17g %.17g" % (0.1, 1 / 3))
+print("%.16e" % 5e-324)
+print("%.3e %.3e" % (1e-310, 9.9995e100))
+print("%.1g %.2g %.3g" % (9.96, 99.5, 0.00099951))
+
+# parsing is correctly rounded, also with many digits
+for s in (
+    "2.2250738585072011e-308",
+    "2.4703282292062327e-324",
+    "2.4703282292062328e-324",
+    "1.7976931348623158e308",
+    "1.7976931348623159e308",
+    "9007199254740993",
+    "9007199254740993.000000000000000000000000000001",
+    "0.500000000000000166533453693773481063544750213623046875",
+    "1" * 400 + "e-400",
+    "0." + "0" * 300 + "1" * 100 + "e10",
+    "123456789012345678901234567890e-40",
+    "1_000.000_1",
+):
+    print(repr(float(s)))
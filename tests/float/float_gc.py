@@ -0,0 +1,30 @@
+# test that floats stay correct while dead floats are collected and reused
+
+try:
+    import gc
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+# live floats must not be reused
+keep = [i + 0.5 for i in range(100)]
+for j in range(5):
+    x = [i * 0.25 for i in range(200)]
+    x = None
+    gc.collect()
+    y = [i * 2.0 for i in range(200)]
+    print(sum(keep), sum(y))
+
+# dead objects of other types whose first word looks like a float
+d = [{float: i} for i in range(50)]
+d = None
+gc.collect()
+print(sum(i / 4 for i in range(100)))
+
+# floats created inside containers across collections
+l = []
+for i in range(300):
+    l.append(i / 3)
+    if i % 50 == 0:
+        gc.collect()
+print(len(l), l[0], l[3], l[150], round(sum(l), 4))
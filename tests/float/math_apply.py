@@ -0,0 +1,43 @@
+# test math.apply, which is a MicroPython extension
+
+try:
+    import math
+    from array import array
+
+    math.apply
+except (ImportError, AttributeError):
+    print("SKIP")
+    raise SystemExit
+
+
+def show(a):
+    print(["%.4f" % x for x in a])
+
+
+src = array("d", [0.0, 0.5, 1.0, 4.0])
+
+# module functions run in C, other callables are called per value
+show(math.apply(math.sqrt, src, array("d", [0] * 4)))
+show(math.apply(math.sin, src, array("f", [0] * 4)))
+show(math.apply(math.floor, [1.5, -1.5], array("d", [0, 0])))
+show(math.apply(lambda x: x * 3, range(3), array("f", [0] * 3)))
+show(math.apply(math.log, array("f", [1, 2]), array("d", [0, 0])))
+
+# in place, on the same array
+dst = array("f", [1, 4, 9])
+print(math.apply(math.sqrt, dst, dst) is dst)
+show(dst)
+
+# errors
+for src, dst in (
+    (array("d", [-1.0]), array("d", [0])),
+    (array("d", [1, 2]), array("d", [0])),
+    ([1, 2], array("d", [0])),
+    ([1], array("d", [0, 0])),
+    ([1], array("i", [0])),
+    ([1], bytearray(8)),
+):
+    try:
+        math.apply(math.sqrt, src, dst)
+    except (ValueError, TypeError) as e:
+        print(type(e).__name__, e)
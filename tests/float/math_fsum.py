@@ -0,0 +1,49 @@
+# test math.fsum, math.prod and math.dist
+
+try:
+    import math
+
+    math.fsum
+except (ImportError, AttributeError):
+    print("SKIP")
+    raise SystemExit
+
+try:
+    from array import array
+except ImportError:
+    array = None
+
+# fsum is exact where a plain sum loses bits
+print(math.fsum([0.1] * 10), sum([0.1] * 10))
+print(math.fsum([1e100, 1.0, -1e100, 1e-100, 1e50, -1.0, -1e50]))
+print(math.fsum([1.0, 1e-16, 1e-16]))
+print(math.fsum([]), math.fsum(range(10)), math.fsum(x / 8 for x in range(9)))
+print(math.fsum([float("inf"), 1.0]), math.fsum([float("-inf"), 1.0]))
+print(math.fsum([float("nan"), 1.0]))
+for seq in ([float("inf"), float("-inf")], [1.7e308, 1.7e308], [1, "a"]):
+    try:
+        math.fsum(seq)
+    except (ValueError, OverflowError, TypeError) as e:
+        print(type(e).__name__)
+
+# prod
+print(math.prod([]), math.prod([2, 3, 4]), math.prod([2, 3], start=5))
+print(math.prod([1.5, 2, 4]), math.prod(range(1, 21)))
+print(math.prod(["ab"], start=3))
+
+# dist
+print(math.dist((0, 0), (3, 4)), math.dist([1.0], [-2.0]), math.dist((), ()))
+print(math.dist((1e200, 1e200), (0, 0)))
+print(math.dist((float("inf"), float("nan")), (0, 0)))
+print(math.dist((float("nan"), 1), (0, 0)))
+try:
+    math.dist((1, 2), (1, 2, 3))
+except ValueError:
+    print("ValueError")
+
+# arrays of floats are read directly
+if array:
+    a = array("d", [0.1] * 10)
+    print(math.fsum(a), math.prod(array("d", [1.5, 2, 4])), math.prod(array("d")))
+    print(math.dist(array("d", [0, 0]), array("f", [3, 4])))
+    print(math.fsum(array("f", [0.5, 0.25])), math.fsum(memoryview(a)[8:]))
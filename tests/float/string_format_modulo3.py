@@ -1,3 +1,10 @@
 # uPy and CPython outputs differ for the following
+
+if "%.2e" % 1.125 == "1.12e+00":
+    # with exact float conversion the output matches CPython, which is tested
+    # by string_format_modulo3_exact.py
+    print("SKIP")
+    raise SystemExit
+
 print("%.1g" % -9.9)  # round up 'g' with '-' sign
 print("%.2g" % 99.9)  # round up
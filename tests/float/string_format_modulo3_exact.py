@@ -0,0 +1,10 @@
+# rounding up to the next power of 10 can change the format chosen by 'g'
+
+if "%.2e" % 1.125 != "1.12e+00":
+    # without exact float conversion ties aren't rounded to even, and the
+    # format is chosen before rounding, see string_format_modulo3.py
+    print("SKIP")
+    raise SystemExit
+
+print("%.1g" % -9.9)  # round up 'g' with '-' sign
+print("%.2g" % 99.9)  # round up
@@ -0,0 +1,20 @@
+# test a package with __getattr__ that imports its names when first used
+
+import pkg9
+
+print(pkg9.Foo.x)
+
+# a name that the package provides
+from pkg9 import bar
+
+print(bar.y)
+
+# a submodule that the package's __getattr__ doesn't know about
+from pkg9 import baz
+
+print(baz.z)
+
+try:
+    from pkg9 import qux
+except ImportError:
+    print("ImportError")
@@ -0,0 +1,13 @@
+# a package whose names are imported when first used
+print("pkg9 __init__")
+
+_lazy = {"Foo": "foo", "foo": "foo", "bar": "bar"}
+
+
+def __getattr__(name):
+    if name not in _lazy:
+        raise AttributeError(name)
+    mod = __import__(__name__ + "." + _lazy[name], None, None, (name,))
+    value = mod if name == _lazy[name] else getattr(mod, name)
+    globals()[name] = value
+    return value
@@ -0,0 +1,2 @@
+print("pkg9.bar")
+y = 2
@@ -0,0 +1,2 @@
+print("pkg9.baz")
+z = 3
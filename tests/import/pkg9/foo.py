@@ -0,0 +1,5 @@
+print("pkg9.foo")
+
+
+class Foo:
+    x = 1
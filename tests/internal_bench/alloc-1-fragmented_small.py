@@ -0,0 +1,14 @@
+import bench
+
+
+def test(num):
+    # keep every other allocation alive so the heap is full of small holes
+    keep = []
+    for i in range(1000):
+        keep.append(bytearray(8 + i % 4 * 16))
+        bytearray(8 + i % 4 * 16)
+    for i in iter(range(num // 100)):
+        bytearray(8 + i % 4 * 16)
+
+
+bench.run(test)
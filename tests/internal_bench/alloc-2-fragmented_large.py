@@ -0,0 +1,14 @@
+import bench
+
+
+def test(num):
+    # same as alloc-1 but the holes are too small for the allocations
+    keep = []
+    for i in range(1000):
+        keep.append(bytearray(8 + i % 4 * 16))
+        bytearray(8 + i % 4 * 16)
+    for i in iter(range(num // 100)):
+        bytearray(80 + i % 4 * 16)
+
+
+bench.run(test)
@@ -0,0 +1,15 @@
+# Array operation
+# Type: array('h'), inplace operation using for. Each element is
+# boxed to an int object and unboxed again when stored.
+import bench
+import uarray
+
+
+def test(num):
+    arr = uarray.array("h", bytearray(2000))
+    for i in iter(range(num // 10000)):
+        for i in range(len(arr)):
+            arr[i] += 1
+
+
+bench.run(test)
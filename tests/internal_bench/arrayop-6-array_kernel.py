@@ -0,0 +1,14 @@
+# Array operation
+# Type: array('h'), inplace operation using uarray.add(). The loop over
+# the elements runs in C, without boxing them.
+import bench
+import uarray
+
+
+def test(num):
+    arr = uarray.array("h", bytearray(2000))
+    for i in iter(range(num // 10000)):
+        uarray.add(arr, 1, arr)
+
+
+bench.run(test)
@@ -0,0 +1,10 @@
+import bench
+
+
+def test(num):
+    for i in iter(range(num // 2000)):
+        s = "q%d" % i
+        getattr(bench, s, None)
+
+
+bench.run(test)
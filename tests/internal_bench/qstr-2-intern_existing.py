@@ -0,0 +1,14 @@
+import bench
+
+
+def test(num):
+    # make lots of qstrs, then intern one that already exists
+    for i in range(2000):
+        getattr(bench, "q%d" % i, None)
+    a = "r"
+    b = "un"
+    for i in iter(range(num // 200)):
+        getattr(bench, a + b, None)
+
+
+bench.run(test)
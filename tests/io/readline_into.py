@@ -0,0 +1,48 @@
+# test readline_into() method of streams
+
+try:
+    import uio as io
+except ImportError:
+    import io
+
+try:
+    io.BytesIO.readline_into
+except AttributeError:
+    print("SKIP")
+    raise SystemExit
+
+s = io.BytesIO(b"first line\nsecnd\n\nlast")
+buf = bytearray(8)
+mv = memoryview(buf)
+
+# line longer than the buffer is read in pieces
+print(s.readline_into(buf), buf)
+print(s.readline_into(buf), buf)
+
+# read into an offset of the buffer
+print(s.readline_into(mv[2:]), buf)
+
+# empty line
+print(s.readline_into(buf), buf[:1])
+
+# nbytes limits the amount read
+print(s.readline_into(buf, 2), buf[:2])
+print(s.readline_into(buf, 100), buf[:2])
+
+# EOF
+print(s.readline_into(buf))
+
+# zero-length buffer
+s = io.BytesIO(b"abc\n")
+print(s.readline_into(bytearray(0)), s.read())
+
+# text stream
+s = io.StringIO("text\nline")
+print(s.readline_into(buf), buf[:5])
+print(s.readline_into(buf), buf[:4])
+
+# buffer must be writable
+try:
+    io.BytesIO(b"x").readline_into(b"y")
+except TypeError:
+    print("TypeError")
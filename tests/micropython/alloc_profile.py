@@ -0,0 +1,36 @@
+# test micropython.alloc_profile
+
+import micropython
+
+try:
+    micropython.alloc_profile
+except AttributeError:
+    print("SKIP")
+    raise SystemExit
+
+
+def alloc(n):
+    l = None
+    for i in range(n):
+        l = [i, i]
+    return l
+
+
+def alloc_bytes(n):
+    for i in range(n):
+        b = bytearray(100)
+
+
+micropython.alloc_profile(True)
+alloc(400)
+alloc_bytes(100)
+prof = micropython.alloc_profile(True)
+
+# the lines allocating most come first
+print(prof[0][1:3], prof[0][3] > 50)
+for entry in prof:
+    if entry[2] == "alloc_bytes":
+        print(entry[1], entry[3] > 5, entry[4] // entry[3] > 40)
+
+# the profile was reset
+print(len(micropython.alloc_profile()) < len(prof))
@@ -0,0 +1,130 @@
+# test micropython.arena
+# objects allocated in an arena are only kept in local variables, as globals
+# would outlive the arena, but existing containers may grow
+
+import gc
+import micropython
+
+try:
+    micropython.arena
+except AttributeError:
+    print("SKIP")
+    raise SystemExit
+
+
+# results computed inside the arena, but not kept
+def test_basic():
+    with micropython.arena():
+        parts = [str(i) for i in range(50)]
+        s = "-".join(parts)
+        print(len(s), s[:20])
+        b = bytearray(10)
+        b.extend(b"abc" * 100)
+        print(len(b), b[-3:])
+
+
+# the arena grows when it is full
+def test_small():
+    with micropython.arena(64):
+        l = [i for i in range(200)]
+        print(sum(l))
+
+
+# collections while an arena is active keep its objects alive
+def test_collect():
+    with micropython.arena(2048):
+        d = {}
+        for i in range(20):
+            d[i] = [i] * 3
+        for i in range(20):
+            gc.collect()
+            [0] * 10
+        print(sum(v[2] for v in d.values()))
+
+
+def test_nested():
+    with micropython.arena():
+        x = [1, 2]
+        with micropython.arena():
+            y = x + [3]
+            print(y)
+        x.append(4)
+        print(x)
+
+
+# an exception raised inside an arena propagates safely
+def test_exception():
+    try:
+        with micropython.arena():
+            raise ValueError("in arena %d" % 1)
+    except ValueError as er:
+        gc.collect()
+        [str(i) for i in range(100)]
+        print(er)
+
+
+# an arena can't be entered twice at the same time
+def test_reuse():
+    a = micropython.arena()
+    with a:
+        try:
+            with a:
+                pass
+        except RuntimeError:
+            print("RuntimeError")
+    with a:
+        print("reused")
+
+
+# containers made before the arena get their new space from the heap, and so
+# do interned strings
+class A:
+    def f(self):
+        return "f"
+
+
+def test_outer():
+    l = []
+    d = {}
+    a = A()
+    with micropython.arena():
+        for i in range(40):
+            l.append(i)
+            d[i] = i
+            setattr(a, "attr%d" % i, i)
+    gc.collect()
+    [str(i) for i in range(100)]
+    print(sum(l), sum(d.values()), a.attr39)
+
+
+# a bound method made in an arena isn't reused after the arena ends
+def test_bound_meth():
+    a = A()
+    with micropython.arena():
+        m = a.f
+        m()
+    m = a.f
+    [str(i) for i in range(100)]
+    print(m())
+
+
+# the memory of an arena is released when it ends
+def test_release():
+    gc.collect()
+    before = gc.mem_free()
+    for i in range(10):
+        with micropython.arena(4000):
+            ["x%d" % j for j in range(100)]
+    gc.collect()
+    print(gc.mem_free() >= before - 256)
+
+
+test_basic()
+test_small()
+test_collect()
+test_nested()
+test_exception()
+test_reuse()
+test_outer()
+test_bound_meth()
+test_release()
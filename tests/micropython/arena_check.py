@@ -0,0 +1,33 @@
+# test the check done when micropython.arena ends
+
+import gc
+import micropython
+
+try:
+    micropython.arena
+except AttributeError:
+    print("SKIP")
+    raise SystemExit
+
+# an object stored in a global escapes the arena, if the check is enabled
+try:
+    with micropython.arena():
+        escaped = [1, 2]
+except RuntimeError:
+    pass
+else:
+    print("SKIP")
+    raise SystemExit
+print(escaped)
+
+
+# a local variable that outlives the arena keeps it alive
+def test_local():
+    with micropython.arena(4096):
+        s = [str(i) for i in range(30)]
+    gc.collect()
+    [bytes(50) for i in range(100)]
+    print(s[:3])
+
+
+test_local()
@@ -0,0 +1,35 @@
+# test folding of comparisons and conditionals in constant expressions
+
+from micropython import const
+
+try:
+    exec("_X = const(1 if 2 > 1 else 0)")
+except SyntaxError:
+    print("SKIP")
+    raise SystemExit
+
+A = const(4)
+D = const(16 if A > 2 else 32)
+E = const(1 if A == 4 else 0)
+F = const(1 if 1 < A < 3 else 0)
+print(D, E, F, A > 2, 1 < A <= 4 != 5)
+
+
+# unreachable code after return
+def f(x):
+    if A < 2:
+        print("unreachable")
+    return x
+    print("unreachable")
+
+
+print(f(1))
+
+
+# a yield after a return still makes a generator
+def g():
+    return
+    yield 1
+
+
+print(list(g()))
@@ -0,0 +1,17 @@
+# test folding of len() in constant expressions
+
+try:
+    exec("from micropython import const\n_X = const(len('abc'))")
+except SyntaxError:
+    print("SKIP")
+    raise SystemExit
+
+# the module is compiled in full before it runs, so the folding is done by exec
+exec(
+    """
+from micropython import const
+B = const(len("abcd") * 2)
+C = const(len((1, 2, 3)))
+print(B, C)
+"""
+)
@@ -0,0 +1,42 @@
+# test gc.compact
+
+import gc
+
+try:
+    gc.compact
+except AttributeError:
+    print("SKIP")
+    raise SystemExit
+
+
+def fragment(n):
+    # interleave buffers that are kept with ones that are freed
+    keep = []
+    for i in range(n):
+        keep.append(bytearray(b"%d" % i * 17))
+        bytearray(200)
+    return keep
+
+
+keep = fragment(40)
+s = "".join(str(i) for i in range(50))
+b = bytes(range(100))
+mv = memoryview(keep[5])[2:]
+largest = gc.compact()
+print(largest > 0)
+
+# contents are unchanged
+print(all(len(x) == len(b"%d" % i) * 17 and x[:2] == (b"%d" % i * 2)[:2] for i, x in enumerate(keep)))
+print(s[:12], len(s), b[-3:])
+
+# a memoryview still shares the data of its bytearray
+keep[5][3] = ord("x")
+print(bytes(mv[:2]), bytes(keep[5][:4]))
+del mv
+
+# buffers can still be resized and freed after moving
+keep[0].extend(b"abc")
+print(keep[0][-6:])
+keep = None
+gc.collect()
+print(gc.compact() >= largest)
@@ -0,0 +1,76 @@
+# test the generational mode of the GC
+
+import gc
+
+try:
+    gc.mem_collections
+except AttributeError:
+    print("SKIP")
+    raise SystemExit
+
+# these lists survive the collection and are promoted to the old generation
+gc.collect()
+old = [[] for _ in range(8)]
+gc.collect()
+minor = gc.mem_collections()[0]
+
+# store young objects in old containers while generating lots of garbage,
+# which triggers minor collections that must keep the young objects alive
+gc.threshold(4096)
+for i in range(2000):
+    old[i % 8].append(str(i))
+    garbage = bytearray(200)
+    garbage = [i] * 20
+del garbage
+gc.threshold(-1)
+
+print(gc.mem_collections()[0] > minor)
+print(all(l == [str(j) for j in range(i, 2000, 8)] for i, l in enumerate(old)))
+
+# old objects of other kinds that are written to, and a generator whose frame
+# holds young objects between resumes, which are only reachable through them
+class C:
+    pass
+
+
+class S:
+    __slots__ = ("a", "b")
+
+
+def gen():
+    s = None
+    while True:
+        s = (yield s) + "!"
+
+
+gc.collect()
+d = {}
+inst = C()
+sl = S()
+sl.a = sl.b = None
+st = set()
+g = gen()
+next(g)
+gc.collect()
+gc.threshold(4096)
+for i in range(2000):
+    d[i] = str(i)
+    setattr(inst, "a%d" % (i % 50), str(i))
+    sl.a = str(i)
+    setattr(sl, "b", str(-i))
+    st.add(str(i))
+    s = g.send(str(i))
+    garbage = bytearray(200)
+    garbage = [i] * 20
+del garbage
+gc.threshold(-1)
+print(all(d[i] == str(i) for i in range(2000)))
+print(all(getattr(inst, "a%d" % i) == str(1950 + i) for i in range(50)))
+print(len(st), all(str(i) in st for i in range(2000)))
+print(sl.a, sl.b)
+print(s)
+
+# an explicit collection is a major one
+major = gc.mem_collections()[1]
+gc.collect()
+print(gc.mem_collections()[1] == major + 1)
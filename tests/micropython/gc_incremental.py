@@ -0,0 +1,55 @@
+# test incremental GC steps interleaved with mutation of the heap
+
+import gc
+
+try:
+    gc.collect(budget_us=0)
+except TypeError:
+    print("SKIP")
+    raise SystemExit
+
+# finish any collection in progress
+gc.collect()
+
+# a structure that is mostly marked before it is modified
+data = [[str(i * 4 + j) * 4 for j in range(4)] for i in range(40)]
+d = {}
+
+# a step with no budget can't complete the collection
+print(gc.collect(budget_us=0))
+
+# swap objects between containers and create new ones in between steps, so
+# that the only references to them are stored into blocks that may already be
+# scanned
+steps = 0
+while not gc.collect(budget_us=0):
+    steps += 1
+    a = data[steps % 40]
+    b = data[(steps * 17) % 40]
+    j = steps % 4
+    d[j] = a[j]
+    a[j] = b[j]
+    b[j] = d[j]
+    d[j] = None
+    if steps > 100000:
+        break
+
+print(steps > 0)
+
+# churn the heap to reuse any blocks that were wrongly freed
+for i in range(100):
+    [bytearray(b"x" * 32) for _ in range(20)]
+gc.collect()
+
+values = [s for l in data for s in l]
+print(sorted(values) == sorted(str(i) * 4 for i in range(160)))
+
+# a full collection completes any collection in progress
+print(gc.collect(budget_us=0))
+gc.collect()
+print(gc.collect(budget_us=1000000))
+
+try:
+    gc.collect(budget_us=-1)
+except ValueError:
+    print("ValueError")
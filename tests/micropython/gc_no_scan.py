@@ -0,0 +1,74 @@
+# test that the data of bytearrays isn't scanned by the GC, and that big
+# buffers are allocated and freed correctly
+
+import gc, usys
+
+try:
+    import uarray as array
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+# the unix port enables no-scan allocations, and id() is an address there
+if usys.platform not in ("linux", "darwin"):
+    print("SKIP")
+    raise SystemExit
+
+
+# return an object holding the address of a big list, which is otherwise dead
+def make(typecode):
+    l = [None] * 2000
+    if typecode == "O":
+        return array.array("O", [l])
+    b = bytearray(16)
+    b[0:8] = id(l).to_bytes(8, "little")
+    b[8:16] = b[0:8]
+    return b
+
+
+def clear_stack(n):
+    if n:
+        clear_stack(n - 1)
+
+
+def used_by(typecode):
+    gc.collect()
+    free = gc.mem_free()
+    obj = make(typecode)
+    clear_stack(20)
+    gc.collect()
+    return obj, free - gc.mem_free()
+
+
+# a bytearray that happens to hold its address doesn't keep the list alive
+b, used = used_by("B")
+print(used < 4000, b[0:8] == b[8:16])
+
+# an array of objects does
+a, used = used_by("O")
+print(used >= 8000, len(a[0]))
+a = None
+
+# the data of growing and shrinking buffers stays intact, including over a
+# collection, and is still not scanned after it has moved
+bufs = []
+for i in range(20):
+    b = bytearray(i * 300)
+    for j in range(0, len(b), 7):
+        b[j] = j & 0xFF
+    b.extend(bytes(range(i)))
+    bufs.append((i, b))
+    if i % 3 == 0:
+        bufs.pop(0)
+    gc.collect()
+ok = True
+for i, b in bufs:
+    for j in range(0, i * 300, 7):
+        ok = ok and b[j] == j & 0xFF
+    ok = ok and b[i * 300 :] == bytes(range(i))
+print(len(bufs), ok)
+
+# the same for strings built in a vstr
+s = ",".join(str(i) for i in range(200))
+gc.collect()
+print(len(s), s[:20], s[-20:])
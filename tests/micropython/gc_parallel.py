@@ -0,0 +1,23 @@
+# test that a collection keeps wide and deep structures alive
+
+import gc
+
+tree = [[[str(i * 100 + j) for j in range(5)] for i in range(20)] for k in range(20)]
+chain = None
+for i in range(2000):
+    chain = [chain, str(i)]
+d = {str(i): [i] for i in range(500)}
+
+for i in range(5):
+    gc.collect()
+    # allocate between collections so freed memory gets reused
+    garbage = [[j] for j in range(200)]
+
+n = 0
+c = chain
+while c is not None:
+    n += 1
+    c = c[0]
+print(n, chain[1])
+print(sum(len(x) for y in tree for x in y), tree[19][19][4])
+print(len(d), sum(v[0] for v in d.values()))
@@ -0,0 +1,44 @@
+# test reuse of dead generators by the GC pool
+
+import gc
+
+try:
+    gc.stats()["pool_kept"]
+except (AttributeError, KeyError):
+    print("SKIP")
+    raise SystemExit
+
+
+def gen(x):
+    yield x
+    yield x + 1
+
+
+# the first generator makes the GC keep dead ones
+list(gen(0))
+gens = [gen(i) for i in range(20)]
+gens = None
+gc.collect()
+print(gc.stats()["pool_kept"] > 0)
+
+# new generators reuse them, and start out as new
+gc.stats(True)
+for i in range(5):
+    print(list(gen(i * 10)))
+print(gc.stats()["pool_reused"] > 0)
+
+# a reused generator that was suspended doesn't remember its state
+g = gen(1)
+next(g)
+g = None
+gc.collect()
+print(list(gen(100)))
+
+# close() and throw() work on reused generators
+g = gen(1)
+print(next(g))
+g.close()
+try:
+    next(g)
+except StopIteration:
+    print("StopIteration")
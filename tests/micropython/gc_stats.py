@@ -0,0 +1,33 @@
+# test gc.stats()
+
+import gc
+
+try:
+    gc.stats
+except AttributeError:
+    print("SKIP")
+    raise SystemExit
+
+gc.collect()
+gc.stats(True)
+s = gc.stats()
+print(s["collections"], s["pauses"], s["pause_max_us"])
+
+# allocations since the last collection are counted
+data = [bytearray(100) for _ in range(10)]
+print(gc.stats()["alloc"] >= 1000)
+
+# one collection, which frees the data
+data = None
+gc.collect()
+s = gc.stats()
+print(s["collections"], s["pauses"])
+print(s["swept"] >= 1000, s["marked"] > 0, s["max_free"] > 0)
+print(s["peak"] >= s["marked"] + 1000, s["peak"] >= gc.mem_alloc())
+print(s["pause_min_us"] <= s["pause_avg_us"] <= s["pause_max_us"])
+print(s["pause_last_us"] == s["pause_max_us"])
+print(s["alloc_rate"] >= 0)
+
+for _ in range(3):
+    gc.collect()
+print(gc.stats(True)["collections"], gc.stats()["collections"])
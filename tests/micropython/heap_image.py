@@ -0,0 +1,35 @@
+# test micropython.heap_image_save error handling (restoring is done at startup)
+
+import micropython
+
+try:
+    micropython.heap_image_save
+    import uio
+except (AttributeError, ImportError):
+    print("SKIP")
+    raise SystemExit
+
+# must be given a stream
+try:
+    micropython.heap_image_save(1)
+except OSError:
+    print("OSError")
+
+# the heap is locked while writing, so a stream that allocates fails
+try:
+    micropython.heap_image_save(uio.BytesIO())
+except MemoryError:
+    print("MemoryError")
+
+# the heap is unlocked again afterwards
+print(micropython.heap_locked() if hasattr(micropython, "heap_locked") else 0, len([1, 2]))
+
+# can't save from within an arena
+if hasattr(micropython, "arena"):
+    try:
+        with micropython.arena(256):
+            micropython.heap_image_save(uio.BytesIO())
+    except RuntimeError:
+        print("RuntimeError")
+else:
+    print("RuntimeError")
@@ -0,0 +1,65 @@
+# Test that common exceptions can be raised and caught without memory allocation,
+# and get a traceback when they propagate out of a function.
+import micropython, usys, uio
+
+try:
+    import uos
+
+    uos.stat
+except (ImportError, AttributeError):
+    print("SKIP")
+    raise SystemExit
+
+
+def get_exc(f, *args):
+    try:
+        f(*args)
+    except Exception as e:
+        return e
+
+
+# shared instances are only used when enabled
+if get_exc(next, iter(())) is not get_exc(next, iter(())):
+    print("SKIP")
+    raise SystemExit
+
+
+def func():
+    it = iter(())
+    res = [None] * 2
+    micropython.heap_lock()
+    for i in range(2):
+        try:
+            next(it)
+        except StopIteration as e:
+            res[i] = e
+    micropython.heap_unlock()
+    for e in res:
+        print(repr(e), e.args)
+
+
+func()
+
+# OSError with a common errno is shared when caught in the function raising it
+e1 = get_exc(uos.stat, "/nonexistent-file")
+e2 = get_exc(uos.stat, "/nonexistent-file")
+print(e1 is e2, repr(e1))
+
+
+def stat():
+    uos.stat("/nonexistent-file")
+
+
+# propagating out of a function gives a new object with a traceback
+e1 = get_exc(stat)
+e2 = get_exc(stat)
+print(e1 is e2, e1.errno)
+buf = uio.StringIO()
+usys.print_exception(e1, buf)
+print(buf.getvalue().split("\n")[-2])
+print(len(buf.getvalue().split("\n")))
+
+# clearing the traceback of a shared instance does nothing
+e = get_exc(next, iter(()))
+e.__traceback__ = None
+print(repr(e))
@@ -0,0 +1,111 @@
+# test importing of .mpy files whose functions are loaded on first use
+
+try:
+    import usys, uio, uos
+
+    uio.IOBase
+    uos.mount
+except (ImportError, AttributeError):
+    print("SKIP")
+    raise SystemExit
+
+
+class UserFile(uio.IOBase):
+    def __init__(self, data):
+        self.data = memoryview(data)
+        self.pos = 0
+
+    def readinto(self, buf):
+        n = min(len(buf), len(self.data) - self.pos)
+        buf[:n] = self.data[self.pos : self.pos + n]
+        self.pos += n
+        return n
+
+    def ioctl(self, req, arg):
+        return 0
+
+
+class UserFS:
+    def __init__(self, files):
+        self.files = files
+
+    def mount(self, readonly, mksfs):
+        pass
+
+    def umount(self):
+        pass
+
+    def chdir(self, path):
+        pass
+
+    def stat(self, path):
+        if path in self.files:
+            return (32768, 0, 0, 0, 0, 0, 0, 0, 0, 0)
+        raise OSError
+
+    def open(self, path, mode):
+        global opens
+        opens += 1
+        return UserFile(self.files[path])
+
+
+# this is the test .mpy file, made with mpy-cross -mcache-lookup-bc -mlazy-load from:
+# def f():
+#     def g():
+#         return 2
+#     return g() + 1
+# def h():
+#     def k():
+#         return "k"
+#     return k()
+mpy = (
+    b"M\x05C\x1f T\x00\x0e\x00\x07\x0cmod.p"
+    b"ye \x002\x00\x16\x02f2\x01\x16\x02hQc"
+    b"\x00\x02ZH\x10\x0e\x02f\x0cmod.py "
+    b"C\x002\x00\xc0\xb04\x00\x81\xf2c\x00\x01%(\x00"
+    b"\x0c\x02g\x0cmod.py@\x00\x82c\x00\x00"
+    b"\\D\x08\x10\x02h\x0cmod.py`@C"
+    b"\x002\x00\xc0\xb04\x00c\x00\x01)4\x00\x0e\x02k"
+    b"\x0cmod.py``\x00\x10\x03c\x00\x00"
+)
+user_files = {"/mod.mpy": mpy}
+opens = 0
+
+# create and mount a user filesystem
+uos.mount(UserFS(user_files), "/userfs")
+usys.path.append("/userfs")
+
+# f and h are loaded by the import, g is loaded from the file when f runs
+import mod
+
+n = opens
+r = mod.f()
+if opens == n:
+    print("SKIP")
+    raise SystemExit
+print(n, r, opens)
+print(mod.f(), opens)
+
+# k is checked against the file as it was when imported
+user_files["/mod.mpy"] = mpy[:-5] + b"\x10\x05c\x00\x00"
+try:
+    mod.h()
+except ValueError:
+    print("ValueError")
+
+# a module imported by a relative path is loaded in full, because the path
+# may not name the same file once the current directory changes
+cwd = uos.getcwd()
+uos.chdir("/userfs")
+usys.path.insert(0, "")
+user_files["mod2.mpy"] = mpy
+n = opens
+import mod2
+
+uos.chdir(cwd)
+print(mod2.f(), opens - n)
+usys.path.pop(0)
+
+# unmount and undo path addition
+uos.umount("/userfs")
+usys.path.pop()
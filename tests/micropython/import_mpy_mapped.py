@@ -0,0 +1,64 @@
+# test importing of .mpy files whose str and bytes constants are used in place
+
+try:
+    import gc, usys, uos
+
+    uos.mmap
+    uos.VfsPosix
+except (ImportError, AttributeError):
+    print("SKIP")
+    raise SystemExit
+
+# We need a directory for testing that doesn't already exist.
+temp_dir = "micropy_test_mapped_dir"
+try:
+    uos.stat(temp_dir)
+    print("SKIP")
+    raise SystemExit
+except OSError:
+    pass
+
+# this is the test .mpy file, made with mpy-cross -mcache-lookup-bc -mmapped-str from:
+# T = b"xxx...", with 1000 x's
+# S = "yyy...", with 1000 y's
+# def f():
+#     return "nested"
+mpy = (
+    b"M\x05\x83\x1f h\x00\x0e\x00\x07\x0cmod.py%e\x00#\x00\x16\x02T#\x01\x16\x02S2\x02\x16\x02fQc\x02\x01b\x87h"
+    + b"x" * 1000
+    + b"\x00s\x87h"
+    + b"y" * 1000
+    + b"\x004\x00\x0e\x01\x07`@\x00\x10\x0cnestedc\x00\x00"
+)
+
+uos.mkdir(temp_dir)
+with open(temp_dir + "/mod.mpy", "wb") as f:
+    f.write(mpy)
+usys.path.append(temp_dir)
+
+gc.collect()
+m = gc.mem_alloc()
+import mod
+
+gc.collect()
+m = gc.mem_alloc() - m
+if m > 1000:
+    # the constants were copied, so the file isn't mapped
+    print("SKIP")
+else:
+    print(type(mod.T), len(mod.T), mod.T == b"x" * 1000)
+    print(type(mod.S), len(mod.S), mod.S == "y" * 1000)
+    print(mod.S[-3:] + mod.f(), {mod.S: 1}["y" * 1000])
+
+    # the mapped file can't be part of a heap image
+    import micropython, uio
+
+    try:
+        micropython.heap_image_save(uio.BytesIO())
+    except (AttributeError, RuntimeError):
+        print("RuntimeError")
+
+# clean up
+usys.path.pop()
+uos.remove(temp_dir + "/mod.mpy")
+uos.rmdir(temp_dir)
@@ -0,0 +1,147 @@
+# test that functions translated to native code at runtime behave like bytecode
+# (with MICROPY_JIT disabled this just runs everything as bytecode)
+
+N = 1500
+
+
+def loop(n):
+    s = 0
+    i = 0
+    while i < n:
+        s += i
+        i += 1
+    return s
+
+
+def args(a, b=2, *args, c=3, **kw):
+    return a + b + c + len(args) + len(kw)
+
+
+def for_break(l):
+    t = 0
+    for x in l:
+        if x > 5:
+            break
+        t += x
+    else:
+        t = -1
+    return t
+
+
+def comps(n):
+    return [x * 2 for x in range(n) if x % 2], {x: x for x in range(3)}, {x for x in range(3)}
+
+
+def closure(n):
+    def g():
+        return n + 1
+
+    return g()
+
+
+def compare(a):
+    return 1 < a < 10, a if a > 3 else -a, a and 0 or 5
+
+
+def containers(*a):
+    x, *y = a
+    d = {"a": x}
+    d["b"] = y
+    return d, a[1:], (x, y)
+
+
+class A:
+    def __init__(self):
+        self.x = 0
+
+    def inc(self):
+        self.x += 1
+        return self.x
+
+
+def method(a):
+    return a.inc()
+
+
+for _ in range(N):
+    r = (
+        loop(10),
+        args(1),
+        args(1, 2, 3, 4, c=5, d=6),
+        for_break([1, 2, 3]),
+        for_break([1, 7]),
+        comps(5),
+        closure(3),
+        compare(4),
+        compare(20),
+        containers(1, 2, 3),
+    )
+print(r)
+a = A()
+for _ in range(N):
+    method(a)
+print(a.x)
+
+# a long loop counts towards promotion, and the next call is translated
+print(loop(N * 2), loop(5))
+
+
+# an exception out of a translated function
+def maybe_raise(x):
+    if x:
+        raise ValueError(x)
+    return x
+
+
+for i in range(N):
+    maybe_raise(0)
+for i in range(3):
+    try:
+        print(maybe_raise(i))
+    except ValueError as e:
+        print("ValueError", e)
+for i in range(N):
+    maybe_raise(0)
+print(maybe_raise(0))
+
+
+# a local that may be unbound must still raise
+def unbound(x):
+    if x:
+        y = 1
+    return y
+
+
+for _ in range(N):
+    unbound(1)
+try:
+    unbound(0)
+except NameError:
+    print("NameError")
+
+
+# functions with exception handlers stay as bytecode
+def handler(x):
+    try:
+        return 1 // x
+    except ZeroDivisionError:
+        return -1
+
+
+for i in range(N):
+    handler(1)
+print(handler(0))
+
+
+# a function using a global that changes
+G = 1
+
+
+def glob():
+    return G
+
+
+for _ in range(N):
+    glob()
+G = 2
+print(glob())
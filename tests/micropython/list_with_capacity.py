@@ -0,0 +1,33 @@
+# test micropython.list_with_capacity
+
+import micropython
+
+try:
+    micropython.list_with_capacity
+except AttributeError:
+    print("SKIP")
+    raise SystemExit
+
+l = micropython.list_with_capacity(10)
+print(l, len(l))
+
+# appending up to the capacity doesn't allocate
+i = 0
+micropython.heap_lock()
+while i < 10:
+    l.append(i)
+    i += 1
+micropython.heap_unlock()
+print(l)
+
+# the list grows past its capacity as usual
+l.append(10)
+l.extend((11, 12))
+print(l)
+
+print(micropython.list_with_capacity(0))
+
+try:
+    micropython.list_with_capacity(-1)
+except ValueError:
+    print("ValueError")
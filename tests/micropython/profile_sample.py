@@ -0,0 +1,64 @@
+# test micropython.profile_start/stop/dump
+
+import micropython
+
+try:
+    import uio, utime
+
+    micropython.profile_start
+except (ImportError, AttributeError):
+    print("SKIP")
+    raise SystemExit
+
+
+def spin(n):
+    x = 0
+    for i in range(n):
+        x += i
+    return x
+
+
+def work(ms):
+    t0 = utime.ticks_ms()
+    while utime.ticks_diff(utime.ticks_ms(), t0) < ms:
+        spin(100)
+
+
+def dump():
+    s = uio.StringIO()
+    micropython.profile_dump(s)
+    return s.getvalue()
+
+
+micropython.profile_start()
+work(300)
+micropython.profile_stop()
+out = dump()
+
+# each line is a stack, outermost frame first, then a count
+stacks = {}
+for line in out.splitlines():
+    stack, count = line.rsplit(" ", 1)
+    stacks[stack] = int(count)
+print(all(count > 0 for count in stacks.values()))
+print(
+    any(
+        s[0].endswith(":<module>:34") and s[1].endswith(":work:24")
+        for s in (stack.split(";") for stack in stacks)
+        if len(s) >= 2
+    )
+)
+
+# stopped, so no more samples are taken
+work(50)
+print(dump() == out)
+
+# starting again clears the profile
+micropython.profile_start(1000)
+print(dump())
+micropython.profile_stop()
+
+try:
+    micropython.profile_start(0)
+except ValueError:
+    print("ValueError")
@@ -0,0 +1,22 @@
+# test micropython.qstr_snapshot
+
+import micropython
+
+try:
+    micropython.qstr_snapshot
+except AttributeError:
+    print("SKIP")
+    raise SystemExit
+
+s1 = micropython.qstr_snapshot()
+print(type(s1))
+
+# intern a new string, which should then be in the snapshot
+class A:
+    pass
+
+
+name = "snapshot_" + "test"
+setattr(A, name, 1)
+s2 = micropython.qstr_snapshot()
+print(name.encode() in s1, name.encode() in s2, len(s2) > len(s1))
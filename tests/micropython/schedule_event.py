@@ -0,0 +1,63 @@
+# test micropython.schedule_event() function
+
+import micropython
+
+try:
+    micropython.schedule_event
+except AttributeError:
+    print("SKIP")
+    raise SystemExit
+
+events = []
+
+
+def callback(arg, value, ticks_us, count):
+    events.append((arg, value, count))
+
+
+# events are delivered in order, with their payload
+micropython.schedule_event(callback, "a", 1)
+micropython.schedule_event(callback, "b", -2)
+for i in range(10):
+    if len(events) == 2:
+        break
+print(events)
+
+# fill the ring from a scheduled function, so none are delivered meanwhile
+def fill(_):
+    global queued, stats
+    queued = 0
+    while micropython.schedule_event(callback, queued, queued):
+        queued += 1
+    stats = micropython.schedule_event_stats()
+
+
+events = []
+queued = None
+stats = None
+micropython.schedule(fill, None)
+for i in range(10):
+    if stats is not None:
+        break
+print(stats[0] == queued, stats[1])
+
+# the coalesced event is counted in the next event that is queued
+for i in range(queued + 10):
+    if len(events) == queued:
+        break
+print(len(events) == queued)
+micropython.schedule_event(callback, "c")
+for i in range(10):
+    if len(events) == queued + 1:
+        break
+print(events[-1], micropython.schedule_event_stats())
+
+
+# the timestamp is taken when the event is queued
+def callback_ticks(arg, value, ticks_us, count):
+    print(arg, type(ticks_us))
+
+
+micropython.schedule_event(callback_ticks, None)
+for i in range(10):
+    pass
@@ -0,0 +1,73 @@
+# test micropython.StringBuilder
+
+import micropython
+
+try:
+    micropython.StringBuilder
+except AttributeError:
+    print("SKIP")
+    raise SystemExit
+
+StringBuilder = micropython.StringBuilder
+
+# appending with write and +=
+sb = StringBuilder()
+print(len(sb), bool(sb))
+print(sb.write("abc"))
+sb += "def"
+sb.write("")
+print(len(sb), bool(sb))
+print(repr(sb.getvalue()))
+
+# getvalue hands over the contents and leaves the builder empty
+print(len(sb), repr(sb.getvalue()))
+sb.write("again")
+print(repr(sb.getvalue()))
+
+# initial value and size hint
+sb = StringBuilder("x", 100)
+sb += "y"
+print(sb.getvalue())
+
+# many appends
+sb = StringBuilder()
+for i in range(1000):
+    sb += str(i)
+s = sb.getvalue()
+print(len(s), s[:10], s[-10:], s == "".join(str(i) for i in range(1000)))
+
+# non-ASCII text
+sb = StringBuilder()
+sb.write("é")
+sb.write("中")
+s = sb.getvalue()
+print(len(s), s == "é中")
+
+# as a stream for print
+sb = StringBuilder()
+print("hello", 42, file=sb)
+print(1, 2, sep="-", end="!", file=sb)
+print(repr(sb.getvalue()))
+
+# a bytes builder
+sb = StringBuilder(b"")
+sb.write(b"ab")
+sb += bytearray(b"cd")
+sb += memoryview(b"ef")
+print(sb.getvalue())
+
+# a str builder only takes str
+sb = StringBuilder()
+for arg in (b"ab", 1, None):
+    try:
+        sb.write(arg)
+    except TypeError:
+        print("TypeError")
+try:
+    sb += 1
+except TypeError:
+    print("TypeError")
+try:
+    StringBuilder(b"", 1) + "x"
+except TypeError:
+    print("TypeError")
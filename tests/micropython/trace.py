@@ -0,0 +1,44 @@
+# test micropython.trace
+
+import micropython
+
+try:
+    import gc, ustruct
+
+    micropython.trace
+except (ImportError, AttributeError):
+    print("SKIP")
+    raise SystemExit
+
+
+def events(data):
+    magic, version, size, n, count = ustruct.unpack("<4sBBHI", data)
+    print(magic, version, size, n <= count, len(data) == 12 + size * n)
+    return [ustruct.unpack_from("<IHH", data, 12 + size * i) for i in range(n)]
+
+
+print(micropython.trace())
+micropython.trace(True)
+print(micropython.trace())
+micropython.trace_dump(None, True)
+
+# nothing recorded yet
+print(events(micropython.trace_dump()))
+
+# marks and a collection
+micropython.trace_mark(1)
+gc.collect()
+micropython.trace_mark(0x12345)
+micropython.trace(False)
+micropython.trace_mark(3)
+ev = events(micropython.trace_dump(None, True))
+print([(e, arg) for t, e, arg in ev])
+print(all(ev[i][0] <= ev[i + 1][0] for i in range(len(ev) - 1)))
+
+# the ring keeps the latest events
+micropython.trace(True)
+for i in range(1000):
+    micropython.trace_mark(i)
+micropython.trace(False)
+ev = events(micropython.trace_dump(None, True))
+print(ev[-1][1:])
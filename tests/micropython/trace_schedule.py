@@ -0,0 +1,23 @@
+# test micropython.trace with scheduled functions
+
+import micropython
+
+try:
+    import ustruct
+
+    micropython.trace
+    micropython.schedule
+except (ImportError, AttributeError):
+    print("SKIP")
+    raise SystemExit
+
+micropython.trace(True)
+micropython.trace_dump(None, True)
+micropython.schedule(lambda arg: micropython.trace_mark(arg), 5)
+for i in range(10):
+    pass
+micropython.trace(False)
+
+data = micropython.trace_dump(None, True)
+n = ustruct.unpack_from("<H", data, 6)[0]
+print([ustruct.unpack_from("<IHH", data, 12 + 8 * i)[1:] for i in range(n)])
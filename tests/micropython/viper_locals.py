@@ -0,0 +1,50 @@
+# test viper and native functions with more locals than fit in registers
+
+
+@micropython.viper
+def f1(a: int, b: int, c: int, d: int, e: int) -> int:
+    x = 0
+    for i in range(e):
+        x += a + d
+    return x * 100 + b + c
+
+
+@micropython.viper
+def f2(buf: ptr8, n: int) -> int:
+    a = 0
+    b = 0
+    s = 0
+    for i in range(n):
+        s += i
+        s += buf[0]
+        a += buf[i] & 1
+        b ^= s
+    return s + a * 1000 + b
+
+
+@micropython.viper
+def f3(buf: ptr8, n: int):
+    x = 0
+    y = 1
+    for i in range(n):
+        buf[i] = y
+        x, y = y, x + y
+
+
+@micropython.native
+def f4(n):
+    a = 1
+    b = 2
+    c = 3
+    d = 0
+    for i in range(n):
+        d += i
+    return a + b + c + d
+
+
+print(f1(1, 2, 3, 4, 5))
+b = bytearray(b"1234")
+print(f2(b, 4))
+f3(b, 4)
+print(b)
+print(f4(10))
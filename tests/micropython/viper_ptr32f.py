@@ -0,0 +1,56 @@
+# test load and store with ptr32f type
+
+import array
+
+
+@micropython.viper
+def get(src: ptr32f) -> object:
+    return src[0]
+
+
+@micropython.viper
+def get1(src: ptr32f) -> object:
+    return src[1]
+
+
+@micropython.viper
+def set(dest: ptr32f, val):
+    dest[0] = val
+
+
+@micropython.viper
+def set1(dest: ptr32f, val):
+    dest[1] = val
+
+
+@micropython.viper
+def scale(dest_in, gain):
+    dest = ptr32f(dest_in)
+    n = int(len(dest_in))
+    for i in range(n):
+        dest[i] = dest[i] * gain
+
+
+@micropython.viper
+def fill(dest: ptr32f, n: int):
+    for i in range(n):
+        dest[i] = i
+
+
+a = array.array("f", [1.5, -2.25, 3.0, 0.5])
+print(get(a), get1(a))
+
+set(a, 4.5)
+set1(a, 0.125)
+print(list(a))
+
+scale(a, 2)
+print(list(a))
+
+fill(a, len(a))
+print(list(a))
+
+# a bytearray holds the bits of the floats
+b = bytearray(8)
+set1(b, 1.0)
+print(b)
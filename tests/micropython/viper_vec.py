@@ -0,0 +1,76 @@
+# test viper vector intrinsics
+import micropython
+
+
+@micropython.viper
+def add8(dst, src, n: int):
+    vadd(ptr8(dst), ptr8(src), n)
+
+
+@micropython.viper
+def add16(dst, src, n: int):
+    vadd(ptr16(dst), ptr16(src), n)
+
+
+@micropython.viper
+def add32(dst, src, n: int):
+    vadd(ptr32(dst), ptr32(src), n)
+
+
+b = bytearray([1, 2, 250, 4])
+add8(b, bytearray([1, 1, 10, 1]), 3)
+print(b)
+b = bytearray(b"\x01\x00\xff\xff\x00\x10")
+add16(b, b"\x02\x00\x02\x00\x00\x10", 3)
+print(b)
+b = bytearray(b"\xff\xff\x00\x00\x01\x00\x00\x00")
+add32(b, b"\x01\x00\x00\x00\x01\x00\x00\x00", 2)
+print(b)
+
+
+@micropython.viper
+def mac16(a, b, n: int) -> int:
+    return vmac(ptr16(a), ptr16(b), n)
+
+
+@micropython.viper
+def sum8(a, n: int) -> int:
+    return vsum(ptr8(a), n)
+
+
+@micropython.viper
+def sum32(a, n: int) -> int:
+    s = vsum(ptr32(a), n)
+    return s + 1
+
+
+@micropython.viper
+def minmax16(a, n: int):
+    return vminmax(ptr16(a), n)
+
+
+print(mac16(b"\x02\x00\x03\x00\x00\x01", b"\x05\x00\x07\x00\x02\x00", 3))
+print(sum8(b"\x01\x02\xff\x04", 4), sum8(b"\x01\x02", 0))
+print(sum32(b"\x01\x00\x00\x00\x00\x00\x01\x00", 2))
+print(minmax16(b"\x05\x00\xff\xff\x03\x00", 3))
+print(minmax16(b"\x05\x00\xff\xff\x03\x00", 1))
+try:
+    minmax16(b"", 0)
+except ValueError:
+    print("ValueError")
+
+
+# wrong arguments are an error when compiling
+def test(code):
+    try:
+        exec(code)
+    except ViperTypeError as e:
+        print(repr(e))
+
+
+test("@micropython.viper\ndef f(a):\n vsum(a, 1)")
+test("@micropython.viper\ndef f(a):\n vsum(ptr8(a), a)")
+test("@micropython.viper\ndef f(a):\n vadd(ptr8(a), ptr16(a), 1)")
+test("@micropython.viper\ndef f(a):\n vmac(ptr(a), ptr(a), 1)")
+test("@micropython.viper\ndef f(a):\n vminmax(ptr8(a))")
+test("@micropython.viper\ndef f(a):\n vsum(ptr8(a), n=1)")
@@ -0,0 +1,78 @@
+# test the VM budget of ticks
+
+import micropython
+
+try:
+    micropython.vm_budget
+except AttributeError:
+    print("SKIP")
+    raise SystemExit
+
+print(micropython.vm_budget())
+
+
+def loop(n):
+    for i in range(n):
+        pass
+
+
+# a short loop runs within the budget
+micropython.vm_budget(1000)
+loop(10)
+print(0 < micropython.vm_budget() < 1000)
+micropython.vm_budget(0)
+print(micropython.vm_budget())
+
+# a long loop is stopped with a RuntimeError, and the budget is removed
+micropython.vm_budget(1000)
+try:
+    loop(1000000)
+except RuntimeError as e:
+    print(repr(e))
+print(micropython.vm_budget())
+
+# calls count as well as jumps
+def f():
+    return 1
+
+
+micropython.vm_budget(100)
+try:
+    for _ in range(1000):
+        f()
+except RuntimeError:
+    print("calls stopped")
+
+
+# a custom exception class or instance
+class Quota(Exception):
+    pass
+
+
+micropython.vm_budget(100, Quota)
+try:
+    while True:
+        pass
+except Quota as e:
+    print("Quota", e.args)
+
+micropython.vm_budget(100, Quota("out of time"))
+try:
+    while True:
+        pass
+except Quota as e:
+    print("Quota", e.args)
+
+# a generator is stopped too
+def gen():
+    while True:
+        yield 1
+
+
+micropython.vm_budget(100)
+try:
+    for _ in gen():
+        pass
+except RuntimeError:
+    print("generator stopped")
+print(micropython.vm_budget())
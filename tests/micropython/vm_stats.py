@@ -0,0 +1,43 @@
+# test micropython.vm_stats
+
+import micropython
+
+try:
+    import uio
+
+    micropython.vm_stats
+except (ImportError, AttributeError):
+    print("SKIP")
+    raise SystemExit
+
+
+def f(n):
+    x = 0
+    for i in range(n):
+        x += i
+    return x
+
+
+def stats(reset=False):
+    s = uio.StringIO()
+    micropython.vm_stats(s, reset)
+    return s.getvalue().splitlines()
+
+
+stats(True)
+f(100)
+lines = stats(True)
+print(lines[0].split()[:2])
+
+# binary ops are counted by operator and operand types
+print(sorted(line for line in lines if line.startswith("binop")))
+
+# opcodes and pairs are counted, and the tables had room for all
+ops = sum(int(line.split()[-1]) for line in lines if line.startswith("op "))
+pairs = sum(int(line.split()[-1]) for line in lines if line.startswith("pair "))
+print(ops > 500, ops == pairs)
+print([line for line in lines if line.startswith("dropped")])
+
+# the counts are reset
+stats(True)
+print([line for line in stats() if line.startswith("binop")])
@@ -0,0 +1,46 @@
+# Test uasyncio.open_connection() with TLS
+
+try:
+    import uasyncio as asyncio
+    import ussl
+except ImportError:
+    try:
+        import asyncio
+    except ImportError:
+        print("SKIP")
+        raise SystemExit
+
+
+async def ticker():
+    # Runs while the handshake is in progress
+    global ticks
+    while True:
+        ticks += 1
+        await asyncio.sleep(0)
+
+
+async def http_get_status(host):
+    reader, writer = await asyncio.open_connection(host, 443, ssl=True)
+
+    print("write GET")
+    writer.write(b"GET / HTTP/1.0\r\nHost: " + host.encode() + b"\r\n\r\n")
+    await writer.drain()
+
+    line = await reader.readline()
+    print(line.startswith(b"HTTP/1."))
+
+    print("close")
+    writer.close()
+    await writer.wait_closed()
+    print("done")
+
+
+async def main():
+    t = asyncio.create_task(ticker())
+    await http_get_status("micropython.org")
+    t.cancel()
+    print("ticker ran:", ticks > 0)
+
+
+ticks = 0
+asyncio.run(main())
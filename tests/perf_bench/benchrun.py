@@ -15,13 +15,42 @@ def bm_run(N, M):
             cur_nm = nm
             param = p
     if param is None:
-        print(-1, -1, "no matching params")
+        print(-1, -1, -1, -1, "no matching params")
         return
 
+    # A benchmark can't run if the target lacks a feature it needs
+    try:
+        run, result = bm_setup(param)
+    except (ImportError, OSError):
+        print("SKIP")
+        return
+
+    # Measure the peak heap use and the number of collections, if the target
+    # can tell
+    try:
+        import gc
+
+        gc.collect()
+        mem_start = gc.mem_alloc()
+    except (ImportError, AttributeError):
+        gc = None
+    has_stats = hasattr(gc, "stats")
+    if has_stats:
+        gc.stats(True)
+
     # Run and time benchmark
-    run, result = bm_setup(param)
     t0 = ticks_us()
     run()
     t1 = ticks_us()
+
+    peak = n_gc = -1
+    if gc is not None:
+        if has_stats:
+            stats = gc.stats()
+            peak, n_gc = stats["peak"], stats["collections"]
+        else:
+            # without a collection in between this is the peak
+            peak = gc.mem_alloc()
+        peak -= mem_start
     norm, out = result()
-    print(ticks_diff(t1, t0), norm, out)
+    print(ticks_diff(t1, t0), norm, peak, n_gc, out)
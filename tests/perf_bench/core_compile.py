@@ -0,0 +1,53 @@
+# Test the speed of compiling Python source: lexing, parsing and compiling to
+# bytecode.  The peak heap use reported by run-perfbench.py is that of the
+# compiler, as the source is kept from before the run.
+
+
+def make_source(n):
+    lines = []
+    for i in range(n):
+        lines.append("class Widget%d:" % i)
+        lines.append("    def __init__(self, configuration_value, *, scale=%d):" % i)
+        lines.append("        # store the arguments")
+        lines.append("        self.configuration_value = configuration_value")
+        lines.append("        self.scale_factor = scale * 2 + 1")
+        lines.append("    def compute_result(self, items):")
+        lines.append("        total = 0")
+        lines.append("        for index, item in enumerate(items):")
+        lines.append("            if index % 2 == 0 and item is not None:")
+        lines.append("                total += item * self.scale_factor")
+        lines.append("            else:")
+        lines.append("                total -= len(str(item))")
+        lines.append("        return {'total': total, 'name': \"widget_%d\"}" % i)
+        lines.append("")
+    return "\n".join(lines)
+
+
+###########################################################################
+# Benchmark interface
+
+bm_params = {
+    (50, 10): (4, 2),
+    (100, 10): (8, 4),
+    (1000, 100): (10, 20),
+    (5000, 1000): (20, 60),
+}
+
+
+def bm_setup(params):
+    nloop, n = params
+    src = make_source(n)
+    state = None
+
+    def run():
+        nonlocal state
+        for _ in range(nloop):
+            code = compile(src, "bench", "exec")
+        ns = {}
+        exec(code, ns)
+        state = len([k for k in ns if k.startswith("Widget")])
+
+    def result():
+        return nloop * len(src) // 100, state
+
+    return run, result
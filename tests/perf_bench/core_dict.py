@@ -0,0 +1,47 @@
+# Test the speed of dict insertion, lookup and deletion with str and int keys.
+
+
+def test(n):
+    keys = ["key%d" % i for i in range(n)]
+    total = 0
+    for _ in range(4):
+        d = {}
+        for i, k in enumerate(keys):
+            d[k] = i
+        for k in keys:
+            total += d[k]
+        di = {}
+        for i in range(n):
+            di[i * 7] = i
+        for i in range(n):
+            total += di.get(i * 7, 0) + di.get(i * 7 + 1, 0)
+        for k in keys[::2]:
+            del d[k]
+        total += len(d)
+    return total
+
+
+###########################################################################
+# Benchmark interface
+
+bm_params = {
+    (50, 10): (40, 20),
+    (100, 10): (80, 40),
+    (1000, 100): (100, 500),
+    (5000, 1000): (100, 4000),
+}
+
+
+def bm_setup(params):
+    nloop, n = params
+    state = None
+
+    def run():
+        nonlocal state
+        for _ in range(nloop):
+            state = test(n)
+
+    def result():
+        return nloop * n, state
+
+    return run, result
@@ -0,0 +1,46 @@
+# Test the speed of common str operations: formatting, join, split, find,
+# replace and slicing.
+
+
+def test(n):
+    words = ["w%d" % i for i in range(n)]
+    line = " ".join(words)
+    total = 0
+    for _ in range(4):
+        parts = line.split(" ")
+        total += len(parts)
+        s = ",".join(parts)
+        total += s.find("w%d" % (n - 1))
+        total += len(s.replace(",", ", "))
+        for w in parts:
+            total += len("{}={:4d}".format(w, len(w))) + len(w.upper())
+            if w.startswith("w1"):
+                total += 1
+        total += len(line[1:-1].strip())
+    return total
+
+
+###########################################################################
+# Benchmark interface
+
+bm_params = {
+    (50, 10): (20, 20),
+    (100, 10): (40, 40),
+    (1000, 100): (100, 300),
+    (5000, 1000): (100, 2000),
+}
+
+
+def bm_setup(params):
+    nloop, n = params
+    state = None
+
+    def run():
+        nonlocal state
+        for _ in range(nloop):
+            state = test(n)
+
+    def result():
+        return nloop * n, state
+
+    return run, result
@@ -0,0 +1,92 @@
+# Test the speed of moving data through several TCP connections over the
+# loopback interface, using uselect.poll to find the ones that are ready.
+# The same work is done with uselect.uring batches in io_uring.py.
+
+try:
+    import usocket as socket, uselect as select
+except ImportError:
+    import socket, select
+
+PORT = 8765
+
+
+def send(s, data):
+    if hasattr(s, "write"):
+        s.write(data)
+    else:
+        s.sendall(data)
+
+
+def readinto(s, buf, n):
+    if hasattr(s, "readinto"):
+        return s.readinto(buf, n)
+    return s.recv_into(buf, n)
+
+
+def make_pairs(n):
+    addr = socket.getaddrinfo("127.0.0.1", PORT)[0][-1]
+    listener = socket.socket()
+    listener.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    listener.bind(addr)
+    listener.listen(n)
+    pairs = []
+    for _ in range(n):
+        client = socket.socket()
+        client.connect(addr)
+        pairs.append((client, listener.accept()[0]))
+    listener.close()
+    return pairs
+
+
+###########################################################################
+# Benchmark interface
+
+bm_params = {
+    (50, 10): (10, 4, 128),
+    (100, 10): (20, 4, 256),
+    (1000, 100): (200, 8, 1024),
+    (5000, 1000): (1000, 8, 1024),
+}
+
+
+def bm_setup(params):
+    nloop, nconn, size = params
+
+    pairs = make_pairs(nconn)
+    data = bytes(range(256)) * (size // 256) + bytes(size % 256)
+    poller = select.poll()
+    servers = {}
+    for client, server in pairs:
+        poller.register(server, select.POLLIN)
+        servers[server.fileno()] = server
+    buf = bytearray(size)
+    state = None
+
+    def run():
+        nonlocal state
+        total = 0
+        for _ in range(nloop):
+            for client, _ in pairs:
+                send(client, data)
+            # read each connection's data as it becomes ready
+            left = {fd: size for fd in servers}
+            while left:
+                for obj, _ in poller.poll(1000):
+                    fd = obj if isinstance(obj, int) else obj.fileno()
+                    n = readinto(servers[fd], buf, left[fd])
+                    total += n
+                    left[fd] -= n
+                    if not left[fd]:
+                        poller.modify(servers[fd], 0)
+                        del left[fd]
+            for _, server in pairs:
+                poller.modify(server, select.POLLIN)
+        for client, server in pairs:
+            client.close()
+            server.close()
+        state = total
+
+    def result():
+        return nloop * nconn * size // 100, state
+
+    return run, result
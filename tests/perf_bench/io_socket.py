@@ -0,0 +1,74 @@
+# Test the speed of sending data through a TCP connection over the loopback
+# interface, and back.
+
+try:
+    import usocket as socket
+except ImportError:
+    import socket
+
+PORT = 8764
+
+
+def send(s, data):
+    if hasattr(s, "write"):
+        s.write(data)
+    else:
+        s.sendall(data)
+
+
+def recv_exactly(s, buf):
+    mv = memoryview(buf)
+    n = 0
+    while n < len(buf):
+        m = s.readinto(mv[n:]) if hasattr(s, "readinto") else s.recv_into(mv[n:])
+        if not m:
+            raise OSError("connection closed")
+        n += m
+
+
+###########################################################################
+# Benchmark interface
+
+bm_params = {
+    (50, 10): (20, 128),
+    (100, 10): (40, 256),
+    (1000, 100): (500, 1024),
+    (5000, 1000): (2000, 1024),
+}
+
+
+def bm_setup(params):
+    nloop, size = params
+
+    # a loopback connection is needed to run this
+    addr = socket.getaddrinfo("127.0.0.1", PORT)[0][-1]
+    listener = socket.socket()
+    listener.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    listener.bind(addr)
+    listener.listen(1)
+    client = socket.socket()
+    client.connect(addr)
+    server = listener.accept()[0]
+    listener.close()
+
+    data = bytes(range(256)) * (size // 256) + bytes(size % 256)
+    buf = bytearray(size)
+    state = None
+
+    def run():
+        nonlocal state
+        total = 0
+        for _ in range(nloop):
+            send(client, data)
+            recv_exactly(server, buf)
+            send(server, buf)
+            recv_exactly(client, buf)
+            total += buf[-1] + len(buf)
+        client.close()
+        server.close()
+        state = total
+
+    def result():
+        return nloop * size // 100, state
+
+    return run, result
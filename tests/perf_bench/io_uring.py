@@ -0,0 +1,83 @@
+# Test the speed of moving data through several TCP connections over the
+# loopback interface, with the writes and reads of each round queued on a
+# uselect.uring and submitted together.  Compare with io_poll.py.
+
+try:
+    import usocket as socket, uselect as select
+except ImportError:
+    import socket, select
+
+PORT = 8766
+
+
+def make_pairs(n):
+    addr = socket.getaddrinfo("127.0.0.1", PORT)[0][-1]
+    listener = socket.socket()
+    listener.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    listener.bind(addr)
+    listener.listen(n)
+    pairs = []
+    for _ in range(n):
+        client = socket.socket()
+        client.connect(addr)
+        pairs.append((client, listener.accept()[0]))
+    listener.close()
+    return pairs
+
+
+###########################################################################
+# Benchmark interface
+
+bm_params = {
+    (50, 10): (10, 4, 128),
+    (100, 10): (20, 4, 256),
+    (1000, 100): (200, 8, 1024),
+    (5000, 1000): (1000, 8, 1024),
+}
+
+
+def bm_setup(params):
+    nloop, nconn, size = params
+
+    if not hasattr(select, "uring"):
+        raise ImportError
+    ring = select.uring(2 * nconn)
+    pairs = make_pairs(nconn)
+    data = bytes(range(256)) * (size // 256) + bytes(size % 256)
+    bufs = [bytearray(size) for _ in range(nconn)]
+    state = None
+
+    def run():
+        nonlocal state
+        total = 0
+        for _ in range(nloop):
+            for i, (client, server) in enumerate(pairs):
+                ring.write(client, data)
+                ring.readinto(server, bufs[i], i)
+            # loopback reads may return short, so requeue any that do
+            left = [size] * nconn
+            n_left = nconn
+            while n_left:
+                ring.submit(1)
+                for i, res in ring.complete():
+                    if i is None:
+                        continue
+                    total += res
+                    left[i] -= res
+                    if left[i]:
+                        ring.readinto(pairs[i][1], memoryview(bufs[i])[size - left[i] :], i)
+                    else:
+                        n_left -= 1
+        for client, server in pairs:
+            client.close()
+            server.close()
+        ring.close()
+        state = total
+
+    def result():
+        # CPython has no uselect.uring to give the expected output, so the
+        # check is done here
+        assert state == nloop * nconn * size
+        return nloop * nconn * size // 100, None
+
+    return run, result
@@ -0,0 +1,52 @@
+# Test the speed of writing, reading and stat'ing a file on the filesystem in
+# the current directory.
+
+try:
+    import uos as os
+except ImportError:
+    import os
+
+FILENAME = "perf_bench_io_vfs.tmp"
+
+
+###########################################################################
+# Benchmark interface
+
+bm_params = {
+    (50, 10): (4, 16, 128),
+    (100, 10): (8, 16, 128),
+    (1000, 100): (20, 64, 512),
+    (5000, 1000): (50, 64, 1024),
+}
+
+
+def bm_setup(params):
+    nloop, nchunk, chunk_size = params
+    chunk = bytes(range(256)) * (chunk_size // 256) + bytes(chunk_size % 256)
+    buf = bytearray(chunk_size)
+    # a filesystem is needed to run this
+    with open(FILENAME, "wb"):
+        pass
+    state = None
+
+    def run():
+        nonlocal state
+        total = 0
+        for _ in range(nloop):
+            with open(FILENAME, "wb") as f:
+                for _ in range(nchunk):
+                    f.write(chunk)
+            total += os.stat(FILENAME)[6]
+            with open(FILENAME, "rb") as f:
+                while True:
+                    n = f.readinto(buf)
+                    if not n:
+                        break
+                    total += n
+        os.remove(FILENAME)
+        state = total
+
+    def result():
+        return nloop * nchunk * chunk_size // 1000, state
+
+    return run, result
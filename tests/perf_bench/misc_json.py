@@ -0,0 +1,49 @@
+# Test the speed of json.dumps and json.loads on a nested document.
+
+try:
+    import ujson as json
+except ImportError:
+    import json
+
+
+def make_doc(n):
+    return {
+        "name": "sensor",
+        "readings": [
+            {"id": i, "value": i * 3 - 7, "ok": i % 3 != 0, "tag": "t%d" % i, "avg": None}
+            for i in range(n)
+        ],
+        "meta": {"version": 2, "units": ["C", "%", "hPa"]},
+    }
+
+
+###########################################################################
+# Benchmark interface
+
+bm_params = {
+    (50, 10): (20, 8),
+    (100, 10): (40, 16),
+    (1000, 100): (100, 100),
+    (5000, 1000): (200, 500),
+}
+
+
+def bm_setup(params):
+    nloop, n = params
+    doc = make_doc(n)
+    state = None
+
+    def run():
+        nonlocal state
+        total = 0
+        for _ in range(nloop):
+            s = json.dumps(doc)
+            d = json.loads(s)
+            # dicts may be in a different order, so compare sizes and contents
+            total += len(s) + len(d["readings"]) + sum(r["value"] for r in d["readings"])
+        state = total
+
+    def result():
+        return nloop * n, state
+
+    return run, result
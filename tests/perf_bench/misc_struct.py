@@ -0,0 +1,44 @@
+# Test the speed of struct.pack, pack_into, unpack and unpack_from on records.
+
+try:
+    import ustruct as struct
+except ImportError:
+    import struct
+
+FMT = "<HhIif"
+
+
+###########################################################################
+# Benchmark interface
+
+bm_params = {
+    (50, 10): (20, 16),
+    (100, 10): (40, 32),
+    (1000, 100): (100, 200),
+    (5000, 1000): (200, 1000),
+}
+
+
+def bm_setup(params):
+    nloop, n = params
+    size = struct.calcsize(FMT)
+    buf = bytearray(size * n)
+    state = None
+
+    def run():
+        nonlocal state
+        total = 0
+        for _ in range(nloop):
+            for i in range(n):
+                struct.pack_into(FMT, buf, i * size, i, -i, i * 1000, -i * 1000, 0.5)
+            for i in range(n):
+                rec = struct.unpack_from(FMT, buf, i * size)
+                total += rec[0] + rec[1] + rec[2] + rec[3]
+            rec = struct.pack(FMT, 1, 2, 3, 4, 5.0)
+            total += struct.unpack(FMT, rec)[2]
+        state = total
+
+    def result():
+        return nloop * n, state
+
+    return run, result
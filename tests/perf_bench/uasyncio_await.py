@@ -0,0 +1,43 @@
+# Measure the cost of awaiting uasyncio tasks that return a value.
+# uasyncio must be importable, e.g. frozen in or with MICROPYPATH=../extmod.
+
+try:
+    import uasyncio as asyncio
+except ImportError:
+    import asyncio
+
+
+async def task(i):
+    await asyncio.sleep(0)
+    return i
+
+
+async def main(n_tasks, n_rounds):
+    total = 0
+    for _ in range(n_rounds):
+        ts = [asyncio.create_task(task(i)) for i in range(n_tasks)]
+        for t in ts:
+            total += await t
+    return total
+
+
+bm_params = {
+    (50, 10): (5, 20),
+    (100, 10): (10, 20),
+    (1000, 10): (20, 100),
+    (5000, 10): (50, 200),
+}
+
+
+def bm_setup(params):
+    n_tasks, n_rounds = params
+    state = None
+
+    def run():
+        nonlocal state
+        state = asyncio.run(main(n_tasks, n_rounds))
+
+    def result():
+        return n_tasks * n_rounds, state
+
+    return run, result
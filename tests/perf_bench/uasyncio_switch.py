@@ -0,0 +1,38 @@
+# Measure the cost of switching between uasyncio tasks.
+# uasyncio must be importable, e.g. frozen in or with MICROPYPATH=../extmod.
+
+try:
+    import uasyncio as asyncio
+except ImportError:
+    import asyncio
+
+
+async def task(n):
+    for _ in range(n):
+        await asyncio.sleep(0)
+
+
+async def main(n_tasks, n_switch):
+    ts = [asyncio.create_task(task(n_switch)) for _ in range(n_tasks)]
+    for t in ts:
+        await t
+
+
+bm_params = {
+    (50, 10): (2, 200),
+    (100, 10): (4, 200),
+    (1000, 10): (4, 2000),
+    (5000, 10): (8, 5000),
+}
+
+
+def bm_setup(params):
+    n_tasks, n_switch = params
+
+    def run():
+        asyncio.run(main(n_tasks, n_switch))
+
+    def result():
+        return n_tasks * n_switch // 1000, None
+
+    return run, result
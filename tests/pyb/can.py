@@ -129,6 +129,24 @@ try:
 except ValueError:
     print("ValueError")
 
+# Test recv_into, which receives all waiting messages without allocating
+msgs = [[0, 0, 0, memoryview(bytearray(8))] for _ in range(3)]
+can.send("a", 1, timeout=5000)
+can.send("bc", 2, timeout=5000)
+micropython.heap_lock()
+n = can.recv_into(0, msgs)
+micropython.heap_unlock()
+print(n, [(m[0], bytes(m[3])) for m in msgs[:n]])
+
+# Test setfilterids, which packs ids into as many banks as needed
+can.clearfilter(0)
+print(can.setfilterids(0, 0, (5, 6, 7, 8, 9)))
+can.send("x", 9, timeout=5000)
+can.send("y", 10, timeout=5000)
+print(can.recv(0)[0], can.any(0))
+can.clearfilter(1)
+can.setfilter(0, CAN.MASK16, 0, (0, 0, 0, 0))
+
 del can
 
 # Testing extended IDs
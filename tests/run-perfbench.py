@@ -8,6 +8,8 @@ import os
 import subprocess
 import sys
 import argparse
+import json
+import math
 from glob import glob
 
 sys.path.append("../tools")
@@ -37,6 +39,56 @@ def compute_stats(lst):
     return avg, var ** 0.5
 
 
+def betacf(a, b, x):
+    # Continued fraction for the incomplete beta function, by Lentz's method.
+    tiny = 1e-300
+    c = 1
+    d = 1 - (a + b) * x / (a + 1)
+    d = 1 / (d if abs(d) > tiny else tiny)
+    h = d
+    for m in range(1, 200):
+        for num in (
+            m * (b - m) * x / ((a + 2 * m - 1) * (a + 2 * m)),
+            -(a + m) * (a + b + m) * x / ((a + 2 * m) * (a + 2 * m + 1)),
+        ):
+            d = 1 + num * d
+            d = 1 / (d if abs(d) > tiny else tiny)
+            c = 1 + num / c
+            c = c if abs(c) > tiny else tiny
+            h *= d * c
+        if abs(d * c - 1) < 1e-12:
+            break
+    return h
+
+
+def betainc(a, b, x):
+    # Regularized incomplete beta function I_x(a, b).
+    if x <= 0 or x >= 1:
+        return max(0, min(1, x))
+    front = math.exp(
+        math.lgamma(a + b) - math.lgamma(a) - math.lgamma(b) + a * math.log(x) + b * math.log(1 - x)
+    )
+    if x < (a + 1) / (a + b + 2):
+        return front * betacf(a, b, x) / a
+    return 1 - front * betacf(b, a, 1 - x) / b
+
+
+def welch_t_test(lst1, lst2):
+    # Return the two-sided p-value of Welch's t-test for the means of two
+    # samples being the same, or None if there are too few values.
+    n1, n2 = len(lst1), len(lst2)
+    if n1 < 2 or n2 < 2:
+        return None
+    m1, m2 = sum(lst1) / n1, sum(lst2) / n2
+    v1 = sum((x - m1) ** 2 for x in lst1) / (n1 - 1) / n1
+    v2 = sum((x - m2) ** 2 for x in lst2) / (n2 - 1) / n2
+    if v1 + v2 == 0:
+        return 1.0 if m1 == m2 else 0.0
+    t = (m2 - m1) / (v1 + v2) ** 0.5
+    df = (v1 + v2) ** 2 / (v1 ** 2 / (n1 - 1) + v2 ** 2 / (n2 - 1))
+    return betainc(df / 2, 0.5, df / (df + t * t))
+
+
 def run_script_on_target(target, script):
     output = b""
     err = None
@@ -72,18 +124,23 @@ def run_feature_test(target, test):
 
 
 def run_benchmark_on_target(target, script):
+    # Returns (time, norm, peak heap, number of collections, result).
     output, err = run_script_on_target(target, script)
     if err is None:
-        time, norm, result = output.split(None, 2)
+        if output == "SKIP":
+            return -1, -1, -1, -1, "skip"
         try:
-            return int(time), int(norm), result
+            time, norm, peak, n_gc, result = output.split(None, 4)
+            return int(time), int(norm), int(peak), int(n_gc), result
         except ValueError:
-            return -1, -1, "CRASH: %r" % output
+            return -1, -1, -1, -1, "CRASH: %r" % output
     else:
-        return -1, -1, "CRASH: %r" % err
+        return -1, -1, -1, -1, "CRASH: %r" % err
 
 
 def run_benchmarks(target, param_n, param_m, n_average, test_list):
+    # Returns a dict of the results of each benchmark, by file name.
+    results = {}
     skip_complex = run_feature_test(target, "complex") != "complex"
     skip_native = run_feature_test(target, "native_check") != "native"
 
@@ -99,6 +156,7 @@ def run_benchmarks(target, param_n, param_m, n_average, test_list):
         )
         if skip:
             print("skip")
+            results[os.path.basename(test_file)] = {"error": "skip"}
             continue
 
         # Create test script
@@ -116,10 +174,11 @@ def run_benchmarks(target, param_n, param_m, n_average, test_list):
         # Run MicroPython a given number of times
         times = []
         scores = []
+        peak_heap = -1
         error = None
         result_out = None
         for _ in range(n_average):
-            time, norm, result = run_benchmark_on_target(target, test_script)
+            time, norm, peak, n_gc, result = run_benchmark_on_target(target, test_script)
             if time < 0 or norm < 0:
                 error = result
                 break
@@ -130,29 +189,80 @@ def run_benchmarks(target, param_n, param_m, n_average, test_list):
                 break
             times.append(time)
             scores.append(1e6 * norm / time)
+            peak_heap = max(peak_heap, peak)
 
         # Check result against truth if needed
         if error is None and result_out != "None":
-            _, _, result_exp = run_benchmark_on_target(PYTHON_TRUTH, test_script)
+            result_exp = run_benchmark_on_target(PYTHON_TRUTH, test_script)[-1]
             if result_out != result_exp:
                 error = "FAIL truth"
 
         if error is not None:
             print(error)
+            results[os.path.basename(test_file)] = {"error": error}
         else:
             t_avg, t_sd = compute_stats(times)
             s_avg, s_sd = compute_stats(scores)
             print(
-                "{:.2f} {:.4f} {:.2f} {:.4f}".format(
-                    t_avg, 100 * t_sd / t_avg, s_avg, 100 * s_sd / s_avg
+                "{:.2f} {:.4f} {:.2f} {:.4f} {} {}".format(
+                    t_avg, 100 * t_sd / t_avg, s_avg, 100 * s_sd / s_avg, peak_heap, n_gc
                 )
             )
+            results[os.path.basename(test_file)] = {
+                "times": times,
+                "scores": scores,
+                "peak_heap": peak_heap,
+                "gc_count": n_gc,
+            }
             if 0:
                 print("  times: ", times)
                 print("  scores:", scores)
 
         sys.stdout.flush()
 
+    return results
+
+
+def compare_baseline(baseline, results, alpha, threshold):
+    # Compare the results with a baseline from an earlier run, printing the
+    # benchmarks that got slower or use more heap by more than threshold
+    # percent.  A slowdown is only reported if Welch's t-test says it's
+    # significant at the given level, so noise doesn't show up as a
+    # regression.  Returns the number of regressions.
+    if (baseline["N"], baseline["M"]) != (results["N"], results["M"]):
+        print("baseline is for N={} M={}, can't compare".format(baseline["N"], baseline["M"]))
+        return 1
+    print("{:24} {:>10} -> {:>10} {:>8} {:>8}".format("regressions", "baseline", "now", "diff%", "p"))
+    n_regress = 0
+    for name, new in sorted(results["benchmarks"].items()):
+        old = baseline["benchmarks"].get(name)
+        if old is None or "error" in old or "error" in new:
+            continue
+        av_old, _ = compute_stats(old["times"])
+        av_new, _ = compute_stats(new["times"])
+        diff = 100 * (av_new - av_old) / av_old
+        p = welch_t_test(old["times"], new["times"])
+        if diff > threshold and (p is None or p < alpha):
+            print(
+                "{:24} {:10.2f} -> {:10.2f} {:+8.2f} {:>8}".format(
+                    name, av_old, av_new, diff, "-" if p is None else "{:.4f}".format(p)
+                )
+            )
+            n_regress += 1
+        if old["peak_heap"] > 0 and new["peak_heap"] > old["peak_heap"] * (1 + threshold / 100):
+            print(
+                "{:24} {:10d} -> {:10d} {:+8.2f} {:>8}".format(
+                    name + " (heap)",
+                    old["peak_heap"],
+                    new["peak_heap"],
+                    100 * (new["peak_heap"] - old["peak_heap"]) / old["peak_heap"],
+                    "-",
+                )
+            )
+            n_regress += 1
+    print("{} regressions".format(n_regress))
+    return n_regress
+
 
 def parse_output(filename):
     with open(filename) as f:
@@ -233,6 +343,16 @@ def main():
     cmd_parser.add_argument(
         "--emit", default="bytecode", help="MicroPython emitter to use (bytecode or native)"
     )
+    cmd_parser.add_argument("--json", help="write the results to this file as JSON")
+    cmd_parser.add_argument(
+        "--baseline", help="compare with the JSON results of an earlier run, fail if slower"
+    )
+    cmd_parser.add_argument(
+        "--alpha", type=float, default=0.01, help="significance level for the baseline"
+    )
+    cmd_parser.add_argument(
+        "--threshold", type=float, default=3, help="percent slowdown or heap growth that fails"
+    )
     cmd_parser.add_argument("N", nargs=1, help="N parameter (approximate target CPU frequency)")
     cmd_parser.add_argument("M", nargs=1, help="M parameter (approximate target heap in kbytes)")
     cmd_parser.add_argument("files", nargs="*", help="input test files")
@@ -270,12 +390,22 @@ def main():
 
     print("N={} M={} n_average={}".format(N, M, n_average))
 
-    run_benchmarks(target, N, M, n_average, tests)
+    benchmarks = run_benchmarks(target, N, M, n_average, tests)
 
     if isinstance(target, pyboard.Pyboard):
         target.exit_raw_repl()
         target.close()
 
+    results = {"N": N, "M": M, "emit": args.emit, "benchmarks": benchmarks}
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump(results, f, indent=1, sort_keys=True)
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+        if compare_baseline(baseline, results, args.alpha, args.threshold):
+            sys.exit(1)
+
 
 if __name__ == "__main__":
     main()
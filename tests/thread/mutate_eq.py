@@ -0,0 +1,86 @@
+# test that __eq__ and __hash__ of keys can use other shared objects while a
+# dict, set or list looks them up
+
+import _thread
+
+
+class Key:
+    def __init__(self, n, other):
+        self.n = n
+        self.other = other
+
+    def __hash__(self):
+        return self.n
+
+    def __eq__(self, x):
+        if not isinstance(x, Key):
+            return False
+        # use the dict and list of the other thread, which may be looking
+        # up a key in them at the same time
+        self.other["d"][self.n] = x.n
+        self.other["l"][-1]
+        return x.n == self.n
+
+
+def th(mine, other, n):
+    d = mine["d"]
+    l = mine["l"]
+    s = mine["s"]
+    for i in range(n):
+        k = Key(i % 5, other)
+        d[k] = i
+        assert d.get(Key(i % 5, other)) == i
+        assert Key(i % 5, other) in s
+        assert l.index(Key(i % 5, other)) == i % 5
+        assert l.count(Key(i % 5, other)) == 1
+        l.remove(Key(i % 5, other))
+        l.insert(i % 5, Key(i % 5, other))
+        assert d.setdefault(Key(i % 5, other), -1) == i
+    with lock:
+        global n_finished
+        n_finished += 1
+
+
+def make():
+    return {"d": {}, "l": [], "s": set()}
+
+
+lock = _thread.allocate_lock()
+n_finished = 0
+objs = (make(), make())
+for o, p in ((objs[0], objs[1]), (objs[1], objs[0])):
+    o["l"].extend(Key(i, p) for i in range(5))
+for o, p in ((objs[0], objs[1]), (objs[1], objs[0])):
+    o["s"].update(Key(i, p) for i in range(5))
+
+_thread.start_new_thread(th, (objs[0], objs[1], 2000))
+_thread.start_new_thread(th, (objs[1], objs[0], 2000))
+
+# busy wait for threads to finish
+while n_finished < 2:
+    pass
+
+
+# a key whose __eq__ grows the dict being looked up, so its table is replaced
+class Grow:
+    def __hash__(self):
+        return 0
+
+    def __eq__(self, x):
+        global n_grow, n_key
+        if n_grow < 5:
+            n_grow += 1
+            for i in range(20):
+                n_key += 1
+                d[str(n_key)] = i
+        return x is self
+
+
+n_grow = 0
+n_key = 0
+d = {}
+g = [Grow() for i in range(3)]
+for x in g:
+    d[x] = 1
+print(all(d[x] == 1 for x in g), len(d) == 3 + n_key)
+print("done", n_finished)
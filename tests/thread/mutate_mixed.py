@@ -0,0 +1,58 @@
+# test concurrent mutating and reading access to shared lists, dicts and sets,
+# where some threads resize the containers while others iterate over them
+
+import _thread
+
+li = []
+di = {}
+se = set()
+
+# each writer thread works on its own keys, growing and shrinking the shared
+# containers so their storage is reallocated
+def writer(n, lo, hi):
+    for repeat in range(n):
+        for i in range(lo, hi):
+            li.append(i)
+            di[i] = i
+            se.add(i)
+        for i in range(lo, hi):
+            li.remove(i)
+            assert di.pop(i) == i
+            se.discard(i)
+        assert i not in di and i not in se
+    with lock:
+        global n_finished
+        n_finished += 1
+
+
+# reader threads check that everything they see is well formed
+def reader(n):
+    for repeat in range(n):
+        for x in li:
+            assert type(x) is int
+        for k, v in list(di.items()):
+            assert k == v
+        for x in set(se):
+            assert type(x) is int
+        li[:]
+        li.count(-1)
+    with lock:
+        global n_finished
+        n_finished += 1
+
+
+lock = _thread.allocate_lock()
+n_writer = 3
+n_reader = 2
+n_finished = 0
+
+for i in range(n_writer):
+    _thread.start_new_thread(writer, (10, i * 100, (i + 1) * 100))
+for i in range(n_reader):
+    _thread.start_new_thread(reader, (100,))
+
+# busy wait for threads to finish
+while n_finished < n_writer + n_reader:
+    pass
+
+print(li, di, se)
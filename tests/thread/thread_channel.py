@@ -0,0 +1,80 @@
+# test _thread.Channel, a single-producer single-consumer message queue
+#
+# MIT license; Copyright (c) 2021 Damien P. George
+
+try:
+    import utime as time
+except ImportError:
+    import time
+import _thread
+
+try:
+    _thread.Channel
+except AttributeError:
+    print("SKIP")
+    raise SystemExit
+
+# basic operations in a single thread
+ch = _thread.Channel(32)
+print(ch.any(), ch.recv())
+print(ch.send(b"abc"), ch.send("de"))
+print(ch.any(), ch.recv(), ch.recv())
+print(ch.recv())
+
+# channel full
+n = 0
+while ch.send(b"xyz"):
+    n += 1
+print(n > 0, ch.send(b"xyz"))
+while ch.recv() is not None:
+    n -= 1
+print(n)
+
+# message longer than the channel can ever hold
+try:
+    ch.send(bytes(64))
+except ValueError:
+    print("ValueError")
+
+# recv_into with a buffer too small leaves the message queued
+ch.send(b"12345")
+buf = bytearray(4)
+try:
+    ch.recv_into(buf)
+except ValueError:
+    print("ValueError")
+buf = bytearray(8)
+print(ch.recv_into(buf), buf[:5])
+print(ch.recv_into(buf))
+
+# producer thread, consumer in the main thread
+N = 200
+ch = _thread.Channel(64)
+done = False
+
+
+def producer():
+    global done
+    for i in range(N):
+        msg = bytes([i & 0xFF]) * (i % 7)
+        while not ch.send(msg):
+            pass
+    done = True
+
+
+_thread.start_new_thread(producer, ())
+
+count = 0
+ok = True
+while count < N:
+    msg = ch.recv()
+    if msg is None:
+        time.sleep(0.001)
+        continue
+    if msg != bytes([count & 0xFF]) * (count % 7):
+        ok = False
+    count += 1
+
+while not done:
+    time.sleep(0.01)
+print(count, ok, ch.recv())
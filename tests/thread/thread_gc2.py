@@ -0,0 +1,40 @@
+# test that small objects allocated by threads survive collections done by
+# other threads while they are being allocated
+
+import gc
+import _thread
+
+
+def thread_entry(n, base):
+    # build a linked chain of small tuples, collecting every now and then
+    chain = None
+    for i in range(n):
+        chain = (base + i, chain)
+        if i % 100 == 0:
+            gc.collect()
+
+    # walk the chain to check that every link is intact
+    i = n
+    while chain is not None:
+        i -= 1
+        value, chain = chain
+        if value != base + i:
+            break
+
+    with lock:
+        print(i == 0)
+        global n_finished
+        n_finished += 1
+
+
+lock = _thread.allocate_lock()
+n_thread = 4
+n_finished = 0
+
+# spawn threads
+for i in range(n_thread):
+    _thread.start_new_thread(thread_entry, (1000, i * 1000))
+
+# busy wait for threads to finish
+while n_finished < n_thread:
+    pass
@@ -0,0 +1,81 @@
+# test _thread.Queue, a bounded queue for multiple producers and consumers
+#
+# MIT license; Copyright (c) 2021 Damien P. George
+
+import _thread
+
+try:
+    _thread.Queue
+except AttributeError:
+    print("SKIP")
+    raise SystemExit
+
+# basic operations in a single thread
+q = _thread.Queue(2)
+print(q.qsize(), q.empty(), q.full())
+q.put(1)
+q.put("two", timeout=1)
+print(q.qsize(), q.empty(), q.full())
+print(q.get(), q.get(block=False))
+print(q.qsize(), q.empty(), q.full())
+
+# non-blocking and timed out operations raise OSError
+try:
+    q.get(False)
+except OSError as er:
+    print("OSError", er.errno == 11)
+try:
+    q.get(timeout=0.01)
+except OSError as er:
+    print("OSError", er.errno == 110)
+q.put(None)
+q.put(None)
+try:
+    q.put(None, timeout=0)
+except OSError as er:
+    print("OSError", er.errno == 110)
+
+# producer and consumer threads
+N = 500
+n_producer = 2
+n_consumer = 2
+q = _thread.Queue(4)
+lock = _thread.allocate_lock()
+total = 0
+n_finished = 0
+
+
+def producer(base):
+    global n_finished
+    for i in range(N):
+        q.put(base + i)
+    with lock:
+        n_finished += 1
+
+
+def consumer():
+    global n_finished, total
+    s = 0
+    while True:
+        item = q.get()
+        if item is None:
+            break
+        s += item
+    with lock:
+        total += s
+        n_finished += 1
+
+
+for i in range(n_consumer):
+    _thread.start_new_thread(consumer, ())
+for i in range(n_producer):
+    _thread.start_new_thread(producer, (i * N,))
+
+# busy wait for the producers, then stop the consumers
+while n_finished < n_producer:
+    pass
+for i in range(n_consumer):
+    q.put(None)
+while n_finished < n_producer + n_consumer:
+    pass
+print(total == sum(range(n_producer * N)), q.empty())
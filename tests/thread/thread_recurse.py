@@ -0,0 +1,28 @@
+# test recursive calls in threads, which run on their own Python stack if
+# the VM is stackless
+import _thread
+
+
+def rec(n):
+    return 0 if n == 0 else 1 + rec(n - 1)
+
+
+def thread_entry(n):
+    global n_finished
+    r = rec(n)
+    with lock:
+        results.append(r)
+        n_finished += 1
+
+
+lock = _thread.allocate_lock()
+results = []
+n_finished = 0
+n_thread = 3
+for i in range(n_thread):
+    _thread.start_new_thread(thread_entry, (10 * (i + 1),))
+
+# busy wait for threads to finish
+while n_finished < n_thread:
+    pass
+print(sorted(results))
@@ -0,0 +1,40 @@
+# test passing the stack size of a thread to start_new_thread
+#
+# MIT license; Copyright (c) 2021 Damien P. George
+import _thread
+
+
+def thread_entry(a, b=0):
+    with lock:
+        global total, n_finished
+        total += a + b
+        n_finished += 1
+
+
+lock = _thread.allocate_lock()
+total = 0
+n_finished = 0
+
+# the stack size is given for these threads only, with and without kwargs
+for args in ((1,), (2,)):
+    while True:
+        try:
+            if args[0] == 1:
+                _thread.start_new_thread(thread_entry, args, stack_size=8192)
+            else:
+                _thread.start_new_thread(thread_entry, args, {"b": 3}, stack_size=8192)
+            break
+        except OSError:
+            pass
+print(_thread.stack_size())
+
+# unknown keyword arguments are rejected
+try:
+    _thread.start_new_thread(thread_entry, (1,), foo=1)
+except TypeError:
+    print("TypeError")
+
+# busy wait for threads to finish
+while n_finished < 2:
+    pass
+print(total)
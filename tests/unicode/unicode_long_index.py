@@ -0,0 +1,49 @@
+# test indexing, slicing and searching long str objects, which may be indexed
+
+# build strings that are not interned, both ASCII and with multibyte characters
+strs = [
+    "".join(chr(65 + i % 26) for i in range(200)),
+    "".join(("a", "é", "€", "😀")[i % 4] for i in range(150)),
+    "".join("Привет, мир " for i in range(20)),
+    "😀" * 70 + "x",
+]
+
+for s in strs:
+    chars = list(s)
+    n = len(chars)
+    print(len(s) == n)
+
+    # every index, forwards and backwards
+    print(all(s[i] == chars[i] for i in range(n)))
+    print(all(s[-i] == chars[-i] for i in range(1, n + 1)))
+
+    # out of range indices
+    for i in (n, n + 100, -n - 1, -n - 100):
+        try:
+            s[i]
+        except IndexError:
+            print("IndexError")
+
+    # slices, including ones clipped to the ends
+    ok = True
+    for a in range(-n - 3, n + 3, 7):
+        for b in range(-n - 3, n + 3, 11):
+            if s[a:b] != "".join(chars[a:b]):
+                ok = False
+    print(ok)
+    print(s[:0] == "", s[n:] == "", s[-1:] == chars[-1])
+
+    # find returns character indices
+    for c in set(chars):
+        i = s.find(c)
+        j = s.rfind(c)
+        print(i == chars.index(c), j == n - 1 - chars[::-1].index(c))
+        print(s.find(c, j) == j, s.find(c, j + 1), s.index(c, i) == i)
+
+# str from bytes shares the data with the bytes object
+b = ("ab" * 40).encode()
+s = str(b, "utf-8")
+print(len(s), s[79], s[-80], s[10:14])
+b = ("aé" * 40).encode()
+s = str(b, "utf-8")
+print(len(s), s[79], s[-80], s[10:14], s.find("é", 11))
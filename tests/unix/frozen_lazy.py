@@ -0,0 +1,25 @@
+# test frozen package whose names are imported when first used
+
+try:
+    import frzmpy_lazy
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+# nothing is loaded until it's used
+print(frzmpy_lazy.__name__)
+print(frzmpy_lazy.Foo.x)
+print(frzmpy_lazy.Foo is frzmpy_lazy.foo.Foo)
+
+# a submodule that's also a name, loaded by from-import
+from frzmpy_lazy import bar
+
+print(bar.y, frzmpy_lazy.bar is bar)
+
+# loaded names are kept in the package
+print(sorted(k for k in dir(frzmpy_lazy) if not k.startswith("_")))
+
+try:
+    frzmpy_lazy.baz
+except AttributeError:
+    print("AttributeError")
@@ -0,0 +1,38 @@
+# test frozen module with its globals in ROM
+
+import sys
+
+try:
+    import frzmpy_rom
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+m = frzmpy_rom
+print(m.__name__, m.X, m.NAME, m.F, m.BIG, m.N, m.Y, m.Z, m.count)
+print(list(m.gen()))
+
+# functions use the module's globals
+print(m.bump(), m.count)
+m.X = 5
+print(list(m.gen()), m.X)
+m.new = 6
+print(m.new)
+del m.NAME
+print(hasattr(m, "NAME"))
+
+# classes
+o = m.Sub(3)
+print(o.get(), o.a, o.b, isinstance(o, m.Base), issubclass(m.Sub, m.Base))
+print(m.Base(3).get(), type(o).__name__, m.Sub.__module__)
+m.Base.a = 7
+m.Base.c = 8
+print(o.a, o.c, m.Sub.a)
+o.a = 9
+print(o.a, m.Base.a)
+
+# importing again starts from the frozen state
+del sys.modules["frzmpy_rom"]
+import frzmpy_rom
+
+print(frzmpy_rom.X, frzmpy_rom.NAME, frzmpy_rom.Z, frzmpy_rom.Base.a, hasattr(frzmpy_rom, "new"))
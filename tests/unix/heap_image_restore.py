@@ -0,0 +1,59 @@
+# test that a heap saved by micropython.heap_image_save is restored at startup
+
+try:
+    import ffi, micropython, uos
+
+    micropython.heap_image_save
+except (ImportError, AttributeError):
+    print("SKIP")
+    raise SystemExit
+
+
+def ffi_open(names):
+    err = None
+    for n in names:
+        try:
+            mod = ffi.open(n)
+            return mod
+        except OSError as e:
+            err = e
+    raise err
+
+
+libc = ffi_open(("libc.so", "libc.so.0", "libc.so.6", "libc.dylib"))
+system = libc.func("i", "system", "s")
+readlink = libc.func("i", "readlink", "spi")
+
+# an image is only restored with the heap at the same address, so address
+# space randomisation is turned off for both runs
+if system("setarch -R true 2>/dev/null") != 0:
+    print("SKIP")
+    raise SystemExit
+
+buf = bytearray(256)
+exe = str(buf[: readlink("/proc/self/exe", buf, len(buf))], "utf-8")
+img = "heap_image_restore.img"
+
+# save a heap with objects that use the free lists and allocation buffers
+save = (
+    "import micropython\n"
+    "x = [1.5 * i for i in range(100)]\n"
+    "d = {'a': x, 'b': 'hello' * 3, 'c': [[i] for i in range(50)]}\n"
+    "f = open('%s', 'wb')\n"
+    "micropython.heap_image_save(f)\n"
+    "f.close()\n"
+) % img
+system("setarch -R %s -c \"%s\"" % (exe, save))
+
+# the objects are there in the restored run, and it can allocate and collect
+load = (
+    "import gc\n"
+    "print(d['a'] is x, sum(x), d['b'], sum(l[0] for l in d['c']))\n"
+    "for i in range(3):\n"
+    "    y = [[j * 1.5] for j in range(1000)]\n"
+    "    gc.collect()\n"
+    "print(len(y), y[999][0], sum(x))\n"
+)
+system("MICROPYHEAPIMAGE=%s setarch -R %s -c \"%s\"" % (img, exe, load))
+
+uos.remove(img)
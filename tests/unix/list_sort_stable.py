@@ -0,0 +1,49 @@
+# test that list.sort and sorted are stable, and compute each key once
+
+# equal keys keep their order, also when reversed
+pairs = [(i % 3, i) for i in range(40)]
+print(sorted(pairs, key=lambda p: p[0]))
+print(sorted(pairs, key=lambda p: p[0], reverse=True))
+
+# runs that are already in order, or in reverse order
+l = list(range(100)) + list(range(50)) + list(range(80, 0, -1))
+print(sorted(l) == sorted(l, key=lambda x: x))
+print(sorted(l)[::7])
+print(sorted(l, reverse=True)[::7])
+
+# str and mixed int/float keys
+words = "the quick brown fox jumps over the lazy dog".split()
+print(sorted(words), sorted(words, key=len))
+print(sorted([3, 1.5, 2, -1, 0.5, True]))
+
+# the key function is called once per item
+calls = 0
+
+
+def key(x):
+    global calls
+    calls += 1
+    return -x
+
+
+sorted(range(100), key=key)
+print(calls)
+
+
+# a comparison that raises leaves the list as it was
+class Cmp:
+    def __init__(self, x):
+        self.x = x
+
+    def __lt__(self, other):
+        if self.x == 13 or other.x == 13:
+            raise ValueError("cmp")
+        return self.x < other.x
+
+
+l = [Cmp(x) for x in range(30, 0, -1)]
+try:
+    l.sort()
+except ValueError as er:
+    print(er)
+print([c.x for c in l][:5])
@@ -0,0 +1,77 @@
+# test uselect.uring batches of reads and writes
+
+try:
+    import uos, uselect, usocket
+
+    uselect.uring
+except (ImportError, AttributeError):
+    print("SKIP")
+    raise SystemExit
+
+try:
+    ring = uselect.uring(4)
+except OSError:
+    # kernel without io_uring, or disabled by seccomp
+    print("SKIP")
+    raise SystemExit
+
+# a connected pair of TCP sockets
+listener = usocket.socket()
+listener.setsockopt(usocket.SOL_SOCKET, usocket.SO_REUSEADDR, 1)
+listener.bind(usocket.getaddrinfo("127.0.0.1", 8002)[0][-1])
+listener.listen(1)
+a = usocket.socket()
+a.connect(usocket.getaddrinfo("127.0.0.1", 8002)[0][-1])
+b, _ = listener.accept()
+listener.close()
+
+# nothing queued
+print(ring.submit(), ring.complete())
+
+# two writes in one submission, tokens default to None
+ring.write(a, b"hello ")
+ring.write(a.fileno(), b"world", "w2")
+print(ring.submit(1) >= 1)
+res = []
+while len(res) < 2:
+    ring.submit(1)
+    res += ring.complete()
+print(sorted(res, key=str))
+
+# a read completes when the data arrives, which poll can wait for
+buf = bytearray(16)
+ring.readinto(b, buf, "r1")
+ring.submit()
+poller = uselect.poll()
+poller.register(ring, uselect.POLLIN)
+print(len(poller.poll(1000)))
+res = ring.complete()
+print(res, buf[: res[0][1]])
+
+# errors are reported as -errno
+f = open("/dev/null", "rb")
+ring.write(f, b"x", "bad")
+ring.submit(1)
+print(ring.complete()[0][1] < 0)
+f.close()
+
+# more operations than the ring can hold
+n = 0
+try:
+    for n in range(100):
+        ring.readinto(b, bytearray(1), n)
+except OSError:
+    print("OSError", n > 1)
+ring.submit()
+
+# complete the reads before closing
+a.write(bytes(n))
+res = []
+while len(res) < n:
+    ring.submit(1)
+    res += ring.complete()
+print(sorted(res) == [(i, 1) for i in range(n)])
+
+ring.close()
+a.close()
+b.close()
@@ -28,6 +28,8 @@ from __future__ import print_function
 import sys
 import os
 import subprocess
+import hashlib
+import concurrent.futures
 
 
 ###########################################################################
@@ -126,6 +128,40 @@ def freeze_mpy(path, script=None, opt=0):
     freeze_internal(KIND_MPY, path, script, opt)
 
 
+def freeze_lazy(package, names, opt=0):
+    """Freeze an __init__.py for `package` that imports the names of the
+    package from its submodules the first time they are used, rather than
+    when the package is imported.  A program then only spends the time and
+    RAM to load the parts of a big package that it uses.
+
+    `names` is a dict that maps each name to the submodule defining it,
+    relative to the package.  A name that is the same as its submodule is
+    the submodule itself.  The submodules must be frozen separately, and the
+    package must not have an __init__.py of its own, e.g.
+
+        freeze("$(PORT_DIR)/modules", "net")
+        freeze_lazy("net", {"WLAN": "wlan", "wlan": "wlan", "BLE": "ble"})
+
+    `opt` is the optimisation level to pass to mpy-cross.
+    """
+
+    for name, module in names.items():
+        if not (name.isidentifier() and module.isidentifier()):
+            raise FreezeError("invalid lazy name {} for {}".format(name, module))
+    script = package.replace(".", "/") + "/__init__.py"
+    source = LAZY_INIT.format(
+        ", ".join("{!r}: {!r}".format(name, module) for name, module in sorted(names.items()))
+    )
+    path = os.path.join(BUILD_DIR, "frozen_lazy")
+    filename = os.path.join(path, script)
+    # only write the file if it changed, so it isn't compiled again
+    if read_file(filename) != source:
+        mkdir(filename)
+        with open(filename, "w") as f:
+            f.write(source)
+    manifest_list.append((KIND_AS_MPY, path, script, opt))
+
+
 ###########################################################################
 # Internal implementation
 
@@ -136,8 +172,24 @@ KIND_MPY = 3
 
 VARS = {}
 
+BUILD_DIR = None
+
 manifest_list = []
 
+# the __init__.py of a package frozen with freeze_lazy
+LAZY_INIT = """# generated by makemanifest.py freeze_lazy
+_lazy = {{{}}}
+
+
+def __getattr__(name):
+    if name not in _lazy:
+        raise AttributeError(name)
+    mod = __import__(__name__ + "." + _lazy[name], None, None, (name,))
+    value = mod if name == _lazy[name] else getattr(mod, name)
+    globals()[name] = value
+    return value
+"""
+
 
 class IncludeOptions:
     def __init__(self, **kwargs):
@@ -190,6 +242,24 @@ def get_timestamp_newest(path):
     return ts_newest
 
 
+def get_hash(filename, *extra):
+    h = hashlib.sha256()
+    for s in extra:
+        h.update(s.encode())
+        h.update(b"\0")
+    with open(filename, "rb") as f:
+        h.update(f.read())
+    return h.hexdigest()
+
+
+def read_file(filename):
+    try:
+        with open(filename) as f:
+            return f.read()
+    except OSError:
+        return None
+
+
 def mkdir(filename):
     path = os.path.dirname(filename)
     if not os.path.isdir(path):
@@ -248,6 +318,9 @@ def main():
         "-f", "--mpy-cross-flags", default="", help="flags to pass to mpy-cross"
     )
     cmd_parser.add_argument("-v", "--var", action="append", help="variables to substitute")
+    cmd_parser.add_argument(
+        "-j", "--jobs", type=int, default=os.cpu_count(), help="number of mpy-cross processes"
+    )
     cmd_parser.add_argument("files", nargs="+", help="input manifest list")
     args = cmd_parser.parse_args()
 
@@ -262,6 +335,9 @@ def main():
         print("MPY_DIR and PORT_DIR variables must be specified")
         sys.exit(1)
 
+    global BUILD_DIR
+    BUILD_DIR = os.path.abspath(args.build_dir)
+
     # Get paths to tools
     MAKE_FROZEN = VARS["MPY_DIR"] + "/tools/make-frozen.py"
     MPY_CROSS = VARS["MPY_DIR"] + "/mpy-cross/mpy-cross"
@@ -289,7 +365,9 @@ def main():
     # Process the manifest
     str_paths = []
     mpy_files = []
+    to_compile = []
     ts_newest = 0
+    mpy_cross_hash = None
     for kind, path, script, opt in manifest_list:
         if kind == KIND_AS_STR:
             str_paths.append(path)
@@ -300,18 +378,15 @@ def main():
             ts_infile = get_timestamp(infile)
             ts_outfile = get_timestamp(outfile, 0)
             if ts_infile >= ts_outfile:
-                print("MPY", script)
-                mkdir(outfile)
-                res, out = system(
-                    [MPY_CROSS]
-                    + args.mpy_cross_flags.split()
-                    + ["-o", outfile, "-s", script, "-O{}".format(opt), infile]
-                )
-                if res != 0:
-                    print("error compiling {}:".format(infile))
-                    sys.stdout.buffer.write(out)
-                    raise SystemExit(1)
-                ts_outfile = get_timestamp(outfile)
+                # The source is newer than the .mpy, but it only needs compiling
+                # again if its contents, the flags or mpy-cross itself changed
+                # since the .mpy was made (eg not after a fresh checkout).
+                cmd = args.mpy_cross_flags.split() + ["-s", script, "-O{}".format(opt)]
+                if mpy_cross_hash is None:
+                    mpy_cross_hash = get_hash(MPY_CROSS)
+                src_hash = get_hash(infile, mpy_cross_hash, *cmd)
+                if ts_outfile == 0 or read_file(outfile + ".hash") != src_hash:
+                    to_compile.append((script, infile, outfile, cmd, src_hash))
             mpy_files.append(outfile)
         else:
             assert kind == KIND_MPY
@@ -320,6 +395,28 @@ def main():
             ts_outfile = get_timestamp(infile)
         ts_newest = max(ts_newest, ts_outfile)
 
+    # Compile the .py files that changed, using a process per job
+    def compile_mpy(script, infile, outfile, cmd, src_hash):
+        mkdir(outfile)
+        res, out = system([MPY_CROSS] + cmd + ["-o", outfile, infile])
+        if res == 0:
+            with open(outfile + ".hash", "w") as f:
+                f.write(src_hash)
+        return res, out
+
+    with concurrent.futures.ThreadPoolExecutor(max(1, args.jobs)) as executor:
+        jobs = [(job, executor.submit(compile_mpy, *job)) for job in to_compile]
+        for (script, infile, outfile, _, _), future in jobs:
+            print("MPY", script)
+            res, out = future.result()
+            if res != 0:
+                print("error compiling {}:".format(infile))
+                sys.stdout.buffer.write(out)
+                for _, f in jobs:
+                    f.cancel()
+                raise SystemExit(1)
+            ts_newest = max(ts_newest, get_timestamp(outfile))
+
     # Check if output file needs generating
     if ts_newest < get_timestamp(args.output, 0):
         # No files are newer than output file so it does not need updating
@@ -0,0 +1,157 @@
+#!/usr/bin/env python3
+#
+# This tool converts a BDF bitmap font into the format read by framebuf.Font.
+#
+# With --scale N the BDF font is taken to be drawn at N times the wanted size:
+# each N x N block of its pixels becomes one 4-bit anti-aliased pixel whose
+# alpha is the fraction of the block that is set.  Without --scale the font is
+# converted as is, at 1 bit per pixel.  Run the tool once per size wanted.
+#
+# The output is either the raw font data, or with --py a Python module that
+# defines FONT as a bytes object, which can be frozen so the font stays in
+# flash:
+#
+#     import framebuf, myfont
+#     font = framebuf.Font(myfont.FONT)
+#     fbuf.text("Hello", 0, 0, 0xFFFF, font)
+
+import argparse
+import struct
+
+
+def parse_bdf(filename):
+    ascent = descent = None
+    glyphs = {}
+    with open(filename) as f:
+        lines = iter(f.read().splitlines())
+    for line in lines:
+        words = line.split()
+        if not words:
+            continue
+        if words[0] == "FONT_ASCENT":
+            ascent = int(words[1])
+        elif words[0] == "FONT_DESCENT":
+            descent = int(words[1])
+        elif words[0] == "STARTCHAR":
+            code = advance = bbx = None
+            rows = []
+            for line in lines:
+                words = line.split() or [""]
+                if words[0] == "ENCODING":
+                    code = int(words[1])
+                elif words[0] == "DWIDTH":
+                    advance = int(words[1])
+                elif words[0] == "BBX":
+                    bbx = [int(w) for w in words[1:5]]
+                elif words[0] == "BITMAP":
+                    for line in lines:
+                        if line.startswith("ENDCHAR"):
+                            break
+                        # each row is hex digits, left aligned to a whole byte
+                        rows.append((int(line or "0", 16), len(line) * 4))
+                    break
+            if code is not None and code >= 0 and bbx is not None:
+                glyphs[code] = (bbx[0] if advance is None else advance, bbx, rows)
+    if ascent is None or descent is None:
+        raise SystemExit("%s: missing FONT_ASCENT or FONT_DESCENT" % filename)
+    return ascent, descent, glyphs
+
+
+def render(ascent, descent, bbx, rows):
+    # Draw the glyph into a cell of the full line height, as rows of 0/1.
+    w, h, xoff, yoff = bbx
+    cell_w = max(0, xoff) + w
+    cell = [[0] * cell_w for _ in range(ascent + descent)]
+    top = ascent - (yoff + h)
+    for r, (bits, nbits) in enumerate(rows):
+        y = top + r
+        if not 0 <= y < len(cell):
+            continue
+        for c in range(w):
+            x = max(0, xoff) + c
+            if bits >> (nbits - 1 - c) & 1:
+                cell[y][x] = 1
+    return cell
+
+
+def downscale(cell, scale):
+    h = (len(cell) + scale - 1) // scale
+    w = ((len(cell[0]) if cell else 0) + scale - 1) // scale
+    out = [[0] * w for _ in range(h)]
+    for y, row in enumerate(cell):
+        for x, v in enumerate(row):
+            out[y // scale][x // scale] += v
+    n = scale * scale
+    return [[(v * 15 + n // 2) // n for v in row] for row in out]
+
+
+def pack_row(row, bpp):
+    data = bytearray((len(row) * bpp + 7) // 8)
+    for x, v in enumerate(row):
+        if bpp == 1:
+            data[x // 8] |= v << (7 - x % 8)
+        else:
+            data[x // 2] |= v << (0 if x & 1 else 4)
+    return data
+
+
+def make_font(filename, scale, first, last):
+    ascent, descent, glyphs = parse_bdf(filename)
+    bpp = 4 if scale > 1 else 1
+    height = (ascent + descent + scale - 1) // scale
+    codes = [c for c in sorted(glyphs) if first <= c <= last]
+    if not codes:
+        raise SystemExit("%s: no glyphs in range" % filename)
+    first = codes[0]
+    count = codes[-1] - first + 1
+    if height > 255 or count > 65535:
+        raise SystemExit("%s: font too large" % filename)
+
+    table = bytearray()
+    bitmaps = bytearray()
+    bitmap_base = 8 + 6 * count
+    for code in range(first, first + count):
+        if code not in glyphs:
+            # missing glyphs have an empty bitmap and no advance
+            table += struct.pack("<IBB", bitmap_base, 0, 0)
+            continue
+        advance, bbx, rows = glyphs[code]
+        cell = render(ascent, descent, bbx, rows)
+        if scale > 1:
+            cell = downscale(cell, scale)
+        width = len(cell[0]) if cell else 0
+        if width > 255:
+            raise SystemExit("%s: glyph %d too wide" % (filename, code))
+        table += struct.pack(
+            "<IBB", bitmap_base + len(bitmaps), width, (advance + scale // 2) // scale
+        )
+        for row in cell:
+            bitmaps += pack_row(row, bpp)
+    header = struct.pack("<BBBBHH", ord("F"), bpp, height, 0, first, count)
+    return header + table + bitmaps
+
+
+def main():
+    cmd_parser = argparse.ArgumentParser(description="Convert a BDF font for framebuf.Font.")
+    cmd_parser.add_argument("--scale", type=int, default=1, help="downscale with anti-aliasing")
+    cmd_parser.add_argument("--first", type=int, default=32, help="first character code")
+    cmd_parser.add_argument("--last", type=int, default=126, help="last character code")
+    cmd_parser.add_argument("--py", action="store_true", help="output a Python module")
+    cmd_parser.add_argument("-o", "--output", required=True, help="output file")
+    cmd_parser.add_argument("bdf", help="input BDF font")
+    args = cmd_parser.parse_args()
+
+    if args.scale < 1:
+        raise SystemExit("scale must be at least 1")
+    data = make_font(args.bdf, args.scale, args.first, args.last)
+    if args.py:
+        with open(args.output, "w") as f:
+            f.write("# Generated by tools/mkfont.py from %s\n" % args.bdf)
+            f.write("FONT = %r\n" % data)
+    else:
+        with open(args.output, "wb") as f:
+            f.write(data)
+
+
+if __name__ == "__main__":
+    main()
@@ -14,10 +14,11 @@ MicroPython device over a serial connection.  Commands supported are:
     mpremote exec <string>           -- execute the string
     mpremote run <script>            -- run the given local script
     mpremote fs <command> <args...>  -- execute filesystem commands on the device
+    mpremote sync <local-dir> [:dir] -- copy changed files in local-dir to the device
     mpremote repl                    -- enter REPL
 """
 
-import os, select, sys, time
+import hashlib, os, select, sys, time
 import serial.tools.list_ports
 
 from . import pyboardextended as pyboard
@@ -264,6 +265,148 @@ def do_filesystem(pyb, args):
     args.clear()
 
 
+# Print one line per entry below the given device directory: "d - path" for a
+# directory and "f <sha256> path" for a file, with paths relative to it, or
+# just "n - ." if the directory doesn't exist.
+_sync_list_code = """\
+import uos
+try:
+ import uhashlib,ubinascii
+except ImportError:
+ uhashlib=None
+def w(d,r):
+ for e in uos.ilistdir(d) if d else uos.ilistdir():
+  if e[0] in ('.','..'):continue
+  p=(d.rstrip('/')+'/' if d else '')+e[0];q=r+e[0]
+  if e[1]&0x4000:
+   print('d -',q);w(p,q+'/')
+  elif uhashlib:
+   h=uhashlib.sha256();b=bytearray(512);m=memoryview(b)
+   with open(p,'rb') as f:
+    while 1:
+     n=f.readinto(b)
+     if not n:break
+     h.update(m[:n])
+   print('f',ubinascii.hexlify(h.digest()).decode(),q)
+  else:
+   print('f -',q)
+d=%r
+try:
+ d and uos.stat(d)
+except OSError:
+ print('n - .')
+else:
+ w(d,'')
+"""
+
+_sync_change_code = """\
+import uos
+for p in %r:
+ uos.remove(p)
+for p in %r:
+ uos.rmdir(p)
+for p in %r:
+ try:
+  uos.mkdir(p)
+ except OSError as e:
+  if e.args[0]!=17:
+   raise
+"""
+
+
+def do_sync(pyb, args):
+    delete = dry_run = False
+    while args and args[0].startswith("-"):
+        opt = args.pop(0)
+        if opt == "--delete":
+            delete = True
+        elif opt in ("-n", "--dry-run"):
+            dry_run = True
+        else:
+            print(f"{_PROG}: sync: unknown option '{opt}'")
+            return 1
+    if not args:
+        print(f"{_PROG}: sync: missing local directory")
+        return 1
+    src = args.pop(0)
+    dest = ""
+    if args and args[0].startswith(":"):
+        dest = args.pop(0)[1:]
+    if not os.path.isdir(src):
+        print(f"{_PROG}: sync: '{src}' is not a directory")
+        return 1
+
+    def remote_path(rel):
+        if not dest:
+            return rel
+        return dest.rstrip("/") + "/" + rel
+
+    # Hash the local tree.
+    local_files = {}
+    local_dirs = set()
+    for dir, dirs, files in os.walk(src):
+        rel_dir = os.path.relpath(dir, src).replace(os.sep, "/")
+        rel_dir = "" if rel_dir == "." else rel_dir + "/"
+        for d in dirs:
+            local_dirs.add(rel_dir + d)
+        for f in files:
+            with open(os.path.join(dir, f), "rb") as fp:
+                local_files[rel_dir + f] = hashlib.sha256(fp.read()).hexdigest()
+
+    try:
+        # Hash the device tree, all in one go.
+        remote_files = {}
+        remote_dirs = set()
+        dest_missing = False
+        for line in pyb.exec_(_sync_list_code % dest).decode("utf8").splitlines():
+            kind, digest, rel = line.split(" ", 2)
+            if kind == "n":
+                dest_missing = True
+            elif kind == "d":
+                remote_dirs.add(rel)
+            else:
+                remote_files[rel] = digest
+
+        # Work out what to change, then make all the deletions and
+        # directories in one go, with parents before their children.
+        put = sorted(rel for rel, h in local_files.items() if remote_files.get(rel) != h)
+        mkdir = [remote_path(rel) for rel in sorted(local_dirs - remote_dirs)]
+        rm, rmdir = [], []
+        if delete:
+            rm = sorted(set(remote_files) - set(local_files))
+            rmdir = sorted(remote_dirs - local_dirs, reverse=True)
+        # A path that changes between file and directory must go first.
+        rm += sorted(rel for rel in remote_files if rel in local_dirs and rel not in rm)
+        rmdir += sorted(
+            (rel for rel in remote_dirs if rel in local_files and rel not in rmdir), reverse=True
+        )
+
+        if dest_missing:
+            # Create the destination and its parents; mkdir skips any that exist.
+            parts = dest.rstrip("/").split("/")
+            mkdir[:0] = ["/".join(parts[: i + 1]) for i in range(len(parts)) if parts[i]]
+        for rel in rm:
+            print("rm :" + remote_path(rel))
+        for rel in rmdir:
+            print("rmdir :" + remote_path(rel))
+        for path in mkdir:
+            print("mkdir :" + path)
+        if (rm or rmdir or mkdir) and not dry_run:
+            pyb.exec_(
+                _sync_change_code
+                % ([remote_path(rel) for rel in rm], [remote_path(rel) for rel in rmdir], mkdir)
+            )
+        for rel in put:
+            print("cp %s :%s" % (os.path.join(src, rel), remote_path(rel)))
+            if not dry_run:
+                pyb.fs_put(os.path.join(src, rel), remote_path(rel))
+        print(f"{len(put)} of {len(local_files)} files changed")
+    except pyboard.PyboardError as er:
+        print(str(er.args[2], "ascii"))
+        return 1
+    return 0
+
+
 def do_repl_main_loop(pyb, console_in, console_out_write, *, code_to_inject, file_to_inject):
     while True:
         if isinstance(console_in, ConsolePosix):
@@ -402,6 +545,7 @@ def main():
                 "exec": (True, True, 1),
                 "run": (True, True, 1),
                 "fs": (True, True, 1),
+                "sync": (True, True, 1),
             }
             cmd = args.pop(0)
             try:
@@ -463,6 +607,10 @@ def main():
                     return ret
             elif cmd == "fs":
                 do_filesystem(pyb, args)
+            elif cmd == "sync":
+                ret = do_sync(pyb, args)
+                if ret:
+                    return ret
             elif cmd == "repl":
                 do_repl(pyb, args)
 
@@ -579,6 +579,8 @@ class PyboardExtended(Pyboard):
                     except serial.SerialException:
                         pass
         self.mounted = True
+        # Binary file transfers could be mistaken for the mount's commands.
+        self.use_raw_file = False
         if self.eval('"RemoteFS" in globals()') == b"False":
             self.exec_(fs_hook_code)
         self.exec_("__mount(%s)" % (dev_out is not None))
@@ -0,0 +1,116 @@
+#!/usr/bin/env python3
+#
+# This tool reads the binary output of micropython.trace_dump() and prints
+# the events as a timeline, with the time of each event relative to the first
+# and to the previous one:
+#
+#     mptrace.py trace.bin
+#
+# With --json the events are also written in the Trace Event format, which
+# chrome://tracing and https://ui.perfetto.dev show as a timeline, with the
+# garbage collections and scheduled functions as spans.  Events are named
+# from py/trace.h, which must be from the same firmware.
+
+import argparse
+import json
+import os
+import re
+import struct
+
+PY_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "py")
+
+# events that start and end a span, for the Trace Event format
+SPANS = {
+    "GC_START": ("GC", "B"),
+    "GC_END": ("GC", "E"),
+    "SCHED_START": ("SCHED", "B"),
+    "SCHED_END": ("SCHED", "E"),
+}
+
+
+def parse_enum(text, name):
+    body = re.search(r"typedef enum \{([^}]*)\} %s;" % name, text).group(1)
+    body = re.sub(r"//.*", "", body)
+    names = {}
+    value = 0
+    for item in body.split(","):
+        m = re.match(r"\s*MP_TRACE_\w+?_(\w+)\s*(?:=\s*(\w+))?\s*$", item)
+        if m:
+            if m.group(2):
+                value = int(m.group(2), 0)
+            names[value] = m.group(1)
+            value += 1
+    return names
+
+
+def load_names():
+    with open(os.path.join(PY_DIR, "trace.h")) as f:
+        text = f.read()
+    events = parse_enum(text, "mp_trace_event_t")
+    sockets = parse_enum(text, "mp_trace_socket_t")
+    return events, sockets
+
+
+def read_trace(filename):
+    with open(filename, "rb") as f:
+        data = f.read()
+    magic, version, size, n, count = struct.unpack_from("<4sBBHI", data)
+    if magic != b"MPTR" or version != 1 or size != 8:
+        raise SystemExit("%s: not a trace of a known format" % filename)
+    # the timestamps are 32 bits, so they are unwrapped assuming less than
+    # 2**32 us (about 71 minutes) between consecutive events
+    events = []
+    last = None
+    for i in range(n):
+        t, event, arg = struct.unpack_from("<IHH", data, 12 + size * i)
+        if last is not None:
+            t = last + ((t - last) & 0xFFFFFFFF)
+        last = t
+        events.append((t, event, arg))
+    return events, count
+
+
+def main():
+    cmd_parser = argparse.ArgumentParser(description="Show the output of micropython.trace_dump().")
+    cmd_parser.add_argument("--json", help="write the events in the Trace Event format to this file")
+    cmd_parser.add_argument("file", help="file with the output of trace_dump()")
+    args = cmd_parser.parse_args()
+
+    events, count = read_trace(args.file)
+    event_names, socket_names = load_names()
+
+    def name(event):
+        if event >= 0x100:
+            return "PORT_%d" % (event - 0x100)
+        return event_names.get(event, "0x%x" % event)
+
+    def arg_str(event, arg):
+        if name(event) == "SOCKET":
+            return socket_names.get(arg, str(arg))
+        if name(event) == "TASK":
+            return "0x%04x" % arg
+        return str(arg)
+
+    if count > len(events):
+        print("%d older events were overwritten\n" % (count - len(events)))
+    t0 = prev = events[0][0] if events else 0
+    for t, event, arg in events:
+        print("%12d %+10d  %-12s %s" % (t - t0, t - prev, name(event), arg_str(event, arg)))
+        prev = t
+
+    if args.json:
+        trace = []
+        for t, event, arg in events:
+            entry = {"ts": t - t0, "pid": 0, "tid": 0, "args": {"arg": arg_str(event, arg)}}
+            span = SPANS.get(name(event))
+            if span:
+                entry.update(name=span[0], ph=span[1])
+            else:
+                entry.update(name=name(event), ph="i", s="t")
+            trace.append(entry)
+        with open(args.json, "w") as f:
+            json.dump({"traceEvents": trace, "displayTimeUnit": "ms"}, f)
+
+
+if __name__ == "__main__":
+    main()
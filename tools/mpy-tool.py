@@ -44,6 +44,7 @@ else:
 
 import sys
 import struct
+import collections
 from collections import namedtuple
 
 sys.path.append(sys.path[0] + "/../py")
@@ -61,6 +62,8 @@ class FreezeError(Exception):
 
 class Config:
     MPY_VERSION = 5
+    MPY_FEATURE_LAZY = 0x40
+    MPY_FEATURE_MAPPED_STR = 0x80
     MICROPY_LONGINT_IMPL_NONE = 0
     MICROPY_LONGINT_IMPL_LONGLONG = 1
     MICROPY_LONGINT_IMPL_MPZ = 2
@@ -76,12 +79,23 @@ class QStrType:
         self.qstr_id = "MP_QSTR_" + self.qstr_esc
 
 
-# Initialise global list of qstrs with static qstrs
+# Initialise global list of qstrs with static qstrs, and a map from their
+# strings to their index, so each distinct string is only in the list once
 global_qstrs = [None]  # MP_QSTRnull should never be referenced
+global_qstr_index = {}
 for n in qstrutil.static_qstr_list:
+    global_qstr_index[n] = len(global_qstrs)
     global_qstrs.append(QStrType(n))
 
 
+def global_qstr_add(s):
+    idx = global_qstr_index.get(s)
+    if idx is None:
+        idx = global_qstr_index[s] = len(global_qstrs)
+        global_qstrs.append(QStrType(s))
+    return idx
+
+
 class QStrWindow:
     def __init__(self, size):
         self.window = []
@@ -112,6 +126,7 @@ MP_NATIVE_ARCH_ARMV7EMSP = 7
 MP_NATIVE_ARCH_ARMV7EMDP = 8
 MP_NATIVE_ARCH_XTENSA = 9
 MP_NATIVE_ARCH_XTENSAWIN = 10
+MP_NATIVE_ARCH_RV32IMC = 11
 
 MP_BC_MASK_EXTRA_BYTE = 0x9E
 
@@ -126,6 +141,29 @@ MP_BC_LOAD_GLOBAL = 0x12
 MP_BC_LOAD_ATTR = 0x13
 MP_BC_STORE_ATTR = 0x18
 
+MP_SCOPE_FLAG_GENERATOR = 0x01
+
+# opcodes that are followed to freeze the globals of a module in ROM
+MP_BC_LOAD_CONST_STRING = 0x10
+MP_BC_STORE_NAME = 0x16
+MP_BC_STORE_GLOBAL = 0x17
+MP_BC_DELETE_NAME = 0x19
+MP_BC_DELETE_GLOBAL = 0x1A
+MP_BC_LOAD_CONST_SMALL_INT = 0x22
+MP_BC_LOAD_CONST_OBJ = 0x23
+MP_BC_MAKE_FUNCTION = 0x32
+MP_BC_CALL_FUNCTION = 0x34
+MP_BC_UNWIND_JUMP = 0x40
+MP_BC_JUMP = 0x42
+MP_BC_SETUP_WITH = 0x47
+MP_BC_LOAD_CONST_FALSE = 0x50
+MP_BC_LOAD_CONST_NONE = 0x51
+MP_BC_LOAD_CONST_TRUE = 0x52
+MP_BC_LOAD_BUILD_CLASS = 0x54
+MP_BC_RETURN_VALUE = 0x63
+MP_BC_IMPORT_STAR = 0x69
+MP_BC_LOAD_CONST_SMALL_INT_MULTI = 0x70
+
 # this function mirrors that in py/bc.c
 def mp_opcode_format(bytecode, ip, count_var_uint):
     opcode = bytecode[ip]
@@ -355,28 +393,33 @@ class RawCode(object):
             for qst in self.qstrs:
                 print("    MP_ROM_QSTR(%s)," % global_qstrs[qst].qstr_id)
             for i in range(len(self.objs)):
-                if self.objs[i] is MPFunTable:
-                    print("    &mp_fun_table,")
-                elif type(self.objs[i]) is float:
-                    print(
-                        "#if MICROPY_OBJ_REPR == MICROPY_OBJ_REPR_A || MICROPY_OBJ_REPR == MICROPY_OBJ_REPR_B"
-                    )
-                    print("    MP_ROM_PTR(&const_obj_%s_%u)," % (self.escaped_name, i))
-                    print("#elif MICROPY_OBJ_REPR == MICROPY_OBJ_REPR_C")
-                    n = struct.unpack("<I", struct.pack("<f", self.objs[i]))[0]
-                    n = ((n & ~0x3) | 2) + 0x80800000
-                    print("    (mp_rom_obj_t)(0x%08x)," % (n,))
-                    print("#elif MICROPY_OBJ_REPR == MICROPY_OBJ_REPR_D")
-                    n = struct.unpack("<Q", struct.pack("<d", self.objs[i]))[0]
-                    n += 0x8004000000000000
-                    print("    (mp_rom_obj_t)(0x%016x)," % (n,))
-                    print("#endif")
-                else:
-                    print("    MP_ROM_PTR(&const_obj_%s_%u)," % (self.escaped_name, i))
+                for line in self.rom_obj(i):
+                    print(line if line.startswith("#") else "    %s," % line)
             for rc in self.raw_codes:
                 print("    MP_ROM_PTR(&raw_code_%s)," % rc.escaped_name)
             print("};")
 
+    def rom_obj(self, i):
+        # the value of constant object i, as lines that are either preprocessor
+        # directives or the value for some object representations
+        obj_name = "const_obj_%s_%u" % (self.escaped_name, i)
+        if self.objs[i] is MPFunTable:
+            return ["&mp_fun_table"]
+        elif type(self.objs[i]) is float:
+            n32 = struct.unpack("<I", struct.pack("<f", self.objs[i]))[0]
+            n64 = struct.unpack("<Q", struct.pack("<d", self.objs[i]))[0]
+            return [
+                "#if MICROPY_OBJ_REPR == MICROPY_OBJ_REPR_A || MICROPY_OBJ_REPR == MICROPY_OBJ_REPR_B",
+                "MP_ROM_PTR(&%s)" % obj_name,
+                "#elif MICROPY_OBJ_REPR == MICROPY_OBJ_REPR_C",
+                "(mp_rom_obj_t)(0x%08x)" % (((n32 & ~0x3) | 2) + 0x80800000,),
+                "#elif MICROPY_OBJ_REPR == MICROPY_OBJ_REPR_D",
+                "(mp_rom_obj_t)(0x%016x)" % (n64 + 0x8004000000000000,),
+                "#endif",
+            ]
+        else:
+            return ["MP_ROM_PTR(&%s)" % obj_name]
+
     def freeze_module(self, qstr_links=(), type_sig=0):
         # generate module
         if self.simple_name.str != "<module>":
@@ -430,6 +473,8 @@ class RawCodeBytecode(RawCode):
         super(RawCodeBytecode, self).__init__(
             MP_CODE_BYTECODE, bytecode, 0, qstrs, objs, raw_codes
         )
+        # start and end of the statements that are jumped over
+        self.rom_jumps = {}
 
     def freeze(self, parent_name):
         self.freeze_children(parent_name)
@@ -454,16 +499,40 @@ class RawCodeBytecode(RawCode):
         for i in range(self.ip2 + 4, self.ip):
             print(" 0x%02x," % self.bytecode[i], end="")
         print()
+        lines = []
         ip = self.ip
         while ip < len(self.bytecode):
             f, sz = mp_opcode_format(self.bytecode, ip, True)
             if f == 1:
                 qst = self._unpack_qstr(ip + 1).qstr_id
-                extra = "" if sz == 3 else " 0x%02x," % self.bytecode[ip + 3]
-                print("   ", "0x%02x," % self.bytecode[ip], qst, "& 0xff,", qst, ">> 8,", extra)
+                line = ["0x%02x" % self.bytecode[ip], qst + " & 0xff", qst + " >> 8"]
+                if sz == 4:
+                    line.append("0x%02x" % self.bytecode[ip + 3])
             else:
-                print("   ", "".join("0x%02x, " % self.bytecode[ip + i] for i in range(sz)))
+                line = ["0x%02x" % self.bytecode[ip + i] for i in range(sz)]
+            lines.append((ip, line))
             ip += sz
+        i = 0
+        while i < len(lines):
+            ip, line = lines[i]
+            end = self.rom_jumps.get(ip)
+            if end is None:
+                print("   ", "".join(b + ", " for b in line))
+                i += 1
+                continue
+            # with its globals in ROM the module jumps over the statements
+            # that made them
+            span = []
+            while lines[i][0] < end:
+                span.extend(lines[i][1])
+                i += 1
+            offset = end - (ip + 3) + 0x8000
+            print("#if MICROPY_MODULE_FROZEN_ROM_GLOBALS")
+            print("    0x%02x, 0x%02x, 0x%02x," % (MP_BC_JUMP, offset & 0xFF, offset >> 8))
+            print("#else")
+            print("   ", "".join(b + ", " for b in span[:3]))
+            print("#endif")
+            print("   ", "".join(b + ", " for b in span[3:]))
         print("};")
 
         self.freeze_constants()
@@ -494,6 +563,7 @@ class RawCodeNative(RawCode):
             MP_NATIVE_ARCH_X64,
             MP_NATIVE_ARCH_XTENSA,
             MP_NATIVE_ARCH_XTENSAWIN,
+            MP_NATIVE_ARCH_RV32IMC,
         ):
             self.fun_data_attributes = '__attribute__((section(".text,\\"ax\\",@progbits # ")))'
         else:
@@ -502,12 +572,14 @@ class RawCodeNative(RawCode):
         # Allow single-byte alignment by default for x86/x64.
         # ARM needs word alignment, ARM Thumb needs halfword, due to instruction size.
         # Xtensa needs word alignment due to the 32-bit constant table embedded in the code.
+        # RV32 needs word alignment as the native emitter only uses 32-bit instructions.
         if config.native_arch in (
             MP_NATIVE_ARCH_ARMV6,
             MP_NATIVE_ARCH_XTENSA,
             MP_NATIVE_ARCH_XTENSAWIN,
+            MP_NATIVE_ARCH_RV32IMC,
         ):
-            # ARMV6 or Xtensa -- four byte align.
+            # ARMV6, Xtensa or RV32 -- four byte align.
             self.fun_data_attributes += " __attribute__ ((aligned (4)))"
         elif MP_NATIVE_ARCH_ARMV6M <= config.native_arch <= MP_NATIVE_ARCH_ARMV7EMDP:
             # ARMVxxM -- two byte align.
@@ -519,6 +591,16 @@ class RawCodeNative(RawCode):
         print(" (%s & 0xff)," % (val,), end="")
         print(" (%u & 0x07) | (%s >> 4 & 0x70)," % (self.bytecode[pc + 3], val))
 
+    def _asm_rv32_rewrite_lui_addi(self, pc, val):
+        # the upper part is rounded up as addi sign extends the lower 12 bits
+        print("    %u," % (self.bytecode[pc],), end="")
+        print(" (%u & 0x0f) | ((%s + 0x800) >> 8 & 0xf0)," % (self.bytecode[pc + 1], val), end="")
+        print(" ((%s + 0x800) >> 16 & 0xff), ((%s + 0x800) >> 24 & 0xff)," % (val, val), end="")
+        print(" %u, %u," % (self.bytecode[pc + 4], self.bytecode[pc + 5]), end="")
+        print(
+            " (%u & 0x0f) | (%s << 4 & 0xf0), (%s >> 4 & 0xff)," % (self.bytecode[pc + 6], val, val)
+        )
+
     def _link_qstr(self, pc, kind, qst):
         if kind == 0:
             # Generic 16-bit link
@@ -551,6 +633,10 @@ class RawCodeNative(RawCode):
                     # qstr number, movw instruction
                     self._asm_thumb_rewrite_mov(pc, qst)
                     return 4
+            elif config.native_arch == MP_NATIVE_ARCH_RV32IMC:
+                # lui and addi
+                self._asm_rv32_rewrite_lui_addi(pc, qst)
+                return 8
             else:
                 assert 0
 
@@ -620,6 +706,305 @@ class RawCodeNative(RawCode):
         self.freeze_module(self.qstr_links, self.type_sig)
 
 
+# The globals of a frozen module can be put in ROM, along with the functions and
+# classes that it defines.  Statements at the top level of the module that store
+# a constant, a function without default arguments or closed-over variables, or
+# a class without bases other than such a class and with a body made of such
+# statements, in a global that's assigned nowhere else, are evaluated here.
+# Their results are put in the ROM table that the module starts out with, and
+# the module jumps over these statements.
+
+
+def decode_uint(bytecode, ip):
+    unum = 0
+    while True:
+        b = bytecode[ip]
+        ip += 1
+        unum = (unum << 7) | (b & 0x7F)
+        if not b & 0x80:
+            return unum
+
+
+def decode_sint(bytecode, ip):
+    num = -1 if bytecode[ip] & 0x40 else 0
+    while True:
+        b = bytecode[ip]
+        ip += 1
+        num = (num << 7) | (b & 0x7F)
+        if not b & 0x80:
+            return num
+
+
+def bytecode_insns(rc):
+    # the offset and opcode of each instruction, and then the end offset
+    insns = []
+    ip = rc.ip
+    while ip < len(rc.bytecode):
+        insns.append((ip, rc.bytecode[ip]))
+        ip += mp_opcode_format(rc.bytecode, ip, True)[1]
+    insns.append((ip, None))
+    return insns
+
+
+def make_qstr(s):
+    return global_qstrs[global_qstr_add(s)]
+
+
+class FrozenNamespace:
+    # number of namespaces so far, over all modules
+    count = 0
+
+    def __init__(self, table_name, entries):
+        self.index = FrozenNamespace.count
+        FrozenNamespace.count += 1
+        self.table_name = table_name
+        self.entries = entries
+
+    def c_ref(self):
+        return "&mp_frozen_mpy_globals[%u]" % self.index
+
+
+class FrozenModuleGlobals:
+    # attributes that the importer sets, and classes can't be frozen with
+    importer_names = ("__name__", "__file__", "__path__")
+    unfrozen_class_names = ("__new__", "__slots__", "__setattr__", "__delattr__")
+
+    def __init__(self, rc):
+        self.rc = rc
+        self.funs = []
+        self.classes = []
+        self.namespaces = []
+
+    def value(self, rc, insns, i, globals):
+        # the value that the instructions from i load, if it can be frozen, and
+        # the index of the instruction after them
+        bc = rc.bytecode
+        ip, op = insns[i]
+        if op == MP_BC_LOAD_CONST_FALSE:
+            return ("obj", ["MP_ROM_FALSE"]), i + 1
+        elif op == MP_BC_LOAD_CONST_NONE:
+            return ("obj", ["MP_ROM_NONE"]), i + 1
+        elif op == MP_BC_LOAD_CONST_TRUE:
+            return ("obj", ["MP_ROM_TRUE"]), i + 1
+        elif MP_BC_LOAD_CONST_SMALL_INT_MULTI <= op < MP_BC_LOAD_CONST_SMALL_INT_MULTI + 64:
+            n = op - MP_BC_LOAD_CONST_SMALL_INT_MULTI - 16
+            return ("obj", ["MP_ROM_INT(%d)" % n]), i + 1
+        elif op == MP_BC_LOAD_CONST_SMALL_INT:
+            return ("obj", ["MP_ROM_INT(%d)" % decode_sint(bc, ip + 1)]), i + 1
+        elif op == MP_BC_LOAD_CONST_STRING:
+            return ("obj", ["MP_ROM_QSTR(%s)" % rc._unpack_qstr(ip + 1).qstr_id]), i + 1
+        elif op == MP_BC_LOAD_CONST_OBJ:
+            return ("const", rc, decode_uint(bc, ip + 1) - len(rc.qstrs)), i + 1
+        elif op == MP_BC_MAKE_FUNCTION:
+            idx = decode_uint(bc, ip + 1) - len(rc.qstrs) - len(rc.objs)
+            child = rc.raw_codes[idx]
+            if child.code_kind == MP_CODE_BYTECODE:
+                return ("fun", child), i + 1
+        elif op == MP_BC_LOAD_BUILD_CLASS and globals is not None:
+            # LOAD_BUILD_CLASS, MAKE_FUNCTION, LOAD_CONST_STRING, [LOAD_NAME], CALL_FUNCTION
+            body, i = self.value(rc, insns, i + 1, None)
+            if body is None or body[0] != "fun" or insns[i][1] != MP_BC_LOAD_CONST_STRING:
+                return None, i
+            name = rc._unpack_qstr(insns[i][0] + 1)
+            i += 1
+            base = None
+            if insns[i][1] == MP_BC_LOAD_NAME:
+                base = globals.get(rc._unpack_qstr(insns[i][0] + 1).str)
+                if base is None or base[0] != "class":
+                    return None, i
+                i += 1
+            n_args = 2 + (base is not None)
+            if insns[i][1] != MP_BC_CALL_FUNCTION or bc[insns[i][0] + 1] != n_args:
+                return None, i
+            entries = self.class_entries(body[1])
+            if entries is None:
+                return None, i
+            return ("class", body[1], name, base, entries), i + 1
+        return None, i
+
+    def class_entries(self, rc):
+        # the locals of a class whose body is rc, if they can all be frozen
+        insns = bytecode_insns(rc)
+        ops = [op for _, op in insns]
+        if ops[:2] != [MP_BC_LOAD_NAME, MP_BC_STORE_NAME] or ops[-3:-1] != [
+            MP_BC_LOAD_CONST_NONE,
+            MP_BC_RETURN_VALUE,
+        ]:
+            return None
+        entries = collections.OrderedDict()
+        entries["__module__"] = ("obj", ["MP_ROM_QSTR(%s)" % self.name.qstr_id])
+        i = 2
+        while i < len(insns) - 3:
+            value, i = self.value(rc, insns, i, None)
+            if value is None or insns[i][1] != MP_BC_STORE_NAME:
+                return None
+            name = rc._unpack_qstr(insns[i][0] + 1).str
+            if name in self.unfrozen_class_names:
+                return None
+            entries[name] = value
+            i += 1
+        return entries
+
+    def count_stores(self, rc, stores, is_module):
+        # count the assignments to each global in rc and the code in it, and
+        # return whether it's all bytecode without "from ... import *"
+        if rc.code_kind != MP_CODE_BYTECODE:
+            return False
+        for ip, op in bytecode_insns(rc)[:-1]:
+            if op == MP_BC_IMPORT_STAR:
+                return False
+            if op in (MP_BC_STORE_GLOBAL, MP_BC_DELETE_GLOBAL) or (
+                is_module and op in (MP_BC_STORE_NAME, MP_BC_DELETE_NAME)
+            ):
+                stores[rc._unpack_qstr(ip + 1).str] += 1 + (op != MP_BC_STORE_NAME)
+        return all(self.count_stores(child, stores, False) for child in rc.raw_codes)
+
+    def find(self):
+        # find the statements of the module that can be evaluated now, and
+        # return whether there are any
+        rc = self.rc
+        stores = collections.Counter()
+        if not self.count_stores(rc, stores, True):
+            return False
+
+        name = rc.source_file.str[:-3].replace("/", ".")
+        if name.endswith(".__init__"):
+            name = name[: -len(".__init__")]
+            self.path = make_qstr(name.replace(".", "/"))
+        else:
+            self.path = None
+        self.name = make_qstr(name)
+
+        # ranges of code that's only run on some paths, from jumps in either direction
+        insns = bytecode_insns(rc)
+        branches = []
+        for ip, op in insns[:-1]:
+            if op >> 4 == MP_BC_JUMP >> 4:
+                offset = rc.bytecode[ip + 1] | rc.bytecode[ip + 2] << 8
+                if op < MP_BC_SETUP_WITH:
+                    offset -= 0x8000
+                target = ip + 3 + offset
+                branches.append((min(ip, target), max(ip, target)))
+
+        globals = collections.OrderedDict()
+        loaded = set()
+        i = 0
+        while i < len(insns) - 1:
+            ip, op = insns[i]
+            if op in (MP_BC_LOAD_NAME, MP_BC_LOAD_GLOBAL):
+                loaded.add(rc._unpack_qstr(ip + 1).str)
+            value, j = self.value(rc, insns, i, globals)
+            if value is not None and insns[j][1] == MP_BC_STORE_NAME:
+                name = rc._unpack_qstr(insns[j][0] + 1).str
+                if (
+                    stores[name] == 1
+                    and name not in loaded
+                    and name not in self.importer_names
+                    and not any(lo <= ip < hi for lo, hi in branches)
+                ):
+                    rc.rom_jumps[ip] = insns[j + 1][0]
+                    globals[name] = value
+                    i = j + 1
+                    continue
+            i += 1
+        if not globals:
+            return False
+
+        # number the namespaces, the module's first
+        self.namespaces.append(FrozenNamespace(None, globals))
+        for value in globals.values():
+            self.add_value(value)
+        return True
+
+    def add_value(self, value):
+        if value[0] == "fun":
+            self.funs.append(value[1])
+        elif value[0] == "class":
+            self.classes.append(value)
+            self.namespaces.append(FrozenNamespace(value[1], value[4]))
+            for v in value[4].values():
+                self.add_value(v)
+
+    def value_lines(self, value):
+        if value[0] == "obj":
+            return value[1]
+        elif value[0] == "const":
+            return value[1].rom_obj(value[2])
+        elif value[0] == "fun":
+            return ["MP_ROM_PTR(&frozen_fun_%s)" % value[1].escaped_name]
+        else:
+            return ["MP_ROM_PTR(&frozen_class_%s)" % value[1].escaped_name]
+
+    def print_table(self, table_name, entries):
+        print("STATIC const mp_rom_map_elem_t %s[] = {" % table_name)
+        for key, value in entries:
+            for line in self.value_lines(value):
+                if line.startswith("#"):
+                    print(line)
+                else:
+                    print("    { MP_ROM_QSTR(%s), %s }," % (key, line))
+        print("};")
+
+    def freeze(self):
+        module_ns = self.namespaces[0]
+        module_ns.table_name = "frozen_globals_table_%s" % self.rc.escaped_name
+        print()
+        print("// frozen globals of module %s" % self.name.str)
+        for rc in self.funs:
+            print("STATIC const mp_obj_fun_bc_t frozen_fun_%s = {" % rc.escaped_name)
+            if rc.prelude[2] & MP_SCOPE_FLAG_GENERATOR:
+                print("    .base = { &mp_type_gen_wrap },")
+            else:
+                print("    .base = { &mp_type_fun_bc },")
+            print("    .globals = %s," % module_ns.c_ref())
+            print("    .bytecode = fun_data_%s," % rc.escaped_name)
+            if len(rc.qstrs) + len(rc.objs) + len(rc.raw_codes):
+                print("    .const_table = (mp_uint_t *)const_table_data_%s," % rc.escaped_name)
+            print("    #if MICROPY_PY_SYS_SETTRACE")
+            print("    .rc = &raw_code_%s," % rc.escaped_name)
+            print("    #endif")
+            print("    #if MICROPY_JIT")
+            print("    .jit_count = MP_JIT_COUNT_FAILED,")
+            print("    #endif")
+            print("};")
+        for ns, value in zip(self.namespaces[1:], self.classes):
+            _, body, name, base, entries = value
+            ns.table_name = "frozen_locals_table_%s" % body.escaped_name
+            self.print_table(ns.table_name, ((make_qstr(k).qstr_id, v) for k, v in entries.items()))
+            fields = "MP_OBJ_TYPE_FROZEN_CLASS(%s, %s, %s)" % (
+                name.qstr_id,
+                "&frozen_class_%s" % base[1].escaped_name if base else "NULL",
+                ns.c_ref(),
+            )
+            print("#if MICROPY_PY_SLOTS")
+            print("STATIC const mp_obj_class_t frozen_class_%s = {" % body.escaped_name)
+            print("    .type = { %s }," % fields)
+            print("};")
+            print("#else")
+            print("STATIC const mp_obj_type_t frozen_class_%s = {" % body.escaped_name)
+            print("    %s," % fields)
+            print("};")
+            print("#endif")
+        entries = [("MP_QSTR___name__", ("obj", ["MP_ROM_QSTR(%s)" % self.name.qstr_id]))]
+        entries.append(
+            (
+                "MP_QSTR___file__",
+                (
+                    "obj",
+                    [
+                        "#if MICROPY_PY___FILE__",
+                        "MP_ROM_QSTR(%s)" % self.rc.source_file.qstr_id,
+                        "#endif",
+                    ],
+                ),
+            )
+        )
+        if self.path:
+            entries.append(("MP_QSTR___path__", ("obj", ["MP_ROM_QSTR(%s)" % self.path.qstr_id])))
+        entries.extend((make_qstr(k).qstr_id, v) for k, v in module_ns.entries.items())
+        self.print_table(module_ns.table_name, entries)
+
+
 class BytecodeBuffer:
     def __init__(self, size):
         self.buf = bytearray(size)
@@ -650,6 +1035,15 @@ def read_uint(f, out=None):
     return i
 
 
+def encode_uint(i):
+    b = bytearray([i & 0x7F])
+    i >>= 7
+    while i:
+        b.insert(0, 0x80 | i & 0x7F)
+        i >>= 7
+    return b
+
+
 def read_qstr(f, qstr_win):
     ln = read_uint(f)
     if ln == 0:
@@ -659,10 +1053,9 @@ def read_qstr(f, qstr_win):
         # qstr in table
         return qstr_win.access(ln >> 1)
     ln >>= 1
-    data = str_cons(f.read(ln), "utf8")
-    global_qstrs.append(QStrType(data))
-    qstr_win.push(len(global_qstrs) - 1)
-    return len(global_qstrs) - 1
+    idx = global_qstr_add(str_cons(f.read(ln), "utf8"))
+    qstr_win.push(idx)
+    return idx
 
 
 def read_obj(f):
@@ -671,6 +1064,8 @@ def read_obj(f):
         return Ellipsis
     else:
         buf = f.read(read_uint(f))
+        if obj_type in (b"s", b"b") and config.mpy_mapped_str:
+            f.read(1)  # null byte
         if obj_type == b"s":
             return str_cons(buf, "utf8")
         elif obj_type == b"b":
@@ -723,7 +1118,7 @@ def read_bytecode(file, bytecode, qstr_win):
             read_byte(file, bytecode)
 
 
-def read_raw_code(f, qstr_win):
+def read_raw_code(f, qstr_win, lazy=False):
     kind_len = read_uint(f)
     kind = (kind_len & 3) + MP_CODE_BYTECODE
     fun_data_len = kind_len >> 2
@@ -771,7 +1166,14 @@ def read_raw_code(f, qstr_win):
         if kind != MP_CODE_BYTECODE:
             objs.append(MPFunTable)
         objs.extend([read_obj(f) for _ in range(n_obj)])
-        raw_codes = [read_raw_code(f, qstr_win) for _ in range(n_raw_code)]
+        for _ in range(n_raw_code):
+            if lazy:
+                # each child is preceded by its length and whether to load it lazily,
+                # and has its own qstr window
+                read_uint(f)
+                raw_codes.append(read_raw_code(f, QStrWindow(qstr_win.size), lazy))
+            else:
+                raw_codes.append(read_raw_code(f, qstr_win))
 
     if kind == MP_CODE_BYTECODE:
         return RawCodeBytecode(fun_data.buf, qstrs, objs, raw_codes)
@@ -800,7 +1202,7 @@ def read_mpy(filename):
         qw_size = read_uint(f)
         config.MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE = (feature_byte & 1) != 0
         config.MICROPY_PY_BUILTINS_STR_UNICODE = (feature_byte & 2) != 0
-        mpy_native_arch = feature_byte >> 2
+        mpy_native_arch = feature_byte >> 2 & 0xF
         if mpy_native_arch != MP_NATIVE_ARCH_NONE:
             if config.native_arch == MP_NATIVE_ARCH_NONE:
                 config.native_arch = mpy_native_arch
@@ -808,8 +1210,12 @@ def read_mpy(filename):
                 raise Exception("native architecture mismatch")
         config.mp_small_int_bits = header[3]
         qstr_win = QStrWindow(qw_size)
-        rc = read_raw_code(f, qstr_win)
+        lazy = (feature_byte & config.MPY_FEATURE_LAZY) != 0
+        config.mpy_mapped_str = (feature_byte & config.MPY_FEATURE_MAPPED_STR) != 0
+        rc = read_raw_code(f, qstr_win, lazy)
         rc.mpy_source_file = filename
+        rc.mpy_lazy = lazy
+        rc.mpy_mapped_str = config.mpy_mapped_str
         rc.qstr_win_size = qw_size
         return rc
 
@@ -820,6 +1226,13 @@ def dump_mpy(raw_codes):
 
 
 def freeze_mpy(base_qstrs, raw_codes):
+    # find the globals that can be put in ROM, which may add qstrs
+    rom_globals = {}
+    for rc in raw_codes:
+        module_globals = FrozenModuleGlobals(rc)
+        if module_globals.find():
+            rom_globals[rc] = module_globals
+
     # add to qstrs
     new = {}
     for q in global_qstrs:
@@ -834,6 +1247,9 @@ def freeze_mpy(base_qstrs, raw_codes):
     print('#include "py/objstr.h"')
     print('#include "py/emitglue.h"')
     print('#include "py/nativeglue.h"')
+    print('#include "py/objtype.h"')
+    print('#include "py/jit.h"')
+    print('#include "py/frozenmod.h"')
     print()
 
     print(
@@ -905,6 +1321,41 @@ def freeze_mpy(base_qstrs, raw_codes):
     for rc in raw_codes:
         rc.freeze(rc.source_file.str.replace("/", "_")[:-3] + "_")
 
+    print()
+    print("#if MICROPY_MODULE_FROZEN_ROM_GLOBALS")
+    namespaces = []
+    for rc in raw_codes:
+        if rc in rom_globals:
+            rom_globals[rc].freeze()
+            namespaces.extend(rom_globals[rc].namespaces)
+    print()
+    print("#define FROZEN_MAP(t) { \\")
+    print("    .all_keys_are_qstrs = 1, .is_fixed = 1, .is_ordered = 1, .copy_on_write = 1, \\")
+    print("    .used = MP_ARRAY_SIZE(t), .alloc = MP_ARRAY_SIZE(t), \\")
+    print("    .table = (mp_map_elem_t *)(mp_rom_map_elem_t *)t }")
+    print("const mp_map_t mp_frozen_mpy_globals_rom[] = {")
+    for ns in namespaces:
+        print("    FROZEN_MAP(%s)," % ns.table_name)
+    if not namespaces:
+        print("    { 0 },")
+    print("};")
+    print("mp_obj_dict_t mp_frozen_mpy_globals[] = {")
+    for ns in namespaces:
+        print("    { .base = { &mp_type_dict }, .map = FROZEN_MAP(%s) }," % ns.table_name)
+    if not namespaces:
+        print("    { .base = { &mp_type_dict } },")
+    print("};")
+    print("const size_t mp_frozen_mpy_globals_len = %u;" % len(namespaces))
+    print("const uint16_t mp_frozen_mpy_globals_index[] = {")
+    n = 0
+    for rc in raw_codes:
+        print("    %u," % n)
+        if rc in rom_globals:
+            n += len(rom_globals[rc].namespaces)
+    print("    %u," % n)
+    print("};")
+    print("#endif")
+
     print()
     print("const char mp_frozen_mpy_names[] = {")
     for rc in raw_codes:
@@ -937,11 +1388,19 @@ def merge_mpy(raw_codes, output_file):
         with open(raw_codes[0].mpy_source_file, "rb") as f:
             merged_mpy.extend(f.read())
     else:
+        lazy = raw_codes[0].mpy_lazy
+        if any(rc.mpy_lazy != lazy for rc in raw_codes):
+            raise Exception("can't merge lazy-load and other .mpy files")
+        mapped_str = raw_codes[0].mpy_mapped_str
+        if any(rc.mpy_mapped_str != mapped_str for rc in raw_codes):
+            raise Exception("can't merge mapped-str and other .mpy files")
         header = bytearray(5)
         header[0] = ord("M")
         header[1] = config.MPY_VERSION
         header[2] = (
-            config.native_arch << 2
+            mapped_str * config.MPY_FEATURE_MAPPED_STR
+            | lazy * config.MPY_FEATURE_LAZY
+            | config.native_arch << 2
             | config.MICROPY_PY_BUILTINS_STR_UNICODE << 1
             | config.MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE
         )
@@ -972,6 +1431,8 @@ def merge_mpy(raw_codes, output_file):
                 f.read(4)  # skip header
                 read_uint(f)  # skip qstr_win_size
                 data = f.read()  # read rest of mpy file
+                if lazy:
+                    merged_mpy.extend(encode_uint(len(data) << 1))
                 merged_mpy.extend(data)
 
     if output_file is None:
@@ -43,6 +43,7 @@ MP_NATIVE_ARCH_ARMV7EMSP = 7
 MP_NATIVE_ARCH_ARMV7EMDP = 8
 MP_NATIVE_ARCH_XTENSA = 9
 MP_NATIVE_ARCH_XTENSAWIN = 10
+MP_NATIVE_ARCH_RV32IMC = 11
 MP_CODE_BYTECODE = 2
 MP_CODE_NATIVE_VIPER = 4
 MP_SCOPE_FLAG_VIPERRELOC = 0x10
@@ -76,6 +77,16 @@ R_ARM_THM_JUMP24 = 30
 R_X86_64_GOTPCREL = 9
 R_X86_64_REX_GOTPCRELX = 42
 R_386_GOT32X = 43
+R_RISCV_32 = 1
+R_RISCV_BRANCH = 16
+R_RISCV_JAL = 17
+R_RISCV_CALL = 18
+R_RISCV_CALL_PLT = 19
+R_RISCV_GOT_HI20 = 20
+R_RISCV_PCREL_HI20 = 23
+R_RISCV_PCREL_LO12_I = 24
+R_RISCV_PCREL_LO12_S = 25
+R_RISCV_RELAX = 51
 
 ################################################################################
 # Architecture configuration
@@ -104,6 +115,11 @@ def asm_jump_xtensa(entry):
     return struct.pack("<BH", jump_op & 0xFF, jump_op >> 8)
 
 
+def asm_jump_rv32(entry):
+    # jal x0, entry
+    return struct.pack("<I", rv32_encode_j(entry) | 0x6F)
+
+
 class ArchData:
     def __init__(self, name, mpy_feature, qstr_entry_size, word_size, arch_got, asm_jump):
         self.name = name
@@ -176,6 +192,14 @@ ARCH_DATA = {
         (R_XTENSA_32, R_XTENSA_PLT),
         asm_jump_xtensa,
     ),
+    "rv32imc": ArchData(
+        "EM_RISCV",
+        MP_NATIVE_ARCH_RV32IMC << 2 | MICROPY_PY_BUILTINS_STR_UNICODE,
+        2,
+        4,
+        (R_RISCV_GOT_HI20,),
+        asm_jump_rv32,
+    ),
 }
 
 ################################################################################
@@ -196,6 +220,30 @@ def pack_u24le(data, offset, value):
     data[offset + 2] = value >> 16 & 0xFF
 
 
+# Immediate fields of RISC-V instructions, as bits to OR into the instruction
+
+
+def rv32_encode_i(imm):
+    return (imm & 0xFFF) << 20
+
+
+def rv32_encode_s(imm):
+    return (imm & 0xFE0) << 20 | (imm & 0x1F) << 7
+
+
+def rv32_encode_b(imm):
+    return (imm & 0x1000) << 19 | (imm & 0x7E0) << 20 | (imm & 0x1E) << 7 | (imm & 0x800) >> 4
+
+
+def rv32_encode_u(imm):
+    # addi and friends sign extend the lower 12 bits, so round up the upper part
+    return (imm + 0x800) & 0xFFFFF000
+
+
+def rv32_encode_j(imm):
+    return (imm & 0x100000) << 11 | (imm & 0x7FE) << 20 | (imm & 0x800) << 9 | imm & 0xFF000
+
+
 def xxd(text):
     for i in range(0, len(text), 16):
         print("{:08x}:".format(i), end="")
@@ -314,6 +362,7 @@ class LinkEnv:
         self.known_syms = {}  # dict of symbols that are defined
         self.unresolved_syms = []  # list of unresolved symbols
         self.mpy_relocs = []  # list of relocations needed in the output .mpy file
+        self.rv32_pcrel_hi = {}  # offsets computed for auipc instructions (RISC-V only)
 
     def check_arch(self, arch_name):
         if arch_name != self.arch.name:
@@ -488,6 +537,9 @@ def do_relocation_text(env, text_addr, r):
         or s_bind == "STB_LOCAL"
         and env.arch.name == "EM_XTENSA"
         and r_info_type == R_XTENSA_32  # not GOT
+        or env.arch.name == "EM_RISCV"
+        and r_info_type
+        in (R_RISCV_BRANCH, R_RISCV_JAL, R_RISCV_CALL, R_RISCV_CALL_PLT, R_RISCV_PCREL_HI20)
     ):
         # Standard relocation to fixed location within text/rodata
         if hasattr(s, "resolved"):
@@ -516,6 +568,16 @@ def do_relocation_text(env, text_addr, r):
             #   R_ARM_THM_CALL: bl
             #   R_ARM_THM_JUMP24: b.w
             reloc_type = "thumb_b"
+        elif env.arch.name == "EM_RISCV":
+            reloc_type = {
+                R_RISCV_BRANCH: "rv32_b",
+                R_RISCV_JAL: "rv32_j",
+                R_RISCV_CALL: "rv32_call",
+                R_RISCV_CALL_PLT: "rv32_call",
+                R_RISCV_PCREL_HI20: "rv32_u",
+            }[r_info_type]
+            if r_info_type == R_RISCV_PCREL_HI20:
+                env.rv32_pcrel_hi[r_offset] = reloc
 
     elif (
         env.arch.name == "EM_386"
@@ -546,6 +608,32 @@ def do_relocation_text(env, text_addr, r):
         addr = env.got_section.addr + got_entry.offset
         reloc = addr - r_offset + r_addend
 
+    elif env.arch.name == "EM_RISCV" and r_info_type == R_RISCV_GOT_HI20:
+        # Relocation pointing to GOT, the upper part of an auipc/lw pair
+        got_entry = env.got_entries[s.name]
+        addr = env.got_section.addr + got_entry.offset
+        reloc = addr - r_offset + r_addend
+        reloc_type = "rv32_u"
+        env.rv32_pcrel_hi[r_offset] = reloc
+
+    elif env.arch.name == "EM_RISCV" and r_info_type in (
+        R_RISCV_PCREL_LO12_I,
+        R_RISCV_PCREL_LO12_S,
+    ):
+        # Lower part of a pc-relative pair, the symbol is the label of the auipc
+        # instruction, and the offset is the one computed for that instruction
+        addr = s.section.addr + s["st_value"]
+        reloc = env.rv32_pcrel_hi[addr]
+        if r_info_type == R_RISCV_PCREL_LO12_I:
+            reloc_type = "rv32_i"
+        else:
+            reloc_type = "rv32_s"
+        log_name = "pcrel_lo"
+
+    elif env.arch.name == "EM_RISCV" and r_info_type == R_RISCV_RELAX:
+        # Hint that the previous relocation can be relaxed, which is not done
+        return
+
     elif env.arch.name == "EM_386" and r_info_type == R_386_GOTOFF:
         # Relocation relative to GOT
         addr = s.section.addr + s["st_value"]
@@ -592,6 +680,23 @@ def do_relocation_text(env, text_addr, r):
         b_h = (b_h & 0xF800) | (new >> 12) & 0x7FF
         b_l = (b_l & 0xF800) | (new >> 1) & 0x7FF
         struct.pack_into("<HH", env.full_text, r_offset, b_h, b_l)
+    elif reloc_type.startswith("rv32_"):
+        # RISC-V uses RELA relocations so the immediate fields are zero
+        (insn,) = struct.unpack_from("<I", env.full_text, r_offset)
+        if reloc_type == "rv32_call":
+            # auipc and jalr
+            (insn2,) = struct.unpack_from("<I", env.full_text, r_offset + 4)
+            insn2 |= rv32_encode_i(reloc)
+            struct.pack_into("<I", env.full_text, r_offset + 4, insn2)
+            reloc_type = "rv32_u"
+        insn |= {
+            "rv32_i": rv32_encode_i,
+            "rv32_s": rv32_encode_s,
+            "rv32_b": rv32_encode_b,
+            "rv32_u": rv32_encode_u,
+            "rv32_j": rv32_encode_j,
+        }[reloc_type](reloc)
+        struct.pack_into("<I", env.full_text, r_offset, insn)
     elif reloc_type == "xtensa_l32r":
         l32r = unpack_u24le(env.full_text, r_offset)
         assert l32r & 0xF == 1  # RI16 encoded l32r
@@ -631,6 +736,8 @@ def do_relocation_data(env, text_addr, r):
         and r_info_type == R_ARM_ABS32
         or env.arch.name == "EM_XTENSA"
         and r_info_type == R_XTENSA_32
+        or env.arch.name == "EM_RISCV"
+        and r_info_type == R_RISCV_32
     ):
         # Relocation in data.rel.ro to internal/external symbol
         if env.arch.word_size == 4:
@@ -956,9 +1063,10 @@ def build_mpy(env, entry_offset, fmpy, native_qstr_vals, native_qstr_objs):
         bss_const_table_idx = bool(env.full_rodata) + 1
         out.write_uint(len(env.full_bss))
 
-    # MPY: relocation information
+    # MPY: relocation information, in address order so that runs of words with
+    # the same destination are merged, and consecutive runs need no offset
     prev_kind = None
-    for base, addr, kind in env.mpy_relocs:
+    for base, addr, kind in sorted(env.mpy_relocs, key=lambda r: (r[0], r[1])):
         if isinstance(kind, str) and kind.startswith(".text"):
             kind = 0
         elif kind in (".rodata", ".data.rel.ro"):
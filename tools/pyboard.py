@@ -71,6 +71,9 @@ import sys
 import time
 import os
 import ast
+import errno
+import struct
+import zlib
 
 try:
     stdout = sys.stdout.buffer
@@ -257,6 +260,7 @@ class Pyboard:
     ):
         self.in_raw_repl = False
         self.use_raw_paste = True
+        self.use_raw_file = True
         if device.startswith("exec:"):
             self.serial = ProcessToSerial(device[len("exec:") :])
         elif device.startswith("execpty:"):
@@ -491,7 +495,101 @@ class Pyboard:
         )
         self.exec_(cmd, data_consumer=stdout_write_bytes)
 
+    def raw_file_start(self, cmd, fname):
+        # check we have a prompt
+        data = self.read_until(1, b">")
+        if not data.endswith(b">"):
+            raise PyboardError("could not enter raw repl")
+
+        # Try to start a binary file transfer, as for raw-paste mode.
+        self.serial.write(b"\x05" + cmd + b"\x01")
+        data = self.serial.read(2)
+        if data != b"R\x01":
+            if data != b"R\x00":
+                # Device doesn't support raw-paste either, and has restarted
+                # the raw REPL; leave its prompt for the next command.
+                data = self.read_until(1, b"w REPL; CTRL-B to exit\r\n")
+                if not data.endswith(b"w REPL; CTRL-B to exit\r\n"):
+                    raise PyboardError("could not enter raw repl")
+            # Don't try to use binary file transfers again for this connection.
+            self.use_raw_file = False
+            return False
+
+        fname = fname.encode("utf8")
+        self.serial.write(struct.pack("<H", len(fname)) + fname)
+        self.raw_file_check_status()
+        return True
+
+    def raw_file_check_status(self):
+        (status,) = struct.unpack("B", self.serial.read(1))
+        if status != 0:
+            # report it like the OSError that fs_get/fs_put would have raised
+            msg = "OSError: [Errno %d] %s" % (status, errno.errorcode.get(status, ""))
+            raise PyboardError("exception", b"", msg.encode("ascii"))
+
+    def raw_file_get(self, src, dest):
+        if not self.raw_file_start(b"G", src):
+            return False
+        crc_ok = True
+        with open(dest, "wb") as f:
+            while True:
+                (n,) = struct.unpack("<H", self.serial.read(2))
+                if n == 0:
+                    break
+                data = self.serial.read(n)
+                (crc,) = struct.unpack("<I", self.serial.read(4))
+                crc_ok &= crc == zlib.crc32(data) & 0xFFFFFFFF
+                f.write(data)
+        if self.serial.read(1) != b"\x04":
+            raise PyboardError("could not complete file transfer")
+        self.raw_file_check_status()
+        if not crc_ok:
+            raise PyboardError("exception", b"", b"fs_get: CRC mismatch")
+        return True
+
+    def raw_file_put(self, src, dest):
+        if not self.raw_file_start(b"P", dest):
+            return False
+        window_size, block_size = struct.unpack("<HH", self.serial.read(4))
+        window_remain = window_size
+        with open(src, "rb") as f:
+            while True:
+                data = f.read(block_size)
+                block = struct.pack("<H", len(data))
+                if data:
+                    block += data + struct.pack("<I", zlib.crc32(data) & 0xFFFFFFFF)
+                # Send the block, within the flow-control window as for raw-paste.
+                i = 0
+                while i < len(block):
+                    while window_remain == 0 or self.serial.inWaiting():
+                        c = self.serial.read(1)
+                        if c == b"\x01":
+                            window_remain += window_size
+                        elif c == b"\x04":
+                            # Device ended the transfer early.
+                            self.raw_file_check_status()
+                            raise PyboardError("could not complete file transfer")
+                        else:
+                            raise PyboardError("unexpected read during file transfer: %r" % c)
+                    b = block[i : i + window_remain]
+                    self.serial.write(b)
+                    window_remain -= len(b)
+                    i += len(b)
+                if not data:
+                    break
+
+        # Wait for the device to finish writing the file.
+        c = self.serial.read(1)
+        while c == b"\x01":
+            c = self.serial.read(1)
+        if c != b"\x04":
+            raise PyboardError("unexpected read during file transfer: %r" % c)
+        self.raw_file_check_status()
+        return True
+
     def fs_get(self, src, dest, chunk_size=256):
+        if self.use_raw_file and self.raw_file_get(src, dest):
+            return
         self.exec_("f=open('%s','rb')\nr=f.read" % src)
         with open(dest, "wb") as f:
             while True:
@@ -510,6 +608,8 @@ class Pyboard:
         self.exec_("f.close()")
 
     def fs_put(self, src, dest, chunk_size=256):
+        if self.use_raw_file and self.raw_file_put(src, dest):
+            return
         self.exec_("f=open('%s','wb')\nw=f.write" % dest)
         with open(src, "rb") as f:
             while True:
@@ -0,0 +1,145 @@
+#!/usr/bin/env python3
+#
+# This tool reads the output of micropython.vm_stats(), from one or more
+# devices or runs, adds the counts together and prints the most common
+# opcodes, pairs of consecutive opcodes and binary ops by operand types:
+#
+#     vmstats.py dev1.txt dev2.txt
+#
+# Lines of other output in the files are ignored, so a log of a REPL session
+# can be read as is.  With -o the sums are also written in the same format as
+# vm_stats(), so the results of a fleet can be merged in stages.  Opcodes and
+# operators are named from py/bc0.h and py/runtime0.h, which must be of the
+# same bytecode version as the firmware.
+
+import argparse
+import collections
+import os
+import re
+
+PY_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "py")
+
+# formats of the opcodes that encode an argument in the opcode itself
+MULTI_OPS = (
+    ("LOAD_CONST_SMALL_INT_MULTI", "LOAD_CONST_SMALL_INT", 64, -16),
+    ("LOAD_FAST_MULTI", "LOAD_FAST", 16, 0),
+    ("STORE_FAST_MULTI", "STORE_FAST", 16, 0),
+)
+
+
+def parse_enum(text, name):
+    body = re.search(r"typedef enum \{([^}]*)\} %s;" % name, text).group(1)
+    body = re.sub(r"//.*", "", body)
+    return re.findall(r"MP_\w+_OP_(\w+),", body)
+
+
+def load_names():
+    with open(os.path.join(PY_DIR, "bc0.h")) as f:
+        bc0 = f.read()
+    with open(os.path.join(PY_DIR, "runtime0.h")) as f:
+        runtime0 = f.read()
+    unary_ops = parse_enum(runtime0, "mp_unary_op_t")
+    binary_ops = parse_enum(runtime0, "mp_binary_op_t")
+
+    values = {}
+    for name, value in re.findall(r"#define MP_BC_(\w+)\s+\((0x[0-9a-f]+)\)", bc0):
+        values[name] = int(value, 16)
+    opcodes = {}
+    for name, base, offset in re.findall(
+        r"#define MP_BC_(\w+)\s+\(MP_BC_(BASE_\w+) \+ (0x[0-9a-f]+)\)", bc0
+    ):
+        opcodes[values[base] + int(offset, 16)] = name
+    for multi, name, num, bias in MULTI_OPS:
+        for i in range(num):
+            opcodes[values[multi] + i] = "%s_%d" % (name, i + bias)
+    # only the ops up to NOT and POWER appear in bytecode
+    for i, op in enumerate(unary_ops[: unary_ops.index("NOT") + 1]):
+        opcodes[values["UNARY_OP_MULTI"] + i] = "UNARY_OP_" + op
+    for i, op in enumerate(binary_ops[: binary_ops.index("POWER") + 1]):
+        opcodes[values["BINARY_OP_MULTI"] + i] = "BINARY_OP_" + op
+
+    with open(os.path.join(PY_DIR, "persistentcode.h")) as f:
+        mpy_version = int(re.search(r"#define MPY_VERSION (\d+)", f.read()).group(1))
+    return opcodes, binary_ops, mpy_version
+
+
+def read_stats(filenames):
+    stats = {
+        "op": collections.Counter(),
+        "pair": collections.Counter(),
+        "binop": collections.Counter(),
+        "dropped": collections.Counter(),
+    }
+    versions = set()
+    for filename in filenames:
+        with open(filename) as f:
+            for line in f:
+                words = line.split()
+                if len(words) == 3 and words[0] == "vm_stats":
+                    if words[1] != "1":
+                        raise SystemExit("%s: unknown vm_stats format %s" % (filename, words[1]))
+                    versions.add(int(words[2]))
+                elif len(words) >= 3 and words[0] in stats:
+                    try:
+                        stats[words[0]][tuple(words[1:-1])] += int(words[-1])
+                    except ValueError:
+                        pass
+    if len(versions) > 1:
+        raise SystemExit("stats are from different bytecode versions: %s" % sorted(versions))
+    return stats, versions.pop() if versions else None
+
+
+def write_stats(filename, stats, mpy_version):
+    with open(filename, "w") as f:
+        f.write("vm_stats 1 %d\n" % mpy_version)
+        for kind in ("op", "pair", "binop", "dropped"):
+            for key, count in sorted(stats[kind].items()):
+                f.write("%s %s %d\n" % (kind, " ".join(key), count))
+
+
+def print_table(title, counter, label, n):
+    total = sum(counter.values())
+    print("%s (%d in total)" % (title, total))
+    for key, count in counter.most_common(n):
+        print("  %10d %5.1f%%  %s" % (count, 100 * count / total, label(key)))
+    print()
+
+
+def main():
+    cmd_parser = argparse.ArgumentParser(description="Add up and show micropython.vm_stats().")
+    cmd_parser.add_argument("-n", type=int, default=20, help="number of entries shown per table")
+    cmd_parser.add_argument("-o", "--output", help="write the sums to this file")
+    cmd_parser.add_argument("files", nargs="+", help="files with the output of vm_stats()")
+    args = cmd_parser.parse_args()
+
+    stats, mpy_version = read_stats(args.files)
+    if mpy_version is None:
+        raise SystemExit("no vm_stats output found")
+    opcodes, binary_ops, source_version = load_names()
+    if mpy_version != source_version:
+        print("warning: stats are for bytecode version %d, names from %d\n" % (mpy_version, source_version))
+    if args.output:
+        write_stats(args.output, stats, mpy_version)
+
+    def op_name(op):
+        return opcodes.get(int(op), "0x%02x" % int(op))
+
+    def binop_name(op):
+        op = int(op)
+        return binary_ops[op] if op < len(binary_ops) else str(op)
+
+    print_table("opcodes", stats["op"], lambda k: op_name(k[0]), args.n)
+    print_table("opcode pairs", stats["pair"], lambda k: "%s, %s" % tuple(map(op_name, k)), args.n)
+    print_table(
+        "binary ops",
+        stats["binop"],
+        lambda k: "%s %s %s" % (k[1], binop_name(k[0]), k[2]),
+        args.n,
+    )
+    for (kind,), count in sorted(stats["dropped"].items()):
+        if count:
+            print("%d counts of %ss dropped by full tables" % (count, kind))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,214 @@
+#!/usr/bin/env python3
+#
+# This tool copies files to and from a device running WebREPL:
+#
+#     webrepl_cli.py -p PASSWORD local_file 192.168.4.1:remote_file
+#     webrepl_cli.py -p PASSWORD 192.168.4.1:remote_file local_file
+#
+# By default the file is moved in records of --chunk bytes, with up to
+# --window records sent ahead of the device's acks for a download, and checked
+# with a CRC32 at the end.  With -z uploads are compressed record by record,
+# and the device decompresses them into the target file.  Use --legacy with
+# firmware that only has the original protocol.
+
+import argparse
+import socket
+import struct
+import zlib
+
+PUT_FILE = 1
+GET_FILE = 2
+
+FLAG_CHUNKED = 0x01
+FLAG_ZLIB = 0x02
+FLAG_CRC32 = 0x04
+
+# must match WEBREPL_ZLIB_SLACK in extmod/modwebrepl.c
+ZLIB_SLACK = 64
+
+
+class WebsocketClient:
+    def __init__(self, host, port):
+        self.sock = socket.create_connection((host, port))
+        # acks are tiny, so don't let them wait to be coalesced
+        self.sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        self.buf = b""
+        # Very simplified handshake, which is enough for MicroPython's server.
+        self.sock.sendall(
+            b"GET / HTTP/1.1\r\nHost: %s\r\nConnection: Upgrade\r\nUpgrade: websocket\r\n"
+            b"Sec-WebSocket-Key: foo\r\n\r\n" % host.encode()
+        )
+        while not self.buf.endswith(b"\r\n\r\n"):
+            self.buf += self._recv(1)
+        self.buf = b""
+
+    def _recv(self, n):
+        data = self.sock.recv(n)
+        if not data:
+            raise SystemExit("connection closed by device")
+        return data
+
+    def _recv_exactly(self, n):
+        data = b""
+        while len(data) < n:
+            data += self._recv(n - len(data))
+        return data
+
+    def write(self, data, text=False):
+        # Frames from a client should be masked, but the device accepts them
+        # unmasked and that saves masking every byte here.
+        op = 0x81 if text else 0x82
+        n = len(data)
+        if n < 126:
+            hdr = struct.pack(">BB", op, n)
+        elif n < 0x10000:
+            hdr = struct.pack(">BBH", op, 126, n)
+        else:
+            hdr = struct.pack(">BBQ", op, 127, n)
+        self.sock.sendall(hdr + data)
+
+    def read_frame(self):
+        op, n = self._recv_exactly(2)
+        if n & 0x7F == 126:
+            (n,) = struct.unpack(">H", self._recv_exactly(2))
+        elif n & 0x7F == 127:
+            (n,) = struct.unpack(">Q", self._recv_exactly(8))
+        else:
+            n &= 0x7F
+        return op & 0x0F, self._recv_exactly(n)
+
+    def read(self, n):
+        # Return n bytes of binary data, skipping the REPL's text output.
+        while len(self.buf) < n:
+            op, data = self.read_frame()
+            if op == 2:
+                self.buf += data
+            elif op == 8:
+                raise SystemExit("connection closed by device")
+        data = self.buf[:n]
+        self.buf = self.buf[n:]
+        return data
+
+    def read_text(self, *until):
+        # Return the REPL's text output up to one of the given strings.
+        text = b""
+        while not any(u in text for u in until):
+            op, data = self.read_frame()
+            if op == 1:
+                text += data
+            elif op == 8:
+                raise SystemExit("connection closed by device")
+        return text
+
+
+def login(ws, passwd):
+    ws.read_text(b"Password: ")
+    ws.write(passwd.encode() + b"\r", text=True)
+    if b"denied" in ws.read_text(b">>> ", b"denied"):
+        raise SystemExit("access denied")
+
+
+def send_req(ws, op, fname, flags=0, chunk=0, window=0, size=0):
+    fname = fname.encode()
+    if len(fname) > 64:
+        raise SystemExit("remote filename too long")
+    hdr = struct.pack("<2sBBHB5xIH64s", b"WA", op, flags, chunk, window, size, len(fname), fname)
+    ws.write(hdr)
+
+
+def read_resp(ws, flags=0):
+    # Read a response, returning the CRC32 the device sent, if any.
+    sig, code = struct.unpack("<2sH", ws.read(4))
+    if sig != b"WB":
+        raise SystemExit("bad response from device")
+    crc = struct.unpack("<I", ws.read(4))[0] if flags & FLAG_CRC32 else None
+    if code != 0:
+        if flags:
+            raise SystemExit("device failed the transfer, or needs --legacy")
+        raise SystemExit("device failed the transfer")
+    return crc
+
+
+def check_crc(expected, crc):
+    if crc is not None and crc != expected:
+        raise SystemExit("CRC32 mismatch: file is %08x on the device" % crc)
+
+
+def put_file(ws, local_file, remote_file, flags, chunk):
+    with open(local_file, "rb") as f:
+        data = f.read()
+    send_req(ws, PUT_FILE, remote_file, flags, chunk, 1, len(data))
+    read_resp(ws)
+    if flags & FLAG_CHUNKED:
+        for i in range(0, len(data), chunk):
+            rec = data[i : i + chunk]
+            if flags & FLAG_ZLIB:
+                rec = zlib.compress(rec)
+                assert len(rec) <= chunk + ZLIB_SLACK
+            ws.write(struct.pack("<H", len(rec)) + rec)
+        ws.write(struct.pack("<H", 0))
+    else:
+        for i in range(0, len(data), 1024):
+            ws.write(data[i : i + 1024])
+    check_crc(zlib.crc32(data), read_resp(ws, flags))
+
+
+def get_file(ws, local_file, remote_file, flags, chunk, window):
+    send_req(ws, GET_FILE, remote_file, flags, chunk, window)
+    read_resp(ws)
+    data = bytearray()
+    while True:
+        if not flags & FLAG_CHUNKED:
+            ws.write(b"\0")
+        (n,) = struct.unpack("<H", ws.read(2))
+        if n == 0:
+            break
+        data += ws.read(n)
+        if flags & FLAG_CHUNKED:
+            ws.write(b"\0")
+    check_crc(zlib.crc32(data), read_resp(ws, flags))
+    with open(local_file, "wb") as f:
+        f.write(data)
+
+
+def main():
+    cmd_parser = argparse.ArgumentParser(description="Copy files to and from WebREPL.")
+    cmd_parser.add_argument("-p", "--password", required=True, help="WebREPL password")
+    cmd_parser.add_argument("--port", type=int, default=8266, help="WebREPL port")
+    cmd_parser.add_argument("--chunk", type=int, default=1024, help="record size in bytes")
+    cmd_parser.add_argument("--window", type=int, default=4, help="records in flight")
+    cmd_parser.add_argument("-z", "--compress", action="store_true", help="compress uploads")
+    cmd_parser.add_argument("--legacy", action="store_true", help="use the original protocol")
+    cmd_parser.add_argument("src", help="source, either local_file or host:remote_file")
+    cmd_parser.add_argument("dst", help="destination, either local_file or host:remote_file")
+    args = cmd_parser.parse_args()
+
+    if not 0 < args.chunk < 0x10000 or not 0 < args.window < 256:
+        raise SystemExit("chunk must be 1 to 65535 and window 1 to 255")
+    if args.legacy:
+        flags = 0
+    else:
+        flags = FLAG_CHUNKED | FLAG_CRC32
+        if args.compress:
+            flags |= FLAG_ZLIB
+
+    if ":" in args.dst:
+        host, remote_file = args.dst.split(":", 1)
+        op = put_file
+    elif ":" in args.src:
+        host, remote_file = args.src.split(":", 1)
+        op = get_file
+    else:
+        raise SystemExit("one of src and dst must be host:remote_file")
+
+    ws = WebsocketClient(host, args.port)
+    login(ws, args.password)
+    if op is put_file:
+        put_file(ws, args.src, remote_file, flags, args.chunk)
+    else:
+        get_file(ws, args.dst, remote_file, flags & ~FLAG_ZLIB, args.chunk, args.window)
+    ws.sock.close()
+
+
+if __name__ == "__main__":
+    main()